@@ -29,13 +29,21 @@ import android.os.IBinder;
 import android.util.Log;
 import android.view.Display;
 import android.view.MotionEvent;
+import android.view.Surface;
 import android.view.View;
 import android.view.WindowManager;
 import android.widget.Button;
 import android.widget.TextView;
 import android.widget.Toast;
 
+import com.projecttango.examples.cpp.util.SurfaceVideoEncoder;
 import com.projecttango.examples.cpp.util.TangoInitializationHelper;
+import com.projecttango.examples.cpp.util.TelemetryBuffer;
+import com.projecttango.examples.cpp.util.TouchBatch;
+
+import java.io.File;
+import java.io.IOException;
+import java.nio.charset.StandardCharsets;
 
 /**
  * The main activity of the application which shows debug information and a
@@ -53,6 +61,26 @@ public class AugmentedRealityActivity extends Activity implements View.OnClickLi
   // service for pose and event information.
   private static final int UPDATE_UI_INTERVAL_MS = 100;
 
+  // Offsets of the fields of the native Telemetry struct, see
+  // tango-augmented-reality/telemetry.h.
+  private static final int POSE_STATUS_OFFSET = 0;
+  private static final int POSE_COUNT_OFFSET = 4;
+  private static final int POSE_DELTA_TIME_OFFSET = 8;
+  private static final int POSITION_OFFSET = 12;
+  private static final int ORIENTATION_OFFSET = 24;
+  private static final int EVENT_COUNT_OFFSET = 40;
+  private static final int EVENT_OFFSET = 44;
+  private static final int EVENT_LENGTH = 256;
+  private static final int FRAME_PACING_WAIT_OFFSET = 300;
+  private static final int RENDER_DURATION_OFFSET = 304;
+  private static final int DOUBLE_LATCH_COUNT_OFFSET = 308;
+  private static final int COLOR_LATENCIES_OFFSET = 312;
+
+  // Names of the TangoPoseStatusType values.
+  private static final String[] POSE_STATUS_NAMES = {
+    "initializing", "valid", "invalid", "unknown"
+  };
+
   // Debug information text.
   // Current frame's pose information.
   private TextView mPoseData;
@@ -68,46 +96,79 @@ public class AugmentedRealityActivity extends Activity implements View.OnClickLi
   // wait for re-initialization of the motion tracking system.
   private Button mMotionReset;
 
+  // Records the AR frames, camera image and virtual content, into an MP4 file
+  // of the external files directory, with the hardware encoder. Set while
+  // recording.
+  private Button mRecordButton;
+  private SurfaceVideoEncoder mVideoEncoder;
+
   // GLSurfaceView and its renderer, all of the graphic content is rendered
   // through OpenGL ES 2.0 in the native code.
   private AugmentedRealityRenderer mRenderer;
   private GLSurfaceView mGLView;
 
+  // Only render when the native code requests it, for a new color camera
+  // image, a touch or a settings change, rather than on every vsync.
+  private boolean mRenderOnDemand = true;
+
   // Screen size for normalizing the touch input for orbiting the render camera.
   private Point mScreenSize = new Point();
 
+  // The touches handed to the native code by the renderer, once per frame.
+  private TouchBatch mTouchBatch = new TouchBatch();
+
   // Handles the debug text UI update loop.
   private Handler mHandler = new Handler();
 
+  // The debug telemetry of the native application, and what updateUi() reads
+  // of it: the delta time, position and orientation of the pose, then the
+  // frame pacing wait and render duration, reused so that polling it does not
+  // allocate.
+  private TelemetryBuffer mTelemetry;
+  private StringBuilder mPoseText = new StringBuilder();
+  private float[] mPose = new float[13];
+  private byte[] mEventBytes = new byte[EVENT_LENGTH];
+  private int mEventCount = 0;
+
+  // Sets up and connects to the Tango service, off the UI thread, while the GL
+  // thread creates the scene. The first frame after both connects the camera.
+  private Thread mStartupThread;
+
   // Tango Service connection.
   ServiceConnection mTangoServiceConnection = new ServiceConnection() {
       public void onServiceConnected(ComponentName name, IBinder service) {
         // The following code block does setup and connection to Tango.
         TangoJNINative.onTangoServiceConnected(AugmentedRealityActivity.this, service);
 
-        // Setup the configuration for the TangoService.
-        TangoJNINative.setupConfig();
-
-        // Connect the onPoseAvailable callback.
-        TangoJNINative.connectCallbacks();
-
-        // Connect to Tango Service (returns true on success).
-        // Starts Motion Tracking and Area Learning.
-        if (TangoJNINative.connect()) {
-          mVersion.setText(TangoJNINative.getVersionNumber());
-        } else {
-          // End the activity and let the user know something went wrong.
-          runOnUiThread(new Runnable() {
-              @Override
-              public void run() {
-                Toast.makeText(AugmentedRealityActivity.this, "Connect Tango Failed.",
-                               Toast.LENGTH_SHORT).show();
-                finish();
-                return;
-              }
-            });
-        }
-      
+        mStartupThread = new Thread(new Runnable() {
+            @Override
+            public void run() {
+              // Setup the configuration for the TangoService.
+              TangoJNINative.setupConfig();
+
+              // Connect the onPoseAvailable callback.
+              TangoJNINative.connectCallbacks();
+
+              // Connect to Tango Service (returns true on success).
+              // Starts Motion Tracking and Area Learning.
+              final boolean isConnected = TangoJNINative.connect();
+              runOnUiThread(new Runnable() {
+                  @Override
+                  public void run() {
+                    if (isConnected) {
+                      mVersion.setText(TangoJNINative.getVersionNumber());
+                      return;
+                    }
+                    // End the activity and let the user know something went
+                    // wrong.
+                    Toast.makeText(AugmentedRealityActivity.this, "Connect Tango Failed.",
+                                   Toast.LENGTH_SHORT).show();
+                    finish();
+                  }
+                });
+            }
+          }, "TangoStartup");
+        mStartupThread.start();
       }
 
       public void onServiceDisconnected(ComponentName name) {
@@ -144,6 +205,7 @@ public class AugmentedRealityActivity extends Activity implements View.OnClickLi
 
     // Text views for displaying most recent Tango Event
     mEvent = (TextView) findViewById(R.id.tango_event_textview);
+    mTelemetry = new TelemetryBuffer(TangoJNINative.getTelemetryBuffer());
 
     // Text views for Tango library versions
     mVersion = (TextView) findViewById(R.id.version_textview);
@@ -172,15 +234,20 @@ public class AugmentedRealityActivity extends Activity implements View.OnClickLi
 
     // Configure OpenGL renderer
     mGLView.setEGLContextClientVersion(2);
+    // Keep the GL resources over a pause, so that resuming does not create
+    // them again. The native code checks whether the context survived.
+    mGLView.setPreserveEGLContextOnPause(true);
+    TangoJNINative.setProgramBinaryDirectory(getCacheDir().getAbsolutePath());
 
     // Set up button click listeners
     mMotionReset.setOnClickListener(this);
+    mRecordButton = (Button) findViewById(R.id.record_button);
+    mRecordButton.setOnClickListener(this);
 
-    // Configure OpenGL renderer. The RENDERMODE_WHEN_DIRTY is set explicitly
+    // Configure OpenGL renderer. The RENDERMODE_WHEN_DIRTY is set in onResume
     // for reducing the CPU load. The request render function call is triggered
-    // by the onTextureAvailable callback from the Tango Service in the native
-    // code.
-    mRenderer = new AugmentedRealityRenderer();
+    // by the render scheduler in the native code.
+    mRenderer = new AugmentedRealityRenderer(mTouchBatch);
     mGLView.setRenderer(mRenderer);
   }
 
@@ -189,16 +256,24 @@ public class AugmentedRealityActivity extends Activity implements View.OnClickLi
     super.onResume();
     mGLView.onResume();
 
-    mGLView.setRenderMode(GLSurfaceView.RENDERMODE_CONTINUOUSLY);
+    mGLView.setRenderMode(mRenderOnDemand ? GLSurfaceView.RENDERMODE_WHEN_DIRTY
+                                          : GLSurfaceView.RENDERMODE_CONTINUOUSLY);
+    TangoJNINative.setRenderOnDemand(mRenderOnDemand);
+    // The camera image and the virtual content are laid out for the rotation
+    // of the display, which the activity is created again for.
+    TangoJNINative.setDisplayRotation(getWindowManager().getDefaultDisplay().getRotation());
     // Start the debug text UI update loop.
     mHandler.post(mUpdateUiLoopRunnable);
 
+    TangoJNINative.beginStartup();
     TangoInitializationHelper.bindTangoService(this, mTangoServiceConnection);
   }
 
   @Override
   protected void onPause() {
     super.onPause();
+    // The GL thread stops drawing into the encoder before the surface goes.
+    stopRecording();
     mGLView.onPause();
 
     TangoJNINative.deleteResources();
@@ -207,6 +282,16 @@ public class AugmentedRealityActivity extends Activity implements View.OnClickLi
     mHandler.removeCallbacksAndMessages(null);
 
     
+    // Let a connection in progress finish before disconnecting.
+    if (mStartupThread != null) {
+      try {
+        mStartupThread.join();
+      } catch (InterruptedException e) {
+        Log.e(TAG, "Interrupted waiting for the Tango startup");
+      }
+      mStartupThread = null;
+    }
+
     // Disconnect from Tango Service, release all the resources that the app is
     // holding from Tango Service.
     TangoJNINative.disconnect();
@@ -219,6 +304,48 @@ public class AugmentedRealityActivity extends Activity implements View.OnClickLi
     TangoJNINative.destroyActivity();
   }
 
+  // Start recording at the size of the GL view, rounded down to the multiple
+  // of 16 encoders expect.
+  private void startRecording() {
+    File file = new File(getExternalFilesDir(null),
+                         "ar_" + System.currentTimeMillis() + ".mp4");
+    try {
+      mVideoEncoder = new SurfaceVideoEncoder(
+          file.getAbsolutePath(), SurfaceVideoEncoder.MIME_AVC,
+          mGLView.getWidth() & ~15, mGLView.getHeight() & ~15);
+    } catch (IOException e) {
+      Log.e(TAG, "Failed to start the video encoder", e);
+      return;
+    }
+    final Surface surface = mVideoEncoder.getInputSurface();
+    mGLView.queueEvent(new Runnable() {
+      @Override
+      public void run() {
+        TangoJNINative.setRecordingSurface(surface);
+      }
+    });
+    mRecordButton.setText(R.string.stop_recording);
+    Toast.makeText(this, file.getAbsolutePath(), Toast.LENGTH_SHORT).show();
+  }
+
+  // Stop drawing into the encoder on the GL thread, then finish the file
+  // there, after the last frame.
+  private void stopRecording() {
+    if (mVideoEncoder == null) {
+      return;
+    }
+    final SurfaceVideoEncoder encoder = mVideoEncoder;
+    mVideoEncoder = null;
+    mGLView.queueEvent(new Runnable() {
+      @Override
+      public void run() {
+        TangoJNINative.setRecordingSurface(null);
+        encoder.stop();
+      }
+    });
+    mRecordButton.setText(R.string.record);
+  }
+
   @Override
   public void onClick(View v) {
     // Handle button clicks.
@@ -235,6 +362,13 @@ public class AugmentedRealityActivity extends Activity implements View.OnClickLi
     case R.id.resetmotion:
       TangoJNINative.resetMotionTracking();
       break;
+    case R.id.record_button:
+      if (mVideoEncoder == null) {
+        startRecording();
+      } else {
+        stopRecording();
+      }
+      break;
     default:
       Log.w(TAG, "Unknown button click");
       return;
@@ -243,42 +377,49 @@ public class AugmentedRealityActivity extends Activity implements View.OnClickLi
 
   @Override
   public boolean onTouchEvent(MotionEvent event) {
-    // Pass the touch event to the native layer for camera control.
+    // Pass the touch event to the native layer for camera control, batched
+    // with the others of the frame, the historical samples of the moves
+    // included.
     // Single touch to rotate the camera around the device.
     // Two fingers to zoom in and out.
     int pointCount = event.getPointerCount();
-    if (pointCount == 1) {
-      float normalizedX = event.getX(0) / mScreenSize.x;
-      float normalizedY = event.getY(0) / mScreenSize.y;
-      TangoJNINative.onTouchEvent(1,
-                                  event.getActionMasked(), normalizedX, normalizedY, 0.0f, 0.0f);
-    }
-    if (pointCount == 2) {
+    float scaleX = 1.0f / mScreenSize.x;
+    float scaleY = 1.0f / mScreenSize.y;
+    boolean isFirst = false;
+    if (pointCount <= 2 && event.getActionMasked() == MotionEvent.ACTION_MOVE) {
+      isFirst = mTouchBatch.addMoves(event, scaleX, scaleY);
+    } else if (pointCount == 1) {
+      float normalizedX = event.getX(0) * scaleX;
+      float normalizedY = event.getY(0) * scaleY;
+      isFirst = mTouchBatch.add(1, event.getActionMasked(), normalizedX,
+                                normalizedY, 0.0f, 0.0f);
+    } else if (pointCount == 2) {
       if (event.getActionMasked() == MotionEvent.ACTION_POINTER_UP) {
         int index = event.getActionIndex() == 0 ? 1 : 0;
-        float normalizedX = event.getX(index) / mScreenSize.x;
-        float normalizedY = event.getY(index) / mScreenSize.y;
-        TangoJNINative.onTouchEvent(1,
-                                    MotionEvent.ACTION_DOWN, normalizedX, normalizedY, 0.0f, 0.0f);
+        float normalizedX = event.getX(index) * scaleX;
+        float normalizedY = event.getY(index) * scaleY;
+        isFirst = mTouchBatch.add(1, MotionEvent.ACTION_DOWN, normalizedX,
+                                  normalizedY, 0.0f, 0.0f);
       } else {
-        float normalizedX0 = event.getX(0) / mScreenSize.x;
-        float normalizedY0 = event.getY(0) / mScreenSize.y;
-        float normalizedX1 = event.getX(1) / mScreenSize.x;
-        float normalizedY1 = event.getY(1) / mScreenSize.y;
-        TangoJNINative.onTouchEvent(2, event.getActionMasked(),
-                                    normalizedX0, normalizedY0, normalizedX1, normalizedY1);
+        float normalizedX0 = event.getX(0) * scaleX;
+        float normalizedY0 = event.getY(0) * scaleY;
+        float normalizedX1 = event.getX(1) * scaleX;
+        float normalizedY1 = event.getY(1) * scaleY;
+        isFirst = mTouchBatch.add(2, event.getActionMasked(), normalizedX0,
+                                  normalizedY0, normalizedX1, normalizedY1);
       }
     }
+    // Rendering on demand, the batch needs a frame to be handed over.
+    if (isFirst) {
+      mGLView.requestRender();
+    }
     return true;
   }
 
   // Request render on the glSurfaceView. This function is called from the
-  // native code, and it is triggered from the onTextureAvailable callback from
-  // the Tango Service.
+  // native code, at most once per frame, when there is a new color camera
+  // image, a touch or a settings change.
   public void requestRender() {
-    if (mGLView.getRenderMode() != GLSurfaceView.RENDERMODE_CONTINUOUSLY) {
-      mGLView.setRenderMode(GLSurfaceView.RENDERMODE_WHEN_DIRTY);
-    }
     mGLView.requestRender();
   }
 
@@ -290,11 +431,68 @@ public class AugmentedRealityActivity extends Activity implements View.OnClickLi
       }
     };
 
-  // Update the debug text UI.
+  // Update the debug text UI from the telemetry, the event text only when a
+  // new event came in.
   private void updateUi() {
     try {
-      mEvent.setText(TangoJNINative.getEventString());
-      mPoseData.setText(TangoJNINative.getPoseString());
+      int sequence;
+      int poseStatus;
+      int poseCount;
+      int eventCount;
+      int doubleLatchCount;
+      int eventLength = 0;
+      do {
+        sequence = mTelemetry.beginRead();
+        poseStatus = mTelemetry.getInt(POSE_STATUS_OFFSET);
+        poseCount = mTelemetry.getInt(POSE_COUNT_OFFSET);
+        mPose[0] = mTelemetry.getFloat(POSE_DELTA_TIME_OFFSET);
+        for (int i = 0; i < 3; ++i) {
+          mPose[1 + i] = mTelemetry.getFloat(POSITION_OFFSET + 4 * i);
+        }
+        for (int i = 0; i < 4; ++i) {
+          mPose[4 + i] = mTelemetry.getFloat(ORIENTATION_OFFSET + 4 * i);
+        }
+        mPose[8] = mTelemetry.getFloat(FRAME_PACING_WAIT_OFFSET);
+        mPose[9] = mTelemetry.getFloat(RENDER_DURATION_OFFSET);
+        doubleLatchCount = mTelemetry.getInt(DOUBLE_LATCH_COUNT_OFFSET);
+        for (int i = 0; i < 3; ++i) {
+          mPose[10 + i] = mTelemetry.getFloat(COLOR_LATENCIES_OFFSET + 4 * i);
+        }
+        eventCount = mTelemetry.getInt(EVENT_COUNT_OFFSET);
+        if (eventCount != mEventCount) {
+          eventLength = mTelemetry.getString(EVENT_OFFSET, mEventBytes);
+        }
+      } while (!mTelemetry.endRead(sequence));
+
+      if (eventCount != mEventCount) {
+        mEventCount = eventCount;
+        mEvent.setText(new String(mEventBytes, 0, eventLength, StandardCharsets.UTF_8));
+      }
+
+      mPoseText.setLength(0);
+      mPoseText.append("status: ")
+          .append(poseStatus >= 0 && poseStatus < POSE_STATUS_NAMES.length
+                  ? POSE_STATUS_NAMES[poseStatus] : "status_code_invalid")
+          .append(", count: ").append(poseCount)
+          .append(", delta time (ms): ");
+      TelemetryBuffer.appendFixed3(mPoseText, mPose[0]);
+      mPoseText.append(", position (m): [");
+      for (int i = 1; i < 8; ++i) {
+        TelemetryBuffer.appendFixed3(mPoseText, mPose[i]);
+        mPoseText.append(i == 3 ? "], orientation: [" : i == 7 ? "]" : ", ");
+      }
+      mPoseText.append("\npacing wait (ms): ");
+      TelemetryBuffer.appendFixed3(mPoseText, mPose[8]);
+      mPoseText.append(", render (ms): ");
+      TelemetryBuffer.appendFixed3(mPoseText, mPose[9]);
+      mPoseText.append(", double latches: ").append(doubleLatchCount);
+      mPoseText.append("\nlatency (ms): to callback ");
+      TelemetryBuffer.appendFixed3(mPoseText, mPose[10]);
+      mPoseText.append(", to render ");
+      TelemetryBuffer.appendFixed3(mPoseText, mPose[11]);
+      mPoseText.append(", to present ");
+      TelemetryBuffer.appendFixed3(mPoseText, mPose[12]);
+      mPoseData.setText(mPoseText);
     } catch (Exception e) {
       e.printStackTrace();
       Log.e(TAG, "Exception updating UI elements");
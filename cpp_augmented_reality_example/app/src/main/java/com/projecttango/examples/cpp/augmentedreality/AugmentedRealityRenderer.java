@@ -17,6 +17,9 @@
 package com.projecttango.examples.cpp.augmentedreality;
 
 import android.opengl.GLSurfaceView;
+
+import com.projecttango.examples.cpp.util.TouchBatch;
+
 import javax.microedition.khronos.egl.EGLConfig;
 import javax.microedition.khronos.opengles.GL10;
 
@@ -25,8 +28,19 @@ import javax.microedition.khronos.opengles.GL10;
  * camera frustum, camera axis, and trajectory based on the Tango device's pose.
  */
 public class AugmentedRealityRenderer implements GLSurfaceView.Renderer {
+  private TouchBatch mTouchBatch;
+
+  public AugmentedRealityRenderer(TouchBatch touchBatch) {
+    mTouchBatch = touchBatch;
+  }
+
   // Render loop of the Gl context.
   public void onDrawFrame(GL10 gl) {
+    // The touches since the previous frame, in a single call.
+    int touchSampleCount = mTouchBatch.take();
+    if (touchSampleCount > 0) {
+      TangoJNINative.onTouchEvents(mTouchBatch.getTaken(), touchSampleCount);
+    }
     TangoJNINative.render();
   }
 
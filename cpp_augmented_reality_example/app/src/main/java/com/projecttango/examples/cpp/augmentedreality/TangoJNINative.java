@@ -18,6 +18,9 @@ package com.projecttango.examples.cpp.augmentedreality;
 
 import android.os.IBinder;
 import android.util.Log;
+import android.view.Surface;
+
+import java.nio.ByteBuffer;
 
 import com.projecttango.examples.cpp.util.TangoInitializationHelper;
 
@@ -42,6 +45,9 @@ public class TangoJNINative {
   public static native boolean checkTangoVersion(AugmentedRealityActivity activity,
       int minTangoVersion);
 
+  // Start timing the startup, logged once the first camera image is drawn.
+  public static native void beginStartup();
+
   // Called when Tango Service is connected successfully.
   public static native void onTangoServiceConnected(AugmentedRealityActivity activity,
                                                     IBinder nativeTangoServiceBinder);
@@ -50,6 +56,11 @@ public class TangoJNINative {
   // the auto-recovery option from here.
   public static native int setupConfig();
 
+  // Localize in an area description on the next setupConfig(), or only track
+  // motion with an empty UUID. The AR content then follows the area
+  // description as the service corrects its pose.
+  public static native void setAreaDescription(String uuid);
+
   // Signal that the activity has been destroyed and remove any cached references.
   public static native void destroyActivity();
 
@@ -65,15 +76,25 @@ public class TangoJNINative {
   // holding from the Tango Service.
   public static native void disconnect();
 
-  // Delete non-GL data structures that are allocated from the program.
+  // Release the data structures bound to the Tango connection. The GL
+  // resources are kept with the EGL context, which the activity preserves.
   public static native void deleteResources();
 
-  // Allocate OpenGL resources for rendering.
+  // Store the linked shader programs in |directory|, so that creating the GL
+  // resources again, after the EGL context was lost or on the next launch,
+  // does not compile them.
+  public static native void setProgramBinaryDirectory(String directory);
+
+  // Allocate OpenGL resources for rendering, unless those of the previous
+  // surface survived with its EGL context.
   public static native void initGlContent();
 
   // Setup the view port width and height.
   public static native void setupGraphic(int width, int height);
 
+  // Set the rotation of the display, a Surface.ROTATION_* value.
+  public static native void setDisplayRotation(int rotation);
+
   // Main render loop.
   public static native void render();
 
@@ -81,20 +102,94 @@ public class TangoJNINative {
   //   first person, third person, or top down.
   public static native void setCamera(int cameraIndex);
 
+  // Set the pose the virtual content is rendered with:
+  //   0 for the pose of the color camera image, 1 for the pose predicted at
+  //   the time the frame is displayed.
+  public static native void setRenderPoseMode(int mode);
+
+  // Show the GPU time of the video overlay and mesh passes over the frame.
+  public static native void setGpuProfilerHudVisible(boolean visible);
+
+  // Stream the fisheye camera along with the color camera, and show it in a
+  // corner of the screen.
+  public static native void setFisheyeStreamEnabled(boolean enabled);
+
+  // Hide the virtual content behind the real geometry, using the point clouds
+  // of the depth camera. Enabled by default.
+  public static native void setDepthOcclusionEnabled(boolean enabled);
+
+  // Map the floor from the point clouds, and show the map around the device
+  // in a corner of the screen.
+  public static native void setFloorMapEnabled(boolean enabled);
+
+  // Detect the fiducial tags in the camera images, and anchor the axes of
+  // each tag where it is first seen.
+  public static native void setTagDetectionEnabled(boolean enabled);
+
+  // Share the depth map and the tags with the other devices localized in the
+  // area description, over UDP broadcast on |port|, and anchor the tags they
+  // saw as well.
+  //
+  // @return false without an area description, or if the socket could not
+  //         be opened.
+  public static native boolean startMapSharing(int port);
+
+  // Stop the sharing of startMapSharing().
+  public static native void stopMapSharing();
+
+  // Render the first person view for both eyes of a headset, side by side,
+  // for a device mounted in one in landscape.
+  public static native void setStereoEnabled(boolean enabled);
+
+  // Start each frame just in time to finish before the next vsync, so that
+  // the camera image shown is the most recent one. Enabled by default.
+  public static native void setFramePacingEnabled(boolean enabled);
+
+  // Save the frames drawn, camera image and virtual content, as PNG files in
+  // an existing directory at up to 8 per second, or stop with an empty one.
+  public static native void setSnapshotDirectory(String directory);
+
+  // Also draw the frames into the input surface of a video encoder, see
+  // SurfaceVideoEncoder, or stop with null. Must be called on the GL thread,
+  // through GLSurfaceView.queueEvent(), and with null before the encoder is
+  // stopped.
+  public static native void setRecordingSurface(Surface surface);
+
+  // Only render when there is a new color camera image, a touch or a settings
+  // change. The GLSurfaceView must use RENDERMODE_WHEN_DIRTY when set, and
+  // RENDERMODE_CONTINUOUSLY otherwise.
+  public static native void setRenderOnDemand(boolean onDemand);
+
   // Explicitly reset motion tracking and restart the pipeline.
   // Note that this will cause motion tracking to re-initialize.
   public static native void resetMotionTracking();
 
-  // Get the latest pose string from our application for display in our debug UI.
-  public static native String getPoseString();
-
-  // Get the latest event string from our application for display in our debug UI.
-  public static native String getEventString();
+  // Get the buffer the application keeps the latest pose and event in, for
+  // display in our debug UI. See TelemetryBuffer, and
+  // tango-augmented-reality/telemetry.h for its layout.
+  public static native ByteBuffer getTelemetryBuffer();
 
   // Get the TangoCore version from our application for display in our debug UI.
   public static native String getVersionNumber();
 
-  // Pass touch events to the native layer.
-  public static native void onTouchEvent(int touchCount, int event0,
-                                         float x0, float y0, float x1, float y1);
+  // Pass the touch samples of a frame to the native layer, handled at the
+  // start of the next render(). See TouchBatch for the layout of |samples|.
+  public static native void onTouchEvents(float[] samples, int sampleCount);
+
+  // Start recording where the native code spends its time, see
+  // tango-gl/tracing.h.
+  public static native void startTracing();
+
+  // Stop recording, the recorded time slices are kept for dumpTrace().
+  public static native void stopTracing();
+
+  // Write the recorded time slices as a Chrome trace JSON file, e.g. under
+  // getExternalFilesDir(null) to pull it from the sdcard.
+  //
+  // @return false if the file could not be written.
+  public static native boolean dumpTrace(String path);
+
+  // Get the native memory accounted to each subsystem, with its high-water
+  // mark, as a JSON object, see tango-gl/memory_accounting.h.
+  public static native String getMemoryReport();
 }
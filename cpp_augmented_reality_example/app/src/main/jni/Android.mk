@@ -20,36 +20,20 @@ PROJECT_ROOT:= $(call my-dir)/../../../../..
 include $(CLEAR_VARS)
 LOCAL_MODULE    := libcpp_augmented_reality_example
 LOCAL_SHARED_LIBRARIES := tango_client_api tango_support_api
+LOCAL_STATIC_LIBRARIES := tango_util tango_gl
 LOCAL_CFLAGS    := -std=c++11
 
 LOCAL_SRC_FILES := augmented_reality_app.cc \
                    jni_interface.cc \
                    pose_data.cc \
                    scene.cc \
-                   tango_event_data.cc \
-                   $(PROJECT_ROOT_FROM_JNI)/tango_gl/axis.cc \
-                   $(PROJECT_ROOT_FROM_JNI)/tango_gl/bounding_box.cc \
-                   $(PROJECT_ROOT_FROM_JNI)/tango_gl/camera.cc \
-                   $(PROJECT_ROOT_FROM_JNI)/tango_gl/conversions.cc \
-                   $(PROJECT_ROOT_FROM_JNI)/tango_gl/drawable_object.cc \
-                   $(PROJECT_ROOT_FROM_JNI)/tango_gl/frustum.cc \
-                   $(PROJECT_ROOT_FROM_JNI)/tango_gl/gesture_camera.cc \
-                   $(PROJECT_ROOT_FROM_JNI)/tango_gl/grid.cc \
-                   $(PROJECT_ROOT_FROM_JNI)/tango_gl/goal_marker.cc \
-                   $(PROJECT_ROOT_FROM_JNI)/tango_gl/line.cc \
-                   $(PROJECT_ROOT_FROM_JNI)/tango_gl/mesh.cc \
-                   $(PROJECT_ROOT_FROM_JNI)/tango_gl/shaders.cc \
-                   $(PROJECT_ROOT_FROM_JNI)/tango_gl/trace.cc \
-                   $(PROJECT_ROOT_FROM_JNI)/tango_gl/transform.cc \
-                   $(PROJECT_ROOT_FROM_JNI)/tango_gl/util.cc \
-                   $(PROJECT_ROOT_FROM_JNI)/tango_gl/video_overlay.cc
+                   tango_event_data.cc
 
-LOCAL_C_INCLUDES := $(PROJECT_ROOT)/tango_gl/include \
-                    $(PROJECT_ROOT)/third_party/glm/
-
-LOCAL_LDLIBS    := -llog -lGLESv2 -L$(SYSROOT)/usr/lib
+LOCAL_LDLIBS    := -llog -lGLESv2 -lEGL -landroid -L$(SYSROOT)/usr/lib
 include $(BUILD_SHARED_LIBRARY)
 
 $(call import-add-path, $(PROJECT_ROOT))
 $(call import-module,tango_client_api)
 $(call import-module,tango_support_api)
+$(call import-module,tango_gl)
+$(call import-module,tango_util)
@@ -14,7 +14,10 @@
  * limitations under the License.
  */
 
+#include <cmath>
+
 #include <tango-gl/conversions.h>
+#include <tango-gl/tracing.h>
 #include <tango_support_api.h>
 
 #include "tango-augmented-reality/augmented_reality_app.h"
@@ -26,6 +29,44 @@ const int kVersionStringLength = 128;
 const float kArCameraNearClippingPlane = 0.1f;
 const float kArCameraFarClippingPlane = 100.0f;
 
+// Work budget of a frame on the render thread, in milliseconds.
+const double kFrameBudget = 12.0;
+
+// The fisheye inset is updated with the color camera images, at most at
+// 15 Hz: enough to judge the tracking, at half the cost of the camera rate.
+const double kFisheyeUpdateInterval = 1.0 / 15.0;
+
+// Time between two snapshots, at the camera image timestamps: 8 per second,
+// which the PNG encoding keeps up with at the display resolution.
+const double kSnapshotInterval = 1.0 / 8.0;
+
+// Point clouds kept for the occlusion: the one acquired, the one being
+// written and the latest.
+const int kOcclusionPointCloudCapacity = 3;
+
+// Edge length of the window of the floor map drawn, in cells, 6.4 meters of
+// the default cells, and the luminance of the device at its center.
+const int kFloorMapSize = 128;
+const uint8_t kFloorMapDeviceLuminance = 64;
+
+// Height of the path above the floor, clear of the occlusion of the floor
+// points.
+const float kPathHeight = 0.03f;
+
+// Pyramids of the camera luminance the tags are detected in: the one
+// acquired, the one being built and the latest.
+const int kLuminancePyramidCapacity = 3;
+
+// Edge length of the black square of the printed tags, in meters.
+const float kTagSize = 0.16f;
+
+// The options of the tag detector, for tags of kTagSize.
+tango_util::TagDetector::Options TagDetectorOptions() {
+  tango_util::TagDetector::Options options;
+  options.tag_size = kTagSize;
+  return options;
+}
+
 // This function routes onTangoEvent callbacks to the application object for
 // handling.
 //
@@ -38,35 +79,129 @@ void onTangoEventAvailableRouter(void* context, const TangoEvent* event) {
   app->onTangoEventAvailable(event);
 }
 
-// This function routes texture callbacks to the application object for
+// This function routes onXYZijAvailable callbacks to the application object
+// for handling.
+//
+// @param context, context will be a pointer to a AugmentedRealityApp
+//        instance on which to call callbacks.
+// @param xyz_ij, point cloud to route to onXYZijAvailable function.
+void onXYZijAvailableRouter(void* context, const TangoXYZij* xyz_ij) {
+  tango_augmented_reality::AugmentedRealityApp* app =
+      static_cast<tango_augmented_reality::AugmentedRealityApp*>(context);
+  app->onXYZijAvailable(xyz_ij);
+}
+
+// This function routes onPoseAvailable callbacks to the application object for
 // handling.
 //
 // @param context, context will be a pointer to a AugmentedRealityApp
 //        instance on which to call callbacks.
-// @param id, id of the updated camera..
-void onTextureAvailableRouter(void* context, TangoCameraId id) {
+// @param pose, pose data to route to onPoseAvailable function.
+void onPoseAvailableRouter(void* context, const TangoPoseData* pose) {
   tango_augmented_reality::AugmentedRealityApp* app =
       static_cast<tango_augmented_reality::AugmentedRealityApp*>(context);
-  app->onTextureAvailable(id);
+  app->onPoseAvailable(pose);
 }
+
+// The frame pairs of the pose callback: the device pose used for rendering,
+// and the corrections of the area description, sent when the service
+// localizes in it or refines the localization.
+const int kStartServiceTDevice = 0;
+const int kAreaDescriptionTStartService = 1;
+const TangoCoordinateFramePair kPoseFramePairs[] = {
+    {TANGO_COORDINATE_FRAME_START_OF_SERVICE, TANGO_COORDINATE_FRAME_DEVICE},
+    {TANGO_COORDINATE_FRAME_AREA_DESCRIPTION,
+     TANGO_COORDINATE_FRAME_START_OF_SERVICE}};
 }  // namespace
 
 namespace tango_augmented_reality {
 void AugmentedRealityApp::onTangoEventAvailable(const TangoEvent* event) {
-  std::lock_guard<std::mutex> lock(tango_event_mutex_);
+  TANGO_TRACE_SCOPE("AugmentedRealityApp::onTangoEventAvailable");
   tango_event_data_.UpdateTangoEvent(event);
+  telemetry_.Write([this](Telemetry* telemetry) {
+    tango_event_data_.WriteTelemetry(telemetry);
+  });
+}
+
+void AugmentedRealityApp::onPoseAvailable(const TangoPoseData* pose) {
+  TANGO_TRACE_SCOPE("AugmentedRealityApp::onPoseAvailable");
+  if (pose->frame.base == TANGO_COORDINATE_FRAME_AREA_DESCRIPTION &&
+      pose->status_code != TANGO_POSE_VALID) {
+    // The anchors keep the last valid correction.
+    return;
+  }
+  // The render thread takes the poses of both pairs at once, as of the
+  // latest tick of the service.
+  if (pose_bus_.OnPoseAvailable(pose)) {
+    const tango_util::PoseBus::Snapshot snapshot = pose_bus_.GetSnapshot();
+    if (snapshot.pose_ticks[kAreaDescriptionTStartService] == snapshot.tick) {
+      render_scheduler_.RequestRender(
+          tango_util::RenderScheduler::kStateChange);
+    }
+  }
+  if (pose->frame.base == TANGO_COORDINATE_FRAME_AREA_DESCRIPTION) {
+    return;
+  }
+  pose_history_.OnPoseAvailable(pose);
+  pose_predictor_.OnPoseAvailable(pose);
 }
 
-void AugmentedRealityApp::onTextureAvailable(TangoCameraId id) {
-  if (id == TANGO_CAMERA_COLOR) {
-    RequestRender();
+void AugmentedRealityApp::onXYZijAvailable(const TangoXYZij* xyz_ij) {
+  TANGO_TRACE_SCOPE("AugmentedRealityApp::onXYZijAvailable");
+  if (!is_depth_occlusion_enabled_ && !is_floor_map_enabled_) {
+    return;
   }
+  point_cloud_queue_.OnPointCloudAvailable(xyz_ij);
+  render_scheduler_.RequestRender(tango_util::RenderScheduler::kPointCloud);
 }
 
 AugmentedRealityApp::AugmentedRealityApp()
-    : calling_activity_obj_(nullptr), on_demand_render_(nullptr) {
+    : pose_bus_(kPoseFramePairs,
+                sizeof(kPoseFramePairs) / sizeof(kPoseFramePairs[0])),
+      pose_history_(kPoseFramePairs[kStartServiceTDevice]),
+      render_pose_mode_(kCameraImagePose),
+      color_latency_(&pose_predictor_),
+      display_configuration_(TANGO_CAMERA_COLOR, kArCameraNearClippingPlane,
+                             kArCameraFarClippingPlane),
+      anchors_(tango_util::AnchorStore::Options()),
+      area_pose_tick_(0),
+      calling_activity_obj_(nullptr),
+      on_demand_render_(nullptr),
+      frame_pacer_(tango_util::FramePacer::Options()),
+      touch_queue_(tango_util::TouchQueue::Options()),
+      quality_governor_(tango_util::QualityGovernor::DefaultLevels(),
+                        kFrameBudget),
+      floor_map_(tango_util::OccupancyGrid::Options()),
+      floor_map_revision_(0),
+      floor_map_center_(0),
+      path_planner_(&floor_map_, tango_util::PathPlanner::Options()),
+      path_revision_(0),
+      path_floor_height_(0.0f),
+      last_snapshot_timestamp_(0.0),
+      tag_detector_(tango_util::TagFamily::Tag16h5(), TagDetectorOptions()),
+      area_T_world_(1.0f),
+      viewport_height_(0) {
+  is_snapshot_directory_changed_ = false;
   is_service_connected_ = false;
   is_texture_id_set_ = false;
+  is_fisheye_stream_enabled_ = false;
+  is_depth_occlusion_enabled_ = true;
+  main_scene_.SetDepthOcclusionEnabled(true);
+  is_floor_map_enabled_ = false;
+  is_tag_detection_enabled_ = false;
+  // The content of the scene is placed in the start of service frame, which
+  // stands for the area description until it is localized in. The first
+  // anchor is Scene::kMarkerAnchor.
+  anchors_.AddAnchor(tango_gl::RigidTransform());
+  // Only the color camera stream asks for frames, the fisheye images are
+  // drawn with the color ones.
+  camera_streams_.SetFrameFunction([this](TangoCameraId camera) {
+    // The timestamp of the image is only known once the texture is updated.
+    if (camera == TANGO_CAMERA_COLOR) {
+      color_latency_.OnFrameAvailable(0.0);
+    }
+    render_scheduler_.RequestRender(tango_util::RenderScheduler::kColorFrame);
+  });
 }
 
 AugmentedRealityApp::~AugmentedRealityApp() { TangoConfig_free(tango_config_); }
@@ -98,12 +233,17 @@ bool AugmentedRealityApp::OnTangoServiceConnected(JNIEnv* env, jobject activity,
   on_demand_render_ = env->GetMethodID(cls, "requestRender", "()V");
 
   calling_activity_obj_ = env->NewGlobalRef(activity);
+  render_scheduler_.SetRequestFunction([this]() { RequestRender(); });
 
-  is_service_connected_ = true;
+  startup_timer_.MarkPhase("service bound");
   return true;
 }
 
 void AugmentedRealityApp::ActivityDestroyed() {
+  // Stop the callbacks from requesting frames before the activity is gone.
+  render_scheduler_.SetRequestFunction(nullptr);
+  frame_pacer_.Stop();
+
   JNIEnv* env;
   java_vm_->GetEnv(reinterpret_cast<void**>(&env), JNI_VERSION_1_6);
   env->DeleteGlobalRef(calling_activity_obj_);
@@ -156,6 +296,31 @@ int AugmentedRealityApp::TangoSetupConfig() {
     return ret;
   }
 
+  // The point clouds of the depth camera hide the virtual objects behind the
+  // real geometry.
+  ret = TangoConfig_setBool(tango_config_, "config_enable_depth", true);
+  if (ret != TANGO_SUCCESS) {
+    LOGE(
+        "AugmentedRealityApp: config_enable_depth() failed with error code: "
+        "%d",
+        ret);
+    return ret;
+  }
+  if (!point_cloud_queue_.IsInitialized()) {
+    int32_t max_point_cloud_elements;
+    ret = TangoConfig_getInt32(tango_config_, "max_point_cloud_elements",
+                               &max_point_cloud_elements);
+    if (ret != TANGO_SUCCESS) {
+      LOGE(
+          "AugmentedRealityApp: Failed to query the maximum number of point "
+          "cloud elements with error code: %d",
+          ret);
+      return ret;
+    }
+    point_cloud_queue_.Initialize(kOcclusionPointCloudCapacity,
+                                  max_point_cloud_elements);
+  }
+
   // Get TangoCore version string from service.
   char tango_core_version[kVersionStringLength];
   ret = TangoConfig_getString(tango_config_, "tango_service_library_version",
@@ -169,9 +334,28 @@ int AugmentedRealityApp::TangoSetupConfig() {
   }
   tango_core_version_string_ = tango_core_version;
 
+  // The corrections of the area description then move the content.
+  if (!area_description_uuid_.empty()) {
+    ret = TangoConfig_setString(tango_config_,
+                                "config_load_area_description_UUID",
+                                area_description_uuid_.c_str());
+    if (ret != TANGO_SUCCESS) {
+      LOGE(
+          "AugmentedRealityApp: config_load_area_description_UUID() failed "
+          "with error code: %d",
+          ret);
+      return ret;
+    }
+  }
+
+  startup_timer_.MarkPhase("config set up");
   return ret;
 }
 
+void AugmentedRealityApp::SetAreaDescription(const std::string& uuid) {
+  area_description_uuid_ = uuid;
+}
+
 int AugmentedRealityApp::TangoConnectCallbacks() {
   // Attach onEventAvailable callback.
   // The callback will be called after the service is connected.
@@ -184,6 +368,31 @@ int AugmentedRealityApp::TangoConnectCallbacks() {
     return ret;
   }
 
+  // Record the device poses, so the render thread can look them up without
+  // querying the service on every frame, and follow the corrections of the
+  // area description.
+  ret = TangoService_connectOnPoseAvailable(pose_bus_.GetFramePairCount(),
+                                            pose_bus_.GetFramePairs(),
+                                            onPoseAvailableRouter);
+  if (ret != TANGO_SUCCESS) {
+    LOGE(
+        "AugmentedRealityApp: Failed to connect to pose callback with error"
+        "code: %d",
+        ret);
+    return ret;
+  }
+
+  // Attach the point cloud callback of the occlusion.
+  ret = TangoService_connectOnXYZijAvailable(onXYZijAvailableRouter);
+  if (ret != TANGO_SUCCESS) {
+    LOGE(
+        "AugmentedRealityApp: Failed to connect to point cloud callback with "
+        "error code: %d",
+        ret);
+    return ret;
+  }
+
+  startup_timer_.MarkPhase("callbacks connected");
   return ret;
 }
 
@@ -198,8 +407,9 @@ bool AugmentedRealityApp::TangoConnect() {
         ret);
     return false;
   }
+  startup_timer_.MarkPhase("service connected");
 
-  ret = UpdateExtrinsics();
+  ret = extrinsics_.Update();
   if (ret != TANGO_SUCCESS) {
     LOGE(
         "AugmentedRealityApp: Failed to query sensor extrinsic with error "
@@ -207,6 +417,29 @@ bool AugmentedRealityApp::TangoConnect() {
         ret);
     return false;
   }
+
+  // The color camera intrinsics match the virtual render camera to the
+  // physical camera, queried here so the first frame does not wait for them.
+  ret = intrinsics_.Update(TANGO_CAMERA_COLOR);
+  if (ret != TANGO_SUCCESS) {
+    LOGE(
+        "AugmentedRealityApp: Failed to get camera intrinsics with error"
+        "code: %d",
+        ret);
+    return false;
+  }
+  // The fisheye intrinsics undistort its inset, which is drawn distorted
+  // without them.
+  ret = intrinsics_.Update(TANGO_CAMERA_FISHEYE);
+  if (ret != TANGO_SUCCESS) {
+    LOGI("AugmentedRealityApp: No fisheye camera intrinsics, error code: %d",
+         ret);
+  }
+  startup_timer_.MarkPhase("calibration queried");
+
+  is_service_connected_ = true;
+  // Draw a frame to connect the color camera texture.
+  render_scheduler_.RequestRender(tango_util::RenderScheduler::kStateChange);
   return true;
 }
 
@@ -224,127 +457,228 @@ void AugmentedRealityApp::TangoDisconnect() {
 void AugmentedRealityApp::TangoResetMotionTracking() {
   main_scene_.ResetTrajectory();
   TangoService_resetMotionTracking();
+  render_scheduler_.RequestRender(tango_util::RenderScheduler::kStateChange);
 }
 
 void AugmentedRealityApp::InitializeGLContent() {
+  switch (gl_context_.CheckCurrentContext()) {
+    case tango_gl::GlContextTracker::kContextKept:
+      return;
+    case tango_gl::GlContextTracker::kContextLost:
+      // Nothing was created in the new context yet, so this only frees the
+      // memory of the objects whose names died with the old one.
+      main_scene_.DeleteResources();
+      frame_capture_.InvalidateGlResources();
+      encoder_surface_.InvalidateGlResources();
+      camera_luminance_.InvalidateGlResources();
+      tango_gl::util::DeleteSharedPrograms();
+      tango_gl::util::DeleteSharedVertexBuffers();
+      break;
+    case tango_gl::GlContextTracker::kNoContext:
+      break;
+  }
+  // The shaders are loaded from the program binaries linked by a previous
+  // context or launch, see SetProgramBinaryDirectory().
   main_scene_.InitGLContent();
+  gl_context_.Attach();
+  // Does nothing after the first surface of the activity.
+  frame_pacer_.Start();
+  startup_timer_.MarkPhase("GL content created");
+  // The service renders into the texture of the new video overlay.
+  is_texture_id_set_ = false;
+  // The new context has the default view port.
+  display_configuration_.Invalidate();
 }
 
 void AugmentedRealityApp::SetViewPort(int width, int height) {
-  viewport_width_ = width;
-  viewport_height_ = height;
+  display_configuration_.SetSurfaceSize(width, height);
+}
+
+void AugmentedRealityApp::SetDisplayRotation(int rotation) {
+  display_configuration_.SetDisplayRotation(rotation);
+  render_scheduler_.RequestRender(tango_util::RenderScheduler::kStateChange);
 }
 
 void AugmentedRealityApp::Render() {
+  TANGO_TRACE_SCOPE("AugmentedRealityApp::Render");
+  // Wait for the start of the frame before anything of it is latched. The
+  // wait is not part of the frame time of the governor.
+  const double pacing_wait = frame_pacer_.BeginFrame();
+  render_scheduler_.BeginFrame();
+  quality_governor_.BeginFrame();
+  // The touches of the frame, before the camera is updated.
+  touch_queue_.Take(&touch_samples_);
+  for (const tango_util::TouchSample& sample : touch_samples_) {
+    main_scene_.OnTouchEvent(sample.touch_count, sample.event, sample.x0,
+                             sample.y0, sample.x1, sample.y1);
+  }
   if (is_service_connected_ && !is_texture_id_set_) {
     is_texture_id_set_ = true;
-    // Connect color camera texture. TangoService_connectTextureId expects a
+    // Connect the camera textures. TangoService_connectTextureId expects a
     // valid texture id from the caller, so we will need to wait until the GL
-    // content is properly allocated.
-    TangoErrorType ret = TangoService_connectTextureId(
-        TANGO_CAMERA_COLOR, main_scene_.GetVideoOverlayTextureId(), this,
-        onTextureAvailableRouter);
-    if (ret != TANGO_SUCCESS) {
-      LOGE(
-          "AugmentedRealityApp: Failed to connect the texture id with error"
-          "code: %d",
-          ret);
-    }
+    // content is properly allocated. A device without a fisheye texture
+    // stream still shows the color one.
+    camera_streams_.Clear();
+    camera_streams_.AddStream(TANGO_CAMERA_COLOR,
+                              main_scene_.GetVideoOverlayTextureId(),
+                              tango_util::CameraStreamScheduler::kLatestFrame);
+    camera_streams_.AddStream(TANGO_CAMERA_FISHEYE,
+                              main_scene_.GetFisheyeOverlayTextureId(),
+                              GetFisheyeDropPolicy(), kFisheyeUpdateInterval);
+    camera_streams_.Connect();
 
-    // Query intrinsics for the color camera from the Tango Service, because we
-    // want to match the virtual render camera's intrinsics to the physical
-    // camera, we will compute the actually projection matrix and the view port
-    // ratio for the render.
-    ret = TangoService_getCameraIntrinsics(TANGO_CAMERA_COLOR,
-                                           &color_camera_intrinsics_);
-    if (ret != TANGO_SUCCESS) {
-      LOGE(
-          "AugmentedRealityApp: Failed to get camera intrinsics with error"
-          "code: %d",
-          ret);
+    TangoCameraIntrinsics fisheye_camera_intrinsics;
+    if (intrinsics_.GetIntrinsics(TANGO_CAMERA_FISHEYE,
+                                  &fisheye_camera_intrinsics)) {
+      main_scene_.SetFisheyeIntrinsics(fisheye_camera_intrinsics);
     }
 
-    float image_width = static_cast<float>(color_camera_intrinsics_.width);
-    float image_height = static_cast<float>(color_camera_intrinsics_.height);
-    float fx = static_cast<float>(color_camera_intrinsics_.fx);
-    float fy = static_cast<float>(color_camera_intrinsics_.fy);
-    float cx = static_cast<float>(color_camera_intrinsics_.cx);
-    float cy = static_cast<float>(color_camera_intrinsics_.cy);
-
-    float image_plane_ratio = image_height / image_width;
-    float image_plane_distance = 2.0f * fx / image_width;
-
-    glm::mat4 projection_mat_ar =
-        tango_gl::Camera::ProjectionMatrixForCameraIntrinsics(
-            image_width, image_height, fx, fy, cx, cy,
-            kArCameraNearClippingPlane, kArCameraFarClippingPlane);
-
-    main_scene_.SetFrustumScale(
-        glm::vec3(1.0f, image_plane_ratio, image_plane_distance));
-    main_scene_.SetCameraImagePlaneRatio(image_plane_ratio);
-    main_scene_.SetImagePlaneDistance(image_plane_distance);
-    main_scene_.SetARCameraProjectionMatrix(projection_mat_ar);
-
-    float screen_ratio = static_cast<float>(viewport_height_) /
-                         static_cast<float>(viewport_width_);
-    // In the following code, we place the view port at (0, 0) from the bottom
-    // left corner of the screen. By placing it at (0,0), the view port may not
-    // be exactly centered on the screen. However, this won't affect AR
-    // visualization as the correct registration of AR objects relies on the
-    // aspect ratio of the screen and video overlay, but not the position of the
-    // view port.
-    //
-    // To place the view port in the center of the screen, please use following
-    // code:
-    //
-    // if (image_plane_ratio < screen_ratio) {
-    //   glViewport(-(h / image_plane_ratio - w) / 2, 0,
-    //              h / image_plane_ratio, h);
-    // } else {
-    //   glViewport(0, -(w * image_plane_ratio - h) / 2, w,
-    //              w * image_plane_ratio);
-    // }
-
-    if (image_plane_ratio < screen_ratio) {
-      glViewport(0, 0, viewport_height_ / image_plane_ratio, viewport_height_);
-    } else {
-      glViewport(0, 0, viewport_width_, viewport_width_ * image_plane_ratio);
-    }
     main_scene_.SetCameraType(
         tango_gl::GestureCamera::CameraType::kFirstPerson);
   }
 
-  double video_overlay_timestamp;
-  TangoErrorType status =
-      TangoService_updateTexture(TANGO_CAMERA_COLOR, &video_overlay_timestamp);
+  // Match the virtual render camera's intrinsics to the physical camera, for
+  // the rotation of the display and the size of the surface. The layout is
+  // only applied again when one of them changed, and each layout is computed
+  // once.
+  tango_util::DisplayConfiguration::Layout layout;
+  if (is_service_connected_ &&
+      display_configuration_.Update(&intrinsics_, &layout)) {
+    ApplyDisplayLayout(layout);
+  }
+
+  // Only the textures with a new camera image are updated, so a frame drawn
+  // for an input or a state change keeps the current images.
+  const uint32_t updated_streams = camera_streams_.UpdateTextures();
+  const double video_overlay_timestamp =
+      camera_streams_.GetTimestamp(TANGO_CAMERA_COLOR);
+  if ((updated_streams & tango_util::CameraStreamScheduler::StreamBit(
+                             TANGO_CAMERA_COLOR)) != 0 &&
+      video_overlay_timestamp != 0.0) {
+    // Does nothing once the first image was drawn.
+    startup_timer_.Finish("first camera frame");
+  }
 
   glm::mat4 color_camera_pose =
-      GetPoseMatrixAtTimestamp(video_overlay_timestamp);
+      render_pose_mode_ == kPredictedDisplayPose
+          ? GetPredictedPoseMatrix()
+          : GetPoseMatrixAtTimestamp(video_overlay_timestamp);
   color_camera_pose =
-      pose_data_.GetExtrinsicsAppliedOpenGLWorldFrame(color_camera_pose);
-  if (status != TANGO_SUCCESS) {
-    LOGE(
-        "AugmentedRealityApp: Failed to update video overlay texture with "
-        "error code: %d",
-        status);
+      extrinsics_.GetOpenGlWorldTColorOpenGlCamera(color_camera_pose);
+  UpdateAnchors();
+  UpdateMapSharing();
+  if (is_depth_occlusion_enabled_ || is_floor_map_enabled_ ||
+      map_sync_.IsSharing()) {
+    UpdateDepth(video_overlay_timestamp);
+  }
+  if (is_tag_detection_enabled_) {
+    UpdateTags((updated_streams & tango_util::CameraStreamScheduler::StreamBit(
+                                      TANGO_CAMERA_COLOR)) != 0,
+               video_overlay_timestamp);
   }
+  main_scene_.SetOverlayScale(quality_governor_.GetLevel().render_scale);
   main_scene_.Render(color_camera_pose);
+  UpdateSnapshots(video_overlay_timestamp);
+  // Only the frames of a new camera image are recorded, at its timestamp.
+  encoder_surface_.Draw(video_overlay_timestamp);
+  quality_governor_.EndFrame();
+  frame_pacer_.EndFrame();
+  color_latency_.OnFrameRendered(video_overlay_timestamp);
+
+  const tango_util::FramePacer::Stats pacing_stats = frame_pacer_.GetStats();
+  telemetry_.Write([this, pacing_wait, &pacing_stats](Telemetry* telemetry) {
+    telemetry->frame_pacing_wait = static_cast<float>(pacing_wait);
+    telemetry->render_duration =
+        static_cast<float>(pacing_stats.render_duration);
+    telemetry->double_latch_count =
+        static_cast<int32_t>(pacing_stats.double_latch_count);
+    // The first stages of the tracker, in order.
+    for (int stage = 0; stage < Telemetry::kLatencyStageCount; ++stage) {
+      telemetry->color_latencies[stage] = static_cast<float>(
+          color_latency_
+              .GetStatistics(
+                  static_cast<tango_util::LatencyTracker::Stage>(stage))
+              .average_ms);
+    }
+  });
 }
 
-void AugmentedRealityApp::DeleteResources() {
-  is_service_connected_ = false;
-  is_texture_id_set_ = false;
-  main_scene_.DeleteResources();
+void AugmentedRealityApp::UpdateAnchors() {
+  const tango_util::PoseBus::Snapshot poses = pose_bus_.GetSnapshot();
+  const uint64_t area_pose_tick =
+      poses.pose_ticks[kAreaDescriptionTStartService];
+  if (area_pose_tick != 0 && area_pose_tick != area_pose_tick_) {
+    area_pose_tick_ = area_pose_tick;
+    // The content is drawn in the OpenGL world of the start of service
+    // frame, so is the area description it is anchored to.
+    const TangoPoseData& area_T_start_service =
+        poses.poses[kAreaDescriptionTStartService];
+    const glm::mat4 opengl_world_T_tango_world =
+        tango_gl::conversions::opengl_world_T_tango_world();
+    const glm::mat4 world_T_area =
+        opengl_world_T_tango_world *
+        glm::inverse(tango_gl::conversions::TransformFromArrays(
+            area_T_start_service.translation,
+            area_T_start_service.orientation)) *
+        glm::inverse(opengl_world_T_tango_world);
+    anchors_.SetWorldTArea(tango_gl::RigidTransform::FromMatrix(world_T_area));
+    area_T_world_ = glm::inverse(world_T_area);
+  }
+  // One pass over the anchors moves all the content, whatever the number of
+  // objects on each.
+  if (anchors_.Update()) {
+    main_scene_.SetAnchorTransforms(anchors_.GetTransforms());
+  }
+  if (anchors_.IsSmoothing()) {
+    render_scheduler_.RequestRender(tango_util::RenderScheduler::kStateChange);
+  }
 }
 
-std::string AugmentedRealityApp::GetPoseString() {
-  std::lock_guard<std::mutex> lock(pose_mutex_);
-  return pose_data_.GetPoseDebugString();
+void AugmentedRealityApp::SetRecordingWindow(ANativeWindow* window) {
+  if (window == nullptr) {
+    encoder_surface_.Detach();
+  } else if (!encoder_surface_.Attach(window)) {
+    LOGE("AugmentedRealityApp: failed to record into the encoder surface");
+  }
 }
 
-std::string AugmentedRealityApp::GetEventString() {
-  std::lock_guard<std::mutex> lock(tango_event_mutex_);
-  return tango_event_data_.GetTangoEventString().c_str();
+void AugmentedRealityApp::SetSnapshotDirectory(const std::string& directory) {
+  std::lock_guard<std::mutex> lock(snapshot_mutex_);
+  snapshot_directory_ = directory;
+  is_snapshot_directory_changed_ = true;
+}
+
+void AugmentedRealityApp::UpdateSnapshots(double color_timestamp) {
+  // The writer is started and stopped on the GL thread, the only one writing
+  // to it.
+  if (is_snapshot_directory_changed_.exchange(false)) {
+    std::lock_guard<std::mutex> lock(snapshot_mutex_);
+    snapshot_writer_.Stop();
+    if (!snapshot_directory_.empty()) {
+      GLint viewport[4];
+      glGetIntegerv(GL_VIEWPORT, viewport);
+      snapshot_writer_.Start(snapshot_directory_.c_str(),
+                             static_cast<size_t>(viewport[2]) * viewport[3] * 4,
+                             tango_util::SnapshotWriter::Options());
+      last_snapshot_timestamp_ = 0.0;
+    }
+  }
+  // The frames captured before a stop are dropped by the writer.
+  frame_capture_.ReadFinishedFrames([this](const uint8_t* rgba, int width,
+                                           int height, double timestamp) {
+    snapshot_writer_.Write(rgba, width, height, timestamp);
+  });
+  if (snapshot_writer_.IsRunning() && color_timestamp != 0.0 &&
+      color_timestamp - last_snapshot_timestamp_ >= kSnapshotInterval &&
+      frame_capture_.Capture(color_timestamp)) {
+    last_snapshot_timestamp_ = color_timestamp;
+  }
+}
+
+void AugmentedRealityApp::DeleteResources() {
+  is_service_connected_ = false;
+  is_texture_id_set_ = false;
+  camera_streams_.Clear();
 }
 
 std::string AugmentedRealityApp::GetVersionString() {
@@ -354,21 +688,315 @@ std::string AugmentedRealityApp::GetVersionString() {
 void AugmentedRealityApp::SetCameraType(
     tango_gl::GestureCamera::CameraType camera_type) {
   main_scene_.SetCameraType(camera_type);
+  render_scheduler_.RequestRender(tango_util::RenderScheduler::kInput);
+}
+
+void AugmentedRealityApp::SetGpuProfilerHudVisible(bool visible) {
+  main_scene_.SetGpuProfilerHudVisible(visible);
+  render_scheduler_.RequestRender(tango_util::RenderScheduler::kStateChange);
+}
+
+void AugmentedRealityApp::SetFisheyeStreamEnabled(bool enabled) {
+  is_fisheye_stream_enabled_ = enabled;
+  camera_streams_.SetDropPolicy(TANGO_CAMERA_FISHEYE, GetFisheyeDropPolicy());
+  main_scene_.SetFisheyeOverlayVisible(enabled);
+  render_scheduler_.RequestRender(tango_util::RenderScheduler::kStateChange);
+}
+
+tango_util::CameraStreamScheduler::DropPolicy
+AugmentedRealityApp::GetFisheyeDropPolicy() const {
+  return is_fisheye_stream_enabled_
+             ? tango_util::CameraStreamScheduler::kWithReference
+             : tango_util::CameraStreamScheduler::kPaused;
+}
+
+void AugmentedRealityApp::SetDepthOcclusionEnabled(bool enabled) {
+  is_depth_occlusion_enabled_ = enabled;
+  main_scene_.SetDepthOcclusionEnabled(enabled);
+  render_scheduler_.RequestRender(tango_util::RenderScheduler::kStateChange);
+}
+
+void AugmentedRealityApp::SetFloorMapEnabled(bool enabled) {
+  is_floor_map_enabled_ = enabled;
+  main_scene_.SetFloorMapVisible(enabled);
+  main_scene_.SetPathVisible(enabled);
+  render_scheduler_.RequestRender(tango_util::RenderScheduler::kStateChange);
+}
+
+void AugmentedRealityApp::SetTagDetectionEnabled(bool enabled) {
+  is_tag_detection_enabled_ = enabled;
+  render_scheduler_.RequestRender(tango_util::RenderScheduler::kStateChange);
+}
+
+bool AugmentedRealityApp::StartMapSharing(int port) {
+  if (area_description_uuid_.empty()) {
+    LOGE("AugmentedRealityApp: the map is only shared in an area description");
+    return false;
+  }
+  return map_sync_.Start(area_description_uuid_.c_str(), port,
+                         tango_util::MapSync::Options());
+}
+
+void AugmentedRealityApp::StopMapSharing() { map_sync_.Stop(); }
+
+void AugmentedRealityApp::UpdateMapSharing() {
+  if (!map_sync_.IsSharing() || area_pose_tick_ == 0) {
+    return;
+  }
+  // Only the anchors which moved are sent again.
+  for (const auto& tag_anchor : tag_anchors_) {
+    map_sync_.SetAnchor(tag_anchor.first,
+                        anchors_.GetAreaTAnchor(tag_anchor.second));
+  }
+  map_sync_.TakeRemoteAnchors(&remote_anchors_);
+  bool has_new_anchor = false;
+  for (const tango_util::MapSync::RemoteAnchor& remote : remote_anchors_) {
+    // As for the tags seen here, a tag is anchored where it is first seen.
+    if (tag_anchors_.count(remote.id) != 0) {
+      continue;
+    }
+    const int anchor = anchors_.AddAreaAnchor(remote.area_T_anchor);
+    tag_anchors_[remote.id] = anchor;
+    main_scene_.AddTagMarker(anchor, kTagSize);
+    has_new_anchor = true;
+  }
+  if (has_new_anchor) {
+    main_scene_.SetAnchorTransforms(anchors_.GetTransforms());
+  }
+}
+
+void AugmentedRealityApp::UpdateTags(bool is_new_image,
+                                     double color_timestamp) {
+  TangoCameraIntrinsics intrinsics;
+  if (!intrinsics_.GetIntrinsics(TANGO_CAMERA_COLOR, &intrinsics)) {
+    return;
+  }
+  // The tags are detected at half the size of the camera image, the first
+  // level of the pyramid being the luminance read back.
+  if (!luminance_pyramid_.IsInitialized()) {
+    luminance_pyramid_.Initialize(kLuminancePyramidCapacity,
+                                  static_cast<int>(intrinsics.width),
+                                  static_cast<int>(intrinsics.height));
+    camera_luminance_.SetSize(static_cast<int>(intrinsics.width) / 2,
+                              static_cast<int>(intrinsics.height) / 2);
+  }
+  camera_luminance_.ReadFinishedImages([this](const uint8_t* luminance,
+                                              int width, int height,
+                                              double timestamp) {
+    luminance_pyramid_.OnLuminanceAvailable(luminance, width, height, width,
+                                            timestamp);
+  });
+  if (is_new_image && color_timestamp != 0.0) {
+    camera_luminance_.Render(main_scene_.GetVideoOverlayTextureId(),
+                             color_timestamp);
+  }
+  bool is_new;
+  const tango_util::ImagePyramidFrame* frame =
+      luminance_pyramid_.Acquire(&is_new);
+  if (frame == nullptr || !is_new ||
+      tag_detector_.Detect(frame->levels[0], intrinsics) == 0) {
+    return;
+  }
+
+  // The tags are posed with the color camera at the time of their image, in
+  // the OpenGL world the anchors are placed in.
+  TangoPoseData pose_start_service_T_device;
+  if (pose_history_.GetPoseAtTime(frame->timestamp,
+                                  &pose_start_service_T_device) !=
+          TANGO_SUCCESS ||
+      pose_start_service_T_device.status_code != TANGO_POSE_VALID) {
+    return;
+  }
+  const tango_gl::RigidTransform world_T_color_camera =
+      tango_gl::RigidTransform::FromMatrix(
+          extrinsics_.GetOpenGlWorldTStartService() *
+          pose_data_.GetMatrixFromPose(pose_start_service_T_device) *
+          extrinsics_.GetDeviceTColorCamera());
+  bool has_new_anchor = false;
+  for (const tango_util::TagDetection& tag : tag_detector_.GetDetections()) {
+    if (tag_anchors_.count(tag.id) != 0) {
+      continue;
+    }
+    const int anchor =
+        anchors_.AddAnchor(world_T_color_camera * tag.camera_T_tag);
+    tag_anchors_[tag.id] = anchor;
+    main_scene_.AddTagMarker(anchor, kTagSize);
+    has_new_anchor = true;
+  }
+  if (has_new_anchor) {
+    main_scene_.SetAnchorTransforms(anchors_.GetTransforms());
+  }
+}
+
+void AugmentedRealityApp::SetStereoEnabled(bool enabled) {
+  main_scene_.SetStereoEnabled(enabled);
+  render_scheduler_.RequestRender(tango_util::RenderScheduler::kStateChange);
+}
+
+void AugmentedRealityApp::SetFramePacingEnabled(bool enabled) {
+  frame_pacer_.SetEnabled(enabled);
+}
+
+void AugmentedRealityApp::ApplyDisplayLayout(
+    const tango_util::DisplayConfiguration::Layout& layout) {
+  main_scene_.SetFrustumScale(
+      glm::vec3(1.0f, layout.image_plane_ratio, layout.image_plane_distance));
+  main_scene_.SetCameraImagePlaneRatio(layout.image_plane_ratio);
+  main_scene_.SetImagePlaneDistance(layout.image_plane_distance);
+  main_scene_.SetARCameraProjectionMatrix(layout.projection);
+  main_scene_.SetDisplayTransform(layout.display_T_camera);
+  // The eyes of the stereo view share the whole surface, with the pinhole of
+  // the color camera, which the layout is computed from once it is known.
+  main_scene_.SetStereoSurfaceSize(layout.surface_width, layout.surface_height);
+  TangoCameraIntrinsics color_camera_intrinsics;
+  if (intrinsics_.GetIntrinsics(TANGO_CAMERA_COLOR, &color_camera_intrinsics)) {
+    main_scene_.SetStereoIntrinsics(color_camera_intrinsics);
+  }
+
+  // The view port is placed at (0, 0) from the bottom left corner of the
+  // screen. By placing it at (0,0), the view port may not be exactly centered
+  // on the screen. However, this won't affect AR visualization as the correct
+  // registration of AR objects relies on the aspect ratio of the screen and
+  // video overlay, but not the position of the view port.
+  //
+  // To place the view port in the center of the screen, offset it by half of
+  // its overflow:
+  //
+  // glViewport((layout.surface_width - layout.viewport_width) / 2,
+  //            (layout.surface_height - layout.viewport_height) / 2,
+  //            layout.viewport_width, layout.viewport_height);
+  glViewport(layout.viewport_x, layout.viewport_y, layout.viewport_width,
+             layout.viewport_height);
+  viewport_height_ = layout.viewport_height;
 }
 
-void AugmentedRealityApp::OnTouchEvent(
-    int touch_count, tango_gl::GestureCamera::TouchEvent event, float x0,
-    float y0, float x1, float y1) {
-  main_scene_.OnTouchEvent(touch_count, event, x0, y0, x1, y1);
+void AugmentedRealityApp::UpdateDepth(double color_timestamp) {
+  bool is_new;
+  const TangoXYZij* point_cloud =
+      point_cloud_queue_.Acquire(color_timestamp, &is_new);
+  if (point_cloud == nullptr) {
+    return;
+  }
+  // The points are placed with the pose of their own timestamp, so that they
+  // stay put while the device moves between two point clouds.
+  TangoPoseData pose_start_service_T_device;
+  if (pose_history_.GetPoseAtTime(point_cloud->timestamp,
+                                  &pose_start_service_T_device) !=
+          TANGO_SUCCESS ||
+      pose_start_service_T_device.status_code != TANGO_POSE_VALID) {
+    return;
+  }
+  const glm::mat4 start_service_T_device =
+      pose_data_.GetMatrixFromPose(pose_start_service_T_device);
+  if (is_depth_occlusion_enabled_) {
+    main_scene_.SetOcclusionPointCloud(
+        point_cloud, is_new,
+        extrinsics_.GetOpenGlWorldTDepthCamera(start_service_T_device),
+        viewport_height_);
+  }
+  if (is_floor_map_enabled_) {
+    if (is_new) {
+      TANGO_TRACE_SCOPE("OccupancyGrid::Insert");
+      floor_map_.Insert(point_cloud, start_service_T_device *
+                                         extrinsics_.GetDeviceTDepthCamera());
+    }
+    UpdateFloorMap(glm::vec3(start_service_T_device[3]));
+    UpdatePath(glm::vec3(start_service_T_device[3]));
+  }
+  // Before the first localization the area description frame is not the one
+  // of the peers.
+  if (is_new && area_pose_tick_ != 0 && map_sync_.IsSharing()) {
+    TANGO_TRACE_SCOPE("MapSync::AddPoints");
+    map_sync_.AddPoints(
+        point_cloud,
+        area_T_world_ *
+            extrinsics_.GetOpenGlWorldTDepthCamera(start_service_T_device));
+  }
+}
+
+void AugmentedRealityApp::UpdateFloorMap(const glm::vec3& position) {
+  // The window only moves by whole cells.
+  const float cell_size = floor_map_.GetCellSize();
+  const glm::ivec2 center(static_cast<int>(std::floor(position.x / cell_size)),
+                          static_cast<int>(std::floor(position.y / cell_size)));
+  if (!floor_map_pixels_.empty() &&
+      floor_map_.GetRevision() == floor_map_revision_ &&
+      center == floor_map_center_) {
+    return;
+  }
+  floor_map_revision_ = floor_map_.GetRevision();
+  floor_map_center_ = center;
+  floor_map_pixels_.resize(kFloorMapSize * kFloorMapSize);
+  floor_map_.GetWindow(glm::vec2(position), kFloorMapSize,
+                       floor_map_pixels_.data());
+  // The device, at the center of the window.
+  const int middle = kFloorMapSize / 2;
+  for (int y = middle - 1; y <= middle; ++y) {
+    for (int x = middle - 1; x <= middle; ++x) {
+      floor_map_pixels_[y * kFloorMapSize + x] = kFloorMapDeviceLuminance;
+    }
+  }
+  main_scene_.SetFloorMap(floor_map_pixels_.data(), kFloorMapSize);
+}
+
+void AugmentedRealityApp::UpdatePath(const glm::vec3& position) {
+  if (!floor_map_.HasFloor()) {
+    return;
+  }
+  const glm::vec3 goal = tango_gl::conversions::Vec3GlToTango(
+      main_scene_.GetMarkerPosition());
+  path_planner_.SetGoal(floor_map_.GetCell(goal.x, goal.y));
+  if (!floor_map_.TakeBlockedChanges(&blocked_cells_)) {
+    path_planner_.Restart();
+  }
+  {
+    TANGO_TRACE_SCOPE("PathPlanner::Update");
+    path_planner_.Update(floor_map_.GetCell(position.x, position.y),
+                         blocked_cells_);
+  }
+  blocked_cells_.clear();
+  if (path_planner_.GetRevision() == path_revision_ &&
+      floor_map_.GetFloorHeight() == path_floor_height_) {
+    return;
+  }
+  path_revision_ = path_planner_.GetRevision();
+  path_floor_height_ = floor_map_.GetFloorHeight();
+  // The centers of the cells where the path turns, which the band is drawn
+  // through.
+  const std::vector<glm::ivec2>& path = path_planner_.GetPath();
+  const float cell_size = floor_map_.GetCellSize();
+  const float height = path_floor_height_ + kPathHeight;
+  path_points_.clear();
+  for (size_t i = 0; i < path.size(); ++i) {
+    if (i == 0 || i + 1 == path.size() ||
+        path[i + 1] - path[i] != path[i] - path[i - 1]) {
+      path_points_.push_back(tango_gl::conversions::Vec3TangoToGl(
+          glm::vec3((path[i].x + 0.5f) * cell_size,
+                    (path[i].y + 0.5f) * cell_size, height)));
+    }
+  }
+  main_scene_.SetPath(path_points_);
+}
+
+void AugmentedRealityApp::SetRenderPoseMode(RenderPoseMode mode) {
+  render_pose_mode_ = mode;
+  render_scheduler_.RequestRender(tango_util::RenderScheduler::kStateChange);
+}
+
+void AugmentedRealityApp::SetRenderOnDemand(bool on_demand) {
+  render_scheduler_.SetOnDemand(on_demand);
+}
+
+void AugmentedRealityApp::OnTouchEvents(const float* samples,
+                                        int sample_count) {
+  touch_queue_.Post(samples, sample_count);
+  render_scheduler_.RequestRender(tango_util::RenderScheduler::kInput);
 }
 
 glm::mat4 AugmentedRealityApp::GetPoseMatrixAtTimestamp(double timstamp) {
   TangoPoseData pose_start_service_T_device;
-  TangoCoordinateFramePair frame_pair;
-  frame_pair.base = TANGO_COORDINATE_FRAME_START_OF_SERVICE;
-  frame_pair.target = TANGO_COORDINATE_FRAME_DEVICE;
-  TangoErrorType status = TangoService_getPoseAtTime(
-      timstamp, frame_pair, &pose_start_service_T_device);
+  TangoErrorType status =
+      pose_history_.GetPoseAtTime(timstamp, &pose_start_service_T_device);
   if (status != TANGO_SUCCESS) {
     LOGE(
         "AugmentedRealityApp: Failed to get transform between the Start of "
@@ -376,10 +1004,10 @@ glm::mat4 AugmentedRealityApp::GetPoseMatrixAtTimestamp(double timstamp) {
         timstamp);
   }
 
-  {
-    std::lock_guard<std::mutex> lock(pose_mutex_);
-    pose_data_.UpdatePose(&pose_start_service_T_device);
-  }
+  pose_data_.UpdatePose(&pose_start_service_T_device);
+  telemetry_.Write([this](Telemetry* telemetry) {
+    pose_data_.WriteTelemetry(telemetry);
+  });
 
   if (pose_start_service_T_device.status_code != TANGO_POSE_VALID) {
     return glm::mat4(1.0f);
@@ -387,39 +1015,19 @@ glm::mat4 AugmentedRealityApp::GetPoseMatrixAtTimestamp(double timstamp) {
   return pose_data_.GetMatrixFromPose(pose_start_service_T_device);
 }
 
-TangoErrorType AugmentedRealityApp::UpdateExtrinsics() {
-  TangoErrorType ret;
-  TangoPoseData pose_data;
-  TangoCoordinateFramePair frame_pair;
-
-  // TangoService_getPoseAtTime function is used for query device extrinsics
-  // as well. We use timestamp 0.0 and the target frame pair to get the
-  // extrinsics from the sensors.
-  //
-  // Get device with respect to imu transformation matrix.
-  frame_pair.base = TANGO_COORDINATE_FRAME_IMU;
-  frame_pair.target = TANGO_COORDINATE_FRAME_DEVICE;
-  ret = TangoService_getPoseAtTime(0.0, frame_pair, &pose_data);
-  if (ret != TANGO_SUCCESS) {
-    LOGE(
-        "PointCloudApp: Failed to get transform between the IMU frame and "
-        "device frames");
-    return ret;
+glm::mat4 AugmentedRealityApp::GetPredictedPoseMatrix() {
+  TangoPoseData pose_start_service_T_device;
+  if (!pose_predictor_.PredictPose(pose_history_,
+                                   &pose_start_service_T_device)) {
+    LOGE("AugmentedRealityApp: Failed to predict the pose at display time");
+    return glm::mat4(1.0f);
   }
-  pose_data_.SetImuTDevice(pose_data_.GetMatrixFromPose(pose_data));
 
-  // Get color camera with respect to imu transformation matrix.
-  frame_pair.base = TANGO_COORDINATE_FRAME_IMU;
-  frame_pair.target = TANGO_COORDINATE_FRAME_CAMERA_COLOR;
-  ret = TangoService_getPoseAtTime(0.0, frame_pair, &pose_data);
-  if (ret != TANGO_SUCCESS) {
-    LOGE(
-        "PointCloudApp: Failed to get transform between the color camera frame "
-        "and device frames");
-    return ret;
-  }
-  pose_data_.SetImuTColorCamera(pose_data_.GetMatrixFromPose(pose_data));
-  return ret;
+  pose_data_.UpdatePose(&pose_start_service_T_device);
+  telemetry_.Write([this](Telemetry* telemetry) {
+    pose_data_.WriteTelemetry(telemetry);
+  });
+  return pose_data_.GetMatrixFromPose(pose_start_service_T_device);
 }
 
 void AugmentedRealityApp::RequestRender() {
@@ -16,7 +16,11 @@
 
 #define GLM_FORCE_RADIANS
 
+#include <android/native_window_jni.h>
 #include <jni.h>
+#include <tango-gl/memory_accounting.h>
+#include <tango-gl/tracing.h>
+#include <tango-gl/util.h>
 #include <tango-augmented-reality/augmented_reality_app.h>
 
 static tango_augmented_reality::AugmentedRealityApp app;
@@ -43,12 +47,26 @@ Java_com_projecttango_examples_cpp_augmentedreality_TangoJNINative_onTangoServic
   return app.OnTangoServiceConnected(env, activity, iBinder);
 }
 
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_augmentedreality_TangoJNINative_beginStartup(
+    JNIEnv*, jobject) {
+  app.BeginStartup();
+}
+
 JNIEXPORT jint JNICALL
 Java_com_projecttango_examples_cpp_augmentedreality_TangoJNINative_setupConfig(
     JNIEnv*, jobject) {
   return app.TangoSetupConfig();
 }
 
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_augmentedreality_TangoJNINative_setAreaDescription(
+    JNIEnv* env, jobject, jstring uuid) {
+  const char* uuid_chars = env->GetStringUTFChars(uuid, nullptr);
+  app.SetAreaDescription(uuid_chars);
+  env->ReleaseStringUTFChars(uuid, uuid_chars);
+}
+
 JNIEXPORT jboolean JNICALL
 Java_com_projecttango_examples_cpp_augmentedreality_TangoJNINative_connect(
     JNIEnv*, jobject) {
@@ -80,6 +98,14 @@ Java_com_projecttango_examples_cpp_augmentedreality_TangoJNINative_resetMotionTr
   app.TangoResetMotionTracking();
 }
 
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_augmentedreality_TangoJNINative_setProgramBinaryDirectory(
+    JNIEnv* env, jobject, jstring directory) {
+  const char* directory_chars = env->GetStringUTFChars(directory, nullptr);
+  tango_gl::util::SetProgramBinaryDirectory(directory_chars);
+  env->ReleaseStringUTFChars(directory, directory_chars);
+}
+
 JNIEXPORT void JNICALL
 Java_com_projecttango_examples_cpp_augmentedreality_TangoJNINative_initGlContent(
     JNIEnv*, jobject) {
@@ -92,6 +118,12 @@ Java_com_projecttango_examples_cpp_augmentedreality_TangoJNINative_setupGraphic(
   app.SetViewPort(width, height);
 }
 
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_augmentedreality_TangoJNINative_setDisplayRotation(
+    JNIEnv*, jobject, jint rotation) {
+  app.SetDisplayRotation(rotation);
+}
+
 JNIEXPORT void JNICALL
 Java_com_projecttango_examples_cpp_augmentedreality_TangoJNINative_render(
     JNIEnv*, jobject) {
@@ -104,16 +136,10 @@ Java_com_projecttango_examples_cpp_augmentedreality_TangoJNINative_deleteResourc
   app.DeleteResources();
 }
 
-JNIEXPORT jstring JNICALL
-Java_com_projecttango_examples_cpp_augmentedreality_TangoJNINative_getPoseString(
+JNIEXPORT jobject JNICALL
+Java_com_projecttango_examples_cpp_augmentedreality_TangoJNINative_getTelemetryBuffer(
     JNIEnv* env, jobject) {
-  return (env)->NewStringUTF(app.GetPoseString().c_str());
-}
-
-JNIEXPORT jstring JNICALL
-Java_com_projecttango_examples_cpp_augmentedreality_TangoJNINative_getEventString(
-    JNIEnv* env, jobject) {
-  return (env)->NewStringUTF(app.GetEventString().c_str());
+  return app.NewTelemetryBuffer(env);
 }
 
 JNIEXPORT jstring JNICALL
@@ -131,13 +157,130 @@ Java_com_projecttango_examples_cpp_augmentedreality_TangoJNINative_setCamera(
 }
 
 JNIEXPORT void JNICALL
-Java_com_projecttango_examples_cpp_augmentedreality_TangoJNINative_onTouchEvent(
-    JNIEnv*, jobject, int touch_count, int event, float x0, float y0, float x1,
-    float y1) {
-  tango_gl::GestureCamera::TouchEvent touch_event =
-      static_cast<tango_gl::GestureCamera::TouchEvent>(event);
-  app.OnTouchEvent(touch_count, touch_event, x0, y0, x1, y1);
+Java_com_projecttango_examples_cpp_augmentedreality_TangoJNINative_setRenderPoseMode(
+    JNIEnv*, jobject, int mode) {
+  app.SetRenderPoseMode(
+      static_cast<tango_augmented_reality::AugmentedRealityApp::RenderPoseMode>(
+          mode));
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_augmentedreality_TangoJNINative_setGpuProfilerHudVisible(
+    JNIEnv*, jobject, jboolean visible) {
+  app.SetGpuProfilerHudVisible(visible);
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_augmentedreality_TangoJNINative_setFisheyeStreamEnabled(
+    JNIEnv*, jobject, jboolean enabled) {
+  app.SetFisheyeStreamEnabled(enabled);
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_augmentedreality_TangoJNINative_setDepthOcclusionEnabled(
+    JNIEnv*, jobject, jboolean enabled) {
+  app.SetDepthOcclusionEnabled(enabled);
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_augmentedreality_TangoJNINative_setFloorMapEnabled(
+    JNIEnv*, jobject, jboolean enabled) {
+  app.SetFloorMapEnabled(enabled);
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_augmentedreality_TangoJNINative_setTagDetectionEnabled(
+    JNIEnv*, jobject, jboolean enabled) {
+  app.SetTagDetectionEnabled(enabled);
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_projecttango_examples_cpp_augmentedreality_TangoJNINative_startMapSharing(
+    JNIEnv*, jobject, jint port) {
+  return app.StartMapSharing(port);
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_augmentedreality_TangoJNINative_stopMapSharing(
+    JNIEnv*, jobject) {
+  app.StopMapSharing();
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_augmentedreality_TangoJNINative_setStereoEnabled(
+    JNIEnv*, jobject, jboolean enabled) {
+  app.SetStereoEnabled(enabled);
 }
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_augmentedreality_TangoJNINative_setFramePacingEnabled(
+    JNIEnv*, jobject, jboolean enabled) {
+  app.SetFramePacingEnabled(enabled);
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_augmentedreality_TangoJNINative_setSnapshotDirectory(
+    JNIEnv* env, jobject, jstring directory) {
+  const char* directory_chars = env->GetStringUTFChars(directory, nullptr);
+  app.SetSnapshotDirectory(directory_chars);
+  env->ReleaseStringUTFChars(directory, directory_chars);
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_augmentedreality_TangoJNINative_setRecordingSurface(
+    JNIEnv* env, jobject, jobject surface) {
+  ANativeWindow* window =
+      surface != nullptr ? ANativeWindow_fromSurface(env, surface) : nullptr;
+  app.SetRecordingWindow(window);
+  if (window != nullptr) {
+    ANativeWindow_release(window);
+  }
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_augmentedreality_TangoJNINative_setRenderOnDemand(
+    JNIEnv*, jobject, jboolean on_demand) {
+  app.SetRenderOnDemand(on_demand);
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_augmentedreality_TangoJNINative_onTouchEvents(
+    JNIEnv* env, jobject, jfloatArray samples, jint sample_count) {
+  jfloat* values = env->GetFloatArrayElements(samples, nullptr);
+  if (values == nullptr) {
+    return;
+  }
+  app.OnTouchEvents(values, sample_count);
+  env->ReleaseFloatArrayElements(samples, values, JNI_ABORT);
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_augmentedreality_TangoJNINative_startTracing(
+    JNIEnv*, jobject) {
+  tango_gl::tracing::Start();
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_augmentedreality_TangoJNINative_stopTracing(
+    JNIEnv*, jobject) {
+  tango_gl::tracing::Stop();
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_projecttango_examples_cpp_augmentedreality_TangoJNINative_dumpTrace(
+    JNIEnv* env, jobject, jstring path) {
+  const char* path_chars = env->GetStringUTFChars(path, nullptr);
+  const bool dumped = tango_gl::tracing::DumpChromeTrace(path_chars);
+  env->ReleaseStringUTFChars(path, path_chars);
+  return dumped;
+}
+
+JNIEXPORT jstring JNICALL
+Java_com_projecttango_examples_cpp_augmentedreality_TangoJNINative_getMemoryReport(
+    JNIEnv* env, jobject) {
+  return env->NewStringUTF(tango_gl::FormatMemoryReport().c_str());
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -14,21 +14,20 @@
  * limitations under the License.
  */
 
-#include <sstream>
-
 #include "tango-augmented-reality/pose_data.h"
 
 namespace {
-const float kMeterToMillimeter = 1000.0f;
+const float kSecondToMillisecond = 1000.0f;
 }  // namespace
 
 namespace tango_augmented_reality {
 
-PoseData::PoseData() {}
+PoseData::PoseData() : cur_pose_(), prev_pose_(), pose_counter_(0) {}
 
 PoseData::~PoseData() {}
 
 void PoseData::UpdatePose(const TangoPoseData* pose_data) {
+  prev_pose_ = cur_pose_;
   cur_pose_ = *pose_data;
 
   if (prev_pose_.status_code != cur_pose_.status_code) {
@@ -38,38 +37,25 @@ void PoseData::UpdatePose(const TangoPoseData* pose_data) {
 
   // Increase pose counter.
   ++pose_counter_;
-  FormatPoseString();
-  prev_pose_ = cur_pose_;
 }
 
-std::string PoseData::GetPoseDebugString() { return pose_string_; }
+void PoseData::WriteTelemetry(Telemetry* telemetry) const {
+  telemetry->pose_status = cur_pose_.status_code;
+  telemetry->pose_count = static_cast<int32_t>(pose_counter_);
+  telemetry->pose_delta_time = static_cast<float>(
+      (cur_pose_.timestamp - prev_pose_.timestamp) * kSecondToMillisecond);
+  for (int i = 0; i < 3; ++i) {
+    telemetry->position[i] = static_cast<float>(cur_pose_.translation[i]);
+  }
+  for (int i = 0; i < 4; ++i) {
+    telemetry->orientation[i] = static_cast<float>(cur_pose_.orientation[i]);
+  }
+}
 
 glm::mat4 PoseData::GetLatestPoseMatrix() {
   return GetMatrixFromPose(cur_pose_);
 }
 
-glm::mat4 PoseData::GetExtrinsicsAppliedOpenGLWorldFrame(
-    const glm::mat4& pose_matrix) {
-  // This full multiplication is equal to:
-  //   opengl_world_T_opengl_camera =
-  //      opengl_world_T_start_service *
-  //      start_service_T_device *
-  //      device_T_imu *
-  //      imu_T_color_camera *
-  //      color_camera_T_opengl_camera;
-  // Note that color camera and depth camera are the same hardware, they share
-  // the same frame.
-  //
-  // More information about frame transformation can be found here:
-  // Frame of reference:
-  //   https://developers.google.com/project-tango/overview/frames-of-reference
-  // Coordinate System Conventions:
-  //   https://developers.google.com/project-tango/overview/coordinate-systems
-  return tango_gl::conversions::opengl_world_T_tango_world() * pose_matrix *
-         glm::inverse(GetImuTDevice()) * GetImuTColorCamera() *
-         tango_gl::conversions::color_camera_T_opengl_camera();
-}
-
 glm::mat4 PoseData::GetMatrixFromPose(const TangoPoseData& pose) {
   // Convert pose data to vec3 for position and quaternion for orientation.
   //
@@ -87,43 +73,4 @@ glm::mat4 PoseData::GetMatrixFromPose(const TangoPoseData& pose) {
   return matrix;
 }
 
-std::string PoseData::GetStringFromStatusCode(TangoPoseStatusType status) {
-  std::string ret_string;
-  switch (status) {
-    case TANGO_POSE_INITIALIZING:
-      ret_string = "initializing";
-      break;
-    case TANGO_POSE_VALID:
-      ret_string = "valid";
-      break;
-    case TANGO_POSE_INVALID:
-      ret_string = "invalid";
-      break;
-    case TANGO_POSE_UNKNOWN:
-      ret_string = "unknown";
-      break;
-    default:
-      ret_string = "status_code_invalid";
-      break;
-  }
-  return ret_string;
-}
-
-void PoseData::FormatPoseString() {
-  std::stringstream string_stream;
-  string_stream.setf(std::ios_base::fixed, std::ios_base::floatfield);
-  string_stream.precision(3);
-  string_stream << "status: " << GetStringFromStatusCode(cur_pose_.status_code)
-                << ", count: " << pose_counter_ << ", delta time (ms): "
-                << (cur_pose_.timestamp - prev_pose_.timestamp) *
-                       kMeterToMillimeter << ", position (m): ["
-                << cur_pose_.translation[0] << ", " << cur_pose_.translation[1]
-                << ", " << cur_pose_.translation[2] << "]"
-                << ", orientation: [" << cur_pose_.orientation[0] << ", "
-                << cur_pose_.orientation[1] << ", " << cur_pose_.orientation[2]
-                << ", " << cur_pose_.orientation[3] << "]";
-  pose_string_ = string_stream.str();
-  string_stream.flush();
-}
-
 }  // namespace tango_augmented_reality
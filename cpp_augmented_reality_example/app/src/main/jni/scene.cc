@@ -15,6 +15,8 @@
  */
 
 #include <tango-gl/conversions.h>
+#include <tango-gl/gl_state.h>
+#include <tango-gl/render_statistics.h>
 
 #include "tango-augmented-reality/scene.h"
 
@@ -41,11 +43,57 @@ const glm::quat kMarkerRotation = glm::quat(0.0f, 0.0f, 1.0f, 0.0f);
 const glm::vec3 kMarkerPosition = glm::vec3(0.0f, 0.85f, -3.0f);
 const glm::vec3 kMarkerScale = glm::vec3(0.05f, 0.05f, 0.05f);
 const tango_gl::Color kMarkerColor(1.0f, 0.f, 0.f);
+
+// Size of the fisheye inset in the full screen quad's [-1, 1] coordinates.
+const float kFisheyeInsetScale = 0.3f;
+
+// Share of the height of the view port the floor map inset takes.
+const float kFloorMapInsetScale = 0.3f;
+
+// The path to the marker, as wide as a foot. Band only uses its length when
+// grown with UpdateVertexArray(), not with the whole path.
+const tango_gl::Color kPathColor(0.2f, 0.8f, 0.3f);
+const float kPathWidth = 0.1f;
+const unsigned int kPathBandLength = 2;
+
+// Width of the undistortion map of the fisheye inset, which is small on the
+// screen, and the focal length of the undistorted image relative to the
+// camera's, zoomed out to keep most of the field of view.
+const int kFisheyeUndistortionMapWidth = 160;
+const double kFisheyeUndistortionFocalScale = 0.5;
+
+// Clipping planes of the eyes of the stereo view, those of the AR camera.
+const float kStereoNearClippingPlane = 0.1f;
+const float kStereoFarClippingPlane = 100.0f;
+
+// The most depth points splatted for the occlusion, a bit over a quarter of
+// a point cloud, with splats grown to cover the same area.
+const int kOcclusionPointBudget = 10000;
 }  // namespace
 
 namespace tango_augmented_reality {
 
-Scene::Scene() {}
+Scene::Scene()
+    : is_fisheye_overlay_visible_(false),
+      depth_occluder_(nullptr),
+      is_depth_occlusion_enabled_(false),
+      occlusion_viewport_height_(0),
+      floor_map_quad_(nullptr),
+      floor_map_texture_(0),
+      floor_map_size_(0),
+      floor_map_memory_(tango_gl::kMemoryTagTexture, tango_gl::kMemoryGpu),
+      is_floor_map_visible_(false),
+      path_band_(nullptr),
+      has_path_(false),
+      is_path_visible_(false),
+      display_T_camera_(1.0f),
+      gpu_profiler_hud_(nullptr),
+      is_gpu_profiler_hud_visible_(false),
+      is_stereo_enabled_(false) {
+  gpu_profiler_.AddPass("Video overlay");
+  gpu_profiler_.AddPass("Meshes");
+  gpu_profiler_.AddPass("Occlusion");
+}
 
 Scene::~Scene() {}
 
@@ -53,34 +101,156 @@ void Scene::InitGLContent() {
   // Allocating render camera and drawable object.
   // All of these objects are for visualization purposes.
   video_overlay_ = new tango_gl::VideoOverlay();
+  fisheye_overlay_ = new tango_gl::VideoOverlay();
+  depth_occluder_ = new tango_gl::DepthOccluder();
+  depth_occluder_->SetPointBudget(kOcclusionPointBudget);
+  floor_map_quad_ = new tango_gl::Quad();
+  path_band_ = new tango_gl::Band(kPathBandLength);
+  has_path_ = false;
   gesture_camera_ = new tango_gl::GestureCamera();
   axis_ = new tango_gl::Axis();
   frustum_ = new tango_gl::Frustum();
   trace_ = new tango_gl::Trace();
   grid_ = new tango_gl::Grid();
   marker_ = new tango_gl::GoalMarker();
+  // The queries of a previous context died with it.
+  gpu_profiler_.InvalidateGlResources();
+  gpu_profiler_hud_ = new tango_gl::GpuProfilerHud(&gpu_profiler_);
 
   trace_->SetColor(kTraceColor);
+  path_band_->SetColor(kPathColor);
+  path_band_->SetWidth(kPathWidth);
   grid_->SetColor(kGridColor);
+  // Falls back to lines where the context can not draw it.
+  grid_->SetProcedural(true);
   grid_->SetPosition(-kHeightOffset);
 
+  marker_->SetParent(GetAnchorNode(kMarkerAnchor));
   marker_->SetPosition(kMarkerPosition);
   marker_->SetScale(kMarkerScale);
   marker_->SetRotation(kMarkerRotation);
   marker_->SetColor(kMarkerColor);
+  marker_->SetBoundingBox();
+
+  fisheye_overlay_->SetScale(
+      glm::vec3(kFisheyeInsetScale, kFisheyeInsetScale, 1.0f));
+  fisheye_overlay_->SetPosition(
+      glm::vec3(1.0f - kFisheyeInsetScale, kFisheyeInsetScale - 1.0f, 0.0f));
+
+  static_objects_.Add(grid_, grid_->GetBoundingBox());
+  anchored_objects_.Add(marker_, *marker_->GetBoundingBox());
+  for (const TagMarker& tag_marker : tag_markers_) {
+    CreateTagAxis(tag_marker);
+  }
 
   gesture_camera_->SetCameraType(
       tango_gl::GestureCamera::CameraType::kThirdPerson);
 }
 
+const int Scene::kMarkerAnchor;
+
+tango_gl::Transform* Scene::GetAnchorNode(int anchor) {
+  while (anchor_nodes_.size() <= static_cast<size_t>(anchor)) {
+    anchor_nodes_.emplace_back(new tango_gl::Transform());
+  }
+  return anchor_nodes_[anchor].get();
+}
+
+void Scene::SetAnchorTransforms(const std::vector<glm::mat4>& transforms) {
+  // The objects only have their world matrix marked out of date, it is
+  // computed on their next use.
+  for (size_t i = 0; i < transforms.size(); ++i) {
+    GetAnchorNode(static_cast<int>(i))->SetTransformationMatrix(transforms[i]);
+  }
+  anchored_objects_.Update();
+}
+
+void Scene::AddTagMarker(int anchor, float size) {
+  TagMarker marker;
+  marker.anchor = anchor;
+  marker.size = size;
+  tag_markers_.push_back(marker);
+  CreateTagAxis(marker);
+}
+
+void Scene::CreateTagAxis(const TagMarker& marker) {
+  tango_gl::Axis* axis = new tango_gl::Axis();
+  axis->SetParent(GetAnchorNode(marker.anchor));
+  axis->SetScale(glm::vec3(marker.size));
+  tag_axes_.emplace_back(axis);
+  anchored_objects_.Add(axis, tango_gl::BoundingBox(glm::vec3(0.0f),
+                                                    glm::vec3(1.0f)));
+}
+
+void Scene::SetStereoIntrinsics(const TangoCameraIntrinsics& intrinsics) {
+  stereo_rig_.SetIntrinsics(
+      static_cast<float>(intrinsics.width),
+      static_cast<float>(intrinsics.height), static_cast<float>(intrinsics.fx),
+      static_cast<float>(intrinsics.fy), static_cast<float>(intrinsics.cx),
+      static_cast<float>(intrinsics.cy), kStereoNearClippingPlane,
+      kStereoFarClippingPlane);
+}
+
+bool Scene::SetFisheyeIntrinsics(const TangoCameraIntrinsics& intrinsics) {
+  tango_gl::VideoOverlay::Undistortion undistortion;
+  switch (intrinsics.calibration_type) {
+    case TANGO_CALIBRATION_EQUIDISTANT:
+      undistortion.model = tango_gl::VideoOverlay::kFieldOfView;
+      break;
+    case TANGO_CALIBRATION_POLYNOMIAL_3_PARAMETERS:
+      undistortion.model = tango_gl::VideoOverlay::kPolynomial3;
+      break;
+    default:
+      LOGI("Scene: unknown fisheye calibration %d, drawing it distorted",
+           intrinsics.calibration_type);
+      return false;
+  }
+  undistortion.width = static_cast<int>(intrinsics.width);
+  undistortion.height = static_cast<int>(intrinsics.height);
+  undistortion.fx = intrinsics.fx;
+  undistortion.fy = intrinsics.fy;
+  undistortion.cx = intrinsics.cx;
+  undistortion.cy = intrinsics.cy;
+  for (int i = 0; i < 3; ++i) {
+    undistortion.distortion[i] = intrinsics.distortion[i];
+  }
+  undistortion.map_width = kFisheyeUndistortionMapWidth;
+  undistortion.map_height =
+      intrinsics.width > 0 ? static_cast<int>(kFisheyeUndistortionMapWidth *
+                                              intrinsics.height /
+                                              intrinsics.width)
+                           : 0;
+  undistortion.focal_scale = kFisheyeUndistortionFocalScale;
+  return fisheye_overlay_->SetUndistortion(undistortion);
+}
+
 void Scene::DeleteResources() {
+  static_objects_.Clear();
+  anchored_objects_.Clear();
+  tag_axes_.clear();
   delete gesture_camera_;
   delete video_overlay_;
+  delete fisheye_overlay_;
+  delete depth_occluder_;
+  depth_occluder_ = nullptr;
+  delete floor_map_quad_;
+  floor_map_quad_ = nullptr;
+  if (floor_map_texture_ != 0) {
+    glDeleteTextures(1, &floor_map_texture_);
+    floor_map_texture_ = 0;
+  }
+  floor_map_size_ = 0;
+  floor_map_memory_.Set(0);
+  delete path_band_;
+  path_band_ = nullptr;
   delete axis_;
   delete frustum_;
   delete trace_;
   delete grid_;
   delete marker_;
+  delete gpu_profiler_hud_;
+  gpu_profiler_hud_ = nullptr;
+  overlay_target_.InvalidateGlResources();
 }
 
 void Scene::SetupViewPort(int x, int y, int w, int h) {
@@ -90,10 +260,21 @@ void Scene::SetupViewPort(int x, int y, int w, int h) {
   gesture_camera_->SetAspectRatio(static_cast<float>(w) /
                                   static_cast<float>(h));
   glViewport(x, y, w, h);
+
+  // The inset stays square whatever the aspect ratio of the view port, the
+  // quad being a unit square of clip space.
+  const float inset_height = 2.0f * kFloorMapInsetScale;
+  const float inset_width = w > 0 ? inset_height * h / w : inset_height;
+  floor_map_quad_->SetScale(glm::vec3(inset_width, inset_height, 1.0f));
+  floor_map_quad_->SetPosition(glm::vec3(-1.0f + inset_width / 2.0f,
+                                         1.0f - inset_height / 2.0f, 0.0f));
 }
 
 void Scene::Render(const glm::mat4& cur_pose_transformation) {
-  glEnable(GL_DEPTH_TEST);
+  // Apply the touch input received since the previous frame.
+  gesture_camera_->Update();
+  gpu_profiler_.BeginFrame();
+  tango_gl::GlState::Enable(GL_DEPTH_TEST);
 
   glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
   glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
@@ -104,15 +285,12 @@ void Scene::Render(const glm::mat4& cur_pose_transformation) {
 
   trace_->UpdateVertexArray(position);
 
-  if (gesture_camera_->GetCameraType() ==
-      tango_gl::GestureCamera::CameraType::kFirstPerson) {
+  const bool is_first_person =
+      gesture_camera_->GetCameraType() ==
+      tango_gl::GestureCamera::CameraType::kFirstPerson;
+  if (is_first_person) {
     // In first person mode, we directly control camera's motion.
     gesture_camera_->SetTransformationMatrix(cur_pose_transformation);
-
-    // If it's first person view, we will render the video overlay in full
-    // screen, so we passed identity matrix as view and projection matrix.
-    glDisable(GL_DEPTH_TEST);
-    video_overlay_->Render(glm::mat4(1.0f), glm::mat4(1.0f));
   } else {
     // In third person or top down more, we follow the camera movement.
     gesture_camera_->SetAnchorPosition(position);
@@ -122,22 +300,183 @@ void Scene::Render(const glm::mat4& cur_pose_transformation) {
     // camera's aspect ratio, this is just for visualization purposes.
     frustum_->SetScale(
         glm::vec3(1.0f, camera_image_plane_ratio_, image_plane_distance_));
-    frustum_->Render(ar_camera_projection_matrix_,
-                     gesture_camera_->GetViewMatrix());
-
     axis_->SetTransformationMatrix(cur_pose_transformation);
-    axis_->Render(ar_camera_projection_matrix_,
-                  gesture_camera_->GetViewMatrix());
+  }
 
-    trace_->Render(ar_camera_projection_matrix_,
-                   gesture_camera_->GetViewMatrix());
-    video_overlay_->Render(ar_camera_projection_matrix_,
+  if (is_first_person && is_stereo_enabled_) {
+    RenderStereo();
+  } else {
+    RenderMono(is_first_person);
+  }
+
+  if (is_fisheye_overlay_visible_) {
+    tango_gl::GlState::Disable(GL_DEPTH_TEST);
+    fisheye_overlay_->Render(glm::mat4(1.0f), glm::mat4(1.0f));
+    tango_gl::GlState::Enable(GL_DEPTH_TEST);
+  }
+
+  if (is_floor_map_visible_ && floor_map_texture_ != 0) {
+    tango_gl::GlState::Disable(GL_DEPTH_TEST);
+    floor_map_quad_->Render(glm::mat4(1.0f), glm::mat4(1.0f));
+    tango_gl::GlState::Enable(GL_DEPTH_TEST);
+  }
+
+  if (is_gpu_profiler_hud_visible_) {
+    gpu_profiler_hud_->Render();
+  }
+}
+
+void Scene::SetFloorMap(const uint8_t* pixels, int size) {
+  if (floor_map_texture_ == 0) {
+    glGenTextures(1, &floor_map_texture_);
+    floor_map_quad_->SetTextureId(floor_map_texture_);
+  }
+  tango_gl::CountRender(tango_gl::kRenderCounterTextureBinds);
+  glBindTexture(GL_TEXTURE_2D, floor_map_texture_);
+  // A cell per pixel, the rows tightly packed.
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  if (size != floor_map_size_) {
+    floor_map_size_ = size;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, size, size, 0, GL_LUMINANCE,
+                 GL_UNSIGNED_BYTE, pixels);
+    floor_map_memory_.Set(tango_gl::EstimateTextureBytes(
+        size, size, GL_LUMINANCE, GL_UNSIGNED_BYTE));
+  } else {
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, size, size, GL_LUMINANCE,
+                    GL_UNSIGNED_BYTE, pixels);
+  }
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  tango_gl::util::CheckGlError("Scene::SetFloorMap()");
+}
+
+void Scene::SetPath(const std::vector<glm::vec3>& points) {
+  has_path_ = points.size() >= 2;
+  if (has_path_) {
+    path_band_->SetVertexArray(points, glm::vec3(0.0f, 1.0f, 0.0f));
+  } else {
+    path_band_->ClearVertexArray();
+  }
+}
+
+void Scene::RenderMono(bool is_first_person) {
+  // The video overlay is drawn first in both modes so that each pass is
+  // timed with a single query. In third person it is depth tested like the
+  // meshes, so the order does not change the picture.
+  {
+    tango_gl::GpuProfiler::ScopedPass pass(&gpu_profiler_, kVideoOverlayPass);
+    if (is_first_person) {
+      // If it's first person view, we will render the video overlay in full
+      // screen, so we passed identity matrix as view matrix, and only the
+      // rotation of the display as projection.
+      tango_gl::GlState::Disable(GL_DEPTH_TEST);
+      video_overlay_->Render(display_T_camera_, glm::mat4(1.0f));
+      tango_gl::GlState::Enable(GL_DEPTH_TEST);
+    } else {
+      video_overlay_->Render(ar_camera_projection_matrix_,
+                             gesture_camera_->GetViewMatrix());
+    }
+  }
+
+  // The virtual objects of the first person view are drawn over the camera
+  // image at the resolution the frame time allows. In third person they are
+  // depth tested against the video overlay, so are drawn with it.
+  const bool is_overlay_scaled = is_first_person && overlay_target_.Begin();
+
+  // The real geometry in front of the virtual objects hides them, at the cost
+  // of a bounded number of points whatever the scene draws.
+  if (is_first_person && is_depth_occlusion_enabled_ &&
+      depth_occluder_->HasPoints()) {
+    tango_gl::GpuProfiler::ScopedPass pass(&gpu_profiler_, kOcclusionPass);
+    // The splats are sized in pixels of the target drawn into.
+    const int viewport_height =
+        is_overlay_scaled ? static_cast<int>(occlusion_viewport_height_ *
+                                             overlay_target_.GetScale())
+                          : occlusion_viewport_height_;
+    depth_occluder_->Render(ar_camera_projection_matrix_,
+                            gesture_camera_->GetViewMatrix(),
+                            world_T_depth_camera_, viewport_height);
+  }
+
+  {
+    tango_gl::GpuProfiler::ScopedPass pass(&gpu_profiler_, kMeshPass);
+    if (!is_first_person) {
+      frustum_->Render(ar_camera_projection_matrix_,
+                       gesture_camera_->GetViewMatrix());
+      axis_->Render(ar_camera_projection_matrix_,
+                    gesture_camera_->GetViewMatrix());
+      trace_->Render(ar_camera_projection_matrix_,
+                     gesture_camera_->GetViewMatrix());
+    }
+    if (is_path_visible_ && has_path_) {
+      path_band_->Render(ar_camera_projection_matrix_,
+                         gesture_camera_->GetViewMatrix());
+    }
+    static_objects_.Render(ar_camera_projection_matrix_,
                            gesture_camera_->GetViewMatrix());
+    anchored_objects_.Render(ar_camera_projection_matrix_,
+                             gesture_camera_->GetViewMatrix());
   }
-  glEnable(GL_DEPTH_TEST);
-  grid_->Render(ar_camera_projection_matrix_, gesture_camera_->GetViewMatrix());
-  marker_->Render(ar_camera_projection_matrix_,
-                  gesture_camera_->GetViewMatrix());
+  overlay_target_.End();
+}
+
+void Scene::RenderStereo() {
+  // What does not depend on the eye is done once: the culling, against a
+  // frustum containing both eyes, and the update of the camera texture the
+  // eyes share. Each pass is drawn for both eyes in a row, so that it is
+  // timed with a single query.
+  stereo_rig_.Update(gesture_camera_->GetViewMatrix());
+  stereo_visible_objects_.clear();
+  static_objects_.Cull(stereo_rig_.GetCullingFrustum(),
+                       &stereo_visible_objects_);
+  anchored_objects_.Cull(stereo_rig_.GetCullingFrustum(),
+                         &stereo_visible_objects_);
+  GLint previous_viewport[4];
+  glGetIntegerv(GL_VIEWPORT, previous_viewport);
+
+  {
+    tango_gl::GpuProfiler::ScopedPass pass(&gpu_profiler_, kVideoOverlayPass);
+    tango_gl::GlState::Disable(GL_DEPTH_TEST);
+    for (int i = 0; i < tango_gl::StereoRig::kEyeCount; ++i) {
+      stereo_rig_.SetEyeViewport(static_cast<tango_gl::StereoRig::Eye>(i));
+      video_overlay_->Render(glm::mat4(1.0f), glm::mat4(1.0f));
+    }
+    tango_gl::GlState::Enable(GL_DEPTH_TEST);
+  }
+
+  if (is_depth_occlusion_enabled_ && depth_occluder_->HasPoints()) {
+    tango_gl::GpuProfiler::ScopedPass pass(&gpu_profiler_, kOcclusionPass);
+    for (int i = 0; i < tango_gl::StereoRig::kEyeCount; ++i) {
+      const tango_gl::StereoRig::Eye eye =
+          static_cast<tango_gl::StereoRig::Eye>(i);
+      stereo_rig_.SetEyeViewport(eye);
+      depth_occluder_->Render(stereo_rig_.GetProjection(),
+                              stereo_rig_.GetView(eye), world_T_depth_camera_,
+                              stereo_rig_.GetEyeViewportHeight());
+    }
+  }
+
+  {
+    tango_gl::GpuProfiler::ScopedPass pass(&gpu_profiler_, kMeshPass);
+    for (int i = 0; i < tango_gl::StereoRig::kEyeCount; ++i) {
+      const tango_gl::StereoRig::Eye eye =
+          static_cast<tango_gl::StereoRig::Eye>(i);
+      stereo_rig_.SetEyeViewport(eye);
+      if (is_path_visible_ && has_path_) {
+        path_band_->Render(stereo_rig_.GetProjection(),
+                           stereo_rig_.GetView(eye));
+      }
+      for (const tango_gl::DrawableObject* object : stereo_visible_objects_) {
+        object->Render(stereo_rig_.GetProjection(), stereo_rig_.GetView(eye));
+      }
+    }
+  }
+  glViewport(previous_viewport[0], previous_viewport[1], previous_viewport[2],
+             previous_viewport[3]);
 }
 
 void Scene::SetCameraType(tango_gl::GestureCamera::CameraType camera_type) {
@@ -155,6 +494,16 @@ void Scene::SetCameraType(tango_gl::GestureCamera::CameraType camera_type) {
   }
 }
 
+void Scene::SetOcclusionPointCloud(const TangoXYZij* point_cloud, bool is_new,
+                                   const glm::mat4& world_T_depth_camera,
+                                   int viewport_height) {
+  if (is_new) {
+    depth_occluder_->UpdatePoints(point_cloud->xyz[0], point_cloud->xyz_count);
+  }
+  world_T_depth_camera_ = world_T_depth_camera;
+  occlusion_viewport_height_ = viewport_height;
+}
+
 void Scene::OnTouchEvent(int touch_count,
                          tango_gl::GestureCamera::TouchEvent event, float x0,
                          float y0, float x1, float y1) {
@@ -17,22 +17,65 @@
 #ifndef TANGO_AUGMENTED_REALITY_AUGMENTED_REALITY_APP_H_
 #define TANGO_AUGMENTED_REALITY_AUGMENTED_REALITY_APP_H_
 
+#include <android/native_window.h>
 #include <jni.h>
+#include <atomic>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 #include <tango_client_api.h>  // NOLINT
+#include <tango-gl/camera_luminance.h>
+#include <tango-gl/encoder_surface.h>
+#include <tango-gl/frame_capture.h>
+#include <tango-gl/gl_context_tracker.h>
+#include <tango-gl/rigid_transform.h>
 #include <tango-gl/util.h>
+#include <tango-util/anchor_store.h>
+#include <tango-util/camera_stream_scheduler.h>
+#include <tango-util/extrinsics_cache.h>
+#include <tango-util/display_configuration.h>
+#include <tango-util/frame_pacer.h>
+#include <tango-util/image_pyramid.h>
+#include <tango-util/intrinsics_registry.h>
+#include <tango-util/latency_tracker.h>
+#include <tango-util/map_sync.h>
+#include <tango-util/occupancy_grid.h>
+#include <tango-util/path_planner.h>
+#include <tango-util/point_cloud_queue.h>
+#include <tango-util/pose_bus.h>
+#include <tango-util/pose_history.h>
+#include <tango-util/pose_predictor.h>
+#include <tango-util/quality_governor.h>
+#include <tango-util/render_scheduler.h>
+#include <tango-util/snapshot_writer.h>
+#include <tango-util/startup_timer.h>
+#include <tango-util/tag_detector.h>
+#include <tango-util/telemetry_block.h>
+#include <tango-util/touch_queue.h>
 
 #include <tango-augmented-reality/pose_data.h>
 #include <tango-augmented-reality/scene.h>
 #include <tango-augmented-reality/tango_event_data.h>
+#include <tango-augmented-reality/telemetry.h>
 
 namespace tango_augmented_reality {
 
 // AugmentedRealityApp handles the application lifecycle and resources.
 class AugmentedRealityApp {
  public:
+  // Pose the virtual content is rendered with.
+  enum RenderPoseMode {
+    // Pose at the timestamp of the color camera image, which keeps the
+    // content registered with the video overlay.
+    kCameraImagePose = 0,
+    // Pose predicted at the time the frame reaches the display, which keeps
+    // the content from lagging behind fast device motion.
+    kPredictedDisplayPose = 1
+  };
+
   // Constructor and deconstructor.
   AugmentedRealityApp();
   ~AugmentedRealityApp();
@@ -43,6 +86,10 @@ class AugmentedRealityApp {
   //         Tango Core version.
   bool CheckTangoVersion(JNIEnv* env, jobject activity, int min_tango_version);
 
+  // Start timing the startup, until the first camera image is drawn, see
+  // tango_util::StartupTimer. Called when the activity resumes.
+  void BeginStartup() { startup_timer_.Begin(); }
+
   // Call when Tango Service is connected successfully.
   bool OnTangoServiceConnected(JNIEnv* env, jobject activity, jobject iBinder);
 
@@ -55,12 +102,21 @@ class AugmentedRealityApp {
   // we'd like auto-recover enabled.
   int TangoSetupConfig();
 
-  // Connect the onPoseAvailable callback.
+  // Localize in the area description |uuid| on the next TangoSetupConfig(),
+  // or only track motion when it is empty. The AR content then follows the
+  // area description, see tango_util::AnchorStore.
+  void SetAreaDescription(const std::string& uuid);
+
+  // Connect the onTangoEvent and onPoseAvailable callbacks.
   int TangoConnectCallbacks();
 
   // Connect to Tango Service.
   // This function will start the Tango Service pipeline, in this case, it will
   // start Motion Tracking.
+  //
+  // The activity runs TangoSetupConfig(), TangoConnectCallbacks() and this on
+  // a startup thread while the GL thread creates the scene. The first frame
+  // after both are done connects the camera texture.
   bool TangoConnect();
 
   // Disconnect from Tango Service, release all the resources that the app is
@@ -77,28 +133,43 @@ class AugmentedRealityApp {
   // @param event: Tango event, caller allocated.
   void onTangoEventAvailable(const TangoEvent* event);
 
-  // Tango service texture callback. Called when the texture is updated.
+  // Tango service pose callback function for the start of service to device
+  // frame pair, and for the area description to start of service one.
   //
-  // @param id: camera Id of the updated camera.
-  void onTextureAvailable(TangoCameraId id);
+  // @param pose: pose data, caller allocated.
+  void onPoseAvailable(const TangoPoseData* pose);
+
+  // Tango service point cloud callback, the point clouds are kept for the
+  // occlusion.
+  //
+  // @param xyz_ij: point cloud, caller allocated.
+  void onXYZijAvailable(const TangoXYZij* xyz_ij);
 
   // Allocate OpenGL resources for rendering, mainly initializing the Scene.
+  // The activity preserves the EGL context over a pause, so this keeps the
+  // Scene of the previous surface as long as its context is the current one,
+  // and only creates it again once the context was lost.
   void InitializeGLContent();
 
   // Setup the view port width and height.
   void SetViewPort(int width, int height);
 
+  // Set the rotation of the display, as Android's Display.getRotation().
+  // Can be called on any thread.
+  void SetDisplayRotation(int rotation);
+
   // Main render loop.
   void Render();
 
-  // Release all non-OpenGL resources that allocate from the program.
+  // Release the resources bound to the Tango connection, on pause. The OpenGL
+  // resources are kept along with their context, see InitializeGLContent().
   void DeleteResources();
 
-  // Retrun pose debug string.
-  std::string GetPoseString();
-
-  // Retrun Tango event debug string.
-  std::string GetEventString();
+  // @return: a direct ByteBuffer over the debug telemetry, which the app
+  //          keeps up to date for the activity to poll, see Telemetry.
+  jobject NewTelemetryBuffer(JNIEnv* env) {
+    return telemetry_.NewDirectByteBuffer(env);
+  }
 
   // Retrun Tango Service version string.
   std::string GetVersionString();
@@ -109,17 +180,79 @@ class AugmentedRealityApp {
   //         top down
   void SetCameraType(tango_gl::GestureCamera::CameraType camera_type);
 
-  // Touch event passed from android activity. This function only supports two
-  // touches.
+  // Show the GPU time of the render passes over the frame.
+  void SetGpuProfilerHudVisible(bool visible);
+
+  // Stream the fisheye camera along with the color camera, and show its
+  // images in a corner of the screen, e.g. to judge the tracking quality.
+  // The fisheye texture is only updated while this is set.
+  void SetFisheyeStreamEnabled(bool enabled);
+
+  // Hide the virtual content behind the real geometry in first person mode,
+  // using the point clouds of the depth camera. Enabled by default.
+  void SetDepthOcclusionEnabled(bool enabled);
+
+  // Build a 2D occupancy grid of the floor from the point clouds, and show
+  // the part of it around the device in a corner of the screen, north up,
+  // with the path from the device to the goal marker on the floor.
+  // Turning it off keeps the grid, turning it on again resumes it.
+  void SetFloorMapEnabled(bool enabled);
+
+  // Detect the fiducial tags of tango_util::TagFamily::Tag16h5() in the
+  // camera images, and anchor the axes of each tag where it is first seen.
+  // The markers stay on their anchors once it is turned off.
+  void SetTagDetectionEnabled(bool enabled);
+
+  // Share the cells of the depth points and the tag anchors with the other
+  // devices localized in the same area description, see
+  // tango_util::MapSync, and anchor the tags they saw as well. Only the
+  // data of while localized is shared.
   //
-  // @param: touch_count, total count for touches.
-  // @param: event, touch event of current touch.
-  // @param: x0, normalized touch location for touch 0 on x axis.
-  // @param: y0, normalized touch location for touch 0 on y axis.
-  // @param: x1, normalized touch location for touch 1 on x axis.
-  // @param: y1, normalized touch location for touch 1 on y axis.
-  void OnTouchEvent(int touch_count, tango_gl::GestureCamera::TouchEvent event,
-                    float x0, float y0, float x1, float y1);
+  // @return: false without an area description, or if the socket could not
+  //          be opened.
+  bool StartMapSharing(int port);
+  void StopMapSharing();
+
+  // Render the first person view for both eyes of a headset the device is
+  // mounted in, side by side on the screen.
+  void SetStereoEnabled(bool enabled);
+
+  // Start each frame as late as it can still finish before the next vsync,
+  // so that the camera image and the pose are latched just before they are
+  // shown. Enabled by default, does nothing on devices without
+  // AChoreographer.
+  void SetFramePacingEnabled(bool enabled);
+
+  // Set the pose the virtual content is rendered with.
+  //
+  // @param: mode, render at the camera image pose or at the predicted display
+  //         time pose.
+  void SetRenderPoseMode(RenderPoseMode mode);
+
+  // Save the frames drawn, video overlay and virtual content, as PNG files in
+  // |directory| at up to 8 per second, or stop when it is empty. The frames
+  // are read back and encoded without stalling the GL thread, and dropped
+  // when the encoding can not keep up.
+  void SetSnapshotDirectory(const std::string& directory);
+
+  // Also draw the frames into |window|, the input surface of a video
+  // encoder, timed by their color camera image, or stop with NULL. Must be
+  // called on the GL thread, e.g. from GLSurfaceView.queueEvent(), and with
+  // NULL before the encoder is released.
+  void SetRecordingWindow(ANativeWindow* window);
+
+  // Only render when there is a new color camera image, an input or a state
+  // change, instead of on every frame. The Java activity must use the
+  // matching GLSurfaceView render mode.
+  void SetRenderOnDemand(bool on_demand);
+
+  // Touch samples batched by the android activity, handled at the start of
+  // the next Render(). Only two touches are supported.
+  //
+  // @param: samples, sample_count samples of tango_util::TouchQueue::
+  //         kSampleSize floats, the touch count, the touch event, and the
+  //         normalized locations of touch 0 and touch 1.
+  void OnTouchEvents(const float* samples, int sample_count);
 
   // Cache the Java VM
   //
@@ -134,63 +267,200 @@ class AugmentedRealityApp {
   // @return: pose in matrix format.
   glm::mat4 GetPoseMatrixAtTimestamp(double timstamp);
 
-  // Query sensor/camera extrinsic from the Tango Service, the extrinsic is only
-  // available after the service is connected.
+  // Get the pose predicted at the display time of the frame being rendered,
+  // in matrix format.
   //
-  // @return: error code.
-  TangoErrorType UpdateExtrinsics();
+  // @return: pose in matrix format.
+  glm::mat4 GetPredictedPoseMatrix();
+
+  // Ease in the latest pose of the area description, and move the content
+  // to the poses of its anchors when they changed.
+  void UpdateAnchors();
+
+  // Share the tag anchors, and anchor the tags of the peers not seen yet.
+  void UpdateMapSharing();
+
+  // Hand the scene the point cloud closest to |color_timestamp|, with the
+  // pose of the depth camera when it was taken, and insert it into the floor
+  // map when it is new.
+  void UpdateDepth(double color_timestamp);
+
+  // Upload the window of floor_map_ around |position|, in the start of
+  // service frame, when it changed.
+  void UpdateFloorMap(const glm::vec3& position);
+
+  // Repair the path over floor_map_ from |position|, in the start of service
+  // frame, to the goal marker, and hand it to the scene when it changed.
+  void UpdatePath(const glm::vec3& position);
 
-  // Request the render function from Java layer.
+  // Lay out the camera image and the virtual content on the display, when
+  // the layout of display_configuration_ changed.
+  void ApplyDisplayLayout(
+      const tango_util::DisplayConfiguration::Layout& layout);
+
+  // Request the render function from Java layer, called by render_scheduler_.
   void RequestRender();
 
-  // pose_data_ handles all pose onPoseAvailable callbacks, onPoseAvailable()
-  // in this object will be routed to pose_data_ to handle.
-  PoseData pose_data_;
+  // Hand the snapshots read back to the writer, and capture the frame just
+  // drawn when one is due. Called once the scene is rendered.
+  void UpdateSnapshots(double color_timestamp);
+
+  // Read the luminance of the camera texture back into the pyramid, queueing
+  // that of the new image if |is_new_image|, detect the tags of the latest
+  // one read, and anchor the tags not seen before.
+  void UpdateTags(bool is_new_image, double color_timestamp);
+
+  // @return the drop policy of the fisheye stream, paused unless
+  //         SetFisheyeStreamEnabled().
+  tango_util::CameraStreamScheduler::DropPolicy GetFisheyeDropPolicy() const;
+
+  // The poses of both frame pairs of the onPoseAvailable callback, as of the
+  // latest tick of the service.
+  tango_util::PoseBus pose_bus_;
+
+  // Device poses recorded from the onPoseAvailable callback, looked up by the
+  // render thread at the timestamp of the color camera image.
+  tango_util::PoseHistory pose_history_;
+
+  // Extrapolates pose_history_ to the display time in kPredictedDisplayPose
+  // mode.
+  tango_util::PosePredictor pose_predictor_;
+  RenderPoseMode render_pose_mode_;
+
+  // The latency of the color camera images, from their capture to the
+  // display, on the clock pose_predictor_ follows.
+  tango_util::LatencyTracker color_latency_;
 
-  // Mutex for protecting the pose data. The pose data is shared between render
-  // thread and TangoService callback thread.
-  std::mutex pose_mutex_;
+  // Sensor extrinsics and camera intrinsics, queried once the service is
+  // connected rather than on the first frame.
+  tango_util::ExtrinsicsCache extrinsics_;
+  tango_util::IntrinsicsRegistry intrinsics_;
+
+  // The view port and the projection of the color camera for the rotation of
+  // the display and the size of the surface.
+  tango_util::DisplayConfiguration display_configuration_;
+
+  // The area description loaded by TangoSetupConfig(), none if empty.
+  std::string area_description_uuid_;
+
+  // The anchors of the AR content, only used on the render thread, and the
+  // tick of pose_bus_ of the area description pose they follow.
+  tango_util::AnchorStore anchors_;
+  uint64_t area_pose_tick_;
+
+  // pose_data_ holds the poses rendered, only used on the render thread.
+  PoseData pose_data_;
 
   // tango_event_data_ handles all Tango event callbacks,
   // onTangoEventAvailable() in this object will be routed to tango_event_data_
-  // to handle.
+  // to handle. Only used on the event callback thread.
   TangoEventData tango_event_data_;
 
-  // tango_event_data_ is share between the UI thread we start for updating
-  // debug
-  // texts and the TangoService event callback thread. We keep event_mutex_ to
-  // protect tango_event_data_.
-  std::mutex tango_event_mutex_;
+  // Debug information of pose_data_ and tango_event_data_, written by their
+  // threads and read by the activity without calling into native code.
+  tango_util::TelemetryBlock<Telemetry> telemetry_;
 
   // main_scene_ includes all drawable object for visualizing Tango device's
   // movement.
   Scene main_scene_;
 
+  // Whether the GL context main_scene_ was created in is still alive.
+  tango_gl::GlContextTracker gl_context_;
+
   // Tango configration file, this object is for configuring Tango Service setup
   // before connect to service. For example, we set the flag
   // config_enable_auto_recovery based user's input and then start Tango.
   TangoConfig tango_config_;
 
-  // Device color camera intrinsics, these intrinsics value is used for
-  // calculate the camera frustum and image aspect ratio. In the AR view, we
-  // want to match the virtual camera's intrinsics to the actual physical camera
-  // as close as possible.
-  TangoCameraIntrinsics color_camera_intrinsics_;
-
   // Tango service version string.
   std::string tango_core_version_string_;
 
   // Cached Java VM, caller activity object and the request render method. These
-  // variables are used for on demand render request from the onTextureAvailable
+  // variables are used for on demand render request from the camera frame
   // callback.
   JavaVM* java_vm_;
   jobject calling_activity_obj_;
   jmethodID on_demand_render_;
 
-  bool is_service_connected_;
+  // Coalesces the render requests of the callbacks, the UI and the input.
+  tango_util::RenderScheduler render_scheduler_;
+
+  // Holds the start of each frame until just in time for the next vsync,
+  // receiving the vsyncs while the activity is alive.
+  tango_util::FramePacer frame_pacer_;
+
+  // Touch samples of OnTouchEvents(), and those taken by the frame.
+  tango_util::TouchQueue touch_queue_;
+  std::vector<tango_util::TouchSample> touch_samples_;
+
+  // Lowers the resolution of the virtual objects over the camera image to
+  // keep within the frame time budget, see Scene::SetOverlayScale().
+  tango_util::QualityGovernor quality_governor_;
+
+  // Updates the color camera texture of the video overlay, and the fisheye
+  // one of its inset, once per frame.
+  tango_util::CameraStreamScheduler camera_streams_;
+  std::atomic<bool> is_fisheye_stream_enabled_;
+
+  // The point clouds of the occlusion, from the depth callback to the render
+  // thread.
+  tango_util::PointCloudQueue point_cloud_queue_;
+  std::atomic<bool> is_depth_occlusion_enabled_;
+
+  // The floor map, and the revision and center cell of the window of it last
+  // uploaded, only used on the render thread.
+  std::atomic<bool> is_floor_map_enabled_;
+  tango_util::OccupancyGrid floor_map_;
+  uint64_t floor_map_revision_;
+  glm::ivec2 floor_map_center_;
+  std::vector<uint8_t> floor_map_pixels_;
+
+  // The path to the marker over the floor map, the revision and height of
+  // the one drawn, and the cells changed since the previous update.
+  tango_util::PathPlanner path_planner_;
+  uint64_t path_revision_;
+  float path_floor_height_;
+  std::vector<glm::ivec2> blocked_cells_;
+  std::vector<glm::vec3> path_points_;
+
+  // Snapshots of the frames, read back on the GL thread and encoded on the
+  // writer thread. The directory is set by SetSnapshotDirectory() and picked
+  // up by the next frame.
+  tango_gl::FrameCapture frame_capture_;
+  tango_util::SnapshotWriter snapshot_writer_;
+  std::mutex snapshot_mutex_;
+  std::string snapshot_directory_;
+  std::atomic<bool> is_snapshot_directory_changed_;
+  double last_snapshot_timestamp_;
+
+  // The video encoder surface the frames are drawn into while recording.
+  tango_gl::EncoderSurface encoder_surface_;
+
+  // The tags detected in the luminance of the camera texture, which is read
+  // back into the pyramid, only used on the render thread. The anchor of each
+  // tag seen, by tag id.
+  std::atomic<bool> is_tag_detection_enabled_;
+  tango_gl::CameraLuminance camera_luminance_;
+  tango_util::ImagePyramid luminance_pyramid_;
+  tango_util::TagDetector tag_detector_;
+  std::map<int, int> tag_anchors_;
+
+  // Shares the map and the tag anchors, in the area description frame of
+  // the anchors, the OpenGL convention of the world. The pose of the world
+  // in it and the anchors of the peers are only used on the render thread.
+  tango_util::MapSync map_sync_;
+  glm::mat4 area_T_world_;
+  std::vector<tango_util::MapSync::RemoteAnchor> remote_anchors_;
+
+  // Set on the startup thread once TangoConnect() succeeded.
+  std::atomic<bool> is_service_connected_;
   bool is_texture_id_set_;
 
-  int viewport_width_;
+  // Times the phases of the startup, run on the startup and GL threads.
+  tango_util::StartupTimer startup_timer_;
+
+  // Height of the view port of the layout applied, only used on the GL
+  // thread.
   int viewport_height_;
 };
 }  // namespace tango_augmented_reality
@@ -19,15 +19,25 @@
 
 #include <jni.h>
 #include <memory>
+#include <vector>
 
 #include <tango_client_api.h>  // NOLINT
 #include <tango-gl/axis.h>
+#include <tango-gl/band.h>
+#include <tango-gl/bounding_volume_hierarchy.h>
 #include <tango-gl/camera.h>
 #include <tango-gl/color.h>
+#include <tango-gl/depth_occluder.h>
 #include <tango-gl/gesture_camera.h>
 #include <tango-gl/grid.h>
 #include <tango-gl/frustum.h>
 #include <tango-gl/goal_marker.h>
+#include <tango-gl/gpu_profiler.h>
+#include <tango-gl/gpu_profiler_hud.h>
+#include <tango-gl/memory_accounting.h>
+#include <tango-gl/overlay_target.h>
+#include <tango-gl/quad.h>
+#include <tango-gl/stereo_rig.h>
 #include <tango-gl/trace.h>
 #include <tango-gl/transform.h>
 #include <tango-gl/util.h>
@@ -69,10 +79,44 @@ class Scene {
   //         top down
   void SetCameraType(tango_gl::GestureCamera::CameraType camera_type);
 
+  // Hide the virtual objects behind the real geometry in first person mode,
+  // by filling the depth buffer with the point cloud of the depth camera.
+  void SetDepthOcclusionEnabled(bool enabled) {
+    is_depth_occlusion_enabled_ = enabled;
+  }
+
+  // Set the point cloud the depth buffer is filled with.
+  //
+  // @param: point_cloud, the point cloud in the depth camera frame.
+  // @param: is_new, false if it was set already, to skip its upload.
+  // @param: world_T_depth_camera, the pose of the depth camera when it was
+  //         taken.
+  // @param: viewport_height, height of the view port in pixels.
+  void SetOcclusionPointCloud(const TangoXYZij* point_cloud, bool is_new,
+                              const glm::mat4& world_T_depth_camera,
+                              int viewport_height);
+
   // Get video overlay texture id.
   // @return: texture id of video overlay's texture.
   GLuint GetVideoOverlayTextureId() { return video_overlay_->GetTextureId(); }
 
+  // @return: texture id of the fisheye inset's texture.
+  GLuint GetFisheyeOverlayTextureId() {
+    return fisheye_overlay_->GetTextureId();
+  }
+
+  // Draw the fisheye inset undistorted, to a pinhole image of the fisheye
+  // camera. Must be called on the GL thread.
+  // @param: intrinsics, of the fisheye camera.
+  // @return: false if it is drawn distorted, the GPU not supporting the
+  //          undistortion map or the calibration not being a known model.
+  bool SetFisheyeIntrinsics(const TangoCameraIntrinsics& intrinsics);
+
+  // Show the fisheye camera image in the bottom right corner of the screen.
+  void SetFisheyeOverlayVisible(bool visible) {
+    is_fisheye_overlay_visible_ = visible;
+  }
+
   // @return: AR render camera's image plane ratio.
   float GetCameraImagePlaneRatio() { return camera_image_plane_ratio_; }
 
@@ -98,6 +142,13 @@ class Scene {
     ar_camera_projection_matrix_ = projection_matrix;
   }
 
+  // Set the rotation of the full screen video overlay on the display.
+  // @param: display_T_camera, the rotation of clip space turning the camera
+  //         image upright.
+  void SetDisplayTransform(const glm::mat4& display_T_camera) {
+    display_T_camera_ = display_T_camera;
+  }
+
   // Set the frustum render drawable object's scale. For the best visialization
   // result, we set the camera frustum object's scale to the physical camera's
   // aspect ratio.
@@ -119,10 +170,118 @@ class Scene {
   void OnTouchEvent(int touch_count, tango_gl::GestureCamera::TouchEvent event,
                     float x0, float y0, float x1, float y1);
 
+  // Render the occlusion and the virtual objects of the first person view at
+  // |scale| times the resolution of the view port, over the camera image at
+  // full resolution.
+  // @param: scale, in [tango_gl::OverlayTarget::kMinScale, 1].
+  void SetOverlayScale(float scale) { overlay_target_.SetScale(scale); }
+
+  // Render the first person view for both eyes of a headset, side by side,
+  // instead of once over the view port. The overlay is not scaled then.
+  void SetStereoEnabled(bool enabled) { is_stereo_enabled_ = enabled; }
+
+  // Set the size of the surface the eyes share.
+  // @param: width, height, of the surface in pixels.
+  void SetStereoSurfaceSize(int width, int height) {
+    stereo_rig_.SetSurfaceSize(width, height);
+  }
+
+  // Set the intrinsics the projection of each eye is derived from.
+  // @param: intrinsics, of the color camera.
+  void SetStereoIntrinsics(const TangoCameraIntrinsics& intrinsics);
+
+  // Upload the floor map drawn in the top left corner of the screen.
+  // @param: pixels, |size|^2 bytes of luminance, the first row at the top.
+  // @param: size, edge length of the map in pixels.
+  void SetFloorMap(const uint8_t* pixels, int size);
+
+  // Show the floor map of SetFloorMap() in the top left corner.
+  void SetFloorMapVisible(bool visible) { is_floor_map_visible_ = visible; }
+
+  // Set the path to the goal marker drawn on the floor.
+  // @param: points, the turns of the path in the OpenGL world frame, fewer
+  //         than two for no path.
+  void SetPath(const std::vector<glm::vec3>& points);
+
+  // Show the path of SetPath().
+  void SetPathVisible(bool visible) { is_path_visible_ = visible; }
+
+  // @return: the position of the goal marker in the OpenGL world frame.
+  glm::vec3 GetMarkerPosition() const {
+    return glm::vec3(marker_->GetTransformationMatrix()[3]);
+  }
+
+  // Anchor of tango_util::AnchorStore the goal marker is placed on.
+  static const int kMarkerAnchor = 0;
+
+  // Move the AR content to the poses of its anchors, the objects following
+  // the node of their anchor.
+  // @param: transforms, the pose of every anchor in the OpenGL world frame,
+  //         by anchor id, see tango_util::AnchorStore::GetTransforms().
+  void SetAnchorTransforms(const std::vector<glm::mat4>& transforms);
+
+  // Show the axes of a fiducial tag on |anchor|, e.g. one placed at a tag
+  // of tango_util::TagDetector. The markers are kept over a loss of the GL
+  // context.
+  // @param: size, edge length of the tag, the length of the axes.
+  void AddTagMarker(int anchor, float size);
+
+  // Show the GPU time of the video overlay and mesh passes over the frame.
+  void SetGpuProfilerHudVisible(bool visible) {
+    is_gpu_profiler_hud_visible_ = visible;
+  }
+
  private:
+  // Passes timed by gpu_profiler_, in the order they are added.
+  enum GpuPass { kVideoOverlayPass, kMeshPass, kOcclusionPass };
+
+  // Render the passes into the view port, or for each eye.
+  void RenderMono(bool is_first_person);
+  void RenderStereo();
+
+  // A marker of AddTagMarker().
+  struct TagMarker {
+    int anchor;
+    float size;
+  };
+
+  // @return: the node of |anchor|, created at the origin if needed.
+  tango_gl::Transform* GetAnchorNode(int anchor);
+
+  // Create the axes of |marker| and add them to anchored_objects_.
+  void CreateTagAxis(const TagMarker& marker);
+
   // Video overlay drawable object to display the camera image.
   tango_gl::VideoOverlay* video_overlay_;
 
+  // Inset of the fisheye camera image, drawn over the scene when
+  // is_fisheye_overlay_visible_ is set.
+  tango_gl::VideoOverlay* fisheye_overlay_;
+  bool is_fisheye_overlay_visible_;
+
+  // Fills the depth buffer over the video overlay when
+  // is_depth_occlusion_enabled_ is set, with the pose of the depth camera
+  // its points were taken at.
+  tango_gl::DepthOccluder* depth_occluder_;
+  bool is_depth_occlusion_enabled_;
+  glm::mat4 world_T_depth_camera_;
+  int occlusion_viewport_height_;
+
+  // Inset of the floor map, a square of the height of kFloorMapInsetScale
+  // times the one of the view port, drawn when is_floor_map_visible_ is set
+  // and the map was uploaded.
+  tango_gl::Quad* floor_map_quad_;
+  GLuint floor_map_texture_;
+  int floor_map_size_;
+  tango_gl::MemoryAccount floor_map_memory_;
+  bool is_floor_map_visible_;
+
+  // Path to the marker, a band on the floor drawn when is_path_visible_ is
+  // set and it has points.
+  tango_gl::Band* path_band_;
+  bool has_path_;
+  bool is_path_visible_;
+
   // Camera object that allows user to use touch input to interact with.
   tango_gl::GestureCamera* gesture_camera_;
 
@@ -138,9 +297,28 @@ class Scene {
   // Trace of pose data.
   tango_gl::Trace* trace_;
 
-  // A marker placed at (0.0f, 0.0f, -3.0f) location.
+  // A marker placed at (0.0f, 0.0f, -3.0f) from its anchor.
   tango_gl::GoalMarker* marker_;
 
+  // The markers of the tags, and their axes, created with the GL content.
+  std::vector<TagMarker> tag_markers_;
+  std::vector<std::unique_ptr<tango_gl::Axis>> tag_axes_;
+
+  // The nodes the AR content is attached to, one per anchor, by anchor id.
+  // They are not GL resources, so they keep their pose over a context loss.
+  std::vector<std::unique_ptr<tango_gl::Transform>> anchor_nodes_;
+
+  // Objects that do not move, drawn only when they are in view. Their tree
+  // is built once.
+  tango_gl::BoundingVolumeHierarchy static_objects_;
+  // Objects attached to the anchors, which move with them: their tree is
+  // refitted every time the anchors are, and rebuilt when the refit left it
+  // too costly.
+  tango_gl::BoundingVolumeHierarchy anchored_objects_;
+
+  // The first person view renders the occlusion and the objects into it.
+  tango_gl::OverlayTarget overlay_target_;
+
   // We use both camera_image_plane_ratio_ and image_plane_distance_ to compute
   // the first person AR camera's frustum, these value is derived from actual
   // physical camera instrinsics.
@@ -152,6 +330,20 @@ class Scene {
 
   // The projection matrix for the first person AR camera.
   glm::mat4 ar_camera_projection_matrix_;
+  // The rotation of the full screen video overlay.
+  glm::mat4 display_T_camera_;
+
+  // GPU time of the render passes, shown by gpu_profiler_hud_ when
+  // is_gpu_profiler_hud_visible_ is set.
+  tango_gl::GpuProfiler gpu_profiler_;
+  tango_gl::GpuProfilerHud* gpu_profiler_hud_;
+  bool is_gpu_profiler_hud_visible_;
+
+  // The eyes of the first person view when is_stereo_enabled_ is set, and
+  // the objects they may see, culled once for both.
+  tango_gl::StereoRig stereo_rig_;
+  bool is_stereo_enabled_;
+  std::vector<const tango_gl::DrawableObject*> stereo_visible_objects_;
 };
 }  // namespace tango_augmented_reality
 
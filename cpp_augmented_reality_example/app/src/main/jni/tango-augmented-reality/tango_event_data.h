@@ -18,11 +18,11 @@
 #define TANGO_AUGMENTED_REALITY_TANGO_EVENT_DATA_H_
 
 #include <jni.h>
-#include <mutex>
-#include <string>
 
 #include <tango_client_api.h>  // NOLINT
 
+#include <tango-augmented-reality/telemetry.h>
+
 namespace tango_augmented_reality {
 
 // TangoEvent is handling the tango event callbacks (e.g, TooFewFeaturesTracked)
@@ -46,12 +46,16 @@ class TangoEventData {
   // Clear event string. Set event_string_ to empty.
   void ClearEventString();
 
-  // Get formated event string for debug dispaly purpose.
-  std::string GetTangoEventString();
+  // Copy the latest event string and the event count into the event fields
+  // of |telemetry|.
+  void WriteTelemetry(Telemetry* telemetry) const;
 
  private:
-  // Current event string.
-  std::string event_string_;
+  // Current event string, longer events are truncated.
+  char event_string_[Telemetry::kEventLength];
+
+  // Events received so far.
+  int32_t event_count_;
 };
 }  // namespace tango_augmented_reality
 
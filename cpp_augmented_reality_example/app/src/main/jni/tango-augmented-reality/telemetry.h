@@ -0,0 +1,61 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_AUGMENTED_REALITY_TELEMETRY_H_
+#define TANGO_AUGMENTED_REALITY_TELEMETRY_H_
+
+#include <cstdint>
+
+namespace tango_augmented_reality {
+
+// The debug information the activity shows, shared with it through a
+// tango_util::TelemetryBlock. AugmentedRealityActivity.java mirrors the layout
+// as offsets, which must be updated along with it.
+struct Telemetry {
+  static const int kEventLength = 256;
+  static const int kLatencyStageCount = 3;
+
+  // The latest pose rendered: its TangoPoseStatusType, the poses rendered
+  // since the status last changed, the time since the previous one in
+  // milliseconds, the position in meters and the orientation quaternion.
+  int32_t pose_status;
+  int32_t pose_count;
+  float pose_delta_time;
+  float position[3];
+  float orientation[4];
+
+  // Bumped for every Tango event, whose "key: value" text is event, null
+  // terminated.
+  int32_t event_count;
+  char event[kEventLength];
+
+  // The frame pacing, written by the render thread: the time the latest frame
+  // waited to start, the render duration estimate, in milliseconds, and the
+  // frames that started in the same vsync interval as the previous one, see
+  // tango_util::FramePacer.
+  float frame_pacing_wait;
+  float render_duration;
+  int32_t double_latch_count;
+
+  // The average latency of the color camera images in milliseconds, from
+  // their capture to the callback, from the callback to the frame drawn with
+  // them, and from that frame to its presentation, see
+  // tango_util::LatencyTracker.
+  float color_latencies[kLatencyStageCount];
+};
+}  // namespace tango_augmented_reality
+
+#endif  // TANGO_AUGMENTED_REALITY_TELEMETRY_H_
@@ -14,13 +14,14 @@
  * limitations under the License.
  */
 
-#include <sstream>
+#include <cstdio>
+#include <cstring>
 
 #include "tango-augmented-reality/tango_event_data.h"
 
 namespace tango_augmented_reality {
 
-TangoEventData::TangoEventData() {}
+TangoEventData::TangoEventData() : event_count_(0) { event_string_[0] = '\0'; }
 
 TangoEventData::~TangoEventData() {}
 
@@ -30,16 +31,19 @@ TangoEventData::~TangoEventData() {}
 //
 // @param: event, TangoEvent in current frame.
 void TangoEventData::UpdateTangoEvent(const TangoEvent* event) {
-  std::stringstream string_stream;
-  string_stream << event->event_key << ": " << event->event_value;
-  event_string_ = string_stream.str();
-  string_stream.flush();
+  // The event strings only live for the duration of the callback, so they are
+  // copied, into a fixed buffer to keep the callback free of allocations.
+  snprintf(event_string_, sizeof(event_string_), "%s: %s", event->event_key,
+           event->event_value);
+  ++event_count_;
 }
 
 // Clear event string. Set event_string_ to empty.
-void TangoEventData::ClearEventString() { event_string_.clear(); }
+void TangoEventData::ClearEventString() { event_string_[0] = '\0'; }
 
-// Get formated event string for debug dispaly purpose.
-std::string TangoEventData::GetTangoEventString() { return event_string_; }
+void TangoEventData::WriteTelemetry(Telemetry* telemetry) const {
+  memcpy(telemetry->event, event_string_, sizeof(telemetry->event));
+  telemetry->event_count = event_count_;
+}
 
 }  // namespace tango_augmented_reality
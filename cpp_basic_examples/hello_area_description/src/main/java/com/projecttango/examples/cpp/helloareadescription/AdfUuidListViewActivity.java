@@ -62,6 +62,11 @@ public class AdfUuidListViewActivity extends Activity implements SetAdfNameDialo
         @Override
         public void onServiceConnected(ComponentName name, IBinder service) {
             TangoJniNative.onTangoServiceConnected(service);
+            if (mIsAdfCatalogStale) {
+                // The import and export activities change the ADFs behind our back.
+                TangoJniNative.syncAdfCatalog();
+                mIsAdfCatalogStale = false;
+            }
             updateList();
         }
 
@@ -77,12 +82,15 @@ public class AdfUuidListViewActivity extends Activity implements SetAdfNameDialo
     private ArrayList<AdfData> mTangoSpaceAdfDataList, mAppSpaceAdfDataList;
     private String[] mTangoSpaceMenuStrings, mAppSpaceMenuStrings;
     private String mAppSpaceAdfFolder;
+    // Set when the ADFs may have changed outside of this app.
+    private boolean mIsAdfCatalogStale = false;
 
     @Override
     protected void onCreate(Bundle savedInstanceState) {
         super.onCreate(savedInstanceState);
 
         setContentView(R.layout.adf_list_view);
+        TangoJniNative.setAdfIndexPath(Util.getAdfIndexPath(this));
         mTangoSpaceMenuStrings = getResources().getStringArray(
                 R.array.set_dialog_menu_items_api_space);
         mAppSpaceMenuStrings = getResources().getStringArray(
@@ -165,6 +173,8 @@ public class AdfUuidListViewActivity extends Activity implements SetAdfNameDialo
     protected void onActivityResult(int requestCode, int resultCode, Intent data) {
         // Check which request we're responding to
         if (requestCode == TANGO_INTENT_ACTIVITY_CODE) {
+            // Synced once the service is bound again.
+            mIsAdfCatalogStale = true;
             // Make sure the request was successful
             if (resultCode == RESULT_CANCELED) {
                 Toast.makeText(this, R.string.no_permissions, Toast.LENGTH_LONG).show();
@@ -33,6 +33,8 @@ import android.widget.Toast;
 
 import com.projecttango.examples.cpp.util.TangoInitializationHelper;
 
+import java.util.Locale;
+
 /**
  * This activity is called after the user selects the area description configuration in the
  * {@code StartActivity}.
@@ -120,6 +122,7 @@ public class AreaDescriptionActivity extends Activity implements
 
     queryDataFromStartActivity();
     setupUiComponents();
+    TangoJniNative.setAdfIndexPath(Util.getAdfIndexPath(this));
 
     // Check that the installed version of the Tango Core is up to date.
     if (!TangoJniNative.initialize(this, MIN_TANGO_CORE_VERSION)) {
@@ -213,7 +216,7 @@ public class AreaDescriptionActivity extends Activity implements
   }
 
   /**
-   * Updates the save progress dialog (called from hello_area_description_app.cc).
+   * Updates the save progress dialog (called from adf_saver.cc).
    */
   public void updateSavingAdfProgress(int progress) {
     // Note: this method is not called from the UI thread. We read mSaveAdfTask into
@@ -224,6 +227,17 @@ public class AreaDescriptionActivity extends Activity implements
     }
   }
 
+  /**
+   * Reports the result of a save to mSaveAdfTask (called from adf_saver.cc).
+   */
+  public void onAdfSaved(int jobId, String adfUuid) {
+    // Note: this method is not called from the UI thread either.
+    SaveAdfTask saveAdfTask = mSaveAdfTask;
+    if (saveAdfTask != null) {
+      saveAdfTask.publishResult(jobId, adfUuid);
+    }
+  }
+
   /**
    * Query user's input for the Tango Service configuration.
    */
@@ -284,8 +298,10 @@ public class AreaDescriptionActivity extends Activity implements
    */
   private void updateUi() {
     try {
-      mRelocalizationTextView.setText(TangoJniNative.isRelocalized() ?
-                                      "Relocalized" : "Not Relocalized");
+      double timeToLocalize = TangoJniNative.getTimeToLocalize();
+      mRelocalizationTextView.setText(timeToLocalize >= 0 ?
+          String.format(Locale.US, "Relocalized in %.1f s", timeToLocalize) :
+          "Not Relocalized");
 
       if (TangoJniNative.isRelocalized()) {
         findViewById(R.id.save_adf_button).setEnabled(true);
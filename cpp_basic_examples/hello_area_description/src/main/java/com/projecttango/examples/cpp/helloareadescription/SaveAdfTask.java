@@ -17,12 +17,16 @@
 package com.projecttango.examples.cpp.helloareadescription;
 
 import android.content.Context;
-import android.os.AsyncTask;
+import android.os.Handler;
+import android.os.Looper;
 
 /**
- * Saves the ADF on a background thread and shows a progress dialog while saving.
+ * Saves the ADF on a native thread and shows a progress dialog while saving.
+ *
+ * The progress and the result come from a native thread and are handed to the
+ * UI thread.
  */
-public class SaveAdfTask extends AsyncTask<Void, Integer, String> {
+public class SaveAdfTask {
 
     /**
      * Listener to check if save ADF is successed.
@@ -36,6 +40,9 @@ public class SaveAdfTask extends AsyncTask<Void, Integer, String> {
     SaveAdfListener mCallbackListener;
     SaveAdfDialog mProgressDialog;
     String mAdfName;
+    // ID of the native save, 0 before it started.
+    int mJobId;
+    Handler mHandler = new Handler(Looper.getMainLooper());
 
     SaveAdfTask(Context context, SaveAdfListener callbackListener, String adfName) {
         mContext = context;
@@ -45,51 +52,52 @@ public class SaveAdfTask extends AsyncTask<Void, Integer, String> {
     }
 
     /**
-     * Call this method to marshall progress updates to the UI thread.
-     */
-    public void publishProgress(int progress) {
-        super.publishProgress(progress);
-    }
-
-
-    /**
-     * Sets up the progress dialog.
+     * Shows the progress dialog and starts the save, call from the UI thread.
      */
-    @Override
-    protected void onPreExecute() {
+    public void execute() {
         if (mProgressDialog != null) {
             mProgressDialog.show();
         }
+        mJobId = TangoJniNative.saveAdfAsync(mAdfName);
+        if (mJobId == 0) {
+            // Another save is running.
+            onFinished("");
+        }
     }
 
     /**
-     * Performs long-running save in the background.
+     * Call this method to marshall progress updates to the UI thread.
      */
-    @Override
-    protected String doInBackground(Void... params) {
-        // This example implementation returns an empty-string on failure.
-        String adfUuid = TangoJniNative.saveAdf();
-        if (!adfUuid.isEmpty()) {
-            TangoJniNative.setAdfMetadataValue(adfUuid, "name", mAdfName);
-        }
-        return adfUuid;
+    public void publishProgress(final int progress) {
+        mHandler.post(new Runnable() {
+            @Override
+            public void run() {
+                if (mProgressDialog != null) {
+                    mProgressDialog.setProgress(progress);
+                }
+            }
+        });
     }
 
     /**
-     * Responds to progress updates events by updating the UI.
+     * Call this method to marshall the result of the save to the UI thread.
      */
-    @Override
-    protected void onProgressUpdate(Integer... progress) {
-        if (mProgressDialog != null) {
-            mProgressDialog.setProgress(progress[0]);
-        }
+    public void publishResult(final int jobId, final String adfUuid) {
+        mHandler.post(new Runnable() {
+            @Override
+            public void run() {
+                // execute() has returned by now, mJobId is set.
+                if (jobId == mJobId) {
+                    onFinished(adfUuid);
+                }
+            }
+        });
     }
 
     /**
      * Dismisses the progress dialog and call the activity.
      */
-    @Override
-    protected void onPostExecute(String adfUuid) {
+    private void onFinished(String adfUuid) {
         if (mProgressDialog != null) {
             mProgressDialog.dismiss();
         }
@@ -64,6 +64,10 @@ public class StartActivity extends Activity {
         if (!Util.hasPermission(getApplicationContext(), AREA_LEARNING_PERMISSION)) {
             getPermission(AREA_LEARNING_PERMISSION);
         }
+
+        // Select the ADF to load while the user sets up the session.
+        TangoJniNative.setAdfIndexPath(Util.getAdfIndexPath(this));
+        TangoJniNative.prefetchAdf();
     }
 
     /**
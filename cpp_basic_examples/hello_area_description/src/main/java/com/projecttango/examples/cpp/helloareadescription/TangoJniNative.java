@@ -99,6 +99,17 @@ public class TangoJniNative {
    */
   public static native String saveAdf();
 
+  /**
+   * Save ADF in learning mode on a native thread and name it. The progress is
+   * reported through AreaDescriptionActivity.updateSavingAdfProgress() and the
+   * result through AreaDescriptionActivity.onAdfSaved(), both called from a
+   * native thread.
+   *
+   * @param adfName The name of the ADF.
+   * @return The ID passed to onAdfSaved(), 0 if a save is already running.
+   */
+  public static native int saveAdfAsync(String adfName);
+
   /**
    * Query metadata from an exsiting ADF using the key.
    */
@@ -114,8 +125,46 @@ public class TangoJniNative {
    */
   public static native String getAllAdfUuids();
 
+  /**
+   * Set the file the ADF list is cached in between runs, call before any ADF query.
+   */
+  public static native void setAdfIndexPath(String path);
+
+  /**
+   * Update the cached ADF list with the ADFs added or removed by other apps.
+   */
+  public static native void syncAdfCatalog();
+
+  /**
+   * Select the ADF to load on a background thread, ahead of setupConfig().
+   */
+  public static native void prefetchAdf();
+
+  /**
+   * Seconds from connect() to the relocalization, negative if not relocalized yet.
+   */
+  public static native double getTimeToLocalize();
+
   /**
    * Delete a ADF from Tango space.
    */
   public static native void deleteAdf(String uuid);
+
+  /**
+   * Start recording where the native code spends its time, see tango-gl/tracing.h.
+   */
+  public static native void startTracing();
+
+  /**
+   * Stop recording, the recorded time slices are kept for dumpTrace().
+   */
+  public static native void stopTracing();
+
+  /**
+   * Write the recorded time slices as a Chrome trace JSON file, e.g. under
+   * getExternalFilesDir(null) to pull it from the sdcard.
+   *
+   * @return false if the file could not be written.
+   */
+  public static native boolean dumpTrace(String path);
 }
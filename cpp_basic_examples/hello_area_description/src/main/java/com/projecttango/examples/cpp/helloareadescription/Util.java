@@ -20,11 +20,18 @@ import android.content.Context;
 import android.database.Cursor;
 import android.net.Uri;
 
+import java.io.File;
+
 /**
  * Util class provides handy utility functions.
  */
 public class Util {
 
+    /**
+     * Name of the file the native code caches the ADF list in.
+     */
+    private static final String ADF_INDEX_FILE_NAME = "adf_index";
+
     /**
      * Checks if the calling app has the specified permission.
      * It is recommended that an app check if it has a permission before trying
@@ -46,4 +53,13 @@ public class Util {
             return true;
         }
     }
+
+    /**
+     * Returns the path of the ADF list cache, in the private files of the app.
+     *
+     * @param context The context of the calling app.
+     */
+    public static String getAdfIndexPath(Context context) {
+        return context.getFilesDir().getAbsolutePath() + File.separator + ADF_INDEX_FILE_NAME;
+    }
 }
@@ -14,13 +14,17 @@
 # limitations under the License.
 #
 LOCAL_PATH := $(call my-dir)
+PROJECT_ROOT_FROM_JNI:= ../../../../..
 PROJECT_ROOT:= $(call my-dir)/../../../../..
 
 include $(CLEAR_VARS)
 LOCAL_MODULE    := libhello_area_description
 LOCAL_SHARED_LIBRARIES := tango_client_api tango_support_api
+LOCAL_STATIC_LIBRARIES := tango_util tango_gl
 LOCAL_CFLAGS    := -std=c++11
-LOCAL_SRC_FILES := jni_interface.cc \
+LOCAL_SRC_FILES := adf_catalog.cc \
+                   adf_saver.cc \
+                   jni_interface.cc \
                    hello_area_description_app.cc \
                    pose_data.cc
 LOCAL_LDLIBS    := -llog -L$(SYSROOT)/usr/lib
@@ -29,3 +33,5 @@ include $(BUILD_SHARED_LIBRARY)
 $(call import-add-path, $(PROJECT_ROOT))
 $(call import-module,tango_client_api)
 $(call import-module,tango_support_api)
+$(call import-module,tango_gl)
+$(call import-module,tango_util)
@@ -0,0 +1,340 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hello_area_description/adf_catalog.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+
+#include <tango-gl/tracing.h>
+
+#include "hello_area_description/hello_area_description_app.h"
+
+namespace {
+// First line of the index file, bumped when the format changes so older
+// files are rebuilt.
+const char kIndexHeader[] = "adf_index 2";
+
+// Prefix of the second line of the index, followed by the UUID of the ADF
+// last used.
+const char kLastUsedPrefix[] = "last_used\t";
+
+// The index then has a line per ADF: the UUID, the date and the name
+// separated by tabs, so the name cannot hold tabs or line breaks.
+std::string SanitizeName(const std::string& name) {
+  std::string sanitized(name);
+  for (char& c : sanitized) {
+    if (c == '\t' || c == '\n' || c == '\r') {
+      c = ' ';
+    }
+  }
+  return sanitized;
+}
+}  // namespace
+
+namespace hello_area_description {
+
+AdfCatalog::AdfCatalog() : is_loaded_(false) {}
+
+void AdfCatalog::SetIndexPath(const std::string& path) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (path != index_path_) {
+    index_path_ = path;
+    is_loaded_ = false;
+  }
+}
+
+std::vector<AdfCatalog::Entry> AdfCatalog::GetEntries() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  LoadLocked();
+  return entries_;
+}
+
+bool AdfCatalog::GetLatest(Entry* entry) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  LoadLocked();
+  if (entries_.empty()) {
+    return false;
+  }
+  *entry = entries_.back();
+  return true;
+}
+
+bool AdfCatalog::GetPreferred(Entry* entry) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  LoadLocked();
+  if (entries_.empty()) {
+    return false;
+  }
+  const int index = FindLocked(last_used_uuid_);
+  *entry = index >= 0 ? entries_[index] : entries_.back();
+  return true;
+}
+
+void AdfCatalog::SetLastUsed(const std::string& uuid) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  LoadLocked();
+  if (uuid != last_used_uuid_) {
+    last_used_uuid_ = uuid;
+    WriteIndex();
+  }
+}
+
+bool AdfCatalog::Preload() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!is_loaded_ && ReadIndex()) {
+    is_loaded_ = true;
+  }
+  return is_loaded_;
+}
+
+bool AdfCatalog::GetName(const std::string& uuid, std::string* name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  LoadLocked();
+  const int index = FindLocked(uuid);
+  if (index < 0) {
+    return false;
+  }
+  *name = entries_[index].name;
+  return true;
+}
+
+void AdfCatalog::OnAdfSaved(const std::string& uuid) {
+  Entry entry;
+  entry.uuid = uuid;
+  // Read outside the lock, the service may be slow right after a save.
+  ReadMetadata(&entry);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  LoadLocked();
+  const int index = FindLocked(uuid);
+  if (index >= 0) {
+    entries_[index] = entry;
+  } else {
+    entries_.push_back(entry);
+  }
+  // The area just learned is the one to load next time.
+  last_used_uuid_ = uuid;
+  WriteIndex();
+}
+
+void AdfCatalog::OnAdfDeleted(const std::string& uuid) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  LoadLocked();
+  const int index = FindLocked(uuid);
+  if (index >= 0) {
+    entries_.erase(entries_.begin() + index);
+    if (uuid == last_used_uuid_) {
+      last_used_uuid_.clear();
+    }
+    WriteIndex();
+  }
+}
+
+void AdfCatalog::OnAdfRenamed(const std::string& uuid,
+                              const std::string& name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  LoadLocked();
+  const int index = FindLocked(uuid);
+  if (index >= 0 && entries_[index].name != name) {
+    entries_[index].name = name;
+    WriteIndex();
+  }
+}
+
+void AdfCatalog::Sync() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  // A missing index is built by the sync itself.
+  if (!is_loaded_) {
+    is_loaded_ = true;
+    if (!ReadIndex()) {
+      entries_.clear();
+      last_used_uuid_.clear();
+    }
+  }
+  SyncLocked();
+}
+
+void AdfCatalog::LoadLocked() {
+  if (is_loaded_) {
+    return;
+  }
+  is_loaded_ = true;
+  if (ReadIndex()) {
+    return;
+  }
+  LOGI("AdfCatalog: No valid ADF index, building it from the service.");
+  entries_.clear();
+  last_used_uuid_.clear();
+  if (!SyncLocked()) {
+    // Retried on the next query.
+    is_loaded_ = false;
+  }
+}
+
+bool AdfCatalog::SyncLocked() {
+  TANGO_TRACE_SCOPE("AdfCatalog::Sync");
+  char* uuid_list = nullptr;
+  int ret = TangoService_getAreaDescriptionUUIDList(&uuid_list);
+  // uuid_list will contain a comma separated list of UUIDs.
+  if (ret != TANGO_SUCCESS || uuid_list == nullptr) {
+    LOGE("AdfCatalog: get ADF UUID failed with error code: %d", ret);
+    return false;
+  }
+
+  std::unordered_map<std::string, size_t> indices;
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    indices[entries_[i].uuid] = i;
+  }
+
+  // Only the ADFs new to the catalog cost a metadata query.
+  std::vector<Entry> entries;
+  bool is_changed = false;
+  const std::string list(uuid_list);
+  size_t begin = 0;
+  while (begin < list.size()) {
+    size_t end = list.find(',', begin);
+    if (end == std::string::npos) {
+      end = list.size();
+    }
+    if (end > begin) {
+      Entry entry;
+      entry.uuid = list.substr(begin, end - begin);
+      auto it = indices.find(entry.uuid);
+      if (it != indices.end()) {
+        is_changed |= (it->second != entries.size());
+        entries.push_back(entries_[it->second]);
+      } else {
+        ReadMetadata(&entry);
+        entries.push_back(entry);
+        is_changed = true;
+      }
+    }
+    begin = end + 1;
+  }
+  is_changed |= (entries.size() != entries_.size());
+
+  entries_.swap(entries);
+  if (is_changed) {
+    WriteIndex();
+  }
+  return true;
+}
+
+bool AdfCatalog::ReadIndex() {
+  if (index_path_.empty()) {
+    return false;
+  }
+  std::ifstream file(index_path_);
+  std::string line;
+  if (!std::getline(file, line) || line != kIndexHeader) {
+    return false;
+  }
+  const size_t prefix_size = strlen(kLastUsedPrefix);
+  if (!std::getline(file, line) ||
+      line.compare(0, prefix_size, kLastUsedPrefix) != 0) {
+    return false;
+  }
+  std::string last_used_uuid = line.substr(prefix_size);
+
+  std::vector<Entry> entries;
+  while (std::getline(file, line)) {
+    const size_t date_begin = line.find('\t');
+    const size_t name_begin =
+        date_begin == std::string::npos ? std::string::npos
+                                        : line.find('\t', date_begin + 1);
+    if (name_begin == std::string::npos) {
+      LOGE("AdfCatalog: Invalid line in the ADF index: %s", line.c_str());
+      return false;
+    }
+    Entry entry;
+    entry.uuid = line.substr(0, date_begin);
+    entry.date_ms_since_epoch =
+        strtoull(line.c_str() + date_begin + 1, nullptr, 10);
+    entry.name = line.substr(name_begin + 1);
+    entries.push_back(entry);
+  }
+  entries_.swap(entries);
+  last_used_uuid_.swap(last_used_uuid);
+  return true;
+}
+
+void AdfCatalog::WriteIndex() const {
+  if (index_path_.empty()) {
+    return;
+  }
+  // Write a new file and rename it over the index, so a crash never leaves
+  // a partial index behind.
+  const std::string temporary_path = index_path_ + ".tmp";
+  {
+    std::ofstream file(temporary_path, std::ios::trunc);
+    file << kIndexHeader << '\n' << kLastUsedPrefix << last_used_uuid_ << '\n';
+    for (const Entry& entry : entries_) {
+      file << entry.uuid << '\t' << entry.date_ms_since_epoch << '\t'
+           << SanitizeName(entry.name) << '\n';
+    }
+    file.close();
+    if (file.fail()) {
+      LOGE("AdfCatalog: Failed to write the ADF index %s",
+           temporary_path.c_str());
+      return;
+    }
+  }
+  if (rename(temporary_path.c_str(), index_path_.c_str()) != 0) {
+    LOGE("AdfCatalog: Failed to replace the ADF index %s",
+         index_path_.c_str());
+  }
+}
+
+int AdfCatalog::FindLocked(const std::string& uuid) const {
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    if (entries_[i].uuid == uuid) {
+      return static_cast<int>(i);
+    }
+  }
+  return -1;
+}
+
+bool AdfCatalog::ReadMetadata(Entry* entry) {
+  entry->date_ms_since_epoch = 0;
+  TangoAreaDescriptionMetadata metadata;
+  int ret =
+      TangoService_getAreaDescriptionMetadata(entry->uuid.c_str(), &metadata);
+  if (ret != TANGO_SUCCESS) {
+    LOGE("AdfCatalog: Failed to get ADF metadata with error code: %d", ret);
+    return false;
+  }
+
+  size_t size = 0;
+  char* value = nullptr;
+  ret = TangoAreaDescriptionMetadata_get(metadata, "name", &size, &value);
+  if (ret == TANGO_SUCCESS && value != nullptr) {
+    entry->name.assign(value, strnlen(value, size));
+  }
+  ret = TangoAreaDescriptionMetadata_get(metadata, "date_ms_since_epoch",
+                                         &size, &value);
+  if (ret == TANGO_SUCCESS && value != nullptr &&
+      size == sizeof(entry->date_ms_since_epoch)) {
+    memcpy(&entry->date_ms_since_epoch, value, size);
+  }
+  TangoAreaDescriptionMetadata_free(metadata);
+  return true;
+}
+
+}  // namespace hello_area_description
@@ -0,0 +1,195 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hello_area_description/adf_saver.h"
+
+#include <algorithm>
+
+#include <tango-gl/tracing.h>
+
+#include "hello_area_description/hello_area_description_app.h"
+
+namespace hello_area_description {
+
+// 10 reports per second at most.
+const std::chrono::milliseconds AdfSaver::kProgressInterval(100);
+
+AdfSaver::AdfSaver()
+    : java_vm_(nullptr),
+      activity_(nullptr),
+      on_progress_(nullptr),
+      on_saved_(nullptr),
+      is_stopping_(false),
+      next_job_id_(1),
+      pending_job_id_(0),
+      running_job_id_(0),
+      progress_(0),
+      reported_progress_(0),
+      saved_job_id_(0) {}
+
+AdfSaver::~AdfSaver() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    is_stopping_ = true;
+  }
+  condition_.notify_all();
+  // A save in progress is waited for, the service has no way to cancel it.
+  if (save_thread_.joinable()) {
+    save_thread_.join();
+  }
+  if (report_thread_.joinable()) {
+    report_thread_.join();
+  }
+}
+
+void AdfSaver::SetActivity(jobject activity, jmethodID on_progress,
+                           jmethodID on_saved) {
+  std::lock_guard<std::mutex> lock(activity_mutex_);
+  activity_ = activity;
+  on_progress_ = on_progress;
+  on_saved_ = on_saved;
+}
+
+int AdfSaver::Start(const SaveFunction& save) {
+  int job_id = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (is_stopping_ || pending_job_id_ != 0 || running_job_id_ != 0) {
+      return 0;
+    }
+    if (!save_thread_.joinable()) {
+      save_thread_ = std::thread(&AdfSaver::RunSaves, this);
+      report_thread_ = std::thread(&AdfSaver::RunReports, this);
+    }
+    job_id = next_job_id_++;
+    pending_job_id_ = job_id;
+    pending_save_ = save;
+  }
+  condition_.notify_all();
+  return job_id;
+}
+
+void AdfSaver::OnSaveProgress(double fraction) {
+  const int progress =
+      std::min(std::max(static_cast<int>(fraction * 100.0), 0), 100);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_job_id_ == 0 || progress == progress_) {
+      return;
+    }
+    progress_ = progress;
+  }
+  condition_.notify_all();
+}
+
+void AdfSaver::RunSaves() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    condition_.wait(lock,
+                    [this] { return is_stopping_ || pending_job_id_ != 0; });
+    if (is_stopping_) {
+      return;
+    }
+    const int job_id = pending_job_id_;
+    SaveFunction save;
+    save.swap(pending_save_);
+    pending_job_id_ = 0;
+    running_job_id_ = job_id;
+    progress_ = 0;
+    reported_progress_ = 0;
+    lock.unlock();
+
+    std::string uuid;
+    {
+      TANGO_TRACE_SCOPE("AdfSaver::Save");
+      uuid = save();
+    }
+
+    lock.lock();
+    running_job_id_ = 0;
+    saved_job_id_ = job_id;
+    saved_uuid_ = uuid;
+    condition_.notify_all();
+  }
+}
+
+void AdfSaver::RunReports() {
+  JNIEnv* env = nullptr;
+  if (java_vm_ == nullptr || java_vm_->AttachCurrentThread(&env, nullptr) !=
+                                 JNI_OK) {
+    LOGE("AdfSaver: Failed to attach the report thread to the Java VM.");
+    env = nullptr;
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!is_stopping_) {
+    if (saved_job_id_ != 0) {
+      // The last progress is left out, the dialog goes away with the result.
+      const int job_id = saved_job_id_;
+      const std::string uuid = saved_uuid_;
+      saved_job_id_ = 0;
+      lock.unlock();
+      ReportSaved(env, job_id, uuid);
+      lock.lock();
+      continue;
+    }
+    if (running_job_id_ != 0 && progress_ != reported_progress_) {
+      const Clock::time_point now = Clock::now();
+      const Clock::time_point due = report_time_ + kProgressInterval;
+      if (now < due) {
+        condition_.wait_until(lock, due);
+        continue;
+      }
+      const int progress = progress_;
+      reported_progress_ = progress;
+      report_time_ = now;
+      lock.unlock();
+      ReportProgress(env, progress);
+      lock.lock();
+      continue;
+    }
+    condition_.wait(lock);
+  }
+  lock.unlock();
+
+  if (env != nullptr) {
+    java_vm_->DetachCurrentThread();
+  }
+}
+
+void AdfSaver::ReportProgress(JNIEnv* env, int progress) {
+  std::lock_guard<std::mutex> lock(activity_mutex_);
+  if (env == nullptr || activity_ == nullptr || on_progress_ == nullptr) {
+    return;
+  }
+  // The activity hands the progress to the UI thread and returns.
+  env->CallVoidMethod(activity_, on_progress_, progress);
+}
+
+void AdfSaver::ReportSaved(JNIEnv* env, int job_id, const std::string& uuid) {
+  std::lock_guard<std::mutex> lock(activity_mutex_);
+  if (env == nullptr || activity_ == nullptr || on_saved_ == nullptr) {
+    LOGE("AdfSaver: Cannot report the save of job %d to the activity.",
+         job_id);
+    return;
+  }
+  // The thread never returns to Java, its local references must be deleted.
+  jstring uuid_string = env->NewStringUTF(uuid.c_str());
+  env->CallVoidMethod(activity_, on_saved_, job_id, uuid_string);
+  env->DeleteLocalRef(uuid_string);
+}
+
+}  // namespace hello_area_description
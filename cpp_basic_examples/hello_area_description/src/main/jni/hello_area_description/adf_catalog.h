@@ -0,0 +1,131 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HELLO_AREA_DESCRIPTION_ADF_CATALOG_H_
+#define HELLO_AREA_DESCRIPTION_ADF_CATALOG_H_
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace hello_area_description {
+
+// AdfCatalog keeps the UUID, name and creation date of the ADFs of the
+// device in memory, and in an index file so a new process does not ask the
+// service for them again:
+//
+//   catalog_.SetIndexPath(files_dir + "/adf_index");
+//   ...
+//   AdfCatalog::Entry latest;
+//   if (catalog_.GetLatest(&latest)) {
+//     // Load latest.uuid.
+//   }
+//
+// The first query reads the index file, or lists the ADFs and reads the
+// metadata of every one from the service if there is no valid index yet.
+// Preload() reads the index ahead, before the service is bound. The
+// catalog is then only updated by the saves, deletes and renames of this app,
+// through the On*() methods. ADFs imported, exported or changed by other apps
+// are only seen after Sync(), which lists the UUIDs again and reads the
+// metadata of the new ones only.
+//
+// All methods are thread safe, the ADF save thread updates the catalog too.
+class AdfCatalog {
+ public:
+  struct Entry {
+    std::string uuid;
+    std::string name;
+    // Creation date of the ADF, 0 if unknown.
+    uint64_t date_ms_since_epoch;
+  };
+
+  AdfCatalog();
+  AdfCatalog(const AdfCatalog& other) = delete;
+  AdfCatalog& operator=(const AdfCatalog&) = delete;
+
+  // Set the index file, read on the next query. Without one the catalog is
+  // built from the service once per process.
+  void SetIndexPath(const std::string& path);
+
+  // @return the entries, in the order of the service list, the latest last.
+  std::vector<Entry> GetEntries();
+
+  // @param entry: filled with the latest ADF, if any.
+  //
+  // @return false if there is no ADF.
+  bool GetLatest(Entry* entry);
+
+  // @param entry: filled with the ADF last used, see SetLastUsed(), or the
+  //        latest if it is gone or none was used yet.
+  //
+  // @return false if there is no ADF.
+  bool GetPreferred(Entry* entry);
+
+  // Record ADF |uuid| as the one to load next, when the device relocalized
+  // to it. The ADFs saved are recorded too.
+  void SetLastUsed(const std::string& uuid);
+
+  // Read the index file now if the catalog is not loaded yet, without ever
+  // calling the service. Safe to call before the service is bound.
+  //
+  // @return true if the catalog is loaded.
+  bool Preload();
+
+  // @param name: filled with the name of ADF |uuid|, if in the catalog.
+  //
+  // @return false if ADF |uuid| is not in the catalog.
+  bool GetName(const std::string& uuid, std::string* name);
+
+  // Add ADF |uuid|, just saved, reading its metadata from the service.
+  void OnAdfSaved(const std::string& uuid);
+
+  void OnAdfDeleted(const std::string& uuid);
+
+  void OnAdfRenamed(const std::string& uuid, const std::string& name);
+
+  // Bring the catalog up to date with the service list.
+  void Sync();
+
+ private:
+  // Read the index file the first time, building the catalog if it is
+  // missing or invalid. Called under mutex_.
+  void LoadLocked();
+  // Called under mutex_.
+  //
+  // @return false if the service could not list the ADFs.
+  bool SyncLocked();
+  bool ReadIndex();
+  void WriteIndex() const;
+
+  // @return the index of ADF |uuid| in entries_, -1 if none.
+  int FindLocked(const std::string& uuid) const;
+
+  // Fill the name and date of |entry| from the service.
+  //
+  // @return false if the metadata could not be read.
+  static bool ReadMetadata(Entry* entry);
+
+  std::mutex mutex_;
+  std::string index_path_;
+  bool is_loaded_;
+  std::vector<Entry> entries_;
+  // Empty if none.
+  std::string last_used_uuid_;
+};
+}  // namespace hello_area_description
+
+#endif  // HELLO_AREA_DESCRIPTION_ADF_CATALOG_H_
@@ -0,0 +1,116 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HELLO_AREA_DESCRIPTION_ADF_SAVER_H_
+#define HELLO_AREA_DESCRIPTION_ADF_SAVER_H_
+
+#include <jni.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace hello_area_description {
+
+// AdfSaver runs the saves of area descriptions off the caller's thread, one
+// at a time, and reports them to the Java activity:
+//
+//   const int job_id = adf_saver_.Start([this] { return SaveAdf(); });
+//   ...
+//   // Service callback thread, on "AreaDescriptionSaveProgress" events.
+//   adf_saver_.OnSaveProgress(fraction);
+//
+// TangoService_saveAreaDescription() blocks for seconds on large ADFs while
+// the service reports the progress from its own thread. The save runs on a
+// thread of its own, and a reporter thread, attached to the JVM once, makes
+// every call into Java: updateSavingAdfProgress(int progress) at most every
+// kProgressInterval, and onAdfSaved(int jobId, String uuid) once the save is
+// done, with an empty UUID if it failed.
+class AdfSaver {
+ public:
+  // The save of a job, returning the UUID of the ADF, empty on failure.
+  typedef std::function<std::string()> SaveFunction;
+
+  // Shortest time between two progress reports.
+  static const std::chrono::milliseconds kProgressInterval;
+
+  AdfSaver();
+  ~AdfSaver();
+  AdfSaver(const AdfSaver& other) = delete;
+  AdfSaver& operator=(const AdfSaver&) = delete;
+
+  void SetJavaVM(JavaVM* java_vm) { java_vm_ = java_vm; }
+
+  // Set the activity the jobs are reported to, nullptr to stop reporting.
+  //
+  // @param activity: global reference to the activity, which the caller keeps
+  //        until the next call.
+  // @param on_progress: updateSavingAdfProgress(int) of the activity.
+  // @param on_saved: onAdfSaved(int, String) of the activity.
+  void SetActivity(jobject activity, jmethodID on_progress,
+                   jmethodID on_saved);
+
+  // Start saving with |save| on the save thread.
+  //
+  // @return the ID of the job, or 0 if a save is already running.
+  int Start(const SaveFunction& save);
+
+  // Record the progress of the running save, between 0 and 1. Called from
+  // the service callback thread, never calls into Java.
+  void OnSaveProgress(double fraction);
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+
+  void RunSaves();
+  void RunReports();
+
+  // Call into the activity, if any.
+  void ReportProgress(JNIEnv* env, int progress);
+  void ReportSaved(JNIEnv* env, int job_id, const std::string& uuid);
+
+  JavaVM* java_vm_;
+
+  std::mutex activity_mutex_;
+  jobject activity_;
+  jmethodID on_progress_;
+  jmethodID on_saved_;
+
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  bool is_stopping_;
+  int next_job_id_;
+  // The job waiting for the save thread, and the one it runs, 0 if none.
+  int pending_job_id_;
+  SaveFunction pending_save_;
+  int running_job_id_;
+  // Progress of the running job in percent, and the last one reported.
+  int progress_;
+  int reported_progress_;
+  Clock::time_point report_time_;
+  // The job finished and not reported yet, 0 if none.
+  int saved_job_id_;
+  std::string saved_uuid_;
+
+  std::thread save_thread_;
+  std::thread report_thread_;
+};
+}  // namespace hello_area_description
+
+#endif  // HELLO_AREA_DESCRIPTION_ADF_SAVER_H_
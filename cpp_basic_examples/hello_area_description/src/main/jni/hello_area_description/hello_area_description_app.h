@@ -18,8 +18,10 @@
 #define HELLO_AREA_DESCRIPTION_HELLO_AREA_DESCRIPTION_APP_H_
 
 #include <jni.h>
+#include <chrono>
 #include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 #include <android/log.h>
 
@@ -29,7 +31,11 @@
   __android_log_print(ANDROID_LOG_ERROR, "hello_area_description", __VA_ARGS__)
 
 #include <tango_client_api.h>  // NOLINT
+#include <tango-util/latest.h>
+#include <tango-util/pose_bus.h>
 
+#include <hello_area_description/adf_catalog.h>
+#include <hello_area_description/adf_saver.h>
 #include <hello_area_description/pose_data.h>
 
 namespace hello_area_description {
@@ -60,10 +66,17 @@ class AreaLearningApp {
   // we'd like auto-recover enabled.
   //
   // @param is_area_learning_enabled: enable/disable the area learning mode.
-  // @param is_loading_adf: load the most recent Adf.
+  // @param is_loading_adf: load the Adf last relocalized to or saved, the most
+  //        recent one if it is gone.
   int TangoSetupConfig(bool is_area_learning_enabled, bool is_loading_adf);
 
-  // Connect the onPoseAvailable callback.
+  // Select the Adf TangoSetupConfig() will load on a background thread,
+  // reading the Adf catalog from its index file without the service, so the
+  // setup does not wait for it. Call as early as possible, before the service
+  // is bound.
+  void PrefetchAdf();
+
+  // Connect the onPoseAvailable and onTangoEvent callbacks.
   int TangoConnectCallbacks();
 
   // Connect to Tango Service.
@@ -80,6 +93,16 @@ class AreaLearningApp {
   // @return: UUID of the saved ADF.
   std::string SaveAdf();
 
+  // Save current ADF on a thread of its own and name it, the activity being
+  // called back with updateSavingAdfProgress() and onAdfSaved(), see
+  // AdfSaver.
+  //
+  // @param name: value of the "name" metadata of the ADF.
+  //
+  // @return: ID of the save passed to onAdfSaved(), 0 if a save is already
+  //          running.
+  int StartSaveAdf(const std::string& name);
+
   // Get specifc meta value of an exsiting ADF.
   //
   // @param uuid: the UUID of the targeting ADF.
@@ -97,11 +120,23 @@ class AreaLearningApp {
   void SetAdfMetadataValue(const std::string& uuid, const std::string& key,
                            const std::string& value);
 
-  // Get all ADF's UUIDs list in one string, saperated by comma.
+  // Get all ADF's UUIDs list in one string, saperated by comma, from the ADF
+  // catalog.
   //
   // @return: all ADF's UUIDs.
   std::string GetAllAdfUuids();
 
+  // Set the file the ADF catalog is kept in between runs.
+  //
+  // @param path: path of the index file, in the app's private files.
+  void SetAdfIndexPath(const std::string& path) {
+    adf_catalog_.SetIndexPath(path);
+  }
+
+  // Update the ADF catalog with the ADFs added or removed outside of this
+  // app, after an import or export for example.
+  void SyncAdfCatalog() { adf_catalog_.Sync(); }
+
   // Delete a specific ADF.
   //
   // @param uuid: target ADF's uuid.
@@ -113,25 +148,33 @@ class AreaLearningApp {
   // @param pose: The current pose returned by the service, caller allocated.
   void onPoseAvailable(const TangoPoseData* pose);
 
+  // Tango service event callback function, forwarding the progress of the
+  // ADF saves.
+  //
+  // @param event: The event returned by the service, caller allocated.
+  void onTangoEventAvailable(const TangoEvent* event);
+
   // Reset pose data and release resources that allocate from the program.
   void DeleteResources();
 
   // Return true if Tango has relocalized to the current ADF at least once.
   bool IsRelocalized();
 
+  // Return the seconds from TangoConnect() to the first valid pose of the
+  // area description frame, the time to localize, or a negative value if not
+  // relocalized yet.
+  double GetTimeToLocalize();
+
   // Return loaded ADF's UUID.
   std::string GetLoadedAdfString() { return loaded_adf_string_; }
 
   // Cache the Java VM
   //
   // @JavaVM java_vm: the Java VM is using from the Java layer.
-  void SetJavaVM(JavaVM* java_vm) { java_vm_ = java_vm; }
-
-  // Callback function when the Adf saving progress.
-  //
-  // @JavaVM progress: current progress value, the value is between 1 to 100,
-  //                   inclusive.
-  void OnAdfSavingProgressChanged(int progress);
+  void SetJavaVM(JavaVM* java_vm) {
+    java_vm_ = java_vm;
+    adf_saver_.SetJavaVM(java_vm);
+  }
 
  private:
   // Get the Tango Service version.
@@ -139,18 +182,30 @@ class AreaLearningApp {
   // @return: Tango Service's version.
   std::string GetTangoServiceVersion();
 
-  // Get the vector list of all ADF stored in the Tango space.
+  // Get the vector list of all ADF stored in the Tango space, from the ADF
+  // catalog.
   //
   // @adf_list: ADF UUID list to be filled in.
   void GetAdfUuids(std::vector<std::string>* adf_list);
 
-  // pose_data_ handles all pose onPoseAvailable callbacks, onPoseAvailable()
-  // in this object will be routed to pose_data_ to handle.
+  // What IsRelocalized() and GetTimeToLocalize() return, published by the
+  // TangoService callback thread.
+  struct LocalizationState {
+    bool is_relocalized;
+    double time_to_localize;
+  };
+
+  // Gathers the poses of the onPoseAvailable callbacks into a snapshot per
+  // tick of the service.
+  tango_util::PoseBus pose_bus_;
+
+  // pose_data_ handles the poses of each tick of pose_bus_. Only touched on
+  // the callback thread while connected.
   PoseData pose_data_;
 
-  // Mutex for protecting the pose data. The pose data is shared between render
-  // thread and TangoService callback thread.
-  std::mutex pose_mutex_;
+  // The localization state of pose_data_, read by the Java threads without
+  // a lock.
+  tango_util::Latest<LocalizationState> localization_;
 
   // Tango configration file, this object is for configuring Tango Service setup
   // before connect to service. For example, we set the flag
@@ -162,12 +217,30 @@ class AreaLearningApp {
 
   // Current loaded ADF.
   std::string loaded_adf_string_;
+  // UUID of the loaded ADF, empty if none.
+  std::string loaded_adf_uuid_;
+
+  // When TangoConnect() was called, and the time to localize in seconds,
+  // negative until relocalized. Only touched on the callback thread while
+  // connected, as pose_data_.
+  std::chrono::steady_clock::time_point connect_time_;
+  double time_to_localize_;
 
   // Cached Java VM, caller activity object and the request render method. These
   // variables are used for get the saving Adf progress bar update.
   JavaVM* java_vm_;
   jobject calling_activity_obj_;
   jmethodID on_saving_adf_progress_updated_;
+  jmethodID on_adf_saved_;
+
+  // The ADFs of the device, updated on the saves, deletes and renames.
+  AdfCatalog adf_catalog_;
+  // The thread of PrefetchAdf(), joined by TangoSetupConfig().
+  std::thread prefetch_thread_;
+
+  // Runs the saves of StartSaveAdf(). Declared last so its threads are joined
+  // before the rest of the app is destroyed.
+  AdfSaver adf_saver_;
 };
 }  // namespace hello_area_description
 
@@ -14,8 +14,11 @@
  * limitations under the License.
  */
 
+#include <cstdlib>
+#include <cstring>
 #include <sstream>
 
+#include <tango-gl/tracing.h>
 #include <tango_support_api.h>
 
 #include "hello_area_description/hello_area_description_app.h"
@@ -23,6 +26,10 @@
 namespace {
 const int kVersionStringLength = 128;
 
+// Key of the events reporting the progress of an ADF save, with the fraction
+// saved as value.
+const char kAdfSaveProgressEventKey[] = "AreaDescriptionSaveProgress";
+
 // This function routes onPoseAvailable callbacks to the application object for
 // handling.
 //
@@ -34,21 +41,89 @@ void onPoseAvailableRouter(void* context, const TangoPoseData* pose) {
       static_cast<hello_area_description::AreaLearningApp*>(context);
   app->onPoseAvailable(pose);
 }
+
+// This function routes onTangoEvent callbacks to the application object for
+// handling.
+//
+// @param context, context will be a pointer to a AreaLearningApp
+//        instance on which to call callbacks.
+// @param event, TangoEvent to route to onTangoEventAvailable function.
+void onTangoEventAvailableRouter(void* context, const TangoEvent* event) {
+  hello_area_description::AreaLearningApp* app =
+      static_cast<hello_area_description::AreaLearningApp*>(context);
+  app->onTangoEventAvailable(event);
+}
+
+// The frame pairs of the onPoseAvailable callback.
+const TangoCoordinateFramePair kFramePairs[] = {
+    {TANGO_COORDINATE_FRAME_START_OF_SERVICE, TANGO_COORDINATE_FRAME_DEVICE},
+    {TANGO_COORDINATE_FRAME_AREA_DESCRIPTION, TANGO_COORDINATE_FRAME_DEVICE},
+    {TANGO_COORDINATE_FRAME_AREA_DESCRIPTION,
+     TANGO_COORDINATE_FRAME_START_OF_SERVICE}};
 }  // namespace
 
 namespace hello_area_description {
 void AreaLearningApp::onPoseAvailable(const TangoPoseData* pose) {
-  std::lock_guard<std::mutex> lock(pose_mutex_);
-  pose_data_.UpdatePose(*pose);
+  TANGO_TRACE_SCOPE("AreaLearningApp::onPoseAvailable");
+  // The poses of the pairs are handled once per tick of the service, when
+  // the bus has them all.
+  if (!pose_bus_.OnPoseAvailable(pose)) {
+    return;
+  }
+  const tango_util::PoseBus::Snapshot snapshot = pose_bus_.GetSnapshot();
+  // Only the callback thread touches the pose data while connected, the other
+  // threads read the localization state it publishes.
+  const bool was_relocalized = pose_data_.IsRelocalized();
+  for (int i = 0; i < pose_bus_.GetFramePairCount(); ++i) {
+    if (snapshot.pose_ticks[i] == snapshot.tick) {
+      pose_data_.UpdatePose(snapshot.poses[i]);
+    }
+  }
+  const bool is_relocalized = pose_data_.IsRelocalized();
+  if (is_relocalized == was_relocalized) {
+    return;
+  }
+  const bool is_first_relocalization =
+      is_relocalized && time_to_localize_ < 0.0;
+  if (is_first_relocalization) {
+    time_to_localize_ = std::chrono::duration<double>(
+                            std::chrono::steady_clock::now() - connect_time_)
+                            .count();
+  }
+  localization_.Write({is_relocalized, time_to_localize_});
+  if (!is_first_relocalization) {
+    return;
+  }
+  LOGI("AreaLearningApp: Relocalized %.2f s after connecting.",
+       time_to_localize_);
+  if (!loaded_adf_uuid_.empty()) {
+    adf_catalog_.SetLastUsed(loaded_adf_uuid_);
+  }
+}
+
+void AreaLearningApp::onTangoEventAvailable(const TangoEvent* event) {
+  if (event->type == TANGO_EVENT_AREA_LEARNING &&
+      strcmp(event->event_key, kAdfSaveProgressEventKey) == 0) {
+    adf_saver_.OnSaveProgress(atof(event->event_value));
+  }
 }
 
 AreaLearningApp::AreaLearningApp()
-    : tango_core_version_string_("N/A"),
+    : pose_bus_(kFramePairs, sizeof(kFramePairs) / sizeof(kFramePairs[0])),
+      localization_(LocalizationState{false, -1.0}),
+      tango_core_version_string_("N/A"),
       loaded_adf_string_("Loaded ADF: N/A"),
+      time_to_localize_(-1.0),
       calling_activity_obj_(nullptr),
-      on_saving_adf_progress_updated_(nullptr) {}
+      on_saving_adf_progress_updated_(nullptr),
+      on_adf_saved_(nullptr) {}
 
-AreaLearningApp::~AreaLearningApp() { TangoConfig_free(tango_config_); }
+AreaLearningApp::~AreaLearningApp() {
+  if (prefetch_thread_.joinable()) {
+    prefetch_thread_.join();
+  }
+  TangoConfig_free(tango_config_);
+}
 
 bool AreaLearningApp::Initialize(JNIEnv* env, jobject activity,
                                  int min_tango_version) {
@@ -63,8 +138,11 @@ bool AreaLearningApp::Initialize(JNIEnv* env, jobject activity,
   jclass cls = env->GetObjectClass(activity);
   on_saving_adf_progress_updated_ =
       env->GetMethodID(cls, "updateSavingAdfProgress", "(I)V");
+  on_adf_saved_ = env->GetMethodID(cls, "onAdfSaved", "(ILjava/lang/String;)V");
 
   calling_activity_obj_ = env->NewGlobalRef(activity);
+  adf_saver_.SetActivity(calling_activity_obj_, on_saving_adf_progress_updated_,
+                         on_adf_saved_);
   return true;
 }
 
@@ -81,11 +159,15 @@ bool AreaLearningApp::OnTangoServiceConnected(JNIEnv* env, jobject binder) {
 }
 
 void AreaLearningApp::ActivityDestroyed() {
+  // Stop the reports before the reference they use goes away.
+  adf_saver_.SetActivity(nullptr, nullptr, nullptr);
+
   JNIEnv* env;
   java_vm_->GetEnv(reinterpret_cast<void**>(&env), JNI_VERSION_1_6);
   env->DeleteGlobalRef(calling_activity_obj_);
   calling_activity_obj_ = nullptr;
   on_saving_adf_progress_updated_ = nullptr;
+  on_adf_saved_ = nullptr;
 }
 
 int AreaLearningApp::TangoSetupConfig(bool is_area_learning_enabled,
@@ -109,39 +191,46 @@ int AreaLearningApp::TangoSetupConfig(bool is_area_learning_enabled,
     return ret;
   }
 
-  // If load ADF, load the most recent saved ADF.
-  if (is_loading_adf) {
-    std::vector<std::string> adf_list;
-    GetAdfUuids(&adf_list);
-    if (!adf_list.empty()) {
-      std::string adf_uuid = adf_list.back();
-      std::ostringstream adf_str_stream;
-      adf_str_stream << "Number of ADFs:" << adf_list.size()
-                     << ", Loaded ADF: " << adf_uuid;
-      loaded_adf_string_ = adf_str_stream.str();
-      ret = TangoConfig_setString(
-          tango_config_, "config_load_area_description_UUID", adf_uuid.c_str());
-      if (ret != TANGO_SUCCESS) {
-        LOGE("AreaLearningApp: get ADF UUID failed with error code: %d", ret);
-      }
+  // If load ADF, load the ADF last used, selected ahead by PrefetchAdf().
+  loaded_adf_uuid_.clear();
+  if (prefetch_thread_.joinable()) {
+    prefetch_thread_.join();
+  }
+  AdfCatalog::Entry adf;
+  if (is_loading_adf && adf_catalog_.GetPreferred(&adf)) {
+    std::ostringstream adf_str_stream;
+    adf_str_stream << "Number of ADFs:" << adf_catalog_.GetEntries().size()
+                   << ", Loaded ADF: " << adf.uuid;
+    loaded_adf_string_ = adf_str_stream.str();
+    loaded_adf_uuid_ = adf.uuid;
+    ret = TangoConfig_setString(
+        tango_config_, "config_load_area_description_UUID", adf.uuid.c_str());
+    if (ret != TANGO_SUCCESS) {
+      LOGE("AreaLearningApp: get ADF UUID failed with error code: %d", ret);
     }
   }
 
   return ret;
 }
 
+void AreaLearningApp::PrefetchAdf() {
+  if (prefetch_thread_.joinable()) {
+    return;
+  }
+  prefetch_thread_ = std::thread([this]() {
+    TANGO_TRACE_SCOPE("AreaLearningApp::PrefetchAdf");
+    if (!adf_catalog_.Preload()) {
+      LOGI("AreaLearningApp: No ADF index yet, the ADFs are listed on setup.");
+    }
+  });
+}
+
 int AreaLearningApp::TangoConnectCallbacks() {
-  // Setting up the frame pair for the onPoseAvailable callback.
-  TangoCoordinateFramePair pairs[3] = {
-      {TANGO_COORDINATE_FRAME_START_OF_SERVICE, TANGO_COORDINATE_FRAME_DEVICE},
-      {TANGO_COORDINATE_FRAME_AREA_DESCRIPTION, TANGO_COORDINATE_FRAME_DEVICE},
-      {TANGO_COORDINATE_FRAME_AREA_DESCRIPTION,
-       TANGO_COORDINATE_FRAME_START_OF_SERVICE}};
-
-  // Attach onPoseAvailable callback.
+  // Attach onPoseAvailable callback, for the frame pairs of the pose bus.
   // The callback will be called after the service is connected.
-  int ret =
-      TangoService_connectOnPoseAvailable(3, pairs, onPoseAvailableRouter);
+  int ret = TangoService_connectOnPoseAvailable(pose_bus_.GetFramePairCount(),
+                                                pose_bus_.GetFramePairs(),
+                                                onPoseAvailableRouter);
   if (ret != TANGO_SUCCESS) {
     LOGE(
         "AreaLearningApp: Failed to connect to pose callback with error"
@@ -149,12 +238,26 @@ int AreaLearningApp::TangoConnectCallbacks() {
         ret);
     return ret;
   }
+
+  // Attach onTangoEvent callback, for the progress of the ADF saves.
+  ret = TangoService_connectOnTangoEvent(onTangoEventAvailableRouter);
+  if (ret != TANGO_SUCCESS) {
+    LOGE(
+        "AreaLearningApp: Failed to connect to event callback with error"
+        "code: %d",
+        ret);
+  }
   return ret;
 }
 
 // Connect to Tango Service, service will start running, and
 // pose can be queried.
 bool AreaLearningApp::TangoConnect() {
+  // The service loads the ADF during the connect, the time to localize
+  // includes it. The callbacks are not running yet.
+  connect_time_ = std::chrono::steady_clock::now();
+  time_to_localize_ = -1.0;
+  localization_.Write({pose_data_.IsRelocalized(), time_to_localize_});
   TangoErrorType ret = TangoService_connect(this, tango_config_);
   bool is_connected = (ret == TANGO_SUCCESS);
   if (!is_connected) {
@@ -179,7 +282,8 @@ void AreaLearningApp::TangoDisconnect() {
 
 std::string AreaLearningApp::SaveAdf() {
   std::string adf_uuid_string;
-  if (!pose_data_.IsRelocalized()) {
+  // Also called from the save thread, reads the published state.
+  if (!IsRelocalized()) {
     return adf_uuid_string;
   }
   TangoUUID uuid;
@@ -195,8 +299,25 @@ std::string AreaLearningApp::SaveAdf() {
   return adf_uuid_string;
 }
 
+int AreaLearningApp::StartSaveAdf(const std::string& name) {
+  return adf_saver_.Start([this, name]() {
+    const std::string uuid = SaveAdf();
+    if (!uuid.empty()) {
+      SetAdfMetadataValue(uuid, "name", name);
+      adf_catalog_.OnAdfSaved(uuid);
+    }
+    return uuid;
+  });
+}
+
 std::string AreaLearningApp::GetAdfMetadataValue(const std::string& uuid,
                                                  const std::string& key) {
+  // The names are in the catalog, which the ADF list asks for every one.
+  std::string name;
+  if (key == "name" && adf_catalog_.GetName(uuid, &name)) {
+    return name;
+  }
+
   size_t size = 0;
   char* output;
   TangoAreaDescriptionMetadata metadata;
@@ -238,75 +359,50 @@ void AreaLearningApp::SetAdfMetadataValue(const std::string& uuid,
   if (ret != TANGO_SUCCESS) {
     LOGE("AreaLearningApp: Failed to save ADF metadata with error code: %d",
          ret);
+  } else if (key == "name") {
+    adf_catalog_.OnAdfRenamed(uuid, value);
   }
 }
 
 std::string AreaLearningApp::GetAllAdfUuids() {
-  TangoConfig tango_config_ = TangoService_getConfig(TANGO_CONFIG_DEFAULT);
-  if (tango_config_ == nullptr) {
-    LOGE("AreaLearningApp: Failed to get default config form");
+  std::string uuid_list;
+  for (const AdfCatalog::Entry& entry : adf_catalog_.GetEntries()) {
+    if (!uuid_list.empty()) {
+      uuid_list += ',';
+    }
+    uuid_list += entry.uuid;
   }
+  return uuid_list;
+}
 
-  // Get all ADF's uuids.
-  char* uuid_list = nullptr;
-  int ret = TangoService_getAreaDescriptionUUIDList(&uuid_list);
-  // uuid_list will contain a comma separated list of UUIDs.
+void AreaLearningApp::DeleteAdf(std::string uuid) {
+  int ret = TangoService_deleteAreaDescription(uuid.c_str());
   if (ret != TANGO_SUCCESS) {
-    LOGE("AreaLearningApp: get ADF UUID failed with error code: %d", ret);
+    LOGE("AreaLearningApp: Failed to delete ADF with error code: %d", ret);
+    return;
   }
-  return std::string(uuid_list);
+  adf_catalog_.OnAdfDeleted(uuid);
 }
 
-void AreaLearningApp::DeleteAdf(std::string uuid) {
-  TangoService_deleteAreaDescription(uuid.c_str());
+void AreaLearningApp::DeleteResources() {
+  // Called once disconnected, when the callbacks stopped.
+  pose_bus_.Reset();
+  pose_data_.ResetPoseData();
+  localization_.Write({false, time_to_localize_});
 }
 
-void AreaLearningApp::DeleteResources() { pose_data_.ResetPoseData(); }
-
 bool AreaLearningApp::IsRelocalized() {
-  std::lock_guard<std::mutex> lock(pose_mutex_);
-  return pose_data_.IsRelocalized();
+  return localization_.Read().is_relocalized;
 }
 
-void AreaLearningApp::GetAdfUuids(std::vector<std::string>* adf_list) {
-  // Get all ADF's uuids.
-  char* uuid_list = nullptr;
-  int ret = TangoService_getAreaDescriptionUUIDList(&uuid_list);
-  // uuid_list will contain a comma separated list of UUIDs.
-  if (ret != TANGO_SUCCESS) {
-    LOGE("AreaLearningApp: get ADF UUID failed with error code: %d", ret);
-  }
-
-  // Parse the uuid_list to get the individual uuids.
-  if (uuid_list != nullptr) {
-    if (uuid_list[0] != '\0') {
-      char* parsing_char;
-      char* saved_ptr;
-      parsing_char = strtok_r(uuid_list, ",", &saved_ptr);
-      while (parsing_char != nullptr) {
-        std::string str = std::string(parsing_char);
-        adf_list->push_back(str);
-        parsing_char = strtok_r(nullptr, ",", &saved_ptr);
-      }
-    }
-  }
+double AreaLearningApp::GetTimeToLocalize() {
+  return localization_.Read().time_to_localize;
 }
 
-void AreaLearningApp::OnAdfSavingProgressChanged(int progress) {
-  // Here, we notify the Java activity that we'd like it to update the saving
-  // Adf progress.
-  if (calling_activity_obj_ == nullptr ||
-      on_saving_adf_progress_updated_ == nullptr) {
-    LOGE(
-        "AreaLearningApp: Cannot reference activity on ADF saving progress"
-        "changed.");
-    return;
+void AreaLearningApp::GetAdfUuids(std::vector<std::string>* adf_list) {
+  for (const AdfCatalog::Entry& entry : adf_catalog_.GetEntries()) {
+    adf_list->push_back(entry.uuid);
   }
-
-  JNIEnv* env;
-  java_vm_->GetEnv(reinterpret_cast<void**>(&env), JNI_VERSION_1_6);
-  env->CallVoidMethod(calling_activity_obj_, on_saving_adf_progress_updated_,
-                      progress);
 }
 
 }  // namespace hello_area_description
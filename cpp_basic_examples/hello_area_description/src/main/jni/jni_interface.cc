@@ -17,6 +17,7 @@
 #define GLM_FORCE_RADIANS
 
 #include <jni.h>
+#include <tango-gl/tracing.h>
 #include <hello_area_description/hello_area_description_app.h>
 
 static hello_area_description::AreaLearningApp app;
@@ -98,6 +99,15 @@ Java_com_projecttango_examples_cpp_helloareadescription_TangoJniNative_saveAdf(
   return (env)->NewStringUTF(app.SaveAdf().c_str());
 }
 
+JNIEXPORT jint JNICALL
+Java_com_projecttango_examples_cpp_helloareadescription_TangoJniNative_saveAdfAsync(
+    JNIEnv* env, jobject, jstring name) {
+  const char* name_chars = env->GetStringUTFChars(name, nullptr);
+  std::string name_str(name_chars);
+  env->ReleaseStringUTFChars(name, name_chars);
+  return app.StartSaveAdf(name_str);
+}
+
 JNIEXPORT jstring JNICALL
 Java_com_projecttango_examples_cpp_helloareadescription_TangoJniNative_getAdfMetadataValue(
     JNIEnv* env, jobject, jstring uuid, jstring key) {
@@ -121,6 +131,33 @@ Java_com_projecttango_examples_cpp_helloareadescription_TangoJniNative_getAllAdf
   return env->NewStringUTF(app.GetAllAdfUuids().c_str());
 }
 
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_helloareadescription_TangoJniNative_prefetchAdf(
+    JNIEnv*, jobject) {
+  app.PrefetchAdf();
+}
+
+JNIEXPORT jdouble JNICALL
+Java_com_projecttango_examples_cpp_helloareadescription_TangoJniNative_getTimeToLocalize(
+    JNIEnv*, jobject) {
+  return app.GetTimeToLocalize();
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_helloareadescription_TangoJniNative_setAdfIndexPath(
+    JNIEnv* env, jobject, jstring path) {
+  const char* path_chars = env->GetStringUTFChars(path, nullptr);
+  std::string path_str(path_chars);
+  env->ReleaseStringUTFChars(path, path_chars);
+  app.SetAdfIndexPath(path_str);
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_helloareadescription_TangoJniNative_syncAdfCatalog(
+    JNIEnv*, jobject) {
+  app.SyncAdfCatalog();
+}
+
 JNIEXPORT void JNICALL
 Java_com_projecttango_examples_cpp_helloareadescription_TangoJniNative_deleteAdf(
     JNIEnv* env, jobject, jstring uuid) {
@@ -128,6 +165,27 @@ Java_com_projecttango_examples_cpp_helloareadescription_TangoJniNative_deleteAdf
   return app.DeleteAdf(uuid_str);
 }
 
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_helloareadescription_TangoJniNative_startTracing(
+    JNIEnv*, jobject) {
+  tango_gl::tracing::Start();
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_helloareadescription_TangoJniNative_stopTracing(
+    JNIEnv*, jobject) {
+  tango_gl::tracing::Stop();
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_projecttango_examples_cpp_helloareadescription_TangoJniNative_dumpTrace(
+    JNIEnv* env, jobject, jstring path) {
+  const char* path_chars = env->GetStringUTFChars(path, nullptr);
+  const bool dumped = tango_gl::tracing::DumpChromeTrace(path_chars);
+  env->ReleaseStringUTFChars(path, path_chars);
+  return dumped;
+}
+
 #ifdef __cplusplus
 }
 #endif
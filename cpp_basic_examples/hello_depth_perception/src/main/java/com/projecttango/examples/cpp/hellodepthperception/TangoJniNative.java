@@ -57,4 +57,22 @@ public class TangoJniNative {
      * Interfaces to native OnPause function.
      */
     public static native void onPause();
+
+    /**
+     * Start recording where the native code spends its time, see tango-gl/tracing.h.
+     */
+    public static native void startTracing();
+
+    /**
+     * Stop recording, the recorded time slices are kept for dumpTrace().
+     */
+    public static native void stopTracing();
+
+    /**
+     * Write the recorded time slices as a Chrome trace JSON file, e.g. under
+     * getExternalFilesDir(null) to pull it from the sdcard.
+     *
+     * @return false if the file could not be written.
+     */
+    public static native boolean dumpTrace(String path);
 }
@@ -14,11 +14,13 @@
 # limitations under the License.
 #
 LOCAL_PATH := $(call my-dir)
+PROJECT_ROOT_FROM_JNI:= ../../../../..
 PROJECT_ROOT:= $(call my-dir)/../../../../..
 
 include $(CLEAR_VARS)
 LOCAL_MODULE    := libhello_depth_perception
 LOCAL_SHARED_LIBRARIES := tango_client_api tango_support_api
+LOCAL_STATIC_LIBRARIES := tango_gl
 LOCAL_CFLAGS    := -std=c++11
 
 LOCAL_SRC_FILES := jni_interface.cc \
@@ -30,3 +32,4 @@ include $(BUILD_SHARED_LIBRARY)
 $(call import-add-path, $(PROJECT_ROOT))
 $(call import-module,tango_client_api)
 $(call import-module,tango_support_api)
+$(call import-module,tango_gl)
@@ -14,8 +14,12 @@
  * limitations under the License.
  */
 
+#include <cmath>
 #include <cstdlib>
 
+#include <tango-gl/log.h>
+#include <tango-gl/point_cloud_statistics.h>
+#include <tango-gl/tracing.h>
 #include <tango_support_api.h>
 
 #include "hello_depth_perception/hello_depth_perception_app.h"
@@ -31,27 +35,20 @@ constexpr int kTangoCoreMinimumVersion = 9377;
 //        since it is not used.
 // @param *point_cloud, XYZij data to log.
 void onPointCloudAvailable(void* /*context*/, const TangoXYZij* point_cloud) {
-  // Number of points in the point cloud.
-  int point_cloud_size;
-  float average_depth;
+  TANGO_TRACE_SCOPE("onPointCloudAvailable");
+  // Calculate the average depth and its spread in one pass over the points,
+  // read in place, so that the callback returns to the service quickly.
+  tango_gl::PointCloudStatistics statistics;
+  tango_gl::GetPointCloudStatistics(point_cloud->xyz[0],
+                                    point_cloud->xyz_count, &statistics);
 
-  // Calculate the average depth.
-  point_cloud_size = point_cloud->xyz_count;
-  average_depth = 0;
-  // Each xyz point has 3 coordinates.
-  size_t iteration_size = point_cloud_size * 3;
-  size_t vertices_count = 0;
-  for (size_t i = 2; i < iteration_size; i += 3) {
-    average_depth += point_cloud->xyz[0][i];
-    vertices_count++;
-  }
-  if (vertices_count) {
-    average_depth /= vertices_count;
-  }
-
-  // Log the number of points and average depth.
-  LOGI("HelloDepthPerceptionApp: Point count: %d. Average depth (m): %.3f",
-       point_cloud_size, average_depth);
+  // Log the number of points, average depth and its standard deviation, once
+  // a second rather than for each cloud.
+  TANGO_LOG_TAG_EVERY_N_SEC(
+      ANDROID_LOG_INFO, LOG_TAG, 1.0,
+      "HelloDepthPerceptionApp: Point count: %d. Average depth (m): %.3f "
+      "+- %.3f",
+      statistics.count, statistics.mean.z, sqrt(statistics.variance.z));
 }
 }  // anonymous namespace
 
@@ -15,6 +15,7 @@
  */
 
 #include <jni.h>
+#include <tango-gl/tracing.h>
 
 #include "hello_depth_perception/hello_depth_perception_app.h"
 
@@ -40,6 +41,28 @@ Java_com_projecttango_examples_cpp_hellodepthperception_TangoJniNative_onPause(
     JNIEnv*, jobject) {
   app.OnPause();
 }
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_hellodepthperception_TangoJniNative_startTracing(
+    JNIEnv*, jobject) {
+  tango_gl::tracing::Start();
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_hellodepthperception_TangoJniNative_stopTracing(
+    JNIEnv*, jobject) {
+  tango_gl::tracing::Stop();
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_projecttango_examples_cpp_hellodepthperception_TangoJniNative_dumpTrace(
+    JNIEnv* env, jobject, jstring path) {
+  const char* path_chars = env->GetStringUTFChars(path, nullptr);
+  const bool dumped = tango_gl::tracing::DumpChromeTrace(path_chars);
+  env->ReleaseStringUTFChars(path, path_chars);
+  return dumped;
+}
+
 #ifdef __cplusplus
 }
 #endif
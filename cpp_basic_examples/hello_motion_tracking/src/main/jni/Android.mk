@@ -14,19 +14,20 @@
 # limitations under the License.
 #
 LOCAL_PATH := $(call my-dir)
+PROJECT_ROOT_FROM_JNI:= ../../../../..
 PROJECT_ROOT:= $(call my-dir)/../../../../..
 
 include $(CLEAR_VARS)
 LOCAL_MODULE    := libhello_motion_tracking
 LOCAL_SHARED_LIBRARIES := tango_client_api tango_support_api
+LOCAL_STATIC_LIBRARIES := tango_gl
 LOCAL_CFLAGS    := -Werror -std=c++11
 LOCAL_SRC_FILES := tango_handler.cc \
                    jni_interface.cc
-LOCAL_C_INCLUDES := $(PROJECT_ROOT)/tango_gl/include \
-                    $(PROJECT_ROOT)/third_party/glm/
 LOCAL_LDLIBS    := -llog -lGLESv2 -L$(SYSROOT)/usr/lib
 include $(BUILD_SHARED_LIBRARY)
 
 $(call import-add-path, $(PROJECT_ROOT))
 $(call import-module,tango_client_api)
 $(call import-module,tango_support_api)
+$(call import-module,tango_gl)
@@ -15,6 +15,7 @@
  */
 
 #include <jni.h>
+#include <tango-gl/tracing.h>
 
 #include "hello_motion_tracking/tango_handler.h"
 
@@ -41,6 +42,27 @@ Java_com_projecttango_examples_cpp_hellomotiontracking_TangoJniNative_onPause(
   tango_handler.OnPause();
 }
 
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_hellomotiontracking_TangoJniNative_startTracing(
+    JNIEnv*, jobject) {
+  tango_gl::tracing::Start();
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_hellomotiontracking_TangoJniNative_stopTracing(
+    JNIEnv*, jobject) {
+  tango_gl::tracing::Stop();
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_projecttango_examples_cpp_hellomotiontracking_TangoJniNative_dumpTrace(
+    JNIEnv* env, jobject, jstring path) {
+  const char* path_chars = env->GetStringUTFChars(path, nullptr);
+  const bool dumped = tango_gl::tracing::DumpChromeTrace(path_chars);
+  env->ReleaseStringUTFChars(path, path_chars);
+  return dumped;
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -16,15 +16,22 @@
 
 #include <cstdlib>
 
+#include <tango-gl/log.h>
+#include <tango-gl/tracing.h>
+
 #include "hello_motion_tracking/tango_handler.h"
 
 namespace {
 constexpr int kTangoCoreMinimumVersion = 9377;
 void onPoseAvailable(void*, const TangoPoseData* pose) {
-  LOGI("Position: %f, %f, %f. Orientation: %f, %f, %f, %f",
-       pose->translation[0], pose->translation[1], pose->translation[2],
-       pose->orientation[0], pose->orientation[1], pose->orientation[2],
-       pose->orientation[3]);
+  TANGO_TRACE_SCOPE("onPoseAvailable");
+  // The poses arrive at 100 Hz or more, log one a second.
+  TANGO_LOG_TAG_EVERY_N_SEC(
+      ANDROID_LOG_INFO, LOG_TAG, 1.0,
+      "Position: %f, %f, %f. Orientation: %f, %f, %f, %f",
+      pose->translation[0], pose->translation[1], pose->translation[2],
+      pose->orientation[0], pose->orientation[1], pose->orientation[2],
+      pose->orientation[3]);
 }
 }  // anonymous namespace.
 
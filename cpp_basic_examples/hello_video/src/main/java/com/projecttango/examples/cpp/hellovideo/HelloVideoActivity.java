@@ -33,6 +33,7 @@ import com.projecttango.examples.cpp.util.TangoInitializationHelper;
 public class HelloVideoActivity extends Activity {
     private GLSurfaceView mSurfaceView;
     private ToggleButton mYuvRenderSwitcher;
+    private ToggleButton mYuvShaderSwitcher;
 
     private ServiceConnection mTangoServiceCoonnection = new ServiceConnection() {
         @Override
@@ -58,9 +59,13 @@ public class HelloVideoActivity extends Activity {
         // Configure OpenGL renderer
         mSurfaceView = (GLSurfaceView) findViewById(R.id.surfaceview);
         mSurfaceView.setEGLContextClientVersion(2);
+        // Keep the drawables over a pause, the native code checks whether the
+        // context survived.
+        mSurfaceView.setPreserveEGLContextOnPause(true);
         mSurfaceView.setRenderer(new HelloVideoRenderer());
 
         mYuvRenderSwitcher = (ToggleButton) findViewById(R.id.yuv_switcher);
+        mYuvShaderSwitcher = (ToggleButton) findViewById(R.id.yuv_shader_switcher);
     }
 
     @Override
@@ -68,7 +73,7 @@ public class HelloVideoActivity extends Activity {
         super.onResume();
         mSurfaceView.onResume();
         TangoInitializationHelper.bindTangoService(this, mTangoServiceCoonnection);
-        TangoJniNative.setYuvMethod(mYuvRenderSwitcher.isChecked());
+        updateTextureMethod();
     }
 
     @Override
@@ -83,6 +88,20 @@ public class HelloVideoActivity extends Activity {
      * The render mode toggle button was pressed.
      */
     public void renderModeClicked(View view) {
-        TangoJniNative.setYuvMethod(mYuvRenderSwitcher.isChecked());
+        updateTextureMethod();
+    }
+
+    /**
+     * Pass the texture method selected by the toggle buttons to the native code. The GPU
+     * toggle only applies to the YUV rendering method.
+     */
+    private void updateTextureMethod() {
+        if (!mYuvRenderSwitcher.isChecked()) {
+            TangoJniNative.setTextureMethod(TangoJniNative.TEXTURE_METHOD_TEXTURE_ID);
+        } else if (mYuvShaderSwitcher.isChecked()) {
+            TangoJniNative.setTextureMethod(TangoJniNative.TEXTURE_METHOD_YUV_SHADER);
+        } else {
+            TangoJniNative.setTextureMethod(TangoJniNative.TEXTURE_METHOD_YUV);
+        }
     }
 }
@@ -29,6 +29,22 @@ import com.projecttango.examples.cpp.util.TangoInitializationHelper;
  * responsible for the communication between the application and Tango Service.
  */
 public class TangoJniNative {
+    /**
+     * Render the camera image by converting the YUV buffer to RGB on the CPU.
+     */
+    public static final int TEXTURE_METHOD_YUV = 0;
+
+    /**
+     * Render the camera image through the texture connected to Tango Service.
+     */
+    public static final int TEXTURE_METHOD_TEXTURE_ID = 1;
+
+    /**
+     * Render the camera image by uploading the YUV planes and converting them
+     * to RGB in a fragment shader.
+     */
+    public static final int TEXTURE_METHOD_YUV_SHADER = 2;
+
     static {
         if (TangoInitializationHelper.loadTangoSharedLibrary() ==
                 TangoInitializationHelper.ARCH_ERROR) {
@@ -74,8 +90,31 @@ public class TangoJniNative {
     /**
      * Select the RGB camera texture rendering method.
      *
-     * @param useYuvMethod If {@code true}, YUV buffer rendering method will be used, otherwise
-     *                     the Texture ID rendering method will be used instead.
+     * @param method One of the {@code TEXTURE_METHOD_*} constants.
+     */
+    public static native void setTextureMethod(int method);
+
+    /**
+     * Get the number of camera frames that were dropped because the renderer did not consume
+     * them before a newer frame arrived.
+     */
+    public static native int getDroppedFrameCount();
+
+    /**
+     * Start recording where the native code spends its time, see tango-gl/tracing.h.
+     */
+    public static native void startTracing();
+
+    /**
+     * Stop recording, the recorded time slices are kept for dumpTrace().
+     */
+    public static native void stopTracing();
+
+    /**
+     * Write the recorded time slices as a Chrome trace JSON file, e.g. under
+     * getExternalFilesDir(null) to pull it from the sdcard.
+     *
+     * @return false if the file could not be written.
      */
-    public static native void setYuvMethod(boolean useYuvMethod);
+    public static native boolean dumpTrace(String path);
 }
@@ -21,23 +21,27 @@ include $(CLEAR_VARS)
 
 LOCAL_MODULE    := libhello_video
 LOCAL_SHARED_LIBRARIES := tango_client_api tango_support_api
+LOCAL_STATIC_LIBRARIES := tango_gl
 LOCAL_CFLAGS    := -std=c++11
 
 LOCAL_SRC_FILES := jni_interface.cc \
                    yuv_drawable.cc \
                    hello_video_app.cc \
-                   $(PROJECT_ROOT_FROM_JNI)/tango_gl/drawable_object.cc \
-                   $(PROJECT_ROOT_FROM_JNI)/tango_gl/shaders.cc \
-                   $(PROJECT_ROOT_FROM_JNI)/tango_gl/transform.cc \
-                   $(PROJECT_ROOT_FROM_JNI)/tango_gl/util.cc \
-                   $(PROJECT_ROOT_FROM_JNI)/tango_gl/video_overlay.cc
+                   yuv_converter.cc
 
-LOCAL_C_INCLUDES := $(PROJECT_ROOT)/tango_gl/include \
-                    $(PROJECT_ROOT)/third_party/glm
+LOCAL_LDLIBS    := -llog -lGLESv2 -lEGL -L$(SYSROOT)/usr/lib
 
-LOCAL_LDLIBS    := -llog -lGLESv2 -L$(SYSROOT)/usr/lib
+# Enable the SIMD YUV to RGB conversion kernels. The Android x86 ABI
+# guarantees SSSE3.
+ifeq ($(TARGET_ARCH_ABI),armeabi-v7a)
+LOCAL_ARM_NEON  := true
+endif
+ifeq ($(TARGET_ARCH_ABI),x86)
+LOCAL_CFLAGS    += -mssse3
+endif
 include $(BUILD_SHARED_LIBRARY)
 
 $(call import-add-path, $(PROJECT_ROOT))
 $(call import-module,tango_client_api)
 $(call import-module,tango_support_api)
+$(call import-module,tango_gl)
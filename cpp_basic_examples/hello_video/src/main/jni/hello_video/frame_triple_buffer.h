@@ -0,0 +1,117 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HELLO_VIDEO_FRAME_TRIPLE_BUFFER_H_
+#define HELLO_VIDEO_FRAME_TRIPLE_BUFFER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include <tango-gl/aligned_buffer.h>
+
+namespace hello_video {
+
+// FrameTripleBuffer hands image frames from a single producer thread (the
+// camera callback) to a single consumer thread (the GL thread) without locks.
+//
+// The producer owns one slot and the consumer another; the third slot holds
+// the most recently published frame. Publishing and acquiring are a single
+// atomic exchange of the shared slot index, so neither side ever waits on the
+// other and the consumer always gets the newest frame.
+class FrameTripleBuffer {
+ public:
+  FrameTripleBuffer()
+      : write_index_(0), read_index_(1), shared_state_(2), dropped_frames_(0) {}
+
+  // Allocate every slot with |size| bytes. This must not be called while
+  // either thread is using the buffer.
+  void Resize(size_t size) {
+    for (tango_gl::AlignedBuffer<uint8_t>& slot : slots_) {
+      slot.resize(size);
+    }
+  }
+
+  // Release the slot memory and reset the buffer to its initial state. This
+  // must not be called while either thread is using the buffer.
+  void Reset() {
+    for (tango_gl::AlignedBuffer<uint8_t>& slot : slots_) {
+      slot.clear();
+      slot.shrink_to_fit();
+    }
+    write_index_ = 0;
+    read_index_ = 1;
+    shared_state_ = 2;
+    dropped_frames_ = 0;
+  }
+
+  // Producer side: the slot the next frame should be written into.
+  uint8_t* GetWriteBuffer() { return slots_[write_index_].data(); }
+
+  // Producer side: publish the frame written into GetWriteBuffer(). If the
+  // previously published frame was never acquired, it is counted as dropped.
+  void Publish() {
+    const uint8_t previous = shared_state_.exchange(
+        static_cast<uint8_t>(write_index_ | kFreshBit),
+        std::memory_order_acq_rel);
+    write_index_ = previous & kIndexMask;
+    if (previous & kFreshBit) {
+      dropped_frames_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  // Consumer side: take ownership of the newest published frame. Returns
+  // false, and keeps the current read slot, if nothing was published since
+  // the last call.
+  bool AcquireLatest() {
+    if ((shared_state_.load(std::memory_order_relaxed) & kFreshBit) == 0) {
+      return false;
+    }
+    const uint8_t previous =
+        shared_state_.exchange(read_index_, std::memory_order_acq_rel);
+    read_index_ = previous & kIndexMask;
+    return true;
+  }
+
+  // Consumer side: the frame returned by the last successful AcquireLatest().
+  const uint8_t* GetReadBuffer() const { return slots_[read_index_].data(); }
+
+  // Number of published frames that were overwritten before the consumer
+  // acquired them.
+  uint32_t GetDroppedFrameCount() const {
+    return dropped_frames_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  static constexpr uint8_t kIndexMask = 0x3;
+  static constexpr uint8_t kFreshBit = 0x4;
+
+  // Aligned for the SIMD loads of the YUV to RGB conversion.
+  tango_gl::AlignedBuffer<uint8_t> slots_[3];
+
+  // Slot owned by the producer.
+  uint8_t write_index_;
+  // Slot owned by the consumer.
+  uint8_t read_index_;
+  // Index of the shared slot, with kFreshBit set when it holds a frame the
+  // consumer has not acquired yet.
+  std::atomic<uint8_t> shared_state_;
+  std::atomic<uint32_t> dropped_frames_;
+};
+
+}  // namespace hello_video
+
+#endif  // HELLO_VIDEO_FRAME_TRIPLE_BUFFER_H_
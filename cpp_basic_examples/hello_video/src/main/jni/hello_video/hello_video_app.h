@@ -20,11 +20,13 @@
 #include <atomic>
 #include <jni.h>
 #include <memory>
-#include <mutex>
-#include <vector>
 
 #include <tango_client_api.h>  // NOLINT
+#include <tango-gl/aligned_buffer.h>
+#include <tango-gl/gl_context_tracker.h>
+#include <tango-gl/memory_accounting.h>
 #include <tango-gl/util.h>
+#include <hello_video/frame_triple_buffer.h>
 #include <hello_video/yuv_drawable.h>
 #include <tango-gl/video_overlay.h>
 
@@ -33,9 +35,11 @@ namespace hello_video {
 // HelloVideoApp handles the application lifecycle and resources.
 class HelloVideoApp {
  public:
+  // The values match the TEXTURE_METHOD_* constants in TangoJniNative.java.
   enum TextureMethod {
     kYuv,
-    kTextureId
+    kTextureId,
+    kYuvShader
   };
 
   // OnCreate() callback is called when this Android application's
@@ -63,7 +67,8 @@ class HelloVideoApp {
   // Tango Service.
   void OnPause();
 
-  // Initializing the Scene.
+  // Initializing the Scene, unless the drawables of the previous surface
+  // survived with its context.
   void OnSurfaceCreated();
 
   // Setup the view port width and height.
@@ -80,6 +85,12 @@ class HelloVideoApp {
   // YUV data callback.
   void OnFrameAvailable(const TangoImageBuffer* buffer);
 
+  // Number of camera frames that were replaced by a newer one before the GL
+  // thread rendered them.
+  uint32_t GetDroppedFrameCount() const {
+    return yuv_frames_.GetDroppedFrameCount();
+  }
+
  private:
   // Tango configration file, this object is for configuring Tango Service setup
   // before connect to service. For example, we set the flag
@@ -89,27 +100,35 @@ class HelloVideoApp {
   // video_overlay_ Render the camera video feedback onto the screen.
   tango_gl::VideoOverlay* video_overlay_drawable_;
   YuvDrawable* yuv_drawable_;
+  // Whether the GL context the drawables were created in is still alive.
+  tango_gl::GlContextTracker gl_context_;
 
   TextureMethod current_texture_method_;
 
-  std::vector<uint8_t> yuv_buffer_;
-  std::vector<uint8_t> yuv_temp_buffer_;
-  std::vector<GLubyte> rgb_buffer_;
+  // NV21 frames handed from the camera callback thread to the GL thread.
+  FrameTripleBuffer yuv_frames_;
+  tango_gl::AlignedBuffer<GLubyte> rgb_buffer_;
+  // The three slots of yuv_frames_, and rgb_buffer_.
+  tango_gl::MemoryAccount camera_image_memory_{tango_gl::kMemoryTagCameraImage,
+                                               tango_gl::kMemoryCpu};
 
   std::atomic<bool> is_yuv_texture_available_;
-  std::atomic<bool> swap_buffer_signal_;
-  std::mutex yuv_buffer_mutex_;
 
   size_t yuv_width_;
   size_t yuv_height_;
   size_t yuv_size_;
   size_t uv_buffer_offset_;
 
+  // Time spent converting YUV frames to RGB since the last timing log, and
+  // the number of frames converted in that period.
+  int64_t conversion_time_us_;
+  int conversion_frame_count_;
+
   bool is_service_connected_;
   bool is_texture_id_set_;
 
-  void AllocateTexture(GLuint texture_id, int width, int height);
   void RenderYuv();
+  void RenderYuvShader();
   void RenderTextureId();
   void DeleteDrawables();
 };
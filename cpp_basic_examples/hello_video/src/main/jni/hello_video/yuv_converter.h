@@ -0,0 +1,47 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HELLO_VIDEO_YUV_CONVERTER_H_
+#define HELLO_VIDEO_YUV_CONVERTER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace hello_video {
+namespace yuv_converter {
+
+// Convert an NV21 (YCrCb_420_SP) image to packed 8-bit RGB.
+//
+// The conversion uses fixed-point coefficients. On armeabi-v7a the rows are
+// converted 16 pixels at a time with NEON, on x86 with SSSE3; any remaining
+// pixels, and builds without SIMD support, go through the scalar path.
+//
+// @param nv21, source buffer: width * height luma bytes followed by
+//        width * height / 2 interleaved VU bytes.
+// @param width, image width in pixels, must be even.
+// @param height, image height in pixels, must be even.
+// @param rgb, destination buffer of at least width * height * 3 bytes.
+void Nv21ToRgb(const uint8_t* nv21, size_t width, size_t height, uint8_t* rgb);
+
+// Scalar reference implementation of Nv21ToRgb(), using the same fixed-point
+// coefficients as the vectorized kernels.
+void Nv21ToRgbScalar(const uint8_t* nv21, size_t width, size_t height,
+                     uint8_t* rgb);
+
+}  // namespace yuv_converter
+}  // namespace hello_video
+
+#endif  // HELLO_VIDEO_YUV_CONVERTER_H_
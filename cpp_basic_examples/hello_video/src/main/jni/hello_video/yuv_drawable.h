@@ -18,22 +18,48 @@
 #define HELLO_VIDEO_YUV_DRAWABLE_H_
 
 #include "tango-gl/drawable_object.h"
+#include "tango-gl/full_screen_quad.h"
+#include "tango-gl/streaming_texture.h"
 
 namespace hello_video {
 class YuvDrawable : public tango_gl::DrawableObject {
  public:
   YuvDrawable();
   void Render(const glm::mat4& projection_mat, const glm::mat4& view_mat) const;
-  GLuint GetTextureId() const { return texture_id_; }
-  void SetTextureId(GLuint texture_id) { texture_id_ = texture_id; }
+
+  // Texture holding a CPU converted RGB image.
+  tango_gl::StreamingTexture* GetRgbTexture() { return &rgb_texture_; }
+  // Texture holding the Y plane of an NV21 image as GL_LUMINANCE.
+  tango_gl::StreamingTexture* GetLumaTexture() { return &luma_texture_; }
+  // Half resolution texture holding the interleaved VU plane of an NV21 image
+  // as GL_LUMINANCE_ALPHA.
+  tango_gl::StreamingTexture* GetChromaTexture() { return &chroma_texture_; }
+
+  // Select whether Render() samples the RGB texture, or converts the luma and
+  // chroma textures to RGB in the fragment shader.
+  void SetDecodeInShader(bool decode_in_shader) {
+    decode_in_shader_ = decode_in_shader;
+  }
 
  private:
-  // This id is populated on construction, and is passed to the tango service.
-  GLuint texture_id_;
+  tango_gl::StreamingTexture rgb_texture_;
 
   GLuint attrib_texture_coords_;
   GLuint uniform_texture_;
-  GLuint vertex_buffers_[3];
+  tango_gl::FullScreenQuad quad_;
+
+  // Program and textures used when the YUV to RGB conversion is done on the
+  // GPU.
+  bool decode_in_shader_;
+  tango_gl::StreamingTexture luma_texture_;
+  tango_gl::StreamingTexture chroma_texture_;
+  GLuint yuv_shader_program_;
+  GLuint yuv_attrib_vertices_;
+  GLuint yuv_attrib_texture_coords_;
+  tango_gl::FullScreenQuad yuv_quad_;
+  GLuint yuv_uniform_mvp_mat_;
+  GLuint uniform_luma_texture_;
+  GLuint uniform_chroma_texture_;
 };
 }  // namespace hello_video
 #endif  // HELLO_VIDEO_YUV_DRAWABLE_H_
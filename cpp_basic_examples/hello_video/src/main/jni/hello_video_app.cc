@@ -14,9 +14,13 @@
  * limitations under the License.
  */
 
+#include <chrono>
+
+#include <tango-gl/tracing.h>
 #include <tango_support_api.h>
 
 #include "hello_video/hello_video_app.h"
+#include "hello_video/yuv_converter.h"
 
 namespace {
 constexpr int kTangoCoreMinimumVersion = 9377;
@@ -27,15 +31,9 @@ void OnFrameAvailableRouter(void* context, TangoCameraId,
   app->OnFrameAvailable(buffer);
 }
 
-// We could do this conversion in a fragment shader if all we care about is
-// rendering, but we show it here as an example of how people can use RGB data
-// on the CPU.
-inline void Yuv2Rgb(uint8_t yValue, uint8_t uValue, uint8_t vValue, uint8_t* r,
-                    uint8_t* g, uint8_t* b) {
-  *r = yValue + (1.370705 * (vValue - 128));
-  *g = yValue - (0.698001 * (vValue - 128)) - (0.337633 * (uValue - 128));
-  *b = yValue + (1.732446 * (uValue - 128));
-}
+// Number of converted frames between two logs of the average YUV to RGB
+// conversion time.
+constexpr int kConversionTimingLogInterval = 100;
 }  // namespace
 
 namespace hello_video {
@@ -52,9 +50,10 @@ void HelloVideoApp::OnCreate(JNIEnv* env, jobject caller_activity) {
 
   // Initialize variables
   is_yuv_texture_available_ = false;
-  swap_buffer_signal_ = false;
   is_service_connected_ = false;
   is_texture_id_set_ = false;
+  conversion_time_us_ = 0;
+  conversion_frame_count_ = 0;
   video_overlay_drawable_ = NULL;
   yuv_drawable_ = NULL;
 }
@@ -124,22 +123,25 @@ void HelloVideoApp::OnPause() {
 
   // Free buffer data
   is_yuv_texture_available_ = false;
-  swap_buffer_signal_ = false;
   is_service_connected_ = false;
   is_texture_id_set_ = false;
   rgb_buffer_.clear();
-  yuv_buffer_.clear();
-  yuv_temp_buffer_.clear();
-  this->DeleteDrawables();
+  rgb_buffer_.shrink_to_fit();
+  yuv_frames_.Reset();
+  camera_image_memory_.Set(0);
+  // The drawables are kept with the EGL context, which the activity
+  // preserves, see OnSurfaceCreated().
 }
 
 void HelloVideoApp::OnFrameAvailable(const TangoImageBuffer* buffer) {
-  if (current_texture_method_ != TextureMethod::kYuv) {
+  TANGO_TRACE_SCOPE("HelloVideoApp::OnFrameAvailable");
+  if (current_texture_method_ != TextureMethod::kYuv &&
+      current_texture_method_ != TextureMethod::kYuvShader) {
     return;
   }
 
-  if (yuv_drawable_->GetTextureId() == 0) {
-    LOGE("HelloVideoApp::yuv texture id not valid");
+  if (yuv_drawable_ == NULL) {
+    LOGE("HelloVideoApp::yuv drawable not created");
     return;
   }
 
@@ -158,17 +160,18 @@ void HelloVideoApp::OnFrameAvailable(const TangoImageBuffer* buffer) {
     yuv_size_ = yuv_width_ * yuv_height_ + yuv_width_ * yuv_height_ / 2;
 
     // Reserve and resize the buffer size for RGB and YUV data.
-    yuv_buffer_.resize(yuv_size_);
-    yuv_temp_buffer_.resize(yuv_size_);
+    yuv_frames_.Resize(yuv_size_);
     rgb_buffer_.resize(yuv_width_ * yuv_height_ * 3);
+    camera_image_memory_.Set(3 * yuv_size_ + rgb_buffer_.capacity());
 
-    AllocateTexture(yuv_drawable_->GetTextureId(), yuv_width_, yuv_height_);
     is_yuv_texture_available_ = true;
   }
 
-  std::lock_guard<std::mutex> lock(yuv_buffer_mutex_);
-  memcpy(&yuv_temp_buffer_[0], buffer->data, yuv_size_);
-  swap_buffer_signal_ = true;
+  // The image buffer is only valid for the duration of this callback, so the
+  // frame is copied once into the free slot and then handed to the GL thread
+  // without blocking it.
+  memcpy(yuv_frames_.GetWriteBuffer(), buffer->data, yuv_size_);
+  yuv_frames_.Publish();
 }
 
 void HelloVideoApp::DeleteDrawables() {
@@ -179,11 +182,20 @@ void HelloVideoApp::DeleteDrawables() {
 }
 
 void HelloVideoApp::OnSurfaceCreated() {
-  if (video_overlay_drawable_ != NULL || yuv_drawable_ != NULL) {
-    this->DeleteDrawables();
+  // GLSurfaceView can call this again for a context it kept, whose drawables
+  // are still valid.
+  if (gl_context_.CheckCurrentContext() ==
+      tango_gl::GlContextTracker::kContextKept) {
+    return;
   }
+  // Nothing was created in a new context yet, so deleting the drawables of a
+  // lost one only frees their memory.
+  this->DeleteDrawables();
   video_overlay_drawable_ = new tango_gl::VideoOverlay();
   yuv_drawable_ = new YuvDrawable();
+  gl_context_.Attach();
+  // The camera renders into the texture of the new video overlay.
+  is_texture_id_set_ = false;
 }
 
 void HelloVideoApp::OnSurfaceChanged(int width, int height) {
@@ -191,6 +203,7 @@ void HelloVideoApp::OnSurfaceChanged(int width, int height) {
 }
 
 void HelloVideoApp::OnDrawFrame() {
+  TANGO_TRACE_SCOPE("HelloVideoApp::OnDrawFrame");
   if (is_service_connected_ && !is_texture_id_set_) {
     is_texture_id_set_ = true;
     // Connect color camera texture. TangoService_connectTextureId expects a
@@ -216,54 +229,70 @@ void HelloVideoApp::OnDrawFrame() {
     case TextureMethod::kTextureId:
       RenderTextureId();
       break;
+    case TextureMethod::kYuvShader:
+      RenderYuvShader();
+      break;
   }
 }
 
-void HelloVideoApp::AllocateTexture(GLuint texture_id, int width, int height) {
-  glBindTexture(GL_TEXTURE_2D, texture_id);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB,
-               GL_UNSIGNED_BYTE, rgb_buffer_.data());
-}
-
 void HelloVideoApp::RenderYuv() {
   if (!is_yuv_texture_available_) {
     return;
   }
-  {
-    std::lock_guard<std::mutex> lock(yuv_buffer_mutex_);
-    if (swap_buffer_signal_) {
-      std::swap(yuv_buffer_, yuv_temp_buffer_);
-      swap_buffer_signal_ = false;
+
+  // Only convert and upload when the camera delivered a new frame, otherwise
+  // the texture still holds the latest one.
+  if (yuv_frames_.AcquireLatest()) {
+    // We could do this conversion in a fragment shader if all we care about
+    // is rendering, but we show it here as an example of how people can use
+    // RGB data on the CPU.
+    const std::chrono::steady_clock::time_point conversion_start =
+        std::chrono::steady_clock::now();
+    yuv_converter::Nv21ToRgb(yuv_frames_.GetReadBuffer(), yuv_width_,
+                             yuv_height_, rgb_buffer_.data());
+    conversion_time_us_ +=
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - conversion_start).count();
+    if (++conversion_frame_count_ == kConversionTimingLogInterval) {
+      LOGI("HelloVideoApp: YUV to RGB conversion took %.3f ms per frame",
+           conversion_time_us_ / (1000.0 * conversion_frame_count_));
+      conversion_time_us_ = 0;
+      conversion_frame_count_ = 0;
     }
+
+    // The storage is only allocated for the first frame, afterwards the
+    // texture content is replaced in place.
+    tango_gl::StreamingTexture* rgb_texture = yuv_drawable_->GetRgbTexture();
+    rgb_texture->Allocate(GL_RGB, yuv_width_, yuv_height_);
+    rgb_texture->Update(rgb_buffer_.data());
   }
 
-  for (size_t i = 0; i < yuv_height_; ++i) {
-    for (size_t j = 0; j < yuv_width_; ++j) {
-      size_t x_index = j;
-      if (j % 2 != 0) {
-        x_index = j - 1;
-      }
-
-      size_t rgb_index = (i * yuv_width_ + j) * 3;
-
-      // The YUV texture format is NV21,
-      // yuv_buffer_ buffer layout:
-      //   [y0, y1, y2, ..., yn, v0, u0, v1, u1, ..., v(n/4), u(n/4)]
-      Yuv2Rgb(
-          yuv_buffer_[i * yuv_width_ + j],
-          yuv_buffer_[uv_buffer_offset_ + (i / 2) * yuv_width_ + x_index + 1],
-          yuv_buffer_[uv_buffer_offset_ + (i / 2) * yuv_width_ + x_index],
-          &rgb_buffer_[rgb_index], &rgb_buffer_[rgb_index + 1],
-          &rgb_buffer_[rgb_index + 2]);
-    }
+  yuv_drawable_->SetDecodeInShader(false);
+  yuv_drawable_->Render(glm::mat4(1.0f), glm::mat4(1.0f));
+}
+
+void HelloVideoApp::RenderYuvShader() {
+  if (!is_yuv_texture_available_) {
+    return;
   }
 
-  glBindTexture(GL_TEXTURE_2D, yuv_drawable_->GetTextureId());
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, yuv_width_, yuv_height_, 0, GL_RGB,
-               GL_UNSIGNED_BYTE, rgb_buffer_.data());
+  // Upload the NV21 planes as they are, the fragment shader of the YUV
+  // drawable does the conversion to RGB. The Y plane is a full resolution
+  // single channel image and the VU plane is a half resolution two channel
+  // image, so this uploads 1.5 bytes per pixel instead of 3 for RGB.
+  if (yuv_frames_.AcquireLatest()) {
+    const uint8_t* yuv_frame = yuv_frames_.GetReadBuffer();
+    tango_gl::StreamingTexture* luma_texture = yuv_drawable_->GetLumaTexture();
+    luma_texture->Allocate(GL_LUMINANCE, yuv_width_, yuv_height_);
+    luma_texture->Update(yuv_frame);
+    tango_gl::StreamingTexture* chroma_texture =
+        yuv_drawable_->GetChromaTexture();
+    chroma_texture->Allocate(GL_LUMINANCE_ALPHA, yuv_width_ / 2,
+                             yuv_height_ / 2);
+    chroma_texture->Update(yuv_frame + uv_buffer_offset_);
+  }
 
+  yuv_drawable_->SetDecodeInShader(true);
   yuv_drawable_->Render(glm::mat4(1.0f), glm::mat4(1.0f));
 }
 
@@ -271,7 +300,11 @@ void HelloVideoApp::RenderTextureId() {
   double timestamp;
   // TangoService_updateTexture() updates target camera's
   // texture and timestamp.
-  int ret = TangoService_updateTexture(TANGO_CAMERA_COLOR, &timestamp);
+  int ret;
+  {
+    TANGO_TRACE_SCOPE("TangoService_updateTexture");
+    ret = TangoService_updateTexture(TANGO_CAMERA_COLOR, &timestamp);
+  }
   if (ret != TANGO_SUCCESS) {
     LOGE(
         "HelloVideoApp: Failed to update the texture id with error code: "
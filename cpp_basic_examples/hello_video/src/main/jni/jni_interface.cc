@@ -17,6 +17,7 @@
 #define GLM_FORCE_RADIANS
 
 #include <jni.h>
+#include <tango-gl/tracing.h>
 #include <hello_video/hello_video_app.h>
 
 static hello_video::HelloVideoApp app;
@@ -61,13 +62,37 @@ Java_com_projecttango_examples_cpp_hellovideo_TangoJniNative_onDrawFrame(
 }
 
 JNIEXPORT void JNICALL
-Java_com_projecttango_examples_cpp_hellovideo_TangoJniNative_setYuvMethod(
-    JNIEnv*, jobject, jboolean use_yuv_method) {
-  if (use_yuv_method) {
-    app.SetTextureMethod(hello_video::HelloVideoApp::TextureMethod::kYuv);
-  } else {
-    app.SetTextureMethod(hello_video::HelloVideoApp::TextureMethod::kTextureId);
-  }
+Java_com_projecttango_examples_cpp_hellovideo_TangoJniNative_setTextureMethod(
+    JNIEnv*, jobject, jint method) {
+  app.SetTextureMethod(
+      static_cast<hello_video::HelloVideoApp::TextureMethod>(method));
+}
+
+JNIEXPORT jint JNICALL
+Java_com_projecttango_examples_cpp_hellovideo_TangoJniNative_getDroppedFrameCount(
+    JNIEnv*, jobject) {
+  return static_cast<jint>(app.GetDroppedFrameCount());
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_hellovideo_TangoJniNative_startTracing(
+    JNIEnv*, jobject) {
+  tango_gl::tracing::Start();
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_hellovideo_TangoJniNative_stopTracing(
+    JNIEnv*, jobject) {
+  tango_gl::tracing::Stop();
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_projecttango_examples_cpp_hellovideo_TangoJniNative_dumpTrace(
+    JNIEnv* env, jobject, jstring path) {
+  const char* path_chars = env->GetStringUTFChars(path, nullptr);
+  const bool dumped = tango_gl::tracing::DumpChromeTrace(path_chars);
+  env->ReleaseStringUTFChars(path, path_chars);
+  return dumped;
 }
 
 #ifdef __cplusplus
@@ -0,0 +1,226 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hello_video/yuv_converter.h"
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define HELLO_VIDEO_YUV_NEON 1
+#elif defined(__SSSE3__)
+// The Android x86 ABI guarantees SSSE3, which Android.mk enables.
+#include <tmmintrin.h>
+#define HELLO_VIDEO_YUV_SSSE3 1
+#endif
+
+namespace {
+// Fixed-point (Q6) versions of the YCrCb to RGB coefficients:
+//   R = Y + 1.370705 * (V - 128)
+//   G = Y - 0.698001 * (V - 128) - 0.337633 * (U - 128)
+//   B = Y + 1.732446 * (U - 128)
+// Q6 keeps every intermediate value inside a signed 16-bit lane.
+constexpr int kFixedPointShift = 6;
+constexpr int kFixedPointRound = 1 << (kFixedPointShift - 1);
+constexpr int16_t kVToR = 88;
+constexpr int16_t kVToG = 45;
+constexpr int16_t kUToG = 22;
+constexpr int16_t kUToB = 111;
+
+// Number of pixels converted by one iteration of the SIMD kernels.
+constexpr size_t kSimdPixelsPerIteration = 16;
+
+inline uint8_t ClampToByte(int value) {
+  return static_cast<uint8_t>(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+// Convert pixels [begin, end) of a single row. |vu_row| points to the start of
+// the interleaved VU row shared by this row and its neighbour.
+void ConvertRowScalar(const uint8_t* y_row, const uint8_t* vu_row,
+                      size_t begin, size_t end, uint8_t* rgb_row) {
+  for (size_t j = begin; j < end; ++j) {
+    const size_t vu_index = j & ~static_cast<size_t>(1);
+    const int v = vu_row[vu_index] - 128;
+    const int u = vu_row[vu_index + 1] - 128;
+    const int y = (y_row[j] << kFixedPointShift) + kFixedPointRound;
+
+    uint8_t* rgb = rgb_row + j * 3;
+    rgb[0] = ClampToByte((y + kVToR * v) >> kFixedPointShift);
+    rgb[1] = ClampToByte((y - kVToG * v - kUToG * u) >> kFixedPointShift);
+    rgb[2] = ClampToByte((y + kUToB * u) >> kFixedPointShift);
+  }
+}
+
+#if defined(HELLO_VIDEO_YUV_NEON)
+// Convert as many leading pixels of the row as fit in whole 16 pixel blocks
+// and return the number of pixels converted.
+size_t ConvertRowSimd(const uint8_t* y_row, const uint8_t* vu_row,
+                      size_t width, uint8_t* rgb_row) {
+  const uint8x8_t bias = vdup_n_u8(128);
+  size_t j = 0;
+  for (; j + kSimdPixelsPerIteration <= width; j += kSimdPixelsPerIteration) {
+    const uint8x16_t y = vld1q_u8(y_row + j);
+    // Deinterleave 8 VU pairs, val[0] holds V and val[1] holds U.
+    const uint8x8x2_t vu = vld2_u8(vu_row + j);
+    const int16x8_t v = vreinterpretq_s16_u16(vsubl_u8(vu.val[0], bias));
+    const int16x8_t u = vreinterpretq_s16_u16(vsubl_u8(vu.val[1], bias));
+
+    const int16x8_t r_offset = vmulq_n_s16(v, kVToR);
+    const int16x8_t g_offset = vmlaq_n_s16(vmulq_n_s16(v, kVToG), u, kUToG);
+    const int16x8_t b_offset = vmulq_n_s16(u, kUToB);
+
+    // Each chroma sample covers two horizontally adjacent pixels.
+    const int16x8x2_t r_zip = vzipq_s16(r_offset, r_offset);
+    const int16x8x2_t g_zip = vzipq_s16(g_offset, g_offset);
+    const int16x8x2_t b_zip = vzipq_s16(b_offset, b_offset);
+
+    const int16x8_t y_low = vreinterpretq_s16_u16(
+        vshll_n_u8(vget_low_u8(y), kFixedPointShift));
+    const int16x8_t y_high = vreinterpretq_s16_u16(
+        vshll_n_u8(vget_high_u8(y), kFixedPointShift));
+
+    uint8x16x3_t rgb;
+    rgb.val[0] = vcombine_u8(
+        vqrshrun_n_s16(vqaddq_s16(y_low, r_zip.val[0]), kFixedPointShift),
+        vqrshrun_n_s16(vqaddq_s16(y_high, r_zip.val[1]), kFixedPointShift));
+    rgb.val[1] = vcombine_u8(
+        vqrshrun_n_s16(vqsubq_s16(y_low, g_zip.val[0]), kFixedPointShift),
+        vqrshrun_n_s16(vqsubq_s16(y_high, g_zip.val[1]), kFixedPointShift));
+    rgb.val[2] = vcombine_u8(
+        vqrshrun_n_s16(vqaddq_s16(y_low, b_zip.val[0]), kFixedPointShift),
+        vqrshrun_n_s16(vqaddq_s16(y_high, b_zip.val[1]), kFixedPointShift));
+    vst3q_u8(rgb_row + j * 3, rgb);
+  }
+  return j;
+}
+#elif defined(HELLO_VIDEO_YUV_SSSE3)
+inline __m128i FixedPointToByte(__m128i low, __m128i high) {
+  const __m128i round = _mm_set1_epi16(kFixedPointRound);
+  low = _mm_srai_epi16(_mm_adds_epi16(low, round), kFixedPointShift);
+  high = _mm_srai_epi16(_mm_adds_epi16(high, round), kFixedPointShift);
+  return _mm_packus_epi16(low, high);
+}
+
+// Interleave 16 planar R, G and B values into 48 bytes of packed RGB.
+inline void StoreRgb(__m128i r, __m128i g, __m128i b, uint8_t* rgb) {
+  const __m128i r0 = _mm_setr_epi8(0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1,
+                                   4, -1, -1, 5);
+  const __m128i g0 = _mm_setr_epi8(-1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1,
+                                   -1, 4, -1, -1);
+  const __m128i b0 = _mm_setr_epi8(-1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3,
+                                   -1, -1, 4, -1);
+  const __m128i r1 = _mm_setr_epi8(-1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9,
+                                   -1, -1, 10, -1);
+  const __m128i g1 = _mm_setr_epi8(5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1,
+                                   9, -1, -1, 10);
+  const __m128i b1 = _mm_setr_epi8(-1, 5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1,
+                                   -1, 9, -1, -1);
+  const __m128i r2 = _mm_setr_epi8(-1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14,
+                                   -1, -1, 15, -1, -1);
+  const __m128i g2 = _mm_setr_epi8(-1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1,
+                                   14, -1, -1, 15, -1);
+  const __m128i b2 = _mm_setr_epi8(10, -1, -1, 11, -1, -1, 12, -1, -1, 13, -1,
+                                   -1, 14, -1, -1, 15);
+
+  __m128i* out = reinterpret_cast<__m128i*>(rgb);
+  _mm_storeu_si128(out, _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(r, r0),
+                                                  _mm_shuffle_epi8(g, g0)),
+                                     _mm_shuffle_epi8(b, b0)));
+  _mm_storeu_si128(out + 1, _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(r, r1),
+                                                      _mm_shuffle_epi8(g, g1)),
+                                         _mm_shuffle_epi8(b, b1)));
+  _mm_storeu_si128(out + 2, _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(r, r2),
+                                                      _mm_shuffle_epi8(g, g2)),
+                                         _mm_shuffle_epi8(b, b2)));
+}
+
+// Convert as many leading pixels of the row as fit in whole 16 pixel blocks
+// and return the number of pixels converted.
+size_t ConvertRowSimd(const uint8_t* y_row, const uint8_t* vu_row,
+                      size_t width, uint8_t* rgb_row) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i low_byte_mask = _mm_set1_epi16(0x00ff);
+  const __m128i bias = _mm_set1_epi16(128);
+  const __m128i v_to_r = _mm_set1_epi16(kVToR);
+  const __m128i v_to_g = _mm_set1_epi16(kVToG);
+  const __m128i u_to_g = _mm_set1_epi16(kUToG);
+  const __m128i u_to_b = _mm_set1_epi16(kUToB);
+
+  size_t j = 0;
+  for (; j + kSimdPixelsPerIteration <= width; j += kSimdPixelsPerIteration) {
+    const __m128i y =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(y_row + j));
+    // 8 VU pairs; on little endian V is the low byte of each 16-bit lane.
+    const __m128i vu =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(vu_row + j));
+    const __m128i v = _mm_sub_epi16(_mm_and_si128(vu, low_byte_mask), bias);
+    const __m128i u = _mm_sub_epi16(_mm_srli_epi16(vu, 8), bias);
+
+    const __m128i r_offset = _mm_mullo_epi16(v, v_to_r);
+    const __m128i g_offset = _mm_add_epi16(_mm_mullo_epi16(v, v_to_g),
+                                           _mm_mullo_epi16(u, u_to_g));
+    const __m128i b_offset = _mm_mullo_epi16(u, u_to_b);
+
+    const __m128i y_low =
+        _mm_slli_epi16(_mm_unpacklo_epi8(y, zero), kFixedPointShift);
+    const __m128i y_high =
+        _mm_slli_epi16(_mm_unpackhi_epi8(y, zero), kFixedPointShift);
+
+    // Each chroma sample covers two horizontally adjacent pixels.
+    const __m128i r = FixedPointToByte(
+        _mm_adds_epi16(y_low, _mm_unpacklo_epi16(r_offset, r_offset)),
+        _mm_adds_epi16(y_high, _mm_unpackhi_epi16(r_offset, r_offset)));
+    const __m128i g = FixedPointToByte(
+        _mm_subs_epi16(y_low, _mm_unpacklo_epi16(g_offset, g_offset)),
+        _mm_subs_epi16(y_high, _mm_unpackhi_epi16(g_offset, g_offset)));
+    const __m128i b = FixedPointToByte(
+        _mm_adds_epi16(y_low, _mm_unpacklo_epi16(b_offset, b_offset)),
+        _mm_adds_epi16(y_high, _mm_unpackhi_epi16(b_offset, b_offset)));
+    StoreRgb(r, g, b, rgb_row + j * 3);
+  }
+  return j;
+}
+#else
+size_t ConvertRowSimd(const uint8_t*, const uint8_t*, size_t, uint8_t*) {
+  return 0;
+}
+#endif
+}  // namespace
+
+namespace hello_video {
+namespace yuv_converter {
+
+void Nv21ToRgb(const uint8_t* nv21, size_t width, size_t height,
+               uint8_t* rgb) {
+  const uint8_t* vu_plane = nv21 + width * height;
+  for (size_t i = 0; i < height; ++i) {
+    const uint8_t* y_row = nv21 + i * width;
+    const uint8_t* vu_row = vu_plane + (i / 2) * width;
+    uint8_t* rgb_row = rgb + i * width * 3;
+    const size_t converted = ConvertRowSimd(y_row, vu_row, width, rgb_row);
+    ConvertRowScalar(y_row, vu_row, converted, width, rgb_row);
+  }
+}
+
+void Nv21ToRgbScalar(const uint8_t* nv21, size_t width, size_t height,
+                     uint8_t* rgb) {
+  const uint8_t* vu_plane = nv21 + width * height;
+  for (size_t i = 0; i < height; ++i) {
+    ConvertRowScalar(nv21 + i * width, vu_plane + (i / 2) * width, 0, width,
+                     rgb + i * width * 3);
+  }
+}
+
+}  // namespace yuv_converter
+}  // namespace hello_video
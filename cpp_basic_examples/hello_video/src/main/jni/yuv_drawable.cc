@@ -16,17 +16,12 @@
 
 #include "hello_video/yuv_drawable.h"
 
-namespace {
-const GLfloat kVertices[] = {-1.0, 1.0, 0.0, -1.0, -1.0, 0.0,
-                             1.0,  1.0, 0.0, 1.0,  -1.0, 0.0};
-
-const GLushort kIndices[] = {0, 1, 2, 2, 1, 3};
+#include <tango-gl/gl_state.h>
+#include <tango-gl/shaders.h>
 
-const GLfloat kTextureCoords[] = {0.0, 0.0, 0.0, 1.0, 1.0, 0.0, 1.0, 1.0};
-
-const std::string kVertexShader =
-    "precision highp float;\n"
-    "precision highp int;\n"
+namespace {
+const char kVertexShader[] =
+    TANGO_GL_GLSL_HIGHP
     "attribute vec4 vertex;\n"
     "attribute vec2 textureCoords;\n"
     "varying vec2 f_textureCoords;\n"
@@ -36,102 +31,100 @@ const std::string kVertexShader =
     "  gl_Position = mvp * vertex;\n"
     "}\n";
 
-const std::string kFragmetnShader =
-    "precision highp float;\n"
-    "precision highp int;\n"
+const char kFragmetnShader[] =
+    TANGO_GL_GLSL_HIGHP
     "uniform sampler2D texture;\n"
     "varying vec2 f_textureCoords;\n"
     "void main() {\n"
     "  gl_FragColor = texture2D(texture, f_textureCoords);\n"
     "}\n";
+
+// NV21 stores V before U, so the luminance channel of the chroma texture
+// holds V and the alpha channel holds U.
+const char kYuvFragmentShader[] =
+    TANGO_GL_GLSL_HIGHP
+    "uniform sampler2D luma_texture;\n"
+    "uniform sampler2D chroma_texture;\n"
+    "varying vec2 f_textureCoords;\n"
+    "void main() {\n"
+    "  float y = texture2D(luma_texture, f_textureCoords).r;\n"
+    "  vec2 vu = texture2D(chroma_texture, f_textureCoords).ra - 0.5;\n"
+    "  gl_FragColor = vec4(y + 1.370705 * vu.x,\n"
+    "                      y - 0.698001 * vu.x - 0.337633 * vu.y,\n"
+    "                      y + 1.732446 * vu.y, 1.0);\n"
+    "}\n";
 }  // namespace
 
 namespace hello_video {
 
-YuvDrawable::YuvDrawable() {
-  glEnable(GL_VERTEX_PROGRAM_POINT_SIZE);
-  shader_program_ = tango_gl::util::CreateProgram(kVertexShader.c_str(),
-                                                  kFragmetnShader.c_str());
+YuvDrawable::YuvDrawable()
+    : rgb_texture_(GL_NEAREST),
+      decode_in_shader_(false),
+      luma_texture_(GL_LINEAR),
+      chroma_texture_(GL_LINEAR) {
+  tango_gl::GlState::Enable(GL_VERTEX_PROGRAM_POINT_SIZE);
+  shader_program_ = tango_gl::util::CreateProgram(kVertexShader,
+                                                  kFragmetnShader);
   if (!shader_program_) {
     LOGE("Could not create program.");
   }
 
-  glGenTextures(1, &texture_id_);
-  glBindTexture(GL_TEXTURE_2D, texture_id_);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
   uniform_texture_ = glGetUniformLocation(shader_program_, "texture");
 
-  glGenBuffers(3, vertex_buffers_);
-  // Allocate vertices buffer.
-  glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers_[0]);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * 3 * 4, kVertices,
-               GL_STATIC_DRAW);
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-  // Allocate triangle indices buffer.
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vertex_buffers_[1]);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLushort) * 6, kIndices,
-               GL_STATIC_DRAW);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-
-  // Allocate texture coordinates buufer.
-  glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers_[2]);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * 2 * 4, kTextureCoords,
-               GL_STATIC_DRAW);
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-  // Assign the vertices attribute data.
   attrib_vertices_ = glGetAttribLocation(shader_program_, "vertex");
-  glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers_[0]);
-  glEnableVertexAttribArray(attrib_vertices_);
-  glVertexAttribPointer(attrib_vertices_, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-  // Assign the texture coordinates attribute data.
   attrib_texture_coords_ =
       glGetAttribLocation(shader_program_, "textureCoords");
-  glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers_[2]);
-  glEnableVertexAttribArray(attrib_texture_coords_);
-  glVertexAttribPointer(attrib_texture_coords_, 2, GL_FLOAT, GL_FALSE, 0,
-                        nullptr);
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  quad_.SetAttributeLocations(attrib_vertices_, attrib_texture_coords_);
 
   uniform_mvp_mat_ = glGetUniformLocation(shader_program_, "mvp");
+
+  yuv_shader_program_ = tango_gl::util::CreateProgram(
+      kVertexShader, kYuvFragmentShader);
+  if (!yuv_shader_program_) {
+    LOGE("Could not create YUV program.");
+  }
+  yuv_attrib_vertices_ = glGetAttribLocation(yuv_shader_program_, "vertex");
+  yuv_attrib_texture_coords_ =
+      glGetAttribLocation(yuv_shader_program_, "textureCoords");
+  yuv_quad_.SetAttributeLocations(yuv_attrib_vertices_,
+                                  yuv_attrib_texture_coords_);
+  yuv_uniform_mvp_mat_ = glGetUniformLocation(yuv_shader_program_, "mvp");
+  uniform_luma_texture_ =
+      glGetUniformLocation(yuv_shader_program_, "luma_texture");
+  uniform_chroma_texture_ =
+      glGetUniformLocation(yuv_shader_program_, "chroma_texture");
 }
 
 void YuvDrawable::Render(const glm::mat4& projection_mat,
                          const glm::mat4& view_mat) const {
-  glUseProgram(shader_program_);
-
-  glUniform1i(uniform_texture_, 2);
-  glActiveTexture(GL_TEXTURE2);
-  glBindTexture(GL_TEXTURE_2D, texture_id_);
+  const tango_gl::FullScreenQuad* quad = &quad_;
+  GLuint uniform_mvp_mat = uniform_mvp_mat_;
+  if (decode_in_shader_) {
+    tango_gl::GlState::UseProgram(yuv_shader_program_);
+    quad = &yuv_quad_;
+    uniform_mvp_mat = yuv_uniform_mvp_mat_;
+
+    glUniform1i(uniform_luma_texture_, 2);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, luma_texture_.GetTextureId());
+    glUniform1i(uniform_chroma_texture_, 3);
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_2D, chroma_texture_.GetTextureId());
+  } else {
+    tango_gl::GlState::UseProgram(shader_program_);
+
+    glUniform1i(uniform_texture_, 2);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, rgb_texture_.GetTextureId());
+  }
 
   glm::mat4 model_mat = GetTransformationMatrix();
   glm::mat4 mvp_mat = projection_mat * view_mat * model_mat;
-  glUniformMatrix4fv(uniform_mvp_mat_, 1, GL_FALSE, glm::value_ptr(mvp_mat));
-
-  // Bind vertices buffer.
-  glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers_[0]);
-  glEnableVertexAttribArray(attrib_vertices_);
-  glVertexAttribPointer(attrib_vertices_, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-  // Bind texture coordinates buffer.
-  glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers_[2]);
-  glEnableVertexAttribArray(attrib_texture_coords_);
-  glVertexAttribPointer(attrib_texture_coords_, 2, GL_FLOAT, GL_FALSE, 0,
-                        nullptr);
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-  // Bind element array buffer.
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vertex_buffers_[1]);
-  glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, 0);
-  tango_gl::util::CheckGlError("glDrawElements");
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-
-  glUseProgram(0);
+  glUniformMatrix4fv(uniform_mvp_mat, 1, GL_FALSE, glm::value_ptr(mvp_mat));
+
+  quad->Draw();
+
+  tango_gl::GlState::UseProgram(0);
   tango_gl::util::CheckGlError("glUseProgram()");
 }
 
@@ -0,0 +1,157 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.projecttango.examples.cpp.util;
+
+import android.annotation.TargetApi;
+import android.media.MediaCodec;
+import android.media.MediaCodecInfo;
+import android.media.MediaFormat;
+import android.media.MediaMuxer;
+import android.os.Build;
+import android.util.Log;
+import android.view.Surface;
+
+import java.io.IOException;
+import java.nio.ByteBuffer;
+
+/**
+ * Records the frames drawn into the input Surface of a hardware video encoder
+ * to an MP4 file, so that the frames never go through the CPU. The native code
+ * draws into getInputSurface(), with the presentation time of each frame, see
+ * tango_gl::EncoderSurface, and a thread of the encoder writes the encoded
+ * frames:
+ *
+ *   mEncoder = new SurfaceVideoEncoder(path, SurfaceVideoEncoder.MIME_AVC,
+ *                                      width, height);
+ *   // Hand mEncoder.getInputSurface() to the native code.
+ *   ...
+ *   // Once the native code stopped drawing into the surface.
+ *   mEncoder.stop();
+ */
+@TargetApi(Build.VERSION_CODES.JELLY_BEAN_MR2)
+public class SurfaceVideoEncoder {
+  private static final String TAG = SurfaceVideoEncoder.class.getSimpleName();
+
+  // H.264, which every device encodes, and H.265 for half the bit rate on the
+  // devices that encode it.
+  public static final String MIME_AVC = "video/avc";
+  public static final String MIME_HEVC = "video/hevc";
+
+  // The frames are timed by their presentation time, the rate is only a hint
+  // of the encoder.
+  private static final int FRAME_RATE = 30;
+  private static final int I_FRAME_INTERVAL_S = 1;
+  // Bits per second per pixel, 8 Mb/s at 1920x1080.
+  private static final int BITS_PER_PIXEL = 4;
+  private static final long DRAIN_TIMEOUT_US = 10000;
+
+  private final MediaCodec mEncoder;
+  private final MediaMuxer mMuxer;
+  private final Surface mInputSurface;
+  private final Thread mDrainThread;
+  // Only used by the drain thread, until it is joined.
+  private int mTrackIndex = -1;
+
+  /**
+   * Create the encoder and the file, and start encoding.
+   *
+   * @param path of the MP4 file, overwritten.
+   * @param mimeType MIME_AVC or MIME_HEVC.
+   * @param width of the frames, a multiple of 16 for most encoders.
+   * @param height of the frames, a multiple of 16 for most encoders.
+   */
+  public SurfaceVideoEncoder(String path, String mimeType, int width, int height)
+      throws IOException {
+    MediaFormat format = MediaFormat.createVideoFormat(mimeType, width, height);
+    format.setInteger(MediaFormat.KEY_COLOR_FORMAT,
+                      MediaCodecInfo.CodecCapabilities.COLOR_FormatSurface);
+    format.setInteger(MediaFormat.KEY_BIT_RATE, BITS_PER_PIXEL * width * height);
+    format.setInteger(MediaFormat.KEY_FRAME_RATE, FRAME_RATE);
+    format.setInteger(MediaFormat.KEY_I_FRAME_INTERVAL, I_FRAME_INTERVAL_S);
+
+    mEncoder = MediaCodec.createEncoderByType(mimeType);
+    mEncoder.configure(format, null, null, MediaCodec.CONFIGURE_FLAG_ENCODE);
+    mInputSurface = mEncoder.createInputSurface();
+    mEncoder.start();
+    mMuxer = new MediaMuxer(path, MediaMuxer.OutputFormat.MUXER_OUTPUT_MPEG_4);
+
+    mDrainThread = new Thread(new Runnable() {
+      @Override
+      public void run() {
+        drain();
+      }
+    }, TAG);
+    mDrainThread.start();
+  }
+
+  /**
+   * @return the Surface the frames are drawn into.
+   */
+  public Surface getInputSurface() {
+    return mInputSurface;
+  }
+
+  /**
+   * Write the frames still in the encoder and close the file. Nothing must
+   * draw into the input surface any more.
+   */
+  public void stop() {
+    mEncoder.signalEndOfInputStream();
+    try {
+      mDrainThread.join();
+    } catch (InterruptedException e) {
+      Log.e(TAG, "Interrupted waiting for the encoder");
+    }
+    mEncoder.stop();
+    mEncoder.release();
+    if (mTrackIndex >= 0) {
+      mMuxer.stop();
+    }
+    mMuxer.release();
+    mInputSurface.release();
+  }
+
+  // Write the encoded frames until the end of the stream.
+  private void drain() {
+    MediaCodec.BufferInfo info = new MediaCodec.BufferInfo();
+    ByteBuffer[] outputBuffers = mEncoder.getOutputBuffers();
+    while (true) {
+      int index = mEncoder.dequeueOutputBuffer(info, DRAIN_TIMEOUT_US);
+      if (index == MediaCodec.INFO_TRY_AGAIN_LATER) {
+        continue;
+      } else if (index == MediaCodec.INFO_OUTPUT_BUFFERS_CHANGED) {
+        outputBuffers = mEncoder.getOutputBuffers();
+      } else if (index == MediaCodec.INFO_OUTPUT_FORMAT_CHANGED) {
+        // Comes once, before the first frame, with the codec configuration.
+        mTrackIndex = mMuxer.addTrack(mEncoder.getOutputFormat());
+        mMuxer.start();
+      } else if (index >= 0) {
+        if ((info.flags & MediaCodec.BUFFER_FLAG_CODEC_CONFIG) == 0 &&
+            info.size > 0 && mTrackIndex >= 0) {
+          ByteBuffer data = outputBuffers[index];
+          data.position(info.offset);
+          data.limit(info.offset + info.size);
+          mMuxer.writeSampleData(mTrackIndex, data, info);
+        }
+        mEncoder.releaseOutputBuffer(index, false);
+        if ((info.flags & MediaCodec.BUFFER_FLAG_END_OF_STREAM) != 0) {
+          return;
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.projecttango.examples.cpp.util;
+
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+
+/**
+ * Reads the debug telemetry a native tango_util::TelemetryBlock shares
+ * through a direct ByteBuffer, without calling into native code. A read is
+ * retried until no native write overlapped it:
+ *
+ *   int sequence;
+ *   do {
+ *     sequence = mTelemetry.beginRead();
+ *     pointCount = mTelemetry.getInt(POINT_COUNT_OFFSET);
+ *   } while (!mTelemetry.endRead(sequence));
+ *
+ * The offsets are those of the fields in the native struct, which the app
+ * mirrors as constants.
+ */
+public class TelemetryBuffer {
+  // Offset of the fields in the buffer, after the 32 bit sequence.
+  private static final int FIELDS_OFFSET = 8;
+
+  private final ByteBuffer mBuffer;
+
+  public TelemetryBuffer(ByteBuffer buffer) {
+    mBuffer = buffer.order(ByteOrder.nativeOrder());
+  }
+
+  // Start a read, waiting out a write in progress.
+  //
+  // @return the sequence to pass to endRead().
+  public int beginRead() {
+    int sequence = mBuffer.getInt(0);
+    while ((sequence & 1) != 0) {
+      Thread.yield();
+      sequence = mBuffer.getInt(0);
+    }
+    return sequence;
+  }
+
+  // @return true if no write happened since beginRead() returned |sequence|,
+  //     false if the fields read must be read again.
+  public boolean endRead(int sequence) {
+    return mBuffer.getInt(0) == sequence;
+  }
+
+  public int getInt(int offset) {
+    return mBuffer.getInt(FIELDS_OFFSET + offset);
+  }
+
+  public float getFloat(int offset) {
+    return mBuffer.getFloat(FIELDS_OFFSET + offset);
+  }
+
+  // Copy the null terminated string of |bytes.length| bytes at |offset|.
+  //
+  // @return the length of the string.
+  public int getString(int offset, byte[] bytes) {
+    int length = 0;
+    while (length < bytes.length) {
+      bytes[length] = mBuffer.get(FIELDS_OFFSET + offset + length);
+      if (bytes[length] == 0) {
+        break;
+      }
+      ++length;
+    }
+    return length;
+  }
+
+  // Append |value| with 3 decimals, as String.format("%.3f") does but without
+  // allocating.
+  public static void appendFixed3(StringBuilder builder, float value) {
+    long thousandths = Math.round(value * 1000.0);
+    if (thousandths < 0) {
+      builder.append('-');
+      thousandths = -thousandths;
+    }
+    builder.append(thousandths / 1000).append('.');
+    long fraction = thousandths % 1000;
+    if (fraction < 100) {
+      builder.append('0');
+    }
+    if (fraction < 10) {
+      builder.append('0');
+    }
+    builder.append(fraction);
+  }
+}
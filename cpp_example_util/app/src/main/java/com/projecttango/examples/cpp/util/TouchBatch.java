@@ -0,0 +1,110 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.projecttango.examples.cpp.util;
+
+import android.view.MotionEvent;
+
+/**
+ * Collects the touch samples of the UI thread for the GL thread to hand to
+ * the native code in one call per frame, as the floats a native
+ * tango_util::TouchQueue posts:
+ *
+ *   // UI thread, in onTouchEvent().
+ *   mTouchBatch.addMoves(event, 1.0f / mScreenSize.x, 1.0f / mScreenSize.y);
+ *
+ *   // GL thread, in onDrawFrame().
+ *   int sampleCount = mTouchBatch.take();
+ *   if (sampleCount > 0) {
+ *     TangoJNINative.onTouchEvents(mTouchBatch.getTaken(), sampleCount);
+ *   }
+ *   TangoJNINative.render();
+ *
+ * The arrays are swapped rather than allocated, so a frame allocates nothing
+ * unless it has more samples than any before.
+ */
+public class TouchBatch {
+  // Floats per sample: the touch count, the event, and x0, y0, x1, y1.
+  public static final int SAMPLE_SIZE = 6;
+
+  private static final int INITIAL_SAMPLE_COUNT = 32;
+
+  private float[] mSamples = new float[INITIAL_SAMPLE_COUNT * SAMPLE_SIZE];
+  private float[] mTaken = new float[INITIAL_SAMPLE_COUNT * SAMPLE_SIZE];
+  private int mSampleCount;
+
+  // Add a sample, |event| being a MotionEvent action.
+  //
+  // @return true if it is the first of the batch, for an app that renders on
+  //     demand to request a frame.
+  public synchronized boolean add(int touchCount, int event, float x0,
+                                  float y0, float x1, float y1) {
+    if ((mSampleCount + 1) * SAMPLE_SIZE > mSamples.length) {
+      float[] samples = new float[mSamples.length * 2];
+      System.arraycopy(mSamples, 0, samples, 0, mSampleCount * SAMPLE_SIZE);
+      mSamples = samples;
+    }
+    int offset = mSampleCount * SAMPLE_SIZE;
+    mSamples[offset] = touchCount;
+    mSamples[offset + 1] = event;
+    mSamples[offset + 2] = x0;
+    mSamples[offset + 3] = y0;
+    mSamples[offset + 4] = x1;
+    mSamples[offset + 5] = y1;
+    ++mSampleCount;
+    return mSampleCount == 1;
+  }
+
+  // Add the historical samples of a move |event| of one or two touches, then
+  // its current one, the positions scaled by |scaleX| and |scaleY|.
+  //
+  // @return true if the first sample is the first of the batch.
+  public boolean addMoves(MotionEvent event, float scaleX, float scaleY) {
+    int touchCount = Math.min(event.getPointerCount(), 2);
+    int second = touchCount - 1;
+    boolean isFirst = false;
+    for (int h = 0; h < event.getHistorySize(); ++h) {
+      isFirst |= add(touchCount, MotionEvent.ACTION_MOVE,
+                     event.getHistoricalX(0, h) * scaleX,
+                     event.getHistoricalY(0, h) * scaleY,
+                     event.getHistoricalX(second, h) * scaleX,
+                     event.getHistoricalY(second, h) * scaleY);
+    }
+    isFirst |= add(touchCount, MotionEvent.ACTION_MOVE,
+                   event.getX(0) * scaleX, event.getY(0) * scaleY,
+                   event.getX(second) * scaleX, event.getY(second) * scaleY);
+    return isFirst;
+  }
+
+  // Swap out the samples added since the previous call, into getTaken().
+  //
+  // @return the sample count.
+  public synchronized int take() {
+    float[] samples = mTaken;
+    mTaken = mSamples;
+    mSamples = samples.length >= mTaken.length ? samples
+                                               : new float[mTaken.length];
+    int sampleCount = mSampleCount;
+    mSampleCount = 0;
+    return sampleCount;
+  }
+
+  // @return the samples of the last take(), only read on the thread calling
+  //     it.
+  public float[] getTaken() {
+    return mTaken;
+  }
+}
@@ -0,0 +1,268 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.projecttango.examples.cpp.meshbuilder;
+
+import android.app.Activity;
+import android.content.ComponentName;
+import android.content.ServiceConnection;
+import android.graphics.Point;
+import android.opengl.GLSurfaceView;
+import android.os.Bundle;
+import android.os.Handler;
+import android.os.IBinder;
+import android.util.Log;
+import android.view.Display;
+import android.view.MotionEvent;
+import android.view.View;
+import android.view.View.OnClickListener;
+import android.widget.TextView;
+import android.widget.Toast;
+
+import java.io.File;
+
+import com.projecttango.examples.cpp.util.TangoInitializationHelper;
+
+/**
+ * The main activity of the application. This activity shows debug information
+ * and a glSurfaceView that renders the mesh built from the depth frames.
+ */
+public class MeshBuilderActivity extends Activity implements OnClickListener {
+  // The minimum Tango Core version required from this application.
+  private static final int  MIN_TANGO_CORE_VERSION = 9377;
+
+  // Tag for debug logging.
+  private static final String TAG = MeshBuilderActivity.class.getSimpleName();
+
+  // The interval at which we'll update our UI debug text in milliseconds.
+  private static final int UPDATE_UI_INTERVAL_MS = 100;
+
+  // Name of the exported mesh, in the external files directory of the app.
+  private static final String EXPORT_FILE_NAME = "mesh.obj";
+
+  // Number of blocks allocated in the volume.
+  private TextView mBlockCount;
+  // Number of faces of the mesh built so far.
+  private TextView mFaceCount;
+
+  // GLSurfaceView and renderer, all of the graphic content is rendered
+  // through OpenGL ES 2.0 in native code.
+  private Renderer mRenderer;
+  private GLSurfaceView mGLView;
+
+  // Screen size for normalizing the touch input for orbiting the render camera.
+  private Point mScreenSize = new Point();
+
+  // Handles the debug text UI update loop.
+  private Handler mHandler = new Handler();
+
+  // Tango Service connection.
+  ServiceConnection mTangoServiceConnection = new ServiceConnection() {
+    public void onServiceConnected(ComponentName name, IBinder service) {
+      TangoJNINative.onTangoServiceConnected(service);
+
+      // Setup the configuration for the TangoService.
+      TangoJNINative.setupConfig();
+
+      // Connect the onXYZijAvailable callback.
+      TangoJNINative.connectCallbacks();
+
+      // Connect to Tango Service (returns true on success).
+      // Starts Motion Tracking and Depth Sensing.
+      if (!TangoJNINative.connect()) {
+        runOnUiThread(new Runnable() {
+            @Override
+            public void run() {
+              // End the activity and let the user know something went wrong.
+              Toast.makeText(MeshBuilderActivity.this,
+                             "Connect Tango Service Error",
+                             Toast.LENGTH_LONG).show();
+              finish();
+              return;
+            }
+          });
+      }
+    }
+
+    public void onServiceDisconnected(ComponentName name) {
+      // Handle this if you need to gracefully shutdown/retry
+      // in the event that Tango itself crashes/gets upgraded while running.
+    }
+  };
+
+  @Override
+  protected void onCreate(Bundle savedInstanceState) {
+    super.onCreate(savedInstanceState);
+
+    // Query screen size, the screen size is used for computing the normalized
+    // touch point.
+    Display display = getWindowManager().getDefaultDisplay();
+    display.getSize(mScreenSize);
+
+    // Setting content view of this activity.
+    setContentView(R.layout.activity_mesh_builder);
+
+    mBlockCount = (TextView) findViewById(R.id.block_count);
+    mFaceCount = (TextView) findViewById(R.id.face_count);
+
+    // Buttons for selecting camera view, clearing and exporting the mesh.
+    findViewById(R.id.first_person_button).setOnClickListener(this);
+    findViewById(R.id.third_person_button).setOnClickListener(this);
+    findViewById(R.id.top_down_button).setOnClickListener(this);
+    findViewById(R.id.clear_button).setOnClickListener(this);
+    findViewById(R.id.export_button).setOnClickListener(this);
+
+    // OpenGL view where all of the graphics are drawn.
+    mGLView = (GLSurfaceView) findViewById(R.id.gl_surface_view);
+
+    // Configure OpenGL renderer
+    mGLView.setEGLContextClientVersion(2);
+
+    // Configure the OpenGL renderer.
+    mRenderer = new Renderer();
+    mGLView.setRenderer(mRenderer);
+
+    // Check if the Tango Core is out of date.
+    if (!TangoJNINative.checkTangoVersion(this, MIN_TANGO_CORE_VERSION)) {
+      Toast.makeText(this, "Tango Core out of date, please update in Play Store",
+                     Toast.LENGTH_LONG).show();
+      finish();
+      return;
+    }
+  }
+
+  @Override
+  protected void onResume() {
+    super.onResume();
+    mGLView.onResume();
+
+    TangoInitializationHelper.bindTangoService(this, mTangoServiceConnection);
+
+    // Start the debug text UI update loop.
+    mHandler.post(mUpdateUiLoopRunnable);
+  }
+
+  @Override
+  protected void onPause() {
+    super.onPause();
+    mGLView.onPause();
+    // Delete all the non-OpenGl resources.
+    TangoJNINative.deleteResources();
+
+    // Stop the debug text UI update loop.
+    mHandler.removeCallbacksAndMessages(null);
+
+    // Disconnect from Tango Service, release all the resources that the app is
+    // holding from Tango Service.
+    TangoJNINative.disconnect();
+    unbindService(mTangoServiceConnection);
+  }
+
+  @Override
+  public void onClick(View v) {
+    // Handle button clicks.
+    switch (v.getId()) {
+    case R.id.first_person_button:
+      TangoJNINative.setCamera(0);
+      break;
+    case R.id.third_person_button:
+      TangoJNINative.setCamera(1);
+      break;
+    case R.id.top_down_button:
+      TangoJNINative.setCamera(2);
+      break;
+    case R.id.clear_button:
+      TangoJNINative.clearMesh();
+      break;
+    case R.id.export_button:
+      exportMesh();
+      break;
+    default:
+      return;
+    }
+  }
+
+  @Override
+  public boolean onTouchEvent(MotionEvent event) {
+    // Pass the touch event to the native layer for camera control.
+    // Single touch to rotate the camera around the device.
+    // Two fingers to zoom in and out.
+    int pointCount = event.getPointerCount();
+    if (pointCount == 1) {
+      float normalizedX = event.getX(0) / mScreenSize.x;
+      float normalizedY = event.getY(0) / mScreenSize.y;
+      TangoJNINative.onTouchEvent(1, event.getActionMasked(),
+                                  normalizedX, normalizedY, 0.0f, 0.0f);
+    }
+    if (pointCount == 2) {
+      if (event.getActionMasked() == MotionEvent.ACTION_POINTER_UP) {
+        int index = event.getActionIndex() == 0 ? 1 : 0;
+        float normalizedX = event.getX(index) / mScreenSize.x;
+        float normalizedY = event.getY(index) / mScreenSize.y;
+        TangoJNINative.onTouchEvent(1, MotionEvent.ACTION_DOWN,
+                                    normalizedX, normalizedY, 0.0f, 0.0f);
+      } else {
+        float normalizedX0 = event.getX(0) / mScreenSize.x;
+        float normalizedY0 = event.getY(0) / mScreenSize.y;
+        float normalizedX1 = event.getX(1) / mScreenSize.x;
+        float normalizedY1 = event.getY(1) / mScreenSize.y;
+        TangoJNINative.onTouchEvent(2, event.getActionMasked(),
+                                    normalizedX0, normalizedY0,
+                                    normalizedX1, normalizedY1);
+      }
+    }
+    return true;
+  }
+
+  // Simplify and write the mesh off the UI thread, it can take a few seconds.
+  private void exportMesh() {
+    final File file = new File(getExternalFilesDir(null), EXPORT_FILE_NAME);
+    new Thread(new Runnable() {
+        public void run() {
+          final boolean exported =
+              TangoJNINative.exportMesh(file.getAbsolutePath());
+          runOnUiThread(new Runnable() {
+              @Override
+              public void run() {
+                Toast.makeText(MeshBuilderActivity.this,
+                               exported ? "Mesh exported to " + file.getPath()
+                                        : "Mesh export failed",
+                               Toast.LENGTH_LONG).show();
+              }
+            });
+        }
+      }).start();
+  }
+
+  // Debug text UI update loop, updating at 10Hz.
+  private Runnable mUpdateUiLoopRunnable = new Runnable() {
+      public void run() {
+        updateUi();
+        mHandler.postDelayed(this, UPDATE_UI_INTERVAL_MS);
+      }
+    };
+
+  // Update the debug text UI.
+  private void updateUi() {
+    try {
+      mBlockCount.setText(String.valueOf(TangoJNINative.getBlockCount()));
+      mFaceCount.setText(String.valueOf(TangoJNINative.getFaceCount()));
+    } catch (Exception e) {
+      e.printStackTrace();
+      Log.e(TAG, "Exception updateing UI elements");
+    }
+  }
+}
@@ -0,0 +1,41 @@
+#
+# Copyright 2014 Google Inc. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+LOCAL_PATH := $(call my-dir)
+PROJECT_ROOT_FROM_JNI:= ../../../../..
+PROJECT_ROOT:= $(call my-dir)/../../../../..
+
+include $(CLEAR_VARS)
+LOCAL_MODULE    := libcpp_mesh_builder_example
+LOCAL_SHARED_LIBRARIES := tango_client_api tango_support_api
+LOCAL_STATIC_LIBRARIES := tango_util tango_gl
+LOCAL_CFLAGS    := -std=c++11
+
+LOCAL_C_INCLUDES := $(PROJECT_ROOT)/tango-service-sdk/include/
+
+LOCAL_SRC_FILES := block_mesh_drawable.cc \
+                   jni_interface.cc \
+                   mesh_builder_app.cc \
+                   scene.cc \
+                   volume_raycaster.cc
+
+LOCAL_LDLIBS    := -llog -lGLESv2 -lEGL -L$(SYSROOT)/usr/lib
+include $(BUILD_SHARED_LIBRARY)
+
+$(call import-add-path, $(PROJECT_ROOT))
+$(call import-module,tango_client_api)
+$(call import-module,tango_support_api)
+$(call import-module,tango_gl)
+$(call import-module,tango_util)
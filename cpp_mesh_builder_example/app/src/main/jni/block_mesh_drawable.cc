@@ -0,0 +1,372 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <limits>
+#include <vector>
+
+#include <tango-gl/gl_state.h>
+#include <tango-gl/render_statistics.h>
+#include <tango-gl/shaders.h>
+#include <tango-gl/view_frustum.h>
+
+#include "tango-mesh-builder/block_mesh_drawable.h"
+
+namespace {
+// Initial size of the upload scratch, grown to the largest block.
+const size_t kUploadArenaCapacity = 64 * 1024;
+
+// Lit from above, and tinted by the normal in the OpenGL world so the
+// orientation of the surfaces stands out.
+const char kBlockVertexShader[] =
+    TANGO_GL_GLSL_MEDIUMP
+    "attribute vec4 vertex;\n"
+    "attribute vec3 normal;\n"
+    "uniform mat4 mvp;\n"
+    "uniform mat4 model;\n"
+    "varying vec4 v_color;\n"
+    "void main() {\n"
+    "  vec3 world_normal = normalize(vec3(model * vec4(normal, 0.0)));\n"
+    "  float diffuse = max(dot(world_normal, vec3(0.0, 1.0, 0.0)), 0.0);\n"
+    "  vec3 tint = world_normal * 0.25 + vec3(0.65);\n"
+    "  v_color = vec4(tint * (0.5 + 0.5 * diffuse), 1.0);\n"
+    "  gl_Position = mvp * vertex;\n"
+    "}\n";
+const char kBlockFragmentShader[] =
+    TANGO_GL_GLSL_MEDIUMP
+    "varying vec4 v_color;\n"
+    "void main() {\n"
+    "  gl_FragColor = v_color;\n"
+    "}\n";
+
+// The atlas is baked from the camera images, its colors are drawn as they
+// are.
+const char kTexturedVertexShader[] =
+    TANGO_GL_GLSL_MEDIUMP
+    "attribute vec4 vertex;\n"
+    "attribute vec2 uv;\n"
+    "uniform mat4 mvp;\n"
+    "varying vec2 v_uv;\n"
+    "void main() {\n"
+    "  v_uv = uv;\n"
+    "  gl_Position = mvp * vertex;\n"
+    "}\n";
+const char kTexturedFragmentShader[] =
+    TANGO_GL_GLSL_MEDIUMP
+    "uniform sampler2D atlas;\n"
+    "varying vec2 v_uv;\n"
+    "void main() {\n"
+    "  gl_FragColor = texture2D(atlas, v_uv);\n"
+    "}\n";
+
+// Interleaved position and normal.
+const int kVertexFloats = 6;
+const GLsizei kVertexStride = kVertexFloats * sizeof(GLfloat);
+
+// Interleaved position and texture coordinates.
+const int kTexturedVertexFloats = 5;
+const GLsizei kTexturedVertexStride = kTexturedVertexFloats * sizeof(GLfloat);
+}  // namespace
+
+namespace tango_mesh_builder {
+
+BlockMeshDrawable::BlockMeshDrawable()
+    : upload_arena_(kUploadArenaCapacity),
+      shader_program_(0),
+      textured_program_(0),
+      atlas_texture_(0),
+      atlas_size_(0),
+      atlas_memory_(tango_gl::kMemoryTagTexture, tango_gl::kMemoryGpu) {
+  const tango_gl::util::SharedProgram* program =
+      tango_gl::util::GetSharedProgram(kBlockVertexShader,
+                                       kBlockFragmentShader);
+  if (!program) {
+    LOGE("Could not create program.");
+    return;
+  }
+  shader_program_ = program->GetId();
+  mvp_handle_ = program->GetUniformLocation("mvp");
+  model_handle_ = program->GetUniformLocation("model");
+  vertices_handle_ = program->GetAttribLocation("vertex");
+  normals_handle_ = program->GetAttribLocation("normal");
+
+  const tango_gl::util::SharedProgram* textured_program =
+      tango_gl::util::GetSharedProgram(kTexturedVertexShader,
+                                       kTexturedFragmentShader);
+  if (!textured_program) {
+    LOGE("Could not create the textured program.");
+    return;
+  }
+  textured_program_ = textured_program->GetId();
+  textured_mvp_handle_ = textured_program->GetUniformLocation("mvp");
+  textured_atlas_handle_ = textured_program->GetUniformLocation("atlas");
+  textured_vertices_handle_ = textured_program->GetAttribLocation("vertex");
+  textured_uvs_handle_ = textured_program->GetAttribLocation("uv");
+}
+
+BlockMeshDrawable::~BlockMeshDrawable() { DeleteGlResources(); }
+
+void BlockMeshDrawable::DeleteGlResources() {
+  Clear();
+  // The programs are owned by tango_gl::util::GetSharedProgram().
+  shader_program_ = 0;
+  textured_program_ = 0;
+  if (atlas_texture_ != 0) {
+    glDeleteTextures(1, &atlas_texture_);
+    atlas_texture_ = 0;
+    atlas_size_ = 0;
+    atlas_memory_.Set(0);
+  }
+}
+
+void BlockMeshDrawable::DeleteBuffers(BlockBuffers* buffers) {
+  tango_gl::GlState::DeleteBuffers(1, &buffers->vertex_buffer);
+  tango_gl::GlState::DeleteBuffers(1, &buffers->index_buffer);
+}
+
+BlockMeshDrawable::BlockBuffers* BlockMeshDrawable::GetBuffers(
+    const BlockIndex& index) {
+  std::pair<std::map<BlockIndex, BlockBuffers>::iterator, bool> inserted =
+      blocks_.insert(std::make_pair(index, BlockBuffers()));
+  BlockBuffers* buffers = &inserted.first->second;
+  if (inserted.second) {
+    glGenBuffers(1, &buffers->vertex_buffer);
+    glGenBuffers(1, &buffers->index_buffer);
+  }
+  return buffers;
+}
+
+void BlockMeshDrawable::RemoveBlock(const BlockIndex& index) {
+  std::map<BlockIndex, BlockBuffers>::iterator it = blocks_.find(index);
+  if (it != blocks_.end()) {
+    DeleteBuffers(&it->second);
+    blocks_.erase(it);
+  }
+}
+
+void BlockMeshDrawable::Clear() {
+  for (std::pair<const BlockIndex, BlockBuffers>& block : blocks_) {
+    DeleteBuffers(&block.second);
+  }
+  blocks_.clear();
+}
+
+void BlockMeshDrawable::UpdateBlock(const TangoMesh_Experimental& mesh) {
+  const BlockIndex index = GetBlockIndex(mesh);
+  // 16 bit indices address the at most (kBlockSize + 1)^3 * 3 vertices of a
+  // block, so no extension is needed.
+  if (mesh.num_faces == 0 || !mesh.has_normals ||
+      mesh.num_vertices > std::numeric_limits<GLushort>::max()) {
+    RemoveBlock(index);
+    return;
+  }
+
+  tango_util::ArenaVector<GLfloat> vertices(
+      mesh.num_vertices * kVertexFloats,
+      tango_util::ArenaAllocator<GLfloat>(&upload_arena_));
+  glm::vec3 bounds_min(std::numeric_limits<float>::max());
+  glm::vec3 bounds_max(-std::numeric_limits<float>::max());
+  for (uint32_t i = 0; i < mesh.num_vertices; ++i) {
+    GLfloat* vertex = &vertices[i * kVertexFloats];
+    for (int k = 0; k < 3; ++k) {
+      vertex[k] = mesh.vertices[i][k];
+      vertex[3 + k] = mesh.normals[i][k];
+    }
+    const glm::vec3 position(vertex[0], vertex[1], vertex[2]);
+    bounds_min = glm::min(bounds_min, position);
+    bounds_max = glm::max(bounds_max, position);
+  }
+  tango_util::ArenaVector<GLushort> indices(
+      mesh.num_faces * 3,
+      tango_util::ArenaAllocator<GLushort>(&upload_arena_));
+  for (uint32_t i = 0; i < mesh.num_faces; ++i) {
+    for (int k = 0; k < 3; ++k) {
+      indices[i * 3 + k] = static_cast<GLushort>(mesh.faces[i][k]);
+    }
+  }
+
+  BlockBuffers& buffers = *GetBuffers(index);
+  buffers.index_count = static_cast<GLsizei>(indices.size());
+  buffers.is_textured = false;
+  buffers.bounds = tango_gl::BoundingBox(bounds_min, bounds_max);
+
+  tango_gl::GlState::BindBuffer(GL_ARRAY_BUFFER, buffers.vertex_buffer);
+  glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat),
+               vertices.data(), GL_STATIC_DRAW);
+  tango_gl::GlState::BindBuffer(GL_ARRAY_BUFFER, 0);
+  tango_gl::GlState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers.index_buffer);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort),
+               indices.data(), GL_STATIC_DRAW);
+  tango_gl::GlState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+  tango_gl::util::CheckGlError("BlockMeshDrawable::UpdateBlock()");
+  // The vectors are not used past this point.
+  upload_arena_.Reset();
+}
+
+void BlockMeshDrawable::UpdateTexturedBlock(const TangoMesh_Experimental& mesh,
+                                            const std::vector<GLfloat>& uvs) {
+  const BlockIndex index = GetBlockIndex(mesh);
+  if (mesh.num_faces == 0 || uvs.size() != mesh.num_faces * 6) {
+    RemoveBlock(index);
+    return;
+  }
+
+  const uint32_t corner_count = mesh.num_faces * 3;
+  tango_util::ArenaVector<GLfloat> vertices(
+      corner_count * kTexturedVertexFloats,
+      tango_util::ArenaAllocator<GLfloat>(&upload_arena_));
+  glm::vec3 bounds_min(std::numeric_limits<float>::max());
+  glm::vec3 bounds_max(-std::numeric_limits<float>::max());
+  for (uint32_t i = 0; i < corner_count; ++i) {
+    const float* position = mesh.vertices[mesh.faces[i / 3][i % 3]];
+    GLfloat* vertex = &vertices[i * kTexturedVertexFloats];
+    for (int k = 0; k < 3; ++k) {
+      vertex[k] = position[k];
+    }
+    vertex[3] = uvs[i * 2];
+    vertex[4] = uvs[i * 2 + 1];
+    const glm::vec3 point(position[0], position[1], position[2]);
+    bounds_min = glm::min(bounds_min, point);
+    bounds_max = glm::max(bounds_max, point);
+  }
+
+  BlockBuffers& buffers = *GetBuffers(index);
+  buffers.index_count = static_cast<GLsizei>(corner_count);
+  buffers.is_textured = true;
+  buffers.bounds = tango_gl::BoundingBox(bounds_min, bounds_max);
+
+  tango_gl::GlState::BindBuffer(GL_ARRAY_BUFFER, buffers.vertex_buffer);
+  glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat),
+               vertices.data(), GL_STATIC_DRAW);
+  tango_gl::GlState::BindBuffer(GL_ARRAY_BUFFER, 0);
+  tango_gl::util::CheckGlError("BlockMeshDrawable::UpdateTexturedBlock()");
+  upload_arena_.Reset();
+}
+
+void BlockMeshDrawable::AllocateAtlas(int size) {
+  if (atlas_texture_ != 0 && atlas_size_ == size) {
+    return;
+  }
+  if (atlas_texture_ == 0) {
+    glGenTextures(1, &atlas_texture_);
+  }
+  atlas_size_ = size;
+  tango_gl::CountRender(tango_gl::kRenderCounterTextureBinds);
+  glBindTexture(GL_TEXTURE_2D, atlas_texture_);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, size, size, 0, GL_RGB,
+               GL_UNSIGNED_BYTE, nullptr);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  atlas_memory_.Set(tango_gl::EstimateTextureBytes(size, size, GL_RGB,
+                                                   GL_UNSIGNED_BYTE));
+  tango_gl::util::CheckGlError("BlockMeshDrawable::AllocateAtlas()");
+}
+
+void BlockMeshDrawable::UpdateAtlasRows(int y, int height,
+                                        const uint8_t* rows) {
+  if (atlas_texture_ == 0) {
+    return;
+  }
+  tango_gl::CountRender(tango_gl::kRenderCounterTextureBinds);
+  glBindTexture(GL_TEXTURE_2D, atlas_texture_);
+  // The RGB rows are tightly packed.
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y, atlas_size_, height, GL_RGB,
+                  GL_UNSIGNED_BYTE, rows);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  tango_gl::util::CheckGlError("BlockMeshDrawable::UpdateAtlasRows()");
+}
+
+void BlockMeshDrawable::Render(const glm::mat4& projection_mat,
+                               const glm::mat4& view_mat,
+                               const glm::mat4& model_mat) {
+  if (shader_program_ == 0 || blocks_.empty()) {
+    return;
+  }
+  const tango_gl::ViewFrustum frustum(projection_mat, view_mat);
+  const glm::mat4 mvp_mat = projection_mat * view_mat * model_mat;
+  bool has_textured_blocks = false;
+
+  tango_gl::GlState::UseProgram(shader_program_);
+  glUniformMatrix4fv(mvp_handle_, 1, GL_FALSE, glm::value_ptr(mvp_mat));
+  glUniformMatrix4fv(model_handle_, 1, GL_FALSE, glm::value_ptr(model_mat));
+  glEnableVertexAttribArray(vertices_handle_);
+  glEnableVertexAttribArray(normals_handle_);
+
+  for (const std::pair<const BlockIndex, BlockBuffers>& block : blocks_) {
+    const BlockBuffers& buffers = block.second;
+    if (buffers.is_textured) {
+      has_textured_blocks = true;
+      continue;
+    }
+    if (!frustum.IsVisible(buffers.bounds.GetTransformed(model_mat))) {
+      continue;
+    }
+    tango_gl::GlState::BindBuffer(GL_ARRAY_BUFFER, buffers.vertex_buffer);
+    glVertexAttribPointer(vertices_handle_, 3, GL_FLOAT, GL_FALSE,
+                          kVertexStride, nullptr);
+    glVertexAttribPointer(normals_handle_, 3, GL_FLOAT, GL_FALSE, kVertexStride,
+                          reinterpret_cast<const GLvoid*>(3 * sizeof(GLfloat)));
+    tango_gl::GlState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER,
+                                  buffers.index_buffer);
+    glDrawElements(GL_TRIANGLES, buffers.index_count, GL_UNSIGNED_SHORT,
+                   nullptr);
+  }
+
+  tango_gl::GlState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+  glDisableVertexAttribArray(vertices_handle_);
+  glDisableVertexAttribArray(normals_handle_);
+
+  if (has_textured_blocks && textured_program_ != 0 && atlas_texture_ != 0) {
+    tango_gl::GlState::UseProgram(textured_program_);
+    glUniformMatrix4fv(textured_mvp_handle_, 1, GL_FALSE,
+                       glm::value_ptr(mvp_mat));
+    glActiveTexture(GL_TEXTURE0);
+    tango_gl::CountRender(tango_gl::kRenderCounterTextureBinds);
+    glBindTexture(GL_TEXTURE_2D, atlas_texture_);
+    glUniform1i(textured_atlas_handle_, 0);
+    glEnableVertexAttribArray(textured_vertices_handle_);
+    glEnableVertexAttribArray(textured_uvs_handle_);
+
+    for (const std::pair<const BlockIndex, BlockBuffers>& block : blocks_) {
+      const BlockBuffers& buffers = block.second;
+      if (!buffers.is_textured ||
+          !frustum.IsVisible(buffers.bounds.GetTransformed(model_mat))) {
+        continue;
+      }
+      tango_gl::GlState::BindBuffer(GL_ARRAY_BUFFER, buffers.vertex_buffer);
+      glVertexAttribPointer(textured_vertices_handle_, 3, GL_FLOAT, GL_FALSE,
+                            kTexturedVertexStride, nullptr);
+      glVertexAttribPointer(
+          textured_uvs_handle_, 2, GL_FLOAT, GL_FALSE, kTexturedVertexStride,
+          reinterpret_cast<const GLvoid*>(3 * sizeof(GLfloat)));
+      glDrawArrays(GL_TRIANGLES, 0, buffers.index_count);
+    }
+
+    glDisableVertexAttribArray(textured_vertices_handle_);
+    glDisableVertexAttribArray(textured_uvs_handle_);
+    glBindTexture(GL_TEXTURE_2D, 0);
+  }
+
+  tango_gl::GlState::BindBuffer(GL_ARRAY_BUFFER, 0);
+  tango_gl::GlState::UseProgram(0);
+  tango_gl::util::CheckGlError("BlockMeshDrawable::Render()");
+}
+
+}  // namespace tango_mesh_builder
@@ -0,0 +1,751 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <tuple>
+
+#include <tango-gl/conversions.h>
+#include <tango-gl/tracing.h>
+#include <tango-util/pose_source.h>
+
+#include "tango-mesh-builder/mesh_builder_app.h"
+
+namespace {
+// Only the latest depth frame is fused when fusing falls behind.
+const size_t kPointCloudQueueCapacity = 1;
+
+// Exported meshes are simplified down to this many faces.
+const uint32_t kMaxExportFaceCount = 100000;
+
+// Vertices of neighboring blocks closer than 1 / kWeldScale meters are merged
+// on export, so the simplification sees a connected surface.
+const double kWeldScale = 10000.0;
+
+// Largest color image the keyframe slots are allocated for.
+const int kMaxColorImageWidth = 1920;
+const int kMaxColorImageHeight = 1080;
+
+// Work budget of a frame on the render thread, in milliseconds.
+constexpr double kFrameBudget = 12.0;
+
+// This function routes onXYZijAvailable callbacks to the application object for
+// handling.
+//
+// @param context, context will be a pointer to a MeshBuilderApp
+//        instance on which to call callbacks.
+// @param xyz_ij, point cloud data to route to onPointCloudAvailable function.
+void onPointCloudAvailableRouter(void* context, const TangoXYZij* xyz_ij) {
+  tango_mesh_builder::MeshBuilderApp* app =
+      static_cast<tango_mesh_builder::MeshBuilderApp*>(context);
+  app->onPointCloudAvailable(xyz_ij);
+}
+
+// This function routes the color camera callbacks to the application object.
+void OnFrameAvailableRouter(void* context, TangoCameraId /*camera_id*/,
+                            const TangoImageBuffer* buffer) {
+  tango_mesh_builder::MeshBuilderApp* app =
+      static_cast<tango_mesh_builder::MeshBuilderApp*>(context);
+  app->OnFrameAvailable(buffer);
+}
+
+// Position of a vertex rounded for welding.
+std::tuple<int64_t, int64_t, int64_t> GetWeldKey(const float* vertex) {
+  return std::make_tuple(std::llround(vertex[0] * kWeldScale),
+                         std::llround(vertex[1] * kWeldScale),
+                         std::llround(vertex[2] * kWeldScale));
+}
+}  // namespace
+
+namespace tango_mesh_builder {
+void MeshBuilderApp::onPointCloudAvailable(const TangoXYZij* xyz_ij) {
+  TANGO_TRACE_SCOPE("MeshBuilderApp::onPointCloudAvailable");
+  // The points are only valid during the callback, so they are copied here.
+  {
+    std::lock_guard<tango_gl::ProfiledMutex> lock(point_cloud_mutex_);
+    if (point_cloud_manager_ != nullptr) {
+      TangoSupport_updatePointCloud(point_cloud_manager_, xyz_ij);
+    }
+  }
+  point_cloud_queue_.Post(xyz_ij->timestamp);
+}
+
+void MeshBuilderApp::OnFrameAvailable(const TangoImageBuffer* buffer) {
+  TANGO_TRACE_SCOPE("MeshBuilderApp::OnFrameAvailable");
+  glm::mat4 start_service_T_device;
+  if (!GetDevicePose(buffer->timestamp, &start_service_T_device)) {
+    return;
+  }
+  keyframes_.OnFrameAvailable(
+      buffer, start_service_T_device * extrinsics_.GetDeviceTColorCamera());
+}
+
+void MeshBuilderApp::HandlePointCloud(double /*timestamp*/) {
+  TANGO_TRACE_SCOPE("MeshBuilderApp::HandlePointCloud");
+  // The exporter reads the block meshes without mesh_mutex_, they must not
+  // change until it is done.
+  if (exporter_.IsBusy()) {
+    return;
+  }
+  std::string export_path;
+  {
+    std::lock_guard<std::mutex> lock(export_mutex_);
+    export_path.swap(export_path_);
+  }
+  if (!export_path.empty()) {
+    std::vector<const TangoMesh_Experimental*> meshes;
+    {
+      std::lock_guard<tango_gl::ProfiledMutex> lock(mesh_mutex_);
+      meshes.reserve(block_meshes_.size());
+      for (const std::pair<const BlockIndex, TangoMesh_Experimental>& block :
+           block_meshes_) {
+        meshes.push_back(&block.second);
+      }
+    }
+    if (exporter_.ExportMeshes(export_path.c_str(), meshes)) {
+      return;
+    }
+    LOGE("MeshBuilderApp: No mesh to export");
+  }
+
+  if (is_clear_requested_.exchange(false)) {
+    volume_.Clear();
+    // The keyframes are kept to texture what is fused next.
+    baker_.Clear();
+    std::lock_guard<tango_gl::ProfiledMutex> lock(mesh_mutex_);
+    FreeBlockMeshes();
+    block_uvs_.clear();
+    changed_blocks_.clear();
+    is_mesh_cleared_ = true;
+    pending_distances_.clear();
+    is_distance_cleared_ = true;
+  }
+  if (is_distance_resync_requested_.exchange(false)) {
+    volume_.InvalidateBlockDistances();
+  }
+
+  // The latest point cloud is swapped into the consumer buffer of the
+  // manager, this thread is its only consumer.
+  TangoXYZij* point_cloud = nullptr;
+  bool new_points = false;
+  int max_point_cloud_elements;
+  {
+    std::lock_guard<tango_gl::ProfiledMutex> lock(point_cloud_mutex_);
+    max_point_cloud_elements = max_point_cloud_elements_;
+    if (point_cloud_manager_ != nullptr) {
+      TangoSupport_getLatestPointCloudAndNewDataFlag(
+          point_cloud_manager_, &point_cloud, &new_points);
+    }
+  }
+  if (!new_points || point_cloud == nullptr || point_cloud->xyz_count == 0) {
+    return;
+  }
+
+  glm::mat4 start_service_T_device;
+  if (!GetDevicePose(point_cloud->timestamp, &start_service_T_device)) {
+    return;
+  }
+
+  if (voxel_filter_.GetCapacity() <
+      static_cast<uint32_t>(max_point_cloud_elements)) {
+    voxel_filter_.Reserve(max_point_cloud_elements);
+  }
+  const TangoXYZij* filtered_point_cloud;
+  {
+    TANGO_TRACE_SCOPE("VoxelGridFilter::Filter");
+    filtered_point_cloud = voxel_filter_.Filter(point_cloud);
+  }
+  {
+    TANGO_TRACE_SCOPE("TsdfVolume::Integrate");
+    volume_.Integrate(filtered_point_cloud,
+                      start_service_T_device *
+                          extrinsics_.GetDeviceTDepthCamera());
+  }
+  block_count_.store(static_cast<int>(volume_.GetBlockCount()));
+  if (is_raycast_preview_enabled_.load()) {
+    // The blocks stay marked for meshing until the preview is turned off.
+    PublishDistances();
+    return;
+  }
+  {
+    TANGO_TRACE_SCOPE("TsdfVolume::ExtractMeshes");
+    volume_.ExtractMeshes(&extracted_meshes_);
+  }
+  // Logged when the scratch arenas grow, which must stop after warm-up.
+  const uint64_t mesh_scratch_allocation_count =
+      volume_.GetScratchAllocationCount();
+  if (mesh_scratch_allocation_count != mesh_scratch_allocation_count_) {
+    mesh_scratch_allocation_count_ = mesh_scratch_allocation_count;
+    LOGI("MeshBuilderApp: Meshing scratch grew, %llu heap blocks so far",
+         static_cast<unsigned long long>(  // NOLINT
+             mesh_scratch_allocation_count));
+  }
+  PublishMeshes(&extracted_meshes_);
+  BakeTextures();
+}
+
+void MeshBuilderApp::PublishDistances() {
+  {
+    TANGO_TRACE_SCOPE("TsdfVolume::ExtractBlockDistances");
+    volume_.ExtractBlockDistances(&extracted_distances_);
+  }
+  if (extracted_distances_.empty()) {
+    return;
+  }
+  std::lock_guard<tango_gl::ProfiledMutex> lock(mesh_mutex_);
+  if (pending_distances_.empty()) {
+    pending_distances_.swap(extracted_distances_);
+  } else {
+    pending_distances_.insert(pending_distances_.end(),
+                              extracted_distances_.begin(),
+                              extracted_distances_.end());
+  }
+  extracted_distances_.clear();
+}
+
+void MeshBuilderApp::PublishMeshes(
+    std::vector<TangoMesh_Experimental>* meshes) {
+  std::lock_guard<tango_gl::ProfiledMutex> lock(mesh_mutex_);
+  for (TangoMesh_Experimental& mesh : *meshes) {
+    const BlockIndex index = GetBlockIndex(mesh);
+    std::map<BlockIndex, TangoMesh_Experimental>::iterator it =
+        block_meshes_.find(index);
+    if (it != block_meshes_.end()) {
+      face_count_ -= it->second.num_faces;
+      TangoSupport_freeMesh(&it->second);
+      block_meshes_.erase(it);
+    }
+    block_uvs_.erase(index);
+    // The render thread removes the blocks left without a mesh.
+    changed_blocks_.insert(index);
+    if (mesh.num_faces == 0) {
+      baker_.UpdateBlock(&mesh);
+      TangoSupport_freeMesh(&mesh);
+      continue;
+    }
+    face_count_ += mesh.num_faces;
+    TangoMesh_Experimental& block_mesh = block_meshes_[index];
+    block_mesh = mesh;
+    baker_.UpdateBlock(&block_mesh);
+  }
+  meshes->clear();
+}
+
+void MeshBuilderApp::BakeTextures() {
+  if (!has_color_intrinsics_) {
+    TangoCameraIntrinsics intrinsics;
+    if (!intrinsics_.GetIntrinsics(TANGO_CAMERA_COLOR, &intrinsics)) {
+      return;
+    }
+    baker_.SetIntrinsics(intrinsics);
+    has_color_intrinsics_ = true;
+  }
+  const int keyframe = keyframes_.Commit();
+  if (keyframe >= 0) {
+    baker_.OnKeyframeChanged(keyframes_.GetKeyframe(keyframe));
+  }
+  {
+    TANGO_TRACE_SCOPE("TextureAtlasBaker::Bake");
+    baker_.Bake(keyframes_, &baked_blocks_);
+  }
+  if (baked_blocks_.empty()) {
+    return;
+  }
+  std::lock_guard<tango_gl::ProfiledMutex> lock(mesh_mutex_);
+  for (const BlockIndex& index : baked_blocks_) {
+    if (baker_.GetBlockUvs(index, &block_uvs_[index])) {
+      changed_blocks_.insert(index);
+    } else {
+      block_uvs_.erase(index);
+    }
+  }
+}
+
+void MeshBuilderApp::FreeBlockMeshes() {
+  for (std::pair<const BlockIndex, TangoMesh_Experimental>& block :
+       block_meshes_) {
+    TangoSupport_freeMesh(&block.second);
+  }
+  block_meshes_.clear();
+  face_count_ = 0;
+}
+
+MeshBuilderApp::MeshBuilderApp()
+    : tango_config_(nullptr),
+      point_cloud_manager_(nullptr),
+      max_point_cloud_elements_(0),
+      volume_(tango_util::TsdfVolume::Options()),
+      keyframes_(tango_util::KeyframeStore::Options()),
+      baker_(tango_util::TextureAtlasBaker::Options()),
+      has_color_intrinsics_(false),
+      is_clear_requested_(false),
+      is_raycast_preview_enabled_(false),
+      is_distance_resync_requested_(false),
+      block_count_(0),
+      mesh_scratch_allocation_count_(0),
+      is_mesh_cleared_(false),
+      face_count_(0),
+      is_distance_cleared_(false),
+      upload_scratch_allocation_count_(0),
+      quality_governor_(tango_util::QualityGovernor::DefaultLevels(),
+                        kFrameBudget),
+      point_cloud_queue_(
+          "point cloud", kPointCloudQueueCapacity,
+          tango_util::DispatchQueueBase::kDropOldest,
+          [this](const double& timestamp) { HandlePointCloud(timestamp); }) {
+  dispatcher_.AddQueue(&point_cloud_queue_);
+  voxel_filter_.SetLeafSize(tango_util::TsdfVolume::Options().voxel_size);
+  keyframes_.Initialize(kMaxColorImageWidth, kMaxColorImageHeight);
+}
+
+MeshBuilderApp::~MeshBuilderApp() {
+  // Stop fusing before the volume and the meshes are destroyed.
+  dispatcher_.Stop();
+  exporter_.Wait();
+  if (tango_config_ != nullptr) {
+    TangoConfig_free(tango_config_);
+  }
+  if (point_cloud_manager_ != nullptr) {
+    TangoSupport_freePointCloudManager(point_cloud_manager_);
+  }
+  std::lock_guard<tango_gl::ProfiledMutex> lock(mesh_mutex_);
+  FreeBlockMeshes();
+}
+
+bool MeshBuilderApp::CheckTangoVersion(JNIEnv* env, jobject activity,
+                                       int min_tango_version) {
+  // Check the installed version of the TangoCore.  If it is too old, then
+  // it will not support the most up to date features.
+  int version;
+  TangoErrorType err = TangoSupport_GetTangoVersion(env, activity, &version);
+  return err == TANGO_SUCCESS && version >= min_tango_version;
+}
+
+bool MeshBuilderApp::OnTangoServiceConnected(JNIEnv* env, jobject binder) {
+  TangoErrorType ret = TangoService_setBinder(env, binder);
+  if (ret != TANGO_SUCCESS) {
+    LOGE(
+        "MeshBuilderApp: Failed to set Binder Tango service with"
+        "error code: %d",
+        ret);
+    return false;
+  }
+  return true;
+}
+
+int MeshBuilderApp::TangoSetupConfig() {
+  // Here, we'll configure the service to run in the way we'd want. For this
+  // application, we'll start from the default configuration
+  // (TANGO_CONFIG_DEFAULT). This enables basic motion tracking capabilities.
+  tango_config_ = TangoService_getConfig(TANGO_CONFIG_DEFAULT);
+  if (tango_config_ == nullptr) {
+    LOGE("MeshBuilderApp: Failed to get default config form");
+    return TANGO_ERROR;
+  }
+
+  // Set auto-recovery for motion tracking as requested by the user.
+  int ret =
+      TangoConfig_setBool(tango_config_, "config_enable_auto_recovery", true);
+  if (ret != TANGO_SUCCESS) {
+    LOGE(
+        "MeshBuilderApp: config_enable_auto_recovery() failed with error"
+        "code: %d",
+        ret);
+    return ret;
+  }
+
+  // Enable depth.
+  ret = TangoConfig_setBool(tango_config_, "config_enable_depth", true);
+  if (ret != TANGO_SUCCESS) {
+    LOGE(
+        "MeshBuilderApp: config_enable_depth() failed with error"
+        "code: %d",
+        ret);
+    return ret;
+  }
+
+  // Enable the color camera, for the keyframes the mesh is textured from.
+  ret = TangoConfig_setBool(tango_config_, "config_enable_color_camera", true);
+  if (ret != TANGO_SUCCESS) {
+    LOGE(
+        "MeshBuilderApp: config_enable_color_camera() failed with error"
+        "code: %d",
+        ret);
+    return ret;
+  }
+
+  // Query the point cloud capacity so the buffers can be allocated once.
+  int32_t max_point_cloud_elements;
+  ret = TangoConfig_getInt32(tango_config_, "max_point_cloud_elements",
+                             &max_point_cloud_elements);
+  if (ret != TANGO_SUCCESS) {
+    LOGE(
+        "MeshBuilderApp: Failed to query maximum number of point cloud "
+        "elements with error code: %d",
+        ret);
+    return ret;
+  }
+  std::lock_guard<tango_gl::ProfiledMutex> lock(point_cloud_mutex_);
+  max_point_cloud_elements_ = max_point_cloud_elements;
+  if (point_cloud_manager_ == nullptr) {
+    ret = TangoSupport_createPointCloudManager(max_point_cloud_elements,
+                                               &point_cloud_manager_);
+    if (ret != TANGO_SUCCESS) {
+      LOGE(
+          "MeshBuilderApp: Failed to create the point cloud manager with error"
+          "code: %d",
+          ret);
+      return ret;
+    }
+  }
+
+  return ret;
+}
+
+int MeshBuilderApp::TangoConnectCallbacks() {
+  // Start handling the callback data before the service can call back.
+  dispatcher_.Start();
+
+  // Attach the OnXYZijAvailable callback.
+  // The callback will be called after the service is connected.
+  int ret = TangoService_connectOnXYZijAvailable(onPointCloudAvailableRouter);
+  if (ret != TANGO_SUCCESS) {
+    LOGE(
+        "MeshBuilderApp: Failed to connect to point cloud callback with error"
+        "code: %d",
+        ret);
+    return ret;
+  }
+
+  ret = TangoService_connectOnFrameAvailable(TANGO_CAMERA_COLOR, this,
+                                             OnFrameAvailableRouter);
+  if (ret != TANGO_SUCCESS) {
+    LOGE(
+        "MeshBuilderApp: Failed to connect to color camera callback with "
+        "error code: %d",
+        ret);
+    return ret;
+  }
+
+  return ret;
+}
+
+// Connect to the Tango Service, the service will start running:
+// poses can be queried and callbacks will be called.
+bool MeshBuilderApp::TangoConnect() {
+  TangoErrorType err = TangoService_connect(this, tango_config_);
+  if (err != TANGO_SUCCESS) {
+    LOGE(
+        "MeshBuilderApp: Failed to connect to the Tango service with"
+        "error code: %d",
+        err);
+    return false;
+  }
+
+  err = extrinsics_.Update();
+  if (err != TANGO_SUCCESS) {
+    LOGE("MeshBuilderApp: Failed to query sensor extrinsic with error code: %d",
+         err);
+    return false;
+  }
+
+  err = intrinsics_.Update(TANGO_CAMERA_COLOR);
+  if (err != TANGO_SUCCESS) {
+    LOGE("MeshBuilderApp: Failed to query the color camera intrinsics with "
+         "error code: %d",
+         err);
+    return false;
+  }
+  return true;
+}
+
+void MeshBuilderApp::TangoDisconnect() {
+  // When disconnecting from the Tango Service, it is important to make sure to
+  // free your configuration object. Note that disconnecting from the service,
+  // resets all configuration, and disconnects all callbacks. If an application
+  // resumes after disconnecting, it must re-register configuration and
+  // callbacks with the service.
+  TangoConfig_free(tango_config_);
+  tango_config_ = nullptr;
+  TangoService_disconnect();
+
+  // No callback can post anymore, the volume is kept for the next
+  // connection.
+  dispatcher_.Stop();
+}
+
+void MeshBuilderApp::InitializeGLContent() {
+  const tango_util::TsdfVolume::Options volume_options;
+  main_scene_.InitGLContent(volume_options.voxel_size,
+                            volume_options.truncation_distance);
+  main_scene_.GetBlockMesh()->AllocateAtlas(baker_.GetAtlasSize());
+  // The buffers and the atlas of the new context have to be uploaded again.
+  baker_.MarkAtlasDirty();
+  std::lock_guard<tango_gl::ProfiledMutex> lock(mesh_mutex_);
+  changed_blocks_.clear();
+  for (const std::pair<const BlockIndex, TangoMesh_Experimental>& block :
+       block_meshes_) {
+    changed_blocks_.insert(block.first);
+  }
+  // The distances pending were for the old context's raycaster.
+  pending_distances_.clear();
+  is_distance_resync_requested_.store(true);
+}
+
+void MeshBuilderApp::SetViewPort(int width, int height) {
+  main_scene_.SetupViewPort(width, height);
+}
+
+void MeshBuilderApp::Render() {
+  TANGO_TRACE_SCOPE("MeshBuilderApp::Render");
+  quality_governor_.BeginFrame();
+  BlockMeshDrawable* block_mesh = main_scene_.GetBlockMesh();
+  VolumeRaycaster* raycaster = main_scene_.GetVolumeRaycaster();
+  {
+    TANGO_TRACE_SCOPE("BlockMeshDrawable::UpdateBlock");
+    std::lock_guard<tango_gl::ProfiledMutex> lock(mesh_mutex_);
+    if (is_mesh_cleared_) {
+      block_mesh->Clear();
+      is_mesh_cleared_ = false;
+    }
+    // The texels of the texture coordinates published are in the atlas of
+    // the baker by now, and go first. While a bake writes the atlas, the
+    // blocks wait for the next frame.
+    if (!changed_blocks_.empty() &&
+        baker_.UploadDirtyRows(
+            [block_mesh](int y, int height, const uint8_t* rows) {
+              block_mesh->UpdateAtlasRows(y, height, rows);
+            })) {
+      for (const BlockIndex& index : changed_blocks_) {
+        UploadBlockLocked(index, block_mesh);
+      }
+      changed_blocks_.clear();
+    }
+    if (is_distance_cleared_) {
+      raycaster->Clear();
+      is_distance_cleared_ = false;
+    }
+    for (const tango_util::TsdfVolume::BlockDistances& block :
+         pending_distances_) {
+      raycaster->UpdateBlock(block);
+    }
+    pending_distances_.clear();
+  }
+  const uint64_t upload_scratch_allocation_count =
+      block_mesh->GetScratchAllocationCount();
+  if (upload_scratch_allocation_count != upload_scratch_allocation_count_) {
+    upload_scratch_allocation_count_ = upload_scratch_allocation_count;
+    LOGI("MeshBuilderApp: Upload scratch grew, %llu heap blocks so far",
+         static_cast<unsigned long long>(  // NOLINT
+             upload_scratch_allocation_count));
+  }
+
+  glm::mat4 start_service_T_device;
+  if (!GetDevicePose(0.0, &start_service_T_device)) {
+    start_service_T_device = glm::mat4(1.0f);
+  }
+  main_scene_.SetRaycastEnabled(is_raycast_preview_enabled_.load());
+  main_scene_.SetRaycastScale(quality_governor_.GetLevel().render_scale);
+  main_scene_.Render(
+      extrinsics_.GetOpenGlWorldTDepthOpenGlCamera(start_service_T_device),
+      extrinsics_.GetOpenGlWorldTStartService());
+  quality_governor_.EndFrame();
+}
+
+void MeshBuilderApp::UploadBlockLocked(const BlockIndex& index,
+                                       BlockMeshDrawable* block_mesh) {
+  std::map<BlockIndex, TangoMesh_Experimental>::const_iterator it =
+      block_meshes_.find(index);
+  if (it == block_meshes_.end()) {
+    // Removes the block.
+    TangoMesh_Experimental empty_mesh;
+    TangoSupport_initializeEmptyMesh(&empty_mesh);
+    empty_mesh.index[0] = std::get<0>(index);
+    empty_mesh.index[1] = std::get<1>(index);
+    empty_mesh.index[2] = std::get<2>(index);
+    block_mesh->UpdateBlock(empty_mesh);
+    return;
+  }
+  std::map<BlockIndex, std::vector<GLfloat>>::const_iterator uvs =
+      block_uvs_.find(index);
+  if (uvs != block_uvs_.end()) {
+    block_mesh->UpdateTexturedBlock(it->second, uvs->second);
+  } else {
+    block_mesh->UpdateBlock(it->second);
+  }
+}
+
+void MeshBuilderApp::DeleteResources() { main_scene_.DeleteResources(); }
+
+void MeshBuilderApp::SetCameraType(
+    tango_gl::GestureCamera::CameraType camera_type) {
+  main_scene_.SetCameraType(camera_type);
+}
+
+void MeshBuilderApp::ClearMesh() { is_clear_requested_.store(true); }
+
+void MeshBuilderApp::SetRaycastPreviewEnabled(bool is_enabled) {
+  is_raycast_preview_enabled_.store(is_enabled);
+}
+
+void MeshBuilderApp::ExportMeshPly(const char* path) {
+  std::lock_guard<std::mutex> lock(export_mutex_);
+  export_path_ = path;
+}
+
+bool MeshBuilderApp::ExportMesh(const char* path) {
+  TANGO_TRACE_SCOPE("MeshBuilderApp::ExportMesh");
+  // Merge the blocks, welding the vertices along their shared faces.
+  TangoMesh_Experimental merged_mesh;
+  {
+    std::lock_guard<tango_gl::ProfiledMutex> lock(mesh_mutex_);
+    if (block_meshes_.empty()) {
+      return false;
+    }
+    uint32_t vertex_count = 0;
+    for (const std::pair<const BlockIndex, TangoMesh_Experimental>& block :
+         block_meshes_) {
+      vertex_count += block.second.num_vertices;
+    }
+    if (TangoSupport_createMesh(vertex_count, face_count_, true, false,
+                                &merged_mesh) != TANGO_SUCCESS) {
+      LOGE("MeshBuilderApp: Failed to allocate the exported mesh");
+      return false;
+    }
+
+    std::map<std::tuple<int64_t, int64_t, int64_t>, uint32_t> welded;
+    std::vector<uint32_t> vertex_map;
+    uint32_t merged_vertex_count = 0;
+    uint32_t merged_face_count = 0;
+    for (const std::pair<const BlockIndex, TangoMesh_Experimental>& block :
+         block_meshes_) {
+      const TangoMesh_Experimental& mesh = block.second;
+      vertex_map.resize(mesh.num_vertices);
+      for (uint32_t i = 0; i < mesh.num_vertices; ++i) {
+        std::pair<std::map<std::tuple<int64_t, int64_t, int64_t>,
+                           uint32_t>::iterator,
+                  bool>
+            inserted = welded.insert(std::make_pair(
+                GetWeldKey(mesh.vertices[i]), merged_vertex_count));
+        vertex_map[i] = inserted.first->second;
+        if (inserted.second) {
+          for (int k = 0; k < 3; ++k) {
+            merged_mesh.vertices[merged_vertex_count][k] = mesh.vertices[i][k];
+            merged_mesh.normals[merged_vertex_count][k] = mesh.normals[i][k];
+          }
+          ++merged_vertex_count;
+        }
+      }
+      for (uint32_t i = 0; i < mesh.num_faces; ++i) {
+        for (int k = 0; k < 3; ++k) {
+          merged_mesh.faces[merged_face_count][k] =
+              vertex_map[mesh.faces[i][k]];
+        }
+        ++merged_face_count;
+      }
+    }
+    merged_mesh.num_vertices = merged_vertex_count;
+    merged_mesh.num_faces = merged_face_count;
+  }
+
+  TangoMesh_Experimental simplified_mesh;
+  const TangoMesh_Experimental* exported_mesh = &merged_mesh;
+  bool is_simplified = false;
+  if (merged_mesh.num_faces > kMaxExportFaceCount) {
+    TANGO_TRACE_SCOPE("TangoSupport_createSimplifiedMesh");
+    is_simplified = TangoSupport_createSimplifiedMesh(
+                        &merged_mesh, kMaxExportFaceCount,
+                        &simplified_mesh) == TANGO_SUCCESS;
+    if (is_simplified) {
+      exported_mesh = &simplified_mesh;
+    } else {
+      LOGE("MeshBuilderApp: Failed to simplify the mesh, exporting it whole");
+    }
+  }
+
+  bool is_written = false;
+  FILE* file = fopen(path, "w");
+  if (file == NULL) {
+    LOGE("MeshBuilderApp: Failed to create %s", path);
+  } else {
+    // Vertices are in the start of service frame, in meters.
+    for (uint32_t i = 0; i < exported_mesh->num_vertices; ++i) {
+      const float* vertex = exported_mesh->vertices[i];
+      fprintf(file, "v %f %f %f\n", vertex[0], vertex[1], vertex[2]);
+    }
+    if (exported_mesh->has_normals) {
+      for (uint32_t i = 0; i < exported_mesh->num_vertices; ++i) {
+        const float* normal = exported_mesh->normals[i];
+        fprintf(file, "vn %f %f %f\n", normal[0], normal[1], normal[2]);
+      }
+    }
+    // OBJ indices start at 1.
+    for (uint32_t i = 0; i < exported_mesh->num_faces; ++i) {
+      const uint32_t* face = exported_mesh->faces[i];
+      if (exported_mesh->has_normals) {
+        fprintf(file, "f %u//%u %u//%u %u//%u\n", face[0] + 1, face[0] + 1,
+                face[1] + 1, face[1] + 1, face[2] + 1, face[2] + 1);
+      } else {
+        fprintf(file, "f %u %u %u\n", face[0] + 1, face[1] + 1, face[2] + 1);
+      }
+    }
+    is_written = ferror(file) == 0;
+    is_written = fclose(file) == 0 && is_written;
+    if (!is_written) {
+      LOGE("MeshBuilderApp: Failed to write %s", path);
+    } else {
+      LOGI("MeshBuilderApp: Exported %u faces to %s", exported_mesh->num_faces,
+           path);
+    }
+  }
+
+  if (is_simplified) {
+    TangoSupport_freeMesh(&simplified_mesh);
+  }
+  TangoSupport_freeMesh(&merged_mesh);
+  return is_written;
+}
+
+int MeshBuilderApp::GetBlockCount() { return block_count_.load(); }
+
+int MeshBuilderApp::GetFaceCount() {
+  std::lock_guard<tango_gl::ProfiledMutex> lock(mesh_mutex_);
+  return static_cast<int>(face_count_);
+}
+
+void MeshBuilderApp::OnTouchEvent(int touch_count,
+                                  tango_gl::GestureCamera::TouchEvent event,
+                                  float x0, float y0, float x1, float y1) {
+  main_scene_.OnTouchEvent(touch_count, event, x0, y0, x1, y1);
+}
+
+bool MeshBuilderApp::GetDevicePose(double timestamp,
+                                   glm::mat4* start_service_T_device) {
+  TangoPoseData pose;
+  TangoCoordinateFramePair frame_pair;
+  frame_pair.base = TANGO_COORDINATE_FRAME_START_OF_SERVICE;
+  frame_pair.target = TANGO_COORDINATE_FRAME_DEVICE;
+  if (tango_util::GetPoseAtTime(timestamp, frame_pair, &pose) !=
+          TANGO_SUCCESS ||
+      pose.status_code != TANGO_POSE_VALID) {
+    return false;
+  }
+  *start_service_T_device = tango_gl::conversions::TransformFromArrays(
+      pose.translation, pose.orientation);
+  return true;
+}
+
+}  // namespace tango_mesh_builder
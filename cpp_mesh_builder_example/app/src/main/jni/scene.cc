@@ -0,0 +1,138 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-mesh-builder/scene.h"
+
+#include <tango-gl/gl_state.h>
+
+namespace {
+// We want to represent the device properly with respect to the ground so we'll
+// add an offset in z to our origin. We'll set this offset to 1.3 meters based
+// on the average height of a human standing with a Tango device. This allows us
+// to place a grid roughly on the ground for most users.
+const glm::vec3 kHeightOffset = glm::vec3(0.0f, 1.3f, 0.0f);
+
+// Color of the ground grid.
+const tango_gl::Color kGridColor(0.85f, 0.85f, 0.85f);
+
+// Frustum scale.
+const glm::vec3 kFrustumScale = glm::vec3(0.4f, 0.3f, 0.5f);
+}  // namespace
+
+namespace tango_mesh_builder {
+
+Scene::Scene()
+    : gesture_camera_(nullptr),
+      frustum_(nullptr),
+      grid_(nullptr),
+      block_mesh_(nullptr),
+      raycaster_(nullptr),
+      is_raycast_enabled_(false) {}
+
+Scene::~Scene() {}
+
+void Scene::InitGLContent(float voxel_size, float truncation_distance) {
+  gesture_camera_ = new tango_gl::GestureCamera();
+  frustum_ = new tango_gl::Frustum();
+  grid_ = new tango_gl::Grid();
+  block_mesh_ = new BlockMeshDrawable();
+  raycaster_ = new VolumeRaycaster(voxel_size, truncation_distance);
+  // The GL objects of a previous context are gone with it.
+  overlay_target_.InvalidateGlResources();
+
+  grid_->SetColor(kGridColor);
+  grid_->SetPosition(-kHeightOffset);
+  gesture_camera_->SetCameraType(
+      tango_gl::GestureCamera::CameraType::kThirdPerson);
+}
+
+void Scene::DeleteResources() {
+  delete gesture_camera_;
+  delete frustum_;
+  delete grid_;
+  delete block_mesh_;
+  delete raycaster_;
+  overlay_target_.DeleteGlResources();
+  gesture_camera_ = nullptr;
+  frustum_ = nullptr;
+  grid_ = nullptr;
+  block_mesh_ = nullptr;
+  raycaster_ = nullptr;
+}
+
+void Scene::SetupViewPort(int w, int h) {
+  if (h == 0) {
+    LOGE("Setup graphic height not valid");
+  }
+  gesture_camera_->SetAspectRatio(static_cast<float>(w) /
+                                  static_cast<float>(h));
+  glViewport(0, 0, w, h);
+}
+
+void Scene::Render(const glm::mat4& cur_pose_transformation,
+                   const glm::mat4& mesh_transformation) {
+  // Apply the touch input received since the previous frame.
+  gesture_camera_->Update();
+  tango_gl::GlState::Enable(GL_DEPTH_TEST);
+  tango_gl::GlState::Enable(GL_CULL_FACE);
+
+  glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+  glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+
+  if (gesture_camera_->GetCameraType() ==
+      tango_gl::GestureCamera::CameraType::kFirstPerson) {
+    // In first person mode, we directly control camera's motion.
+    gesture_camera_->SetTransformationMatrix(cur_pose_transformation);
+  } else {
+    // In third person or top down more, we follow the camera movement.
+    gesture_camera_->SetAnchorPosition(
+        glm::vec3(cur_pose_transformation[3]));
+
+    frustum_->SetTransformationMatrix(cur_pose_transformation);
+    // Set the frustum scale to 4:3, this doesn't necessarily match the
+    // physical camera's aspect ratio, this is just for visualization
+    // purposes.
+    frustum_->SetScale(kFrustumScale);
+    frustum_->Render(gesture_camera_->GetProjectionMatrix(),
+                     gesture_camera_->GetViewMatrix());
+  }
+
+  grid_->Render(gesture_camera_->GetProjectionMatrix(),
+                gesture_camera_->GetViewMatrix());
+
+  if (is_raycast_enabled_) {
+    // Drawn over the grid without depth, at the scale of the overlay.
+    overlay_target_.Begin();
+    raycaster_->Render(gesture_camera_->GetProjectionMatrix(),
+                       gesture_camera_->GetViewMatrix(), mesh_transformation);
+    overlay_target_.End();
+  } else {
+    block_mesh_->Render(gesture_camera_->GetProjectionMatrix(),
+                        gesture_camera_->GetViewMatrix(), mesh_transformation);
+  }
+}
+
+void Scene::SetCameraType(tango_gl::GestureCamera::CameraType camera_type) {
+  gesture_camera_->SetCameraType(camera_type);
+}
+
+void Scene::OnTouchEvent(int touch_count,
+                         tango_gl::GestureCamera::TouchEvent event, float x0,
+                         float y0, float x1, float y1) {
+  gesture_camera_->OnTouchEvent(touch_count, event, x0, y0, x1, y1);
+}
+
+}  // namespace tango_mesh_builder
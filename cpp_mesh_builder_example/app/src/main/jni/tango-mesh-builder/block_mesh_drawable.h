@@ -0,0 +1,143 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_MESH_BUILDER_BLOCK_MESH_DRAWABLE_H_
+#define TANGO_MESH_BUILDER_BLOCK_MESH_DRAWABLE_H_
+
+#include <map>
+#include <tuple>
+#include <vector>
+
+#include <tango_client_api.h>  // NOLINT
+#include <tango-gl/bounding_box.h>
+#include <tango-gl/memory_accounting.h>
+#include <tango-gl/util.h>
+#include <tango-util/frame_arena.h>
+
+namespace tango_mesh_builder {
+
+// Coordinates of a block of the volume, as in TangoMesh_Experimental::index.
+typedef std::tuple<int32_t, int32_t, int32_t> BlockIndex;
+
+inline BlockIndex GetBlockIndex(const TangoMesh_Experimental& mesh) {
+  return BlockIndex(mesh.index[0], mesh.index[1], mesh.index[2]);
+}
+
+// BlockMeshDrawable renders the meshes of the blocks of a TsdfVolume, each
+// from its own vertex and index buffers, so a block changed by a depth frame
+// only uploads its own mesh again. Blocks outside of the view are not drawn.
+//
+// A block is either shaded by its normals, or textured from the atlas of a
+// tango_util::TextureAtlasBaker once it is baked. Textured blocks have the
+// corners of every face of their own, as the faces sharing a vertex have it
+// at different places of the atlas.
+class BlockMeshDrawable {
+ public:
+  BlockMeshDrawable();
+  ~BlockMeshDrawable();
+  BlockMeshDrawable(const BlockMeshDrawable& other) = delete;
+  BlockMeshDrawable& operator=(const BlockMeshDrawable&) = delete;
+
+  // Free all GL Resources, i.e, shaders, buffers.
+  void DeleteGlResources();
+
+  // Upload the mesh of a block, replacing the previous one. A mesh without
+  // faces removes the block.
+  //
+  // @param mesh: mesh with vertices and normals in the start of service frame,
+  //              and the block coordinates in its index.
+  void UpdateBlock(const TangoMesh_Experimental& mesh);
+
+  // Upload the mesh of a block with the texture coordinates of its faces in
+  // the atlas, replacing the previous one.
+  //
+  // @param uvs: 6 floats per face, see TextureAtlasBaker::GetBlockUvs().
+  void UpdateTexturedBlock(const TangoMesh_Experimental& mesh,
+                           const std::vector<GLfloat>& uvs);
+
+  // Allocate the RGB atlas the textured blocks are drawn with.
+  //
+  // @param size: edge length of the atlas, in texels.
+  void AllocateAtlas(int size);
+
+  // Replace full rows of the atlas.
+  //
+  // @param rows: |height| tightly packed RGB rows from row |y| on.
+  void UpdateAtlasRows(int y, int height, const uint8_t* rows);
+
+  // Remove every block.
+  void Clear();
+
+  // @return: the heap blocks allocated by the scratch arena of the uploads,
+  //          steady once it fits the largest block.
+  uint64_t GetScratchAllocationCount() const {
+    return upload_arena_.GetStats().heap_allocation_count;
+  }
+
+  // Render the blocks in view.
+  //
+  // @param projection_mat: projection matrix from current render camera.
+  // @param view_mat: view matrix from current render camera.
+  // @param model_mat: transformation from the start of service frame.
+  void Render(const glm::mat4& projection_mat, const glm::mat4& view_mat,
+              const glm::mat4& model_mat);
+
+ private:
+  struct BlockBuffers {
+    // Interleaved positions and normals, indexed, or positions and texture
+    // coordinates of the corners of every face when textured, drawn without
+    // the indices.
+    GLuint vertex_buffer;
+    GLuint index_buffer;
+    // The corners drawn when textured.
+    GLsizei index_count;
+    bool is_textured;
+    // Bounds of the vertices in the start of service frame.
+    tango_gl::BoundingBox bounds;
+  };
+
+  void DeleteBuffers(BlockBuffers* buffers);
+
+  // @return the buffers of |index|, created if needed.
+  BlockBuffers* GetBuffers(const BlockIndex& index);
+
+  // Delete the buffers of |index|, if any.
+  void RemoveBlock(const BlockIndex& index);
+
+  std::map<BlockIndex, BlockBuffers> blocks_;
+  // The interleaved vertices and the indices of a block before they are
+  // uploaded, reset after every block.
+  tango_util::FrameArena upload_arena_;
+
+  GLuint shader_program_;
+  GLuint vertices_handle_;
+  GLuint normals_handle_;
+  GLuint mvp_handle_;
+  GLuint model_handle_;
+
+  GLuint textured_program_;
+  GLuint textured_vertices_handle_;
+  GLuint textured_uvs_handle_;
+  GLuint textured_mvp_handle_;
+  GLuint textured_atlas_handle_;
+
+  GLuint atlas_texture_;
+  int atlas_size_;
+  tango_gl::MemoryAccount atlas_memory_;
+};
+}  // namespace tango_mesh_builder
+
+#endif  // TANGO_MESH_BUILDER_BLOCK_MESH_DRAWABLE_H_
@@ -0,0 +1,285 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_MESH_BUILDER_MESH_BUILDER_APP_H_
+#define TANGO_MESH_BUILDER_MESH_BUILDER_APP_H_
+
+#include <jni.h>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <tango_client_api.h>  // NOLINT
+#include <tango_support_api.h>
+#include <tango-gl/profiled_mutex.h>
+#include <tango-gl/util.h>
+#include <tango-util/callback_dispatcher.h>
+#include <tango-util/extrinsics_cache.h>
+#include <tango-util/intrinsics_registry.h>
+#include <tango-util/keyframe_store.h>
+#include <tango-util/ply_exporter.h>
+#include <tango-util/quality_governor.h>
+#include <tango-util/texture_atlas_baker.h>
+#include <tango-util/tsdf_volume.h>
+#include <tango-util/voxel_grid_filter.h>
+
+#include <tango-mesh-builder/block_mesh_drawable.h>
+#include <tango-mesh-builder/scene.h>
+
+namespace tango_mesh_builder {
+
+// MeshBuilderApp handles the application lifecycle and resources.
+//
+// Every depth frame is fused into a TsdfVolume on the dispatcher thread, and
+// the blocks it changed are meshed right away. The meshes are handed to the
+// render thread, which uploads only the changed blocks, and are kept for
+// ExportMesh().
+//
+// The color camera feeds a KeyframeStore, and the blocks are textured from
+// its keyframes into an atlas a few at a time after each depth frame, on the
+// same thread. Until a block is baked it is shaded by its normals.
+//
+// In the raycast preview, the distances of the changed blocks are extracted
+// instead of their meshes and the volume is raycast, at the resolution the
+// frame budget allows, which is cheaper to keep up with while scanning. The
+// meshes catch up with everything fused once the preview is turned off.
+class MeshBuilderApp {
+ public:
+  // Constructor and deconstructor.
+  MeshBuilderApp();
+  ~MeshBuilderApp();
+
+  // Check that the installed version of the Tango API is up to date.
+  //
+  // @return returns true if the application version is compatible with the
+  //         Tango Core version.
+  bool CheckTangoVersion(JNIEnv* env, jobject caller_activity,
+                         int min_tango_version);
+
+  // Called when Tango Service is connected successfully.
+  bool OnTangoServiceConnected(JNIEnv* env, jobject binder);
+
+  // Setup the configuration file for the Tango Service.
+  int TangoSetupConfig();
+
+  // Connect the onXYZijAvailable and color camera callbacks.
+  int TangoConnectCallbacks();
+
+  // Connect to Tango Service.
+  // This function will start the Tango Service pipeline, in this case, it will
+  // start Motion Tracking and Depth Sensing callbacks.
+  bool TangoConnect();
+
+  // Disconnect from Tango Service, release all the resources that the app is
+  // holding from the Tango Service.
+  void TangoDisconnect();
+
+  // Tango Service point cloud callback function for depth data. Called when new
+  // new point cloud data is available from the Tango Service.
+  //
+  // @param xyz_ij: The current point cloud returned by the service,
+  //                caller allocated.
+  void onPointCloudAvailable(const TangoXYZij* xyz_ij);
+
+  // Tango Service color camera callback function, the images are considered
+  // as keyframes for the texturing of the mesh.
+  //
+  // @param buffer: the color image, only valid during the callback.
+  void OnFrameAvailable(const TangoImageBuffer* buffer);
+
+  // Allocate OpenGL resources for rendering, mainly for initializing the Scene.
+  void InitializeGLContent();
+
+  // Setup the view port width and height.
+  void SetViewPort(int width, int height);
+
+  // Main render loop.
+  void Render();
+
+  // Release all non-OpenGL allocated resources.
+  void DeleteResources();
+
+  // Set render camera's viewing angle, first person, third person or top down.
+  //
+  // @param: camera_type, camera type includes first person, third person and
+  //         top down
+  void SetCameraType(tango_gl::GestureCamera::CameraType camera_type);
+
+  // Remove everything fused so far. The volume is cleared before the next
+  // depth frame is fused.
+  void ClearMesh();
+
+  // Merge the block meshes, simplify the result and write it as a Wavefront
+  // OBJ file.
+  //
+  // @param path: path of the file to write.
+  //
+  // @return: false if there is no mesh or the file could not be written.
+  bool ExportMesh(const char* path);
+
+  // Write the block meshes as they are as a binary PLY file on a background
+  // thread. Unlike ExportMesh(), nothing is merged or copied: the export
+  // starts before the next depth frame is fused, and fusion pauses until the
+  // file is written.
+  //
+  // @param path: path of the file to write.
+  void ExportMeshPly(const char* path);
+
+  // Raycast the volume instead of drawing its mesh, and stop meshing while
+  // it is.
+  void SetRaycastPreviewEnabled(bool is_enabled);
+
+  // @return: the number of blocks of the volume.
+  int GetBlockCount();
+
+  // @return: the number of faces of the mesh.
+  int GetFaceCount();
+
+  // Touch event passed from android activity. This function only supports two
+  // touches.
+  //
+  // @param: touch_count, total count for touches.
+  // @param: event, touch event of current touch.
+  // @param: x0, normalized touch location for touch 0 on x axis.
+  // @param: y0, normalized touch location for touch 0 on y axis.
+  // @param: x1, normalized touch location for touch 1 on x axis.
+  // @param: y1, normalized touch location for touch 1 on y axis.
+  void OnTouchEvent(int touch_count, tango_gl::GestureCamera::TouchEvent event,
+                    float x0, float y0, float x1, float y1);
+
+ private:
+  // Fuse the latest point cloud and mesh the blocks it changed, run on the
+  // dispatcher thread.
+  void HandlePointCloud(double timestamp);
+
+  // Hand the distances of the blocks changed since the last call to the
+  // render thread. Run on the dispatcher thread.
+  void PublishDistances();
+
+  // Replace the meshes of blocks, taking ownership of them.
+  void PublishMeshes(std::vector<TangoMesh_Experimental>* meshes);
+
+  // Add the latest keyframe, bake the next blocks waiting for their texture
+  // and publish their texture coordinates. Run on the dispatcher thread.
+  void BakeTextures();
+
+  // Upload the mesh of a block, textured once baked, or remove it. Called on
+  // the render thread with mesh_mutex_ held.
+  void UploadBlockLocked(const BlockIndex& index,
+                         BlockMeshDrawable* block_mesh);
+
+  // Free every mesh of block_meshes_, with mesh_mutex_ held.
+  void FreeBlockMeshes();
+
+  // Get the device pose in the start of service frame.
+  //
+  // @param: timestamp, timestamp of the target pose, 0 for the latest.
+  // @param: start_service_T_device, set to the pose when it is valid.
+  //
+  // @return: whether a valid pose was found.
+  bool GetDevicePose(double timestamp, glm::mat4* start_service_T_device);
+
+  // Tango configration file, this object is for configuring Tango Service setup
+  // before connect to service. For example, we turn on the depth sensing in
+  // this example.
+  TangoConfig tango_config_;
+
+  // Preallocated point cloud buffers, filled on the Tango callback thread and
+  // read on the dispatcher thread. Created in TangoSetupConfig(); the pointer
+  // itself is protected by point_cloud_mutex_.
+  TangoSupportPointCloudManager* point_cloud_manager_;
+  int max_point_cloud_elements_;
+  tango_gl::ProfiledMutex point_cloud_mutex_{
+      "MeshBuilderApp::point_cloud_mutex_"};
+
+  // Sensor extrinsics and the color camera intrinsics, queried once the
+  // service is connected.
+  tango_util::ExtrinsicsCache extrinsics_;
+  tango_util::IntrinsicsRegistry intrinsics_;
+
+  // Only used on the dispatcher thread. The depth frames are downsampled to
+  // the voxel size before they are fused, which bounds the fusion cost of a
+  // frame by the surface area in view rather than by the number of points.
+  tango_util::VoxelGridFilter voxel_filter_;
+  tango_util::TsdfVolume volume_;
+  std::vector<TangoMesh_Experimental> extracted_meshes_;
+  std::vector<tango_util::TsdfVolume::BlockDistances> extracted_distances_;
+
+  // Filled on the color callback thread, committed and baked from on the
+  // dispatcher thread, which alone uses baker_. The atlas is uploaded by the
+  // render thread.
+  tango_util::KeyframeStore keyframes_;
+  tango_util::TextureAtlasBaker baker_;
+  std::vector<BlockIndex> baked_blocks_;
+  bool has_color_intrinsics_;
+
+  // Set by ClearMesh(), handled on the dispatcher thread.
+  std::atomic<bool> is_clear_requested_;
+  // Set by SetRaycastPreviewEnabled(). is_distance_resync_requested_ has
+  // the distances of every block extracted again, for a new GL context.
+  std::atomic<bool> is_raycast_preview_enabled_;
+  std::atomic<bool> is_distance_resync_requested_;
+  std::atomic<int> block_count_;
+  // Heap blocks of the meshing scratch arenas last logged, which stop
+  // growing after the first frames.
+  uint64_t mesh_scratch_allocation_count_;
+
+  // Latest mesh of every block with faces, the texture coordinates of those
+  // baked since, and the blocks changed since the render thread last
+  // uploaded them. is_mesh_cleared_ tells the render thread to drop every
+  // block first. Protected by mesh_mutex_.
+  std::map<BlockIndex, TangoMesh_Experimental> block_meshes_;
+  std::map<BlockIndex, std::vector<GLfloat>> block_uvs_;
+  std::set<BlockIndex> changed_blocks_;
+  bool is_mesh_cleared_;
+  uint32_t face_count_;
+  // Distances published for the raycaster but not uploaded yet, and
+  // whether the raycaster drops every block first. Protected by mesh_mutex_.
+  std::vector<tango_util::TsdfVolume::BlockDistances> pending_distances_;
+  bool is_distance_cleared_;
+  tango_gl::ProfiledMutex mesh_mutex_{"MeshBuilderApp::mesh_mutex_"};
+  // Heap blocks of the upload scratch arena last logged, only used on the
+  // render thread.
+  uint64_t upload_scratch_allocation_count_;
+
+  // Set by ExportMeshPly(), started on the dispatcher thread.
+  std::string export_path_;
+  std::mutex export_mutex_;
+  tango_util::PlyExporter exporter_;
+
+  // Lowers the resolution of the raycast preview when frames run over
+  // budget. Only used on the render thread.
+  tango_util::QualityGovernor quality_governor_;
+
+  // main_scene_ includes all drawable object for visualizing Tango device's
+  // movement and the mesh.
+  Scene main_scene_;
+
+  // The point cloud callback only posts to this queue, the frames are fused
+  // on the thread of dispatcher_. Fusing a frame can take longer than the
+  // frame interval, only the latest frame is kept then.
+  tango_util::DispatchQueue<double> point_cloud_queue_;
+
+  // Declared last so that its thread is stopped before the rest of the app is
+  // destroyed.
+  tango_util::CallbackDispatcher dispatcher_;
+};
+}  // namespace tango_mesh_builder
+
+#endif  // TANGO_MESH_BUILDER_MESH_BUILDER_APP_H_
@@ -0,0 +1,114 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_MESH_BUILDER_SCENE_H_
+#define TANGO_MESH_BUILDER_SCENE_H_
+
+#include <tango_client_api.h>  // NOLINT
+#include <tango-gl/color.h>
+#include <tango-gl/gesture_camera.h>
+#include <tango-gl/grid.h>
+#include <tango-gl/frustum.h>
+#include <tango-gl/overlay_target.h>
+#include <tango-gl/util.h>
+
+#include <tango-mesh-builder/block_mesh_drawable.h>
+#include <tango-mesh-builder/volume_raycaster.h>
+
+namespace tango_mesh_builder {
+
+// Scene provides OpenGL drawable objects and renders them for visualization.
+class Scene {
+ public:
+  // Constructor and destructor.
+  Scene();
+  ~Scene();
+
+  // Allocate OpenGL resources for rendering.
+  //
+  // @param voxel_size: edge length of the voxels of the volume raycast, in
+  //        meters.
+  // @param truncation_distance: that of the volume raycast, in meters.
+  void InitGLContent(float voxel_size, float truncation_distance);
+
+  // Release non-OpenGL allocated resources.
+  void DeleteResources();
+
+  // Setup GL view port.
+  void SetupViewPort(int w, int h);
+
+  // @return: the drawable of the mesh, to upload changed blocks to. Only
+  //          valid on the GL thread between InitGLContent() and
+  //          DeleteResources().
+  BlockMeshDrawable* GetBlockMesh() { return block_mesh_; }
+
+  // @return: the raycaster of the volume, to upload changed blocks to, with
+  //          the same validity as GetBlockMesh().
+  VolumeRaycaster* GetVolumeRaycaster() { return raycaster_; }
+
+  // Draw the volume raycast instead of the mesh.
+  void SetRaycastEnabled(bool is_enabled) { is_raycast_enabled_ = is_enabled; }
+
+  // Set the scale of the resolution the volume is raycast at, in (0, 1].
+  void SetRaycastScale(float scale) { overlay_target_.SetScale(scale); }
+
+  // Render loop.
+  // @param: cur_pose_transformation, latest pose's transformation.
+  // @param: mesh_transformation, transformation of the start of service
+  //         frame.
+  void Render(const glm::mat4& cur_pose_transformation,
+              const glm::mat4& mesh_transformation);
+
+  // Set render camera's viewing angle, first person, third person or top down.
+  //
+  // @param: camera_type, camera type includes first person, third person and
+  //         top down
+  void SetCameraType(tango_gl::GestureCamera::CameraType camera_type);
+
+  // Touch event passed from android activity. This function only support two
+  // touches.
+  //
+  // @param: touch_count, total count for touches.
+  // @param: event, touch event of current touch.
+  // @param: x0, normalized touch location for touch 0 on x axis.
+  // @param: y0, normalized touch location for touch 0 on y axis.
+  // @param: x1, normalized touch location for touch 1 on x axis.
+  // @param: y1, normalized touch location for touch 1 on y axis.
+  void OnTouchEvent(int touch_count, tango_gl::GestureCamera::TouchEvent event,
+                    float x0, float y0, float x1, float y1);
+
+ private:
+  // Camera object that allows user to use touch input to interact with.
+  tango_gl::GestureCamera* gesture_camera_;
+
+  // Device frustum.
+  tango_gl::Frustum* frustum_;
+
+  // Ground grid.
+  tango_gl::Grid* grid_;
+
+  // Mesh built from the depth frames.
+  BlockMeshDrawable* block_mesh_;
+
+  // Surface of the volume, raycast at the scale of overlay_target_ when
+  // is_raycast_enabled_.
+  VolumeRaycaster* raycaster_;
+  tango_gl::OverlayTarget overlay_target_;
+  bool is_raycast_enabled_;
+};
+}  // namespace tango_mesh_builder
+
+#endif  // TANGO_MESH_BUILDER_SCENE_H_
@@ -0,0 +1,130 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_MESH_BUILDER_VOLUME_RAYCASTER_H_
+#define TANGO_MESH_BUILDER_VOLUME_RAYCASTER_H_
+
+#include <map>
+#include <vector>
+
+#include <tango-gl/full_screen_quad.h>
+#include <tango-gl/memory_accounting.h>
+#include <tango-gl/util.h>
+#include <tango-util/tsdf_volume.h>
+
+#include <tango-mesh-builder/block_mesh_drawable.h>
+
+namespace tango_mesh_builder {
+
+// VolumeRaycaster draws the surface of a TsdfVolume straight from the
+// distances of its blocks, so that a live preview costs the same whatever the
+// size of the reconstruction, instead of meshing the volume every frame:
+//
+//   // With the distances extracted since the last frame.
+//   for (const tango_util::TsdfVolume::BlockDistances& block : blocks) {
+//     raycaster_->UpdateBlock(block);
+//   }
+//   overlay_target_.SetScale(quality.render_scale);
+//   overlay_target_.Begin();
+//   raycaster_->Render(projection_mat, view_mat, world_T_start_service);
+//   overlay_target_.End();
+//
+// The samples of every block with a surface are a brick of a 2D atlas, the z
+// slices of the block side by side, which the texture filters bilinearly and
+// the shader blends between two slices. A grid texture of the kGridSize^3
+// blocks around the origin of the volume tells which blocks have a brick, and
+// where. Each pixel walks its ray through the grid a block at a time, an
+// empty block costing one fetch, and through the bricks by steps of the
+// distance it reads, until the distance turns negative: the front of the
+// surface, as marching cubes would mesh it. The cost of a frame depends on
+// the pixels drawn, which OverlayTarget lowers along with the dynamic
+// resolution of the QualityGovernor, not on the blocks of the volume.
+//
+// The blocks outside of the grid are not drawn, nor are those past the
+// capacity of the atlas. All methods must be called on the GL thread.
+class VolumeRaycaster {
+ public:
+  // Blocks along each axis of the grid, centered on the origin of the
+  // volume.
+  static const int kGridSize = 64;
+
+  // @param voxel_size: edge length of the voxels of the volume, in meters.
+  // @param truncation_distance: that of the volume, in meters.
+  VolumeRaycaster(float voxel_size, float truncation_distance);
+  ~VolumeRaycaster();
+  VolumeRaycaster(const VolumeRaycaster& other) = delete;
+  VolumeRaycaster& operator=(const VolumeRaycaster&) = delete;
+
+  // Free the textures. The program is shared and stays alive.
+  void DeleteGlResources();
+
+  // Upload the samples of a block with a surface, replacing its previous
+  // ones, or remove a block without a surface.
+  void UpdateBlock(const tango_util::TsdfVolume::BlockDistances& block);
+
+  // Remove every block.
+  void Clear();
+
+  // @return: the number of blocks drawn.
+  size_t GetBlockCount() const { return bricks_.size(); }
+
+  // Render the surface over the current target, without depth. The pixels
+  // whose ray misses the surface are left as they are.
+  //
+  // @param projection_mat: projection matrix from current render camera.
+  // @param view_mat: view matrix from current render camera.
+  // @param model_mat: transformation from the start of service frame.
+  void Render(const glm::mat4& projection_mat, const glm::mat4& view_mat,
+              const glm::mat4& model_mat);
+
+ private:
+  // Create the textures, the grid cleared, once.
+  //
+  // @return: false if they could not be created.
+  bool InitializeTextures();
+
+  // Write the texel of the grid of |index|, pointing at |brick|, or empty
+  // for a |brick| of -1.
+  void SetGridTexel(const BlockIndex& index, int brick);
+
+  // @return: whether |index| is within the grid.
+  static bool IsInGrid(const BlockIndex& index);
+
+  float voxel_size_;
+  float truncation_distance_;
+
+  // The brick of each block drawn, and the bricks freed by removed blocks.
+  std::map<BlockIndex, int> bricks_;
+  std::vector<int> free_bricks_;
+  int brick_count_;
+  bool has_warned_outside_;
+  bool has_warned_full_;
+
+  GLuint program_;
+  GLuint grid_T_clip_handle_;
+  GLuint normal_mat_handle_;
+  GLuint grid_handle_;
+  GLuint atlas_handle_;
+  GLuint distance_scale_handle_;
+  tango_gl::FullScreenQuad quad_;
+
+  GLuint grid_texture_;
+  GLuint atlas_texture_;
+  tango_gl::MemoryAccount texture_memory_;
+};
+}  // namespace tango_mesh_builder
+
+#endif  // TANGO_MESH_BUILDER_VOLUME_RAYCASTER_H_
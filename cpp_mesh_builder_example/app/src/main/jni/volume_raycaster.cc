@@ -0,0 +1,407 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <tuple>
+#include <vector>
+
+#include <tango-gl/gl_state.h>
+#include <tango-gl/render_statistics.h>
+#include <tango-gl/shaders.h>
+
+#include "tango-mesh-builder/volume_raycaster.h"
+
+namespace {
+const int kBlockSize = tango_util::TsdfVolume::kBlockSize;
+const int kSampleSize = tango_util::TsdfVolume::kSampleSize;
+const int kGridSize = tango_mesh_builder::VolumeRaycaster::kGridSize;
+
+// The grid texture holds the z slices of the grid in rows of kGridSlicesPerRow,
+// an RGBA texel per block: the column and row of its brick, and 255 in blue
+// when it has one.
+const int kGridSlicesPerRow = 8;
+const int kGridTextureSize = kGridSize * kGridSlicesPerRow;
+
+// The atlas holds the bricks in rows of kBricksPerRow, each kSampleSize
+// slices of kSampleSize^2 luminance and alpha texels.
+const int kAtlasSize = 2048;
+const int kBrickWidth = kSampleSize * kSampleSize;
+const int kBrickHeight = kSampleSize;
+const int kBricksPerRow = kAtlasSize / kBrickWidth;
+const int kBrickCapacity = kBricksPerRow * (kAtlasSize / kBrickHeight);
+static_assert(kAtlasSize / kBrickHeight <= 256,
+              "The rows of the bricks must fit in a byte of the grid.");
+
+// The near and far points of the ray of every pixel, in grid coordinates:
+// blocks from the corner of the grid, the centers of the voxels at whole
+// samples.
+const char kRaycastVertexShader[] =
+    TANGO_GL_GLSL_HIGHP
+    "attribute vec4 vertex;\n"
+    "uniform mat4 grid_T_clip;\n"
+    "varying vec3 v_near;\n"
+    "varying vec3 v_far;\n"
+    "void main() {\n"
+    "  vec4 near = grid_T_clip * vec4(vertex.xy, -1.0, 1.0);\n"
+    "  vec4 far = grid_T_clip * vec4(vertex.xy, 1.0, 1.0);\n"
+    "  v_near = near.xyz / near.w;\n"
+    "  v_far = far.xyz / far.w;\n"
+    "  gl_Position = vec4(vertex.xy, 0.0, 1.0);\n"
+    "}\n";
+
+// The sizes are those of the constants above. The ray steps over the blocks
+// without a brick, and through the bricks by 0.8 of the distance read, at
+// least half a voxel, until it crosses from a positive distance to a
+// negative one, both samples meshable. The surface is shaded as the meshes
+// of BlockMeshDrawable are.
+const char kRaycastFragmentShader[] =
+    TANGO_GL_GLSL_HIGHP
+    "uniform sampler2D grid;\n"
+    "uniform sampler2D atlas;\n"
+    "uniform mat3 normal_mat;\n"
+    "uniform float distance_scale;\n"
+    "varying vec3 v_near;\n"
+    "varying vec3 v_far;\n"
+    "vec4 GetBlock(vec3 block) {\n"
+    "  vec2 slice = vec2(mod(block.z, 8.0), floor(block.z / 8.0));\n"
+    "  return texture2D(grid, (slice * 64.0 + block.xy + 0.5) / 512.0);\n"
+    "}\n"
+    // The distance in voxels, and whether it can be meshed, at |voxel| of
+    // [0, 8]^3 in |brick|.
+    "vec2 GetDistance(vec2 brick, vec3 voxel) {\n"
+    "  float slice = min(floor(voxel.z), 7.0);\n"
+    "  vec2 texel = brick * vec2(81.0, 9.0) + vec2(slice * 9.0, 0.0) +\n"
+    "               voxel.xy + 0.5;\n"
+    "  vec2 lower = texture2D(atlas, texel / 2048.0).ra;\n"
+    "  vec2 upper = texture2D(atlas, (texel + vec2(9.0, 0.0)) / 2048.0).ra;\n"
+    "  vec2 value = mix(lower, upper, voxel.z - slice);\n"
+    "  return vec2((value.x * 255.0 - 127.5) * distance_scale, value.y);\n"
+    "}\n"
+    "void main() {\n"
+    "  vec3 ray = v_far - v_near;\n"
+    "  vec3 safe_ray = vec3(abs(ray.x) > 1e-6 ? ray.x : 1e-6,\n"
+    "                       abs(ray.y) > 1e-6 ? ray.y : 1e-6,\n"
+    "                       abs(ray.z) > 1e-6 ? ray.z : 1e-6);\n"
+    "  vec3 inverse_ray = 1.0 / safe_ray;\n"
+    "  vec3 t0 = -v_near * inverse_ray;\n"
+    "  vec3 t1 = (vec3(64.0) - v_near) * inverse_ray;\n"
+    "  vec3 t_min = min(t0, t1);\n"
+    "  vec3 t_max = max(t0, t1);\n"
+    "  float t = max(max(t_min.x, t_min.y), max(t_min.z, 0.0));\n"
+    "  float t_end = min(min(t_max.x, t_max.y), min(t_max.z, 1.0));\n"
+    "  float t_per_voxel = 1.0 / (8.0 * length(ray));\n"
+    "  vec3 exit_side = step(0.0, safe_ray);\n"
+    "  bool has_previous = false;\n"
+    "  float previous_distance = 0.0;\n"
+    "  float previous_t = 0.0;\n"
+    "  float hit_t = -1.0;\n"
+    "  for (int i = 0; i < 256; ++i) {\n"
+    "    if (t >= t_end) {\n"
+    "      break;\n"
+    "    }\n"
+    "    vec3 position = v_near + ray * t;\n"
+    "    vec3 block = clamp(floor(position), 0.0, 63.0);\n"
+    "    vec4 entry = GetBlock(block);\n"
+    "    if (entry.b < 0.5) {\n"
+    "      vec3 exits = (block + exit_side - v_near) * inverse_ray;\n"
+    "      t = min(min(exits.x, exits.y), exits.z) + 0.001 * t_per_voxel;\n"
+    "      has_previous = false;\n"
+    "      continue;\n"
+    "    }\n"
+    "    vec2 brick = floor(entry.rg * 255.0 + 0.5);\n"
+    "    vec2 value = GetDistance(brick, (position - block) * 8.0);\n"
+    "    if (value.y < 0.99) {\n"
+    "      t += 0.5 * t_per_voxel;\n"
+    "      has_previous = false;\n"
+    "      continue;\n"
+    "    }\n"
+    "    if (has_previous && previous_distance > 0.0 && value.x <= 0.0) {\n"
+    "      hit_t = previous_t + (t - previous_t) * previous_distance /\n"
+    "                               (previous_distance - value.x);\n"
+    "      break;\n"
+    "    }\n"
+    "    has_previous = true;\n"
+    "    previous_distance = value.x;\n"
+    "    previous_t = t;\n"
+    "    t += max(0.8 * abs(value.x), 0.5) * t_per_voxel;\n"
+    "  }\n"
+    "  if (hit_t < 0.0) {\n"
+    "    discard;\n"
+    "  }\n"
+    "  vec3 position = v_near + ray * hit_t;\n"
+    "  vec3 block = clamp(floor(position), 0.0, 63.0);\n"
+    "  vec4 entry = GetBlock(block);\n"
+    "  vec2 brick = floor(entry.rg * 255.0 + 0.5);\n"
+    "  vec3 voxel = (position - block) * 8.0;\n"
+    "  vec3 normal = vec3(\n"
+    "      GetDistance(brick, min(voxel + vec3(0.5, 0.0, 0.0), 8.0)).x -\n"
+    "          GetDistance(brick, max(voxel - vec3(0.5, 0.0, 0.0), 0.0)).x,\n"
+    "      GetDistance(brick, min(voxel + vec3(0.0, 0.5, 0.0), 8.0)).x -\n"
+    "          GetDistance(brick, max(voxel - vec3(0.0, 0.5, 0.0), 0.0)).x,\n"
+    "      GetDistance(brick, min(voxel + vec3(0.0, 0.0, 0.5), 8.0)).x -\n"
+    "          GetDistance(brick, max(voxel - vec3(0.0, 0.0, 0.5), 0.0)).x);\n"
+    "  if (entry.b < 0.5 || dot(normal, normal) == 0.0) {\n"
+    "    normal = -ray;\n"
+    "  }\n"
+    "  vec3 world_normal = normalize(normal_mat * normal);\n"
+    "  float diffuse = max(dot(world_normal, vec3(0.0, 1.0, 0.0)), 0.0);\n"
+    "  vec3 tint = world_normal * 0.25 + vec3(0.65);\n"
+    "  gl_FragColor = vec4(tint * (0.5 + 0.5 * diffuse), 1.0);\n"
+    "}\n";
+}  // namespace
+
+namespace tango_mesh_builder {
+
+const int VolumeRaycaster::kGridSize;
+
+VolumeRaycaster::VolumeRaycaster(float voxel_size, float truncation_distance)
+    : voxel_size_(voxel_size),
+      truncation_distance_(truncation_distance),
+      brick_count_(0),
+      has_warned_outside_(false),
+      has_warned_full_(false),
+      program_(0),
+      grid_texture_(0),
+      atlas_texture_(0),
+      texture_memory_(tango_gl::kMemoryTagTexture, tango_gl::kMemoryGpu) {
+  const tango_gl::util::SharedProgram* program =
+      tango_gl::util::GetSharedProgram(kRaycastVertexShader,
+                                       kRaycastFragmentShader);
+  if (!program) {
+    LOGE("Could not create the raycast program.");
+    return;
+  }
+  program_ = program->GetId();
+  grid_T_clip_handle_ = program->GetUniformLocation("grid_T_clip");
+  normal_mat_handle_ = program->GetUniformLocation("normal_mat");
+  grid_handle_ = program->GetUniformLocation("grid");
+  atlas_handle_ = program->GetUniformLocation("atlas");
+  distance_scale_handle_ = program->GetUniformLocation("distance_scale");
+  quad_.SetAttributeLocations(program->GetAttribLocation("vertex"), -1);
+}
+
+VolumeRaycaster::~VolumeRaycaster() { DeleteGlResources(); }
+
+void VolumeRaycaster::DeleteGlResources() {
+  // The program is owned by tango_gl::util::GetSharedProgram().
+  program_ = 0;
+  quad_.DeleteGlResources();
+  if (grid_texture_ != 0) {
+    glDeleteTextures(1, &grid_texture_);
+    grid_texture_ = 0;
+  }
+  if (atlas_texture_ != 0) {
+    glDeleteTextures(1, &atlas_texture_);
+    atlas_texture_ = 0;
+  }
+  texture_memory_.Set(0);
+  bricks_.clear();
+  free_bricks_.clear();
+  brick_count_ = 0;
+}
+
+bool VolumeRaycaster::InitializeTextures() {
+  if (grid_texture_ != 0) {
+    return true;
+  }
+  if (program_ == 0) {
+    return false;
+  }
+  // The grid is read block by block, and starts empty.
+  const std::vector<uint8_t> empty_grid(
+      kGridTextureSize * kGridTextureSize * 4, 0);
+  glGenTextures(1, &grid_texture_);
+  tango_gl::CountRender(tango_gl::kRenderCounterTextureBinds);
+  glBindTexture(GL_TEXTURE_2D, grid_texture_);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, kGridTextureSize, kGridTextureSize,
+               0, GL_RGBA, GL_UNSIGNED_BYTE, empty_grid.data());
+
+  glGenTextures(1, &atlas_texture_);
+  tango_gl::CountRender(tango_gl::kRenderCounterTextureBinds);
+  glBindTexture(GL_TEXTURE_2D, atlas_texture_);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE_ALPHA, kAtlasSize, kAtlasSize,
+               0, GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE, nullptr);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  texture_memory_.Set(
+      tango_gl::EstimateTextureBytes(kGridTextureSize, kGridTextureSize,
+                                     GL_RGBA, GL_UNSIGNED_BYTE) +
+      tango_gl::EstimateTextureBytes(kAtlasSize, kAtlasSize,
+                                     GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE));
+  tango_gl::util::CheckGlError("VolumeRaycaster::InitializeTextures()");
+  return true;
+}
+
+bool VolumeRaycaster::IsInGrid(const BlockIndex& index) {
+  const int half_size = kGridSize / 2;
+  return std::get<0>(index) >= -half_size && std::get<0>(index) < half_size &&
+         std::get<1>(index) >= -half_size && std::get<1>(index) < half_size &&
+         std::get<2>(index) >= -half_size && std::get<2>(index) < half_size;
+}
+
+void VolumeRaycaster::SetGridTexel(const BlockIndex& index, int brick) {
+  const int x = std::get<0>(index) + kGridSize / 2;
+  const int y = std::get<1>(index) + kGridSize / 2;
+  const int z = std::get<2>(index) + kGridSize / 2;
+  uint8_t texel[4] = {0, 0, 0, 0};
+  if (brick >= 0) {
+    texel[0] = static_cast<uint8_t>(brick % kBricksPerRow);
+    texel[1] = static_cast<uint8_t>(brick / kBricksPerRow);
+    texel[2] = 255;
+    texel[3] = 255;
+  }
+  tango_gl::CountRender(tango_gl::kRenderCounterTextureBinds);
+  glBindTexture(GL_TEXTURE_2D, grid_texture_);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, (z % kGridSlicesPerRow) * kGridSize + x,
+                  (z / kGridSlicesPerRow) * kGridSize + y, 1, 1, GL_RGBA,
+                  GL_UNSIGNED_BYTE, texel);
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void VolumeRaycaster::UpdateBlock(
+    const tango_util::TsdfVolume::BlockDistances& block) {
+  const BlockIndex index(block.index.x, block.index.y, block.index.z);
+  std::map<BlockIndex, int>::iterator it = bricks_.find(index);
+  if (!block.has_surface) {
+    if (it != bricks_.end()) {
+      SetGridTexel(index, -1);
+      free_bricks_.push_back(it->second);
+      bricks_.erase(it);
+    }
+    return;
+  }
+  if (!IsInGrid(index)) {
+    if (!has_warned_outside_) {
+      LOGI("VolumeRaycaster: Blocks past %d blocks from the origin are not "
+           "drawn.",
+           kGridSize / 2);
+      has_warned_outside_ = true;
+    }
+    return;
+  }
+  if (!InitializeTextures()) {
+    return;
+  }
+
+  int brick;
+  if (it != bricks_.end()) {
+    brick = it->second;
+  } else if (!free_bricks_.empty()) {
+    brick = free_bricks_.back();
+    free_bricks_.pop_back();
+  } else if (brick_count_ < kBrickCapacity) {
+    brick = brick_count_++;
+  } else {
+    if (!has_warned_full_) {
+      LOGE("VolumeRaycaster: The atlas is full, %d blocks are drawn.",
+           kBrickCapacity);
+      has_warned_full_ = true;
+    }
+    return;
+  }
+
+  tango_gl::CountRender(tango_gl::kRenderCounterTextureBinds);
+  glBindTexture(GL_TEXTURE_2D, atlas_texture_);
+  // The rows of luminance and alpha pairs have an odd number of texels.
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, (brick % kBricksPerRow) * kBrickWidth,
+                  (brick / kBricksPerRow) * kBrickHeight, kBrickWidth,
+                  kBrickHeight, GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE,
+                  block.samples);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  if (it == bricks_.end()) {
+    bricks_[index] = brick;
+    SetGridTexel(index, brick);
+  }
+  tango_gl::util::CheckGlError("VolumeRaycaster::UpdateBlock()");
+}
+
+void VolumeRaycaster::Clear() {
+  if (grid_texture_ != 0 && !bricks_.empty()) {
+    const std::vector<uint8_t> empty_grid(
+        kGridTextureSize * kGridTextureSize * 4, 0);
+    tango_gl::CountRender(tango_gl::kRenderCounterTextureBinds);
+    glBindTexture(GL_TEXTURE_2D, grid_texture_);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, kGridTextureSize,
+                    kGridTextureSize, GL_RGBA, GL_UNSIGNED_BYTE,
+                    empty_grid.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+  }
+  bricks_.clear();
+  free_bricks_.clear();
+  brick_count_ = 0;
+  has_warned_full_ = false;
+}
+
+void VolumeRaycaster::Render(const glm::mat4& projection_mat,
+                             const glm::mat4& view_mat,
+                             const glm::mat4& model_mat) {
+  if (program_ == 0 || bricks_.empty()) {
+    return;
+  }
+  // From the start of service frame to blocks of the grid, whose samples are
+  // at the voxel centers.
+  const glm::mat4 grid_T_start_service =
+      glm::translate(glm::mat4(1.0f),
+                     glm::vec3(kGridSize / 2 - 0.5f / kBlockSize)) *
+      glm::scale(glm::mat4(1.0f), glm::vec3(1.0f / (kBlockSize * voxel_size_)));
+  const glm::mat4 grid_T_clip =
+      grid_T_start_service *
+      glm::inverse(projection_mat * view_mat * model_mat);
+  const glm::mat3 normal_mat(model_mat);
+
+  const bool was_depth_test_enabled = glIsEnabled(GL_DEPTH_TEST) == GL_TRUE;
+  const bool was_cull_face_enabled = glIsEnabled(GL_CULL_FACE) == GL_TRUE;
+  tango_gl::GlState::Disable(GL_DEPTH_TEST);
+  tango_gl::GlState::Disable(GL_CULL_FACE);
+  tango_gl::GlState::UseProgram(program_);
+  glUniformMatrix4fv(grid_T_clip_handle_, 1, GL_FALSE,
+                     glm::value_ptr(grid_T_clip));
+  glUniformMatrix3fv(normal_mat_handle_, 1, GL_FALSE,
+                     glm::value_ptr(normal_mat));
+  glUniform1f(distance_scale_handle_,
+              truncation_distance_ / (127.5f * voxel_size_));
+  glActiveTexture(GL_TEXTURE0);
+  tango_gl::CountRender(tango_gl::kRenderCounterTextureBinds);
+  glBindTexture(GL_TEXTURE_2D, grid_texture_);
+  glUniform1i(grid_handle_, 0);
+  glActiveTexture(GL_TEXTURE1);
+  tango_gl::CountRender(tango_gl::kRenderCounterTextureBinds);
+  glBindTexture(GL_TEXTURE_2D, atlas_texture_);
+  glUniform1i(atlas_handle_, 1);
+  quad_.Draw();
+
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  tango_gl::GlState::UseProgram(0);
+  if (was_depth_test_enabled) {
+    tango_gl::GlState::Enable(GL_DEPTH_TEST);
+  }
+  if (was_cull_face_enabled) {
+    tango_gl::GlState::Enable(GL_CULL_FACE);
+  }
+  tango_gl::util::CheckGlError("VolumeRaycaster::Render()");
+}
+
+}  // namespace tango_mesh_builder
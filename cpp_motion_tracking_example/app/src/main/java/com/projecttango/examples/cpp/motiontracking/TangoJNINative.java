@@ -76,4 +76,30 @@ public class TangoJNINative {
   //    see Android documentation for detail:
   //    http://developer.android.com/reference/android/view/Surface.html#ROTATION_0
   public static native void setScreenRotation(int rotationIndex);
+
+  // Set the pose the scene is rendered with:
+  //   0 for the latest pose, 1 for the pose predicted at the time the frame is
+  //   displayed.
+  public static native void setRenderPoseMode(int mode);
+
+  // Render both eyes of a headset side by side, for a device mounted in one
+  // in landscape.
+  public static native void setStereoEnabled(boolean enabled);
+
+  // Follow the device from behind and above, drawing the path it went
+  // through, instead of looking through the device.
+  public static native void setThirdPersonEnabled(boolean enabled);
+
+  // Start recording where the native code spends its time, see
+  // tango-gl/tracing.h.
+  public static native void startTracing();
+
+  // Stop recording, the recorded time slices are kept for dumpTrace().
+  public static native void stopTracing();
+
+  // Write the recorded time slices as a Chrome trace JSON file, e.g. under
+  // getExternalFilesDir(null) to pull it from the sdcard.
+  //
+  // @return false if the file could not be written.
+  public static native boolean dumpTrace(String path);
 }
@@ -17,6 +17,7 @@
 #define GLM_FORCE_RADIANS
 
 #include <jni.h>
+#include <tango-gl/tracing.h>
 #include <tango-motion-tracking/motion_tracking_app.h>
 #include <tango-motion-tracking/scene.h>
 
@@ -79,11 +80,53 @@ Java_com_projecttango_examples_cpp_motiontracking_TangoJNINative_setScreenRotati
   app.SetScreenRotation(rotation_index);
 }
 
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_motiontracking_TangoJNINative_setRenderPoseMode(
+    JNIEnv*, jobject, int mode) {
+  app.SetRenderPoseMode(
+      static_cast<tango_motion_tracking::MotiongTrackingApp::RenderPoseMode>(
+          mode));
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_motiontracking_TangoJNINative_setStereoEnabled(
+    JNIEnv*, jobject, jboolean enabled) {
+  app.SetStereoEnabled(enabled);
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_motiontracking_TangoJNINative_setThirdPersonEnabled(
+    JNIEnv*, jobject, jboolean enabled) {
+  app.SetThirdPersonEnabled(enabled);
+}
+
 JNIEXPORT void JNICALL
 Java_com_projecttango_examples_cpp_motiontracking_TangoJNINative_onTangoServiceConnected(
     JNIEnv* env, jobject, jobject iBinder) {
   app.OnTangoServiceConnected(env, iBinder);
 }
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_motiontracking_TangoJNINative_startTracing(
+    JNIEnv*, jobject) {
+  tango_gl::tracing::Start();
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_motiontracking_TangoJNINative_stopTracing(
+    JNIEnv*, jobject) {
+  tango_gl::tracing::Stop();
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_projecttango_examples_cpp_motiontracking_TangoJNINative_dumpTrace(
+    JNIEnv* env, jobject, jstring path) {
+  const char* path_chars = env->GetStringUTFChars(path, nullptr);
+  const bool dumped = tango_gl::tracing::DumpChromeTrace(path_chars);
+  env->ReleaseStringUTFChars(path, path_chars);
+  return dumped;
+}
+
 #ifdef __cplusplus
 }
 #endif
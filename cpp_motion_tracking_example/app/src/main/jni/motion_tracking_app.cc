@@ -17,10 +17,42 @@
 #include <tango_support_api.h>
 
 #include <tango-gl/conversions.h>
+#include <tango-gl/tracing.h>
+#include <tango-util/pose_source.h>
 #include "tango-motion-tracking/motion_tracking_app.h"
 
+namespace {
+// Interval before the latest pose over which the device velocity is measured
+// to predict the pose at display time.
+const double kVelocityInterval = 0.03;
+
+// This function routes onPoseAvailable callbacks to the application object for
+// handling.
+//
+// @param context, context will be a pointer to a MotiongTrackingApp
+//        instance on which to call callbacks.
+// @param pose, pose data to route to onPoseAvailable function.
+void onPoseAvailableRouter(void* context, const TangoPoseData* pose) {
+  tango_motion_tracking::MotiongTrackingApp* app =
+      static_cast<tango_motion_tracking::MotiongTrackingApp*>(context);
+  app->onPoseAvailable(pose);
+}
+}  // namespace
+
 namespace tango_motion_tracking {
-MotiongTrackingApp::MotiongTrackingApp() {}
+MotiongTrackingApp::MotiongTrackingApp()
+    : render_pose_mode_(kLatestPose),
+      is_stereo_enabled_(false),
+      has_stereo_intrinsics_(false) {}
+
+void MotiongTrackingApp::onPoseAvailable(const TangoPoseData* pose) {
+  TANGO_TRACE_SCOPE("MotiongTrackingApp::onPoseAvailable");
+  pose_predictor_.OnPoseAvailable(pose);
+  if (pose->status_code == TANGO_POSE_VALID) {
+    main_scene_.AppendTracePosition(tango_gl::conversions::Vec3TangoToGl(
+        tango_gl::conversions::Vec3FromArray(pose->translation)));
+  }
+}
 
 MotiongTrackingApp::~MotiongTrackingApp() {
   if (tango_config_ != nullptr) {
@@ -64,7 +96,22 @@ int MotiongTrackingApp::TangoSetupConfig() {
 // Connect to Tango Service, service will start running, and
 // pose can be queried.
 bool MotiongTrackingApp::TangoConnect() {
-  TangoErrorType ret = TangoService_connect(this, tango_config_);
+  // The pose callback follows the service clock for pose prediction and feeds
+  // the trace, the poses rendered with are queried while rendering.
+  TangoCoordinateFramePair frame_pair;
+  frame_pair.base = TANGO_COORDINATE_FRAME_START_OF_SERVICE;
+  frame_pair.target = TANGO_COORDINATE_FRAME_DEVICE;
+  TangoErrorType ret = TangoService_connectOnPoseAvailable(
+      1, &frame_pair, onPoseAvailableRouter);
+  if (ret != TANGO_SUCCESS) {
+    LOGE(
+        "MotiongTrackingApp: Failed to connect to pose callback with error"
+        "code: %d",
+        ret);
+    return false;
+  }
+
+  ret = TangoService_connect(this, tango_config_);
   if (ret != TANGO_SUCCESS) {
     LOGE(
         "MotiongTrackingApp: Failed to connect to the Tango service with"
@@ -87,7 +134,7 @@ void MotiongTrackingApp::TangoDisconnect() {
 }
 
 void MotiongTrackingApp::InitializeGLContent() {
-  TangoSupport_initialize(TangoService_getPoseAtTime);
+  TangoSupport_initialize(tango_util::GetPoseAtTime);
   main_scene_.InitGLContent();
 }
 
@@ -96,6 +143,7 @@ void MotiongTrackingApp::SetViewPort(int width, int height) {
 }
 
 void MotiongTrackingApp::Render() {
+  TANGO_TRACE_SCOPE("MotiongTrackingApp::Render");
   TangoPoseData pose;
 
   TangoSupport_getPoseAtTime(
@@ -108,12 +156,38 @@ void MotiongTrackingApp::Render() {
     return;
   }
 
+  if (render_pose_mode_ == kPredictedDisplayPose) {
+    // Both poses are in the same OpenGL frames, so the motion between them is
+    // extrapolated the same way as in the Tango frames.
+    TangoPoseData earlier_pose;
+    TangoSupport_getPoseAtTime(
+        pose.timestamp - kVelocityInterval,
+        TANGO_COORDINATE_FRAME_START_OF_SERVICE, TANGO_COORDINATE_FRAME_DEVICE,
+        TANGO_SUPPORT_ENGINE_OPENGL,
+        static_cast<TangoSupportDisplayRotation>(screen_rotation_),
+        &earlier_pose);
+    const TangoPoseData latest_pose = pose;
+    if (!pose_predictor_.PredictPose(earlier_pose, latest_pose, &pose)) {
+      pose = latest_pose;
+    }
+  }
+
   glm::vec3 position =
       glm::vec3(pose.translation[0], pose.translation[1], pose.translation[2]);
 
   glm::quat orientation = glm::quat(pose.orientation[3], pose.orientation[0],
                                     pose.orientation[1], pose.orientation[2]);
 
+  if (is_stereo_enabled_ && !has_stereo_intrinsics_) {
+    TangoCameraIntrinsics color_camera_intrinsics;
+    if (TangoService_getCameraIntrinsics(TANGO_CAMERA_COLOR,
+                                         &color_camera_intrinsics) ==
+        TANGO_SUCCESS) {
+      main_scene_.SetStereoIntrinsics(color_camera_intrinsics);
+      has_stereo_intrinsics_ = true;
+    }
+  }
+  main_scene_.SetStereoEnabled(is_stereo_enabled_);
   main_scene_.Render(position, orientation);
 }
 
@@ -16,6 +16,7 @@
 #include <tango_support_api.h>
 
 #include <tango-gl/conversions.h>
+#include <tango-gl/gl_state.h>
 #include <tango-gl/util.h>
 
 #include "tango-motion-tracking/scene.h"
@@ -29,11 +30,22 @@ const glm::vec3 kHeightOffset = glm::vec3(0.0f, 1.3f, 0.0f);
 
 // Color of the ground grid.
 const tango_gl::Color kGridColor(0.85f, 0.85f, 0.85f);
+
+// Color of the motion tracking trajectory.
+const tango_gl::Color kTraceColor(0.22f, 0.28f, 0.67f);
+
+// Clipping planes of the eyes of the stereo view.
+const float kStereoNearClippingPlane = 0.1f;
+const float kStereoFarClippingPlane = 100.0f;
 }  // namespace
 
 namespace tango_motion_tracking {
 
-Scene::Scene() {}
+Scene::Scene()
+    : trace_positions_(tango_gl::Trace::kSpacing,
+                       tango_gl::Trace::kMaxPointCount),
+      is_third_person_enabled_(false),
+      is_stereo_enabled_(false) {}
 
 Scene::~Scene() {}
 
@@ -41,13 +53,29 @@ void Scene::InitGLContent() {
   // Allocating render camera and drawable object.
   // All of these objects are for visualization purposes.
   camera_ = new tango_gl::Camera();
+  third_person_camera_ = new tango_gl::GestureCamera();
+  third_person_camera_->SetCameraType(
+      tango_gl::GestureCamera::CameraType::kThirdPerson);
+  axis_ = new tango_gl::Axis();
+  trace_ = new tango_gl::Trace();
+  trace_->SetColor(kTraceColor);
+  // The positions are those of the device, whose origin the camera is raised
+  // from.
+  trace_->SetPosition(kHeightOffset);
   grid_ = new tango_gl::Grid();
 
   grid_->SetColor(kGridColor);
+  // Falls back to lines where the context can not draw it.
+  grid_->SetProcedural(true);
+  static_objects_.Add(grid_, grid_->GetBoundingBox());
 }
 
 void Scene::DeleteResources() {
+  static_objects_.Clear();
   delete camera_;
+  delete third_person_camera_;
+  delete axis_;
+  delete trace_;
   delete grid_;
 }
 
@@ -56,20 +84,69 @@ void Scene::SetupViewPort(int w, int h) {
     LOGE("Setup graphic height not valid");
   }
   camera_->SetAspectRatio(static_cast<float>(w) / static_cast<float>(h));
+  third_person_camera_->SetAspectRatio(static_cast<float>(w) /
+                                       static_cast<float>(h));
+  stereo_rig_.SetSurfaceSize(w, h);
   glViewport(0, 0, w, h);
 }
 
+void Scene::SetStereoIntrinsics(const TangoCameraIntrinsics& intrinsics) {
+  stereo_rig_.SetIntrinsics(
+      static_cast<float>(intrinsics.width),
+      static_cast<float>(intrinsics.height), static_cast<float>(intrinsics.fx),
+      static_cast<float>(intrinsics.fy), static_cast<float>(intrinsics.cx),
+      static_cast<float>(intrinsics.cy), kStereoNearClippingPlane,
+      kStereoFarClippingPlane);
+}
+
 void Scene::Render(const glm::vec3& position, const glm::quat& rotation) {
-  glEnable(GL_DEPTH_TEST);
-  glEnable(GL_CULL_FACE);
+  tango_gl::GlState::Enable(GL_DEPTH_TEST);
+  tango_gl::GlState::Enable(GL_CULL_FACE);
 
   glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
   glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
 
   camera_->SetPosition(position + kHeightOffset);
   camera_->SetRotation(rotation);
+  // Taken every frame, so that the trace is complete when the view changes.
+  trace_->UpdateVertexArray(&trace_positions_);
+
+  if (is_third_person_enabled_ && !is_stereo_enabled_) {
+    third_person_camera_->SetAnchorPosition(position + kHeightOffset);
+    const glm::mat4 projection_mat =
+        third_person_camera_->GetProjectionMatrix();
+    const glm::mat4 view_mat = third_person_camera_->GetViewMatrix();
+    axis_->SetPosition(position + kHeightOffset);
+    axis_->SetRotation(rotation);
+    axis_->Render(projection_mat, view_mat);
+    trace_->Render(projection_mat, view_mat);
+    static_objects_.Render(projection_mat, view_mat);
+    return;
+  }
+
+  if (!is_stereo_enabled_) {
+    static_objects_.Render(camera_->GetProjectionMatrix(),
+                           camera_->GetViewMatrix());
+    return;
+  }
 
-  grid_->Render(camera_->GetProjectionMatrix(), camera_->GetViewMatrix());
+  // The objects are culled once, against a frustum containing both eyes.
+  stereo_rig_.Update(camera_->GetViewMatrix());
+  stereo_visible_objects_.clear();
+  static_objects_.Cull(stereo_rig_.GetCullingFrustum(),
+                       &stereo_visible_objects_);
+  GLint previous_viewport[4];
+  glGetIntegerv(GL_VIEWPORT, previous_viewport);
+  for (int i = 0; i < tango_gl::StereoRig::kEyeCount; ++i) {
+    const tango_gl::StereoRig::Eye eye =
+        static_cast<tango_gl::StereoRig::Eye>(i);
+    stereo_rig_.SetEyeViewport(eye);
+    for (const tango_gl::DrawableObject* object : stereo_visible_objects_) {
+      object->Render(stereo_rig_.GetProjection(), stereo_rig_.GetView(eye));
+    }
+  }
+  glViewport(previous_viewport[0], previous_viewport[1], previous_viewport[2],
+             previous_viewport[3]);
 }
 
 }  // namespace tango_motion_tracking
@@ -24,6 +24,7 @@
 
 #include <tango_client_api.h>  // NOLINT
 #include <tango-gl/util.h>
+#include <tango-util/pose_predictor.h>
 
 #include <tango-motion-tracking/scene.h>
 
@@ -32,6 +33,14 @@ namespace tango_motion_tracking {
 // MotiongTrackingApp handles the application lifecycle and resources.
 class MotiongTrackingApp {
  public:
+  // Pose the scene is rendered with.
+  enum RenderPoseMode {
+    // Latest pose available from the service.
+    kLatestPose = 0,
+    // Pose predicted at the time the frame reaches the display.
+    kPredictedDisplayPose = 1
+  };
+
   // Constructor and deconstructor.
   MotiongTrackingApp();
   ~MotiongTrackingApp();
@@ -74,6 +83,27 @@ class MotiongTrackingApp {
   //    http://developer.android.com/reference/android/view/Surface.html#ROTATION_0
   void SetScreenRotation(int screen_roatation);
 
+  // Set the pose the scene is rendered with.
+  //
+  // @param mode: render at the latest pose or at the predicted display time
+  //    pose.
+  void SetRenderPoseMode(RenderPoseMode mode) { render_pose_mode_ = mode; }
+
+  // Render both eyes of a headset the device is mounted in, side by side on
+  // the screen, with the intrinsics of the color camera.
+  void SetStereoEnabled(bool enabled) { is_stereo_enabled_ = enabled; }
+
+  // Follow the device from behind, drawing the path it went through.
+  void SetThirdPersonEnabled(bool enabled) {
+    main_scene_.SetThirdPersonEnabled(enabled);
+  }
+
+  // Tango service pose callback function for the start of service to device
+  // frame pair. Feeds the trace of the scene at the rate of the service.
+  //
+  // @param pose: pose data, caller allocated.
+  void onPoseAvailable(const TangoPoseData* pose);
+
   // Call when Tango Service is connected successfully.
   void OnTangoServiceConnected(JNIEnv* env, jobject iBinder);
 
@@ -89,6 +119,16 @@ class MotiongTrackingApp {
 
   // Screen rotation index.
   int screen_rotation_;
+
+  // Follows the service clock to estimate the display time of the frames in
+  // kPredictedDisplayPose mode.
+  tango_util::PosePredictor pose_predictor_;
+  RenderPoseMode render_pose_mode_;
+
+  // Whether to render both eyes, and whether the scene has the intrinsics of
+  // the color camera they are rendered with, queried once connected.
+  bool is_stereo_enabled_;
+  bool has_stereo_intrinsics_;
 };
 }  // namespace tango_motion_tracking
 
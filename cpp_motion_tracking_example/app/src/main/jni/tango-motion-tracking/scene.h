@@ -19,10 +19,16 @@
 
 #include <jni.h>
 #include <memory>
+#include <vector>
 
 #include <tango_client_api.h>  // NOLINT
+#include <tango-gl/axis.h>
+#include <tango-gl/bounding_volume_hierarchy.h>
 #include <tango-gl/gesture_camera.h>
 #include <tango-gl/grid.h>
+#include <tango-gl/stereo_rig.h>
+#include <tango-gl/trace.h>
+#include <tango-gl/trajectory.h>
 #include <tango-gl/util.h>
 
 namespace tango_motion_tracking {
@@ -49,12 +55,51 @@ class Scene {
   // Render loop.
   void Render(const glm::vec3& position, const glm::quat& roatation);
 
+  // Render both eyes of a headset side by side, instead of the whole view
+  // port from the device.
+  void SetStereoEnabled(bool enabled) { is_stereo_enabled_ = enabled; }
+
+  // Set the intrinsics the projection of each eye is derived from.
+  // @param intrinsics: of the color camera.
+  void SetStereoIntrinsics(const TangoCameraIntrinsics& intrinsics);
+
+  // Follow the device from behind and above, drawing its axes and its trace,
+  // instead of looking through it. The stereo view is always first person.
+  void SetThirdPersonEnabled(bool enabled) {
+    is_third_person_enabled_ = enabled;
+  }
+
+  // Append the position of the device to the trace, in the OpenGL world. Can
+  // be called on any thread, e.g. for every pose of the service, so that the
+  // trace does not depend on the frame rate.
+  void AppendTracePosition(const glm::vec3& position) {
+    trace_positions_.Append(position);
+  }
+
  private:
   // Camera for rendering the scene.
   tango_gl::Camera* camera_;
 
+  // Camera following the device in the third person view, with the device
+  // axes and trace it draws. The trace is drawn from the positions appended
+  // to trace_positions_ at the rate of the poses.
+  tango_gl::GestureCamera* third_person_camera_;
+  tango_gl::Axis* axis_;
+  tango_gl::Trace* trace_;
+  tango_gl::SharedTrajectory trace_positions_;
+  bool is_third_person_enabled_;
+
   // Ground grid.
   tango_gl::Grid* grid_;
+
+  // Objects that do not move, drawn only when they are in view.
+  tango_gl::BoundingVolumeHierarchy static_objects_;
+
+  // The eyes when is_stereo_enabled_ is set, and the objects they may see,
+  // culled once for both.
+  tango_gl::StereoRig stereo_rig_;
+  bool is_stereo_enabled_;
+  std::vector<const tango_gl::DrawableObject*> stereo_visible_objects_;
 };
 }  // namespace tango_motion_tracking
 
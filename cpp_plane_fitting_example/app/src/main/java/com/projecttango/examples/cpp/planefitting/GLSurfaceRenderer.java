@@ -18,6 +18,8 @@ package com.projecttango.examples.cpp.planefitting;
 
 import android.opengl.GLSurfaceView;
 
+import com.projecttango.examples.cpp.util.TouchBatch;
+
 import javax.microedition.khronos.egl.EGLConfig;
 import javax.microedition.khronos.opengles.GL10;
 
@@ -33,6 +35,13 @@ public class GLSurfaceRenderer implements GLSurfaceView.Renderer {
 
     // Render loop of the GL context.
     public void onDrawFrame(GL10 gl) {
+        // The taps since the previous frame, in a single call.
+        TouchBatch touchBatch = mMainActivity.getTouchBatch();
+        int touchSampleCount = touchBatch.take();
+        if (touchSampleCount > 0) {
+            JNIInterface.onTouchEvents(touchBatch.getTaken(),
+                                       touchSampleCount);
+        }
         JNIInterface.render();
     }
 
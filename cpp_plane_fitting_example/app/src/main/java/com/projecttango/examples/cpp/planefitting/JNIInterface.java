@@ -69,6 +69,20 @@ public class JNIInterface {
   // Main render loop.
   public static native void render();
 
-  // Respond to a touch event.
-  public static native void onTouchEvent(float x, float y);
+  // Pass the touch samples of a frame, handled at the start of the next
+  // render(). See TouchBatch for the layout of |samples|.
+  public static native void onTouchEvents(float[] samples, int sampleCount);
+
+  // Start recording where the native code spends its time, see
+  // tango-gl/tracing.h.
+  public static native void startTracing();
+
+  // Stop recording, the recorded time slices are kept for dumpTrace().
+  public static native void stopTracing();
+
+  // Write the recorded time slices as a Chrome trace JSON file, e.g. under
+  // getExternalFilesDir(null) to pull it from the sdcard.
+  //
+  // @return false if the file could not be written.
+  public static native boolean dumpTrace(String path);
 }
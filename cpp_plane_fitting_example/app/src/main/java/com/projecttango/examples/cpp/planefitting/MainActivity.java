@@ -40,6 +40,7 @@ import java.util.Iterator;
 import java.util.Map;
 
 import com.projecttango.examples.cpp.util.TangoInitializationHelper;
+import com.projecttango.examples.cpp.util.TouchBatch;
 
 /**
  * Primary activity of the example.
@@ -55,6 +56,9 @@ public class MainActivity extends Activity {
   private GLSurfaceView mGLView;
   private GLSurfaceRenderer mRenderer;
 
+  // The taps of the UI thread, handed to the native code by the renderer.
+  private final TouchBatch mTouchBatch = new TouchBatch();
+
   private CustomDrawerLayout mDrawerLayout;
   private ImageButton mDrawerButton;
   private Button mSettingsButton;
@@ -125,21 +129,20 @@ public class MainActivity extends Activity {
   @Override
   public boolean onTouchEvent(final MotionEvent event) {
     if (event.getAction() == MotionEvent.ACTION_DOWN) {
-      // Ensure that handling of the touch event is run on the GL thread
-      // rather than Android UI thread. This ensures we can modify
-      // rendering state without locking.  This event triggers a plane
-      // fit.
-      mGLView.queueEvent(new Runnable() {
-          @Override
-          public void run() {
-            JNIInterface.onTouchEvent(event.getX(), event.getY());
-          }
-        });
+      // The renderer hands the taps of a frame to the native code at once,
+      // on the GL thread, so it can modify rendering state without locking.
+      mTouchBatch.add(1, MotionEvent.ACTION_DOWN, event.getX(), event.getY(),
+                      0.0f, 0.0f);
     }
 
     return super.onTouchEvent(event);
   }
 
+  // @return the taps for the renderer to hand over every frame.
+  public TouchBatch getTouchBatch() {
+    return mTouchBatch;
+  }
+
   private void configureGlSurfaceView() {
     // OpenGL view where all of the graphics are drawn.
     mGLView = (GLSurfaceView) findViewById(R.id.gl_surface_view);
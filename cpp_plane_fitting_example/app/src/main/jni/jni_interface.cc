@@ -15,6 +15,8 @@
  */
 
 #include <jni.h>
+#include <tango-gl/tracing.h>
+#include <tango-gl/util.h>
 
 #include "tango-plane-fitting/plane_fitting_application.h"
 
@@ -70,6 +72,7 @@ JNIEXPORT void JNICALL
 Java_com_projecttango_examples_cpp_planefitting_JNIInterface_render(
     JNIEnv* /*env*/, jobject /*obj*/) {
   app.Render();
+  tango_gl::util::CheckGlErrorsOfFrame();
 }
 
 JNIEXPORT void JNICALL
@@ -79,9 +82,35 @@ Java_com_projecttango_examples_cpp_planefitting_JNIInterface_deleteResources(
 }
 
 JNIEXPORT void JNICALL
-Java_com_projecttango_examples_cpp_planefitting_JNIInterface_onTouchEvent(
-    JNIEnv* /*env*/, jobject /*obj*/, jfloat x, jfloat y) {
-  app.OnTouchEvent(x, y);
+Java_com_projecttango_examples_cpp_planefitting_JNIInterface_onTouchEvents(
+    JNIEnv* env, jobject /*obj*/, jfloatArray samples, jint sample_count) {
+  jfloat* values = env->GetFloatArrayElements(samples, nullptr);
+  if (values == nullptr) {
+    return;
+  }
+  app.OnTouchEvents(values, sample_count);
+  env->ReleaseFloatArrayElements(samples, values, JNI_ABORT);
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_planefitting_JNIInterface_startTracing(
+    JNIEnv*, jobject) {
+  tango_gl::tracing::Start();
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_planefitting_JNIInterface_stopTracing(
+    JNIEnv*, jobject) {
+  tango_gl::tracing::Stop();
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_projecttango_examples_cpp_planefitting_JNIInterface_dumpTrace(
+    JNIEnv* env, jobject, jstring path) {
+  const char* path_chars = env->GetStringUTFChars(path, nullptr);
+  const bool dumped = tango_gl::tracing::DumpChromeTrace(path_chars);
+  env->ReleaseStringUTFChars(path, path_chars);
+  return dumped;
 }
 
 #ifdef __cplusplus
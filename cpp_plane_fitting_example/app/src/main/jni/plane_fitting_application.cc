@@ -20,6 +20,8 @@
 #include <glm/gtx/quaternion.hpp>
 #include <tango-gl/camera.h>
 #include <tango-gl/conversions.h>
+#include <tango-gl/gl_state.h>
+#include <tango-gl/tracing.h>
 #include <tango-gl/util.h>
 
 #include "tango-plane-fitting/plane_fitting.h"
@@ -31,6 +33,25 @@ namespace {
 
 constexpr float kCubeScale = 0.05f;
 
+// The hulls of the planes, translucent, and lifted off their surface so that
+// they are not hidden by the points on it.
+const tango_gl::Color kPlaneColor(0.3f, 0.8f, 1.0f);
+constexpr float kPlaneAlpha = 0.3f;
+constexpr float kPlaneLift = 0.005f;
+
+// Work budget of a frame on the render thread, in milliseconds.
+constexpr double kFrameBudget = 12.0;
+
+// Edge length in meters of the voxels the point cloud is downsampled to
+// before it is rendered, and before planes are detected in it.
+constexpr float kVoxelLeafSize = 0.02f;
+constexpr float kDetectionVoxelLeafSize = 0.03f;
+
+// Only the latest point cloud is kept for plane detection.
+constexpr size_t kPointCloudQueueCapacity = 1;
+// The GL thread and the plane detection.
+constexpr int kPointCloudReaderCount = 2;
+
 /**
  * This function will route callbacks to our application object via the context
  * parameter.
@@ -44,24 +65,76 @@ void OnXYZijAvailableRouter(void* context, const TangoXYZij* xyz_ij) {
   app->OnXYZijAvailable(xyz_ij);
 }
 
+/**
+ * This function will route pose callbacks to our application object via the
+ * context parameter.
+ *
+ * @param context Will be a pointer to a PlaneFittingApplication instance on
+ * which to call callbacks.
+ * @param pose The pose to pass on.
+ */
+void OnPoseAvailableRouter(void* context, const TangoPoseData* pose) {
+  PlaneFittingApplication* app = static_cast<PlaneFittingApplication*>(context);
+  app->OnPoseAvailable(pose);
+}
+
+// The frame pair of the device poses looked up while rendering.
+TangoCoordinateFramePair StartServiceTDeviceFramePair() {
+  TangoCoordinateFramePair frame_pair;
+  frame_pair.base = TANGO_COORDINATE_FRAME_START_OF_SERVICE;
+  frame_pair.target = TANGO_COORDINATE_FRAME_DEVICE;
+  return frame_pair;
+}
+
 }  // end namespace
 
 void PlaneFittingApplication::OnXYZijAvailable(const TangoXYZij* xyz_ij) {
-  TangoSupport_updatePointCloud(point_cloud_manager_, xyz_ij);
+  TANGO_TRACE_SCOPE("PlaneFittingApplication::OnXYZijAvailable");
+  point_cloud_buffer_.Update(xyz_ij);
+  point_cloud_queue_.Post(xyz_ij->timestamp);
+}
+
+void PlaneFittingApplication::OnPoseAvailable(const TangoPoseData* pose) {
+  TANGO_TRACE_SCOPE("PlaneFittingApplication::OnPoseAvailable");
+  pose_history_.OnPoseAvailable(pose);
 }
 
 PlaneFittingApplication::PlaneFittingApplication()
-    : point_cloud_debug_render_(false),
+    : plane_mesh_(nullptr),
+      render_planes_revision_(0),
+      cubes_(kMaxCubeCount),
+      hit_tester_(tango_util::HitTester::Options()),
+      hit_test_timestamp_(-1.0),
+      next_cube_(0),
+      point_cloud_debug_render_(false),
       last_gpu_timestamp_(0.0),
-      opengl_world_T_start_service_(
-          tango_gl::conversions::opengl_world_T_tango_world()),
-      color_camera_T_opengl_camera_(
-          tango_gl::conversions::color_camera_T_opengl_camera()) {}
+      pose_history_(StartServiceTDeviceFramePair()),
+      max_point_cloud_elements_(0),
+      quality_governor_(tango_util::QualityGovernor::DefaultLevels(),
+                        kFrameBudget),
+      render_cloud_reader_(&point_cloud_buffer_),
+      front_cloud_(nullptr),
+      filtered_cloud_(nullptr),
+      detection_cloud_reader_(&point_cloud_buffer_),
+      depth_filter_(tango_util::DepthTemporalFilter::Options()),
+      normal_estimator_(tango_util::NormalEstimator::Options()),
+      plane_detector_(tango_util::PlaneDetector::Options()),
+      plane_tracker_(tango_util::PlaneTracker::Options()),
+      planes_revision_(0),
+      touch_queue_(tango_util::TouchQueue::Options()),
+      point_cloud_queue_(
+          "point cloud", kPointCloudQueueCapacity,
+          tango_util::DispatchQueueBase::kDropOldest,
+          [this](const double& timestamp) { HandlePointCloud(timestamp); }) {
+  voxel_filter_.SetLeafSize(kVoxelLeafSize);
+  detection_filter_.SetLeafSize(kDetectionVoxelLeafSize);
+  dispatcher_.AddQueue(&point_cloud_queue_);
+}
 
 PlaneFittingApplication::~PlaneFittingApplication() {
+  // Stop detecting before the point clouds are freed.
+  dispatcher_.Stop();
   TangoConfig_free(tango_config_);
-  TangoSupport_freePointCloudManager(point_cloud_manager_);
-  point_cloud_manager_ = nullptr;
 }
 
 bool PlaneFittingApplication::CheckTangoVersion(JNIEnv* env, jobject activity,
@@ -80,20 +153,17 @@ bool PlaneFittingApplication::CheckTangoVersion(JNIEnv* env, jobject activity,
     return false;
   }
 
-  if (point_cloud_manager_ == nullptr) {
-    int32_t max_point_cloud_elements;
+  if (!point_cloud_buffer_.IsInitialized()) {
     err = TangoConfig_getInt32(tango_config_, "max_point_cloud_elements",
-                               &max_point_cloud_elements);
+                               &max_point_cloud_elements_);
     if (err != TANGO_SUCCESS) {
       LOGE("Failed to query maximum number of point cloud elements.");
       return false;
     }
 
-    err = TangoSupport_createPointCloudManager(max_point_cloud_elements,
-                                               &point_cloud_manager_);
-    if (err != TANGO_SUCCESS) {
-      return false;
-    }
+    // Read by the GL thread and by the plane detection.
+    point_cloud_buffer_.Initialize(kPointCloudReaderCount,
+                                   max_point_cloud_elements_);
   }
 
   return true;
@@ -152,6 +222,16 @@ bool PlaneFittingApplication::TangoSetupAndConnect() {
     return false;
   }
 
+  // Register for device poses, so that rendering can look them up without a
+  // round-trip to the service.
+  TangoCoordinateFramePair pose_frame_pair = pose_history_.GetFramePair();
+  ret = TangoService_connectOnPoseAvailable(1, &pose_frame_pair,
+                                            OnPoseAvailableRouter);
+  if (ret != TANGO_SUCCESS) {
+    LOGE("Failed to connected to pose callback.");
+    return false;
+  }
+
   // Here, we will connect to the TangoService and set up to run. Note that
   // we are passing in a pointer to ourselves as the context which will be
   // passed back in our callbacks.
@@ -164,94 +244,80 @@ bool PlaneFittingApplication::TangoSetupAndConnect() {
   // Get the intrinsics for the color camera and pass them on to the depth
   // image. We need these to know how to project the point cloud into the color
   // camera frame.
-  ret = TangoService_getCameraIntrinsics(TANGO_CAMERA_COLOR,
-                                         &color_camera_intrinsics_);
-  if (ret != TANGO_SUCCESS) {
+  ret = intrinsics_.Update(TANGO_CAMERA_COLOR);
+  if (ret != TANGO_SUCCESS ||
+      !intrinsics_.GetIntrinsics(TANGO_CAMERA_COLOR,
+                                 &color_camera_intrinsics_)) {
     LOGE(
         "PlaneFittingApplication: Failed to get the intrinsics for the color"
         "camera.");
   }
 
-  constexpr float kNearPlane = 0.1;
-  constexpr float kFarPlane = 100.0;
-
-  projection_matrix_ar_ = tango_gl::Camera::ProjectionMatrixForCameraIntrinsics(
-      color_camera_intrinsics_.width, color_camera_intrinsics_.height,
-      color_camera_intrinsics_.fx, color_camera_intrinsics_.fy,
-      color_camera_intrinsics_.cx, color_camera_intrinsics_.cy, kNearPlane,
-      kFarPlane);
-
-  // Setup fixed pose information
-  TangoPoseData pose_imu_T_color_t0;
-  TangoPoseData pose_imu_T_depth_t0;
-  TangoPoseData pose_imu_T_device_t0;
-
-  TangoCoordinateFramePair frame_pair;
-  glm::vec3 translation;
-  glm::quat rotation;
-
-  // We need to get the extrinsic transform between the color camera and the
-  // IMU coordinate frames. This matrix is then used to compute the extrinsic
-  // transform between color camera and device: C_T_D = C_T_IMU * IMU_T_D.
-  // Note that the matrix C_T_D is a constant transformation since the hardware
-  // will not change, we use the getPoseAtTime() function to query it once right
-  // after the Tango Service connected and store it for efficiency.
-  frame_pair.base = TANGO_COORDINATE_FRAME_IMU;
-  frame_pair.target = TANGO_COORDINATE_FRAME_DEVICE;
-  ret = TangoService_getPoseAtTime(0.0, frame_pair, &pose_imu_T_device_t0);
-  if (ret != TANGO_SUCCESS) {
+  // The depth camera intrinsics size the filtered depth image, and lay out
+  // the point clouds for their normals when the service leaves the ij buffer
+  // empty. Without them the planes are detected from the raw points alone.
+  TangoCameraIntrinsics depth_camera_intrinsics;
+  ret = intrinsics_.Update(TANGO_CAMERA_DEPTH);
+  if (ret == TANGO_SUCCESS &&
+      intrinsics_.GetIntrinsics(TANGO_CAMERA_DEPTH,
+                                &depth_camera_intrinsics)) {
+    depth_filter_.SetIntrinsics(depth_camera_intrinsics);
+    normal_estimator_.SetIntrinsics(depth_camera_intrinsics);
+  } else {
     LOGE(
-        "PlaneFittingApplication: Failed to get transform between the IMU and"
-        "device frames. Something is wrong with device extrinsics.");
-    return false;
+        "PlaneFittingApplication: Failed to get the intrinsics for the depth "
+        "camera.");
   }
-  const glm::mat4 IMU_T_device = tango_gl::conversions::TransformFromArrays(
-      pose_imu_T_device_t0.translation, pose_imu_T_device_t0.orientation);
 
-  // Get color camera with respect to IMU transformation matrix. This matrix is
-  // used to compute the extrinsics between color camera and device:
-  // C_T_D = C_T_IMU * IMU_T_D.
-  frame_pair.base = TANGO_COORDINATE_FRAME_IMU;
-  frame_pair.target = TANGO_COORDINATE_FRAME_CAMERA_COLOR;
-  ret = TangoService_getPoseAtTime(0.0, frame_pair, &pose_imu_T_color_t0);
-  if (ret != TANGO_SUCCESS) {
-    LOGE(
-        "PlaneFittingApplication: Failed to get transform between the IMU and"
-        "camera frames. Something is wrong with device extrinsics.");
-    return false;
+  constexpr float kNearPlane = 0.1;
+  constexpr float kFarPlane = 100.0;
+
+  tango_util::IntrinsicsRegistry::Projection projection;
+  if (intrinsics_.GetProjection(TANGO_CAMERA_COLOR, kNearPlane, kFarPlane,
+                                &projection)) {
+    projection_matrix_ar_ = projection.matrix;
   }
-  const glm::mat4 IMU_T_color = tango_gl::conversions::TransformFromArrays(
-      pose_imu_T_color_t0.translation, pose_imu_T_color_t0.orientation);
 
-  // Get depth camera with respect to imu transformation matrix. This matrix is
-  // used to compute the extrinsics between depth camera and device:
-  // C_T_D = C_T_IMU * IMU_T_D.
-  frame_pair.base = TANGO_COORDINATE_FRAME_IMU;
-  frame_pair.target = TANGO_COORDINATE_FRAME_CAMERA_DEPTH;
-  ret = TangoService_getPoseAtTime(0.0, frame_pair, &pose_imu_T_depth_t0);
+  // The extrinsics between the cameras and the device are constant since the
+  // hardware will not change, so we query them once right after the Tango
+  // Service connected and store them for efficiency.
+  ret = extrinsics_.Update();
   if (ret != TANGO_SUCCESS) {
-    LOGE(
-        "PlaneFittingApplication: Failed to get transform between the IMU and"
-        "camera frames. Something is wrong with device extrinsics.");
+    LOGE("PlaneFittingApplication: Failed to get the device extrinsics.");
     return false;
   }
-  const glm::mat4 IMU_T_depth = tango_gl::conversions::TransformFromArrays(
-      pose_imu_T_depth_t0.translation, pose_imu_T_depth_t0.orientation);
-
-  device_T_depth_ = glm::inverse(IMU_T_device) * IMU_T_depth;
-  device_T_color_ = glm::inverse(IMU_T_device) * IMU_T_color;
-
+  device_T_depth_camera_ =
+      tango_gl::RigidTransform::FromMatrix(extrinsics_.GetDeviceTDepthCamera());
+  device_T_color_camera_ =
+      tango_gl::RigidTransform::FromMatrix(extrinsics_.GetDeviceTColorCamera());
+  color_opengl_camera_T_device_ = tango_gl::RigidTransform::FromMatrix(
+      extrinsics_.GetColorOpenGlCameraTDevice());
+  opengl_world_T_start_service_ = tango_gl::RigidTransform::FromMatrix(
+      extrinsics_.GetOpenGlWorldTStartService());
+
+  // The detection needs the extrinsics, so it only starts once they are
+  // known.
+  dispatcher_.Start();
   return true;
 }
 
-void PlaneFittingApplication::TangoDisconnect() { TangoService_disconnect(); }
+void PlaneFittingApplication::TangoDisconnect() {
+  TangoService_disconnect();
+  dispatcher_.Stop();
+}
 
 bool PlaneFittingApplication::InitializeGLContent() {
   video_overlay_ = new tango_gl::VideoOverlay();
-  point_cloud_renderer_ = new PointCloudRenderer();
-  cube_ = new tango_gl::Cube();
-  cube_->SetScale(glm::vec3(kCubeScale, kCubeScale, kCubeScale));
-  cube_->SetColor(0.7f, 0.7f, 0.7f);
+  point_cloud_renderer_ = new PointCloudRenderer(max_point_cloud_elements_);
+  plane_mesh_ = new tango_gl::Mesh();
+  plane_mesh_->SetShader();
+  plane_mesh_->SetColor(kPlaneColor);
+  plane_mesh_->SetAlpha(kPlaneAlpha);
+  // Uploaded again into the new context.
+  render_planes_revision_ = 0;
+  plane_vertices_.clear();
+  // The framebuffer of a previous context died with it.
+  overlay_target_.InvalidateGlResources();
 
   // The Tango service allows you to connect an OpenGL texture directly to its
   // RGB and fisheye cameras. This is the most efficient way of receiving
@@ -275,21 +341,32 @@ void PlaneFittingApplication::SetViewPort(int width, int height) {
 }
 
 void PlaneFittingApplication::Render() {
+  TANGO_TRACE_SCOPE("PlaneFittingApplication::Render");
+  quality_governor_.BeginFrame();
+  // The taps since the previous frame, seen on the image it shows.
+  touch_queue_.Take(&touch_samples_);
+  for (const tango_util::TouchSample& sample : touch_samples_) {
+    if (sample.event == tango_gl::GestureCamera::kTouch0Down) {
+      OnTouchEvent(sample.x0, sample.y0);
+    }
+  }
   // We need to make sure that we update the texture associated with the color
   // image.
-  if (TangoService_updateTexture(TANGO_CAMERA_COLOR, &last_gpu_timestamp_) !=
-      TANGO_SUCCESS) {
+  TangoErrorType status;
+  {
+    TANGO_TRACE_SCOPE("TangoService_updateTexture");
+    status =
+        TangoService_updateTexture(TANGO_CAMERA_COLOR, &last_gpu_timestamp_);
+  }
+  if (status != TANGO_SUCCESS) {
     LOGE("PlaneFittingApplication: Failed to get a color image.");
     return;
   }
 
   // Querying the GPU color image's frame transformation based its timestamp.
   TangoPoseData pose_start_service_T_color_gpu;
-  TangoCoordinateFramePair color_gpu_frame_pair;
-  color_gpu_frame_pair.base = TANGO_COORDINATE_FRAME_START_OF_SERVICE;
-  color_gpu_frame_pair.target = TANGO_COORDINATE_FRAME_DEVICE;
-  if (TangoService_getPoseAtTime(last_gpu_timestamp_, color_gpu_frame_pair,
-                                 &pose_start_service_T_color_gpu) !=
+  if (pose_history_.GetPoseAtTime(last_gpu_timestamp_,
+                                  &pose_start_service_T_color_gpu) !=
       TANGO_SUCCESS) {
     LOGE(
         "PlaneFittingApplication: Could not find a valid pose at time %lf"
@@ -298,109 +375,122 @@ void PlaneFittingApplication::Render() {
   }
 
   if (pose_start_service_T_color_gpu.status_code == TANGO_POSE_VALID) {
-    const glm::mat4 start_service_T_device =
-        tango_gl::conversions::TransformFromArrays(
+    const tango_gl::RigidTransform start_service_T_device =
+        tango_gl::RigidTransform::FromArrays(
             pose_start_service_T_color_gpu.translation,
             pose_start_service_T_color_gpu.orientation);
 
-    const glm::mat4 start_service_T_color_camera =
-        start_service_T_device * device_T_color_;
-
-    GLRender(start_service_T_color_camera);
+    GLRender(start_service_T_device);
   } else {
     LOGE("Invalid pose for gpu color image at time: %lf", last_gpu_timestamp_);
   }
+  quality_governor_.EndFrame();
 }
 
 void PlaneFittingApplication::GLRender(
-    const glm::mat4& start_service_T_color_camera) {
-  glEnable(GL_CULL_FACE);
+    const tango_gl::RigidTransform& start_service_T_device) {
+  tango_gl::GlState::Enable(GL_CULL_FACE);
 
   glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
   glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
-  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  tango_gl::GlState::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
   // We want to render from the perspective of the device, so we will set our
   // camera based on the transform that was passed in.
-  glm::mat4 opengl_camera_T_ss = glm::inverse(start_service_T_color_camera *
-                                              color_camera_T_opengl_camera_);
+  const tango_gl::RigidTransform opengl_camera_T_ss =
+      color_opengl_camera_T_device_ * start_service_T_device.Inverse();
 
-  glDisable(GL_DEPTH_TEST);
-  glEnable(GL_BLEND);
-  video_overlay_->Render(glm::mat4(1.0), glm::mat4(1.0));
-  glEnable(GL_DEPTH_TEST);
   UpdateCurrentPointData();
-  const glm::mat4 start_service_T_device_t1 = GetStartServiceTDeviceTransform();
-  const glm::mat4 projection_T_depth =
-      projection_matrix_ar_ * opengl_camera_T_ss * start_service_T_device_t1 *
-      device_T_depth_;
-  const glm::mat4 start_service_T_depth =
-      start_service_T_device_t1 * device_T_depth_;
-  point_cloud_renderer_->Render(projection_T_depth, start_service_T_depth,
-                                front_cloud_);
-  glDisable(GL_BLEND);
-
-  glm::mat4 opengl_camera_T_opengl_world =
-      opengl_camera_T_ss *
-      glm::inverse(tango_gl::conversions::opengl_world_T_tango_world());
-  cube_->Render(projection_matrix_ar_, opengl_camera_T_opengl_world);
+  const tango_util::QualityLevel& quality = quality_governor_.GetLevel();
+  overlay_target_.SetScale(quality.render_scale);
+  // Drawn directly, the opaque content goes first and the camera image behind
+  // it, which is then only sampled where nothing covers it. Drawn into the
+  // overlay target, the content is blended over the camera image.
+  const bool is_video_behind = overlay_target_.GetScale() >= 1.0f;
+  if (!is_video_behind) {
+    tango_gl::GlState::Disable(GL_DEPTH_TEST);
+    tango_gl::GlState::Disable(GL_BLEND);
+    video_overlay_->Render(glm::mat4(1.0), glm::mat4(1.0));
+  }
+  tango_gl::GlState::Enable(GL_DEPTH_TEST);
+  tango_gl::GlState::Disable(GL_BLEND);
+  overlay_target_.Begin();
+  if (front_cloud_ != nullptr && quality.render_point_cloud) {
+    const tango_gl::RigidTransform start_service_T_depth =
+        GetStartServiceTDeviceTransform() * device_T_depth_camera_;
+    const glm::mat4 projection_T_depth =
+        projection_matrix_ar_ *
+        (opengl_camera_T_ss * start_service_T_depth).ToMatrix();
+    point_cloud_renderer_->SetPointStride(quality.point_cloud_stride);
+    point_cloud_renderer_->Render(projection_T_depth, start_service_T_depth,
+                                  filtered_cloud_);
+  }
+
+  const tango_gl::RigidTransform opengl_camera_T_opengl_world =
+      opengl_camera_T_ss * opengl_world_T_start_service_.Inverse();
+  cubes_.Render(projection_matrix_ar_, opengl_camera_T_opengl_world.ToMatrix());
+  if (is_video_behind) {
+    video_overlay_->RenderBehind();
+  }
+
+  UpdatePlaneMesh();
+  if (!plane_vertices_.empty()) {
+    // Both sides are seen, and the hulls behind one another all show.
+    tango_gl::GlState::Enable(GL_BLEND);
+    tango_gl::GlState::Disable(GL_CULL_FACE);
+    tango_gl::GlState::DepthMask(GL_FALSE);
+    plane_mesh_->Render(projection_matrix_ar_,
+                        opengl_camera_T_opengl_world.ToMatrix());
+    tango_gl::GlState::DepthMask(GL_TRUE);
+    tango_gl::GlState::Enable(GL_CULL_FACE);
+    tango_gl::GlState::Disable(GL_BLEND);
+  }
+  overlay_target_.End();
 }
 
 void PlaneFittingApplication::DeleteResources() {
+  overlay_target_.DeleteGlResources();
   delete video_overlay_;
-  delete cube_;
   delete point_cloud_renderer_;
+  delete plane_mesh_;
   video_overlay_ = nullptr;
-  cube_ = nullptr;
   point_cloud_renderer_ = nullptr;
+  plane_mesh_ = nullptr;
+  cubes_.Clear();
+  for (tango_gl::DrawableHandle& handle : cube_handles_) {
+    handle = tango_gl::DrawableHandle();
+  }
+  next_cube_ = 0;
+  hit_test_timestamp_ = -1.0;
+}
+
+void PlaneFittingApplication::OnTouchEvents(const float* samples,
+                                            int sample_count) {
+  touch_queue_.Post(samples, sample_count);
 }
 
-// We assume the Java layer ensures this function is called on the GL thread.
 void PlaneFittingApplication::OnTouchEvent(float x, float y) {
-  /// Calculate the conversion from the latest depth camera position to the
-  /// position of the most recent color camera image. This corrects for screen
-  /// lag between the two systems.
-  TangoPoseData pose_color_camera_t0_T_depth_camera_t1;
-  int ret = TangoSupport_calculateRelativePose(
-      last_gpu_timestamp_, TANGO_COORDINATE_FRAME_CAMERA_COLOR,
-      front_cloud_->timestamp, TANGO_COORDINATE_FRAME_CAMERA_DEPTH,
-      &pose_color_camera_t0_T_depth_camera_t1);
-  if (ret != TANGO_SUCCESS) {
-    LOGE("%s: could not calculate relative pose", __func__);
+  if (hit_test_timestamp_ != last_gpu_timestamp_ && !BeginHitTestFrame()) {
     return;
   }
-  glm::vec2 uv(x / screen_width_, y / screen_height_);
-
-  glm::dvec3 double_depth_position;
-  glm::dvec4 double_depth_plane_equation;
-  if (TangoSupport_fitPlaneModelNearClick(
-          front_cloud_, &color_camera_intrinsics_,
-          &pose_color_camera_t0_T_depth_camera_t1, glm::value_ptr(uv),
-          glm::value_ptr(double_depth_position),
-          glm::value_ptr(double_depth_plane_equation)) != TANGO_SUCCESS) {
-    return;  // Assume error has already been reported.
+  const float uv[2] = {x / screen_width_, y / screen_height_};
+  tango_util::HitResult hit;
+  if (!hit_tester_.Query(
+          uv, tango_util::HitResult::kPlane | tango_util::HitResult::kObject,
+          &hit)) {
+    return;
   }
 
-  const glm::vec3 depth_position =
-      static_cast<glm::vec3>(double_depth_position);
-  const glm::vec4 depth_plane_equation =
-      static_cast<glm::vec4>(double_depth_plane_equation);
-
-  const glm::mat4 opengl_world_T_depth = opengl_world_T_start_service_ *
-                                         GetStartServiceTDeviceTransform() *
-                                         device_T_depth_;
-
   // Transform to world coordinates
-  const glm::vec4 world_position =
-      opengl_world_T_depth * glm::vec4(depth_position, 1.0f);
-
-  glm::vec4 world_plane_equation;
-  PlaneTransform(depth_plane_equation, opengl_world_T_depth,
-                 &world_plane_equation);
-
-  point_cloud_renderer_->SetPlaneEquation(world_plane_equation);
-
-  const glm::vec3 plane_normal(world_plane_equation);
+  const glm::vec3 world_position =
+      opengl_world_T_start_service_.TransformPoint(hit.point);
+  const glm::vec3 plane_normal =
+      opengl_world_T_start_service_.TransformVector(hit.normal);
+  if (hit.type == tango_util::HitResult::kPlane) {
+    const glm::vec4 world_plane_equation(
+        plane_normal, -glm::dot(plane_normal, world_position));
+    point_cloud_renderer_->SetPlaneEquation(world_plane_equation);
+  }
 
   // Use world up as the second vector, unless they are nearly parallel.
   // In that case use world +Z.
@@ -420,26 +510,178 @@ void PlaneFittingApplication::OnTouchEvent(float x, float y) {
   rotation_matrix[2] = normal_Z;
   const glm::quat rotation = glm::toQuat(rotation_matrix);
 
-  cube_->SetRotation(rotation);
-  cube_->SetPosition(glm::vec3(world_position) + plane_normal * kCubeScale);
+  // The oldest cube makes room for the new one, and is likely the one it
+  // gets back from the pool.
+  cubes_.Release(cube_handles_[next_cube_]);
+  const tango_gl::DrawableHandle handle = cubes_.Acquire();
+  cube_handles_[next_cube_] = handle;
+  next_cube_ = (next_cube_ + 1) % kMaxCubeCount;
+  tango_gl::Cube* cube = cubes_.Get(handle);
+  if (cube->GetBoundingBox() == NULL) {
+    cube->SetBoundingBox();
+  }
+  cube->SetScale(glm::vec3(kCubeScale, kCubeScale, kCubeScale));
+  cube->SetColor(0.7f, 0.7f, 0.7f);
+  cube->SetRotation(rotation);
+  cube->SetPosition(world_position + plane_normal * kCubeScale);
+  hit_test_timestamp_ = -1.0;
 }
 
-glm::mat4 PlaneFittingApplication::GetStartServiceTDeviceTransform() {
-  TangoCoordinateFramePair frame_pair;
-  frame_pair.base = TANGO_COORDINATE_FRAME_START_OF_SERVICE;
-  frame_pair.target = TANGO_COORDINATE_FRAME_DEVICE;
+bool PlaneFittingApplication::BeginHitTestFrame() {
+  // Cast the rays through the pixels of the color image on screen, from the
+  // color camera pose at the time of that image.
+  TangoPoseData pose_start_service_T_device;
+  if (pose_history_.GetPoseAtTime(last_gpu_timestamp_,
+                                  &pose_start_service_T_device) !=
+          TANGO_SUCCESS ||
+      pose_start_service_T_device.status_code != TANGO_POSE_VALID) {
+    LOGE("%s: could not find the color camera pose", __func__);
+    return false;
+  }
+  const tango_gl::RigidTransform start_service_T_color =
+      tango_gl::RigidTransform::FromArrays(
+          pose_start_service_T_device.translation,
+          pose_start_service_T_device.orientation) *
+      device_T_color_camera_;
+
+  std::shared_ptr<const tango_gl::RayTable> color_rays =
+      intrinsics_.GetRayTable(TANGO_CAMERA_COLOR,
+                              color_camera_intrinsics_.width,
+                              color_camera_intrinsics_.height);
+  if (color_rays == nullptr) {
+    LOGE("%s: the color camera intrinsics are not known", __func__);
+    return false;
+  }
+
+  hit_test_cubes_.Clear();
+  for (const tango_gl::DrawableHandle& handle : cube_handles_) {
+    const tango_gl::Cube* cube = cubes_.Get(handle);
+    if (cube != nullptr) {
+      hit_test_cubes_.Add(cube, *cube->GetBoundingBox());
+    }
+  }
+  hit_tester_.BeginFrame(start_service_T_color, std::move(color_rays));
+  hit_tester_.SetPlanes(&render_planes_);
+  hit_tester_.SetObjects(&hit_test_cubes_,
+                         opengl_world_T_start_service_.Inverse());
+  hit_test_timestamp_ = last_gpu_timestamp_;
+  return true;
+}
+
+tango_gl::RigidTransform
+PlaneFittingApplication::GetStartServiceTDeviceTransform() {
   TangoPoseData pose_start_service_T_device_t1;
 
-  TangoService_getPoseAtTime(front_cloud_->timestamp, frame_pair,
-                             &pose_start_service_T_device_t1);
+  pose_history_.GetPoseAtTime(front_cloud_->timestamp,
+                              &pose_start_service_T_device_t1);
 
-  return tango_gl::conversions::TransformFromArrays(
+  return tango_gl::RigidTransform::FromArrays(
       pose_start_service_T_device_t1.translation,
       pose_start_service_T_device_t1.orientation);
 }
 
+void PlaneFittingApplication::HandlePointCloud(double /*timestamp*/) {
+  TANGO_TRACE_SCOPE("PlaneFittingApplication::HandlePointCloud");
+  bool new_points = false;
+  const TangoXYZij* xyz_ij = detection_cloud_reader_.Acquire(&new_points);
+  if (xyz_ij == nullptr || !new_points) {
+    return;
+  }
+
+  TangoPoseData pose_start_service_T_device;
+  if (pose_history_.GetPoseAtTime(xyz_ij->timestamp,
+                                  &pose_start_service_T_device) !=
+          TANGO_SUCCESS ||
+      pose_start_service_T_device.status_code != TANGO_POSE_VALID) {
+    // The next point cloud can not be registered with the filtered depth.
+    depth_filter_.Reset();
+    return;
+  }
+  const tango_gl::RigidTransform start_service_T_depth =
+      tango_gl::RigidTransform::FromArrays(
+          pose_start_service_T_device.translation,
+          pose_start_service_T_device.orientation) *
+      device_T_depth_camera_;
+
+  if (detection_filter_.GetCapacity() <
+      static_cast<uint32_t>(max_point_cloud_elements_)) {
+    detection_filter_.Reserve(max_point_cloud_elements_);
+  }
+  const TangoXYZij* smoothed_cloud =
+      depth_filter_.Filter(xyz_ij, start_service_T_depth.ToMatrix());
+  const std::vector<glm::vec3>& normals =
+      normal_estimator_.Estimate(smoothed_cloud);
+  const glm::vec3* filtered_normals = nullptr;
+  const TangoXYZij* filtered_cloud = detection_filter_.Filter(
+      smoothed_cloud, normals.data(), &filtered_normals);
+
+  // Planes are detected and tracked in the start of service frame, where they
+  // stay put as the device moves.
+  plane_detector_.Detect(filtered_cloud, filtered_normals,
+                         start_service_T_depth.ToMatrix(), &detected_planes_);
+  plane_tracker_.Update(detected_planes_);
+
+  std::lock_guard<std::mutex> lock(planes_mutex_);
+  plane_tracker_.GetConfirmedPlanes(&planes_);
+  ++planes_revision_;
+}
+
+void PlaneFittingApplication::UpdatePlaneMesh() {
+  {
+    std::lock_guard<std::mutex> lock(planes_mutex_);
+    if (planes_revision_ == render_planes_revision_) {
+      return;
+    }
+    render_planes_revision_ = planes_revision_;
+    render_planes_ = planes_;
+  }
+  hit_test_timestamp_ = -1.0;
+  // A fan of triangles per hull, in the OpenGL world frame.
+  plane_vertices_.clear();
+  for (const tango_util::TrackedPlane& tracked : render_planes_) {
+    const tango_util::DetectedPlane& plane = tracked.plane;
+    if (plane.hull.size() < 3) {
+      continue;
+    }
+    glm::vec4 world_plane_equation;
+    PlaneTransform(plane.equation, opengl_world_T_start_service_,
+                   &world_plane_equation);
+    const glm::vec3 lift = glm::vec3(world_plane_equation) * kPlaneLift;
+    const glm::vec3 tangent =
+        opengl_world_T_start_service_.TransformVector(plane.tangent);
+    const glm::vec3 bitangent =
+        opengl_world_T_start_service_.TransformVector(plane.bitangent);
+    const glm::vec3 origin =
+        opengl_world_T_start_service_.TransformPoint(plane.centroid) + lift;
+    for (size_t i = 1; i + 1 < plane.hull.size(); ++i) {
+      const glm::vec2* corners[3] = {&plane.hull[0], &plane.hull[i],
+                                     &plane.hull[i + 1]};
+      for (const glm::vec2* corner : corners) {
+        const glm::vec3 vertex =
+            origin + corner->x * tangent + corner->y * bitangent;
+        plane_vertices_.insert(plane_vertices_.end(),
+                               {vertex.x, vertex.y, vertex.z});
+      }
+    }
+  }
+  if (!plane_vertices_.empty()) {
+    plane_mesh_->SetVertexBuffers(plane_vertices_, false,
+                                  std::vector<GLuint>());
+  }
+}
+
 void PlaneFittingApplication::UpdateCurrentPointData() {
-  TangoSupport_getLatestPointCloud(point_cloud_manager_, &front_cloud_);
+  bool new_points = false;
+  front_cloud_ = render_cloud_reader_.Acquire(&new_points);
+  if (new_points) {
+    // Sized once for the largest point cloud, so filtering never allocates.
+    if (voxel_filter_.GetCapacity() <
+        static_cast<uint32_t>(max_point_cloud_elements_)) {
+      voxel_filter_.Reserve(max_point_cloud_elements_);
+    }
+    TANGO_TRACE_SCOPE("VoxelGridFilter::Filter");
+    filtered_cloud_ = voxel_filter_.Filter(front_cloud_);
+  }
 }
 
 }  // namespace tango_plane_fitting
@@ -16,7 +16,11 @@
 
 #include "tango-plane-fitting/point_cloud_renderer.h"
 
+#include <cmath>
+
 #include <tango-gl/conversions.h>
+#include <tango-gl/gl_state.h>
+#include <tango-util/plane_detector.h>
 #include <tango_support_api.h>
 
 #include "tango-plane-fitting/plane_fitting.h"
@@ -25,7 +29,7 @@ namespace tango_plane_fitting {
 
 namespace {
 
-const std::string kPointCloudVertexShader =
+const char kPointCloudVertexShader[] =
     "precision mediump float;\n"
     "attribute vec4 vertex;\n"
     "uniform mat4 mvp;\n"
@@ -46,26 +50,35 @@ const std::string kPointCloudVertexShader =
     "    v_color = vec3(0.0, 0.0, 1.0);\n"
     "  }\n"
     "}\n";
-const std::string kPointCloudFragmentShader =
+const char kPointCloudFragmentShader[] =
     "precision mediump float;\n"
     "varying vec3 v_color;\n"
     "void main() {\n"
     "  gl_FragColor = vec4(v_color, 1.0);\n"
     "}\n";
 
+// Fewer inliers than this are not worth refining the plane model with.
+const uint32_t kMinRefineInlierCount = 100;
+
+// The plane model is only refined with inliers reduced against a plane this
+// close to it, so that the inliers of a plane replaced since are ignored.
+const float kMinRefineNormalCosine = 0.98f;
+
 }  // namespace
 
-PointCloudRenderer::PointCloudRenderer()
+PointCloudRenderer::PointCloudRenderer(int max_point_count)
     : plane_distance_(0.05f),
       debug_colors_(false),
-      plane_model_(glm::vec4(0.0, 0.0, 1.0, 0.0)) {
-  opengl_world_T_start_service_ =
-      tango_gl::conversions::opengl_world_T_tango_world();
+      point_stride_(1),
+      plane_model_(glm::vec4(0.0, 0.0, 1.0, 0.0)),
+      has_plane_model_(false) {
+  opengl_world_T_start_service_ = tango_gl::RigidTransform::FromMatrix(
+      tango_gl::conversions::opengl_world_T_tango_world());
 
   shader_program_ = tango_gl::util::CreateProgram(
-      kPointCloudVertexShader.c_str(), kPointCloudFragmentShader.c_str());
+      kPointCloudVertexShader, kPointCloudFragmentShader);
 
-  glGenBuffers(1, &vertex_buffer_);
+  vertex_buffer_.Reserve(sizeof(GLfloat) * 3 * max_point_count);
 
   mvp_handle_ = glGetUniformLocation(shader_program_, "mvp");
   vertices_handle_ = glGetAttribLocation(shader_program_, "vertex");
@@ -79,27 +92,40 @@ PointCloudRenderer::PointCloudRenderer()
 PointCloudRenderer::~PointCloudRenderer() {}
 
 void PointCloudRenderer::DeleteGLResources() {
-  glDeleteProgram(shader_program_);
-  glDeleteBuffers(0, &vertex_buffer_);
+  tango_gl::GlState::DeleteProgram(shader_program_);
+  vertex_buffer_.DeleteGlResources();
+  inlier_reducer_.DeleteGlResources();
 }
 
-void PointCloudRenderer::Render(const glm::mat4& projection_T_depth,
-                                const glm::mat4& start_service_T_depth,
-                                const TangoXYZij* point_cloud) {
-  if (!debug_colors_) {
+void PointCloudRenderer::Render(
+    const glm::mat4& projection_T_depth,
+    const tango_gl::RigidTransform& start_service_T_depth,
+    const TangoXYZij* point_cloud) {
+  if (!debug_colors_ && !has_plane_model_) {
     return;
   }
 
-  glUseProgram(shader_program_);
-
   const size_t number_of_vertices = point_cloud->xyz_count;
 
-  glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer_);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * 3 * number_of_vertices,
-               point_cloud->xyz[0], GL_STATIC_DRAW);
+  vertex_buffer_.Update(point_cloud->xyz[0],
+                        sizeof(GLfloat) * 3 * number_of_vertices);
+
+  const tango_gl::RigidTransform opengl_T_depth =
+      opengl_world_T_start_service_ * start_service_T_depth;
+  if (has_plane_model_) {
+    RefinePlaneModel();
+    inlier_reducer_.Reduce(vertex_buffer_.GetBuffer(), number_of_vertices,
+                           opengl_T_depth.ToMatrix(), plane_model_,
+                           plane_distance_);
+  }
+  if (!debug_colors_) {
+    tango_gl::GlState::BindBuffer(GL_ARRAY_BUFFER, 0);
+    return;
+  }
+
+  tango_gl::GlState::UseProgram(shader_program_);
 
-  const glm::mat4 depth_T_opengl =
-      glm::inverse(opengl_world_T_start_service_ * start_service_T_depth);
+  const tango_gl::RigidTransform depth_T_opengl = opengl_T_depth.Inverse();
 
   // Transform plane into depth camera coordinates.
   glm::vec4 camera_plane;
@@ -116,15 +142,34 @@ void PointCloudRenderer::Render(const glm::mat4& projection_T_depth,
   glUniform1f(plane_distance_handle_, kDistanceScale * plane_distance_);
 
   glEnableVertexAttribArray(vertices_handle_);
-  glVertexAttribPointer(vertices_handle_, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+  glVertexAttribPointer(vertices_handle_, 3, GL_FLOAT, GL_FALSE,
+                        sizeof(GLfloat) * 3 * point_stride_, nullptr);
 
-  glDrawArrays(GL_POINTS, 0, number_of_vertices);
+  glDrawArrays(GL_POINTS, 0,
+               (number_of_vertices + point_stride_ - 1) / point_stride_);
 
   glDisableVertexAttribArray(vertices_handle_);
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  tango_gl::GlState::BindBuffer(GL_ARRAY_BUFFER, 0);
 
-  glUseProgram(0);
+  tango_gl::GlState::UseProgram(0);
   tango_gl::util::CheckGlError("PointCloudRenderer::Render");
 }
 
+void PointCloudRenderer::RefinePlaneModel() {
+  tango_gl::PlaneInliers inliers;
+  if (!inlier_reducer_.GetLatestInliers(&inliers) ||
+      inliers.count < kMinRefineInlierCount ||
+      glm::dot(glm::vec3(inliers.plane), glm::vec3(plane_model_)) <
+          kMinRefineNormalCosine ||
+      std::fabs(inliers.plane.w - plane_model_.w) > plane_distance_) {
+    return;
+  }
+  // The normal of the least squares plane, facing the same side as before.
+  glm::vec3 normal = tango_util::GetSmallestEigenvector(inliers.covariance);
+  if (glm::dot(normal, glm::vec3(plane_model_)) < 0.0f) {
+    normal = -normal;
+  }
+  plane_model_ = glm::vec4(normal, -glm::dot(normal, inliers.centroid));
+}
+
 }  // namespace tango_plane_fitting
@@ -20,11 +20,14 @@
 #include <vector>
 
 #include <glm/glm.hpp>
+#include <tango-gl/rigid_transform.h>
 #include <tango_support_api.h>
 
 namespace tango_plane_fitting {
 
-void PlaneTransform(const glm::vec4& in_plane, const glm::mat4& out_T_in,
+// Express a plane equation of frame "in" in frame "out".
+void PlaneTransform(const glm::vec4& in_plane,
+                    const tango_gl::RigidTransform& out_T_in,
                     glm::vec4* out_plane);
 
 }  // namespace tango_plane_fitting
@@ -18,11 +18,31 @@
 #define TANGO_PLANE_FITTING_PLANE_FITTING_APPLICATION_H_
 
 #include <jni.h>
+#include <mutex>
+#include <vector>
 
 #include <tango_client_api.h>
+#include <tango-gl/bounding_volume_hierarchy.h>
 #include <tango-gl/cube.h>
+#include <tango-gl/drawable_pool.h>
+#include <tango-gl/mesh.h>
+#include <tango-gl/overlay_target.h>
+#include <tango-gl/rigid_transform.h>
 #include <tango-gl/util.h>
 #include <tango-gl/video_overlay.h>
+#include <tango-util/callback_dispatcher.h>
+#include <tango-util/depth_temporal_filter.h>
+#include <tango-util/extrinsics_cache.h>
+#include <tango-util/hit_tester.h>
+#include <tango-util/intrinsics_registry.h>
+#include <tango-util/normal_estimator.h>
+#include <tango-util/plane_detector.h>
+#include <tango-util/plane_tracker.h>
+#include <tango-util/point_cloud_buffer.h>
+#include <tango-util/pose_history.h>
+#include <tango-util/quality_governor.h>
+#include <tango-util/touch_queue.h>
+#include <tango-util/voxel_grid_filter.h>
 
 #include "tango-plane-fitting/point_cloud_renderer.h"
 
@@ -81,23 +101,50 @@ class PlaneFittingApplication {
   void OnXYZijAvailable(const TangoXYZij* xyz_ij);
 
   //
-  // Callback for touch events to fit a plane and place an object.  The Java
-  // layer should ensure this is only called from the GL thread.
+  // Callback for device poses that come in from the Tango service.
+  //
+  // @param pose The pose returned by the service.
+  //
+  void OnPoseAvailable(const TangoPoseData* pose);
+
+  //
+  // Touch samples batched by the Java layer, handled at the start of the next
+  // Render().
+  //
+  // @param samples sample_count samples of tango_util::TouchQueue::kSampleSize
+  //        floats, of which only the touch downs are used, in screen space of
+  //        the window.
+  void OnTouchEvents(const float* samples, int sample_count);
+
+ private:
+  // Place an object on the detected plane under a tap, if any. Only called
+  // from Render().
   //
   // @param x The requested x coordinate in screen space of the window.
   // @param y The requested y coordinate in screen space of the window.
   void OnTouchEvent(float x, float y);
 
- private:
   // Details of rendering to OpenGL after determining transforms.
-  void GLRender(const glm::mat4& w_T_cc);
+  void GLRender(const tango_gl::RigidTransform& start_service_T_device);
 
   // Update the current point data.
   void UpdateCurrentPointData();
 
+  // Start a frame of hit_tester_ for the color image on screen.
+  //
+  // @return: false if its pose or rays are not known.
+  bool BeginHitTestFrame();
+
+  // Upload the hulls of the planes into plane_mesh_ when the planes changed.
+  void UpdatePlaneMesh();
+
+  // Detect the planes of the latest point cloud and track them, run on the
+  // dispatcher thread.
+  void HandlePointCloud(double timestamp);
+
   // return pose for device position with respect to
   // start of service.
-  glm::mat4 GetStartServiceTDeviceTransform();
+  tango_gl::RigidTransform GetStartServiceTDeviceTransform();
 
   TangoConfig tango_config_;
   TangoCameraIntrinsics color_camera_intrinsics_;
@@ -105,7 +152,30 @@ class PlaneFittingApplication {
   // Render objects
   tango_gl::VideoOverlay* video_overlay_;
   PointCloudRenderer* point_cloud_renderer_;
-  tango_gl::Cube* cube_;
+  // The hulls of the confirmed planes, drawn translucent over the camera
+  // image, from the planes of render_planes_revision_.
+  tango_gl::Mesh* plane_mesh_;
+  uint64_t render_planes_revision_;
+  std::vector<tango_util::TrackedPlane> render_planes_;
+  std::vector<GLfloat> plane_vertices_;
+  // A cube is placed on the plane or the cube under every tap, the oldest
+  // recycled for the new one once kMaxCubeCount are placed. cube_handles_ is
+  // a ring of the cubes placed, next_cube_ the oldest.
+  static const int kMaxCubeCount = 16;
+  tango_gl::DrawablePool<tango_gl::Cube> cubes_;
+  tango_gl::DrawableHandle cube_handles_[kMaxCubeCount];
+
+  // Taps are hit-tested against render_planes_ and hit_test_cubes_, the
+  // cubes placed, in the start of service frame. The frame of hit_tester_ is
+  // the color image of hit_test_timestamp_, negative once the planes or
+  // cubes changed.
+  tango_util::HitTester hit_tester_;
+  tango_gl::BoundingVolumeHierarchy hit_test_cubes_;
+  double hit_test_timestamp_;
+  // The point cloud and cubes, rendered at the resolution of the quality
+  // level over the full resolution camera image.
+  tango_gl::OverlayTarget overlay_target_;
+  int next_cube_;
 
   // The dimensions of the render window.
   float screen_width_;
@@ -115,21 +185,75 @@ class PlaneFittingApplication {
 
   double last_gpu_timestamp_;
 
+  // Device poses with respect to start of service, recorded from the pose
+  // callback.
+  tango_util::PoseHistory pose_history_;
+
   // Cached transforms
-  // Pose of color camera with respect to device.
-  glm::mat4 device_T_color_;
-  // Pose of depth camera with respect to device.
-  glm::mat4 device_T_depth_;
-  // Start of service with respect to OpenGL world.
-  glm::mat4 opengl_world_T_start_service_;
-  // OpenGL camera with respect to color camera.
-  glm::mat4 color_camera_T_opengl_camera_;
+  // Extrinsics of the cameras and OpenGL frames.
+  tango_util::ExtrinsicsCache extrinsics_;
+  // Camera intrinsics and the projections derived from them.
+  tango_util::IntrinsicsRegistry intrinsics_;
+  // The extrinsics used on every frame, as rigid transforms so that they are
+  // inverted and composed without 4x4 inverses.
+  tango_gl::RigidTransform device_T_depth_camera_;
+  tango_gl::RigidTransform device_T_color_camera_;
+  tango_gl::RigidTransform color_opengl_camera_T_device_;
+  tango_gl::RigidTransform opengl_world_T_start_service_;
   // OpenGL projection matrix.
   glm::mat4 projection_matrix_ar_;
 
-  // Point data manager.
-  TangoSupportPointCloudManager* point_cloud_manager_;
-  TangoXYZij* front_cloud_;
+  // The latest point cloud of the callback, which the GL thread and the plane
+  // detection each hold one of through their reader.
+  tango_util::PointCloudBuffer point_cloud_buffer_;
+  // Maximum number of points in a point cloud frame.
+  int32_t max_point_cloud_elements_;
+
+  // Thins out, then stops drawing, the debug point cloud and lowers the
+  // resolution of the overlay to keep within the frame time budget and the
+  // device cool.
+  tango_util::QualityGovernor quality_governor_;
+  // The point cloud the GL thread holds, from one frame to the next, nullptr
+  // until the first one arrives.
+  tango_util::PointCloudBuffer::Reader render_cloud_reader_;
+  const TangoXYZij* front_cloud_;
+
+  // Downsamples front_cloud_ into filtered_cloud_, which is rendered on the
+  // GL thread.
+  tango_util::VoxelGridFilter voxel_filter_;
+  const TangoXYZij* filtered_cloud_;
+
+  // The planes are detected off the GL thread, from the point clouds of their
+  // own reader. The detection state is only used on the dispatcher thread.
+  tango_util::PointCloudBuffer::Reader detection_cloud_reader_;
+  // Smooths the depth of the point clouds over the frames before anything
+  // else, so that the planes have fewer outliers.
+  tango_util::DepthTemporalFilter depth_filter_;
+  // Normals of the full point cloud, filtered along with it, so that the
+  // inliers of a plane also face its way.
+  tango_util::NormalEstimator normal_estimator_;
+  tango_util::VoxelGridFilter detection_filter_;
+  tango_util::PlaneDetector plane_detector_;
+  tango_util::PlaneTracker plane_tracker_;
+  std::vector<tango_util::DetectedPlane> detected_planes_;
+
+  // Confirmed planes in the start of service frame, copied from
+  // plane_tracker_ after every point cloud, and the number of copies.
+  // Protected by planes_mutex_.
+  std::vector<tango_util::TrackedPlane> planes_;
+  uint64_t planes_revision_;
+  std::mutex planes_mutex_;
+
+  // Touch samples of OnTouchEvents(), and those taken by the frame.
+  tango_util::TouchQueue touch_queue_;
+  std::vector<tango_util::TouchSample> touch_samples_;
+
+  // Only the latest point cloud is worth detecting planes in.
+  tango_util::DispatchQueue<double> point_cloud_queue_;
+
+  // Declared last so that its thread is stopped before the rest of the app is
+  // destroyed.
+  tango_util::CallbackDispatcher dispatcher_;
 };
 
 }  // namespace tango_plane_fitting
@@ -22,6 +22,9 @@
 #include <vector>
 
 #include <tango_client_api.h>
+#include <tango-gl/plane_inlier_reducer.h>
+#include <tango-gl/rigid_transform.h>
+#include <tango-gl/streaming_vertex_buffer.h>
 #include <tango-gl/util.h>
 #include <tango_support_api.h>
 
@@ -30,11 +33,13 @@ namespace tango_plane_fitting {
 // PointCloudRenderer contains the OpenGL logic to render depth data.
 class PointCloudRenderer {
  public:
-  PointCloudRenderer();
+  // @param max_point_count: the maximum number of points in a point cloud
+  // frame, used to allocate the vertex buffer once.
+  explicit PointCloudRenderer(int max_point_count);
   ~PointCloudRenderer();
 
   // Render the point cloud colored by its location relative to the
-  // world plane model.
+  // world plane model, and refine the plane model with its inliers.
   //
   // @param projection_T_depth The pose of the openGL projection with
   // respect to the depth camera position.
@@ -42,21 +47,32 @@ class PointCloudRenderer {
   // respect to depth camera position.
   // @param point_cloud Depth data gathered by a PointCloudManager.
   void Render(const glm::mat4& projection_T_depth,
-              const glm::mat4& start_service_T_depth,
+              const tango_gl::RigidTransform& start_service_T_depth,
               const TangoXYZij* point_cloud);
 
   // Render depth points with debugging colors.
   void SetRenderDebugColors(bool on) { debug_colors_ = on; }
 
-  // A plane equation in world coordinates for debug rendering.
-  void SetPlaneEquation(const glm::vec4& plane) { plane_model_ = plane; }
+  // Only draw one point out of |point_stride|. Defaults to 1.
+  void SetPointStride(int point_stride) {
+    point_stride_ = point_stride > 1 ? point_stride : 1;
+  }
+
+  // A plane equation in world coordinates for debug rendering. It is then
+  // refined on every Render() with its inliers, when the GPU supports it.
+  void SetPlaneEquation(const glm::vec4& plane) {
+    plane_model_ = plane;
+    has_plane_model_ = true;
+  }
+
+  const glm::vec4& GetPlaneEquation() const { return plane_model_; }
 
   // A call to manually free the OpenGL resources
   void DeleteGLResources();
 
  private:
   GLuint shader_program_;
-  GLuint vertex_buffer_;
+  tango_gl::StreamingVertexBuffer vertex_buffer_;
   GLuint mvp_handle_;
   GLuint vertices_handle_;
   GLuint plane_handle_;
@@ -68,12 +84,21 @@ class PointCloudRenderer {
   // Controls coloring of point data.
   GLboolean debug_colors_;
 
+  int point_stride_;
+
+  // Refine plane_model_ with the latest inliers reduced on the GPU.
+  void RefinePlaneModel();
+
   // The updated plane model after every plane fit.
   glm::vec4 plane_model_;
+  bool has_plane_model_;
+
+  // Reduces the inliers of plane_model_ in the points of vertex_buffer_.
+  tango_gl::PlaneInlierReducer inlier_reducer_;
 
   // Cached transform from opengl world to tango world.
   // This is initialized and never updated.
-  glm::mat4 opengl_world_T_start_service_;
+  tango_gl::RigidTransform opengl_world_T_start_service_;
 };
 
 }  // namespace tango_plane_fitting
@@ -32,7 +32,10 @@ import android.view.View.OnClickListener;
 import android.widget.TextView;
 import android.widget.Toast;
 
+import java.io.File;
+
 import com.projecttango.examples.cpp.util.TangoInitializationHelper;
+import com.projecttango.examples.cpp.util.TelemetryBuffer;
 
 /**
  * The main activity of the application. This activity shows debug information
@@ -53,10 +56,25 @@ public class PointcloudActivity extends Activity implements OnClickListener {
   // service for pose and event information.
   private static final int UPDATE_UI_INTERVAL_MS = 100;
 
+  // Offsets of the fields of the native Telemetry struct, see
+  // tango-point-cloud/telemetry.h.
+  private static final int POINT_COUNT_OFFSET = 0;
+  private static final int AVERAGE_DEPTH_OFFSET = 4;
+  private static final int SEGMENT_COUNT_OFFSET = 44;
+
   // Total points count in the current depth frame.
   private TextView mPointCount;
   // Average depth value (in meteres) of all the points in the current frame.
   private TextView mAverageZ;
+  // Objects the current frame is segmented into.
+  private TextView mSegmentCount;
+
+  // The debug information shared by the native code, and the text formatted
+  // from it, reused across updates.
+  private TelemetryBuffer mTelemetry;
+  private StringBuilder mAverageZText = new StringBuilder();
+  private int mShownPointCount = -1;
+  private int mShownSegmentCount = -1;
 
   // GLSurfaceView and renderer, all of the graphic content is rendered
   // through OpenGL ES 2.0 in native code.
@@ -126,6 +144,14 @@ public class PointcloudActivity extends Activity implements OnClickListener {
     // Text view for average depth distance (in meters).
     mAverageZ = (TextView) findViewById(R.id.average_depth);
 
+    // Text view for the objects in the current frame.
+    mSegmentCount = (TextView) findViewById(R.id.segment_count);
+    mTelemetry = new TelemetryBuffer(TangoJNINative.getTelemetryBuffer());
+
+    // The parts of the map away from the camera are paged out to the cache.
+    TangoJNINative.setMapTileFile(
+        new File(getCacheDir(), "map_tiles.bin").getPath());
+
     // Buttons for selecting camera view and Set up button click listeners.
     findViewById(R.id.first_person_button).setOnClickListener(this);
     findViewById(R.id.third_person_button).setOnClickListener(this);
@@ -235,11 +261,31 @@ public class PointcloudActivity extends Activity implements OnClickListener {
       }
     };
 
-  // Update the debug text UI.
+  // Update the debug text UI from the telemetry.
   private void updateUi() {
     try {
-      mPointCount.setText(String.valueOf(TangoJNINative.getVerticesCount()));
-      mAverageZ.setText(String.format("%.3f", TangoJNINative.getAverageZ()));
+      int sequence;
+      int pointCount;
+      float averageZ;
+      int segmentCount;
+      do {
+        sequence = mTelemetry.beginRead();
+        pointCount = mTelemetry.getInt(POINT_COUNT_OFFSET);
+        averageZ = mTelemetry.getFloat(AVERAGE_DEPTH_OFFSET);
+        segmentCount = mTelemetry.getInt(SEGMENT_COUNT_OFFSET);
+      } while (!mTelemetry.endRead(sequence));
+
+      if (pointCount != mShownPointCount) {
+        mShownPointCount = pointCount;
+        mPointCount.setText(String.valueOf(pointCount));
+      }
+      if (segmentCount != mShownSegmentCount) {
+        mShownSegmentCount = segmentCount;
+        mSegmentCount.setText(String.valueOf(segmentCount));
+      }
+      mAverageZText.setLength(0);
+      TelemetryBuffer.appendFixed3(mAverageZText, averageZ);
+      mAverageZ.setText(mAverageZText);
     } catch (Exception e) {
       e.printStackTrace();
       Log.e(TAG, "Exception updateing UI elements");
@@ -21,6 +21,8 @@ import android.util.Log;
 
 import com.projecttango.examples.cpp.util.TangoInitializationHelper;
 
+import java.nio.ByteBuffer;
+
 /**
  * Interfaces between C and Java.
  */
@@ -77,16 +79,104 @@ public class TangoJNINative {
   //   first person, third person, or top down.
   public static native void setCamera(int cameraIndex);
 
-  // Get total point count in current depth frame.
-  public static native int getVerticesCount();
+  // Show the GPU time of the mesh and point cloud passes over the frame.
+  public static native void setGpuProfilerHudVisible(boolean visible);
+
+  // Color the point cloud by the color camera image instead of by depth.
+  public static native void setColorizedPointCloud(boolean colorize);
+
+  // Shade the point cloud by eye-dome lighting, at a lower point budget.
+  public static native void setEyeDomeLighting(boolean enabled);
+
+  // Accumulate the point clouds into a map and render it instead of the latest
+  // point cloud.
+  public static native void setAccumulationMode(boolean accumulate);
+
+  // Page the map away from the camera out to a scratch file at |path|.
+  public static native void setMapTileFile(String path);
+
+  // Write the map, or else the latest point cloud, as a PLY file at |path| on
+  // a background thread.
+  public static native void exportPointCloud(String path);
+
+  // Stream the poses and point clouds over UDP to a viewer at |host|:|port|.
+  // Resolves |host|, so must not be called on the UI thread.
+  //
+  // @return false if the host could not be resolved.
+  public static native boolean startStreaming(String host, int port);
+
+  // Stop the stream of startStreaming().
+  public static native void stopStreaming();
+
+  // Publish the poses and point clouds into shared memory for a service of
+  // another process, which maps it with the SharedSensorReader of
+  // tango_util. The fd stays owned by the app: pass a dup of it, e.g. from
+  // ParcelFileDescriptor.fromFd(), to the service once.
+  //
+  // @return the fd of the shared memory, -1 on failure.
+  public static native int startSharedSensorPublishing();
+
+  // Stop the publishing of startSharedSensorPublishing().
+  public static native void stopSharedSensorPublishing();
+
+  // Load a Wavefront OBJ model to align to the map. Parses the file, so must
+  // not be called on the UI thread.
+  public static native boolean loadAlignmentModel(String path);
+
+  // Align the model from pairs of points, xyz triplets of the model and of the
+  // start of service frame, e.g. tapped. At least three pairs are needed.
+  public static native boolean setModelCorrespondences(float[] modelPoints,
+                                                       float[] worldPoints);
 
-  // Get average depth (in meters) in current depth frame.
-  public static native float getAverageZ();
+  // Refine the alignment of the model by ICP against the accumulated map.
+  public static native void alignModelToMap();
+
+  // Fill |worldTModel| with the column major alignment of the model.
+  //
+  // @return false if the model is not aligned yet.
+  public static native boolean getModelAlignment(float[] worldTModel);
+
+  // Get the buffer the application keeps the point count, average depth and
+  // delta time of the current depth frame in, for display in our debug UI.
+  // See TelemetryBuffer, and tango-point-cloud/telemetry.h for its layout.
+  public static native ByteBuffer getTelemetryBuffer();
+
+  // Raise the priority of the render and callback threads and keep them on
+  // the big cores, with the export and streaming threads on the little ones.
+  // The cores they run on are part of the telemetry.
+  public static native void setThreadPolicyEnabled(boolean isEnabled);
+
+  // Get the latest point cloud, to read in place without a copy. The buffer
+  // holds x, y, z floats in the native order, of which only the first
+  // getAcquiredPointCount() points are set, and stays valid until the next
+  // acquirePointCloud() or releasePointCloud(): it must not be read after.
+  // The same buffers are returned over and over, so use absolute gets, or
+  // duplicate() them. Call from one thread at a time.
+  //
+  // @return null until the first point cloud after the first call.
+  public static native ByteBuffer acquirePointCloud();
 
-  // Get depth frame delta time between current frame and previous frame.
-  public static native float getFrameDeltaTime();
+  // Let the native code reuse the point cloud acquired.
+  public static native void releasePointCloud();
+
+  // Get the point count and timestamp of the point cloud acquired, 0 if none.
+  public static native int getAcquiredPointCount();
+  public static native double getAcquiredPointCloudTimestamp();
 
   // Pass touch events to the native layer.
   public static native void onTouchEvent(int touchCount, int event0,
                                          float x0, float y0, float x1, float y1);
+
+  // Start recording where the native code spends its time, see
+  // tango-gl/tracing.h.
+  public static native void startTracing();
+
+  // Stop recording, the recorded time slices are kept for dumpTrace().
+  public static native void stopTracing();
+
+  // Write the recorded time slices as a Chrome trace JSON file, e.g. under
+  // getExternalFilesDir(null) to pull it from the sdcard.
+  //
+  // @return false if the file could not be written.
+  public static native boolean dumpTrace(String path);
 }
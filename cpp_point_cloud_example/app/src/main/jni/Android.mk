@@ -20,34 +20,24 @@ PROJECT_ROOT:= $(call my-dir)/../../../../..
 include $(CLEAR_VARS)
 LOCAL_MODULE    := libcpp_point_cloud_example
 LOCAL_SHARED_LIBRARIES := tango_client_api tango_support_api
+LOCAL_STATIC_LIBRARIES := tango_util tango_gl
 LOCAL_CFLAGS    := -std=c++11
 
-LOCAL_C_INCLUDES := $(PROJECT_ROOT)/tango-service-sdk/include/ \
-                    $(PROJECT_ROOT)/tango_gl/include \
-                    $(PROJECT_ROOT)/third_party/glm/
+LOCAL_C_INCLUDES := $(PROJECT_ROOT)/tango-service-sdk/include/
 
 LOCAL_SRC_FILES := jni_interface.cc \
                    point_cloud_data.cc \
                    point_cloud_drawable.cc \
+                   point_cloud_map_drawable.cc \
                    point_cloud_app.cc \
                    pose_data.cc \
-                   scene.cc \
-                   $(PROJECT_ROOT_FROM_JNI)/tango_gl/axis.cc \
-                   $(PROJECT_ROOT_FROM_JNI)/tango_gl/camera.cc \
-                   $(PROJECT_ROOT_FROM_JNI)/tango_gl/conversions.cc \
-                   $(PROJECT_ROOT_FROM_JNI)/tango_gl/drawable_object.cc \
-                   $(PROJECT_ROOT_FROM_JNI)/tango_gl/frustum.cc \
-                   $(PROJECT_ROOT_FROM_JNI)/tango_gl/gesture_camera.cc \
-                   $(PROJECT_ROOT_FROM_JNI)/tango_gl/grid.cc \
-                   $(PROJECT_ROOT_FROM_JNI)/tango_gl/line.cc \
-                   $(PROJECT_ROOT_FROM_JNI)/tango_gl/shaders.cc \
-                   $(PROJECT_ROOT_FROM_JNI)/tango_gl/trace.cc \
-                   $(PROJECT_ROOT_FROM_JNI)/tango_gl/transform.cc \
-                   $(PROJECT_ROOT_FROM_JNI)/tango_gl/util.cc
+                   scene.cc
 
-LOCAL_LDLIBS    := -llog -lGLESv2 -L$(SYSROOT)/usr/lib
+LOCAL_LDLIBS    := -llog -lGLESv2 -lEGL -L$(SYSROOT)/usr/lib
 include $(BUILD_SHARED_LIBRARY)
 
 $(call import-add-path, $(PROJECT_ROOT))
 $(call import-module,tango_client_api)
 $(call import-module,tango_support_api)
+$(call import-module,tango_gl)
+$(call import-module,tango_util)
@@ -17,6 +17,9 @@
 #define GLM_FORCE_RADIANS
 
 #include <jni.h>
+#include <tango-gl/tracing.h>
+#include <tango-gl/util.h>
+#include <tango-util/thread_policy.h>
 #include <tango-point-cloud/point_cloud_app.h>
 #include <tango-point-cloud/scene.h>
 
@@ -77,6 +80,7 @@ JNIEXPORT void JNICALL
 Java_com_projecttango_examples_cpp_pointcloud_TangoJNINative_render(JNIEnv*,
                                                                     jobject) {
   app.Render();
+  tango_gl::util::CheckGlErrorsOfFrame();
 }
 
 JNIEXPORT void JNICALL
@@ -85,16 +89,34 @@ Java_com_projecttango_examples_cpp_pointcloud_TangoJNINative_deleteResources(
   app.DeleteResources();
 }
 
+JNIEXPORT jobject JNICALL
+Java_com_projecttango_examples_cpp_pointcloud_TangoJNINative_getTelemetryBuffer(
+    JNIEnv* env, jobject) {
+  return app.NewTelemetryBuffer(env);
+}
+
+JNIEXPORT jobject JNICALL
+Java_com_projecttango_examples_cpp_pointcloud_TangoJNINative_acquirePointCloud(
+    JNIEnv* env, jobject) {
+  return app.AcquireJavaPointCloud(env);
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_pointcloud_TangoJNINative_releasePointCloud(
+    JNIEnv*, jobject) {
+  app.ReleaseJavaPointCloud();
+}
+
 JNIEXPORT jint JNICALL
-Java_com_projecttango_examples_cpp_pointcloud_TangoJNINative_getVerticesCount(
+Java_com_projecttango_examples_cpp_pointcloud_TangoJNINative_getAcquiredPointCount(
     JNIEnv*, jobject) {
-  return app.GetPointCloudVerticesCount();
+  return app.GetJavaPointCount();
 }
 
-JNIEXPORT jfloat JNICALL
-Java_com_projecttango_examples_cpp_pointcloud_TangoJNINative_getAverageZ(
+JNIEXPORT jdouble JNICALL
+Java_com_projecttango_examples_cpp_pointcloud_TangoJNINative_getAcquiredPointCloudTimestamp(
     JNIEnv*, jobject) {
-  return app.GetAverageZ();
+  return app.GetJavaPointCloudTimestamp();
 }
 
 JNIEXPORT void JNICALL
@@ -105,6 +127,115 @@ Java_com_projecttango_examples_cpp_pointcloud_TangoJNINative_setCamera(
   app.SetCameraType(cam_type);
 }
 
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_pointcloud_TangoJNINative_setGpuProfilerHudVisible(
+    JNIEnv*, jobject, jboolean visible) {
+  app.SetGpuProfilerHudVisible(visible);
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_pointcloud_TangoJNINative_setColorizedPointCloud(
+    JNIEnv*, jobject, jboolean colorize) {
+  app.SetColorizedPointCloud(colorize);
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_pointcloud_TangoJNINative_setEyeDomeLighting(
+    JNIEnv*, jobject, jboolean enabled) {
+  app.SetEyeDomeLighting(enabled);
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_pointcloud_TangoJNINative_setAccumulationMode(
+    JNIEnv*, jobject, jboolean accumulate) {
+  app.SetAccumulationMode(accumulate);
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_pointcloud_TangoJNINative_setMapTileFile(
+    JNIEnv* env, jobject, jstring path) {
+  const char* path_chars = env->GetStringUTFChars(path, nullptr);
+  app.SetMapTileFile(path_chars);
+  env->ReleaseStringUTFChars(path, path_chars);
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_pointcloud_TangoJNINative_exportPointCloud(
+    JNIEnv* env, jobject, jstring path) {
+  const char* path_chars = env->GetStringUTFChars(path, nullptr);
+  app.ExportPointCloud(path_chars);
+  env->ReleaseStringUTFChars(path, path_chars);
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_projecttango_examples_cpp_pointcloud_TangoJNINative_startStreaming(
+    JNIEnv* env, jobject, jstring host, jint port) {
+  const char* host_chars = env->GetStringUTFChars(host, nullptr);
+  const bool started = app.StartStreaming(host_chars, port);
+  env->ReleaseStringUTFChars(host, host_chars);
+  return started;
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_pointcloud_TangoJNINative_stopStreaming(
+    JNIEnv*, jobject) {
+  app.StopStreaming();
+}
+
+JNIEXPORT jint JNICALL
+Java_com_projecttango_examples_cpp_pointcloud_TangoJNINative_startSharedSensorPublishing(
+    JNIEnv*, jobject) {
+  return app.StartSharedSensorPublishing();
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_pointcloud_TangoJNINative_stopSharedSensorPublishing(
+    JNIEnv*, jobject) {
+  app.StopSharedSensorPublishing();
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_projecttango_examples_cpp_pointcloud_TangoJNINative_loadAlignmentModel(
+    JNIEnv* env, jobject, jstring path) {
+  const char* path_chars = env->GetStringUTFChars(path, nullptr);
+  const bool loaded = app.LoadAlignmentModel(path_chars);
+  env->ReleaseStringUTFChars(path, path_chars);
+  return loaded;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_projecttango_examples_cpp_pointcloud_TangoJNINative_setModelCorrespondences(
+    JNIEnv* env, jobject, jfloatArray model_points, jfloatArray world_points) {
+  const jsize length = env->GetArrayLength(model_points);
+  if (length != env->GetArrayLength(world_points) || length % 3 != 0) {
+    return false;
+  }
+  jfloat* model = env->GetFloatArrayElements(model_points, nullptr);
+  jfloat* world = env->GetFloatArrayElements(world_points, nullptr);
+  const bool is_set = app.SetModelCorrespondences(model, world, length / 3);
+  env->ReleaseFloatArrayElements(world_points, world, JNI_ABORT);
+  env->ReleaseFloatArrayElements(model_points, model, JNI_ABORT);
+  return is_set;
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_pointcloud_TangoJNINative_alignModelToMap(
+    JNIEnv*, jobject) {
+  app.AlignModelToMap();
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_projecttango_examples_cpp_pointcloud_TangoJNINative_getModelAlignment(
+    JNIEnv* env, jobject, jfloatArray world_T_model) {
+  float matrix[16];
+  if (env->GetArrayLength(world_T_model) != 16 ||
+      !app.GetModelAlignment(matrix)) {
+    return false;
+  }
+  env->SetFloatArrayRegion(world_T_model, 0, 16, matrix);
+  return true;
+}
+
 JNIEXPORT void JNICALL
 Java_com_projecttango_examples_cpp_pointcloud_TangoJNINative_onTouchEvent(
     JNIEnv*, jobject, int touch_count, int event, float x0, float y0, float x1,
@@ -113,6 +244,34 @@ Java_com_projecttango_examples_cpp_pointcloud_TangoJNINative_onTouchEvent(
       static_cast<tango_gl::GestureCamera::TouchEvent>(event);
   app.OnTouchEvent(touch_count, touch_event, x0, y0, x1, y1);
 }
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_pointcloud_TangoJNINative_startTracing(
+    JNIEnv*, jobject) {
+  tango_gl::tracing::Start();
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_pointcloud_TangoJNINative_stopTracing(
+    JNIEnv*, jobject) {
+  tango_gl::tracing::Stop();
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_projecttango_examples_cpp_pointcloud_TangoJNINative_dumpTrace(
+    JNIEnv* env, jobject, jstring path) {
+  const char* path_chars = env->GetStringUTFChars(path, nullptr);
+  const bool dumped = tango_gl::tracing::DumpChromeTrace(path_chars);
+  env->ReleaseStringUTFChars(path, path_chars);
+  return dumped;
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_pointcloud_TangoJNINative_setThreadPolicyEnabled(
+    JNIEnv*, jobject, jboolean is_enabled) {
+  tango_util::ThreadPolicy::Get().SetEnabled(is_enabled);
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -14,14 +14,49 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
 #include <tango-gl/conversions.h>
+#include <tango-gl/point_cloud_statistics.h>
+#include <tango-gl/tracing.h>
 #include <tango_support_api.h>
+#include <tango-util/pose_source.h>
 
 #include "tango-point-cloud/point_cloud_app.h"
 
 namespace {
 const int kVersionStringLength = 128;
 
+// Capacity of the callback queues. The point cloud arrives at about 5Hz and the
+// pose at about 100Hz, so both hold a few hundred milliseconds of data.
+const size_t kPointCloudQueueCapacity = 4;
+
+// Map points the model is aligned to, as many as ICP handles within its time
+// budget of a second.
+const size_t kMaxAlignmentPointCount = 20000;
+const size_t kPoseQueueCapacity = 32;
+
+// Edge length in meters of the voxels the point cloud is downsampled to
+// before rendering.
+const float kVoxelLeafSize = 0.02f;
+
+// Readers of the point clouds handed to Java, see AcquireJavaPointCloud().
+const int kJavaPointCloudReaderCount = 1;
+
+// Work budget of a frame on the render thread, in milliseconds.
+const double kFrameBudget = 12.0;
+
+// Work budgets of a point cloud on the depth pipeline, and of the handlers
+// run on a wake-up of the dispatcher, in milliseconds.
+const double kDepthFrameBudget = 20.0;
+const double kCallbackBudget = 4.0;
+
+// Fraction of the point budget drawn with eye-dome lighting, whose outlines
+// keep a sparser cloud as readable.
+const float kEyeDomeLightingPointBudgetScale = 0.5f;
+
 // This function routes onXYZijAvailable callbacks to the application object for
 // handling.
 //
@@ -49,16 +84,179 @@ void onPoseAvailableRouter(void* context, const TangoPoseData* pose) {
 
 namespace tango_point_cloud {
 void PointCloudApp::onPointCloudAvailable(const TangoXYZij* xyz_ij) {
-  std::lock_guard<std::mutex> lock(point_cloud_mutex_);
-  point_cloud_data_.UpdatePointCloud(xyz_ij);
+  TANGO_TRACE_SCOPE("PointCloudApp::onPointCloudAvailable");
+  // The points are only valid during the callback, so they are copied into
+  // a frame of the pipeline. The frame is dropped when all of them are busy.
+  DepthFrame* frame = depth_pipeline_.BeginFrame();
+  if (frame != nullptr) {
+    frame->xyz.assign(xyz_ij->xyz[0], xyz_ij->xyz[0] + 3 * xyz_ij->xyz_count);
+    frame->point_cloud = *xyz_ij;
+    frame->point_cloud.xyz = reinterpret_cast<float(*)[3]>(frame->xyz.data());
+    frame->point_cloud.ij_rows = 0;
+    frame->point_cloud.ij_cols = 0;
+    frame->point_cloud.ij = nullptr;
+    frame->point_cloud.color_image = nullptr;
+    depth_pipeline_.Submit(frame);
+  }
+  streamer_.OnXYZijAvailable(xyz_ij);
+  sensor_publisher_.OnXYZijAvailable(xyz_ij);
+  // Only copied for Java once it asked for a cloud.
+  if (is_java_point_cloud_requested_.load(std::memory_order_relaxed)) {
+    java_point_clouds_.Update(xyz_ij);
+  }
+  PointCloudInfo info;
+  info.timestamp = xyz_ij->timestamp;
+  info.xyz_count = xyz_ij->xyz_count;
+  point_cloud_queue_.Post(info);
 }
 
 void PointCloudApp::onPoseAvailable(const TangoPoseData* pose) {
-  std::lock_guard<std::mutex> lock(pose_mutex_);
-  pose_data_.UpdatePose(pose);
+  TANGO_TRACE_SCOPE("PointCloudApp::onPoseAvailable");
+  streamer_.OnPoseAvailable(pose);
+  sensor_publisher_.OnPoseAvailable(pose);
+  pose_queue_.Post(*pose);
+}
+
+void PointCloudApp::HandlePointCloud(const PointCloudInfo& info) {
+  TANGO_TRACE_SCOPE("PointCloudApp::HandlePointCloud");
+  std::lock_guard<tango_gl::ProfiledMutex> lock(point_cloud_mutex_);
+  point_cloud_data_.UpdatePointCloud(info.timestamp, info.xyz_count);
+  const tango_util::NetworkStreamer::Stats stream_stats =
+      streamer_.GetStats();
+  telemetry_.Write([this, &stream_stats](Telemetry* telemetry) {
+    point_cloud_data_.WriteTelemetry(telemetry);
+    telemetry->stream_bandwidth = stream_stats.bytes_per_second / 1024.0f;
+    telemetry->stream_latency = stream_stats.average_latency * 1000.0f;
+    telemetry->stream_dropped_count = static_cast<int32_t>(
+        stream_stats.dropped_count + stream_stats.dropped_datagram_count);
+    WriteThreadTelemetry(telemetry);
+  });
 }
 
-PointCloudApp::PointCloudApp() {}
+void PointCloudApp::WriteThreadTelemetry(Telemetry* telemetry) {
+  const tango_util::ThreadPolicy& thread_policy =
+      tango_util::ThreadPolicy::Get();
+  for (int i = 0; i < tango_util::ThreadPolicy::kStageCount; ++i) {
+    telemetry->stage_cpus[i] =
+        thread_policy
+            .GetStageStats(static_cast<tango_util::ThreadPolicy::Stage>(i))
+            .last_cpu;
+  }
+  const tango_util::ThreadPolicy::StageStats render_stats =
+      thread_policy.GetStageStats(tango_util::ThreadPolicy::kRenderStage);
+  telemetry->render_big_core_ratio =
+      render_stats.entry_count > 0
+          ? static_cast<float>(render_stats.big_core_entry_count) /
+                render_stats.entry_count
+          : 0.0f;
+}
+
+void PointCloudApp::FilterDepthFrame(DepthFrame* frame) {
+  const TangoXYZij* point_cloud = &frame->point_cloud;
+  // Sized once for the largest point cloud.
+  if (voxel_filter_.GetCapacity() < point_cloud->xyz_count) {
+    int max_point_cloud_elements;
+    {
+      std::lock_guard<tango_gl::ProfiledMutex> lock(point_cloud_mutex_);
+      max_point_cloud_elements = max_point_cloud_elements_;
+    }
+    voxel_filter_.Reserve(
+        std::max(point_cloud->xyz_count,
+                 static_cast<uint32_t>(max_point_cloud_elements)));
+  }
+  const TangoXYZij* filtered = voxel_filter_.Filter(point_cloud);
+  frame->filtered_xyz.assign(filtered->xyz[0],
+                             filtered->xyz[0] + 3 * filtered->xyz_count);
+  frame->filtered_point_cloud = *point_cloud;
+  frame->filtered_point_cloud.xyz_count = filtered->xyz_count;
+  frame->filtered_point_cloud.xyz =
+      reinterpret_cast<float(*)[3]>(frame->filtered_xyz.data());
+}
+
+int32_t PointCloudApp::CountSegments(const TangoXYZij& point_cloud) {
+  {
+    std::lock_guard<tango_gl::ProfiledMutex> lock(point_cloud_mutex_);
+    if (has_depth_camera_intrinsics_) {
+      depth_segmenter_.SetIntrinsics(depth_camera_intrinsics_);
+    }
+  }
+  return static_cast<int32_t>(depth_segmenter_.Split(&point_cloud).size());
+}
+
+void PointCloudApp::HandlePose(const TangoPoseData& pose) {
+  TANGO_TRACE_SCOPE("PointCloudApp::HandlePose");
+  pose_data_.UpdatePose(&pose);
+  // The trace samples every pose, not only those of the frames drawn.
+  if (pose.status_code == TANGO_POSE_VALID) {
+    const glm::mat4 opengl_world_T_depth_opengl_camera =
+        extrinsics_.GetOpenGlWorldTDepthOpenGlCamera(
+            pose_data_.GetMatrixFromPose(pose));
+    main_scene_.AppendTracePosition(
+        glm::vec3(opengl_world_T_depth_opengl_camera[3]));
+  }
+}
+
+PointCloudApp::PointCloudApp()
+    : max_point_cloud_elements_(0),
+      has_depth_camera_intrinsics_(false),
+      is_java_point_cloud_requested_(false),
+      java_point_cloud_reader_(&java_point_clouds_),
+      java_point_cloud_(nullptr),
+      depth_segmenter_(tango_util::DepthSegmenter::Options()),
+      render_hint_session_("render"),
+      depth_hint_session_("depth pipeline"),
+      callback_hint_session_("callback"),
+      is_accumulating_(false),
+      aligner_(tango_util::ModelAligner::Options()),
+      has_initial_alignment_(false),
+      is_alignment_requested_(false),
+      quality_governor_(tango_util::QualityGovernor::DefaultLevels(),
+                        kFrameBudget),
+      connection_id_(0),
+      is_colorized_(false),
+      is_eye_dome_lighting_(false),
+      color_texture_id_(0),
+      color_texture_connection_id_(0),
+      is_color_texture_connected_(false),
+      has_color_intrinsics_(false),
+      point_cloud_queue_("point cloud", kPointCloudQueueCapacity,
+                         tango_util::DispatchQueueBase::kDropOldest,
+                         [this](const PointCloudInfo& info) {
+                           HandlePointCloud(info);
+                         }),
+      pose_queue_("pose", kPoseQueueCapacity,
+                  tango_util::DispatchQueueBase::kDropOldest,
+                  [this](const TangoPoseData& pose) { HandlePose(pose); }) {
+  dispatcher_.AddQueue(&point_cloud_queue_);
+  dispatcher_.AddQueue(&pose_queue_);
+  dispatcher_.SetPerformanceHintSession(&callback_hint_session_,
+                                        kCallbackBudget);
+  quality_governor_.SetPerformanceHintSession(&render_hint_session_);
+  depth_pipeline_.SetPerformanceHintSession(&depth_hint_session_,
+                                            kDepthFrameBudget);
+  voxel_filter_.SetLeafSize(kVoxelLeafSize);
+
+  // The statistics are those of the raw points, not of the downsampled ones
+  // the point cloud drawable gets its statistics from.
+  depth_pipeline_.AddStage(
+      "statistics", &DepthFrame::point_cloud, &DepthFrame::average_depth,
+      [](const TangoXYZij& point_cloud, float* average_depth) {
+        tango_gl::PointCloudStatistics statistics;
+        tango_gl::GetPointCloudStatistics(
+            point_cloud.xyz[0], point_cloud.xyz_count, &statistics);
+        *average_depth = statistics.mean.z;
+      });
+  const size_t filter = depth_pipeline_.AddStage(
+      "filter", [this](DepthFrame* frame) { FilterDepthFrame(frame); });
+  depth_pipeline_.Reads(filter, &DepthFrame::point_cloud);
+  depth_pipeline_.Writes(filter, &DepthFrame::filtered_point_cloud);
+  depth_pipeline_.AddStage(
+      "segmentation", &DepthFrame::point_cloud, &DepthFrame::segment_count,
+      [this](const TangoXYZij& point_cloud, int32_t* segment_count) {
+        *segment_count = CountSegments(point_cloud);
+      });
+  depth_pipeline_.Start();
+}
 
 PointCloudApp::~PointCloudApp() {
   if (tango_config_ != nullptr) {
@@ -118,10 +316,47 @@ int PointCloudApp::TangoSetupConfig() {
     return ret;
   }
 
+  // Enable the color camera, whose image the point cloud can be colorized
+  // with. It is only streamed to a texture while the point cloud is.
+  ret = TangoConfig_setBool(tango_config_, "config_enable_color_camera", true);
+  if (ret != TANGO_SUCCESS) {
+    LOGE(
+        "PointCloudApp: config_enable_color_camera() failed with error"
+        "code: %d",
+        ret);
+    return ret;
+  }
+
+  // Query the point cloud capacity so the vertex buffer can be allocated once.
+  int32_t max_point_cloud_elements;
+  ret = TangoConfig_getInt32(tango_config_, "max_point_cloud_elements",
+                             &max_point_cloud_elements);
+  if (ret != TANGO_SUCCESS) {
+    LOGE(
+        "PointCloudApp: Failed to query maximum number of point cloud "
+        "elements with error code: %d",
+        ret);
+    return ret;
+  }
+  {
+    std::lock_guard<tango_gl::ProfiledMutex> lock(point_cloud_mutex_);
+    max_point_cloud_elements_ = max_point_cloud_elements;
+  }
+
+  // Before the callbacks are connected, and only once, as the buffers handed
+  // to Java are over its slots.
+  if (!java_point_clouds_.IsInitialized()) {
+    java_point_clouds_.Initialize(kJavaPointCloudReaderCount,
+                                  max_point_cloud_elements);
+  }
+
   return ret;
 }
 
 int PointCloudApp::TangoConnectCallbacks() {
+  // Start handling the callback data before the service can call back.
+  dispatcher_.Start();
+
   // Attach the OnXYZijAvailable callback.
   // The callback will be called after the service is connected.
   int ret = TangoService_connectOnXYZijAvailable(onPointCloudAvailableRouter);
@@ -164,12 +399,35 @@ bool PointCloudApp::TangoConnect() {
     return false;
   }
 
-  err = UpdateExtrinsics();
+  err = extrinsics_.Update();
   if (err != TANGO_SUCCESS) {
     LOGE("PointCloudApp: Failed to query sensor extrinsic with error code: %d",
          err);
     return false;
   }
+
+  // Without the depth camera intrinsics the point clouds are only segmented
+  // when the service fills their ij buffer.
+  TangoCameraIntrinsics depth_camera_intrinsics;
+  if (intrinsics_.Update(TANGO_CAMERA_DEPTH) == TANGO_SUCCESS &&
+      intrinsics_.GetIntrinsics(TANGO_CAMERA_DEPTH,
+                                &depth_camera_intrinsics)) {
+    std::lock_guard<tango_gl::ProfiledMutex> lock(point_cloud_mutex_);
+    depth_camera_intrinsics_ = depth_camera_intrinsics;
+    has_depth_camera_intrinsics_ = true;
+  } else {
+    LOGE("PointCloudApp: Failed to query the depth camera intrinsics");
+  }
+
+  // Without the intrinsics the point cloud stays colored by depth.
+  err = intrinsics_.Update(TANGO_CAMERA_COLOR);
+  if (err != TANGO_SUCCESS) {
+    LOGE(
+        "PointCloudApp: Failed to query the color camera intrinsics with "
+        "error code: %d",
+        err);
+  }
+  connection_id_.fetch_add(1);
   return true;
 }
 
@@ -182,84 +440,329 @@ void PointCloudApp::TangoDisconnect() {
   TangoConfig_free(tango_config_);
   tango_config_ = nullptr;
   TangoService_disconnect();
+
+  // No callback can post anymore, the queued data is handled on the next
+  // connection.
+  dispatcher_.Stop();
+  const tango_util::DispatchQueueStats pose_stats = pose_queue_.GetStats();
+  LOGI("PointCloudApp: %llu of %llu poses dropped, %.2f ms average latency",
+       static_cast<unsigned long long>(pose_stats.dropped_count),
+       static_cast<unsigned long long>(pose_stats.posted_count),
+       pose_stats.average_latency * 1000.0);
 }
 
-void PointCloudApp::InitializeGLContent() { main_scene_.InitGLContent(); }
+void PointCloudApp::InitializeGLContent() {
+  main_scene_.InitGLContent();
+  // The texture of a previous context died with it, and the drawables were
+  // created again without the intrinsics.
+  color_texture_id_ = 0;
+  color_texture_connection_id_ = 0;
+  is_color_texture_connected_ = false;
+  has_color_intrinsics_ = false;
+  main_scene_.SetPointCloudPointSize(kVoxelLeafSize);
+}
 
 void PointCloudApp::SetViewPort(int width, int height) {
   main_scene_.SetupViewPort(width, height);
 }
 
 void PointCloudApp::Render() {
+  TANGO_TRACE_SCOPE("PointCloudApp::Render");
+  tango_util::ThreadPolicy::Get().Enter(tango_util::ThreadPolicy::kRenderStage);
+  quality_governor_.BeginFrame();
   // Query the latest pose transformation and point cloud frame transformation.
   // Point cloud data comes in with a specific timestamp, in order to get the
   // closest pose for the point cloud, we will need to use the
   // TangoService_getPoseAtTime() to query pose at timestamp.
-  glm::mat4 cur_pose_transformation;
+  glm::mat4 cur_pose_transformation = pose_data_.GetLatestPoseMatrix();
   glm::mat4 point_cloud_transformation;
-  {
-    std::lock_guard<std::mutex> lock(pose_mutex_);
-    cur_pose_transformation = pose_data_.GetLatestPoseMatrix();
-  }
 
-  double point_cloud_timestamp;
-  // We make another copy for rendering and depth computation.
-  std::vector<float> vertices_cpy;
+  int max_point_cloud_elements;
   {
-    std::lock_guard<std::mutex> lock(point_cloud_mutex_);
-    point_cloud_timestamp = point_cloud_data_.GetCurrentTimstamp();
-    std::vector<float> vertices = point_cloud_data_.GetVerticeVector();
-    vertices_cpy = std::vector<float>(vertices);
+    std::lock_guard<tango_gl::ProfiledMutex> lock(point_cloud_mutex_);
+    max_point_cloud_elements = max_point_cloud_elements_;
   }
+  // The latest frame processed by the pipeline, which stays valid until the
+  // next call from this thread.
+  bool new_points = false;
+  const DepthFrame* depth_frame = depth_pipeline_.Acquire(&new_points);
+  const TangoXYZij* latest_point_cloud =
+      depth_frame != nullptr ? &depth_frame->point_cloud : nullptr;
+  const TangoXYZij* point_cloud = latest_point_cloud;
+  if (point_cloud == nullptr || point_cloud->xyz_count == 0) {
+    point_cloud = nullptr;
+  }
+  const double point_cloud_timestamp =
+      point_cloud != nullptr ? point_cloud->timestamp : 0.0;
 
   // Get the latest pose transformation in opengl frame and apply extrinsics to
   // it.
   cur_pose_transformation =
-      pose_data_.GetExtrinsicsAppliedOpenGLWorldFrame(cur_pose_transformation);
+      extrinsics_.GetOpenGlWorldTDepthOpenGlCamera(cur_pose_transformation);
 
   // Query pose based on point cloud frame's timestamp.
-  point_cloud_transformation = GetPoseMatrixAtTimestamp(point_cloud_timestamp);
+  bool is_point_cloud_pose_valid = false;
+  const glm::mat4 start_service_T_device = GetPoseMatrixAtTimestamp(
+      point_cloud_timestamp, &is_point_cloud_pose_valid);
   // Get the point cloud transformation in opengl frame and apply extrinsics to
   // it.
-  point_cloud_transformation = pose_data_.GetExtrinsicsAppliedOpenGLWorldFrame(
-      point_cloud_transformation);
+  point_cloud_transformation =
+      extrinsics_.GetOpenGlWorldTDepthOpenGlCamera(start_service_T_device);
+
+  // The average depth only changes with the frame.
+  if (new_points && point_cloud != nullptr) {
+    std::lock_guard<tango_gl::ProfiledMutex> lock(point_cloud_mutex_);
+    point_cloud_data_.SetAverageDepth(depth_frame->average_depth);
+    telemetry_.Write([this, depth_frame](Telemetry* telemetry) {
+      point_cloud_data_.WriteTelemetry(telemetry);
+      telemetry->segment_count = depth_frame->segment_count;
+    });
+  }
 
-  // Compute the average depth value.
-  float average_depth_ = 0.0f;
-  size_t iteration_size = vertices_cpy.size();
-  size_t vertices_count = 0;
-  for (size_t i = 2; i < iteration_size; i += 3) {
-    average_depth_ += vertices_cpy[i];
-    vertices_count++;
+  // Only the downsampled points are rendered.
+  if (point_cloud != nullptr) {
+    point_cloud = &depth_frame->filtered_point_cloud;
   }
-  if (vertices_count) {
-    average_depth_ /= vertices_count;
+
+  // The map is allocated, at its full size, only while accumulating. It is
+  // left as it is while the exporter writes it.
+  const bool is_exporting = exporter_.IsBusy();
+  if (!is_accumulating_.load()) {
+    if (!is_exporting) {
+      point_cloud_map_.reset();
+    }
+  } else {
+    if (!point_cloud_map_) {
+      tango_util::PointCloudMap::Options options;
+      {
+        std::lock_guard<std::mutex> lock(map_tile_file_mutex_);
+        options.tile_file_path = map_tile_file_;
+      }
+      point_cloud_map_.reset(new tango_util::PointCloudMap(options));
+    }
+    if (new_points && point_cloud != nullptr && is_point_cloud_pose_valid &&
+        !is_exporting) {
+      TANGO_TRACE_SCOPE("PointCloudMap::Insert");
+      point_cloud_map_->Insert(
+          point_cloud,
+          start_service_T_device * extrinsics_.GetDeviceTDepthCamera());
+    }
+  }
+
+  if (is_alignment_requested_.exchange(false)) {
+    glm::mat4 initial_world_T_model;
+    {
+      std::lock_guard<std::mutex> lock(alignment_mutex_);
+      initial_world_T_model = initial_world_T_model_;
+    }
+    std::vector<glm::vec3> map_points;
+    if (point_cloud_map_) {
+      tango_util::GetMapPoints(*point_cloud_map_, kMaxAlignmentPointCount,
+                               &map_points);
+    }
+    if (map_points.empty() ||
+        !aligner_.Start(&map_points, initial_world_T_model)) {
+      LOGE("PointCloudApp: Can not align the model to the map");
+    }
   }
 
+  std::string export_path;
   {
-    std::lock_guard<std::mutex> lock(point_cloud_mutex_);
-    point_cloud_data_.SetAverageDepth(average_depth_);
+    std::lock_guard<std::mutex> lock(export_mutex_);
+    if (!is_exporting) {
+      export_path.swap(export_path_);
+    }
+  }
+  if (!export_path.empty()) {
+    // The raw points are exported rather than the downsampled ones.
+    if (point_cloud_map_) {
+      exporter_.ExportPointCloudMap(export_path.c_str(),
+                                    point_cloud_map_.get());
+    } else if (latest_point_cloud != nullptr && is_point_cloud_pose_valid) {
+      exporter_.ExportPointCloud(
+          export_path.c_str(), latest_point_cloud,
+          start_service_T_device * extrinsics_.GetDeviceTDepthCamera());
+    } else {
+      LOGE("PointCloudApp: No point cloud to export");
+    }
   }
 
+  // The color image is only streamed while the point cloud is colorized.
+  GLuint color_texture_id = 0;
+  glm::mat4 color_camera_T_depth_camera;
+  if (is_colorized_.load() && point_cloud != nullptr &&
+      is_point_cloud_pose_valid) {
+    color_texture_id =
+        UpdateColorImage(start_service_T_device, &color_camera_T_depth_camera);
+  }
+  main_scene_.SetColorImage(color_texture_id, color_camera_T_depth_camera);
+
+  // Only the point budget of the quality level applies here, the point cloud
+  // is always drawn as it is the point of the app.
+  int point_budget = quality_governor_.GetLevel().point_budget;
+  const bool is_eye_dome_lighting = is_eye_dome_lighting_.load();
+  if (is_eye_dome_lighting && point_budget > 0) {
+    point_budget = std::max(
+        static_cast<int>(point_budget * kEyeDomeLightingPointBudgetScale), 1);
+  }
+  main_scene_.SetMaxPointCloudElements(max_point_cloud_elements);
+  main_scene_.SetPointBudget(point_budget);
+  main_scene_.SetEyeDomeLightingEnabled(is_eye_dome_lighting);
   main_scene_.Render(cur_pose_transformation, point_cloud_transformation,
-                     vertices_cpy);
+                     point_cloud, new_points,
+                     extrinsics_.GetOpenGlWorldTStartService(),
+                     point_cloud_map_.get());
+  quality_governor_.EndFrame();
 }
 
 void PointCloudApp::DeleteResources() { main_scene_.DeleteResources(); }
 
-int PointCloudApp::GetPointCloudVerticesCount() {
-  std::lock_guard<std::mutex> lock(point_cloud_mutex_);
-  return point_cloud_data_.GetPointCloudVerticesCount();
+void PointCloudApp::SetCameraType(
+    tango_gl::GestureCamera::CameraType camera_type) {
+  main_scene_.SetCameraType(camera_type);
+}
+
+jobject PointCloudApp::AcquireJavaPointCloud(JNIEnv* env) {
+  std::lock_guard<std::mutex> lock(java_point_cloud_mutex_);
+  if (!java_point_clouds_.IsInitialized()) {
+    return nullptr;
+  }
+  is_java_point_cloud_requested_.store(true);
+  bool is_new;
+  java_point_cloud_ = java_point_cloud_reader_.Acquire(&is_new);
+  if (java_point_cloud_ == nullptr) {
+    return nullptr;
+  }
+  // The slots of the pool are allocated once, so each gets a single buffer,
+  // and acquiring a cloud allocates nothing on either heap.
+  const float* points = java_point_cloud_->xyz[0];
+  for (const std::pair<const float*, jobject>& buffer :
+       java_point_cloud_buffers_) {
+    if (buffer.first == points) {
+      return buffer.second;
+    }
+  }
+  jobject buffer = env->NewDirectByteBuffer(
+      const_cast<float*>(points),
+      static_cast<jlong>(max_point_cloud_elements_) * 3 * sizeof(float));
+  if (buffer == nullptr) {
+    LOGE("PointCloudApp: Failed to create the point cloud buffer.");
+    return nullptr;
+  }
+  // Kept for as long as the pool, that is, the app.
+  jobject global_buffer = env->NewGlobalRef(buffer);
+  env->DeleteLocalRef(buffer);
+  java_point_cloud_buffers_.emplace_back(points, global_buffer);
+  return global_buffer;
+}
+
+void PointCloudApp::ReleaseJavaPointCloud() {
+  std::lock_guard<std::mutex> lock(java_point_cloud_mutex_);
+  java_point_cloud_reader_.Release();
+  java_point_cloud_ = nullptr;
 }
 
-float PointCloudApp::GetAverageZ() {
-  std::lock_guard<std::mutex> lock(point_cloud_mutex_);
-  return point_cloud_data_.GetAverageDepth();
+int PointCloudApp::GetJavaPointCount() {
+  std::lock_guard<std::mutex> lock(java_point_cloud_mutex_);
+  return java_point_cloud_ != nullptr
+             ? static_cast<int>(java_point_cloud_->xyz_count)
+             : 0;
 }
 
-void PointCloudApp::SetCameraType(
-    tango_gl::GestureCamera::CameraType camera_type) {
-  main_scene_.SetCameraType(camera_type);
+double PointCloudApp::GetJavaPointCloudTimestamp() {
+  std::lock_guard<std::mutex> lock(java_point_cloud_mutex_);
+  return java_point_cloud_ != nullptr ? java_point_cloud_->timestamp : 0.0;
+}
+
+void PointCloudApp::SetGpuProfilerHudVisible(bool visible) {
+  main_scene_.SetGpuProfilerHudVisible(visible);
+}
+
+void PointCloudApp::SetAccumulationMode(bool accumulate) {
+  is_accumulating_.store(accumulate);
+}
+
+void PointCloudApp::SetMapTileFile(const char* path) {
+  std::lock_guard<std::mutex> lock(map_tile_file_mutex_);
+  map_tile_file_ = path;
+}
+
+void PointCloudApp::ExportPointCloud(const char* path) {
+  std::lock_guard<std::mutex> lock(export_mutex_);
+  export_path_ = path;
+}
+
+bool PointCloudApp::StartStreaming(const char* host, int port) {
+  tango_util::NetworkStreamer::Options options;
+  {
+    std::lock_guard<tango_gl::ProfiledMutex> lock(point_cloud_mutex_);
+    if (max_point_cloud_elements_ > 0) {
+      options.max_point_count = max_point_cloud_elements_;
+    }
+  }
+  return streamer_.Start(host, port, options);
+}
+
+void PointCloudApp::StopStreaming() { streamer_.Stop(); }
+
+int PointCloudApp::StartSharedSensorPublishing() {
+  tango_util::SharedSensorPublisher::Options options;
+  {
+    std::lock_guard<tango_gl::ProfiledMutex> lock(point_cloud_mutex_);
+    if (max_point_cloud_elements_ > 0) {
+      options.max_point_count = max_point_cloud_elements_;
+    }
+  }
+  return sensor_publisher_.Start(options) ? sensor_publisher_.GetFd() : -1;
+}
+
+void PointCloudApp::StopSharedSensorPublishing() { sensor_publisher_.Stop(); }
+
+bool PointCloudApp::LoadAlignmentModel(const char* path) {
+  if (!aligner_.LoadModel(path)) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(alignment_mutex_);
+  initial_world_T_model_ = glm::mat4(1.0f);
+  has_initial_alignment_ = false;
+  return true;
+}
+
+bool PointCloudApp::SetModelCorrespondences(const float* model_points,
+                                            const float* world_points,
+                                            int count) {
+  std::vector<glm::vec3> model(count);
+  std::vector<glm::vec3> world(count);
+  for (int i = 0; i < count; ++i) {
+    model[i] = glm::make_vec3(model_points + i * 3);
+    world[i] = glm::make_vec3(world_points + i * 3);
+  }
+  glm::mat4 world_T_model;
+  if (!tango_util::FindSimilarityTransform(model, world, &world_T_model)) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(alignment_mutex_);
+  initial_world_T_model_ = world_T_model;
+  has_initial_alignment_ = true;
+  return true;
+}
+
+void PointCloudApp::AlignModelToMap() { is_alignment_requested_.store(true); }
+
+bool PointCloudApp::GetModelAlignment(float world_T_model[16]) {
+  tango_util::ModelAligner::Result result;
+  glm::mat4 alignment;
+  if (aligner_.GetResult(&result)) {
+    alignment = result.world_T_model;
+  } else {
+    std::lock_guard<std::mutex> lock(alignment_mutex_);
+    if (!has_initial_alignment_) {
+      return false;
+    }
+    alignment = initial_world_T_model_;
+  }
+  memcpy(world_T_model, glm::value_ptr(alignment), 16 * sizeof(float));
+  return true;
 }
 
 void PointCloudApp::OnTouchEvent(int touch_count,
@@ -268,12 +771,78 @@ void PointCloudApp::OnTouchEvent(int touch_count,
   main_scene_.OnTouchEvent(touch_count, event, x0, y0, x1, y1);
 }
 
-glm::mat4 PointCloudApp::GetPoseMatrixAtTimestamp(double timstamp) {
+GLuint PointCloudApp::UpdateColorImage(
+    const glm::mat4& start_service_T_device,
+    glm::mat4* color_camera_T_depth_camera) {
+  const int connection_id = connection_id_.load();
+  if (connection_id == 0) {
+    return 0;
+  }
+  if (color_texture_id_ == 0) {
+    glGenTextures(1, &color_texture_id_);
+    glBindTexture(GL_TEXTURE_EXTERNAL_OES, color_texture_id_);
+    glTexParameteri(GL_TEXTURE_EXTERNAL_OES, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_EXTERNAL_OES, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_EXTERNAL_OES, 0);
+  }
+  // The service writes the images straight into the texture, they are never
+  // copied to the CPU. Connected once per connection, failed or not.
+  if (color_texture_connection_id_ != connection_id) {
+    color_texture_connection_id_ = connection_id;
+    is_color_texture_connected_ =
+        TangoService_connectTextureId(TANGO_CAMERA_COLOR, color_texture_id_,
+                                      this, nullptr) == TANGO_SUCCESS;
+    if (!is_color_texture_connected_) {
+      LOGE("PointCloudApp: Failed to connect the color camera texture");
+    }
+  }
+  if (!is_color_texture_connected_) {
+    return 0;
+  }
+  if (!has_color_intrinsics_) {
+    TangoCameraIntrinsics color_camera_intrinsics;
+    if (!intrinsics_.GetIntrinsics(TANGO_CAMERA_COLOR,
+                                   &color_camera_intrinsics)) {
+      return 0;
+    }
+    main_scene_.SetColorCameraIntrinsics(color_camera_intrinsics);
+    has_color_intrinsics_ = true;
+  }
+
+  double color_timestamp = 0.0;
+  TangoErrorType status;
+  {
+    TANGO_TRACE_SCOPE("TangoService_updateTexture");
+    status = TangoService_updateTexture(TANGO_CAMERA_COLOR, &color_timestamp);
+  }
+  if (status != TANGO_SUCCESS) {
+    return 0;
+  }
+
+  // The point cloud was taken at t0 and the image at t1:
+  //   color_camera_t1_T_depth_camera_t0 =
+  //       color_camera_T_device * inverse(start_service_T_device_t1) *
+  //       start_service_T_device_t0 * device_T_depth_camera
+  bool is_color_pose_valid = false;
+  const glm::mat4 start_service_T_device_t1 =
+      GetPoseMatrixAtTimestamp(color_timestamp, &is_color_pose_valid);
+  if (!is_color_pose_valid) {
+    return 0;
+  }
+  *color_camera_T_depth_camera = extrinsics_.GetColorCameraTDevice() *
+                                 glm::inverse(start_service_T_device_t1) *
+                                 start_service_T_device *
+                                 extrinsics_.GetDeviceTDepthCamera();
+  return color_texture_id_;
+}
+
+glm::mat4 PointCloudApp::GetPoseMatrixAtTimestamp(double timstamp,
+                                                  bool* is_valid) {
   TangoPoseData pose_start_service_T_device;
   TangoCoordinateFramePair frame_pair;
   frame_pair.base = TANGO_COORDINATE_FRAME_START_OF_SERVICE;
   frame_pair.target = TANGO_COORDINATE_FRAME_DEVICE;
-  TangoErrorType status = TangoService_getPoseAtTime(
+  TangoErrorType status = tango_util::GetPoseAtTime(
       timstamp, frame_pair, &pose_start_service_T_device);
   if (status != TANGO_SUCCESS) {
     LOGE(
@@ -281,45 +850,12 @@ glm::mat4 PointCloudApp::GetPoseMatrixAtTimestamp(double timstamp) {
         "device frames at timstamp %lf",
         timstamp);
   }
-  if (pose_start_service_T_device.status_code != TANGO_POSE_VALID) {
+  *is_valid = status == TANGO_SUCCESS &&
+              pose_start_service_T_device.status_code == TANGO_POSE_VALID;
+  if (!*is_valid) {
     return glm::mat4(1.0f);
   }
   return pose_data_.GetMatrixFromPose(pose_start_service_T_device);
 }
 
-TangoErrorType PointCloudApp::UpdateExtrinsics() {
-  TangoErrorType ret;
-  TangoPoseData pose_data;
-  TangoCoordinateFramePair frame_pair;
-
-  // TangoService_getPoseAtTime function is used for query device extrinsics
-  // as well. We use timestamp 0.0 and the target frame pair to get the
-  // extrinsics from the sensors.
-  //
-  // Get device with respect to imu transformation matrix.
-  frame_pair.base = TANGO_COORDINATE_FRAME_IMU;
-  frame_pair.target = TANGO_COORDINATE_FRAME_DEVICE;
-  ret = TangoService_getPoseAtTime(0.0, frame_pair, &pose_data);
-  if (ret != TANGO_SUCCESS) {
-    LOGE(
-        "PointCloudApp: Failed to get transform between the IMU frame and "
-        "device frames");
-    return ret;
-  }
-  pose_data_.SetImuTDevice(pose_data_.GetMatrixFromPose(pose_data));
-
-  // Get color camera with respect to imu transformation matrix.
-  frame_pair.base = TANGO_COORDINATE_FRAME_IMU;
-  frame_pair.target = TANGO_COORDINATE_FRAME_CAMERA_DEPTH;
-  ret = TangoService_getPoseAtTime(0.0, frame_pair, &pose_data);
-  if (ret != TANGO_SUCCESS) {
-    LOGE(
-        "PointCloudApp: Failed to get transform between the color camera frame "
-        "and device frames");
-    return ret;
-  }
-  pose_data_.SetImuTDepthCamera(pose_data_.GetMatrixFromPose(pose_data));
-  return ret;
-}
-
 }  // namespace tango_point_cloud
@@ -22,35 +22,29 @@ const float kSecondToMillisecond = 1000.0f;
 
 namespace tango_point_cloud {
 
-int PointCloudData::GetPointCloudVerticesCount() { return vertices_count_; }
-
-float PointCloudData::GetAverageDepth() { return average_depth_; }
-
 void PointCloudData::SetAverageDepth(float average_depth) {
   average_depth_ = average_depth;
 }
 
-float PointCloudData::GetDepthFrameDeltaTime() {
-  return static_cast<float>(delta_timestamp_) * kSecondToMillisecond;
+void PointCloudData::WriteTelemetry(Telemetry* telemetry) const {
+  telemetry->point_count = vertices_count_;
+  telemetry->average_depth = average_depth_;
+  telemetry->frame_delta_time =
+      static_cast<float>(delta_timestamp_) * kSecondToMillisecond;
 }
 
 double PointCloudData::GetCurrentTimstamp() { return cur_frame_timstamp_; }
 
-void PointCloudData::UpdatePointCloud(const TangoXYZij* point_cloud) {
-  size_t point_cloud_size = point_cloud->xyz_count * 3;
-  vertices_.resize(point_cloud_size);
-  std::copy(point_cloud->xyz[0], point_cloud->xyz[0] + point_cloud_size,
-            vertices_.begin());
-
+void PointCloudData::UpdatePointCloud(double timestamp, int vertices_count) {
   // Get current frame's point count.
-  vertices_count_ = point_cloud->xyz_count;
+  vertices_count_ = vertices_count;
 
   // Compute the frame delta time.
-  cur_frame_timstamp_ = point_cloud->timestamp;
+  cur_frame_timstamp_ = timestamp;
   delta_timestamp_ = cur_frame_timstamp_ - prev_frame_timestamp_;
 
   // Set current timestamp to previous timestamp.
-  prev_frame_timestamp_ = point_cloud->timestamp;
+  prev_frame_timestamp_ = timestamp;
 }
 
 }  // namespace tango_point_cloud
@@ -16,28 +16,94 @@
  */
 
 #include <sstream>
+#include <tango-gl/gl_state.h>
+#include <tango-gl/render_statistics.h>
+#include <tango-gl/shaders.h>
 
 #include "tango-point-cloud/point_cloud_drawable.h"
 
 namespace {
-const std::string kPointCloudVertexShader =
-    "precision mediump float;\n"
-    "precision mediump int;\n"
-    "attribute vec4 vertex;\n"
+// Color of a point of depth z, from red to green to blue over depth_range.
+#define POINT_CLOUD_GLSL_DEPTH_COLOR                                        \
+  "uniform highp vec2 depth_range;\n"                                       \
+  "vec4 DepthColor(highp float z) {\n"                                      \
+  "  float t = clamp((z - depth_range.x) /\n"                               \
+  "                  max(depth_range.y - depth_range.x, 0.001), 0.0, 1.0);\n" \
+  "  return vec4(clamp(1.0 - 2.0 * t, 0.0, 1.0), 1.0 - abs(2.0 * t - 1.0),\n" \
+  "              clamp(2.0 * t - 1.0, 0.0, 1.0), 1.0);\n"                  \
+  "}\n"
+
+// The points are uploaded quantized, see tango_gl::QuantizedPoints, colored
+// by depth from red to green to blue over depth_range, and sized by distance,
+// see tango_gl::PointLevelOfDetail.
+const char kPointCloudVertexShader[] =
+    TANGO_GL_GLSL_MEDIUMP
+    "attribute highp vec4 vertex;\n"
     "uniform mat4 mvp;\n"
     "varying vec4 v_color;\n"
+    TANGO_GL_GLSL_DEQUANTIZE_POINT
+    TANGO_GL_GLSL_POINT_SIZE_BY_DISTANCE
+    POINT_CLOUD_GLSL_DEPTH_COLOR
     "void main() {\n"
-    "  gl_Position = mvp*vertex;\n"
-    "  v_color = vertex;\n"
+    "  highp vec4 position = DequantizePoint(vertex);\n"
+    "  gl_Position = mvp*position;\n"
+    "  gl_PointSize = PointSizeByDistance(gl_Position);\n"
+    "  v_color = DepthColor(position.z);\n"
     "}\n";
-const std::string kPointCloudFragmentShader =
-    "precision mediump float;\n"
-    "precision mediump int;\n"
+const char kPointCloudFragmentShader[] =
+    TANGO_GL_GLSL_MEDIUMP
     "varying vec4 v_color;\n"
     "void main() {\n"
     "  gl_FragColor = vec4(v_color);\n"
     "}\n";
 
+// The same points projected into the color camera, as the depth image of the
+// RGB depth sync example does, to be colored by the pixel they fall on. The
+// intrinsics are normalized by the image size, so the projection directly is
+// the texture coordinate, whose v is the row from the top as the camera's y.
+// The points out of the image keep their depth color.
+const char kColorizedVertexShader[] =
+    TANGO_GL_GLSL_MEDIUMP
+    "attribute highp vec4 vertex;\n"
+    "uniform mat4 mvp;\n"
+    "uniform highp mat4 color_T_depth;\n"
+    "uniform highp vec4 color_intrinsics;\n"
+    "varying vec4 v_color;\n"
+    "varying vec2 v_color_uv;\n"
+    "varying float v_in_image;\n"
+    TANGO_GL_GLSL_DEQUANTIZE_POINT
+    TANGO_GL_GLSL_POINT_SIZE_BY_DISTANCE
+    POINT_CLOUD_GLSL_DEPTH_COLOR
+    "void main() {\n"
+    "  highp vec4 position = DequantizePoint(vertex);\n"
+    "  gl_Position = mvp*position;\n"
+    "  gl_PointSize = PointSizeByDistance(gl_Position);\n"
+    "  v_color = DepthColor(position.z);\n"
+    "  highp vec4 color_point = color_T_depth * position;\n"
+    "  highp vec2 uv = color_point.xy / max(color_point.z, 0.001) *\n"
+    "                  color_intrinsics.xy + color_intrinsics.zw;\n"
+    "  v_color_uv = uv;\n"
+    "  v_in_image = color_point.z > 0.0 &&\n"
+    "               all(greaterThanEqual(uv, vec2(0.0))) &&\n"
+    "               all(lessThanEqual(uv, vec2(1.0))) ? 1.0 : 0.0;\n"
+    "}\n";
+const char kColorizedFragmentShader[] =
+    "#extension GL_OES_EGL_image_external : require\n"
+    TANGO_GL_GLSL_MEDIUMP
+    "uniform samplerExternalOES color_texture;\n"
+    "varying vec4 v_color;\n"
+    "varying vec2 v_color_uv;\n"
+    "varying float v_in_image;\n"
+    "void main() {\n"
+    "  gl_FragColor = v_in_image > 0.5 ? texture2D(color_texture, v_color_uv)\n"
+    "                                  : v_color;\n"
+    "}\n";
+
+// Fractions of the points closer than the ends of the colormap, so a few
+// outliers do not squeeze the colors of the rest.
+const float kColormapNearFraction = 0.02f;
+const float kColormapFarFraction = 0.98f;
+
 const glm::mat4 kOpengGL_T_Depth =
     glm::mat4(1.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f,
               -1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f);
@@ -45,44 +111,136 @@ const glm::mat4 kOpengGL_T_Depth =
 
 namespace tango_point_cloud {
 
-PointCloudDrawable::PointCloudDrawable() {
-  shader_program_ = tango_gl::util::CreateProgram(
-      kPointCloudVertexShader.c_str(), kPointCloudFragmentShader.c_str());
+PointCloudDrawable::Program::Program()
+    : id(0),
+      vertices_handle(0),
+      mvp_handle(0),
+      point_scale_handle(-1),
+      point_offset_handle(-1),
+      depth_range_handle(-1),
+      point_size_scale_handle(-1),
+      color_T_depth_handle(-1),
+      color_intrinsics_handle(-1),
+      color_texture_handle(-1) {}
 
-  mvp_handle_ = glGetUniformLocation(shader_program_, "mvp");
-  vertices_handle_ = glGetAttribLocation(shader_program_, "vertex");
-  glGenBuffers(1, &vertex_buffers_);
+bool PointCloudDrawable::Program::Initialize(const char* vertex_shader,
+                                             const char* fragment_shader) {
+  const tango_gl::util::SharedProgram* program =
+      tango_gl::util::GetSharedProgram(vertex_shader, fragment_shader);
+  if (!program) {
+    id = 0;
+    return false;
+  }
+  id = program->GetId();
+  mvp_handle = program->GetUniformLocation("mvp");
+  vertices_handle = program->GetAttribLocation("vertex");
+  point_scale_handle = program->GetUniformLocation("point_scale");
+  point_offset_handle = program->GetUniformLocation("point_offset");
+  depth_range_handle = program->GetUniformLocation("depth_range");
+  point_size_scale_handle = program->GetUniformLocation("point_size_scale");
+  color_T_depth_handle = program->GetUniformLocation("color_T_depth");
+  color_intrinsics_handle = program->GetUniformLocation("color_intrinsics");
+  color_texture_handle = program->GetUniformLocation("color_texture");
+  return true;
 }
 
-void PointCloudDrawable::DeleteGlResources() {
-  if (vertex_buffers_) {
-    glDeleteBuffers(1, &vertex_buffers_);
+PointCloudDrawable::PointCloudDrawable()
+    : max_point_count_(0), color_texture_id_(0), color_intrinsics_(0.0f) {
+  if (!depth_program_.Initialize(kPointCloudVertexShader,
+                                 kPointCloudFragmentShader)) {
+    LOGE("Could not create program.");
+  }
+  // Without the colorized program the points stay colored by depth.
+  if (!colorized_program_.Initialize(kColorizedVertexShader,
+                                     kColorizedFragmentShader)) {
+    LOGE("Could not create the colorized program.");
   }
-  if (shader_program_) {
-    glDeleteShader(shader_program_);
+}
+
+void PointCloudDrawable::SetColorCameraIntrinsics(
+    const TangoCameraIntrinsics& intrinsics) {
+  if (intrinsics.width == 0 || intrinsics.height == 0) {
+    LOGE("PointCloudDrawable: invalid color camera image size %ux%u",
+         intrinsics.width, intrinsics.height);
+    return;
   }
+  const float width = static_cast<float>(intrinsics.width);
+  const float height = static_cast<float>(intrinsics.height);
+  color_intrinsics_ =
+      glm::vec4(intrinsics.fx / width, intrinsics.fy / height,
+                intrinsics.cx / width, intrinsics.cy / height);
+}
+
+void PointCloudDrawable::DeleteGlResources() {
+  vertex_buffer_.DeleteGlResources();
+  // The programs are owned by tango_gl::util::GetSharedProgram().
+  depth_program_.id = 0;
+  colorized_program_.id = 0;
 }
 
 void PointCloudDrawable::Render(glm::mat4 projection_mat, glm::mat4 view_mat,
                                 glm::mat4 model_mat,
-                                const std::vector<float>& vertices) {
-  glUseProgram(shader_program_);
-  mvp_handle_ = glGetUniformLocation(shader_program_, "mvp");
+                                int viewport_height,
+                                const TangoXYZij* point_cloud,
+                                bool new_points) {
+  // The colorized program needs intrinsics, which only the color camera has.
+  const bool is_colorized = color_texture_id_ != 0 &&
+                            colorized_program_.id != 0 &&
+                            color_intrinsics_.x > 0.0f;
+  const Program& program = is_colorized ? colorized_program_ : depth_program_;
+  tango_gl::GlState::UseProgram(program.id);
 
   // Calculate model view projection matrix.
   glm::mat4 mvp_mat = projection_mat * view_mat * model_mat * kOpengGL_T_Depth;
-  glUniformMatrix4fv(mvp_handle_, 1, GL_FALSE, glm::value_ptr(mvp_mat));
+  glUniformMatrix4fv(program.mvp_handle, 1, GL_FALSE,
+                     glm::value_ptr(mvp_mat));
 
-  glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers_);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * vertices.size(),
-               vertices.data(), GL_STATIC_DRAW);
-  glEnableVertexAttribArray(vertices_handle_);
-  glVertexAttribPointer(vertices_handle_, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  // A fresh vertex buffer, e.g. after the GL context was recreated, has no
+  // content yet even if the point cloud did not change.
+  if (vertex_buffer_.GetCapacity() == 0) {
+    new_points = true;
+  }
+  vertex_buffer_.Reserve(tango_gl::QuantizedPoints::kPointSize *
+                         max_point_count_);
+  if (new_points) {
+    quantized_points_.Quantize(point_cloud->xyz[0], point_cloud->xyz_count);
+    // Shuffled so that the points within the budget are an even subsample.
+    quantized_points_.Shuffle();
+    vertex_buffer_.Update(quantized_points_.GetData(),
+                          quantized_points_.GetSize());
+  } else {
+    vertex_buffer_.Bind();
+  }
+  const tango_gl::PointCloudStatistics& statistics = GetStatistics();
+  quantized_points_.SetUniforms(program.point_scale_handle,
+                                program.point_offset_handle);
+  glUniform2f(program.depth_range_handle,
+              statistics.GetDepthPercentile(kColormapNearFraction),
+              statistics.GetDepthPercentile(kColormapFarFraction));
+  if (is_colorized) {
+    glUniformMatrix4fv(program.color_T_depth_handle, 1, GL_FALSE,
+                       glm::value_ptr(color_camera_T_depth_camera_));
+    glUniform4fv(program.color_intrinsics_handle, 1,
+                 glm::value_ptr(color_intrinsics_));
+    glUniform1i(program.color_texture_handle, 0);
+    glActiveTexture(GL_TEXTURE0);
+    tango_gl::CountRender(tango_gl::kRenderCounterTextureBinds);
+    glBindTexture(GL_TEXTURE_EXTERNAL_OES, color_texture_id_);
+  }
+  glEnableVertexAttribArray(program.vertices_handle);
+  tango_gl::QuantizedPoints::SetVertexAttribPointer(program.vertices_handle,
+                                                    1);
+  tango_gl::GlState::BindBuffer(GL_ARRAY_BUFFER, 0);
 
-  glDrawArrays(GL_POINTS, 0, vertices.size() / 3);
+  const int draw_count = level_of_detail_.Update(
+      quantized_points_.GetCount(), projection_mat, viewport_height);
+  level_of_detail_.SetUniforms(program.point_size_scale_handle);
+  glDrawArrays(GL_POINTS, 0, draw_count);
 
-  glUseProgram(0);
+  if (is_colorized) {
+    glBindTexture(GL_TEXTURE_EXTERNAL_OES, 0);
+  }
+  tango_gl::GlState::UseProgram(0);
   tango_gl::util::CheckGlError("Pointcloud::Render()");
 }
 
@@ -0,0 +1,197 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <tango-gl/gl_state.h>
+#include <tango-gl/shaders.h>
+
+#include "tango-point-cloud/point_cloud_map_drawable.h"
+
+namespace {
+// The weight of a vertex is the occupancy of its voxel. Voxels are sized by
+// distance, see tango_gl::PointLevelOfDetail.
+const char kMapVertexShader[] =
+    TANGO_GL_GLSL_MEDIUMP
+    "attribute vec4 vertex;\n"
+    "uniform mat4 mvp;\n"
+    "uniform float min_weight;\n"
+    "varying vec4 v_color;\n"
+    TANGO_GL_GLSL_POINT_SIZE_BY_DISTANCE
+    "void main() {\n"
+    "  if (vertex.w < min_weight) {\n"
+    "    gl_Position = vec4(2.0, 2.0, 2.0, 1.0);\n"
+    "  } else {\n"
+    "    gl_Position = mvp * vec4(vertex.xyz, 1.0);\n"
+    "  }\n"
+    "  gl_PointSize = PointSizeByDistance(gl_Position);\n"
+    "  // Colored by height in the start of service frame.\n"
+    "  float height = clamp((vertex.z + 1.5) / 3.0, 0.0, 1.0);\n"
+    "  v_color = vec4(mix(vec3(0.2, 0.3, 0.8), vec3(1.0, 0.6, 0.1), height),\n"
+    "                 1.0);\n"
+    "}\n";
+const char kMapFragmentShader[] =
+    TANGO_GL_GLSL_MEDIUMP
+    "varying vec4 v_color;\n"
+    "void main() {\n"
+    "  gl_FragColor = v_color;\n"
+    "}\n";
+
+// Voxels are only shown once observed in this many frames, which hides most
+// of the depth noise.
+const float kMinWeight = 2.0f;
+
+const int kVoxelsPerBlock = tango_util::PointCloudMap::kVoxelsPerBlock;
+const GLsizeiptr kSlotSize =
+    sizeof(tango_util::PointCloudMap::Voxel) * kVoxelsPerBlock;
+
+// The slots are drawn in chunks of as many voxels as 16 bit indices address,
+// all with the same index buffer.
+const uint32_t kSlotsPerChunk = 65536 / kVoxelsPerBlock;
+const GLsizei kVerticesPerChunk = kSlotsPerChunk * kVoxelsPerBlock;
+const GLsizeiptr kChunkSize = kSlotSize * kSlotsPerChunk;
+}  // namespace
+
+namespace tango_point_cloud {
+
+PointCloudMapDrawable::PointCloudMapDrawable()
+    : vertex_buffer_(0),
+      index_buffer_(0),
+      uploaded_map_(nullptr),
+      slot_count_(0),
+      chunk_count_(0) {
+  const tango_gl::util::SharedProgram* program =
+      tango_gl::util::GetSharedProgram(kMapVertexShader,
+                                       kMapFragmentShader);
+  if (!program) {
+    LOGE("Could not create program.");
+    shader_program_ = 0;
+    return;
+  }
+  shader_program_ = program->GetId();
+  mvp_handle_ = program->GetUniformLocation("mvp");
+  min_weight_handle_ = program->GetUniformLocation("min_weight");
+  vertices_handle_ = program->GetAttribLocation("vertex");
+  point_size_scale_handle_ = program->GetUniformLocation("point_size_scale");
+}
+
+PointCloudMapDrawable::~PointCloudMapDrawable() { DeleteGlResources(); }
+
+void PointCloudMapDrawable::DeleteGlResources() {
+  if (vertex_buffer_ != 0) {
+    tango_gl::GlState::DeleteBuffers(1, &vertex_buffer_);
+    vertex_buffer_ = 0;
+  }
+  if (index_buffer_ != 0) {
+    tango_gl::GlState::DeleteBuffers(1, &index_buffer_);
+    index_buffer_ = 0;
+  }
+  uploaded_map_ = nullptr;
+  slot_count_ = 0;
+  chunk_count_ = 0;
+  // The program is owned by tango_gl::util::GetSharedProgram().
+  shader_program_ = 0;
+}
+
+void PointCloudMapDrawable::Render(const glm::mat4& projection_mat,
+                                   const glm::mat4& view_mat,
+                                   const glm::mat4& model_mat,
+                                   int viewport_height,
+                                   tango_util::PointCloudMap* map) {
+  if (shader_program_ == 0) {
+    return;
+  }
+  map->TakeChangedSlots(&changed_slots_);
+
+  if (index_buffer_ == 0) {
+    CreateIndexBuffer();
+  }
+  if (vertex_buffer_ == 0) {
+    glGenBuffers(1, &vertex_buffer_);
+  }
+  tango_gl::GlState::BindBuffer(GL_ARRAY_BUFFER, vertex_buffer_);
+  if (uploaded_map_ != map || slot_count_ != map->GetSlotCount()) {
+    // A new buffer holds every slot, used or free, and is padded to whole
+    // chunks with slots of weight 0, which are never shown.
+    uploaded_map_ = map;
+    slot_count_ = map->GetSlotCount();
+    chunk_count_ = (slot_count_ + kSlotsPerChunk - 1) / kSlotsPerChunk;
+    const GLsizeiptr slots_size = kSlotSize * slot_count_;
+    const GLsizeiptr padding_size = kChunkSize * chunk_count_ - slots_size;
+    glBufferData(GL_ARRAY_BUFFER, kChunkSize * chunk_count_, nullptr,
+                 GL_DYNAMIC_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, slots_size, map->GetSlotVoxels(0));
+    if (padding_size > 0) {
+      const std::vector<char> padding(padding_size, 0);
+      glBufferSubData(GL_ARRAY_BUFFER, slots_size, padding_size,
+                      padding.data());
+    }
+  } else {
+    for (uint32_t slot : changed_slots_) {
+      glBufferSubData(GL_ARRAY_BUFFER, kSlotSize * slot, kSlotSize,
+                      map->GetSlotVoxels(slot));
+    }
+  }
+
+  tango_gl::GlState::UseProgram(shader_program_);
+  const glm::mat4 mvp_mat = projection_mat * view_mat * model_mat;
+  glUniformMatrix4fv(mvp_handle_, 1, GL_FALSE, glm::value_ptr(mvp_mat));
+  glUniform1f(min_weight_handle_, kMinWeight);
+  level_of_detail_.SetPointSize(map->GetVoxelSize());
+  const int draw_count = level_of_detail_.Update(
+      slot_count_ * kVoxelsPerBlock, projection_mat, viewport_height);
+  level_of_detail_.SetUniforms(point_size_scale_handle_);
+  // The budget is shared evenly by the chunks, so every block of the map
+  // gets the same number of voxels drawn.
+  const GLsizei chunk_draw_count = std::min<GLsizei>(
+      kVerticesPerChunk, (draw_count + chunk_count_ - 1) / chunk_count_);
+
+  glEnableVertexAttribArray(vertices_handle_);
+  tango_gl::GlState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer_);
+  for (uint32_t chunk = 0; chunk < chunk_count_; ++chunk) {
+    glVertexAttribPointer(vertices_handle_, 4, GL_FLOAT, GL_FALSE, 0,
+                          reinterpret_cast<const GLvoid*>(kChunkSize * chunk));
+    glDrawElements(GL_POINTS, chunk_draw_count, GL_UNSIGNED_SHORT, nullptr);
+  }
+  tango_gl::GlState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+  tango_gl::GlState::BindBuffer(GL_ARRAY_BUFFER, 0);
+
+  glDisableVertexAttribArray(vertices_handle_);
+  tango_gl::GlState::UseProgram(0);
+  tango_gl::util::CheckGlError("PointCloudMapDrawable::Render()");
+}
+
+void PointCloudMapDrawable::CreateIndexBuffer() {
+  // The voxels of a chunk by their rank in the shuffled order of a block,
+  // then by slot, so that any prefix draws an even subsample of every block.
+  const int stride =
+      tango_gl::PointLevelOfDetail::GetShuffleStride(kVoxelsPerBlock);
+  std::vector<GLushort> indices;
+  indices.reserve(kVerticesPerChunk);
+  int voxel = 0;
+  for (int rank = 0; rank < kVoxelsPerBlock; ++rank) {
+    for (uint32_t slot = 0; slot < kSlotsPerChunk; ++slot) {
+      indices.push_back(static_cast<GLushort>(slot * kVoxelsPerBlock + voxel));
+    }
+    voxel = (voxel + stride) % kVoxelsPerBlock;
+  }
+  glGenBuffers(1, &index_buffer_);
+  tango_gl::GlState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer_);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLushort) * indices.size(),
+               indices.data(), GL_STATIC_DRAW);
+  tango_gl::GlState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+}  // namespace tango_point_cloud
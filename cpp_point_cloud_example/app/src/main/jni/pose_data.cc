@@ -15,7 +15,6 @@
  */
 
 #include <sstream>
-#include <tango-gl/conversions.h>
 
 #include "tango-point-cloud/pose_data.h"
 
@@ -30,31 +29,11 @@ PoseData::PoseData() {}
 PoseData::~PoseData() {}
 
 void PoseData::UpdatePose(const TangoPoseData* pose_data) {
-  cur_pose_ = *pose_data;
+  cur_pose_.Write(*pose_data);
 }
 
 glm::mat4 PoseData::GetLatestPoseMatrix() {
-  return GetMatrixFromPose(cur_pose_);
-}
-
-glm::mat4 PoseData::GetExtrinsicsAppliedOpenGLWorldFrame(
-    const glm::mat4 pose_matrix) {
-  // This full multiplication is equal to:
-  //   opengl_world_T_opengl_camera =
-  //      opengl_world_T_start_service *
-  //      start_service_T_device *
-  //      device_T_imu *
-  //      imu_T_depth_camera *
-  //      depth_camera_T_opengl_camera;
-  //
-  // More information about frame transformation can be found here:
-  // Frame of reference:
-  //   https://developers.google.com/project-tango/overview/frames-of-reference
-  // Coordinate System Conventions:
-  //   https://developers.google.com/project-tango/overview/coordinate-systems
-  return tango_gl::conversions::opengl_world_T_tango_world() * pose_matrix *
-         glm::inverse(GetImuTDevice()) * GetImuTDepthCamera() *
-         tango_gl::conversions::depth_camera_T_opengl_camera();
+  return GetMatrixFromPose(cur_pose_.Read());
 }
 
 glm::mat4 PoseData::GetMatrixFromPose(const TangoPoseData& pose) {
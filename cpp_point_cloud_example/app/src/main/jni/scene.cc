@@ -15,6 +15,7 @@
  */
 
 #include <tango-gl/conversions.h>
+#include <tango-gl/gl_state.h>
 
 #include "tango-point-cloud/scene.h"
 
@@ -33,11 +34,24 @@ const tango_gl::Color kGridColor(0.85f, 0.85f, 0.85f);
 
 // Frustum scale.
 const glm::vec3 kFrustumScale = glm::vec3(0.4f, 0.3f, 0.5f);
+
+// Damping of the gesture camera's motion after a swipe, per second.
+const float kCameraInertia = 4.0f;
 }  // namespace
 
 namespace tango_point_cloud {
 
-Scene::Scene() {}
+Scene::Scene()
+    : viewport_height_(0),
+      trace_positions_(tango_gl::Trace::kSpacing,
+                       tango_gl::Trace::kMaxPointCount),
+      is_eye_dome_lighting_enabled_(false),
+      gpu_profiler_hud_(nullptr),
+      is_gpu_profiler_hud_visible_(false) {
+  gpu_profiler_.AddPass("Meshes");
+  gpu_profiler_.AddPass("Point cloud");
+  gpu_profiler_.AddPass("Eye dome lighting");
+}
 
 Scene::~Scene() {}
 
@@ -48,21 +62,35 @@ void Scene::InitGLContent() {
   trace_ = new tango_gl::Trace();
   grid_ = new tango_gl::Grid();
   point_cloud_ = new PointCloudDrawable();
+  point_cloud_map_ = new PointCloudMapDrawable();
+  // The queries and framebuffer of a previous context died with it.
+  gpu_profiler_.InvalidateGlResources();
+  eye_dome_lighting_.InvalidateGlResources();
+  gpu_profiler_hud_ = new tango_gl::GpuProfilerHud(&gpu_profiler_);
 
   trace_->SetColor(kTraceColor);
   grid_->SetColor(kGridColor);
+  // Falls back to lines where the context can not draw it.
+  grid_->SetProcedural(true);
   grid_->SetPosition(-kHeightOffset);
+  static_objects_.Add(grid_, grid_->GetBoundingBox());
   gesture_camera_->SetCameraType(
       tango_gl::GestureCamera::CameraType::kThirdPerson);
+  // The orbit around the map glides to a stop within about a second.
+  gesture_camera_->SetInertia(kCameraInertia);
 }
 
 void Scene::DeleteResources() {
+  static_objects_.Clear();
   delete gesture_camera_;
   delete axis_;
   delete frustum_;
   delete trace_;
   delete grid_;
   delete point_cloud_;
+  delete point_cloud_map_;
+  delete gpu_profiler_hud_;
+  gpu_profiler_hud_ = nullptr;
 }
 
 void Scene::SetupViewPort(int w, int h) {
@@ -72,51 +100,106 @@ void Scene::SetupViewPort(int w, int h) {
   gesture_camera_->SetAspectRatio(static_cast<float>(w) /
                                   static_cast<float>(h));
   glViewport(0, 0, w, h);
+  viewport_height_ = h;
+}
+
+void Scene::SetMaxPointCloudElements(int max_point_cloud_elements) {
+  point_cloud_->SetMaxPointCount(max_point_cloud_elements);
+}
+
+void Scene::SetPointCloudPointSize(float point_size) {
+  point_cloud_->SetPointSize(point_size);
+}
+
+void Scene::SetPointBudget(int point_budget) {
+  point_cloud_->SetPointBudget(point_budget);
+  point_cloud_map_->SetPointBudget(point_budget);
+}
+
+void Scene::SetColorCameraIntrinsics(const TangoCameraIntrinsics& intrinsics) {
+  point_cloud_->SetColorCameraIntrinsics(intrinsics);
+}
+
+void Scene::SetColorImage(GLuint texture_id,
+                          const glm::mat4& color_camera_T_depth_camera) {
+  point_cloud_->SetColorImage(texture_id, color_camera_T_depth_camera);
 }
 
 void Scene::Render(const glm::mat4& cur_pose_transformation,
                    const glm::mat4& point_cloud_transformation,
-                   const std::vector<float>& point_cloud_vertices) {
-  glEnable(GL_DEPTH_TEST);
-  glEnable(GL_CULL_FACE);
+                   const TangoXYZij* point_cloud, bool new_points,
+                   const glm::mat4& map_transformation,
+                   tango_util::PointCloudMap* map) {
+  // Apply the touch input received since the previous frame.
+  gesture_camera_->Update();
+  gpu_profiler_.BeginFrame();
+  tango_gl::GlState::Enable(GL_DEPTH_TEST);
+  tango_gl::GlState::Enable(GL_CULL_FACE);
 
   glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
   glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+  // Cleared to the same color, and drawn flat where it is not supported.
+  const bool is_shaded =
+      is_eye_dome_lighting_enabled_ &&
+      eye_dome_lighting_.Begin(gesture_camera_->GetProjectionMatrix());
 
   glm::vec3 position =
       glm::vec3(cur_pose_transformation[3][0], cur_pose_transformation[3][1],
                 cur_pose_transformation[3][2]);
 
-  if (gesture_camera_->GetCameraType() ==
-      tango_gl::GestureCamera::CameraType::kFirstPerson) {
-    // In first person mode, we directly control camera's motion.
-    gesture_camera_->SetTransformationMatrix(cur_pose_transformation);
-  } else {
-    // In third person or top down more, we follow the camera movement.
-    gesture_camera_->SetAnchorPosition(position);
-
-    frustum_->SetTransformationMatrix(cur_pose_transformation);
-    // Set the frustum scale to 4:3, this doesn't necessarily match the physical
-    // camera's aspect ratio, this is just for visualization purposes.
-    frustum_->SetScale(kFrustumScale);
-    frustum_->Render(gesture_camera_->GetProjectionMatrix(),
-                     gesture_camera_->GetViewMatrix());
-
-    axis_->SetTransformationMatrix(cur_pose_transformation);
-    axis_->Render(gesture_camera_->GetProjectionMatrix(),
-                  gesture_camera_->GetViewMatrix());
+  {
+    tango_gl::GpuProfiler::ScopedPass pass(&gpu_profiler_, kMeshPass);
+    if (gesture_camera_->GetCameraType() ==
+        tango_gl::GestureCamera::CameraType::kFirstPerson) {
+      // In first person mode, we directly control camera's motion.
+      gesture_camera_->SetTransformationMatrix(cur_pose_transformation);
+    } else {
+      // In third person or top down more, we follow the camera movement.
+      gesture_camera_->SetAnchorPosition(position);
+
+      frustum_->SetTransformationMatrix(cur_pose_transformation);
+      // Set the frustum scale to 4:3, this doesn't necessarily match the
+      // physical camera's aspect ratio, this is just for visualization
+      // purposes.
+      frustum_->SetScale(kFrustumScale);
+      frustum_->Render(gesture_camera_->GetProjectionMatrix(),
+                       gesture_camera_->GetViewMatrix());
+
+      axis_->SetTransformationMatrix(cur_pose_transformation);
+      axis_->Render(gesture_camera_->GetProjectionMatrix(),
+                    gesture_camera_->GetViewMatrix());
+    }
+
+    trace_->UpdateVertexArray(&trace_positions_);
+    trace_->Render(gesture_camera_->GetProjectionMatrix(),
+                   gesture_camera_->GetViewMatrix());
+
+    static_objects_.Render(gesture_camera_->GetProjectionMatrix(),
+                           gesture_camera_->GetViewMatrix());
   }
 
-  trace_->UpdateVertexArray(position);
-  trace_->Render(gesture_camera_->GetProjectionMatrix(),
-                 gesture_camera_->GetViewMatrix());
+  if (map != nullptr) {
+    tango_gl::GpuProfiler::ScopedPass pass(&gpu_profiler_, kPointCloudPass);
+    point_cloud_map_->Render(gesture_camera_->GetProjectionMatrix(),
+                             gesture_camera_->GetViewMatrix(),
+                             map_transformation, viewport_height_, map);
+  } else if (point_cloud != nullptr) {
+    tango_gl::GpuProfiler::ScopedPass pass(&gpu_profiler_, kPointCloudPass);
+    point_cloud_->Render(gesture_camera_->GetProjectionMatrix(),
+                         gesture_camera_->GetViewMatrix(),
+                         point_cloud_transformation, viewport_height_,
+                         point_cloud, new_points);
+  }
 
-  grid_->Render(gesture_camera_->GetProjectionMatrix(),
-                gesture_camera_->GetViewMatrix());
+  if (is_shaded) {
+    tango_gl::GpuProfiler::ScopedPass pass(&gpu_profiler_,
+                                           kEyeDomeLightingPass);
+    eye_dome_lighting_.End();
+  }
 
-  point_cloud_->Render(gesture_camera_->GetProjectionMatrix(),
-                       gesture_camera_->GetViewMatrix(),
-                       point_cloud_transformation, point_cloud_vertices);
+  if (is_gpu_profiler_hud_visible_) {
+    gpu_profiler_hud_->Render();
+  }
 }
 
 void Scene::SetCameraType(tango_gl::GestureCamera::CameraType camera_type) {
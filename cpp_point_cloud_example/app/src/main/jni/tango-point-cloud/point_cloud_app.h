@@ -18,11 +18,33 @@
 #define TANGO_POINT_CLOUD_POINT_CLOUD_APP_H_
 
 #include <jni.h>
+#include <atomic>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <tango_client_api.h>  // NOLINT
+#include <tango_support_api.h>
+#include <tango-gl/profiled_mutex.h>
 #include <tango-gl/util.h>
+#include <tango-util/callback_dispatcher.h>
+#include <tango-util/depth_segmenter.h>
+#include <tango-util/extrinsics_cache.h>
+#include <tango-util/frame_pipeline.h>
+#include <tango-util/intrinsics_registry.h>
+#include <tango-util/model_aligner.h>
+#include <tango-util/network_streamer.h>
+#include <tango-util/performance_hint.h>
+#include <tango-util/ply_exporter.h>
+#include <tango-util/point_cloud_buffer.h>
+#include <tango-util/point_cloud_map.h>
+#include <tango-util/quality_governor.h>
+#include <tango-util/shared_sensor_publisher.h>
+#include <tango-util/telemetry_block.h>
+#include <tango-util/thread_policy.h>
+#include <tango-util/voxel_grid_filter.h>
 
 #include <tango-point-cloud/point_cloud_data.h>
 #include <tango-point-cloud/pose_data.h>
@@ -76,6 +98,8 @@ class PointCloudApp {
   // Tango service pose callback function for pose data. Called when new
   // information about device pose is available from the Tango Service.
   //
+  // The pose is queued for the dispatcher thread, so this returns right away.
+  //
   // @param pose: The current pose returned by the service, caller allocated.
   void onPoseAvailable(const TangoPoseData* pose);
 
@@ -91,17 +115,117 @@ class PointCloudApp {
   // Release all non-OpenGL allocated resources.
   void DeleteResources();
 
-  // Return total point count in the current depth frame.
-  int GetPointCloudVerticesCount();
+  // @return: a direct ByteBuffer over the debug telemetry, which the app
+  //          keeps up to date for the activity to poll, see Telemetry.
+  jobject NewTelemetryBuffer(JNIEnv* env) {
+    return telemetry_.NewDirectByteBuffer(env);
+  }
+
+  // Acquire the latest point cloud for Java to read in place, e.g. for
+  // analytics, instead of copying it across JNI. The cloud is held in a pool
+  // the depth callback copies the clouds into, so it stays valid, and is not
+  // written over, until the next acquire or ReleaseJavaPointCloud(). Reading
+  // the buffer after that is undefined.
+  //
+  // @return: a direct ByteBuffer over the x, y, z floats of the points, in
+  //          the native order and of the capacity of the largest cloud, of
+  //          which only GetJavaPointCount() are set. nullptr until the first
+  //          cloud after the first call, which starts the copies.
+  jobject AcquireJavaPointCloud(JNIEnv* env);
+  void ReleaseJavaPointCloud();
 
-  // Return the average depth of points in the current depth frame.
-  float GetAverageZ();
+  // @return: the point count and the timestamp of the cloud Java holds, 0 if
+  //          none.
+  int GetJavaPointCount();
+  double GetJavaPointCloudTimestamp();
   // Set render camera's viewing angle, first person, third person or top down.
   //
   // @param: camera_type, camera type includes first person, third person and
   //         top down
   void SetCameraType(tango_gl::GestureCamera::CameraType camera_type);
 
+  // Show the GPU time of the render passes over the frame.
+  void SetGpuProfilerHudVisible(bool visible);
+
+  // Color the points of the point cloud frames by the color camera image,
+  // streamed into a texture and projected onto them on the GPU, rather than
+  // by depth. The image is only streamed while this is on.
+  void SetColorizedPointCloud(bool colorize) { is_colorized_.store(colorize); }
+
+  // Shade the points by eye-dome lighting. As the shading carries the shape of
+  // the surfaces, the point budget of the quality level is cut while it is on.
+  void SetEyeDomeLighting(bool enabled) {
+    is_eye_dome_lighting_.store(enabled);
+  }
+
+  // Accumulate the point clouds into a map of the start of service frame, and
+  // render the map instead of the latest point cloud. Turning accumulation
+  // off frees the map, turning it on again starts a new one.
+  void SetAccumulationMode(bool accumulate);
+
+  // Page the parts of the map away from the camera out to a scratch file, so
+  // that a map larger than its memory budget is kept whole. Takes effect for
+  // the next map.
+  //
+  // @param path: path of the file, on the app storage, empty to drop the
+  //        parts evicted instead.
+  void SetMapTileFile(const char* path);
+
+  // Write the map as a PLY file on a background thread while accumulating,
+  // or else the latest point cloud, both in the start of service frame. The
+  // export starts on the next frame, and the map stops accumulating until it
+  // is written.
+  //
+  // @param path: path of the file to write.
+  void ExportPointCloud(const char* path);
+
+  // Stream the poses and point clouds over UDP to a desktop viewer, see
+  // tango_util::NetworkStreamer. The bandwidth and latency of the stream are
+  // part of the telemetry.
+  //
+  // @param host: name or address of the viewer, resolved before returning.
+  // @param port: UDP port of the viewer.
+  //
+  // @return: false if the host could not be resolved.
+  bool StartStreaming(const char* host, int port);
+  void StopStreaming();
+
+  // Publish the poses and point clouds into shared memory for a service of
+  // another process, see tango_util::SharedSensorPublisher.
+  //
+  // @return: the fd of the memory, to pass to the service, -1 on failure.
+  int StartSharedSensorPublishing();
+  void StopSharedSensorPublishing();
+
+  // Load a model, e.g. a CAD model, to align to the map. Parses and samples
+  // the file before returning.
+  //
+  // @param path: path of a Wavefront OBJ file.
+  //
+  // @return: false if the file could not be loaded.
+  bool LoadAlignmentModel(const char* path);
+
+  // Start the alignment from the similarity transformation taking points of
+  // the model closest to points of the start of service frame, e.g. tapped.
+  //
+  // @param model_points: xyz of |count| points in the model frame.
+  // @param world_points: xyz of the |count| corresponding points.
+  //
+  // @return: false if the pairs give no transformation, at least three
+  //          non-collinear ones are needed.
+  bool SetModelCorrespondences(const float* model_points,
+                               const float* world_points, int count);
+
+  // Refine the alignment by ICP against the map, on a thread of the aligner,
+  // from the next frame on. Only while accumulating.
+  void AlignModelToMap();
+
+  // @param world_T_model: set to the column major transformation of the model
+  //        into the start of service frame, the latest of the ICP iterations.
+  //
+  // @return: false if the model is not aligned yet.
+  bool GetModelAlignment(float world_T_model[16]);
+
   // Touch event passed from android activity. This function only supports two
   // touches.
   //
@@ -115,18 +239,58 @@ class PointCloudApp {
                     float x0, float y0, float x1, float y1);
 
  private:
-  // Get a pose in matrix format with extrinsics in OpenGl space.
+  // What the dispatcher thread needs to know of a point cloud frame.
+  struct PointCloudInfo {
+    double timestamp;
+    int xyz_count;
+  };
+
+  // A point cloud frame and the results of its processing by
+  // depth_pipeline_.
+  struct DepthFrame {
+    // Copy of the points of the callback, which point_cloud points to.
+    std::vector<float> xyz;
+    TangoXYZij point_cloud;
+    // Mean depth of the raw points.
+    float average_depth;
+    // Objects in the raw points, see tango_util::DepthSegmenter.
+    int32_t segment_count;
+    // The points downsampled for rendering, which filtered_point_cloud points
+    // to.
+    std::vector<float> filtered_xyz;
+    TangoXYZij filtered_point_cloud;
+  };
+
+  // Stages of depth_pipeline_.
+  void FilterDepthFrame(DepthFrame* frame);
+  int32_t CountSegments(const TangoXYZij& point_cloud);
+
+  // Handlers of the callback data, run on the dispatcher thread.
+  void HandlePointCloud(const PointCloudInfo& info);
+  void HandlePose(const TangoPoseData& pose);
+
+  // Write the cores the stages of tango_util::ThreadPolicy run on.
+  static void WriteThreadTelemetry(Telemetry* telemetry);
+
+  // Update the color texture, connecting it to the color camera first if
+  // needed, and get the depth camera at the point cloud timestamp with
+  // respect to the color camera at the image timestamp. Called on the render
+  // thread.
   //
-  // @param: timstamp, timestamp of the target pose.
+  // @param: start_service_T_device, the device at the point cloud timestamp.
+  // @param: color_camera_T_depth_camera, set to the transformation.
   //
-  // @return: pose in matrix format.
-  glm::mat4 GetPoseMatrixAtTimestamp(double timstamp);
+  // @return: the color texture, 0 if there is no image or pose for it.
+  GLuint UpdateColorImage(const glm::mat4& start_service_T_device,
+                          glm::mat4* color_camera_T_depth_camera);
 
-  // Query sensor/camera extrinsic from the Tango Service, the extrinsic is only
-  // available after the service is connected.
+  // Get a pose in matrix format with extrinsics in OpenGl space.
+  //
+  // @param: timstamp, timestamp of the target pose.
+  // @param: is_valid, set to whether a valid pose was found.
   //
-  // @return: error code.
-  TangoErrorType UpdateExtrinsics();
+  // @return: pose in matrix format, the identity if it is not valid.
+  glm::mat4 GetPoseMatrixAtTimestamp(double timstamp, bool* is_valid);
 
   // point_cloud_ contains the data of current depth frame, it also
   // has the render function to render the points. This instance will be passed
@@ -136,18 +300,115 @@ class PointCloudApp {
   // internally inside the PointCloud class.
   PointCloudData point_cloud_data_;
 
+  // Debug information of point_cloud_data_, written by the dispatcher and
+  // render threads and read by the activity without calling into native code.
+  tango_util::TelemetryBlock<Telemetry> telemetry_;
+
+  // Maximum number of points in a point cloud frame, queried from the Tango
+  // config. Protected by point_cloud_mutex_.
+  int max_point_cloud_elements_;
+  // The intrinsics of the depth camera, once queried, to lay out the point
+  // clouds for the segmentation. Protected by point_cloud_mutex_.
+  TangoCameraIntrinsics depth_camera_intrinsics_;
+  bool has_depth_camera_intrinsics_;
+
   // Mutex for protecting the point cloud data. The point cloud data is shared
   // between render thread and TangoService callback thread.
-  std::mutex point_cloud_mutex_;
+  tango_gl::ProfiledMutex point_cloud_mutex_{
+      "PointCloudApp::point_cloud_mutex_"};
+
+  // The point clouds of the callback for Java, once Java asked for one, and
+  // the cloud it holds, see AcquireJavaPointCloud(). The direct ByteBuffer
+  // of each slot of the pool is a global reference made the first time the
+  // slot is acquired. The reader, the cloud and the buffers are protected by
+  // java_point_cloud_mutex_, for any Java thread to call.
+  tango_util::PointCloudBuffer java_point_clouds_;
+  std::atomic<bool> is_java_point_cloud_requested_;
+  std::mutex java_point_cloud_mutex_;
+  tango_util::PointCloudBuffer::Reader java_point_cloud_reader_;
+  const TangoXYZij* java_point_cloud_;
+  std::vector<std::pair<const float*, jobject>> java_point_cloud_buffers_;
+
+  // Downsamples the point clouds for rendering, in the "filter" stage of
+  // depth_pipeline_.
+  tango_util::VoxelGridFilter voxel_filter_;
+  // Splits the point clouds into objects, in the "segmentation" stage.
+  tango_util::DepthSegmenter depth_segmenter_;
+
+  // The render, depth pipeline and dispatcher threads report their work to
+  // these, declared before the pipeline, the governor and the dispatcher so
+  // that they outlive them.
+  tango_util::PerformanceHintSession render_hint_session_;
+  tango_util::PerformanceHintSession depth_hint_session_;
+  tango_util::PerformanceHintSession callback_hint_session_;
+
+  // Processes the point clouds of the callback, the statistics and the
+  // filter running at once, while the render thread draws the previous one.
+  // The frames are reused, so no point cloud is allocated after the first
+  // few.
+  tango_util::FramePipeline<DepthFrame> depth_pipeline_;
+
+  // Accumulated map of the depth frames, only used on the render thread, and
+  // only allocated while is_accumulating_ is set.
+  std::atomic<bool> is_accumulating_;
+  std::unique_ptr<tango_util::PointCloudMap> point_cloud_map_;
+  // Set by SetMapTileFile(), protected by map_tile_file_mutex_.
+  std::string map_tile_file_;
+  std::mutex map_tile_file_mutex_;
+
+  // Set by ExportPointCloud(), started on the render thread. Declared after
+  // the map so that the export in progress is done before the map is freed.
+  std::string export_path_;
+  std::mutex export_mutex_;
+  tango_util::PlyExporter exporter_;
+
+  // Aligns the model of LoadAlignmentModel(). The initial alignment is
+  // protected by alignment_mutex_, and is_alignment_requested_ is handled on
+  // the render thread where the map is.
+  tango_util::ModelAligner aligner_;
+  glm::mat4 initial_world_T_model_;
+  bool has_initial_alignment_;
+  std::mutex alignment_mutex_;
+  std::atomic<bool> is_alignment_requested_;
+
+  // Fed by the Tango callbacks, streaming only between StartStreaming() and
+  // StopStreaming().
+  tango_util::NetworkStreamer streamer_;
+  // Fed by the Tango callbacks too, between StartSharedSensorPublishing()
+  // and StopSharedSensorPublishing().
+  tango_util::SharedSensorPublisher sensor_publisher_;
+
+  // Picks the point budget of the point cloud and map from the frame time.
+  tango_util::QualityGovernor quality_governor_;
+
+  // Sensor extrinsics, queried once the service is connected.
+  tango_util::ExtrinsicsCache extrinsics_;
+
+  // Color camera intrinsics, queried once the service is connected.
+  tango_util::IntrinsicsRegistry intrinsics_;
+
+  // Incremented by every TangoConnect(), so that the render thread connects
+  // the color texture again to a new connection. 0 before the first one.
+  std::atomic<int> connection_id_;
+
+  // Set by SetColorizedPointCloud() and SetEyeDomeLighting().
+  std::atomic<bool> is_colorized_;
+  std::atomic<bool> is_eye_dome_lighting_;
+
+  // The GL_TEXTURE_EXTERNAL_OES texture of the color camera, created on the
+  // render thread when the point cloud is first colorized, the connection
+  // it was connected to, whether that succeeded, and whether the intrinsics
+  // were given to the scene.
+  GLuint color_texture_id_;
+  int color_texture_connection_id_;
+  bool is_color_texture_connected_;
+  bool has_color_intrinsics_;
 
   // pose_data_ handles all pose onPoseAvailable callbacks, onPoseAvailable()
-  // in this object will be routed to pose_data_ to handle.
+  // in this object will be routed to pose_data_ to handle. Shared between the
+  // render thread and the TangoService callback thread without a lock.
   PoseData pose_data_;
 
-  // Mutex for protecting the pose data. The pose data is shared between render
-  // thread and TangoService callback thread.
-  std::mutex pose_mutex_;
-
   // main_scene_ includes all drawable object for visualizing Tango device's
   // movement and point cloud.
   Scene main_scene_;
@@ -156,6 +417,17 @@ class PointCloudApp {
   // before connect to service. For example, we turn on the depth sensing in
   // this example.
   TangoConfig tango_config_;
+
+  // The Tango callbacks only post to these queues, their data is handled on
+  // the thread of dispatcher_, so a slow handler or a contended mutex never
+  // holds up the service. Only the latest data matters to this app, so full
+  // queues drop their oldest items.
+  tango_util::DispatchQueue<PointCloudInfo> point_cloud_queue_;
+  tango_util::DispatchQueue<TangoPoseData> pose_queue_;
+
+  // Declared last so that its thread is stopped before the rest of the app is
+  // destroyed.
+  tango_util::CallbackDispatcher dispatcher_;
 };
 }  // namespace tango_point_cloud
 
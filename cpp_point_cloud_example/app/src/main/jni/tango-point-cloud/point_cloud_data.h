@@ -18,33 +18,27 @@
 #define TANGO_POINT_CLOUD_POINT_CLOUD_DATA_H_
 
 #include <jni.h>
-#include <vector>
 
 #include <tango_client_api.h>  // NOLINT
 #include <tango-gl/util.h>
 
+#include "tango-point-cloud/telemetry.h"
+
 namespace tango_point_cloud {
 
-// PointCloudData is a holder for all point cloud related data. That includes
-// the current frame of the point cloud, and some other debug data.
+// PointCloudData is a holder for the debug data of the point cloud frames.
+// The points themselves are kept in the frames of the app's depth pipeline.
 class PointCloudData {
  public:
   PointCloudData() {}
   ~PointCloudData() {}
 
-  // @return total point count in the current depth frame.
-  int GetPointCloudVerticesCount();
-
-  // @return the average depth (in meters) of current depth frame.
-  float GetAverageDepth();
-
   // Set average depth value.
   // @param average_depth: average depth of the current depth frame.
   void SetAverageDepth(float average_depth);
 
-  // @return the delta time (in milliseconds) between the current depth frame
-  // and the previous depth frame.
-  float GetDepthFrameDeltaTime();
+  // Copy the point count, average depth and frame delta time to |telemetry|.
+  void WriteTelemetry(Telemetry* telemetry) const;
 
   // Return the current depth frame's timstamp. The timestamp is used for
   // querying the depth frame's pose using the TangoService_getPoseAtTime
@@ -53,23 +47,14 @@ class PointCloudData {
   // @return current depth frame's timstamp.
   double GetCurrentTimstamp();
 
-  // @return the vector of the vertices.
-  const std::vector<float>& GetVerticeVector() { return vertices_; }
-
-  // Update current point cloud data.
+  // Update the debug data with a new point cloud frame. The points are not
+  // needed, so this can run after the frame was released to the service.
   //
-  // @param point_cloud: point cloud data of the current frame.
-  void UpdatePointCloud(const TangoXYZij* point_cloud);
+  // @param timestamp: timestamp of the current frame.
+  // @param vertices_count: point count of the current frame.
+  void UpdatePointCloud(double timestamp, int vertices_count);
 
  private:
-  // A vector list of packed coordinate triplets, x,y,z as floating point
-  // values With the unit in landscape orientation, screen facing the user:
-  // +Z points in the direction of the camera's optical axis, and is measured
-  // perpendicular to the plane of the camera.
-  // +X points toward the user's right, and +Y points toward the bottom of
-  // the screen.
-  std::vector<float> vertices_;
-
   // Timestamp of current depth frame.
   double cur_frame_timstamp_;
 
@@ -18,8 +18,11 @@
 #define TANGO_POINT_CLOUD_POINT_CLOUD_DRAWABLE_H_
 
 #include <jni.h>
-#include <vector>
 
+#include <tango_client_api.h>  // NOLINT
+#include <tango-gl/point_level_of_detail.h>
+#include <tango-gl/quantized_points.h>
+#include <tango-gl/streaming_vertex_buffer.h>
 #include <tango-gl/util.h>
 
 namespace tango_point_cloud {
@@ -32,27 +35,119 @@ class PointCloudDrawable {
   // Free all GL Resources, i.e, shaders, buffers.
   void DeleteGlResources();
 
+  // Set the maximum number of points a single point cloud frame can hold.
+  // The vertex buffer is allocated at this capacity on the next Render() so it
+  // never has to grow while streaming.
+  //
+  // @param max_point_count: max_point_cloud_elements of the Tango config.
+  void SetMaxPointCount(int max_point_count) {
+    max_point_count_ = max_point_count;
+  }
+
+  // Set the most points drawn per frame, 0 for all of them, and the size of
+  // a point in meters when they all are. See tango_gl::PointLevelOfDetail.
+  void SetPointBudget(int point_budget) {
+    level_of_detail_.SetPointBudget(point_budget);
+  }
+  void SetPointSize(float point_size) {
+    level_of_detail_.SetPointSize(point_size);
+  }
+
+  // Set the intrinsics of the color camera the points are colorized with.
+  void SetColorCameraIntrinsics(const TangoCameraIntrinsics& intrinsics);
+
+  // Color the points of the next Render() by the pixel of the color image
+  // they project to, rather than by depth. The image is sampled from the
+  // texture on the GPU, so the CPU never touches its pixels.
+  //
+  // @param texture_id: the GL_TEXTURE_EXTERNAL_OES texture the color camera
+  //        is connected to, or 0 to color the points by depth.
+  // @param color_camera_T_depth_camera: the depth camera at the timestamp of
+  //        the point cloud with respect to the color camera at the timestamp
+  //        of the image in the texture.
+  void SetColorImage(GLuint texture_id,
+                     const glm::mat4& color_camera_T_depth_camera) {
+    color_texture_id_ = texture_id;
+    color_camera_T_depth_camera_ = color_camera_T_depth_camera;
+  }
+
   // Update current point cloud data.
   //
   // @param projection_mat: projection matrix from current render camera.
   // @param view_mat: view matrix from current render camera.
   // @param model_mat: model matrix for this point cloud frame.
-  // @param vertices: all vertices in this point cloud frame.
+  // @param viewport_height: height of the viewport in pixels.
+  // @param point_cloud: the point cloud frame to render.
+  // @param new_points: whether point_cloud changed since the previous call.
+  //                    The vertex buffer is only uploaded when it did.
   void Render(glm::mat4 projection_mat, glm::mat4 view_mat, glm::mat4 model_mat,
-              const std::vector<float>& vertices);
+              int viewport_height, const TangoXYZij* point_cloud,
+              bool new_points);
+
+  // @return the statistics of the last point cloud uploaded by Render(),
+  //         which colors the points by depth between its percentiles.
+  const tango_gl::PointCloudStatistics& GetStatistics() const {
+    return quantized_points_.GetStatistics();
+  }
 
  private:
-  // Vertex buffer of the point cloud geometry.
-  GLuint vertex_buffers_;
+  // Vertex buffer of the point cloud geometry, streamed every frame.
+  tango_gl::StreamingVertexBuffer vertex_buffer_;
+
+  // The last point cloud uploaded, quantized to 16 bits and shuffled.
+  tango_gl::QuantizedPoints quantized_points_;
+
+  // Fits the points drawn to the point budget.
+  tango_gl::PointLevelOfDetail level_of_detail_;
+
+  // Capacity in points the vertex buffer is reserved for.
+  int max_point_count_;
+
+  // A program to display the point cloud and its handles.
+  struct Program {
+    Program();
+
+    // Get the program of |vertex_shader| and |fragment_shader|, and the
+    // handles of its uniforms and attribute.
+    //
+    // @return false if the program could not be created.
+    bool Initialize(const char* vertex_shader, const char* fragment_shader);
+
+    GLuint id;
+
+    // Handle to vertex attribute value in the shader.
+    GLuint vertices_handle;
+
+    // Handle to the model view projection matrix uniform in the shader.
+    GLuint mvp_handle;
+
+    // Handles to the dequantization uniforms in the shader.
+    GLint point_scale_handle;
+    GLint point_offset_handle;
+
+    // Handle to the depth range of the colormap in the shader.
+    GLint depth_range_handle;
+
+    // Handle to the point size uniform of the level of detail in the shader.
+    GLint point_size_scale_handle;
+
+    // Handles to the color camera uniforms of the colorized program, -1 in
+    // the other.
+    GLint color_T_depth_handle;
+    GLint color_intrinsics_handle;
+    GLint color_texture_handle;
+  };
 
-  // Shader to display point cloud.
-  GLuint shader_program_;
+  // Programs coloring the points by depth, and by the color image.
+  Program depth_program_;
+  Program colorized_program_;
 
-  // Handle to vertex attribute value in the shader.
-  GLuint vertices_handle_;
+  // The color image of the next Render(), none if 0.
+  GLuint color_texture_id_;
+  glm::mat4 color_camera_T_depth_camera_;
 
-  // Handle to the model view projection matrix uniform in the shader.
-  GLuint mvp_handle_;
+  // fx / width, fy / height, cx / width and cy / height of the color camera.
+  glm::vec4 color_intrinsics_;
 };
 }  // namespace tango_point_cloud
 
@@ -0,0 +1,87 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_POINT_CLOUD_POINT_CLOUD_MAP_DRAWABLE_H_
+#define TANGO_POINT_CLOUD_POINT_CLOUD_MAP_DRAWABLE_H_
+
+#include <vector>
+
+#include <tango-gl/point_level_of_detail.h>
+#include <tango-gl/util.h>
+#include <tango-util/point_cloud_map.h>
+
+namespace tango_point_cloud {
+
+// PointCloudMapDrawable renders the occupied voxels of a PointCloudMap.
+//
+// The vertex buffer mirrors the block slots of the map, one voxel per
+// vertex, so every frame only the slots changed since the previous frame are
+// uploaded. Voxels observed too few times are moved out of the view volume
+// by the vertex shader.
+//
+// The voxels are drawn through an index buffer that visits every block in
+// the shuffled order of tango_gl::PointLevelOfDetail, so a point budget
+// draws the same share of every block.
+class PointCloudMapDrawable {
+ public:
+  PointCloudMapDrawable();
+  ~PointCloudMapDrawable();
+  PointCloudMapDrawable(const PointCloudMapDrawable& other) = delete;
+  PointCloudMapDrawable& operator=(const PointCloudMapDrawable&) = delete;
+
+  // Free all GL Resources, i.e, shaders, buffers.
+  void DeleteGlResources();
+
+  // Set the most voxels drawn per frame, 0 for all of them.
+  void SetPointBudget(int point_budget) {
+    level_of_detail_.SetPointBudget(point_budget);
+  }
+
+  // Upload the changed slots of |map| and render it.
+  //
+  // @param projection_mat: projection matrix from current render camera.
+  // @param view_mat: view matrix from current render camera.
+  // @param model_mat: transformation from the start of service frame.
+  // @param viewport_height: height of the viewport in pixels.
+  // @param map: the map to render, whose changed slots are taken.
+  void Render(const glm::mat4& projection_mat, const glm::mat4& view_mat,
+              const glm::mat4& model_mat, int viewport_height,
+              tango_util::PointCloudMap* map);
+
+ private:
+  // Create the index buffer of a chunk of slots, the same for every chunk.
+  void CreateIndexBuffer();
+
+  GLuint vertex_buffer_;
+  GLuint index_buffer_;
+  // The map the vertex buffer mirrors, every slot of another map is
+  // uploaded.
+  const tango_util::PointCloudMap* uploaded_map_;
+  uint32_t slot_count_;
+  // Chunks of slots in the vertex buffer, the last one padded.
+  uint32_t chunk_count_;
+  std::vector<uint32_t> changed_slots_;
+  tango_gl::PointLevelOfDetail level_of_detail_;
+
+  GLuint shader_program_;
+  GLuint vertices_handle_;
+  GLuint mvp_handle_;
+  GLuint min_weight_handle_;
+  GLint point_size_scale_handle_;
+};
+}  // namespace tango_point_cloud
+
+#endif  // TANGO_POINT_CLOUD_POINT_CLOUD_MAP_DRAWABLE_H_
@@ -18,16 +18,18 @@
 #define TANGO_POINT_CLOUD_POSE_DATA_H_
 
 #include <jni.h>
-#include <mutex>
 #include <string>
 
 #include <tango_client_api.h>  // NOLINT
 #include <tango-gl/util.h>
+#include <tango-util/latest.h>
 
 namespace tango_point_cloud {
 
 // PoseData holds all pose related data. E.g. pose position, rotation and time-
-// stamp. It also produce the debug information strings.
+// stamp. It also produce the debug information strings. The latest pose is
+// written by the service callback thread and read by the render thread
+// without a lock.
 class PoseData {
  public:
   PoseData();
@@ -43,24 +45,6 @@ class PoseData {
   // @return: latest pose in matrix format.
   glm::mat4 GetLatestPoseMatrix();
 
-  // @return: device frame with respect to IMU frame matrix.
-  glm::mat4 GetImuTDevice() { return imu_T_device_; }
-
-  // Set device frame with respect to IMU frame matrix.
-  // @param: imu_T_device, imu_T_device_ matrix.
-  void SetImuTDevice(const glm::mat4& imu_T_device) {
-    imu_T_device_ = imu_T_device;
-  }
-
-  // @return: depth camera frame with respect to IMU frame.
-  glm::mat4 GetImuTDepthCamera() { return imu_T_depth_camera_; }
-
-  // Set depth camera frame with respect to IMU frame matrix.
-  // @param: imu_T_color_camera, imu_T_color_camera_ matrix.
-  void SetImuTDepthCamera(const glm::mat4& imu_T_depth_camera) {
-    imu_T_depth_camera_ = imu_T_depth_camera;
-  }
-
   // Get pose transformation in OpenGL coordinate system. This function also
   // applies sensor extrinsics transformation to the current pose.
   //
@@ -69,10 +53,6 @@ class PoseData {
   // @return: corresponding matrix of the pose data.
   glm::mat4 GetMatrixFromPose(const TangoPoseData& pose);
 
-  // Apply extrinsics and coordinate frame transformations to the matrix.
-  // This funciton will transform the passed in matrix into opengl world frame.
-  glm::mat4 GetExtrinsicsAppliedOpenGLWorldFrame(const glm::mat4 pose_matrix);
-
  private:
   // Convert TangoPoseStatusType to string.
   //
@@ -84,14 +64,8 @@ class PoseData {
   // Format the pose debug string based on current pose and previous pose data.
   void FormatPoseString();
 
-  // Device frame with respect to IMU frame.
-  glm::mat4 imu_T_device_;
-
-  // Color camera frame with respect to IMU frame.
-  glm::mat4 imu_T_depth_camera_;
-
   // Pose data of current frame.
-  TangoPoseData cur_pose_;
+  tango_util::Latest<TangoPoseData> cur_pose_;
 };
 }  // namespace tango_point_cloud
 
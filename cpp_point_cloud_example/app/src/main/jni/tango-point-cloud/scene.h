@@ -19,13 +19,16 @@
 
 #include <jni.h>
 #include <memory>
-#include <vector>
 
 #include <tango_client_api.h>  // NOLINT
 #include <tango-gl/axis.h>
+#include <tango-gl/bounding_volume_hierarchy.h>
 #include <tango-gl/camera.h>
 #include <tango-gl/color.h>
+#include <tango-gl/eye_dome_lighting.h>
 #include <tango-gl/gesture_camera.h>
+#include <tango-gl/gpu_profiler.h>
+#include <tango-gl/gpu_profiler_hud.h>
 #include <tango-gl/grid.h>
 #include <tango-gl/frustum.h>
 #include <tango-gl/trace.h>
@@ -33,6 +36,7 @@
 #include <tango-gl/util.h>
 
 #include <tango-point-cloud/point_cloud_drawable.h>
+#include <tango-point-cloud/point_cloud_map_drawable.h>
 #include <tango-point-cloud/pose_data.h>
 
 namespace tango_point_cloud {
@@ -53,15 +57,49 @@ class Scene {
   // Setup GL view port.
   void SetupViewPort(int w, int h);
 
+  // Set the maximum number of points in a point cloud frame, used to size the
+  // point cloud vertex buffer once.
+  void SetMaxPointCloudElements(int max_point_cloud_elements);
+
+  // Set the size in meters of the points of the point cloud frames, e.g. the
+  // leaf size they are downsampled with.
+  void SetPointCloudPointSize(float point_size);
+
+  // Set the most points of the point cloud or map drawn per frame, 0 for all
+  // of them.
+  void SetPointBudget(int point_budget);
+
+  // Set the intrinsics of the color camera the point cloud is colorized with.
+  void SetColorCameraIntrinsics(const TangoCameraIntrinsics& intrinsics);
+
+  // Colorize the point cloud frame of the next Render() with the color image
+  // in |texture_id|, or color it by depth if 0. The map is always colored by
+  // depth. See PointCloudDrawable::SetColorImage().
+  void SetColorImage(GLuint texture_id,
+                     const glm::mat4& color_camera_T_depth_camera);
+
+  // Append the position of the device to the trace, in the OpenGL world. Can
+  // be called on any thread, e.g. for every pose of the service, so that the
+  // trace does not depend on the frame rate.
+  void AppendTracePosition(const glm::vec3& position) {
+    trace_positions_.Append(position);
+  }
+
   // Render loop.
   // @param: cur_pose_transformation, latest pose's transformation.
   // @param: point_cloud_transformation, pose transformation at point cloud
   //         frame's timestamp.
-  // @param: point_cloud_vertices, point cloud's vertices of the current point
-  //         frame.
+  // @param: point_cloud, the current point cloud frame, nullptr if no frame
+  //         has been received yet.
+  // @param: new_points, whether point_cloud changed since the previous frame.
+  // @param: map_transformation, transformation of the start of service frame.
+  // @param: map, the accumulated point cloud map, rendered instead of
+  //         point_cloud unless nullptr.
   void Render(const glm::mat4& cur_pose_transformation,
               const glm::mat4& point_cloud_transformation,
-              const std::vector<float>& point_cloud_vertices);
+              const TangoXYZij* point_cloud, bool new_points,
+              const glm::mat4& map_transformation,
+              tango_util::PointCloudMap* map);
 
   // Set render camera's viewing angle, first person, third person or top down.
   //
@@ -81,7 +119,24 @@ class Scene {
   void OnTouchEvent(int touch_count, tango_gl::GestureCamera::TouchEvent event,
                     float x0, float y0, float x1, float y1);
 
+  // Show the GPU time of the mesh and point cloud passes over the frame.
+  void SetGpuProfilerHudVisible(bool visible) {
+    is_gpu_profiler_hud_visible_ = visible;
+  }
+
+  // Shade the scene by eye-dome lighting, see tango_gl::EyeDomeLighting, so
+  // that the point cloud reads in relief rather than flat.
+  void SetEyeDomeLightingEnabled(bool enabled) {
+    is_eye_dome_lighting_enabled_ = enabled;
+  }
+
  private:
+  // Passes timed by gpu_profiler_, in the order they are added.
+  enum GpuPass { kMeshPass, kPointCloudPass, kEyeDomeLightingPass };
+
+  // Height of the viewport in pixels, which the points are sized for.
+  int viewport_height_;
+
   // Camera object that allows user to use touch input to interact with.
   tango_gl::GestureCamera* gesture_camera_;
 
@@ -94,11 +149,30 @@ class Scene {
   // Ground grid.
   tango_gl::Grid* grid_;
 
-  // Trace of pose data.
+  // Objects that do not move, drawn only when they are in view.
+  tango_gl::BoundingVolumeHierarchy static_objects_;
+
+  // Trace of pose data, drawn from the positions appended to
+  // trace_positions_ at the rate of the poses.
   tango_gl::Trace* trace_;
+  tango_gl::SharedTrajectory trace_positions_;
 
   // Point cloud drawale object.
   PointCloudDrawable* point_cloud_;
+
+  // Drawable of the accumulated point cloud map.
+  PointCloudMapDrawable* point_cloud_map_;
+
+  // Screen-space shading of the meshes and points, one full-screen pass
+  // whatever the number of points.
+  tango_gl::EyeDomeLighting eye_dome_lighting_;
+  bool is_eye_dome_lighting_enabled_;
+
+  // GPU time of the render passes, shown by gpu_profiler_hud_ when
+  // is_gpu_profiler_hud_visible_ is set.
+  tango_gl::GpuProfiler gpu_profiler_;
+  tango_gl::GpuProfilerHud* gpu_profiler_hud_;
+  bool is_gpu_profiler_hud_visible_;
 };
 }  // namespace tango_point_cloud
 
@@ -0,0 +1,54 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_POINT_CLOUD_TELEMETRY_H_
+#define TANGO_POINT_CLOUD_TELEMETRY_H_
+
+#include <cstdint>
+
+#include <tango-util/thread_policy.h>
+
+namespace tango_point_cloud {
+
+// The debug information the activity shows, shared with it through a
+// tango_util::TelemetryBlock. PointcloudActivity.java mirrors the layout as
+// offsets, which must be updated along with it.
+struct Telemetry {
+  // Point count of the current depth frame, the average depth of its points
+  // in meters, and the time since the previous frame in milliseconds.
+  int32_t point_count;
+  float average_depth;
+  float frame_delta_time;
+
+  // The stream to a desktop viewer, of the last one started: its bandwidth
+  // in KB/s and latency in milliseconds over the last second, and the records
+  // and datagrams it dropped.
+  float stream_bandwidth;
+  float stream_latency;
+  int32_t stream_dropped_count;
+
+  // The CPU the threads of each tango_util::ThreadPolicy::Stage last ran
+  // on, -1 for a stage that did not run, and the fraction of the frames the
+  // render thread ran on a big core.
+  int32_t stage_cpus[tango_util::ThreadPolicy::kStageCount];
+  float render_big_core_ratio;
+
+  // Objects in the current depth frame, see tango_util::DepthSegmenter.
+  int32_t segment_count;
+};
+}  // namespace tango_point_cloud
+
+#endif  // TANGO_POINT_CLOUD_TELEMETRY_H_
@@ -22,6 +22,8 @@ import android.util.Log;
 
 import com.projecttango.examples.cpp.util.TangoInitializationHelper;
 
+import java.nio.ByteBuffer;
+
 /**
  * Interfaces between native C++ code and Java code.
  */
@@ -60,8 +62,25 @@ public class JNIInterface {
   // Use bilateral filtering to upsample point cloud.
   public static native void setUpsampleViaBilateralFiltering(boolean bilateral);
 
-  // Get the distance between the two selected points.
-  public static native String getPointSeparation();
+  // Find the taps in a depth image splatted on the GPU instead, see
+  // PointToPointApplication::SetUpsampleViaGpuDepth(). Must be called on the
+  // GL thread.
+  public static native void setUpsampleViaGpuDepth(boolean gpu);
+
+  // Measure a polyline of screen points live instead of the segment between
+  // the last two taps, see PointToPointApplication::SetLiveMeasurement(). Must
+  // be called on the GL thread.
+  public static native void setLiveMeasurement(boolean live);
+
+  // Snap the measured points to the 3D edges near them, see
+  // PointToPointApplication::SetEdgeSnapping(). Must be called on the GL
+  // thread.
+  public static native void setEdgeSnapping(boolean snap);
+
+  // Get the buffer the application keeps the distance between the two selected
+  // points, or the lengths of the live polyline, in. See TelemetryBuffer, and
+  // tango-point-to-point/telemetry.h for its layout.
+  public static native ByteBuffer getTelemetryBuffer();
 
   // Setup the view port width and height.
   public static native void setViewPort(int width, int height);
@@ -72,6 +91,30 @@ public class JNIInterface {
   // Release resources that are allocated.
   public static native void deleteResources();
 
-  // Respond to a touch event.
-  public static native void onTouchEvent(float x, float y);
+  // Pass the touch samples of a frame, handled at the start of the next
+  // render(). See TouchBatch for the layout of |samples|.
+  public static native void onTouchEvents(float[] samples, int sampleCount);
+
+  // Record the poses, point clouds and optionally the raw color images of the
+  // session into a session log at path, see tango-util/session_log.h, until
+  // stopRecording() or the service is disconnected.
+  //
+  // @return false if the log could not be created.
+  public static native boolean startRecording(String path,
+                                              boolean recordImages);
+
+  public static native void stopRecording();
+
+  // Start recording where the native code spends its time, see
+  // tango-gl/tracing.h.
+  public static native void startTracing();
+
+  // Stop recording, the recorded time slices are kept for dumpTrace().
+  public static native void stopTracing();
+
+  // Write the recorded time slices as a Chrome trace JSON file, e.g. under
+  // getExternalFilesDir(null) to pull it from the sdcard.
+  //
+  // @return false if the file could not be written.
+  public static native boolean dumpTrace(String path);
 }
@@ -33,6 +33,8 @@ import android.widget.TextView;
 import android.widget.Toast;
 
 import com.projecttango.examples.cpp.util.TangoInitializationHelper;
+import com.projecttango.examples.cpp.util.TelemetryBuffer;
+import com.projecttango.examples.cpp.util.TouchBatch;
 
 /**
  * Primary activity of the example.
@@ -51,15 +53,36 @@ public class MainActivity extends Activity {
   // service for pose and event information.
   private static final int UPDATE_UI_INTERVAL_MS = 10;
 
+  // Offsets of the fields of the native Telemetry struct, see
+  // tango-point-to-point/telemetry.h.
+  private static final int SEGMENT_COUNT_OFFSET = 0;
+  private static final int TOTAL_LENGTH_OFFSET = 4;
+  private static final int SEGMENT_LENGTHS_OFFSET = 8;
+  private static final int MAX_SEGMENTS = 32;
+
   // GLSurfaceView and renderer, all of the graphic content is rendered
   // through OpenGL ES 2.0 in native code.
   private GLSurfaceView mGLView;
   private GLSurfaceRenderer mRenderer;
+
+  // The taps of the UI thread, handed to the native code by the renderer.
+  private final TouchBatch mTouchBatch = new TouchBatch();
   // Current frame's pose information.
   private TextView mDistanceMeasure;
 
+  // The measurement shared by the native code, and the text formatted from it
+  // when it changes.
+  private TelemetryBuffer mTelemetry;
+  private int mShownSequence = -1;
+  private float[] mSegmentLengths = new float[MAX_SEGMENTS];
+  private StringBuilder mDistanceText = new StringBuilder();
+
   private CheckBox mBilateralBox;
   private boolean mBilateralFiltering;
+  private CheckBox mGpuDepthBox;
+
+  private CheckBox mLiveBox;
+  private CheckBox mSnapBox;
 
   // Handles the debug text UI update loop.
   private Handler mHandler = new Handler();
@@ -103,29 +126,31 @@ public class MainActivity extends Activity {
 
     // Text views for Tango library versions
     mDistanceMeasure = (TextView) findViewById(R.id.distance_textview);
+    mTelemetry = new TelemetryBuffer(JNIInterface.getTelemetryBuffer());
 
     configureGlSurfaceView();
     configureFilteringOption();
+    configureLiveOption();
+    configureSnapOption();
   }
 
   @Override
   public boolean onTouchEvent(final MotionEvent event) {
     if (event.getAction() == MotionEvent.ACTION_DOWN) {
-      // Ensure that handling of the touch event is run on the GL thread
-      // rather than Android UI thread. This ensures we can modify
-      // rendering state without locking.  This event triggers a plane
-      // fit.
-      mGLView.queueEvent(new Runnable() {
-          @Override
-          public void run() {
-            JNIInterface.onTouchEvent(event.getX(), event.getY());
-          }
-        });
+      // The renderer hands the taps of a frame to the native code at once,
+      // on the GL thread, so it can modify rendering state without locking.
+      mTouchBatch.add(1, MotionEvent.ACTION_DOWN, event.getX(), event.getY(),
+                      0.0f, 0.0f);
     }
 
     return super.onTouchEvent(event);
   }
 
+  // @return the taps for the renderer to hand over every frame.
+  public TouchBatch getTouchBatch() {
+    return mTouchBatch;
+  }
+
   private void configureGlSurfaceView() {
     // OpenGL view where all of the graphics are drawn.
     mGLView = (GLSurfaceView) findViewById(R.id.gl_surface_view);
@@ -144,12 +169,64 @@ public class MainActivity extends Activity {
           // Is the view now checked?
           mBilateralFiltering = ((CheckBox) view).isChecked();
           if (mBilateralFiltering) {
+            mGpuDepthBox.setChecked(false);
             JNIInterface.setUpsampleViaBilateralFiltering(true);
           } else {
             JNIInterface.setUpsampleViaBilateralFiltering(false);
           }
         }
       });
+    // The two methods exclude each other.
+    mGpuDepthBox = (CheckBox) findViewById(R.id.gpu_depth_check_box);
+    mGpuDepthBox.setOnClickListener(new OnClickListener() {
+        @Override
+        public void onClick(View view) {
+          final boolean gpu = ((CheckBox) view).isChecked();
+          if (gpu) {
+            mBilateralBox.setChecked(false);
+            mBilateralFiltering = false;
+          }
+          mGLView.queueEvent(new Runnable() {
+              @Override
+              public void run() {
+                JNIInterface.setUpsampleViaGpuDepth(gpu);
+              }
+            });
+        }
+      });
+  }
+
+  private void configureLiveOption() {
+    mLiveBox = (CheckBox) findViewById(R.id.live_check_box);
+    mLiveBox.setOnClickListener(new OnClickListener() {
+        @Override
+        public void onClick(View view) {
+          final boolean live = ((CheckBox) view).isChecked();
+          // The measurement is GL thread state, like the touch events.
+          mGLView.queueEvent(new Runnable() {
+              @Override
+              public void run() {
+                JNIInterface.setLiveMeasurement(live);
+              }
+            });
+        }
+      });
+  }
+
+  private void configureSnapOption() {
+    mSnapBox = (CheckBox) findViewById(R.id.snap_check_box);
+    mSnapBox.setOnClickListener(new OnClickListener() {
+        @Override
+        public void onClick(View view) {
+          final boolean snap = ((CheckBox) view).isChecked();
+          mGLView.queueEvent(new Runnable() {
+              @Override
+              public void run() {
+                JNIInterface.setEdgeSnapping(snap);
+              }
+            });
+        }
+      });
   }
 
   @Override
@@ -187,10 +264,42 @@ public class MainActivity extends Activity {
       }
     };
 
-  // Update the debug text UI.
+  // Update the debug text UI when the measurement changed.
   private void updateUi() {
     try {
-      mDistanceMeasure.setText(JNIInterface.getPointSeparation());
+      int sequence;
+      int segmentCount;
+      float totalLength;
+      do {
+        sequence = mTelemetry.beginRead();
+        if (sequence == mShownSequence) {
+          return;
+        }
+        segmentCount = mTelemetry.getInt(SEGMENT_COUNT_OFFSET);
+        totalLength = mTelemetry.getFloat(TOTAL_LENGTH_OFFSET);
+        for (int i = 0; i < Math.min(segmentCount, MAX_SEGMENTS); ++i) {
+          mSegmentLengths[i] = mTelemetry.getFloat(SEGMENT_LENGTHS_OFFSET + 4 * i);
+        }
+      } while (!mTelemetry.endRead(sequence));
+      mShownSequence = sequence;
+
+      mDistanceText.setLength(0);
+      if (segmentCount == 0) {
+        mDistanceText.append("Undefined");
+      } else if (segmentCount == 1) {
+        TelemetryBuffer.appendFixed3(mDistanceText, totalLength);
+        mDistanceText.append(" meters");
+      } else {
+        for (int i = 0; i < Math.min(segmentCount, MAX_SEGMENTS); ++i) {
+          mDistanceText.append(i + 1).append(": ");
+          TelemetryBuffer.appendFixed3(mDistanceText, mSegmentLengths[i]);
+          mDistanceText.append(" meters\n");
+        }
+        mDistanceText.append("Total: ");
+        TelemetryBuffer.appendFixed3(mDistanceText, totalLength);
+        mDistanceText.append(" meters");
+      }
+      mDistanceMeasure.setText(mDistanceText);
     } catch (Exception e) {
       e.printStackTrace();
       Log.e(TAG, "Exception updating UI elements");
@@ -15,6 +15,8 @@
  */
 
 #include <jni.h>
+#include <tango-gl/profiled_mutex.h>
+#include <tango-gl/tracing.h>
 
 #include "tango-point-to-point/point_to_point_application.h"
 
@@ -60,10 +62,28 @@ Java_com_projecttango_examples_cpp_pointtopoint_JNIInterface_setUpsampleViaBilat
   app.SetUpsampleViaBilateralFiltering(on);
 }
 
-JNIEXPORT jstring JNICALL
-Java_com_projecttango_examples_cpp_pointtopoint_JNIInterface_getPointSeparation(
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_pointtopoint_JNIInterface_setUpsampleViaGpuDepth(
+    JNIEnv* /*env*/, jobject /*obj*/, jboolean on) {
+  app.SetUpsampleViaGpuDepth(on);
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_pointtopoint_JNIInterface_setLiveMeasurement(
+    JNIEnv* /*env*/, jobject /*obj*/, jboolean on) {
+  app.SetLiveMeasurement(on);
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_pointtopoint_JNIInterface_setEdgeSnapping(
+    JNIEnv* /*env*/, jobject /*obj*/, jboolean on) {
+  app.SetEdgeSnapping(on);
+}
+
+JNIEXPORT jobject JNICALL
+Java_com_projecttango_examples_cpp_pointtopoint_JNIInterface_getTelemetryBuffer(
     JNIEnv* env, jobject) {
-  return (env)->NewStringUTF(app.GetPointSeparation().c_str());
+  return app.NewTelemetryBuffer(env);
 }
 
 JNIEXPORT void JNICALL
@@ -85,9 +105,51 @@ Java_com_projecttango_examples_cpp_pointtopoint_JNIInterface_deleteResources(
 }
 
 JNIEXPORT void JNICALL
-Java_com_projecttango_examples_cpp_pointtopoint_JNIInterface_onTouchEvent(
-    JNIEnv* /*env*/, jobject /*obj*/, jfloat x, jfloat y) {
-  app.OnTouchEvent(x, y);
+Java_com_projecttango_examples_cpp_pointtopoint_JNIInterface_onTouchEvents(
+    JNIEnv* env, jobject /*obj*/, jfloatArray samples, jint sample_count) {
+  jfloat* values = env->GetFloatArrayElements(samples, nullptr);
+  if (values == nullptr) {
+    return;
+  }
+  app.OnTouchEvents(values, sample_count);
+  env->ReleaseFloatArrayElements(samples, values, JNI_ABORT);
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_projecttango_examples_cpp_pointtopoint_JNIInterface_startRecording(
+    JNIEnv* env, jobject, jstring path, jboolean record_images) {
+  const char* path_chars = env->GetStringUTFChars(path, nullptr);
+  const bool started = app.StartRecording(path_chars, record_images);
+  env->ReleaseStringUTFChars(path, path_chars);
+  return started;
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_pointtopoint_JNIInterface_stopRecording(
+    JNIEnv*, jobject) {
+  app.StopRecording();
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_pointtopoint_JNIInterface_startTracing(
+    JNIEnv*, jobject) {
+  tango_gl::tracing::Start();
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_pointtopoint_JNIInterface_stopTracing(
+    JNIEnv*, jobject) {
+  tango_gl::tracing::Stop();
+  tango_gl::tracing::LogLockStatistics();
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_projecttango_examples_cpp_pointtopoint_JNIInterface_dumpTrace(
+    JNIEnv* env, jobject, jstring path) {
+  const char* path_chars = env->GetStringUTFChars(path, nullptr);
+  const bool dumped = tango_gl::tracing::DumpChromeTrace(path_chars);
+  env->ReleaseStringUTFChars(path, path_chars);
+  return dumped;
 }
 
 #ifdef __cplusplus
@@ -16,13 +16,16 @@
 
 #include "tango-point-to-point/point_to_point_application.h"
 
+#include <algorithm>
 #include <cmath>
-#include <sstream>
+#include <cstdio>
 
 #include <glm/gtc/matrix_access.hpp>
 #include <glm/gtx/quaternion.hpp>
 #include <tango-gl/camera.h>
 #include <tango-gl/conversions.h>
+#include <tango-gl/gl_state.h>
+#include <tango-gl/tracing.h>
 #include <tango-gl/util.h>
 
 namespace tango_point_to_point {
@@ -31,6 +34,60 @@ namespace {
 
 constexpr float kCubeScale = 0.05f;
 
+// Most points of the live polyline.
+constexpr size_t kMaxLiveAnchors = 32;
+
+// Edge size in pixels of the cells of the color image sharing the edges
+// searched near any of their pixels.
+constexpr int kEdgeCellSize = 16;
+
+// Farthest a point snaps to an edge from, in meters.
+constexpr float kSnapDistance = 0.05f;
+
+// Longest a tap waits for the edges near it, in seconds.
+constexpr double kMaxSnapWait = 0.2;
+
+// Texels of the edge map searched around a point on each side, about the
+// snap distance at a meter with the downscales of the depth image and of its
+// edge map.
+constexpr int kEdgeMapSearchRadius = 6;
+
+// Edges not searched again for this long, in seconds of point cloud time, are
+// forgotten.
+constexpr double kEdgeCacheLifetime = 1.0;
+
+// Rows of the color image copied above and below the pixels edges are
+// searched near, beyond what the search looks at.
+constexpr int kImageRowMargin = 64;
+
+// An image older than the point cloud an edge search runs on by more than
+// this is copied again, in seconds.
+constexpr double kMaxImageAge = 0.1;
+
+// A request per live anchor, and one for a tap.
+constexpr size_t kEdgeRequestQueueCapacity = kMaxLiveAnchors + 1;
+
+// The GL thread and the edge search.
+constexpr int kPointCloudReaderCount = 2;
+
+// Work budget of a frame on the render thread, in milliseconds.
+constexpr double kFrameBudget = 12.0;
+
+// Height of the length labels, in pixels.
+constexpr int kLabelPixelSize = 40;
+
+// The GPU depth image is this many times smaller than the color image, with
+// splats wide enough for a point cloud to cover it.
+constexpr int kDepthProbeDownscale = 2;
+constexpr float kDepthProbePointSize = 3.0f;
+
+// Query id of a tap in the GPU depth image, those of the live anchors being
+// their index.
+constexpr int kTapQueryId = -1;
+
+// Three frames of queries of the live anchors, or of a tap.
+constexpr int kMaxDepthQueries = 3 * static_cast<int>(kMaxLiveAnchors + 1);
+
 /**
  * This function will route callbacks to our application object via the context
  * parameter.
@@ -58,34 +115,118 @@ void OnFrameAvailableRouter(void* context, TangoCameraId,
   app->OnFrameAvailable(buffer);
 }
 
+/**
+ * This function will route pose callbacks to our application object via the
+ * context parameter.
+ *
+ * @param context Will be a pointer to a PointToPointApplication instance on
+ * which to call callbacks.
+ * @param pose The pose to pass on.
+ */
+void OnPoseAvailableRouter(void* context, const TangoPoseData* pose) {
+  PointToPointApplication* app = static_cast<PointToPointApplication*>(context);
+  app->OnPoseAvailable(pose);
+}
+
+// @return the point of |segment| closest to |point|.
+glm::vec3 ClosestPointOnSegment(const tango_gl::Segment& segment,
+                                const glm::vec3& point) {
+  const glm::vec3 direction = segment.end - segment.start;
+  const float length_squared = glm::dot(direction, direction);
+  if (length_squared == 0.0f) {
+    return segment.start;
+  }
+  const float t = glm::clamp(
+      glm::dot(point - segment.start, direction) / length_squared, 0.0f, 1.0f);
+  return segment.start + t * direction;
+}
+
+// The frame pair of the device poses looked up while rendering.
+TangoCoordinateFramePair StartServiceTDeviceFramePair() {
+  TangoCoordinateFramePair frame_pair;
+  frame_pair.base = TANGO_COORDINATE_FRAME_START_OF_SERVICE;
+  frame_pair.target = TANGO_COORDINATE_FRAME_DEVICE;
+  return frame_pair;
+}
+
 }  // namespace
 
 void PointToPointApplication::OnXYZijAvailable(const TangoXYZij* xyz_ij) {
-  TangoSupport_updatePointCloud(point_cloud_manager_, xyz_ij);
-  TangoSupport_getLatestPointCloud(point_cloud_manager_, &front_cloud_);
+  TANGO_TRACE_SCOPE("PointToPointApplication::OnXYZijAvailable");
+  session_recorder_.OnXYZijAvailable(xyz_ij);
+  point_cloud_buffer_.Update(xyz_ij);
+}
+
+void PointToPointApplication::OnPoseAvailable(const TangoPoseData* pose) {
+  TANGO_TRACE_SCOPE("PointToPointApplication::OnPoseAvailable");
+  session_recorder_.OnPoseAvailable(pose);
+  pose_history_.OnPoseAvailable(pose);
 }
 
 void PointToPointApplication::OnFrameAvailable(const TangoImageBuffer* buffer) {
+  TANGO_TRACE_SCOPE("PointToPointApplication::OnFrameAvailable");
+  session_recorder_.OnFrameAvailable(buffer);
+  {
+    // The image is only copied when an edge search asks for one, and only
+    // the rows it looks at, a band of the image instead of the whole frame.
+    std::lock_guard<tango_gl::ProfiledMutex> lock(image_rows_mutex_);
+    if (!is_image_requested_) {
+      return;
+    }
+    is_image_requested_ = false;
+    if ((requested_image_rows_.begin != copied_image_rows_.begin ||
+         requested_image_rows_.end != copied_image_rows_.end) &&
+        TangoSupport_setImageBufferCopyRegion(
+            image_buffer_manager_, 0, requested_image_rows_.begin,
+            requested_image_rows_.end) == TANGO_SUCCESS) {
+      copied_image_rows_ = requested_image_rows_;
+      copied_image_rows_timestamp_ = buffer->timestamp;
+    }
+  }
   TangoSupport_updateImageBuffer(image_buffer_manager_, buffer);
-  TangoSupport_getLatestImageBuffer(image_buffer_manager_, &image_buffer_);
 }
 
 PointToPointApplication::PointToPointApplication()
     : last_gpu_timestamp_(0.0),
-      opengl_world_T_start_service_(
-          tango_gl::conversions::opengl_world_T_tango_world()),
+      max_point_cloud_elements_(0),
+      pose_history_(StartServiceTDeviceFramePair()),
+      render_cloud_reader_(&point_cloud_buffer_),
+      front_cloud_(nullptr),
+      copied_image_rows_timestamp_(0.0),
+      image_rows_request_timestamp_(0.0),
+      is_image_requested_(true),
+      depth_cache_(tango_util::ProjectedDepthCache::Options()),
       tap_number_(0),
+      algorithm_(UpsampleAlgorithm::kNearest),
+      depth_probe_(kMaxDepthQueries),
+      depth_probe_timestamp_(0.0),
+      has_pending_depth_tap_(false),
+      is_edge_map_posed_(false),
       point_modifier_flag_(true),
       point1_(glm::vec3(0.0, 0.0, 0.0)),
       point2_(glm::vec3(0.0, 0.0, 0.0)),
-      segment_is_drawable_(false) {}
+      segment_is_drawable_(false),
+      live_measurement_(false),
+      polyline_(nullptr),
+      length_labels_(nullptr),
+      quality_governor_(tango_util::QualityGovernor::DefaultLevels(),
+                        kFrameBudget),
+      edge_snapping_(false),
+      edge_cloud_reader_(&point_cloud_buffer_),
+      has_pending_tap_(false),
+      pending_tap_timestamp_(0.0),
+      touch_queue_(tango_util::TouchQueue::Options()),
+      edge_request_queue_(
+          "edge request", kEdgeRequestQueueCapacity,
+          tango_util::DispatchQueueBase::kDropOldest,
+          [this](const EdgeRequest& request) { HandleEdgeRequest(request); }) {
+  dispatcher_.AddQueue(&edge_request_queue_);
+}
 
 PointToPointApplication::~PointToPointApplication() {
+  // Stop searching edges before the point clouds and images are freed.
+  dispatcher_.Stop();
   TangoConfig_free(tango_config_);
-  TangoSupport_freePointCloudManager(point_cloud_manager_);
-  point_cloud_manager_ = nullptr;
-  TangoSupport_freeDepthInterpolator(interpolator_);
-  interpolator_ = nullptr;
   TangoSupport_freeImageBufferManager(image_buffer_manager_);
   image_buffer_manager_ = nullptr;
 }
@@ -119,10 +260,10 @@ int PointToPointApplication::TangoSetupAndConnect() {
 
   TangoErrorType ret;
   /**
-   * The point_cloud_manager_ contains the depth buffer data and allows
+   * The point_cloud_buffer_ contains the depth buffer data and allows
    * reading and writing of data in a thread safe way.
    */
-  if (point_cloud_manager_ == nullptr) {
+  if (!point_cloud_buffer_.IsInitialized()) {
     int32_t max_point_cloud_elements;
     ret = TangoConfig_getInt32(tango_config_, "max_point_cloud_elements",
                                &max_point_cloud_elements);
@@ -133,11 +274,10 @@ int PointToPointApplication::TangoSetupAndConnect() {
       return ret;
     }
 
-    ret = TangoSupport_createPointCloudManager(max_point_cloud_elements,
-                                               &point_cloud_manager_);
-    if (ret != TANGO_SUCCESS) {
-      return ret;
-    }
+    max_point_cloud_elements_ = max_point_cloud_elements;
+    // Read by the GL thread and by the edge search.
+    point_cloud_buffer_.Initialize(kPointCloudReaderCount,
+                                   max_point_cloud_elements);
   }
 
   // Here, we will configure the service to run in the way we would want. For
@@ -176,6 +316,16 @@ int PointToPointApplication::TangoSetupAndConnect() {
     return ret;
   }
 
+  // Register for device poses, so that rendering can look them up without a
+  // round-trip to the service.
+  TangoCoordinateFramePair pose_frame_pair = pose_history_.GetFramePair();
+  ret = TangoService_connectOnPoseAvailable(1, &pose_frame_pair,
+                                            OnPoseAvailableRouter);
+  if (ret != TANGO_SUCCESS) {
+    LOGE("Failed to connected to pose callback.");
+    return ret;
+  }
+
   // Here, we will connect to the TangoService and set up to run. Note that
   // we are passing in a pointer to ourselves as the context which will be
   // passed back in our callbacks.
@@ -188,9 +338,10 @@ int PointToPointApplication::TangoSetupAndConnect() {
   // Get the intrinsics for the color camera and pass them on to the depth
   // image. We need these to know how to project the point cloud into the color
   // camera frame.
-  ret = TangoService_getCameraIntrinsics(TANGO_CAMERA_COLOR,
-                                         &color_camera_intrinsics_);
-  if (ret != TANGO_SUCCESS) {
+  ret = intrinsics_.Update(TANGO_CAMERA_COLOR);
+  if (ret != TANGO_SUCCESS ||
+      !intrinsics_.GetIntrinsics(TANGO_CAMERA_COLOR,
+                                 &color_camera_intrinsics_)) {
     LOGE(
         "PointToPointApplication: Failed to get the intrinsics for the color"
         "camera.");
@@ -217,33 +368,69 @@ int PointToPointApplication::TangoSetupAndConnect() {
       LOGE("PointToPointApplication: Failed to create image buffer manager");
       return ret;
     }
+    // The whole image is copied until an edge search asks for fewer rows.
+    std::lock_guard<tango_gl::ProfiledMutex> lock(image_rows_mutex_);
+    requested_image_rows_.begin = 0;
+    requested_image_rows_.end = color_camera_intrinsics_.height - 1;
+    copied_image_rows_ = requested_image_rows_;
+    copied_image_rows_timestamp_ = 0.0;
+    image_rows_request_timestamp_ = 0.0;
+    is_image_requested_ = true;
   }
 
 
-  /**
-   * The interpolator_ contains camera intrinsics and references to data buffers
-   * allowing for effective upsampling of the depth data to camera image
-   * resolution.
-   */
-  ret = TangoSupport_createDepthInterpolator(&color_camera_intrinsics_,
-                                             &interpolator_);
+  // The depth cache projects the point clouds into the color camera, so it
+  // needs the intrinsics and the extrinsics of both cameras.
+  depth_cache_.SetIntrinsics(color_camera_intrinsics_);
+  depth_probe_.SetCamera(
+      color_camera_intrinsics_.width / kDepthProbeDownscale,
+      color_camera_intrinsics_.height / kDepthProbeDownscale,
+      color_camera_intrinsics_.fx / kDepthProbeDownscale,
+      color_camera_intrinsics_.fy / kDepthProbeDownscale,
+      color_camera_intrinsics_.cx / kDepthProbeDownscale,
+      color_camera_intrinsics_.cy / kDepthProbeDownscale);
+  depth_probe_.SetPointSize(kDepthProbePointSize);
+  ret = extrinsics_.Update();
   if (ret != TANGO_SUCCESS) {
-    LOGE("PointToPointApplication: Failed to set up interpolator.");
+    LOGE("PointToPointApplication: Failed to get the device extrinsics.");
+    return ret;
   }
 
+  // The edge search needs the intrinsics and the extrinsics, so it only
+  // starts once they are known.
+  dispatcher_.Start();
+
   constexpr float kNearPlane = 0.1;
   constexpr float kFarPlane = 100.0;
 
-  projection_matrix_ar_ = tango_gl::Camera::ProjectionMatrixForCameraIntrinsics(
-      color_camera_intrinsics_.width, color_camera_intrinsics_.height,
-      color_camera_intrinsics_.fx, color_camera_intrinsics_.fy,
-      color_camera_intrinsics_.cx, color_camera_intrinsics_.cy, kNearPlane,
-      kFarPlane);
+  tango_util::IntrinsicsRegistry::Projection projection;
+  if (intrinsics_.GetProjection(TANGO_CAMERA_COLOR, kNearPlane, kFarPlane,
+                                &projection)) {
+    projection_matrix_ar_ = projection.matrix;
+  }
 
   return ret;
 }
 
-void PointToPointApplication::TangoDisconnect() { TangoService_disconnect(); }
+void PointToPointApplication::TangoDisconnect() {
+  TangoService_disconnect();
+  // No callback comes after the service is disconnected.
+  session_recorder_.Stop();
+  dispatcher_.Stop();
+}
+
+bool PointToPointApplication::StartRecording(const char* path,
+                                             bool record_images) {
+  tango_util::SessionRecorder::Options options;
+  options.max_point_count = max_point_cloud_elements_;
+  options.record_images = record_images;
+  // The color images are NV21, with a stride of the image width.
+  options.max_image_size =
+      color_camera_intrinsics_.width * color_camera_intrinsics_.height * 3 / 2;
+  return session_recorder_.Start(path, options);
+}
+
+void PointToPointApplication::StopRecording() { session_recorder_.Stop(); }
 
 int PointToPointApplication::InitializeGLContent() {
   video_overlay_ = new tango_gl::VideoOverlay();
@@ -251,8 +438,22 @@ int PointToPointApplication::InitializeGLContent() {
 
   segment_->SetLineWidth(4.0);
   segment_->SetColor(1.0, 1.0, 1.0);
+  polyline_ = new tango_gl::Line(4.0f, GL_LINE_STRIP);
+  polyline_->SetShader();
+  polyline_->SetColor(1.0, 1.0, 1.0);
+  polyline_->UpdateLineVertices(live_polyline_);
+  length_labels_ = new tango_gl::TextRenderer();
+  length_labels_->LoadSystemFont(kLabelPixelSize);
+  // The framebuffer of a previous context died with it.
+  overlay_target_.InvalidateGlResources();
   tap_number_ = 0;
   segment_is_drawable_ = false;
+  // The GL objects of the probe went with the previous context, and the
+  // point cloud is uploaded again.
+  depth_probe_.InvalidateGlResources();
+  depth_probe_timestamp_ = 0.0;
+  has_pending_depth_tap_ = false;
+  is_edge_map_posed_ = false;
   int ret;
 
   // The Tango service allows you to connect an OpenGL texture directly to its
@@ -277,6 +478,31 @@ void PointToPointApplication::SetUpsampleViaBilateralFiltering(bool on) {
   algorithm_ = UpsampleAlgorithm::kNearest;
 }
 
+void PointToPointApplication::SetUpsampleViaGpuDepth(bool on) {
+  algorithm_ = on ? UpsampleAlgorithm::kGpuDepth : UpsampleAlgorithm::kNearest;
+  has_pending_depth_tap_ = false;
+}
+
+void PointToPointApplication::SetLiveMeasurement(bool on) {
+  live_measurement_ = on;
+  live_anchors_.clear();
+  live_polyline_.clear();
+  if (polyline_ != nullptr) {
+    polyline_->UpdateLineVertices(live_polyline_);
+  }
+  tap_number_ = 0;
+  point_modifier_flag_ = true;
+  segment_is_drawable_ = false;
+  has_pending_tap_ = false;
+  has_pending_depth_tap_ = false;
+  PublishMeasurement(live_polyline_);
+}
+
+void PointToPointApplication::SetEdgeSnapping(bool on) {
+  edge_snapping_ = on;
+  has_pending_tap_ = false;
+}
+
 void PointToPointApplication::SetViewPort(int width, int height) {
   screen_width_ = static_cast<GLsizei>(width);
   screen_height_ = static_cast<GLsizei>(height);
@@ -285,20 +511,32 @@ void PointToPointApplication::SetViewPort(int width, int height) {
 }
 
 void PointToPointApplication::Render() {
+  TANGO_TRACE_SCOPE("PointToPointApplication::Render");
+  quality_governor_.BeginFrame();
+  // The taps since the previous frame, seen on the image it shows.
+  touch_queue_.Take(&touch_samples_);
+  for (const tango_util::TouchSample& sample : touch_samples_) {
+    if (sample.event == tango_gl::GestureCamera::kTouch0Down) {
+      OnTouchEvent(sample.x0, sample.y0);
+    }
+  }
   // Update the texture associated with the color image.
-  if (TangoService_updateTexture(TANGO_CAMERA_COLOR, &last_gpu_timestamp_) !=
-      TANGO_SUCCESS) {
+  TangoErrorType status;
+  {
+    TANGO_TRACE_SCOPE("TangoService_updateTexture");
+    status =
+        TangoService_updateTexture(TANGO_CAMERA_COLOR, &last_gpu_timestamp_);
+  }
+  if (status != TANGO_SUCCESS) {
     LOGE("PointToPointApplication: Failed to get a color image.");
+    quality_governor_.EndFrame();
     return;
   }
 
   // Querying the device frame transformation based on color GPU timestamp.
   TangoPoseData pose_start_service_T_device_t1;
-  TangoCoordinateFramePair color_gpu_frame_pair;
-  color_gpu_frame_pair.base = TANGO_COORDINATE_FRAME_START_OF_SERVICE;
-  color_gpu_frame_pair.target = TANGO_COORDINATE_FRAME_DEVICE;
-  if (TangoService_getPoseAtTime(last_gpu_timestamp_, color_gpu_frame_pair,
-                                 &pose_start_service_T_device_t1) !=
+  if (pose_history_.GetPoseAtTime(last_gpu_timestamp_,
+                                  &pose_start_service_T_device_t1) !=
       TANGO_SUCCESS) {
     LOGE(
         "PointToPointApplication: Could not find a valid pose at time %lf"
@@ -307,6 +545,24 @@ void PointToPointApplication::Render() {
   }
 
   if (pose_start_service_T_device_t1.status_code == TANGO_POSE_VALID) {
+    ReadScreenPointQueries();
+    if (live_measurement_) {
+      UpdateLiveMeasurement();
+    } else if (has_pending_tap_) {
+      // The tap is measured once the edges near it are found, or without
+      // them if the search takes too long.
+      ScreenPoint snapped = pending_tap_;
+      if (SnapToEdge(&snapped) ||
+          last_gpu_timestamp_ - pending_tap_timestamp_ > kMaxSnapWait) {
+        has_pending_tap_ = false;
+        UpdateSegment(snapped.world_position);
+      }
+    }
+    if (edge_snapping_ && algorithm_ == UpsampleAlgorithm::kGpuDepth &&
+        UpdateDepthProbe()) {
+      // Read back for the snapping of the next frames.
+      depth_probe_.QueryEdgeMap();
+    }
     GLRender(pose_start_service_T_device_t1);
   } else {
     LOGE(
@@ -314,21 +570,29 @@ void PointToPointApplication::Render() {
         "%lf",
         last_gpu_timestamp_);
   }
+  quality_governor_.EndFrame();
 }
 
 void PointToPointApplication::GLRender(
     const TangoPoseData& pose_start_service_T_device) {
-  glEnable(GL_CULL_FACE);
+  tango_gl::GlState::Enable(GL_CULL_FACE);
 
   glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
   glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
-  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  tango_gl::GlState::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-  glDisable(GL_DEPTH_TEST);
-  glEnable(GL_BLEND);
-  video_overlay_->Render(glm::mat4(1.0), glm::mat4(1.0));
-  glEnable(GL_DEPTH_TEST);
-  glDisable(GL_BLEND);
+  // Drawn directly, the opaque content goes first and the camera image behind
+  // it, which is then only sampled where nothing covers it. Drawn into the
+  // overlay target, the content is blended over the camera image.
+  overlay_target_.SetScale(quality_governor_.GetLevel().render_scale);
+  const bool is_video_behind = overlay_target_.GetScale() >= 1.0f;
+  if (!is_video_behind) {
+    tango_gl::GlState::Disable(GL_DEPTH_TEST);
+    tango_gl::GlState::Disable(GL_BLEND);
+    video_overlay_->Render(glm::mat4(1.0), glm::mat4(1.0));
+  }
+  tango_gl::GlState::Enable(GL_DEPTH_TEST);
+  tango_gl::GlState::Disable(GL_BLEND);
 
   TangoPoseData pose_opengl_world_T_opengl_camera;
   TangoErrorType ret = TangoSupport_getPoseInEngineFrame(
@@ -345,107 +609,513 @@ void PointToPointApplication::GLRender(
       glm::inverse(tango_gl::conversions::TransformFromArrays(
           pose_opengl_world_T_opengl_camera.translation,
           pose_opengl_world_T_opengl_camera.orientation));
-  if (segment_is_drawable_) {
+  overlay_target_.Begin();
+  if (live_measurement_) {
+    if (live_polyline_.size() > 1) {
+      polyline_->Render(projection_matrix_ar_, opengl_camera_T_opengl_world);
+    }
+    for (size_t i = 1; i < live_polyline_.size(); ++i) {
+      AddLengthLabel(live_polyline_[i - 1], live_polyline_[i]);
+    }
+  } else if (segment_is_drawable_) {
     segment_->Render(projection_matrix_ar_, opengl_camera_T_opengl_world);
+    AddLengthLabel(point1_, point2_);
   }
+  if (is_video_behind) {
+    video_overlay_->RenderBehind();
+  }
+  overlay_target_.End();
+  length_labels_->Render(projection_matrix_ar_, opengl_camera_T_opengl_world);
+}
+
+void PointToPointApplication::AddLengthLabel(const glm::vec3& start,
+                                             const glm::vec3& end) {
+  char text[32];
+  snprintf(text, sizeof(text), "%.3f m", glm::distance(start, end));
+  length_labels_->AddLabel(text, 0.5f * (start + end),
+                           tango_gl::Color(1.0f, 1.0f, 1.0f));
 }
 
 void PointToPointApplication::DeleteResources() {
+  depth_probe_.DeleteGlResources();
+  overlay_target_.DeleteGlResources();
   delete video_overlay_;
   delete segment_;
+  delete polyline_;
+  if (length_labels_ != nullptr) {
+    length_labels_->DeleteGlResources();
+  }
+  delete length_labels_;
   video_overlay_ = nullptr;
   segment_ = nullptr;
+  polyline_ = nullptr;
+  length_labels_ = nullptr;
 }
 
 // We assume the Java layer ensures this function is called on the GL thread.
+void PointToPointApplication::OnTouchEvents(const float* samples,
+                                            int sample_count) {
+  touch_queue_.Post(samples, sample_count);
+}
+
 void PointToPointApplication::OnTouchEvent(float x, float y) {
-  /// Calculate the conversion from the latest depth camera position to the
-  /// position of the most recent color camera image. This corrects for screen
-  /// lag between the two systems.
-  TangoPoseData pose_color_camera_t0_T_depth_camera_t1;
-  int ret = TangoSupport_calculateRelativePose(
-      last_gpu_timestamp_, TANGO_COORDINATE_FRAME_CAMERA_COLOR,
-      front_cloud_->timestamp, TANGO_COORDINATE_FRAME_CAMERA_DEPTH,
-      &pose_color_camera_t0_T_depth_camera_t1);
-  if (ret != TANGO_SUCCESS) {
-    LOGE("PointToPointApplication::%s: could not calculate relative pose",
+  ScreenPoint point;
+  point.uv = glm::vec2(x / screen_width_, y / screen_height_);
+  point.is_valid = false;
+
+  // The live anchors are found with the rest of the polyline next frame.
+  if (live_measurement_) {
+    if (live_anchors_.size() >= kMaxLiveAnchors) {
+      LOGI("PointToPointApplication: The polyline has %d points already.",
+           static_cast<int>(live_anchors_.size()));
+      return;
+    }
+    live_anchors_.push_back(point);
+    return;
+  }
+
+  // A new tap does not wait for the edges of the previous one anymore, nor
+  // for the depth of one not found yet.
+  if (has_pending_tap_) {
+    has_pending_tap_ = false;
+    UpdateSegment(pending_tap_.world_position);
+  }
+  has_pending_depth_tap_ = false;
+
+  std::vector<ScreenPoint> points(1, point);
+  if (algorithm_ == UpsampleAlgorithm::kGpuDepth &&
+      QueryScreenPoints(points, kTapQueryId)) {
+    // Render() measures it once its depth is read back.
+    has_pending_depth_tap_ = true;
+    pending_depth_tap_ = point;
+    return;
+  }
+  if (!ResolveScreenPoints(&points) || !points[0].is_valid) {
+    return;
+  }
+  MeasureTap(points[0]);
+}
+
+void PointToPointApplication::MeasureTap(const ScreenPoint& point) {
+  ScreenPoint snapped = point;
+  if (edge_snapping_ && !SnapToEdge(&snapped)) {
+    // Render() measures it once the edges near it are found.
+    has_pending_tap_ = true;
+    pending_tap_ = point;
+    pending_tap_timestamp_ = last_gpu_timestamp_;
+    return;
+  }
+  UpdateSegment(snapped.world_position);
+}
+
+bool PointToPointApplication::ResolveScreenPoints(
+    std::vector<ScreenPoint>* points) {
+  TANGO_TRACE_SCOPE("PointToPointApplication::ResolveScreenPoints");
+  bool is_new_cloud;
+  front_cloud_ = render_cloud_reader_.Acquire(&is_new_cloud);
+  if (front_cloud_ == nullptr) {
+    return false;
+  }
+
+  glm::mat4 color_camera_t1_T_color_camera_t0;
+  if (!GetColorCameraMotion(&color_camera_t1_T_color_camera_t0)) {
+    return false;
+  }
+
+  // The point cloud is in the depth camera frame at its own time.
+  TangoPoseData pose_start_service_T_device;
+  if (GetStartServiceTDevicePose(&pose_start_service_T_device) !=
+      TANGO_SUCCESS) {
+    LOGE("PointToPointApplication::%s: error getting depth camera pose",
          __func__);
+    return false;
+  }
+  const glm::mat4 opengl_world_T_depth =
+      tango_gl::conversions::kOpenGlWorldTTangoWorld *
+      (tango_gl::conversions::TransformFromArrays(
+           pose_start_service_T_device.translation,
+           pose_start_service_T_device.orientation) *
+       extrinsics_.GetDeviceTDepthCamera());
+
+  // Only projects front_cloud_ the first time it is queried.
+  depth_cache_.Update(front_cloud_, extrinsics_.GetColorCameraTDevice() *
+                                        extrinsics_.GetDeviceTDepthCamera());
+  for (ScreenPoint& point : *points) {
+    const float uv[2] = {point.uv.x, point.uv.y};
+    float depth_position[3] = {0.0f, 0.0f, 0.0f};
+    if (GetDepthAtPoint(uv, depth_position,
+                        color_camera_t1_T_color_camera_t0)) {
+      point.world_position =
+          glm::vec3(opengl_world_T_depth *
+                    glm::vec4(depth_position[0], depth_position[1],
+                              depth_position[2], 1.0f));
+      point.is_valid = true;
+    }
+  }
+  return true;
+}
+
+bool PointToPointApplication::UpdateDepthProbe() {
+  bool is_new_cloud;
+  front_cloud_ = render_cloud_reader_.Acquire(&is_new_cloud);
+  if (front_cloud_ == nullptr) {
+    return false;
+  }
+  glm::mat4 color_camera_t1_T_color_camera_t0;
+  if (!GetColorCameraMotion(&color_camera_t1_T_color_camera_t0)) {
+    return false;
+  }
+
+  // The probe keeps its own copy of the point cloud.
+  if (front_cloud_->timestamp != depth_probe_timestamp_) {
+    depth_probe_.SetPoints(front_cloud_->xyz[0], front_cloud_->xyz_count,
+                           front_cloud_->timestamp);
+    depth_probe_timestamp_ = front_cloud_->timestamp;
+  }
+  // Splatted into the color camera at the time of the latest image, which
+  // the taps are pixels of.
+  depth_probe_.SetCameraTPoints(
+      glm::inverse(color_camera_t1_T_color_camera_t0) *
+      extrinsics_.GetColorCameraTDevice() *
+      extrinsics_.GetDeviceTDepthCamera());
+  return true;
+}
+
+bool PointToPointApplication::QueryScreenPoints(
+    const std::vector<ScreenPoint>& points, int first_id) {
+  TANGO_TRACE_SCOPE("PointToPointApplication::QueryScreenPoints");
+  if (!UpdateDepthProbe()) {
+    return false;
+  }
+  for (size_t i = 0; i < points.size(); ++i) {
+    if (!depth_probe_.Query(points[i].uv, first_id + static_cast<int>(i))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void PointToPointApplication::ReadScreenPointQueries() {
+  depth_probe_.ReadFinishedQueries([this](int id, const glm::vec2& uv,
+                                          bool is_found,
+                                          const glm::vec3& position,
+                                          double timestamp) {
+    // The tap or the anchor may have been replaced since the query.
+    const bool is_tap = id == kTapQueryId && has_pending_depth_tap_ &&
+                        pending_depth_tap_.uv == uv;
+    const bool is_anchor =
+        id >= 0 && static_cast<size_t>(id) < live_anchors_.size() &&
+        live_anchors_[id].uv == uv;
+    if (!is_tap && !is_anchor) {
+      return;
+    }
+    if (is_tap) {
+      has_pending_depth_tap_ = false;
+    }
+    TangoPoseData pose_start_service_T_device;
+    if (!is_found ||
+        pose_history_.GetPoseAtTime(timestamp, &pose_start_service_T_device) !=
+            TANGO_SUCCESS ||
+        pose_start_service_T_device.status_code != TANGO_POSE_VALID) {
+      return;
+    }
+    const glm::mat4 opengl_world_T_depth =
+        tango_gl::conversions::kOpenGlWorldTTangoWorld *
+        (tango_gl::conversions::TransformFromArrays(
+             pose_start_service_T_device.translation,
+             pose_start_service_T_device.orientation) *
+         extrinsics_.GetDeviceTDepthCamera());
+    ScreenPoint* point = is_tap ? &pending_depth_tap_ : &live_anchors_[id];
+    point->world_position =
+        glm::vec3(opengl_world_T_depth * glm::vec4(position, 1.0f));
+    point->is_valid = true;
+    if (is_tap) {
+      MeasureTap(*point);
+    }
+  });
+
+  if (depth_probe_.ReadFinishedEdgeMap()) {
+    TangoPoseData pose_start_service_T_device;
+    is_edge_map_posed_ =
+        pose_history_.GetPoseAtTime(depth_probe_.GetEdgeMapTimestamp(),
+                                    &pose_start_service_T_device) ==
+            TANGO_SUCCESS &&
+        pose_start_service_T_device.status_code == TANGO_POSE_VALID;
+    if (is_edge_map_posed_) {
+      edge_map_world_T_depth_ =
+          tango_gl::conversions::kOpenGlWorldTTangoWorld *
+          (tango_gl::conversions::TransformFromArrays(
+               pose_start_service_T_device.translation,
+               pose_start_service_T_device.orientation) *
+           extrinsics_.GetDeviceTDepthCamera());
+      edge_map_depth_T_world_ = glm::inverse(edge_map_world_T_depth_);
+    }
+  }
+}
+
+void PointToPointApplication::UpdateLiveMeasurement() {
+  if (live_anchors_.empty()) {
     return;
   }
-  float uv[2] = {x / screen_width_, y / screen_height_};
-
-  // use this to calculate position relative to depth camera
-  float depth_position[3] = {0.0f, 0.0f, 0.0f};
-  // This sets the position relative to the depth camera.
-  // Returns true if it is a valid point.
-  if (GetDepthAtPoint(uv, depth_position,
-                      pose_color_camera_t0_T_depth_camera_t1)) {
-    const glm::vec3 depth_position_vec =
-        glm::vec3(depth_position[0], depth_position[1], depth_position[2]);
-
-    // Use transformation helper to calculate start_service_T_depth
-    TangoPoseData pose_start_servce_T_device;
-    GetStartServiceTDevicePose(&pose_start_servce_T_device);
-    TangoPoseData pose_start_servce_T_depth;
-    TangoErrorType ret = TangoSupport_getPoseInEngineFrame(
-        TANGO_SUPPORT_COORDINATE_CONVENTION_TANGO,
-        TANGO_COORDINATE_FRAME_CAMERA_DEPTH, pose_start_servce_T_device,
-        &pose_start_servce_T_depth);
-    if (ret != TANGO_SUCCESS) {
-      LOGE("PointToPointApplication::%s: error getting depth camera pose",
-           __func__);
+  // The queries update the anchors a frame or two later, in
+  // ReadScreenPointQueries(), meanwhile they stay where they were found.
+  const bool is_queried = algorithm_ == UpsampleAlgorithm::kGpuDepth &&
+                          QueryScreenPoints(live_anchors_, 0);
+  if (!is_queried && !ResolveScreenPoints(&live_anchors_)) {
+    return;
+  }
+  live_polyline_.clear();
+  for (const ScreenPoint& anchor : live_anchors_) {
+    if (!anchor.is_valid) {
+      continue;
+    }
+    // Anchors snap with the edges found so far, without waiting for newer
+    // ones.
+    ScreenPoint snapped = anchor;
+    if (edge_snapping_) {
+      SnapToEdge(&snapped);
+    }
+    live_polyline_.push_back(snapped.world_position);
+  }
+  polyline_->UpdateLineVertices(live_polyline_);
+  PublishMeasurement(live_polyline_);
+}
+
+void PointToPointApplication::GetEdgeCell(const glm::vec2& uv, int* cell_x,
+                                          int* cell_y) const {
+  *cell_x = static_cast<int>(
+      std::floor(uv.x * color_camera_intrinsics_.width / kEdgeCellSize));
+  *cell_y = static_cast<int>(
+      std::floor(uv.y * color_camera_intrinsics_.height / kEdgeCellSize));
+}
+
+PointToPointApplication::CachedEdges*
+PointToPointApplication::FindCachedEdges(int cell_x, int cell_y) {
+  for (CachedEdges& cached : edge_cache_) {
+    if (cached.cell_x == cell_x && cached.cell_y == cell_y) {
+      return &cached;
+    }
+  }
+  return nullptr;
+}
+
+bool PointToPointApplication::SnapToEdgeMap(ScreenPoint* point) {
+  if (!is_edge_map_posed_ || front_cloud_ == nullptr ||
+      front_cloud_->timestamp - depth_probe_.GetEdgeMapTimestamp() >
+          kEdgeCacheLifetime) {
+    return false;
+  }
+  const glm::vec3 depth_position(edge_map_depth_T_world_ *
+                                 glm::vec4(point->world_position, 1.0f));
+  glm::vec3 edge_position;
+  if (depth_probe_.FindNearestEdge(point->uv, kEdgeMapSearchRadius,
+                                   depth_position, kSnapDistance,
+                                   &edge_position)) {
+    point->world_position =
+        glm::vec3(edge_map_world_T_depth_ * glm::vec4(edge_position, 1.0f));
+  }
+  return true;
+}
+
+bool PointToPointApplication::SnapToEdge(ScreenPoint* point) {
+  if (algorithm_ == UpsampleAlgorithm::kGpuDepth && SnapToEdgeMap(point)) {
+    return true;
+  }
+  int cell_x, cell_y;
+  GetEdgeCell(point->uv, &cell_x, &cell_y);
+  bool is_up_to_date = false;
+  {
+    std::lock_guard<tango_gl::ProfiledMutex> lock(edges_mutex_);
+    const CachedEdges* cached = FindCachedEdges(cell_x, cell_y);
+    if (cached != nullptr) {
+      is_up_to_date = front_cloud_ == nullptr ||
+                      cached->timestamp >= front_cloud_->timestamp;
+      float nearest_distance = kSnapDistance * kSnapDistance;
+      glm::vec3 nearest_point = point->world_position;
+      for (const tango_gl::Segment& edge : cached->edges) {
+        const glm::vec3 closest =
+            ClosestPointOnSegment(edge, point->world_position);
+        const float distance =
+            tango_gl::util::DistanceSquared(closest, point->world_position);
+        if (distance < nearest_distance) {
+          nearest_distance = distance;
+          nearest_point = closest;
+        }
+      }
+      point->world_position = nearest_point;
+    }
+  }
+  if (!is_up_to_date) {
+    EdgeRequest request;
+    request.uv = point->uv;
+    edge_request_queue_.Post(request);
+  }
+  return is_up_to_date;
+}
+
+void PointToPointApplication::HandleEdgeRequest(const EdgeRequest& request) {
+  TANGO_TRACE_SCOPE("PointToPointApplication::HandleEdgeRequest");
+  bool is_new_cloud;
+  const TangoXYZij* xyz_ij = edge_cloud_reader_.Acquire(&is_new_cloud);
+  TangoImageBuffer* image_buffer = nullptr;
+  TangoSupport_getLatestImageBuffer(image_buffer_manager_, &image_buffer);
+  if (xyz_ij == nullptr) {
+    return;
+  }
+  if (image_buffer == nullptr) {
+    std::lock_guard<tango_gl::ProfiledMutex> lock(image_rows_mutex_);
+    is_image_requested_ = true;
+    return;
+  }
+
+  int cell_x, cell_y;
+  GetEdgeCell(request.uv, &cell_x, &cell_y);
+  {
+    // The requests repeat every frame until the edges are found, they are
+    // only searched once per point cloud.
+    std::lock_guard<tango_gl::ProfiledMutex> lock(edges_mutex_);
+    const CachedEdges* cached = FindCachedEdges(cell_x, cell_y);
+    if (cached != nullptr && cached->timestamp >= xyz_ij->timestamp) {
       return;
     }
+  }
+  // The request repeats until an image with the rows around the pixel comes.
+  if (!RequestImageRows(request.uv, xyz_ij->timestamp, image_buffer)) {
+    return;
+  }
+
+  TangoPoseData pose_start_service_T_device;
+  if (pose_history_.GetPoseAtTime(xyz_ij->timestamp,
+                                  &pose_start_service_T_device) !=
+          TANGO_SUCCESS ||
+      pose_start_service_T_device.status_code != TANGO_POSE_VALID) {
+    return;
+  }
+  const glm::mat4 opengl_world_T_depth =
+      tango_gl::conversions::kOpenGlWorldTTangoWorld *
+      (tango_gl::conversions::TransformFromArrays(
+           pose_start_service_T_device.translation,
+           pose_start_service_T_device.orientation) *
+       extrinsics_.GetDeviceTDepthCamera());
+
+  CachedEdges found;
+  found.cell_x = cell_x;
+  found.cell_y = cell_y;
+  found.timestamp = xyz_ij->timestamp;
+  const float uv[2] = {request.uv.x, request.uv.y};
+  TangoSupportEdge* edges = nullptr;
+  int edge_count = 0;
+  // A failed search is cached too, as no edges near the pixel.
+  if (TangoSupport_findEdgesNearPoint(xyz_ij, image_buffer,
+                                      &color_camera_intrinsics_, uv, &edges,
+                                      &edge_count) == TANGO_SUCCESS) {
+    for (int i = 0; i < edge_count; ++i) {
+      const float* start = edges[i].end_points[0];
+      const float* end = edges[i].end_points[1];
+      found.edges.push_back(tango_gl::Segment(
+          glm::vec3(opengl_world_T_depth *
+                    glm::vec4(start[0], start[1], start[2], 1.0f)),
+          glm::vec3(opengl_world_T_depth *
+                    glm::vec4(end[0], end[1], end[2], 1.0f))));
+    }
+    TangoSupport_freeEdgeList(&edges);
+  }
 
-    const glm::mat4 start_service_T_depth =
-        tango_gl::conversions::TransformFromArrays(
-            pose_start_servce_T_depth.translation,
-            pose_start_servce_T_depth.orientation);
+  std::lock_guard<tango_gl::ProfiledMutex> lock(edges_mutex_);
+  // Forget the cells not looked at for a while.
+  const double oldest_timestamp = xyz_ij->timestamp - kEdgeCacheLifetime;
+  edge_cache_.erase(
+      std::remove_if(edge_cache_.begin(), edge_cache_.end(),
+                     [oldest_timestamp](const CachedEdges& cached) {
+                       return cached.timestamp < oldest_timestamp;
+                     }),
+      edge_cache_.end());
+  CachedEdges* cached = FindCachedEdges(cell_x, cell_y);
+  if (cached != nullptr) {
+    *cached = std::move(found);
+  } else {
+    edge_cache_.push_back(std::move(found));
+  }
+}
 
-    // Apply final transformation from start service to OpenGL world
-    const glm::mat4 opengl_world_T_depth =
-        opengl_world_T_start_service_ * start_service_T_depth;
+bool PointToPointApplication::RequestImageRows(
+    const glm::vec2& uv, double timestamp,
+    const TangoImageBuffer* image_buffer) {
+  const int height = static_cast<int>(color_camera_intrinsics_.height);
+  const int row = static_cast<int>(std::floor(uv.y * height));
+  ImageRows needed;
+  needed.begin = static_cast<uint32_t>(
+      std::min(std::max(row - kImageRowMargin, 0), height - 2));
+  needed.end = static_cast<uint32_t>(
+      std::max(std::min(row + kImageRowMargin, height - 1), 1));
 
-    // Transform to world coordinates
-    const glm::vec4 world_position =
-        opengl_world_T_depth * glm::vec4(depth_position_vec, 1.0f);
+  std::lock_guard<tango_gl::ProfiledMutex> lock(image_rows_mutex_);
+  const bool is_copied =
+      copied_image_rows_.Contains(needed) &&
+      image_buffer->timestamp >= copied_image_rows_timestamp_ &&
+      image_buffer->timestamp >= timestamp - kMaxImageAge;
+  if (!is_copied) {
+    is_image_requested_ = true;
+  }
+  // The rows of every pixel searched within kEdgeCacheLifetime are kept, the
+  // older ones are dropped so that the band follows the pixels instead of
+  // growing back to the whole image.
+  if (timestamp - image_rows_request_timestamp_ > kEdgeCacheLifetime) {
+    requested_image_rows_ = needed;
+    image_rows_request_timestamp_ = timestamp;
+  } else if (!requested_image_rows_.Contains(needed)) {
+    requested_image_rows_.begin =
+        std::min(requested_image_rows_.begin, needed.begin);
+    requested_image_rows_.end = std::max(requested_image_rows_.end, needed.end);
+    image_rows_request_timestamp_ = timestamp;
+  }
+  return is_copied;
+}
 
-    UpdateSegment(world_position);
+bool PointToPointApplication::GetColorCameraMotion(
+    glm::mat4* color_camera_t1_T_color_camera_t0) {
+  /// Calculate the motion of the color camera from the most recent color
+  /// camera image to the latest point cloud. This corrects for screen lag
+  /// between the two systems.
+  TangoPoseData pose_color_camera_t1_T_color_camera_t0;
+  int ret = TangoSupport_calculateRelativePose(
+      front_cloud_->timestamp, TANGO_COORDINATE_FRAME_CAMERA_COLOR,
+      last_gpu_timestamp_, TANGO_COORDINATE_FRAME_CAMERA_COLOR,
+      &pose_color_camera_t1_T_color_camera_t0);
+  if (ret != TANGO_SUCCESS) {
+    LOGE("PointToPointApplication::%s: could not calculate relative pose",
+         __func__);
+    return false;
   }
+  *color_camera_t1_T_color_camera_t0 =
+      tango_gl::conversions::TransformFromArrays(
+          pose_color_camera_t1_T_color_camera_t0.translation,
+          pose_color_camera_t1_T_color_camera_t0.orientation);
+  return true;
 }
 
 TangoErrorType PointToPointApplication::GetStartServiceTDevicePose(
     TangoPoseData* pose) {
-  TangoCoordinateFramePair frame_pair;
-  frame_pair.base = TANGO_COORDINATE_FRAME_START_OF_SERVICE;
-  frame_pair.target = TANGO_COORDINATE_FRAME_DEVICE;
-
-  return TangoService_getPoseAtTime(front_cloud_->timestamp, frame_pair, pose);
+  return pose_history_.GetPoseAtTime(front_cloud_->timestamp, pose);
 }
 
 bool PointToPointApplication::GetDepthAtPoint(
     const float uv[2], float xyz[3],
-    const TangoPoseData& color_camera_T_point_cloud) {
-  int is_valid_point = 0;
+    const glm::mat4& color_camera_t1_T_color_camera_t0) {
   if (algorithm_ == UpsampleAlgorithm::kNearest) {
-    TangoSupport_getDepthAtPointNearestNeighbor(
-        front_cloud_, &color_camera_intrinsics_, &color_camera_T_point_cloud,
-        uv, xyz, &is_valid_point);
-    return is_valid_point;
+    return depth_cache_.GetNearestPoint(uv, color_camera_t1_T_color_camera_t0,
+                                        xyz);
   }
-  TangoSupport_getDepthAtPointBilateral(
-      interpolator_, front_cloud_, image_buffer_, &color_camera_T_point_cloud,
-      uv, xyz, &is_valid_point);
-  return is_valid_point;
+  return depth_cache_.GetInterpolatedPoint(
+      uv, color_camera_t1_T_color_camera_t0, xyz);
 }
 
-void PointToPointApplication::UpdateSegment(glm::vec4 world_position) {
+void PointToPointApplication::UpdateSegment(const glm::vec3& world_position) {
   // Update the points with world_position.
-  std::lock_guard<std::mutex> lock(tango_points_mutex_);
   if (point_modifier_flag_) {
-    point1_ = glm::vec3(world_position);
+    point1_ = world_position;
   } else {
-    point2_ = glm::vec3(world_position);
+    point2_ = world_position;
   }
   point_modifier_flag_ = !point_modifier_flag_;
 
@@ -459,24 +1129,24 @@ void PointToPointApplication::UpdateSegment(glm::vec4 world_position) {
     segment_is_drawable_ = true;
   }
   segment_->UpdateSegment(tango_gl::Segment(point1_, point2_));
+  PublishMeasurement({point1_, point2_});
 }
 
-double DistanceSquared(glm::vec3 pt1, glm::vec3 pt2) {
-  double v1((pt1[0] - pt2[0]) * (pt1[0] - pt2[0]));
-  double v2((pt1[1] - pt2[1]) * (pt1[1] - pt2[1]));
-  double v3((pt1[2] - pt2[2]) * (pt1[2] - pt2[2]));
-  return v1 + v2 + v3;
-}
-
-std::string PointToPointApplication::GetPointSeparation() {
-  std::lock_guard<std::mutex> lock(tango_points_mutex_);
-  if (segment_is_drawable_) {
-    double value(sqrt(DistanceSquared(point1_, point2_)));
-    std::ostringstream strs;
-    strs << value << " meters";
-    return strs.str();
-  }
-  return "Undefined";
+void PointToPointApplication::PublishMeasurement(
+    const std::vector<glm::vec3>& polyline) {
+  telemetry_.Write([&polyline](Telemetry* telemetry) {
+    const int count =
+        polyline.empty() ? 0 : static_cast<int>(polyline.size()) - 1;
+    telemetry->segment_count = count;
+    telemetry->total_length = 0.0f;
+    for (int i = 0; i < count; ++i) {
+      const float length = glm::distance(polyline[i], polyline[i + 1]);
+      if (i < Telemetry::kMaxSegments) {
+        telemetry->segment_lengths[i] = length;
+      }
+      telemetry->total_length += length;
+    }
+  });
 }
 
 }  // namespace tango_point_to_point
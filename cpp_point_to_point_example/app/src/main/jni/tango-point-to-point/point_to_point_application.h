@@ -18,16 +18,32 @@
 #define TANGO_POINT_TO_POINT_POINT_TO_POINT_APPLICATION_H_
 
 #include <jni.h>
-#include <memory>
 #include <mutex>
-#include <string>
+#include <vector>
 
 #include <tango_client_api.h>
 #include <tango_support_api.h>
+#include <tango-gl/depth_probe.h>
 #include <tango-gl/line.h>
+#include <tango-gl/overlay_target.h>
+#include <tango-gl/profiled_mutex.h>
+#include <tango-gl/segment.h>
 #include <tango-gl/segment_drawable.h>
+#include <tango-gl/text_renderer.h>
 #include <tango-gl/util.h>
 #include <tango-gl/video_overlay.h>
+#include <tango-util/callback_dispatcher.h>
+#include <tango-util/extrinsics_cache.h>
+#include <tango-util/intrinsics_registry.h>
+#include <tango-util/point_cloud_buffer.h>
+#include <tango-util/pose_history.h>
+#include <tango-util/projected_depth_cache.h>
+#include <tango-util/quality_governor.h>
+#include <tango-util/session_recorder.h>
+#include <tango-util/telemetry_block.h>
+#include <tango-util/touch_queue.h>
+
+#include "tango-point-to-point/telemetry.h"
 
 namespace tango_point_to_point {
 
@@ -56,12 +72,39 @@ class PointToPointApplication {
   // Disconnect from the Project Tango service.
   void TangoDisconnect();
 
+  // Record the poses, point clouds and, if |record_images|, the color images
+  // of the session into a session log at |path|, until StopRecording() or
+  // TangoDisconnect(). Must be called while connected to the service.
+  bool StartRecording(const char* path, bool record_images);
+  void StopRecording();
+
   // Create OpenGL state and connect to the color camera texture.
   int InitializeGLContent();
 
   // Configure which method to use for upsampling.
   void SetUpsampleViaBilateralFiltering(bool on);
 
+  // Find the points of the taps in a depth image the GPU splats the point
+  // cloud into, reading back only the pixels around the taps, instead of
+  // projecting the whole point cloud on the CPU. A tap is then measured a
+  // frame or two later. Falls back to the nearest projected point without
+  // GLES 3.0. Must be called on the GL thread.
+  void SetUpsampleViaGpuDepth(bool on);
+
+  // Switch between measuring the segment between the last two taps and
+  // measuring live: every tap then adds a point of the screen to a polyline,
+  // whose vertices are measured again every frame as the device moves.
+  // Switching clears the measurement. Must be called on the GL thread.
+  void SetLiveMeasurement(bool on);
+
+  // Snap the measured points to the 3D edges found near them, e.g. the border
+  // of a table. The edges are searched off the GL thread: a tap waits a few
+  // frames for the search instead of stalling, and the edges found near any
+  // pixel are reused until the next point cloud. With the GPU depth image,
+  // the edges are those of its edge map instead, extracted every frame, see
+  // tango_gl::DepthProbe. Must be called on the GL thread.
+  void SetEdgeSnapping(bool on);
+
   // Configure the viewport of the GL view.
   void SetViewPort(int width, int height);
 
@@ -71,8 +114,12 @@ class PointToPointApplication {
   // Delete the allocate resources.
   void DeleteResources();
 
-  // Return the distance between the two selected points.
-  std::string GetPointSeparation();
+  // @return: a direct ByteBuffer over the distance between the two selected
+  //          points, or the length of every segment of the live polyline and
+  //          their total, see Telemetry.
+  jobject NewTelemetryBuffer(JNIEnv* env) {
+    return telemetry_.NewDirectByteBuffer(env);
+  }
 
   //
   // Callback for point clouds that come in from the Tango service.
@@ -81,6 +128,13 @@ class PointToPointApplication {
   //
   void OnXYZijAvailable(const TangoXYZij* xyz_ij);
 
+  //
+  // Callback for device poses that come in from the Tango service.
+  //
+  // @param pose The pose returned by the service.
+  //
+  void OnPoseAvailable(const TangoPoseData* pose);
+
   //
   // Callback for image buffers that come in from the Tango service.
   //
@@ -89,24 +143,151 @@ class PointToPointApplication {
   void OnFrameAvailable(const TangoImageBuffer* buffer);
 
   //
-  // Callback for touch events to place apoint and update the line segment. The
-  // Java
-  // layer should ensure this is only called from the GL thread.
+  // Touch samples batched by the Java layer, handled at the start of the next
+  // Render().
+  //
+  // @param samples sample_count samples of tango_util::TouchQueue::kSampleSize
+  //        floats, of which only the touch downs are used, in screen space of
+  //        the window.
+  void OnTouchEvents(const float* samples, int sample_count);
+
+ private:
+  // Place a point and update the line segment for a tap. Only called from
+  // Render().
   //
   // @param x The requested x coordinate in screen space of the window.
   // @param y The requested y coordinate in screen space of the window.
   void OnTouchEvent(float x, float y);
 
- private:
+  // A pixel of the color image and the point of the scene it sees.
+  struct ScreenPoint {
+    // The pixel in normalized image coordinates.
+    glm::vec2 uv;
+    // Position in the OpenGL world, kept when the point is not found again.
+    glm::vec3 world_position;
+    // Whether world_position was ever found.
+    bool is_valid;
+  };
+
+  // A pixel to search edges near, for the dispatcher thread.
+  struct EdgeRequest {
+    glm::vec2 uv;
+  };
+
+  // The edges found near the pixels of a cell of the color image.
+  struct CachedEdges {
+    int cell_x;
+    int cell_y;
+    // Timestamp of the point cloud they were found in.
+    double timestamp;
+    // The edges in the OpenGL world.
+    std::vector<tango_gl::Segment> edges;
+  };
+
+  // Rows |begin| to |end| included of the color image.
+  struct ImageRows {
+    ImageRows() : begin(0), end(0) {}
+
+    bool Contains(const ImageRows& other) const {
+      return begin <= other.begin && other.end <= end;
+    }
+
+    uint32_t begin;
+    uint32_t end;
+  };
+
   // Details of rendering to OpenGL after determining transforms.
   void GLRender(const TangoPoseData& pose_start_service_T_device);
 
-  // Get the x,y,z point of the touch location.
+  // Get the x,y,z point of the touch location, in the depth camera frame of
+  // front_cloud_. depth_cache_ must have been updated with front_cloud_.
+  //
+  // @param color_camera_t1_T_color_camera_t0: motion of the color camera from
+  //        the time of the image touched to the time of front_cloud_.
   bool GetDepthAtPoint(const float uv[2], float xyz[3],
-                       const TangoPoseData& color_camera_T_point_cloud);
+                       const glm::mat4& color_camera_t1_T_color_camera_t0);
+
+  // Find the world positions of pixels of the latest color image. All the
+  // points share the one relative pose, depth camera pose and projection of
+  // front_cloud_ this needs, however many there are.
+  //
+  // @return false if the poses are not available, every point is left as is.
+  bool ResolveScreenPoints(std::vector<ScreenPoint>* points);
+
+  // Queue the search of |points| in the GPU depth image of front_cloud_, the
+  // i-th one with the query id |first_id| + i. ReadScreenPointQueries() gets
+  // their world positions back.
+  //
+  // @return false if the poses are not available, or the GPU depth image is
+  // not supported, in which case the points are resolved on the CPU.
+  bool QueryScreenPoints(const std::vector<ScreenPoint>& points, int first_id);
+
+  // Give front_cloud_ and its transform into the latest image to the GPU
+  // depth image.
+  //
+  // @return false if the poses are not available.
+  bool UpdateDepthProbe();
+
+  // Update the tap and the live anchors of the GPU queries that finished, and
+  // the edge map.
+  void ReadScreenPointQueries();
+
+  // Measure a tap whose world position was found, once the edges near it are
+  // if snapping.
+  void MeasureTap(const ScreenPoint& point);
+
+  // Measure the live polyline again.
+  void UpdateLiveMeasurement();
 
   // Update the segment based on a new touch position.
-  void UpdateSegment(glm::vec4 world_position);
+  void UpdateSegment(const glm::vec3& world_position);
+
+  // Write the lengths of the segments of |polyline| to telemetry_.
+  void PublishMeasurement(const std::vector<glm::vec3>& polyline);
+
+  // Label the segment from |start| to |end| with its length, at its middle.
+  void AddLengthLabel(const glm::vec3& start, const glm::vec3& end);
+
+  // Move |point| to the closest of the edges cached near its pixel, if close
+  // enough, and request a search if they were not found in front_cloud_.
+  //
+  // @return false if the edges of front_cloud_ are still being searched.
+  bool SnapToEdge(ScreenPoint* point);
+
+  // As SnapToEdge(), to the edges of the edge map of depth_probe_.
+  //
+  // @return false if there is no recent edge map, e.g. before the first one
+  //         is read back.
+  bool SnapToEdgeMap(ScreenPoint* point);
+
+  // Search the edges near a pixel in the latest point cloud, unless they were
+  // already. Runs on the dispatcher thread.
+  void HandleEdgeRequest(const EdgeRequest& request);
+
+  // Ask for the rows of the color image around |uv| to be copied into the
+  // image buffer manager, the only ones the edge search looks at. Runs on the
+  // dispatcher thread.
+  //
+  // @param timestamp: the time of the point cloud being searched.
+  // @param image_buffer: the latest image of the manager.
+  //
+  // @return true if |image_buffer| was copied with those rows, recently
+  //         enough for the point cloud. If not, the next image is copied.
+  bool RequestImageRows(const glm::vec2& uv, double timestamp,
+                        const TangoImageBuffer* image_buffer);
+
+  // The cell of edge_cache_ of a pixel.
+  void GetEdgeCell(const glm::vec2& uv, int* cell_x, int* cell_y) const;
+
+  // @return the cached edges of a cell, nullptr if none. Must be called with
+  // edges_mutex_ locked.
+  CachedEdges* FindCachedEdges(int cell_x, int cell_y);
+
+  // The motion of the color camera from the time of the latest image, t0, to
+  // the time of front_cloud_, t1.
+  //
+  // @return false if it is not available.
+  bool GetColorCameraMotion(glm::mat4* color_camera_t1_T_color_camera_t0);
 
   // return pose for device position with respect to
   // start of service.
@@ -124,38 +305,79 @@ class PointToPointApplication {
 
   double last_gpu_timestamp_;
 
+  // Maximum number of points in a point cloud frame.
+  int32_t max_point_cloud_elements_;
+
+  // Tees the Tango callbacks into a session log while recording.
+  tango_util::SessionRecorder session_recorder_;
+
+  // Device poses with respect to start of service, recorded from the pose
+  // callback.
+  tango_util::PoseHistory pose_history_;
+
+  // Extrinsics of the cameras, queried once connected.
+  tango_util::ExtrinsicsCache extrinsics_;
+  // Camera intrinsics and the projections derived from them.
+  tango_util::IntrinsicsRegistry intrinsics_;
+
   // Cached transforms
-  // Start of service with respect to OpenGL world.
-  glm::mat4 opengl_world_T_start_service_;
   // OpenGL projection matrix.
   glm::mat4 projection_matrix_ar_;
 
-  // Point data manager.
-  TangoSupportPointCloudManager* point_cloud_manager_;
-  TangoXYZij* front_cloud_;
+  // The latest point cloud of the callback, which the GL thread and the edge
+  // search each hold one of through their reader.
+  tango_util::PointCloudBuffer point_cloud_buffer_;
+  // The point cloud the GL thread measures in, acquired with every
+  // ResolveScreenPoints(), nullptr until the first one arrives.
+  tango_util::PointCloudBuffer::Reader render_cloud_reader_;
+  const TangoXYZij* front_cloud_;
 
-  // Image data manager.
+  // Image data manager, only read by the edge search.
   TangoSupportImageBufferManager* image_buffer_manager_;
-  TangoImageBuffer* image_buffer_;
-
-  // The depth interpolator class.
-  TangoSupportDepthInterpolator* interpolator_;
+  // The rows the dispatcher thread needs, and the ones the image callback
+  // copies since the image at copied_image_rows_timestamp_, under
+  // image_rows_mutex_. image_rows_request_timestamp_ is the time of the point
+  // cloud requested_image_rows_ last changed for, only used by the dispatcher
+  // thread. The image callback only copies the image after an edge search
+  // set is_image_requested_, the images no search reads being skipped.
+  ImageRows requested_image_rows_;
+  ImageRows copied_image_rows_;
+  double copied_image_rows_timestamp_;
+  double image_rows_request_timestamp_;
+  bool is_image_requested_;
+  tango_gl::ProfiledMutex image_rows_mutex_{
+      "PointToPointApplication::image_rows_mutex_"};
+
+  // front_cloud_ projected into the color camera, once per point cloud
+  // whatever the number of depth queries.
+  tango_util::ProjectedDepthCache depth_cache_;
 
   // To keep track of when segment can be rendered.
   int tap_number_;
 
   enum UpsampleAlgorithm {
     kNearest,
-    kBilateral
+    kBilateral,
+    // See SetUpsampleViaGpuDepth().
+    kGpuDepth
   };
   UpsampleAlgorithm algorithm_;
 
-  tango_gl::SegmentDrawable* segment_;
+  // The GPU depth image of kGpuDepth, front_cloud_ splatted in the color
+  // camera at the time of the latest image. depth_probe_timestamp_ is the
+  // time of the point cloud it was given last.
+  tango_gl::DepthProbe depth_probe_;
+  double depth_probe_timestamp_;
+  // A tap waiting for its depth to be read back.
+  bool has_pending_depth_tap_;
+  ScreenPoint pending_depth_tap_;
+  // The pose of the points of the edge map read last, and whether it was
+  // found.
+  bool is_edge_map_posed_;
+  glm::mat4 edge_map_world_T_depth_;
+  glm::mat4 edge_map_depth_T_world_;
 
-  // point data is shared between the UI thread we start for updating
-  // texts and the TangoService event callback thread. We keep points_mutex_ to
-  // protect point1_, point2_, and both flags.
-  std::mutex tango_points_mutex_;
+  tango_gl::SegmentDrawable* segment_;
 
   // Toggles which point will be altered
   bool point_modifier_flag_;
@@ -164,6 +386,51 @@ class PointToPointApplication {
 
   // Are both points defined?
   bool segment_is_drawable_;
+
+  // Live measurement, see SetLiveMeasurement(). The anchors are pixels, the
+  // polyline joins the ones found so far.
+  bool live_measurement_;
+  std::vector<ScreenPoint> live_anchors_;
+  std::vector<glm::vec3> live_polyline_;
+  tango_gl::Line* polyline_;
+  // Writes the lengths over the segments, nullptr before the GL content is
+  // initialized.
+  tango_gl::TextRenderer* length_labels_;
+
+  // Lowers the resolution the segments are rendered at over the full
+  // resolution camera image, to keep within the frame time budget. The
+  // labels are drawn at full resolution, to stay readable.
+  tango_util::QualityGovernor quality_governor_;
+  tango_gl::OverlayTarget overlay_target_;
+
+  // The measurement, written on the GL thread and read by the UI thread
+  // without calling into native code.
+  tango_util::TelemetryBlock<Telemetry> telemetry_;
+
+  // Edge snapping, see SetEdgeSnapping(). The edges are searched on the
+  // dispatcher thread, in point clouds of their own reader.
+  bool edge_snapping_;
+  tango_util::PointCloudBuffer::Reader edge_cloud_reader_;
+  // A tap waiting for the edges near it, and the time of its image.
+  bool has_pending_tap_;
+  ScreenPoint pending_tap_;
+  double pending_tap_timestamp_;
+
+  // The edges found so far, at most one entry per cell. Shared by the GL
+  // thread and the dispatcher thread under edges_mutex_.
+  std::vector<CachedEdges> edge_cache_;
+  tango_gl::ProfiledMutex edges_mutex_{"PointToPointApplication::edges_mutex_"};
+
+  // Touch samples of OnTouchEvents(), and those taken by the frame.
+  tango_util::TouchQueue touch_queue_;
+  std::vector<tango_util::TouchSample> touch_samples_;
+
+  // Searches requested by the GL thread, the oldest dropped first.
+  tango_util::DispatchQueue<EdgeRequest> edge_request_queue_;
+
+  // Declared last so that its thread is stopped before the rest of the app is
+  // destroyed.
+  tango_util::CallbackDispatcher dispatcher_;
 };
 
 }  // namespace tango_point_to_point
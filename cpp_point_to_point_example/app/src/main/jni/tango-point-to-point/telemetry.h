@@ -0,0 +1,39 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_POINT_TO_POINT_TELEMETRY_H_
+#define TANGO_POINT_TO_POINT_TELEMETRY_H_
+
+#include <cstdint>
+
+namespace tango_point_to_point {
+
+// The debug information the activity shows, shared with it through a
+// tango_util::TelemetryBlock. MainActivity.java mirrors the layout as
+// offsets, which must be updated along with it.
+struct Telemetry {
+  static const int kMaxSegments = 32;
+
+  // The measured segments, of the last two taps or of the live polyline, and
+  // their total length in meters. Only the first kMaxSegments lengths are
+  // kept.
+  int32_t segment_count;
+  float total_length;
+  float segment_lengths[kMaxSegments];
+};
+}  // namespace tango_point_to_point
+
+#endif  // TANGO_POINT_TO_POINT_TELEMETRY_H_
@@ -27,6 +27,7 @@ import javax.microedition.khronos.opengles.GL10;
 public class GLSurfaceRenderer implements GLSurfaceView.Renderer {
 
     private MainActivity mMainActivity;
+    private boolean mIsUpsampleCalibrated = false;
 
     public GLSurfaceRenderer(MainActivity mainActivity) {
         mMainActivity = mainActivity;
@@ -34,6 +35,10 @@ public class GLSurfaceRenderer implements GLSurfaceView.Renderer {
 
     public void onDrawFrame(GL10 gl) {
         JNIInterface.render();
+        if (!mIsUpsampleCalibrated && JNIInterface.isUpsampleCalibrated()) {
+            mIsUpsampleCalibrated = true;
+            mMainActivity.upsampleCalibrated(JNIInterface.getGPUUpsample());
+        }
     }
 
     public void onSurfaceChanged(GL10 gl, int width, int height) {
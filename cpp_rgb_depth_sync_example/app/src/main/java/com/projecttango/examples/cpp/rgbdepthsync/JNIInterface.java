@@ -61,4 +61,39 @@ public class JNIInterface {
   public static native void setDepthAlphaValue(float alpha);
 
   public static native void setGPUUpsample(boolean on);
+
+  public static native boolean getGPUUpsample();
+
+  // Pick the faster of the CPU and GPU upsampling on the first depth frame,
+  // and tune the CPU upsampling as it runs, kept in files of directory for
+  // the device described by deviceKey. Must be called before the GL surface
+  // is created.
+  public static native void setCalibrationStore(String directory, String deviceKey);
+
+  // @return true once the upsampling was picked by the calibration.
+  public static native boolean isUpsampleCalibrated();
+
+  public static native void setDepthTest(boolean on);
+
+  public static native void setFillHoles(boolean on);
+
+  public static native void setBilateralUpsample(boolean on);
+
+  // Write the metric depth images as 16 bit PNG of millimeters and the color
+  // images as raw NV21 to directory, e.g. under getExternalFilesDir(null),
+  // until called with an empty one.
+  public static native void setExportDirectory(String directory);
+
+  // Start recording where the native code spends its time, see
+  // tango-gl/tracing.h.
+  public static native void startTracing();
+
+  // Stop recording, the recorded time slices are kept for dumpTrace().
+  public static native void stopTracing();
+
+  // Write the recorded time slices as a Chrome trace JSON file, e.g. under
+  // getExternalFilesDir(null) to pull it from the sdcard.
+  //
+  // @return false if the file could not be written.
+  public static native boolean dumpTrace(String path);
 }
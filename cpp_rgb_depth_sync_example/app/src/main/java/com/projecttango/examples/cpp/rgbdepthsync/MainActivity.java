@@ -21,6 +21,7 @@ import android.content.ComponentName;
 import android.content.ServiceConnection;
 import android.graphics.Point;
 import android.opengl.GLSurfaceView;
+import android.os.Build;
 import android.os.Bundle;
 import android.os.IBinder;
 import android.util.Log;
@@ -49,6 +50,9 @@ public class MainActivity extends Activity {
   private SeekBar mDepthOverlaySeekbar;
   private CheckBox mdebugOverlayCheckbox;
   private CheckBox mGPUUpsampleCheckbox;
+  private CheckBox mDepthTestCheckbox;
+  private CheckBox mFillHolesCheckbox;
+  private CheckBox mBilateralUpsampleCheckbox;
 
     
   // Tango Service connection.
@@ -120,6 +124,28 @@ public class MainActivity extends Activity {
     }
   }
 
+  private class DepthTestListener implements CheckBox.OnCheckedChangeListener {
+    @Override
+    public void onCheckedChanged(CompoundButton buttonView, boolean isChecked) {
+      JNIInterface.setDepthTest(isChecked);
+    }
+  }
+
+  private class FillHolesListener implements CheckBox.OnCheckedChangeListener {
+    @Override
+    public void onCheckedChanged(CompoundButton buttonView, boolean isChecked) {
+      JNIInterface.setFillHoles(isChecked);
+    }
+  }
+
+  private class BilateralUpsampleListener
+      implements CheckBox.OnCheckedChangeListener {
+    @Override
+    public void onCheckedChanged(CompoundButton buttonView, boolean isChecked) {
+      JNIInterface.setBilateralUpsample(isChecked);
+    }
+  }
+
   @Override
   protected void onCreate(Bundle savedInstanceState) {
     super.onCreate(savedInstanceState);
@@ -143,6 +169,22 @@ public class MainActivity extends Activity {
     mGPUUpsampleCheckbox = (CheckBox) findViewById(R.id.gpu_upsample_checkbox);
     mGPUUpsampleCheckbox.setOnCheckedChangeListener(new GPUUpsampleListener());
 
+    mDepthTestCheckbox = (CheckBox) findViewById(R.id.depth_test_checkbox);
+    mDepthTestCheckbox.setOnCheckedChangeListener(new DepthTestListener());
+
+    mFillHolesCheckbox = (CheckBox) findViewById(R.id.fill_holes_checkbox);
+    mFillHolesCheckbox.setOnCheckedChangeListener(new FillHolesListener());
+
+    mBilateralUpsampleCheckbox =
+        (CheckBox) findViewById(R.id.bilateral_upsample_checkbox);
+    mBilateralUpsampleCheckbox.setOnCheckedChangeListener(
+        new BilateralUpsampleListener());
+
+    // The fastest upsampling and its tuning move with the OS build, which
+    // the fingerprint changes with.
+    JNIInterface.setCalibrationStore(getFilesDir().getPath(),
+                                     Build.MODEL + " " + Build.FINGERPRINT);
+
     // OpenGL view where all of the graphics are drawn
     mGLView = (GLSurfaceView) findViewById(R.id.gl_surface_view);
 
@@ -177,6 +219,17 @@ public class MainActivity extends Activity {
     unbindService(mTangoServiceConnection);
   }
 
+  // Check the GPU upsampling box as the calibration picked it. Called from
+  // the GL thread.
+  public void upsampleCalibrated(final boolean gpuUpsample) {
+    runOnUiThread(new Runnable() {
+      @Override
+      public void run() {
+        mGPUUpsampleCheckbox.setChecked(gpuUpsample);
+      }
+    });
+  }
+
   public void surfaceCreated() {
     JNIInterface.initializeGLContent();
     if (!JNIInterface.tangoConnectTexture()) {
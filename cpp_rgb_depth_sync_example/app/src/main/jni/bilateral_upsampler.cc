@@ -0,0 +1,387 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "rgb-depth-sync/bilateral_upsampler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstring>
+
+#include <tango-gl/tracing.h>
+#include <tango-gl/util.h>
+
+namespace {
+// Tiles thinner than this are not worth a thread of their own.
+const int kMinRowsPerTile = 32;
+
+inline uint8_t ToGrayscale(float depth, float depth_to_grayscale) {
+  return static_cast<uint8_t>(
+      std::min(depth * depth_to_grayscale, static_cast<float>(UCHAR_MAX)));
+}
+}  // namespace
+
+namespace rgb_depth_sync {
+
+BilateralUpsampler::BilateralUpsampler(float max_depth)
+    : depth_to_grayscale_(UCHAR_MAX / max_depth),
+      approximate_(true),
+      tile_count_(0),
+      image_buffer_manager_(nullptr),
+      is_started_(false),
+      is_stopping_(false),
+      has_pending_job_(false),
+      pending_timestamp_(0.0),
+      pending_geometry_(),
+      submitted_geometry_version_(0),
+      submitted_timestamp_(0.0),
+      submitted_point_stride_(0),
+      writing_(new Result()),
+      ready_(new Result()),
+      reading_(new Result()),
+      has_new_result_(false),
+      job_point_cloud_(),
+      geometry_(),
+      tiles_version_(0),
+      tiles_tile_count_(0),
+      thread_count_(1) {}
+
+BilateralUpsampler::~BilateralUpsampler() {
+  if (thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      is_stopping_ = true;
+    }
+    job_condition_.notify_one();
+    thread_.join();
+  }
+  FreeTiles();
+  if (image_buffer_manager_.load() != nullptr) {
+    TangoSupport_freeImageBufferManager(image_buffer_manager_.load());
+  }
+}
+
+void BilateralUpsampler::SetImageGeometry(
+    const TangoCameraIntrinsics& intrinsics, int region_x, int region_y,
+    int image_divisor) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  pending_geometry_.intrinsics = intrinsics;
+  pending_geometry_.region_x = region_x;
+  pending_geometry_.region_y = region_y;
+  pending_geometry_.image_divisor = std::max(image_divisor, 1);
+  ++pending_geometry_.version;
+}
+
+void BilateralUpsampler::SetApproximate(bool approximate) {
+  approximate_ = approximate;
+}
+
+void BilateralUpsampler::SetTileCount(int tile_count) {
+  tile_count_ = std::max(tile_count, 0);
+}
+
+void BilateralUpsampler::UpdateImage(const TangoImageBuffer* buffer) {
+  if (!is_started_) {
+    return;
+  }
+  // This thread is the only one creating the manager, the size of the images
+  // being only known here.
+  TangoSupportImageBufferManager* manager = image_buffer_manager_.load();
+  if (manager == nullptr) {
+    if (TangoSupport_createImageBufferManager(buffer->format, buffer->width,
+                                              buffer->height,
+                                              &manager) != TANGO_SUCCESS) {
+      LOGE("BilateralUpsampler: Failed to create the image buffer manager.");
+      return;
+    }
+    image_buffer_manager_ = manager;
+  }
+  TangoSupport_updateImageBuffer(manager, buffer);
+}
+
+void BilateralUpsampler::Submit(const TangoXYZij* point_cloud,
+                                int point_stride) {
+  if (point_cloud == nullptr || point_cloud->xyz_count == 0) {
+    return;
+  }
+  point_stride = std::max(point_stride, 1);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (pending_geometry_.version == 0 ||
+        (point_cloud->timestamp == submitted_timestamp_ &&
+         point_stride == submitted_point_stride_ &&
+         pending_geometry_.version == submitted_geometry_version_)) {
+      return;
+    }
+    const int point_count =
+        (point_cloud->xyz_count + point_stride - 1) / point_stride;
+    pending_points_.resize(point_count * 3);
+    for (int i = 0; i < point_count; ++i) {
+      const float* point = point_cloud->xyz[i * point_stride];
+      std::copy(point, point + 3, pending_points_.begin() + i * 3);
+    }
+    pending_timestamp_ = point_cloud->timestamp;
+    has_pending_job_ = true;
+    submitted_geometry_version_ = pending_geometry_.version;
+    submitted_timestamp_ = point_cloud->timestamp;
+    submitted_point_stride_ = point_stride;
+
+    if (!is_started_) {
+      thread_ = std::thread(&BilateralUpsampler::Run, this);
+      is_started_ = true;
+    }
+  }
+  job_condition_.notify_one();
+}
+
+const BilateralUpsampler::Result* BilateralUpsampler::GetNewResult() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!has_new_result_) {
+    return nullptr;
+  }
+  std::swap(ready_, reading_);
+  has_new_result_ = false;
+  return reading_.get();
+}
+
+void BilateralUpsampler::Run() {
+  // One core is left to the render thread.
+  const int core_count =
+      std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+  thread_count_ = std::max(core_count - 1, 1);
+  pool_.reset(new tango_util::WorkerPool(thread_count_ - 1));
+
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      job_condition_.wait(lock,
+                          [this] { return is_stopping_ || has_pending_job_; });
+      if (is_stopping_) {
+        break;
+      }
+      job_points_.swap(pending_points_);
+      job_point_cloud_.timestamp = pending_timestamp_;
+      geometry_ = pending_geometry_;
+      has_pending_job_ = false;
+    }
+    TANGO_TRACE_SCOPE("BilateralUpsampler::Job");
+    const std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+
+    // The latest image, and the pose of the point cloud relative to it.
+    TangoSupportImageBufferManager* manager = image_buffer_manager_.load();
+    TangoImageBuffer* image = nullptr;
+    if (manager == nullptr ||
+        TangoSupport_getLatestImageBuffer(manager, &image) != TANGO_SUCCESS ||
+        image == nullptr || image->timestamp <= 0.0) {
+      continue;
+    }
+    TangoPoseData color_camera_T_point_cloud;
+    if (TangoSupport_calculateRelativePose(
+            image->timestamp, TANGO_COORDINATE_FRAME_CAMERA_COLOR,
+            job_point_cloud_.timestamp, TANGO_COORDINATE_FRAME_CAMERA_DEPTH,
+            &color_camera_T_point_cloud) != TANGO_SUCCESS ||
+        color_camera_T_point_cloud.status_code != TANGO_POSE_VALID) {
+      continue;
+    }
+
+    if (tiles_version_ != geometry_.version ||
+        tiles_tile_count_ != tile_count_) {
+      CreateTiles();
+    }
+    if (tiles_.empty()) {
+      continue;
+    }
+    job_point_cloud_.xyz_count = job_points_.size() / 3;
+    job_point_cloud_.xyz = reinterpret_cast<float(*)[3]>(job_points_.data());
+
+    const uint32_t width = geometry_.intrinsics.width;
+    const uint32_t height = geometry_.intrinsics.height;
+    writing_->width = width;
+    writing_->height = height;
+    writing_->depths.resize(width * height);
+    writing_->grayscale.resize(width * height);
+    pool_->ParallelFor(tiles_.size(), [&](size_t index) {
+      UpsampleTile(index, image, color_camera_T_point_cloud);
+    });
+
+    uint32_t covered_count = 0;
+    for (const Tile& tile : tiles_) {
+      covered_count += tile.covered_count;
+    }
+    writing_->point_cloud_timestamp = job_point_cloud_.timestamp;
+    writing_->image_timestamp = image->timestamp;
+    writing_->worker_time = std::chrono::duration<double, std::milli>(
+                                std::chrono::steady_clock::now() - start)
+                                .count();
+    writing_->coverage = static_cast<double>(covered_count) / (width * height);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::swap(writing_, ready_);
+    has_new_result_ = true;
+  }
+  pool_.reset();
+}
+
+void BilateralUpsampler::CreateTiles() {
+  FreeTiles();
+  tiles_version_ = geometry_.version;
+  tiles_tile_count_ = tile_count_;
+  const int width = geometry_.intrinsics.width;
+  const int height = geometry_.intrinsics.height;
+  if (width <= 0 || height <= 0) {
+    return;
+  }
+  const int tile_count = std::max(
+      1, std::min(tiles_tile_count_ > 0 ? tiles_tile_count_ : thread_count_,
+                  height / kMinRowsPerTile));
+  // The tiles are never moved once created, their interpolators referring to
+  // their intrinsics.
+  tiles_.resize(tile_count);
+  for (int i = 0; i < tile_count; ++i) {
+    Tile& tile = tiles_[i];
+    tile.row_begin = height * i / tile_count;
+    tile.row_end = height * (i + 1) / tile_count;
+    // Even, so the chroma rows of the tile start with a pair of rows.
+    tile.image_row_begin = std::max(tile.row_begin - kTileOverlap, 0) & ~1;
+    tile.image_row_end = std::min(tile.row_end + kTileOverlap, height);
+    const int tile_height = tile.image_row_end - tile.image_row_begin;
+
+    tile.intrinsics = geometry_.intrinsics;
+    tile.intrinsics.height = tile_height;
+    tile.intrinsics.cy -= tile.image_row_begin;
+    tile.interpolator = nullptr;
+    tile.depth_buffer.depths = nullptr;
+    if (TangoSupport_createDepthInterpolator(&tile.intrinsics,
+                                             &tile.interpolator) !=
+            TANGO_SUCCESS ||
+        TangoSupport_initializeDepthBuffer(width, tile_height,
+                                           &tile.depth_buffer) !=
+            TANGO_SUCCESS) {
+      LOGE("BilateralUpsampler: Failed to create the tile of rows %d to %d.",
+           tile.row_begin, tile.row_end);
+      FreeTiles();
+      return;
+    }
+
+    // NV21, the interleaved VU plane at half the height after the Y plane.
+    const int stride = (width + 1) & ~1;
+    tile.image_data.resize(stride * (tile_height + (tile_height + 1) / 2));
+    tile.image.width = width;
+    tile.image.height = tile_height;
+    tile.image.stride = stride;
+    tile.image.timestamp = 0.0;
+    tile.image.frame_number = 0;
+    tile.image.format = TANGO_HAL_PIXEL_FORMAT_YCrCb_420_SP;
+    tile.image.data = tile.image_data.data();
+    tile.covered_count = 0;
+  }
+}
+
+void BilateralUpsampler::FreeTiles() {
+  for (Tile& tile : tiles_) {
+    if (tile.interpolator != nullptr) {
+      TangoSupport_freeDepthInterpolator(tile.interpolator);
+    }
+    if (tile.depth_buffer.depths != nullptr) {
+      TangoSupport_freeDepthBuffer(&tile.depth_buffer);
+    }
+  }
+  tiles_.clear();
+}
+
+void BilateralUpsampler::UpsampleTile(
+    size_t index, const TangoImageBuffer* image,
+    const TangoPoseData& color_camera_T_point_cloud) {
+  TANGO_TRACE_SCOPE("BilateralUpsampler::UpsampleTile");
+  Tile& tile = tiles_[index];
+  CopyImageRows(image, &tile);
+  tile.image.timestamp = image->timestamp;
+  tile.image.frame_number = image->frame_number;
+  const bool is_upsampled =
+      TangoSupport_upsampleImageBilateral(
+          tile.interpolator, approximate_ ? 1 : 0, &job_point_cloud_,
+          &tile.image, &color_camera_T_point_cloud, &tile.depth_buffer) ==
+      TANGO_SUCCESS;
+
+  // Only the rows of the tile are kept, the overlap being written by the
+  // neighbours.
+  const int width = tile.image.width;
+  uint32_t covered_count = 0;
+  for (int y = tile.row_begin; y < tile.row_end; ++y) {
+    float* depth_row = writing_->depths.data() + y * width;
+    uint8_t* grayscale_row = writing_->grayscale.data() + y * width;
+    if (!is_upsampled) {
+      std::fill(depth_row, depth_row + width, 0.0f);
+      std::fill(grayscale_row, grayscale_row + width, 0);
+      continue;
+    }
+    const float* tile_row =
+        tile.depth_buffer.depths + (y - tile.image_row_begin) * width;
+    for (int x = 0; x < width; ++x) {
+      const float depth = tile_row[x];
+      depth_row[x] = depth;
+      grayscale_row[x] = ToGrayscale(depth, depth_to_grayscale_);
+      covered_count += depth > 0.0f ? 1 : 0;
+    }
+  }
+  tile.covered_count = covered_count;
+}
+
+void BilateralUpsampler::CopyImageRows(const TangoImageBuffer* image,
+                                       Tile* tile) const {
+  const int width = tile->image.width;
+  const int height = tile->image.height;
+  const int stride = tile->image.stride;
+  const int divisor = geometry_.image_divisor;
+  const int region_x = geometry_.region_x;
+  const int max_x = static_cast<int>(image->width) - 1;
+  const int max_y = static_cast<int>(image->height) - 1;
+  uint8_t* y_plane = tile->image_data.data();
+  uint8_t* vu_plane = y_plane + stride * height;
+  const uint8_t* source_vu_plane = image->data + image->stride * image->height;
+
+  for (int y = 0; y < height; ++y) {
+    const int source_y = std::min(
+        geometry_.region_y + (tile->image_row_begin + y) * divisor, max_y);
+    const uint8_t* source_row = image->data + source_y * image->stride;
+    uint8_t* row = y_plane + y * stride;
+    if (divisor == 1 && region_x + width - 1 <= max_x) {
+      std::memcpy(row, source_row + region_x, width);
+      continue;
+    }
+    for (int x = 0; x < width; ++x) {
+      row[x] = source_row[std::min(region_x + x * divisor, max_x)];
+    }
+  }
+
+  // A VU pair for every 2x2 pixels, taken from the pair of the source pixel
+  // of the top left one.
+  for (int y = 0; 2 * y < height; ++y) {
+    const int source_y = std::min(
+        geometry_.region_y + (tile->image_row_begin + 2 * y) * divisor, max_y);
+    const uint8_t* source_row = source_vu_plane + source_y / 2 * image->stride;
+    uint8_t* row = vu_plane + y * stride;
+    for (int x = 0; 2 * x < width; ++x) {
+      const int source_x =
+          std::min(region_x + 2 * x * divisor, max_x) / 2 * 2;
+      row[2 * x] = source_row[source_x];
+      row[2 * x + 1] = source_row[source_x + 1];
+    }
+  }
+}
+
+}  // namespace rgb_depth_sync
@@ -16,18 +16,14 @@
 
 #include <rgb-depth-sync/camera_texture_drawable.h>
 
-namespace {
-const GLfloat kVertices[] = {-1.0, 1.0, 0.0, -1.0, -1.0, 0.0,
-                             1.0,  1.0, 0.0, 1.0,  -1.0, 0.0};
-
-const GLushort kIndices[] = {0, 1, 2, 2, 1, 3};
-
-const GLfloat kTextureCoords[] = {0.0, 0.0, 0.0, 1.0, 1.0, 0.0, 1.0, 1.0};
-}  // namespace
+#include <tango-gl/gl_state.h>
 
 namespace rgb_depth_sync {
 
-CameraTextureDrawable::CameraTextureDrawable() : shader_program_(0) {}
+CameraTextureDrawable::CameraTextureDrawable()
+    : depth_region_(0.0f, 0.0f, 1.0f, 1.0f),
+      depth_encoding_(kGrayscaleDepth),
+      shader_program_(0) {}
 
 CameraTextureDrawable::~CameraTextureDrawable() {}
 
@@ -39,44 +35,20 @@ void CameraTextureDrawable::InitializeGL() {
     LOGE("Could not create shader program for CameraImageDrawable.");
   }
 
-  glGenBuffers(3, render_buffers_);
-  // Allocate vertices buffer.
-  glBindBuffer(GL_ARRAY_BUFFER, render_buffers_[0]);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * 3 * 4, kVertices,
-               GL_STATIC_DRAW);
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-  // Allocate triangle indices buffer.
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, render_buffers_[1]);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLushort) * 6, kIndices,
-               GL_STATIC_DRAW);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-
-  // Allocate texture coordinates buufer.
-  glBindBuffer(GL_ARRAY_BUFFER, render_buffers_[2]);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * 2 * 4, kTextureCoords,
-               GL_STATIC_DRAW);
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-  // Assign the vertices attribute data.
+  // A new context has none of the objects of the previous one.
+  quad_.InvalidateGlResources();
   attrib_vertices_ = glGetAttribLocation(shader_program_, "vertex");
-  glBindBuffer(GL_ARRAY_BUFFER, render_buffers_[0]);
-  glEnableVertexAttribArray(attrib_vertices_);
-  glVertexAttribPointer(attrib_vertices_, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-  // Assign the texture coordinates attribute data.
   attrib_texture_coords_ =
       glGetAttribLocation(shader_program_, "textureCoords");
-  glBindBuffer(GL_ARRAY_BUFFER, render_buffers_[2]);
-  glEnableVertexAttribArray(attrib_texture_coords_);
-  glVertexAttribPointer(attrib_texture_coords_, 2, GL_FLOAT, GL_FALSE, 0,
-                        nullptr);
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  quad_.SetAttributeLocations(attrib_vertices_, attrib_texture_coords_);
 
   color_texture_handle_ = glGetUniformLocation(shader_program_, "colorTexture");
   depth_texture_handle_ = glGetUniformLocation(shader_program_, "depthTexture");
   blend_alpha_handle_ = glGetUniformLocation(shader_program_, "blendAlpha");
+  depth_region_handle_ = glGetUniformLocation(shader_program_, "depthRegion");
+  depth_encoding_handle_ =
+      glGetUniformLocation(shader_program_, "depthEncoding");
+  max_depth_handle_ = glGetUniformLocation(shader_program_, "maxDepth");
 }
 
 void CameraTextureDrawable::RenderImage() {
@@ -84,11 +56,14 @@ void CameraTextureDrawable::RenderImage() {
     InitializeGL();
   }
 
-  glDisable(GL_DEPTH_TEST);
+  tango_gl::GlState::Disable(GL_DEPTH_TEST);
 
-  glUseProgram(shader_program_);
+  tango_gl::GlState::UseProgram(shader_program_);
 
   glUniform1f(blend_alpha_handle_, blend_alpha_);
+  glUniform4fv(depth_region_handle_, 1, glm::value_ptr(depth_region_));
+  glUniform1f(depth_encoding_handle_, static_cast<float>(depth_encoding_));
+  glUniform1f(max_depth_handle_, DepthImage::GetMaxDepth());
 
   // Note that the Tango C-API update texture will bind the texture directly to
   // active texture, this is currently a bug in API, and because of that, we are
@@ -104,26 +79,10 @@ void CameraTextureDrawable::RenderImage() {
   glBindTexture(GL_TEXTURE_2D, depth_texture_id_);
   glUniform1i(depth_texture_handle_, 1);
 
-  // Bind vertices buffer.
-  glBindBuffer(GL_ARRAY_BUFFER, render_buffers_[0]);
-  glEnableVertexAttribArray(attrib_vertices_);
-  glVertexAttribPointer(attrib_vertices_, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-  // Bind texture coordinates buffer.
-  glBindBuffer(GL_ARRAY_BUFFER, render_buffers_[2]);
-  glEnableVertexAttribArray(attrib_texture_coords_);
-  glVertexAttribPointer(attrib_texture_coords_, 2, GL_FLOAT, GL_FALSE, 0,
-                        nullptr);
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-  // Bind element array buffer.
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, render_buffers_[1]);
-  glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, 0);
-  tango_gl::util::CheckGlError("ColorCameraDrawable glDrawElements");
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-
-  glUseProgram(0);
+  quad_.Draw();
+  tango_gl::util::CheckGlError("ColorCameraDrawable Draw");
+
+  tango_gl::GlState::UseProgram(0);
   glActiveTexture(GL_TEXTURE0);
   tango_gl::util::CheckGlError("CameraTextureDrawable::render");
 }
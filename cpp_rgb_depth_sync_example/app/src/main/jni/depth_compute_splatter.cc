@@ -0,0 +1,518 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "rgb-depth-sync/depth_compute_splatter.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "tango-gl/gl_state.h"
+
+namespace {
+// GLES 3.0 and 3.1 enums, which gl2.h does not define.
+const GLenum kShaderStorageBuffer = 0x90D2;
+const GLenum kDynamicRead = 0x88E9;
+const GLenum kDynamicCopy = 0x88EA;
+const GLenum kGlR32f = 0x822E;
+const GLenum kWriteOnly = 0x88B9;
+const GLbitfield kShaderStorageBarrierBit = 0x2000;
+const GLbitfield kTextureFetchBarrierBit = 0x0008;
+const GLbitfield kBufferUpdateBarrierBit = 0x0200;
+const GLbitfield kMapReadBit = 0x0001;
+
+// Reductions in flight before their statistics must be available, older
+// ones are dropped rather than waited for.
+const size_t kReductionLatency = 3;
+
+// Invocations per work group of the projection, and most work groups, each
+// invocation looping over the points past them. The passes over the pixels
+// run in tiles of kTileSize x kTileSize.
+const int kSplatGroupSize = 128;
+const int kMaxSplatGroupCount = 256;
+const int kTileSize = 8;
+
+// The z-buffer value of a pixel without a point, above the bits of any
+// positive float.
+const uint32_t kNoDepth = 0xffffffffu;
+
+// A reduction is its depth count, the bits of its minimum and maximum depth,
+// and the sum of the depths in millimeters, which fits 32 bits for a million
+// pixels at 4 m.
+const int kReductionWordCount = 4;
+const GLsizeiptr kReductionSize = kReductionWordCount * sizeof(uint32_t);
+
+// Each point is 2 words of the quantized points, see
+// tango_gl::QuantizedPoints: x and y, then z and the padding, as
+// unpackSnorm2x16() reads normalized shorts.
+const char kSplatShader[] =
+    "#version 310 es\n"
+    "layout(local_size_x = %d) in;\n"
+    "layout(std430, binding = 0) readonly buffer Points {\n"
+    "  uint points[];\n"
+    "};\n"
+    "layout(std430, binding = 1) buffer Depths {\n"
+    "  uint depths[];\n"
+    "};\n"
+    "uniform int point_count;\n"
+    "uniform int point_stride;\n"
+    "uniform mat4 image_T_points;\n"
+    "uniform vec4 intrinsics;\n"
+    "uniform float max_depth;\n"
+    "uniform vec3 point_scale;\n"
+    "uniform vec3 point_offset;\n"
+    "uniform ivec2 image_size;\n"
+    "void main() {\n"
+    "  uint stride = gl_NumWorkGroups.x * gl_WorkGroupSize.x;\n"
+    "  for (uint i = gl_GlobalInvocationID.x; i < uint(point_count);\n"
+    "       i += stride) {\n"
+    "    uint index = 2u * i * uint(point_stride);\n"
+    "    vec2 xy = unpackSnorm2x16(points[index]);\n"
+    "    float z = unpackSnorm2x16(points[index + 1u]).x;\n"
+    "    vec3 point = point_offset + point_scale * vec3(xy, z);\n"
+    "    point = (image_T_points * vec4(point, 1.0)).xyz;\n"
+    // The near clipping plane of the GL_POINTS path.
+    "    if (point.z < 0.1) {\n"
+    "      continue;\n"
+    "    }\n"
+    "    ivec2 texel = ivec2(floor(intrinsics.xy * point.xy / point.z +\n"
+    "                              intrinsics.zw));\n"
+    "    if (any(lessThan(texel, ivec2(0))) ||\n"
+    "        any(greaterThanEqual(texel, image_size))) {\n"
+    "      continue;\n"
+    "    }\n"
+    "    atomicMin(depths[texel.y * image_size.x + texel.x],\n"
+    "              floatBitsToUint(min(point.z, max_depth)));\n"
+    "  }\n"
+    "}\n";
+
+const char kRowShader[] =
+    "#version 310 es\n"
+    "layout(local_size_x = %d, local_size_y = %d) in;\n"
+    "layout(std430, binding = 1) readonly buffer Depths {\n"
+    "  uint depths[];\n"
+    "};\n"
+    "layout(std430, binding = 2) writeonly buffer Rows {\n"
+    "  uint rows[];\n"
+    "};\n"
+    "uniform ivec2 image_size;\n"
+    "uniform int radius;\n"
+    "void main() {\n"
+    "  ivec2 texel = ivec2(gl_GlobalInvocationID.xy);\n"
+    "  if (any(greaterThanEqual(texel, image_size))) {\n"
+    "    return;\n"
+    "  }\n"
+    "  int row = texel.y * image_size.x;\n"
+    "  int end = min(texel.x + radius, image_size.x - 1);\n"
+    "  uint nearest = 0xffffffffu;\n"
+    "  for (int x = max(texel.x - radius, 0); x <= end; ++x) {\n"
+    "    nearest = min(nearest, depths[row + x]);\n"
+    "  }\n"
+    "  rows[row + texel.x] = nearest;\n"
+    "}\n";
+
+// Also resets the z-buffer, which the row pass is done reading, and reduces
+// the depths of the tile in shared memory before adding them to the
+// statistics.
+const char kColumnShader[] =
+    "#version 310 es\n"
+    "layout(local_size_x = %d, local_size_y = %d) in;\n"
+    "layout(std430, binding = 1) writeonly buffer Depths {\n"
+    "  uint depths[];\n"
+    "};\n"
+    "layout(std430, binding = 2) readonly buffer Rows {\n"
+    "  uint rows[];\n"
+    "};\n"
+    "layout(std430, binding = 3) buffer Statistics {\n"
+    "  uint depth_count;\n"
+    "  uint min_depth;\n"
+    "  uint max_depth;\n"
+    "  uint depth_sum;\n"
+    "};\n"
+    "layout(r32f, binding = 0) writeonly uniform highp image2D depth_image;\n"
+    "uniform ivec2 image_size;\n"
+    "uniform int radius;\n"
+    "shared uint tile_count;\n"
+    "shared uint tile_min;\n"
+    "shared uint tile_max;\n"
+    "shared uint tile_sum;\n"
+    "void main() {\n"
+    "  if (gl_LocalInvocationIndex == 0u) {\n"
+    "    tile_count = 0u;\n"
+    "    tile_min = 0xffffffffu;\n"
+    "    tile_max = 0u;\n"
+    "    tile_sum = 0u;\n"
+    "  }\n"
+    "  memoryBarrierShared();\n"
+    "  barrier();\n"
+    "  ivec2 texel = ivec2(gl_GlobalInvocationID.xy);\n"
+    "  if (all(lessThan(texel, image_size))) {\n"
+    "    int end = min(texel.y + radius, image_size.y - 1);\n"
+    "    uint nearest = 0xffffffffu;\n"
+    "    for (int y = max(texel.y - radius, 0); y <= end; ++y) {\n"
+    "      nearest = min(nearest, rows[y * image_size.x + texel.x]);\n"
+    "    }\n"
+    "    float depth =\n"
+    "        nearest == 0xffffffffu ? 0.0 : uintBitsToFloat(nearest);\n"
+    "    imageStore(depth_image, texel, vec4(depth, 0.0, 0.0, 1.0));\n"
+    "    depths[texel.y * image_size.x + texel.x] = 0xffffffffu;\n"
+    "    if (depth > 0.0) {\n"
+    "      atomicAdd(tile_count, 1u);\n"
+    "      atomicMin(tile_min, nearest);\n"
+    "      atomicMax(tile_max, nearest);\n"
+    "      atomicAdd(tile_sum, uint(depth * 1000.0 + 0.5));\n"
+    "    }\n"
+    "  }\n"
+    "  memoryBarrierShared();\n"
+    "  barrier();\n"
+    "  if (gl_LocalInvocationIndex == 0u && tile_count > 0u) {\n"
+    "    atomicAdd(depth_count, tile_count);\n"
+    "    atomicMin(min_depth, tile_min);\n"
+    "    atomicMax(max_depth, tile_max);\n"
+    "    atomicAdd(depth_sum, tile_sum);\n"
+    "  }\n"
+    "}\n";
+
+// The source of |shader|, a format string taking the work group size.
+std::string GetShaderSource(const char* shader, int size_x, int size_y) {
+  std::vector<char> source(strlen(shader) + 32);
+  snprintf(source.data(), source.size(), shader, size_x, size_y);
+  return std::string(source.data());
+}
+
+float DepthFromBits(uint32_t bits) {
+  float depth;
+  memcpy(&depth, &bits, sizeof(depth));
+  return depth;
+}
+
+GLuint GetGroupCount(int size, int group_size) {
+  return static_cast<GLuint>((size + group_size - 1) / group_size);
+}
+}  // namespace
+
+namespace rgb_depth_sync {
+
+DepthComputeSplatter::DepthComputeSplatter()
+    : gl_initialized_(false),
+      is_supported_(false),
+      dispatch_compute_(NULL),
+      memory_barrier_(NULL),
+      bind_buffer_base_(NULL),
+      bind_image_texture_(NULL),
+      tex_storage_2d_(NULL),
+      map_buffer_range_(NULL),
+      unmap_buffer_(NULL),
+      fence_sync_(NULL),
+      client_wait_sync_(NULL),
+      delete_sync_(NULL),
+      splat_program_(0),
+      row_program_(0),
+      column_program_(0),
+      point_count_location_(-1),
+      point_stride_location_(-1),
+      image_T_points_location_(-1),
+      intrinsics_location_(-1),
+      max_depth_location_(-1),
+      point_scale_location_(-1),
+      point_offset_location_(-1),
+      splat_size_location_(-1),
+      row_size_location_(-1),
+      row_radius_location_(-1),
+      column_size_location_(-1),
+      column_radius_location_(-1),
+      width_(0),
+      height_(0),
+      is_allocated_(false),
+      texture_(0),
+      depth_buffer_(0),
+      row_buffer_(0),
+      next_reduction_(0),
+      has_statistics_(false),
+      latest_statistics_() {}
+
+DepthComputeSplatter::~DepthComputeSplatter() {}
+
+void DepthComputeSplatter::SetImageSize(int width, int height) {
+  if (width == width_ && height == height_) {
+    return;
+  }
+  width_ = width;
+  height_ = height;
+  is_allocated_ = false;
+}
+
+bool DepthComputeSplatter::InitializeGl() {
+  if (gl_initialized_) {
+    return is_supported_;
+  }
+  gl_initialized_ = true;
+  is_supported_ = false;
+  const tango_gl::util::GlCapabilities& gl =
+      tango_gl::util::GetGlCapabilities();
+  if (!gl.IsGles31()) {
+    LOGI("DepthComputeSplatter: compute shaders are not supported");
+    return false;
+  }
+
+  dispatch_compute_ = gl.dispatch_compute;
+  memory_barrier_ = gl.memory_barrier;
+  bind_buffer_base_ = gl.bind_buffer_base;
+  bind_image_texture_ = gl.bind_image_texture;
+  tex_storage_2d_ = gl.tex_storage_2d;
+  map_buffer_range_ = gl.map_buffer_range;
+  unmap_buffer_ = gl.unmap_buffer;
+  fence_sync_ = gl.fence_sync;
+  client_wait_sync_ = gl.client_wait_sync;
+  delete_sync_ = gl.delete_sync;
+  if (dispatch_compute_ == NULL || memory_barrier_ == NULL ||
+      bind_buffer_base_ == NULL || bind_image_texture_ == NULL ||
+      tex_storage_2d_ == NULL || map_buffer_range_ == NULL ||
+      unmap_buffer_ == NULL || fence_sync_ == NULL ||
+      client_wait_sync_ == NULL || delete_sync_ == NULL) {
+    LOGE("DepthComputeSplatter: GLES 3.1 entry points are missing");
+    return false;
+  }
+
+  splat_program_ = tango_gl::util::CreateComputeProgram(
+      GetShaderSource(kSplatShader, kSplatGroupSize, 1).c_str());
+  row_program_ = tango_gl::util::CreateComputeProgram(
+      GetShaderSource(kRowShader, kTileSize, kTileSize).c_str());
+  column_program_ = tango_gl::util::CreateComputeProgram(
+      GetShaderSource(kColumnShader, kTileSize, kTileSize).c_str());
+  if (splat_program_ == 0 || row_program_ == 0 || column_program_ == 0) {
+    for (GLuint program : {splat_program_, row_program_, column_program_}) {
+      if (program != 0) {
+        tango_gl::GlState::DeleteProgram(program);
+      }
+    }
+    splat_program_ = 0;
+    row_program_ = 0;
+    column_program_ = 0;
+    return false;
+  }
+  point_count_location_ = glGetUniformLocation(splat_program_, "point_count");
+  point_stride_location_ =
+      glGetUniformLocation(splat_program_, "point_stride");
+  image_T_points_location_ =
+      glGetUniformLocation(splat_program_, "image_T_points");
+  intrinsics_location_ = glGetUniformLocation(splat_program_, "intrinsics");
+  max_depth_location_ = glGetUniformLocation(splat_program_, "max_depth");
+  point_scale_location_ = glGetUniformLocation(splat_program_, "point_scale");
+  point_offset_location_ =
+      glGetUniformLocation(splat_program_, "point_offset");
+  splat_size_location_ = glGetUniformLocation(splat_program_, "image_size");
+  row_size_location_ = glGetUniformLocation(row_program_, "image_size");
+  row_radius_location_ = glGetUniformLocation(row_program_, "radius");
+  column_size_location_ = glGetUniformLocation(column_program_, "image_size");
+  column_radius_location_ = glGetUniformLocation(column_program_, "radius");
+
+  reductions_.resize(kReductionLatency);
+  for (Reduction& reduction : reductions_) {
+    glGenBuffers(1, &reduction.buffer);
+    tango_gl::GlState::BindBuffer(kShaderStorageBuffer, reduction.buffer);
+    glBufferData(kShaderStorageBuffer, kReductionSize, NULL, kDynamicRead);
+    reduction.fence = NULL;
+    reduction.pixel_count = 0;
+  }
+  tango_gl::GlState::BindBuffer(kShaderStorageBuffer, 0);
+  next_reduction_ = 0;
+  is_allocated_ = false;
+  is_supported_ = true;
+  tango_gl::util::CheckGlError("DepthComputeSplatter::InitializeGl");
+  return true;
+}
+
+void DepthComputeSplatter::AllocateImage() {
+  // The storage of an image texture is immutable, a new size needs a new
+  // texture.
+  if (texture_ != 0) {
+    glDeleteTextures(1, &texture_);
+  }
+  glGenTextures(1, &texture_);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, texture_);
+  tex_storage_2d_(GL_TEXTURE_2D, 1, kGlR32f, width_, height_);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  // The z-buffer starts empty, the column pass empties it again after every
+  // image.
+  const std::vector<uint32_t> empty_depths(width_ * height_, kNoDepth);
+  const GLsizeiptr size = empty_depths.size() * sizeof(uint32_t);
+  if (depth_buffer_ == 0) {
+    glGenBuffers(1, &depth_buffer_);
+    glGenBuffers(1, &row_buffer_);
+  }
+  tango_gl::GlState::BindBuffer(kShaderStorageBuffer, depth_buffer_);
+  glBufferData(kShaderStorageBuffer, size, empty_depths.data(), kDynamicCopy);
+  tango_gl::GlState::BindBuffer(kShaderStorageBuffer, row_buffer_);
+  glBufferData(kShaderStorageBuffer, size, NULL, kDynamicCopy);
+  tango_gl::GlState::BindBuffer(kShaderStorageBuffer, 0);
+  is_allocated_ = true;
+  LOGI("DepthComputeSplatter: depth image of %dx%d in R32F", width_, height_);
+}
+
+bool DepthComputeSplatter::Splat(
+    GLuint points_buffer, const tango_gl::QuantizedPoints& quantized_points,
+    const glm::mat4& image_T_points, const glm::vec4& intrinsics,
+    int point_stride, int window_size, float max_depth) {
+  if (!InitializeGl()) {
+    return false;
+  }
+  if (width_ <= 0 || height_ <= 0) {
+    return true;
+  }
+  if (!is_allocated_) {
+    AllocateImage();
+  }
+  ReadReductions();
+
+  // A reduction whose statistics are still not available after
+  // kReductionLatency others is dropped.
+  Reduction& reduction = reductions_[next_reduction_];
+  next_reduction_ = (next_reduction_ + 1) % reductions_.size();
+  if (reduction.fence != NULL) {
+    delete_sync_(reduction.fence);
+    reduction.fence = NULL;
+  }
+  reduction.pixel_count = static_cast<uint32_t>(width_ * height_);
+  const uint32_t empty_reduction[kReductionWordCount] = {0, kNoDepth, 0, 0};
+  tango_gl::GlState::BindBuffer(kShaderStorageBuffer, reduction.buffer);
+  glBufferSubData(kShaderStorageBuffer, 0, kReductionSize, empty_reduction);
+  tango_gl::GlState::BindBuffer(kShaderStorageBuffer, 0);
+
+  const int point_count =
+      (quantized_points.GetCount() + point_stride - 1) / point_stride;
+  bind_buffer_base_(kShaderStorageBuffer, 0, points_buffer);
+  bind_buffer_base_(kShaderStorageBuffer, 1, depth_buffer_);
+  bind_buffer_base_(kShaderStorageBuffer, 2, row_buffer_);
+  bind_buffer_base_(kShaderStorageBuffer, 3, reduction.buffer);
+  bind_image_texture_(0, texture_, 0, GL_FALSE, 0, kWriteOnly, kGlR32f);
+
+  if (point_count > 0) {
+    tango_gl::GlState::UseProgram(splat_program_);
+    glUniform1i(point_count_location_, point_count);
+    glUniform1i(point_stride_location_, point_stride);
+    glUniformMatrix4fv(image_T_points_location_, 1, GL_FALSE,
+                       glm::value_ptr(image_T_points));
+    glUniform4fv(intrinsics_location_, 1, glm::value_ptr(intrinsics));
+    glUniform1f(max_depth_location_, max_depth);
+    glUniform3fv(point_scale_location_, 1,
+                 glm::value_ptr(quantized_points.GetScale()));
+    glUniform3fv(point_offset_location_, 1,
+                 glm::value_ptr(quantized_points.GetOffset()));
+    glUniform2i(splat_size_location_, width_, height_);
+    dispatch_compute_(std::min<GLuint>(GetGroupCount(point_count,
+                                                     kSplatGroupSize),
+                                       kMaxSplatGroupCount),
+                      1, 1);
+    memory_barrier_(kShaderStorageBarrierBit);
+  }
+
+  const GLuint group_count_x = GetGroupCount(width_, kTileSize);
+  const GLuint group_count_y = GetGroupCount(height_, kTileSize);
+  tango_gl::GlState::UseProgram(row_program_);
+  glUniform2i(row_size_location_, width_, height_);
+  glUniform1i(row_radius_location_, window_size);
+  dispatch_compute_(group_count_x, group_count_y, 1);
+  memory_barrier_(kShaderStorageBarrierBit);
+
+  tango_gl::GlState::UseProgram(column_program_);
+  glUniform2i(column_size_location_, width_, height_);
+  glUniform1i(column_radius_location_, window_size);
+  dispatch_compute_(group_count_x, group_count_y, 1);
+  // The texture is sampled by the scene, the z-buffer is splatted into by
+  // the next image and the statistics are read with glMapBufferRange().
+  memory_barrier_(kTextureFetchBarrierBit | kShaderStorageBarrierBit |
+                  kBufferUpdateBarrierBit);
+  reduction.fence = fence_sync_(
+      tango_gl::util::GlCapabilities::kSyncGpuCommandsComplete, 0);
+
+  for (GLuint binding = 0; binding < 4; ++binding) {
+    bind_buffer_base_(kShaderStorageBuffer, binding, 0);
+  }
+  tango_gl::GlState::UseProgram(0);
+  tango_gl::util::CheckGlError("DepthComputeSplatter::Splat");
+  return true;
+}
+
+bool DepthComputeSplatter::GetLatestStatistics(
+    DepthImageStatistics* statistics) const {
+  if (!has_statistics_) {
+    return false;
+  }
+  *statistics = latest_statistics_;
+  return true;
+}
+
+void DepthComputeSplatter::ReadReductions() {
+  // Reductions finish in order, oldest first, so the later ones are not done
+  // when one is not.
+  for (size_t i = 0; i < reductions_.size(); ++i) {
+    Reduction& reduction =
+        reductions_[(next_reduction_ + i) % reductions_.size()];
+    if (reduction.fence == NULL) {
+      continue;
+    }
+    const GLenum status = client_wait_sync_(
+        reduction.fence, tango_gl::util::GlCapabilities::kSyncFlushCommandsBit,
+        0);
+    if (status != tango_gl::util::GlCapabilities::kAlreadySignaled &&
+        status != tango_gl::util::GlCapabilities::kConditionSatisfied) {
+      break;
+    }
+    delete_sync_(reduction.fence);
+    reduction.fence = NULL;
+
+    tango_gl::GlState::BindBuffer(kShaderStorageBuffer, reduction.buffer);
+    const uint32_t* words = static_cast<const uint32_t*>(map_buffer_range_(
+        kShaderStorageBuffer, 0, kReductionSize, kMapReadBit));
+    if (words != NULL) {
+      DepthImageStatistics& statistics = latest_statistics_;
+      statistics.depth_count = words[0];
+      statistics.pixel_count = reduction.pixel_count;
+      const bool has_depth = words[0] > 0;
+      statistics.min_depth = has_depth ? DepthFromBits(words[1]) : 0.0f;
+      statistics.max_depth = has_depth ? DepthFromBits(words[2]) : 0.0f;
+      statistics.mean_depth =
+          has_depth ? 0.001f * words[3] / words[0] : 0.0f;
+      unmap_buffer_(kShaderStorageBuffer);
+      has_statistics_ = true;
+    }
+    tango_gl::GlState::BindBuffer(kShaderStorageBuffer, 0);
+  }
+  tango_gl::util::CheckGlError("DepthComputeSplatter::ReadReductions");
+}
+
+void DepthComputeSplatter::InvalidateGlResources() {
+  splat_program_ = 0;
+  row_program_ = 0;
+  column_program_ = 0;
+  texture_ = 0;
+  depth_buffer_ = 0;
+  row_buffer_ = 0;
+  reductions_.clear();
+  next_reduction_ = 0;
+  is_allocated_ = false;
+  gl_initialized_ = false;
+  is_supported_ = false;
+}
+}  // namespace rgb_depth_sync
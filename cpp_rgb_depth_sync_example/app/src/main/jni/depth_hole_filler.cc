@@ -0,0 +1,262 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include <tango-gl/gl_state.h>
+
+#include "rgb-depth-sync/depth_hole_filler.h"
+
+namespace {
+const char kFillVertexShader[] =
+    "precision highp float;\n"
+    "attribute vec2 vertex;\n"
+    "varying vec2 v_uv;\n"
+    "void main() {\n"
+    "  v_uv = 0.5 * vertex + 0.5;\n"
+    "  gl_Position = vec4(vertex, 0.0, 1.0);\n"
+    "}\n";
+
+// One pass of the joint bilateral filter, along |tapStep|. The loop bound is
+// DepthHoleFiller::kMaxRadius.
+const char kFillFragmentShader[] =
+    "#extension GL_OES_EGL_image_external : require\n"
+    "precision highp float;\n"
+    "uniform sampler2D depthTexture;\n"
+    "uniform samplerExternalOES colorTexture;\n"
+    "uniform vec2 tapStep;\n"
+    "uniform float radius;\n"
+    "uniform float spatialScale;\n"
+    "uniform float colorScale;\n"
+    "uniform float packOutput;\n"
+    "uniform vec4 colorRegion;\n"
+    "varying vec2 v_uv;\n"
+    "vec3 ColorAt(vec2 uv) {\n"
+    "  vec2 colorUv = colorRegion.xy + uv * colorRegion.zw;\n"
+    "  return texture2D(colorTexture, colorUv).rgb;\n"
+    "}\n"
+    "void main() {\n"
+    "  vec3 center = ColorAt(v_uv);\n"
+    "  float sum = 0.0;\n"
+    "  float weightSum = 0.0;\n"
+    "  for (int i = -8; i <= 8; ++i) {\n"
+    "    float tap = float(i);\n"
+    "    if (abs(tap) > radius) {\n"
+    "      continue;\n"
+    "    }\n"
+    "    vec2 uv = v_uv + tap * tapStep;\n"
+    "    vec4 depth = texture2D(depthTexture, uv);\n"
+    "    vec3 colorOffset = ColorAt(uv) - center;\n"
+    "    float weight = depth.a * exp(spatialScale * tap * tap +\n"
+    "        colorScale * dot(colorOffset, colorOffset));\n"
+    "    sum += weight * (depth.r + depth.g / 255.0);\n"
+    "    weightSum += weight;\n"
+    "  }\n"
+    "  if (weightSum <= 0.0) {\n"
+    "    gl_FragColor = vec4(0.0);\n"
+    "    return;\n"
+    "  }\n"
+    "  float depth = sum / weightSum;\n"
+    "  if (packOutput > 0.5) {\n"
+    "    float scaled = depth * 255.0;\n"
+    "    gl_FragColor = vec4(floor(scaled) / 255.0, fract(scaled), 0.0, 1.0);\n"
+    "  } else {\n"
+    "    gl_FragColor = vec4(depth, depth, depth, 1.0);\n"
+    "  }\n"
+    "}\n";
+}  // namespace
+
+namespace rgb_depth_sync {
+
+DepthHoleFiller::Kernel::Kernel()
+    : point_size(3.0f),
+      radius(6),
+      tap_spacing(2.0f),
+      spatial_sigma(3.0f),
+      color_sigma(0.1f) {}
+
+DepthHoleFiller::DepthHoleFiller()
+    : width_(0),
+      height_(0),
+      color_region_(0.0f, 0.0f, 1.0f, 1.0f),
+      is_allocated_(false) {
+  InvalidateGlResources();
+}
+
+void DepthHoleFiller::SetKernel(const Kernel& kernel) {
+  kernel_ = kernel;
+  kernel_.radius = std::min(std::max(kernel_.radius, 0), kMaxRadius);
+  // The taps then land on texel centers, where the bilinear filter of the
+  // output texture returns the packed depth unchanged.
+  kernel_.tap_spacing =
+      std::max(std::floor(kernel_.tap_spacing + 0.5f), 1.0f);
+}
+
+void DepthHoleFiller::SetImageSize(int width, int height) {
+  if (width == width_ && height == height_) {
+    return;
+  }
+  width_ = width;
+  height_ = height;
+  is_allocated_ = false;
+}
+
+void DepthHoleFiller::InvalidateGlResources() {
+  is_allocated_ = false;
+  program_ = 0;
+  vertex_handle_ = -1;
+  depth_texture_handle_ = -1;
+  color_texture_handle_ = -1;
+  tap_step_handle_ = -1;
+  radius_handle_ = -1;
+  spatial_scale_handle_ = -1;
+  color_scale_handle_ = -1;
+  pack_output_handle_ = -1;
+  color_region_handle_ = -1;
+  quad_.InvalidateGlResources();
+  textures_[0] = textures_[1] = 0;
+  framebuffers_[0] = framebuffers_[1] = 0;
+  depth_renderbuffer_ = 0;
+}
+
+bool DepthHoleFiller::InitializeGl() {
+  if (program_ == 0) {
+    const tango_gl::util::SharedProgram* program =
+        tango_gl::util::GetSharedProgram(kFillVertexShader,
+                                         kFillFragmentShader);
+    if (program == nullptr) {
+      LOGE("DepthHoleFiller: Could not create the fill program.");
+      return false;
+    }
+    program_ = program->GetId();
+    vertex_handle_ = program->GetAttribLocation("vertex");
+    depth_texture_handle_ = program->GetUniformLocation("depthTexture");
+    color_texture_handle_ = program->GetUniformLocation("colorTexture");
+    tap_step_handle_ = program->GetUniformLocation("tapStep");
+    radius_handle_ = program->GetUniformLocation("radius");
+    spatial_scale_handle_ = program->GetUniformLocation("spatialScale");
+    color_scale_handle_ = program->GetUniformLocation("colorScale");
+    pack_output_handle_ = program->GetUniformLocation("packOutput");
+    color_region_handle_ = program->GetUniformLocation("colorRegion");
+    // The shader derives its texture coordinates from the positions, the
+    // depth images not being flipped like the camera images.
+    quad_.SetAttributeLocations(vertex_handle_, -1);
+
+    glGenTextures(2, textures_);
+    glGenFramebuffers(2, framebuffers_);
+    glGenRenderbuffers(1, &depth_renderbuffer_);
+  }
+  if (is_allocated_) {
+    return true;
+  }
+
+  // Packed depths must not be interpolated, every tap reads a single pixel.
+  // The output, in textures_[0], is bilinearly filtered for display, which
+  // only taps on texel centers allow.
+  glActiveTexture(GL_TEXTURE0);
+  for (int i = 0; i < 2; ++i) {
+    const GLint filter = i == 0 ? GL_LINEAR : GL_NEAREST;
+    glBindTexture(GL_TEXTURE_2D, textures_[i]);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width_, height_, 0, GL_RGBA,
+                 GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffers_[i]);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                           textures_[i], 0);
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  glBindRenderbuffer(GL_RENDERBUFFER, depth_renderbuffer_);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT16, width_,
+                        height_);
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffers_[0]);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                            GL_RENDERBUFFER, depth_renderbuffer_);
+  const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  if (status != GL_FRAMEBUFFER_COMPLETE) {
+    LOGE("DepthHoleFiller: Incomplete splat framebuffer: 0x%x", status);
+    return false;
+  }
+  tango_gl::util::CheckGlError("DepthHoleFiller::InitializeGl");
+  is_allocated_ = true;
+  return true;
+}
+
+bool DepthHoleFiller::BeginSplat() {
+  if (width_ <= 0 || height_ <= 0 || !InitializeGl()) {
+    return false;
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffers_[0]);
+  glViewport(0, 0, width_, height_);
+  glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  tango_gl::GlState::Disable(GL_BLEND);
+  tango_gl::GlState::Enable(GL_DEPTH_TEST);
+  return true;
+}
+
+GLuint DepthHoleFiller::Fill(GLuint color_texture_id) {
+  tango_gl::GlState::Disable(GL_DEPTH_TEST);
+  tango_gl::GlState::UseProgram(program_);
+  glUniform1f(radius_handle_, static_cast<float>(kernel_.radius));
+  const float spatial_sigma = std::max(kernel_.spatial_sigma, 1e-3f);
+  const float color_sigma = std::max(kernel_.color_sigma, 1e-3f);
+  glUniform1f(spatial_scale_handle_,
+              -0.5f / (spatial_sigma * spatial_sigma));
+  glUniform1f(color_scale_handle_, -0.5f / (color_sigma * color_sigma));
+  glUniform4fv(color_region_handle_, 1, glm::value_ptr(color_region_));
+
+  // Horizontally from the splats, then vertically back into textures_[0].
+  RunPass(textures_[0], framebuffers_[1], color_texture_id,
+          kernel_.tap_spacing / width_, 0.0f, true);
+  RunPass(textures_[1], framebuffers_[0], color_texture_id, 0.0f,
+          kernel_.tap_spacing / height_, false);
+
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glActiveTexture(GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_EXTERNAL_OES, 0);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  tango_gl::GlState::UseProgram(0);
+  tango_gl::util::CheckGlError("DepthHoleFiller::Fill");
+  return textures_[0];
+}
+
+void DepthHoleFiller::RunPass(GLuint source_texture, GLuint framebuffer,
+                              GLuint color_texture_id, float step_x,
+                              float step_y, bool pack_output) {
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  glViewport(0, 0, width_, height_);
+
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, source_texture);
+  glUniform1i(depth_texture_handle_, 0);
+  glActiveTexture(GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_EXTERNAL_OES, color_texture_id);
+  glUniform1i(color_texture_handle_, 1);
+
+  glUniform2f(tap_step_handle_, step_x, step_y);
+  glUniform1f(pack_output_handle_, pack_output ? 1.0f : 0.0f);
+  quad_.Draw();
+}
+
+}  // namespace rgb_depth_sync
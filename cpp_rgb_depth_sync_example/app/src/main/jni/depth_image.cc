@@ -14,149 +14,409 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
 #include "tango-gl/conversions.h"
 #include "tango-gl/camera.h"
+#include "tango-gl/gl_state.h"
 
 #include "rgb-depth-sync/depth_image.h"
 
 namespace {
-const std::string kPointCloudVertexShader =
+typedef std::chrono::steady_clock Clock;
+
+// Rows of the CPU splats the coverage is sampled on, one in this many.
+const int kCoverageRowStride = 8;
+
+// Names of the DepthImage::Mode values, in order.
+const char* const kModeNames[] = {"CPU splat", "GPU splat", "GPU filled",
+                                  "CPU bilateral", "GPU compute"};
+
+double MillisecondsSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+// @return the fraction of the pixels of one row out of kCoverageRowStride
+// with a depth.
+double SampleCoverage(const std::vector<float>& depths, int width,
+                      int height) {
+  uint32_t covered_count = 0;
+  uint32_t sampled_count = 0;
+  for (int y = 0; y < height; y += kCoverageRowStride) {
+    const float* row = depths.data() + y * width;
+    for (int x = 0; x < width; ++x) {
+      covered_count += row[x] > 0.0f ? 1 : 0;
+    }
+    sampled_count += width;
+  }
+  return sampled_count > 0
+             ? static_cast<double>(covered_count) / sampled_count
+             : 0.0;
+}
+
+// The points are uploaded quantized, see tango_gl::QuantizedPoints.
+const char kPointCloudVertexShader[] =
     "precision mediump float;\n"
     "\n"
-    "attribute vec4 vertex;\n"
+    "attribute highp vec4 vertex;\n"
     "\n"
     "uniform mat4 mvp;\n"
     "uniform float maxdepth;\n"
     "uniform float pointsize;\n"
     "\n"
-    "varying vec4 v_color;\n"
+    "varying highp float v_depth;\n"
     "\n"
+    TANGO_GL_GLSL_DEQUANTIZE_POINT
     "void main() {\n"
+    "  highp vec4 position = DequantizePoint(vertex);\n"
     "  gl_PointSize = pointsize;\n"
-    "  gl_Position = mvp*vertex;\n"
-    "  float depth = clamp(vertex.z / maxdepth, 0.0, 1.0);\n"
-    "  v_color = vec4(depth, depth, depth, 1.0);\n"
+    "  gl_Position = mvp*position;\n"
+    "  v_depth = clamp(position.z / maxdepth, 0.0, 1.0);\n"
     "}\n";
-const std::string kPointCloudFragmentShader =
-    "precision mediump float;\n"
+// The depth is written in meters to a half float texture, or packed in 16
+// bits for the hole filling path and the textures without half floats.
+const char kPointCloudFragmentShader[] =
+    "precision highp float;\n"
     "\n"
-    "varying vec4 v_color;\n"
+    "uniform float packdepth;\n"
+    "uniform float depthscale;\n"
+    "varying highp float v_depth;\n"
+    RGB_DEPTH_SYNC_GLSL_PACK_DEPTH
     "void main() {\n"
-    "  gl_FragColor = v_color;\n"
+    "  if (packdepth > 0.5) {\n"
+    "    gl_FragColor = PackDepth(v_depth);\n"
+    "  } else {\n"
+    "    gl_FragColor = vec4(v_depth * depthscale, 0.0, 0.0, 1.0);\n"
+    "  }\n"
     "}\n";
+
+// Not in the GLES2 headers.
+const GLenum kGlRed = 0x1903;
+const GLenum kGlRg = 0x8227;
+const GLenum kGlR16f = 0x822D;
+const GLenum kGlRg8 = 0x822B;
+const GLenum kGlHalfFloat = 0x140B;
+
+// A format of the GPU depth texture, from the most compact.
+struct DepthTextureFormat {
+  GLint internal_format;
+  GLenum format;
+  GLenum type;
+  rgb_depth_sync::DepthEncoding encoding;
+  const char* name;
+};
+
+// @return the formats the context may render the depth to, in order of
+// preference. RGBA8 is always renderable.
+std::vector<DepthTextureFormat> GetDepthTextureFormats() {
+  const tango_gl::util::GlCapabilities& gl =
+      tango_gl::util::GetGlCapabilities();
+  std::vector<DepthTextureFormat> formats;
+  if (gl.IsGles3() &&
+      (tango_gl::util::IsGlExtensionSupported(
+           "GL_EXT_color_buffer_half_float") ||
+       tango_gl::util::IsGlExtensionSupported("GL_EXT_color_buffer_float"))) {
+    formats.push_back({static_cast<GLint>(kGlR16f), kGlRed, kGlHalfFloat,
+                       rgb_depth_sync::kMetricDepth, "R16F"});
+  }
+  if (gl.IsGles3()) {
+    formats.push_back({static_cast<GLint>(kGlRg8), kGlRg, GL_UNSIGNED_BYTE,
+                       rgb_depth_sync::kPackedDepth, "RG8"});
+  } else if (tango_gl::util::IsGlExtensionSupported("GL_EXT_texture_rg")) {
+    // GLES2 takes the format as the internal format.
+    formats.push_back({static_cast<GLint>(kGlRg), kGlRg, GL_UNSIGNED_BYTE,
+                       rgb_depth_sync::kPackedDepth, "RG8"});
+  }
+  formats.push_back({GL_RGBA, GL_RGBA, GL_UNSIGNED_BYTE,
+                     rgb_depth_sync::kPackedDepth, "RGBA8"});
+  return formats;
+}
 }  // namespace
 
 namespace rgb_depth_sync {
 
+const float DepthImage::kMaxTranslationChange = 0.001f;
+const float DepthImage::kMaxRotationChange = 0.001f;
+
 DepthImage::DepthImage()
     : texture_id_(0),
-      cpu_texture_id_(0),
+      texture_encoding_(kGrayscaleDepth),
+      cpu_texture_(GL_LINEAR),
       gpu_texture_id_(0),
-      depth_map_buffer_(0),
-      grayscale_display_buffer_(0),
+      gpu_texture_width_(0),
+      gpu_texture_height_(0),
+      gpu_texture_encoding_(kMetricDepth),
+      cpu_upsampler_(kWindowSize, static_cast<float>(kMaxDepthDistance) /
+                                      kMeterToMillimeter),
+      window_size_(kWindowSize),
+      point_stride_(1),
+      image_divisor_(1),
+      roi_x_(0),
+      roi_y_(0),
+      roi_width_(0),
+      roi_height_(0),
+      is_texture_valid_(false),
+      texture_timestamp_(0.0),
+      rgb_camera_intrinsics_(),
+      depth_image_intrinsics_(),
       texture_render_program_(0),
       fbo_handle_(0),
-      vertex_buffer_handle_(0),
+      max_point_count_(0),
       vertices_handle_(0),
-      mvp_handle_(0) {}
+      mvp_handle_(0),
+      point_size_handle_(0),
+      pack_depth_handle_(0),
+      point_scale_handle_(0),
+      point_offset_handle_(0),
+      is_compute_enabled_(true),
+      bilateral_upsampler_(static_cast<float>(kMaxDepthDistance) /
+                           kMeterToMillimeter),
+      bilateral_texture_(GL_LINEAR),
+      frame_exporter_(nullptr) {
+  for (ModeStats& stats : mode_stats_) {
+    stats = ModeStats();
+  }
+  for (LastImage& last_image : last_images_) {
+    last_image = LastImage();
+  }
+}
 
 DepthImage::~DepthImage() {}
 
 void DepthImage::InitializeGL() {
   texture_id_ = 0;
-  cpu_texture_id_ = 0;
+  is_texture_valid_ = false;
+  cpu_texture_.InvalidateGlResources();
   gpu_texture_id_ = 0;
+  gpu_texture_width_ = 0;
+  gpu_texture_height_ = 0;
 
   texture_render_program_ = 0;
   fbo_handle_ = 0;
-  vertex_buffer_handle_ = 0;
+  vertex_buffer_.InvalidateGlResources();
   vertices_handle_ = 0;
   mvp_handle_ = 0;
+  point_size_handle_ = 0;
+  pack_depth_handle_ = 0;
+  point_scale_handle_ = 0;
+  point_offset_handle_ = 0;
+  hole_filler_.InvalidateGlResources();
+  compute_splatter_.InvalidateGlResources();
+  bilateral_texture_.InvalidateGlResources();
+}
+
+bool DepthImage::InitializePointProgram() {
+  if (texture_render_program_) {
+    return false;
+  }
+  const tango_gl::util::SharedProgram* program =
+      tango_gl::util::GetSharedProgram(kPointCloudVertexShader,
+                                       kPointCloudFragmentShader);
+  texture_render_program_ = program ? program->GetId() : 0;
+
+  mvp_handle_ = program ? program->GetUniformLocation("mvp") : -1;
+
+  tango_gl::GlState::UseProgram(texture_render_program_);
+  // Assume these are constant for the life the program
+  GLuint max_depth_handle =
+      program ? program->GetUniformLocation("maxdepth") : -1;
+  GLint depth_scale_handle =
+      program ? program->GetUniformLocation("depthscale") : -1;
+  point_size_handle_ = program ? program->GetUniformLocation("pointsize") : -1;
+  pack_depth_handle_ = program ? program->GetUniformLocation("packdepth") : -1;
+  point_scale_handle_ =
+      program ? program->GetUniformLocation("point_scale") : -1;
+  point_offset_handle_ =
+      program ? program->GetUniformLocation("point_offset") : -1;
+  glUniform1f(max_depth_handle, GetMaxDepth());
+  glUniform1f(depth_scale_handle, GetMaxDepth());
+
+  vertices_handle_ = program ? program->GetAttribLocation("vertex") : -1;
+
+  vertex_buffer_.Reserve(tango_gl::QuantizedPoints::kPointSize *
+                         max_point_count_);
+  return true;
 }
 
 bool DepthImage::CreateOrBindGPUTexture() {
-  if (gpu_texture_id_) {
+  const bool created_program = InitializePointProgram();
+  const int width = depth_image_intrinsics_.width;
+  const int height = depth_image_intrinsics_.height;
+  if (gpu_texture_id_ && width == gpu_texture_width_ &&
+      height == gpu_texture_height_) {
     glBindFramebuffer(GL_FRAMEBUFFER, fbo_handle_);
-    return false;
-  } else {
+    return created_program;
+  }
+  if (gpu_texture_id_ == 0) {
     glGenTextures(1, &gpu_texture_id_);
-    texture_render_program_ = tango_gl::util::CreateProgram(
-        kPointCloudVertexShader.c_str(), kPointCloudFragmentShader.c_str());
+    glGenFramebuffers(1, &fbo_handle_);
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, fbo_handle_);
+  // The texture is reallocated in place when the scale or the region of
+  // interest change, and stays attached to the framebuffer.
+  AllocateGPUTexture(width, height);
+  return true;
+}
+
+void DepthImage::AllocateGPUTexture(int width, int height) {
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, gpu_texture_id_);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  // Whether a format is color renderable is only known once it is attached,
+  // the formats are tried until the framebuffer is complete.
+  const std::vector<DepthTextureFormat> formats = GetDepthTextureFormats();
+  for (size_t i = 0; i < formats.size(); ++i) {
+    const DepthTextureFormat& format = formats[i];
+    glTexImage2D(GL_TEXTURE_2D, 0, format.internal_format, width, height, 0,
+                 format.format, format.type, nullptr);
+    // Interpolating packed depths would mix their bytes.
+    const GLint filter =
+        format.encoding == kPackedDepth ? GL_NEAREST : GL_LINEAR;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                           gpu_texture_id_, 0);
+    if (i + 1 == formats.size() ||
+        glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE) {
+      gpu_texture_encoding_ = format.encoding;
+      LOGI("DepthImage: GPU depth texture of %dx%d in %s", width, height,
+           format.name);
+      break;
+    }
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
+  gpu_texture_width_ = width;
+  gpu_texture_height_ = height;
+}
+
+void DepthImage::RenderDepthToTexture(
+    const glm::mat4& color_t1_T_depth_t0,
+    const TangoXYZij* render_point_cloud_buffer, bool new_points) {
+  if (is_compute_enabled_ &&
+      RenderComputeDepthToTexture(color_t1_T_depth_t0,
+                                  render_point_cloud_buffer, new_points)) {
+    return;
+  }
+  if (IsTextureUpToDate(gpu_texture_id_, color_t1_T_depth_t0,
+                        render_point_cloud_buffer)) {
+    return;
+  }
+  const Clock::time_point start = Clock::now();
+  new_points = this->CreateOrBindGPUTexture() || new_points;
 
-    mvp_handle_ = glGetUniformLocation(texture_render_program_, "mvp");
+  glViewport(0, 0, depth_image_intrinsics_.width,
+             depth_image_intrinsics_.height);
+  glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    glUseProgram(texture_render_program_);
-    // Assume these are constant for the life the program
-    GLuint max_depth_handle =
-        glGetUniformLocation(texture_render_program_, "maxdepth");
-    GLuint point_size_handle =
-        glGetUniformLocation(texture_render_program_, "pointsize");
-    glUniform1f(max_depth_handle,
-                static_cast<float>(kMaxDepthDistance) / kMeterToMillimeter);
-    glUniform1f(point_size_handle, 2 * kWindowSize + 1);
+  tango_gl::GlState::Disable(GL_BLEND);
+  tango_gl::GlState::Enable(GL_DEPTH_TEST);
 
-    vertices_handle_ = glGetAttribLocation(texture_render_program_, "vertex");
+  DrawPoints(color_t1_T_depth_t0, render_point_cloud_buffer, new_points,
+             2 * window_size_ + 1, gpu_texture_encoding_ == kPackedDepth);
 
-    glGenBuffers(1, &vertex_buffer_handle_);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, gpu_texture_id_);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, rgb_camera_intrinsics_.width,
-                 rgb_camera_intrinsics_.height, 0, GL_RGBA, GL_UNSIGNED_BYTE,
-                 nullptr);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glBindTexture(GL_TEXTURE_2D, 0);
+  tango_gl::util::CheckGlError("DepthImage RenderTexture");
 
-    glGenFramebuffers(1, &fbo_handle_);
-    glBindFramebuffer(GL_FRAMEBUFFER, fbo_handle_);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
-                           gpu_texture_id_, 0);
+  texture_id_ = gpu_texture_id_;
+  texture_encoding_ = gpu_texture_encoding_;
+  SetTextureUpToDate(color_t1_T_depth_t0, render_point_cloud_buffer);
+  RecordImage(kGpuSplatMode, MillisecondsSince(start), 0.0, -1.0);
+}
 
+bool DepthImage::RenderComputeDepthToTexture(
+    const glm::mat4& color_t1_T_depth_t0,
+    const TangoXYZij* render_point_cloud_buffer, bool new_points) {
+  if (IsTextureUpToDate(compute_splatter_.GetTextureId(), color_t1_T_depth_t0,
+                        render_point_cloud_buffer)) {
     return true;
   }
-}
-
-bool DepthImage::CreateOrBindCPUTexture() {
-  if (cpu_texture_id_) {
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, cpu_texture_id_);
+  if (!compute_splatter_.InitializeGl()) {
     return false;
-  } else {
-    glGenTextures(1, &cpu_texture_id_);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, cpu_texture_id_);
-    glTexImage2D(GL_TEXTURE_2D, 0,  // mip-map level
-                 GL_LUMINANCE, rgb_camera_intrinsics_.width,
-                 rgb_camera_intrinsics_.height, 0,  // border
-                 GL_LUMINANCE, GL_UNSIGNED_BYTE, nullptr);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    return true;
   }
+  const Clock::time_point start = Clock::now();
+  // The points are uploaded quantized as for the GL_POINTS path, the buffer
+  // being shared with it.
+  new_points = InitializePointProgram() || new_points;
+  if (new_points) {
+    quantized_points_.Quantize(render_point_cloud_buffer->xyz[0],
+                               render_point_cloud_buffer->xyz_count);
+    vertex_buffer_.Update(quantized_points_.GetData(),
+                          quantized_points_.GetSize());
+    tango_gl::GlState::BindBuffer(GL_ARRAY_BUFFER, 0);
+  }
+  const TangoCameraIntrinsics& intrinsics = depth_image_intrinsics_;
+  if (!compute_splatter_.Splat(
+          vertex_buffer_.GetBuffer(), quantized_points_, color_t1_T_depth_t0,
+          glm::vec4(intrinsics.fx, intrinsics.fy, intrinsics.cx,
+                    intrinsics.cy),
+          point_stride_, window_size_, GetMaxDepth())) {
+    return false;
+  }
+  texture_id_ = compute_splatter_.GetTextureId();
+  texture_encoding_ = kMetricDepth;
+  SetTextureUpToDate(color_t1_T_depth_t0, render_point_cloud_buffer);
+
+  // The coverage is the one of an image a few frames older.
+  DepthImageStatistics statistics;
+  const double coverage =
+      compute_splatter_.GetLatestStatistics(&statistics) &&
+              statistics.pixel_count > 0
+          ? static_cast<double>(statistics.depth_count) /
+                statistics.pixel_count
+          : -1.0;
+  RecordImage(kGpuComputeMode, MillisecondsSince(start), 0.0, coverage);
+  return true;
 }
 
-void DepthImage::RenderDepthToTexture(
+void DepthImage::RenderFilledDepthToTexture(
     const glm::mat4& color_t1_T_depth_t0,
-    const TangoXYZij* render_point_cloud_buffer, bool new_points) {
-  new_points = this->CreateOrBindGPUTexture() || new_points;
+    const TangoXYZij* render_point_cloud_buffer, bool new_points,
+    GLuint color_texture_id) {
+  if (IsTextureUpToDate(hole_filler_.GetTextureId(), color_t1_T_depth_t0,
+                        render_point_cloud_buffer)) {
+    return;
+  }
+  const Clock::time_point start = Clock::now();
+  new_points = InitializePointProgram() || new_points;
+  if (!hole_filler_.BeginSplat()) {
+    return;
+  }
+  DrawPoints(color_t1_T_depth_t0, render_point_cloud_buffer, new_points,
+             hole_filler_.GetKernel().point_size, true);
+  texture_id_ = hole_filler_.Fill(color_texture_id);
+  texture_encoding_ = kGrayscaleDepth;
 
-  glViewport(0, 0, rgb_camera_intrinsics_.width, rgb_camera_intrinsics_.height);
-  glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
-  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  tango_gl::util::CheckGlError("DepthImage RenderFilledTexture");
 
-  // Special program needed to color by z-distance
-  glUseProgram(texture_render_program_);
+  SetTextureUpToDate(color_t1_T_depth_t0, render_point_cloud_buffer);
+  RecordImage(kGpuFilledMode, MillisecondsSince(start), 0.0, -1.0);
+}
 
-  glDisable(GL_BLEND);
-  glEnable(GL_DEPTH_TEST);
+void DepthImage::DrawPoints(const glm::mat4& color_t1_T_depth_t0,
+                            const TangoXYZij* render_point_cloud_buffer,
+                            bool new_points, float point_size,
+                            bool pack_depth) {
+  // Special program needed to color by z-distance
+  tango_gl::GlState::UseProgram(texture_render_program_);
+  glUniform1f(point_size_handle_, point_size);
+  glUniform1f(pack_depth_handle_, pack_depth ? 1.0f : 0.0f);
 
-  glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer_handle_);
   if (new_points) {
-    glBufferData(GL_ARRAY_BUFFER,
-                 sizeof(GLfloat) * render_point_cloud_buffer->xyz_count * 3,
-                 render_point_cloud_buffer->xyz, GL_STATIC_DRAW);
+    quantized_points_.Quantize(render_point_cloud_buffer->xyz[0],
+                               render_point_cloud_buffer->xyz_count);
+    vertex_buffer_.Update(quantized_points_.GetData(),
+                          quantized_points_.GetSize());
+  } else {
+    vertex_buffer_.Bind();
   }
+  quantized_points_.SetUniforms(point_scale_handle_, point_offset_handle_);
   tango_gl::util::CheckGlError("DepthImage Buffer");
 
   // Skip negation of Y-axis as is normally done in opengl_T_color
@@ -171,21 +431,22 @@ void DepthImage::RenderDepthToTexture(
 
   glUniformMatrix4fv(mvp_handle_, 1, GL_FALSE, glm::value_ptr(mvp_mat));
 
+  // Skip points by striding over the whole cloud rather than uploading a
+  // subset of it.
   glEnableVertexAttribArray(vertices_handle_);
-  glVertexAttribPointer(vertices_handle_, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+  tango_gl::QuantizedPoints::SetVertexAttribPointer(vertices_handle_,
+                                                    point_stride_);
 
-  glDrawArrays(GL_POINTS, 0, render_point_cloud_buffer->xyz_count);
+  glDrawArrays(
+      GL_POINTS, 0,
+      (render_point_cloud_buffer->xyz_count + point_stride_ - 1) /
+          point_stride_);
   glDisableVertexAttribArray(vertices_handle_);
 
   tango_gl::util::CheckGlError("DepthImage Draw");
 
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-  glBindFramebuffer(GL_FRAMEBUFFER, 0);
-  glUseProgram(0);
-
-  tango_gl::util::CheckGlError("DepthImage RenderTexture");
-
-  texture_id_ = gpu_texture_id_;
+  tango_gl::GlState::BindBuffer(GL_ARRAY_BUFFER, 0);
+  tango_gl::GlState::UseProgram(0);
 }
 
 // Update function will be called in application's main render loop. This funct-
@@ -201,65 +462,265 @@ void DepthImage::RenderDepthToTexture(
 void DepthImage::UpdateAndUpsampleDepth(
     const glm::mat4& color_t1_T_depth_t0,
     const TangoXYZij* render_point_cloud_buffer) {
-  int depth_image_width = rgb_camera_intrinsics_.width;
-  int depth_image_height = rgb_camera_intrinsics_.height;
-  int depth_image_size = depth_image_width * depth_image_height;
-
-  depth_map_buffer_.resize(depth_image_size);
-  grayscale_display_buffer_.resize(depth_image_size);
-  std::fill(depth_map_buffer_.begin(), depth_map_buffer_.end(), 0);
-  std::fill(grayscale_display_buffer_.begin(), grayscale_display_buffer_.end(),
-            0);
-
-  int point_cloud_size = render_point_cloud_buffer->xyz_count;
-  for (int i = 0; i < point_cloud_size; ++i) {
-    float x = render_point_cloud_buffer->xyz[i][0];
-    float y = render_point_cloud_buffer->xyz[i][1];
-    float z = render_point_cloud_buffer->xyz[i][2];
-
-    // depth_t0_point is the point in depth camera frame on timestamp t0.
-    // (depth image timestamp).
-    glm::vec4 depth_t0_point = glm::vec4(x, y, z, 1.0);
-
-    // color_t1_point is the point in camera frame on timestamp t1.
-    // (color image timestamp).
-    glm::vec4 color_t1_point = color_t1_T_depth_t0 * depth_t0_point;
-
-    int pixel_x, pixel_y;
-    // get the coordinate on image plane.
-    pixel_x = static_cast<int>((rgb_camera_intrinsics_.fx) *
-                                   (color_t1_point.x / color_t1_point.z) +
-                               rgb_camera_intrinsics_.cx);
-
-    pixel_y = static_cast<int>((rgb_camera_intrinsics_.fy) *
-                                   (color_t1_point.y / color_t1_point.z) +
-                               rgb_camera_intrinsics_.cy);
-
-    // Color value is the GL_LUMINANCE value used for displaying the depth
-    // image.
-    // We can query for depth value in mm from grayscale image buffer by
-    // getting a `pixel_value` at (pixel_x,pixel_y) and calculating
-    // pixel_value * (kMaxDepthDistance / USHRT_MAX)
-    float depth_value = color_t1_point.z;
-    uint8_t grayscale_value =
-        (color_t1_point.z * kMeterToMillimeter) * UCHAR_MAX / kMaxDepthDistance;
-
-    UpSampleDepthAroundPoint(grayscale_value, depth_value, pixel_x, pixel_y,
-                             &grayscale_display_buffer_, &depth_map_buffer_);
-  }
-
-  this->CreateOrBindCPUTexture();
-  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, depth_image_width, depth_image_height,
-                  GL_LUMINANCE, GL_UNSIGNED_BYTE,
-                  grayscale_display_buffer_.data());
-  tango_gl::util::CheckGlError("DepthImage glTexSubImage2D");
+  if (IsTextureUpToDate(cpu_texture_.GetTextureId(), color_t1_T_depth_t0,
+                        render_point_cloud_buffer)) {
+    return;
+  }
+  const Clock::time_point start = Clock::now();
+  int depth_image_width = depth_image_intrinsics_.width;
+  int depth_image_height = depth_image_intrinsics_.height;
+
+  TangoXYZij strided_point_cloud;
+  if (point_stride_ > 1) {
+    const int point_count =
+        (render_point_cloud_buffer->xyz_count + point_stride_ - 1) /
+        point_stride_;
+    strided_points_.resize(point_count * 3);
+    for (int i = 0; i < point_count; ++i) {
+      const float* point = render_point_cloud_buffer->xyz[i * point_stride_];
+      strided_points_[i * 3] = point[0];
+      strided_points_[i * 3 + 1] = point[1];
+      strided_points_[i * 3 + 2] = point[2];
+    }
+    strided_point_cloud = *render_point_cloud_buffer;
+    strided_point_cloud.xyz_count = point_count;
+    strided_point_cloud.xyz =
+        reinterpret_cast<float(*)[3]>(strided_points_.data());
+    render_point_cloud_buffer = &strided_point_cloud;
+  }
+
+  // The grayscale value is the GL_LUMINANCE value used for displaying the
+  // depth image. We can query for depth value in mm from the grayscale image
+  // buffer by getting a `pixel_value` at (pixel_x,pixel_y) and calculating
+  // pixel_value * (kMaxDepthDistance / UCHAR_MAX)
+  cpu_upsampler_.Upsample(color_t1_T_depth_t0, render_point_cloud_buffer);
+
+  glActiveTexture(GL_TEXTURE0);
+  cpu_texture_.Allocate(GL_LUMINANCE, depth_image_width, depth_image_height);
+  cpu_texture_.Update(cpu_upsampler_.GetGrayscaleBuffer().data());
   glBindTexture(GL_TEXTURE_2D, 0);
 
-  texture_id_ = cpu_texture_id_;
+  texture_id_ = cpu_texture_.GetTextureId();
+  texture_encoding_ = kGrayscaleDepth;
+  SetTextureUpToDate(color_t1_T_depth_t0, render_point_cloud_buffer);
+  // The sampling and the export are left out of the render time.
+  const double render_time = MillisecondsSince(start);
+  if (frame_exporter_ != nullptr && frame_exporter_->IsRunning()) {
+    frame_exporter_->ExportDepth(
+        "depth", cpu_upsampler_.GetDepthBuffer().data(), depth_image_width,
+        depth_image_height, render_point_cloud_buffer->timestamp);
+  }
+  RecordImage(kCpuSplatMode, render_time, 0.0,
+              SampleCoverage(cpu_upsampler_.GetDepthBuffer(),
+                             depth_image_width, depth_image_height));
 }
 
-void DepthImage::SetCameraIntrinsics(TangoCameraIntrinsics intrinsics) {
-  rgb_camera_intrinsics_ = intrinsics;
+void DepthImage::UpdateBilateralDepth(
+    const TangoXYZij* render_point_cloud_buffer) {
+  const Clock::time_point start = Clock::now();
+  bilateral_upsampler_.Submit(render_point_cloud_buffer, point_stride_);
+  const BilateralUpsampler::Result* result =
+      bilateral_upsampler_.GetNewResult();
+  // Results started before a change of the image size are dropped.
+  if (result != nullptr && result->width == depth_image_intrinsics_.width &&
+      result->height == depth_image_intrinsics_.height) {
+    glActiveTexture(GL_TEXTURE0);
+    bilateral_texture_.Allocate(GL_LUMINANCE, result->width, result->height);
+    bilateral_texture_.Update(result->grayscale.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+    RecordImage(kCpuBilateralMode, MillisecondsSince(start),
+                result->worker_time, result->coverage);
+    if (frame_exporter_ != nullptr && frame_exporter_->IsRunning()) {
+      frame_exporter_->ExportDepth("depth", result->depths.data(),
+                                   result->width, result->height,
+                                   result->point_cloud_timestamp);
+    }
+  }
+  // The previous texture stays up until the first result.
+  if (bilateral_texture_.GetTextureId() != 0) {
+    texture_id_ = bilateral_texture_.GetTextureId();
+    texture_encoding_ = kGrayscaleDepth;
+  }
+}
+
+bool DepthImage::IsTextureUpToDate(
+    GLuint texture_id, const glm::mat4& color_t1_T_depth_t0,
+    const TangoXYZij* render_point_cloud_buffer) const {
+  if (!is_texture_valid_ || texture_id == 0 || texture_id != texture_id_ ||
+      render_point_cloud_buffer->timestamp != texture_timestamp_) {
+    return false;
+  }
+  // Motion between the transformation rendered and this one.
+  const glm::mat4 delta =
+      color_t1_T_depth_t0 * glm::inverse(texture_color_t1_T_depth_t0_);
+  if (glm::length(glm::vec3(delta[3])) > kMaxTranslationChange) {
+    return false;
+  }
+  // The trace of a rotation matrix is 1 + 2 cos(angle).
+  const float cos_angle =
+      0.5f * (delta[0][0] + delta[1][1] + delta[2][2] - 1.0f);
+  return cos_angle >= std::cos(kMaxRotationChange);
+}
+
+void DepthImage::SetTextureUpToDate(
+    const glm::mat4& color_t1_T_depth_t0,
+    const TangoXYZij* render_point_cloud_buffer) {
+  is_texture_valid_ = true;
+  texture_timestamp_ = render_point_cloud_buffer->timestamp;
+  texture_color_t1_T_depth_t0_ = color_t1_T_depth_t0;
+}
+
+void DepthImage::RecordImage(Mode mode, double render_time,
+                             double worker_time, double coverage) {
+  LastImage& last_image = last_images_[mode];
+  ++last_image.revision;
+  last_image.time = render_time + worker_time;
+
+  ModeStats& stats = mode_stats_[mode];
+  ++stats.image_count;
+  stats.render_time_sum += render_time;
+  stats.worker_time_sum += worker_time;
+  if (coverage >= 0.0) {
+    stats.coverage_sum += coverage;
+    ++stats.coverage_count;
+  }
+  if (stats.image_count < kStatsLogInterval) {
+    return;
+  }
+  const DepthImageStats summary = GetStats(mode);
+  if (summary.average_coverage >= 0.0) {
+    LOGI(
+        "DepthImage: %s, %d images, render thread %.2f ms, workers %.2f ms, "
+        "coverage %.1f%%",
+        kModeNames[mode], static_cast<int>(summary.image_count),
+        summary.average_render_time, summary.average_worker_time,
+        100.0 * summary.average_coverage);
+  } else {
+    LOGI("DepthImage: %s, %d images, render thread %.2f ms, workers %.2f ms",
+         kModeNames[mode], static_cast<int>(summary.image_count),
+         summary.average_render_time, summary.average_worker_time);
+  }
+  stats = ModeStats();
+}
+
+DepthImageStats DepthImage::GetStats(Mode mode) const {
+  const ModeStats& stats = mode_stats_[mode];
+  DepthImageStats summary;
+  summary.image_count = stats.image_count;
+  const double image_count = std::max<double>(stats.image_count, 1.0);
+  summary.average_render_time = stats.render_time_sum / image_count;
+  summary.average_worker_time = stats.worker_time_sum / image_count;
+  summary.average_coverage =
+      stats.coverage_count > 0 ? stats.coverage_sum / stats.coverage_count
+                               : -1.0;
+  return summary;
+}
+
+void DepthImage::SetDepthTest(bool depth_test) {
+  if (depth_test == cpu_upsampler_.GetDepthTest()) {
+    return;
+  }
+  cpu_upsampler_.SetDepthTest(depth_test);
+  is_texture_valid_ = false;
+}
+
+void DepthImage::SetWindowSize(int window_size) {
+  if (window_size == window_size_) {
+    return;
+  }
+  window_size_ = window_size;
+  cpu_upsampler_.SetWindowSize(window_size);
+  is_texture_valid_ = false;
+}
+
+void DepthImage::SetPointStride(int point_stride) {
+  point_stride = point_stride > 1 ? point_stride : 1;
+  if (point_stride == point_stride_) {
+    return;
+  }
+  point_stride_ = point_stride;
+  is_texture_valid_ = false;
+}
+
+void DepthImage::SetImageDivisor(int image_divisor) {
+  image_divisor = image_divisor > 1 ? image_divisor : 1;
+  if (image_divisor == image_divisor_) {
+    return;
+  }
+  image_divisor_ = image_divisor;
+  UpdateDepthImageIntrinsics();
+  is_texture_valid_ = false;
+}
+
+void DepthImage::SetRegionOfInterest(int x, int y, int width, int height) {
+  if (x == roi_x_ && y == roi_y_ && width == roi_width_ &&
+      height == roi_height_) {
+    return;
+  }
+  roi_x_ = x;
+  roi_y_ = y;
+  roi_width_ = width;
+  roi_height_ = height;
+  UpdateDepthImageIntrinsics();
+  is_texture_valid_ = false;
+}
+
+glm::vec4 DepthImage::GetTextureRegion() const {
+  if (rgb_camera_intrinsics_.width == 0 || rgb_camera_intrinsics_.height == 0) {
+    return glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+  }
+  const float image_width = rgb_camera_intrinsics_.width;
+  const float image_height = rgb_camera_intrinsics_.height;
+  return glm::vec4(region_x_ / image_width, region_y_ / image_height,
+                   region_width_ / image_width, region_height_ / image_height);
+}
+
+void DepthImage::SetComputeEnabled(bool enabled) {
+  if (enabled == is_compute_enabled_) {
+    return;
+  }
+  is_compute_enabled_ = enabled;
+  is_texture_valid_ = false;
+}
+
+void DepthImage::SetFillKernel(const DepthHoleFiller::Kernel& kernel) {
+  hole_filler_.SetKernel(kernel);
+  is_texture_valid_ = false;
+}
+
+void DepthImage::UpdateDepthImageIntrinsics() {
+  // The region of interest clamped to the color image, the whole image when
+  // it is empty.
+  const int image_width = rgb_camera_intrinsics_.width;
+  const int image_height = rgb_camera_intrinsics_.height;
+  region_x_ = std::min(std::max(roi_x_, 0), image_width);
+  region_y_ = std::min(std::max(roi_y_, 0), image_height);
+  region_width_ = std::min(roi_width_, image_width - region_x_);
+  region_height_ = std::min(roi_height_, image_height - region_y_);
+  if (region_width_ <= 0 || region_height_ <= 0) {
+    region_x_ = 0;
+    region_y_ = 0;
+    region_width_ = image_width;
+    region_height_ = image_height;
+  }
+
+  // Every path projects straight into the smaller image, of a camera with
+  // the principal point moved by the region and all scaled down.
+  TangoCameraIntrinsics& intrinsics = depth_image_intrinsics_;
+  intrinsics = rgb_camera_intrinsics_;
+  intrinsics.width = std::max(region_width_ / image_divisor_, 1);
+  intrinsics.height = std::max(region_height_ / image_divisor_, 1);
+  intrinsics.fx /= image_divisor_;
+  intrinsics.fy /= image_divisor_;
+  intrinsics.cx = (intrinsics.cx - region_x_) / image_divisor_;
+  intrinsics.cy = (intrinsics.cy - region_y_) / image_divisor_;
+  cpu_upsampler_.SetCameraIntrinsics(intrinsics);
+  hole_filler_.SetImageSize(intrinsics.width, intrinsics.height);
+  hole_filler_.SetColorImageRegion(GetTextureRegion());
+  compute_splatter_.SetImageSize(intrinsics.width, intrinsics.height);
+  bilateral_upsampler_.SetImageGeometry(intrinsics, region_x_, region_y_,
+                                        image_divisor_);
+
   const float kNearClip = 0.1;
   const float kFarClip = 10.0;
   projection_matrix_ar_ = tango_gl::Camera::ProjectionMatrixForCameraIntrinsics(
@@ -267,29 +728,10 @@ void DepthImage::SetCameraIntrinsics(TangoCameraIntrinsics intrinsics) {
       intrinsics.cx, intrinsics.cy, kNearClip, kFarClip);
 }
 
-void DepthImage::UpSampleDepthAroundPoint(
-    uint8_t grayscale_value, float depth_value, int pixel_x, int pixel_y,
-    std::vector<uint8_t>* grayscale_buffer,
-    std::vector<float>* depth_map_buffer) {
-
-  int image_width = rgb_camera_intrinsics_.width;
-  int image_height = rgb_camera_intrinsics_.height;
-  int image_size = image_height * image_width;
-  // Set the neighbour pixels to same color.
-  for (int a = -kWindowSize; a <= kWindowSize; ++a) {
-    for (int b = -kWindowSize; b <= kWindowSize; ++b) {
-      if (pixel_x > image_width || pixel_y > image_height || pixel_x < 0 ||
-          pixel_y < 0) {
-        continue;
-      }
-      int pixel_num = (pixel_x + a) + (pixel_y + b) * image_width;
-
-      if (pixel_num > 0 && pixel_num < image_size) {
-        (*grayscale_buffer)[pixel_num] = grayscale_value;
-        (*depth_map_buffer)[pixel_num] = depth_value;
-      }
-    }
-  }
+void DepthImage::SetCameraIntrinsics(TangoCameraIntrinsics intrinsics) {
+  rgb_camera_intrinsics_ = intrinsics;
+  is_texture_valid_ = false;
+  UpdateDepthImageIntrinsics();
 }
 
 }  // namespace rgb_depth_sync
@@ -0,0 +1,198 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "rgb-depth-sync/depth_upsampler.h"
+
+#include <algorithm>
+#include <climits>
+#include <thread>
+
+#include <tango-gl/point_transform.h>
+#include <tango-util/task_scheduler.h>
+
+namespace {
+// Bands thinner than this are not worth a thread of their own.
+const int kMinRowsPerBand = 32;
+
+inline uint8_t ToGrayscale(float depth, float depth_to_grayscale) {
+  return static_cast<uint8_t>(
+      std::min(depth * depth_to_grayscale, static_cast<float>(UCHAR_MAX)));
+}
+}  // namespace
+
+namespace rgb_depth_sync {
+
+DepthUpsampler::DepthUpsampler(int window_size, float max_depth)
+    : window_size_(window_size),
+      depth_to_grayscale_(UCHAR_MAX / max_depth),
+      depth_test_(false),
+      max_thread_count_(std::max(1u, std::thread::hardware_concurrency())),
+      memory_(tango_gl::kMemoryTagDepthImage, tango_gl::kMemoryCpu) {
+  intrinsics_.width = 0;
+  intrinsics_.height = 0;
+}
+
+void DepthUpsampler::SetCameraIntrinsics(
+    const TangoCameraIntrinsics& intrinsics) {
+  intrinsics_ = intrinsics;
+  const size_t image_size = intrinsics_.width * intrinsics_.height;
+  depth_buffer_.assign(image_size, 0.0f);
+  grayscale_buffer_.assign(image_size, 0);
+  dirty_begin_.assign(intrinsics_.height, 0);
+  dirty_end_.assign(intrinsics_.height, 0);
+  UpdateMemoryAccount();
+}
+
+void DepthUpsampler::SetWindowSize(int window_size) {
+  window_size_ = std::max(0, window_size);
+}
+
+void DepthUpsampler::SetMaxThreadCount(int max_thread_count) {
+  max_thread_count_ = std::max(1, max_thread_count);
+}
+
+void DepthUpsampler::Upsample(const glm::mat4& color_t1_T_depth_t0,
+                              const TangoXYZij* point_cloud) {
+  const int point_count = point_cloud->xyz_count;
+  if (static_cast<int>(projected_depth_.size()) < point_count) {
+    projected_x_.resize(point_count);
+    projected_y_.resize(point_count);
+    projected_depth_.resize(point_count);
+    UpdateMemoryAccount();
+  }
+  ProjectPoints(color_t1_T_depth_t0, point_cloud, 0, point_count);
+
+  const int height = intrinsics_.height;
+  const int band_count =
+      std::max(1, std::min(max_thread_count_, height / kMinRowsPerBand));
+
+  tango_util::TaskScheduler::Get().ParallelFor(
+      0, band_count, 1, [&](size_t band_begin, size_t band_end) {
+        for (int band = static_cast<int>(band_begin);
+             band < static_cast<int>(band_end); ++band) {
+          SplatRows(point_count, height * band / band_count,
+                    height * (band + 1) / band_count);
+        }
+      });
+}
+
+void DepthUpsampler::ProjectPoints(const glm::mat4& color_t1_T_depth_t0,
+                                   const TangoXYZij* point_cloud, int begin,
+                                   int end) {
+  const tango_gl::PointProjection projection(
+      color_t1_T_depth_t0, static_cast<float>(intrinsics_.fx),
+      static_cast<float>(intrinsics_.fy), static_cast<float>(intrinsics_.cx),
+      static_cast<float>(intrinsics_.cy));
+  tango_gl::ProjectPoints(projection, point_cloud->xyz[begin], end - begin,
+                          projected_x_.data() + begin,
+                          projected_y_.data() + begin,
+                          projected_depth_.data() + begin);
+}
+
+void DepthUpsampler::SplatRows(int point_count, int row_begin, int row_end) {
+  const int width = intrinsics_.width;
+  const int height = intrinsics_.height;
+
+  // Only clear the pixels written by the previous frame; everything else is
+  // still zero.
+  for (int y = row_begin; y < row_end; ++y) {
+    float* depth_row = depth_buffer_.data() + y * width;
+    uint8_t* grayscale_row = grayscale_buffer_.data() + y * width;
+    std::fill(depth_row + dirty_begin_[y], depth_row + dirty_end_[y], 0.0f);
+    std::fill(grayscale_row + dirty_begin_[y], grayscale_row + dirty_end_[y],
+              0);
+  }
+
+  // Bounding box of the pixels written in this band.
+  int dirty_x_begin = width;
+  int dirty_x_end = 0;
+  int dirty_y_begin = row_end;
+  int dirty_y_end = row_begin;
+
+  for (int i = 0; i < point_count; ++i) {
+    const float depth = projected_depth_[i];
+    const int pixel_x = projected_x_[i];
+    const int pixel_y = projected_y_[i];
+    // Points behind the camera or projecting outside of the image are not
+    // splatted.
+    if (!(depth > 0.0f) || pixel_x < 0 || pixel_x >= width || pixel_y < 0 ||
+        pixel_y >= height) {
+      continue;
+    }
+
+    // Clip the window against the image and this band once, so the fill
+    // below needs no per-pixel checks.
+    const int y_begin = std::max(pixel_y - window_size_, row_begin);
+    const int y_end = std::min(pixel_y + window_size_ + 1, row_end);
+    if (y_begin >= y_end) {
+      continue;
+    }
+    const int x_begin = std::max(pixel_x - window_size_, 0);
+    const int x_end = std::min(pixel_x + window_size_ + 1, width);
+    dirty_x_begin = std::min(dirty_x_begin, x_begin);
+    dirty_x_end = std::max(dirty_x_end, x_end);
+    dirty_y_begin = std::min(dirty_y_begin, y_begin);
+    dirty_y_end = std::max(dirty_y_end, y_end);
+
+    if (depth_test_) {
+      // Keep the nearest depth; 0 marks a pixel no point has reached yet.
+      for (int y = y_begin; y < y_end; ++y) {
+        float* depth_row = depth_buffer_.data() + y * width;
+        for (int x = x_begin; x < x_end; ++x) {
+          const float current = depth_row[x];
+          depth_row[x] =
+              (current == 0.0f || depth < current) ? depth : current;
+        }
+      }
+    } else {
+      const uint8_t grayscale = ToGrayscale(depth, depth_to_grayscale_);
+      for (int y = y_begin; y < y_end; ++y) {
+        float* depth_row = depth_buffer_.data() + y * width;
+        uint8_t* grayscale_row = grayscale_buffer_.data() + y * width;
+        std::fill(depth_row + x_begin, depth_row + x_end, depth);
+        std::fill(grayscale_row + x_begin, grayscale_row + x_end, grayscale);
+      }
+    }
+  }
+
+  for (int y = row_begin; y < row_end; ++y) {
+    const bool dirty = y >= dirty_y_begin && y < dirty_y_end;
+    dirty_begin_[y] = dirty ? dirty_x_begin : 0;
+    dirty_end_[y] = dirty ? dirty_x_end : 0;
+  }
+
+  if (depth_test_) {
+    // The winning depth is only known once every point has been splatted, so
+    // the display image is derived from the depth buffer in a single pass.
+    for (int y = row_begin; y < row_end; ++y) {
+      const float* depth_row = depth_buffer_.data() + y * width;
+      uint8_t* grayscale_row = grayscale_buffer_.data() + y * width;
+      for (int x = dirty_begin_[y]; x < dirty_end_[y]; ++x) {
+        grayscale_row[x] = ToGrayscale(depth_row[x], depth_to_grayscale_);
+      }
+    }
+  }
+}
+
+void DepthUpsampler::UpdateMemoryAccount() {
+  memory_.Set(projected_x_.capacity() * sizeof(int32_t) +
+              projected_y_.capacity() * sizeof(int32_t) +
+              projected_depth_.capacity() * sizeof(float) +
+              depth_buffer_.capacity() * sizeof(float) +
+              grayscale_buffer_.capacity() +
+              (dirty_begin_.capacity() + dirty_end_.capacity()) * sizeof(int));
+}
+}  // namespace rgb_depth_sync
@@ -17,6 +17,8 @@
 #define GLM_FORCE_RADIANS
 
 #include <jni.h>
+#include <tango-gl/tracing.h>
+#include <tango-gl/util.h>
 
 #include "rgb-depth-sync/rgb_depth_sync_application.h"
 
@@ -89,6 +91,7 @@ JNIEXPORT void JNICALL
 Java_com_projecttango_examples_cpp_rgbdepthsync_JNIInterface_render(JNIEnv*,
                                                                     jobject) {
   app.Render();
+  tango_gl::util::CheckGlErrorsOfFrame();
 }
 
 JNIEXPORT void JNICALL
@@ -103,6 +106,75 @@ Java_com_projecttango_examples_cpp_rgbdepthsync_JNIInterface_setGPUUpsample(
   return app.SetGPUUpsample(on);
 }
 
+JNIEXPORT jboolean JNICALL
+Java_com_projecttango_examples_cpp_rgbdepthsync_JNIInterface_getGPUUpsample(
+    JNIEnv*, jobject) {
+  return app.GetGPUUpsample();
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_rgbdepthsync_JNIInterface_setCalibrationStore(
+    JNIEnv* env, jobject, jstring directory, jstring device_key) {
+  const char* directory_chars = env->GetStringUTFChars(directory, nullptr);
+  const char* device_key_chars = env->GetStringUTFChars(device_key, nullptr);
+  app.SetCalibrationStore(directory_chars, device_key_chars);
+  env->ReleaseStringUTFChars(device_key, device_key_chars);
+  env->ReleaseStringUTFChars(directory, directory_chars);
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_projecttango_examples_cpp_rgbdepthsync_JNIInterface_isUpsampleCalibrated(
+    JNIEnv*, jobject) {
+  return app.IsUpsampleCalibrated();
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_rgbdepthsync_JNIInterface_setDepthTest(
+    JNIEnv*, jobject, jboolean on) {
+  return app.SetDepthTest(on);
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_rgbdepthsync_JNIInterface_setFillHoles(
+    JNIEnv*, jobject, jboolean on) {
+  return app.SetFillHoles(on);
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_rgbdepthsync_JNIInterface_setBilateralUpsample(
+    JNIEnv*, jobject, jboolean on) {
+  return app.SetBilateralUpsample(on);
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_rgbdepthsync_JNIInterface_setExportDirectory(
+    JNIEnv* env, jobject, jstring directory) {
+  const char* directory_chars = env->GetStringUTFChars(directory, nullptr);
+  app.SetExportDirectory(directory_chars);
+  env->ReleaseStringUTFChars(directory, directory_chars);
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_rgbdepthsync_JNIInterface_startTracing(
+    JNIEnv*, jobject) {
+  tango_gl::tracing::Start();
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_rgbdepthsync_JNIInterface_stopTracing(
+    JNIEnv*, jobject) {
+  tango_gl::tracing::Stop();
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_projecttango_examples_cpp_rgbdepthsync_JNIInterface_dumpTrace(
+    JNIEnv* env, jobject, jstring path) {
+  const char* path_chars = env->GetStringUTFChars(path, nullptr);
+  const bool dumped = tango_gl::tracing::DumpChromeTrace(path_chars);
+  env->ReleaseStringUTFChars(path, path_chars);
+  return dumped;
+}
+
 #ifdef __cplusplus
 }
 #endif
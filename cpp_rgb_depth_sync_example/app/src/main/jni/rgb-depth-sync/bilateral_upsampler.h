@@ -0,0 +1,205 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef RGB_DEPTH_SYNC_BILATERAL_UPSAMPLER_H_
+#define RGB_DEPTH_SYNC_BILATERAL_UPSAMPLER_H_
+
+#include <tango_client_api.h>
+#include <tango_support_api.h>
+#include <tango-util/worker_pool.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace rgb_depth_sync {
+
+// BilateralUpsampler fills a whole depth image with
+// TangoSupport_upsampleImageBilateral, guided by the color camera image, off
+// the render thread:
+//
+//   // Color camera callback thread.
+//   upsampler.UpdateImage(buffer);
+//   // Render thread, every frame.
+//   upsampler.Submit(point_cloud, point_stride);
+//   const BilateralUpsampler::Result* result = upsampler.GetNewResult();
+//   if (result != nullptr) {
+//     // Upload result->grayscale.
+//   }
+//
+// The depth image is split into bands of rows, the tiles, upsampled in
+// parallel on a tango_util::WorkerPool. Every tile has its own interpolator,
+// depth buffer and copy of its rows of the color image, cropped and scaled
+// down like the depth image, and overlaps its neighbours by kTileOverlap rows
+// so the filter sees the same pixels across the seams. The support library
+// projects the whole point cloud for every tile.
+//
+// Submit() copies the point cloud for the worker thread, replacing a point
+// cloud it has not started on yet, and GetNewResult() hands over the last
+// depth image finished. The results are triple buffered, one being written,
+// one ready and one read, so neither thread ever waits for the other beyond
+// swapping them.
+//
+// The depth image is computed for the color image the worker finds when it
+// starts, with the pose of the point cloud relative to that image, so it
+// lags the color texture drawn under it by a frame or so.
+class BilateralUpsampler {
+ public:
+  // A depth image, of the geometry of the last SetImageGeometry() it was
+  // started after.
+  struct Result {
+    uint32_t width;
+    uint32_t height;
+    // Depth in meters of every pixel, 0 where there is none.
+    std::vector<float> depths;
+    // The depth scaled to [0, 255] for display as a GL_LUMINANCE texture.
+    std::vector<uint8_t> grayscale;
+    double point_cloud_timestamp;
+    double image_timestamp;
+    // Time from the start of the job to the result, in milliseconds.
+    double worker_time;
+    // Fraction of the pixels with a depth.
+    double coverage;
+  };
+
+  // Rows every tile upsamples beyond the ones it writes, on each side.
+  static const int kTileOverlap = 8;
+
+  // @param max_depth: depth in meters mapped to the brightest grayscale value.
+  explicit BilateralUpsampler(float max_depth);
+  ~BilateralUpsampler();
+  BilateralUpsampler(const BilateralUpsampler& other) = delete;
+  BilateralUpsampler& operator=(const BilateralUpsampler&) = delete;
+
+  // Set the depth image computed by the next jobs.
+  //
+  // @param intrinsics: intrinsics of the depth image.
+  // @param region_x, region_y: pixel of the color image at the top left of
+  //        the depth image.
+  // @param image_divisor: pixels of the color image per pixel of the depth
+  //        image, on each side.
+  void SetImageGeometry(const TangoCameraIntrinsics& intrinsics, int region_x,
+                        int region_y, int image_divisor);
+
+  // Use the faster approximation of the support library. Defaults to true.
+  void SetApproximate(bool approximate);
+
+  // Split the next jobs in |tile_count| tiles, at most one per
+  // 32 rows. 0, the default, is a tile per thread.
+  void SetTileCount(int tile_count);
+
+  // Copy a color camera image for the next jobs. Called from the color camera
+  // callback thread, does nothing until the first Submit().
+  void UpdateImage(const TangoImageBuffer* buffer);
+
+  // Start a job on every |point_stride|-th point of |point_cloud|, unless it
+  // is the point cloud and geometry of the last one. Never waits for a job.
+  void Submit(const TangoXYZij* point_cloud, int point_stride);
+
+  // @return the last depth image finished if it was not returned already,
+  // nullptr otherwise. It stays valid until the next call.
+  const Result* GetNewResult();
+
+ private:
+  // The depth image a job computes.
+  struct Geometry {
+    TangoCameraIntrinsics intrinsics;
+    int region_x;
+    int region_y;
+    int image_divisor;
+    // Bumped by every SetImageGeometry(), 0 before the first.
+    uint64_t version;
+  };
+
+  // A band of the depth image and what upsampling it takes.
+  struct Tile {
+    // Rows of the depth image the tile writes, and the ones it upsamples.
+    int row_begin;
+    int row_end;
+    int image_row_begin;
+    int image_row_end;
+    // The interpolator refers to the intrinsics, which must not move.
+    TangoCameraIntrinsics intrinsics;
+    TangoSupportDepthInterpolator* interpolator;
+    TangoSupportDepthBuffer depth_buffer;
+    // The rows of the color image, as NV21 of the size of the tile.
+    std::vector<uint8_t> image_data;
+    TangoImageBuffer image;
+    uint32_t covered_count;
+  };
+
+  void Run();
+
+  // Create the tiles of geometry_, freeing the previous ones.
+  void CreateTiles();
+  void FreeTiles();
+
+  // Copy and upsample tile |index| into writing_. Runs on the pool.
+  void UpsampleTile(size_t index, const TangoImageBuffer* image,
+                    const TangoPoseData& color_camera_T_point_cloud);
+
+  // Crop and scale |image| down into the color image of |tile|.
+  void CopyImageRows(const TangoImageBuffer* image, Tile* tile) const;
+
+  float depth_to_grayscale_;
+  std::atomic<bool> approximate_;
+  std::atomic<int> tile_count_;
+
+  // Written by the color camera callback thread once, read by the worker.
+  std::atomic<TangoSupportImageBufferManager*> image_buffer_manager_;
+  std::atomic<bool> is_started_;
+
+  std::mutex mutex_;
+  std::condition_variable job_condition_;
+  bool is_stopping_;
+  // The job Submit() last posted, under mutex_.
+  bool has_pending_job_;
+  std::vector<float> pending_points_;
+  double pending_timestamp_;
+  Geometry pending_geometry_;
+  // What the last job submitted was started from.
+  uint64_t submitted_geometry_version_;
+  double submitted_timestamp_;
+  int submitted_point_stride_;
+
+  // The results, exchanged under mutex_.
+  std::unique_ptr<Result> writing_;
+  std::unique_ptr<Result> ready_;
+  std::unique_ptr<Result> reading_;
+  bool has_new_result_;
+
+  // Only used by the worker thread. tiles_ are of the geometry of
+  // tiles_version_, for a tile count of tiles_tile_count_.
+  std::vector<float> job_points_;
+  TangoXYZij job_point_cloud_;
+  Geometry geometry_;
+  uint64_t tiles_version_;
+  int tiles_tile_count_;
+  std::vector<Tile> tiles_;
+  // The worker thread runs tiles too, with thread_count_ - 1 threads of the
+  // pool.
+  int thread_count_;
+  std::unique_ptr<tango_util::WorkerPool> pool_;
+
+  std::thread thread_;
+};
+}  // namespace rgb_depth_sync
+
+#endif  // RGB_DEPTH_SYNC_BILATERAL_UPSAMPLER_H_
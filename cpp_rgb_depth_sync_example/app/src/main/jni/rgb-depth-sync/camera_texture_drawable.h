@@ -17,7 +17,9 @@
 #ifndef RGB_DEPTH_SYNC_CAMERA_TEXTURE_DRAWABLE_H_
 #define RGB_DEPTH_SYNC_CAMERA_TEXTURE_DRAWABLE_H_
 
+#include <tango-gl/full_screen_quad.h>
 #include <tango-gl/util.h>
+#include "rgb-depth-sync/depth_image.h"
 #include "rgb-depth-sync/shader.h"
 
 namespace rgb_depth_sync {
@@ -46,6 +48,17 @@ class CameraTextureDrawable {
   // @param texture_id: texture id which we set the depth_texture_id_
   void SetDepthTextureId(GLuint texture_id) { depth_texture_id_ = texture_id; }
 
+  // Set the rectangle of the color image the depth texture covers.
+  // @param depth_region: (x, y, width, height) in texture coordinates of the
+  //                      color texture, (0, 0, 1, 1) by default.
+  void SetDepthTextureRegion(const glm::vec4& depth_region) {
+    depth_region_ = depth_region;
+  }
+
+  // Set how the depth texture holds the depth, see
+  // DepthImage::GetTextureEncoding().
+  void SetDepthEncoding(DepthEncoding encoding) { depth_encoding_ = encoding; }
+
   // Alpha blend value for depth texture and color camera texture.
   // The value range is [0.0f, 1.0f].
   // @param blend_alpha: Blending value between rgb and depth texture.
@@ -56,17 +69,21 @@ class CameraTextureDrawable {
 
   GLuint color_texture_id_;
   GLuint depth_texture_id_;
+  glm::vec4 depth_region_;
+  DepthEncoding depth_encoding_;
 
   GLuint color_texture_handle_;
   GLuint depth_texture_handle_;
   GLuint blend_alpha_handle_;
+  GLuint depth_region_handle_;
+  GLint depth_encoding_handle_;
+  GLint max_depth_handle_;
 
-  GLuint attrib_texture_coords_;
-  GLuint attrib_vertices_;
+  GLint attrib_texture_coords_;
+  GLint attrib_vertices_;
 
   GLuint shader_program_;
-  // Vertex, indices and texture buffers.
-  GLuint render_buffers_[3];
+  tango_gl::FullScreenQuad quad_;
 };
 }  // namespace rgb_depth_sync
 
@@ -0,0 +1,180 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef RGB_DEPTH_SYNC_DEPTH_COMPUTE_SPLATTER_H_
+#define RGB_DEPTH_SYNC_DEPTH_COMPUTE_SPLATTER_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include <tango-gl/quantized_points.h>
+#include <tango-gl/util.h>
+
+namespace rgb_depth_sync {
+
+// Statistics of the depths of a depth image, see
+// DepthComputeSplatter::GetLatestStatistics().
+struct DepthImageStatistics {
+  // Pixels with a depth, and pixels of the image.
+  uint32_t depth_count;
+  uint32_t pixel_count;
+  // Over the pixels with a depth, in meters.
+  float min_depth;
+  float max_depth;
+  float mean_depth;
+};
+
+// DepthComputeSplatter projects a point cloud into a depth image with the
+// compute shaders of GLES 3.1, without the CPU touching the points once they
+// are uploaded:
+//
+//   // Once the quantized points are in the buffer.
+//   if (splatter_.Splat(buffer, quantized_points, color_T_depth, intrinsics,
+//                       point_stride, window_size, max_depth)) {
+//     depth_texture = splatter_.GetTextureId();
+//   }
+//
+// Every point keeps the nearest depth of its pixel with an atomicMin() on a
+// z-buffer of the float bits, which order as unsigned integers. The holes
+// are then filled like the splats of the GL_POINTS path, the nearest depth
+// within the window winning, as a horizontal then a vertical minimum over
+// 2 * window_size + 1 pixels. The last pass writes the texture, resets the
+// z-buffer for the next image and reduces the depths to their statistics,
+// which are read back a few frames later, once a fence says the GPU
+// finished them.
+//
+// The z-buffer is a shader storage buffer, atomics on images needing
+// OES_shader_image_atomic before GLES 3.2. The texture holds the depth in
+// meters in R32F, R16F not being an image format of GLES 3.1, and is sampled
+// with nearest filtering, float textures not being filterable.
+//
+// Without GLES 3.1, Splat() returns false and the caller falls back to
+// rasterizing the points. All methods must be called on the GL thread.
+class DepthComputeSplatter {
+ public:
+  DepthComputeSplatter();
+  DepthComputeSplatter(const DepthComputeSplatter& other) = delete;
+  DepthComputeSplatter& operator=(const DepthComputeSplatter&) = delete;
+  ~DepthComputeSplatter();
+
+  // Look up the entry points and create the programs of the current
+  // context, once until InvalidateGlResources(). Splat() does it too.
+  //
+  // @return false if compute shaders are not supported.
+  bool InitializeGl();
+
+  // Set the size of the depth image, the texture and buffers being
+  // reallocated on the next Splat().
+  void SetImageSize(int width, int height);
+
+  // Project the points into the depth texture.
+  //
+  // @param points_buffer: buffer object of the points quantized as
+  //        |quantized_points|.
+  // @param quantized_points: bounding box and count of the points.
+  // @param image_T_points: transform of the points to the camera of the
+  //        depth image.
+  // @param intrinsics: fx, fy, cx and cy of the depth image, in pixels.
+  // @param point_stride: only project one point out of this many.
+  // @param window_size: half size of the window a point fills, in pixels.
+  // @param max_depth: depth the points are clamped to, in meters.
+  //
+  // @return false if compute shaders are not supported.
+  bool Splat(GLuint points_buffer,
+             const tango_gl::QuantizedPoints& quantized_points,
+             const glm::mat4& image_T_points, const glm::vec4& intrinsics,
+             int point_stride, int window_size, float max_depth);
+
+  // @return the texture Splat() writes to, 0 until the first one.
+  GLuint GetTextureId() const { return texture_; }
+
+  // @param statistics: set to those of the latest image the GPU had
+  //        finished by the last Splat().
+  //
+  // @return false if none finished yet.
+  bool GetLatestStatistics(DepthImageStatistics* statistics) const;
+
+  // Forget the programs, buffers, texture and fences without deleting them,
+  // for when the GL context they belonged to has been destroyed.
+  void InvalidateGlResources();
+
+ private:
+  // The statistics of an image in flight.
+  struct Reduction {
+    // Buffer the statistics are reduced into, read once |fence| signals.
+    GLuint buffer;
+    // Set while the statistics have not been read.
+    tango_gl::util::GlCapabilities::Sync fence;
+    uint32_t pixel_count;
+  };
+
+  // Create the texture and buffers at the current image size.
+  void AllocateImage();
+
+  // Read the reductions the GPU finished into latest_statistics_.
+  void ReadReductions();
+
+  bool gl_initialized_;
+  bool is_supported_;
+  tango_gl::util::GlCapabilities::DispatchComputeFunction dispatch_compute_;
+  tango_gl::util::GlCapabilities::MemoryBarrierFunction memory_barrier_;
+  tango_gl::util::GlCapabilities::BindBufferBaseFunction bind_buffer_base_;
+  tango_gl::util::GlCapabilities::BindImageTextureFunction
+      bind_image_texture_;
+  tango_gl::util::GlCapabilities::TexStorage2DFunction tex_storage_2d_;
+  tango_gl::util::GlCapabilities::MapBufferRangeFunction map_buffer_range_;
+  tango_gl::util::GlCapabilities::UnmapBufferFunction unmap_buffer_;
+  tango_gl::util::GlCapabilities::FenceSyncFunction fence_sync_;
+  tango_gl::util::GlCapabilities::ClientWaitSyncFunction client_wait_sync_;
+  tango_gl::util::GlCapabilities::DeleteSyncFunction delete_sync_;
+
+  // Projects the points into the z-buffer, then takes the minimum over the
+  // rows of the window into row_buffer_, then over its columns into the
+  // texture.
+  GLuint splat_program_;
+  GLuint row_program_;
+  GLuint column_program_;
+  GLint point_count_location_;
+  GLint point_stride_location_;
+  GLint image_T_points_location_;
+  GLint intrinsics_location_;
+  GLint max_depth_location_;
+  GLint point_scale_location_;
+  GLint point_offset_location_;
+  GLint splat_size_location_;
+  GLint row_size_location_;
+  GLint row_radius_location_;
+  GLint column_size_location_;
+  GLint column_radius_location_;
+
+  int width_;
+  int height_;
+  // Whether the texture and buffers have the current image size.
+  bool is_allocated_;
+  GLuint texture_;
+  GLuint depth_buffer_;
+  GLuint row_buffer_;
+
+  // Ring of reductions, the oldest being read first.
+  std::vector<Reduction> reductions_;
+  size_t next_reduction_;
+  bool has_statistics_;
+  DepthImageStatistics latest_statistics_;
+};
+}  // namespace rgb_depth_sync
+
+#endif  // RGB_DEPTH_SYNC_DEPTH_COMPUTE_SPLATTER_H_
@@ -0,0 +1,156 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef RGB_DEPTH_SYNC_DEPTH_HOLE_FILLER_H_
+#define RGB_DEPTH_SYNC_DEPTH_HOLE_FILLER_H_
+
+#include <tango-gl/full_screen_quad.h>
+#include <tango-gl/util.h>
+
+// GLSL function packing the normalized depth |depth| into a color, for the
+// splat shader: the high byte of the depth in red, the low byte in green.
+// Must match the decoding of the fill shader.
+#define RGB_DEPTH_SYNC_GLSL_PACK_DEPTH                                \
+  "vec4 PackDepth(highp float depth) {\n"                             \
+  "  highp float scaled = depth * 255.0;\n"                           \
+  "  return vec4(floor(scaled) / 255.0, fract(scaled), 0.0, 1.0);\n" \
+  "}\n"
+
+namespace rgb_depth_sync {
+
+// DepthHoleFiller fills the holes between the splats of a sparse depth image
+// on the GPU, a GPU counterpart of TangoSupport_upsampleImageBilateral:
+//
+//   hole_filler_.SetImageSize(width, height);
+//   ...
+//   if (hole_filler_.BeginSplat()) {
+//     // Draw the points with the depth packed by the splat shader.
+//     depth_texture = hole_filler_.Fill(color_texture);
+//   }
+//
+// The points are splatted small, the nearest one winning thanks to a depth
+// buffer. A horizontal then a vertical pass of a joint bilateral filter then
+// spread the depth of every splat over the pixels around it that are of a
+// similar color in the color image, so depth edges follow the edges of the
+// image. Separating the filter costs 2 * (2 * radius + 1) taps a pixel
+// instead of (2 * radius + 1)^2, holes wider than the kernel remain.
+//
+// The splats and the result of the first pass hold the depth normalized to
+// [0, 1] and packed in the red and green channels, see
+// RGB_DEPTH_SYNC_GLSL_PACK_DEPTH, with an alpha of 0 where there is no depth.
+// The output is grayscale like the one of the single pass GPU path, and
+// bilinearly filtered.
+//
+// All methods must be called on the GL thread.
+class DepthHoleFiller {
+ public:
+  // Shape of the filter.
+  struct Kernel {
+    Kernel();
+
+    // Size of the point splats in pixels, small enough not to cover the
+    // depth edges.
+    float point_size;
+    // Taps on each side of a pixel, at most kMaxRadius.
+    int radius;
+    // Pixels between two taps, rounded to whole pixels.
+    float tap_spacing;
+    // Standard deviation of the spatial weight, in taps.
+    float spatial_sigma;
+    // Standard deviation of the color weight, over RGB in [0, 1].
+    float color_sigma;
+  };
+
+  // The most taps on each side of a pixel, the bound of the shader loop.
+  static const int kMaxRadius = 8;
+
+  DepthHoleFiller();
+  DepthHoleFiller(const DepthHoleFiller& other) = delete;
+  DepthHoleFiller& operator=(const DepthHoleFiller&) = delete;
+
+  void SetKernel(const Kernel& kernel);
+  const Kernel& GetKernel() const { return kernel_; }
+
+  // Set the size of the depth image, the textures being reallocated on the
+  // next BeginSplat().
+  void SetImageSize(int width, int height);
+
+  // Set the rectangle of the color image the depth image covers, as
+  // (x, y, width, height) in texture coordinates of the color image. Defaults
+  // to the whole image.
+  void SetColorImageRegion(const glm::vec4& region) { color_region_ = region; }
+
+  // Bind and clear the framebuffer the points are splatted into, with the
+  // depth test enabled.
+  //
+  // @return false if the GL resources could not be created.
+  bool BeginSplat();
+
+  // Fill the holes of the splats, guided by a color image.
+  //
+  // @param color_texture_id: GL_TEXTURE_EXTERNAL_OES texture of the color
+  //        image the splats were projected into.
+  //
+  // @return the filled depth texture, GetTextureId().
+  GLuint Fill(GLuint color_texture_id);
+
+  // @return the texture Fill() writes to, 0 until the first BeginSplat().
+  GLuint GetTextureId() const { return textures_[0]; }
+
+  // Forget the GL resources without deleting them, for when the GL context
+  // they belonged to has been destroyed.
+  void InvalidateGlResources();
+
+ private:
+  // Create the program and set up the quad, then create the textures and
+  // framebuffers at the current image size.
+  //
+  // @return false if the program could not be created.
+  bool InitializeGl();
+
+  // Run one pass of the filter from |source_texture| into |framebuffer|.
+  void RunPass(GLuint source_texture, GLuint framebuffer,
+               GLuint color_texture_id, float step_x, float step_y,
+               bool pack_output);
+
+  Kernel kernel_;
+  int width_;
+  int height_;
+  glm::vec4 color_region_;
+  // Whether the textures have the current image size.
+  bool is_allocated_;
+
+  GLuint program_;
+  GLint vertex_handle_;
+  GLint depth_texture_handle_;
+  GLint color_texture_handle_;
+  GLint tap_step_handle_;
+  GLint radius_handle_;
+  GLint spatial_scale_handle_;
+  GLint color_scale_handle_;
+  GLint pack_output_handle_;
+  GLint color_region_handle_;
+  tango_gl::FullScreenQuad quad_;
+
+  // The splats, then the output, are in textures_[0], the first pass in
+  // textures_[1]. Only framebuffers_[0] has the depth buffer.
+  GLuint textures_[2];
+  GLuint framebuffers_[2];
+  GLuint depth_renderbuffer_;
+};
+}  // namespace rgb_depth_sync
+
+#endif  // RGB_DEPTH_SYNC_DEPTH_HOLE_FILLER_H_
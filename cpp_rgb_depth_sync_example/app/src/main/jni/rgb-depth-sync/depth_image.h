@@ -18,17 +18,72 @@
 #define RGB_DEPTH_SYNC_DEPTH_IMAGE_H_
 
 #include <tango_client_api.h>
+#include <tango-gl/quantized_points.h>
+#include <tango-gl/streaming_texture.h>
+#include <tango-gl/streaming_vertex_buffer.h>
 #include <tango-gl/util.h>
+#include <tango-util/frame_exporter.h>
+#include <rgb-depth-sync/bilateral_upsampler.h>
+#include <rgb-depth-sync/depth_compute_splatter.h>
+#include <rgb-depth-sync/depth_hole_filler.h>
+#include <rgb-depth-sync/depth_upsampler.h>
 #include <thread>
 #include <mutex>
 #include <vector>
 
 namespace rgb_depth_sync {
 
+// Counters of the depth images of one DepthImage::Mode, see
+// DepthImage::GetStats().
+struct DepthImageStats {
+  // Depth images produced, the frames they were up to date not counted.
+  uint64_t image_count;
+  // Time spent producing them on the render thread, in milliseconds. The GPU
+  // modes only count issuing the GL commands.
+  double average_render_time;
+  // Time spent producing them on worker threads, in milliseconds, 0 for the
+  // modes running on the render thread.
+  double average_worker_time;
+  // Fraction of the pixels with a depth, -1 for the GPU modes whose images
+  // are not read back.
+  double average_coverage;
+};
+
+// How a depth texture holds the depth of its pixels, 0 where there is none.
+enum DepthEncoding {
+  // Red, green and blue hold the depth normalized to [0, 1] over the maximum
+  // depth, in 8 bits, for display only.
+  kGrayscaleDepth,
+  // Red holds the depth in meters.
+  kMetricDepth,
+  // Red and green hold the high and the low byte of the normalized depth,
+  // see RGB_DEPTH_SYNC_GLSL_PACK_DEPTH, to be read with nearest filtering.
+  kPackedDepth
+};
+
 // DepthImage is a class which projects point cloud on to a color camera's
 // image plane.
+//
+// The texture is only rendered again when the point cloud, the settings or,
+// beyond a small tolerance, the transformation changed, so a device standing
+// still costs next to nothing once the point cloud stops changing.
 class DepthImage {
  public:
+  // The ways of producing the depth image.
+  enum Mode {
+    // UpdateAndUpsampleDepth().
+    kCpuSplatMode,
+    // RenderDepthToTexture().
+    kGpuSplatMode,
+    // RenderFilledDepthToTexture().
+    kGpuFilledMode,
+    // UpdateBilateralDepth().
+    kCpuBilateralMode,
+    // RenderDepthToTexture() with compute shaders.
+    kGpuComputeMode,
+    kModeCount
+  };
+
   DepthImage();
   ~DepthImage();
 
@@ -63,48 +118,193 @@ class DepthImage {
   //
   // @param new_points Indicates if the point data has been updated and needs to
   // be uploaded to the GPU.
+  //
+  // With GLES 3.1, the points are projected and the holes filled by compute
+  // shaders instead, see DepthComputeSplatter, unless SetComputeEnabled()
+  // turned them off.
   void RenderDepthToTexture(const glm::mat4& color_t1_T_depth_t0,
                             const TangoXYZij* render_point_cloud_buffer,
                             bool new_points);
 
+  // Like RenderDepthToTexture(), but splat the points small and fill the holes
+  // between them with a joint bilateral filter guided by the color image,
+  // see DepthHoleFiller.
+  //
+  // @param color_texture_id: the GL_TEXTURE_EXTERNAL_OES texture of the color
+  // image at timestamp t1.
+  void RenderFilledDepthToTexture(const glm::mat4& color_t1_T_depth_t0,
+                                  const TangoXYZij* render_point_cloud_buffer,
+                                  bool new_points, GLuint color_texture_id);
+
+  // Update the depth texture with the whole image bilateral upsampling of the
+  // point cloud guided by the color image, on worker threads, see
+  // BilateralUpsampler. The texture is the last depth image the workers
+  // finished, so it lags the point cloud and only changes with the point
+  // cloud.
+  void UpdateBilateralDepth(const TangoXYZij* render_point_cloud_buffer);
+
+  // Hand a color camera image to UpdateBilateralDepth(). Called from the
+  // color camera callback thread.
+  void UpdateColorImage(const TangoImageBuffer* buffer) {
+    bilateral_upsampler_.UpdateImage(buffer);
+  }
+
+  // Use the compute shaders in RenderDepthToTexture() where they are
+  // supported, the default.
+  void SetComputeEnabled(bool enabled);
+
+  // @param statistics: set to those of the latest depth image of the compute
+  //        shaders the GPU finished.
+  //
+  // @return false if there is none.
+  bool GetComputeStatistics(DepthImageStatistics* statistics) const {
+    return compute_splatter_.GetLatestStatistics(statistics);
+  }
+
+  // Set the kernel of RenderFilledDepthToTexture(). Defaults to
+  // DepthHoleFiller::Kernel().
+  void SetFillKernel(const DepthHoleFiller::Kernel& kernel);
+
   // Returns the depth texture id.
   GLuint GetTextureId() const { return texture_id_; }
 
+  // @return how the depth texture holds the depth. The GPU splats are in
+  // meters in an R16F texture where half floats are color renderable, and
+  // packed in an RG8 one otherwise, half or a quarter of an RGBA8 texture.
+  DepthEncoding GetTextureEncoding() const { return texture_encoding_; }
+
+  // @return the depth normalized depths are relative to, in meters.
+  static float GetMaxDepth() {
+    return static_cast<float>(kMaxDepthDistance) / kMeterToMillimeter;
+  }
+
   // Set camera's intrinsics.
   // The intrinsics are used to project the pointcloud to depth image and
   // and undistort the image to the right size.
   void SetCameraIntrinsics(TangoCameraIntrinsics intrinsics);
 
+  // Keep the nearest point where the splats of the CPU path overlap instead
+  // of the last one.
+  void SetDepthTest(bool depth_test);
+
+  // Set the maximum number of points in a point cloud frame. The vertex buffer
+  // of the GPU path is allocated once at this capacity.
+  void SetMaxPointCount(int max_point_count) {
+    max_point_count_ = max_point_count;
+  }
+
+  // Set the half size of the window every point is splatted over, in pixels
+  // of the depth image. Defaults to kWindowSize.
+  void SetWindowSize(int window_size);
+
+  // Only project one point out of |point_stride|. Defaults to 1.
+  void SetPointStride(int point_stride);
+
+  // Divide the resolution of the depth image by |image_divisor| on each side,
+  // e.g. 2 or 4, so less is allocated, splatted and uploaded. Defaults to 1,
+  // the color camera resolution.
+  void SetImageDivisor(int image_divisor);
+
+  // Split the CPU splat in |band_count| bands of rows, see
+  // DepthUpsampler::SetMaxThreadCount(), and the bilateral upsampling in
+  // |tile_count| tiles, see BilateralUpsampler::SetTileCount(). Neither
+  // changes the depth images, only how fast they are produced.
+  void SetSplatBandCount(int band_count) {
+    cpu_upsampler_.SetMaxThreadCount(band_count);
+  }
+  void SetBilateralTileCount(int tile_count) {
+    bilateral_upsampler_.SetTileCount(tile_count);
+  }
+
+  // Only generate the depth image over a rectangle of the color image, in
+  // pixels of the color camera. Clamped to the color image, an empty
+  // rectangle selects the whole image, which is the default.
+  void SetRegionOfInterest(int x, int y, int width, int height);
+
+  // Export the metric depth of the images of the CPU modes to |exporter|
+  // while it runs, as "depth" frames of the point cloud timestamp. The GPU
+  // modes are not read back, and not exported. nullptr, the default, exports
+  // nothing.
+  void SetFrameExporter(tango_util::FrameExporter* exporter) {
+    frame_exporter_ = exporter;
+  }
+
+  // @return the rectangle of the color image the depth texture covers, as
+  // (x, y, width, height) in texture coordinates of the color image.
+  glm::vec4 GetTextureRegion() const;
+
+  // @return the counters of |mode| since the last summary logged, every
+  // kStatsLogInterval images of a mode.
+  DepthImageStats GetStats(Mode mode) const;
+
+  // @return a number that changes with every depth image of |mode|, and the
+  // time the last one took on the render thread and the workers, in
+  // milliseconds, e.g. to tune the settings that only change its speed.
+  uint64_t GetImageRevision(Mode mode) const {
+    return last_images_[mode].revision;
+  }
+  double GetLastImageTime(Mode mode) const { return last_images_[mode].time; }
+
  private:
   // Initialize the OpenGL structures needed to render depth image to texture.
   // Returns true if the texture was created and false if an existing texture
   // was bound.
   bool CreateOrBindGPUTexture();
 
-  // Initialize the OpenGL structures needed for the CPU texture generation.
-  // Returns true if the texture was created and false if an existing texture
-  // was bound.
-  bool CreateOrBindCPUTexture();
+  // Allocate gpu_texture_id_ in the most compact format the framebuffer can
+  // render to, and set gpu_texture_encoding_.
+  void AllocateGPUTexture(int width, int height);
 
-  // This function takes care of upsampling depth around a given point by
-  // setting the same value in a bounding box. Note:This is a very rudimentary
-  // approach to upsampling depth.
-  //
-  // @param color_value: The value that needs to set for all points in a
-  // bounding box.
-  //
-  // @param pixel_x: The pixel along x axis in the grayscale_buffer around which
-  // depth needs to be upsampled.
+  // Create the program splatting the points and the vertex buffer of the GPU
+  // paths. Returns true if they were created and false if they existed.
+  bool InitializePointProgram();
+
+  // RenderDepthToTexture() with the compute shaders.
   //
-  // @param pixel_y: The pixel along y axis in the grayscale_buffer around which
-  // depth needs to be upsampled.
+  // @return false if they are not supported.
+  bool RenderComputeDepthToTexture(const glm::mat4& color_t1_T_depth_t0,
+                                   const TangoXYZij* render_point_cloud_buffer,
+                                   bool new_points);
+
+  // Splat the point cloud into the bound framebuffer.
+  // @param point_size: size of the splats in pixels.
+  // @param pack_depth: write the depth packed, for the DepthHoleFiller or a
+  // texture without half floats, instead of in meters.
+  void DrawPoints(const glm::mat4& color_t1_T_depth_t0,
+                  const TangoXYZij* render_point_cloud_buffer, bool new_points,
+                  float point_size, bool pack_depth);
+
+  // Set depth_image_intrinsics_ to the color camera intrinsics cropped to the
+  // region of interest and scaled down by image_divisor_, and update what
+  // depends on them.
+  void UpdateDepthImageIntrinsics();
+
+  // @return true if |texture_id| is texture_id_, and was rendered from the
+  // same point cloud through a transformation within kMaxTranslationChange
+  // and kMaxRotationChange of |color_t1_T_depth_t0|.
+  bool IsTextureUpToDate(GLuint texture_id,
+                         const glm::mat4& color_t1_T_depth_t0,
+                         const TangoXYZij* render_point_cloud_buffer) const;
+
+  // Record what texture_id_ was just rendered from.
+  void SetTextureUpToDate(const glm::mat4& color_t1_T_depth_t0,
+                          const TangoXYZij* render_point_cloud_buffer);
+
+  // Account for a depth image of |mode| and log the summary of the mode
+  // every kStatsLogInterval images.
   //
-  // @param grayscale_buffer: The image buffer in which upsampling needs to be
-  // done.
-  void UpSampleDepthAroundPoint(uint8_t color_value, float depth_value,
-                                int pixel_x, int pixel_y,
-                                std::vector<uint8_t>* grayscale_buffer,
-                                std::vector<float>* depth_map_buffer);
+  // @param coverage: fraction of the pixels with a depth, or -1 if unknown.
+  void RecordImage(Mode mode, double render_time, double worker_time,
+                   double coverage);
+
+  // Running sums of the counters of a mode.
+  struct ModeStats {
+    uint64_t image_count;
+    double render_time_sum;
+    double worker_time_sum;
+    double coverage_sum;
+    uint64_t coverage_count;
+  };
 
   // The defined max distance for a depth value.
   static const int kMaxDepthDistance = 4000;
@@ -112,29 +312,64 @@ class DepthImage {
   // The meter to millimeter conversion.
   static const int kMeterToMillimeter = 1000;
 
-  // Window size for splatter upsample
+  // Default window size for splatter upsample
   static const int kWindowSize = 7;
 
+  // Images of a mode between two summaries of its counters.
+  static const int kStatsLogInterval = 120;
+
+  // Motion of the color camera with respect to the point cloud under which
+  // the depth image is not rendered again, in meters and radians. A
+  // milliradian is about half a pixel of the color camera.
+  static const float kMaxTranslationChange;
+  static const float kMaxRotationChange;
+
   // The depth texture id. This is used for other rendering class to
   // render, in this class, we only write value to this texture via
   // CPU or offscreen framebuffer rendering.  This should point either
-  // to the cpu_texture_id_ or gpu_texture_id_ value and should not be
-  // deleted separately.
+  // to the cpu_texture_, gpu_texture_id_, hole_filler_ or bilateral_texture_
+  // texture and should not be deleted separately.
   GLuint texture_id_;
-  // The backing texture for CPU texture generation.
-  GLuint cpu_texture_id_;
-  // The backing texture for GPU texture generation.
+  DepthEncoding texture_encoding_;
+  // The backing texture for CPU texture generation. Its storage is allocated
+  // once and then updated in place every frame.
+  tango_gl::StreamingTexture cpu_texture_;
+  // The backing texture for GPU texture generation, its size and encoding.
   GLuint gpu_texture_id_;
+  int gpu_texture_width_;
+  int gpu_texture_height_;
+  DepthEncoding gpu_texture_encoding_;
 
-  std::vector<float> depth_map_buffer_;
+  // Projects and splats the point cloud for the CPU path. Its grayscale
+  // buffer is written to cpu_texture_ and displayed as GL_LUMINANCE value.
+  DepthUpsampler cpu_upsampler_;
+  int window_size_;
+  int point_stride_;
+  int image_divisor_;
+  // The region of interest as set, and clamped to the color image.
+  int roi_x_;
+  int roi_y_;
+  int roi_width_;
+  int roi_height_;
+  int region_x_;
+  int region_y_;
+  int region_width_;
+  int region_height_;
+  // Every point_stride_-th point of the cloud for the CPU path.
+  std::vector<GLfloat> strided_points_;
 
-  // Color map buffer is for the texture render purpose, this value is written
-  // to the texture id buffer, and display as GL_LUMINANCE value.
-  std::vector<uint8_t> grayscale_display_buffer_;
+  // What texture_id_ was last rendered from. Cleared by any change of the
+  // settings or of the GL context.
+  bool is_texture_valid_;
+  double texture_timestamp_;
+  glm::mat4 texture_color_t1_T_depth_t0_;
 
   // The camera intrinsics of current device. Note that the color camera and
   // depth camera are the same hardware on the device.
   TangoCameraIntrinsics rgb_camera_intrinsics_;
+  // The intrinsics of the depth image, every path projecting into it
+  // directly.
+  TangoCameraIntrinsics depth_image_intrinsics_;
 
   // Transform between Color camera and Depth Camera.
   glm::mat4 depth_camera_T_color_camera_;
@@ -143,9 +378,41 @@ class DepthImage {
   // OpenGL handles for render to texture
   GLuint texture_render_program_;
   GLuint fbo_handle_;
-  GLuint vertex_buffer_handle_;
+  // Point cloud vertices streamed to the GPU when new points arrive,
+  // quantized to 16 bits in quantized_points_.
+  tango_gl::StreamingVertexBuffer vertex_buffer_;
+  tango_gl::QuantizedPoints quantized_points_;
+  int max_point_count_;
   GLuint vertices_handle_;
   GLuint mvp_handle_;
+  GLuint point_size_handle_;
+  GLuint pack_depth_handle_;
+  GLint point_scale_handle_;
+  GLint point_offset_handle_;
+
+  // Fills the holes of the GPU splats for RenderFilledDepthToTexture().
+  DepthHoleFiller hole_filler_;
+
+  // Projects the points of vertex_buffer_ for RenderDepthToTexture() where
+  // compute shaders are supported and enabled.
+  DepthComputeSplatter compute_splatter_;
+  bool is_compute_enabled_;
+
+  // Upsamples for UpdateBilateralDepth(), its results uploaded to
+  // bilateral_texture_.
+  BilateralUpsampler bilateral_upsampler_;
+  tango_gl::StreamingTexture bilateral_texture_;
+
+  ModeStats mode_stats_[kModeCount];
+
+  tango_util::FrameExporter* frame_exporter_;
+
+  // The last image of every mode, kept across the summaries.
+  struct LastImage {
+    uint64_t revision;
+    double time;
+  };
+  LastImage last_images_[kModeCount];
 };
 }  // namespace rgb_depth_sync
 
@@ -0,0 +1,121 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef RGB_DEPTH_SYNC_DEPTH_UPSAMPLER_H_
+#define RGB_DEPTH_SYNC_DEPTH_UPSAMPLER_H_
+
+#include <tango_client_api.h>
+#include <tango-gl/memory_accounting.h>
+#include <tango-gl/util.h>
+#include <cstdint>
+#include <vector>
+
+namespace rgb_depth_sync {
+
+// DepthUpsampler projects a point cloud onto the color camera's image plane on
+// the CPU and splats every point over a square window of pixels.
+//
+// Points are projected in SIMD batches, then the image is split into bands of
+// rows that are splatted in parallel on the shared tango_util::TaskScheduler,
+// instead of threads started every frame. Each band is owned by a single task
+// and visits the points in cloud order, so the result is the same as a serial
+// splat regardless of the number of threads.
+//
+// By default a later point overwrites the pixels of an earlier one. With the
+// depth test enabled the nearest point wins instead, which is what a depth
+// measurement needs where splats overlap at depth edges.
+class DepthUpsampler {
+ public:
+  // @param window_size: half size of the splat window, every point covers
+  //                     (2 * window_size + 1)^2 pixels.
+  // @param max_depth: depth in meters mapped to the brightest grayscale value.
+  DepthUpsampler(int window_size, float max_depth);
+
+  // Set the color camera intrinsics. The output images have the resolution of
+  // the color camera.
+  void SetCameraIntrinsics(const TangoCameraIntrinsics& intrinsics);
+
+  // Set the half size of the splat window.
+  void SetWindowSize(int window_size);
+
+  // Keep the nearest depth for pixels covered by several points instead of
+  // the depth of the last point. The grayscale buffer is then derived from
+  // the depth buffer once all points have been splatted.
+  void SetDepthTest(bool depth_test) { depth_test_ = depth_test; }
+  bool GetDepthTest() const { return depth_test_; }
+
+  // Limit the number of bands Upsample() splits the image in, and so the
+  // threads it runs on. Defaults to the number of cores of the device.
+  void SetMaxThreadCount(int max_thread_count);
+
+  // Project and splat a point cloud.
+  //
+  // @param color_t1_T_depth_t0: transformation from the depth camera frame
+  //    of the point cloud to the color camera frame of the image.
+  // @param point_cloud: the point cloud to project.
+  void Upsample(const glm::mat4& color_t1_T_depth_t0,
+                const TangoXYZij* point_cloud);
+
+  // @return the depth in meters of every pixel, 0 where no point was splatted.
+  const std::vector<float>& GetDepthBuffer() const { return depth_buffer_; }
+
+  // @return the depth of every pixel scaled to [0, 255] for display as a
+  // GL_LUMINANCE texture.
+  const std::vector<uint8_t>& GetGrayscaleBuffer() const {
+    return grayscale_buffer_;
+  }
+
+ private:
+  // Project points [begin, end) of the cloud into projected_x_, projected_y_
+  // and projected_depth_.
+  void ProjectPoints(const glm::mat4& color_t1_T_depth_t0,
+                     const TangoXYZij* point_cloud, int begin, int end);
+
+  // Clear the pixels written by the previous frame and splat every projected
+  // point into rows [row_begin, row_end).
+  void SplatRows(int point_count, int row_begin, int row_end);
+
+  // Account the capacity of the buffers.
+  void UpdateMemoryAccount();
+
+  int window_size_;
+  float depth_to_grayscale_;
+  bool depth_test_;
+  int max_thread_count_;
+
+  TangoCameraIntrinsics intrinsics_;
+
+  // Pixel coordinates and depth of every projected point. Preallocated so
+  // Upsample() does not allocate once the largest cloud has been seen.
+  std::vector<int32_t> projected_x_;
+  std::vector<int32_t> projected_y_;
+  std::vector<float> projected_depth_;
+
+  std::vector<float> depth_buffer_;
+  std::vector<uint8_t> grayscale_buffer_;
+
+  // Columns [dirty_begin_[y], dirty_end_[y]) of row y contain every pixel
+  // written by the last Upsample(); the rest of the row is zero. Only these
+  // spans are cleared before the next frame is splatted, instead of the whole
+  // image. They are kept per row so they stay valid when the bands change.
+  std::vector<int> dirty_begin_;
+  std::vector<int> dirty_end_;
+
+  tango_gl::MemoryAccount memory_;
+};
+}  // namespace rgb_depth_sync
+
+#endif  // RGB_DEPTH_SYNC_DEPTH_UPSAMPLER_H_
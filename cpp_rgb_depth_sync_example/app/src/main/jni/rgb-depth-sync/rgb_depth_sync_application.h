@@ -18,6 +18,8 @@
 #define RGB_DEPTH_SYNC_RGB_DEPTH_SYNC_APPLICATION_H_
 
 #include <jni.h>
+#include <atomic>
+#include <string>
 #include <vector>
 
 #include <tango_client_api.h>
@@ -27,6 +29,13 @@
 #include <rgb-depth-sync/scene.h>
 #include <rgb-depth-sync/util.h>
 #include <tango-gl/util.h>
+#include <tango-util/autotuner.h>
+#include <tango-util/feature_demand.h>
+#include <tango-util/frame_exporter.h>
+#include <tango-util/intrinsics_registry.h>
+#include <tango-util/path_calibration.h>
+#include <tango-util/point_cloud_queue.h>
+#include <tango-util/quality_governor.h>
 
 namespace rgb_depth_sync {
 
@@ -34,20 +43,12 @@ namespace rgb_depth_sync {
 // It can be instantiated in the JNI layer and use to pass information back and
 // forth between Java. The class also manages the application's lifecycle and
 // interaction with the Tango service. Primarily, this involves registering for
-// callbacks and passing on the necessary information to stored objects. It also
-// takes care of passing a vector container which has a pointer to the
-// latest point cloud buffer that is to used for rendering.
-//  To reduce the number of point cloud data copies between callback and render
-// threads we use three buffers which are synchronously exchanged between each
-// other so that the render loop always contains the latest point cloud data.
-// 1. Callback buffer : The buffer to which pointcloud data received from Tango
-// Service callback is copied out.
-// 2. Shared buffer: This buffer is used to share the data between Service
-// callback and Render loop
-// 3. Render Buffer: This buffer is used in the renderloop to project point
-// cloud data to a 2D image plane which is of the same size as RGB image. We
-// also make sure that this buffer contains the latest point cloud data that is
-//  received from the call back.
+// callbacks and passing on the necessary information to stored objects.
+//  The point clouds of the callback are copied once, into a
+// tango_util::PointCloudQueue holding the last few of them. The render loop
+// projects the one taken closest to the color image onto a 2D image plane of
+// the same size as the RGB image, rather than the latest, whose skew from the
+// image varies from frame to frame.
 class SynchronizationApplication {
  public:
   SynchronizationApplication();
@@ -99,16 +100,74 @@ class SynchronizationApplication {
   // Set the transparency of Depth Image.
   void SetDepthAlphaValue(float alpha);
 
-  // Set whether to use GPU or CPU upsampling
+  // Set whether to use GPU or CPU upsampling, over the calibrated one.
   void SetGPUUpsample(bool on);
 
+  // @return whether the GPU upsampling is used.
+  bool GetGPUUpsample() const { return gpu_upsample_; }
+
+  // Pick the faster of the CPU and GPU upsampling on the first depth frame,
+  // by timing both on a synthetic point cloud, and tune the band and tile
+  // counts of the CPU upsampling as it runs, unless the files of |directory|
+  // hold the choices made for this device. |device_key| describes the
+  // device, e.g. its model and OS build, the GL renderer and version are
+  // added to it, so that an update of either times them again. Must be
+  // called before the GL content is initialized.
+  void SetCalibrationStore(const std::string& directory,
+                           const std::string& device_key);
+
+  // @return true once the upsampling was picked by the calibration.
+  bool IsUpsampleCalibrated() const { return upsample_path_ >= 0; }
+
+  // Set whether the CPU upsampling keeps the nearest depth where splats
+  // overlap.
+  void SetDepthTest(bool on);
+
+  // Set whether the GPU upsampling fills the holes between the points,
+  // guided by the color image.
+  void SetFillHoles(bool on);
+
+  // Set whether to upsample the whole image with the bilateral filter of the
+  // support library on worker threads, over the other modes.
+  void SetBilateralUpsample(bool on);
+
+  // Export the metric depth images and the color images, for data
+  // collection, to |directory| until called with an empty one. The depth
+  // is then upsampled on the CPU, whose images are read back, and both
+  // cameras run whatever is shown. Stopping blocks until the frames queued
+  // are written.
+  void SetExportDirectory(const std::string& directory);
+
   // Callback for point clouds that come in from the Tango service.
   //
   // @param xyz_ij The point cloud returned by the service.
   //
   void OnXYZijAvailable(const TangoXYZij* xyz_ij);
 
+  // Callback for the color camera images, only used by the bilateral
+  // upsampling.
+  //
+  // @param buffer The image returned by the service.
+  void OnFrameAvailable(const TangoImageBuffer* buffer);
+
  private:
+  // The upsampling paths in the order the calibration times them.
+  enum UpsamplePath { kCpuUpsamplePath = 0, kGpuUpsamplePath = 1 };
+
+  // Pick the upsampling stored for the device, or time both, and load the
+  // tuned values. Called on the GL thread, once the color camera intrinsics
+  // are known.
+  void CalibrateUpsample();
+
+  // Copy a color image into a frame of the exporter. Called from the color
+  // camera callback thread.
+  void ExportColorImage(const TangoImageBuffer* buffer);
+
+  // Feed |tuner| the time of the depth image of |mode| produced since
+  // |image_revision|.
+  void AddTuningSample(DepthImage::Mode mode, tango_util::Autotuner* tuner,
+                       uint64_t* image_revision);
+
   // RGB image
   ColorImage color_image_;
 
@@ -128,15 +187,57 @@ class SynchronizationApplication {
   float screen_width_;
   float screen_height_;
 
-  // The point_cloud_manager allows for thread safe reading and
-  // writing of the point cloud data.
-  TangoSupportPointCloudManager* point_cloud_manager_;
-
-  // This TangoXYZij* points to the most recently produced
-  // point cloud data which should be rendered.
-  TangoXYZij* render_buffer_;
+  // The last point clouds of the depth callback, from which the render
+  // thread picks the one closest to the color image, and the skew of the
+  // pairs.
+  tango_util::PointCloudQueue point_cloud_queue_;
 
   bool gpu_upsample_;
+  bool depth_test_;
+  bool fill_holes_;
+  // Also read by the color camera callback thread.
+  std::atomic<bool> bilateral_upsample_;
+
+  // Times the upsampling paths, and keeps the fastest in the files of
+  // calibration_directory_. The calibration is pending until it ran or the
+  // upsampling was picked by hand, and upsample_path_ is the path it picked,
+  // -1 until then.
+  tango_util::PathCalibration upsample_calibration_;
+  std::string calibration_directory_;
+  std::string device_key_;
+  std::atomic<bool> is_upsample_calibration_pending_;
+  std::atomic<int> upsample_path_;
+
+  // Tune the band count of the CPU splat and the tile count of the bilateral
+  // upsampling on the frames with time to spare, from the depth images
+  // produced since the revisions.
+  tango_util::Autotuner splat_tuner_;
+  tango_util::Autotuner bilateral_tuner_;
+  uint64_t splat_image_revision_;
+  uint64_t bilateral_image_revision_;
+
+  // Trades the depth image resolution, splat size and point density for
+  // frame time and temperature.
+  tango_util::QualityGovernor quality_governor_;
+
+  // Runs depth only while the depth image is visible, and the color frame
+  // callback only while the bilateral upsampling needs the pixels.
+  tango_util::FeatureDemand feature_demand_;
+
+  // Writes the depth and color images while exporting, on threads of its
+  // own. Fed by the depth image on the render thread and by the color camera
+  // callback.
+  tango_util::FrameExporter frame_exporter_;
+
+  // Intrinsics of the color camera, queried once per connection.
+  tango_util::IntrinsicsRegistry intrinsics_;
+
+  // The transformation of the last frame rendered, and the timestamps it was
+  // queried at.
+  bool has_color_t1_T_depth_t0_;
+  double last_color_timestamp_;
+  double last_depth_timestamp_;
+  glm::mat4 color_image_t1_T_depth_image_t0_;
 };
 }  // namespace rgb_depth_sync
 
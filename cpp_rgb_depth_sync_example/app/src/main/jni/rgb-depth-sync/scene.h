@@ -46,6 +46,14 @@ class Scene {
   // Set the depth texture's alpha blending value. The range is [0.0, 1.0].
   void SetDepthAlphaValue(float alpha);
 
+  // Set the rectangle of the color image the depth texture covers, see
+  // DepthImage::GetTextureRegion().
+  void SetDepthTextureRegion(const glm::vec4& depth_region);
+
+  // Set how the depth texture holds the depth, see
+  // DepthImage::GetTextureEncoding().
+  void SetDepthTextureEncoding(DepthEncoding encoding);
+
   // Set the camera intrinsics to use for this scene.
   void SetCameraIntrinsics(const TangoCameraIntrinsics& cc_intrinsics);
 
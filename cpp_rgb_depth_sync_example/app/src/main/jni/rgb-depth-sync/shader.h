@@ -34,6 +34,10 @@ static const char kColorCameraVert[] =
 
 // Fragment shader for rendering a color texture on full screen with half alpha
 // blending, please note that the color camera texture is samplerExternalOES.
+// The depth texture only covers the depthRegion (x, y, width, height) of the
+// color image, and is not blended outside of it. It is shown in grayscale
+// whatever its depthEncoding, a DepthEncoding, the metric depths over
+// maxDepth.
 static const char kColorCameraFrag[] =
     "#extension GL_OES_EGL_image_external : require\n"
     "precision highp float;\n"
@@ -41,11 +45,24 @@ static const char kColorCameraFrag[] =
     "uniform float blendAlpha;\n"
     "uniform samplerExternalOES colorTexture;\n"
     "uniform sampler2D depthTexture;\n"
+    "uniform vec4 depthRegion;\n"
+    "uniform float depthEncoding;\n"
+    "uniform float maxDepth;\n"
     "varying vec2 f_textureCoords;\n"
     "void main() {\n"
     "  vec4 cColor = texture2D(colorTexture, f_textureCoords);\n"
-    "  vec4 cDepth = texture2D(depthTexture, f_textureCoords);\n"
-    "  gl_FragColor = (1.0-blendAlpha) * cColor + blendAlpha * cDepth;;\n"
+    "  vec2 depthCoords =\n"
+    "      (f_textureCoords - depthRegion.xy) / depthRegion.zw;\n"
+    "  vec4 cDepth = texture2D(depthTexture, depthCoords);\n"
+    "  if (depthEncoding > 1.5) {\n"
+    "    cDepth.rgb = vec3(cDepth.r + cDepth.g / 255.0);\n"
+    "  } else if (depthEncoding > 0.5) {\n"
+    "    cDepth.rgb = vec3(cDepth.r / maxDepth);\n"
+    "  }\n"
+    "  vec2 inside = step(vec2(0.0), depthCoords) *\n"
+    "      step(depthCoords, vec2(1.0));\n"
+    "  float alpha = blendAlpha * inside.x * inside.y;\n"
+    "  gl_FragColor = (1.0-alpha) * cColor + alpha * cDepth;\n"
     "}\n";
 
 }  // namespace shader
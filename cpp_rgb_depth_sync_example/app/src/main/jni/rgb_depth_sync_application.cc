@@ -13,11 +13,83 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
 #include <tango-gl/conversions.h>
+#include <tango-gl/tracing.h>
 #include <tango_support_api.h>
+#include <tango-util/pose_source.h>
 
 #include <rgb-depth-sync/rgb_depth_sync_application.h>
 
+namespace {
+// Work budget of a frame on the render thread, in milliseconds, which leaves
+// room for the rest of the system at 60Hz.
+const double kFrameBudget = 12.0;
+
+// Point clouds kept to pair with the color images: about a second of the
+// depth camera.
+const int kPointCloudQueueCapacity = 6;
+
+// The consumers of the features of the FeatureDemand, see
+// tango_util::FeatureDemand::SetDemand().
+const uint32_t kDepthOverlayConsumer = 1 << 0;
+const uint32_t kBilateralUpsampleConsumer = 1 << 1;
+const uint32_t kFrameExportConsumer = 1 << 2;
+
+// A couple of seconds of depth and color frames queued for the disk, whose
+// buffers grow to the largest frame once.
+const int kExportFrameCount = 12;
+
+// The synthetic point cloud the upsampling paths are timed on: a grid of
+// points over a wall kCalibrationDepth meters away, about as many as a frame
+// of the depth camera, across its field of view.
+const int kCalibrationColumns = 160;
+const int kCalibrationRows = 120;
+const float kCalibrationDepth = 2.0f;
+const float kCalibrationHalfWidth = 1.6f;
+const float kCalibrationHalfHeight = 1.2f;
+
+// Files of the calibration directory the choices are stored in.
+const char kUpsampleCalibrationFile[] = "/upsample_calibration";
+const char kSplatTuningFile[] = "/splat_tuning";
+const char kBilateralTuningFile[] = "/bilateral_tuning";
+
+tango_util::FrameExporter::Options GetExportOptions() {
+  tango_util::FrameExporter::Options options;
+  options.frame_count = kExportFrameCount;
+  return options;
+}
+
+// @return the counts of bands or tiles explored, |default_count| first.
+std::vector<int> GetTunedCounts(int default_count) {
+  std::vector<int> counts(1, default_count);
+  for (int count : {1, 2, 4, 2 * default_count}) {
+    if (std::find(counts.begin(), counts.end(), count) == counts.end()) {
+      counts.push_back(count);
+    }
+  }
+  return counts;
+}
+
+// The tuned band count of the CPU splat, a band per core by default, and
+// tile count of the bilateral upsampling, which leaves a core to the render
+// thread.
+std::vector<tango_util::Autotuner::Parameter> GetSplatParameters() {
+  const int core_count =
+      std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+  return {{"band_count", GetTunedCounts(core_count)}};
+}
+
+std::vector<tango_util::Autotuner::Parameter> GetBilateralParameters() {
+  const int core_count =
+      std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+  return {{"tile_count", GetTunedCounts(std::max(core_count - 1, 1))}};
+}
+}  // namespace
+
 namespace rgb_depth_sync {
 
 // This function will route callbacks to our application object via the context
@@ -32,8 +104,56 @@ void OnXYZijAvailableRouter(void* context, const TangoXYZij* xyz_ij) {
 }
 
 void SynchronizationApplication::OnXYZijAvailable(const TangoXYZij* xyz_ij) {
-  // We'll just update the point cloud associated with our depth image.
-  TangoSupport_updatePointCloud(point_cloud_manager_, xyz_ij);
+  TANGO_TRACE_SCOPE("SynchronizationApplication::OnXYZijAvailable");
+  // The render thread pairs the color image with the closest point cloud.
+  point_cloud_queue_.OnPointCloudAvailable(xyz_ij);
+}
+
+// Route the color camera images to the application object, see
+// OnXYZijAvailableRouter().
+void OnFrameAvailableRouter(void* context, TangoCameraId,
+                            const TangoImageBuffer* buffer) {
+  SynchronizationApplication* app =
+      static_cast<SynchronizationApplication*>(context);
+  app->OnFrameAvailable(buffer);
+}
+
+void SynchronizationApplication::OnFrameAvailable(
+    const TangoImageBuffer* buffer) {
+  // Copying the images is only worth it when they are used.
+  if (bilateral_upsample_) {
+    depth_image_.UpdateColorImage(buffer);
+  }
+  if (frame_exporter_.IsRunning()) {
+    ExportColorImage(buffer);
+  }
+}
+
+void SynchronizationApplication::ExportColorImage(
+    const TangoImageBuffer* buffer) {
+  if (buffer->format != TANGO_HAL_PIXEL_FORMAT_YCrCb_420_SP) {
+    return;
+  }
+  // The luma rows, then the interleaved chroma rows of half the height,
+  // written without their padding.
+  const size_t row_size = buffer->width;
+  const size_t row_count = buffer->height + (buffer->height + 1) / 2;
+  tango_util::FrameExporter::Frame* frame =
+      frame_exporter_.Acquire(row_size * row_count);
+  if (frame == nullptr) {
+    return;
+  }
+  frame->format = tango_util::FrameExporter::kRawFormat;
+  frame->name = "color";
+  frame->extension = "nv21";
+  frame->width = buffer->width;
+  frame->height = buffer->height;
+  frame->timestamp = buffer->timestamp;
+  for (size_t row = 0; row < row_count; ++row) {
+    memcpy(frame->data + row * row_size, buffer->data + row * buffer->stride,
+           row_size);
+  }
+  frame_exporter_.Submit(frame);
 }
 
 SynchronizationApplication::SynchronizationApplication()
@@ -43,14 +163,31 @@ SynchronizationApplication::SynchronizationApplication()
       // We'll store the fixed transform between the opengl frame convention.
       // (Y-up, X-right) and tango frame convention. (Z-up, X-right).
       OW_T_SS_(tango_gl::conversions::opengl_world_T_tango_world()),
-      gpu_upsample_(false) {}
+      gpu_upsample_(false),
+      depth_test_(false),
+      fill_holes_(false),
+      bilateral_upsample_(false),
+      upsample_calibration_(tango_util::PathCalibration::Options()),
+      is_upsample_calibration_pending_(false),
+      upsample_path_(-1),
+      splat_tuner_(GetSplatParameters(), tango_util::Autotuner::Options()),
+      bilateral_tuner_(GetBilateralParameters(),
+                       tango_util::Autotuner::Options()),
+      splat_image_revision_(0),
+      bilateral_image_revision_(0),
+      quality_governor_(tango_util::QualityGovernor::DefaultLevels(),
+                        kFrameBudget),
+      frame_exporter_(GetExportOptions()),
+      has_color_t1_T_depth_t0_(false),
+      last_color_timestamp_(0.0),
+      last_depth_timestamp_(0.0) {
+  depth_image_.SetFrameExporter(&frame_exporter_);
+}
 
 SynchronizationApplication::~SynchronizationApplication() {
   if (tango_config_) {
     TangoConfig_free(tango_config_);
   }
-  TangoSupport_freePointCloudManager(point_cloud_manager_);
-  point_cloud_manager_ = nullptr;
 }
 
 bool SynchronizationApplication::CheckTangoVersion(JNIEnv* env,
@@ -76,7 +213,12 @@ void SynchronizationApplication::OnTangoServiceConnected(JNIEnv* env,
 
 bool SynchronizationApplication::TangoSetupConfig() {
   SetDepthAlphaValue(0.0);
-  SetGPUUpsample(false);
+  // The calibrated upsampling, rather than SetGPUUpsample() which overrides
+  // it.
+  gpu_upsample_ = upsample_path_ == kGpuUpsamplePath;
+  SetDepthTest(false);
+  SetFillHoles(false);
+  SetBilateralUpsample(false);
 
   if (tango_config_ != nullptr) {
     return true;
@@ -91,10 +233,9 @@ bool SynchronizationApplication::TangoSetupConfig() {
   }
 
   // In addition to motion tracking, however, we want to run with depth so that
-  // we can sync Image data with Depth Data. As such, we're going to set an
-  // additional flag "config_enable_depth" to true.
-  TangoErrorType err =
-      TangoConfig_setBool(tango_config_, "config_enable_depth", true);
+  // we can sync Image data with Depth Data. Depth is enabled here but only
+  // runs while the depth image is visible, see SetDepthAlphaValue().
+  TangoErrorType err = feature_demand_.Configure(tango_config_);
   if (err != TANGO_SUCCESS) {
     LOGE("Failed to enable depth.");
     return false;
@@ -122,9 +263,9 @@ bool SynchronizationApplication::TangoSetupConfig() {
     return false;
   }
 
-  // Use the tango_config to set up the PointCloudManager before we connect
+  // Use the tango_config to set up the point cloud queue before we connect
   // the callbacks.
-  if (point_cloud_manager_ == nullptr) {
+  if (!point_cloud_queue_.IsInitialized()) {
     int32_t max_point_cloud_elements;
     err = TangoConfig_getInt32(tango_config_, "max_point_cloud_elements",
                                &max_point_cloud_elements);
@@ -132,12 +273,9 @@ bool SynchronizationApplication::TangoSetupConfig() {
       LOGE("Failed to query maximum number of point cloud elements.");
       return false;
     }
-
-    err = TangoSupport_createPointCloudManager(max_point_cloud_elements,
-                                               &point_cloud_manager_);
-    if (err != TANGO_SUCCESS) {
-      return false;
-    }
+    depth_image_.SetMaxPointCount(max_point_cloud_elements);
+    point_cloud_queue_.Initialize(kPointCloudQueueCapacity,
+                                  max_point_cloud_elements);
   }
 
   return true;
@@ -151,6 +289,8 @@ bool SynchronizationApplication::TangoConnectTexture() {
   // in our render loop, we'll be polling for the color image as needed.
   TangoErrorType err = TangoService_connectTextureId(
       TANGO_CAMERA_COLOR, color_image_.GetTextureId(), this, nullptr);
+  // Connected again whenever the color frame callback is disconnected.
+  feature_demand_.SetColorTexture(color_image_.GetTextureId(), this);
   return err == TANGO_SUCCESS;
 }
 
@@ -162,7 +302,15 @@ bool SynchronizationApplication::TangoConnectCallbacks() {
   // our poses will be driven by timestamps. As such, we'll use GetPoseAtTime.
   TangoErrorType depth_ret =
       TangoService_connectOnXYZijAvailable(OnXYZijAvailableRouter);
-  return depth_ret == TANGO_SUCCESS;
+  if (depth_ret != TANGO_SUCCESS) {
+    return false;
+  }
+  // The bilateral upsampling needs the pixels of the color image, which the
+  // texture does not give to the CPU. The point to point example gets both
+  // the same way, but here the frames are only connected while the
+  // bilateral upsampling is on.
+  feature_demand_.SetColorFrameCallback(this, OnFrameAvailableRouter);
+  return true;
 }
 
 bool SynchronizationApplication::TangoConnect() {
@@ -174,6 +322,7 @@ bool SynchronizationApplication::TangoConnect() {
     LOGE("SynchronizationApplication: Failed to connect to the Tango service.");
     return false;
   }
+  feature_demand_.OnConnected();
   return true;
 }
 bool SynchronizationApplication::TangoSetIntrinsicsAndExtrinsics() {
@@ -181,9 +330,10 @@ bool SynchronizationApplication::TangoSetIntrinsicsAndExtrinsics() {
   // image. We need these to know how to project the point cloud into the color
   // camera frame.
   TangoCameraIntrinsics color_camera_intrinsics;
-  TangoErrorType err = TangoService_getCameraIntrinsics(
-      TANGO_CAMERA_COLOR, &color_camera_intrinsics);
-  if (err != TANGO_SUCCESS) {
+  TangoErrorType err = intrinsics_.Update(TANGO_CAMERA_COLOR);
+  if (err != TANGO_SUCCESS ||
+      !intrinsics_.GetIntrinsics(TANGO_CAMERA_COLOR,
+                                 &color_camera_intrinsics)) {
     LOGE(
         "SynchronizationApplication: Failed to get the intrinsics for the color"
         "camera.");
@@ -196,10 +346,14 @@ bool SynchronizationApplication::TangoSetIntrinsicsAndExtrinsics() {
 }
 
 void SynchronizationApplication::TangoDisconnect() {
+  feature_demand_.OnDisconnected();
   TangoService_disconnect();
 }
 
 void SynchronizationApplication::InitializeGLContent() {
+  // The support library looks up the poses of calculateRelativePose() from
+  // the same source as the rest of the example, e.g. a replayed session.
+  TangoSupport_initialize(tango_util::GetPoseAtTime);
   depth_image_.InitializeGL();
   color_image_.InitializeGL();
   main_scene_.InitializeGL();
@@ -212,94 +366,236 @@ void SynchronizationApplication::SetViewPort(int width, int height) {
 }
 
 void SynchronizationApplication::Render() {
+  TANGO_TRACE_SCOPE("SynchronizationApplication::Render");
+  quality_governor_.BeginFrame();
+  feature_demand_.Apply();
+  // The depth image is what this example shows, so it is always rendered and
+  // only made cheaper.
+  const tango_util::QualityLevel& quality = quality_governor_.GetLevel();
+  depth_image_.SetWindowSize(quality.depth_window_size);
+  depth_image_.SetPointStride(quality.point_cloud_stride);
+  depth_image_.SetImageDivisor(quality.color_image_divisor);
+  // Only the frames with time to spare try other counts, which never change
+  // the depth image.
+  const bool has_headroom = quality_governor_.HasHeadroom();
+  splat_tuner_.SetCanExplore(has_headroom);
+  bilateral_tuner_.SetCanExplore(has_headroom);
+  depth_image_.SetSplatBandCount(splat_tuner_.GetValue(0));
+  depth_image_.SetBilateralTileCount(bilateral_tuner_.GetValue(0));
+
   double color_timestamp = 0.0;
-  double depth_timestamp = 0.0;
-  bool new_points = false;
-  TangoSupport_getLatestPointCloudAndNewDataFlag(point_cloud_manager_,
-                                                 &render_buffer_, &new_points);
-  depth_timestamp = render_buffer_->timestamp;
   // We need to make sure that we update the texture associated with the color
   // image.
-  if (TangoService_updateTexture(TANGO_CAMERA_COLOR, &color_timestamp) !=
-      TANGO_SUCCESS) {
+  TangoErrorType status;
+  {
+    TANGO_TRACE_SCOPE("TangoService_updateTexture");
+    status = TangoService_updateTexture(TANGO_CAMERA_COLOR, &color_timestamp);
+  }
+  if (status != TANGO_SUCCESS) {
     LOGE("SynchronizationApplication: Failed to get a color image.");
   }
 
-  // Querying the depth image's frame transformation based on the depth image's
-  // timestamp.
-  TangoPoseData pose_start_service_T_depth_camera_t0;
-  TangoCoordinateFramePair depth_frame_pair;
-  depth_frame_pair.base = TANGO_COORDINATE_FRAME_START_OF_SERVICE;
-  depth_frame_pair.target = TANGO_COORDINATE_FRAME_CAMERA_DEPTH;
-  if (TangoService_getPoseAtTime(depth_timestamp, depth_frame_pair,
-                                 &pose_start_service_T_depth_camera_t0) !=
-      TANGO_SUCCESS) {
-    LOGE(
-        "SynchronizationApplication: Could not find a valid pose at time %lf"
-        " for the depth camera.",
-        depth_timestamp);
+  // With the depth image hidden there is nothing to update, and depth may
+  // not even be running.
+  if (!feature_demand_.IsDemanded(tango_util::FeatureDemand::kDepth)) {
+    main_scene_.Render(color_image_.GetTextureId(),
+                       depth_image_.GetTextureId());
+    quality_governor_.EndFrame();
+    return;
   }
 
-  // Querying the color image's frame transformation based on the depth image's
-  // timestamp.
-  TangoPoseData pose_color_camera_t1_T_start_service;
-  TangoCoordinateFramePair color_frame_pair;
-  color_frame_pair.base = TANGO_COORDINATE_FRAME_CAMERA_COLOR;
-  color_frame_pair.target = TANGO_COORDINATE_FRAME_START_OF_SERVICE;
-  if (TangoService_getPoseAtTime(color_timestamp, color_frame_pair,
-                                 &pose_color_camera_t1_T_start_service) !=
-      TANGO_SUCCESS) {
-    LOGE(
-        "SynchronizationApplication: Could not find a valid pose at time %lf"
-        " for the color camera.",
-        color_timestamp);
+  // The point cloud taken closest to the color image, rather than the
+  // latest, which keeps the depth image from lagging behind it.
+  bool new_points = false;
+  const TangoXYZij* render_buffer =
+      point_cloud_queue_.Acquire(color_timestamp, &new_points);
+  if (render_buffer == nullptr) {
+    // No point cloud arrived yet.
+    quality_governor_.EndFrame();
+    return;
+  }
+  // Once a point cloud arrived, the service is connected and the intrinsics
+  // set.
+  if (is_upsample_calibration_pending_) {
+    CalibrateUpsample();
   }
+  const double depth_timestamp = render_buffer->timestamp;
 
   // In the following code, we define t0 as the depth timestamp and t1 as the
-  // color camera timestamp.
-  //
-  // Device frame at timestamp t0 (depth timestamp) with respect to start of
-  // service.
-  glm::mat4 start_service_T_depth_camera_t0 =
-      util::GetMatrixFromPose(&pose_start_service_T_depth_camera_t0);
-  // Device frame at timestamp t1 (color timestamp) with respect to start of
-  // service.
-  glm::mat4 color_camera_t1_T_start_service =
-      util::GetMatrixFromPose(&pose_color_camera_t1_T_start_service);
-
-  if (pose_color_camera_t1_T_start_service.status_code == TANGO_POSE_VALID) {
-    if (pose_start_service_T_depth_camera_t0.status_code == TANGO_POSE_VALID) {
+  // color camera timestamp. The transformation only depends on the two
+  // timestamps, so it is only queried when either changes.
+  const bool is_same_frame = has_color_t1_T_depth_t0_ &&
+                             color_timestamp == last_color_timestamp_ &&
+                             depth_timestamp == last_depth_timestamp_;
+  if (!is_same_frame) {
+    // The Depth Camera frame at timestamp t0 with respect to the Color Camera
+    // frame at timestamp t1, in a single query instead of one pose per
+    // camera.
+    TangoPoseData pose_color_camera_t1_T_depth_camera_t0;
+    if (TangoSupport_calculateRelativePose(
+            color_timestamp, TANGO_COORDINATE_FRAME_CAMERA_COLOR,
+            depth_timestamp, TANGO_COORDINATE_FRAME_CAMERA_DEPTH,
+            &pose_color_camera_t1_T_depth_camera_t0) != TANGO_SUCCESS ||
+        pose_color_camera_t1_T_depth_camera_t0.status_code !=
+            TANGO_POSE_VALID) {
       // Note that we are discarding all invalid poses at the moment, another
       // option could be to use the latest pose when the queried pose is
       // invalid.
-
-      // The Color Camera frame at timestamp t0 with respect to Depth
-      // Camera frame at timestamp t1.
-      glm::mat4 color_image_t1_T_depth_image_t0 =
-          color_camera_t1_T_start_service * start_service_T_depth_camera_t0;
-
-      if (gpu_upsample_) {
-        depth_image_.RenderDepthToTexture(color_image_t1_T_depth_image_t0,
-                                          render_buffer_,
-                                          new_points);
-      } else {
-        depth_image_.UpdateAndUpsampleDepth(color_image_t1_T_depth_image_t0,
-                                            render_buffer_);
-      }
-      main_scene_.Render(color_image_.GetTextureId(),
-                         depth_image_.GetTextureId());
-    } else {
-      LOGE("Invalid pose for ss_t_depth at time: %lf", depth_timestamp);
+      LOGE(
+          "SynchronizationApplication: Could not find a valid pose between"
+          " the color camera at time %lf and the depth camera at time %lf.",
+          color_timestamp, depth_timestamp);
+      quality_governor_.EndFrame();
+      return;
     }
+    color_image_t1_T_depth_image_t0_ =
+        util::GetMatrixFromPose(&pose_color_camera_t1_T_depth_camera_t0);
+    last_color_timestamp_ = color_timestamp;
+    last_depth_timestamp_ = depth_timestamp;
+    has_color_t1_T_depth_t0_ = true;
+  }
+
+  // The depth image skips the frames where neither the point cloud, the
+  // settings nor, noticeably, the transformation changed.
+  // The images of the GPU are not read back for the export.
+  const bool gpu_upsample = gpu_upsample_ && !frame_exporter_.IsRunning();
+  if (bilateral_upsample_) {
+    depth_image_.UpdateBilateralDepth(render_buffer);
+  } else if (gpu_upsample && fill_holes_) {
+    depth_image_.RenderFilledDepthToTexture(
+        color_image_t1_T_depth_image_t0_, render_buffer, new_points,
+        color_image_.GetTextureId());
+  } else if (gpu_upsample) {
+    depth_image_.RenderDepthToTexture(color_image_t1_T_depth_image_t0_,
+                                      render_buffer, new_points);
   } else {
-    LOGE("Invalid pose for ss_t_color at time: %lf", color_timestamp);
+    depth_image_.SetDepthTest(depth_test_);
+    depth_image_.UpdateAndUpsampleDepth(color_image_t1_T_depth_image_t0_,
+                                        render_buffer);
   }
+  AddTuningSample(DepthImage::kCpuSplatMode, &splat_tuner_,
+                  &splat_image_revision_);
+  AddTuningSample(DepthImage::kCpuBilateralMode, &bilateral_tuner_,
+                  &bilateral_image_revision_);
+  main_scene_.SetDepthTextureRegion(depth_image_.GetTextureRegion());
+  main_scene_.SetDepthTextureEncoding(depth_image_.GetTextureEncoding());
+  main_scene_.Render(color_image_.GetTextureId(), depth_image_.GetTextureId());
+  quality_governor_.EndFrame();
 }
 
 void SynchronizationApplication::SetDepthAlphaValue(float alpha) {
   main_scene_.SetDepthAlphaValue(alpha);
+  feature_demand_.SetDemand(tango_util::FeatureDemand::kDepth,
+                            kDepthOverlayConsumer, alpha > 0.0f);
+}
+
+void SynchronizationApplication::SetGPUUpsample(bool on) {
+  gpu_upsample_ = on;
+  is_upsample_calibration_pending_ = false;
+}
+
+void SynchronizationApplication::SetExportDirectory(
+    const std::string& directory) {
+  frame_exporter_.Stop();
+  const bool is_exporting =
+      !directory.empty() && frame_exporter_.Start(directory.c_str());
+  feature_demand_.SetDemand(tango_util::FeatureDemand::kDepth,
+                            kFrameExportConsumer, is_exporting);
+  feature_demand_.SetDemand(tango_util::FeatureDemand::kColorFrames,
+                            kFrameExportConsumer, is_exporting);
 }
 
-void SynchronizationApplication::SetGPUUpsample(bool on) { gpu_upsample_ = on; }
+void SynchronizationApplication::SetCalibrationStore(
+    const std::string& directory, const std::string& device_key) {
+  calibration_directory_ = directory;
+  device_key_ = device_key;
+  is_upsample_calibration_pending_ = !directory.empty();
+}
+
+void SynchronizationApplication::CalibrateUpsample() {
+  TANGO_TRACE_SCOPE("SynchronizationApplication::CalibrateUpsample");
+  is_upsample_calibration_pending_ = false;
+
+  // The fastest path depends on the GL driver as much as on the device.
+  std::string key = device_key_;
+  for (GLenum name : {GL_RENDERER, GL_VERSION}) {
+    const GLubyte* value = glGetString(name);
+    if (value != nullptr) {
+      key += " ";
+      key += reinterpret_cast<const char*>(value);
+    }
+  }
+  splat_tuner_.SetStore(calibration_directory_ + kSplatTuningFile, key);
+  splat_tuner_.Load();
+  bilateral_tuner_.SetStore(calibration_directory_ + kBilateralTuningFile,
+                            key);
+  bilateral_tuner_.Load();
+
+  upsample_calibration_.SetStore(
+      calibration_directory_ + kUpsampleCalibrationFile, key);
+  int path = upsample_calibration_.LoadChoice();
+  if (path < 0) {
+    std::vector<float> points;
+    points.reserve(kCalibrationColumns * kCalibrationRows * 3);
+    for (int row = 0; row < kCalibrationRows; ++row) {
+      for (int column = 0; column < kCalibrationColumns; ++column) {
+        points.push_back(kCalibrationHalfWidth *
+                         (2.0f * column / (kCalibrationColumns - 1) - 1.0f));
+        points.push_back(kCalibrationHalfHeight *
+                         (2.0f * row / (kCalibrationRows - 1) - 1.0f));
+        points.push_back(kCalibrationDepth);
+      }
+    }
+    TangoXYZij point_cloud = {};
+    point_cloud.xyz_count = kCalibrationColumns * kCalibrationRows;
+    point_cloud.xyz = reinterpret_cast<float(*)[3]>(points.data());
+    const glm::mat4 color_T_depth(1.0f);
+
+    // Every run is a new point cloud, for the depth image not to skip it, and
+    // waits for the GPU, for its time to hold the work of the GPU path.
+    std::vector<tango_util::PathCalibration::Path> paths(2);
+    paths[kCpuUpsamplePath] = [&]() {
+      point_cloud.timestamp += 1.0;
+      depth_image_.SetDepthTest(depth_test_);
+      depth_image_.UpdateAndUpsampleDepth(color_T_depth, &point_cloud);
+      glFinish();
+    };
+    paths[kGpuUpsamplePath] = [&]() {
+      point_cloud.timestamp += 1.0;
+      depth_image_.RenderDepthToTexture(color_T_depth, &point_cloud, true);
+      glFinish();
+    };
+    path = upsample_calibration_.Calibrate(paths);
+    const std::vector<double>& times = upsample_calibration_.GetTimes();
+    LOGI(
+        "SynchronizationApplication: CPU upsampling in %.2f ms, GPU in %.2f "
+        "ms, using the %s one.",
+        times[kCpuUpsamplePath], times[kGpuUpsamplePath],
+        path == kGpuUpsamplePath ? "GPU" : "CPU");
+  }
+  upsample_path_ = path;
+  gpu_upsample_ = path == kGpuUpsamplePath;
+}
+
+void SynchronizationApplication::AddTuningSample(DepthImage::Mode mode,
+                                                 tango_util::Autotuner* tuner,
+                                                 uint64_t* image_revision) {
+  const uint64_t revision = depth_image_.GetImageRevision(mode);
+  if (revision == *image_revision) {
+    return;
+  }
+  *image_revision = revision;
+  tuner->AddSample(depth_image_.GetLastImageTime(mode));
+}
+
+void SynchronizationApplication::SetDepthTest(bool on) { depth_test_ = on; }
+
+void SynchronizationApplication::SetFillHoles(bool on) { fill_holes_ = on; }
+
+void SynchronizationApplication::SetBilateralUpsample(bool on) {
+  bilateral_upsample_ = on;
+  feature_demand_.SetDemand(tango_util::FeatureDemand::kColorFrames,
+                            kBilateralUpsampleConsumer, on);
+}
 
 }  // namespace rgb_depth_sync
@@ -91,4 +91,12 @@ void Scene::SetDepthAlphaValue(float alpha) {
   camera_texture_drawable_.SetBlendAlpha(alpha);
 }
 
+void Scene::SetDepthTextureRegion(const glm::vec4& depth_region) {
+  camera_texture_drawable_.SetDepthTextureRegion(depth_region);
+}
+
+void Scene::SetDepthTextureEncoding(DepthEncoding encoding) {
+  camera_texture_drawable_.SetDepthEncoding(encoding);
+}
+
 }  // namespace rgb_depth_sync
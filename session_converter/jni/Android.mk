@@ -0,0 +1,44 @@
+# Copyright 2016 Google Inc. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# The session log converter, a command line tool built as an executable of
+# the Tango ABIs, from the session_converter directory:
+#
+#   ndk-build
+#   adb push libs/x86 /data/local/tmp/session_converter
+#   adb shell 'cd /data/local/tmp/session_converter &&
+#       LD_LIBRARY_PATH=. ./session_converter /sdcard/converted /sdcard/logs'
+#
+# See session_converter.cc for its options.
+
+LOCAL_PATH := $(call my-dir)
+PROJECT_ROOT:= $(LOCAL_PATH)/../..
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := session_converter
+LOCAL_SHARED_LIBRARIES := tango_client_api tango_support_api
+LOCAL_STATIC_LIBRARIES := tango_util tango_gl
+LOCAL_CFLAGS := -std=c++11
+LOCAL_SRC_FILES := session_converter.cc
+LOCAL_LDLIBS := -llog -lGLESv2 -lEGL -L$(SYSROOT)/usr/lib
+ifeq ($(APP_OPTIM),release)
+LOCAL_CFLAGS += -O3
+endif
+include $(BUILD_EXECUTABLE)
+
+$(call import-add-path,$(PROJECT_ROOT))
+$(call import-module,tango_client_api)
+$(call import-module,tango_support_api)
+$(call import-module,tango_gl)
+$(call import-module,tango_util)
@@ -0,0 +1,487 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// session_converter converts session logs, see tango-util/session_log.h,
+// into the files of the offline pipeline:
+//
+//   session_converter [options] <output directory> <log or directory>...
+//
+// Every log given, and every file of the directories given, is replayed as
+// fast as it decodes, into <output directory>/<log name>/:
+//  - cloud.ply, the voxel filtered points accumulated in a PointCloudMap,
+//  - mesh.ply, the TsdfVolume the filtered points are fused into,
+//  - depth_<timestamp>.png, every point cloud projected into a 16 bit depth
+//    image of millimeters, with --depth_intrinsics.
+//
+// The logs are converted in parallel, one per core, each memory mapped and
+// streamed through by its SessionReader, and the depth images are encoded
+// and written while the next point clouds are fused. The options are:
+//   --jobs=<count>: logs converted at a time, the cores by default.
+//   --leaf_size=<meters>: voxel grid filter, 0 to keep every point.
+//   --map_voxel_size=<meters>, --tsdf_voxel_size=<meters>.
+//   --device_T_depth=<tx,ty,tz,qx,qy,qz,qw>: the depth camera extrinsics,
+//       which the logs do not record, nominally the depth camera looking
+//       along -z of the device.
+//   --depth_intrinsics=<width,height,fx,fy,cx,cy>: the depth image, without
+//       distortion, no depth images by default.
+//   --no_cloud, --no_mesh: skip cloud.ply, mesh.ply.
+
+#include <dirent.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <tango_client_api.h>  // NOLINT
+#include <tango_support_api.h>
+#include <tango-gl/conversions.h>
+#include <tango-gl/util.h>
+#include <tango-util/frame_exporter.h>
+#include <tango-util/ply_exporter.h>
+#include <tango-util/point_cloud_map.h>
+#include <tango-util/session_player.h>
+#include <tango-util/task_scheduler.h>
+#include <tango-util/tsdf_volume.h>
+#include <tango-util/voxel_grid_filter.h>
+
+namespace {
+struct ConverterOptions {
+  ConverterOptions()
+      : job_count(0),
+        leaf_size(0.02f),
+        map_voxel_size(0.02f),
+        tsdf_voxel_size(0.03f),
+        device_T_depth(tango_gl::conversions::TransformFromVecAndQuat(
+            glm::vec3(0.0f), glm::quat(0.0f, 1.0f, 0.0f, 0.0f))),
+        has_depth_intrinsics(false),
+        depth_width(0),
+        depth_height(0),
+        fx(0.0f),
+        fy(0.0f),
+        cx(0.0f),
+        cy(0.0f),
+        export_cloud(true),
+        export_mesh(true) {}
+
+  int job_count;
+  float leaf_size;
+  float map_voxel_size;
+  float tsdf_voxel_size;
+  glm::mat4 device_T_depth;
+  bool has_depth_intrinsics;
+  int depth_width;
+  int depth_height;
+  float fx;
+  float fy;
+  float cx;
+  float cy;
+  bool export_cloud;
+  bool export_mesh;
+};
+
+struct SessionStats {
+  uint64_t point_cloud_count;
+  uint64_t skipped_count;
+  uint64_t point_count;
+  uint64_t depth_image_count;
+  size_t block_count;
+  double seconds;
+};
+
+// @return: false if |path| is neither a directory nor could be created.
+bool MakeDirectory(const std::string& path) {
+  if (mkdir(path.c_str(), 0755) != 0 && errno != EEXIST) {
+    fprintf(stderr, "Failed to create %s: %s\n", path.c_str(),
+            strerror(errno));
+    return false;
+  }
+  return true;
+}
+
+// Converts one log, see the top of the file. Every method runs on the thread
+// converting it, the callbacks of the player included.
+class SessionConverter {
+ public:
+  SessionConverter(const ConverterOptions& options, int mesh_thread_count);
+  SessionConverter(const SessionConverter& other) = delete;
+  SessionConverter& operator=(const SessionConverter&) = delete;
+
+  // @param directory: receives the files, created if needed.
+  bool Convert(const char* log_path, const std::string& directory,
+               SessionStats* stats);
+
+ private:
+  static void OnXYZijAvailableRouter(void* context, const TangoXYZij* xyz_ij);
+  void OnXYZijAvailable(const TangoXYZij* xyz_ij);
+
+  // Project |xyz_ij| into depths_, the nearest point of every pixel.
+  void ProjectDepth(const TangoXYZij* xyz_ij);
+
+  // Write the map and the meshes of the volume.
+  bool ExportGeometry(const std::string& directory);
+
+  const ConverterOptions& options_;
+  tango_util::SessionPlayer player_;
+  tango_util::VoxelGridFilter filter_;
+  tango_util::PointCloudMap map_;
+  tango_util::TsdfVolume volume_;
+  tango_util::FrameExporter frame_exporter_;
+  std::vector<float> depths_;
+  SessionStats stats_;
+};
+
+tango_util::PointCloudMap::Options GetMapOptions(
+    const ConverterOptions& options) {
+  tango_util::PointCloudMap::Options map_options;
+  map_options.voxel_size = options.map_voxel_size;
+  map_options.max_memory_size = 32 << 20;
+  return map_options;
+}
+
+tango_util::TsdfVolume::Options GetVolumeOptions(
+    const ConverterOptions& options, int mesh_thread_count) {
+  tango_util::TsdfVolume::Options volume_options;
+  volume_options.voxel_size = options.tsdf_voxel_size;
+  volume_options.truncation_distance = 3.0f * options.tsdf_voxel_size;
+  // 128 MB of blocks at most, a floor of a building at 3 cm.
+  volume_options.max_block_count = 32768;
+  volume_options.thread_count = mesh_thread_count;
+  return volume_options;
+}
+
+tango_util::FrameExporter::Options GetFrameExporterOptions() {
+  // The other logs keep the other cores busy, and no frame may be dropped.
+  tango_util::FrameExporter::Options exporter_options;
+  exporter_options.encode_thread_count = 1;
+  exporter_options.wait_for_frame = true;
+  return exporter_options;
+}
+
+SessionConverter::SessionConverter(const ConverterOptions& options,
+                                   int mesh_thread_count)
+    : options_(options),
+      map_(GetMapOptions(options)),
+      volume_(GetVolumeOptions(options, mesh_thread_count)),
+      frame_exporter_(GetFrameExporterOptions()) {
+  filter_.SetLeafSize(options.leaf_size);
+  memset(&stats_, 0, sizeof(stats_));
+}
+
+bool SessionConverter::Convert(const char* log_path,
+                               const std::string& directory,
+                               SessionStats* stats) {
+  const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  if (!player_.Open(log_path) || !MakeDirectory(directory)) {
+    return false;
+  }
+  // The poses are loaded by Open(), only the point clouds are replayed.
+  player_.SetRecordTypes(1u << tango_util::session_log::kPointCloudRecord);
+  player_.ConnectOnXYZijAvailable(this, OnXYZijAvailableRouter);
+  if (options_.has_depth_intrinsics &&
+      !frame_exporter_.Start(directory.c_str())) {
+    return false;
+  }
+  while (player_.Step()) {
+  }
+  frame_exporter_.Stop();
+  const tango_util::FrameExporter::Stats exporter_stats =
+      frame_exporter_.GetStats();
+  stats_.depth_image_count = exporter_stats.written_count;
+
+  const bool is_exported =
+      ExportGeometry(directory) && exporter_stats.failed_count == 0;
+  stats_.block_count = volume_.GetBlockCount();
+  stats_.seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start).count();
+  *stats = stats_;
+  return is_exported;
+}
+
+void SessionConverter::OnXYZijAvailableRouter(void* context,
+                                              const TangoXYZij* xyz_ij) {
+  static_cast<SessionConverter*>(context)->OnXYZijAvailable(xyz_ij);
+}
+
+void SessionConverter::OnXYZijAvailable(const TangoXYZij* xyz_ij) {
+  TangoCoordinateFramePair frame;
+  frame.base = TANGO_COORDINATE_FRAME_START_OF_SERVICE;
+  frame.target = TANGO_COORDINATE_FRAME_DEVICE;
+  TangoPoseData pose;
+  player_.GetPoseAtTime(xyz_ij->timestamp, frame, &pose);
+  if (pose.status_code != TANGO_POSE_VALID) {
+    ++stats_.skipped_count;
+    return;
+  }
+  ++stats_.point_cloud_count;
+  stats_.point_count += xyz_ij->xyz_count;
+  const glm::mat4 start_service_T_depth =
+      tango_gl::conversions::TransformFromArrays(pose.translation,
+                                                 pose.orientation) *
+      options_.device_T_depth;
+
+  if (frame_exporter_.IsRunning()) {
+    ProjectDepth(xyz_ij);
+    frame_exporter_.ExportDepth("depth", depths_.data(), options_.depth_width,
+                                options_.depth_height, xyz_ij->timestamp);
+  }
+
+  // The logs of a device have point clouds of the same size, so this only
+  // allocates for the first one.
+  if (xyz_ij->xyz_count > filter_.GetCapacity()) {
+    filter_.Reserve(xyz_ij->xyz_count);
+  }
+  const TangoXYZij* filtered = filter_.Filter(xyz_ij);
+  if (options_.export_cloud) {
+    map_.Insert(filtered, start_service_T_depth);
+  }
+  if (options_.export_mesh) {
+    volume_.Integrate(filtered, start_service_T_depth);
+  }
+}
+
+void SessionConverter::ProjectDepth(const TangoXYZij* xyz_ij) {
+  const int width = options_.depth_width;
+  const int height = options_.depth_height;
+  depths_.assign(static_cast<size_t>(width) * height, 0.0f);
+  for (uint32_t i = 0; i < xyz_ij->xyz_count; ++i) {
+    const float* point = xyz_ij->xyz[i];
+    if (point[2] <= 0.0f) {
+      continue;
+    }
+    const float inverse_z = 1.0f / point[2];
+    const int x = static_cast<int>(
+        std::floor(options_.fx * point[0] * inverse_z + options_.cx));
+    const int y = static_cast<int>(
+        std::floor(options_.fy * point[1] * inverse_z + options_.cy));
+    if (x < 0 || y < 0 || x >= width || y >= height) {
+      continue;
+    }
+    float& depth = depths_[static_cast<size_t>(y) * width + x];
+    if (depth == 0.0f || point[2] < depth) {
+      depth = point[2];
+    }
+  }
+}
+
+bool SessionConverter::ExportGeometry(const std::string& directory) {
+  tango_util::PlyExporter exporter;
+  if (options_.export_cloud) {
+    exporter.ExportPointCloudMap((directory + "/cloud.ply").c_str(), &map_);
+    exporter.Wait();
+  }
+  if (options_.export_mesh) {
+    std::vector<TangoMesh_Experimental> meshes;
+    volume_.ExtractMeshes(&meshes);
+    std::vector<const TangoMesh_Experimental*> mesh_pointers;
+    for (const TangoMesh_Experimental& mesh : meshes) {
+      if (mesh.num_faces > 0) {
+        mesh_pointers.push_back(&mesh);
+      }
+    }
+    // A log without a surface has no mesh to write.
+    if (!mesh_pointers.empty()) {
+      exporter.ExportMeshes((directory + "/mesh.ply").c_str(), mesh_pointers);
+      exporter.Wait();
+    }
+    for (TangoMesh_Experimental& mesh : meshes) {
+      TangoSupport_freeMesh(&mesh);
+    }
+  }
+  return exporter.GetStats().failed_count == 0;
+}
+
+// Append |path| to |logs| if it is a file, and the files it holds if it is a
+// directory, sorted by name.
+void ListLogs(const std::string& path, std::vector<std::string>* logs) {
+  struct stat path_stat;
+  if (stat(path.c_str(), &path_stat) != 0) {
+    fprintf(stderr, "Failed to find %s\n", path.c_str());
+    return;
+  }
+  if (!S_ISDIR(path_stat.st_mode)) {
+    logs->push_back(path);
+    return;
+  }
+  DIR* directory = opendir(path.c_str());
+  if (directory == NULL) {
+    fprintf(stderr, "Failed to list %s\n", path.c_str());
+    return;
+  }
+  std::vector<std::string> files;
+  while (const dirent* entry = readdir(directory)) {
+    const std::string file = path + "/" + entry->d_name;
+    struct stat file_stat;
+    if (stat(file.c_str(), &file_stat) == 0 && S_ISREG(file_stat.st_mode)) {
+      files.push_back(file);
+    }
+  }
+  closedir(directory);
+  std::sort(files.begin(), files.end());
+  logs->insert(logs->end(), files.begin(), files.end());
+}
+
+// @return: the file name of |path| without its extension.
+std::string GetSessionName(const std::string& path) {
+  const size_t slash = path.find_last_of('/');
+  std::string name =
+      slash == std::string::npos ? path : path.substr(slash + 1);
+  const size_t dot = name.find_last_of('.');
+  if (dot != std::string::npos && dot > 0) {
+    name.resize(dot);
+  }
+  return name;
+}
+
+// Parse the option |argument| into |options|.
+//
+// @return: false if it is not an option.
+bool ParseOption(const char* argument, ConverterOptions* options) {
+  float values[7];
+  if (sscanf(argument, "--jobs=%d", &options->job_count) == 1) {
+    return true;
+  }
+  if (sscanf(argument, "--leaf_size=%f", &options->leaf_size) == 1) {
+    return true;
+  }
+  if (sscanf(argument, "--map_voxel_size=%f", &options->map_voxel_size) ==
+      1) {
+    return options->map_voxel_size > 0.0f;
+  }
+  if (sscanf(argument, "--tsdf_voxel_size=%f", &options->tsdf_voxel_size) ==
+      1) {
+    return options->tsdf_voxel_size > 0.0f;
+  }
+  if (sscanf(argument, "--device_T_depth=%f,%f,%f,%f,%f,%f,%f", &values[0],
+             &values[1], &values[2], &values[3], &values[4], &values[5],
+             &values[6]) == 7) {
+    options->device_T_depth = tango_gl::conversions::TransformFromVecAndQuat(
+        glm::vec3(values[0], values[1], values[2]),
+        glm::normalize(glm::quat(values[6], values[3], values[4], values[5])));
+    return true;
+  }
+  if (sscanf(argument, "--depth_intrinsics=%d,%d,%f,%f,%f,%f",
+             &options->depth_width, &options->depth_height, &options->fx,
+             &options->fy, &options->cx, &options->cy) == 6) {
+    options->has_depth_intrinsics =
+        options->depth_width > 0 && options->depth_height > 0;
+    return options->has_depth_intrinsics;
+  }
+  if (strcmp(argument, "--no_cloud") == 0) {
+    options->export_cloud = false;
+    return true;
+  }
+  if (strcmp(argument, "--no_mesh") == 0) {
+    options->export_mesh = false;
+    return true;
+  }
+  return false;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  ConverterOptions options;
+  std::vector<const char*> arguments;
+  for (int i = 1; i < argc; ++i) {
+    if (strncmp(argv[i], "--", 2) != 0) {
+      arguments.push_back(argv[i]);
+    } else if (!ParseOption(argv[i], &options)) {
+      fprintf(stderr, "Invalid option %s\n", argv[i]);
+      return 2;
+    }
+  }
+  if (arguments.size() < 2) {
+    fprintf(stderr,
+            "Usage: %s [options] <output directory> <log or directory>...\n"
+            "See session_converter.cc for the options.\n",
+            argv[0]);
+    return 2;
+  }
+  const std::string output_directory = arguments[0];
+  if (!MakeDirectory(output_directory)) {
+    return 1;
+  }
+  std::vector<std::string> logs;
+  for (size_t i = 1; i < arguments.size(); ++i) {
+    ListLogs(arguments[i], &logs);
+  }
+  if (logs.empty()) {
+    fprintf(stderr, "No session log to convert\n");
+    return 1;
+  }
+
+  // A job per core, and the cores left over when there are fewer logs than
+  // cores mesh the volumes.
+  const int core_count =
+      std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+  const int job_count = std::min(
+      options.job_count > 0 ? options.job_count : core_count,
+      static_cast<int>(logs.size()));
+  const int mesh_thread_count = std::max(core_count / job_count - 1, 0);
+  tango_util::TaskScheduler::Options scheduler_options;
+  scheduler_options.worker_count = job_count - 1;
+  tango_util::TaskScheduler scheduler(scheduler_options);
+
+  const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  std::mutex print_mutex;
+  std::atomic<int> failed_count(0);
+  std::atomic<uint64_t> point_cloud_count(0);
+  scheduler.ParallelFor(0, logs.size(), 1, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      const std::string directory =
+          output_directory + "/" + GetSessionName(logs[i]);
+      SessionStats stats;
+      SessionConverter converter(options, mesh_thread_count);
+      const bool is_converted =
+          converter.Convert(logs[i].c_str(), directory, &stats);
+      std::lock_guard<std::mutex> lock(print_mutex);
+      if (!is_converted) {
+        ++failed_count;
+        fprintf(stderr, "Failed to convert %s\n", logs[i].c_str());
+        continue;
+      }
+      point_cloud_count += stats.point_cloud_count;
+      printf("%s: %llu point clouds, %llu without a pose, %llu points, "
+             "%llu depth images, %zu blocks, in %.1f s\n",
+             logs[i].c_str(),
+             static_cast<unsigned long long>(stats.point_cloud_count),  // NOLINT
+             static_cast<unsigned long long>(stats.skipped_count),  // NOLINT
+             static_cast<unsigned long long>(stats.point_count),  // NOLINT
+             static_cast<unsigned long long>(stats.depth_image_count),  // NOLINT
+             stats.block_count, stats.seconds);
+      fflush(stdout);
+    }
+  });
+
+  const double seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start).count();
+  printf("Converted %zu of %zu logs, %llu point clouds, in %.1f s on %d "
+         "jobs\n",
+         logs.size() - failed_count.load(), logs.size(),
+         static_cast<unsigned long long>(point_cloud_count.load()),  // NOLINT
+         seconds, job_count);
+  return failed_count.load() == 0 ? 0 : 1;
+}
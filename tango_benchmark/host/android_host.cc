@@ -0,0 +1,88 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// The Android functions the tree calls, for the desktop build of the
+// benchmarks: the log goes to stderr, a looper is a condition variable
+// waited on until its timeout or a wake, and there are no windows.
+
+#include <android/log.h>
+#include <android/looper.h>
+#include <android/native_window.h>
+
+#include <stdarg.h>
+#include <stdio.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+struct ALooper {
+  ALooper() : is_woken(false) {}
+
+  std::mutex mutex;
+  std::condition_variable condition;
+  bool is_woken;
+};
+
+namespace {
+const char kPriorityLetters[] = "??VDIWEFS";
+}  // namespace
+
+int __android_log_print(int priority, const char* tag, const char* format,
+                        ...) {
+  const bool is_known = priority >= 0 && priority <= ANDROID_LOG_SILENT;
+  const char letter = is_known ? kPriorityLetters[priority] : '?';
+  fprintf(stderr, "%c/%s: ", letter, tag);
+  va_list args;
+  va_start(args, format);
+  const int length = vfprintf(stderr, format, args);
+  va_end(args);
+  fputc('\n', stderr);
+  return length;
+}
+
+ALooper* ALooper_prepare(int /*options*/) {
+  // Like the NDK's, one looper per thread, for the life of the thread.
+  static thread_local ALooper looper;
+  return &looper;
+}
+
+int ALooper_pollOnce(int timeout_ms, int* /*out_fd*/, int* /*out_events*/,
+                     void** /*out_data*/) {
+  ALooper* looper = ALooper_prepare(0);
+  std::unique_lock<std::mutex> lock(looper->mutex);
+  if (timeout_ms < 0) {
+    looper->condition.wait(lock, [looper] { return looper->is_woken; });
+  } else if (!looper->condition.wait_for(
+                 lock, std::chrono::milliseconds(timeout_ms),
+                 [looper] { return looper->is_woken; })) {
+    return ALOOPER_POLL_TIMEOUT;
+  }
+  looper->is_woken = false;
+  return ALOOPER_POLL_WAKE;
+}
+
+void ALooper_wake(ALooper* looper) {
+  {
+    std::lock_guard<std::mutex> lock(looper->mutex);
+    looper->is_woken = true;
+  }
+  looper->condition.notify_all();
+}
+
+void ANativeWindow_acquire(ANativeWindow* /*window*/) {}
+
+void ANativeWindow_release(ANativeWindow* /*window*/) {}
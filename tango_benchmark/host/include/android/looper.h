@@ -0,0 +1,48 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_BENCHMARK_HOST_ANDROID_LOOPER_H_
+#define TANGO_BENCHMARK_HOST_ANDROID_LOOPER_H_
+
+// The part of the NDK's android/looper.h the tree uses, for the desktop
+// build of the benchmarks. A looper only waits for its timeout or a wake,
+// there are no file descriptors to poll, see android_host.cc.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ALooper ALooper;
+
+enum {
+  ALOOPER_POLL_WAKE = -1,
+  ALOOPER_POLL_CALLBACK = -2,
+  ALOOPER_POLL_TIMEOUT = -3,
+  ALOOPER_POLL_ERROR = -4
+};
+
+ALooper* ALooper_prepare(int options);
+
+int ALooper_pollOnce(int timeout_ms, int* out_fd, int* out_events,
+                     void** out_data);
+
+void ALooper_wake(ALooper* looper);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // TANGO_BENCHMARK_HOST_ANDROID_LOOPER_H_
@@ -0,0 +1,39 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_BENCHMARK_HOST_ANDROID_NATIVE_WINDOW_H_
+#define TANGO_BENCHMARK_HOST_ANDROID_NATIVE_WINDOW_H_
+
+// The part of the NDK's android/native_window.h the tree uses, for the
+// desktop build of the benchmarks. There are no windows to get on the
+// desktop, and EGL takes a window as a void*, with the
+// EGL_NO_PLATFORM_SPECIFIC_TYPES of CMakeLists.txt.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ANativeWindow ANativeWindow;
+
+void ANativeWindow_acquire(ANativeWindow* window);
+
+void ANativeWindow_release(ANativeWindow* window);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // TANGO_BENCHMARK_HOST_ANDROID_NATIVE_WINDOW_H_
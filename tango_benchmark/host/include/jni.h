@@ -0,0 +1,171 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_BENCHMARK_HOST_JNI_H_
+#define TANGO_BENCHMARK_HOST_JNI_H_
+
+// The part of jni.h the tree uses, for the desktop build of the benchmarks.
+// The layout follows the NDK's: JNIEnv and JavaVM call through a table of
+// functions, of which only the ones the tree calls are kept. There is no
+// virtual machine on the desktop, so nothing ever gets a JNIEnv, and the
+// benchmarks pass nullptr where one is expected.
+
+#include <stdarg.h>
+#include <stddef.h>  // Which the stdint.h of bionic includes.
+#include <stdint.h>
+
+typedef uint8_t jboolean;
+typedef int8_t jbyte;
+typedef uint16_t jchar;
+typedef int16_t jshort;
+typedef int32_t jint;
+typedef int64_t jlong;
+typedef float jfloat;
+typedef double jdouble;
+typedef jint jsize;
+
+class _jobject {};
+class _jclass : public _jobject {};
+class _jstring : public _jobject {};
+class _jarray : public _jobject {};
+class _jfloatArray : public _jarray {};
+class _jbyteArray : public _jarray {};
+class _jintArray : public _jarray {};
+class _jobjectArray : public _jarray {};
+
+typedef _jobject* jobject;
+typedef _jclass* jclass;
+typedef _jstring* jstring;
+typedef _jarray* jarray;
+typedef _jfloatArray* jfloatArray;
+typedef _jbyteArray* jbyteArray;
+typedef _jintArray* jintArray;
+typedef _jobjectArray* jobjectArray;
+
+struct _jmethodID;
+typedef struct _jmethodID* jmethodID;
+struct _jfieldID;
+typedef struct _jfieldID* jfieldID;
+
+#define JNI_FALSE 0
+#define JNI_TRUE 1
+
+#define JNI_OK 0
+#define JNI_ERR (-1)
+#define JNI_EDETACHED (-2)
+
+#define JNI_COMMIT 1
+#define JNI_ABORT 2
+
+#define JNI_VERSION_1_6 0x00010006
+
+#define JNIEXPORT __attribute__((visibility("default")))
+#define JNICALL
+
+struct _JNIEnv;
+struct _JavaVM;
+typedef _JNIEnv JNIEnv;
+typedef _JavaVM JavaVM;
+
+struct JNINativeInterface {
+  jclass (*GetObjectClass)(JNIEnv*, jobject);
+  jmethodID (*GetMethodID)(JNIEnv*, jclass, const char*, const char*);
+  void (*CallVoidMethodV)(JNIEnv*, jobject, jmethodID, va_list);
+  jobject (*NewGlobalRef)(JNIEnv*, jobject);
+  void (*DeleteGlobalRef)(JNIEnv*, jobject);
+  void (*DeleteLocalRef)(JNIEnv*, jobject);
+  jstring (*NewStringUTF)(JNIEnv*, const char*);
+  const char* (*GetStringUTFChars)(JNIEnv*, jstring, jboolean*);
+  void (*ReleaseStringUTFChars)(JNIEnv*, jstring, const char*);
+  jsize (*GetArrayLength)(JNIEnv*, jarray);
+  jfloat* (*GetFloatArrayElements)(JNIEnv*, jfloatArray, jboolean*);
+  void (*ReleaseFloatArrayElements)(JNIEnv*, jfloatArray, jfloat*, jint);
+  void (*SetFloatArrayRegion)(JNIEnv*, jfloatArray, jsize, jsize,
+                              const jfloat*);
+  jobject (*NewDirectByteBuffer)(JNIEnv*, void*, jlong);
+};
+
+struct _JNIEnv {
+  const JNINativeInterface* functions;
+
+  jclass GetObjectClass(jobject obj) {
+    return functions->GetObjectClass(this, obj);
+  }
+  jmethodID GetMethodID(jclass clazz, const char* name, const char* sig) {
+    return functions->GetMethodID(this, clazz, name, sig);
+  }
+  void CallVoidMethod(jobject obj, jmethodID method_id, ...) {
+    va_list args;
+    va_start(args, method_id);
+    functions->CallVoidMethodV(this, obj, method_id, args);
+    va_end(args);
+  }
+  jobject NewGlobalRef(jobject obj) {
+    return functions->NewGlobalRef(this, obj);
+  }
+  void DeleteGlobalRef(jobject global_ref) {
+    functions->DeleteGlobalRef(this, global_ref);
+  }
+  void DeleteLocalRef(jobject local_ref) {
+    functions->DeleteLocalRef(this, local_ref);
+  }
+  jstring NewStringUTF(const char* bytes) {
+    return functions->NewStringUTF(this, bytes);
+  }
+  const char* GetStringUTFChars(jstring string, jboolean* is_copy) {
+    return functions->GetStringUTFChars(this, string, is_copy);
+  }
+  void ReleaseStringUTFChars(jstring string, const char* utf) {
+    functions->ReleaseStringUTFChars(this, string, utf);
+  }
+  jsize GetArrayLength(jarray array) {
+    return functions->GetArrayLength(this, array);
+  }
+  jfloat* GetFloatArrayElements(jfloatArray array, jboolean* is_copy) {
+    return functions->GetFloatArrayElements(this, array, is_copy);
+  }
+  void ReleaseFloatArrayElements(jfloatArray array, jfloat* elems,
+                                 jint mode) {
+    functions->ReleaseFloatArrayElements(this, array, elems, mode);
+  }
+  void SetFloatArrayRegion(jfloatArray array, jsize start, jsize len,
+                           const jfloat* buf) {
+    functions->SetFloatArrayRegion(this, array, start, len, buf);
+  }
+  jobject NewDirectByteBuffer(void* address, jlong capacity) {
+    return functions->NewDirectByteBuffer(this, address, capacity);
+  }
+};
+
+struct JNIInvokeInterface {
+  jint (*AttachCurrentThread)(JavaVM*, JNIEnv**, void*);
+  jint (*DetachCurrentThread)(JavaVM*);
+  jint (*GetEnv)(JavaVM*, void**, jint);
+};
+
+struct _JavaVM {
+  const JNIInvokeInterface* functions;
+
+  jint AttachCurrentThread(JNIEnv** p_env, void* thr_args) {
+    return functions->AttachCurrentThread(this, p_env, thr_args);
+  }
+  jint DetachCurrentThread() { return functions->DetachCurrentThread(this); }
+  jint GetEnv(void** env, jint version) {
+    return functions->GetEnv(this, env, version);
+  }
+};
+
+#endif  // TANGO_BENCHMARK_HOST_JNI_H_
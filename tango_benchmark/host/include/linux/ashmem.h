@@ -0,0 +1,34 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_BENCHMARK_HOST_LINUX_ASHMEM_H_
+#define TANGO_BENCHMARK_HOST_LINUX_ASHMEM_H_
+
+// The ioctls of the Android kernel's linux/ashmem.h, for the desktop build
+// of the benchmarks. Desktop kernels have no /dev/ashmem, so opening it
+// fails and the shared memory publishers report it.
+
+#include <linux/ioctl.h>
+#include <stddef.h>
+
+#define ASHMEM_NAME_LEN 256
+
+#define __ASHMEMIOC 0x77
+#define ASHMEM_SET_NAME _IOW(__ASHMEMIOC, 1, char[ASHMEM_NAME_LEN])
+#define ASHMEM_SET_SIZE _IOW(__ASHMEMIOC, 3, size_t)
+#define ASHMEM_SET_PROT_MASK _IOW(__ASHMEMIOC, 5, unsigned long)
+
+#endif  // TANGO_BENCHMARK_HOST_LINUX_ASHMEM_H_
@@ -0,0 +1,382 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// The part of tango_support_api.h the examples the benchmarks run call, for
+// the desktop build, where the prebuilt library of the ARM and x86 devices
+// does not link. The poses come from TangoService_getPoseAtTime(), which the
+// mock service answers, converted to the OpenGL engine frames as the library
+// does. The bilateral upsampling is a nearest point splat, without the
+// filter guided by the color image: it only stands in for the work, not for
+// the output of the library. The correspondence transform always fails.
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+#include <tango_client_api.h>  // NOLINT
+#include <tango_support_api.h>
+#include <tango-gl/conversions.h>
+#include <tango-gl/util.h>
+
+struct TangoSupportImageBufferManager {
+  std::mutex mutex;
+  // The image of the latest update, copied into |front| by the next
+  // TangoSupport_getLatestImageBuffer().
+  std::vector<uint8_t> back;
+  TangoImageBuffer back_image;
+  bool has_new_image;
+  std::vector<uint8_t> front;
+  TangoImageBuffer front_image;
+};
+
+struct TangoSupportDepthInterpolator {
+  TangoCameraIntrinsics intrinsics;
+};
+
+namespace {
+// Above the minimum version of every example.
+const int kTangoVersion = 100000;
+// Half size of the splat of a point in pixels.
+const int kSplatRadius = 3;
+
+TangoSupport_GetPoseAtTimeFn get_pose_at_time = nullptr;
+
+TangoErrorType GetPose(double timestamp, TangoCoordinateFrameType base,
+                       TangoCoordinateFrameType target, TangoPoseData* pose) {
+  TangoCoordinateFramePair frame_pair;
+  frame_pair.base = base;
+  frame_pair.target = target;
+  return get_pose_at_time != nullptr
+             ? get_pose_at_time(timestamp, frame_pair, pose)
+             : TangoService_getPoseAtTime(timestamp, frame_pair, pose);
+}
+
+glm::mat4 MatrixFromPose(const TangoPoseData& pose) {
+  return tango_gl::conversions::TransformFromArrays(pose.translation,
+                                                    pose.orientation);
+}
+
+void SetPoseFromMatrix(const glm::mat4& matrix, TangoPoseData* pose) {
+  const glm::quat rotation = glm::normalize(glm::quat_cast(glm::mat3(matrix)));
+  pose->translation[0] = matrix[3][0];
+  pose->translation[1] = matrix[3][1];
+  pose->translation[2] = matrix[3][2];
+  pose->orientation[0] = rotation.x;
+  pose->orientation[1] = rotation.y;
+  pose->orientation[2] = rotation.z;
+  pose->orientation[3] = rotation.w;
+}
+
+bool IsWorldFrame(TangoCoordinateFrameType frame) {
+  return frame == TANGO_COORDINATE_FRAME_START_OF_SERVICE ||
+         frame == TANGO_COORDINATE_FRAME_AREA_DESCRIPTION;
+}
+
+// @return engine_T_tango of |frame|, how the engine sees the Tango frame.
+glm::mat4 GetEngineTFrame(TangoCoordinateFrameType frame,
+                          TangoSupportEngineType engine) {
+  if (engine != TANGO_SUPPORT_ENGINE_OPENGL) {
+    return glm::mat4(1.0f);
+  }
+  if (IsWorldFrame(frame)) {
+    return tango_gl::conversions::opengl_world_T_tango_world();
+  }
+  if (frame == TANGO_COORDINATE_FRAME_CAMERA_COLOR ||
+      frame == TANGO_COORDINATE_FRAME_CAMERA_DEPTH ||
+      frame == TANGO_COORDINATE_FRAME_CAMERA_FISHEYE) {
+    return glm::inverse(tango_gl::conversions::color_camera_T_opengl_camera());
+  }
+  // The device frame is already right, up, backward.
+  return glm::mat4(1.0f);
+}
+}  // namespace
+
+TangoErrorType TangoSupport_GetTangoVersion(JNIEnv*, jobject, int* version) {
+  if (version == nullptr) {
+    return TANGO_INVALID;
+  }
+  *version = kTangoVersion;
+  return TANGO_SUCCESS;
+}
+
+void TangoSupport_initialize(TangoSupport_GetPoseAtTimeFn getPoseAtTime) {
+  get_pose_at_time = getPoseAtTime;
+}
+
+TangoErrorType TangoSupport_createImageBufferManager(
+    TangoImageFormatType format, int width, int height,
+    TangoSupportImageBufferManager** manager) {
+  if (manager == nullptr || width <= 0 || height <= 0) {
+    return TANGO_INVALID;
+  }
+  TangoSupportImageBufferManager* new_manager =
+      new TangoSupportImageBufferManager();
+  memset(&new_manager->back_image, 0, sizeof(new_manager->back_image));
+  new_manager->back_image.format = format;
+  new_manager->back_image.width = width;
+  new_manager->back_image.height = height;
+  new_manager->back_image.stride = width;
+  new_manager->front_image = new_manager->back_image;
+  new_manager->has_new_image = false;
+  *manager = new_manager;
+  return TANGO_SUCCESS;
+}
+
+TangoErrorType TangoSupport_freeImageBufferManager(
+    TangoSupportImageBufferManager* manager) {
+  delete manager;
+  return TANGO_SUCCESS;
+}
+
+TangoErrorType TangoSupport_setImageBufferCopyRegion(
+    TangoSupportImageBufferManager* manager, int, uint32_t, uint32_t) {
+  // The whole image is copied.
+  return manager != nullptr ? TANGO_SUCCESS : TANGO_INVALID;
+}
+
+TangoErrorType TangoSupport_updateImageBuffer(
+    TangoSupportImageBufferManager* manager,
+    const TangoImageBuffer* image_buffer) {
+  if (manager == nullptr || image_buffer == nullptr) {
+    return TANGO_INVALID;
+  }
+  // The NV21 images of the color camera, luma and interleaved chroma.
+  const size_t size = static_cast<size_t>(image_buffer->stride) *
+                      image_buffer->height * 3 / 2;
+  std::lock_guard<std::mutex> lock(manager->mutex);
+  manager->back.assign(image_buffer->data, image_buffer->data + size);
+  manager->back_image = *image_buffer;
+  manager->back_image.data = manager->back.data();
+  manager->has_new_image = true;
+  return TANGO_SUCCESS;
+}
+
+TangoErrorType TangoSupport_getLatestImageBufferAndNewDataFlag(
+    TangoSupportImageBufferManager* manager, TangoImageBuffer** image_buffer,
+    bool* new_data) {
+  if (manager == nullptr || image_buffer == nullptr) {
+    return TANGO_INVALID;
+  }
+  std::lock_guard<std::mutex> lock(manager->mutex);
+  const bool has_new_image = manager->has_new_image;
+  if (has_new_image) {
+    manager->front.swap(manager->back);
+    manager->front_image = manager->back_image;
+    manager->front_image.data = manager->front.data();
+    manager->has_new_image = false;
+  }
+  if (new_data != nullptr) {
+    *new_data = has_new_image;
+  }
+  *image_buffer = &manager->front_image;
+  return TANGO_SUCCESS;
+}
+
+TangoErrorType TangoSupport_getLatestImageBuffer(
+    TangoSupportImageBufferManager* manager, TangoImageBuffer** image_buffer) {
+  return TangoSupport_getLatestImageBufferAndNewDataFlag(manager,
+                                                         image_buffer, nullptr);
+}
+
+TangoErrorType TangoSupport_calculateRelativePose(
+    double base_timestamp, TangoCoordinateFrameType base_frame,
+    double target_timestamp, TangoCoordinateFrameType target_frame,
+    TangoPoseData* base_frame_T_target_frame) {
+  if (base_frame_T_target_frame == nullptr) {
+    return TANGO_INVALID;
+  }
+  TangoPoseData start_service_T_base;
+  TangoPoseData start_service_T_target;
+  if (GetPose(base_timestamp, TANGO_COORDINATE_FRAME_START_OF_SERVICE,
+              base_frame, &start_service_T_base) != TANGO_SUCCESS ||
+      GetPose(target_timestamp, TANGO_COORDINATE_FRAME_START_OF_SERVICE,
+              target_frame, &start_service_T_target) != TANGO_SUCCESS ||
+      start_service_T_base.status_code != TANGO_POSE_VALID ||
+      start_service_T_target.status_code != TANGO_POSE_VALID) {
+    return TANGO_ERROR;
+  }
+  TangoPoseData* pose = base_frame_T_target_frame;
+  *pose = start_service_T_target;
+  pose->frame.base = base_frame;
+  pose->frame.target = target_frame;
+  SetPoseFromMatrix(glm::inverse(MatrixFromPose(start_service_T_base)) *
+                        MatrixFromPose(start_service_T_target),
+                    pose);
+  return TANGO_SUCCESS;
+}
+
+TangoErrorType TangoSupport_getPoseAtTime(
+    double timestamp, TangoCoordinateFrameType base_frame,
+    TangoCoordinateFrameType target_frame, TangoSupportEngineType engine,
+    TangoSupportDisplayRotation display_rotation_type, TangoPoseData* pose) {
+  if (pose == nullptr) {
+    return TANGO_INVALID;
+  }
+  const TangoErrorType result = GetPose(timestamp, base_frame, target_frame,
+                                        pose);
+  if (result != TANGO_SUCCESS || pose->status_code != TANGO_POSE_VALID) {
+    return result;
+  }
+  // The display rotates clockwise about the backward axis of the target.
+  const float display_angle = -0.5f * static_cast<float>(M_PI) *
+                              static_cast<int>(display_rotation_type);
+  const glm::mat4 target_T_display = glm::rotate(
+      glm::mat4(1.0f), display_angle, glm::vec3(0.0f, 0.0f, 1.0f));
+  SetPoseFromMatrix(GetEngineTFrame(base_frame, engine) *
+                        MatrixFromPose(*pose) *
+                        glm::inverse(GetEngineTFrame(target_frame, engine)) *
+                        target_T_display,
+                    pose);
+  return TANGO_SUCCESS;
+}
+
+TangoErrorType TangoSupport_createDepthInterpolator(
+    const TangoCameraIntrinsics* intrinsics,
+    TangoSupportDepthInterpolator** interpolator) {
+  if (intrinsics == nullptr || interpolator == nullptr) {
+    return TANGO_INVALID;
+  }
+  *interpolator = new TangoSupportDepthInterpolator();
+  (*interpolator)->intrinsics = *intrinsics;
+  return TANGO_SUCCESS;
+}
+
+TangoErrorType TangoSupport_freeDepthInterpolator(
+    TangoSupportDepthInterpolator* interpolator) {
+  delete interpolator;
+  return TANGO_SUCCESS;
+}
+
+TangoErrorType TangoSupport_initializeDepthBuffer(
+    uint32_t width, uint32_t height, TangoSupportDepthBuffer* depth_buffer) {
+  if (depth_buffer == nullptr || width == 0 || height == 0) {
+    return TANGO_INVALID;
+  }
+  depth_buffer->depths = static_cast<float*>(
+      calloc(static_cast<size_t>(width) * height, sizeof(float)));
+  if (depth_buffer->depths == nullptr) {
+    return TANGO_ERROR;
+  }
+  depth_buffer->width = width;
+  depth_buffer->height = height;
+  return TANGO_SUCCESS;
+}
+
+TangoErrorType TangoSupport_freeDepthBuffer(
+    TangoSupportDepthBuffer* depth_buffer) {
+  if (depth_buffer == nullptr) {
+    return TANGO_INVALID;
+  }
+  free(depth_buffer->depths);
+  depth_buffer->depths = nullptr;
+  return TANGO_SUCCESS;
+}
+
+TangoErrorType TangoSupport_upsampleImageBilateral(
+    const TangoSupportDepthInterpolator* interpolator, int,
+    const TangoXYZij* point_cloud, const TangoImageBuffer* image_buffer,
+    const TangoPoseData* color_camera_T_point_cloud,
+    TangoSupportDepthBuffer* depth_buffer) {
+  if (interpolator == nullptr || point_cloud == nullptr ||
+      point_cloud->xyz_count == 0 || image_buffer == nullptr ||
+      color_camera_T_point_cloud == nullptr || depth_buffer == nullptr ||
+      depth_buffer->depths == nullptr) {
+    return TANGO_INVALID;
+  }
+  const TangoCameraIntrinsics& intrinsics = interpolator->intrinsics;
+  const int width = static_cast<int>(depth_buffer->width);
+  const int height = static_cast<int>(depth_buffer->height);
+  std::fill(depth_buffer->depths, depth_buffer->depths + width * height, 0.0f);
+  const glm::mat4 color_T_points = MatrixFromPose(*color_camera_T_point_cloud);
+  for (uint32_t i = 0; i < point_cloud->xyz_count; ++i) {
+    const glm::vec3 point = tango_gl::util::ApplyTransform(
+        color_T_points, glm::vec3(point_cloud->xyz[i][0],
+                                  point_cloud->xyz[i][1],
+                                  point_cloud->xyz[i][2]));
+    if (point.z <= 0.0f) {
+      continue;
+    }
+    const int u = static_cast<int>(intrinsics.fx * point.x / point.z +
+                                   intrinsics.cx);
+    const int v = static_cast<int>(intrinsics.fy * point.y / point.z +
+                                   intrinsics.cy);
+    for (int y = std::max(v - kSplatRadius, 0);
+         y <= std::min(v + kSplatRadius, height - 1); ++y) {
+      float* row = depth_buffer->depths + y * width;
+      for (int x = std::max(u - kSplatRadius, 0);
+           x <= std::min(u + kSplatRadius, width - 1); ++x) {
+        if (row[x] == 0.0f || point.z < row[x]) {
+          row[x] = point.z;
+        }
+      }
+    }
+  }
+  return TANGO_SUCCESS;
+}
+
+TangoErrorType TangoSupport_initializeEmptyMesh(TangoMesh_Experimental* mesh) {
+  if (mesh == nullptr) {
+    return TANGO_INVALID;
+  }
+  memset(mesh, 0, sizeof(*mesh));
+  return TANGO_SUCCESS;
+}
+
+TangoErrorType TangoSupport_freeMesh(TangoMesh_Experimental* mesh) {
+  if (mesh == nullptr) {
+    return TANGO_INVALID;
+  }
+  free(mesh->vertices);
+  free(mesh->faces);
+  free(mesh->normals);
+  free(mesh->colors);
+  return TangoSupport_initializeEmptyMesh(mesh);
+}
+
+TangoErrorType TangoSupport_createMesh(uint32_t num_vertices,
+                                       uint32_t num_faces, bool has_normals,
+                                       bool has_colors,
+                                       TangoMesh_Experimental* mesh) {
+  if (TangoSupport_initializeEmptyMesh(mesh) != TANGO_SUCCESS) {
+    return TANGO_INVALID;
+  }
+  mesh->vertices =
+      static_cast<float(*)[3]>(calloc(num_vertices, sizeof(*mesh->vertices)));
+  mesh->faces =
+      static_cast<uint32_t(*)[3]>(calloc(num_faces, sizeof(*mesh->faces)));
+  if (has_normals) {
+    mesh->normals =
+        static_cast<float(*)[3]>(calloc(num_vertices, sizeof(*mesh->normals)));
+  }
+  if (has_colors) {
+    mesh->colors =
+        static_cast<uint8_t(*)[4]>(calloc(num_vertices, sizeof(*mesh->colors)));
+  }
+  mesh->num_vertices = num_vertices;
+  mesh->num_faces = num_faces;
+  mesh->has_normals = has_normals;
+  mesh->has_colors = has_colors;
+  return TANGO_SUCCESS;
+}
+
+// Only aligning a model to the map asks for it, which no benchmark does.
+TangoErrorType TangoSupport_findCorrespondenceSimilarityTransform(
+    double (*)[3], double (*)[3], int, double[16]) {
+  return TANGO_ERROR;
+}
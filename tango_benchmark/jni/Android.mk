@@ -0,0 +1,156 @@
+# Copyright 2016 Google Inc. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# The benchmarks of tango_gl and of the examples, command line tools built
+# as executables of the Tango ABIs, from the tango_benchmark directory:
+#
+#   ndk-build
+#   adb push libs/x86 /data/local/tmp/tango_benchmark
+#   adb shell 'cd /data/local/tmp/tango_benchmark &&
+#       LD_LIBRARY_PATH=. ./kernel_benchmark --min_time=2'
+#
+# On the desktop they build with CMake against Mesa, see CMakeLists.txt.
+# See kernel_benchmark.cc, render_benchmark.cc and regression_suite.cc for
+# their options. render_benchmark and regression_suite link tango_mock in
+# place of the Tango service, so they run on any device, and the sources of
+# the examples but for their JNI entry points.
+
+LOCAL_PATH := $(call my-dir)
+PROJECT_ROOT:= $(LOCAL_PATH)/../..
+HELLO_VIDEO_JNI := ../../cpp_basic_examples/hello_video/src/main/jni
+RGB_DEPTH_SYNC_JNI := ../../cpp_rgb_depth_sync_example/app/src/main/jni
+AUGMENTED_REALITY_JNI := ../../cpp_augmented_reality_example/app/src/main/jni
+MESH_BUILDER_JNI := ../../cpp_mesh_builder_example/app/src/main/jni
+MOTION_TRACKING_JNI := ../../cpp_motion_tracking_example/app/src/main/jni
+PLANE_FITTING_JNI := ../../cpp_plane_fitting_example/app/src/main/jni
+POINT_CLOUD_JNI := ../../cpp_point_cloud_example/app/src/main/jni
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := kernel_benchmark
+LOCAL_SHARED_LIBRARIES := tango_client_api tango_support_api
+LOCAL_STATIC_LIBRARIES := tango_util tango_gl
+LOCAL_CFLAGS := -std=c++11
+LOCAL_C_INCLUDES := $(LOCAL_PATH) \
+                    $(LOCAL_PATH)/$(HELLO_VIDEO_JNI) \
+                    $(LOCAL_PATH)/$(RGB_DEPTH_SYNC_JNI)
+LOCAL_SRC_FILES := kernel_benchmark.cc \
+                   offscreen_context.cc \
+                   $(HELLO_VIDEO_JNI)/yuv_converter.cc \
+                   $(RGB_DEPTH_SYNC_JNI)/depth_upsampler.cc
+LOCAL_LDLIBS := -llog -lGLESv2 -lEGL -L$(SYSROOT)/usr/lib
+# Built like in the examples, for the kernels to be timed as they ship.
+ifeq ($(APP_OPTIM),release)
+LOCAL_CFLAGS += -O3
+endif
+ifeq ($(TARGET_ARCH_ABI),armeabi-v7a)
+LOCAL_ARM_NEON := true
+endif
+ifeq ($(TARGET_ARCH_ABI),x86)
+LOCAL_CFLAGS += -mssse3
+endif
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := render_benchmark
+LOCAL_SHARED_LIBRARIES := tango_support_api
+LOCAL_STATIC_LIBRARIES := tango_mock tango_util tango_gl
+LOCAL_CFLAGS := -std=c++11
+LOCAL_C_INCLUDES := $(LOCAL_PATH) \
+                    $(LOCAL_PATH)/$(AUGMENTED_REALITY_JNI) \
+                    $(LOCAL_PATH)/$(MESH_BUILDER_JNI) \
+                    $(LOCAL_PATH)/$(MOTION_TRACKING_JNI) \
+                    $(LOCAL_PATH)/$(POINT_CLOUD_JNI) \
+                    $(LOCAL_PATH)/$(RGB_DEPTH_SYNC_JNI)
+LOCAL_SRC_FILES := render_benchmark.cc \
+                   offscreen_context.cc \
+                   $(AUGMENTED_REALITY_JNI)/augmented_reality_app.cc \
+                   $(AUGMENTED_REALITY_JNI)/pose_data.cc \
+                   $(AUGMENTED_REALITY_JNI)/scene.cc \
+                   $(AUGMENTED_REALITY_JNI)/tango_event_data.cc \
+                   $(MESH_BUILDER_JNI)/block_mesh_drawable.cc \
+                   $(MESH_BUILDER_JNI)/mesh_builder_app.cc \
+                   $(MESH_BUILDER_JNI)/scene.cc \
+                   $(MESH_BUILDER_JNI)/volume_raycaster.cc \
+                   $(MOTION_TRACKING_JNI)/motion_tracking_app.cc \
+                   $(MOTION_TRACKING_JNI)/scene.cc \
+                   $(POINT_CLOUD_JNI)/point_cloud_app.cc \
+                   $(POINT_CLOUD_JNI)/point_cloud_data.cc \
+                   $(POINT_CLOUD_JNI)/point_cloud_drawable.cc \
+                   $(POINT_CLOUD_JNI)/point_cloud_map_drawable.cc \
+                   $(POINT_CLOUD_JNI)/pose_data.cc \
+                   $(POINT_CLOUD_JNI)/scene.cc \
+                   $(RGB_DEPTH_SYNC_JNI)/bilateral_upsampler.cc \
+                   $(RGB_DEPTH_SYNC_JNI)/camera_texture_drawable.cc \
+                   $(RGB_DEPTH_SYNC_JNI)/color_image.cc \
+                   $(RGB_DEPTH_SYNC_JNI)/depth_compute_splatter.cc \
+                   $(RGB_DEPTH_SYNC_JNI)/depth_hole_filler.cc \
+                   $(RGB_DEPTH_SYNC_JNI)/depth_image.cc \
+                   $(RGB_DEPTH_SYNC_JNI)/depth_upsampler.cc \
+                   $(RGB_DEPTH_SYNC_JNI)/rgb_depth_sync_application.cc \
+                   $(RGB_DEPTH_SYNC_JNI)/scene.cc \
+                   $(RGB_DEPTH_SYNC_JNI)/util.cc
+LOCAL_LDLIBS := -llog -lGLESv2 -lEGL -landroid -L$(SYSROOT)/usr/lib
+ifeq ($(APP_OPTIM),release)
+LOCAL_CFLAGS += -O3
+endif
+ifeq ($(TARGET_ARCH_ABI),armeabi-v7a)
+LOCAL_ARM_NEON := true
+endif
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := regression_suite
+LOCAL_SHARED_LIBRARIES := tango_support_api
+LOCAL_STATIC_LIBRARIES := tango_mock tango_util tango_gl
+LOCAL_CFLAGS := -std=c++11
+LOCAL_C_INCLUDES := $(LOCAL_PATH) \
+                    $(LOCAL_PATH)/$(PLANE_FITTING_JNI) \
+                    $(LOCAL_PATH)/$(POINT_CLOUD_JNI) \
+                    $(LOCAL_PATH)/$(RGB_DEPTH_SYNC_JNI)
+LOCAL_SRC_FILES := regression_suite.cc \
+                   offscreen_context.cc \
+                   $(PLANE_FITTING_JNI)/plane_fitting.cc \
+                   $(PLANE_FITTING_JNI)/plane_fitting_application.cc \
+                   $(PLANE_FITTING_JNI)/point_cloud_renderer.cc \
+                   $(POINT_CLOUD_JNI)/point_cloud_app.cc \
+                   $(POINT_CLOUD_JNI)/point_cloud_data.cc \
+                   $(POINT_CLOUD_JNI)/point_cloud_drawable.cc \
+                   $(POINT_CLOUD_JNI)/point_cloud_map_drawable.cc \
+                   $(POINT_CLOUD_JNI)/pose_data.cc \
+                   $(POINT_CLOUD_JNI)/scene.cc \
+                   $(RGB_DEPTH_SYNC_JNI)/bilateral_upsampler.cc \
+                   $(RGB_DEPTH_SYNC_JNI)/camera_texture_drawable.cc \
+                   $(RGB_DEPTH_SYNC_JNI)/color_image.cc \
+                   $(RGB_DEPTH_SYNC_JNI)/depth_compute_splatter.cc \
+                   $(RGB_DEPTH_SYNC_JNI)/depth_hole_filler.cc \
+                   $(RGB_DEPTH_SYNC_JNI)/depth_image.cc \
+                   $(RGB_DEPTH_SYNC_JNI)/depth_upsampler.cc \
+                   $(RGB_DEPTH_SYNC_JNI)/rgb_depth_sync_application.cc \
+                   $(RGB_DEPTH_SYNC_JNI)/scene.cc \
+                   $(RGB_DEPTH_SYNC_JNI)/util.cc
+LOCAL_LDLIBS := -llog -lGLESv2 -lEGL -landroid -L$(SYSROOT)/usr/lib
+ifeq ($(APP_OPTIM),release)
+LOCAL_CFLAGS += -O3
+endif
+ifeq ($(TARGET_ARCH_ABI),armeabi-v7a)
+LOCAL_ARM_NEON := true
+endif
+include $(BUILD_EXECUTABLE)
+
+$(call import-add-path,$(PROJECT_ROOT))
+$(call import-module,tango_client_api)
+$(call import-module,tango_support_api)
+$(call import-module,tango_gl)
+$(call import-module,tango_mock)
+$(call import-module,tango_util)
@@ -0,0 +1,570 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// kernel_benchmark times the CPU kernels of tango_gl and of the examples on
+// synthetic frames and point clouds, and reports for each the time, the
+// bytes allocated and the allocations of one operation:
+//
+//   kernel_benchmark [--min_time=<seconds>] [--filter=<substring>]
+//
+// Every benchmark runs more operations until it took --min_time, 1 s by
+// default, like the benchmarks of Go, then prints a line of:
+//  - ns/op, the mean time of an operation,
+//  - MB/s, the input bytes an operation processes over its time, for the
+//    image, point cloud and file kernels,
+//  - B/op and allocs/op, what operator new allocated during the timed
+//    operations, on every thread, over the operations.
+// Only the benchmarks whose name contains --filter run. Band needs a
+// context, which an EGL pbuffer gives, see OffscreenContext.
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <tango_client_api.h>  // NOLINT
+#include <tango-gl/band.h>
+#include <tango-gl/obj_loader.h>
+#include <tango-gl/util.h>
+
+#include "hello_video/yuv_converter.h"
+#include "rgb-depth-sync/depth_upsampler.h"
+#include "tango-benchmark/offscreen_context.h"
+
+namespace {
+// Allocations of every thread since the start, counted by the operator new
+// below.
+std::atomic<uint64_t> allocated_bytes(0);
+std::atomic<uint64_t> allocation_count(0);
+}  // namespace
+
+void* operator new(size_t size) {
+  allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  void* pointer = malloc(size == 0 ? 1 : size);
+  if (pointer == nullptr) {
+    throw std::bad_alloc();
+  }
+  return pointer;
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+
+void operator delete(void* pointer) noexcept { free(pointer); }
+
+void operator delete[](void* pointer) noexcept { free(pointer); }
+
+void operator delete(void* pointer, size_t) noexcept { free(pointer); }
+
+void operator delete[](void* pointer, size_t) noexcept { free(pointer); }
+
+namespace {
+// Written with the results of the kernels, for them not to be optimized out.
+volatile uint64_t sink;
+
+// The timing of a run of |iterations| operations. A benchmark prepares its
+// data, calls ResetTimer() and runs the operations, the run being timed up to
+// its end or to StopTimer().
+class BenchmarkState {
+ public:
+  explicit BenchmarkState(int64_t iterations)
+      : iterations_(iterations),
+        bytes_processed_(0),
+        is_timing_(false),
+        has_failed_(false),
+        elapsed_(0),
+        bytes_(0),
+        allocations_(0) {}
+
+  int64_t GetIterations() const { return iterations_; }
+
+  // Start timing again from zero, dropping what the preparation took.
+  void ResetTimer() {
+    elapsed_ = std::chrono::steady_clock::duration(0);
+    bytes_ = 0;
+    allocations_ = 0;
+    StartTimer();
+  }
+
+  void StartTimer() {
+    if (is_timing_) {
+      return;
+    }
+    is_timing_ = true;
+    start_time_ = std::chrono::steady_clock::now();
+    start_bytes_ = allocated_bytes.load();
+    start_allocations_ = allocation_count.load();
+  }
+
+  void StopTimer() {
+    if (!is_timing_) {
+      return;
+    }
+    is_timing_ = false;
+    elapsed_ += std::chrono::steady_clock::now() - start_time_;
+    bytes_ += allocated_bytes.load() - start_bytes_;
+    allocations_ += allocation_count.load() - start_allocations_;
+  }
+
+  // Set the input bytes of an operation, for the MB/s of the report.
+  void SetBytesProcessed(int64_t bytes) { bytes_processed_ = bytes; }
+
+  // Stop the benchmark, which could not prepare its data.
+  void Fail() { has_failed_ = true; }
+
+  int64_t GetBytesProcessed() const { return bytes_processed_; }
+  bool HasFailed() const { return has_failed_; }
+  double GetSeconds() const {
+    return std::chrono::duration<double>(elapsed_).count();
+  }
+  uint64_t GetAllocatedBytes() const { return bytes_; }
+  uint64_t GetAllocationCount() const { return allocations_; }
+
+ private:
+  const int64_t iterations_;
+  int64_t bytes_processed_;
+  bool is_timing_;
+  bool has_failed_;
+  std::chrono::steady_clock::time_point start_time_;
+  std::chrono::steady_clock::duration elapsed_;
+  uint64_t start_bytes_;
+  uint64_t start_allocations_;
+  uint64_t bytes_;
+  uint64_t allocations_;
+};
+
+typedef void (*BenchmarkFunction)(BenchmarkState* state);
+
+struct Benchmark {
+  const char* name;
+  BenchmarkFunction function;
+  // Whether the benchmark needs a current GL context.
+  bool needs_context;
+};
+
+const glm::vec3 kAabbMin(-1.0f, -1.0f, -1.0f);
+const glm::vec3 kAabbMax(1.0f, 1.0f, 1.0f);
+const size_t kSegmentCount = 1024;
+const size_t kMatrixCount = 256;
+// Vertices per side of the synthetic OBJ height field.
+const int kObjGridSize = 128;
+
+// The color camera of the Tango development kit, at 1280x720.
+TangoCameraIntrinsics GetColorIntrinsics() {
+  TangoCameraIntrinsics intrinsics;
+  memset(&intrinsics, 0, sizeof(intrinsics));
+  intrinsics.camera_id = TANGO_CAMERA_COLOR;
+  intrinsics.calibration_type = TANGO_CALIBRATION_POLYNOMIAL_3_PARAMETERS;
+  intrinsics.width = 1280;
+  intrinsics.height = 720;
+  intrinsics.fx = 1042.0;
+  intrinsics.fy = 1042.0;
+  intrinsics.cx = 637.0;
+  intrinsics.cy = 357.0;
+  return intrinsics;
+}
+
+void BM_SegmentAABBIntersect(BenchmarkState* state) {
+  // Segments between two random points of a box twice as large as the
+  // tested one, so that about half of them intersect it.
+  std::mt19937 random(1);
+  std::uniform_real_distribution<float> coordinate(-2.0f, 2.0f);
+  std::vector<glm::vec3> starts(kSegmentCount);
+  std::vector<glm::vec3> ends(kSegmentCount);
+  for (size_t i = 0; i < kSegmentCount; ++i) {
+    starts[i] = glm::vec3(coordinate(random), coordinate(random),
+                          coordinate(random));
+    ends[i] = glm::vec3(coordinate(random), coordinate(random),
+                        coordinate(random));
+  }
+  uint64_t hit_count = 0;
+  state->ResetTimer();
+  for (int64_t i = 0; i < state->GetIterations(); ++i) {
+    const size_t segment = static_cast<size_t>(i) % kSegmentCount;
+    hit_count += tango_gl::util::SegmentAABBIntersect(
+        kAabbMin, kAabbMax, starts[segment], ends[segment]);
+  }
+  state->StopTimer();
+  sink = hit_count;
+}
+
+void BM_DecomposeMatrix(BenchmarkState* state) {
+  std::mt19937 random(2);
+  std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+  std::uniform_real_distribution<float> scale(0.5f, 2.0f);
+  std::vector<glm::mat4> matrices(kMatrixCount);
+  for (size_t i = 0; i < kMatrixCount; ++i) {
+    const glm::quat rotation = glm::normalize(
+        glm::quat(unit(random), unit(random), unit(random), unit(random)));
+    matrices[i] = glm::translate(glm::mat4(1.0f),
+                                 glm::vec3(unit(random), unit(random),
+                                           unit(random))) *
+                  glm::mat4_cast(rotation) *
+                  glm::scale(glm::mat4(1.0f),
+                             glm::vec3(scale(random), scale(random),
+                                       scale(random)));
+  }
+  glm::vec3 translation;
+  glm::quat rotation;
+  glm::vec3 scale_factors;
+  float sum = 0.0f;
+  state->ResetTimer();
+  for (int64_t i = 0; i < state->GetIterations(); ++i) {
+    tango_gl::util::DecomposeMatrix(
+        matrices[static_cast<size_t>(i) % kMatrixCount], translation,
+        rotation, scale_factors);
+    sum += translation.x + rotation.w + scale_factors.z;
+  }
+  state->StopTimer();
+  sink = static_cast<uint64_t>(sum);
+}
+
+// A kObjGridSize x kObjGridSize height field with its normals and quad
+// faces, written once in the temporary directory and removed at exit.
+class ObjFile {
+ public:
+  ObjFile() : size_(0) {
+#ifdef __ANDROID__
+    const char* directory = "/data/local/tmp";
+#else
+    const char* directory = "/tmp";
+#endif
+    const char* tmpdir = getenv("TMPDIR");
+    path_ = std::string(tmpdir != nullptr ? tmpdir : directory) +
+            "/kernel_benchmark.obj";
+    FILE* file = fopen(path_.c_str(), "w");
+    if (file == nullptr) {
+      fprintf(stderr, "Failed to create %s\n", path_.c_str());
+      path_.clear();
+      return;
+    }
+    const float step = 0.05f;
+    for (int y = 0; y < kObjGridSize; ++y) {
+      for (int x = 0; x < kObjGridSize; ++x) {
+        fprintf(file, "v %.4f %.4f %.4f\n", x * step,
+                0.1f * std::sin(0.3f * x) * std::cos(0.2f * y), y * step);
+      }
+    }
+    for (int y = 0; y < kObjGridSize; ++y) {
+      for (int x = 0; x < kObjGridSize; ++x) {
+        const glm::vec3 normal = glm::normalize(
+            glm::vec3(-0.03f * std::cos(0.3f * x) * std::cos(0.2f * y), 1.0f,
+                      0.02f * std::sin(0.3f * x) * std::sin(0.2f * y)));
+        fprintf(file, "vn %.4f %.4f %.4f\n", normal.x, normal.y, normal.z);
+      }
+    }
+    for (int y = 0; y + 1 < kObjGridSize; ++y) {
+      for (int x = 0; x + 1 < kObjGridSize; ++x) {
+        const int a = y * kObjGridSize + x + 1;
+        const int b = a + 1;
+        const int c = a + kObjGridSize + 1;
+        const int d = a + kObjGridSize;
+        fprintf(file, "f %d//%d %d//%d %d//%d %d//%d\n", a, a, b, b, c, c, d,
+                d);
+      }
+    }
+    size_ = ftell(file);
+    fclose(file);
+  }
+  ObjFile(const ObjFile& other) = delete;
+  ObjFile& operator=(const ObjFile&) = delete;
+  ~ObjFile() {
+    if (!path_.empty()) {
+      unlink(path_.c_str());
+    }
+  }
+
+  // @return: nullptr if the file could not be written.
+  const char* GetPath() const {
+    return path_.empty() ? nullptr : path_.c_str();
+  }
+  long GetSize() const { return size_; }
+
+ private:
+  std::string path_;
+  long size_;
+};
+
+const ObjFile& GetObjFile() {
+  static const ObjFile obj_file;
+  return obj_file;
+}
+
+void BM_LoadOBJData(BenchmarkState* state) {
+  const ObjFile& obj_file = GetObjFile();
+  if (obj_file.GetPath() == nullptr) {
+    state->Fail();
+    return;
+  }
+  std::vector<GLfloat> vertices;
+  std::vector<GLushort> indices;
+  state->SetBytesProcessed(obj_file.GetSize());
+  state->ResetTimer();
+  for (int64_t i = 0; i < state->GetIterations(); ++i) {
+    // The loader appends, like for a model loaded at startup.
+    vertices.clear();
+    indices.clear();
+    tango_gl::obj_loader::LoadOBJData(obj_file.GetPath(), vertices, indices);
+  }
+  state->StopTimer();
+  sink = indices.size();
+}
+
+void BM_LoadInterleavedOBJData(BenchmarkState* state) {
+  const ObjFile& obj_file = GetObjFile();
+  if (obj_file.GetPath() == nullptr) {
+    state->Fail();
+    return;
+  }
+  std::vector<GLfloat> vertices;
+  std::vector<GLuint> indices;
+  state->SetBytesProcessed(obj_file.GetSize());
+  state->ResetTimer();
+  for (int64_t i = 0; i < state->GetIterations(); ++i) {
+    vertices.clear();
+    indices.clear();
+    tango_gl::obj_loader::LoadInterleavedOBJData(obj_file.GetPath(), true,
+                                                 vertices, indices);
+  }
+  state->StopTimer();
+  sink = indices.size();
+}
+
+typedef void (*Nv21Converter)(const uint8_t* nv21, size_t width,
+                              size_t height, uint8_t* rgb);
+
+void RunNv21ToRgb(Nv21Converter converter, size_t width, size_t height,
+                  BenchmarkState* state) {
+  // Noise, for the image not to be a best case of any kernel.
+  std::mt19937 random(3);
+  std::vector<uint8_t> nv21(width * height * 3 / 2);
+  for (uint8_t& value : nv21) {
+    value = static_cast<uint8_t>(random());
+  }
+  std::vector<uint8_t> rgb(width * height * 3);
+  state->SetBytesProcessed(nv21.size());
+  state->ResetTimer();
+  for (int64_t i = 0; i < state->GetIterations(); ++i) {
+    converter(nv21.data(), width, height, rgb.data());
+  }
+  state->StopTimer();
+  sink = rgb[rgb.size() / 2];
+}
+
+void BM_Nv21ToRgb_640x480(BenchmarkState* state) {
+  RunNv21ToRgb(hello_video::yuv_converter::Nv21ToRgb, 640, 480, state);
+}
+
+void BM_Nv21ToRgb_1280x720(BenchmarkState* state) {
+  RunNv21ToRgb(hello_video::yuv_converter::Nv21ToRgb, 1280, 720, state);
+}
+
+void BM_Nv21ToRgbScalar_640x480(BenchmarkState* state) {
+  RunNv21ToRgb(hello_video::yuv_converter::Nv21ToRgbScalar, 640, 480, state);
+}
+
+void BM_Nv21ToRgbScalar_1280x720(BenchmarkState* state) {
+  RunNv21ToRgb(hello_video::yuv_converter::Nv21ToRgbScalar, 1280, 720,
+               state);
+}
+
+void RunDepthUpsampler(bool depth_test, BenchmarkState* state) {
+  // A 160x120 cloud, the density of the depth camera, of a wall slanted
+  // away from 1 m to 3 m across the color image, with 1 cm of noise.
+  const TangoCameraIntrinsics intrinsics = GetColorIntrinsics();
+  const int columns = 160;
+  const int rows = 120;
+  std::mt19937 random(4);
+  std::normal_distribution<float> noise(0.0f, 0.01f);
+  std::vector<float> xyz;
+  xyz.reserve(columns * rows * 3);
+  for (int row = 0; row < rows; ++row) {
+    for (int column = 0; column < columns; ++column) {
+      const float u = (column + 0.5f) * intrinsics.width / columns;
+      const float v = (row + 0.5f) * intrinsics.height / rows;
+      const float z = 1.0f + 2.0f * column / columns + noise(random);
+      xyz.push_back((u - intrinsics.cx) / intrinsics.fx * z);
+      xyz.push_back((v - intrinsics.cy) / intrinsics.fy * z);
+      xyz.push_back(z);
+    }
+  }
+  TangoXYZij point_cloud;
+  memset(&point_cloud, 0, sizeof(point_cloud));
+  point_cloud.xyz_count = columns * rows;
+  point_cloud.xyz = reinterpret_cast<float(*)[3]>(xyz.data());
+
+  // The depth camera a few centimeters beside the color camera.
+  const glm::mat4 color_T_depth =
+      glm::translate(glm::mat4(1.0f), glm::vec3(0.06f, 0.0f, 0.0f));
+  rgb_depth_sync::DepthUpsampler upsampler(7, 4.0f);
+  upsampler.SetCameraIntrinsics(intrinsics);
+  upsampler.SetDepthTest(depth_test);
+  // The buffers are allocated by the first frame, as in the example.
+  upsampler.Upsample(color_T_depth, &point_cloud);
+  state->SetBytesProcessed(xyz.size() * sizeof(float));
+  state->ResetTimer();
+  for (int64_t i = 0; i < state->GetIterations(); ++i) {
+    upsampler.Upsample(color_T_depth, &point_cloud);
+  }
+  state->StopTimer();
+  sink = upsampler.GetGrayscaleBuffer()[intrinsics.width * 360 + 640];
+}
+
+void BM_DepthUpsampler(BenchmarkState* state) {
+  RunDepthUpsampler(false, state);
+}
+
+void BM_DepthUpsampler_depth_test(BenchmarkState* state) {
+  RunDepthUpsampler(true, state);
+}
+
+void RunBandUpdateVertexArray(tango_gl::Band::BandMode mode,
+                              BenchmarkState* state) {
+  // A walk around a circle of 4 m, 5 cm a pose, so that every pose adds to
+  // the band and its tail is dropped once it reached its length.
+  const int pose_count = 512;
+  std::vector<glm::mat4> poses(pose_count);
+  for (int i = 0; i < pose_count; ++i) {
+    const float angle = 0.0125f * i;
+    poses[i] = glm::translate(glm::mat4(1.0f),
+                              glm::vec3(4.0f * std::cos(angle), 0.0f,
+                                        4.0f * std::sin(angle))) *
+               glm::rotate(glm::mat4(1.0f), -angle, glm::vec3(0, 1, 0));
+  }
+  tango_gl::Band band(1000);
+  state->ResetTimer();
+  for (int64_t i = 0; i < state->GetIterations(); ++i) {
+    band.UpdateVertexArray(poses[static_cast<size_t>(i) % pose_count], mode);
+  }
+  state->StopTimer();
+}
+
+void BM_Band_UpdateVertexArray(BenchmarkState* state) {
+  RunBandUpdateVertexArray(tango_gl::Band::kNormal, state);
+}
+
+void BM_Band_UpdateVertexArray_keep_left(BenchmarkState* state) {
+  RunBandUpdateVertexArray(tango_gl::Band::kKeepLeft, state);
+}
+
+const Benchmark kBenchmarks[] = {
+    {"SegmentAABBIntersect", BM_SegmentAABBIntersect, false},
+    {"DecomposeMatrix", BM_DecomposeMatrix, false},
+    {"LoadOBJData/ushort", BM_LoadOBJData, false},
+    {"LoadInterleavedOBJData/normals", BM_LoadInterleavedOBJData, false},
+    {"Nv21ToRgb/640x480", BM_Nv21ToRgb_640x480, false},
+    {"Nv21ToRgb/1280x720", BM_Nv21ToRgb_1280x720, false},
+    {"Nv21ToRgbScalar/640x480", BM_Nv21ToRgbScalar_640x480, false},
+    {"Nv21ToRgbScalar/1280x720", BM_Nv21ToRgbScalar_1280x720, false},
+    {"DepthUpsampler/window7", BM_DepthUpsampler, false},
+    {"DepthUpsampler/window7_depth_test", BM_DepthUpsampler_depth_test,
+     false},
+    {"Band/UpdateVertexArray", BM_Band_UpdateVertexArray, true},
+    {"Band/UpdateVertexArray_keep_left", BM_Band_UpdateVertexArray_keep_left,
+     true},
+};
+
+// Run |benchmark| with more operations until they took |min_time|, and
+// print the line of the last run.
+//
+// @return: false if the benchmark failed.
+bool RunBenchmark(const Benchmark& benchmark, double min_time) {
+  int64_t iterations = 1;
+  while (true) {
+    BenchmarkState state(iterations);
+    state.StartTimer();
+    benchmark.function(&state);
+    state.StopTimer();
+    if (state.HasFailed()) {
+      fprintf(stderr, "%s failed\n", benchmark.name);
+      return false;
+    }
+    const double seconds = state.GetSeconds();
+    if (seconds >= min_time || iterations >= 1000000000) {
+      const double count = static_cast<double>(iterations);
+      printf("%-36s %10lld %14.1f ns/op", benchmark.name,
+             static_cast<long long>(iterations), seconds * 1e9 / count);
+      if (state.GetBytesProcessed() > 0 && seconds > 0.0) {
+        printf(" %10.1f MB/s",
+               state.GetBytesProcessed() * count / seconds / 1e6);
+      }
+      printf(" %10.0f B/op %8.1f allocs/op\n",
+             state.GetAllocatedBytes() / count,
+             state.GetAllocationCount() / count);
+      fflush(stdout);
+      return true;
+    }
+    // Aim 20% past |min_time| from the time of this run, growing by 100
+    // times at most.
+    int64_t next = iterations * 100;
+    if (seconds > 0.0) {
+      next = std::min(next, static_cast<int64_t>(iterations * 1.2 *
+                                                 min_time / seconds));
+    }
+    iterations = std::max(next, iterations + 1);
+  }
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  double min_time = 1.0;
+  const char* filter = "";
+  for (int i = 1; i < argc; ++i) {
+    if (sscanf(argv[i], "--min_time=%lf", &min_time) == 1 &&
+        min_time > 0.0) {
+      continue;
+    }
+    if (strncmp(argv[i], "--filter=", 9) == 0) {
+      filter = argv[i] + 9;
+      continue;
+    }
+    fprintf(stderr,
+            "Usage: %s [--min_time=<seconds>] [--filter=<substring>]\n",
+            argv[0]);
+    return 2;
+  }
+
+  tango_benchmark::OffscreenContext context;
+  bool has_context = false;
+  bool has_failed = false;
+  for (const Benchmark& benchmark : kBenchmarks) {
+    if (strstr(benchmark.name, filter) == nullptr) {
+      continue;
+    }
+    if (benchmark.needs_context && !has_context) {
+      has_context = context.Create(64, 64);
+      if (!has_context) {
+        fprintf(stderr, "Failed to create a context for %s\n",
+                benchmark.name);
+        has_failed = true;
+        continue;
+      }
+    }
+    if (!RunBenchmark(benchmark, min_time)) {
+      has_failed = true;
+    }
+  }
+  return has_failed ? 1 : 0;
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-benchmark/offscreen_context.h"
+
+#include <tango-gl/util.h>
+
+namespace {
+// EGL_KHR_create_context, which the EGL headers of older NDKs do not
+// declare.
+const EGLint kOpenGlEs3Bit = 0x0040;
+}  // namespace
+
+namespace tango_benchmark {
+
+OffscreenContext::OffscreenContext()
+    : display_(EGL_NO_DISPLAY),
+      context_(EGL_NO_CONTEXT),
+      surface_(EGL_NO_SURFACE),
+      width_(0),
+      height_(0),
+      client_version_(0) {}
+
+OffscreenContext::~OffscreenContext() { Destroy(); }
+
+bool OffscreenContext::Create(int width, int height) {
+  Destroy();
+  display_ = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  if (display_ == EGL_NO_DISPLAY || !eglInitialize(display_, NULL, NULL)) {
+    LOGE("OffscreenContext: no EGL display, error 0x%x", eglGetError());
+    display_ = EGL_NO_DISPLAY;
+    return false;
+  }
+
+  // The 3.0 context first, the 2.0 one where there is no 3.0 config.
+  const EGLint renderable_types[] = {kOpenGlEs3Bit, EGL_OPENGL_ES2_BIT};
+  const EGLint client_versions[] = {3, 2};
+  for (int i = 0; i < 2 && context_ == EGL_NO_CONTEXT; ++i) {
+    const EGLint config_attributes[] = {EGL_SURFACE_TYPE,
+                                        EGL_PBUFFER_BIT,
+                                        EGL_RENDERABLE_TYPE,
+                                        renderable_types[i],
+                                        EGL_RED_SIZE,
+                                        8,
+                                        EGL_GREEN_SIZE,
+                                        8,
+                                        EGL_BLUE_SIZE,
+                                        8,
+                                        EGL_ALPHA_SIZE,
+                                        8,
+                                        EGL_DEPTH_SIZE,
+                                        16,
+                                        EGL_NONE};
+    EGLConfig config;
+    EGLint config_count = 0;
+    if (!eglChooseConfig(display_, config_attributes, &config, 1,
+                         &config_count) ||
+        config_count == 0) {
+      continue;
+    }
+    const EGLint context_attributes[] = {EGL_CONTEXT_CLIENT_VERSION,
+                                         client_versions[i], EGL_NONE};
+    context_ = eglCreateContext(display_, config, EGL_NO_CONTEXT,
+                                context_attributes);
+    if (context_ == EGL_NO_CONTEXT) {
+      continue;
+    }
+    const EGLint surface_attributes[] = {EGL_WIDTH, width, EGL_HEIGHT, height,
+                                         EGL_NONE};
+    surface_ = eglCreatePbufferSurface(display_, config, surface_attributes);
+    if (surface_ == EGL_NO_SURFACE) {
+      eglDestroyContext(display_, context_);
+      context_ = EGL_NO_CONTEXT;
+      continue;
+    }
+    client_version_ = client_versions[i];
+  }
+  if (context_ == EGL_NO_CONTEXT) {
+    LOGE("OffscreenContext: no pbuffer context, error 0x%x", eglGetError());
+    Destroy();
+    return false;
+  }
+  if (!eglMakeCurrent(display_, surface_, surface_, context_)) {
+    LOGE("OffscreenContext: could not make the context current, error 0x%x",
+         eglGetError());
+    Destroy();
+    return false;
+  }
+  width_ = width;
+  height_ = height;
+  return true;
+}
+
+void OffscreenContext::Destroy() {
+  if (display_ == EGL_NO_DISPLAY) {
+    return;
+  }
+  eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+  if (surface_ != EGL_NO_SURFACE) {
+    eglDestroySurface(display_, surface_);
+    surface_ = EGL_NO_SURFACE;
+  }
+  if (context_ != EGL_NO_CONTEXT) {
+    eglDestroyContext(display_, context_);
+    context_ = EGL_NO_CONTEXT;
+  }
+  eglTerminate(display_);
+  display_ = EGL_NO_DISPLAY;
+  width_ = 0;
+  height_ = 0;
+  client_version_ = 0;
+}
+
+void OffscreenContext::SwapBuffers() {
+  if (surface_ != EGL_NO_SURFACE) {
+    eglSwapBuffers(display_, surface_);
+  }
+}
+}  // namespace tango_benchmark
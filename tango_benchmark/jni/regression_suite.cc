@@ -0,0 +1,372 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// regression_suite replays the three canonical sessions of tango_mock, the
+// static desk, the walk and the fast rotation, through the pipelines of the
+// point cloud, RGB depth sync and plane fitting examples, and checks every
+// run against the budgets of its pipeline with tango_util::PerformanceBudget:
+//
+//   regression_suite [--seconds=<duration>] [--tolerance=<fraction>]
+//                    [--filter=<substring>]
+//
+// A run connects the app to the mock service as its activity does, renders
+// it in an EGL pbuffer, see OffscreenContext, and steps the session by 1/60 s
+// before every frame, for --seconds of the session, 5 by default. The first
+// second warms up the caches and pools and is not measured. The budgets are:
+//  - the 95th percentile time of the trace slices of the stages of the
+//    pipeline, its callbacks and its frame, and the longest time of those
+//    that take milliseconds: a callback of microseconds is preempted for
+//    longer than it runs now and then,
+//  - the peak GPU memory of its vertex buffers and textures,
+//  - the heap allocations of a frame, counted by the operator new below on
+//    every thread.
+// Each run prints the report of its budget as a line of JSON, and the suite
+// exits with 1 if any run is over a budget by more than --tolerance, 0.5 by
+// default, so that it can gate a build; the budgets are those of a desktop
+// under Mesa's llvmpipe, far above what a device takes, and only catch a
+// regression of several times. Only the runs whose name, e.g.
+// "point_cloud/walking", contains --filter run.
+
+#include <stdlib.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+
+#include <tango_client_api.h>  // NOLINT
+#include <tango-gl/memory_accounting.h>
+#include <tango-gl/tracing.h>
+#include <tango-gl/util.h>
+#include <tango-mock/mock_service.h>
+#include <tango-util/performance_budget.h>
+
+#include "rgb-depth-sync/rgb_depth_sync_application.h"
+#include "tango-benchmark/offscreen_context.h"
+#include "tango-plane-fitting/plane_fitting_application.h"
+#include "tango-point-cloud/point_cloud_app.h"
+
+namespace {
+// Allocations of every thread since the start, counted by the operator new
+// below.
+std::atomic<uint64_t> allocation_count(0);
+}  // namespace
+
+void* operator new(size_t size) {
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  void* pointer = malloc(size == 0 ? 1 : size);
+  if (pointer == nullptr) {
+    throw std::bad_alloc();
+  }
+  return pointer;
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+
+void operator delete(void* pointer) noexcept { free(pointer); }
+
+void operator delete[](void* pointer) noexcept { free(pointer); }
+
+void operator delete(void* pointer, size_t) noexcept { free(pointer); }
+
+void operator delete[](void* pointer, size_t) noexcept { free(pointer); }
+
+namespace {
+const int kWidth = 640;
+const int kHeight = 360;
+const double kFrameInterval = 1.0 / 60.0;
+const double kWarmUpSeconds = 1.0;
+
+struct Scenario {
+  const char* name;
+  tango_mock::Scenario scenario;
+};
+
+const Scenario kScenarios[] = {
+    {"static_desk", tango_mock::kScenarioStaticDesk},
+    {"walking", tango_mock::kScenarioWalking},
+    {"fast_rotation", tango_mock::kScenarioFastRotation},
+};
+
+// An example app, driven through the calls its activity and renderer make.
+// Without a virtual machine, the JNI arguments are nullptr, which the mock
+// service and the support library of the desktop accept.
+class Pipeline {
+ public:
+  virtual ~Pipeline() {}
+
+  // Configure the app and connect it to the service, then create its GL
+  // content for a |width| x |height| surface.
+  //
+  // @return false if the app failed to.
+  virtual bool Start(int width, int height) = 0;
+  virtual void Render() = 0;
+  // Disconnect from the service and free the GL content.
+  virtual void Stop() = 0;
+};
+
+class PointCloudPipeline : public Pipeline {
+ public:
+  bool Start(int width, int height) override {
+    if (!app_.CheckTangoVersion(nullptr, nullptr, 0) ||
+        !app_.OnTangoServiceConnected(nullptr, nullptr) ||
+        app_.TangoSetupConfig() != TANGO_SUCCESS ||
+        app_.TangoConnectCallbacks() != TANGO_SUCCESS ||
+        !app_.TangoConnect()) {
+      return false;
+    }
+    app_.InitializeGLContent();
+    app_.SetViewPort(width, height);
+    return true;
+  }
+  void Render() override { app_.Render(); }
+  void Stop() override {
+    app_.TangoDisconnect();
+    app_.DeleteResources();
+  }
+
+ private:
+  tango_point_cloud::PointCloudApp app_;
+};
+
+class RgbDepthSyncPipeline : public Pipeline {
+ public:
+  bool Start(int width, int height) override {
+    if (!app_.CheckTangoVersion(nullptr, nullptr, 0)) {
+      return false;
+    }
+    app_.OnTangoServiceConnected(nullptr, nullptr);
+    if (!app_.TangoSetupConfig() || !app_.TangoConnectCallbacks() ||
+        !app_.TangoConnect() || !app_.TangoSetIntrinsicsAndExtrinsics()) {
+      return false;
+    }
+    // As with the depth overlay checked, which runs the depth camera.
+    app_.SetDepthAlphaValue(0.5f);
+    app_.InitializeGLContent();
+    if (!app_.TangoConnectTexture()) {
+      return false;
+    }
+    app_.SetViewPort(width, height);
+    return true;
+  }
+  void Render() override { app_.Render(); }
+  void Stop() override { app_.TangoDisconnect(); }
+
+ private:
+  rgb_depth_sync::SynchronizationApplication app_;
+};
+
+class PlaneFittingPipeline : public Pipeline {
+ public:
+  bool Start(int width, int height) override {
+    if (!app_.CheckTangoVersion(nullptr, nullptr, 0)) {
+      return false;
+    }
+    app_.OnTangoServiceConnected(nullptr, nullptr);
+    if (!app_.TangoSetupAndConnect() || !app_.InitializeGLContent()) {
+      return false;
+    }
+    app_.SetViewPort(width, height);
+    return true;
+  }
+  void Render() override { app_.Render(); }
+  void Stop() override {
+    app_.TangoDisconnect();
+    app_.DeleteResources();
+  }
+
+ private:
+  tango_plane_fitting::PlaneFittingApplication app_;
+};
+
+struct StageBudget {
+  const char* stage;
+  double percentile_95_ms;
+  // 0 for none, see the top of the file.
+  double max_ms;
+};
+
+// The pipelines and their budgets, the same for every scenario, which the
+// fast rotation sets.
+struct PipelineBudget {
+  const char* name;
+  Pipeline* (*create)();
+  StageBudget stages[3];
+  int64_t vertex_buffer_peak_bytes;
+  int64_t texture_peak_bytes;
+  double allocations_per_frame;
+};
+
+template <typename PipelineType>
+Pipeline* CreatePipeline() {
+  return new PipelineType();
+}
+
+const PipelineBudget kPipelines[] = {
+    {"point_cloud",
+     CreatePipeline<PointCloudPipeline>,
+     {{"PointCloudApp::onPointCloudAvailable", 3.0, 10.0},
+      {"PointCloudApp::onPoseAvailable", 0.5, 0.0},
+      {"PointCloudApp::Render", 20.0, 60.0}},
+     1 << 20,
+     16 << 20,
+     2.5},
+    {"rgb_depth_sync",
+     CreatePipeline<RgbDepthSyncPipeline>,
+     {{"SynchronizationApplication::OnXYZijAvailable", 1.0, 0.0},
+      {"SynchronizationApplication::Render", 60.0, 150.0},
+      {nullptr, 0.0, 0.0}},
+     1 << 20,
+     16 << 20,
+     1.0},
+    {"plane_fitting",
+     CreatePipeline<PlaneFittingPipeline>,
+     {{"PlaneFittingApplication::OnXYZijAvailable", 1.0, 0.0},
+      {"PlaneFittingApplication::OnPoseAvailable", 0.5, 0.0},
+      {"PlaneFittingApplication::Render", 10.0, 60.0}},
+     1 << 20,
+     16 << 20,
+     3.0},
+};
+
+// Replay |scenario| through a new pipeline of |pipeline|, and check it
+// against its budget.
+//
+// @param report: set to the run and the report of its budget as JSON.
+//
+// @return false if the run failed or is over budget.
+bool RunPipeline(const PipelineBudget& pipeline, const Scenario& scenario,
+                 double seconds, double tolerance, std::string* report) {
+  tango_util::PerformanceBudget budget(tolerance);
+  for (const StageBudget& stage : pipeline.stages) {
+    if (stage.stage != nullptr) {
+      budget.SetStageBudget(stage.stage, stage.percentile_95_ms,
+                            stage.max_ms);
+    }
+  }
+  budget.SetMemoryBudget(tango_gl::kMemoryTagVertexBuffer,
+                         tango_gl::kMemoryGpu,
+                         pipeline.vertex_buffer_peak_bytes, 0);
+  budget.SetMemoryBudget(tango_gl::kMemoryTagTexture, tango_gl::kMemoryGpu,
+                         pipeline.texture_peak_bytes, 0);
+
+  tango_mock::MockOptions options =
+      tango_mock::GetScenarioOptions(scenario.scenario);
+  options.is_real_time = false;
+  tango_mock::SetOptions(options);
+  std::unique_ptr<Pipeline> app(pipeline.create());
+  if (!app->Start(kWidth, kHeight)) {
+    LOGE("regression_suite: %s could not start.", pipeline.name);
+    app->Stop();
+    return false;
+  }
+
+  const int warm_up_frame_count = static_cast<int>(kWarmUpSeconds /
+                                                   kFrameInterval);
+  const int frame_count = static_cast<int>(seconds / kFrameInterval);
+  uint64_t start_allocation_count = 0;
+  for (int frame = 0; frame < warm_up_frame_count + frame_count; ++frame) {
+    if (frame == warm_up_frame_count) {
+      tango_gl::ResetMemoryPeaks();
+      tango_gl::tracing::Start();
+      start_allocation_count = allocation_count.load();
+    }
+    tango_mock::Step(kFrameInterval);
+    app->Render();
+  }
+  glFinish();
+  tango_gl::tracing::Stop();
+  const double allocations_per_frame =
+      static_cast<double>(allocation_count.load() - start_allocation_count) /
+      frame_count;
+
+  std::string budget_report;
+  bool is_passed =
+      budget.Check(tango_gl::tracing::GetSliceStatistics(), &budget_report);
+  app->Stop();
+  const bool is_allocation_passed =
+      allocations_per_frame <=
+      pipeline.allocations_per_frame * (1.0 + tolerance);
+  is_passed = is_passed && is_allocation_passed;
+
+  char header[256];
+  snprintf(header, sizeof(header),
+           "{\"name\":\"%s/%s\",\"passed\":%s,\"frames\":%d,"
+           "\"allocations_per_frame\":%.2f,\"allocation_budget\":%.2f,"
+           "\"budget\":",
+           pipeline.name, scenario.name, is_passed ? "true" : "false",
+           frame_count, allocations_per_frame,
+           pipeline.allocations_per_frame);
+  *report = header + budget_report + "}";
+  return is_passed;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  double seconds = 5.0;
+  double tolerance = 0.5;
+  const char* filter = "";
+  for (int i = 1; i < argc; ++i) {
+    if (sscanf(argv[i], "--seconds=%lf", &seconds) == 1 && seconds > 0.0) {
+      continue;
+    }
+    if (sscanf(argv[i], "--tolerance=%lf", &tolerance) == 1 &&
+        tolerance >= 0.0) {
+      continue;
+    }
+    if (strncmp(argv[i], "--filter=", 9) == 0) {
+      filter = argv[i] + 9;
+      continue;
+    }
+    fprintf(stderr,
+            "Usage: %s [--seconds=<duration>] [--tolerance=<fraction>]\n"
+            "          [--filter=<substring>]\n",
+            argv[0]);
+    return 2;
+  }
+
+  tango_benchmark::OffscreenContext context;
+  if (!context.Create(kWidth, kHeight)) {
+    return 1;
+  }
+  int failure_count = 0;
+  for (const PipelineBudget& pipeline : kPipelines) {
+    for (const Scenario& scenario : kScenarios) {
+      const std::string name =
+          std::string(pipeline.name) + "/" + scenario.name;
+      if (strstr(name.c_str(), filter) == nullptr) {
+        continue;
+      }
+      std::string report;
+      if (!RunPipeline(pipeline, scenario, seconds, tolerance, &report)) {
+        ++failure_count;
+      }
+      if (!report.empty()) {
+        printf("%s\n", report.c_str());
+      }
+      fflush(stdout);
+    }
+  }
+  context.Destroy();
+
+  if (failure_count > 0) {
+    fprintf(stderr, "regression_suite: %d runs failed.\n", failure_count);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,701 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// render_benchmark renders every drawable of tango_gl and the scene of every
+// example for a number of frames, in an EGL pbuffer, fed by the mock service,
+// and prints the report of a tango_gl::RenderBenchmark for each as JSON:
+//
+//   render_benchmark [--frames=<count>] [--size=<width>x<height>]
+//                    [--filter=<substring>] [--no_gpu_sync] > render.json
+//
+// Every benchmark renders kWarmUpFrameCount frames unmeasured, which upload
+// the static buffers and textures, and then --frames, 300 by default, at
+// --size, 1280x720 by default. The reports have the time of a frame, and
+// its draw calls, state changes and uploaded bytes, so that a drawable which
+// uploads a static vertex buffer again every frame shows in uploaded_bytes.
+// With --no_gpu_sync, the time is only that of the CPU to issue a frame.
+// Only the benchmarks whose name contains --filter run.
+//
+// The mock service runs the walking scenario, stepped by 1/60 s before every
+// frame, outside of the measurement, as are the meshing of the point clouds
+// by the mesh builder and the other work of the applications which is not
+// rendering.
+
+#include <stdint.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <tango_client_api.h>  // NOLINT
+#include <tango_support_api.h>  // NOLINT
+#include <tango-gl/axis.h>
+#include <tango-gl/band.h>
+#include <tango-gl/camera.h>
+#include <tango-gl/circle.h>
+#include <tango-gl/cube.h>
+#include <tango-gl/frustum.h>
+#include <tango-gl/goal_marker.h>
+#include <tango-gl/grid.h>
+#include <tango-gl/line.h>
+#include <tango-gl/mesh.h>
+#include <tango-gl/quad.h>
+#include <tango-gl/render_statistics.h>
+#include <tango-gl/segment.h>
+#include <tango-gl/segment_drawable.h>
+#include <tango-gl/trace.h>
+#include <tango-gl/triangle.h>
+#include <tango-gl/util.h>
+#include <tango-gl/video_overlay.h>
+#include <tango-mock/mock_service.h>
+#include <tango-util/extrinsics_cache.h>
+#include <tango-util/tsdf_volume.h>
+
+#include "rgb-depth-sync/color_image.h"
+#include "rgb-depth-sync/depth_image.h"
+#include "rgb-depth-sync/scene.h"
+#include "tango-augmented-reality/scene.h"
+#include "tango-benchmark/offscreen_context.h"
+#include "tango-mesh-builder/scene.h"
+#include "tango-motion-tracking/scene.h"
+#include "tango-point-cloud/scene.h"
+
+namespace {
+const int kWarmUpFrameCount = 10;
+const double kFrameInterval = 1.0 / 60.0;
+
+// The camera of the drawables circles the origin once every kOrbitFrameCount
+// frames, at kOrbitRadius meters and kOrbitHeight meters above it.
+const int kOrbitFrameCount = 600;
+const float kOrbitRadius = 4.0f;
+const float kOrbitHeight = 2.0f;
+
+const float kNearClipPlane = 0.1f;
+const float kFarClipPlane = 100.0f;
+
+struct Options {
+  int frame_count;
+  int width;
+  int height;
+  bool is_gpu_synchronized;
+};
+
+glm::mat4 GetMatrixFromPose(const TangoPoseData& pose) {
+  const glm::vec3 translation(pose.translation[0], pose.translation[1],
+                              pose.translation[2]);
+  const glm::quat rotation(pose.orientation[3], pose.orientation[0],
+                           pose.orientation[1], pose.orientation[2]);
+  return glm::translate(glm::mat4(1.0f), translation) *
+         glm::mat4_cast(rotation);
+}
+
+// A connection to the mock service, whose callbacks are delivered by Step()
+// on the calling thread. It keeps a copy of the latest point cloud.
+class MockSession {
+ public:
+  MockSession();
+  ~MockSession();
+  MockSession(const MockSession& other) = delete;
+  MockSession& operator=(const MockSession&) = delete;
+
+  // Connect for |scenario|, with the depth and the color camera.
+  //
+  // @return false if the service refused the connection.
+  bool Connect(tango_mock::Scenario scenario);
+  void Disconnect();
+
+  // Advance the service by a frame.
+  void Step() { tango_mock::Step(kFrameInterval); }
+
+  // @param is_new: set to whether the point cloud arrived since the previous
+  //        call.
+  //
+  // @return the latest point cloud, valid until the next Step(), nullptr
+  //         before the first.
+  const TangoXYZij* GetPointCloud(bool* is_new);
+
+  // @return the pose of the device at |timestamp|, 0 for the latest, the
+  //         identity if there is none.
+  glm::mat4 GetStartServiceTDevice(double timestamp) const;
+
+  const tango_mock::MockOptions& GetOptions() const { return options_; }
+  const TangoCameraIntrinsics& GetColorIntrinsics() const {
+    return color_intrinsics_;
+  }
+  const tango_util::ExtrinsicsCache& GetExtrinsics() const {
+    return extrinsics_;
+  }
+
+ private:
+  static void OnXYZijAvailable(void* context, const TangoXYZij* xyz_ij);
+
+  tango_mock::MockOptions options_;
+  TangoConfig config_;
+  TangoCameraIntrinsics color_intrinsics_;
+  tango_util::ExtrinsicsCache extrinsics_;
+
+  std::vector<float> points_;
+  TangoXYZij point_cloud_;
+  bool has_point_cloud_;
+  bool is_point_cloud_new_;
+};
+
+MockSession::MockSession()
+    : options_(tango_mock::GetDefaultOptions()),
+      config_(nullptr),
+      has_point_cloud_(false),
+      is_point_cloud_new_(false) {
+  memset(&color_intrinsics_, 0, sizeof(color_intrinsics_));
+  memset(&point_cloud_, 0, sizeof(point_cloud_));
+}
+
+MockSession::~MockSession() { Disconnect(); }
+
+bool MockSession::Connect(tango_mock::Scenario scenario) {
+  options_ = tango_mock::GetScenarioOptions(scenario);
+  options_.is_real_time = false;
+  tango_mock::SetOptions(options_);
+
+  config_ = TangoService_getConfig(TANGO_CONFIG_DEFAULT);
+  if (config_ == nullptr ||
+      TangoConfig_setBool(config_, "config_enable_depth", true) !=
+          TANGO_SUCCESS ||
+      TangoConfig_setBool(config_, "config_enable_color_camera", true) !=
+          TANGO_SUCCESS) {
+    LOGE("MockSession: Could not configure the service.");
+    return false;
+  }
+  if (TangoService_connectOnXYZijAvailable(OnXYZijAvailable) !=
+          TANGO_SUCCESS ||
+      TangoService_connect(this, config_) != TANGO_SUCCESS) {
+    LOGE("MockSession: Could not connect to the service.");
+    return false;
+  }
+  if (TangoService_getCameraIntrinsics(TANGO_CAMERA_COLOR,
+                                       &color_intrinsics_) != TANGO_SUCCESS ||
+      extrinsics_.Update() != TANGO_SUCCESS) {
+    LOGE("MockSession: Could not get the intrinsics and extrinsics.");
+    return false;
+  }
+  TangoSupport_initialize(TangoService_getPoseAtTime);
+  return true;
+}
+
+void MockSession::Disconnect() {
+  if (config_ == nullptr) {
+    return;
+  }
+  TangoService_disconnect();
+  TangoConfig_free(config_);
+  config_ = nullptr;
+  has_point_cloud_ = false;
+}
+
+const TangoXYZij* MockSession::GetPointCloud(bool* is_new) {
+  *is_new = is_point_cloud_new_;
+  is_point_cloud_new_ = false;
+  return has_point_cloud_ ? &point_cloud_ : nullptr;
+}
+
+glm::mat4 MockSession::GetStartServiceTDevice(double timestamp) const {
+  TangoCoordinateFramePair frame_pair;
+  frame_pair.base = TANGO_COORDINATE_FRAME_START_OF_SERVICE;
+  frame_pair.target = TANGO_COORDINATE_FRAME_DEVICE;
+  TangoPoseData pose;
+  if (TangoService_getPoseAtTime(timestamp, frame_pair, &pose) !=
+          TANGO_SUCCESS ||
+      pose.status_code != TANGO_POSE_VALID) {
+    return glm::mat4(1.0f);
+  }
+  return GetMatrixFromPose(pose);
+}
+
+void MockSession::OnXYZijAvailable(void* context, const TangoXYZij* xyz_ij) {
+  MockSession* session = static_cast<MockSession*>(context);
+  const float* xyz = &xyz_ij->xyz[0][0];
+  session->points_.assign(xyz, xyz + 3 * xyz_ij->xyz_count);
+  session->point_cloud_ = *xyz_ij;
+  session->point_cloud_.xyz =
+      reinterpret_cast<float(*)[3]>(session->points_.data());
+  session->point_cloud_.ij_rows = 0;
+  session->point_cloud_.ij_cols = 0;
+  session->point_cloud_.ij = nullptr;
+  session->has_point_cloud_ = true;
+  session->is_point_cloud_new_ = true;
+}
+
+typedef std::function<void(int frame)> FrameFunction;
+
+// BenchmarkFrames renders the frames of one benchmark and measures them.
+class BenchmarkFrames {
+ public:
+  BenchmarkFrames(const char* name, const Options& options,
+                  MockSession* session)
+      : options_(options),
+        session_(session),
+        benchmark_(name, options.is_gpu_synchronized) {
+    camera_.SetAspectRatio(static_cast<float>(options.width) /
+                           options.height);
+  }
+  BenchmarkFrames(const BenchmarkFrames& other) = delete;
+  BenchmarkFrames& operator=(const BenchmarkFrames&) = delete;
+
+  // Render the warm up frames and then the measured ones. Before every
+  // frame, the service is stepped and |update| called, out of the
+  // measurement. |render| draws the frame, after it was cleared.
+  void Run(const FrameFunction& update, const FrameFunction& render);
+  void Run(const FrameFunction& render) {
+    Run([](int /*frame*/) {}, render);
+  }
+
+  MockSession* GetSession() { return session_; }
+  int GetWidth() const { return options_.width; }
+  int GetHeight() const { return options_.height; }
+
+  // The camera the drawables are rendered with, looking at the origin.
+  glm::mat4 GetProjection() const { return camera_.GetProjectionMatrix(); }
+  glm::mat4 GetOrbitView(int frame) const;
+
+  std::string FormatReport() const { return benchmark_.FormatReport(); }
+
+ private:
+  Options options_;
+  MockSession* session_;
+  tango_gl::Camera camera_;
+  tango_gl::RenderBenchmark benchmark_;
+};
+
+void BenchmarkFrames::Run(const FrameFunction& update,
+                          const FrameFunction& render) {
+  const int frame_count = kWarmUpFrameCount + options_.frame_count;
+  for (int frame = 0; frame < frame_count; ++frame) {
+    if (frame == kWarmUpFrameCount) {
+      benchmark_.Reset();
+    }
+    session_->Step();
+    update(frame);
+    benchmark_.BeginFrame();
+    glViewport(0, 0, options_.width, options_.height);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    render(frame);
+    benchmark_.EndFrame();
+  }
+}
+
+glm::mat4 BenchmarkFrames::GetOrbitView(int frame) const {
+  const float angle = 2.0f * static_cast<float>(M_PI) * frame /
+                      static_cast<float>(kOrbitFrameCount);
+  const glm::vec3 eye(kOrbitRadius * std::cos(angle), kOrbitHeight,
+                      kOrbitRadius * std::sin(angle));
+  return glm::lookAt(eye, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+}
+
+// Render |drawable| from the orbit, as it was set up.
+template <typename Drawable>
+void RenderDrawable(BenchmarkFrames* frames, const Drawable& drawable) {
+  frames->Run([frames, &drawable](int frame) {
+    drawable.Render(frames->GetProjection(), frames->GetOrbitView(frame));
+  });
+}
+
+// A texture of |target| with a 2x2 image, or none for an external texture,
+// which can only be filled by the camera.
+GLuint CreateTexture(GLenum target) {
+  GLuint texture_id;
+  glGenTextures(1, &texture_id);
+  glBindTexture(target, texture_id);
+  glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  if (target == GL_TEXTURE_2D) {
+    const uint32_t pixels[] = {0xffffffff, 0xff000000, 0xff000000,
+                               0xffffffff};
+    glTexImage2D(target, 0, GL_RGBA, 2, 2, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                 pixels);
+  }
+  glBindTexture(target, 0);
+  return texture_id;
+}
+
+void BenchmarkAxis(BenchmarkFrames* frames) {
+  tango_gl::Axis axis;
+  RenderDrawable(frames, axis);
+}
+
+// The band of the mesh builder's path, which grows every frame.
+void BenchmarkBand(BenchmarkFrames* frames) {
+  tango_gl::Band band(1000);
+  frames->Run(
+      [&band, frames](int frame) {
+        const glm::mat4 view = frames->GetOrbitView(frame);
+        band.UpdateVertexArray(glm::inverse(view));
+      },
+      [&band, frames](int frame) {
+        band.Render(frames->GetProjection(), frames->GetOrbitView(frame));
+      });
+}
+
+void BenchmarkCircle(BenchmarkFrames* frames) {
+  tango_gl::Circle circle(1.0f, 64);
+  circle.SetColor(tango_gl::Color(1.0f, 0.5f, 0.0f));
+  RenderDrawable(frames, circle);
+}
+
+void BenchmarkCube(BenchmarkFrames* frames) {
+  tango_gl::Cube cube;
+  RenderDrawable(frames, cube);
+}
+
+void BenchmarkFrustum(BenchmarkFrames* frames) {
+  tango_gl::Frustum frustum;
+  RenderDrawable(frames, frustum);
+}
+
+void BenchmarkGoalMarker(BenchmarkFrames* frames) {
+  tango_gl::GoalMarker goal_marker;
+  RenderDrawable(frames, goal_marker);
+}
+
+// The grid of the examples, of lines, and procedural.
+void BenchmarkGrid(BenchmarkFrames* frames) {
+  tango_gl::Grid grid(1.0f, 50, 50);
+  RenderDrawable(frames, grid);
+}
+
+void BenchmarkGridProcedural(BenchmarkFrames* frames) {
+  tango_gl::Grid grid(1.0f, 50, 50);
+  if (!grid.SetProcedural(true)) {
+    LOGE("render_benchmark: The procedural grid is not supported.");
+    return;
+  }
+  RenderDrawable(frames, grid);
+}
+
+void BenchmarkLine(BenchmarkFrames* frames) {
+  tango_gl::Line line(3.0f, GL_LINE_STRIP);
+  std::vector<glm::vec3> vertices;
+  for (int i = 0; i <= 100; ++i) {
+    const float t = i / 100.0f;
+    vertices.push_back(glm::vec3(2.0f * t - 1.0f, std::sin(10.0f * t), 0.0f));
+  }
+  line.UpdateLineVertices(vertices);
+  RenderDrawable(frames, line);
+}
+
+// A static height field of 128x128 vertices with normals, uploaded once.
+void BenchmarkMesh(BenchmarkFrames* frames) {
+  const int kSize = 128;
+  std::vector<GLfloat> vertices;
+  std::vector<GLuint> indices;
+  for (int y = 0; y < kSize; ++y) {
+    for (int x = 0; x < kSize; ++x) {
+      const float u = 4.0f * x / (kSize - 1) - 2.0f;
+      const float v = 4.0f * y / (kSize - 1) - 2.0f;
+      const float height = 0.2f * std::sin(3.0f * u) * std::cos(3.0f * v);
+      const glm::vec3 normal = glm::normalize(
+          glm::vec3(-0.6f * std::cos(3.0f * u) * std::cos(3.0f * v), 1.0f,
+                    0.6f * std::sin(3.0f * u) * std::sin(3.0f * v)));
+      vertices.insert(vertices.end(),
+                      {u, height, v, normal.x, normal.y, normal.z});
+      if (x + 1 < kSize && y + 1 < kSize) {
+        const GLuint i = y * kSize + x;
+        indices.insert(indices.end(), {i, i + kSize, i + 1, i + 1,
+                                       i + kSize, i + kSize + 1});
+      }
+    }
+  }
+  tango_gl::Mesh mesh(GL_TRIANGLES);
+  mesh.SetShader(true);
+  mesh.SetVertexBuffers(vertices, true, indices);
+  RenderDrawable(frames, mesh);
+}
+
+void BenchmarkQuad(BenchmarkFrames* frames) {
+  const GLuint texture_id = CreateTexture(GL_TEXTURE_2D);
+  {
+    tango_gl::Quad quad;
+    quad.SetTextureId(texture_id);
+    RenderDrawable(frames, quad);
+  }
+  glDeleteTextures(1, &texture_id);
+}
+
+void BenchmarkSegment(BenchmarkFrames* frames) {
+  tango_gl::SegmentDrawable segment;
+  segment.UpdateSegment(tango_gl::Segment(glm::vec3(-1.0f, 0.0f, 0.0f),
+                                          glm::vec3(1.0f, 1.0f, 0.0f)));
+  RenderDrawable(frames, segment);
+}
+
+// The trace of the motion tracking example, which grows every frame.
+void BenchmarkTrace(BenchmarkFrames* frames) {
+  tango_gl::Trace trace;
+  frames->Run(
+      [&trace](int frame) {
+        const float angle = 0.05f * frame;
+        trace.UpdateVertexArray(
+            glm::vec3(std::cos(angle), 0.0f, std::sin(angle)));
+      },
+      [&trace, frames](int frame) {
+        trace.Render(frames->GetProjection(), frames->GetOrbitView(frame));
+      });
+}
+
+void BenchmarkTriangle(BenchmarkFrames* frames) {
+  tango_gl::Triangle triangle;
+  RenderDrawable(frames, triangle);
+}
+
+void BenchmarkVideoOverlay(BenchmarkFrames* frames) {
+  const GLuint texture_id = CreateTexture(GL_TEXTURE_2D);
+  {
+    tango_gl::VideoOverlay video_overlay(GL_TEXTURE_2D);
+    video_overlay.SetTextureId(texture_id);
+    RenderDrawable(frames, video_overlay);
+  }
+  glDeleteTextures(1, &texture_id);
+}
+
+void BenchmarkAugmentedRealityScene(BenchmarkFrames* frames) {
+  MockSession* session = frames->GetSession();
+  const TangoCameraIntrinsics& intrinsics = session->GetColorIntrinsics();
+  tango_augmented_reality::Scene scene;
+  scene.InitGLContent();
+  scene.SetupViewPort(0, 0, frames->GetWidth(), frames->GetHeight());
+  scene.SetARCameraProjectionMatrix(
+      tango_gl::Camera::ProjectionMatrixForCameraIntrinsics(
+          intrinsics.width, intrinsics.height, intrinsics.fx, intrinsics.fy,
+          intrinsics.cx, intrinsics.cy, kNearClipPlane, kFarClipPlane));
+  frames->Run([&scene, session](int /*frame*/) {
+    scene.Render(session->GetExtrinsics().GetOpenGlWorldTColorOpenGlCamera(
+        session->GetStartServiceTDevice(0.0)));
+  });
+  scene.DeleteResources();
+}
+
+// The meshes of the point clouds are integrated and extracted out of the
+// measurement, and uploaded within it.
+void BenchmarkMeshBuilderScene(BenchmarkFrames* frames) {
+  MockSession* session = frames->GetSession();
+  const tango_util::ExtrinsicsCache& extrinsics = session->GetExtrinsics();
+  const tango_util::TsdfVolume::Options options;
+  tango_util::TsdfVolume volume(options);
+  std::vector<TangoMesh_Experimental> meshes;
+
+  tango_mesh_builder::Scene scene;
+  scene.InitGLContent(options.voxel_size, options.truncation_distance);
+  scene.SetupViewPort(frames->GetWidth(), frames->GetHeight());
+  frames->Run(
+      [session, &extrinsics, &volume, &meshes](int /*frame*/) {
+        bool is_new;
+        const TangoXYZij* point_cloud = session->GetPointCloud(&is_new);
+        if (point_cloud == nullptr || !is_new) {
+          return;
+        }
+        volume.Integrate(
+            point_cloud,
+            session->GetStartServiceTDevice(point_cloud->timestamp) *
+                extrinsics.GetDeviceTDepthCamera());
+        volume.ExtractMeshes(&meshes);
+      },
+      [&scene, session, &extrinsics, &meshes](int /*frame*/) {
+        for (TangoMesh_Experimental& mesh : meshes) {
+          scene.GetBlockMesh()->UpdateBlock(mesh);
+          TangoSupport_freeMesh(&mesh);
+        }
+        meshes.clear();
+        scene.Render(extrinsics.GetOpenGlWorldTDepthOpenGlCamera(
+                         session->GetStartServiceTDevice(0.0)),
+                     extrinsics.GetOpenGlWorldTStartService());
+      });
+  for (TangoMesh_Experimental& mesh : meshes) {
+    TangoSupport_freeMesh(&mesh);
+  }
+  scene.DeleteResources();
+}
+
+void BenchmarkMotionTrackingScene(BenchmarkFrames* frames) {
+  tango_motion_tracking::Scene scene;
+  scene.InitGLContent();
+  scene.SetupViewPort(frames->GetWidth(), frames->GetHeight());
+  frames->Run([&scene](int /*frame*/) {
+    TangoPoseData pose;
+    if (TangoSupport_getPoseAtTime(
+            0.0, TANGO_COORDINATE_FRAME_START_OF_SERVICE,
+            TANGO_COORDINATE_FRAME_DEVICE, TANGO_SUPPORT_ENGINE_OPENGL,
+            ROTATION_0, &pose) != TANGO_SUCCESS ||
+        pose.status_code != TANGO_POSE_VALID) {
+      return;
+    }
+    const glm::vec3 position(pose.translation[0], pose.translation[1],
+                             pose.translation[2]);
+    const glm::quat rotation(pose.orientation[3], pose.orientation[0],
+                             pose.orientation[1], pose.orientation[2]);
+    scene.AppendTracePosition(position);
+    scene.Render(position, rotation);
+  });
+  scene.DeleteResources();
+}
+
+void BenchmarkPointCloudScene(BenchmarkFrames* frames) {
+  MockSession* session = frames->GetSession();
+  const tango_util::ExtrinsicsCache& extrinsics = session->GetExtrinsics();
+  tango_point_cloud::Scene scene;
+  scene.InitGLContent();
+  scene.SetupViewPort(frames->GetWidth(), frames->GetHeight());
+  scene.SetMaxPointCloudElements(session->GetOptions().point_count);
+  scene.SetColorCameraIntrinsics(session->GetColorIntrinsics());
+  frames->Run([&scene, session, &extrinsics](int /*frame*/) {
+    bool is_new;
+    const TangoXYZij* point_cloud = session->GetPointCloud(&is_new);
+    const double timestamp =
+        point_cloud != nullptr ? point_cloud->timestamp : 0.0;
+    scene.Render(extrinsics.GetOpenGlWorldTDepthOpenGlCamera(
+                     session->GetStartServiceTDevice(0.0)),
+                 extrinsics.GetOpenGlWorldTDepthOpenGlCamera(
+                     session->GetStartServiceTDevice(timestamp)),
+                 point_cloud, is_new,
+                 extrinsics.GetOpenGlWorldTStartService(), nullptr);
+  });
+  scene.DeleteResources();
+}
+
+// The color image can not be filled off the device, so only the depth
+// image, projected on the GPU, changes.
+void BenchmarkRgbDepthSyncScene(BenchmarkFrames* frames) {
+  MockSession* session = frames->GetSession();
+  rgb_depth_sync::ColorImage color_image;
+  rgb_depth_sync::DepthImage depth_image;
+  rgb_depth_sync::Scene scene;
+  depth_image.SetMaxPointCount(session->GetOptions().point_count);
+  depth_image.SetCameraIntrinsics(session->GetColorIntrinsics());
+  scene.SetCameraIntrinsics(session->GetColorIntrinsics());
+  color_image.InitializeGL();
+  depth_image.InitializeGL();
+  scene.InitializeGL();
+  scene.SetupViewPort(frames->GetWidth(), frames->GetHeight());
+  frames->Run([&](int /*frame*/) {
+    bool is_new;
+    const TangoXYZij* point_cloud = session->GetPointCloud(&is_new);
+    TangoPoseData pose;
+    if (point_cloud != nullptr &&
+        TangoSupport_calculateRelativePose(
+            tango_mock::GetTimestamp(), TANGO_COORDINATE_FRAME_CAMERA_COLOR,
+            point_cloud->timestamp, TANGO_COORDINATE_FRAME_CAMERA_DEPTH,
+            &pose) == TANGO_SUCCESS) {
+      depth_image.RenderDepthToTexture(GetMatrixFromPose(pose), point_cloud,
+                                       is_new);
+    }
+    scene.Render(color_image.GetTextureId(), depth_image.GetTextureId());
+  });
+}
+
+struct Benchmark {
+  const char* name;
+  void (*function)(BenchmarkFrames* frames);
+};
+
+const Benchmark kBenchmarks[] = {
+    {"Axis", BenchmarkAxis},
+    {"Band", BenchmarkBand},
+    {"Circle", BenchmarkCircle},
+    {"Cube", BenchmarkCube},
+    {"Frustum", BenchmarkFrustum},
+    {"GoalMarker", BenchmarkGoalMarker},
+    {"Grid", BenchmarkGrid},
+    {"Grid/procedural", BenchmarkGridProcedural},
+    {"Line", BenchmarkLine},
+    {"Mesh", BenchmarkMesh},
+    {"Quad", BenchmarkQuad},
+    {"SegmentDrawable", BenchmarkSegment},
+    {"Trace", BenchmarkTrace},
+    {"Triangle", BenchmarkTriangle},
+    {"VideoOverlay", BenchmarkVideoOverlay},
+    {"Scene/augmented_reality", BenchmarkAugmentedRealityScene},
+    {"Scene/mesh_builder", BenchmarkMeshBuilderScene},
+    {"Scene/motion_tracking", BenchmarkMotionTrackingScene},
+    {"Scene/point_cloud", BenchmarkPointCloudScene},
+    {"Scene/rgb_depth_sync", BenchmarkRgbDepthSyncScene},
+};
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  options.frame_count = 300;
+  options.width = 1280;
+  options.height = 720;
+  options.is_gpu_synchronized = true;
+  const char* filter = "";
+  for (int i = 1; i < argc; ++i) {
+    if (sscanf(argv[i], "--frames=%d", &options.frame_count) == 1 &&
+        options.frame_count > 0) {
+      continue;
+    }
+    if (sscanf(argv[i], "--size=%dx%d", &options.width, &options.height) ==
+            2 &&
+        options.width > 0 && options.height > 0) {
+      continue;
+    }
+    if (strncmp(argv[i], "--filter=", 9) == 0) {
+      filter = argv[i] + 9;
+      continue;
+    }
+    if (strcmp(argv[i], "--no_gpu_sync") == 0) {
+      options.is_gpu_synchronized = false;
+      continue;
+    }
+    fprintf(stderr,
+            "Usage: %s [--frames=<count>] [--size=<width>x<height>]\n"
+            "          [--filter=<substring>] [--no_gpu_sync]\n",
+            argv[0]);
+    return 2;
+  }
+
+  tango_benchmark::OffscreenContext context;
+  if (!context.Create(options.width, options.height)) {
+    return 1;
+  }
+  MockSession session;
+  if (!session.Connect(tango_mock::kScenarioWalking)) {
+    return 1;
+  }
+  glEnable(GL_DEPTH_TEST);
+
+  const char* renderer =
+      reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+  printf("{\"renderer\":\"%s\",\"width\":%d,\"height\":%d,\"frames\":%d,"
+         "\"gpu_synchronized\":%s,\"benchmarks\":[",
+         renderer != nullptr ? renderer : "", options.width, options.height,
+         options.frame_count, options.is_gpu_synchronized ? "true" : "false");
+  bool is_first = true;
+  for (const Benchmark& benchmark : kBenchmarks) {
+    if (strstr(benchmark.name, filter) == nullptr) {
+      continue;
+    }
+    BenchmarkFrames frames(benchmark.name, options, &session);
+    benchmark.function(&frames);
+    printf("%s\n%s", is_first ? "" : ",", frames.FormatReport().c_str());
+    is_first = false;
+  }
+  printf("]}\n");
+
+  session.Disconnect();
+  context.Destroy();
+  return 0;
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_BENCHMARK_OFFSCREEN_CONTEXT_H_
+#define TANGO_BENCHMARK_OFFSCREEN_CONTEXT_H_
+
+#include <EGL/egl.h>
+
+namespace tango_benchmark {
+
+// OffscreenContext makes an OpenGL ES context current on the calling thread
+// without a window, over a pbuffer surface, for the benchmarks to create
+// and draw the tango_gl objects from a command line tool:
+//
+//   tango_benchmark::OffscreenContext context;
+//   if (!context.Create(1280, 720)) {
+//     return 1;
+//   }
+//   tango_gl::Band band(1000);
+//
+// An OpenGL ES 3.0 context is created where the display supports one, 2.0
+// otherwise. On the desktop, Mesa gives one without a display server with
+// EGL_PLATFORM=surfaceless.
+class OffscreenContext {
+ public:
+  OffscreenContext();
+  OffscreenContext(const OffscreenContext& other) = delete;
+  OffscreenContext& operator=(const OffscreenContext&) = delete;
+  ~OffscreenContext();
+
+  // Create the context and a |width| x |height| pbuffer, and make them
+  // current.
+  //
+  // @return false if there is no display, config or context to create.
+  bool Create(int width, int height);
+
+  // Destroy the context and the pbuffer.
+  void Destroy();
+
+  // Swap the pbuffer, for the frame to be finished like one of a window.
+  void SwapBuffers();
+
+  int GetWidth() const { return width_; }
+  int GetHeight() const { return height_; }
+  int GetClientVersion() const { return client_version_; }
+
+ private:
+  EGLDisplay display_;
+  EGLContext context_;
+  EGLSurface surface_;
+  int width_;
+  int height_;
+  int client_version_;
+};
+}  // namespace tango_benchmark
+
+#endif  // TANGO_BENCHMARK_OFFSCREEN_CONTEXT_H_
@@ -11,6 +11,11 @@ LOCAL_PATH := $(call my-dir)
 include $(CLEAR_VARS)
 LOCAL_MODULE := tango_client_api
 
+# The Tango libraries only ship for the 32-bit ABIs, and a 64-bit process
+# cannot load them.
+ifeq ($(filter $(TARGET_ARCH_ABI),armeabi-v7a x86),)
+    $(error The Tango libraries are not available for $(TARGET_ARCH_ABI))
+endif
 
 ifeq ($(TARGET_ARCH),x86)
     LOCAL_EXPORT_LDLIBS := -L$(LOCAL_PATH)/lib/x86 -ltango_client_api
@@ -0,0 +1,118 @@
+# Copyright 2016 Google Inc. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# The tango_gl rendering helpers, built as a static library the examples
+# import:
+#
+#   LOCAL_STATIC_LIBRARIES := tango_gl
+#   ...
+#   $(call import-add-path,$(PROJECT_ROOT))
+#   $(call import-module,tango_gl)
+#
+# Only the objects an example references are linked into it.
+
+LOCAL_PATH := $(call my-dir)
+PROJECT_ROOT:= $(LOCAL_PATH)/..
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := tango_gl
+LOCAL_STATIC_LIBRARIES := libfreetype
+LOCAL_CFLAGS := -std=c++11
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/include \
+                    $(PROJECT_ROOT)/third_party/glm \
+                    $(PROJECT_ROOT)/third_party/libpng/include
+LOCAL_SRC_FILES := aligned_buffer.cc \
+                   axis.cc \
+                   band.cc \
+                   bounding_box.cc \
+                   bounding_volume_hierarchy.cc \
+                   camera.cc \
+                   camera_block.cc \
+                   camera_luminance.cc \
+                   circle.cc \
+                   conversions.cc \
+                   cube.cc \
+                   depth_occluder.cc \
+                   depth_probe.cc \
+                   drawable_object.cc \
+                   encoder_surface.cc \
+                   eye_dome_lighting.cc \
+                   frame_capture.cc \
+                   frustum.cc \
+                   full_screen_quad.cc \
+                   gesture_camera.cc \
+                   gl_context_tracker.cc \
+                   gl_state.cc \
+                   goal_marker.cc \
+                   gpu_profiler.cc \
+                   gpu_profiler_hud.cc \
+                   grid.cc \
+                   line.cc \
+                   log.cc \
+                   marker_store.cc \
+                   memory_accounting.cc \
+                   mesh.cc \
+                   mesh_cache.cc \
+                   mesh_indices.cc \
+                   mesh_lod_builder.cc \
+                   mesh_simplifier.cc \
+                   obj_loader.cc \
+                   oriented_bounding_box.cc \
+                   overlay_target.cc \
+                   plane_inlier_reducer.cc \
+                   point_cloud_statistics.cc \
+                   point_level_of_detail.cc \
+                   point_transform.cc \
+                   profiled_mutex.cc \
+                   quad.cc \
+                   quantized_points.cc \
+                   ray_table.cc \
+                   render_queue.cc \
+                   render_statistics.cc \
+                   segment_drawable.cc \
+                   segment_picker.cc \
+                   simd_math.cc \
+                   sprite_atlas.cc \
+                   sprite_batch.cc \
+                   stereo_rig.cc \
+                   streaming_texture.cc \
+                   streaming_vertex_buffer.cc \
+                   tango_gl.cc \
+                   text_renderer.cc \
+                   texture.cc \
+                   texture_loader.cc \
+                   trace.cc \
+                   tracing.cc \
+                   trajectory.cc \
+                   transform.cc \
+                   triangle.cc \
+                   util.cc \
+                   video_overlay.cc \
+                   view_frustum.cc
+LOCAL_EXPORT_C_INCLUDES := $(LOCAL_PATH)/include \
+                           $(PROJECT_ROOT)/third_party/glm
+LOCAL_EXPORT_LDLIBS := -lGLESv2 -lEGL -llog -landroid
+
+# The render loops run every frame: optimize them further in release builds,
+# and enable the NEON kernels. x86 always has SSE2.
+ifeq ($(APP_OPTIM),release)
+LOCAL_CFLAGS += -O3
+endif
+ifeq ($(TARGET_ARCH_ABI),armeabi-v7a)
+LOCAL_ARM_MODE := arm
+LOCAL_ARM_NEON := true
+endif
+include $(BUILD_STATIC_LIBRARY)
+
+$(call import-module,third_party/libfreetype)
@@ -0,0 +1,117 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-gl/aligned_buffer.h"
+
+#include <stdlib.h>
+
+namespace {
+// Blocks the process-wide pool keeps, about a session of camera frames,
+// depth images and point clouds.
+const size_t kMaxPooledBytes = 64 * 1024 * 1024;
+
+// Blocks up to this size are rounded to the alignment only.
+const size_t kMinSizeClassStep = tango_gl::kBufferAlignment;
+const size_t kSizeClassStepsPerPowerOfTwo = 4;
+}  // namespace
+
+namespace tango_gl {
+
+BufferPool::BufferPool(size_t max_pooled_bytes)
+    : max_pooled_bytes_(max_pooled_bytes),
+      statistics_(),
+      memory_(kMemoryTagBufferPool, kMemoryCpu) {}
+
+BufferPool::~BufferPool() { Trim(); }
+
+BufferPool* BufferPool::GetInstance() {
+  // Never destroyed, buffers of static objects may still be freed while the
+  // process exits.
+  static BufferPool* pool = new BufferPool(kMaxPooledBytes);
+  return pool;
+}
+
+size_t BufferPool::GetSizeClass(size_t size) {
+  if (size <= kMinSizeClassStep * kSizeClassStepsPerPowerOfTwo) {
+    return GetAlignedStride(std::max<size_t>(size, 1));
+  }
+  // The steps between the power of two below |size| and the next one.
+  size_t power_of_two = kMinSizeClassStep * kSizeClassStepsPerPowerOfTwo;
+  while (power_of_two * 2 < size) {
+    power_of_two *= 2;
+  }
+  const size_t step = power_of_two / kSizeClassStepsPerPowerOfTwo;
+  return (size + step - 1) / step * step;
+}
+
+void* BufferPool::Acquire(size_t size, size_t* capacity) {
+  const size_t size_class = GetSizeClass(size);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto found = free_blocks_.find(size_class);
+    if (found != free_blocks_.end() && !found->second.empty()) {
+      void* block = found->second.back();
+      found->second.pop_back();
+      statistics_.pooled_bytes -= size_class;
+      ++statistics_.reuse_count;
+      memory_.Set(statistics_.pooled_bytes);
+      *capacity = size_class;
+      return block;
+    }
+    ++statistics_.allocation_count;
+  }
+  void* block = nullptr;
+  if (posix_memalign(&block, kBufferAlignment, size_class) != 0) {
+    LOGE("BufferPool: Failed to allocate %zu bytes", size_class);
+    return nullptr;
+  }
+  *capacity = size_class;
+  return block;
+}
+
+void BufferPool::Release(void* block, size_t capacity) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (statistics_.pooled_bytes + capacity <= max_pooled_bytes_) {
+      free_blocks_[capacity].push_back(block);
+      statistics_.pooled_bytes += capacity;
+      memory_.Set(statistics_.pooled_bytes);
+      return;
+    }
+  }
+  free(block);
+}
+
+void BufferPool::Trim() {
+  std::map<size_t, std::vector<void*>> free_blocks;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_blocks.swap(free_blocks_);
+    statistics_.pooled_bytes = 0;
+    memory_.Set(0);
+  }
+  for (const auto& size_blocks : free_blocks) {
+    for (void* block : size_blocks.second) {
+      free(block);
+    }
+  }
+}
+
+BufferPool::Statistics BufferPool::GetStatistics() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return statistics_;
+}
+}  // namespace tango_gl
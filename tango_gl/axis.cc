@@ -15,6 +15,9 @@
  */
 
 #include "tango-gl/axis.h"
+#include "tango-gl/camera_block.h"
+#include "tango-gl/gl_state.h"
+#include "tango-gl/render_statistics.h"
 #include "tango-gl/shaders.h"
 
 namespace tango_gl {
@@ -29,15 +32,18 @@ static const float float_colors[] = {
 
 Axis::Axis() : Line(3.0f, GL_LINES) {
   // Implement SetShader here, not using the dedault one.
-  shader_program_ =
-      util::CreateProgram(shaders::GetColorVertexShader().c_str(),
-                          shaders::GetBasicFragmentShader().c_str());
-  if (!shader_program_) {
+  const util::SharedProgram* program =
+      util::GetSharedProgram(shaders::GetColorVertexShader().c_str(),
+                             shaders::GetBasicFragmentShader().c_str());
+  if (program) {
+    shader_program_ = program->GetId();
+    uniform_mvp_mat_ = program->GetUniformLocation("mvp");
+    attrib_colors_ = program->GetAttribLocation("color");
+    attrib_vertices_ = program->GetAttribLocation("vertex");
+  } else {
     LOGE("Could not create program.");
+    shader_program_ = 0;
   }
-  uniform_mvp_mat_ = glGetUniformLocation(shader_program_, "mvp");
-  attrib_colors_ = glGetAttribLocation(shader_program_, "color");
-  attrib_vertices_ = glGetAttribLocation(shader_program_, "vertex");
 
   size_t size = sizeof(float_vertices) / (sizeof(float) * 3);
   for (size_t i = 0; i < size; i++) {
@@ -52,10 +58,11 @@ Axis::Axis() : Line(3.0f, GL_LINES) {
 
 void Axis::Render(const glm::mat4& projection_mat,
                   const glm::mat4& view_mat) const {
-  glUseProgram(shader_program_);
+  GlState::UseProgram(shader_program_);
   glLineWidth(line_width_);
   glm::mat4 model_mat = GetTransformationMatrix();
-  glm::mat4 mvp_mat = projection_mat * view_mat * model_mat;
+  glm::mat4 mvp_mat =
+      GetCameraBlock(projection_mat, view_mat).view_projection * model_mat;
   glUniformMatrix4fv(uniform_mvp_mat_, 1, GL_FALSE, glm::value_ptr(mvp_mat));
 
   glEnableVertexAttribArray(attrib_vertices_);
@@ -66,10 +73,10 @@ void Axis::Render(const glm::mat4& projection_mat,
   glVertexAttribPointer(attrib_colors_, 4, GL_FLOAT, GL_FALSE,
                         sizeof(glm::vec4), &vec_colors_[0]);
 
+  CountDraw(vec_vertices_.size());
   glDrawArrays(render_mode_, 0, vec_vertices_.size());
 
   glDisableVertexAttribArray(attrib_vertices_);
   glDisableVertexAttribArray(attrib_colors_);
-  glUseProgram(0);
 }
 }  // namespace tango_gl
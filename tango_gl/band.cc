@@ -15,6 +15,12 @@
  */
 
 #include "tango-gl/band.h"
+
+#include <algorithm>
+
+#include "tango-gl/camera_block.h"
+#include "tango-gl/gl_state.h"
+#include "tango-gl/render_statistics.h"
 #include "tango-gl/util.h"
 
 namespace tango_gl {
@@ -25,7 +31,8 @@ static const float kMinDistanceSquared = 0.0001f;
 Band::Band(const unsigned int max_length)
     : band_width_(0.2), max_length_(max_length) {
   SetShader();
-  vertices_v_.reserve(max_length);
+  // The band grows two vertices past its length before its tail is dropped.
+  vertices_v_.reserve(max_length + 2);
   pivot_left = glm::vec3(0, 0, 0);
   pivot_right = glm::vec3(0, 0, 0);
 }
@@ -83,6 +90,8 @@ void Band::UpdateVertexArray(const glm::mat4 m, BandMode mode) {
     }
 
     size_t insertion_start = vertices_v_.size() - 5;
+    // The previous arrow head is replaced, everything before it is unchanged.
+    SetVerticesChangedFrom(insertion_start);
     vertices_v_[insertion_start + 0] = pivot_left;
     vertices_v_[insertion_start + 1] = pivot_right;
     vertices_v_[insertion_start + 2] = util::ApplyTransform(head_m, arrow_left);
@@ -91,8 +100,14 @@ void Band::UpdateVertexArray(const glm::mat4 m, BandMode mode) {
     vertices_v_[insertion_start + 4] =
         util::ApplyTransform(head_m, arrow_front);
 
+    // Drop the oldest part of the band in chunks rather than two vertices at
+    // a time, so the band is not shifted and uploaded again on every update.
     if (vertices_v_.size() > max_length_) {
-      vertices_v_.erase(vertices_v_.begin(), vertices_v_.begin() + 2);
+      const size_t drop_count =
+          std::min(vertices_v_.size() - 5,
+                   std::max<size_t>(2, (max_length_ / 8) & ~size_t(1)));
+      vertices_v_.erase(vertices_v_.begin(), vertices_v_.begin() + drop_count);
+      SetVertexBuffersDirty();
     }
   }
 }
@@ -106,6 +121,7 @@ void Band::SetVertexArray(const std::vector<glm::vec3>& v,
                           const glm::vec3& up) {
   vertices_v_.clear();
   vertices_v_.reserve(2 * v.size());
+  SetVertexBuffersDirty();
   if (v.size() < 2) return;
 
   for (size_t i = 0; i < v.size() - 1; ++i) {
@@ -126,23 +142,27 @@ void Band::SetVertexArray(const std::vector<glm::vec3>& v,
   }
 }
 
-void Band::ClearVertexArray() { vertices_v_.clear(); }
+void Band::ClearVertexArray() {
+  vertices_v_.clear();
+  SetVertexBuffersDirty();
+}
 
 void Band::Render(const glm::mat4& projection_mat,
                   const glm::mat4& view_mat) const {
-  glUseProgram(shader_program_);
+  GlState::UseProgram(shader_program_);
   glm::mat4 model_mat = GetTransformationMatrix();
-  glm::mat4 mvp_mat = projection_mat * view_mat * model_mat;
+  glm::mat4 mvp_mat =
+      GetCameraBlock(projection_mat, view_mat).view_projection * model_mat;
   glUniformMatrix4fv(uniform_mvp_mat_, 1, GL_FALSE, glm::value_ptr(mvp_mat));
 
   glUniform4f(uniform_color_, red_, green_, blue_, alpha_);
 
-  glEnableVertexAttribArray(attrib_vertices_);
-  glVertexAttribPointer(attrib_vertices_, 3, GL_FLOAT, GL_FALSE,
-                        sizeof(glm::vec3), &vertices_v_[0]);
-  glDrawArrays(GL_TRIANGLE_STRIP, 0, vertices_v_.size());
-  glDisableVertexAttribArray(attrib_vertices_);
-  glUseProgram(0);
+  UpdateGrowingVertexBuffer(vertices_v_.data(), vertices_v_.size(),
+                            sizeof(glm::vec3));
+  BindVertexAttributes(false);
+  CountDraw(buffer_vertex_count_);
+  glDrawArrays(GL_TRIANGLE_STRIP, 0, buffer_vertex_count_);
+  UnbindVertexAttributes(false);
 }
 
 }  // namespace tango_gl
@@ -15,14 +15,22 @@
  */
 #include "tango-gl/bounding_box.h"
 
+#include <algorithm>
+#include <cmath>
+
 namespace tango_gl {
 
 BoundingBox::BoundingBox(const std::vector<float>& vertices) {
+  if (vertices.size() < 3) {
+    bounding_min_ = glm::vec3(0, 0, 0);
+    bounding_max_ = bounding_min_;
+    return;
+  }
   // Set min and max to the first vertice.
   bounding_min_ = glm::vec3(vertices[0], vertices[1], vertices[2]);
   bounding_max_ = bounding_min_;
   size_t vertices_count = vertices.size() / 3;
-  for (size_t i = 1; i < vertices_count; i += 3) {
+  for (size_t i = 1; i < vertices_count; ++i) {
     bounding_min_.x = std::min(vertices[i * 3], bounding_min_.x);
     bounding_min_.y = std::min(vertices[i * 3 + 1], bounding_min_.y);
     bounding_min_.z = std::min(vertices[i * 3 + 2], bounding_min_.z);
@@ -33,46 +41,51 @@ BoundingBox::BoundingBox(const std::vector<float>& vertices) {
   }
 }
 
-bool BoundingBox::IsIntersecting(const Segment& segment,
-                                 const glm::quat& rotation,
-                                 const glm::mat4& transformation) {
-  // The current bounding box.
-  glm::vec3 min, max;
-
-  // If the mesh has been rotated, we need to derive a new bounding box
-  // based on the original one, if it just been translated or scaled,
-  // we can still use the original one with current model matrix applied.
-  if (rotation == glm::quat(1.0f, 0.0f, 0.0f, 0.0f)) {
-    min = util::ApplyTransform(transformation, bounding_min_);
-    max = util::ApplyTransform(transformation, bounding_max_);
-  } else {
-    std::vector<glm::vec3> box;
-    // Derive 8 vertices of the new bounding box from original min and max.
-    box.push_back(bounding_min_);
-    box.push_back(bounding_max_);
-
-    box.push_back(glm::vec3(bounding_min_.x, bounding_max_.y, bounding_max_.z));
-    box.push_back(glm::vec3(bounding_max_.x, bounding_min_.y, bounding_min_.z));
-
-    box.push_back(glm::vec3(bounding_min_.x, bounding_min_.y, bounding_max_.z));
-    box.push_back(glm::vec3(bounding_max_.x, bounding_max_.y, bounding_min_.z));
-
-    box.push_back(glm::vec3(bounding_max_.x, bounding_min_.y, bounding_max_.z));
-    box.push_back(glm::vec3(bounding_min_.x, bounding_max_.y, bounding_min_.z));
+BoundingBox::BoundingBox(const std::vector<glm::vec3>& vertices) {
+  if (vertices.empty()) {
+    bounding_min_ = glm::vec3(0, 0, 0);
+    bounding_max_ = bounding_min_;
+    return;
+  }
+  bounding_min_ = vertices[0];
+  bounding_max_ = vertices[0];
+  for (size_t i = 1; i < vertices.size(); ++i) {
+    bounding_min_ = glm::min(bounding_min_, vertices[i]);
+    bounding_max_ = glm::max(bounding_max_, vertices[i]);
+  }
+}
 
-    min = util::ApplyTransform(transformation, bounding_min_);
-    max = min;
-    for (size_t i = 1; i < box.size(); i++) {
-      glm::vec3 temp = util::ApplyTransform(transformation, box[i]);
-      min.x = std::min(temp.x, min.x);
-      min.y = std::min(temp.y, min.y);
-      min.z = std::min(temp.z, min.z);
+void BoundingBox::Merge(const BoundingBox& other) {
+  bounding_min_ = glm::min(bounding_min_, other.bounding_min_);
+  bounding_max_ = glm::max(bounding_max_, other.bounding_max_);
+}
 
-      max.x = std::max(temp.x, max.x);
-      max.y = std::max(temp.y, max.y);
-      max.z = std::max(temp.z, max.z);
+BoundingBox BoundingBox::GetTransformed(
+    const glm::mat4& transformation) const {
+  // Transform the center, and project the half extents on every axis, instead
+  // of transforming the 8 corners.
+  const glm::vec3 center = GetCenter();
+  const glm::vec3 half_extent = (bounding_max_ - bounding_min_) * 0.5f;
+  const glm::vec3 new_center =
+      glm::vec3(transformation * glm::vec4(center, 1.0f));
+  glm::vec3 new_half_extent(0.0f, 0.0f, 0.0f);
+  for (int column = 0; column < 3; ++column) {
+    for (int row = 0; row < 3; ++row) {
+      new_half_extent[row] +=
+          std::abs(transformation[column][row]) * half_extent[column];
     }
   }
-  return util::SegmentAABBIntersect(min, max, segment.start, segment.end);
+  return BoundingBox(new_center - new_half_extent,
+                     new_center + new_half_extent);
+}
+
+bool BoundingBox::IsIntersecting(const Segment& segment,
+                                 const glm::quat& rotation,
+                                 const glm::mat4& transformation) {
+  // The transformed box of the 8 corners, without transforming them. A box
+  // that was only translated or scaled gets the same bounds as before.
+  const BoundingBox box = GetTransformed(transformation);
+  return util::SegmentAABBIntersect(box.bounding_min_, box.bounding_max_,
+                                    segment.start, segment.end);
 }
 }  // namespace tango_gl
@@ -0,0 +1,383 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "tango-gl/bounding_volume_hierarchy.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// Largest number of objects tested one by one at the bottom of the tree.
+const size_t kMaxLeafEntries = 4;
+
+// Segment directions smaller than this along an axis are parallel to the
+// faces of the boxes across it.
+const float kMinDirection = 1e-6f;
+
+// A refitted tree can cost half again as much as a rebuilt one before the
+// rebuild is worth it.
+const float kDefaultMaxCostRatio = 1.5f;
+
+float GetSurfaceArea(const tango_gl::BoundingBox& box) {
+  const glm::vec3 size = box.GetMax() - box.GetMin();
+  return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+// Clip the segment from |start| along |direction|, at [0, |max_fraction|] of
+// |direction|, to |box|.
+//
+// @param entry: set to where the segment enters the box, 0 if it starts in
+//               it.
+// @param axis: set to the axis of the face it enters through, -1 if it
+//              starts in it.
+// @return false if the segment misses the box.
+bool ClipSegment(const tango_gl::BoundingBox& box, const glm::vec3& start,
+                 const glm::vec3& direction, float max_fraction, float* entry,
+                 int* axis) {
+  float near_fraction = 0.0f;
+  float far_fraction = max_fraction;
+  int near_axis = -1;
+  for (int i = 0; i < 3; ++i) {
+    if (std::fabs(direction[i]) < kMinDirection) {
+      if (start[i] < box.GetMin()[i] || start[i] > box.GetMax()[i]) {
+        return false;
+      }
+      continue;
+    }
+    const float inverse = 1.0f / direction[i];
+    float t0 = (box.GetMin()[i] - start[i]) * inverse;
+    float t1 = (box.GetMax()[i] - start[i]) * inverse;
+    if (t0 > t1) {
+      std::swap(t0, t1);
+    }
+    if (t0 > near_fraction) {
+      near_fraction = t0;
+      near_axis = i;
+    }
+    far_fraction = std::min(far_fraction, t1);
+    if (near_fraction > far_fraction) {
+      return false;
+    }
+  }
+  *entry = near_fraction;
+  *axis = near_axis;
+  return true;
+}
+}  // namespace
+
+namespace tango_gl {
+
+BoundingVolumeHierarchy::Options::Options()
+    : max_cost_ratio(kDefaultMaxCostRatio) {}
+
+BoundingVolumeHierarchy::BoundingVolumeHierarchy()
+    : BoundingVolumeHierarchy(Options()) {}
+
+BoundingVolumeHierarchy::BoundingVolumeHierarchy(const Options& options)
+    : options_(options),
+      needs_build_(false),
+      cost_(0.0f),
+      built_cost_(0.0f),
+      build_count_(0) {}
+
+void BoundingVolumeHierarchy::Add(const DrawableObject* object,
+                                  const BoundingBox& local_box) {
+  Entry entry;
+  entry.object = object;
+  entry.local_box = local_box;
+  entry.has_oriented_box = false;
+  entries_.push_back(entry);
+  needs_build_ = true;
+}
+
+void BoundingVolumeHierarchy::Add(
+    const DrawableObject* object, const BoundingBox& local_box,
+    const OrientedBoundingBox& local_oriented_box) {
+  Add(object, local_box);
+  entries_.back().has_oriented_box = true;
+  entries_.back().local_oriented_box = local_oriented_box;
+}
+
+void BoundingVolumeHierarchy::Clear() {
+  entries_.clear();
+  nodes_.clear();
+  needs_build_ = false;
+  cost_ = 0.0f;
+  built_cost_ = 0.0f;
+}
+
+void BoundingVolumeHierarchy::Update() {
+  for (Entry& entry : entries_) {
+    const glm::mat4 transformation = entry.object->GetTransformationMatrix();
+    entry.world_box = entry.local_box.GetTransformed(transformation);
+    if (entry.has_oriented_box) {
+      entry.world_oriented_box =
+          entry.local_oriented_box.GetTransformed(transformation);
+    }
+  }
+  if (needs_build_) {
+    Build();
+    return;
+  }
+  // Children come after their parent, so walking backwards refits every
+  // node from up to date children.
+  for (size_t i = nodes_.size(); i-- > 0;) {
+    Node& node = nodes_[i];
+    if (node.right_child < 0) {
+      node.box = entries_[node.first_entry].world_box;
+      for (size_t j = 1; j < node.entry_count; ++j) {
+        node.box.Merge(entries_[node.first_entry + j].world_box);
+      }
+    } else {
+      node.box = nodes_[i + 1].box;
+      node.box.Merge(nodes_[node.right_child].box);
+    }
+  }
+  // The split of a node was chosen for where its objects were when it was
+  // built, once they moved across each other the boxes of its children
+  // overlap and most queries visit both.
+  cost_ = ComputeCost();
+  if (cost_ > built_cost_ * options_.max_cost_ratio) {
+    Build();
+  }
+}
+
+void BoundingVolumeHierarchy::Build() {
+  nodes_.clear();
+  if (!entries_.empty()) {
+    nodes_.reserve(2 * entries_.size() / kMaxLeafEntries + 1);
+    BuildNode(0, entries_.size());
+  }
+  needs_build_ = false;
+  cost_ = ComputeCost();
+  built_cost_ = cost_;
+  ++build_count_;
+}
+
+float BoundingVolumeHierarchy::ComputeCost() const {
+  if (nodes_.empty()) {
+    return 0.0f;
+  }
+  const float root_area = GetSurfaceArea(nodes_[0].box);
+  if (root_area <= 0.0f) {
+    // Every object is at one point, each query tests them all.
+    return static_cast<float>(nodes_.size() + entries_.size());
+  }
+  float cost = 0.0f;
+  for (const Node& node : nodes_) {
+    // A node tests its own box, and a leaf those of its entries once the
+    // query reached it.
+    const float tests =
+        node.right_child < 0 && node.entry_count > 1
+            ? 1.0f + static_cast<float>(node.entry_count)
+            : 1.0f;
+    cost += tests * GetSurfaceArea(node.box);
+  }
+  return cost / root_area;
+}
+
+int BoundingVolumeHierarchy::BuildNode(size_t first, size_t count) {
+  const int node_index = nodes_.size();
+  nodes_.push_back(Node());
+  BoundingBox box = entries_[first].world_box;
+  BoundingBox centers(box.GetCenter(), box.GetCenter());
+  for (size_t i = first + 1; i < first + count; ++i) {
+    box.Merge(entries_[i].world_box);
+    const glm::vec3 center = entries_[i].world_box.GetCenter();
+    centers.Merge(BoundingBox(center, center));
+  }
+  nodes_[node_index].box = box;
+  nodes_[node_index].first_entry = first;
+  nodes_[node_index].entry_count = count;
+  nodes_[node_index].right_child = -1;
+  if (count <= kMaxLeafEntries) {
+    return node_index;
+  }
+
+  // Split at the median of the box centers along the axis they spread the
+  // most on, which keeps the tree balanced.
+  const glm::vec3 spread = centers.GetMax() - centers.GetMin();
+  int axis = spread.x > spread.y ? 0 : 1;
+  if (spread.z > spread[axis]) {
+    axis = 2;
+  }
+  const size_t half = count / 2;
+  std::nth_element(entries_.begin() + first, entries_.begin() + first + half,
+                   entries_.begin() + first + count,
+                   [axis](const Entry& a, const Entry& b) {
+                     return a.world_box.GetCenter()[axis] <
+                            b.world_box.GetCenter()[axis];
+                   });
+  BuildNode(first, half);
+  const int right_child = BuildNode(first + half, count - half);
+  // nodes_ may have been reallocated.
+  nodes_[node_index].right_child = right_child;
+  return node_index;
+}
+
+void BoundingVolumeHierarchy::Cull(
+    const ViewFrustum& frustum, std::vector<const DrawableObject*>* visible) {
+  if (needs_build_) {
+    Update();
+  }
+  if (!nodes_.empty()) {
+    CullNode(0, frustum, visible);
+  }
+}
+
+void BoundingVolumeHierarchy::CullNode(
+    int node_index, const ViewFrustum& frustum,
+    std::vector<const DrawableObject*>* visible) const {
+  const Node& node = nodes_[node_index];
+  const ViewFrustum::Containment containment = frustum.Classify(node.box);
+  if (containment == ViewFrustum::kOutside) {
+    return;
+  }
+  if (containment == ViewFrustum::kInside) {
+    // The whole subtree is visible, no need to test it further.
+    for (size_t i = 0; i < node.entry_count; ++i) {
+      visible->push_back(entries_[node.first_entry + i].object);
+    }
+    return;
+  }
+  if (node.right_child < 0) {
+    for (size_t i = 0; i < node.entry_count; ++i) {
+      const Entry& entry = entries_[node.first_entry + i];
+      const bool is_visible =
+          entry.has_oriented_box
+              ? frustum.IsVisible(entry.world_oriented_box)
+              : node.entry_count == 1 || frustum.IsVisible(entry.world_box);
+      if (is_visible) {
+        visible->push_back(entry.object);
+      }
+    }
+    return;
+  }
+  CullNode(node_index + 1, frustum, visible);
+  CullNode(node.right_child, frustum, visible);
+}
+
+void BoundingVolumeHierarchy::Render(const glm::mat4& projection_mat,
+                                     const glm::mat4& view_mat) {
+  visible_objects_.clear();
+  Cull(ViewFrustum(projection_mat, view_mat), &visible_objects_);
+  for (const DrawableObject* object : visible_objects_) {
+    object->Render(projection_mat, view_mat);
+  }
+}
+
+void BoundingVolumeHierarchy::Intersect(
+    const Segment& segment, std::vector<const DrawableObject*>* hits) {
+  if (needs_build_) {
+    Update();
+  }
+  if (!nodes_.empty()) {
+    IntersectNode(0, segment, hits);
+  }
+}
+
+void BoundingVolumeHierarchy::IntersectNode(
+    int node_index, const Segment& segment,
+    std::vector<const DrawableObject*>* hits) const {
+  const Node& node = nodes_[node_index];
+  if (!util::SegmentAABBIntersect(node.box.GetMin(), node.box.GetMax(),
+                                  segment.start, segment.end)) {
+    return;
+  }
+  if (node.right_child < 0) {
+    for (size_t i = 0; i < node.entry_count; ++i) {
+      const Entry& entry = entries_[node.first_entry + i];
+      const bool is_hit =
+          entry.has_oriented_box
+              ? entry.world_oriented_box.IsIntersecting(segment)
+              : node.entry_count == 1 ||
+                    util::SegmentAABBIntersect(entry.world_box.GetMin(),
+                                               entry.world_box.GetMax(),
+                                               segment.start, segment.end);
+      if (is_hit) {
+        hits->push_back(entry.object);
+      }
+    }
+    return;
+  }
+  IntersectNode(node_index + 1, segment, hits);
+  IntersectNode(node.right_child, segment, hits);
+}
+
+const DrawableObject* BoundingVolumeHierarchy::IntersectNearest(
+    const Segment& segment, float* fraction, glm::vec3* normal) {
+  if (needs_build_) {
+    Update();
+  }
+  if (nodes_.empty()) {
+    return NULL;
+  }
+  const glm::vec3 direction = segment.end - segment.start;
+  float nearest = 1.0f;
+  const DrawableObject* object = NULL;
+  int axis = -1;
+  IntersectNearestNode(0, segment.start, direction, &nearest, &object, &axis);
+  if (object == NULL) {
+    return NULL;
+  }
+  *fraction = nearest;
+  *normal = glm::vec3(0.0f, 0.0f, 0.0f);
+  (*normal)[axis] = direction[axis] > 0.0f ? -1.0f : 1.0f;
+  return object;
+}
+
+void BoundingVolumeHierarchy::IntersectNearestNode(
+    int node_index, const glm::vec3& start, const glm::vec3& direction,
+    float* nearest, const DrawableObject** object, int* axis) const {
+  const Node& node = nodes_[node_index];
+  if (node.right_child < 0) {
+    for (size_t i = 0; i < node.entry_count; ++i) {
+      const Entry& entry = entries_[node.first_entry + i];
+      float entry_fraction;
+      int entry_axis;
+      // A segment starting in a box does not hit it.
+      if (ClipSegment(entry.world_box, start, direction, *nearest,
+                      &entry_fraction, &entry_axis) &&
+          entry_axis >= 0 && entry_fraction < *nearest) {
+        *nearest = entry_fraction;
+        *object = entry.object;
+        *axis = entry_axis;
+      }
+    }
+    return;
+  }
+
+  // The child entered first is visited first, so that the other one is
+  // likely past the nearest box by then.
+  int children[2] = {node_index + 1, node.right_child};
+  float entries[2];
+  bool is_hit[2];
+  for (int i = 0; i < 2; ++i) {
+    int child_axis;
+    is_hit[i] = ClipSegment(nodes_[children[i]].box, start, direction,
+                            *nearest, &entries[i], &child_axis);
+  }
+  if (is_hit[0] && is_hit[1] && entries[1] < entries[0]) {
+    std::swap(children[0], children[1]);
+    std::swap(entries[0], entries[1]);
+  }
+  for (int i = 0; i < 2; ++i) {
+    if (is_hit[i] && entries[i] < *nearest) {
+      IntersectNearestNode(children[i], start, direction, nearest, object,
+                           axis);
+    }
+  }
+}
+}  // namespace tango_gl
@@ -0,0 +1,91 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-gl/camera_block.h"
+
+#include <EGL/egl.h>
+
+#include <vector>
+
+namespace {
+// The block of a thread, and the programs that hold its matrices.
+struct CameraState {
+  CameraState() : context(EGL_NO_CONTEXT) {
+    block.projection = glm::mat4(0.0f);
+    block.view = glm::mat4(0.0f);
+    block.view_projection = glm::mat4(0.0f);
+    block.generation = 0;
+  }
+
+  tango_gl::CameraBlock block;
+  // The context of the programs, which are forgotten with it.
+  EGLContext context;
+  std::vector<std::pair<GLuint, uint32_t>> uploads;
+};
+
+CameraState& GetCameraState() {
+  static thread_local CameraState* state = nullptr;
+  if (state == nullptr) {
+    state = new CameraState();
+  }
+  return *state;
+}
+}  // namespace
+
+namespace tango_gl {
+
+const CameraBlock& GetCameraBlock(const glm::mat4& projection,
+                                  const glm::mat4& view) {
+  CameraBlock& block = GetCameraState().block;
+  if (projection != block.projection || view != block.view) {
+    block.projection = projection;
+    block.view = view;
+    block.view_projection = projection * view;
+    ++block.generation;
+  }
+  return block;
+}
+
+bool IsCameraUploaded(GLuint program, const CameraBlock& camera) {
+  CameraState& state = GetCameraState();
+  const EGLContext context = eglGetCurrentContext();
+  if (context != state.context) {
+    state.uploads.clear();
+    state.context = context;
+  }
+  for (std::pair<GLuint, uint32_t>& upload : state.uploads) {
+    if (upload.first == program) {
+      if (upload.second == camera.generation) {
+        return true;
+      }
+      upload.second = camera.generation;
+      return false;
+    }
+  }
+  state.uploads.push_back(std::make_pair(program, camera.generation));
+  return false;
+}
+
+void ForgetCameraUploads(GLuint program) {
+  std::vector<std::pair<GLuint, uint32_t>>& uploads = GetCameraState().uploads;
+  for (size_t i = 0; i < uploads.size(); ++i) {
+    if (uploads[i].first == program) {
+      uploads.erase(uploads.begin() + i);
+      return;
+    }
+  }
+}
+}  // namespace tango_gl
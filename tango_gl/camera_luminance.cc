@@ -0,0 +1,356 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-gl/camera_luminance.h"
+
+#include <algorithm>
+
+#include "tango-gl/gl_state.h"
+#include "tango-gl/render_statistics.h"
+#include "tango-gl/tracing.h"
+
+namespace {
+// GLES 3.0 enums, which gl2.h does not define.
+const GLenum kPixelPackBuffer = 0x88EB;
+const GLenum kStreamRead = 0x88E1;
+const GLbitfield kMapReadBit = 0x0001;
+
+// Images in flight: the one being read back, the one the GPU may still be
+// drawing and one to spare.
+const size_t kReadbackCount = 3;
+
+// Luminance pixels per RGBA texel of the framebuffer.
+const int kPixelsPerTexel = 4;
+
+// The quad covering the framebuffer, as a triangle strip.
+const GLfloat kVertices[] = {-1.0f, -1.0f, 1.0f, -1.0f,
+                             -1.0f, 1.0f,  1.0f, 1.0f};
+
+const char kVertexShader[] =
+    "attribute vec2 vertex;\n"
+    "void main() {\n"
+    "  gl_Position = vec4(vertex, 0.0, 1.0);\n"
+    "}\n";
+
+// Texel x of the framebuffer holds the luminance pixels 4x to 4x + 3 of its
+// row, and row y is row y of the image from the top, which is v = 0 of the
+// camera texture. Each pixel averages 4 bilinear taps a quarter of a pixel
+// from its center: for an image half or a quarter the size of the camera's,
+// that is exactly the box of camera pixels it covers.
+const char kFragmentShader[] =
+    "#extension GL_OES_EGL_image_external : require\n"
+    "precision highp float;\n"
+    "uniform samplerExternalOES camera;\n"
+    "uniform vec2 texel_size;\n"
+    "const vec3 kLuma = vec3(0.299, 0.587, 0.114);\n"
+    "float Luminance(vec2 center) {\n"
+    "  vec2 offset = 0.25 * texel_size;\n"
+    "  vec3 sum = texture2D(camera, center - offset).rgb +\n"
+    "      texture2D(camera, center + offset).rgb +\n"
+    "      texture2D(camera, center + vec2(offset.x, -offset.y)).rgb +\n"
+    "      texture2D(camera, center + vec2(-offset.x, offset.y)).rgb;\n"
+    "  return 0.25 * dot(kLuma, sum);\n"
+    "}\n"
+    "void main() {\n"
+    "  vec2 center = vec2((floor(gl_FragCoord.x) * 4.0 + 0.5) * texel_size.x,\n"
+    "                     gl_FragCoord.y * texel_size.y);\n"
+    "  vec2 step = vec2(texel_size.x, 0.0);\n"
+    "  gl_FragColor = vec4(Luminance(center), Luminance(center + step),\n"
+    "                      Luminance(center + 2.0 * step),\n"
+    "                      Luminance(center + 3.0 * step));\n"
+    "}\n";
+
+// Capabilities the luminance pass turns off, and restores after it.
+const GLenum kDisabledCapabilities[] = {GL_BLEND, GL_CULL_FACE,
+                                        GL_DEPTH_TEST, GL_SCISSOR_TEST,
+                                        GL_STENCIL_TEST};
+const size_t kDisabledCapabilityCount =
+    sizeof(kDisabledCapabilities) / sizeof(kDisabledCapabilities[0]);
+}  // namespace
+
+namespace tango_gl {
+
+CameraLuminance::CameraLuminance()
+    : width_(0),
+      height_(0),
+      gl_initialized_(false),
+      is_supported_(false),
+      map_buffer_range_(NULL),
+      unmap_buffer_(NULL),
+      fence_sync_(NULL),
+      client_wait_sync_(NULL),
+      delete_sync_(NULL),
+      program_(0),
+      vertex_location_(-1),
+      camera_location_(-1),
+      texel_size_location_(-1),
+      vertex_buffer_(0),
+      framebuffer_(0),
+      framebuffer_texture_(0),
+      framebuffer_width_(0),
+      framebuffer_height_(0),
+      next_readback_(0),
+      dropped_count_(0) {}
+
+CameraLuminance::~CameraLuminance() {}
+
+void CameraLuminance::SetSize(int width, int height) {
+  width_ = std::max(width / kPixelsPerTexel, 0) * kPixelsPerTexel;
+  height_ = std::max(height, 0);
+}
+
+void CameraLuminance::InitializeGl() {
+  if (gl_initialized_) {
+    return;
+  }
+  gl_initialized_ = true;
+  is_supported_ = false;
+  const util::GlCapabilities& gl = util::GetGlCapabilities();
+  if (!gl.IsGles3()) {
+    LOGI("CameraLuminance: pixel pack buffers are not supported");
+    return;
+  }
+  map_buffer_range_ = gl.map_buffer_range;
+  unmap_buffer_ = gl.unmap_buffer;
+  fence_sync_ = gl.fence_sync;
+  client_wait_sync_ = gl.client_wait_sync;
+  delete_sync_ = gl.delete_sync;
+  if (map_buffer_range_ == NULL || unmap_buffer_ == NULL ||
+      fence_sync_ == NULL || client_wait_sync_ == NULL ||
+      delete_sync_ == NULL) {
+    LOGE("CameraLuminance: GLES 3.0 entry points are missing");
+    return;
+  }
+
+  program_ = util::CreateProgram(kVertexShader, kFragmentShader);
+  if (program_ == 0) {
+    LOGE("CameraLuminance: could not create the program");
+    return;
+  }
+  vertex_location_ = glGetAttribLocation(program_, "vertex");
+  camera_location_ = glGetUniformLocation(program_, "camera");
+  texel_size_location_ = glGetUniformLocation(program_, "texel_size");
+  glGenBuffers(1, &vertex_buffer_);
+  GlState::BindBuffer(GL_ARRAY_BUFFER, vertex_buffer_);
+  CountUpload(sizeof(kVertices));
+  glBufferData(GL_ARRAY_BUFFER, sizeof(kVertices), kVertices, GL_STATIC_DRAW);
+  GlState::BindBuffer(GL_ARRAY_BUFFER, 0);
+
+  // The buffers are sized by the first image they read.
+  readbacks_.resize(kReadbackCount);
+  for (Readback& readback : readbacks_) {
+    glGenBuffers(1, &readback.buffer);
+    readback.capacity = 0;
+    readback.fence = NULL;
+  }
+  next_readback_ = 0;
+  is_supported_ = true;
+  util::CheckGlError("CameraLuminance::InitializeGl");
+}
+
+bool CameraLuminance::InitializeFramebuffer() {
+  const int texture_width = width_ / kPixelsPerTexel;
+  if (framebuffer_ != 0 && texture_width == framebuffer_width_ &&
+      height_ == framebuffer_height_) {
+    return true;
+  }
+  if (framebuffer_ == 0) {
+    glGenFramebuffers(1, &framebuffer_);
+    glGenTextures(1, &framebuffer_texture_);
+  }
+  CountRender(kRenderCounterTextureBinds);
+  glBindTexture(GL_TEXTURE_2D, framebuffer_texture_);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, texture_width, height_, 0, GL_RGBA,
+               GL_UNSIGNED_BYTE, NULL);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                         framebuffer_texture_, 0);
+  const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+  if (status != GL_FRAMEBUFFER_COMPLETE) {
+    LOGE("CameraLuminance: incomplete framebuffer 0x%x", status);
+    framebuffer_width_ = 0;
+    framebuffer_height_ = 0;
+    return false;
+  }
+  framebuffer_width_ = texture_width;
+  framebuffer_height_ = height_;
+  return true;
+}
+
+bool CameraLuminance::Render(GLuint camera_texture, double timestamp) {
+  TANGO_TRACE_SCOPE("CameraLuminance::Render");
+  InitializeGl();
+  if (!is_supported_ || width_ <= 0 || height_ <= 0) {
+    return false;
+  }
+  // Never wait for an image still in flight, this one is dropped instead.
+  Readback& readback = readbacks_[next_readback_];
+  if (readback.fence != NULL) {
+    ++dropped_count_;
+    return false;
+  }
+
+  GLint previous_framebuffer = 0;
+  GLint previous_viewport[4];
+  GLint previous_program = 0;
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous_framebuffer);
+  glGetIntegerv(GL_VIEWPORT, previous_viewport);
+  glGetIntegerv(GL_CURRENT_PROGRAM, &previous_program);
+  bool was_enabled[kDisabledCapabilityCount];
+  for (size_t i = 0; i < kDisabledCapabilityCount; ++i) {
+    was_enabled[i] = glIsEnabled(kDisabledCapabilities[i]) == GL_TRUE;
+    GlState::Disable(kDisabledCapabilities[i]);
+  }
+
+  const bool is_complete = InitializeFramebuffer();
+  if (is_complete) {
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+    glViewport(0, 0, framebuffer_width_, framebuffer_height_);
+    GlState::UseProgram(program_);
+    // The taps rely on bilinear filtering, which the apps usually leave off
+    // for drawing the camera image unscaled.
+    glActiveTexture(GL_TEXTURE0);
+    CountRender(kRenderCounterTextureBinds);
+    glBindTexture(GL_TEXTURE_EXTERNAL_OES, camera_texture);
+    GLint min_filter = GL_NEAREST;
+    GLint mag_filter = GL_NEAREST;
+    glGetTexParameteriv(GL_TEXTURE_EXTERNAL_OES, GL_TEXTURE_MIN_FILTER,
+                        &min_filter);
+    glGetTexParameteriv(GL_TEXTURE_EXTERNAL_OES, GL_TEXTURE_MAG_FILTER,
+                        &mag_filter);
+    glTexParameteri(GL_TEXTURE_EXTERNAL_OES, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_EXTERNAL_OES, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glUniform1i(camera_location_, 0);
+    glUniform2f(texel_size_location_, 1.0f / width_, 1.0f / height_);
+    GlState::BindBuffer(GL_ARRAY_BUFFER, vertex_buffer_);
+    glEnableVertexAttribArray(vertex_location_);
+    glVertexAttribPointer(vertex_location_, 2, GL_FLOAT, GL_FALSE, 0,
+                          nullptr);
+    CountDraw(4);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glDisableVertexAttribArray(vertex_location_);
+    GlState::BindBuffer(GL_ARRAY_BUFFER, 0);
+    glTexParameteri(GL_TEXTURE_EXTERNAL_OES, GL_TEXTURE_MIN_FILTER,
+                    min_filter);
+    glTexParameteri(GL_TEXTURE_EXTERNAL_OES, GL_TEXTURE_MAG_FILTER,
+                    mag_filter);
+    glBindTexture(GL_TEXTURE_EXTERNAL_OES, 0);
+
+    next_readback_ = (next_readback_ + 1) % readbacks_.size();
+    readback.width = width_;
+    readback.height = height_;
+    readback.timestamp = timestamp;
+    // Rows of RGBA texels are 4 byte aligned, the default pack alignment.
+    const GLsizeiptr size = static_cast<GLsizeiptr>(width_) * height_;
+    GlState::BindBuffer(kPixelPackBuffer, readback.buffer);
+    if (readback.capacity < size) {
+      glBufferData(kPixelPackBuffer, size, NULL, kStreamRead);
+      readback.capacity = size;
+    }
+    // With a pack buffer bound, the pixels go to its offset 0 on the GPU.
+    glReadPixels(0, 0, framebuffer_width_, framebuffer_height_, GL_RGBA,
+                 GL_UNSIGNED_BYTE, NULL);
+    GlState::BindBuffer(kPixelPackBuffer, 0);
+    readback.fence =
+        fence_sync_(util::GlCapabilities::kSyncGpuCommandsComplete, 0);
+  }
+
+  glBindFramebuffer(GL_FRAMEBUFFER, previous_framebuffer);
+  glViewport(previous_viewport[0], previous_viewport[1], previous_viewport[2],
+             previous_viewport[3]);
+  GlState::UseProgram(previous_program);
+  for (size_t i = 0; i < kDisabledCapabilityCount; ++i) {
+    if (was_enabled[i]) {
+      GlState::Enable(kDisabledCapabilities[i]);
+    }
+  }
+  util::CheckGlError("CameraLuminance::Render");
+  return is_complete;
+}
+
+int CameraLuminance::ReadFinishedImages(const ImageCallback& callback) {
+  if (!is_supported_) {
+    return 0;
+  }
+  TANGO_TRACE_SCOPE("CameraLuminance::ReadFinishedImages");
+  int read_count = 0;
+  // Read backs finish in order, oldest first, so the later ones are not done
+  // when one is not.
+  for (size_t i = 0; i < readbacks_.size(); ++i) {
+    Readback& readback =
+        readbacks_[(next_readback_ + i) % readbacks_.size()];
+    if (readback.fence == NULL) {
+      continue;
+    }
+    const GLenum status = client_wait_sync_(readback.fence, 0, 0);
+    if (status != util::GlCapabilities::kAlreadySignaled &&
+        status != util::GlCapabilities::kConditionSatisfied) {
+      break;
+    }
+    delete_sync_(readback.fence);
+    readback.fence = NULL;
+
+    const GLsizeiptr size =
+        static_cast<GLsizeiptr>(readback.width) * readback.height;
+    GlState::BindBuffer(kPixelPackBuffer, readback.buffer);
+    const uint8_t* luminance = static_cast<const uint8_t*>(
+        map_buffer_range_(kPixelPackBuffer, 0, size, kMapReadBit));
+    if (luminance != NULL) {
+      callback(luminance, readback.width, readback.height,
+               readback.timestamp);
+      unmap_buffer_(kPixelPackBuffer);
+      ++read_count;
+    }
+    GlState::BindBuffer(kPixelPackBuffer, 0);
+  }
+  util::CheckGlError("CameraLuminance::ReadFinishedImages");
+  return read_count;
+}
+
+void CameraLuminance::DeleteGlResources() {
+  for (Readback& readback : readbacks_) {
+    GlState::DeleteBuffers(1, &readback.buffer);
+    if (readback.fence != NULL) {
+      delete_sync_(readback.fence);
+    }
+  }
+  if (framebuffer_ != 0) {
+    glDeleteFramebuffers(1, &framebuffer_);
+    glDeleteTextures(1, &framebuffer_texture_);
+  }
+  if (program_ != 0) {
+    GlState::DeleteProgram(program_);
+    GlState::DeleteBuffers(1, &vertex_buffer_);
+  }
+  InvalidateGlResources();
+}
+
+void CameraLuminance::InvalidateGlResources() {
+  readbacks_.clear();
+  next_readback_ = 0;
+  program_ = 0;
+  vertex_buffer_ = 0;
+  framebuffer_ = 0;
+  framebuffer_texture_ = 0;
+  framebuffer_width_ = 0;
+  framebuffer_height_ = 0;
+  gl_initialized_ = false;
+  is_supported_ = false;
+}
+}  // namespace tango_gl
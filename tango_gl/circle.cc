@@ -17,20 +17,22 @@
 #include "tango-gl/circle.h"
 
 namespace tango_gl {
-Circle::Circle(float radius, int resolution) : Mesh(GL_TRIANGLE_FAN) {
-  SetShader();
-  std::vector<GLfloat> vertices;
-  vertices.reserve(3 * (resolution + 2));
-  vertices.push_back(0);
-  vertices.push_back(0);
-  vertices.push_back(0);
+
+// A fan of |resolution| triangles around the origin, of radius 1.
+static void GenerateUnitCircle(int resolution,
+                               std::vector<glm::vec3>* vertices) {
+  vertices->reserve(resolution + 2);
+  vertices->push_back(glm::vec3(0.0f, 0.0f, 0.0f));
   float delta_theta = M_PI * 2.0f / static_cast<float>(resolution);
   for (int i = resolution; i >= 0; i--) {
     float theta = delta_theta * static_cast<float>(i);
-    vertices.push_back(cos(theta) * radius);
-    vertices.push_back(0);
-    vertices.push_back(sin(theta) * radius);
+    vertices->push_back(glm::vec3(cos(theta), 0.0f, sin(theta)));
   }
-  SetVertices(vertices);
+}
+
+Circle::Circle(float radius, int resolution) : Mesh(GL_TRIANGLE_FAN) {
+  SetShader();
+  SetSharedVertices(&GenerateUnitCircle, resolution);
+  SetScale(glm::vec3(radius, 1.0f, radius));
 }
 }  // namespace tango_gl
@@ -19,29 +19,14 @@
 namespace tango_gl {
 namespace conversions {
 
-glm::mat4 opengl_world_T_tango_world() {
-  // Note glm is column-wise.
-  return glm::mat4(1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 0.0f, 0.0f, 1.0f,
-                   0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f);
-}
-
-glm::mat4 color_camera_T_opengl_camera() {
-  // Note glm is column-wise.
-  return glm::mat4(1.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f,
-                   -1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f);
-}
-
-glm::mat4 depth_camera_T_opengl_camera() {
-  // Note glm is column-wise.
-  return glm::mat4(1.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f,
-                   -1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f);
-}
-
 glm::quat QuatTangoToGl(const glm::quat& tango_q_frame) {
-  const float kSqrt2Over2 = std::sqrt(2.0) / 2.0f;
-  // Tango frame is a -90 degree rotation about +X from the GL frame.
-  glm::quat gl_q_tango = glm::quat(kSqrt2Over2, -kSqrt2Over2, 0.0f, 0.0f);
-  return gl_q_tango * tango_q_frame;
+  // Tango frame is a -90 degree rotation about +X from the GL frame, the
+  // quaternion (w, x, y, z) = (sqrt(2) / 2, -sqrt(2) / 2, 0, 0). Its product
+  // with another quaternion reduces to sums and differences of components.
+  constexpr float kSqrt2Over2 = 0.70710678f;
+  const glm::quat& q = tango_q_frame;
+  return glm::quat(kSqrt2Over2 * (q.w + q.x), kSqrt2Over2 * (q.x - q.w),
+                   kSqrt2Over2 * (q.y + q.z), kSqrt2Over2 * (q.z - q.y));
 }
 
 }  // namespace conversions
@@ -0,0 +1,141 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "tango-gl/depth_occluder.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "tango-gl/gl_state.h"
+#include "tango-gl/render_statistics.h"
+
+namespace {
+// The depth camera resolves about this many rows over the height of the
+// color camera image, which a splat of 1 / kDepthRows of the viewport
+// height covers without holes.
+const float kDepthRows = 120.0f;
+
+// Splats are pushed back by this many meters, about the noise of the depth
+// camera, so that the virtual objects resting on a real surface are not
+// hidden by it.
+const float kDepthBias = 0.05f;
+
+// The largest splat every GPU we run on rasterizes, in pixels.
+const float kMaxPointSize = 16.0f;
+
+// The points are uploaded quantized, see tango_gl::QuantizedPoints.
+const char kOccluderVertexShader[] =
+    "attribute highp vec4 vertex;\n"
+    "uniform highp mat4 projection;\n"
+    "uniform highp mat4 modelview;\n"
+    "uniform float point_size;\n"
+    "uniform float depth_bias;\n"
+    TANGO_GL_GLSL_DEQUANTIZE_POINT
+    "void main() {\n"
+    "  highp vec4 position = modelview * DequantizePoint(vertex);\n"
+    "  position.xyz *= 1.0 + depth_bias / max(length(position.xyz), 0.001);\n"
+    "  gl_Position = projection * position;\n"
+    "  gl_PointSize = point_size;\n"
+    "}\n";
+
+// The color writes are masked, only the depth is kept.
+const char kOccluderFragmentShader[] =
+    "precision mediump float;\n"
+    "void main() {\n"
+    "  gl_FragColor = vec4(0.0);\n"
+    "}\n";
+}  // namespace
+
+namespace tango_gl {
+
+DepthOccluder::DepthOccluder() : point_budget_(0) {
+  const util::SharedProgram* program = util::GetSharedProgram(
+      kOccluderVertexShader, kOccluderFragmentShader);
+  program_ = program ? program->GetId() : 0;
+  if (!program_) {
+    LOGE("DepthOccluder: Could not create program.");
+  }
+  attrib_vertices_ = program ? program->GetAttribLocation("vertex") : -1;
+  uniform_projection_mat_ =
+      program ? program->GetUniformLocation("projection") : -1;
+  uniform_modelview_mat_ =
+      program ? program->GetUniformLocation("modelview") : -1;
+  uniform_point_size_ =
+      program ? program->GetUniformLocation("point_size") : -1;
+  uniform_point_scale_ =
+      program ? program->GetUniformLocation("point_scale") : -1;
+  uniform_point_offset_ =
+      program ? program->GetUniformLocation("point_offset") : -1;
+  if (program_) {
+    GlState::UseProgram(program_);
+    glUniform1f(program->GetUniformLocation("depth_bias"), kDepthBias);
+    GlState::UseProgram(0);
+  }
+}
+
+DepthOccluder::~DepthOccluder() { vertex_buffer_.DeleteGlResources(); }
+
+void DepthOccluder::UpdatePoints(const float* xyz, int count) {
+  points_.Quantize(xyz, count);
+  // Any prefix of the shuffled points is an even subsample of the cloud.
+  points_.Shuffle();
+  vertex_buffer_.Update(points_.GetData(), points_.GetSize());
+  GlState::BindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void DepthOccluder::Render(const glm::mat4& projection_mat,
+                           const glm::mat4& view_mat,
+                           const glm::mat4& world_T_depth_camera,
+                           int viewport_height) const {
+  const int count = points_.GetCount();
+  if (!program_ || count == 0 || attrib_vertices_ < 0) {
+    return;
+  }
+  const int draw_count =
+      point_budget_ > 0 ? std::min(count, point_budget_) : count;
+  // A subsample of 1 / n of the points covers as much with splats sqrt(n)
+  // times wider.
+  const float point_size = std::min(
+      std::max(viewport_height / kDepthRows, 1.0f) *
+          std::sqrt(static_cast<float>(count) / draw_count),
+      kMaxPointSize);
+
+  GlState::UseProgram(program_);
+  glUniformMatrix4fv(uniform_projection_mat_, 1, GL_FALSE,
+                     glm::value_ptr(projection_mat));
+  const glm::mat4 modelview_mat = view_mat * world_T_depth_camera;
+  glUniformMatrix4fv(uniform_modelview_mat_, 1, GL_FALSE,
+                     glm::value_ptr(modelview_mat));
+  glUniform1f(uniform_point_size_, point_size);
+  points_.SetUniforms(uniform_point_scale_, uniform_point_offset_);
+
+  vertex_buffer_.Bind();
+  glEnableVertexAttribArray(attrib_vertices_);
+  QuantizedPoints::SetVertexAttribPointer(attrib_vertices_, 1);
+
+  glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+  GlState::DepthMask(GL_TRUE);
+  CountDraw(draw_count);
+  glDrawArrays(GL_POINTS, 0, draw_count);
+  glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+  glDisableVertexAttribArray(attrib_vertices_);
+  GlState::BindBuffer(GL_ARRAY_BUFFER, 0);
+  util::CheckGlError("DepthOccluder::Render");
+}
+
+}  // namespace tango_gl
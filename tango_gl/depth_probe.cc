@@ -0,0 +1,824 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-gl/depth_probe.h"
+
+#include <algorithm>
+
+#include "tango-gl/gl_state.h"
+#include "tango-gl/render_statistics.h"
+#include "tango-gl/tracing.h"
+
+namespace {
+// GLES 3.0 enums, which gl2.h does not define.
+const GLenum kPixelPackBuffer = 0x88EB;
+const GLenum kStreamRead = 0x88E1;
+const GLbitfield kMapReadBit = 0x0001;
+
+// Side of the texels read back around a queried pixel.
+const int kNeighborhoodSize =
+    2 * tango_gl::DepthProbe::kNeighborhoodRadius + 1;
+
+// Bytes of a read back, the whole neighborhood of RGBA texels.
+const GLsizeiptr kReadbackSize = kNeighborhoodSize * kNeighborhoodSize * 4;
+
+// Millimeters per meter of the encoded depth.
+const float kDepthScale = 1000.0f;
+
+// Row y of the framebuffer is row y of the image from the top, as for
+// CameraLuminance, so a pixel is read where it is. Points behind the camera
+// are moved out of the clip volume, and the depth test only resolves the
+// points closer than 16 meters.
+const char kVertexShader[] =
+    "attribute vec3 vertex;\n"
+    "uniform mat4 camera_T_points;\n"
+    "uniform vec4 intrinsics;\n"
+    "uniform vec2 size;\n"
+    "uniform float point_size;\n"
+    "varying float depth;\n"
+    "void main() {\n"
+    "  vec4 point = camera_T_points * vec4(vertex, 1.0);\n"
+    "  depth = point.z;\n"
+    "  gl_PointSize = point_size;\n"
+    "  if (point.z <= 0.0) {\n"
+    "    gl_Position = vec4(2.0, 2.0, 2.0, 1.0);\n"
+    "    return;\n"
+    "  }\n"
+    "  vec2 pixel = intrinsics.xy * point.xy / point.z + intrinsics.zw;\n"
+    "  gl_Position = vec4(2.0 * pixel / size - 1.0,\n"
+    "                     2.0 * point.z / 16.0 - 1.0, 1.0);\n"
+    "}\n";
+
+// The depth in millimeters, the high byte in red and the low one in green. 0
+// is the clear color, no point.
+const char kFragmentShader[] =
+    "precision highp float;\n"
+    "varying float depth;\n"
+    "void main() {\n"
+    "  float millimeters = clamp(floor(depth * 1000.0 + 0.5), 1.0, 65535.0);\n"
+    "  float high = floor(millimeters / 256.0);\n"
+    "  gl_FragColor = vec4(high / 255.0,\n"
+    "                      (millimeters - high * 256.0) / 255.0, 0.0, 1.0);\n"
+    "}\n";
+
+// Draws every texel of the edge map.
+const char kEdgeVertexShader[] =
+    "attribute vec4 vertex;\n"
+    "void main() {\n"
+    "  gl_Position = vertex;\n"
+    "}\n";
+
+// Each texel of the edge map looks at the depth under its center, and 2
+// texels of the map away from it in the 4 directions through it. It is a
+// jump when the depth of a neighbor is more than 5% farther, which leaves
+// the texels on the far side of it out, and a fold when the inverse depths
+// of two opposite neighbors are more than 1.2% off the line through it. The
+// depth is read as splatted, and written, as millimeters in red and green
+// for an edge, 0 otherwise. Texels without a point are not compared.
+const char kEdgeFragmentShader[] =
+    "precision highp float;\n"
+    "uniform sampler2D depth;\n"
+    "uniform float scale;\n"
+    "uniform vec2 texel;\n"
+    "vec4 Sample(vec2 offset) {\n"
+    "  vec2 pixel = floor((gl_FragCoord.xy + offset) * scale) + 0.5;\n"
+    "  return texture2D(depth, pixel * texel);\n"
+    "}\n"
+    "float InverseDepth(vec2 offset) {\n"
+    "  vec4 color = Sample(offset);\n"
+    "  float millimeters = color.r * 65280.0 + color.g * 255.0;\n"
+    "  return millimeters > 0.5 ? 1000.0 / millimeters : 0.0;\n"
+    "}\n"
+    "bool IsEdge(vec2 direction, float center) {\n"
+    "  float a = InverseDepth(2.0 * direction);\n"
+    "  float b = InverseDepth(-2.0 * direction);\n"
+    "  bool is_jump_a = a > 0.0 && a * 1.05 < center;\n"
+    "  bool is_jump_b = b > 0.0 && b * 1.05 < center;\n"
+    "  if (is_jump_a || is_jump_b) {\n"
+    "    return true;\n"
+    "  }\n"
+    "  if (a == 0.0 || b == 0.0 || center * 1.05 < max(a, b)) {\n"
+    "    return false;\n"
+    "  }\n"
+    "  return abs(a + b - 2.0 * center) > 0.012 * center;\n"
+    "}\n"
+    "void main() {\n"
+    "  float center = InverseDepth(vec2(0.0));\n"
+    "  if (center == 0.0 ||\n"
+    "      !(IsEdge(vec2(1.0, 0.0), center) ||\n"
+    "        IsEdge(vec2(0.0, 1.0), center) ||\n"
+    "        IsEdge(vec2(1.0, 1.0), center) ||\n"
+    "        IsEdge(vec2(1.0, -1.0), center))) {\n"
+    "    gl_FragColor = vec4(0.0);\n"
+    "    return;\n"
+    "  }\n"
+    "  gl_FragColor = vec4(Sample(vec2(0.0)).rg, 0.0, 1.0);\n"
+    "}\n";
+
+// Edge maps in flight at most, the previous one being read while the next
+// one is drawn.
+const int kEdgeReadbackCount = 2;
+
+// Capabilities the splat turns off, and restores after it.
+const GLenum kDisabledCapabilities[] = {GL_BLEND, GL_CULL_FACE,
+                                        GL_SCISSOR_TEST, GL_STENCIL_TEST};
+const size_t kDisabledCapabilityCount =
+    sizeof(kDisabledCapabilities) / sizeof(kDisabledCapabilities[0]);
+
+// The GL state the queries change, restored after them.
+struct SavedState {
+  GLint framebuffer;
+  GLint viewport[4];
+  GLint program;
+  GLfloat clear_color[4];
+  GLint depth_func;
+  GLboolean depth_mask;
+  bool was_depth_test_enabled;
+  bool was_enabled[kDisabledCapabilityCount];
+};
+
+// Save the state into |state|, and turn off the capabilities the splat does
+// not use.
+void SaveState(SavedState* state) {
+  state->framebuffer = 0;
+  state->program = 0;
+  state->depth_func = GL_LESS;
+  state->depth_mask = GL_TRUE;
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &state->framebuffer);
+  glGetIntegerv(GL_VIEWPORT, state->viewport);
+  glGetIntegerv(GL_CURRENT_PROGRAM, &state->program);
+  glGetFloatv(GL_COLOR_CLEAR_VALUE, state->clear_color);
+  glGetIntegerv(GL_DEPTH_FUNC, &state->depth_func);
+  glGetBooleanv(GL_DEPTH_WRITEMASK, &state->depth_mask);
+  state->was_depth_test_enabled = glIsEnabled(GL_DEPTH_TEST) == GL_TRUE;
+  for (size_t i = 0; i < kDisabledCapabilityCount; ++i) {
+    state->was_enabled[i] = glIsEnabled(kDisabledCapabilities[i]) == GL_TRUE;
+    tango_gl::GlState::Disable(kDisabledCapabilities[i]);
+  }
+}
+
+void RestoreState(const SavedState& state) {
+  glBindFramebuffer(GL_FRAMEBUFFER, state.framebuffer);
+  glViewport(state.viewport[0], state.viewport[1], state.viewport[2],
+             state.viewport[3]);
+  tango_gl::GlState::UseProgram(state.program);
+  glClearColor(state.clear_color[0], state.clear_color[1],
+               state.clear_color[2], state.clear_color[3]);
+  tango_gl::GlState::DepthFunc(state.depth_func);
+  tango_gl::GlState::DepthMask(state.depth_mask);
+  if (state.was_depth_test_enabled) {
+    tango_gl::GlState::Enable(GL_DEPTH_TEST);
+  } else {
+    tango_gl::GlState::Disable(GL_DEPTH_TEST);
+  }
+  for (size_t i = 0; i < kDisabledCapabilityCount; ++i) {
+    if (state.was_enabled[i]) {
+      tango_gl::GlState::Enable(kDisabledCapabilities[i]);
+    }
+  }
+}
+}  // namespace
+
+namespace tango_gl {
+
+const int DepthProbe::kNeighborhoodRadius;
+const int DepthProbe::kEdgeMapDownscale;
+
+DepthProbe::DepthProbe(int max_queries)
+    : max_queries_(std::max(max_queries, 1)),
+      width_(0),
+      height_(0),
+      fx_(0.0f),
+      fy_(0.0f),
+      cx_(0.0f),
+      cy_(0.0f),
+      point_size_(1.0f),
+      camera_T_points_(1.0f),
+      points_timestamp_(0.0),
+      is_splat_stale_(true),
+      gl_initialized_(false),
+      is_supported_(false),
+      map_buffer_range_(NULL),
+      unmap_buffer_(NULL),
+      fence_sync_(NULL),
+      client_wait_sync_(NULL),
+      delete_sync_(NULL),
+      program_(0),
+      vertex_location_(-1),
+      camera_T_points_location_(-1),
+      intrinsics_location_(-1),
+      size_location_(-1),
+      point_size_location_(-1),
+      vertex_buffer_(0),
+      point_count_(0),
+      framebuffer_(0),
+      framebuffer_texture_(0),
+      depth_renderbuffer_(0),
+      framebuffer_width_(0),
+      framebuffer_height_(0),
+      next_readback_(0),
+      dropped_count_(0),
+      edge_program_(0),
+      edge_depth_location_(-1),
+      edge_scale_location_(-1),
+      edge_texel_location_(-1),
+      edge_framebuffer_(0),
+      edge_texture_(0),
+      edge_width_(0),
+      edge_height_(0),
+      next_edge_readback_(0) {
+  edge_map_.buffer = 0;
+  edge_map_.fence = NULL;
+  edge_map_.width = 0;
+  edge_map_.height = 0;
+  edge_map_.fx = 0.0f;
+  edge_map_.fy = 0.0f;
+  edge_map_.cx = 0.0f;
+  edge_map_.cy = 0.0f;
+  edge_map_.timestamp = 0.0;
+}
+
+DepthProbe::~DepthProbe() {}
+
+void DepthProbe::SetCamera(int width, int height, float fx, float fy,
+                           float cx, float cy) {
+  width_ = std::max(width, 0);
+  height_ = std::max(height, 0);
+  fx_ = fx;
+  fy_ = fy;
+  cx_ = cx;
+  cy_ = cy;
+  is_splat_stale_ = true;
+}
+
+void DepthProbe::SetPointSize(float point_size) {
+  point_size_ = std::max(point_size, 1.0f);
+  is_splat_stale_ = true;
+}
+
+void DepthProbe::SetPoints(const float* xyz, int count, double timestamp) {
+  TANGO_TRACE_SCOPE("DepthProbe::SetPoints");
+  InitializeGl();
+  if (!is_supported_) {
+    return;
+  }
+  point_count_ = std::max(count, 0);
+  points_timestamp_ = timestamp;
+  GlState::BindBuffer(GL_ARRAY_BUFFER, vertex_buffer_);
+  CountUpload(point_count_ * 3 * sizeof(float));
+  glBufferData(GL_ARRAY_BUFFER, point_count_ * 3 * sizeof(float), xyz,
+               GL_STREAM_DRAW);
+  GlState::BindBuffer(GL_ARRAY_BUFFER, 0);
+  is_splat_stale_ = true;
+  util::CheckGlError("DepthProbe::SetPoints");
+}
+
+void DepthProbe::SetCameraTPoints(const glm::mat4& camera_T_points) {
+  if (camera_T_points != camera_T_points_) {
+    camera_T_points_ = camera_T_points;
+    is_splat_stale_ = true;
+  }
+}
+
+void DepthProbe::InitializeGl() {
+  if (gl_initialized_) {
+    return;
+  }
+  gl_initialized_ = true;
+  is_supported_ = false;
+  const util::GlCapabilities& gl = util::GetGlCapabilities();
+  if (!gl.IsGles3()) {
+    LOGI("DepthProbe: pixel pack buffers are not supported");
+    return;
+  }
+  map_buffer_range_ = gl.map_buffer_range;
+  unmap_buffer_ = gl.unmap_buffer;
+  fence_sync_ = gl.fence_sync;
+  client_wait_sync_ = gl.client_wait_sync;
+  delete_sync_ = gl.delete_sync;
+  if (map_buffer_range_ == NULL || unmap_buffer_ == NULL ||
+      fence_sync_ == NULL || client_wait_sync_ == NULL ||
+      delete_sync_ == NULL) {
+    LOGE("DepthProbe: GLES 3.0 entry points are missing");
+    return;
+  }
+
+  program_ = util::CreateProgram(kVertexShader, kFragmentShader);
+  if (program_ == 0) {
+    LOGE("DepthProbe: could not create the program");
+    return;
+  }
+  vertex_location_ = glGetAttribLocation(program_, "vertex");
+  camera_T_points_location_ =
+      glGetUniformLocation(program_, "camera_T_points");
+  intrinsics_location_ = glGetUniformLocation(program_, "intrinsics");
+  size_location_ = glGetUniformLocation(program_, "size");
+  point_size_location_ = glGetUniformLocation(program_, "point_size");
+  glGenBuffers(1, &vertex_buffer_);
+  point_count_ = 0;
+
+  // Every read back is of a whole neighborhood, clamped ones included.
+  readbacks_.resize(max_queries_);
+  for (Readback& readback : readbacks_) {
+    glGenBuffers(1, &readback.buffer);
+    GlState::BindBuffer(kPixelPackBuffer, readback.buffer);
+    glBufferData(kPixelPackBuffer, kReadbackSize, NULL, kStreamRead);
+    readback.fence = NULL;
+  }
+  GlState::BindBuffer(kPixelPackBuffer, 0);
+  next_readback_ = 0;
+  is_splat_stale_ = true;
+  is_supported_ = true;
+  util::CheckGlError("DepthProbe::InitializeGl");
+}
+
+bool DepthProbe::InitializeFramebuffer() {
+  if (framebuffer_ != 0 && width_ == framebuffer_width_ &&
+      height_ == framebuffer_height_) {
+    return true;
+  }
+  if (framebuffer_ == 0) {
+    glGenFramebuffers(1, &framebuffer_);
+    glGenTextures(1, &framebuffer_texture_);
+    glGenRenderbuffers(1, &depth_renderbuffer_);
+  }
+  CountRender(kRenderCounterTextureBinds);
+  glBindTexture(GL_TEXTURE_2D, framebuffer_texture_);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  // The edge map samples it past its borders.
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width_, height_, 0, GL_RGBA,
+               GL_UNSIGNED_BYTE, NULL);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glBindRenderbuffer(GL_RENDERBUFFER, depth_renderbuffer_);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT16, width_,
+                        height_);
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                         framebuffer_texture_, 0);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                            GL_RENDERBUFFER, depth_renderbuffer_);
+  const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+  if (status != GL_FRAMEBUFFER_COMPLETE) {
+    LOGE("DepthProbe: incomplete framebuffer 0x%x", status);
+    framebuffer_width_ = 0;
+    framebuffer_height_ = 0;
+    return false;
+  }
+  framebuffer_width_ = width_;
+  framebuffer_height_ = height_;
+  is_splat_stale_ = true;
+  return true;
+}
+
+void DepthProbe::Splat() {
+  TANGO_TRACE_SCOPE("DepthProbe::Splat");
+  glViewport(0, 0, framebuffer_width_, framebuffer_height_);
+  glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  if (point_count_ > 0) {
+    GlState::UseProgram(program_);
+    glUniformMatrix4fv(camera_T_points_location_, 1, GL_FALSE,
+                       glm::value_ptr(camera_T_points_));
+    glUniform4f(intrinsics_location_, fx_, fy_, cx_, cy_);
+    glUniform2f(size_location_, static_cast<float>(framebuffer_width_),
+                static_cast<float>(framebuffer_height_));
+    glUniform1f(point_size_location_, point_size_);
+    GlState::BindBuffer(GL_ARRAY_BUFFER, vertex_buffer_);
+    glEnableVertexAttribArray(vertex_location_);
+    glVertexAttribPointer(vertex_location_, 3, GL_FLOAT, GL_FALSE, 0,
+                          nullptr);
+    CountDraw(point_count_);
+    glDrawArrays(GL_POINTS, 0, point_count_);
+    glDisableVertexAttribArray(vertex_location_);
+    GlState::BindBuffer(GL_ARRAY_BUFFER, 0);
+  }
+  is_splat_stale_ = false;
+}
+
+bool DepthProbe::BindSplat() {
+  if (!InitializeFramebuffer()) {
+    return false;
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+  if (is_splat_stale_) {
+    // The nearest point of each texel wins.
+    GlState::Enable(GL_DEPTH_TEST);
+    GlState::DepthFunc(GL_LESS);
+    GlState::DepthMask(GL_TRUE);
+    Splat();
+  }
+  return true;
+}
+
+bool DepthProbe::Query(const glm::vec2& uv, int id) {
+  TANGO_TRACE_SCOPE("DepthProbe::Query");
+  InitializeGl();
+  if (!is_supported_ || width_ <= 0 || height_ <= 0) {
+    return false;
+  }
+  // Never wait for a query still in flight, this one is dropped instead.
+  Readback& readback = readbacks_[next_readback_];
+  if (readback.fence != NULL) {
+    ++dropped_count_;
+    return false;
+  }
+
+  SavedState state;
+  SaveState(&state);
+  const bool is_complete = BindSplat();
+  if (is_complete) {
+    // The neighborhood, moved inside the framebuffer at its borders.
+    readback.center_x = std::min(
+        std::max(static_cast<int>(uv.x * framebuffer_width_), 0),
+        framebuffer_width_ - 1);
+    readback.center_y = std::min(
+        std::max(static_cast<int>(uv.y * framebuffer_height_), 0),
+        framebuffer_height_ - 1);
+    readback.width = std::min(kNeighborhoodSize, framebuffer_width_);
+    readback.height = std::min(kNeighborhoodSize, framebuffer_height_);
+    readback.x = std::min(
+        std::max(readback.center_x - kNeighborhoodRadius, 0),
+        framebuffer_width_ - readback.width);
+    readback.y = std::min(
+        std::max(readback.center_y - kNeighborhoodRadius, 0),
+        framebuffer_height_ - readback.height);
+    readback.id = id;
+    readback.uv = uv;
+    readback.points_T_camera = glm::inverse(camera_T_points_);
+    readback.fx = fx_;
+    readback.fy = fy_;
+    readback.cx = cx_;
+    readback.cy = cy_;
+    readback.timestamp = points_timestamp_;
+    next_readback_ = (next_readback_ + 1) % readbacks_.size();
+
+    // Rows of RGBA texels are 4 byte aligned, the default pack alignment.
+    GlState::BindBuffer(kPixelPackBuffer, readback.buffer);
+    glReadPixels(readback.x, readback.y, readback.width, readback.height,
+                 GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    GlState::BindBuffer(kPixelPackBuffer, 0);
+    readback.fence =
+        fence_sync_(util::GlCapabilities::kSyncGpuCommandsComplete, 0);
+  }
+
+  RestoreState(state);
+  util::CheckGlError("DepthProbe::Query");
+  return is_complete;
+}
+
+int DepthProbe::ReadFinishedQueries(const ResultCallback& callback) {
+  if (!is_supported_) {
+    return 0;
+  }
+  TANGO_TRACE_SCOPE("DepthProbe::ReadFinishedQueries");
+  int read_count = 0;
+  // Read backs finish in order, oldest first, so the later ones are not done
+  // when one is not.
+  for (size_t i = 0; i < readbacks_.size(); ++i) {
+    Readback& readback =
+        readbacks_[(next_readback_ + i) % readbacks_.size()];
+    if (readback.fence == NULL) {
+      continue;
+    }
+    const GLenum status = client_wait_sync_(readback.fence, 0, 0);
+    if (status != util::GlCapabilities::kAlreadySignaled &&
+        status != util::GlCapabilities::kConditionSatisfied) {
+      break;
+    }
+    delete_sync_(readback.fence);
+    readback.fence = NULL;
+
+    GlState::BindBuffer(kPixelPackBuffer, readback.buffer);
+    const uint8_t* texels = static_cast<const uint8_t*>(map_buffer_range_(
+        kPixelPackBuffer, 0, readback.width * readback.height * 4,
+        kMapReadBit));
+    if (texels != NULL) {
+      // The texel with a point nearest to the one queried.
+      int nearest_distance = -1;
+      int nearest_x = 0;
+      int nearest_y = 0;
+      uint32_t nearest_millimeters = 0;
+      for (int y = 0; y < readback.height; ++y) {
+        const uint8_t* row = texels + y * readback.width * 4;
+        for (int x = 0; x < readback.width; ++x) {
+          const uint32_t millimeters = (row[x * 4] << 8) | row[x * 4 + 1];
+          if (millimeters == 0) {
+            continue;
+          }
+          const int dx = readback.x + x - readback.center_x;
+          const int dy = readback.y + y - readback.center_y;
+          const int distance = dx * dx + dy * dy;
+          if (nearest_distance < 0 || distance < nearest_distance) {
+            nearest_distance = distance;
+            nearest_x = readback.x + x;
+            nearest_y = readback.y + y;
+            nearest_millimeters = millimeters;
+          }
+        }
+      }
+      unmap_buffer_(kPixelPackBuffer);
+
+      glm::vec3 position(0.0f);
+      const bool is_found = nearest_distance >= 0;
+      if (is_found) {
+        // Back through the center of the texel at its depth.
+        const float depth = nearest_millimeters / kDepthScale;
+        const glm::vec4 camera_point(
+            (nearest_x + 0.5f - readback.cx) / readback.fx * depth,
+            (nearest_y + 0.5f - readback.cy) / readback.fy * depth, depth,
+            1.0f);
+        position = glm::vec3(readback.points_T_camera * camera_point);
+      }
+      callback(readback.id, readback.uv, is_found, position,
+               readback.timestamp);
+      ++read_count;
+    }
+    GlState::BindBuffer(kPixelPackBuffer, 0);
+  }
+  util::CheckGlError("DepthProbe::ReadFinishedQueries");
+  return read_count;
+}
+
+bool DepthProbe::InitializeEdgeMap() {
+  if (edge_program_ == 0) {
+    edge_program_ =
+        util::CreateProgram(kEdgeVertexShader, kEdgeFragmentShader);
+    if (edge_program_ == 0) {
+      LOGE("DepthProbe: could not create the edge program");
+      return false;
+    }
+    edge_depth_location_ = glGetUniformLocation(edge_program_, "depth");
+    edge_scale_location_ = glGetUniformLocation(edge_program_, "scale");
+    edge_texel_location_ = glGetUniformLocation(edge_program_, "texel");
+    edge_quad_.SetAttributeLocations(
+        glGetAttribLocation(edge_program_, "vertex"), -1);
+  }
+  const int width = std::max(
+      (framebuffer_width_ + kEdgeMapDownscale - 1) / kEdgeMapDownscale, 1);
+  const int height = std::max(
+      (framebuffer_height_ + kEdgeMapDownscale - 1) / kEdgeMapDownscale, 1);
+  if (edge_framebuffer_ != 0 && width == edge_width_ &&
+      height == edge_height_) {
+    return true;
+  }
+  if (edge_framebuffer_ == 0) {
+    glGenFramebuffers(1, &edge_framebuffer_);
+    glGenTextures(1, &edge_texture_);
+    edge_readbacks_.resize(kEdgeReadbackCount);
+    for (EdgeReadback& readback : edge_readbacks_) {
+      glGenBuffers(1, &readback.buffer);
+      readback.fence = NULL;
+    }
+    next_edge_readback_ = 0;
+  }
+  CountRender(kRenderCounterTextureBinds);
+  glBindTexture(GL_TEXTURE_2D, edge_texture_);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA,
+               GL_UNSIGNED_BYTE, NULL);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  // The maps in flight are of the previous size, and dropped.
+  for (EdgeReadback& readback : edge_readbacks_) {
+    if (readback.fence != NULL) {
+      delete_sync_(readback.fence);
+      readback.fence = NULL;
+    }
+    GlState::BindBuffer(kPixelPackBuffer, readback.buffer);
+    glBufferData(kPixelPackBuffer, width * height * 4, NULL, kStreamRead);
+  }
+  GlState::BindBuffer(kPixelPackBuffer, 0);
+  glBindFramebuffer(GL_FRAMEBUFFER, edge_framebuffer_);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                         edge_texture_, 0);
+  const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+  if (status != GL_FRAMEBUFFER_COMPLETE) {
+    LOGE("DepthProbe: incomplete edge framebuffer 0x%x", status);
+    edge_width_ = 0;
+    edge_height_ = 0;
+    return false;
+  }
+  edge_width_ = width;
+  edge_height_ = height;
+  return true;
+}
+
+bool DepthProbe::QueryEdgeMap() {
+  TANGO_TRACE_SCOPE("DepthProbe::QueryEdgeMap");
+  InitializeGl();
+  if (!is_supported_ || width_ <= 0 || height_ <= 0) {
+    return false;
+  }
+  if (!edge_readbacks_.empty() &&
+      edge_readbacks_[next_edge_readback_].fence != NULL) {
+    return false;
+  }
+
+  SavedState state;
+  SaveState(&state);
+  const bool is_complete = BindSplat() && InitializeEdgeMap();
+  if (is_complete) {
+    TANGO_TRACE_SCOPE("DepthProbe::DrawEdgeMap");
+    GlState::Disable(GL_DEPTH_TEST);
+    glBindFramebuffer(GL_FRAMEBUFFER, edge_framebuffer_);
+    glViewport(0, 0, edge_width_, edge_height_);
+    GlState::UseProgram(edge_program_);
+    glUniform1i(edge_depth_location_, 0);
+    glUniform1f(edge_scale_location_, static_cast<float>(kEdgeMapDownscale));
+    glUniform2f(edge_texel_location_, 1.0f / framebuffer_width_,
+                1.0f / framebuffer_height_);
+    glActiveTexture(GL_TEXTURE0);
+    CountRender(kRenderCounterTextureBinds);
+    glBindTexture(GL_TEXTURE_2D, framebuffer_texture_);
+    edge_quad_.Draw();
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    EdgeReadback& readback = edge_readbacks_[next_edge_readback_];
+    readback.width = edge_width_;
+    readback.height = edge_height_;
+    readback.points_T_camera = glm::inverse(camera_T_points_);
+    readback.fx = fx_;
+    readback.fy = fy_;
+    readback.cx = cx_;
+    readback.cy = cy_;
+    readback.timestamp = points_timestamp_;
+    next_edge_readback_ = (next_edge_readback_ + 1) % edge_readbacks_.size();
+    GlState::BindBuffer(kPixelPackBuffer, readback.buffer);
+    glReadPixels(0, 0, edge_width_, edge_height_, GL_RGBA, GL_UNSIGNED_BYTE,
+                 NULL);
+    GlState::BindBuffer(kPixelPackBuffer, 0);
+    readback.fence =
+        fence_sync_(util::GlCapabilities::kSyncGpuCommandsComplete, 0);
+  }
+  RestoreState(state);
+  util::CheckGlError("DepthProbe::QueryEdgeMap");
+  return is_complete;
+}
+
+bool DepthProbe::ReadFinishedEdgeMap() {
+  if (!is_supported_ || edge_readbacks_.empty()) {
+    return false;
+  }
+  TANGO_TRACE_SCOPE("DepthProbe::ReadFinishedEdgeMap");
+  // Only the newest finished map is read, the older ones are dropped.
+  EdgeReadback* newest = NULL;
+  for (size_t i = 0; i < edge_readbacks_.size(); ++i) {
+    EdgeReadback& readback =
+        edge_readbacks_[(next_edge_readback_ + i) % edge_readbacks_.size()];
+    if (readback.fence == NULL) {
+      continue;
+    }
+    const GLenum status = client_wait_sync_(readback.fence, 0, 0);
+    if (status != util::GlCapabilities::kAlreadySignaled &&
+        status != util::GlCapabilities::kConditionSatisfied) {
+      break;
+    }
+    delete_sync_(readback.fence);
+    readback.fence = NULL;
+    newest = &readback;
+  }
+  if (newest == NULL) {
+    return false;
+  }
+
+  const size_t texel_count =
+      static_cast<size_t>(newest->width) * newest->height;
+  GlState::BindBuffer(kPixelPackBuffer, newest->buffer);
+  const uint8_t* texels = static_cast<const uint8_t*>(
+      map_buffer_range_(kPixelPackBuffer, 0, texel_count * 4, kMapReadBit));
+  const bool is_read = texels != NULL;
+  if (is_read) {
+    edge_depths_.resize(texel_count);
+    for (size_t i = 0; i < texel_count; ++i) {
+      edge_depths_[i] =
+          static_cast<uint16_t>((texels[i * 4] << 8) | texels[i * 4 + 1]);
+    }
+    unmap_buffer_(kPixelPackBuffer);
+    edge_map_ = *newest;
+  }
+  GlState::BindBuffer(kPixelPackBuffer, 0);
+  util::CheckGlError("DepthProbe::ReadFinishedEdgeMap");
+  return is_read;
+}
+
+bool DepthProbe::FindNearestEdge(const glm::vec2& uv, int radius,
+                                 const glm::vec3& position,
+                                 float max_distance,
+                                 glm::vec3* edge_position) const {
+  if (edge_depths_.empty()) {
+    return false;
+  }
+  const int center_x =
+      std::min(std::max(static_cast<int>(uv.x * edge_map_.width), 0),
+               edge_map_.width - 1);
+  const int center_y =
+      std::min(std::max(static_cast<int>(uv.y * edge_map_.height), 0),
+               edge_map_.height - 1);
+  const int min_x = std::max(center_x - radius, 0);
+  const int max_x = std::min(center_x + radius, edge_map_.width - 1);
+  const int min_y = std::max(center_y - radius, 0);
+  const int max_y = std::min(center_y + radius, edge_map_.height - 1);
+  float nearest_distance = max_distance * max_distance;
+  bool is_found = false;
+  for (int y = min_y; y <= max_y; ++y) {
+    for (int x = min_x; x <= max_x; ++x) {
+      const uint16_t millimeters = edge_depths_[y * edge_map_.width + x];
+      if (millimeters == 0) {
+        continue;
+      }
+      // Back through the center of the texel of the framebuffer the map
+      // sampled, at its depth.
+      const float depth = millimeters / kDepthScale;
+      const float pixel_x = x * kEdgeMapDownscale + kEdgeMapDownscale / 2;
+      const float pixel_y = y * kEdgeMapDownscale + kEdgeMapDownscale / 2;
+      const glm::vec3 point(
+          edge_map_.points_T_camera *
+          glm::vec4((pixel_x + 0.5f - edge_map_.cx) / edge_map_.fx * depth,
+                    (pixel_y + 0.5f - edge_map_.cy) / edge_map_.fy * depth,
+                    depth, 1.0f));
+      const float distance = util::DistanceSquared(point, position);
+      if (distance < nearest_distance) {
+        nearest_distance = distance;
+        *edge_position = point;
+        is_found = true;
+      }
+    }
+  }
+  return is_found;
+}
+
+void DepthProbe::DeleteGlResources() {
+  for (Readback& readback : readbacks_) {
+    GlState::DeleteBuffers(1, &readback.buffer);
+    if (readback.fence != NULL) {
+      delete_sync_(readback.fence);
+    }
+  }
+  if (framebuffer_ != 0) {
+    glDeleteFramebuffers(1, &framebuffer_);
+    glDeleteTextures(1, &framebuffer_texture_);
+    glDeleteRenderbuffers(1, &depth_renderbuffer_);
+  }
+  if (program_ != 0) {
+    GlState::DeleteProgram(program_);
+    GlState::DeleteBuffers(1, &vertex_buffer_);
+  }
+  for (EdgeReadback& readback : edge_readbacks_) {
+    GlState::DeleteBuffers(1, &readback.buffer);
+    if (readback.fence != NULL) {
+      delete_sync_(readback.fence);
+    }
+  }
+  if (edge_framebuffer_ != 0) {
+    glDeleteFramebuffers(1, &edge_framebuffer_);
+    glDeleteTextures(1, &edge_texture_);
+  }
+  if (edge_program_ != 0) {
+    GlState::DeleteProgram(edge_program_);
+  }
+  edge_quad_.DeleteGlResources();
+  InvalidateGlResources();
+}
+
+void DepthProbe::InvalidateGlResources() {
+  readbacks_.clear();
+  next_readback_ = 0;
+  program_ = 0;
+  vertex_buffer_ = 0;
+  point_count_ = 0;
+  framebuffer_ = 0;
+  framebuffer_texture_ = 0;
+  depth_renderbuffer_ = 0;
+  framebuffer_width_ = 0;
+  framebuffer_height_ = 0;
+  is_splat_stale_ = true;
+  gl_initialized_ = false;
+  is_supported_ = false;
+  edge_quad_.InvalidateGlResources();
+  edge_program_ = 0;
+  edge_framebuffer_ = 0;
+  edge_texture_ = 0;
+  edge_width_ = 0;
+  edge_height_ = 0;
+  edge_readbacks_.clear();
+  next_edge_readback_ = 0;
+  edge_depths_.clear();
+}
+}  // namespace tango_gl
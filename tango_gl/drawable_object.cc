@@ -15,25 +15,329 @@
  */
 
 #include "tango-gl/drawable_object.h"
+
+#include <algorithm>
+
+#include "tango-gl/gl_state.h"
+#include "tango-gl/render_statistics.h"
 #include "tango-gl/shaders.h"
+#include "tango-gl/tracing.h"
+
+namespace {
+// Initial capacity, in vertices, of a buffer set with
+// UpdateGrowingVertexBuffer().
+const GLsizei kMinGrowingVertexCount = 256;
+
+// Offset of the normals in the vertices that have one.
+const size_t kNormalOffset = 3 * sizeof(GLfloat);
+}  // namespace
 
 namespace tango_gl {
 
+DrawableObject::DrawableObject()
+    : red_(0),
+      green_(0),
+      blue_(0),
+      alpha_(1.0f),
+      vertex_buffer_(0),
+      index_buffer_(0),
+      vertex_buffers_dirty_(true),
+      vertex_buffer_usage_(GL_STATIC_DRAW),
+      vertex_buffer_capacity_(0),
+      changed_vertex_begin_(0),
+      buffer_vertex_count_(0),
+      buffer_written_vertex_count_(0),
+      buffer_vertex_stride_(0),
+      buffer_has_normals_(false),
+      buffer_normal_offset_(kNormalOffset),
+      buffer_index_count_(0),
+      buffer_index_type_(GL_UNSIGNED_SHORT),
+      vertex_buffer_memory_(kMemoryTagVertexBuffer, kMemoryGpu),
+      index_buffer_memory_(kMemoryTagVertexBuffer, kMemoryGpu),
+      shared_generator_(NULL),
+      shared_parameter_(0),
+      shared_generation_(0),
+      vertex_array_(0) {
+  vertex_array_layout_.stride = 0;
+}
+
 void DrawableObject::SetShader() {
-  shader_program_ =
-      util::CreateProgram(shaders::GetBasicVertexShader().c_str(),
-                          shaders::GetBasicFragmentShader().c_str());
-  if (!shader_program_) {
+  const util::SharedProgram* program =
+      util::GetSharedProgram(shaders::GetBasicVertexShader().c_str(),
+                             shaders::GetBasicFragmentShader().c_str());
+  if (!program) {
     LOGE("Could not create program.");
+    shader_program_ = 0;
+    return;
   }
-  uniform_mvp_mat_ = glGetUniformLocation(shader_program_, "mvp");
-  attrib_vertices_ = glGetAttribLocation(shader_program_, "vertex");
-  uniform_color_ = glGetUniformLocation(shader_program_, "color");
+  shader_program_ = program->GetId();
+  uniform_mvp_mat_ = program->GetUniformLocation("mvp");
+  attrib_vertices_ = program->GetAttribLocation("vertex");
+  uniform_color_ = program->GetUniformLocation("color");
 }
 
 void DrawableObject::DeleteGlResources() {
-  if (shader_program_) {
-    glDeleteShader(shader_program_);
+  // The program is shared with other objects and owned by
+  // util::GetSharedProgram().
+  shader_program_ = 0;
+  // A shared buffer is owned by util::GetSharedVertexBuffer().
+  if (vertex_buffer_ && !HasSharedVertices()) {
+    GlState::DeleteBuffers(1, &vertex_buffer_);
+  }
+  vertex_buffer_ = 0;
+  vertex_buffer_memory_.Set(0);
+  if (index_buffer_) {
+    GlState::DeleteBuffers(1, &index_buffer_);
+    index_buffer_ = 0;
+  }
+  index_buffer_memory_.Set(0);
+  if (vertex_array_) {
+    util::GetGlCapabilities().delete_vertex_arrays(1, &vertex_array_);
+    vertex_array_ = 0;
+  }
+  vertex_array_layout_.stride = 0;
+  vertex_buffer_capacity_ = 0;
+  vertex_buffers_dirty_ = true;
+}
+
+void DrawableObject::UploadVertexBuffer(const void* data,
+                                        GLsizei vertex_count,
+                                        GLsizei stride) const {
+  TANGO_TRACE_SCOPE("DrawableObject::UploadVertexBuffer");
+  if (!vertex_buffer_) {
+    glGenBuffers(1, &vertex_buffer_);
+  }
+  GlState::BindBuffer(GL_ARRAY_BUFFER, vertex_buffer_);
+  CountUpload(vertex_count * stride);
+  glBufferData(GL_ARRAY_BUFFER, vertex_count * stride, data,
+               vertex_buffer_usage_);
+  GlState::BindBuffer(GL_ARRAY_BUFFER, 0);
+  vertex_buffer_memory_.Set(vertex_count * stride);
+  buffer_vertex_count_ = vertex_count;
+  buffer_written_vertex_count_ = vertex_count;
+  buffer_vertex_stride_ = stride;
+  buffer_has_normals_ = false;
+  buffer_normal_offset_ = kNormalOffset;
+  buffer_index_count_ = 0;
+  // Data uploaded more than once is likely to change again.
+  vertex_buffer_usage_ = GL_DYNAMIC_DRAW;
+  vertex_buffer_capacity_ = vertex_count;
+  changed_vertex_begin_ = vertex_count;
+  vertex_buffers_dirty_ = false;
+}
+
+void DrawableObject::UpdateGrowingVertexBuffer(const void* data,
+                                               GLsizei vertex_count,
+                                               GLsizei stride) const {
+  TANGO_TRACE_SCOPE("DrawableObject::UpdateGrowingVertexBuffer");
+  GLsizei first_vertex =
+      vertex_buffers_dirty_ || stride != buffer_vertex_stride_
+          ? 0
+          : std::min(changed_vertex_begin_, buffer_vertex_count_);
+  if (vertex_buffer_ && first_vertex >= vertex_count &&
+      vertex_count == buffer_vertex_count_) {
+    return;
+  }
+
+  if (!vertex_buffer_) {
+    glGenBuffers(1, &vertex_buffer_);
+    vertex_buffer_capacity_ = 0;
+  }
+  GlState::BindBuffer(GL_ARRAY_BUFFER, vertex_buffer_);
+  if (vertex_count > vertex_buffer_capacity_ ||
+      stride != buffer_vertex_stride_) {
+    // Leave room for the path to grow, and reupload what is kept.
+    vertex_buffer_capacity_ =
+        std::max(vertex_count, std::max<GLsizei>(2 * vertex_buffer_capacity_,
+                                                 kMinGrowingVertexCount));
+    glBufferData(GL_ARRAY_BUFFER, vertex_buffer_capacity_ * stride, nullptr,
+                 GL_DYNAMIC_DRAW);
+    vertex_buffer_memory_.Set(vertex_buffer_capacity_ * stride);
+    buffer_written_vertex_count_ = 0;
+    first_vertex = 0;
+  }
+  if (first_vertex < vertex_count) {
+    const GLintptr offset = first_vertex * stride;
+    const GLsizeiptr size = (vertex_count - first_vertex) * stride;
+    const char* changed_data = static_cast<const char*>(data) + offset;
+    CountUpload(size);
+    // The vertices appended to the path since the last frame are written
+    // without syncing with the draws of the earlier ones.
+    if (first_vertex >= buffer_written_vertex_count_) {
+      util::WriteUnusedBufferRange(GL_ARRAY_BUFFER, offset, size,
+                                   changed_data);
+    } else {
+      glBufferSubData(GL_ARRAY_BUFFER, offset, size, changed_data);
+    }
+    buffer_written_vertex_count_ =
+        std::max(buffer_written_vertex_count_, vertex_count);
+  }
+  GlState::BindBuffer(GL_ARRAY_BUFFER, 0);
+
+  buffer_vertex_count_ = vertex_count;
+  buffer_vertex_stride_ = stride;
+  buffer_has_normals_ = false;
+  buffer_normal_offset_ = kNormalOffset;
+  buffer_index_count_ = 0;
+  changed_vertex_begin_ = vertex_count;
+  vertex_buffers_dirty_ = false;
+}
+
+void DrawableObject::SetSharedVertices(util::GeometryGenerator generate,
+                                       int parameter) {
+  vertices_.clear();
+  normals_.clear();
+  indices_.clear();
+  if (vertex_buffer_ && !HasSharedVertices()) {
+    GlState::DeleteBuffers(1, &vertex_buffer_);
+  }
+  vertex_buffer_ = 0;
+  vertex_buffer_memory_.Set(0);
+  shared_generator_ = generate;
+  shared_parameter_ = parameter;
+}
+
+void DrawableObject::UpdateSharedVertexBuffer() const {
+  if (vertex_buffer_ &&
+      shared_generation_ == util::GetSharedVertexBufferGeneration()) {
+    return;
+  }
+  const util::SharedVertexBuffer& buffer =
+      util::GetSharedVertexBuffer(shared_generator_, shared_parameter_);
+  shared_generation_ = util::GetSharedVertexBufferGeneration();
+  vertex_buffer_ = buffer.id;
+  buffer_vertex_count_ = buffer.vertex_count;
+  buffer_vertex_stride_ = sizeof(glm::vec3);
+  buffer_has_normals_ = false;
+  buffer_normal_offset_ = kNormalOffset;
+  buffer_index_count_ = 0;
+  vertex_buffers_dirty_ = false;
+}
+
+void DrawableObject::UpdateVertexBuffers() const {
+  if (HasSharedVertices()) {
+    UpdateSharedVertexBuffer();
+    return;
+  }
+  if (!vertex_buffers_dirty_) {
+    return;
+  }
+  const GLsizei vertex_count = vertices_.size() / 3;
+  const bool has_normals =
+      !normals_.empty() && normals_.size() == vertices_.size();
+  if (has_normals) {
+    std::vector<GLfloat> interleaved;
+    interleaved.reserve(vertices_.size() * 2);
+    for (size_t i = 0; i < vertices_.size(); i += 3) {
+      interleaved.insert(interleaved.end(), &vertices_[i], &vertices_[i] + 3);
+      interleaved.insert(interleaved.end(), &normals_[i], &normals_[i] + 3);
+    }
+    UploadVertexBuffer(interleaved.data(), vertex_count,
+                       6 * sizeof(GLfloat));
+  } else {
+    UploadVertexBuffer(vertices_.data(), vertex_count, 3 * sizeof(GLfloat));
+  }
+  buffer_has_normals_ = has_normals;
+
+  buffer_index_count_ = indices_.size();
+  buffer_index_type_ = GL_UNSIGNED_SHORT;
+  if (!indices_.empty()) {
+    if (!index_buffer_) {
+      glGenBuffers(1, &index_buffer_);
+    }
+    GlState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer_);
+    CountUpload(indices_.size() * sizeof(GLushort));
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices_.size() * sizeof(GLushort),
+                 indices_.data(), GL_STATIC_DRAW);
+    GlState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    index_buffer_memory_.Set(indices_.size() * sizeof(GLushort));
+  }
+  util::CheckGlError("DrawableObject::UpdateVertexBuffers");
+}
+
+void DrawableObject::BindVertexAttributes(bool use_normals) const {
+  const util::GlCapabilities& gl = util::GetGlCapabilities();
+  if (!gl.HasVertexArrays()) {
+    SetUpVertexAttributes(use_normals);
+    if (buffer_index_count_ > 0) {
+      GlState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer_);
+    }
+    return;
+  }
+
+  VertexArrayLayout layout;
+  layout.vertex_buffer = vertex_buffer_;
+  layout.index_buffer = buffer_index_count_ > 0 ? index_buffer_ : 0;
+  layout.stride = buffer_vertex_stride_;
+  layout.normal_offset = buffer_normal_offset_;
+  layout.vertices = attrib_vertices_;
+  layout.normals = attrib_normals_;
+  layout.use_normals = use_normals;
+  const VertexArrayLayout& recorded = vertex_array_layout_;
+  const bool is_recorded =
+      recorded.stride != 0 && recorded.vertex_buffer == layout.vertex_buffer &&
+      recorded.index_buffer == layout.index_buffer &&
+      recorded.stride == layout.stride &&
+      recorded.vertices == layout.vertices &&
+      recorded.use_normals == layout.use_normals &&
+      (!use_normals || (recorded.normals == layout.normals &&
+                        recorded.normal_offset == layout.normal_offset));
+
+  if (!vertex_array_) {
+    gl.gen_vertex_arrays(1, &vertex_array_);
+  }
+  gl.bind_vertex_array(vertex_array_);
+  if (is_recorded) {
+    return;
+  }
+  // The array keeps the attributes it enabled before.
+  if (recorded.stride != 0) {
+    glDisableVertexAttribArray(recorded.vertices);
+    if (recorded.use_normals) {
+      glDisableVertexAttribArray(recorded.normals);
+    }
+  }
+  SetUpVertexAttributes(use_normals);
+  GlState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, layout.index_buffer);
+  vertex_array_layout_ = layout;
+  util::CheckGlError("DrawableObject::BindVertexAttributes");
+}
+
+void DrawableObject::UnbindVertexAttributes(bool use_normals) const {
+  if (vertex_array_) {
+    util::GetGlCapabilities().bind_vertex_array(0);
+  } else {
+    if (buffer_index_count_ > 0) {
+      GlState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    }
+    glDisableVertexAttribArray(attrib_vertices_);
+    if (use_normals) {
+      glDisableVertexAttribArray(attrib_normals_);
+    }
+  }
+  GlState::BindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void DrawableObject::SetUpVertexAttributes(bool use_normals) const {
+  glEnableVertexAttribArray(attrib_vertices_);
+  if (use_normals) {
+    glEnableVertexAttribArray(attrib_normals_);
+  }
+  PointVertexAttributes(0, use_normals);
+}
+
+void DrawableObject::PointVertexAttributes(GLsizei first_vertex,
+                                           bool use_normals) const {
+  const size_t offset = static_cast<size_t>(first_vertex) *
+                        buffer_vertex_stride_;
+  GlState::BindBuffer(GL_ARRAY_BUFFER, vertex_buffer_);
+  glVertexAttribPointer(attrib_vertices_, 3, GL_FLOAT, GL_FALSE,
+                        buffer_vertex_stride_,
+                        reinterpret_cast<const GLvoid*>(offset));
+  if (use_normals) {
+    glVertexAttribPointer(
+        attrib_normals_, 3, GL_FLOAT, GL_FALSE, buffer_vertex_stride_,
+        reinterpret_cast<const GLvoid*>(offset + buffer_normal_offset_));
   }
 }
 
@@ -50,17 +354,20 @@ void DrawableObject::SetAlpha(const float alpha) { alpha_ = alpha; }
 
 void DrawableObject::SetVertices(const std::vector<GLfloat>& vertices) {
   vertices_ = vertices;
+  vertex_buffers_dirty_ = true;
 }
 
 void DrawableObject::SetVertices(const std::vector<GLfloat>& vertices,
                                  const std::vector<GLushort>& indices) {
   vertices_ = vertices;
   indices_ = indices;
+  vertex_buffers_dirty_ = true;
 }
 
 void DrawableObject::SetVertices(const std::vector<GLfloat>& vertices,
                                  const std::vector<GLfloat>& normals) {
   vertices_ = vertices;
   normals_ = normals;
+  vertex_buffers_dirty_ = true;
 }
 }  // namespace tango_gl
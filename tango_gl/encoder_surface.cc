@@ -0,0 +1,241 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-gl/encoder_surface.h"
+
+#include "tango-gl/gl_state.h"
+#include "tango-gl/render_statistics.h"
+#include "tango-gl/tracing.h"
+
+namespace {
+// EGL_ANDROID_recordable, so that the config can feed a video encoder.
+const EGLint kRecordableAndroid = 0x3142;
+
+// The quad covering the encoder surface, as a triangle strip.
+const GLfloat kVertices[] = {-1.0f, -1.0f, 1.0f, -1.0f,
+                             -1.0f, 1.0f,  1.0f, 1.0f};
+
+// The copy has its first row at the bottom, as the window, so the texture
+// coordinates are the positions mapped to [0, 1].
+const char kVertexShader[] =
+    "attribute vec2 vertex;\n"
+    "varying vec2 f_textureCoords;\n"
+    "void main() {\n"
+    "  f_textureCoords = 0.5 * vertex + 0.5;\n"
+    "  gl_Position = vec4(vertex, 0.0, 1.0);\n"
+    "}\n";
+
+const char kFragmentShader[] =
+    "precision mediump float;\n"
+    "uniform sampler2D copy;\n"
+    "varying vec2 f_textureCoords;\n"
+    "void main() {\n"
+    "  gl_FragColor = texture2D(copy, f_textureCoords);\n"
+    "}\n";
+}  // namespace
+
+namespace tango_gl {
+
+EncoderSurface::EncoderSurface()
+    : window_(NULL),
+      display_(EGL_NO_DISPLAY),
+      context_(EGL_NO_CONTEXT),
+      surface_(EGL_NO_SURFACE),
+      presentation_time_(NULL),
+      texture_(0),
+      texture_width_(0),
+      texture_height_(0),
+      program_(0),
+      vertex_buffer_(0),
+      vertex_location_(-1),
+      texture_location_(-1),
+      last_timestamp_(0.0) {}
+
+EncoderSurface::~EncoderSurface() {
+  if (window_ != NULL) {
+    ANativeWindow_release(window_);
+  }
+}
+
+bool EncoderSurface::Attach(ANativeWindow* window) {
+  Detach();
+  display_ = eglGetCurrentDisplay();
+  const EGLContext current_context = eglGetCurrentContext();
+  if (display_ == EGL_NO_DISPLAY || current_context == EGL_NO_CONTEXT) {
+    LOGE("EncoderSurface: no current context");
+    return false;
+  }
+  presentation_time_ = reinterpret_cast<PresentationTimeFunction>(
+      eglGetProcAddress("eglPresentationTimeANDROID"));
+  if (presentation_time_ == NULL) {
+    LOGE("EncoderSurface: EGL_ANDROID_presentation_time is not supported");
+    return false;
+  }
+
+  // The window config is usually not recordable, the encoder surface gets a
+  // context of its own sharing the texture of the copy.
+  const EGLint config_attributes[] = {EGL_RED_SIZE,        8,
+                                      EGL_GREEN_SIZE,      8,
+                                      EGL_BLUE_SIZE,       8,
+                                      EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT,
+                                      kRecordableAndroid,  EGL_TRUE,
+                                      EGL_NONE};
+  EGLConfig config;
+  EGLint config_count = 0;
+  if (!eglChooseConfig(display_, config_attributes, &config, 1,
+                       &config_count) ||
+      config_count == 0) {
+    LOGE("EncoderSurface: no recordable config");
+    return false;
+  }
+  const EGLint context_attributes[] = {EGL_CONTEXT_CLIENT_VERSION, 2,
+                                       EGL_NONE};
+  context_ = eglCreateContext(display_, config, current_context,
+                              context_attributes);
+  if (context_ == EGL_NO_CONTEXT) {
+    LOGE("EncoderSurface: failed to create the context, error 0x%x",
+         eglGetError());
+    return false;
+  }
+  surface_ = eglCreateWindowSurface(display_, config, window, NULL);
+  if (surface_ == EGL_NO_SURFACE) {
+    LOGE("EncoderSurface: failed to create the surface, error 0x%x",
+         eglGetError());
+    eglDestroyContext(display_, context_);
+    context_ = EGL_NO_CONTEXT;
+    return false;
+  }
+  window_ = window;
+  ANativeWindow_acquire(window_);
+  last_timestamp_ = 0.0;
+  return true;
+}
+
+void EncoderSurface::Detach() {
+  if (surface_ != EGL_NO_SURFACE) {
+    // The objects of the encoder context are deleted with it, the texture
+    // belongs to the window context as well.
+    eglDestroySurface(display_, surface_);
+    eglDestroyContext(display_, context_);
+    if (texture_ != 0) {
+      glDeleteTextures(1, &texture_);
+    }
+  }
+  InvalidateGlResources();
+}
+
+void EncoderSurface::InvalidateGlResources() {
+  if (window_ != NULL) {
+    ANativeWindow_release(window_);
+    window_ = NULL;
+  }
+  display_ = EGL_NO_DISPLAY;
+  context_ = EGL_NO_CONTEXT;
+  surface_ = EGL_NO_SURFACE;
+  texture_ = 0;
+  texture_width_ = 0;
+  texture_height_ = 0;
+  program_ = 0;
+  vertex_buffer_ = 0;
+}
+
+bool EncoderSurface::InitializeCopy() {
+  program_ = util::CreateProgram(kVertexShader, kFragmentShader);
+  if (program_ == 0) {
+    return false;
+  }
+  vertex_location_ = glGetAttribLocation(program_, "vertex");
+  texture_location_ = glGetUniformLocation(program_, "copy");
+  glGenBuffers(1, &vertex_buffer_);
+  GlState::BindBuffer(GL_ARRAY_BUFFER, vertex_buffer_);
+  CountUpload(sizeof(kVertices));
+  glBufferData(GL_ARRAY_BUFFER, sizeof(kVertices), kVertices, GL_STATIC_DRAW);
+  GlState::BindBuffer(GL_ARRAY_BUFFER, 0);
+  return true;
+}
+
+void EncoderSurface::Draw(double timestamp) {
+  if (surface_ == EGL_NO_SURFACE || timestamp <= last_timestamp_) {
+    return;
+  }
+  TANGO_TRACE_SCOPE("EncoderSurface::Draw");
+  last_timestamp_ = timestamp;
+  const EGLContext window_context = eglGetCurrentContext();
+  const EGLSurface draw_surface = eglGetCurrentSurface(EGL_DRAW);
+  const EGLSurface read_surface = eglGetCurrentSurface(EGL_READ);
+  EGLint width = 0;
+  EGLint height = 0;
+  eglQuerySurface(display_, draw_surface, EGL_WIDTH, &width);
+  eglQuerySurface(display_, draw_surface, EGL_HEIGHT, &height);
+  if (width <= 0 || height <= 0) {
+    return;
+  }
+
+  // Copy the window on the GPU, then flush so that the encoder context sees
+  // the texture complete.
+  if (texture_ == 0) {
+    glGenTextures(1, &texture_);
+  }
+  CountRender(kRenderCounterTextureBinds);
+  glBindTexture(GL_TEXTURE_2D, texture_);
+  if (width != texture_width_ || height != texture_height_) {
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glCopyTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 0, 0, width, height, 0);
+    texture_width_ = width;
+    texture_height_ = height;
+  } else {
+    glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, width, height);
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glFlush();
+
+  if (!eglMakeCurrent(display_, surface_, surface_, context_)) {
+    LOGE("EncoderSurface: failed to make the surface current, error 0x%x",
+         eglGetError());
+    return;
+  }
+  if (program_ != 0 || InitializeCopy()) {
+    EGLint surface_width = 0;
+    EGLint surface_height = 0;
+    eglQuerySurface(display_, surface_, EGL_WIDTH, &surface_width);
+    eglQuerySurface(display_, surface_, EGL_HEIGHT, &surface_height);
+    glViewport(0, 0, surface_width, surface_height);
+    GlState::UseProgram(program_);
+    glActiveTexture(GL_TEXTURE0);
+    CountRender(kRenderCounterTextureBinds);
+    glBindTexture(GL_TEXTURE_2D, texture_);
+    glUniform1i(texture_location_, 0);
+    GlState::BindBuffer(GL_ARRAY_BUFFER, vertex_buffer_);
+    glEnableVertexAttribArray(vertex_location_);
+    glVertexAttribPointer(vertex_location_, 2, GL_FLOAT, GL_FALSE, 0,
+                          nullptr);
+    CountDraw(4);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glDisableVertexAttribArray(vertex_location_);
+    GlState::BindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    GlState::UseProgram(0);
+    util::CheckGlError("EncoderSurface::Draw");
+    presentation_time_(display_, surface_,
+                       static_cast<int64_t>(timestamp * 1.0e9));
+    eglSwapBuffers(display_, surface_);
+  }
+  eglMakeCurrent(display_, draw_surface, read_surface, window_context);
+}
+}  // namespace tango_gl
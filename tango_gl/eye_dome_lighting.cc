@@ -0,0 +1,293 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-gl/eye_dome_lighting.h"
+
+#include <algorithm>
+
+#include "tango-gl/gl_state.h"
+#include "tango-gl/render_statistics.h"
+#include "tango-gl/tracing.h"
+
+namespace {
+// The framebuffer is bottom-up and the quad's texture coordinates top-down,
+// so the rows are flipped back.
+const char kVertexShader[] =
+    "attribute vec4 vertex;\n"
+    "attribute vec2 textureCoords;\n"
+    "varying vec2 uv;\n"
+    "void main() {\n"
+    "  gl_Position = vertex;\n"
+    "  uv = vec2(textureCoords.x, 1.0 - textureCoords.y);\n"
+    "}\n";
+
+// The response of a pixel is the sum over 8 neighbors around it of how much
+// nearer they are, in log2 of the distance, and its color is darkened by
+// exp(-strength * response). Farther neighbors, e.g. the background, do not
+// count. The distance takes highp where the fragment shader has it.
+const char kFragmentShader[] =
+    "#ifdef GL_FRAGMENT_PRECISION_HIGH\n"
+    "precision highp float;\n"
+    "#else\n"
+    "precision mediump float;\n"
+    "#endif\n"
+    "uniform sampler2D color_texture;\n"
+    "uniform sampler2D depth_texture;\n"
+    "uniform vec2 pixel_size;\n"
+    "uniform float strength;\n"
+    "uniform vec3 depth_coefficients;\n"
+    "varying vec2 uv;\n"
+    "float LogDistance(float depth) {\n"
+    "  float z = 2.0 * depth - 1.0;\n"
+    "  float distance = depth_coefficients.z > 0.5\n"
+    "      ? depth_coefficients.y / (z + depth_coefficients.x)\n"
+    "      : (depth_coefficients.y - z) / depth_coefficients.x;\n"
+    "  return log2(max(distance, 0.0001));\n"
+    "}\n"
+    "void main() {\n"
+    "  vec4 color = texture2D(color_texture, uv);\n"
+    "  float depth = texture2D(depth_texture, uv).r;\n"
+    "  if (depth >= 1.0) {\n"
+    "    gl_FragColor = color;\n"
+    "    return;\n"
+    "  }\n"
+    "  float center = LogDistance(depth);\n"
+    "  float response = 0.0;\n"
+    "  for (int i = 0; i < 8; ++i) {\n"
+    "    float angle = float(i) * 0.7853982;\n"
+    "    vec2 neighbor = uv + vec2(cos(angle), sin(angle)) * pixel_size;\n"
+    "    float neighbor_depth = texture2D(depth_texture, neighbor).r;\n"
+    "    response += max(center - LogDistance(neighbor_depth), 0.0);\n"
+    "  }\n"
+    "  gl_FragColor = vec4(color.rgb * exp(-strength * response), color.a);\n"
+    "}\n";
+
+// Bounds of the radius, below which the neighbors are the pixel itself and
+// above which the outlines detach from the edges.
+const float kMinRadius = 0.5f;
+const float kMaxRadius = 8.0f;
+}  // namespace
+
+namespace tango_gl {
+
+const float EyeDomeLighting::kDefaultStrength = 2.0f;
+const float EyeDomeLighting::kDefaultRadius = 1.5f;
+
+EyeDomeLighting::EyeDomeLighting()
+    : strength_(kDefaultStrength),
+      radius_(kDefaultRadius),
+      is_active_(false),
+      depth_coefficients_(0.0f, 1.0f, 1.0f),
+      program_(0),
+      color_texture_location_(-1),
+      depth_texture_location_(-1),
+      pixel_size_location_(-1),
+      strength_location_(-1),
+      depth_coefficients_location_(-1),
+      framebuffer_(0),
+      color_texture_(0),
+      depth_texture_(0),
+      framebuffer_width_(0),
+      framebuffer_height_(0),
+      gpu_memory_(kMemoryTagTexture, kMemoryGpu),
+      previous_framebuffer_(0) {}
+
+EyeDomeLighting::~EyeDomeLighting() {}
+
+bool EyeDomeLighting::IsSupported() {
+  return util::GetGlCapabilities().IsGles3() ||
+         util::IsGlExtensionSupported("GL_OES_depth_texture");
+}
+
+void EyeDomeLighting::SetStrength(float strength) {
+  strength_ = std::max(strength, 0.0f);
+}
+
+void EyeDomeLighting::SetRadius(float radius) {
+  radius_ = std::min(std::max(radius, kMinRadius), kMaxRadius);
+}
+
+bool EyeDomeLighting::InitializeFramebuffer(GLsizei width, GLsizei height) {
+  if (program_ == 0) {
+    program_ = util::CreateProgram(kVertexShader, kFragmentShader);
+    if (program_ == 0) {
+      LOGE("EyeDomeLighting: could not create the program");
+      return false;
+    }
+    color_texture_location_ = glGetUniformLocation(program_, "color_texture");
+    depth_texture_location_ = glGetUniformLocation(program_, "depth_texture");
+    pixel_size_location_ = glGetUniformLocation(program_, "pixel_size");
+    strength_location_ = glGetUniformLocation(program_, "strength");
+    depth_coefficients_location_ =
+        glGetUniformLocation(program_, "depth_coefficients");
+    quad_.SetAttributeLocations(glGetAttribLocation(program_, "vertex"),
+                                glGetAttribLocation(program_, "textureCoords"));
+  }
+  if (framebuffer_ != 0 && width == framebuffer_width_ &&
+      height == framebuffer_height_) {
+    return true;
+  }
+  if (framebuffer_ == 0) {
+    glGenFramebuffers(1, &framebuffer_);
+    glGenTextures(1, &color_texture_);
+    glGenTextures(1, &depth_texture_);
+  }
+  // Both are sampled pixel for pixel, and depths must not be interpolated.
+  const GLuint textures[] = {color_texture_, depth_texture_};
+  for (GLuint texture : textures) {
+    CountRender(kRenderCounterTextureBinds);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    if (texture == color_texture_) {
+      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA,
+                   GL_UNSIGNED_BYTE, NULL);
+    } else {
+      glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, width, height, 0,
+                   GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, NULL);
+    }
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
+  gpu_memory_.Set(
+      EstimateTextureBytes(width, height, GL_RGBA, GL_UNSIGNED_BYTE) +
+      EstimateTextureBytes(width, height, GL_DEPTH_COMPONENT,
+                           GL_UNSIGNED_INT));
+
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                         color_texture_, 0);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D,
+                         depth_texture_, 0);
+  const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+  glBindFramebuffer(GL_FRAMEBUFFER, previous_framebuffer_);
+  if (status != GL_FRAMEBUFFER_COMPLETE) {
+    LOGE("EyeDomeLighting: incomplete framebuffer 0x%x", status);
+    framebuffer_width_ = 0;
+    framebuffer_height_ = 0;
+    return false;
+  }
+  framebuffer_width_ = width;
+  framebuffer_height_ = height;
+  util::CheckGlError("EyeDomeLighting::InitializeFramebuffer");
+  return true;
+}
+
+bool EyeDomeLighting::Begin(const glm::mat4& projection_mat) {
+  is_active_ = false;
+  // Only looked up until the framebuffer of the context exists.
+  if (framebuffer_ == 0 && !IsSupported()) {
+    return false;
+  }
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous_framebuffer_);
+  glGetIntegerv(GL_VIEWPORT, previous_viewport_);
+  const GLsizei width = std::max<GLsizei>(previous_viewport_[2], 1);
+  const GLsizei height = std::max<GLsizei>(previous_viewport_[3], 1);
+  if (!InitializeFramebuffer(width, height)) {
+    return false;
+  }
+
+  // The projection takes the distance d to clip z = a * -d + b, divided by
+  // d for a perspective and by 1 for an orthographic projection.
+  const float a = projection_mat[2][2];
+  const float b = projection_mat[3][2];
+  const bool is_perspective = projection_mat[2][3] != 0.0f;
+  depth_coefficients_ = glm::vec3(a, b, is_perspective ? 1.0f : 0.0f);
+
+  TANGO_TRACE_SCOPE("EyeDomeLighting::Begin");
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+  glViewport(0, 0, framebuffer_width_, framebuffer_height_);
+  GlState::DepthMask(GL_TRUE);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  is_active_ = true;
+  return true;
+}
+
+void EyeDomeLighting::End() {
+  if (!is_active_) {
+    return;
+  }
+  is_active_ = false;
+  TANGO_TRACE_SCOPE("EyeDomeLighting::End");
+  glBindFramebuffer(GL_FRAMEBUFFER, previous_framebuffer_);
+  glViewport(previous_viewport_[0], previous_viewport_[1],
+             previous_viewport_[2], previous_viewport_[3]);
+
+  const bool was_depth_test_enabled = glIsEnabled(GL_DEPTH_TEST) == GL_TRUE;
+  const bool was_blend_enabled = glIsEnabled(GL_BLEND) == GL_TRUE;
+  GlState::Disable(GL_DEPTH_TEST);
+  GlState::Disable(GL_BLEND);
+  GlState::UseProgram(program_);
+  glUniform1i(color_texture_location_, 0);
+  glUniform1i(depth_texture_location_, 1);
+  glUniform2f(pixel_size_location_, radius_ / framebuffer_width_,
+              radius_ / framebuffer_height_);
+  glUniform1f(strength_location_, strength_);
+  glUniform3fv(depth_coefficients_location_, 1,
+               glm::value_ptr(depth_coefficients_));
+  glActiveTexture(GL_TEXTURE1);
+  CountRender(kRenderCounterTextureBinds);
+  glBindTexture(GL_TEXTURE_2D, depth_texture_);
+  glActiveTexture(GL_TEXTURE0);
+  CountRender(kRenderCounterTextureBinds);
+  glBindTexture(GL_TEXTURE_2D, color_texture_);
+  quad_.Draw();
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glActiveTexture(GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glActiveTexture(GL_TEXTURE0);
+
+  if (was_blend_enabled) {
+    GlState::Enable(GL_BLEND);
+  }
+  if (was_depth_test_enabled) {
+    GlState::Enable(GL_DEPTH_TEST);
+  }
+  util::CheckGlError("EyeDomeLighting::End");
+}
+
+void EyeDomeLighting::DeleteGlResources() {
+  if (framebuffer_ != 0) {
+    glDeleteFramebuffers(1, &framebuffer_);
+    glDeleteTextures(1, &color_texture_);
+    glDeleteTextures(1, &depth_texture_);
+  }
+  if (program_ != 0) {
+    GlState::DeleteProgram(program_);
+  }
+  quad_.DeleteGlResources();
+  InvalidateGlResources();
+}
+
+void EyeDomeLighting::InvalidateGlResources() {
+  quad_.InvalidateGlResources();
+  program_ = 0;
+  color_texture_location_ = -1;
+  depth_texture_location_ = -1;
+  pixel_size_location_ = -1;
+  strength_location_ = -1;
+  depth_coefficients_location_ = -1;
+  framebuffer_ = 0;
+  color_texture_ = 0;
+  depth_texture_ = 0;
+  framebuffer_width_ = 0;
+  framebuffer_height_ = 0;
+  gpu_memory_.Set(0);
+  is_active_ = false;
+}
+
+}  // namespace tango_gl
@@ -0,0 +1,179 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-gl/frame_capture.h"
+
+#include "tango-gl/gl_state.h"
+#include "tango-gl/tracing.h"
+
+namespace {
+// GLES 3.0 enums, which gl2.h does not define.
+const GLenum kPixelPackBuffer = 0x88EB;
+const GLenum kStreamRead = 0x88E1;
+const GLbitfield kMapReadBit = 0x0001;
+
+// Frames in flight: the one being copied, the one the GPU may still be
+// drawing and one to spare.
+const size_t kReadbackCount = 3;
+
+const GLsizeiptr kBytesPerPixel = 4;
+}  // namespace
+
+namespace tango_gl {
+
+FrameCapture::FrameCapture()
+    : gl_initialized_(false),
+      is_supported_(false),
+      map_buffer_range_(NULL),
+      unmap_buffer_(NULL),
+      fence_sync_(NULL),
+      client_wait_sync_(NULL),
+      delete_sync_(NULL),
+      next_readback_(0),
+      dropped_count_(0) {}
+
+FrameCapture::~FrameCapture() {}
+
+void FrameCapture::InitializeGl() {
+  if (gl_initialized_) {
+    return;
+  }
+  gl_initialized_ = true;
+  is_supported_ = false;
+  const util::GlCapabilities& gl = util::GetGlCapabilities();
+  if (!gl.IsGles3()) {
+    LOGI("FrameCapture: pixel pack buffers are not supported");
+    return;
+  }
+  map_buffer_range_ = gl.map_buffer_range;
+  unmap_buffer_ = gl.unmap_buffer;
+  fence_sync_ = gl.fence_sync;
+  client_wait_sync_ = gl.client_wait_sync;
+  delete_sync_ = gl.delete_sync;
+  if (map_buffer_range_ == NULL || unmap_buffer_ == NULL ||
+      fence_sync_ == NULL || client_wait_sync_ == NULL ||
+      delete_sync_ == NULL) {
+    LOGE("FrameCapture: GLES 3.0 entry points are missing");
+    return;
+  }
+
+  // The buffers are sized by the first frame they capture.
+  readbacks_.resize(kReadbackCount);
+  for (Readback& readback : readbacks_) {
+    glGenBuffers(1, &readback.buffer);
+    readback.capacity = 0;
+    readback.fence = NULL;
+  }
+  next_readback_ = 0;
+  is_supported_ = true;
+  util::CheckGlError("FrameCapture::InitializeGl");
+}
+
+bool FrameCapture::Capture(double timestamp) {
+  TANGO_TRACE_SCOPE("FrameCapture::Capture");
+  InitializeGl();
+  if (!is_supported_) {
+    return false;
+  }
+  // Never wait for a frame still in flight, the capture is dropped instead.
+  Readback& readback = readbacks_[next_readback_];
+  if (readback.fence != NULL) {
+    ++dropped_count_;
+    return false;
+  }
+  GLint viewport[4];
+  glGetIntegerv(GL_VIEWPORT, viewport);
+  if (viewport[2] <= 0 || viewport[3] <= 0) {
+    return false;
+  }
+  next_readback_ = (next_readback_ + 1) % readbacks_.size();
+  readback.width = viewport[2];
+  readback.height = viewport[3];
+  readback.timestamp = timestamp;
+
+  // Rows of RGBA pixels are 4 byte aligned, the default pack alignment.
+  const GLsizeiptr size = kBytesPerPixel * readback.width * readback.height;
+  GlState::BindBuffer(kPixelPackBuffer, readback.buffer);
+  if (readback.capacity < size) {
+    glBufferData(kPixelPackBuffer, size, NULL, kStreamRead);
+    readback.capacity = size;
+  }
+  // With a pack buffer bound, the pixels go to its offset 0 on the GPU.
+  glReadPixels(viewport[0], viewport[1], readback.width, readback.height,
+               GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+  GlState::BindBuffer(kPixelPackBuffer, 0);
+  readback.fence =
+      fence_sync_(util::GlCapabilities::kSyncGpuCommandsComplete, 0);
+  util::CheckGlError("FrameCapture::Capture");
+  return true;
+}
+
+int FrameCapture::ReadFinishedFrames(const FrameCallback& callback) {
+  if (!is_supported_) {
+    return 0;
+  }
+  TANGO_TRACE_SCOPE("FrameCapture::ReadFinishedFrames");
+  int read_count = 0;
+  // Copies finish in order, oldest first, so the later ones are not done
+  // when one is not.
+  for (size_t i = 0; i < readbacks_.size(); ++i) {
+    Readback& readback =
+        readbacks_[(next_readback_ + i) % readbacks_.size()];
+    if (readback.fence == NULL) {
+      continue;
+    }
+    // The fence was flushed by the frames drawn since, no flush bit is
+    // needed to keep polling it.
+    const GLenum status = client_wait_sync_(readback.fence, 0, 0);
+    if (status != util::GlCapabilities::kAlreadySignaled &&
+        status != util::GlCapabilities::kConditionSatisfied) {
+      break;
+    }
+    delete_sync_(readback.fence);
+    readback.fence = NULL;
+
+    const GLsizeiptr size = kBytesPerPixel * readback.width * readback.height;
+    GlState::BindBuffer(kPixelPackBuffer, readback.buffer);
+    const uint8_t* rgba = static_cast<const uint8_t*>(
+        map_buffer_range_(kPixelPackBuffer, 0, size, kMapReadBit));
+    if (rgba != NULL) {
+      callback(rgba, readback.width, readback.height, readback.timestamp);
+      unmap_buffer_(kPixelPackBuffer);
+      ++read_count;
+    }
+    GlState::BindBuffer(kPixelPackBuffer, 0);
+  }
+  util::CheckGlError("FrameCapture::ReadFinishedFrames");
+  return read_count;
+}
+
+void FrameCapture::DeleteGlResources() {
+  for (Readback& readback : readbacks_) {
+    GlState::DeleteBuffers(1, &readback.buffer);
+    if (readback.fence != NULL) {
+      delete_sync_(readback.fence);
+    }
+  }
+  InvalidateGlResources();
+}
+
+void FrameCapture::InvalidateGlResources() {
+  readbacks_.clear();
+  next_readback_ = 0;
+  gl_initialized_ = false;
+  is_supported_ = false;
+}
+}  // namespace tango_gl
@@ -24,12 +24,17 @@ static const float float_vertices[] = {
     1.0f,  1.0f,  -1.0f, 1.0f,  -1.0f, -1.0f, 1.0f,  -1.0f, -1.0f, -1.0f,
     -1.0f, -1.0f, -1.0f, -1.0f, -1.0f, -1.0f, 1.0f,  -1.0f};
 
-Frustum::Frustum() : Line(3.0f, GL_LINES) {
-  SetShader();
+static void GenerateUnitFrustum(int /*parameter*/,
+                                std::vector<glm::vec3>* vertices) {
   size_t size = sizeof(float_vertices) / sizeof(float);
   for (size_t i = 0; i < size; i += 3) {
-    vec_vertices_.push_back(glm::vec3(float_vertices[i], float_vertices[i + 1],
-                                      float_vertices[i + 2]));
+    vertices->push_back(glm::vec3(float_vertices[i], float_vertices[i + 1],
+                                  float_vertices[i + 2]));
   }
 }
+
+Frustum::Frustum() : Line(3.0f, GL_LINES) {
+  SetShader();
+  SetSharedVertices(&GenerateUnitFrustum, 0);
+}
 }  // namespace tango_gl
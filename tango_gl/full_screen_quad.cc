@@ -0,0 +1,137 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-gl/full_screen_quad.h"
+
+#include <EGL/egl.h>
+
+#include "tango-gl/gl_state.h"
+#include "tango-gl/render_statistics.h"
+
+namespace {
+// Position then texture coordinates of every vertex of the triangle strip.
+const GLfloat kVertices[] = {-1.0f, 1.0f,  0.0f, 0.0f, 0.0f,  //
+                             -1.0f, -1.0f, 0.0f, 0.0f, 1.0f,  //
+                             1.0f,  1.0f,  0.0f, 1.0f, 0.0f,  //
+                             1.0f,  -1.0f, 0.0f, 1.0f, 1.0f};
+const GLsizei kVertexStride = 5 * sizeof(GLfloat);
+const size_t kTextureCoordsOffset = 3 * sizeof(GLfloat);
+
+// The vertex buffer shared by the quads of a context.
+struct QuadContext {
+  QuadContext() : context(EGL_NO_CONTEXT), vertex_buffer(0) {}
+
+  EGLContext context;
+  GLuint vertex_buffer;
+};
+
+// @return the quad context of the current context, created on first use.
+const QuadContext& GetQuadContext() {
+  static QuadContext* quad_context = new QuadContext();
+  const EGLContext context = eglGetCurrentContext();
+  if (context == quad_context->context) {
+    return *quad_context;
+  }
+  // The buffer of another context can not be used, nor deleted, here.
+  *quad_context = QuadContext();
+  quad_context->context = context;
+
+  glGenBuffers(1, &quad_context->vertex_buffer);
+  tango_gl::GlState::BindBuffer(GL_ARRAY_BUFFER, quad_context->vertex_buffer);
+  tango_gl::CountUpload(sizeof(kVertices));
+  glBufferData(GL_ARRAY_BUFFER, sizeof(kVertices), kVertices, GL_STATIC_DRAW);
+  tango_gl::GlState::BindBuffer(GL_ARRAY_BUFFER, 0);
+  return *quad_context;
+}
+}  // namespace
+
+namespace tango_gl {
+
+FullScreenQuad::FullScreenQuad()
+    : vertex_location_(-1),
+      texture_coords_location_(-1),
+      vertex_buffer_(0),
+      vertex_array_(0) {}
+
+void FullScreenQuad::SetAttributeLocations(GLint vertex_location,
+                                           GLint texture_coords_location) {
+  const util::GlCapabilities& gl = util::GetGlCapabilities();
+  vertex_location_ = vertex_location;
+  texture_coords_location_ = texture_coords_location;
+  vertex_buffer_ = GetQuadContext().vertex_buffer;
+  if (!gl.HasVertexArrays()) {
+    return;
+  }
+  if (vertex_array_ == 0) {
+    gl.gen_vertex_arrays(1, &vertex_array_);
+  }
+  gl.bind_vertex_array(vertex_array_);
+  SetUpAttributes();
+  gl.bind_vertex_array(0);
+  GlState::BindBuffer(GL_ARRAY_BUFFER, 0);
+  util::CheckGlError("FullScreenQuad::SetAttributeLocations");
+}
+
+void FullScreenQuad::Draw() const {
+  if (vertex_array_ != 0) {
+    const util::GlCapabilities& gl = util::GetGlCapabilities();
+    gl.bind_vertex_array(vertex_array_);
+    CountDraw(4);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    gl.bind_vertex_array(0);
+  } else {
+    SetUpAttributes();
+    CountDraw(4);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    if (vertex_location_ >= 0) {
+      glDisableVertexAttribArray(vertex_location_);
+    }
+    if (texture_coords_location_ >= 0) {
+      glDisableVertexAttribArray(texture_coords_location_);
+    }
+    GlState::BindBuffer(GL_ARRAY_BUFFER, 0);
+  }
+  util::CheckGlError("FullScreenQuad::Draw");
+}
+
+void FullScreenQuad::SetUpAttributes() const {
+  GlState::BindBuffer(GL_ARRAY_BUFFER, vertex_buffer_);
+  if (vertex_location_ >= 0) {
+    glEnableVertexAttribArray(vertex_location_);
+    glVertexAttribPointer(vertex_location_, 3, GL_FLOAT, GL_FALSE,
+                          kVertexStride, nullptr);
+  }
+  if (texture_coords_location_ >= 0) {
+    glEnableVertexAttribArray(texture_coords_location_);
+    glVertexAttribPointer(texture_coords_location_, 2, GL_FLOAT, GL_FALSE,
+                          kVertexStride,
+                          reinterpret_cast<const void*>(kTextureCoordsOffset));
+  }
+}
+
+void FullScreenQuad::DeleteGlResources() {
+  if (vertex_array_ != 0) {
+    util::GetGlCapabilities().delete_vertex_arrays(1, &vertex_array_);
+  }
+  InvalidateGlResources();
+}
+
+void FullScreenQuad::InvalidateGlResources() {
+  vertex_buffer_ = 0;
+  vertex_array_ = 0;
+}
+
+}  // namespace tango_gl
@@ -15,6 +15,10 @@
  */
 
 #include "tango-gl/gesture_camera.h"
+
+#include <algorithm>
+#include <cmath>
+
 #include "tango-gl/util.h"
 
 namespace {
@@ -36,11 +40,47 @@ const float kCamViewMaxDist = 100.f;
 // First person camera's FOV is 45 degrees.
 const float kHighFov = 65.0f;
 const float kLowFov = 45.0f;
+
+// Fixed point units per radian or meter of the posted input.
+const float kInputScale = 1048576.0f;
+
+// The inertia is integrated in steps of kInertiaStep seconds. A frame later
+// than kMaxFrameTime, e.g. after a pause, only moves the camera as much.
+const double kInertiaStep = 1.0 / 120.0;
+const double kMaxFrameTime = 0.1;
+
+// Weight of the latest frame in the speed of a gesture, which the camera
+// keeps when the fingers are lifted.
+const float kVelocitySmoothing = 0.5f;
+
+// Below these speeds, in radians and meters per second, the camera stops.
+const float kMinAngularSpeed = 0.01f;
+const float kMinZoomSpeed = 0.01f;
+
+const int kNoCameraTypeRequest = -1;
+
+float TakeInput(std::atomic<int32_t>* accumulator) {
+  return accumulator->exchange(0) / kInputScale;
+}
 }  // namespace
 
 namespace tango_gl {
 
-GestureCamera::GestureCamera() {
+GestureCamera::GestureCamera()
+    : camera_type_(kFirstPerson),
+      cam_cur_angle_(0.0f),
+      cam_cur_dist_(0.0f),
+      velocity_(0.0f),
+      damping_(0.0f),
+      has_updated_(false),
+      unintegrated_time_(0.0),
+      last_touch0_position_(0.0f),
+      last_touch_dist_(0.0f),
+      input_rotation_x_(0),
+      input_rotation_y_(0),
+      input_dist_(0),
+      is_touching_(false),
+      requested_camera_type_(kNoCameraTypeRequest) {
   cam_parent_transform_ = new Transform();
   SetParent(cam_parent_transform_);
 }
@@ -49,49 +89,38 @@ GestureCamera::~GestureCamera() { delete cam_parent_transform_; }
 
 void GestureCamera::OnTouchEvent(int touch_count, TouchEvent event, float x0,
                                  float y0, float x1, float y1) {
-  if (camera_type_ == CameraType::kFirstPerson) {
-    return;
-  }
-
   if (touch_count == 1) {
     switch (event) {
       case TouchEvent::kTouch0Down: {
-        cam_start_angle_ = cam_cur_angle_;
-
-        touch0_start_position_.x = x0;
-        touch0_start_position_.y = y0;
+        last_touch0_position_ = glm::vec2(x0, y0);
+        is_touching_.store(true);
+        break;
+      }
+      case TouchEvent::kTouch0Up: {
+        is_touching_.store(false);
         break;
       }
       case TouchEvent::kTouchMove: {
-        float rotation_x = touch0_start_position_.y - y0;
-        float rotation_y = touch0_start_position_.x - x0;
-
-        cam_cur_angle_.x = cam_start_angle_.x + rotation_x;
-        cam_cur_angle_.y = cam_start_angle_.y + rotation_y;
-        StartCameraToCurrentTransform();
+        PostInput(last_touch0_position_.y - y0, &input_rotation_x_);
+        PostInput(last_touch0_position_.x - x0, &input_rotation_y_);
+        last_touch0_position_ = glm::vec2(x0, y0);
         break;
       }
       default: { break; }
     }
   }
   if (touch_count == 2) {
+    float abs_x = x0 - x1;
+    float abs_y = y0 - y1;
+    const float touch_dist = std::sqrt(abs_x * abs_x + abs_y * abs_y);
     switch (event) {
       case TouchEvent::kTouch1Down: {
-        float abs_x = x0 - x1;
-        float abs_y = y0 - y1;
-        start_touch_dist_ = std::sqrt(abs_x * abs_x + abs_y * abs_y);
-        cam_start_dist_ = GetPosition().z;
+        last_touch_dist_ = touch_dist;
         break;
       }
       case TouchEvent::kTouchMove: {
-        float abs_x = x0 - x1;
-        float abs_y = y0 - y1;
-        float dist =
-            start_touch_dist_ - std::sqrt(abs_x * abs_x + abs_y * abs_y);
-        cam_cur_dist_ =
-            tango_gl::util::Clamp(cam_start_dist_ + dist * kZoomSpeed,
-                                  kCamViewMinDist, kCamViewMaxDist);
-        StartCameraToCurrentTransform();
+        PostInput((last_touch_dist_ - touch_dist) * kZoomSpeed, &input_dist_);
+        last_touch_dist_ = touch_dist;
         break;
       }
       default: { break; }
@@ -99,6 +128,72 @@ void GestureCamera::OnTouchEvent(int touch_count, TouchEvent event, float x0,
   }
 }
 
+void GestureCamera::Update() {
+  const std::chrono::steady_clock::time_point now =
+      std::chrono::steady_clock::now();
+  const double frame_time =
+      has_updated_ ? std::min(std::chrono::duration<double>(
+                                  now - last_update_time_).count(),
+                              kMaxFrameTime)
+                   : 0.0;
+  last_update_time_ = now;
+  has_updated_ = true;
+
+  const int requested_type =
+      requested_camera_type_.exchange(kNoCameraTypeRequest);
+  if (requested_type != kNoCameraTypeRequest) {
+    ApplyCameraType(static_cast<CameraType>(requested_type));
+  }
+
+  const glm::vec3 input(TakeInput(&input_rotation_x_),
+                        TakeInput(&input_rotation_y_),
+                        TakeInput(&input_dist_));
+  // The input of the previous type is dropped along with it.
+  if (camera_type_ == CameraType::kFirstPerson ||
+      requested_type != kNoCameraTypeRequest) {
+    return;
+  }
+
+  glm::vec3 motion = input;
+  if (damping_ <= 0.0f) {
+    velocity_ = glm::vec3(0.0f);
+  } else if (is_touching_.load()) {
+    // The camera follows the fingers, and keeps their latest speed.
+    if (frame_time > 0.0) {
+      velocity_ = glm::mix(velocity_, input / static_cast<float>(frame_time),
+                           kVelocitySmoothing);
+    }
+    unintegrated_time_ = 0.0;
+  } else {
+    unintegrated_time_ += frame_time;
+    const float decay = std::exp(-damping_ * kInertiaStep);
+    for (; unintegrated_time_ >= kInertiaStep;
+         unintegrated_time_ -= kInertiaStep) {
+      motion += velocity_ * static_cast<float>(kInertiaStep);
+      velocity_ *= decay;
+    }
+    if (std::abs(velocity_.x) < kMinAngularSpeed &&
+        std::abs(velocity_.y) < kMinAngularSpeed &&
+        std::abs(velocity_.z) < kMinZoomSpeed) {
+      velocity_ = glm::vec3(0.0f);
+    }
+  }
+
+  if (motion == glm::vec3(0.0f)) {
+    return;
+  }
+  cam_cur_angle_ += glm::vec2(motion);
+  cam_cur_dist_ = tango_gl::util::Clamp(cam_cur_dist_ + motion.z,
+                                        kCamViewMinDist, kCamViewMaxDist);
+  StartCameraToCurrentTransform();
+}
+
+void GestureCamera::PostInput(float delta, std::atomic<int32_t>* accumulator) {
+  const float value = delta * kInputScale;
+  accumulator->fetch_add(
+      static_cast<int32_t>(value >= 0.0f ? value + 0.5f : value - 0.5f));
+}
+
 Segment GestureCamera::GetSegmentFromTouch(float normalized_x,
                                            float normalized_y,
                                            float touch_range) {
@@ -124,7 +219,12 @@ void GestureCamera::SetAnchorPosition(const glm::vec3& pos) {
 }
 
 void GestureCamera::SetCameraType(CameraType camera_index) {
+  requested_camera_type_.store(camera_index);
+}
+
+void GestureCamera::ApplyCameraType(CameraType camera_index) {
   camera_type_ = camera_index;
+  velocity_ = glm::vec3(0.0f);
   switch (camera_index) {
     case CameraType::kFirstPerson:
       SetFieldOfView(kLowFov);
@@ -0,0 +1,56 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-gl/gl_context_tracker.h"
+
+namespace tango_gl {
+
+GlContextTracker::GlContextTracker()
+    : context_(EGL_NO_CONTEXT), marker_texture_(0) {}
+
+GlContextTracker::State GlContextTracker::CheckCurrentContext() const {
+  if (context_ == EGL_NO_CONTEXT) {
+    return kNoContext;
+  }
+  // glIsTexture() is false for a name that was never bound, so a new context
+  // with the same handle does not pass for the attached one.
+  if (eglGetCurrentContext() != context_ || !glIsTexture(marker_texture_)) {
+    return kContextLost;
+  }
+  return kContextKept;
+}
+
+void GlContextTracker::Attach() {
+  Detach();
+  context_ = eglGetCurrentContext();
+  if (context_ == EGL_NO_CONTEXT) {
+    LOGE("GlContextTracker: no GL context is current.");
+    return;
+  }
+  glGenTextures(1, &marker_texture_);
+  glBindTexture(GL_TEXTURE_2D, marker_texture_);
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void GlContextTracker::Detach() {
+  if (CheckCurrentContext() == kContextKept) {
+    glDeleteTextures(1, &marker_texture_);
+  }
+  context_ = EGL_NO_CONTEXT;
+  marker_texture_ = 0;
+}
+
+}  // namespace tango_gl
@@ -0,0 +1,186 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-gl/gl_state.h"
+
+#include <EGL/egl.h>
+
+#include "tango-gl/render_statistics.h"
+
+namespace {
+// Value of the state that is not known.
+const int64_t kUnknown = -1;
+
+enum Capability { kBlend = 0, kDepthTest, kCullFace, kCapabilityCount };
+
+// The shadow of the state of a context.
+struct Shadow {
+  Shadow() : context(EGL_NO_CONTEXT) { Reset(); }
+
+  void Reset() {
+    program = kUnknown;
+    array_buffer = kUnknown;
+    for (int i = 0; i < kCapabilityCount; ++i) {
+      capabilities[i] = kUnknown;
+    }
+    blend_source_factor = kUnknown;
+    blend_destination_factor = kUnknown;
+    depth_function = kUnknown;
+    depth_mask = kUnknown;
+  }
+
+  EGLContext context;
+  int64_t program;
+  int64_t array_buffer;
+  int64_t capabilities[kCapabilityCount];
+  int64_t blend_source_factor;
+  int64_t blend_destination_factor;
+  int64_t depth_function;
+  int64_t depth_mask;
+};
+
+Shadow& GetShadow() {
+  static thread_local Shadow* shadow = nullptr;
+  if (shadow == nullptr) {
+    shadow = new Shadow();
+  }
+  const EGLContext context = eglGetCurrentContext();
+  if (context != shadow->context) {
+    shadow->Reset();
+    shadow->context = context;
+  }
+  return *shadow;
+}
+
+// @return the capability shadowed for |capability|, or -1 if it is not.
+int GetCapability(GLenum capability) {
+  switch (capability) {
+    case GL_BLEND:
+      return kBlend;
+    case GL_DEPTH_TEST:
+      return kDepthTest;
+    case GL_CULL_FACE:
+      return kCullFace;
+    default:
+      return -1;
+  }
+}
+
+// Set |*shadowed| to |value|.
+//
+// @return false if it already was, and the call can be skipped.
+bool Update(int64_t* shadowed, int64_t value) {
+  if (*shadowed == value) {
+    tango_gl::CountRender(tango_gl::kRenderCounterSkippedStateChanges);
+    return false;
+  }
+  *shadowed = value;
+  return true;
+}
+
+void SetCapability(GLenum capability, bool is_enabled) {
+  const int index = GetCapability(capability);
+  if (index >= 0 &&
+      !Update(&GetShadow().capabilities[index], is_enabled ? 1 : 0)) {
+    return;
+  }
+  tango_gl::CountRender(tango_gl::kRenderCounterStateChanges);
+  if (is_enabled) {
+    glEnable(capability);
+  } else {
+    glDisable(capability);
+  }
+}
+}  // namespace
+
+namespace tango_gl {
+
+void GlState::UseProgram(GLuint program) {
+  if (!Update(&GetShadow().program, program)) {
+    return;
+  }
+  CountRender(program != 0 ? kRenderCounterProgramBinds
+                           : kRenderCounterStateChanges);
+  glUseProgram(program);
+}
+
+void GlState::BindBuffer(GLenum target, GLuint buffer) {
+  // The GL_ELEMENT_ARRAY_BUFFER binding belongs to the bound vertex array,
+  // and the other targets are rarely bound twice.
+  if (target == GL_ARRAY_BUFFER &&
+      !Update(&GetShadow().array_buffer, buffer)) {
+    return;
+  }
+  CountRender(kRenderCounterStateChanges);
+  glBindBuffer(target, buffer);
+}
+
+void GlState::Enable(GLenum capability) { SetCapability(capability, true); }
+
+void GlState::Disable(GLenum capability) { SetCapability(capability, false); }
+
+void GlState::BlendFunc(GLenum source_factor, GLenum destination_factor) {
+  Shadow& shadow = GetShadow();
+  if (shadow.blend_source_factor == source_factor &&
+      shadow.blend_destination_factor == destination_factor) {
+    CountRender(kRenderCounterSkippedStateChanges);
+    return;
+  }
+  shadow.blend_source_factor = source_factor;
+  shadow.blend_destination_factor = destination_factor;
+  CountRender(kRenderCounterStateChanges);
+  glBlendFunc(source_factor, destination_factor);
+}
+
+void GlState::DepthFunc(GLenum function) {
+  if (!Update(&GetShadow().depth_function, function)) {
+    return;
+  }
+  CountRender(kRenderCounterStateChanges);
+  glDepthFunc(function);
+}
+
+void GlState::DepthMask(GLboolean flag) {
+  if (!Update(&GetShadow().depth_mask, flag != GL_FALSE ? 1 : 0)) {
+    return;
+  }
+  CountRender(kRenderCounterStateChanges);
+  glDepthMask(flag);
+}
+
+void GlState::DeleteProgram(GLuint program) {
+  Shadow& shadow = GetShadow();
+  if (shadow.program == program) {
+    // The program stays current until another one is used, but its name
+    // may come back for a new one, which would then be skipped.
+    shadow.program = kUnknown;
+  }
+  glDeleteProgram(program);
+}
+
+void GlState::DeleteBuffers(GLsizei count, const GLuint* buffers) {
+  Shadow& shadow = GetShadow();
+  for (GLsizei i = 0; i < count; ++i) {
+    if (shadow.array_buffer == buffers[i]) {
+      // Deleting a bound buffer binds 0 instead.
+      shadow.array_buffer = 0;
+    }
+  }
+  glDeleteBuffers(count, buffers);
+}
+
+void GlState::Invalidate() { GetShadow().Reset(); }
+}  // namespace tango_gl
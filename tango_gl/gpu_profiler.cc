@@ -0,0 +1,254 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-gl/gpu_profiler.h"
+
+#include <EGL/egl.h>
+
+namespace {
+// GL_EXT_disjoint_timer_query enums, which older gl2ext.h do not define.
+const GLenum kQueryResult = 0x8866;
+const GLenum kQueryResultAvailable = 0x8867;
+const GLenum kTimeElapsed = 0x88BF;
+const GLenum kGpuDisjoint = 0x8FBB;
+
+// Frames in flight before their results must be available, older ones are
+// dropped rather than waited for.
+const size_t kFrameLatency = 4;
+// Frames the times are averaged over.
+const size_t kAverageFrameCount = 30;
+
+const float kNanosecondToMillisecond = 1e-6f;
+}  // namespace
+
+namespace tango_gl {
+
+GpuProfiler::RollingAverage::RollingAverage()
+    : samples_(kAverageFrameCount, 0.0f), next_sample_(0), sample_count_(0) {}
+
+void GpuProfiler::RollingAverage::Add(float sample) {
+  samples_[next_sample_] = sample;
+  next_sample_ = (next_sample_ + 1) % samples_.size();
+  if (sample_count_ < samples_.size()) {
+    ++sample_count_;
+  }
+}
+
+float GpuProfiler::RollingAverage::GetAverage() const {
+  if (sample_count_ == 0) {
+    return 0.0f;
+  }
+  float sum = 0.0f;
+  for (size_t i = 0; i < sample_count_; ++i) {
+    sum += samples_[i];
+  }
+  return sum / sample_count_;
+}
+
+GpuProfiler::GpuProfiler()
+    : frames_(kFrameLatency),
+      current_frame_(0),
+      is_frame_started_(false),
+      open_pass_(-1),
+      gl_initialized_(false),
+      is_supported_(false),
+      gen_queries_(NULL),
+      delete_queries_(NULL),
+      begin_query_(NULL),
+      end_query_(NULL),
+      get_query_objectuiv_(NULL),
+      get_query_objectui64v_(NULL) {}
+
+GpuProfiler::~GpuProfiler() {}
+
+int GpuProfiler::AddPass(const char* name) {
+  Pass pass;
+  pass.name = name;
+  passes_.push_back(pass);
+  return static_cast<int>(passes_.size()) - 1;
+}
+
+void GpuProfiler::InitializeGl() {
+  if (gl_initialized_) {
+    return;
+  }
+  gl_initialized_ = true;
+  is_frame_started_ = false;
+  open_pass_ = -1;
+  gen_queries_ = NULL;
+  delete_queries_ = NULL;
+  begin_query_ = NULL;
+  end_query_ = NULL;
+  get_query_objectuiv_ = NULL;
+  get_query_objectui64v_ = NULL;
+
+  if (util::IsGlExtensionSupported("GL_EXT_disjoint_timer_query")) {
+    gen_queries_ = reinterpret_cast<GenQueriesFunction>(
+        eglGetProcAddress("glGenQueriesEXT"));
+    delete_queries_ = reinterpret_cast<DeleteQueriesFunction>(
+        eglGetProcAddress("glDeleteQueriesEXT"));
+    begin_query_ = reinterpret_cast<BeginQueryFunction>(
+        eglGetProcAddress("glBeginQueryEXT"));
+    end_query_ =
+        reinterpret_cast<EndQueryFunction>(eglGetProcAddress("glEndQueryEXT"));
+    get_query_objectuiv_ = reinterpret_cast<GetQueryObjectuivFunction>(
+        eglGetProcAddress("glGetQueryObjectuivEXT"));
+    get_query_objectui64v_ = reinterpret_cast<GetQueryObjectui64vFunction>(
+        eglGetProcAddress("glGetQueryObjectui64vEXT"));
+  }
+  is_supported_ = gen_queries_ != NULL && delete_queries_ != NULL &&
+                  begin_query_ != NULL && end_query_ != NULL &&
+                  get_query_objectuiv_ != NULL &&
+                  get_query_objectui64v_ != NULL;
+  if (!is_supported_) {
+    LOGI("GpuProfiler: GL_EXT_disjoint_timer_query is not supported");
+    return;
+  }
+
+  for (Frame& frame : frames_) {
+    frame.queries.assign(passes_.size(), 0);
+    frame.is_issued.assign(passes_.size(), false);
+    frame.last_query = 0;
+    if (!passes_.empty()) {
+      gen_queries_(passes_.size(), frame.queries.data());
+    }
+  }
+  // Reading the disjoint flag clears it.
+  GLint disjoint;
+  glGetIntegerv(kGpuDisjoint, &disjoint);
+}
+
+void GpuProfiler::BeginFrame() {
+  const std::chrono::steady_clock::time_point now =
+      std::chrono::steady_clock::now();
+  if (is_frame_started_) {
+    frame_interval_.Add(
+        std::chrono::duration<float, std::milli>(now - last_frame_time_)
+            .count());
+  }
+  last_frame_time_ = now;
+
+  InitializeGl();
+  if (!is_supported_) {
+    is_frame_started_ = true;
+    return;
+  }
+  EndPass();
+  CollectResults();
+
+  current_frame_ = (current_frame_ + 1) % kFrameLatency;
+  Frame& frame = frames_[current_frame_];
+  // Results still not available after kFrameLatency frames are dropped.
+  frame.is_issued.assign(passes_.size(), false);
+  frame.last_query = 0;
+  is_frame_started_ = true;
+}
+
+void GpuProfiler::CollectResults() {
+  // A disjoint operation, e.g. a GPU frequency change, makes the results of
+  // every query in flight meaningless.
+  GLint disjoint = 0;
+  glGetIntegerv(kGpuDisjoint, &disjoint);
+  if (disjoint != 0) {
+    for (Frame& frame : frames_) {
+      frame.last_query = 0;
+    }
+    return;
+  }
+
+  for (size_t i = 1; i <= kFrameLatency; ++i) {
+    Frame& frame = frames_[(current_frame_ + i) % kFrameLatency];
+    if (frame.last_query == 0) {
+      continue;
+    }
+    // Queries complete in order, so the frame is done when its last one is,
+    // and the later frames are not if it is not.
+    GLuint is_available = 0;
+    get_query_objectuiv_(frame.last_query, kQueryResultAvailable,
+                         &is_available);
+    if (!is_available) {
+      break;
+    }
+    for (size_t pass = 0; pass < passes_.size(); ++pass) {
+      uint64_t elapsed = 0;
+      if (frame.is_issued[pass]) {
+        get_query_objectui64v_(frame.queries[pass], kQueryResult, &elapsed);
+      }
+      passes_[pass].time.Add(elapsed * kNanosecondToMillisecond);
+    }
+    frame.last_query = 0;
+  }
+}
+
+void GpuProfiler::BeginPass(int pass) {
+  if (!is_supported_ || !is_frame_started_ || open_pass_ >= 0 || pass < 0 ||
+      pass >= GetPassCount()) {
+    return;
+  }
+  Frame& frame = frames_[current_frame_];
+  if (frame.is_issued[pass]) {
+    return;
+  }
+  begin_query_(kTimeElapsed, frame.queries[pass]);
+  frame.is_issued[pass] = true;
+  frame.last_query = frame.queries[pass];
+  open_pass_ = pass;
+}
+
+void GpuProfiler::EndPass() {
+  if (open_pass_ < 0) {
+    return;
+  }
+  end_query_(kTimeElapsed);
+  open_pass_ = -1;
+}
+
+float GpuProfiler::GetPassTime(int pass) const {
+  return passes_[pass].time.GetAverage();
+}
+
+float GpuProfiler::GetTotalTime() const {
+  float total = 0.0f;
+  for (const Pass& pass : passes_) {
+    total += pass.time.GetAverage();
+  }
+  return total;
+}
+
+void GpuProfiler::DeleteGlResources() {
+  if (is_supported_) {
+    EndPass();
+    for (Frame& frame : frames_) {
+      if (!frame.queries.empty()) {
+        delete_queries_(frame.queries.size(), frame.queries.data());
+      }
+    }
+  }
+  InvalidateGlResources();
+}
+
+void GpuProfiler::InvalidateGlResources() {
+  for (Frame& frame : frames_) {
+    frame.queries.clear();
+    frame.is_issued.clear();
+    frame.last_query = 0;
+  }
+  gl_initialized_ = false;
+  is_supported_ = false;
+  is_frame_started_ = false;
+  open_pass_ = -1;
+}
+}  // namespace tango_gl
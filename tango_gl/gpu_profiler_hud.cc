@@ -0,0 +1,126 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-gl/gpu_profiler_hud.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include "tango-gl/color.h"
+#include "tango-gl/gl_state.h"
+
+namespace {
+// Layout in normalized device coordinates.
+const float kLeft = -0.95f;
+const float kTop = 0.9f;
+const float kRowHeight = 0.05f;
+// Width of the frame budget, longer bars are clipped at twice the budget.
+const float kBudgetWidth = 0.5f;
+const float kBudgetTime = 1000.0f / 60.0f;
+const float kBarWidth = 8.0f;
+// The text starts after the longest bars.
+const float kTextLeft = kLeft + 2.0f * kBudgetWidth + 0.02f;
+const int kTextPixelSize = 24;
+
+// Colors of the pass bars, reused when there are more passes.
+const tango_gl::Color kPassColors[] = {
+    tango_gl::Color(0.9f, 0.3f, 0.2f), tango_gl::Color(0.2f, 0.7f, 0.3f),
+    tango_gl::Color(0.2f, 0.4f, 0.9f), tango_gl::Color(0.9f, 0.7f, 0.1f),
+    tango_gl::Color(0.7f, 0.3f, 0.8f)};
+const tango_gl::Color kTotalColor(0.1f, 0.1f, 0.1f);
+const tango_gl::Color kFrameIntervalColor(0.5f, 0.5f, 0.5f);
+const tango_gl::Color kBudgetColor(1.0f, 0.0f, 0.0f);
+}  // namespace
+
+namespace tango_gl {
+
+GpuProfilerHud::GpuProfilerHud(const GpuProfiler* profiler)
+    : profiler_(profiler), budget_line_(new Line(2.0f, GL_LINES)) {
+  const size_t color_count = sizeof(kPassColors) / sizeof(kPassColors[0]);
+  const int bar_count = profiler_->GetPassCount() + 2;
+  for (int i = 0; i < bar_count; ++i) {
+    Line* bar = new Line(kBarWidth, GL_LINES);
+    bar->SetShader();
+    if (i < profiler_->GetPassCount()) {
+      bar_colors_.push_back(kPassColors[i % color_count]);
+    } else if (i == profiler_->GetPassCount()) {
+      bar_colors_.push_back(kTotalColor);
+    } else {
+      bar_colors_.push_back(kFrameIntervalColor);
+    }
+    bar->SetColor(bar_colors_.back());
+    bars_.emplace_back(bar);
+  }
+
+  const float budget_x = kLeft + kBudgetWidth;
+  const float bottom = kTop - bar_count * kRowHeight;
+  budget_line_->SetShader();
+  budget_line_->SetColor(kBudgetColor);
+  budget_line_->UpdateLineVertices(
+      {glm::vec3(budget_x, kTop + kRowHeight * 0.5f, 0.0f),
+       glm::vec3(budget_x, bottom + kRowHeight * 0.5f, 0.0f)});
+  text_.LoadSystemFont(kTextPixelSize);
+}
+
+GpuProfilerHud::~GpuProfilerHud() { text_.DeleteGlResources(); }
+
+void GpuProfilerHud::SetBar(Line* bar, int row, float time) {
+  const float length = std::min(time / kBudgetTime, 2.0f) * kBudgetWidth;
+  const float y = kTop - row * kRowHeight;
+  bar->UpdateLineVertices(
+      {glm::vec3(kLeft, y, 0.0f), glm::vec3(kLeft + length, y, 0.0f)});
+}
+
+void GpuProfilerHud::AddText(int row, const char* name, float time,
+                             const Color& color) {
+  char text[64];
+  snprintf(text, sizeof(text), "%s %.1f ms", name, time);
+  // The dark bars are written in white.
+  const float brightness = color.r + color.g + color.b;
+  text_.AddScreenText(text, glm::vec2(kTextLeft, kTop - row * kRowHeight),
+                      brightness < 0.5f ? Color(1.0f, 1.0f, 1.0f) : color);
+}
+
+void GpuProfilerHud::Render() {
+  const int pass_count = profiler_->GetPassCount();
+  for (int i = 0; i < pass_count; ++i) {
+    SetBar(bars_[i].get(), i, profiler_->GetPassTime(i));
+  }
+  SetBar(bars_[pass_count].get(), pass_count, profiler_->GetTotalTime());
+  SetBar(bars_[pass_count + 1].get(), pass_count + 1,
+         profiler_->GetFrameInterval());
+
+  // The bars are laid out in normalized device coordinates.
+  const glm::mat4 identity(1.0f);
+  GlState::Disable(GL_DEPTH_TEST);
+  for (const std::unique_ptr<Line>& bar : bars_) {
+    bar->Render(identity, identity);
+  }
+  budget_line_->Render(identity, identity);
+  if (text_.IsLoaded()) {
+    for (int i = 0; i < pass_count; ++i) {
+      AddText(i, profiler_->GetPassName(i), profiler_->GetPassTime(i),
+              bar_colors_[i]);
+    }
+    AddText(pass_count, "total", profiler_->GetTotalTime(),
+            bar_colors_[pass_count]);
+    AddText(pass_count + 1, "frame", profiler_->GetFrameInterval(),
+            bar_colors_[pass_count + 1]);
+    text_.Render(identity, identity);
+  }
+  GlState::Enable(GL_DEPTH_TEST);
+}
+}  // namespace tango_gl
@@ -16,28 +16,172 @@
 
 #include "tango-gl/grid.h"
 
+#include "tango-gl/gl_state.h"
+#include "tango-gl/render_statistics.h"
+#include "tango-gl/shaders.h"
+
+namespace {
+// Default distances at which procedural lines fade out, in meters.
+const float kDefaultFadeStart = 5.0f;
+const float kDefaultFadeEnd = 15.0f;
+
+// Lays the quad of FullScreenQuad on the xz plane over the grid, of
+// |half_size| cells on each side of the origin. The cell coordinates are
+// offset to put the lines on integers.
+const char kProceduralVertexShader[] =
+    TANGO_GL_GLSL_HIGHP
+    "attribute vec4 vertex;\n"
+    "uniform mat4 mvp;\n"
+    "uniform mat4 mv;\n"
+    "uniform vec2 half_size;\n"
+    "varying vec2 v_cell;\n"
+    "varying vec3 v_eye;\n"
+    "void main() {\n"
+    "  vec4 position =\n"
+    "      vec4(vertex.x * half_size.x, 0.0, vertex.y * half_size.y, 1.0);\n"
+    "  v_cell = position.xz + half_size;\n"
+    "  v_eye = (mv * position).xyz;\n"
+    "  gl_Position = mvp * position;\n"
+    "}\n";
+
+// The coverage of a pixel by the nearest line follows from its distance to
+// it, in pixels through the screen space derivatives of the cell coordinates.
+// Lines fade out where cells become a few pixels wide, before they alias, and
+// with the distance to the eye. Fragments left uncovered are discarded so
+// they do not write depth.
+const char kProceduralFragmentShader[] =
+    "#extension GL_OES_standard_derivatives : enable\n"
+    "#ifdef GL_FRAGMENT_PRECISION_HIGH\n"
+    "precision highp float;\n"
+    "#else\n"
+    "precision mediump float;\n"
+    "#endif\n"
+    "uniform vec4 color;\n"
+    "uniform float line_width;\n"
+    "uniform vec2 fade;\n"
+    "varying vec2 v_cell;\n"
+    "varying vec3 v_eye;\n"
+    "void main() {\n"
+    "  vec2 footprint = fwidth(v_cell);\n"
+    "  vec2 distance = abs(fract(v_cell - 0.5) - 0.5) / footprint;\n"
+    "  float coverage = clamp(0.5 * line_width + 0.5 -\n"
+    "                         min(distance.x, distance.y), 0.0, 1.0);\n"
+    "  coverage *= 1.0 - smoothstep(0.125, 0.333,\n"
+    "                               max(footprint.x, footprint.y));\n"
+    "  coverage *= 1.0 - smoothstep(fade.x, fade.y, length(v_eye));\n"
+    "  if (coverage <= 0.0) {\n"
+    "    discard;\n"
+    "  }\n"
+    "  gl_FragColor = vec4(color.rgb, color.a * coverage);\n"
+    "}\n";
+}  // namespace
+
 namespace tango_gl {
 
-// Initialize Grid with x and y grid count,
-// qx, quantity in x
-// qy, quantity in y.
-Grid::Grid(float density, int qx, int qy) : Line(1.0f, GL_LINES) {
-  SetShader();
+// Lines of a grid of cells of 1 by 1 centered on the origin, |cell_counts|
+// being the quantity in x in its high 16 bits and in y in its low ones.
+static void GenerateUnitGrid(int cell_counts,
+                             std::vector<glm::vec3>* vertices) {
+  const int qx = cell_counts >> 16;
+  const int qy = cell_counts & 0xffff;
 
-  // 3 float in 1 vertex, 2 vertices form a line.
+  // 2 vertices form a line.
   // Horizontal line and vertical line forms the grid.
-  float width = density * qx / 2;
-  float height = density * qy / 2;
+  float width = qx / 2.0f;
+  float height = qy / 2.0f;
+  vertices->reserve(2 * (qx + 1) + 2 * (qy + 1));
 
   // Horizontal line.
   for (int i = 0; i < (qy + 1); i++) {
-    vec_vertices_.push_back(glm::vec3(-width, 0.0f, -height + i * density));
-    vec_vertices_.push_back(glm::vec3(width, 0.0f, -height + i * density));
+    vertices->push_back(glm::vec3(-width, 0.0f, -height + i));
+    vertices->push_back(glm::vec3(width, 0.0f, -height + i));
   }
 
   for (int i = 0; i < (qx + 1); i++) {
-    vec_vertices_.push_back(glm::vec3(-width + i * density, 0.0f, -height));
-    vec_vertices_.push_back(glm::vec3(-width + i * density, 0.0f, height));
+    vertices->push_back(glm::vec3(-width + i, 0.0f, -height));
+    vertices->push_back(glm::vec3(-width + i, 0.0f, height));
+  }
+}
+
+// Initialize Grid with x and y grid count,
+// qx, quantity in x
+// qy, quantity in y.
+Grid::Grid(float density, int qx, int qy)
+    : Line(1.0f, GL_LINES),
+      half_size_(qx / 2.0f, 0.0f, qy / 2.0f),
+      is_procedural_(false),
+      fade_start_(kDefaultFadeStart),
+      fade_end_(kDefaultFadeEnd),
+      procedural_program_(0),
+      uniform_procedural_mvp_(-1),
+      uniform_procedural_mv_(-1),
+      uniform_procedural_color_(-1),
+      uniform_half_size_(-1),
+      uniform_line_width_(-1),
+      uniform_fade_(-1) {
+  SetShader();
+  SetSharedVertices(&GenerateUnitGrid, (qx << 16) | (qy & 0xffff));
+  SetScale(glm::vec3(density, 1.0f, density));
+}
+
+bool Grid::SetProcedural(bool is_procedural) {
+  if (!is_procedural || procedural_program_ != 0) {
+    is_procedural_ = is_procedural;
+    return true;
+  }
+  if (!util::IsGlExtensionSupported("GL_OES_standard_derivatives")) {
+    LOGI("Grid: GL_OES_standard_derivatives is not supported, drawing lines");
+    return false;
+  }
+  const util::SharedProgram* program = util::GetSharedProgram(
+      kProceduralVertexShader, kProceduralFragmentShader);
+  if (!program) {
+    LOGE("Grid: could not create the procedural program");
+    return false;
+  }
+  procedural_program_ = program->GetId();
+  uniform_procedural_mvp_ = program->GetUniformLocation("mvp");
+  uniform_procedural_mv_ = program->GetUniformLocation("mv");
+  uniform_procedural_color_ = program->GetUniformLocation("color");
+  uniform_half_size_ = program->GetUniformLocation("half_size");
+  uniform_line_width_ = program->GetUniformLocation("line_width");
+  uniform_fade_ = program->GetUniformLocation("fade");
+  quad_.SetAttributeLocations(program->GetAttribLocation("vertex"), -1);
+  is_procedural_ = true;
+  return true;
+}
+
+void Grid::Render(const glm::mat4& projection_mat,
+                  const glm::mat4& view_mat) const {
+  if (!is_procedural_) {
+    Line::Render(projection_mat, view_mat);
+    return;
+  }
+  const bool was_blending = glIsEnabled(GL_BLEND) == GL_TRUE;
+  const bool was_culling = glIsEnabled(GL_CULL_FACE) == GL_TRUE;
+  GlState::Enable(GL_BLEND);
+  GlState::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  // The grid is seen from both sides.
+  GlState::Disable(GL_CULL_FACE);
+
+  GlState::UseProgram(procedural_program_);
+  const glm::mat4 mv_mat = view_mat * GetTransformationMatrix();
+  const glm::mat4 mvp_mat = projection_mat * mv_mat;
+  glUniformMatrix4fv(uniform_procedural_mvp_, 1, GL_FALSE,
+                     glm::value_ptr(mvp_mat));
+  glUniformMatrix4fv(uniform_procedural_mv_, 1, GL_FALSE,
+                     glm::value_ptr(mv_mat));
+  glUniform4f(uniform_procedural_color_, red_, green_, blue_, alpha_);
+  glUniform2f(uniform_half_size_, half_size_.x, half_size_.z);
+  glUniform1f(uniform_line_width_, line_width_);
+  glUniform2f(uniform_fade_, fade_start_, fade_end_);
+  quad_.Draw();
+
+  if (!was_blending) {
+    GlState::Disable(GL_BLEND);
+  }
+  if (was_culling) {
+    GlState::Enable(GL_CULL_FACE);
   }
 }
 }  // namespace tango_gl
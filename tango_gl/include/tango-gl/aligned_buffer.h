@@ -0,0 +1,212 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_GL_ALIGNED_BUFFER_H_
+#define TANGO_GL_ALIGNED_BUFFER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "tango-gl/memory_accounting.h"
+
+namespace tango_gl {
+
+// Alignment of the start of every AlignedBuffer, a cache line, so that SIMD
+// kernels can use aligned loads and no two buffers share a line.
+const size_t kBufferAlignment = 64;
+
+// @return: |row_bytes| rounded up to kBufferAlignment, the stride for the
+//          rows of an image to each start aligned.
+inline size_t GetAlignedStride(size_t row_bytes) {
+  return (row_bytes + kBufferAlignment - 1) & ~(kBufferAlignment - 1);
+}
+
+// BufferPool keeps the blocks the AlignedBuffers free, by size class, for
+// the next buffer of the same class, so that the image and point cloud
+// buffers of a new session, or of a frame size seen before, reuse the
+// memory of the last one instead of allocating it again. The size classes
+// are four per power of two, which wastes at most a fifth of a block.
+//
+// The blocks kept appear as "buffer_pool" in the memory report. Past
+// |max_pooled_bytes| the blocks freed are returned to the system, and
+// Trim() returns all of them, e.g. when the app goes to the background:
+//
+//   tango_gl::BufferPool::GetInstance()->Trim();
+class BufferPool {
+ public:
+  struct Statistics {
+    // Blocks allocated from the system, and those taken from the pool.
+    uint64_t allocation_count;
+    uint64_t reuse_count;
+    // Kept in the pool right now.
+    size_t pooled_bytes;
+  };
+
+  explicit BufferPool(size_t max_pooled_bytes);
+  ~BufferPool();
+  BufferPool(const BufferPool& other) = delete;
+  BufferPool& operator=(const BufferPool&) = delete;
+
+  // @return: the pool of the process, which keeps up to 64 MB.
+  static BufferPool* GetInstance();
+
+  // @return: a block of at least |size| bytes aligned to kBufferAlignment,
+  //          of |*capacity| bytes, or nullptr if it cannot be allocated.
+  void* Acquire(size_t size, size_t* capacity);
+
+  // Keep |block| of Acquire() for another buffer, or free it if the pool is
+  // full. Can be called on any thread.
+  void Release(void* block, size_t capacity);
+
+  // Free the blocks kept.
+  void Trim();
+
+  Statistics GetStatistics() const;
+
+  // @return: the capacity of the blocks for |size| bytes.
+  static size_t GetSizeClass(size_t size);
+
+ private:
+  const size_t max_pooled_bytes_;
+
+  mutable std::mutex mutex_;
+  std::map<size_t, std::vector<void*>> free_blocks_;
+  Statistics statistics_;
+  MemoryAccount memory_;
+};
+
+// AlignedBuffer is the std::vector of the image and point cloud buffers: an
+// array of |T| starting on kBufferAlignment, whose block comes from and goes
+// back to BufferPool::GetInstance().
+//
+//   tango_gl::AlignedBuffer<uint8_t> rgb_buffer_;
+//   ...
+//   rgb_buffer_.resize(width * height * 3);
+//   yuv_converter::Nv21ToRgb(yuv, width, height, rgb_buffer_.data());
+//
+// |T| must be trivially copyable: the elements are moved with memcpy() and
+// never constructed or destroyed, so resize() leaves the new ones
+// uninitialized, and assign() is the way to clear them.
+template <typename T>
+class AlignedBuffer {
+ public:
+  AlignedBuffer() : data_(nullptr), size_(0), capacity_(0), bytes_(0) {}
+  explicit AlignedBuffer(size_t count) : AlignedBuffer() { resize(count); }
+  AlignedBuffer(AlignedBuffer&& other)
+      : data_(other.data_),
+        size_(other.size_),
+        capacity_(other.capacity_),
+        bytes_(other.bytes_) {
+    other.data_ = nullptr;
+    other.size_ = 0;
+    other.capacity_ = 0;
+    other.bytes_ = 0;
+  }
+  AlignedBuffer& operator=(AlignedBuffer&& other) {
+    swap(other);
+    return *this;
+  }
+  AlignedBuffer(const AlignedBuffer& other) = delete;
+  AlignedBuffer& operator=(const AlignedBuffer&) = delete;
+  ~AlignedBuffer() { ReleaseBlock(); }
+
+  T* data() { return data_; }
+  const T* data() const { return data_; }
+  size_t size() const { return size_; }
+  size_t capacity() const { return capacity_; }
+  bool empty() const { return size_ == 0; }
+
+  T& operator[](size_t i) { return data_[i]; }
+  const T& operator[](size_t i) const { return data_[i]; }
+  T* begin() { return data_; }
+  T* end() { return data_ + size_; }
+  const T* begin() const { return data_; }
+  const T* end() const { return data_ + size_; }
+
+  // Keep the first |count| elements, the ones past the previous size being
+  // uninitialized.
+  void resize(size_t count) {
+    reserve(count);
+    size_ = count;
+  }
+
+  void reserve(size_t count) {
+    if (count <= capacity_) {
+      return;
+    }
+    size_t bytes;
+    T* data = static_cast<T*>(
+        BufferPool::GetInstance()->Acquire(count * sizeof(T), &bytes));
+    if (data == nullptr) {
+      // As std::vector, but without exceptions to throw.
+      abort();
+    }
+    if (size_ != 0) {
+      memcpy(data, data_, size_ * sizeof(T));
+    }
+    ReleaseBlock();
+    data_ = data;
+    capacity_ = bytes / sizeof(T);
+    bytes_ = bytes;
+  }
+
+  void assign(size_t count, const T& value) {
+    resize(count);
+    std::fill(data_, data_ + size_, value);
+  }
+
+  // Empty the buffer, keeping its block.
+  void clear() { size_ = 0; }
+
+  // Return the block of an empty buffer to the pool.
+  void shrink_to_fit() {
+    if (size_ == 0) {
+      ReleaseBlock();
+    }
+  }
+
+  void swap(AlignedBuffer& other) {
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+    std::swap(capacity_, other.capacity_);
+    std::swap(bytes_, other.bytes_);
+  }
+
+ private:
+  void ReleaseBlock() {
+    if (data_ != nullptr) {
+      BufferPool::GetInstance()->Release(data_, bytes_);
+    }
+    data_ = nullptr;
+    capacity_ = 0;
+    bytes_ = 0;
+  }
+
+  T* data_;
+  size_t size_;
+  size_t capacity_;
+  // Of the block, which capacity_ may not divide evenly.
+  size_t bytes_;
+};
+}  // namespace tango_gl
+#endif  // TANGO_GL_ALIGNED_BUFFER_H_
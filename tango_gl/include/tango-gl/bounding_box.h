@@ -28,11 +28,25 @@ class BoundingBox {
   BoundingBox()
       : bounding_min_(glm::vec3(0, 0, 0)), bounding_max_(glm::vec3(0, 0, 0)) {}
   explicit BoundingBox(const std::vector<float>& vertices);
+  explicit BoundingBox(const std::vector<glm::vec3>& vertices);
   BoundingBox(const glm::vec3& min, const glm::vec3& max)
       : bounding_min_(min), bounding_max_(max) {}
+  // Test a segment against the box transformed by |transformation|. The
+  // rotation is part of the transformation, |rotation| is unused.
   bool IsIntersecting(const Segment& segment, const glm::quat& rotation,
                       const glm::mat4& transformation);
 
+  const glm::vec3& GetMin() const { return bounding_min_; }
+  const glm::vec3& GetMax() const { return bounding_max_; }
+  glm::vec3 GetCenter() const { return (bounding_min_ + bounding_max_) * 0.5f; }
+
+  // Grow the box to contain |other|.
+  void Merge(const BoundingBox& other);
+
+  // @return the axis-aligned box containing this box once transformed by
+  //         |transformation|, which must be affine.
+  BoundingBox GetTransformed(const glm::mat4& transformation) const;
+
  private:
   // Axis-aligned bounding box minimum and maximum point.
   glm::vec3 bounding_min_;
@@ -0,0 +1,161 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_GL_BOUNDING_VOLUME_HIERARCHY_H_
+#define TANGO_GL_BOUNDING_VOLUME_HIERARCHY_H_
+
+#include <vector>
+
+#include "tango-gl/bounding_box.h"
+#include "tango-gl/drawable_object.h"
+#include "tango-gl/oriented_bounding_box.h"
+#include "tango-gl/segment.h"
+#include "tango-gl/view_frustum.h"
+
+namespace tango_gl {
+// BoundingVolumeHierarchy sorts the objects of a scene into a tree of
+// axis-aligned boxes, so the objects outside of the view can be skipped with
+// a few box tests instead of being drawn.
+//
+// The tree is built from the world space box of every object, taken from
+// its box in model space and its current transformation. Objects that move
+// need an Update() before the next Render(), which refits the boxes of the
+// tree in place and only rebuilds it once the objects moved so far that the
+// refitted tree got too costly to query. Objects that never move are best
+// kept in a hierarchy of their own, which is built once and never updated.
+//
+// The hierarchy keeps pointers to the objects, which must outlive it or be
+// removed with Clear().
+class BoundingVolumeHierarchy {
+ public:
+  struct Options {
+    Options();
+
+    // Update() rebuilds the tree once the surface area heuristic cost of
+    // the refitted tree is this many times that of the tree as built.
+    float max_cost_ratio;
+  };
+
+  BoundingVolumeHierarchy();
+  explicit BoundingVolumeHierarchy(const Options& options);
+  BoundingVolumeHierarchy(const BoundingVolumeHierarchy& other) = delete;
+  BoundingVolumeHierarchy& operator=(const BoundingVolumeHierarchy&) =
+      delete;
+
+  // Add an object whose vertices lie in |local_box|, in its model space,
+  // e.g. Mesh::GetBoundingBox(). The tree is rebuilt on the next Update(),
+  // Cull() or Render().
+  void Add(const DrawableObject* object, const BoundingBox& local_box);
+
+  // Add an object with its oriented box too, e.g.
+  // Mesh::GetOrientedBoundingBox(). The tree is built from the axis-aligned
+  // boxes, and the object is culled and picked against its oriented box
+  // once its node could not reject it.
+  void Add(const DrawableObject* object, const BoundingBox& local_box,
+           const OrientedBoundingBox& local_oriented_box);
+
+  // Remove every object.
+  void Clear();
+
+  // Recompute the world space boxes from the current transformation of the
+  // objects. The tree keeps its structure and only has its boxes refitted,
+  // unless objects were added since it was built or the refit raised its
+  // cost past Options::max_cost_ratio.
+  void Update();
+
+  // Append the objects that may be visible in |frustum| to |visible|.
+  void Cull(const ViewFrustum& frustum,
+            std::vector<const DrawableObject*>* visible);
+
+  // Draw the objects that may be visible with these matrices.
+  void Render(const glm::mat4& projection_mat, const glm::mat4& view_mat);
+
+  // Append the objects whose world space box the segment goes through to
+  // |hits|, e.g. to pick from a touch ray. Only the subtrees the segment
+  // reaches are visited.
+  void Intersect(const Segment& segment,
+                 std::vector<const DrawableObject*>* hits);
+
+  // Find the object whose world space box the segment enters first, e.g. the
+  // one under a touch. The subtrees are visited nearest first, and those the
+  // segment reaches past the nearest box found so far are skipped.
+  //
+  // @param fraction: set to where the segment enters the box, in [0, 1] of
+  //                  its length.
+  // @param normal: set to the normal of the face of the box it enters
+  //                through, facing the start of the segment.
+  // @return the object, or NULL if the segment misses every box or starts
+  //         inside the one it goes through.
+  const DrawableObject* IntersectNearest(const Segment& segment,
+                                         float* fraction, glm::vec3* normal);
+
+  size_t GetObjectCount() const { return entries_.size(); }
+
+  // @return: the surface area heuristic cost of the tree as of the last
+  //          Update(), the boxes a query through it is expected to test,
+  //          and the number of times it was built.
+  float GetCost() const { return cost_; }
+  int GetBuildCount() const { return build_count_; }
+
+ private:
+  struct Entry {
+    const DrawableObject* object;
+    BoundingBox local_box;
+    BoundingBox world_box;
+    bool has_oriented_box;
+    OrientedBoundingBox local_oriented_box;
+    OrientedBoundingBox world_oriented_box;
+  };
+
+  // Every node covers a contiguous range of entries_. The left child of an
+  // inner node is the next node, leaves have no right child.
+  struct Node {
+    BoundingBox box;
+    size_t first_entry;
+    size_t entry_count;
+    int right_child;
+  };
+
+  void Build();
+  // @return: the surface area heuristic cost of nodes_, each box being
+  //          tested with the probability of its area over that of the root.
+  float ComputeCost() const;
+  // Build the subtree of entries [first, first + count) and return its root.
+  int BuildNode(size_t first, size_t count);
+  void CullNode(int node_index, const ViewFrustum& frustum,
+                std::vector<const DrawableObject*>* visible) const;
+  void IntersectNode(int node_index, const Segment& segment,
+                     std::vector<const DrawableObject*>* hits) const;
+  // Lower |nearest| to the entry of the nearest box of the subtree,
+  // |object| and |axis| being the one of that box and of its entry face.
+  void IntersectNearestNode(int node_index, const glm::vec3& start,
+                            const glm::vec3& direction, float* nearest,
+                            const DrawableObject** object, int* axis) const;
+
+  const Options options_;
+  std::vector<Entry> entries_;
+  std::vector<Node> nodes_;
+  bool needs_build_;
+  float cost_;
+  // Cost of the tree when it was last built.
+  float built_cost_;
+  int build_count_;
+
+  // Reused by Render().
+  std::vector<const DrawableObject*> visible_objects_;
+};
+}  // namespace tango_gl
+#endif  // TANGO_GL_BOUNDING_VOLUME_HIERARCHY_H_
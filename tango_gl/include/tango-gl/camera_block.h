@@ -0,0 +1,64 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_GL_CAMERA_BLOCK_H_
+#define TANGO_GL_CAMERA_BLOCK_H_
+
+#include <stdint.h>
+
+#include "tango-gl/util.h"
+
+namespace tango_gl {
+
+// The camera matrices of a frame, shared by every drawable rendered with
+// them, so that a drawable only multiplies its model matrix in:
+//
+//   const CameraBlock& camera = GetCameraBlock(projection_mat, view_mat);
+//   const glm::mat4 mvp_mat = camera.view_projection * model_mat;
+//
+// and the instanced paths, whose shaders take the camera matrices as they
+// are, upload them once per program and camera:
+//
+//   if (!IsCameraUploaded(program->GetId(), camera)) {
+//     glUniformMatrix4fv(vp_location, 1, GL_FALSE,
+//                        glm::value_ptr(camera.view_projection));
+//   }
+struct CameraBlock {
+  glm::mat4 projection;
+  glm::mat4 view;
+  glm::mat4 view_projection;
+  // Changes whenever the matrices do.
+  uint32_t generation;
+};
+
+// @return the block of |projection| and |view|, only computed again when
+//         they differ from those of the previous call, usually once a frame.
+//         Each thread has its own block, which the next call with other
+//         matrices changes. Must be called on the GL thread.
+const CameraBlock& GetCameraBlock(const glm::mat4& projection,
+                                  const glm::mat4& view);
+
+// Record that |program| holds the camera matrices of |camera| in its
+// uniforms, for the callers that upload them all at once.
+//
+// @return true if it already did, and the upload can be skipped.
+bool IsCameraUploaded(GLuint program, const CameraBlock& camera);
+
+// Forget the uploads to |program|, e.g. before it is deleted and its name
+// reused.
+void ForgetCameraUploads(GLuint program);
+}  // namespace tango_gl
+#endif  // TANGO_GL_CAMERA_BLOCK_H_
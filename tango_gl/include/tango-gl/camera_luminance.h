@@ -0,0 +1,150 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_GL_CAMERA_LUMINANCE_H_
+#define TANGO_GL_CAMERA_LUMINANCE_H_
+
+#include <stdint.h>
+
+#include <functional>
+#include <vector>
+
+#include "tango-gl/util.h"
+
+namespace tango_gl {
+
+// CameraLuminance gives the CPU a small luminance image of the color camera
+// texture, the GL_TEXTURE_EXTERNAL_OES one of TangoService_connectTextureId,
+// so that an app reading images on the CPU does not also need
+// TangoService_connectOnFrameAvailable and its copies of the full image:
+//
+//   // Every frame, once TangoService_updateTexture() updated the texture.
+//   luminance_.ReadFinishedImages([&](const uint8_t* luminance, int width,
+//                                     int height, double timestamp) {
+//     pyramid_.OnLuminanceAvailable(luminance, width, height, width,
+//                                   timestamp);
+//   });
+//   luminance_.Render(camera_texture_id, color_timestamp);
+//
+// Render() averages blocks of the camera image on the GPU into a framebuffer
+// of the size of SetSize(), and queues its read back into a pixel pack
+// buffer followed by a fence, as FrameCapture does. ReadFinishedImages()
+// maps the buffers whose fence signaled, a frame or two later. The image is
+// dropped when every buffer is still in flight. Without GLES 3.0 nothing is
+// read.
+//
+// The framebuffer is RGBA with 4 luminance pixels per texel, since GLES only
+// guarantees glReadPixels() of RGBA for color-renderable formats.
+//
+// All methods must be called on the GL thread.
+class CameraLuminance {
+ public:
+  // Called with the top-down rows of luminance, without padding, valid for
+  // the duration of the call.
+  typedef std::function<void(const uint8_t* luminance, int width, int height,
+                             double timestamp)> ImageCallback;
+
+  CameraLuminance();
+  CameraLuminance(const CameraLuminance& other) = delete;
+  CameraLuminance& operator=(const CameraLuminance&) = delete;
+  ~CameraLuminance();
+
+  // Set the size of the luminance image, e.g. half the camera image for the
+  // first level of an ImagePyramid. The width is rounded down to a multiple
+  // of 4. Images rendered before still read back at their size.
+  void SetSize(int width, int height);
+  int GetWidth() const { return width_; }
+  int GetHeight() const { return height_; }
+
+  // Render the luminance of |camera_texture| and queue its read back. The
+  // bound framebuffer, viewport and program are restored after it.
+  //
+  // @param timestamp: passed along with the image, the timestamp of the
+  //        camera image in the texture.
+  //
+  // @return false if the image was dropped, or reading it is not supported.
+  bool Render(GLuint camera_texture, double timestamp);
+
+  // Call |callback| with each image the GPU finished, oldest first.
+  //
+  // @return the number of images read.
+  int ReadFinishedImages(const ImageCallback& callback);
+
+  // @return true if the GL context supports the read back, once Render() was
+  // called.
+  bool IsSupported() const { return is_supported_; }
+
+  // @return the images Render() dropped because none of the buffers was
+  // free.
+  uint64_t GetDroppedCount() const { return dropped_count_; }
+
+  // Delete the framebuffer, program, buffers and fences.
+  void DeleteGlResources();
+
+  // Forget the GL objects without deleting them, for when the GL context they
+  // belonged to has been destroyed.
+  void InvalidateGlResources();
+
+ private:
+  // An image in flight.
+  struct Readback {
+    GLuint buffer;
+    GLsizeiptr capacity;
+    // Set while the image has not been read.
+    util::GlCapabilities::Sync fence;
+    int width;
+    int height;
+    double timestamp;
+  };
+
+  // Look up the entry points and create the program and buffers of the
+  // current context, once until InvalidateGlResources().
+  void InitializeGl();
+
+  // (Re)create the framebuffer at the size of SetSize().
+  bool InitializeFramebuffer();
+
+  int width_;
+  int height_;
+
+  bool gl_initialized_;
+  bool is_supported_;
+  util::GlCapabilities::MapBufferRangeFunction map_buffer_range_;
+  util::GlCapabilities::UnmapBufferFunction unmap_buffer_;
+  util::GlCapabilities::FenceSyncFunction fence_sync_;
+  util::GlCapabilities::ClientWaitSyncFunction client_wait_sync_;
+  util::GlCapabilities::DeleteSyncFunction delete_sync_;
+
+  GLuint program_;
+  GLint vertex_location_;
+  GLint camera_location_;
+  GLint texel_size_location_;
+  GLuint vertex_buffer_;
+
+  // Of framebuffer_width_ x framebuffer_height_ texels, the first being 4
+  // times narrower than the image.
+  GLuint framebuffer_;
+  GLuint framebuffer_texture_;
+  int framebuffer_width_;
+  int framebuffer_height_;
+
+  // Ring of read backs, the oldest being read first.
+  std::vector<Readback> readbacks_;
+  size_t next_readback_;
+  uint64_t dropped_count_;
+};
+}  // namespace tango_gl
+#endif  // TANGO_GL_CAMERA_LUMINANCE_H_
@@ -20,6 +20,9 @@
 #include "tango-gl/mesh.h"
 
 namespace tango_gl {
+// A disc in the xz plane. The unit circles of a resolution are generated once
+// per GL context and shared by every instance, the radius is the scale of the
+// model matrix: setting another scale resizes the circle.
 class Circle : public Mesh {
  public:
   Circle(float radius, int resolution);
@@ -23,6 +23,8 @@
 #include "glm/gtc/matrix_transform.hpp"
 #include "glm/gtc/quaternion.hpp"
 
+#include "tango-gl/simd_math.h"
+
 namespace tango_gl {
 namespace conversions {
 
@@ -54,7 +56,7 @@ inline glm::quat QuatFromArray(const double* array) {
 inline glm::mat4 TransformFromArrays(const double* A_p_B, const double* A_q_B) {
   glm::vec3 glm_A_p_B = Vec3FromArray(A_p_B);
   glm::quat glm_A_q_B = QuatFromArray(A_q_B);
-  return glm::translate(glm::mat4(1.0f), glm_A_p_B) * glm::mat4_cast(glm_A_q_B);
+  return simd_math::RigidFromQuat(glm_A_q_B, glm_A_p_B);
 }
 
 /**
@@ -68,7 +70,7 @@ inline glm::mat4 TransformFromArrays(const double* A_p_B, const double* A_q_B) {
  */
 inline glm::mat4 TransformFromVecAndQuat(const glm::vec3& A_p_B,
                                          const glm::quat& A_q_B) {
-  return glm::translate(glm::mat4(1.0f), A_p_B) * glm::mat4_cast(A_q_B);
+  return simd_math::RigidFromQuat(A_q_B, A_p_B);
 }
 
 /**
@@ -108,26 +110,167 @@ inline glm::vec3 Vec3GlToTango(const glm::vec3& gl_vec) {
  */
 glm::quat QuatTangoToGl(const glm::quat& tango_q_any);
 
+namespace internal {
+// Entry |i| of (|v0|, |v1|, |v2|).
+constexpr int Select(int v0, int v1, int v2, int i) {
+  return i == 0 ? v0 : (i == 1 ? v1 : v2);
+}
+
+// The row of a permutation whose rows 0 and 1 read |axis0| and |axis1| that
+// reads axis |axis|, which is the axis row |axis| of the inverse reads. Row 2
+// reads the remaining axis.
+constexpr int RowOfAxis(int axis0, int axis1, int axis) {
+  return axis0 == axis ? 0 : (axis1 == axis ? 1 : 2);
+}
+}  // namespace internal
+
+/**
+ * @brief A rotation that only permutes the axes and flips their signs, the
+ * kind of the fixed transformations between the Tango and OpenGL frame
+ * conventions. Row i of its matrix holds Sign_i in column Axis_i, that is
+ * p'[i] = Sign_i * p[Axis_i].
+ *
+ * The permutation is in the type, so applying one to a vector or a matrix is a
+ * swizzle with sign flips the compiler resolves, instead of a matrix product,
+ * and composing or inverting them happens at compile time:
+ *
+ *   const glm::mat4 opengl_world_T_device =
+ *       conversions::kOpenGlWorldTTangoWorld * start_service_T_device;
+ */
+template <int Axis0, int Sign0, int Axis1, int Sign1, int Axis2, int Sign2>
+struct AxisPermutation {
+  static_assert(Axis0 >= 0 && Axis0 < 3 && Axis1 >= 0 && Axis1 < 3 &&
+                    Axis2 >= 0 && Axis2 < 3 && Axis0 != Axis1 &&
+                    Axis0 != Axis2 && Axis1 != Axis2,
+                "The axes must be a permutation of 0, 1 and 2.");
+  static_assert((Sign0 == 1 || Sign0 == -1) && (Sign1 == 1 || Sign1 == -1) &&
+                    (Sign2 == 1 || Sign2 == -1),
+                "The signs must be 1 or -1.");
+
+  /// The transposed permutation, which undoes this one.
+  typedef AxisPermutation<
+      internal::RowOfAxis(Axis0, Axis1, 0),
+      internal::Select(Sign0, Sign1, Sign2,
+                       internal::RowOfAxis(Axis0, Axis1, 0)),
+      internal::RowOfAxis(Axis0, Axis1, 1),
+      internal::Select(Sign0, Sign1, Sign2,
+                       internal::RowOfAxis(Axis0, Axis1, 1)),
+      internal::RowOfAxis(Axis0, Axis1, 2),
+      internal::Select(Sign0, Sign1, Sign2,
+                       internal::RowOfAxis(Axis0, Axis1, 2))>
+      Inverse;
+
+  constexpr Inverse GetInverse() const { return Inverse(); }
+
+  /// The permutation as a matrix, for code that needs one.
+  glm::mat4 ToMatrix() const {
+    glm::mat4 matrix(0.0f);
+    matrix[Axis0][0] = static_cast<float>(Sign0);
+    matrix[Axis1][1] = static_cast<float>(Sign1);
+    matrix[Axis2][2] = static_cast<float>(Sign2);
+    matrix[3][3] = 1.0f;
+    return matrix;
+  }
+
+  glm::vec3 operator*(const glm::vec3& p) const {
+    return glm::vec3(Sign0 * p[Axis0], Sign1 * p[Axis1], Sign2 * p[Axis2]);
+  }
+
+  glm::vec4 operator*(const glm::vec4& p) const {
+    return glm::vec4(Sign0 * p[Axis0], Sign1 * p[Axis1], Sign2 * p[Axis2],
+                     p[3]);
+  }
+
+  /// Permutes the rows of |m|.
+  glm::mat4 operator*(const glm::mat4& m) const {
+    return glm::mat4((*this) * m[0], (*this) * m[1], (*this) * m[2],
+                     (*this) * m[3]);
+  }
+
+  /// Composes two permutations into the one applying |other| first.
+  template <int B0, int S0, int B1, int S1, int B2, int S2>
+  constexpr AxisPermutation<
+      internal::Select(B0, B1, B2, Axis0),
+      Sign0 * internal::Select(S0, S1, S2, Axis0),
+      internal::Select(B0, B1, B2, Axis1),
+      Sign1 * internal::Select(S0, S1, S2, Axis1),
+      internal::Select(B0, B1, B2, Axis2),
+      Sign2 * internal::Select(S0, S1, S2, Axis2)>
+  operator*(const AxisPermutation<B0, S0, B1, S1, B2, S2>&) const {
+    return AxisPermutation<internal::Select(B0, B1, B2, Axis0),
+                           Sign0 * internal::Select(S0, S1, S2, Axis0),
+                           internal::Select(B0, B1, B2, Axis1),
+                           Sign1 * internal::Select(S0, S1, S2, Axis1),
+                           internal::Select(B0, B1, B2, Axis2),
+                           Sign2 * internal::Select(S0, S1, S2, Axis2)>();
+  }
+
+  /// Permutes the columns of |m|: column Axis_i of the product is Sign_i
+  /// times column i of |m|.
+  friend glm::mat4 operator*(const glm::mat4& m, const AxisPermutation&) {
+    glm::mat4 result;
+    result[Axis0] = static_cast<float>(Sign0) * m[0];
+    result[Axis1] = static_cast<float>(Sign1) * m[1];
+    result[Axis2] = static_cast<float>(Sign2) * m[2];
+    result[3] = m[3];
+    return result;
+  }
+};
+
+/**
+ * The fixed transformation relating the opengl frame convention (with Y-up,
+ * X-right) and the tango frame convention for the start-of-service and ADF
+ * frames (with Z-up, X-right), termed "world" here. Same as
+ * Vec3TangoToGl().
+ */
+typedef AxisPermutation<0, 1, 2, 1, 1, -1> OpenGlWorldTTangoWorld;
+constexpr OpenGlWorldTTangoWorld kOpenGlWorldTTangoWorld{};
+
+/**
+ * The fixed transformation relating the frame convention of the device's
+ * color camera frame (with Z-forward, X-right) and the opengl camera frame
+ * (with Z-backward, X-right).
+ */
+typedef AxisPermutation<0, 1, 1, -1, 2, -1> ColorCameraTOpenGlCamera;
+constexpr ColorCameraTOpenGlCamera kColorCameraTOpenGlCamera{};
+
+/**
+ * The fixed transformation relating the frame convention of the device's
+ * depth camera frame (with Z-forward, X-right) and the opengl camera frame
+ * (with Z-backward, X-right).
+ */
+typedef AxisPermutation<0, 1, 1, -1, 2, -1> DepthCameraTOpenGlCamera;
+constexpr DepthCameraTOpenGlCamera kDepthCameraTOpenGlCamera{};
+
 /**
  * Get the fixed transformation matrix relating the opengl frame convention
  * (with Y-up, X-right) and the tango frame convention for the start-of-service
- * and ADF frames (with Z-up, X-right), termed "world" here.
+ * and ADF frames (with Z-up, X-right), termed "world" here. Prefer
+ * kOpenGlWorldTTangoWorld in per-frame code.
  */
-glm::mat4 opengl_world_T_tango_world();
+inline glm::mat4 opengl_world_T_tango_world() {
+  return kOpenGlWorldTTangoWorld.ToMatrix();
+}
 
 /**
  * Get the fixed transformation matrix relating the frame convention of the
  * device's color camera frame (with Z-forward, X-right) and the opengl camera
- * frame (with Z-backward, X-right).
+ * frame (with Z-backward, X-right). Prefer kColorCameraTOpenGlCamera in
+ * per-frame code.
  */
-glm::mat4 color_camera_T_opengl_camera();
+inline glm::mat4 color_camera_T_opengl_camera() {
+  return kColorCameraTOpenGlCamera.ToMatrix();
+}
 
 /**
  * Get the fixed transformation matrix relating the frame convention of the
  * device's depth camera frame (with Z-forward, X-right) and the opengl camera
- * frame (with Z-backward, X-right).
+ * frame (with Z-backward, X-right). Prefer kDepthCameraTOpenGlCamera in
+ * per-frame code.
  */
-glm::mat4 depth_camera_T_opengl_camera();
+inline glm::mat4 depth_camera_T_opengl_camera() {
+  return kDepthCameraTOpenGlCamera.ToMatrix();
+}
 
 }  // namespace conversions
 }  // namespace tango_gl
@@ -0,0 +1,84 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef TANGO_GL_DEPTH_OCCLUDER_H_
+#define TANGO_GL_DEPTH_OCCLUDER_H_
+
+#include "tango-gl/quantized_points.h"
+#include "tango-gl/streaming_vertex_buffer.h"
+#include "tango-gl/util.h"
+
+namespace tango_gl {
+// DepthOccluder fills the depth buffer with the point cloud of the depth
+// camera, so that the virtual objects drawn after it are hidden behind the
+// real geometry in front of them. The points are splatted depth only, over
+// the camera image drawn without depth test:
+//
+//   occluder_->UpdatePoints(point_cloud->xyz[0], point_cloud->xyz_count);
+//   ...
+//   video_overlay_->Render(glm::mat4(1.0f), glm::mat4(1.0f));
+//   occluder_->Render(projection_mat, view_mat, world_T_depth_camera,
+//                     viewport_height);
+//   objects_->Render(projection_mat, view_mat);
+//
+// At most the point budget is drawn, as an even subsample of the cloud with
+// larger splats, so the pass costs the same whatever the scene draws. It
+// splats the points of DepthImage::RenderDepthToTexture() of the RGB depth
+// sync example straight into the depth buffer of the frame, skipping the
+// texture.
+class DepthOccluder {
+ public:
+  // Must be called on the GL thread, as the destructor.
+  DepthOccluder();
+  ~DepthOccluder();
+  DepthOccluder(const DepthOccluder& other) = delete;
+  DepthOccluder& operator=(const DepthOccluder&) = delete;
+
+  // @param point_budget: the most points drawn, 0 to draw them all.
+  void SetPointBudget(int point_budget) { point_budget_ = point_budget; }
+
+  // Upload |count| points of packed xyz floats in the depth camera frame.
+  // Must be called on the GL thread.
+  void UpdatePoints(const float* xyz, int count);
+
+  // @return false until the first points are uploaded.
+  bool HasPoints() const { return points_.GetCount() > 0; }
+
+  // Fill the depth buffer with the points, leaving the color buffer alone.
+  //
+  // @param world_T_depth_camera: pose of the depth camera when the points
+  //        were taken, in the world of |view_mat|.
+  // @param viewport_height: height of the viewport in pixels.
+  void Render(const glm::mat4& projection_mat, const glm::mat4& view_mat,
+              const glm::mat4& world_T_depth_camera,
+              int viewport_height) const;
+
+ private:
+  QuantizedPoints points_;
+  StreamingVertexBuffer vertex_buffer_;
+  int point_budget_;
+
+  GLuint program_;
+  GLint attrib_vertices_;
+  GLint uniform_projection_mat_;
+  GLint uniform_modelview_mat_;
+  GLint uniform_point_size_;
+  GLint uniform_point_scale_;
+  GLint uniform_point_offset_;
+};
+}  // namespace tango_gl
+#endif  // TANGO_GL_DEPTH_OCCLUDER_H_
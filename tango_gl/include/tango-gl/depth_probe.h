@@ -0,0 +1,299 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_GL_DEPTH_PROBE_H_
+#define TANGO_GL_DEPTH_PROBE_H_
+
+#include <stdint.h>
+
+#include <functional>
+#include <vector>
+
+#include "tango-gl/full_screen_quad.h"
+#include "tango-gl/util.h"
+
+namespace tango_gl {
+
+// DepthProbe finds the point of a point cloud seen by pixels of a camera
+// image on the GPU, instead of projecting the whole cloud on the CPU for a
+// handful of pixels:
+//
+//   // When a new point cloud arrives.
+//   probe_.SetPoints(xyz_ij->xyz[0], xyz_ij->xyz_count, xyz_ij->timestamp);
+//   // Every frame there are pixels to find.
+//   probe_.SetCameraTPoints(color_camera_T_depth_camera);
+//   probe_.Query(uv, id);
+//   ...
+//   probe_.ReadFinishedQueries([&](int id, const glm::vec2& uv, bool is_found,
+//                                  const glm::vec3& position,
+//                                  double timestamp) {
+//     ...
+//   });
+//
+// The points are splatted as metric depth into a framebuffer of the size of
+// SetCamera(), nearest point first, once per cloud and transform however
+// many pixels are queried. Query() then only copies the texels around the
+// pixel into a pixel pack buffer followed by a fence, as CameraLuminance
+// does, and ReadFinishedQueries() maps the buffers whose fence signaled, a
+// frame or two later. The query is dropped when every buffer is still in
+// flight. Without GLES 3.0 nothing is queried, and callers fall back to the
+// CPU.
+//
+// The framebuffer is RGBA with the depth in millimeters in red and green,
+// since GLES only guarantees glReadPixels() of RGBA for color-renderable
+// formats.
+//
+// The depth edges, e.g. to snap a point to the border of a box, are found on
+// the GPU as well, instead of searching the point cloud on the CPU near each
+// point:
+//
+//   // Every frame, after SetCameraTPoints().
+//   probe_.QueryEdgeMap();
+//   ...
+//   probe_.ReadFinishedEdgeMap();
+//   glm::vec3 edge;
+//   if (probe_.FindNearestEdge(uv, radius, position, max_distance, &edge)) {
+//     ...
+//   }
+//
+// QueryEdgeMap() draws a map a kEdgeMapDownscale-th of the size of the
+// framebuffer, whose texels are edges where the depth of the points around
+// them jumps, on the nearer side of the jump, or where the surface folds,
+// its inverse depth being affine in the pixels on a plane. The whole map is
+// read back as the queries are, and ReadFinishedEdgeMap() keeps the newest
+// one, so that FindNearestEdge() is a search of the few texels around a
+// pixel on the CPU.
+//
+// All methods must be called on the GL thread.
+class DepthProbe {
+ public:
+  // Called with the |id| and |uv| of a query. |position| is the point found
+  // nearest to the pixel, in the frame of the points, and |timestamp| the
+  // one of SetPoints() they were splatted from.
+  typedef std::function<void(int id, const glm::vec2& uv, bool is_found,
+                             const glm::vec3& position, double timestamp)>
+      ResultCallback;
+
+  // Texels searched around a queried pixel on each side, in the framebuffer.
+  static const int kNeighborhoodRadius = 4;
+
+  // Texels of the framebuffer per texel of the edge map, on each side.
+  static const int kEdgeMapDownscale = 4;
+
+  // @param max_queries: queries in flight at most, e.g. three frames of them.
+  explicit DepthProbe(int max_queries);
+  DepthProbe(const DepthProbe& other) = delete;
+  DepthProbe& operator=(const DepthProbe&) = delete;
+  ~DepthProbe();
+
+  // Set the size and pinhole intrinsics of the framebuffer the points are
+  // splatted into, e.g. the color camera's scaled down by 2, in framebuffer
+  // pixels.
+  void SetCamera(int width, int height, float fx, float fy, float cx,
+                 float cy);
+
+  // Set the width of the splat of each point, in framebuffer pixels, large
+  // enough for the splats to cover the gaps between the points.
+  void SetPointSize(float point_size);
+
+  // Upload |count| points of |xyz| to splat from now on, taken at
+  // |timestamp|.
+  void SetPoints(const float* xyz, int count, double timestamp);
+
+  // Set the transform of the points into the camera of SetCamera().
+  void SetCameraTPoints(const glm::mat4& camera_T_points);
+
+  // Queue the search of the point seen at |uv|, in normalized coordinates of
+  // the image from its top left corner. The points are splatted again first
+  // if they or their transform changed since. The bound framebuffer,
+  // viewport, program and clear color are restored after it.
+  //
+  // @param id: passed along with the result.
+  //
+  // @return false if the query was dropped, or is not supported.
+  bool Query(const glm::vec2& uv, int id);
+
+  // Call |callback| with each query the GPU finished, oldest first.
+  //
+  // @return the number of queries read.
+  int ReadFinishedQueries(const ResultCallback& callback);
+
+  // Queue the extraction of the edge map of the points, splatting them again
+  // first if needed. The state is restored as for Query().
+  //
+  // @return false if the extraction was dropped, the previous one still
+  //         being in flight, or is not supported.
+  bool QueryEdgeMap();
+
+  // Read the newest edge map the GPU finished, if any, replacing the previous
+  // one.
+  //
+  // @return true if one was read.
+  bool ReadFinishedEdgeMap();
+
+  // @return whether an edge map was read, and the timestamp of the points it
+  //         was extracted from.
+  bool HasEdgeMap() const { return !edge_depths_.empty(); }
+  double GetEdgeMapTimestamp() const { return edge_map_.timestamp; }
+
+  // Find the point of the edge map nearest to |position|, among its texels
+  // within |radius| texels of |uv|.
+  //
+  // @param uv: normalized coordinates of the image, as for Query().
+  // @param position: in the frame of the points of the edge map.
+  // @param edge_position: the edge point found, in the same frame.
+  //
+  // @return false if no edge point is closer than |max_distance|.
+  bool FindNearestEdge(const glm::vec2& uv, int radius,
+                       const glm::vec3& position, float max_distance,
+                       glm::vec3* edge_position) const;
+
+  // @return true if the GL context supports the queries, once Query() was
+  // called.
+  bool IsSupported() const { return is_supported_; }
+
+  // @return the queries Query() dropped because none of the buffers was
+  // free.
+  uint64_t GetDroppedCount() const { return dropped_count_; }
+
+  // Delete the framebuffer, program, buffers and fences.
+  void DeleteGlResources();
+
+  // Forget the GL objects without deleting them, for when the GL context they
+  // belonged to has been destroyed.
+  void InvalidateGlResources();
+
+ private:
+  // A query in flight.
+  struct Readback {
+    GLuint buffer;
+    // Set while the query has not been read.
+    util::GlCapabilities::Sync fence;
+    int id;
+    glm::vec2 uv;
+    // The texels read, and the one of the pixel queried, in the framebuffer.
+    int x;
+    int y;
+    int width;
+    int height;
+    int center_x;
+    int center_y;
+    // What the texels were splatted with.
+    glm::mat4 points_T_camera;
+    float fx;
+    float fy;
+    float cx;
+    float cy;
+    double timestamp;
+  };
+
+  // An edge map in flight, or read.
+  struct EdgeReadback {
+    GLuint buffer;
+    // Set while the map has not been read.
+    util::GlCapabilities::Sync fence;
+    int width;
+    int height;
+    // What the depth was splatted with.
+    glm::mat4 points_T_camera;
+    float fx;
+    float fy;
+    float cx;
+    float cy;
+    double timestamp;
+  };
+
+  // Bind the framebuffer, and splat the points into it if they changed.
+  //
+  // @return false if the framebuffer is not complete.
+  bool BindSplat();
+
+  // Create the program, framebuffer and buffers of the edge map, once until
+  // InvalidateGlResources().
+  bool InitializeEdgeMap();
+
+  // Look up the entry points and create the program and buffers of the
+  // current context, once until InvalidateGlResources().
+  void InitializeGl();
+
+  // (Re)create the framebuffer at the size of SetCamera().
+  bool InitializeFramebuffer();
+
+  // Splat the points into the framebuffer, bound.
+  void Splat();
+
+  int max_queries_;
+  int width_;
+  int height_;
+  float fx_;
+  float fy_;
+  float cx_;
+  float cy_;
+  float point_size_;
+  glm::mat4 camera_T_points_;
+  double points_timestamp_;
+  // The points, or their transform or the camera, changed since the last
+  // splat.
+  bool is_splat_stale_;
+
+  bool gl_initialized_;
+  bool is_supported_;
+  util::GlCapabilities::MapBufferRangeFunction map_buffer_range_;
+  util::GlCapabilities::UnmapBufferFunction unmap_buffer_;
+  util::GlCapabilities::FenceSyncFunction fence_sync_;
+  util::GlCapabilities::ClientWaitSyncFunction client_wait_sync_;
+  util::GlCapabilities::DeleteSyncFunction delete_sync_;
+
+  GLuint program_;
+  GLint vertex_location_;
+  GLint camera_T_points_location_;
+  GLint intrinsics_location_;
+  GLint size_location_;
+  GLint point_size_location_;
+  // The points of SetPoints().
+  GLuint vertex_buffer_;
+  int point_count_;
+
+  GLuint framebuffer_;
+  GLuint framebuffer_texture_;
+  GLuint depth_renderbuffer_;
+  int framebuffer_width_;
+  int framebuffer_height_;
+
+  // Ring of read backs, the oldest being read first.
+  std::vector<Readback> readbacks_;
+  size_t next_readback_;
+  uint64_t dropped_count_;
+
+  GLuint edge_program_;
+  GLint edge_depth_location_;
+  GLint edge_scale_location_;
+  GLint edge_texel_location_;
+  FullScreenQuad edge_quad_;
+  GLuint edge_framebuffer_;
+  GLuint edge_texture_;
+  int edge_width_;
+  int edge_height_;
+  // Ring of read backs of the edge map, the oldest being read first.
+  std::vector<EdgeReadback> edge_readbacks_;
+  size_t next_edge_readback_;
+  // The edge map read, the depth of each texel in millimeters, 0 if it is
+  // not an edge, and what it was extracted with.
+  std::vector<uint16_t> edge_depths_;
+  EdgeReadback edge_map_;
+};
+}  // namespace tango_gl
+#endif  // TANGO_GL_DEPTH_PROBE_H_
@@ -20,16 +20,18 @@
 #include <vector>
 
 #include "tango-gl/color.h"
+#include "tango-gl/memory_accounting.h"
 #include "tango-gl/transform.h"
 #include "tango-gl/util.h"
 
 namespace tango_gl {
 class DrawableObject : public Transform {
  public:
-  DrawableObject() : red_(0), green_(0), blue_(0), alpha_(1.0f) {}
+  DrawableObject();
   DrawableObject(const DrawableObject& other) = delete;
   const DrawableObject& operator=(const DrawableObject&) = delete;
 
+  // Delete the vertex buffers. The shader program is shared and stays alive.
   void DeleteGlResources();
   void SetShader();
   void SetColor(const Color& color);
@@ -44,6 +46,61 @@ class DrawableObject : public Transform {
                       const glm::mat4& view_mat) const = 0;
 
  protected:
+  friend class MarkerStore;
+  friend class RenderQueue;
+
+  // Upload vertices_, with normals_ interleaved when there is one per vertex,
+  // and indices_ into vertex_buffer_ and index_buffer_ if they changed since
+  // the last upload. Must be called on the GL thread.
+  void UpdateVertexBuffers() const;
+
+  // Upload |vertex_count| vertices of |stride| bytes into vertex_buffer_, for
+  // subclasses that keep their vertices elsewhere. Must be called on the GL
+  // thread.
+  void UploadVertexBuffer(const void* data, GLsizei vertex_count,
+                          GLsizei stride) const;
+
+  // Keep vertex_buffer_ up to date with |vertex_count| vertices of |stride|
+  // bytes that change mostly at their end, like a path that keeps growing.
+  // Only the vertices appended since the last call, and those from
+  // SetVerticesChangedFrom() on, are uploaded. The buffer grows
+  // geometrically. Must be called on the GL thread.
+  void UpdateGrowingVertexBuffer(const void* data, GLsizei vertex_count,
+                                 GLsizei stride) const;
+
+  // Enable the position attribute, and the normal one if |use_normals|,
+  // reading vertex_buffer_ with the layout of its last upload, and bind
+  // index_buffer_ when there are indices. When the context has vertex array
+  // objects the setup is recorded in one, once per layout, so drawing only
+  // binds it. Must be called on the GL thread, after the upload and before
+  // drawing, and undone with UnbindVertexAttributes().
+  void BindVertexAttributes(bool use_normals) const;
+  void UnbindVertexAttributes(bool use_normals) const;
+
+  // Point the attributes bound by BindVertexAttributes() at the vertices from
+  // |first_vertex| on, for draws of a part of vertex_buffer_ with its own
+  // indices. Must be called with |first_vertex| 0 again before unbinding.
+  void PointVertexAttributes(GLsizei first_vertex, bool use_normals) const;
+
+  // Draw the geometry |generate| makes for |parameter| instead of vertices_,
+  // from a vertex buffer shared with every object of the same geometry in the
+  // context, see util::GetSharedVertexBuffer(). For primitives that are the
+  // same for every instance, sized by the model matrix.
+  void SetSharedVertices(util::GeometryGenerator generate, int parameter);
+  bool HasSharedVertices() const { return shared_generator_ != NULL; }
+
+  // Have the next upload send the whole vertex data again, for subclasses
+  // that modify it in place.
+  void SetVertexBuffersDirty() { vertex_buffers_dirty_ = true; }
+
+  // Have the next UpdateGrowingVertexBuffer() upload the vertices from
+  // |first_vertex| on again.
+  void SetVerticesChangedFrom(GLsizei first_vertex) {
+    if (first_vertex < changed_vertex_begin_) {
+      changed_vertex_begin_ = first_vertex;
+    }
+  }
+
   float red_;
   float green_;
   float blue_;
@@ -58,6 +115,62 @@ class DrawableObject : public Transform {
   GLuint uniform_mvp_mat_;
   GLuint attrib_vertices_;
   GLuint attrib_normals_;
+
+  // GL copies of the vertex data, uploaded on first use and after every change
+  // so drawing does not send the vertices again. 0 until the first upload.
+  // Positions come first in every vertex, followed by the normal when
+  // buffer_has_normals_ is set, or the normals follow every position when
+  // buffer_normal_offset_ is past them. Without indices, the vertices are
+  // drawn with glDrawArrays.
+  mutable GLuint vertex_buffer_;
+  mutable GLuint index_buffer_;
+  mutable bool vertex_buffers_dirty_;
+  mutable GLenum vertex_buffer_usage_;
+  mutable GLsizei vertex_buffer_capacity_;
+  mutable GLsizei changed_vertex_begin_;
+  mutable GLsizei buffer_vertex_count_;
+  // Vertices written to vertex_buffer_ since its storage was allocated, past
+  // which no draw ever read it.
+  mutable GLsizei buffer_written_vertex_count_;
+  mutable GLsizei buffer_vertex_stride_;
+  mutable bool buffer_has_normals_;
+  // Offset of the normal of the first vertex in vertex_buffer_, in bytes,
+  // that of each next vertex being buffer_vertex_stride_ further.
+  mutable size_t buffer_normal_offset_;
+  mutable GLsizei buffer_index_count_;
+  mutable GLenum buffer_index_type_;
+  // The storage of vertex_buffer_, unless it is shared, and of index_buffer_.
+  mutable MemoryAccount vertex_buffer_memory_;
+  mutable MemoryAccount index_buffer_memory_;
+
+ private:
+  // The buffers and attributes recorded in vertex_array_.
+  struct VertexArrayLayout {
+    GLuint vertex_buffer;
+    GLuint index_buffer;
+    GLsizei stride;
+    size_t normal_offset;
+    GLuint vertices;
+    GLuint normals;
+    bool use_normals;
+  };
+
+  // Point the attributes at vertex_buffer_.
+  void SetUpVertexAttributes(bool use_normals) const;
+
+  // Get the buffer of SetSharedVertices() into vertex_buffer_, again when the
+  // cache started over.
+  void UpdateSharedVertexBuffer() const;
+
+  // Set by SetSharedVertices(), vertex_buffer_ then belongs to the cache.
+  util::GeometryGenerator shared_generator_;
+  int shared_parameter_;
+  mutable uint32_t shared_generation_;
+
+  // 0 until BindVertexAttributes() needs one. Its layout has a stride of 0
+  // until the attributes are set up.
+  mutable GLuint vertex_array_;
+  mutable VertexArrayLayout vertex_array_layout_;
 };
 }  // namespace tango_gl
 #endif  // TANGO_GL_DRAWABLE_OBJECT_H_
@@ -0,0 +1,151 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_GL_DRAWABLE_POOL_H_
+#define TANGO_GL_DRAWABLE_POOL_H_
+
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+#include "tango-gl/util.h"
+
+namespace tango_gl {
+// A reference to an object of a DrawablePool. A handle outliving its object
+// is stale, and DrawablePool::Get() returns nullptr for it, rather than the
+// object that recycled its slot.
+struct DrawableHandle {
+  uint32_t index;
+  uint32_t generation;
+
+  DrawableHandle() : index(0), generation(0) {}
+  DrawableHandle(uint32_t index, uint32_t generation)
+      : index(index), generation(generation) {}
+  // Generations start at 1, so a default constructed handle never resolves.
+  bool IsNull() const { return generation == 0; }
+};
+
+// DrawablePool recycles drawables of one type, e.g. the markers of an
+// annotation scene, so creating and destroying them does not allocate nor
+// create GL objects once the pool has grown to the most alive at a time.
+//
+// A released object is kept along with its vertex buffers and shader
+// bindings, and handed out again by the next Acquire() with the state of its
+// previous use: the caller sets its transform and color again. Objects are
+// constructed by the pool on first need, so Acquire() must be called on the
+// GL thread, like every other method.
+//
+//   tango_gl::DrawablePool<tango_gl::Cube> markers_(kMaxMarkerCount);
+//   ...
+//   const tango_gl::DrawableHandle marker = markers_.Acquire();
+//   markers_.Get(marker)->SetPosition(position);
+//   ...
+//   markers_.Render(projection_mat, view_mat);
+//   ...
+//   markers_.Release(marker);
+template <typename T>
+class DrawablePool {
+ public:
+  // @param capacity: objects the pool holds without growing its arrays.
+  explicit DrawablePool(size_t capacity) : active_count_(0) {
+    objects_.reserve(capacity);
+    generations_.reserve(capacity);
+    free_indices_.reserve(capacity);
+  }
+  DrawablePool(const DrawablePool& other) = delete;
+  DrawablePool& operator=(const DrawablePool&) = delete;
+
+  ~DrawablePool() { Clear(); }
+
+  // @return: a handle to a released object, or to a new one if there is
+  //          none.
+  DrawableHandle Acquire() {
+    uint32_t index;
+    if (!free_indices_.empty()) {
+      index = free_indices_.back();
+      free_indices_.pop_back();
+    } else {
+      index = static_cast<uint32_t>(objects_.size());
+      objects_.push_back(std::unique_ptr<T>(new T()));
+      // Slots emptied by Clear() keep their generation.
+      if (index == generations_.size()) {
+        generations_.push_back(0);
+      }
+    }
+    // Odd generations are alive.
+    ++generations_[index];
+    ++active_count_;
+    return DrawableHandle(index, generations_[index]);
+  }
+
+  // Give the object of |handle| back to the pool. Does nothing for a stale
+  // or null handle.
+  void Release(const DrawableHandle& handle) {
+    if (Get(handle) == nullptr) {
+      return;
+    }
+    ++generations_[handle.index];
+    free_indices_.push_back(handle.index);
+    --active_count_;
+  }
+
+  // @return: the object of |handle|, or nullptr if it was released.
+  T* Get(const DrawableHandle& handle) const {
+    if (handle.IsNull() || handle.index >= objects_.size() ||
+        generations_[handle.index] != handle.generation) {
+      return nullptr;
+    }
+    return objects_[handle.index].get();
+  }
+
+  // Render every object alive.
+  void Render(const glm::mat4& projection_mat,
+              const glm::mat4& view_mat) const {
+    for (size_t i = 0; i < objects_.size(); ++i) {
+      if ((generations_[i] & 1) != 0) {
+        objects_[i]->Render(projection_mat, view_mat);
+      }
+    }
+  }
+
+  size_t GetActiveCount() const { return active_count_; }
+
+  // @return: the objects constructed, alive or not.
+  size_t GetSize() const { return objects_.size(); }
+
+  // Delete every object and its GL resources. The handles alive become
+  // stale.
+  void Clear() {
+    for (std::unique_ptr<T>& object : objects_) {
+      object->DeleteGlResources();
+    }
+    objects_.clear();
+    for (uint32_t& generation : generations_) {
+      generation += generation & 1;
+    }
+    free_indices_.clear();
+    active_count_ = 0;
+  }
+
+ private:
+  std::vector<std::unique_ptr<T>> objects_;
+  std::vector<uint32_t> generations_;
+  std::vector<uint32_t> free_indices_;
+  size_t active_count_;
+};
+}  // namespace tango_gl
+#endif  // TANGO_GL_DRAWABLE_POOL_H_
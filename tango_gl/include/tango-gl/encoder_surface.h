@@ -0,0 +1,106 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_GL_ENCODER_SURFACE_H_
+#define TANGO_GL_ENCODER_SURFACE_H_
+
+#include <EGL/egl.h>
+#include <android/native_window.h>
+#include <stdint.h>
+
+#include "tango-gl/util.h"
+
+namespace tango_gl {
+
+// EncoderSurface copies the frames drawn into the input surface of a video
+// encoder, e.g. the Surface of MediaCodec.createInputSurface(), so that the
+// frames are recorded without any read back to the CPU:
+//
+//   // GL thread, with the ANativeWindow of the encoder Surface.
+//   encoder_surface_.Attach(window);
+//   ...
+//   // Every frame, once the scene is drawn and before it is swapped.
+//   encoder_surface_.Draw(color_timestamp);
+//
+// Draw() copies the window into a texture, then draws it into the encoder
+// surface through a context sharing the objects of the current one, with a
+// recordable config, and swaps the surface with the timestamp as its
+// presentation time. The window is current again when Draw() returns.
+//
+// All methods must be called on the GL thread, with the context of the window
+// current.
+class EncoderSurface {
+ public:
+  EncoderSurface();
+  EncoderSurface(const EncoderSurface& other) = delete;
+  EncoderSurface& operator=(const EncoderSurface&) = delete;
+  ~EncoderSurface();
+
+  // Create the surface over |window| and its context. The surface keeps a
+  // reference to the window until Detach().
+  //
+  // @return false if no recordable config or surface could be created.
+  bool Attach(ANativeWindow* window);
+
+  // Destroy the surface and its context, and release the window.
+  void Detach();
+
+  bool IsAttached() const { return surface_ != EGL_NO_SURFACE; }
+
+  // Draw the frame of the current window into the encoder surface, unless a
+  // frame of |timestamp| or a later one was already drawn.
+  //
+  // @param timestamp: presentation time of the frame in seconds, e.g. the
+  //        timestamp of its camera image.
+  void Draw(double timestamp);
+
+  // Forget the surface, context and texture without destroying them, for
+  // when the context they were created from has been destroyed. The window
+  // is still released.
+  void InvalidateGlResources();
+
+ private:
+  // EGL_ANDROID_presentation_time, which the EGL headers of older NDKs do not
+  // declare.
+  typedef EGLBoolean(EGLAPIENTRYP PresentationTimeFunction)(EGLDisplay,
+                                                            EGLSurface,
+                                                            int64_t);
+
+  // Create the program and vertex buffer of the copy, with the encoder
+  // context current.
+  bool InitializeCopy();
+
+  ANativeWindow* window_;
+  EGLDisplay display_;
+  EGLContext context_;
+  EGLSurface surface_;
+  PresentationTimeFunction presentation_time_;
+
+  // The copy of the window, in the shared objects of both contexts.
+  GLuint texture_;
+  GLsizei texture_width_;
+  GLsizei texture_height_;
+
+  // Objects of the encoder context.
+  GLuint program_;
+  GLuint vertex_buffer_;
+  GLint vertex_location_;
+  GLint texture_location_;
+
+  double last_timestamp_;
+};
+}  // namespace tango_gl
+#endif  // TANGO_GL_ENCODER_SURFACE_H_
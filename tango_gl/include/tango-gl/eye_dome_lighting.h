@@ -0,0 +1,124 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_GL_EYE_DOME_LIGHTING_H_
+#define TANGO_GL_EYE_DOME_LIGHTING_H_
+
+#include "tango-gl/full_screen_quad.h"
+#include "tango-gl/memory_accounting.h"
+#include "tango-gl/util.h"
+
+namespace tango_gl {
+
+// EyeDomeLighting shades flat colored points by the depth around each pixel,
+// so that the shape of a dense point cloud reads without normals:
+//
+//   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+//   eye_dome_lighting_.Begin(camera_->GetProjectionMatrix());
+//   ... render the point cloud and the rest of the scene ...
+//   eye_dome_lighting_.End();
+//
+// Begin() binds a framebuffer of the size of the current viewport with a
+// depth texture, cleared to the current clear color. End() draws it back over
+// the viewport of Begin() in a single full-screen pass, darkening every pixel
+// by how much nearer its neighbors are, on the logarithm of their distance to
+// the camera. Edges and creases of the surfaces come out as dark outlines,
+// whatever the number of points, and the background is left as it is.
+//
+// The depth is sampled from a texture, which takes GLES3 or
+// GL_OES_depth_texture. Without them, or when the framebuffer can not be
+// created, Begin() and End() do nothing and the scene is drawn flat.
+//
+// All methods must be called on the GL thread.
+class EyeDomeLighting {
+ public:
+  // Darkening per unit of the logarithm of the distance, by default.
+  static const float kDefaultStrength;
+
+  // Distance of the neighbors sampled around a pixel, in pixels, by default.
+  static const float kDefaultRadius;
+
+  EyeDomeLighting();
+  EyeDomeLighting(const EyeDomeLighting& other) = delete;
+  EyeDomeLighting& operator=(const EyeDomeLighting&) = delete;
+  ~EyeDomeLighting();
+
+  // @return whether the current context can sample depth textures.
+  static bool IsSupported();
+
+  void SetStrength(float strength);
+  float GetStrength() const { return strength_; }
+  void SetRadius(float radius);
+  float GetRadius() const { return radius_; }
+
+  // Redirect the rendering into the framebuffer.
+  //
+  // @param projection_mat: projection the scene is rendered with, to recover
+  //        the distance of the pixels from their depth.
+  //
+  // @return false if the scene is drawn directly, without depth textures or
+  //         the framebuffer.
+  bool Begin(const glm::mat4& projection_mat);
+
+  // Restore the framebuffer and viewport of Begin(), and draw the shaded
+  // scene over it. Depth testing and blending are left as they were in
+  // Begin().
+  void End();
+
+  // Delete the framebuffer and program.
+  void DeleteGlResources();
+
+  // Forget the GL objects without deleting them, for when the GL context they
+  // belonged to has been destroyed.
+  void InvalidateGlResources();
+
+ private:
+  // Create the program once, and the framebuffer of |width| by |height|
+  // whenever its size changes.
+  //
+  // @return false if the framebuffer is not complete.
+  bool InitializeFramebuffer(GLsizei width, GLsizei height);
+
+  float strength_;
+  float radius_;
+  bool is_active_;
+
+  // The distance of a pixel is depth_coefficients_.y / (z + .x) for a
+  // perspective projection, (.y - z) / .x for an orthographic one, with z
+  // its depth in normalized device coordinates, and .z is 1 for the former.
+  glm::vec3 depth_coefficients_;
+
+  GLuint program_;
+  GLint color_texture_location_;
+  GLint depth_texture_location_;
+  GLint pixel_size_location_;
+  GLint strength_location_;
+  GLint depth_coefficients_location_;
+  FullScreenQuad quad_;
+
+  GLuint framebuffer_;
+  GLuint color_texture_;
+  GLuint depth_texture_;
+  GLsizei framebuffer_width_;
+  GLsizei framebuffer_height_;
+  MemoryAccount gpu_memory_;
+
+  // The framebuffer and viewport of Begin().
+  GLint previous_framebuffer_;
+  GLint previous_viewport_[4];
+};
+}  // namespace tango_gl
+#endif  // TANGO_GL_EYE_DOME_LIGHTING_H_
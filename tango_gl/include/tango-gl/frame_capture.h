@@ -0,0 +1,118 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_GL_FRAME_CAPTURE_H_
+#define TANGO_GL_FRAME_CAPTURE_H_
+
+#include <stdint.h>
+
+#include <functional>
+#include <vector>
+
+#include "tango-gl/util.h"
+
+namespace tango_gl {
+
+// FrameCapture reads back rendered frames without stalling the GL thread,
+// through a ring of pixel pack buffers of GLES 3.0:
+//
+//   // Every frame, once the scene is drawn.
+//   capture_.ReadFinishedFrames([&](const uint8_t* rgba, int width,
+//                                   int height, double timestamp) {
+//     writer_.Write(rgba, width, height, timestamp);
+//   });
+//   if (is_snapshot_due) {
+//     capture_.Capture(timestamp);
+//   }
+//
+// Capture() only queues the copy of the viewport into the next buffer, and a
+// fence after it. ReadFinishedFrames() maps the buffers whose fence signaled,
+// usually two frames later, so the read never waits for the GPU. A capture
+// is dropped when every buffer is still in flight. Without GLES 3.0 nothing
+// is captured.
+//
+// All methods must be called on the GL thread.
+class FrameCapture {
+ public:
+  // Called with the bottom-up RGBA rows of a captured frame, valid for the
+  // duration of the call.
+  typedef std::function<void(const uint8_t* rgba, int width, int height,
+                             double timestamp)> FrameCallback;
+
+  FrameCapture();
+  FrameCapture(const FrameCapture& other) = delete;
+  FrameCapture& operator=(const FrameCapture&) = delete;
+  ~FrameCapture();
+
+  // Queue the read back of the current viewport of the bound framebuffer.
+  //
+  // @param timestamp: passed along with the frame, e.g. the timestamp of its
+  //        camera image.
+  //
+  // @return false if the frame was dropped, or capture is not supported.
+  bool Capture(double timestamp);
+
+  // Call |callback| with each frame the GPU finished copying, oldest first.
+  //
+  // @return the number of frames read.
+  int ReadFinishedFrames(const FrameCallback& callback);
+
+  // @return true if the GL context supports the capture, once Capture() was
+  // called.
+  bool IsSupported() const { return is_supported_; }
+
+  // @return the frames Capture() dropped because none of the buffers was
+  // free.
+  uint64_t GetDroppedCount() const { return dropped_count_; }
+
+  // Delete the buffers and fences.
+  void DeleteGlResources();
+
+  // Forget the buffers and fences without deleting them, for when the GL
+  // context they belonged to has been destroyed.
+  void InvalidateGlResources();
+
+ private:
+  // A frame in flight.
+  struct Readback {
+    GLuint buffer;
+    GLsizeiptr capacity;
+    // Set while the frame has not been read.
+    util::GlCapabilities::Sync fence;
+    int width;
+    int height;
+    double timestamp;
+  };
+
+  // Look up the entry points and create the buffers of the current context,
+  // once until InvalidateGlResources().
+  void InitializeGl();
+
+  bool gl_initialized_;
+  bool is_supported_;
+  util::GlCapabilities::MapBufferRangeFunction map_buffer_range_;
+  util::GlCapabilities::UnmapBufferFunction unmap_buffer_;
+  util::GlCapabilities::FenceSyncFunction fence_sync_;
+  util::GlCapabilities::ClientWaitSyncFunction client_wait_sync_;
+  util::GlCapabilities::DeleteSyncFunction delete_sync_;
+
+  // Ring of read backs, the oldest being read first.
+  std::vector<Readback> readbacks_;
+  size_t next_readback_;
+  uint64_t dropped_count_;
+};
+}  // namespace tango_gl
+#endif  // TANGO_GL_FRAME_CAPTURE_H_
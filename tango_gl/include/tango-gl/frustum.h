@@ -20,6 +20,9 @@
 #include "tango-gl/line.h"
 
 namespace tango_gl {
+// The pyramid of a camera looking down -z, from its apex at the origin to a
+// square at z = -1, sized by the scale of the model matrix. Its vertices are
+// shared by every instance in the GL context.
 class Frustum : public Line {
  public:
   Frustum();
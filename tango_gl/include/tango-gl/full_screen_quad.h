@@ -0,0 +1,81 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_GL_FULL_SCREEN_QUAD_H_
+#define TANGO_GL_FULL_SCREEN_QUAD_H_
+
+#include "tango-gl/util.h"
+
+namespace tango_gl {
+// FullScreenQuad draws the quad covering clip space, [-1, 1] on x and y at a
+// z of 0, with the texture coordinates (0, 0) at its top left corner and
+// (1, 1) at its bottom right, as the camera images are laid out.
+//
+//   // Once the program is linked.
+//   quad_.SetAttributeLocations(glGetAttribLocation(program, "vertex"),
+//                               glGetAttribLocation(program, "textureCoords"));
+//   ...
+//   glUseProgram(program);
+//   // Set the uniforms and bind the textures.
+//   quad_.Draw();
+//
+// Every quad of a context shares a single static vertex buffer, the positions
+// and texture coordinates interleaved. The attribute setup of each quad is
+// recorded once in a vertex array object, on GLES3 or with
+// GL_OES_vertex_array_object, so Draw() is a bind and a draw call. Without
+// vertex array objects the attributes are set up on every Draw().
+//
+// All methods must be called on the GL thread.
+class FullScreenQuad {
+ public:
+  FullScreenQuad();
+  FullScreenQuad(const FullScreenQuad& other) = delete;
+  FullScreenQuad& operator=(const FullScreenQuad&) = delete;
+
+  // Set the attributes of the program the quad is drawn with, and record
+  // them.
+  //
+  // @param vertex_location: location of the position attribute, a vec2, vec3
+  //        or vec4. -1 if the program has none.
+  // @param texture_coords_location: location of the vec2 texture coordinates
+  //        attribute, -1 if the program has none.
+  void SetAttributeLocations(GLint vertex_location,
+                             GLint texture_coords_location);
+
+  // Draw the quad as a triangle strip with the current program.
+  void Draw() const;
+
+  // Delete the vertex array object. The shared vertex buffer lives as long as
+  // its context.
+  void DeleteGlResources();
+
+  // Forget the vertex array object without deleting it, for when the GL
+  // context it belonged to has been destroyed.
+  void InvalidateGlResources();
+
+ private:
+  // Enable and point the attributes at the shared vertex buffer.
+  void SetUpAttributes() const;
+
+  GLint vertex_location_;
+  GLint texture_coords_location_;
+  // The shared vertex buffer of the context of the quad.
+  GLuint vertex_buffer_;
+  // 0 without vertex array objects.
+  GLuint vertex_array_;
+};
+}  // namespace tango_gl
+#endif  // TANGO_GL_FULL_SCREEN_QUAD_H_
@@ -17,11 +17,31 @@
 #ifndef TANGO_GL_GESTURE_CAMERA_H_
 #define TANGO_GL_GESTURE_CAMERA_H_
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
 #include "tango-gl/camera.h"
 #include "tango-gl/segment.h"
 #include "tango-gl/transform.h"
 
 namespace tango_gl {
+// GestureCamera orbits the render camera around an anchor with touch input:
+// one finger rotates it, two fingers zoom.
+//
+// The touch events and camera type changes come from the UI thread, faster
+// than frames are drawn. They only post to a lock free mailbox, and Update()
+// applies whatever arrived since the previous frame on the render thread, so
+// the camera is recomputed at most once per frame and never while it is used:
+//
+//   // UI thread.
+//   camera->OnTouchEvent(touch_count, event, x0, y0, x1, y1);
+//   // Render thread, every frame before the matrices are used.
+//   camera->Update();
+//
+// With SetInertia(), the camera keeps moving after the fingers are lifted and
+// slows down. The motion is integrated in fixed steps, so it does not depend
+// on the frame rate.
 class GestureCamera : public Camera {
  public:
   enum CameraType {
@@ -42,9 +62,20 @@ class GestureCamera : public Camera {
   GestureCamera();
   ~GestureCamera();
 
+  // Post a touch event, applied by the next Update(). Must be called on a
+  // single thread, e.g. the UI thread.
   void OnTouchEvent(int touch_count, TouchEvent event, float x0, float y0,
                     float x1, float y1);
 
+  // Apply the touch events and camera type posted since the previous call, and
+  // move the camera along its inertia. Must be called on the render thread.
+  void Update();
+
+  // Keep the camera moving after a gesture, slowing down by |damping| per
+  // second, e.g. 4 to stop within a second. 0, the default, stops it as soon
+  // as the fingers do. Must be called on the render thread.
+  void SetInertia(float damping) { damping_ = damping; }
+
   // Get the ray in opengl world frame given the 2d touch position on screen,
   // normalized touch_x and normalized touch_y should be the same value get from
   // OnTouchEvent, x0 and y0, touch_range is the depth of the touch in
@@ -54,29 +85,51 @@ class GestureCamera : public Camera {
 
   void SetAnchorPosition(const glm::vec3& pos);
 
-  // Set camera type, set render camera's parent position and rotation.
+  // Set camera type, set render camera's parent position and rotation. Can be
+  // called on any thread, the camera changes on the next Update().
   void SetCameraType(CameraType camera_index);
 
+  // @return the camera type as of the latest Update().
   CameraType GetCameraType() const { return camera_type_; }
 
  private:
+  void ApplyCameraType(CameraType camera_index);
+
+  // Add an input delta to a mailbox accumulator, in kInputScale units.
+  static void PostInput(float delta, std::atomic<int32_t>* accumulator);
+
   void StartCameraToCurrentTransform();
 
   // Render camera's parent transformation.
   Transform* cam_parent_transform_;
 
+  // State of the render thread.
   CameraType camera_type_;
-
-  glm::vec2 cam_start_angle_;
   glm::vec2 cam_cur_angle_;
-
-  float cam_start_dist_;
   float cam_cur_dist_;
-
-  float start_touch_dist_;
-  float cur_touch_dist_;
-
-  glm::vec2 touch0_start_position_;
+  // Rotation speed in radians per second and zoom speed in meters per second,
+  // as x, y and z.
+  glm::vec3 velocity_;
+  float damping_;
+  // Time of the previous Update(), and the part of the time since the
+  // inertia was integrated that is shorter than a step.
+  std::chrono::steady_clock::time_point last_update_time_;
+  bool has_updated_;
+  double unintegrated_time_;
+
+  // State of the touch thread: the finger position and the distance between
+  // the two fingers at the previous event.
+  glm::vec2 last_touch0_position_;
+  float last_touch_dist_;
+
+  // The mailbox: input deltas since the last Update(), the rotations around x
+  // and y and the change of distance, in fixed point so they can be added to
+  // atomically. The camera type awaiting Update(), or -1.
+  std::atomic<int32_t> input_rotation_x_;
+  std::atomic<int32_t> input_rotation_y_;
+  std::atomic<int32_t> input_dist_;
+  std::atomic<bool> is_touching_;
+  std::atomic<int> requested_camera_type_;
 };
 }  // namespace tango_gl
 #endif  // TANGO_GL_GESTURE_CAMERA_H_
@@ -0,0 +1,83 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_GL_GL_CONTEXT_TRACKER_H_
+#define TANGO_GL_GL_CONTEXT_TRACKER_H_
+
+#include <EGL/egl.h>
+
+#include "tango-gl/util.h"
+
+namespace tango_gl {
+
+// GlContextTracker tells whether the GL objects of an app survived a pause.
+// With GLSurfaceView.setPreserveEGLContextOnPause(true) the context usually
+// outlives the pause and everything created in it can be drawn again as it
+// is. When it was lost, the handles died with it and must be forgotten, their
+// resources created again.
+//
+//   void App::InitializeGLContent() {
+//     switch (gl_context_.CheckCurrentContext()) {
+//       case GlContextTracker::kContextKept:
+//         return;
+//       case GlContextTracker::kContextLost:
+//         // Nothing was created in the new context yet, so deleting the
+//         // names of the lost one is a no-op for GL and frees the rest.
+//         scene_.DeleteResources();
+//         util::DeleteSharedPrograms();
+//         util::DeleteSharedVertexBuffers();
+//         break;
+//       case GlContextTracker::kNoContext:
+//         break;
+//     }
+//     scene_.InitGLContent();
+//     gl_context_.Attach();
+//   }
+//
+// A context is recognized by its EGLContext handle and by a texture created in
+// it, so a new context that reuses the handle of a destroyed one still counts
+// as lost. All methods must be called on the GL thread.
+class GlContextTracker {
+ public:
+  enum State {
+    // Attach() was never called, or not since Detach().
+    kNoContext,
+    // The context current is the attached one.
+    kContextKept,
+    // The attached context was destroyed, or another one is current.
+    kContextLost
+  };
+
+  GlContextTracker();
+  GlContextTracker(const GlContextTracker& other) = delete;
+  GlContextTracker& operator=(const GlContextTracker&) = delete;
+
+  // @return the state of the attached context.
+  State CheckCurrentContext() const;
+
+  // Follow the current context, once the resources were created in it.
+  void Attach();
+
+  // Stop following the context, e.g. after the resources were deleted. Frees
+  // the texture that identifies it if it is current.
+  void Detach();
+
+ private:
+  EGLContext context_;
+  GLuint marker_texture_;
+};
+}  // namespace tango_gl
+#endif  // TANGO_GL_GL_CONTEXT_TRACKER_H_
@@ -0,0 +1,64 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_GL_GL_STATE_H_
+#define TANGO_GL_GL_STATE_H_
+
+#include "tango-gl/util.h"
+
+namespace tango_gl {
+
+// GlState shadows the GL state the drawables set every frame, and skips the
+// calls that would not change it: the program, the GL_ARRAY_BUFFER binding,
+// GL_BLEND, GL_DEPTH_TEST and GL_CULL_FACE, the blend function, the depth
+// function and the depth mask. Its functions take the arguments of the GL
+// functions they replace:
+//
+//   GlState::UseProgram(shader_program_);
+//   GlState::Enable(GL_DEPTH_TEST);
+//   GlState::BindBuffer(GL_ARRAY_BUFFER, vertex_buffer_);
+//   ...
+//   GlState::BindBuffer(GL_ARRAY_BUFFER, 0);
+//
+// so a drawable drawn after another one with the same program or state only
+// costs the calls that differ. The drawables leave their program in use, as
+// the next one uses its own. Other targets and capabilities are passed
+// through to GL.
+//
+// The shadow is only right if every change of that state goes through
+// GlState, including the deletion of the programs and buffers, which may
+// unbind them. Code that changes it directly, e.g. a library, must call
+// Invalidate() afterwards. Each thread keeps the shadow of its current
+// context, and forgets it when another context becomes current.
+class GlState {
+ public:
+  GlState() = delete;
+
+  static void UseProgram(GLuint program);
+  static void BindBuffer(GLenum target, GLuint buffer);
+  static void Enable(GLenum capability);
+  static void Disable(GLenum capability);
+  static void BlendFunc(GLenum source_factor, GLenum destination_factor);
+  static void DepthFunc(GLenum function);
+  static void DepthMask(GLboolean flag);
+  static void DeleteProgram(GLuint program);
+  static void DeleteBuffers(GLsizei count, const GLuint* buffers);
+
+  // Forget the shadow, so that the next call of each function is issued.
+  static void Invalidate();
+};
+}  // namespace tango_gl
+#endif  // TANGO_GL_GL_STATE_H_
@@ -0,0 +1,170 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_GL_GPU_PROFILER_H_
+#define TANGO_GL_GPU_PROFILER_H_
+
+#include <stdint.h>
+
+#include <chrono>
+#include <vector>
+
+#include "tango-gl/util.h"
+
+namespace tango_gl {
+
+// GpuProfiler measures how long the GPU spends on the passes of a frame with
+// the timer queries of GL_EXT_disjoint_timer_query.
+//
+//   // Once, in the order of the pass indices.
+//   video_pass_ = profiler_.AddPass("Video overlay");
+//   ...
+//   // Every frame.
+//   profiler_.BeginFrame();
+//   {
+//     GpuProfiler::ScopedPass pass(&profiler_, video_pass_);
+//     video_overlay_->Render(projection, view);
+//   }
+//
+// The results of a frame are only read once the GPU has finished it, a few
+// frames later, so profiling never stalls the pipeline. Times are averaged
+// over the latest frames. Without the extension, BeginPass() and EndPass()
+// do nothing and every pass takes 0 ms.
+//
+// All methods but AddPass() must be called on the GL thread.
+class GpuProfiler {
+ public:
+  // Time a pass for the lifetime of the object.
+  class ScopedPass {
+   public:
+    ScopedPass(GpuProfiler* profiler, int pass) : profiler_(profiler) {
+      profiler_->BeginPass(pass);
+    }
+    ScopedPass(const ScopedPass& other) = delete;
+    ScopedPass& operator=(const ScopedPass&) = delete;
+    ~ScopedPass() { profiler_->EndPass(); }
+
+   private:
+    GpuProfiler* profiler_;
+  };
+
+  GpuProfiler();
+  GpuProfiler(const GpuProfiler& other) = delete;
+  GpuProfiler& operator=(const GpuProfiler&) = delete;
+  ~GpuProfiler();
+
+  // Add a pass to measure, before the first BeginFrame().
+  //
+  // @param name: name of the pass, which must outlive the profiler.
+  //
+  // @return the index of the pass.
+  int AddPass(const char* name);
+
+  // Start a new frame, reading the results of the finished frames.
+  void BeginFrame();
+
+  // Time the GPU commands issued until EndPass(). Passes cannot be nested,
+  // and a pass is timed at most once per frame.
+  void BeginPass(int pass);
+  void EndPass();
+
+  // @return true if the GL context supports timer queries, once BeginFrame()
+  // was called.
+  bool IsSupported() const { return is_supported_; }
+
+  int GetPassCount() const { return static_cast<int>(passes_.size()); }
+  const char* GetPassName(int pass) const { return passes_[pass].name; }
+
+  // @return the average GPU time of a pass in milliseconds.
+  float GetPassTime(int pass) const;
+
+  // @return the average GPU time of every pass in milliseconds.
+  float GetTotalTime() const;
+
+  // @return the average time between BeginFrame() calls in milliseconds.
+  float GetFrameInterval() const { return frame_interval_.GetAverage(); }
+
+  // Delete the timer queries.
+  void DeleteGlResources();
+
+  // Forget the timer queries without deleting them, for when the GL context
+  // they belonged to has been destroyed.
+  void InvalidateGlResources();
+
+ private:
+  // Average of the latest samples.
+  class RollingAverage {
+   public:
+    RollingAverage();
+    void Add(float sample);
+    float GetAverage() const;
+
+   private:
+    std::vector<float> samples_;
+    size_t next_sample_;
+    size_t sample_count_;
+  };
+
+  struct Pass {
+    const char* name;
+    RollingAverage time;
+  };
+
+  // Timer queries of a frame, one per pass.
+  struct Frame {
+    std::vector<GLuint> queries;
+    std::vector<bool> is_issued;
+    // The last query issued, set while the results have not been read.
+    GLuint last_query;
+  };
+
+  // Entry points of the extension, NULL when it is not supported.
+  typedef void(GL_APIENTRYP GenQueriesFunction)(GLsizei, GLuint*);
+  typedef void(GL_APIENTRYP DeleteQueriesFunction)(GLsizei, const GLuint*);
+  typedef void(GL_APIENTRYP BeginQueryFunction)(GLenum, GLuint);
+  typedef void(GL_APIENTRYP EndQueryFunction)(GLenum);
+  typedef void(GL_APIENTRYP GetQueryObjectuivFunction)(GLuint, GLenum,
+                                                       GLuint*);
+  typedef void(GL_APIENTRYP GetQueryObjectui64vFunction)(GLuint, GLenum,
+                                                         uint64_t*);
+
+  // Look up the extension and create the queries of the current context,
+  // once until InvalidateGlResources().
+  void InitializeGl();
+
+  // Read the results of the finished frames, oldest first.
+  void CollectResults();
+
+  std::vector<Pass> passes_;
+  std::vector<Frame> frames_;
+  size_t current_frame_;
+  bool is_frame_started_;
+  int open_pass_;
+
+  RollingAverage frame_interval_;
+  std::chrono::steady_clock::time_point last_frame_time_;
+
+  bool gl_initialized_;
+  bool is_supported_;
+  GenQueriesFunction gen_queries_;
+  DeleteQueriesFunction delete_queries_;
+  BeginQueryFunction begin_query_;
+  EndQueryFunction end_query_;
+  GetQueryObjectuivFunction get_query_objectuiv_;
+  GetQueryObjectui64vFunction get_query_objectui64v_;
+};
+}  // namespace tango_gl
+#endif  // TANGO_GL_GPU_PROFILER_H_
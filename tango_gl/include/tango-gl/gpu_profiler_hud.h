@@ -0,0 +1,62 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_GL_GPU_PROFILER_HUD_H_
+#define TANGO_GL_GPU_PROFILER_HUD_H_
+
+#include <memory>
+#include <vector>
+
+#include "tango-gl/gpu_profiler.h"
+#include "tango-gl/line.h"
+#include "tango-gl/text_renderer.h"
+
+namespace tango_gl {
+
+// GpuProfilerHud draws the times of a GpuProfiler over the frame: one bar
+// per pass, then the total GPU time and the frame interval, in the top left
+// corner of the viewport. A vertical line marks the 16.7 ms budget of a
+// 60 Hz display. The name and time of each bar are written after it, when
+// a system font could be loaded.
+//
+// Must be created once the passes were added to the profiler, and used on
+// the GL thread.
+class GpuProfilerHud {
+ public:
+  explicit GpuProfilerHud(const GpuProfiler* profiler);
+  GpuProfilerHud(const GpuProfilerHud& other) = delete;
+  GpuProfilerHud& operator=(const GpuProfilerHud&) = delete;
+  ~GpuProfilerHud();
+
+  // Draw the bars, without depth test, as the last thing of a frame.
+  void Render();
+
+ private:
+  // Place a bar at |row| from the top, |time| milliseconds long.
+  void SetBar(Line* bar, int row, float time);
+
+  // Queue the text of the bar at |row|.
+  void AddText(int row, const char* name, float time, const Color& color);
+
+  const GpuProfiler* profiler_;
+  // One bar per pass, then the total and the frame interval.
+  std::vector<std::unique_ptr<Line>> bars_;
+  std::unique_ptr<Line> budget_line_;
+  std::vector<Color> bar_colors_;
+  TextRenderer text_;
+};
+}  // namespace tango_gl
+#endif  // TANGO_GL_GPU_PROFILER_HUD_H_
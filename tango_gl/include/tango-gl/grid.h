@@ -17,12 +17,61 @@
 #ifndef TANGO_GL_GRID_H_
 #define TANGO_GL_GRID_H_
 
+#include "tango-gl/bounding_box.h"
+#include "tango-gl/full_screen_quad.h"
 #include "tango-gl/line.h"
 
 namespace tango_gl {
+// Lines of a grid of qx by qy cells in the xz plane, centered on the origin.
+// The grids of cells of 1 by 1 are generated once per GL context and shared
+// by every instance, |density| is the scale of the model matrix.
+//
+// A procedural grid is a single quad over the same extent whose lines are
+// computed per pixel instead, anti-aliased and faded out with the distance to
+// the viewer, so its cost does not depend on the number of cells:
+//
+//   grid_ = new tango_gl::Grid(1.0f, 400, 400);
+//   grid_->SetProcedural(true);
 class Grid : public Line {
  public:
   explicit Grid(float density = 1.0f, int qx = 50, int qy = 50);
+
+  void Render(const glm::mat4& projection_mat, const glm::mat4& view_mat) const;
+
+  // Draw the grid procedurally, or as lines again. Procedural grids need
+  // GL_OES_standard_derivatives. Must be called on the GL thread.
+  //
+  // @return false if the context can not draw procedural grids, the grid then
+  //         stays lines.
+  bool SetProcedural(bool is_procedural);
+  bool IsProcedural() const { return is_procedural_; }
+
+  // Distances to the viewer, in meters, at which the lines of a procedural
+  // grid start to fade out and are gone.
+  void SetFadeDistances(float start, float end) {
+    fade_start_ = start;
+    fade_end_ = end;
+  }
+
+  // @return the box around the lines, in model space, e.g. for culling.
+  BoundingBox GetBoundingBox() const {
+    return BoundingBox(-half_size_, half_size_);
+  }
+
+ private:
+  glm::vec3 half_size_;
+
+  bool is_procedural_;
+  float fade_start_;
+  float fade_end_;
+  GLuint procedural_program_;
+  GLint uniform_procedural_mvp_;
+  GLint uniform_procedural_mv_;
+  GLint uniform_procedural_color_;
+  GLint uniform_half_size_;
+  GLint uniform_line_width_;
+  GLint uniform_fade_;
+  FullScreenQuad quad_;
 };
 }  // namespace tango_gl
 #endif  // TANGO_GL_GRID_H_
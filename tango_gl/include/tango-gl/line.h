@@ -28,10 +28,25 @@ class Line : public DrawableObject {
   void Render(const glm::mat4& projection_mat, const glm::mat4& view_mat) const;
   void UpdateLineVertices(const std::vector<glm::vec3>& vec_vertices) {
     vec_vertices_ = vec_vertices;
+    SetVertexBuffersDirty();
+  }
+  // Empty for lines with shared vertices, e.g. a Grid or a Frustum.
+  const std::vector<glm::vec3>& GetLineVertices() const {
+    return vec_vertices_;
   }
 
  protected:
+  // Draw |vertices| with the line width and render mode, uploading them as a
+  // growing vertex buffer, see UpdateGrowingVertexBuffer(). Lines with shared
+  // vertices draw those instead.
+  void RenderVertices(const glm::mat4& projection_mat,
+                      const glm::mat4& view_mat,
+                      const std::vector<glm::vec3>& vertices) const;
+
   float line_width_;
+  // Drawn from the vertex buffer. Vertices can be appended freely, subclasses
+  // that modify existing ones must call SetVertexBuffersDirty() or
+  // SetVerticesChangedFrom().
   std::vector<glm::vec3> vec_vertices_;
 };
 }  // namespace tango_gl
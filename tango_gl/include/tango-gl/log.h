@@ -0,0 +1,240 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_GL_LOG_H_
+#define TANGO_GL_LOG_H_
+
+#include <android/log.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <atomic>
+#include <cstdio>
+#include <type_traits>
+
+// Logging for the callbacks and render loops, where a logcat line per call
+// costs more than the work it reports:
+//
+//   // At most one line per second, followed by the count of the calls that
+//   // were not logged since the previous one.
+//   TANGO_LOG_EVERY_N_SEC(ANDROID_LOG_INFO, 1.0, "Position: %f, %f, %f",
+//                         pose->translation[0], pose->translation[1],
+//                         pose->translation[2]);
+//
+//   // Every call, as a fixed size binary record of the arguments, formatted
+//   // only when the records are decoded. Does nothing until
+//   // tango_gl::log::BinaryLog::Enable() is called.
+//   TANGO_LOG_BINARY(ANDROID_LOG_INFO, "Point count: %d, depth: %.3f",
+//                    count, depth);
+//
+// The logs below TANGO_GL_MIN_LOG_LEVEL, an Android log priority, compile to
+// nothing, LOGI() and LOGE() included: e.g. building with
+// APP_CFLAGS += -DTANGO_GL_MIN_LOG_LEVEL=6 keeps only the errors.
+#ifndef TANGO_GL_MIN_LOG_LEVEL
+#define TANGO_GL_MIN_LOG_LEVEL 0
+#endif
+
+#define TANGO_GL_LOG_TAG "tango_jni_example"
+
+#define TANGO_GL_LOG_IS_ON(priority) ((priority) >= TANGO_GL_MIN_LOG_LEVEL)
+
+// An expression, as __android_log_print() is.
+#define TANGO_LOG(priority, ...)                                        \
+  (TANGO_GL_LOG_IS_ON(priority)                                         \
+       ? __android_log_print(priority, TANGO_GL_LOG_TAG, __VA_ARGS__) \
+       : 0)
+
+// |format| must be a string literal.
+#define TANGO_LOG_EVERY_N_SEC(priority, seconds, format, ...)           \
+  TANGO_LOG_TAG_EVERY_N_SEC(priority, TANGO_GL_LOG_TAG, seconds, format, \
+                            ##__VA_ARGS__)
+
+// As TANGO_LOG_EVERY_N_SEC(), for the apps logging with their own tag.
+#define TANGO_LOG_TAG_EVERY_N_SEC(priority, tag, seconds, format, ...)      \
+  do {                                                                      \
+    if (TANGO_GL_LOG_IS_ON(priority)) {                                     \
+      static tango_gl::log::RateLimiter tango_log_rate_limiter;             \
+      int tango_log_suppressed = 0;                                         \
+      if (tango_log_rate_limiter.ShouldLog(seconds,                         \
+                                           &tango_log_suppressed)) {        \
+        if (tango_log_suppressed > 0) {                                     \
+          __android_log_print(priority, tag, format " (%d more)",           \
+                              ##__VA_ARGS__, tango_log_suppressed);         \
+        } else {                                                            \
+          __android_log_print(priority, tag, format, ##__VA_ARGS__);        \
+        }                                                                   \
+      }                                                                     \
+    }                                                                       \
+  } while (0)
+
+// The arguments must be numbers, at most BinaryLog::kMaxArguments of them,
+// and |format| a string literal.
+#define TANGO_LOG_BINARY(priority, format, ...)                             \
+  do {                                                                      \
+    if (TANGO_GL_LOG_IS_ON(priority) &&                                     \
+        tango_gl::log::BinaryLog::IsEnabled()) {                            \
+      static const tango_gl::log::BinarySite tango_log_site = {             \
+          priority, __FILE__, __LINE__, format};                            \
+      tango_gl::log::BinaryLog::Record(&tango_log_site, ##__VA_ARGS__);     \
+    }                                                                       \
+  } while (0)
+
+namespace tango_gl {
+namespace log {
+
+// @return the monotonic clock in nanoseconds.
+inline int64_t NowNanoseconds() {
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+// RateLimiter lets a log site through at most once per interval, from any
+// number of threads. The calls it turns away only cost a clock read and an
+// atomic increment.
+class RateLimiter {
+ public:
+  constexpr RateLimiter() : next_time_(0), suppressed_count_(0) {}
+  RateLimiter(const RateLimiter& other) = delete;
+  RateLimiter& operator=(const RateLimiter&) = delete;
+
+  // @param suppressed_count: set to the calls turned away since the last one
+  //        let through, when this one is.
+  // @return true if the site should log, at most once per |seconds|.
+  bool ShouldLog(double seconds, int* suppressed_count) {
+    const int64_t now = NowNanoseconds();
+    int64_t next_time = next_time_.load(std::memory_order_relaxed);
+    if (now < next_time ||
+        !next_time_.compare_exchange_strong(
+            next_time, now + static_cast<int64_t>(seconds * 1e9),
+            std::memory_order_relaxed)) {
+      suppressed_count_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    *suppressed_count =
+        suppressed_count_.exchange(0, std::memory_order_relaxed);
+    return true;
+  }
+
+ private:
+  std::atomic<int64_t> next_time_;
+  std::atomic<int> suppressed_count_;
+};
+
+// A TANGO_LOG_BINARY() site, static for the lifetime of the process.
+struct BinarySite {
+  int priority;
+  const char* file;
+  int line;
+  const char* format;
+};
+
+// BinaryLog keeps the last records of the TANGO_LOG_BINARY() sites in a ring
+// shared by every thread. Recording one copies its arguments without
+// formatting them, and never blocks or allocates; the oldest records are
+// overwritten.
+//
+//   // At startup, or when a bug is being chased.
+//   tango_gl::log::BinaryLog::Enable(1 << 16);
+//   ...
+//   // On demand, e.g. from a debug menu.
+//   tango_gl::log::BinaryLog::Write("/sdcard/Download/tango.tlog");
+//
+//   // Offline, e.g. in a host build of log.cc.
+//   tango_gl::log::BinaryLog::Decode("tango.tlog", stdout);
+//
+// The file holds the formats and locations of the sites recorded, and the
+// records in order, with their monotonic time.
+class BinaryLog {
+ public:
+  static const int kMaxArguments = 6;
+
+  // Allocate a ring of at least |capacity| records, rounded up to a power of
+  // 2, and start recording. Must be called once, before the sites run.
+  static void Enable(int capacity);
+  static bool IsEnabled() {
+    return is_enabled_.load(std::memory_order_relaxed);
+  }
+
+  template <typename... Arguments>
+  static void Record(const BinarySite* site, Arguments... arguments) {
+    static_assert(sizeof...(Arguments) <= kMaxArguments,
+                  "BinaryLog records at most kMaxArguments arguments");
+    Entry entry;
+    entry.site = site;
+    entry.time = NowNanoseconds();
+    entry.argument_count = 0;
+    Pack(&entry, arguments...);
+    Append(entry);
+  }
+
+  // Write the records in the ring to |path|.
+  //
+  // @return false if the file could not be written.
+  static bool Write(const char* path);
+
+  // Format the records of the file at |path| to |output|, a line each.
+  //
+  // @return false if the file could not be read.
+  static bool Decode(const char* path, FILE* output);
+
+ private:
+  enum ArgumentType { kInteger = 1, kUnsigned = 2, kDouble = 3 };
+
+  struct Entry {
+    const BinarySite* site;
+    int64_t time;
+    int argument_count;
+    uint8_t types[kMaxArguments];
+    union {
+      int64_t integer;
+      uint64_t unsigned_integer;
+      double real;
+    } values[kMaxArguments];
+  };
+
+  static void Pack(Entry*) {}
+
+  template <typename Argument, typename... Arguments>
+  static void Pack(Entry* entry, Argument argument, Arguments... arguments) {
+    static_assert(std::is_arithmetic<Argument>::value,
+                  "BinaryLog only records numbers");
+    const int index = entry->argument_count++;
+    if (std::is_floating_point<Argument>::value) {
+      entry->types[index] = kDouble;
+      entry->values[index].real = static_cast<double>(argument);
+    } else if (std::is_signed<Argument>::value) {
+      entry->types[index] = kInteger;
+      entry->values[index].integer = static_cast<int64_t>(argument);
+    } else {
+      entry->types[index] = kUnsigned;
+      entry->values[index].unsigned_integer = static_cast<uint64_t>(argument);
+    }
+    Pack(entry, arguments...);
+  }
+
+  // The records, defined in log.cc.
+  struct Ring;
+
+  static void Append(const Entry& entry);
+
+  static std::atomic<bool> is_enabled_;
+  static Ring* ring_;
+};
+}  // namespace log
+}  // namespace tango_gl
+
+#endif  // TANGO_GL_LOG_H_
@@ -0,0 +1,150 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_GL_MARKER_STORE_H_
+#define TANGO_GL_MARKER_STORE_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "tango-gl/color.h"
+#include "tango-gl/mesh.h"
+#include "tango-gl/streaming_vertex_buffer.h"
+#include "tango-gl/util.h"
+#include "tango-gl/view_frustum.h"
+
+namespace tango_gl {
+// MarkerStore draws thousands of copies of one mesh, e.g. annotations or
+// goal points, without a DrawableObject each.
+//
+// The markers are kept as a structure of arrays: positions, rotations,
+// scales, colors and the visibility and liveness bits each in their own
+// contiguous array, indexed by marker. Render() culls the markers against
+// the view frustum in one pass over the position and scale arrays, which
+// the compiler vectorizes, gathers the model matrix and color of those left
+// into one buffer, and draws them with a single instanced draw call. Without
+// instancing, every marker is drawn with its own call from the same program.
+//
+//   markers_.SetGeometry(goal_marker_);
+//   const uint32_t marker = markers_.Add(position, rotation, 0.1f,
+//                                        Color(1.0f, 0.0f, 0.0f));
+//   ...
+//   markers_.Render(projection_mat, view_mat);
+//
+// The geometry must be a list of triangles, lines or points, drawn with the
+// default shaders of Mesh::SetShader(), e.g. a GoalMarker or a Cube. Its
+// transformation and color are ignored. Marker indices stay valid until
+// removed, and are reused by later markers. All methods must be called on
+// the GL thread.
+class MarkerStore {
+ public:
+  // @param capacity: markers the arrays hold without growing.
+  explicit MarkerStore(size_t capacity);
+  MarkerStore(const MarkerStore& other) = delete;
+  MarkerStore& operator=(const MarkerStore&) = delete;
+
+  // Set the mesh every marker draws, which must outlive the store or be
+  // replaced.
+  void SetGeometry(const Mesh* geometry);
+
+  // @return: the index of a new visible marker.
+  uint32_t Add(const glm::vec3& position, const glm::quat& rotation,
+               float scale, const Color& color);
+
+  // Remove a marker, whose index may then be reused.
+  void Remove(uint32_t marker);
+
+  // Remove every marker.
+  void Clear();
+
+  void SetPosition(uint32_t marker, const glm::vec3& position);
+  void SetRotation(uint32_t marker, const glm::quat& rotation);
+  void SetScale(uint32_t marker, float scale);
+  void SetColor(uint32_t marker, const Color& color, float alpha);
+  void SetVisible(uint32_t marker, bool visible);
+
+  glm::vec3 GetPosition(uint32_t marker) const {
+    return glm::vec3(x_[marker], y_[marker], z_[marker]);
+  }
+
+  // @return: the markers alive.
+  size_t GetCount() const { return count_; }
+
+  // Draw the visible markers in the view frustum.
+  void Render(const glm::mat4& projection_mat, const glm::mat4& view_mat);
+
+  // @return: the markers drawn by the last Render().
+  size_t GetDrawnCount() const { return drawn_markers_.size(); }
+
+  // Delete the buffer objects.
+  void DeleteGlResources();
+
+  // Forget the buffer objects without deleting them, for when the GL context
+  // they belonged to has been destroyed.
+  void InvalidateGlResources();
+
+ private:
+  // Bits of flags_.
+  static const uint8_t kAlive = 1 << 0;
+  static const uint8_t kVisible = 1 << 1;
+
+  // Look up the programs and the instancing entry points of the current
+  // context, once until InvalidateGlResources().
+  void InitializeGl();
+
+  // Fill drawn_markers_ with the markers alive, visible and in |frustum|.
+  void Cull(const ViewFrustum& frustum);
+
+  // Fill instances_ with the model matrix and color of drawn_markers_.
+  void GatherInstances();
+
+  void RenderInstanced(const util::SharedProgram& program);
+  void RenderSeparately(const util::SharedProgram& program);
+
+  const Mesh* geometry_;
+  // Radius of the bounding sphere of the geometry around its origin, at a
+  // scale of 1.
+  float geometry_radius_;
+
+  // One entry per marker index.
+  std::vector<float> x_;
+  std::vector<float> y_;
+  std::vector<float> z_;
+  std::vector<float> scales_;
+  std::vector<glm::quat> rotations_;
+  std::vector<glm::vec4> colors_;
+  std::vector<uint8_t> flags_;
+  std::vector<uint32_t> free_markers_;
+  size_t count_;
+
+  // Rebuilt on every Render(): per marker result of the culling pass, the
+  // markers drawn, and their model matrix and color.
+  std::vector<uint8_t> in_view_;
+  std::vector<uint32_t> drawn_markers_;
+  std::vector<GLfloat> instances_;
+  StreamingVertexBuffer instance_buffer_;
+
+  bool gl_initialized_;
+  const util::SharedProgram* program_;
+  const util::SharedProgram* shaded_program_;
+  // Entry points of instanced drawing, NULL when it is not supported.
+  util::GlCapabilities::DrawArraysInstancedFunction draw_arrays_instanced_;
+  util::GlCapabilities::DrawElementsInstancedFunction draw_elements_instanced_;
+  util::GlCapabilities::VertexAttribDivisorFunction vertex_attrib_divisor_;
+};
+}  // namespace tango_gl
+#endif  // TANGO_GL_MARKER_STORE_H_
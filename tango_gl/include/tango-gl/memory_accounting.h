@@ -0,0 +1,125 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_GL_MEMORY_ACCOUNTING_H_
+#define TANGO_GL_MEMORY_ACCOUNTING_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "tango-gl/util.h"
+
+namespace tango_gl {
+// The subsystems memory is accounted to. Each has a name in the report, see
+// GetMemoryTagName().
+enum MemoryTag {
+  // Texture images and atlases, e.g. Texture and TextRenderer.
+  kMemoryTagTexture = 0,
+  // Textures and pixel buffers updated every frame, e.g. StreamingTexture.
+  kMemoryTagStreamingTexture,
+  // Vertex and index buffers of the drawables.
+  kMemoryTagVertexBuffer,
+  // Paths kept for the whole session, e.g. the Trajectory of a Trace.
+  kMemoryTagTrajectory,
+  // Depth images and the buffers they are computed in.
+  kMemoryTagDepthImage,
+  // Copies of camera images, e.g. YUV frames and their RGB conversion.
+  kMemoryTagCameraImage,
+  // Blocks the BufferPool keeps for the next AlignedBuffer.
+  kMemoryTagBufferPool,
+  kMemoryTagOther,
+  kMemoryTagCount
+};
+
+// Where the memory lives. GPU memory is an estimate from the size and format
+// of what was allocated, drivers add their own padding and copies.
+enum MemoryDomain { kMemoryCpu = 0, kMemoryGpu, kMemoryDomainCount };
+
+struct MemoryUsage {
+  // Bytes accounted right now.
+  int64_t bytes;
+  // The most bytes accounted at once since the start of the process, or the
+  // last ResetMemoryPeaks().
+  int64_t peak_bytes;
+  // Accounts holding any memory, e.g. one per texture.
+  int32_t allocation_count;
+};
+
+// MemoryAccount accounts the memory one object holds for |tag|, e.g. the
+// storage of a vertex buffer, to the process-wide counters of the tag. The
+// owner sets the size whenever it changes, and the destructor returns it:
+//
+//   Texture::Texture() : ..., gpu_memory_(kMemoryTagTexture, kMemoryGpu) {}
+//   ...
+//   glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, ...);
+//   gpu_memory_.Set(EstimateTextureBytes(width, height, GL_RGBA,
+//                                        GL_UNSIGNED_BYTE));
+//   ...
+//   glDeleteTextures(1, &texture_id_);
+//   gpu_memory_.Set(0);
+//
+// The counters are atomic, so each account can be set on the thread of its
+// owner, and costs a few atomic additions when the size changes and nothing
+// otherwise. A copy starts empty, for the owner's copy to account itself on
+// its next Set().
+class MemoryAccount {
+ public:
+  MemoryAccount(MemoryTag tag, MemoryDomain domain);
+  MemoryAccount(const MemoryAccount& other);
+  // Keeps the tag, domain and size of this account.
+  MemoryAccount& operator=(const MemoryAccount& other);
+  ~MemoryAccount();
+
+  // Account |bytes| instead of the previous size.
+  void Set(size_t bytes);
+
+  size_t Get() const { return bytes_; }
+
+ private:
+  MemoryTag tag_;
+  MemoryDomain domain_;
+  size_t bytes_;
+};
+
+// @return the memory accounted to |tag| in |domain|.
+MemoryUsage GetMemoryUsage(MemoryTag tag, MemoryDomain domain);
+
+// @return the memory accounted to every tag in |domain|. The peak is the
+//         highest total, not the sum of the peaks of the tags.
+MemoryUsage GetTotalMemoryUsage(MemoryDomain domain);
+
+// @return the name of |tag| in the report, e.g. "vertex_buffer".
+const char* GetMemoryTagName(MemoryTag tag);
+
+// Restart the peaks from the memory accounted right now, e.g. at the start
+// of a session.
+void ResetMemoryPeaks();
+
+// @return the usage of every tag and the total as a JSON object, e.g.
+//         {"texture":{"cpu_bytes":0,"cpu_peak_bytes":0,"gpu_bytes":262144,
+//         "gpu_peak_bytes":262144,"allocations":2},...,"total":{...}}, for
+//         a JNI query to hand to Java.
+std::string FormatMemoryReport();
+
+// @return the size of a |width| by |height| image of |format| and |type|,
+//         a third more with its mipmaps. Unknown formats count 4 bytes per
+//         pixel.
+size_t EstimateTextureBytes(GLsizei width, GLsizei height, GLenum format,
+                            GLenum type, bool has_mipmaps = false);
+}  // namespace tango_gl
+#endif  // TANGO_GL_MEMORY_ACCOUNTING_H_
@@ -19,27 +19,194 @@
 
 #include "tango-gl/bounding_box.h"
 #include "tango-gl/drawable_object.h"
+#include "tango-gl/mesh_cache.h"
+#include "tango-gl/mesh_indices.h"
+#include "tango-gl/oriented_bounding_box.h"
 #include "tango-gl/segment.h"
 
 namespace tango_gl {
+// A mesh drawn with a uniform color, lit by a directional light or not. Its
+// programs and draws are specialized at compile time on the lighting and on
+// the index buffer, so that drawing a mesh runs straight through the calls
+// of its variant instead of testing its setup every frame.
 class Mesh : public DrawableObject {
  public:
+  // The triangles of a mesh in separate arrays, laid out as those of the
+  // TangoMesh_Experimental of TangoSupport_createMesh(),
+  // TangoSupport_copyMesh() and TangoSupport_createSimplifiedMesh(), so that
+  // such a mesh is drawn without a copy into the vectors of the mesh:
+  //
+  //   const tango_gl::Mesh::Arrays arrays = {
+  //       tango_mesh.vertices,
+  //       tango_mesh.has_normals ? tango_mesh.normals : nullptr,
+  //       tango_mesh.faces, static_cast<GLsizei>(tango_mesh.num_vertices),
+  //       static_cast<GLsizei>(tango_mesh.num_faces)};
+  //   live_mesh_.reset(new tango_gl::Mesh(arrays));
+  //   ...
+  //   // Once the mesh grew, its vertices and faces from the given ones on
+  //   // being new or changed.
+  //   live_mesh_->UpdateVertexBufferRange(arrays, first_vertex, first_face);
+  struct Arrays {
+    const GLfloat (*vertices)[3];
+    // nullptr without normals.
+    const GLfloat (*normals)[3];
+    // Indices into vertices, 0 faces to draw the vertices as a list of
+    // triangles.
+    const GLuint (*faces)[3];
+    GLsizei vertex_count;
+    GLsizei face_count;
+  };
+
   Mesh();
   explicit Mesh(GLenum render_mode);
+  // A mesh of triangles uploaded from |arrays| with SetVertexBuffers(), lit
+  // when it has normals. Must be constructed on the GL thread.
+  explicit Mesh(const Arrays& arrays);
   void SetShader();
   void SetShader(bool is_lighting_on);
+  // Compute the boxes of the vertices, axis-aligned and oriented, for
+  // IsIntersecting(). Needs to be called after SetVertices().
   void SetBoundingBox();
   void SetLightDirection(const glm::vec3& light_direction);
+  // Upload a mesh cache into the vertex buffers, replacing the vertices set
+  // with SetVertices(). The mesh can be unmapped afterwards. Must be called on
+  // the GL thread.
+  void SetVertexBuffers(const MappedMesh& mesh);
+
+  // Upload a mesh of any size in the same way, e.g. the output of
+  // obj_loader::LoadInterleavedOBJData().
+  //
+  // @param vertices: position xyz of every vertex, followed by normal xyz
+  //                  when |has_normals| is set.
+  // @param indices: empty to draw the vertices as a list of triangles.
+  void SetVertexBuffers(const std::vector<GLfloat>& vertices, bool has_normals,
+                        const std::vector<GLuint>& indices);
+
+  // Upload a mesh in the same way along with simplified versions of it, see
+  // MeshLodBuilder. Each frame, the level drawn depends on the size of the
+  // mesh on screen, see SetLodScreenSize(). The levels are dropped when the
+  // mesh needs more than 65536 vertices and the GPU has no 32 bit indices.
+  //
+  // @param lod_indices: triangles of each level over the same vertices,
+  //                     coarsest last.
+  void SetVertexBuffers(const std::vector<GLfloat>& vertices, bool has_normals,
+                        const std::vector<GLuint>& indices,
+                        const std::vector<std::vector<GLuint>>& lod_indices);
+
+  // Upload |arrays| in the same way, straight from the arrays: the positions
+  // and then the normals into the vertex buffer, and the faces as they are
+  // into the index buffer. Without GL_OES_element_index_uint the mesh is
+  // interleaved and its indices narrowed as with the vectors.
+  void SetVertexBuffers(const Arrays& arrays);
+
+  // Upload only the vertices of |arrays| from |first_vertex| on and its faces
+  // from |first_face| on, the others being those of the last upload of the
+  // arrays of the mesh, for a mesh that changes incrementally. The buffers
+  // grow geometrically, and all of |arrays| is uploaded when they grow, or
+  // when the last upload was of other vertices. The bounds only ever grow to
+  // the vertices uploaded. Must be called on the GL thread.
+  void UpdateVertexBufferRange(const Arrays& arrays, GLsizei first_vertex,
+                               GLsizei first_face);
+
+  static constexpr float kDefaultLodScreenSize = 0.5f;
+
+  // Set the screen size under which the first simplified level is drawn, as
+  // the fraction of the viewport height covered by the bounds of the mesh.
+  // Each next level is drawn under half the size of the previous one, as it
+  // has a quarter of its triangles. Defaults to kDefaultLodScreenSize.
+  void SetLodScreenSize(float screen_size) { lod_screen_size_ = screen_size; }
+
+  // @return the number of levels set with SetVertexBuffers(), the full mesh
+  //         included, 1 without simplified levels.
+  int GetLodCount() const {
+    return lods_.empty() ? 1 : static_cast<int>(lods_.size());
+  }
   void Render(const glm::mat4& projection_mat, const glm::mat4& view_mat) const;
+  // Test a segment against the oriented box of SetBoundingBox(), moved by
+  // the transformation of the mesh.
   bool IsIntersecting(const Segment& segment);
+  // @return the box set by SetBoundingBox(), in model space, or NULL.
+  const BoundingBox* GetBoundingBox() const {
+    return is_bounding_box_on_ ? bounding_box_ : NULL;
+  }
+  // @return the oriented box set by SetBoundingBox(), in model space, or
+  //         NULL.
+  const OrientedBoundingBox* GetOrientedBoundingBox() const {
+    return is_bounding_box_on_ ? &oriented_bounding_box_ : NULL;
+  }
 
  protected:
+  friend class MarkerStore;
+  friend class RenderQueue;
+
+  // A level of detail: a range of the index buffer.
+  struct Lod {
+    GLsizei first_index;
+    GLsizei index_count;
+  };
+
+  // The draw of a variant of the mesh.
+  typedef void (Mesh::*RenderFunction)(const glm::mat4& projection_mat,
+                                       const glm::mat4& view_mat) const;
+
+  // Upload the vertices and indices of SetVertexBuffers(). Without
+  // GL_OES_element_index_uint, triangles with 32 bit indices are split into
+  // chunks of 16 bit indices, drawn one after the other.
+  void UploadMesh(const void* vertex_data, GLsizei vertex_count,
+                  GLsizei vertex_stride, bool has_normals,
+                  const void* index_data, GLsizei index_count,
+                  GLenum index_type, const glm::vec3& bounding_min,
+                  const glm::vec3& bounding_max);
+
+  // Reallocate the buffers of UpdateVertexBufferRange() for
+  // |vertex_capacity| vertices and |face_capacity| faces.
+  void AllocateArrayBuffers(GLsizei vertex_capacity, GLsizei face_capacity,
+                            bool has_normals);
+
+  // @return the level to draw the mesh with, 0 being the full mesh.
+  int SelectLod(const glm::mat4& projection_mat, const glm::mat4& mv_mat) const;
+
+  // Get the program of the lit or unlit vertex shader, and its locations.
+  template <bool kIsLit>
+  void SetProgram();
+
+  // Draw the uploaded buffers with the program of SetProgram<kIsLit>(), with
+  // glDrawElements() if |kIsIndexed|, glDrawArrays() otherwise.
+  template <bool kIsLit, bool kIsIndexed>
+  void RenderVariant(const glm::mat4& projection_mat,
+                     const glm::mat4& view_mat) const;
+
   BoundingBox* bounding_box_;
+  OrientedBoundingBox oriented_bounding_box_;
   bool is_lighting_on_;
   bool is_bounding_box_on_;
   glm::vec3 light_direction_;
   GLuint uniform_mv_mat_;
   GLuint uniform_light_vec_;
+
+  // Set by SetVertexBuffers(), with the bounds of the mesh.
+  bool is_cached_mesh_;
+  glm::vec3 buffer_bounding_min_;
+  glm::vec3 buffer_bounding_max_;
+
+  // The capacity of the buffers uploaded from Arrays, in vertices and faces,
+  // 0 when they hold other vertices.
+  GLsizei array_vertex_capacity_;
+  GLsizei array_face_capacity_;
+  // Vertices and faces written to those buffers since they were allocated,
+  // past which no draw ever read them.
+  GLsizei array_written_vertex_count_;
+  GLsizei array_written_face_count_;
+
+  // The draws of a mesh split by UploadMesh(), empty when the indices are
+  // drawn at once. Dropped when other vertices are set.
+  mutable std::vector<mesh_indices::IndexChunk> index_chunks_;
+
+  // The levels of detail set by SetVertexBuffers(), the full mesh first, or
+  // empty. buffer_index_count_ is the one of the full mesh, which is what
+  // RenderQueue and MarkerStore draw. Dropped when other vertices are set.
+  mutable std::vector<Lod> lods_;
+  float lod_screen_size_;
 };
 }  // namespace tango_gl
 #endif  // TANGO_GL_MESH_H_
@@ -0,0 +1,146 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_GL_MESH_CACHE_H_
+#define TANGO_GL_MESH_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "tango-gl/util.h"
+
+namespace tango_gl {
+namespace mesh_cache {
+// Layout of a mesh cache file. All fields are little endian, which is the
+// byte order of every Android ABI.
+//
+//   Header
+//   vertex_count vertices of vertex_stride bytes: position xyz, followed by
+//                normal xyz when kHasNormals is set, and by uv when
+//                kHasTexCoords is set.
+//   index_count indices, GLushort or GLuint when kHasUintIndices is set,
+//               starting at a 4 byte aligned offset.
+//
+// A mesh without indices is drawn with glDrawArrays.
+struct Header {
+  char magic[4];
+  uint32_t version;
+  uint32_t flags;
+  uint32_t vertex_count;
+  uint32_t vertex_stride;
+  uint32_t index_count;
+  float bounding_min[3];
+  float bounding_max[3];
+  // Size and modification time of the OBJ file the cache was built from.
+  int64_t source_size;
+  int64_t source_mtime;
+};
+
+static const uint32_t kHasNormals = 1 << 0;
+static const uint32_t kHasUintIndices = 1 << 1;
+static const uint32_t kHasTexCoords = 1 << 2;
+
+// Write a mesh cache file. The file is written next to |path| and renamed
+// into place, so a reader never sees a partial cache.
+//
+// @param vertices: position xyz of every vertex, followed by normal xyz when
+//                  has_normals is set, and by uv when has_tex_coords is set.
+// @param indices: empty to draw the vertices as a list of triangles. They are
+//                 stored as GLushort when every vertex fits, GLuint otherwise.
+// @param source_path: the OBJ file the mesh was loaded from, may be NULL.
+bool WriteMeshCache(const char* path, const std::vector<GLfloat>& vertices,
+                    bool has_normals, bool has_tex_coords,
+                    const std::vector<GLuint>& indices,
+                    const char* source_path);
+}  // namespace mesh_cache
+
+// MappedMesh gives read access to a mesh cache file mapped into memory. The
+// vertex and index blocks can be handed to glBufferData as they are, loading
+// a mesh costs no more than paging it in.
+class MappedMesh {
+ public:
+  MappedMesh();
+  MappedMesh(const MappedMesh& other) = delete;
+  MappedMesh& operator=(const MappedMesh&) = delete;
+  ~MappedMesh();
+
+  // Map a cache file, closing the previous one.
+  //
+  // @return false if the file is missing or is not a valid cache.
+  bool Open(const char* path);
+
+  // Unmap the file.
+  void Close();
+
+  bool IsOpen() const { return header_ != NULL; }
+  const mesh_cache::Header& GetHeader() const { return *header_; }
+
+  bool HasNormals() const {
+    return (header_->flags & mesh_cache::kHasNormals) != 0;
+  }
+  bool HasTexCoords() const {
+    return (header_->flags & mesh_cache::kHasTexCoords) != 0;
+  }
+  GLsizei GetVertexCount() const { return header_->vertex_count; }
+  GLsizei GetVertexStride() const { return header_->vertex_stride; }
+  const void* GetVertexData() const { return vertex_data_; }
+  GLsizeiptr GetVertexDataSize() const {
+    return static_cast<GLsizeiptr>(header_->vertex_count) *
+           header_->vertex_stride;
+  }
+
+  GLsizei GetIndexCount() const { return header_->index_count; }
+  // @return GL_UNSIGNED_SHORT or GL_UNSIGNED_INT.
+  GLenum GetIndexType() const {
+    return (header_->flags & mesh_cache::kHasUintIndices) ? GL_UNSIGNED_INT
+                                                          : GL_UNSIGNED_SHORT;
+  }
+  const void* GetIndexData() const { return index_data_; }
+  GLsizeiptr GetIndexDataSize() const;
+
+  glm::vec3 GetBoundingMin() const;
+  glm::vec3 GetBoundingMax() const;
+
+ private:
+  void* mapping_;
+  size_t mapping_size_;
+  const mesh_cache::Header* header_;
+  const void* vertex_data_;
+  const void* index_data_;
+};
+
+namespace mesh_cache {
+// Load an OBJ file through a mesh cache. If |cache_path| holds a cache built
+// from the current version of |obj_path|, it is mapped directly. Otherwise the
+// OBJ file is parsed with obj_loader::LoadInterleavedOBJData and the cache is
+// written
+// first, so only the first load pays for the text parsing. If the OBJ file is
+// missing, a cache found at |cache_path| is used as is.
+//
+// @param with_normals: interleave a normal with every position, which needs
+//                      every face vertex to have one.
+bool LoadOBJData(const char* obj_path, const char* cache_path,
+                 bool with_normals, MappedMesh* mesh);
+
+// Same as above, also interleaving the texture coordinates when
+// |with_tex_coords| is set, which needs every face vertex to have one. Mesh
+// draws such a cache as any other, skipping the texture coordinates.
+bool LoadOBJData(const char* obj_path, const char* cache_path,
+                 bool with_normals, bool with_tex_coords, MappedMesh* mesh);
+}  // namespace mesh_cache
+}  // namespace tango_gl
+#endif  // TANGO_GL_MESH_CACHE_H_
@@ -0,0 +1,91 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_GL_MESH_LOD_BUILDER_H_
+#define TANGO_GL_MESH_LOD_BUILDER_H_
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "tango-gl/mesh.h"
+#include "tango-gl/mesh_simplifier.h"
+
+namespace tango_gl {
+// MeshLodBuilder simplifies meshes into levels of detail on a worker thread
+// and uploads them on the GL thread, so imported models get their levels
+// without blocking the caller or a frame.
+//
+//   std::vector<GLfloat> vertices;
+//   std::vector<GLuint> indices;
+//   obj_loader::LoadInterleavedOBJData(path, true, vertices, indices);
+//   // Drawn in full detail until the levels are uploaded.
+//   model.SetVertexBuffers(vertices, true, indices);
+//   builder.Build(vertices, true, indices, &model);
+//   ...
+//   // Once per frame, on the GL thread.
+//   builder.UploadBuilt(1);
+//
+// Meshes must outlive the builder, or at least their upload.
+class MeshLodBuilder {
+ public:
+  // @param lod_count: simplified levels made for each mesh.
+  explicit MeshLodBuilder(int lod_count = mesh_simplifier::kDefaultLodCount);
+  MeshLodBuilder(const MeshLodBuilder& other) = delete;
+  MeshLodBuilder& operator=(const MeshLodBuilder&) = delete;
+  // Waits for the mesh being simplified, if any, and drops the others.
+  ~MeshLodBuilder();
+
+  // Queue a mesh to simplify into |mesh|, with the arguments of
+  // Mesh::SetVertexBuffers(). Can be called on any thread.
+  void Build(const std::vector<GLfloat>& vertices, bool has_normals,
+             const std::vector<GLuint>& indices, Mesh* mesh);
+
+  // Upload the meshes whose levels were built, at most |max_count| of them
+  // since each upload is a full Mesh::SetVertexBuffers(). Must be called on
+  // the GL thread.
+  //
+  // @return the number of meshes uploaded.
+  int UploadBuilt(int max_count);
+
+  // @return the number of meshes queued and not uploaded yet.
+  size_t GetPendingCount() const;
+
+ private:
+  struct Request {
+    std::vector<GLfloat> vertices;
+    bool has_normals;
+    std::vector<GLuint> indices;
+    std::vector<std::vector<GLuint>> lod_indices;
+    Mesh* mesh;
+  };
+
+  void BuildLoop();
+
+  const int lod_count_;
+  mutable std::mutex mutex_;
+  std::condition_variable request_available_;
+  std::deque<Request> requests_;
+  std::deque<Request> built_;
+  // Whether the worker is simplifying a request it took.
+  bool is_building_;
+  bool is_stopping_;
+  std::thread worker_;
+};
+}  // namespace tango_gl
+#endif  // TANGO_GL_MESH_LOD_BUILDER_H_
@@ -0,0 +1,58 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_GL_MESH_SIMPLIFIER_H_
+#define TANGO_GL_MESH_SIMPLIFIER_H_
+
+#include <vector>
+
+#include "tango-gl/util.h"
+
+namespace tango_gl {
+namespace mesh_simplifier {
+// Number of levels of detail BuildLods() makes by default, the full mesh
+// excluded.
+static const int kDefaultLodCount = 3;
+
+// Simplify the triangle list |indices| down to about |target_triangle_count|
+// triangles by quadric edge collapse, after Garland and Heckbert, "Surface
+// Simplification Using Quadric Error Metrics". Edges collapse into one of
+// their vertices rather than a new one, so the simplified triangles index the
+// same vertex buffer as the full mesh. Borders of open meshes, e.g.
+// reconstructed ones, are kept in place. Slow enough to run off the GL
+// thread, see MeshLodBuilder.
+//
+// @param vertices: position xyz of every vertex, followed by normal xyz when
+//                  |has_normals| is set.
+// @param simplified_indices: set to the remaining triangles. Fewer than the
+//                            target are removed when more collapses would
+//                            fold the surface over.
+void Simplify(const std::vector<GLfloat>& vertices, bool has_normals,
+              const std::vector<GLuint>& indices, size_t target_triangle_count,
+              std::vector<GLuint>* simplified_indices);
+
+// Make |lod_count| simplified versions of a mesh, each with a quarter of the
+// triangles of the previous one, which is what a halving of its size on
+// screen allows. Each one is ordered for the vertex cache.
+//
+// @param lod_indices: set to the triangles of each level, coarsest last.
+//                     Levels that would not be much smaller are left out.
+void BuildLods(const std::vector<GLfloat>& vertices, bool has_normals,
+               const std::vector<GLuint>& indices, int lod_count,
+               std::vector<std::vector<GLuint>>* lod_indices);
+}  // namespace mesh_simplifier
+}  // namespace tango_gl
+#endif  // TANGO_GL_MESH_SIMPLIFIER_H_
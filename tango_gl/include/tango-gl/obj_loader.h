@@ -32,7 +32,7 @@ namespace obj_loader {
 //   f 1 2 3 4
 //   ..."
 //
-//  If exported with normals, file should look like
+//  If exported with normals or texture coordinates, file should look like
 //  "v 1.00 2.00 3.00
 //   ...
 //   (Any format listed here for 'f' is supported)
@@ -42,6 +42,8 @@ namespace obj_loader {
 //   f 1/1/1 2/2/3 3/4/4 4/5/6
 //   ...
 //   vn 1.00 2.00 3.00
+//   ...
+//   vt 0.50 0.25
 //   ..."
 //  this can be used with Mesh:
 //
@@ -53,12 +55,43 @@ namespace obj_loader {
 //  or
 //  tango_gl::obj_loader::LoadOBJData("/sdcard/model.obj", vertices, normals);
 //  mesh->SetVertices(vertices, normals);
+//
+//  To avoid parsing large files on every start, see mesh_cache::LoadOBJData.
+//
+//  Faces with more than 3 vertices are split into triangles, and negative
+//  (relative) indices are supported. Loaded data is appended to the vectors.
 
+// Load the vertices with one GLushort index per triangle corner. Fails for
+// meshes of more than 65536 vertices, use the GLuint overload for those.
 bool LoadOBJData(const char* path, std::vector<GLfloat>& vertices,
                  std::vector<GLushort>& indices);
 
+// Same as above with GLuint indices, which need OpenGL ES 3.0 or the
+// GL_OES_element_index_uint extension to be drawn.
+bool LoadOBJData(const char* path, std::vector<GLfloat>& vertices,
+                 std::vector<GLuint>& indices);
+
+// Load one vertex and one normal per triangle corner, without indices.
 bool LoadOBJData(const char* path, std::vector<GLfloat>& vertices,
                  std::vector<GLfloat>& normals);
+
+// Load an indexed mesh where every distinct position/normal pair of the faces
+// is one vertex, stored interleaved as position xyz followed by normal xyz
+// when |with_normals| is true, and position xyz only otherwise. This is both
+// smaller and faster to draw than the non-indexed normals overload.
+bool LoadInterleavedOBJData(const char* path, bool with_normals,
+                            std::vector<GLfloat>& vertices,
+                            std::vector<GLuint>& indices);
+
+// Same as above, with the texture coordinates of the 'vt' lines interleaved
+// last when |with_tex_coords| is true: position xyz, normal xyz if
+// |with_normals|, then uv. The normals stay where Mesh reads them. Distinct
+// position/texture coordinate/normal triples are distinct vertices, e.g. on
+// the seams of a texture.
+bool LoadInterleavedOBJData(const char* path, bool with_normals,
+                            bool with_tex_coords,
+                            std::vector<GLfloat>& vertices,
+                            std::vector<GLuint>& indices);
 }  // namespace obj_loader
 }  // namespace tango_gl
 #endif  // TANGO_GL_OBJ_LOADER_H_
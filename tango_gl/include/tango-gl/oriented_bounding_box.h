@@ -0,0 +1,80 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef TANGO_GL_ORIENTED_BOUNDING_BOX_H_
+#define TANGO_GL_ORIENTED_BOUNDING_BOX_H_
+
+#include <vector>
+
+#include "tango-gl/bounding_box.h"
+#include "tango-gl/segment.h"
+#include "tango-gl/util.h"
+
+namespace tango_gl {
+// OrientedBoundingBox is a box along the directions the vertices of an
+// object spread on, with the sphere around them for quick rejection. For
+// long objects that are rotated, it is much tighter than the axis-aligned
+// box of their transformed BoundingBox, so culling and picking reject them
+// more often.
+//
+// The axes are fitted once, from the principal components of the vertices,
+// e.g. in Mesh::SetBoundingBox(). The axis-aligned box is kept instead when
+// it is smaller, e.g. for a cube. Moving the object only transforms the
+// box, see GetTransformed().
+class OrientedBoundingBox {
+ public:
+  // An empty box at the origin.
+  OrientedBoundingBox();
+  // The box of |box|, along its axes.
+  explicit OrientedBoundingBox(const BoundingBox& box);
+  // Fit the box to vertices, packed xyz or not.
+  explicit OrientedBoundingBox(const std::vector<float>& vertices);
+  explicit OrientedBoundingBox(const std::vector<glm::vec3>& vertices);
+
+  const glm::vec3& GetCenter() const { return center_; }
+  // @return the axis |index| of the box, a unit vector.
+  const glm::vec3& GetAxis(int index) const { return axes_[index]; }
+  const glm::vec3* GetAxes() const { return axes_; }
+  // @return the half size of the box along each axis.
+  const glm::vec3& GetHalfExtent() const { return half_extent_; }
+
+  // @return the radius of the sphere around the vertices, centered on the
+  //         box, never larger than the sphere around the box.
+  float GetRadius() const { return radius_; }
+
+  // @return this box transformed by |transformation|, which must be affine.
+  //         A scale that is not uniform keeps the box around the vertices,
+  //         if looser.
+  OrientedBoundingBox GetTransformed(const glm::mat4& transformation) const;
+
+  // @return the axis-aligned box containing this box.
+  BoundingBox GetAxisAligned() const;
+
+  // Test a segment against the box, rejected by the sphere first.
+  bool IsIntersecting(const Segment& segment) const;
+
+ private:
+  // Fit the box to |count| vertices |stride| floats apart.
+  void Fit(const float* vertices, size_t count, size_t stride);
+
+  glm::vec3 center_;
+  glm::vec3 axes_[3];
+  glm::vec3 half_extent_;
+  float radius_;
+};
+}  // namespace tango_gl
+#endif  // TANGO_GL_ORIENTED_BOUNDING_BOX_H_
@@ -0,0 +1,107 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_GL_OVERLAY_TARGET_H_
+#define TANGO_GL_OVERLAY_TARGET_H_
+
+#include "tango-gl/full_screen_quad.h"
+#include "tango-gl/memory_accounting.h"
+#include "tango-gl/util.h"
+
+namespace tango_gl {
+
+// OverlayTarget renders the virtual content of an AR view at a fraction of
+// the resolution of the viewport, and blends it over the camera image drawn
+// at full resolution, so that a slow GPU keeps its frame rate without
+// blurring the camera image:
+//
+//   video_overlay_->Render(glm::mat4(1.0f), glm::mat4(1.0f));
+//   overlay_target_.SetScale(quality.render_scale);
+//   overlay_target_.Begin();
+//   ... render the virtual objects ...
+//   overlay_target_.End();
+//
+// Begin() binds a framebuffer of the size of the current viewport times the
+// scale, cleared to transparent, with its own depth buffer. End() draws it
+// stretched over the viewport of Begin(), with the color taken as
+// premultiplied by its alpha: opaque content is blended exactly, translucent
+// content a little lighter than drawn directly, as its alpha is blended too.
+//
+// At a scale of 1, or when the framebuffer can not be created, Begin() and
+// End() do nothing and the content is drawn directly into the viewport. The
+// framebuffer is only reallocated when its size changes, e.g. when the
+// scale does.
+//
+// All methods must be called on the GL thread.
+class OverlayTarget {
+ public:
+  // The smallest scale, below which the content is too blurry to be useful.
+  static const float kMinScale;
+
+  OverlayTarget();
+  OverlayTarget(const OverlayTarget& other) = delete;
+  OverlayTarget& operator=(const OverlayTarget&) = delete;
+  ~OverlayTarget();
+
+  // Set the scale of the resolution of the next Begin(), clamped to
+  // [kMinScale, 1].
+  void SetScale(float scale);
+  float GetScale() const { return scale_; }
+
+  // Redirect the rendering into the framebuffer.
+  //
+  // @return false if the content is drawn directly, at a scale of 1 or
+  //         without the framebuffer.
+  bool Begin();
+
+  // Restore the framebuffer and viewport of Begin(), and blend the content
+  // over it. Depth testing and blending are left as they were in Begin().
+  void End();
+
+  // Delete the framebuffer and program.
+  void DeleteGlResources();
+
+  // Forget the GL objects without deleting them, for when the GL context they
+  // belonged to has been destroyed.
+  void InvalidateGlResources();
+
+ private:
+  // Create the program once, and the framebuffer of |width| by |height|
+  // whenever its size changes.
+  //
+  // @return false if the framebuffer is not complete.
+  bool InitializeFramebuffer(GLsizei width, GLsizei height);
+
+  float scale_;
+  bool is_active_;
+
+  GLuint program_;
+  GLint texture_location_;
+  FullScreenQuad quad_;
+
+  GLuint framebuffer_;
+  GLuint color_texture_;
+  GLuint depth_renderbuffer_;
+  GLsizei framebuffer_width_;
+  GLsizei framebuffer_height_;
+  MemoryAccount gpu_memory_;
+
+  // The framebuffer and viewport of Begin().
+  GLint previous_framebuffer_;
+  GLint previous_viewport_[4];
+};
+}  // namespace tango_gl
+#endif  // TANGO_GL_OVERLAY_TARGET_H_
@@ -0,0 +1,144 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_GL_PLANE_INLIER_REDUCER_H_
+#define TANGO_GL_PLANE_INLIER_REDUCER_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "tango-gl/util.h"
+
+namespace tango_gl {
+
+// Statistics of the points close to a plane.
+struct PlaneInliers {
+  // The plane the points were classified against.
+  glm::vec4 plane;
+  uint32_t count;
+  glm::vec3 centroid;
+  // Covariance of the inliers, divided by their count.
+  glm::mat3 covariance;
+};
+
+// PlaneInlierReducer classifies the points of a vertex buffer against a plane
+// and reduces the inliers to their count, centroid and covariance, all on the
+// GPU with the compute shaders of GLES 3.1:
+//
+//   // Every frame, once the points were uploaded to the buffer.
+//   reducer_.Reduce(buffer, point_count, world_T_points, plane, 0.05f);
+//   PlaneInliers inliers;
+//   if (reducer_.GetLatestInliers(&inliers)) {
+//     // Refine the plane from inliers.centroid and inliers.covariance.
+//   }
+//
+// A reduction is only read back once a fence says the GPU finished it, a few
+// frames later, so neither the points nor the results ever stall the
+// pipeline. Without GLES 3.1, Reduce() does nothing and no inliers are ever
+// returned.
+//
+// All methods must be called on the GL thread.
+class PlaneInlierReducer {
+ public:
+  PlaneInlierReducer();
+  PlaneInlierReducer(const PlaneInlierReducer& other) = delete;
+  PlaneInlierReducer& operator=(const PlaneInlierReducer&) = delete;
+  ~PlaneInlierReducer();
+
+  // Queue the reduction of the points within |distance| of |plane|.
+  //
+  // @param points_buffer: buffer object of tightly packed x, y, z floats, e.g.
+  //        the one of a StreamingVertexBuffer.
+  // @param point_count: number of points in the buffer.
+  // @param frame_T_points: transform of the points to the frame of |plane|,
+  //        where the statistics are computed.
+  // @param plane: plane equation, with a unit normal.
+  // @param distance: maximum distance of an inlier to the plane, in meters.
+  void Reduce(GLuint points_buffer, uint32_t point_count,
+              const glm::mat4& frame_T_points, const glm::vec4& plane,
+              float distance);
+
+  // Read the reductions the GPU finished since the last call.
+  //
+  // @param inliers: set to the latest finished reduction.
+  //
+  // @return false if no reduction finished.
+  bool GetLatestInliers(PlaneInliers* inliers);
+
+  // @return true if the GL context supports compute shaders, once Reduce()
+  // was called.
+  bool IsSupported() const { return is_supported_; }
+
+  // Delete the programs, buffers and fences.
+  void DeleteGlResources();
+
+  // Forget the programs, buffers and fences without deleting them, for when
+  // the GL context they belonged to has been destroyed.
+  void InvalidateGlResources();
+
+ private:
+  // A reduction in flight.
+  struct Reduction {
+    // Buffer the final sums are written to, read back once |fence| signals.
+    GLuint result_buffer;
+    // Set while the result has not been read.
+    util::GlCapabilities::Sync fence;
+    glm::vec4 plane;
+    glm::vec3 origin;
+  };
+
+  // Look up the entry points and create the programs and buffers of the
+  // current context, once until InvalidateGlResources().
+  void InitializeGl();
+
+  // Read a finished reduction into |inliers|.
+  //
+  // @return false if it had no inliers.
+  bool ReadReduction(const Reduction& reduction, PlaneInliers* inliers);
+
+  bool gl_initialized_;
+  bool is_supported_;
+  util::GlCapabilities::DispatchComputeFunction dispatch_compute_;
+  util::GlCapabilities::MemoryBarrierFunction memory_barrier_;
+  util::GlCapabilities::BindBufferBaseFunction bind_buffer_base_;
+  util::GlCapabilities::MapBufferRangeFunction map_buffer_range_;
+  util::GlCapabilities::UnmapBufferFunction unmap_buffer_;
+  util::GlCapabilities::FenceSyncFunction fence_sync_;
+  util::GlCapabilities::ClientWaitSyncFunction client_wait_sync_;
+  util::GlCapabilities::DeleteSyncFunction delete_sync_;
+
+  // Sums the points of each work group into partial_buffer_, then sums the
+  // partial sums into the result buffer of a reduction.
+  GLuint classify_program_;
+  GLuint sum_program_;
+  GLint point_count_location_;
+  GLint frame_T_points_location_;
+  GLint plane_location_;
+  GLint distance_location_;
+  GLint origin_location_;
+  GLuint partial_buffer_;
+
+  // Ring of reductions, the oldest being read first.
+  std::vector<Reduction> reductions_;
+  size_t next_reduction_;
+
+  // Used to center the sums, for their precision.
+  glm::vec3 last_centroid_;
+  bool has_last_centroid_;
+};
+}  // namespace tango_gl
+#endif  // TANGO_GL_PLANE_INLIER_REDUCER_H_
@@ -0,0 +1,69 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_GL_POINT_CLOUD_STATISTICS_H_
+#define TANGO_GL_POINT_CLOUD_STATISTICS_H_
+
+#include <cstdint>
+
+#include "glm/glm.hpp"
+
+namespace tango_gl {
+// PointCloudStatistics summarizes a point cloud, e.g. for a depth readout or
+// to normalize a depth colormap:
+//
+//   tango_gl::PointCloudStatistics statistics;
+//   tango_gl::GetPointCloudStatistics(point_cloud->xyz[0],
+//                                     point_cloud->xyz_count, &statistics);
+//   LOGI("Average depth (m): %.3f +- %.3f", statistics.mean.z,
+//        sqrt(statistics.variance.z));
+//
+// QuantizedPoints::Quantize() computes it as a by-product of packing the
+// points, depth histogram included, so an uploaded cloud is never walked
+// again for it.
+struct PointCloudStatistics {
+  static const int kDepthBins = 64;
+
+  PointCloudStatistics();
+
+  // Drop the points, the statistics become those of an empty cloud.
+  void Clear();
+
+  // @return the depth that |fraction| of the points are closer than,
+  //         interpolated within the bins of depth_histogram, or min.z
+  //         without a histogram.
+  float GetDepthPercentile(float fraction) const;
+
+  int count;
+  // Bounding box, centroid and per axis variance of the points, 0 without
+  // points.
+  glm::vec3 min;
+  glm::vec3 max;
+  glm::vec3 mean;
+  glm::vec3 variance;
+
+  // Points per bin of z, the bins splitting [min.z, max.z] evenly. Only
+  // filled by QuantizedPoints::Quantize(), all 0 otherwise.
+  uint32_t depth_histogram[kDepthBins];
+};
+
+// Compute the count, bounding box, centroid and variance of |count| points
+// of packed xyz floats, in a single pass that reads them in place, e.g. right
+// from a TangoXYZij. The depth histogram is left empty.
+void GetPointCloudStatistics(const float* xyz, int count,
+                             PointCloudStatistics* statistics);
+}  // namespace tango_gl
+#endif  // TANGO_GL_POINT_CLOUD_STATISTICS_H_
@@ -0,0 +1,86 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_GL_POINT_LEVEL_OF_DETAIL_H_
+#define TANGO_GL_POINT_LEVEL_OF_DETAIL_H_
+
+#include "tango-gl/util.h"
+
+// GLSL declaration of the uniform "point_size_scale", and of
+// "float PointSizeByDistance(highp vec4 position)", for vertex shaders. A
+// literal, to be concatenated with the rest of the source at compile time.
+// Points stop shrinking at one pixel, and stop growing at 16 which every GPU
+// we run on rasterizes.
+#define TANGO_GL_GLSL_POINT_SIZE_BY_DISTANCE                                  \
+  "uniform highp float point_size_scale;\n"                                  \
+  "float PointSizeByDistance(highp vec4 position) {\n"                       \
+  "  return clamp(point_size_scale / max(position.w, 0.001), 1.0, 16.0);\n" \
+  "}\n"
+
+namespace tango_gl {
+// PointLevelOfDetail keeps the points drawn within a budget. The points are
+// stored in a shuffled order, see GetShuffleStride(), so that any prefix of
+// them is an even subsample of the whole cloud, and only the prefix that fits
+// the budget is drawn:
+//
+//   lod_.SetPointBudget(quality.point_budget);
+//   const int draw_count =
+//       lod_.Update(point_count, projection_mat, viewport_height_);
+//   lod_.SetUniforms(point_size_scale_handle_);
+//   glDrawArrays(GL_POINTS, 0, draw_count);
+//
+// Points are sized by their distance to the camera, and grown as fewer of
+// them are drawn, so the cloud keeps covering the same part of the screen.
+// The vertex shader declares TANGO_GL_GLSL_POINT_SIZE_BY_DISTANCE and sets
+// gl_PointSize = PointSizeByDistance(gl_Position).
+class PointLevelOfDetail {
+ public:
+  PointLevelOfDetail();
+  PointLevelOfDetail(const PointLevelOfDetail& other) = delete;
+  PointLevelOfDetail& operator=(const PointLevelOfDetail&) = delete;
+
+  // @param point_budget: the most points drawn, 0 to draw them all.
+  void SetPointBudget(int point_budget) { point_budget_ = point_budget; }
+  int GetPointBudget() const { return point_budget_; }
+
+  // @param point_size: diameter of a point in meters when every point is
+  //                    drawn, e.g. the voxel size of a downsampled cloud.
+  void SetPointSize(float point_size) { point_size_ = point_size; }
+
+  // Fit |count| points to the budget for a frame.
+  //
+  // @param projection_mat: projection matrix of the render camera.
+  // @param viewport_height: height of the viewport in pixels.
+  // @return the number of points to draw, from the first one.
+  int Update(int count, const glm::mat4& projection_mat, int viewport_height);
+
+  // Set the uniform of TANGO_GL_GLSL_POINT_SIZE_BY_DISTANCE for the last
+  // Update(), on the current program.
+  void SetUniforms(GLint point_size_scale_location) const;
+
+  // @return a stride coprime with |count|, about count divided by the golden
+  //         ratio. Visiting (i * stride) % count for i in [0, count) visits
+  //         every index once, and any prefix of that order spreads evenly
+  //         over [0, count).
+  static int GetShuffleStride(int count);
+
+ private:
+  int point_budget_;
+  float point_size_;
+  float point_size_scale_;
+};
+}  // namespace tango_gl
+#endif  // TANGO_GL_POINT_LEVEL_OF_DETAIL_H_
@@ -0,0 +1,69 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_GL_POINT_TRANSFORM_H_
+#define TANGO_GL_POINT_TRANSFORM_H_
+
+#include <cstdint>
+
+#include "glm/glm.hpp"
+
+namespace tango_gl {
+// Batch kernels moving packed xyz floats, e.g. the points of a TangoXYZij,
+// from one frame to another, instead of a glm::mat4 * glm::vec4 per point.
+// Four points at a time are transposed to x, y and z vectors with NEON or
+// SSE2, transformed, and interleaved back:
+//
+//   tango_gl::TransformPoints(start_service_T_depth, xyz_ij->xyz[0],
+//                             xyz_ij->xyz_count, world_points_.data());
+//
+// The kernels read the points as they are, so the clouds of the depth
+// callback need no copy first.
+
+// Apply the affine |transform|, e.g. a rigid transform, to |count| points of
+// |xyz| and write them to |transformed_xyz|, which can be |xyz| itself but
+// must not overlap it otherwise.
+void TransformPoints(const glm::mat4& transform, const float* xyz, int count,
+                     float* transformed_xyz);
+
+// Projection of points to pixel coordinates: a transform into a camera frame
+// followed by the pinhole intrinsics of the camera, fused into a single 3x4
+// matrix:
+//   (u, v, w) = (u_row, v_row, w_row) . (x, y, z, 1)
+//   pixel = (u / w, v / w), depth = w
+struct PointProjection {
+  PointProjection(const glm::mat4& camera_T_points, float fx, float fy,
+                  float cx, float cy);
+
+  float u_row[4];
+  float v_row[4];
+  float w_row[4];
+};
+
+// Project |count| points of |xyz| to the pixels and depths of |projection|.
+// The pixels of a point with a depth of 0 or less, behind the camera, are
+// undefined, so callers check its depth first.
+void ProjectPoints(const PointProjection& projection, const float* xyz,
+                   int count, float* pixel_x, float* pixel_y, float* depth);
+
+// As above with the pixels truncated toward 0 to integers, e.g. for a splat,
+// and clamped to +-2^20 so that points close to the camera plane can not
+// overflow.
+void ProjectPoints(const PointProjection& projection, const float* xyz,
+                   int count, int32_t* pixel_x, int32_t* pixel_y,
+                   float* depth);
+}  // namespace tango_gl
+#endif  // TANGO_GL_POINT_TRANSFORM_H_
@@ -0,0 +1,144 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_GL_PROFILED_MUTEX_H_
+#define TANGO_GL_PROFILED_MUTEX_H_
+
+#include <stdint.h>
+
+#include <mutex>
+#include <vector>
+
+// Whether ProfiledMutex measures its locks, for the whole build, e.g. with
+// APP_CFLAGS += -DTANGO_GL_LOCK_PROFILING=1:
+//   0: the default, a ProfiledMutex is a std::mutex.
+//   1: every lock reads the clock twice, and once more on unlock, to count
+//      the time spent waiting for and holding the mutex.
+#ifndef TANGO_GL_LOCK_PROFILING
+#define TANGO_GL_LOCK_PROFILING 0
+#endif
+
+namespace tango_gl {
+namespace tracing {
+
+// The locks of the ProfiledMutexes of one name, since the start of the
+// process or the last ResetLockStatistics().
+struct LockStatistics {
+  const char* name;
+  uint64_t lock_count;
+  // Locks that found the mutex held by another thread.
+  uint64_t contended_count;
+  double total_wait_ms;
+  double max_wait_ms;
+  double total_hold_ms;
+  double max_hold_ms;
+};
+
+// @return the statistics of every ProfiledMutex locked so far by name, in
+//         the order of the names. Empty unless TANGO_GL_LOCK_PROFILING.
+std::vector<LockStatistics> GetLockStatistics();
+
+// Restart the statistics from 0, e.g. once the app is past its start up.
+void ResetLockStatistics();
+
+// Log the statistics of GetLockStatistics(), the most contended first.
+void LogLockStatistics();
+
+// The statistics of one name, for ProfiledMutex.
+struct LockCounters;
+
+// @return the counters of |name|, which live as long as the process.
+LockCounters* GetLockCounters(const char* name);
+
+// Lock |mutex|, counting the lock into |counters|.
+//
+// @return: the CLOCK_MONOTONIC time the mutex was acquired, in nanoseconds.
+int64_t LockProfiled(std::mutex* mutex, LockCounters* counters);
+
+// Count an acquisition that did not wait into |counters|.
+//
+// @return: the CLOCK_MONOTONIC time, in nanoseconds.
+int64_t CountUncontendedLock(LockCounters* counters);
+
+// Count the time |mutex| was held since |lock_time| into |counters|, and
+// unlock it.
+void UnlockProfiled(std::mutex* mutex, LockCounters* counters,
+                    int64_t lock_time);
+}  // namespace tracing
+
+// ProfiledMutex is a std::mutex which, with TANGO_GL_LOCK_PROFILING, counts
+// for its name how often it is locked and contended, and how long it is
+// waited for and held, see tracing::GetLockStatistics(). Every contended
+// wait is also recorded as a "Lock wait: <name>" slice while tracing.
+//
+//   tango_gl::ProfiledMutex point_cloud_mutex_{"App::point_cloud_mutex_"};
+//   ...
+//   std::lock_guard<tango_gl::ProfiledMutex> lock(point_cloud_mutex_);
+//
+// The mutexes of one name are counted together, e.g. those of every
+// instance of a class.
+class ProfiledMutex {
+ public:
+  // @param name: a string literal, or otherwise outliving the process.
+  explicit ProfiledMutex(const char* name)
+#if TANGO_GL_LOCK_PROFILING
+      : counters_(tracing::GetLockCounters(name)),
+        lock_time_(0)
+#endif
+  {
+    (void)name;
+  }
+  ProfiledMutex(const ProfiledMutex& other) = delete;
+  ProfiledMutex& operator=(const ProfiledMutex&) = delete;
+
+  void lock() {
+#if TANGO_GL_LOCK_PROFILING
+    lock_time_ = tracing::LockProfiled(&mutex_, counters_);
+#else
+    mutex_.lock();
+#endif
+  }
+
+  bool try_lock() {
+    if (!mutex_.try_lock()) {
+      return false;
+    }
+#if TANGO_GL_LOCK_PROFILING
+    // Failed tries are not counted, the caller did not wait.
+    lock_time_ = tracing::CountUncontendedLock(counters_);
+#endif
+    return true;
+  }
+
+  void unlock() {
+#if TANGO_GL_LOCK_PROFILING
+    tracing::UnlockProfiled(&mutex_, counters_, lock_time_);
+#else
+    mutex_.unlock();
+#endif
+  }
+
+ private:
+  std::mutex mutex_;
+#if TANGO_GL_LOCK_PROFILING
+  tracing::LockCounters* counters_;
+  // Written by the owner of mutex_ only.
+  int64_t lock_time_;
+#endif
+};
+}  // namespace tango_gl
+
+#endif  // TANGO_GL_PROFILED_MUTEX_H_
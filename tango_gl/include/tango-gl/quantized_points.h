@@ -0,0 +1,104 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_GL_QUANTIZED_POINTS_H_
+#define TANGO_GL_QUANTIZED_POINTS_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "tango-gl/point_cloud_statistics.h"
+#include "tango-gl/util.h"
+
+// GLSL declaration of the uniforms "point_scale" and "point_offset", and of
+// "highp vec4 DequantizePoint(highp vec4 vertex)", for vertex shaders. A
+// literal, to be concatenated with the rest of the source at compile time.
+#define TANGO_GL_GLSL_DEQUANTIZE_POINT                             \
+  "uniform highp vec3 point_scale;\n"                              \
+  "uniform highp vec3 point_offset;\n"                             \
+  "highp vec4 DequantizePoint(highp vec4 vertex) {\n"              \
+  "  return vec4(point_offset + point_scale * vertex.xyz, 1.0);\n" \
+  "}\n"
+
+namespace tango_gl {
+// QuantizedPoints packs a point cloud of xyz floats into 16 bit integers for
+// upload, 8 bytes per point instead of 12:
+//
+//   points_.Quantize(point_cloud->xyz[0], point_cloud->xyz_count);
+//   vertex_buffer_.Update(points_.GetData(), points_.GetSize());
+//   points_.SetUniforms(point_scale_handle_, point_offset_handle_);
+//   tango_gl::QuantizedPoints::SetVertexAttribPointer(vertices_handle_, 1);
+//
+// The coordinates are normalized over the bounding box of the cloud, so
+// their precision is 1/65534th of its size, e.g. 0.15 mm over 10 m. The
+// vertex shader declares TANGO_GL_GLSL_DEQUANTIZE_POINT and gets the point
+// back with DequantizePoint(vertex), which must be highp to keep that
+// precision.
+//
+// The statistics of the points, depth histogram included, are computed on the
+// way. Every point also holds a zero short, so that the points stay 4 byte
+// aligned, which the GPUs read fastest.
+class QuantizedPoints {
+ public:
+  // Shorts per point: x, y, z and the zero padding.
+  static const int kComponents = 4;
+  // Bytes per point.
+  static const GLsizei kPointSize = kComponents * sizeof(int16_t);
+
+  QuantizedPoints();
+  QuantizedPoints(const QuantizedPoints& other) = delete;
+  QuantizedPoints& operator=(const QuantizedPoints&) = delete;
+
+  // Quantize |count| points of packed xyz floats over their bounding box.
+  void Quantize(const float* xyz, int count);
+
+  // Reorder the points of the last Quantize() in the shuffled order of
+  // PointLevelOfDetail, so that drawing any prefix of them draws an even
+  // subsample of the cloud.
+  void Shuffle();
+
+  // @return the statistics of the points of the last Quantize().
+  const PointCloudStatistics& GetStatistics() const { return statistics_; }
+
+  const int16_t* GetData() const { return data_.data(); }
+  int GetCount() const { return count_; }
+  // @return the size of the quantized points in bytes.
+  GLsizeiptr GetSize() const { return count_ * kPointSize; }
+
+  // A point is offset + scale * normalized, where normalized is its
+  // quantized coordinates in [-1, 1] as the GL reads them.
+  const glm::vec3& GetScale() const { return scale_; }
+  const glm::vec3& GetOffset() const { return offset_; }
+
+  // Set the uniforms of TANGO_GL_GLSL_DEQUANTIZE_POINT for these points, on
+  // the current program.
+  void SetUniforms(GLint scale_location, GLint offset_location) const;
+
+  // Point the attribute at |location| to the quantized points of the buffer
+  // bound to GL_ARRAY_BUFFER, reading every |point_stride|-th point.
+  static void SetVertexAttribPointer(GLuint location, int point_stride);
+
+ private:
+  std::vector<int16_t> data_;
+  // Reused by Shuffle().
+  std::vector<int16_t> shuffled_data_;
+  int count_;
+  glm::vec3 scale_;
+  glm::vec3 offset_;
+  PointCloudStatistics statistics_;
+};
+}  // namespace tango_gl
+#endif  // TANGO_GL_QUANTIZED_POINTS_H_
@@ -0,0 +1,110 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_GL_RAY_TABLE_H_
+#define TANGO_GL_RAY_TABLE_H_
+
+#include <vector>
+
+#include "tango-gl/util.h"
+
+namespace tango_gl {
+// RayTable holds the rays of the pixels of a pinhole camera image, as
+// normalized image plane coordinates (x / z, y / z), so unprojecting a pixel
+// is a lookup and a multiply instead of (u - cx) / fx and (v - cy) / fy:
+//
+//   tango_gl::RayTable rays;
+//   rays.Reset(intrinsics.width, intrinsics.height, intrinsics.fx,
+//              intrinsics.fy, intrinsics.cx, intrinsics.cy);
+//   ...
+//   const glm::vec3 point = rays.Unproject(x, y, depth);
+//
+// The ray of pixel (x, y) is (ray_x[x], ray_y[y]), so the table keeps one
+// row and one column. SetUndistortion() adds a grid of corrections sampled at
+// the corners of square tiles and interpolated bilinearly in between, for
+// the cameras whose distortion is corrected.
+//
+// The pixel (x, y) covers [x, x + 1) x [y, y + 1) of the image, its ray goes
+// through its center.
+class RayTable {
+ public:
+  RayTable();
+
+  // Build the table of a |width| x |height| image from its intrinsics, in
+  // pixels of that image. Drops the undistortion.
+  void Reset(int width, int height, double fx, double fy, double cx,
+             double cy);
+
+  // Undistort the rays with the polynomial model of the Tango service,
+  // TANGO_CALIBRATION_POLYNOMIAL_3_PARAMETERS: a point at radius r on the
+  // normalized image plane is seen at r * (1 + k1 r^2 + k2 r^4 + k3 r^6).
+  //
+  // @param distortion: k1, k2 and k3, or nullptr to remove the undistortion.
+  // @param tile_size: pixels between the samples of the correction.
+  void SetUndistortion(const double* distortion, int tile_size);
+
+  bool IsEmpty() const { return ray_x_.empty(); }
+  int GetWidth() const { return static_cast<int>(ray_x_.size()); }
+  int GetHeight() const { return static_cast<int>(ray_y_.size()); }
+
+  // @return the ray through the center of pixel (x, y), which must be in the
+  //         image.
+  glm::vec2 GetPixelRay(int x, int y) const {
+    const glm::vec2 ray(ray_x_[x], ray_y_[y]);
+    if (corrections_.empty()) {
+      return ray;
+    }
+    return ray + GetCorrection(x + 0.5f, y + 0.5f);
+  }
+
+  // @return the ray through |position|, in pixels from the top left corner of
+  //         the image, e.g. a touch scaled to the image size.
+  glm::vec2 GetRay(const glm::vec2& position) const;
+
+  // @return the point of pixel (x, y) at |depth| along the camera z axis.
+  glm::vec3 Unproject(int x, int y, float depth) const {
+    const glm::vec2 ray = GetPixelRay(x, y);
+    return glm::vec3(ray.x * depth, ray.y * depth, depth);
+  }
+
+  // Unproject a whole row major depth image of the table size, in meters.
+  // Pixels of depth 0 give the point (0, 0, 0), so point i stays the point of
+  // pixel i.
+  //
+  // @param points: resized to the pixel count and filled.
+  void UnprojectDepthImage(const float* depth,
+                           std::vector<glm::vec3>* points) const;
+
+ private:
+  // @return the correction at (x, y), in pixels, interpolated in the grid.
+  glm::vec2 GetCorrection(float x, float y) const;
+
+  // The undistorted rays are ray + correction.
+  std::vector<float> ray_x_;
+  std::vector<float> ray_y_;
+  float cx_;
+  float cy_;
+  float inverse_fx_;
+  float inverse_fy_;
+
+  // Row major, at the corners of the tiles, empty without undistortion.
+  std::vector<glm::vec2> corrections_;
+  int tile_size_;
+  int grid_width_;
+  int grid_height_;
+};
+}  // namespace tango_gl
+#endif  // TANGO_GL_RAY_TABLE_H_
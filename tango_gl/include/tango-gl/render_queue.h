@@ -0,0 +1,122 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_GL_RENDER_QUEUE_H_
+#define TANGO_GL_RENDER_QUEUE_H_
+
+#include <vector>
+
+#include "tango-gl/drawable_object.h"
+#include "tango-gl/mesh.h"
+#include "tango-gl/streaming_vertex_buffer.h"
+#include "tango-gl/util.h"
+
+namespace tango_gl {
+
+// RenderQueue draws many objects with few state changes.
+//
+// Meshes that use the default shaders of Mesh::SetShader(), draw a list of
+// points, lines or triangles set with SetVertices(), and share the same
+// geometry, e.g. every Cube or every GoalMarker, are drawn together at their
+// own transformation and color:
+//  - with one instanced draw call when GLES3 or GL_EXT_instanced_arrays is
+//    available,
+//  - otherwise with their vertices transformed on the CPU and packed into a
+//    single vertex buffer, drawn with as few calls as 16 bit indices allow.
+// Every other object is drawn with its own Render(), grouped by program.
+//
+// Objects are drawn in no particular order, so blended objects that depend on
+// the drawing order should be rendered on their own.
+//
+// The queue keeps pointers to the objects, which must outlive it or be
+// removed with Clear(). All methods must be called on the GL thread.
+class RenderQueue {
+ public:
+  RenderQueue();
+  RenderQueue(const RenderQueue& other) = delete;
+  RenderQueue& operator=(const RenderQueue&) = delete;
+
+  // Add an object to draw on every Render().
+  void Add(const DrawableObject* object);
+  void Add(const Mesh* mesh);
+
+  // Remove every object.
+  void Clear();
+
+  // Draw every object with its current transformation and color.
+  void Render(const glm::mat4& projection_mat, const glm::mat4& view_mat);
+
+  // Delete the buffer objects used for batching.
+  void DeleteGlResources();
+
+  // Forget the buffer objects without deleting them, for when the GL context
+  // they belonged to has been destroyed.
+  void InvalidateGlResources();
+
+ private:
+  // Meshes sharing program, primitive mode, lighting and geometry.
+  struct Batch {
+    const Mesh* geometry;
+    std::vector<const Mesh*> meshes;
+    // First float of the instances, or of the packed vertices, of this batch
+    // in batch_data_.
+    size_t data_offset;
+  };
+
+  // Look up the programs and the instancing entry points of the current
+  // context, once until InvalidateGlResources().
+  void InitializeGl();
+
+  // Whether a mesh can be drawn in a batch.
+  bool IsBatchable(const Mesh* mesh) const;
+
+  // Sort the meshes into batches_ and every other object into
+  // unbatched_objects_.
+  void BuildBatches();
+
+  // Append the instances, or the packed vertices, of a batch to batch_data_.
+  void AppendInstances(Batch* batch);
+  void AppendPackedVertices(Batch* batch);
+
+  void RenderInstanced(const Batch& batch,
+                       const util::SharedProgram& program);
+  void RenderPacked(const Batch& batch, const util::SharedProgram& program);
+
+  std::vector<const DrawableObject*> objects_;
+  std::vector<const Mesh*> meshes_;
+
+  // Rebuilt on every Render().
+  std::vector<Batch> batches_;
+  std::vector<const DrawableObject*> unbatched_objects_;
+
+  bool gl_initialized_;
+  const util::SharedProgram* basic_program_;
+  const util::SharedProgram* shaded_program_;
+  const util::SharedProgram* batch_program_;
+  const util::SharedProgram* shaded_batch_program_;
+  // Entry points of instanced drawing, NULL when it is not supported.
+  util::GlCapabilities::DrawArraysInstancedFunction draw_arrays_instanced_;
+  util::GlCapabilities::DrawElementsInstancedFunction draw_elements_instanced_;
+  util::GlCapabilities::VertexAttribDivisorFunction vertex_attrib_divisor_;
+
+  // Model matrix and color of every instance, or packed vertices, of every
+  // batch, uploaded once per frame.
+  std::vector<GLfloat> batch_data_;
+  std::vector<GLushort> packed_indices_;
+  StreamingVertexBuffer batch_buffer_;
+};
+}  // namespace tango_gl
+#endif  // TANGO_GL_RENDER_QUEUE_H_
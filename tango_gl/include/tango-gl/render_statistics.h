@@ -0,0 +1,141 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_GL_RENDER_STATISTICS_H_
+#define TANGO_GL_RENDER_STATISTICS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+#include "tango-gl/util.h"
+
+namespace tango_gl {
+// What the drawables of tango_gl count as they render, process-wide. Each has
+// a name in the reports, see GetRenderCounterName().
+enum RenderCounter {
+  // glDraw*() calls, and the vertices or indices they draw.
+  kRenderCounterDrawCalls = 0,
+  kRenderCounterVertices,
+  // Programs and textures bound, other than unbinding them.
+  kRenderCounterProgramBinds,
+  kRenderCounterTextureBinds,
+  // Other state GlState set, and the calls it skipped as they would not have
+  // changed anything.
+  kRenderCounterStateChanges,
+  kRenderCounterSkippedStateChanges,
+  // Buffer and texture uploads with data from memory, and their size. An
+  // upload every frame of something static shows as a rise in both.
+  kRenderCounterUploads,
+  kRenderCounterUploadedBytes,
+  kRenderCounterCount
+};
+
+namespace internal {
+extern std::atomic<int64_t> g_render_counters[kRenderCounterCount];
+}  // namespace internal
+
+// Count |amount| on |counter|, a relaxed atomic addition.
+inline void CountRender(RenderCounter counter, int64_t amount = 1) {
+  internal::g_render_counters[counter].fetch_add(amount,
+                                                 std::memory_order_relaxed);
+}
+
+// Count a draw call of |count| vertices or indices, next to the glDraw*().
+inline void CountDraw(GLsizei count) {
+  CountRender(kRenderCounterDrawCalls);
+  CountRender(kRenderCounterVertices, count);
+}
+
+// Count an upload of |bytes| from memory, next to the glBufferData(),
+// glBufferSubData(), glTexImage2D() or glTexSubImage2D().
+inline void CountUpload(size_t bytes) {
+  CountRender(kRenderCounterUploads);
+  CountRender(kRenderCounterUploadedBytes, static_cast<int64_t>(bytes));
+}
+
+// The counters at one point in time, or between two with operator-().
+struct RenderStatistics {
+  int64_t counters[kRenderCounterCount];
+
+  RenderStatistics operator-(const RenderStatistics& other) const;
+};
+
+// @return the counters since the start of the process.
+RenderStatistics GetRenderStatistics();
+
+// @return the name of |counter| in the reports, e.g. "draw_calls".
+const char* GetRenderCounterName(RenderCounter counter);
+
+// RenderBenchmark measures the frames of a drawable, a scene, or anything
+// else rendered between BeginFrame() and EndFrame(): the time they take and
+// what they count per frame. E.g. for the grid of a scene, in a pbuffer
+// context, connected to the mock service:
+//
+//   tango_gl::RenderBenchmark benchmark("grid", true);
+//   for (int i = 0; i < kFrameCount; ++i) {
+//     benchmark.BeginFrame();
+//     grid_->Render(projection, view);
+//     benchmark.EndFrame();
+//   }
+//   LOGI("%s", benchmark.FormatReport().c_str());
+//
+// The time is that of the CPU to issue the frame, and with
+// |is_gpu_synchronized| also of the GPU to finish it, as EndFrame() waits in
+// glFinish(). The counters are process-wide, so only one benchmark should run
+// at a time. Must be called on the GL thread.
+class RenderBenchmark {
+ public:
+  // @param name: name of the benchmark in the report, which must outlive it.
+  RenderBenchmark(const char* name, bool is_gpu_synchronized);
+  RenderBenchmark(const RenderBenchmark& other) = delete;
+  RenderBenchmark& operator=(const RenderBenchmark&) = delete;
+
+  void BeginFrame();
+  void EndFrame();
+
+  // Forget the frames measured so far.
+  void Reset();
+
+  int GetFrameCount() const { return frame_count_; }
+
+  // @return the average and the longest time of a frame in milliseconds.
+  double GetAverageFrameTime() const;
+  double GetMaxFrameTime() const { return max_frame_time_; }
+
+  // @return the counters of every frame measured.
+  const RenderStatistics& GetTotals() const { return totals_; }
+
+  // @return the results as a JSON object, e.g. {"name":"grid","frames":100,
+  //         "average_ms":0.21,"max_ms":0.93,"draw_calls":1.00,...}, with the
+  //         counters per frame.
+  std::string FormatReport() const;
+
+ private:
+  const char* name_;
+  bool is_gpu_synchronized_;
+  std::chrono::steady_clock::time_point frame_start_;
+  RenderStatistics frame_start_statistics_;
+  RenderStatistics totals_;
+  int frame_count_;
+  double total_frame_time_;
+  double max_frame_time_;
+};
+}  // namespace tango_gl
+#endif  // TANGO_GL_RENDER_STATISTICS_H_
@@ -0,0 +1,109 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_GL_RIGID_TRANSFORM_H_
+#define TANGO_GL_RIGID_TRANSFORM_H_
+
+#define GLM_FORCE_RADIANS
+
+#include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+#include "glm/gtc/quaternion.hpp"
+
+#include "tango-gl/conversions.h"
+
+namespace tango_gl {
+// RigidTransform is a rotation followed by a translation, A_T_B mapping
+// coordinates in frame B to frame A, e.g. a Tango pose or an extrinsic.
+//
+// Unlike a glm::mat4, its inverse is in closed form, and planes are
+// transformed without the inverse transpose of a 4x4. The rotation is a unit
+// quaternion, renormalized when transforms are composed, so long chains of
+// compositions stay rigid instead of drifting away from a rotation.
+class RigidTransform {
+ public:
+  // The identity.
+  RigidTransform() : rotation_(1.0f, 0.0f, 0.0f, 0.0f), translation_(0.0f) {}
+
+  RigidTransform(const glm::quat& rotation, const glm::vec3& translation)
+      : rotation_(glm::normalize(rotation)), translation_(translation) {}
+
+  // A transform from the translation and orientation fields of a
+  // TangoPoseData.
+  static RigidTransform FromArrays(const double* A_p_B, const double* A_q_B) {
+    return RigidTransform(conversions::QuatFromArray(A_q_B),
+                          conversions::Vec3FromArray(A_p_B));
+  }
+
+  // The transform of a matrix without scale, shear or projection. Its
+  // rotation is reorthonormalized.
+  static RigidTransform FromMatrix(const glm::mat4& A_T_B) {
+    return RigidTransform(glm::quat_cast(glm::mat3(A_T_B)),
+                          glm::vec3(A_T_B[3]));
+  }
+
+  const glm::quat& GetRotation() const { return rotation_; }
+  const glm::vec3& GetTranslation() const { return translation_; }
+
+  glm::mat4 ToMatrix() const {
+    glm::mat4 matrix = glm::mat4_cast(rotation_);
+    matrix[3] = glm::vec4(translation_, 1.0f);
+    return matrix;
+  }
+
+  // @return B_T_A for this A_T_B.
+  RigidTransform Inverse() const {
+    const glm::quat inverse_rotation = glm::conjugate(rotation_);
+    return RigidTransform(inverse_rotation, -(inverse_rotation * translation_),
+                          kNormalized);
+  }
+
+  // @return A_T_C for this A_T_B and |B_T_C|.
+  RigidTransform operator*(const RigidTransform& B_T_C) const {
+    return RigidTransform(rotation_ * B_T_C.rotation_,
+                          rotation_ * B_T_C.translation_ + translation_);
+  }
+
+  glm::vec3 TransformPoint(const glm::vec3& point) const {
+    return rotation_ * point + translation_;
+  }
+
+  glm::vec3 TransformVector(const glm::vec3& vector) const {
+    return rotation_ * vector;
+  }
+
+  // @param plane: equation (n, d) of the plane n.x + d = 0 in frame B.
+  //
+  // @return the equation of the plane in frame A, with a normal as long.
+  glm::vec4 TransformPlane(const glm::vec4& plane) const {
+    const glm::vec3 normal = rotation_ * glm::vec3(plane);
+    return glm::vec4(normal, plane.w - glm::dot(normal, translation_));
+  }
+
+ private:
+  // Tag of the constructor skipping the normalization of a rotation known to
+  // be a unit quaternion.
+  enum NormalizedTag { kNormalized };
+
+  RigidTransform(const glm::quat& rotation, const glm::vec3& translation,
+                 NormalizedTag)
+      : rotation_(rotation), translation_(translation) {}
+
+  glm::quat rotation_;
+  glm::vec3 translation_;
+};
+}  // namespace tango_gl
+#endif  // TANGO_GL_RIGID_TRANSFORM_H_
@@ -0,0 +1,68 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_GL_SEGMENT_PICKER_H_
+#define TANGO_GL_SEGMENT_PICKER_H_
+
+#include <vector>
+
+#include "tango-gl/bounding_box.h"
+#include "tango-gl/segment.h"
+
+namespace tango_gl {
+// SegmentPicker tests a segment, e.g. a touch ray, against many world space
+// boxes in one call, like util::SegmentAABBIntersect does for one box.
+//
+// The boxes are stored by groups of four, one array per coordinate, and each
+// group is tested at once with NEON or SSE2 where available. To pick among
+// objects that move, Set() their boxes again before testing, e.g. with
+// Mesh::GetBoundingBox()->GetTransformed(mesh->GetTransformationMatrix()).
+class SegmentPicker {
+ public:
+  SegmentPicker();
+
+  // Remove every box.
+  void Clear();
+
+  // @return the index of the box, which is the number of boxes before it.
+  size_t Add(const BoundingBox& world_box);
+
+  // Replace the box at |index|.
+  void Set(size_t index, const BoundingBox& world_box);
+
+  size_t GetBoxCount() const { return box_count_; }
+
+  // Append the index of every box the segment goes through to |hits|, in
+  // increasing order.
+  void Intersect(const Segment& segment, std::vector<size_t>* hits) const;
+
+  // @return the index of the box the segment enters first from its start, or
+  //         -1 if it goes through none.
+  int IntersectNearest(const Segment& segment) const;
+
+ private:
+  // Test the segment against every group and call |on_hit| with the index
+  // and the entry distance, in units of the segment length, of every hit.
+  template <typename HitFunction>
+  void ForEachHit(const Segment& segment, HitFunction on_hit) const;
+
+  // min x, y, z then max x, y, z of four boxes per group, padded with empty
+  // boxes that are never reported.
+  std::vector<float> groups_;
+  size_t box_count_;
+};
+}  // namespace tango_gl
+#endif  // TANGO_GL_SEGMENT_PICKER_H_
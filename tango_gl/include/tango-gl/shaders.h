@@ -17,17 +17,176 @@
 #ifndef TANGO_GL_SHADERS_H_
 #define TANGO_GL_SHADERS_H_
 
-#include <string>
+#include <stddef.h>
+
+// Preambles of the GLSL sources, concatenated with them by the compiler:
+//
+//   const char kVertexShader[] =
+//       TANGO_GL_GLSL_MEDIUMP
+//       "attribute vec4 vertex;\n"
+//       ...
+//
+// so that the sources stay in static storage, with no global constructor
+// run when the library is loaded and no copy made to compile them.
+#define TANGO_GL_GLSL_MEDIUMP   \
+  "precision mediump float;\n" \
+  "precision mediump int;\n"
+#define TANGO_GL_GLSL_HIGHP   \
+  "precision highp float;\n" \
+  "precision highp int;\n"
+#define TANGO_GL_GLSL_EXTERNAL_OES \
+  "#extension GL_OES_EGL_image_external : require\n"
 
 namespace tango_gl {
 namespace shaders {
-std::string GetBasicVertexShader();
-std::string GetBasicFragmentShader();
-std::string GetColorVertexShader();
-std::string GetVideoOverlayVertexShader();
-std::string GetVideoOverlayFragmentShader();
-std::string GetVideoOverlayTexture2DFragmentShader();
-std::string GetShadedVertexShader();
+
+// ShaderSource refers to a GLSL source in static storage, e.g. a string
+// literal, without owning or copying it.
+class ShaderSource {
+ public:
+  template <size_t N>
+  constexpr ShaderSource(const char (&source)[N])  // NOLINT
+      : source_(source), size_(N - 1) {}
+
+  constexpr const char* c_str() const { return source_; }
+  constexpr size_t size() const { return size_; }
+
+ private:
+  const char* source_;
+  size_t size_;
+};
+
+constexpr ShaderSource GetBasicVertexShader() {
+  return TANGO_GL_GLSL_MEDIUMP
+      "attribute vec4 vertex;\n"
+      "uniform mat4 mvp;\n"
+      "uniform vec4 color;\n"
+      "varying vec4 v_color;\n"
+      "void main() {\n"
+      "  gl_Position = mvp*vertex;\n"
+      "  v_color = color;\n"
+      "}\n";
+}
+
+constexpr ShaderSource GetBasicFragmentShader() {
+  return "precision mediump float;\n"
+      "varying vec4 v_color;\n"
+      "void main() {\n"
+      "  gl_FragColor = v_color;\n"
+      "}\n";
+}
+
+constexpr ShaderSource GetColorVertexShader() {
+  return TANGO_GL_GLSL_MEDIUMP
+      "attribute vec4 vertex;\n"
+      "attribute vec4 color;\n"
+      "uniform mat4 mvp;\n"
+      "varying vec4 v_color;\n"
+      "void main() {\n"
+      "  gl_Position = mvp*vertex;\n"
+      "  v_color = color;\n"
+      "}\n";
+}
+
+constexpr ShaderSource GetVideoOverlayVertexShader() {
+  return TANGO_GL_GLSL_HIGHP
+      "attribute vec4 vertex;\n"
+      "attribute vec2 textureCoords;\n"
+      "varying vec2 f_textureCoords;\n"
+      "uniform mat4 mvp;\n"
+      "void main() {\n"
+      "  f_textureCoords = textureCoords;\n"
+      "  gl_Position = mvp * vertex;\n"
+      "}\n";
+}
+
+constexpr ShaderSource GetVideoOverlayFragmentShader() {
+  return TANGO_GL_GLSL_EXTERNAL_OES TANGO_GL_GLSL_HIGHP
+      "uniform samplerExternalOES texture;\n"
+      "varying vec2 f_textureCoords;\n"
+      "void main() {\n"
+      "  gl_FragColor = texture2D(texture, f_textureCoords);\n"
+      "}\n";
+}
+
+constexpr ShaderSource GetVideoOverlayTexture2DFragmentShader() {
+  return TANGO_GL_GLSL_HIGHP
+      "uniform sampler2D texture;\n"
+      "varying vec2 f_textureCoords;\n"
+      "void main() {\n"
+      "  gl_FragColor = texture2D(texture, f_textureCoords);\n"
+      "}\n";
+}
+
+constexpr ShaderSource GetShadedVertexShader() {
+  return "attribute vec4 vertex;\n"
+      "attribute vec3 normal;\n"
+      "uniform mat4 mvp;\n"
+      "uniform mat4 mv;\n"
+      "uniform vec4 color;\n"
+      "uniform vec3 lightVec;\n"
+      "varying vec4 v_color;\n"
+      "void main() {\n"
+      "  vec3 mvNormal = vec3(mv * vec4(normal, 0.0));\n"
+      "  float diffuse = max(-dot(mvNormal, lightVec), 0.0);\n"
+      "  v_color.a = color.a;\n"
+      "  v_color.xyz = color.xyz * diffuse + color.xyz * 0.3;\n"
+      "  gl_Position = mvp*vertex;\n"
+      "}\n";
+}
+
+// The vertex shader of a Mesh, lit by a directional light or not. Selected
+// at compile time when |is_lit| is a constant.
+constexpr ShaderSource GetMeshVertexShader(bool is_lit) {
+  return is_lit ? GetShadedVertexShader() : GetBasicVertexShader();
+}
+
+// Basic and shaded vertex shaders that take the model matrix and the color
+// as attributes, for rendering many objects in one draw call.
+constexpr ShaderSource GetInstancedVertexShader() {
+  return TANGO_GL_GLSL_MEDIUMP
+      "attribute vec4 vertex;\n"
+      "attribute vec4 model0;\n"
+      "attribute vec4 model1;\n"
+      "attribute vec4 model2;\n"
+      "attribute vec4 model3;\n"
+      "attribute vec4 color;\n"
+      "uniform mat4 vp;\n"
+      "varying vec4 v_color;\n"
+      "void main() {\n"
+      "  mat4 model = mat4(model0, model1, model2, model3);\n"
+      "  gl_Position = vp*model*vertex;\n"
+      "  v_color = color;\n"
+      "}\n";
+}
+
+constexpr ShaderSource GetInstancedShadedVertexShader() {
+  return "attribute vec4 vertex;\n"
+      "attribute vec3 normal;\n"
+      "attribute vec4 model0;\n"
+      "attribute vec4 model1;\n"
+      "attribute vec4 model2;\n"
+      "attribute vec4 model3;\n"
+      "attribute vec4 color;\n"
+      "uniform mat4 vp;\n"
+      "uniform mat4 view;\n"
+      "uniform vec3 lightVec;\n"
+      "varying vec4 v_color;\n"
+      "void main() {\n"
+      "  mat4 model = mat4(model0, model1, model2, model3);\n"
+      "  vec3 mvNormal = vec3(view * model * vec4(normal, 0.0));\n"
+      "  float diffuse = max(-dot(mvNormal, lightVec), 0.0);\n"
+      "  v_color.a = color.a;\n"
+      "  v_color.xyz = color.xyz * diffuse + color.xyz * 0.3;\n"
+      "  gl_Position = vp*model*vertex;\n"
+      "}\n";
+}
+
+// Selected at compile time when |is_shaded| is a constant.
+constexpr ShaderSource GetInstancedVertexShader(bool is_shaded) {
+  return is_shaded ? GetInstancedShadedVertexShader()
+                   : GetInstancedVertexShader();
+}
 }  // namespace shaders
 }  // namespace tango_gl
 #endif  // TANGO_GL_SHADERS_H_
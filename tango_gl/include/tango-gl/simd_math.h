@@ -0,0 +1,63 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_GL_SIMD_MATH_H_
+#define TANGO_GL_SIMD_MATH_H_
+
+#define GLM_FORCE_RADIANS
+#include "glm/glm.hpp"
+#include "glm/gtc/quaternion.hpp"
+
+namespace tango_gl {
+// The matrix and quaternion operations of the render and pose paths, done
+// on the columns of the glm types as vectors of four floats with NEON or
+// SSE2, where glm computes them a float at a time. They take and return glm
+// types, so code can move to them one call at a time:
+//
+//   world_matrix_ = tango_gl::simd_math::Multiply(
+//       parent_->GetTransformationMatrix(), local_matrix_);
+//
+// The results match glm's to float rounding.
+namespace simd_math {
+
+// @return: |a| * |b|.
+glm::mat4 Multiply(const glm::mat4& a, const glm::mat4& b);
+
+// Write |transform| * |vectors[i]| of |count| vectors to |transformed|,
+// which can be |vectors| itself but must not overlap it otherwise. For
+// packed xyz points see TransformPoints().
+void TransformVectors(const glm::mat4& transform, const glm::vec4* vectors,
+                      int count, glm::vec4* transformed);
+
+// @return: the inverse of |transform|, a rotation and a translation only,
+//          e.g. a pose, as the transposed rotation and the translation
+//          rotated back, where glm::inverse() inverts a general matrix.
+glm::mat4 InverseRigid(const glm::mat4& transform);
+
+// @return: the rotation of the unit quaternion |rotation| followed by the
+//          |translation|, which is glm::translate(glm::mat4(1.0f),
+//          translation) * glm::mat4_cast(rotation) without the product.
+glm::mat4 RigidFromQuat(const glm::quat& rotation,
+                        const glm::vec3& translation);
+
+// @return: the spherical interpolation between the unit quaternions |a| and
+//          |b| by |t| in [0, 1], the shorter way around, as glm::slerp()
+//          after flipping |b| to the side of |a|. Close quaternions are
+//          interpolated linearly and normalized.
+glm::quat Slerp(const glm::quat& a, const glm::quat& b, float t);
+}  // namespace simd_math
+}  // namespace tango_gl
+#endif  // TANGO_GL_SIMD_MATH_H_
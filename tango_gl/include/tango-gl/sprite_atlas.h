@@ -0,0 +1,142 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef TANGO_GL_SPRITE_ATLAS_H_
+#define TANGO_GL_SPRITE_ATLAS_H_
+
+#include <memory>
+#include <vector>
+
+#include "tango-gl/texture.h"
+#include "tango-gl/util.h"
+
+namespace tango_gl {
+// SpriteAtlas packs small images, e.g. marker and UI icons, into a few
+// shared textures, so that a SpriteBatch draws all the icons of a page with
+// a single texture bind and draw call:
+//
+//   // At load time, on any thread.
+//   const int pin = atlas_.AddFile("/sdcard/pin.png");
+//   const int flag = atlas_.AddFile("/sdcard/flag.png");
+//   atlas_.Pack();
+//   ...
+//   // Once, on the GL thread.
+//   atlas_.Upload();
+//   ...
+//   batch_.AddSprite(atlas_.GetSprite(pin), position, color);
+//
+// The images are packed on shelves, tallest first, into pages of
+// Options::page_size pixels wide, each as high as the power of two holding
+// its shelves so that it is never padded by Texture::Upload(). The edge
+// pixels of every image are repeated around it, for bilinear filtering not
+// to bleed the neighbors in. The pages are RGBA, whatever the images.
+//
+// The packing does not use GL: it can be run offline, the pages written with
+// GetPageImage() and their sprites with GetSprite().
+class SpriteAtlas {
+ public:
+  struct Options {
+    Options();
+
+    // Width of a page, and the largest height, in pixels. A power of two.
+    int page_size;
+    // Pixels repeated around every image.
+    int border;
+  };
+
+  // Where an image is in the atlas.
+  struct Sprite {
+    int page;
+    // Texture coordinates of the top left and bottom right corners of the
+    // image, the first row being the top one.
+    glm::vec2 uv_min;
+    glm::vec2 uv_max;
+    // Size of the image in pixels.
+    glm::ivec2 size;
+  };
+
+  explicit SpriteAtlas(const Options& options = Options());
+  SpriteAtlas(const SpriteAtlas& other) = delete;
+  SpriteAtlas& operator=(const SpriteAtlas&) = delete;
+
+  // Queue a copy of 8 bit RGB or RGBA |image| for the next Pack().
+  //
+  // @return the index of its sprite, or -1 if the image is compressed or
+  //         larger than a page.
+  int AddImage(const TextureImage& image);
+
+  // Decode the PNG file at |file_path| and queue it, see AddImage().
+  int AddFile(const char* file_path);
+
+  // Pack the images added since the last Pack() into new pages, the earlier
+  // pages staying as they are. Frees the added images.
+  void Pack();
+
+  // @return the sprite of |index|, valid once it was packed.
+  const Sprite& GetSprite(int index) const { return sprites_[index]; }
+  int GetSpriteCount() const { return static_cast<int>(sprites_.size()); }
+
+  int GetPageCount() const { return static_cast<int>(pages_.size()); }
+
+  // @return the pixels of |page|, empty once it was uploaded.
+  const TextureImage& GetPageImage(int page) const {
+    return pages_[page]->image;
+  }
+
+  // Upload the pages packed since the last call, freeing their pixels. Must
+  // be called on the GL thread.
+  //
+  // @return false if a page could not be uploaded.
+  bool Upload();
+
+  // @return the texture of |page|, empty until it was uploaded.
+  const Texture& GetPageTexture(int page) const {
+    return pages_[page]->texture;
+  }
+
+  // Delete the page textures, or forget them for when the GL context they
+  // belonged to has been destroyed. Their pixels are gone, so the images
+  // need to be added and packed again.
+  void DeleteGlResources();
+  void InvalidateGlResources();
+
+ private:
+  struct Page {
+    TextureImage image;
+    Texture texture;
+  };
+
+  // An image waiting for Pack(), as RGBA.
+  struct PendingImage {
+    int sprite;
+    TextureImage image;
+  };
+
+  // Copy |image| into |page| with its top left corner at |x|, |y|, its
+  // edges repeated over the border.
+  void Blit(const TextureImage& image, int x, int y, TextureImage* page) const;
+
+  int page_size_;
+  int border_;
+  std::vector<Sprite> sprites_;
+  std::vector<PendingImage> pending_images_;
+  std::vector<std::unique_ptr<Page>> pages_;
+  // Pages before this one were uploaded.
+  int uploaded_page_count_;
+};
+}  // namespace tango_gl
+#endif  // TANGO_GL_SPRITE_ATLAS_H_
@@ -0,0 +1,117 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef TANGO_GL_SPRITE_BATCH_H_
+#define TANGO_GL_SPRITE_BATCH_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "tango-gl/color.h"
+#include "tango-gl/sprite_atlas.h"
+#include "tango-gl/streaming_vertex_buffer.h"
+#include "tango-gl/util.h"
+
+namespace tango_gl {
+// SpriteBatch draws the icons of a SpriteAtlas, e.g. over markers and
+// annotations, with one draw call per atlas page however many there are:
+//
+//   // Every frame, after the scene.
+//   for (const Annotation& annotation : annotations_) {
+//     const SpriteAtlas::Sprite& icon = atlas_.GetSprite(annotation.icon);
+//     batch_.AddSprite(icon, annotation.position, glm::vec2(icon.size),
+//                      Color(1.0f, 1.0f, 1.0f));
+//   }
+//   batch_.Render(atlas_, projection_mat, view_mat);
+//
+// A sprite is a quad facing the screen, of a size in pixels whatever its
+// distance, centered on the projection of its position. It is depth tested
+// as the caller set it up, without writing depth, and blended over the
+// scene.
+//
+// All methods must be called on the GL thread.
+class SpriteBatch {
+ public:
+  SpriteBatch();
+  SpriteBatch(const SpriteBatch& other) = delete;
+  SpriteBatch& operator=(const SpriteBatch&) = delete;
+  ~SpriteBatch();
+
+  // Queue |sprite| centered on the projection of |position|, |size| pixels
+  // wide and high, its pixels multiplied by |color| and |alpha|. It is not
+  // drawn when the position is behind the camera.
+  void AddSprite(const SpriteAtlas::Sprite& sprite, const glm::vec3& position,
+                 const glm::vec2& size, const Color& color,
+                 float alpha = 1.0f);
+
+  // Queue |sprite| centered on |position|, in normalized device coordinates,
+  // e.g. for a UI icon. It is drawn over the scene.
+  void AddScreenSprite(const SpriteAtlas::Sprite& sprite,
+                       const glm::vec2& position, const glm::vec2& size,
+                       const Color& color, float alpha = 1.0f);
+
+  // @return the number of sprites queued.
+  size_t GetSpriteCount() const;
+
+  // Draw the sprites queued since the last call with the pages of |atlas|,
+  // then clear the queue. Does not change the GL state, besides the bound
+  // buffers.
+  void Render(const SpriteAtlas& atlas, const glm::mat4& projection_mat,
+              const glm::mat4& view_mat);
+
+  // Delete the program and buffers.
+  void DeleteGlResources();
+
+  // Forget the GL objects without deleting them, for when the GL context they
+  // belonged to has been destroyed.
+  void InvalidateGlResources();
+
+ private:
+  // A vertex of a sprite quad: where it is anchored, in world space or in
+  // normalized device coordinates when anchor[3] is 0, its offset from the
+  // anchor in pixels, y down, and its atlas coordinates.
+  struct Vertex {
+    float anchor[4];
+    float offset[2];
+    float uv[2];
+    uint8_t color[4];
+  };
+
+  void AddQuad(const SpriteAtlas::Sprite& sprite, const float anchor[4],
+               const glm::vec2& size, const Color& color, float alpha);
+
+  bool InitializeGl();
+
+  // The quads queued for each page, and all of them in page order for the
+  // upload.
+  std::vector<std::vector<Vertex>> page_vertices_;
+  std::vector<Vertex> vertices_;
+
+  bool gl_initialized_;
+  GLuint program_;
+  GLint anchor_location_;
+  GLint offset_location_;
+  GLint uv_location_;
+  GLint color_location_;
+  GLint view_projection_location_;
+  GLint pixel_size_location_;
+  GLint atlas_location_;
+  StreamingVertexBuffer vertex_buffer_;
+};
+}  // namespace tango_gl
+#endif  // TANGO_GL_SPRITE_BATCH_H_
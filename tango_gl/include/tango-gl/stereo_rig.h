@@ -0,0 +1,113 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_GL_STEREO_RIG_H_
+#define TANGO_GL_STEREO_RIG_H_
+
+#include "tango-gl/util.h"
+#include "tango-gl/view_frustum.h"
+
+namespace tango_gl {
+
+// StereoRig places two eyes either side of a camera, for a device mounted in
+// a headset, and renders them side by side in the left and right halves of
+// the surface. The work that does not depend on the eye is done once per
+// frame rather than once per eye:
+//
+//   rig_.Update(camera_->GetViewMatrix());
+//   visible_.clear();
+//   static_objects_.Cull(rig_.GetCullingFrustum(), &visible_);
+//   for (int i = 0; i < StereoRig::kEyeCount; ++i) {
+//     const StereoRig::Eye eye = static_cast<StereoRig::Eye>(i);
+//     rig_.SetEyeViewport(eye);
+//     video_overlay_->Render(glm::mat4(1.0f), glm::mat4(1.0f));
+//     for (const DrawableObject* object : visible_) {
+//       object->Render(rig_.GetProjection(), rig_.GetView(eye));
+//     }
+//   }
+//
+// The objects are culled a single time against a frustum containing both
+// eyes, and the camera image is updated once and drawn from the same texture
+// in both. The eyes look in parallel and share one projection, the pinhole
+// of SetIntrinsics(), with their viewports letterboxed to the aspect of the
+// image: only their views differ.
+class StereoRig {
+ public:
+  enum Eye { kLeftEye = 0, kRightEye, kEyeCount };
+
+  // Distance between the eyes of an average adult, in meters.
+  static const float kDefaultInterpupillaryDistance;
+
+  StereoRig();
+  StereoRig(const StereoRig& other) = delete;
+  StereoRig& operator=(const StereoRig&) = delete;
+
+  // Set the size of the surface both eyes share, in pixels.
+  void SetSurfaceSize(int width, int height);
+
+  // Set the pinhole of each eye, e.g. the color camera's, and the clip
+  // planes. See Camera::ProjectionMatrixForCameraIntrinsics().
+  void SetIntrinsics(float width, float height, float fx, float fy, float cx,
+                     float cy, float near, float far);
+
+  // @param distance: between the eyes, in meters.
+  void SetInterpupillaryDistance(float distance);
+
+  // Place the eyes either side of the camera of |view_mat|, e.g. the pose of
+  // the device, and compute the frustum of both.
+  void Update(const glm::mat4& view_mat);
+
+  // The projection of both eyes.
+  const glm::mat4& GetProjection() const { return projection_; }
+  const glm::mat4& GetView(Eye eye) const { return views_[eye]; }
+
+  // @return the frustum of a camera behind the two eyes seeing all they see,
+  //         for the objects to be culled once for both.
+  const ViewFrustum& GetCullingFrustum() const { return culling_frustum_; }
+
+  // Set the viewport to the one of |eye|. Must be called on the GL thread.
+  void SetEyeViewport(Eye eye) const;
+
+  // @return the height of the viewport of an eye, in pixels.
+  int GetEyeViewportHeight() const { return eye_viewport_height_; }
+
+ private:
+  // Letterbox the viewports of the eyes in their halves of the surface.
+  void UpdateViewports();
+
+  int surface_width_;
+  int surface_height_;
+  float image_width_;
+  float image_height_;
+  float fx_;
+  float fy_;
+  float cx_;
+  float cy_;
+  float near_;
+  float far_;
+  float interpupillary_distance_;
+
+  glm::mat4 projection_;
+  glm::mat4 views_[kEyeCount];
+  ViewFrustum culling_frustum_;
+
+  int eye_viewport_x_[kEyeCount];
+  int eye_viewport_y_;
+  int eye_viewport_width_;
+  int eye_viewport_height_;
+};
+}  // namespace tango_gl
+#endif  // TANGO_GL_STEREO_RIG_H_
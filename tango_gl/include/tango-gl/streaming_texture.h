@@ -0,0 +1,92 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_GL_STREAMING_TEXTURE_H_
+#define TANGO_GL_STREAMING_TEXTURE_H_
+
+#include "tango-gl/memory_accounting.h"
+#include "tango-gl/util.h"
+
+namespace tango_gl {
+
+// StreamingTexture is a GL_TEXTURE_2D whose content is replaced every frame.
+//
+// The texture storage is allocated once with glTexImage2D and every update
+// goes through glTexSubImage2D, so the driver never reallocates storage on the
+// render path. When the current context is OpenGL ES 3.0 or later, updates
+// are staged through a ring of pixel unpack buffers so the upload does not
+// stall on the previous one.
+//
+// All methods must be called on the GL thread.
+class StreamingTexture {
+ public:
+  // @param filter: the minification and magnification filter of the texture.
+  explicit StreamingTexture(GLenum filter = GL_NEAREST);
+  StreamingTexture(const StreamingTexture& other) = delete;
+  StreamingTexture& operator=(const StreamingTexture&) = delete;
+
+  // Make sure the texture has storage for a width x height image in the given
+  // format with GL_UNSIGNED_BYTE components. The texture is only reallocated
+  // when the size or the format changed since the previous call.
+  //
+  // @param format: GL_LUMINANCE, GL_LUMINANCE_ALPHA, GL_RGB or GL_RGBA.
+  //
+  // @return true if the storage was (re)allocated.
+  bool Allocate(GLenum format, GLsizei width, GLsizei height);
+
+  // Replace the whole texture content. Allocate() must have been called
+  // before. The texture is left bound to GL_TEXTURE_2D on the active texture
+  // unit.
+  //
+  // @param data: tightly packed image of the allocated size and format.
+  void Update(const void* data);
+
+  // Delete the texture and pixel buffers.
+  void DeleteGlResources();
+
+  // Forget the GL objects without deleting them, for when the GL context
+  // they belonged to has been destroyed.
+  void InvalidateGlResources();
+
+  // Returns 0 until the first call to Allocate().
+  GLuint GetTextureId() const { return texture_id_; }
+  GLsizei GetWidth() const { return width_; }
+  GLsizei GetHeight() const { return height_; }
+
+ private:
+  // Number of pixel unpack buffers cycled through when they are available.
+  static const int kPixelBufferCount = 2;
+
+  GLenum filter_;
+  GLenum format_;
+  GLsizei width_;
+  GLsizei height_;
+  GLsizeiptr image_size_;
+
+  GLuint texture_id_;
+
+  // Pixel unpack buffer ring, only used on OpenGL ES 3.0 contexts.
+  bool use_pixel_buffers_;
+  GLuint pixel_buffers_[kPixelBufferCount];
+  int pixel_buffer_index_;
+  util::GlCapabilities::MapBufferRangeFunction map_buffer_range_;
+  util::GlCapabilities::UnmapBufferFunction unmap_buffer_;
+
+  // The texture and the pixel buffers.
+  MemoryAccount gpu_memory_;
+};
+}  // namespace tango_gl
+#endif  // TANGO_GL_STREAMING_TEXTURE_H_
@@ -0,0 +1,78 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_GL_STREAMING_VERTEX_BUFFER_H_
+#define TANGO_GL_STREAMING_VERTEX_BUFFER_H_
+
+#include "tango-gl/memory_accounting.h"
+#include "tango-gl/util.h"
+
+namespace tango_gl {
+
+// StreamingVertexBuffer is a GL_ARRAY_BUFFER whose content is replaced every
+// frame, e.g. with the latest point cloud.
+//
+// Uploads rotate through a small ring of buffer objects that are allocated
+// once with GL_STREAM_DRAW at a fixed capacity. Each upload orphans the next
+// buffer of the ring before writing into it, so the driver never has to wait
+// for draws still reading the previous data, and never reallocates storage
+// unless the capacity is exceeded. On GLES3, or with GL_EXT_map_buffer_range,
+// the buffer is mapped with GL_MAP_INVALIDATE_BUFFER_BIT instead, which
+// orphans it just the same, and the data is copied straight into it.
+//
+// All methods must be called on the GL thread.
+class StreamingVertexBuffer {
+ public:
+  StreamingVertexBuffer();
+  StreamingVertexBuffer(const StreamingVertexBuffer& other) = delete;
+  StreamingVertexBuffer& operator=(const StreamingVertexBuffer&) = delete;
+
+  // Make sure every buffer of the ring can hold at least |capacity| bytes.
+  // Does nothing when the buffers are already large enough.
+  void Reserve(GLsizeiptr capacity);
+
+  // Upload |size| bytes into the next buffer of the ring, growing the capacity
+  // if needed. The buffer is left bound to GL_ARRAY_BUFFER.
+  void Update(const void* data, GLsizeiptr size);
+
+  // Bind the buffer written by the last Update() to GL_ARRAY_BUFFER.
+  void Bind() const;
+
+  // Delete the buffer objects.
+  void DeleteGlResources();
+
+  // Forget the buffer objects without deleting them, for when the GL context
+  // they belonged to has been destroyed.
+  void InvalidateGlResources();
+
+  // @return the buffer object written by the last Update(), e.g. to read it
+  // from a compute shader.
+  GLuint GetBuffer() const { return buffers_[current_buffer_]; }
+
+  GLsizeiptr GetCapacity() const { return capacity_; }
+
+ private:
+  // Number of buffer objects cycled through by Update().
+  static const int kBufferCount = 3;
+
+  GLuint buffers_[kBufferCount];
+  int current_buffer_;
+  GLsizeiptr capacity_;
+  // The storage of every buffer of the ring.
+  MemoryAccount gpu_memory_;
+};
+}  // namespace tango_gl
+#endif  // TANGO_GL_STREAMING_VERTEX_BUFFER_H_
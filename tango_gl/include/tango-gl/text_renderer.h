@@ -0,0 +1,174 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_GL_TEXT_RENDERER_H_
+#define TANGO_GL_TEXT_RENDERER_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "tango-gl/color.h"
+#include "tango-gl/memory_accounting.h"
+#include "tango-gl/streaming_vertex_buffer.h"
+#include "tango-gl/util.h"
+
+// FreeType's handles, whose headers stay out of the apps.
+struct FT_LibraryRec_;
+struct FT_FaceRec_;
+
+namespace tango_gl {
+
+// TextRenderer draws labels in the scene and text over it, e.g. measurements
+// and debug values, without going through Java views:
+//
+//   // Once, on the GL thread.
+//   text_.LoadSystemFont(kPixelSize);
+//   ...
+//   // Every frame, after the scene.
+//   text_.AddLabel("0.532 m", midpoint, Color(1.0f, 1.0f, 1.0f));
+//   text_.AddScreenText("12.1 ms", glm::vec2(-0.9f, 0.9f), color);
+//   text_.Render(projection_mat, view_mat);
+//
+// Glyphs are rasterized by FreeType the first time they are used, into the
+// cells of an atlas texture. When the atlas is full, the glyph used least
+// recently is evicted, never one of the text of the current frame. The text
+// added in a frame is drawn with a single draw call, at the pixel size of
+// the font whatever its distance, with a one pixel shadow so that it stays
+// readable over the camera image.
+//
+// All methods must be called on the GL thread.
+class TextRenderer {
+ public:
+  TextRenderer();
+  TextRenderer(const TextRenderer& other) = delete;
+  TextRenderer& operator=(const TextRenderer&) = delete;
+  ~TextRenderer();
+
+  // Load the font file at |path|, rasterized |pixel_size| pixels high. Drops
+  // the glyphs of the previous font.
+  //
+  // @return false if the font could not be loaded, and nothing will be
+  // drawn.
+  bool LoadFont(const std::string& path, int pixel_size);
+
+  // Load the first of the Android system fonts found.
+  bool LoadSystemFont(int pixel_size);
+
+  bool IsLoaded() const { return face_ != nullptr; }
+
+  // @return the height of a line of text in pixels, 0 without a font.
+  int GetLineHeight() const { return line_height_; }
+
+  // Queue the UTF-8 |text|, centered on the projection of |position|. It is
+  // not drawn when the position is behind the camera.
+  void AddLabel(const char* text, const glm::vec3& position,
+                const Color& color);
+
+  // Queue the UTF-8 |text| starting at |position|, in normalized device
+  // coordinates, and vertically centered on it.
+  void AddScreenText(const char* text, const glm::vec2& position,
+                     const Color& color);
+
+  // Draw the text queued since the last call, on top of the scene, then
+  // clear the queue. Does not change the GL state, besides the bound buffers.
+  void Render(const glm::mat4& projection_mat, const glm::mat4& view_mat);
+
+  // Delete the atlas, program and buffers.
+  void DeleteGlResources();
+
+  // Forget the GL objects without deleting them, for when the GL context they
+  // belonged to has been destroyed. The glyphs are rasterized again.
+  void InvalidateGlResources();
+
+ private:
+  // A vertex of a glyph quad: where it is anchored, in world space or in
+  // normalized device coordinates when anchor[3] is 0, its offset from the
+  // anchor in pixels, y down, and its atlas coordinates.
+  struct Vertex {
+    float anchor[4];
+    float offset[2];
+    float uv[2];
+    uint8_t color[4];
+  };
+
+  // A cell of the atlas and the glyph in it.
+  struct Cell {
+    // The code point, 0 while empty.
+    uint32_t code_point;
+    // Frame the glyph was last drawn in, the LRU order.
+    uint64_t last_used_frame;
+    // The bitmap, at the top left of the cell, and where it goes relative to
+    // the pen on the baseline.
+    int width;
+    int height;
+    int left;
+    int top;
+    int advance;
+  };
+
+  // Queue |text| with its pen starting |offset_x| pixels from the anchor, on
+  // a baseline centering the line vertically on it.
+  void AddText(const char* text, const float anchor[4], float offset_x,
+               const Color& color);
+
+  // @return the width of |text| in pixels, rasterizing its glyphs.
+  float MeasureText(const char* text);
+
+  // @return the cell of |code_point|, rasterized into the atlas if needed, or
+  // nullptr if it has no glyph or the atlas is full of the current frame's.
+  const Cell* GetGlyph(uint32_t code_point);
+
+  // Create the atlas and program of the current context, once until
+  // InvalidateGlResources().
+  bool InitializeGl();
+
+  // Empty the atlas cells.
+  void ClearCells();
+
+  FT_LibraryRec_* library_;
+  FT_FaceRec_* face_;
+  int line_height_;
+  int ascender_;
+  int cell_size_;
+  int cells_per_row_;
+
+  std::vector<Cell> cells_;
+  std::unordered_map<uint32_t, int> cell_of_code_point_;
+  uint64_t frame_;
+  // Rows of a bitmap without the padding of FreeType, for the upload.
+  std::vector<uint8_t> bitmap_;
+
+  std::vector<Vertex> vertices_;
+
+  bool gl_initialized_;
+  GLuint atlas_;
+  MemoryAccount atlas_memory_;
+  GLuint program_;
+  GLint anchor_location_;
+  GLint offset_location_;
+  GLint uv_location_;
+  GLint color_location_;
+  GLint view_projection_location_;
+  GLint pixel_size_location_;
+  GLint shadow_offset_location_;
+  GLint atlas_location_;
+  StreamingVertexBuffer vertex_buffer_;
+};
+}  // namespace tango_gl
+#endif  // TANGO_GL_TEXT_RENDERER_H_
@@ -17,27 +17,87 @@
 #ifndef TANGO_GL_TEXTURE_H_
 #define TANGO_GL_TEXTURE_H_
 
-#include <errno.h>
-#include <png.h>
+#include <vector>
 
+#include "tango-gl/memory_accounting.h"
 #include "tango-gl/util.h"
 
 namespace tango_gl {
+// Pixels of an image file decoded into memory, ready to be uploaded into a
+// Texture.
+struct TextureImage {
+  TextureImage() : width(0), height(0), format(0), is_compressed(false) {}
+
+  GLsizei width;
+  GLsizei height;
+  // GL_RGB or GL_RGBA with GL_UNSIGNED_BYTE components, tightly packed, or
+  // the compressed internal format when is_compressed is set.
+  GLenum format;
+  bool is_compressed;
+  std::vector<unsigned char> data;
+};
+
 class Texture {
  public:
+  // An empty texture, to be filled with Upload(), e.g. by a TextureLoader.
+  Texture();
+  // Decode and upload an image file right away. Must be called on the GL
+  // thread.
   explicit Texture(const char* file_path);
   Texture(const Texture& other) = delete;
   Texture& operator=(const Texture&) = delete;
   ~Texture();
 
+  // Decode and upload a PNG file, or an ETC1 or ETC2 compressed PKM file.
+  // A PNG file is decoded row by row into a mapped pixel buffer on OpenGL ES
+  // 3.0, and into staging memory reused across loads otherwise, so the image
+  // is never copied on the CPU. Must be called on the GL thread.
   bool LoadFromPNG(const char* file_path);
+
+  // Decode an image file in memory. PNG files are expanded to 8 bit RGB or
+  // RGBA. Files ending in .pkm are read as ETC1 or ETC2 blocks, which are
+  // uploaded as they are. Does not use GL, so it can run on any thread.
+  static bool DecodeFile(const char* file_path, TextureImage* image);
+
+  // Upload a decoded image, replacing the previous one. Images whose size is
+  // not a power of two are uploaded as they are on OpenGL ES 3.0 or with
+  // GL_OES_texture_npot. Otherwise they are placed in the corner of the next
+  // power of two texture, see GetTextureCoordinateScale(). Must be called on
+  // the GL thread.
+  bool Upload(const TextureImage& image);
+
+  // Returns 0 until an image was uploaded.
   GLuint GetTextureID() const;
+  bool IsLoaded() const { return texture_id_ != 0; }
+
+  // Size of the image and of the texture holding it.
+  GLsizei GetWidth() const { return width_; }
+  GLsizei GetHeight() const { return height_; }
+  GLsizei GetTextureWidth() const { return texture_width_; }
+  GLsizei GetTextureHeight() const { return texture_height_; }
+
+  // Texture coordinates of the far corner of the image, (1, 1) unless it was
+  // padded to a power of two.
+  glm::vec2 GetTextureCoordinateScale() const;
+
+  // Delete the texture.
+  void DeleteGlResources();
+
+  // Forget the texture without deleting it, for when the GL context it
+  // belonged to has been destroyed.
+  void InvalidateGlResources();
 
  private:
-  png_uint_32 width_, height_;
-  int bit_depth_, color_type_;
-  char* byte_data_;
+  // Upload |size| bytes of |pixels| with the size and format of |image|,
+  // an offset into the bound GL_PIXEL_UNPACK_BUFFER if there is one.
+  bool UploadPixels(const TextureImage& image, const void* pixels,
+                    size_t size);
+
+  GLsizei width_, height_;
+  GLsizei texture_width_, texture_height_;
   GLuint texture_id_;
+  // The storage of texture_id_, padding included.
+  MemoryAccount gpu_memory_;
 };
 }  // namespace tango_gl
 #endif  // TANGO_GL_TEXTURE_H_
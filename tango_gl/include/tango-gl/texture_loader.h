@@ -0,0 +1,90 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_GL_TEXTURE_LOADER_H_
+#define TANGO_GL_TEXTURE_LOADER_H_
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tango-gl/texture.h"
+
+namespace tango_gl {
+// TextureLoader decodes image files on worker threads and uploads them on
+// the GL thread a few at a time, so loading many textures neither blocks the
+// caller nor stalls a frame.
+//
+//   loader.Load("/sdcard/marker.png", &marker_texture);
+//   ...
+//   // Once per frame, on the GL thread.
+//   loader.UploadDecoded(kUploadBytesPerFrame);
+//
+// Textures are drawn empty until they are uploaded, see Texture::IsLoaded().
+// They must outlive the loader, or at least their upload.
+class TextureLoader {
+ public:
+  // @param thread_count: number of decoding threads.
+  explicit TextureLoader(int thread_count = 2);
+  TextureLoader(const TextureLoader& other) = delete;
+  TextureLoader& operator=(const TextureLoader&) = delete;
+  // Waits for the file being decoded, if any, and drops the others.
+  ~TextureLoader();
+
+  // Queue an image file to decode into |texture|, see Texture::DecodeFile().
+  // Can be called on any thread.
+  void Load(const std::string& file_path, Texture* texture);
+
+  // Upload decoded images, in the order they finished decoding, until
+  // |byte_budget| bytes were uploaded. The first image is always uploaded so
+  // large images are not starved. Must be called on the GL thread.
+  //
+  // @return the number of textures uploaded.
+  int UploadDecoded(size_t byte_budget);
+
+  // @return the number of textures queued and not uploaded yet, including
+  //         those that failed to decode and were not handed to
+  //         UploadDecoded() yet.
+  size_t GetPendingCount() const;
+
+ private:
+  struct Request {
+    std::string file_path;
+    Texture* texture;
+  };
+
+  struct DecodedImage {
+    Texture* texture;
+    bool is_valid;
+    TextureImage image;
+  };
+
+  void DecodeLoop();
+
+  mutable std::mutex mutex_;
+  std::condition_variable request_available_;
+  std::deque<Request> requests_;
+  std::deque<DecodedImage> decoded_images_;
+  // Requests taken by a worker and not decoded yet.
+  size_t decoding_count_;
+  bool is_stopping_;
+  std::vector<std::thread> workers_;
+};
+}  // namespace tango_gl
+#endif  // TANGO_GL_TEXTURE_LOADER_H_
@@ -18,13 +18,36 @@
 #define TANGO_GL_TRACE_H_
 
 #include "tango-gl/line.h"
+#include "tango-gl/trajectory.h"
 
 namespace tango_gl {
+// The path of the device, drawn as a line strip through points 5 cm apart.
+// Long sessions are decimated by the trajectory, so drawing costs the same
+// every frame however long the session ran.
+//
+// The positions are either appended on the GL thread, once per frame, or
+// appended to a SharedTrajectory at the rate of the poses and taken from it
+// every frame, which keeps every pose whatever the frame rate.
 class Trace : public Line {
  public:
+  // Spacing of the points in meters, and the most points kept.
+  static constexpr float kSpacing = 0.05f;
+  static const size_t kMaxPointCount = 5000;
+
   Trace();
   void UpdateVertexArray(const glm::vec3& v);
+  // Take the points of |trajectory| that changed since the previous call,
+  // e.g. one created with kSpacing and kMaxPointCount. Must be called on the
+  // GL thread, with the same trajectory every time.
+  void UpdateVertexArray(SharedTrajectory* trajectory);
   void ClearVertexArray();
+  void Render(const glm::mat4& projection_mat, const glm::mat4& view_mat) const;
+
+  // The points drawn, e.g. to Serialize() them into a session log.
+  const Trajectory& GetTrajectory() const { return trajectory_; }
+
+ private:
+  Trajectory trajectory_;
 };
 }  // namespace tango_gl
 #endif  // TANGO_GL_TRACE_H_
@@ -0,0 +1,98 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_GL_TRACING_H_
+#define TANGO_GL_TRACING_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+// Time the enclosing scope as a trace slice named |name|, which must be a
+// string literal or otherwise outlive the recording.
+//
+//   void App::Render() {
+//     TANGO_TRACE_SCOPE("App::Render");
+//     ...
+//   }
+#define TANGO_TRACE_SCOPE(name)                                   \
+  tango_gl::tracing::ScopedTrace TANGO_TRACE_CONCAT_(tango_trace_, \
+                                                     __LINE__)(name)
+#define TANGO_TRACE_CONCAT_(a, b) TANGO_TRACE_CONCAT_IMPL_(a, b)
+#define TANGO_TRACE_CONCAT_IMPL_(a, b) a##b
+
+namespace tango_gl {
+namespace tracing {
+
+// Start recording trace slices, dropping those of the previous recording.
+//
+// While recording, every slice is also written as a systrace marker, so it
+// shows in systrace when that captures the app's "view" category. Every
+// thread keeps its slices in its own ring buffer, which holds the latest few
+// thousand of them.
+void Start();
+
+// Stop recording. The recorded slices are kept for DumpChromeTrace().
+void Stop();
+
+// @return true if slices are being recorded.
+bool IsRecording();
+
+// Write the recorded slices as a Chrome trace, which chrome://tracing and
+// Perfetto open, e.g. to the app's directory on the sdcard. Can be called
+// while recording.
+//
+// @param path: path of the JSON file to write.
+//
+// @return false if the file could not be written.
+bool DumpChromeTrace(const char* path);
+
+// The durations of the recorded slices of one name.
+struct SliceStatistics {
+  // The name of the slices, as passed to the first of them.
+  const char* name;
+  int count;
+  double average_ms;
+  double percentile_95_ms;
+  double max_ms;
+};
+
+// @return the statistics of the slices recorded so far by name, in the order
+//         of the names, e.g. for a benchmark to check against its budgets.
+//         Only the latest slices of each thread are kept, see Start(). Can be
+//         called while recording.
+std::vector<SliceStatistics> GetSliceStatistics();
+
+// ScopedTrace records the time from its construction to its destruction,
+// see TANGO_TRACE_SCOPE(). It does nothing but read a flag when not
+// recording.
+class ScopedTrace {
+ public:
+  explicit ScopedTrace(const char* name);
+  ScopedTrace(const ScopedTrace& other) = delete;
+  ScopedTrace& operator=(const ScopedTrace&) = delete;
+  ~ScopedTrace();
+
+ private:
+  const char* name_;
+  // CLOCK_MONOTONIC time of the construction in nanoseconds, 0 when the
+  // slice is not recorded.
+  int64_t begin_time_;
+};
+}  // namespace tracing
+}  // namespace tango_gl
+
+#endif  // TANGO_GL_TRACING_H_
@@ -0,0 +1,141 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_GL_TRAJECTORY_H_
+#define TANGO_GL_TRAJECTORY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "tango-gl/memory_accounting.h"
+
+namespace tango_gl {
+// A path sampled every |spacing| meters along its length, e.g. the positions
+// of the device over a session. Points are appended in constant amortized
+// time. Once the path holds |max_point_count| points its older part is
+// decimated: the points where it runs straight are dropped and those where it
+// turns are kept, while the most recent part keeps every point. Each point
+// keeps the arc length it was appended at, so distances along the path
+// survive the decimation.
+//
+//   Trajectory trajectory(0.05f, 5000);
+//   trajectory.Append(position);
+//   buffer.Update(trajectory.GetPositions(),
+//                 trajectory.TakeFirstChangedPoint());
+class Trajectory {
+ public:
+  Trajectory(float spacing, size_t max_point_count);
+
+  // Append |position| if it is at least the spacing away from the last
+  // point, decimating the older points when the path is full.
+  //
+  // @return whether the point was appended.
+  bool Append(const glm::vec3& position);
+
+  void Clear();
+
+  size_t GetPointCount() const { return positions_.size(); }
+  const std::vector<glm::vec3>& GetPositions() const { return positions_; }
+
+  // @return the length of the path up to point |index|, which is the sum of
+  //         the distances between the points as they were appended.
+  float GetArcLength(size_t index) const { return arc_lengths_[index]; }
+  // @return the length of the path up to its last point, 0 when empty.
+  float GetLength() const {
+    return arc_lengths_.empty() ? 0.0f : arc_lengths_.back();
+  }
+
+  // @return the first point that changed since the last call: the first one
+  //         appended, or the first one moved by a decimation, and
+  //         GetPointCount() if none did. E.g. for a vertex buffer to upload
+  //         only the points from there on.
+  size_t TakeFirstChangedPoint();
+
+  // Replace the points from |first_changed_point| on with those of |source|,
+  // e.g. to keep a copy of a path appended to on another thread without
+  // copying all of it every time. The points before it must be the same in
+  // both.
+  void CopyFrom(const Trajectory& source, size_t first_changed_point);
+
+  // Append the points to |data|, with their arc lengths, as little endian
+  // floats after a header with the point count and the spacing. This is the
+  // payload of the trajectory records of tango_util::SessionRecorder.
+  void Serialize(std::vector<uint8_t>* data) const;
+
+  // Replace the points with those of Serialize(). The spacing and capacity
+  // are kept.
+  //
+  // @return false if |data| is not a trajectory, leaving the path empty.
+  bool Deserialize(const uint8_t* data, size_t size);
+
+ private:
+  // Drop the points of the older part of the path that are closer than a
+  // tolerance to the simplified path, with a coarser tolerance each time,
+  // until at most half the capacity is used.
+  void Decimate();
+
+  // Account the capacity of the vectors, which only grows past the one
+  // reserved when a longer path is deserialized.
+  void UpdateMemoryAccount();
+
+  float spacing_;
+  size_t max_point_count_;
+  std::vector<glm::vec3> positions_;
+  std::vector<float> arc_lengths_;
+  size_t first_changed_point_;
+  MemoryAccount memory_;
+};
+
+// SharedTrajectory is a Trajectory appended to on one thread and read on
+// another, e.g. fed from the pose callbacks at the rate of the service and
+// drawn by a Trace, so that no pose is lost when frames drop:
+//
+//   // Pose thread.
+//   trajectory_.Append(position);
+//
+//   // GL thread, once per frame.
+//   trace_->UpdateVertexArray(&trajectory_);
+//   trace_->Render(projection_mat, view_mat);
+//
+// The appends and the decimation happen on the appending thread. A reader
+// keeps its own copy, the snapshot, and only copies the points that changed
+// since its previous call, under a lock held for that copy.
+class SharedTrajectory {
+ public:
+  SharedTrajectory(float spacing, size_t max_point_count);
+  SharedTrajectory(const SharedTrajectory& other) = delete;
+  SharedTrajectory& operator=(const SharedTrajectory&) = delete;
+
+  // See Trajectory::Append().
+  bool Append(const glm::vec3& position);
+  void Clear();
+
+  // Bring |snapshot| up to date with the points changed since the previous
+  // call. There must be a single reader, whose snapshot is the same every
+  // call or starts empty, e.g. after the GL context was recreated.
+  //
+  // @return whether |snapshot| changed.
+  bool CopyTo(Trajectory* snapshot);
+
+ private:
+  std::mutex mutex_;
+  Trajectory trajectory_;
+};
+}  // namespace tango_gl
+#endif  // TANGO_GL_TRAJECTORY_H_
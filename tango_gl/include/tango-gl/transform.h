@@ -17,10 +17,18 @@
 #ifndef TANGO_GL_TRANSFORM_H_
 #define TANGO_GL_TRANSFORM_H_
 
+#include <vector>
+
 #include "glm/glm.hpp"
 #include "glm/gtc/quaternion.hpp"
 
 namespace tango_gl {
+// Transform places an object relative to its parent, or to the world.
+//
+// The local and world matrices are cached. Changing the position, rotation,
+// scale or parent of a transform marks its world matrix, and those of its
+// descendants, out of date; it is then recomputed once on the next
+// GetTransformationMatrix(). Not thread safe.
 class Transform {
  public:
   Transform();
@@ -41,19 +49,39 @@ class Transform {
   void Translate(const glm::vec3& translation);
 
   void SetTransformationMatrix(const glm::mat4& transform_mat);
-  glm::mat4 GetTransformationMatrix() const;
+  // The world matrix, i.e. the local matrix composed with those of every
+  // parent.
+  const glm::mat4& GetTransformationMatrix() const;
 
+  // Attach the transform to a parent, or to the world with nullptr. A
+  // transform deleted before its children leaves them attached to the world.
   void SetParent(Transform* transform);
 
   const Transform* GetParent() const;
   Transform* GetParent();
 
  private:
+  // Mark the world matrix of this transform and of its descendants out of
+  // date.
+  void InvalidateWorldMatrix();
+  void SetLocalMatrixDirty() {
+    is_local_matrix_dirty_ = true;
+    InvalidateWorldMatrix();
+  }
+
   Transform* parent_;
+  std::vector<Transform*> children_;
 
   glm::vec3 position_;
   glm::quat rotation_;
   glm::vec3 scale_;
+
+  // A transform whose world matrix is dirty has dirty descendants too, since
+  // computing a world matrix computes those of its parents first.
+  mutable glm::mat4 local_matrix_;
+  mutable glm::mat4 world_matrix_;
+  mutable bool is_local_matrix_dirty_;
+  mutable bool is_world_matrix_dirty_;
 };
 }  // namespace tango_gl
 #endif  // TANGO_GL_TRANSFORM_H_
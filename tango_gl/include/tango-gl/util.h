@@ -20,11 +20,15 @@
 
 #define GL_VERTEX_PROGRAM_POINT_SIZE 0x8642
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <jni.h>
 #include <android/log.h>
 #include <GLES2/gl2.h>
 #include <GLES2/gl2ext.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
@@ -32,10 +36,10 @@
 #include "glm/gtc/type_ptr.hpp"
 #include "glm/gtx/matrix_decompose.hpp"
 
-#define LOGI(...) \
-  __android_log_print(ANDROID_LOG_INFO, "tango_jni_example", __VA_ARGS__)
-#define LOGE(...) \
-  __android_log_print(ANDROID_LOG_ERROR, "tango_jni_example", __VA_ARGS__)
+#include "tango-gl/log.h"
+
+#define LOGI(...) TANGO_LOG(ANDROID_LOG_INFO, __VA_ARGS__)
+#define LOGE(...) TANGO_LOG(ANDROID_LOG_ERROR, __VA_ARGS__)
 
 #ifndef M_PI
 #define M_PI 3.1415926f
@@ -44,12 +48,247 @@
 #define RADIAN_2_DEGREE 57.2957795f
 #define DEGREE_2_RADIANS 0.0174532925f
 
+// How util::CheckGlError() checks, for the whole build, e.g. with
+// APP_CFLAGS += -DTANGO_GL_ERROR_CHECKS=2:
+//   0, none: the default of release builds, glGetError() can stall the
+//      pipeline until the driver caught up with the calls.
+//   1, each: glGetError() after each checked operation, the default of debug
+//      builds.
+//   2, frame: glGetError() once per frame, in CheckGlErrorsOfFrame(), which
+//      names the first operation that failed where GL_KHR_debug reports the
+//      errors.
+#define TANGO_GL_ERROR_CHECKS_NONE 0
+#define TANGO_GL_ERROR_CHECKS_EACH 1
+#define TANGO_GL_ERROR_CHECKS_FRAME 2
+#ifndef TANGO_GL_ERROR_CHECKS
+#ifdef NDEBUG
+#define TANGO_GL_ERROR_CHECKS TANGO_GL_ERROR_CHECKS_NONE
+#else
+#define TANGO_GL_ERROR_CHECKS TANGO_GL_ERROR_CHECKS_EACH
+#endif
+#endif
+
 namespace tango_gl {
 namespace util {
-void CheckGlError(const char* operation);
+// Log the GL errors raised since the last check, as raised by |operation|,
+// whatever TANGO_GL_ERROR_CHECKS.
+void CheckGlErrorNow(const char* operation);
+
+// Note that |operation| was issued, for CheckGlErrorsOfFrame() to name it if
+// it failed. |operation| must outlive the frame, e.g. be a string literal.
+void MarkGlOperation(const char* operation);
+
+// Check the GL errors of |operation|, as TANGO_GL_ERROR_CHECKS says.
+inline void CheckGlError(const char* operation) {
+#if TANGO_GL_ERROR_CHECKS == TANGO_GL_ERROR_CHECKS_EACH
+  CheckGlErrorNow(operation);
+#elif TANGO_GL_ERROR_CHECKS == TANGO_GL_ERROR_CHECKS_FRAME
+  MarkGlOperation(operation);
+#else
+  (void)operation;
+#endif
+}
+
+// Check the GL errors of the frame when TANGO_GL_ERROR_CHECKS is frame, a
+// no-op otherwise. Called on the GL thread once the frame is drawn.
+void CheckGlErrorsOfFrame();
 
 GLuint CreateProgram(const char* vertex_source, const char* fragment_source);
 
+// Create a program from the source of a compute shader, which needs a GLES 3.1
+// context.
+GLuint CreateComputeProgram(const char* compute_source);
+
+// A program shared by everything drawn with the same shader sources, see
+// GetSharedProgram(). The locations of its active uniforms and attributes are
+// looked up once, when it is linked.
+class SharedProgram {
+ public:
+  explicit SharedProgram(GLuint program);
+  SharedProgram(const SharedProgram& other) = delete;
+  SharedProgram& operator=(const SharedProgram&) = delete;
+
+  GLuint GetId() const { return id_; }
+
+  // @return the location of a uniform or attribute, -1 if the program has no
+  // active one of that name.
+  GLint GetUniformLocation(const char* name) const;
+  GLint GetAttribLocation(const char* name) const;
+
+ private:
+  GLuint id_;
+  std::unordered_map<std::string, GLint> uniform_locations_;
+  std::unordered_map<std::string, GLint> attrib_locations_;
+};
+
+// Get the program built from a pair of shader sources, compiling and linking
+// it the first time it is asked for. Programs are cached per GL context: when
+// a different context is current, e.g. after the surface was recreated, the
+// cache starts over and the old handles, which died with their context, are
+// forgotten. The program is owned by the cache and must not be deleted.
+// Must be called on the GL thread.
+//
+// @return NULL if the program failed to compile or link.
+const SharedProgram* GetSharedProgram(const char* vertex_source,
+                                      const char* fragment_source);
+
+// Delete every program of the cache. Must be called on the GL thread, with the
+// context that created them current.
+void DeleteSharedPrograms();
+
+// Store the binaries of the programs linked by GetSharedProgram() in
+// |directory|, e.g. the application's cache directory, and load them from
+// there instead of compiling on the following launches. Binaries that the
+// driver rejects, e.g. after a driver update, are rebuilt. Only used when
+// GL_OES_get_program_binary is supported. An empty |directory| disables it,
+// which is the default.
+void SetProgramBinaryDirectory(const std::string& directory);
+
+// A vertex buffer of xyz positions shared by every object drawn with the
+// same geometry, e.g. the unit circles of a resolution, see
+// GetSharedVertexBuffer().
+struct SharedVertexBuffer {
+  GLuint id;
+  GLsizei vertex_count;
+};
+
+// Fill |vertices| with the geometry of |parameter|, e.g. a resolution.
+typedef void (*GeometryGenerator)(int parameter,
+                                  std::vector<glm::vec3>* vertices);
+
+// Get the vertex buffer of the geometry |generate| makes for |parameter|,
+// generating and uploading it the first time it is asked for. Buffers are
+// cached per GL context like the programs of GetSharedProgram(), and owned by
+// the cache. Must be called on the GL thread.
+const SharedVertexBuffer& GetSharedVertexBuffer(GeometryGenerator generate,
+                                                int parameter);
+
+// @return a number that changes whenever the cache of GetSharedVertexBuffer()
+//         starts over, e.g. because another context is current, for the
+//         objects that hold a buffer to get it again. Must be called on the GL
+//         thread.
+uint32_t GetSharedVertexBufferGeneration();
+
+// Delete every buffer of the cache. Must be called on the GL thread, with the
+// context that created them current.
+void DeleteSharedVertexBuffers();
+
+// Whether the current GL context supports an extension, e.g.
+// "GL_OES_element_index_uint". Must be called on the GL thread.
+bool IsGlExtensionSupported(const char* extension);
+
+// What the current GL context offers beyond GLES 2.0. The GLES3 entry points
+// are looked up with eglGetProcAddress(), from the core functions on a GLES3
+// context and from the matching extension otherwise, so the library still
+// runs on GLES 2.0 drivers. Each group of entry points is either complete or
+// NULL, the callers keep a GLES 2.0 path for the latter:
+//
+//   const util::GlCapabilities& gl = util::GetGlCapabilities();
+//   if (gl.HasVertexArrays()) {
+//     gl.bind_vertex_array(vertex_array_);
+//     ...
+//   }
+struct GlCapabilities {
+  typedef void(GL_APIENTRYP GenVertexArraysFunction)(GLsizei, GLuint*);
+  typedef void(GL_APIENTRYP BindVertexArrayFunction)(GLuint);
+  typedef void(GL_APIENTRYP DeleteVertexArraysFunction)(GLsizei,
+                                                        const GLuint*);
+  typedef void(GL_APIENTRYP DrawArraysInstancedFunction)(GLenum, GLint,
+                                                         GLsizei, GLsizei);
+  typedef void(GL_APIENTRYP DrawElementsInstancedFunction)(GLenum, GLsizei,
+                                                           GLenum,
+                                                           const GLvoid*,
+                                                           GLsizei);
+  typedef void(GL_APIENTRYP VertexAttribDivisorFunction)(GLuint, GLuint);
+  typedef void*(GL_APIENTRYP MapBufferRangeFunction)(GLenum, GLintptr,
+                                                     GLsizeiptr, GLbitfield);
+  typedef GLboolean(GL_APIENTRYP UnmapBufferFunction)(GLenum);
+  // GLsync is an opaque pointer.
+  typedef void* Sync;
+  typedef Sync(GL_APIENTRYP FenceSyncFunction)(GLenum, GLbitfield);
+  typedef GLenum(GL_APIENTRYP ClientWaitSyncFunction)(Sync, GLbitfield,
+                                                      uint64_t);
+  typedef void(GL_APIENTRYP DeleteSyncFunction)(Sync);
+  typedef void(GL_APIENTRYP DispatchComputeFunction)(GLuint, GLuint, GLuint);
+  typedef void(GL_APIENTRYP MemoryBarrierFunction)(GLbitfield);
+  typedef void(GL_APIENTRYP BindBufferBaseFunction)(GLenum, GLuint, GLuint);
+  typedef void(GL_APIENTRYP BindImageTextureFunction)(GLuint, GLuint, GLint,
+                                                      GLboolean, GLint,
+                                                      GLenum, GLenum);
+  typedef void(GL_APIENTRYP TexStorage2DFunction)(GLenum, GLsizei, GLenum,
+                                                  GLsizei, GLsizei);
+
+  // Access bits of glMapBufferRange(), which gl2.h does not define.
+  static const GLbitfield kMapWriteBit = 0x0002;
+  static const GLbitfield kMapInvalidateRangeBit = 0x0004;
+  static const GLbitfield kMapInvalidateBufferBit = 0x0008;
+  static const GLbitfield kMapUnsynchronizedBit = 0x0020;
+
+  // Values of fence syncs, which gl2.h does not define either.
+  static const GLenum kSyncGpuCommandsComplete = 0x9117;
+  static const GLbitfield kSyncFlushCommandsBit = 0x0001;
+  static const GLenum kAlreadySignaled = 0x911A;
+  static const GLenum kConditionSatisfied = 0x911C;
+
+  GlCapabilities();
+
+  // The EGL context may be newer than the version the application asked for,
+  // this is what the driver actually created, e.g. 3 and 1 for GLES 3.1.
+  bool IsGles3() const { return major_version >= 3; }
+  bool IsGles31() const {
+    return major_version > 3 || (major_version == 3 && minor_version >= 1);
+  }
+  int major_version;
+  int minor_version;
+
+  // Vertex array objects: GLES3 or GL_OES_vertex_array_object.
+  bool HasVertexArrays() const { return gen_vertex_arrays != NULL; }
+  GenVertexArraysFunction gen_vertex_arrays;
+  BindVertexArrayFunction bind_vertex_array;
+  DeleteVertexArraysFunction delete_vertex_arrays;
+
+  // Instanced draws: GLES3 or GL_EXT_instanced_arrays.
+  bool HasInstancing() const { return draw_arrays_instanced != NULL; }
+  DrawArraysInstancedFunction draw_arrays_instanced;
+  DrawElementsInstancedFunction draw_elements_instanced;
+  VertexAttribDivisorFunction vertex_attrib_divisor;
+
+  // Writing buffers in place: GLES3 or GL_EXT_map_buffer_range, whose unmap
+  // comes from GL_OES_mapbuffer.
+  bool HasMapBufferRange() const { return map_buffer_range != NULL; }
+  MapBufferRangeFunction map_buffer_range;
+  UnmapBufferFunction unmap_buffer;
+
+  // Fence syncs, to learn without waiting when the GPU is done with a
+  // command: GLES3 or GL_APPLE_sync.
+  bool HasFenceSync() const { return fence_sync != NULL; }
+  FenceSyncFunction fence_sync;
+  ClientWaitSyncFunction client_wait_sync;
+  DeleteSyncFunction delete_sync;
+
+  // Compute shaders and the storage they write to: GLES 3.1.
+  bool HasCompute() const { return dispatch_compute != NULL; }
+  DispatchComputeFunction dispatch_compute;
+  MemoryBarrierFunction memory_barrier;
+  BindBufferBaseFunction bind_buffer_base;
+  BindImageTextureFunction bind_image_texture;
+  TexStorage2DFunction tex_storage_2d;
+};
+
+// Get the capabilities of the current GL context, queried the first time they
+// are asked for and again when a different context is current. Must be called
+// on the GL thread.
+const GlCapabilities& GetGlCapabilities();
+
+// Write |size| bytes of |data| at |offset| in the buffer bound to |target|, a
+// range that no draw issued since the buffer was allocated reads, e.g. the
+// vertices appended to a growing path. glBufferSubData() on a buffer still
+// read by pending draws makes the driver wait for them or copy the whole
+// buffer; the range is mapped unsynchronized instead where
+// GlCapabilities::HasMapBufferRange(). Must be called on the GL thread.
+void WriteUnusedBufferRange(GLenum target, GLintptr offset, GLsizeiptr size,
+                            const void* data);
+
 void DecomposeMatrix(const glm::mat4& transform_mat, glm::vec3& translation,
                      glm::quat& rotation, glm::vec3& scale);
 
@@ -18,25 +18,109 @@
 #define TANGO_GL_VIDEO_OVERLAY_H_
 
 #include "tango-gl/drawable_object.h"
+#include "tango-gl/full_screen_quad.h"
 
 namespace tango_gl {
+// VideoOverlay draws a camera texture over the full screen quad, as it is or
+// undistorted. The undistortion is a map, built once on the CPU from the
+// intrinsics of the camera, from each pixel of the undistorted image to the
+// texture coordinates of the camera image it comes from. Drawing it is a
+// lookup per fragment instead of the distortion model:
+//
+//   tango_gl::VideoOverlay::Undistortion undistortion;
+//   undistortion.model = tango_gl::VideoOverlay::kFieldOfView;
+//   undistortion.width = intrinsics.width;
+//   ...
+//   undistortion.distortion[0] = intrinsics.distortion[0];
+//   undistortion.map_width = 160;
+//   undistortion.map_height = 90;
+//   fisheye_overlay_->SetUndistortion(undistortion);
+//
+// The map is interpolated between its texels, and the distortion varies
+// smoothly, so it can be much smaller than the camera image. The pixels of
+// the undistorted image that the camera does not see are black.
 class VideoOverlay : public DrawableObject {
  public:
+  // The distortion models of TangoCameraIntrinsics.
+  enum DistortionModel {
+    // TANGO_CALIBRATION_EQUIDISTANT, of the fisheye camera: a point at
+    // radius r on the normalized image plane is seen at
+    // atan(2 r tan(w / 2)) / w.
+    kFieldOfView,
+    // TANGO_CALIBRATION_POLYNOMIAL_3_PARAMETERS: a point at radius r is seen
+    // at r * (1 + k1 r^2 + k2 r^4 + k3 r^6).
+    kPolynomial3
+  };
+
+  struct Undistortion {
+    Undistortion();
+
+    DistortionModel model;
+    // Intrinsics of the camera image, in its pixels.
+    int width;
+    int height;
+    double fx;
+    double fy;
+    double cx;
+    double cy;
+    // w for kFieldOfView, k1, k2 and k3 for kPolynomial3.
+    double distortion[3];
+
+    // Resolution of the map, 0 for a quarter of the camera image's.
+    int map_width;
+    int map_height;
+    // Focal length of the undistorted image, relative to the camera's. Below
+    // 1 it zooms out, to keep more of a wide field of view.
+    double focal_scale;
+  };
+
   explicit VideoOverlay(GLuint texture_type);
   VideoOverlay();
+  ~VideoOverlay();
   void Render(const glm::mat4& projection_mat, const glm::mat4& view_mat) const;
+
+  // Draw the texture at the far plane, after the opaque content, instead of
+  // under it before: with GL_LEQUAL depth testing against a depth buffer
+  // cleared to 1, only the pixels no content covers sample the camera
+  // texture. The translucent content is drawn after it. Leaves depth testing
+  // on with GL_LESS and depth writes, and blending off.
+  void RenderBehind() const;
   GLuint GetTextureId() const { return texture_id_; }
   void SetTextureId(GLuint texture_id) { texture_id_ = texture_id; }
   void Initialize();
 
+  // Draw the texture undistorted with the map of |undistortion|, replacing
+  // the previous map. Must be called on the GL thread.
+  //
+  // @return: false if the context has no half float RG textures, GLES3 or
+  //          GL_OES_texture_half_float with GL_EXT_texture_rg, the texture
+  //          then being drawn as it is.
+  bool SetUndistortion(const Undistortion& undistortion);
+
+  // Draw the texture as it is again, deleting the map.
+  void ClearUndistortion();
+
+  bool IsUndistorted() const { return undistortion_map_ != 0; }
+
  private:
+  void Draw(const glm::mat4& mvp_mat) const;
+
   // This id is populated on construction, and is passed to the tango service.
   GLuint texture_id_;
   GLuint texture_type_;
 
   GLuint attrib_texture_coords_;
   GLuint uniform_texture_;
-  GLuint vertex_buffers_[3];
+  FullScreenQuad quad_;
+
+  // Texture coordinates of the camera image for the pixels of the
+  // undistorted one, 0 when drawn as it is.
+  GLuint undistortion_map_;
+  GLuint undistorted_program_;
+  GLint uniform_undistorted_mvp_;
+  GLint uniform_undistorted_texture_;
+  GLint uniform_undistortion_map_;
+  FullScreenQuad undistorted_quad_;
 };
 }  // namespace tango_gl
 #endif  // TANGO_GL_VIDEO_OVERLAY_H_
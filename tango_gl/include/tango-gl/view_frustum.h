@@ -0,0 +1,67 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_GL_VIEW_FRUSTUM_H_
+#define TANGO_GL_VIEW_FRUSTUM_H_
+
+#include "tango-gl/bounding_box.h"
+#include "tango-gl/oriented_bounding_box.h"
+#include "tango-gl/util.h"
+
+namespace tango_gl {
+// ViewFrustum is the volume seen by a camera, as six planes, for culling
+// objects before they are drawn. See tango_gl::Frustum to draw one.
+class ViewFrustum {
+ public:
+  enum Containment { kOutside, kIntersecting, kInside };
+
+  // The planes are extracted from the product of the projection and view
+  // matrices, e.g. of a tango_gl::Camera, so the frustum is in world space.
+  ViewFrustum(const glm::mat4& projection_mat, const glm::mat4& view_mat);
+
+  // Test a world space box against the frustum. Boxes close to a corner of
+  // the frustum may be reported intersecting while they are outside, never
+  // the other way around.
+  Containment Classify(const BoundingBox& box) const;
+
+  bool IsVisible(const BoundingBox& box) const {
+    return Classify(box) != kOutside;
+  }
+
+  // Test a world space oriented box against the frustum, its sphere first
+  // and then the box, with four planes at a time in NEON or SSE2 where
+  // available. As loose as Classify() near the corners of the frustum.
+  Containment Classify(const OrientedBoundingBox& box) const;
+
+  bool IsVisible(const OrientedBoundingBox& box) const {
+    return Classify(box) != kOutside;
+  }
+
+  // @return the plane |index| in [0, 6), with the layout of planes_, e.g. to
+  // test many spheres at once.
+  const glm::vec4& GetPlane(int index) const { return planes_[index]; }
+
+ private:
+  // Left, right, bottom, top, near and far planes as (normal, distance),
+  // with the normal pointing inside. The normals are not normalized, which
+  // the sign tests do not need.
+  glm::vec4 planes_[6];
+  // The planes normalized, one array of 8 per coordinate of the layout of
+  // planes_, padded with two planes that contain everything.
+  float normalized_planes_[4][8];
+};
+}  // namespace tango_gl
+#endif  // TANGO_GL_VIEW_FRUSTUM_H_
@@ -16,6 +16,10 @@
 
 #include "tango-gl/line.h"
 
+#include "tango-gl/camera_block.h"
+#include "tango-gl/gl_state.h"
+#include "tango-gl/render_statistics.h"
+
 namespace tango_gl {
 Line::Line(float line_width, GLenum render_mode) {
   line_width_ = line_width;
@@ -24,21 +28,31 @@ Line::Line(float line_width, GLenum render_mode) {
 void Line::SetLineWidth(const float pixels) { line_width_ = pixels; }
 void Line::Render(const glm::mat4& projection_mat,
                   const glm::mat4& view_mat) const {
-  glUseProgram(shader_program_);
+  RenderVertices(projection_mat, view_mat, vec_vertices_);
+}
+
+void Line::RenderVertices(const glm::mat4& projection_mat,
+                          const glm::mat4& view_mat,
+                          const std::vector<glm::vec3>& vertices) const {
+  GlState::UseProgram(shader_program_);
   glLineWidth(line_width_);
   glm::mat4 model_mat = GetTransformationMatrix();
-  glm::mat4 mvp_mat = projection_mat * view_mat * model_mat;
+  glm::mat4 mvp_mat =
+      GetCameraBlock(projection_mat, view_mat).view_projection * model_mat;
   glUniformMatrix4fv(uniform_mvp_mat_, 1, GL_FALSE, glm::value_ptr(mvp_mat));
 
   glUniform4f(uniform_color_, red_, green_, blue_, alpha_);
 
-  glEnableVertexAttribArray(attrib_vertices_);
-  glVertexAttribPointer(attrib_vertices_, 3, GL_FLOAT, GL_FALSE,
-                        sizeof(glm::vec3), &vec_vertices_[0]);
-  glDrawArrays(render_mode_, 0, vec_vertices_.size());
-
-  glDisableVertexAttribArray(attrib_vertices_);
-  glUseProgram(0);
+  if (HasSharedVertices()) {
+    UpdateVertexBuffers();
+  } else {
+    UpdateGrowingVertexBuffer(vertices.data(), vertices.size(),
+                              sizeof(glm::vec3));
+  }
+  BindVertexAttributes(false);
+  CountDraw(buffer_vertex_count_);
+  glDrawArrays(render_mode_, 0, buffer_vertex_count_);
+  UnbindVertexAttributes(false);
 }
 
 }  // namespace tango_gl
@@ -0,0 +1,304 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-gl/log.h"
+
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+// Start of the files of BinaryLog::Write(), "TLG1".
+const uint32_t kFileMagic = 0x31474c54;
+
+// Letters of the Android priorities, as logcat prints them.
+const char kPriorityLetters[] = "??VDIWEF";
+
+// A record as written to the file, the site being an index in its table.
+struct FileRecord {
+  uint32_t site;
+  uint32_t argument_count;
+  int64_t time;
+  uint8_t types[8];
+  uint64_t values[tango_gl::log::BinaryLog::kMaxArguments];
+};
+
+bool WriteString(const char* text, FILE* file) {
+  const uint32_t length = static_cast<uint32_t>(strlen(text));
+  return fwrite(&length, sizeof(length), 1, file) == 1 &&
+         fwrite(text, 1, length, file) == length;
+}
+
+bool ReadString(FILE* file, std::string* text) {
+  uint32_t length;
+  if (fread(&length, sizeof(length), 1, file) != 1 || length > (1 << 16)) {
+    return false;
+  }
+  text->resize(length);
+  return length == 0 || fread(&(*text)[0], 1, length, file) == length;
+}
+
+// Append |format| to |output| with the conversions replaced by the values of
+// |record|, integers being recorded as 64 bits whatever their length
+// modifier.
+void FormatRecord(const std::string& format, const FileRecord& record,
+                  std::string* output) {
+  char buffer[128];
+  uint32_t argument = 0;
+  for (size_t i = 0; i < format.size(); ++i) {
+    if (format[i] != '%') {
+      output->push_back(format[i]);
+      continue;
+    }
+    if (i + 1 < format.size() && format[i + 1] == '%') {
+      output->push_back('%');
+      ++i;
+      continue;
+    }
+    // The flags, width and precision, without the length modifiers.
+    std::string specification = "%";
+    size_t j = i + 1;
+    for (; j < format.size() && strchr("-+ #0123456789.", format[j]); ++j) {
+      specification.push_back(format[j]);
+    }
+    for (; j < format.size() && strchr("hlLqjzt", format[j]); ++j) {
+    }
+    if (j == format.size()) {
+      break;
+    }
+    const char conversion = format[j];
+    i = j;
+    if (argument >= record.argument_count) {
+      output->append("<missing>");
+      continue;
+    }
+    // One of BinaryLog::ArgumentType: 1 signed, 2 unsigned, 3 double.
+    const uint8_t type = record.types[argument];
+    uint64_t value = record.values[argument];
+    ++argument;
+    double real;
+    memcpy(&real, &value, sizeof(real));
+    if (strchr("eEfFgGaA", conversion)) {
+      // An integer recorded for a floating point conversion.
+      if (type == 1) {
+        real = static_cast<double>(static_cast<int64_t>(value));
+      } else if (type == 2) {
+        real = static_cast<double>(value);
+      }
+      specification.push_back(conversion);
+      snprintf(buffer, sizeof(buffer), specification.c_str(), real);
+    } else if (strchr("diouxXc", conversion)) {
+      if (type == 3) {
+        value = static_cast<uint64_t>(static_cast<int64_t>(real));
+      }
+      if (conversion == 'c') {
+        specification.push_back('c');
+        snprintf(buffer, sizeof(buffer), specification.c_str(),
+                 static_cast<int>(value));
+      } else {
+        specification.append("ll");
+        specification.push_back(conversion);
+        snprintf(buffer, sizeof(buffer), specification.c_str(),
+                 static_cast<unsigned long long>(value));  // NOLINT
+      }
+    } else {
+      // Strings and pointers are not recorded.
+      snprintf(buffer, sizeof(buffer), "<%%%c>", conversion);
+    }
+    output->append(buffer);
+  }
+}
+}  // namespace
+
+namespace tango_gl {
+namespace log {
+
+struct BinaryLog::Ring {
+  // A record with its sequence lock: odd while being written, 2 * (index + 1)
+  // once record |index| of the log is complete.
+  struct Slot {
+    std::atomic<uint64_t> sequence;
+    Entry entry;
+  };
+
+  explicit Ring(size_t capacity)
+      : slots(new Slot[capacity]), mask(capacity - 1), write_index(0) {
+    for (size_t i = 0; i < capacity; ++i) {
+      slots[i].sequence.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  Slot* slots;
+  size_t mask;
+  std::atomic<uint64_t> write_index;
+};
+
+std::atomic<bool> BinaryLog::is_enabled_(false);
+BinaryLog::Ring* BinaryLog::ring_ = nullptr;
+
+void BinaryLog::Enable(int capacity) {
+  if (ring_ != nullptr) {
+    return;
+  }
+  size_t size = 1;
+  while (size < static_cast<size_t>(capacity)) {
+    size *= 2;
+  }
+  // Never freed: the sites may record until the process exits.
+  ring_ = new Ring(size);
+  is_enabled_.store(true, std::memory_order_release);
+}
+
+void BinaryLog::Append(const Entry& entry) {
+  // Sites that saw the flag before the ring was published drop the record.
+  if (!is_enabled_.load(std::memory_order_acquire)) {
+    return;
+  }
+  const uint64_t index =
+      ring_->write_index.fetch_add(1, std::memory_order_relaxed);
+  Ring::Slot& slot = ring_->slots[index & ring_->mask];
+  slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.entry = entry;
+  slot.sequence.store(2 * (index + 1), std::memory_order_release);
+}
+
+bool BinaryLog::Write(const char* path) {
+  if (!is_enabled_.load(std::memory_order_acquire)) {
+    return false;
+  }
+  // Copy the complete records, skipping those overwritten meanwhile.
+  const uint64_t end = ring_->write_index.load(std::memory_order_acquire);
+  const uint64_t capacity = ring_->mask + 1;
+  const uint64_t begin = end > capacity ? end - capacity : 0;
+  std::vector<FileRecord> records;
+  records.reserve(end - begin);
+  std::vector<const BinarySite*> sites;
+  std::unordered_map<const BinarySite*, uint32_t> site_indices;
+  for (uint64_t index = begin; index < end; ++index) {
+    const Ring::Slot& slot = ring_->slots[index & ring_->mask];
+    const uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+    if (sequence != 2 * (index + 1)) {
+      continue;
+    }
+    const Entry entry = slot.entry;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.sequence.load(std::memory_order_relaxed) != sequence) {
+      continue;
+    }
+
+    FileRecord record;
+    memset(&record, 0, sizeof(record));
+    auto inserted = site_indices.emplace(
+        entry.site, static_cast<uint32_t>(sites.size()));
+    if (inserted.second) {
+      sites.push_back(entry.site);
+    }
+    record.site = inserted.first->second;
+    record.argument_count = static_cast<uint32_t>(entry.argument_count);
+    record.time = entry.time;
+    memcpy(record.types, entry.types, entry.argument_count);
+    memcpy(record.values, entry.values,
+           entry.argument_count * sizeof(entry.values[0]));
+    records.push_back(record);
+  }
+
+  FILE* file = fopen(path, "wb");
+  if (file == nullptr) {
+    TANGO_LOG(ANDROID_LOG_ERROR, "Could not open %s for the binary log.",
+              path);
+    return false;
+  }
+  const uint32_t site_count = static_cast<uint32_t>(sites.size());
+  const uint32_t record_count = static_cast<uint32_t>(records.size());
+  bool is_written = fwrite(&kFileMagic, sizeof(kFileMagic), 1, file) == 1 &&
+                    fwrite(&site_count, sizeof(site_count), 1, file) == 1;
+  for (const BinarySite* site : sites) {
+    const int32_t location[2] = {site->priority, site->line};
+    is_written = is_written &&
+                 fwrite(location, sizeof(location), 1, file) == 1 &&
+                 WriteString(site->file, file) &&
+                 WriteString(site->format, file);
+  }
+  is_written =
+      is_written &&
+      fwrite(&record_count, sizeof(record_count), 1, file) == 1 &&
+      fwrite(records.data(), sizeof(FileRecord), records.size(), file) ==
+          records.size();
+  if (fclose(file) != 0 || !is_written) {
+    TANGO_LOG(ANDROID_LOG_ERROR, "Could not write the binary log to %s.",
+              path);
+    return false;
+  }
+  return true;
+}
+
+bool BinaryLog::Decode(const char* path, FILE* output) {
+  FILE* file = fopen(path, "rb");
+  if (file == nullptr) {
+    return false;
+  }
+  struct Site {
+    int32_t priority;
+    int32_t line;
+    std::string file;
+    std::string format;
+  };
+  uint32_t magic = 0;
+  uint32_t site_count = 0;
+  bool is_read = fread(&magic, sizeof(magic), 1, file) == 1 &&
+                 magic == kFileMagic &&
+                 fread(&site_count, sizeof(site_count), 1, file) == 1;
+  std::vector<Site> sites(is_read ? site_count : 0);
+  for (Site& site : sites) {
+    int32_t location[2];
+    is_read = is_read && fread(location, sizeof(location), 1, file) == 1 &&
+              ReadString(file, &site.file) && ReadString(file, &site.format);
+    site.priority = location[0];
+    site.line = location[1];
+  }
+  uint32_t record_count = 0;
+  is_read = is_read &&
+            fread(&record_count, sizeof(record_count), 1, file) == 1;
+  std::string line;
+  for (uint32_t i = 0; is_read && i < record_count; ++i) {
+    FileRecord record;
+    if (fread(&record, sizeof(record), 1, file) != 1 ||
+        record.site >= site_count ||
+        record.argument_count > static_cast<uint32_t>(kMaxArguments)) {
+      is_read = false;
+      break;
+    }
+    const Site& site = sites[record.site];
+    const int priority = site.priority;
+    const char letter =
+        priority >= 0 && priority < static_cast<int>(sizeof(kPriorityLetters))
+            ? kPriorityLetters[priority]
+            : '?';
+    // Only the file name of the path.
+    const size_t slash = site.file.rfind('/');
+    line.clear();
+    FormatRecord(site.format, record, &line);
+    fprintf(output, "%.6f %c %s:%d %s\n", record.time * 1e-9, letter,
+            site.file.c_str() + (slash == std::string::npos ? 0 : slash + 1),
+            site.line, line.c_str());
+  }
+  fclose(file);
+  return is_read;
+}
+}  // namespace log
+}  // namespace tango_gl
@@ -0,0 +1,387 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-gl/marker_store.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "tango-gl/camera_block.h"
+#include "tango-gl/gl_state.h"
+#include "tango-gl/render_statistics.h"
+#include "tango-gl/shaders.h"
+
+namespace {
+// Floats per instance: model matrix, then color.
+const size_t kInstanceFloats = 16 + 4;
+
+const char* kModelAttributes[4] = {"model0", "model1", "model2", "model3"};
+
+const GLvoid* FloatOffset(size_t offset) {
+  return reinterpret_cast<const GLvoid*>(offset * sizeof(GLfloat));
+}
+}  // namespace
+
+namespace tango_gl {
+
+MarkerStore::MarkerStore(size_t capacity)
+    : geometry_(NULL),
+      geometry_radius_(0.0f),
+      count_(0),
+      gl_initialized_(false),
+      program_(NULL),
+      shaded_program_(NULL),
+      draw_arrays_instanced_(NULL),
+      draw_elements_instanced_(NULL),
+      vertex_attrib_divisor_(NULL) {
+  x_.reserve(capacity);
+  y_.reserve(capacity);
+  z_.reserve(capacity);
+  scales_.reserve(capacity);
+  rotations_.reserve(capacity);
+  colors_.reserve(capacity);
+  flags_.reserve(capacity);
+  free_markers_.reserve(capacity);
+  in_view_.reserve(capacity);
+  drawn_markers_.reserve(capacity);
+  instances_.reserve(capacity * kInstanceFloats);
+}
+
+void MarkerStore::SetGeometry(const Mesh* geometry) {
+  geometry_ = geometry;
+  geometry_radius_ = 0.0f;
+  if (geometry == NULL) {
+    return;
+  }
+  const std::vector<GLfloat>& vertices = geometry->vertices_;
+  float squared_radius = 0.0f;
+  for (size_t i = 0; i + 2 < vertices.size(); i += 3) {
+    squared_radius = std::max(
+        squared_radius, vertices[i] * vertices[i] +
+                            vertices[i + 1] * vertices[i + 1] +
+                            vertices[i + 2] * vertices[i + 2]);
+  }
+  geometry_radius_ = std::sqrt(squared_radius);
+}
+
+uint32_t MarkerStore::Add(const glm::vec3& position, const glm::quat& rotation,
+                          float scale, const Color& color) {
+  uint32_t marker;
+  if (!free_markers_.empty()) {
+    marker = free_markers_.back();
+    free_markers_.pop_back();
+  } else {
+    marker = static_cast<uint32_t>(flags_.size());
+    x_.push_back(0.0f);
+    y_.push_back(0.0f);
+    z_.push_back(0.0f);
+    scales_.push_back(0.0f);
+    rotations_.push_back(glm::quat());
+    colors_.push_back(glm::vec4(0.0f));
+    flags_.push_back(0);
+  }
+  flags_[marker] = kAlive | kVisible;
+  SetPosition(marker, position);
+  SetRotation(marker, rotation);
+  SetScale(marker, scale);
+  SetColor(marker, color, 1.0f);
+  ++count_;
+  return marker;
+}
+
+void MarkerStore::Remove(uint32_t marker) {
+  if (marker >= flags_.size() || (flags_[marker] & kAlive) == 0) {
+    return;
+  }
+  flags_[marker] = 0;
+  free_markers_.push_back(marker);
+  --count_;
+}
+
+void MarkerStore::Clear() {
+  x_.clear();
+  y_.clear();
+  z_.clear();
+  scales_.clear();
+  rotations_.clear();
+  colors_.clear();
+  flags_.clear();
+  free_markers_.clear();
+  drawn_markers_.clear();
+  count_ = 0;
+}
+
+void MarkerStore::SetPosition(uint32_t marker, const glm::vec3& position) {
+  x_[marker] = position.x;
+  y_[marker] = position.y;
+  z_[marker] = position.z;
+}
+
+void MarkerStore::SetRotation(uint32_t marker, const glm::quat& rotation) {
+  rotations_[marker] = rotation;
+}
+
+void MarkerStore::SetScale(uint32_t marker, float scale) {
+  scales_[marker] = scale;
+}
+
+void MarkerStore::SetColor(uint32_t marker, const Color& color, float alpha) {
+  colors_[marker] = glm::vec4(color.r, color.g, color.b, alpha);
+}
+
+void MarkerStore::SetVisible(uint32_t marker, bool visible) {
+  if (visible) {
+    flags_[marker] |= kVisible;
+  } else {
+    flags_[marker] &= ~kVisible;
+  }
+}
+
+void MarkerStore::DeleteGlResources() {
+  instance_buffer_.DeleteGlResources();
+  InvalidateGlResources();
+}
+
+void MarkerStore::InvalidateGlResources() {
+  instance_buffer_.InvalidateGlResources();
+  gl_initialized_ = false;
+  program_ = NULL;
+  shaded_program_ = NULL;
+  draw_arrays_instanced_ = NULL;
+  draw_elements_instanced_ = NULL;
+  vertex_attrib_divisor_ = NULL;
+}
+
+void MarkerStore::InitializeGl() {
+  if (gl_initialized_) {
+    return;
+  }
+  gl_initialized_ = true;
+  program_ =
+      util::GetSharedProgram(shaders::GetInstancedVertexShader().c_str(),
+                             shaders::GetBasicFragmentShader().c_str());
+  shaded_program_ = util::GetSharedProgram(
+      shaders::GetInstancedShadedVertexShader().c_str(),
+      shaders::GetBasicFragmentShader().c_str());
+
+  const util::GlCapabilities& gl = util::GetGlCapabilities();
+  draw_arrays_instanced_ = gl.draw_arrays_instanced;
+  draw_elements_instanced_ = gl.draw_elements_instanced;
+  vertex_attrib_divisor_ = gl.vertex_attrib_divisor;
+}
+
+void MarkerStore::Cull(const ViewFrustum& frustum) {
+  const size_t marker_count = flags_.size();
+  in_view_.assign(marker_count, 0);
+  // One plane at a time over every marker: a plain loop over the arrays,
+  // without branches, which becomes NEON or SSE code. The planes are not
+  // normalized, so the radius is scaled by the length of their normal.
+  for (int i = 0; i < 6; ++i) {
+    const glm::vec4& plane = frustum.GetPlane(i);
+    const float a = plane.x;
+    const float b = plane.y;
+    const float c = plane.z;
+    const float d = plane.w;
+    const float radius =
+        geometry_radius_ * std::sqrt(a * a + b * b + c * c);
+    const float* x = x_.data();
+    const float* y = y_.data();
+    const float* z = z_.data();
+    const float* scales = scales_.data();
+    uint8_t* in_view = in_view_.data();
+    for (size_t marker = 0; marker < marker_count; ++marker) {
+      const float distance = a * x[marker] + b * y[marker] + c * z[marker] + d;
+      in_view[marker] |= distance < -radius * scales[marker] ? 1 : 0;
+    }
+  }
+  // in_view_ holds 1 for the markers outside of a plane at this point.
+  const uint8_t drawn_flags = kAlive | kVisible;
+  drawn_markers_.clear();
+  for (size_t marker = 0; marker < marker_count; ++marker) {
+    if (in_view_[marker] == 0 &&
+        (flags_[marker] & drawn_flags) == drawn_flags) {
+      drawn_markers_.push_back(static_cast<uint32_t>(marker));
+    }
+  }
+}
+
+void MarkerStore::GatherInstances() {
+  instances_.resize(drawn_markers_.size() * kInstanceFloats);
+  GLfloat* instance = instances_.data();
+  for (uint32_t marker : drawn_markers_) {
+    // The model matrix is translation * rotation * scale, as Transform's.
+    const glm::mat3 rotation =
+        glm::mat3_cast(rotations_[marker]) * scales_[marker];
+    for (int column = 0; column < 3; ++column) {
+      instance[column * 4 + 0] = rotation[column].x;
+      instance[column * 4 + 1] = rotation[column].y;
+      instance[column * 4 + 2] = rotation[column].z;
+      instance[column * 4 + 3] = 0.0f;
+    }
+    instance[12] = x_[marker];
+    instance[13] = y_[marker];
+    instance[14] = z_[marker];
+    instance[15] = 1.0f;
+    const glm::vec4& color = colors_[marker];
+    instance[16] = color.r;
+    instance[17] = color.g;
+    instance[18] = color.b;
+    instance[19] = color.a;
+    instance += kInstanceFloats;
+  }
+}
+
+void MarkerStore::Render(const glm::mat4& projection_mat,
+                         const glm::mat4& view_mat) {
+  drawn_markers_.clear();
+  if (geometry_ == NULL || geometry_->vertices_.empty() || count_ == 0) {
+    return;
+  }
+  InitializeGl();
+  Cull(ViewFrustum(projection_mat, view_mat));
+  if (drawn_markers_.empty()) {
+    return;
+  }
+  GatherInstances();
+
+  const bool lighting = geometry_->is_lighting_on_;
+  const util::SharedProgram* program = lighting ? shaded_program_ : program_;
+  if (program == NULL) {
+    return;
+  }
+  GlState::UseProgram(program->GetId());
+  const CameraBlock& camera = GetCameraBlock(projection_mat, view_mat);
+  if (!IsCameraUploaded(program->GetId(), camera)) {
+    glUniformMatrix4fv(program->GetUniformLocation("vp"), 1, GL_FALSE,
+                       glm::value_ptr(camera.view_projection));
+    if (lighting) {
+      glUniformMatrix4fv(program->GetUniformLocation("view"), 1, GL_FALSE,
+                         glm::value_ptr(camera.view));
+    }
+  }
+  if (lighting) {
+    const glm::vec3 light_direction =
+        glm::mat3(view_mat) * geometry_->light_direction_;
+    glUniform3fv(program->GetUniformLocation("lightVec"), 1,
+                 glm::value_ptr(light_direction));
+  }
+
+  // The geometry is drawn from the vertex buffers of the mesh.
+  geometry_->UpdateVertexBuffers();
+  const GLint attrib_vertices = program->GetAttribLocation("vertex");
+  const GLint attrib_normals = program->GetAttribLocation("normal");
+  GlState::BindBuffer(GL_ARRAY_BUFFER, geometry_->vertex_buffer_);
+  glEnableVertexAttribArray(attrib_vertices);
+  glVertexAttribPointer(attrib_vertices, 3, GL_FLOAT, GL_FALSE,
+                        geometry_->buffer_vertex_stride_, nullptr);
+  if (lighting) {
+    glEnableVertexAttribArray(attrib_normals);
+    glVertexAttribPointer(attrib_normals, 3, GL_FLOAT, GL_FALSE,
+                          geometry_->buffer_vertex_stride_,
+                          reinterpret_cast<const GLvoid*>(
+                              geometry_->buffer_normal_offset_));
+  }
+  GlState::BindBuffer(GL_ARRAY_BUFFER, 0);
+  if (geometry_->buffer_index_count_ > 0) {
+    GlState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, geometry_->index_buffer_);
+  }
+
+  if (draw_arrays_instanced_ != NULL) {
+    RenderInstanced(*program);
+  } else {
+    RenderSeparately(*program);
+  }
+
+  if (geometry_->buffer_index_count_ > 0) {
+    GlState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+  }
+  if (lighting) {
+    glDisableVertexAttribArray(attrib_normals);
+  }
+  glDisableVertexAttribArray(attrib_vertices);
+  util::CheckGlError("MarkerStore::Render");
+}
+
+void MarkerStore::RenderInstanced(const util::SharedProgram& program) {
+  const GLint attrib_color = program.GetAttribLocation("color");
+  GLint attrib_model[4];
+  for (int i = 0; i < 4; ++i) {
+    attrib_model[i] = program.GetAttribLocation(kModelAttributes[i]);
+  }
+
+  instance_buffer_.Update(instances_.data(),
+                          instances_.size() * sizeof(GLfloat));
+  instance_buffer_.Bind();
+  const GLsizei stride = kInstanceFloats * sizeof(GLfloat);
+  for (int i = 0; i < 4; ++i) {
+    glEnableVertexAttribArray(attrib_model[i]);
+    glVertexAttribPointer(attrib_model[i], 4, GL_FLOAT, GL_FALSE, stride,
+                          FloatOffset(i * 4));
+    vertex_attrib_divisor_(attrib_model[i], 1);
+  }
+  glEnableVertexAttribArray(attrib_color);
+  glVertexAttribPointer(attrib_color, 4, GL_FLOAT, GL_FALSE, stride,
+                        FloatOffset(16));
+  vertex_attrib_divisor_(attrib_color, 1);
+  GlState::BindBuffer(GL_ARRAY_BUFFER, 0);
+
+  const GLsizei instance_count = static_cast<GLsizei>(drawn_markers_.size());
+  if (geometry_->buffer_index_count_ > 0) {
+    draw_elements_instanced_(geometry_->render_mode_,
+                             geometry_->buffer_index_count_,
+                             geometry_->buffer_index_type_, nullptr,
+                             instance_count);
+  } else {
+    draw_arrays_instanced_(geometry_->render_mode_, 0,
+                           geometry_->buffer_vertex_count_, instance_count);
+  }
+
+  for (int i = 0; i < 4; ++i) {
+    vertex_attrib_divisor_(attrib_model[i], 0);
+    glDisableVertexAttribArray(attrib_model[i]);
+  }
+  vertex_attrib_divisor_(attrib_color, 0);
+  glDisableVertexAttribArray(attrib_color);
+}
+
+void MarkerStore::RenderSeparately(const util::SharedProgram& program) {
+  const GLint attrib_color = program.GetAttribLocation("color");
+  GLint attrib_model[4];
+  for (int i = 0; i < 4; ++i) {
+    attrib_model[i] = program.GetAttribLocation(kModelAttributes[i]);
+  }
+  // The instance attributes are left disabled, and set as constant
+  // attributes before every draw.
+  const GLfloat* instance = instances_.data();
+  for (size_t i = 0; i < drawn_markers_.size(); ++i) {
+    for (int column = 0; column < 4; ++column) {
+      glVertexAttrib4fv(attrib_model[column], instance + column * 4);
+    }
+    glVertexAttrib4fv(attrib_color, instance + 16);
+    if (geometry_->buffer_index_count_ > 0) {
+      CountDraw(geometry_->buffer_index_count_);
+      glDrawElements(geometry_->render_mode_, geometry_->buffer_index_count_,
+                     geometry_->buffer_index_type_, nullptr);
+    } else {
+      CountDraw(geometry_->buffer_vertex_count_);
+      glDrawArrays(geometry_->render_mode_, 0,
+                   geometry_->buffer_vertex_count_);
+    }
+    instance += kInstanceFloats;
+  }
+}
+
+}  // namespace tango_gl
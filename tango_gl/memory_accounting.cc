@@ -0,0 +1,207 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-gl/memory_accounting.h"
+
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+
+namespace {
+// GLES 3.0 formats and types the GLES2 headers do not declare.
+const GLenum kRed = 0x1903;
+const GLenum kRg = 0x8227;
+const GLenum kR8 = 0x8229;
+const GLenum kRg8 = 0x822B;
+const GLenum kR16f = 0x822D;
+const GLenum kR32f = 0x822E;
+const GLenum kRgba8 = 0x8058;
+const GLenum kHalfFloat = 0x140B;
+const GLenum kHalfFloatOes = 0x8D61;
+
+const char* const kTagNames[tango_gl::kMemoryTagCount] = {
+    "texture",     "streaming_texture", "vertex_buffer", "trajectory",
+    "depth_image", "camera_image",      "buffer_pool",   "other"};
+
+struct Counter {
+  std::atomic<int64_t> bytes;
+  std::atomic<int64_t> peak_bytes;
+  std::atomic<int32_t> allocation_count;
+};
+
+// Zero initialized before any constructor runs, so that accounts of static
+// objects can use them.
+Counter g_counters[tango_gl::kMemoryTagCount][tango_gl::kMemoryDomainCount];
+Counter g_totals[tango_gl::kMemoryDomainCount];
+
+void RaisePeak(Counter* counter, int64_t bytes) {
+  int64_t peak = counter->peak_bytes.load(std::memory_order_relaxed);
+  while (bytes > peak &&
+         !counter->peak_bytes.compare_exchange_weak(
+             peak, bytes, std::memory_order_relaxed)) {
+  }
+}
+
+void Add(Counter* counter, int64_t delta, int32_t allocation_delta) {
+  const int64_t bytes =
+      counter->bytes.fetch_add(delta, std::memory_order_relaxed) + delta;
+  if (allocation_delta != 0) {
+    counter->allocation_count.fetch_add(allocation_delta,
+                                        std::memory_order_relaxed);
+  }
+  if (delta > 0) {
+    RaisePeak(counter, bytes);
+  }
+}
+
+tango_gl::MemoryUsage Read(const Counter& counter) {
+  tango_gl::MemoryUsage usage;
+  usage.bytes = counter.bytes.load(std::memory_order_relaxed);
+  usage.peak_bytes = counter.peak_bytes.load(std::memory_order_relaxed);
+  usage.allocation_count =
+      counter.allocation_count.load(std::memory_order_relaxed);
+  return usage;
+}
+
+void AppendUsage(const char* name, const tango_gl::MemoryUsage& cpu,
+                 const tango_gl::MemoryUsage& gpu, std::string* report) {
+  char entry[256];
+  snprintf(entry, sizeof(entry),
+           "\"%s\":{\"cpu_bytes\":%" PRId64 ",\"cpu_peak_bytes\":%" PRId64
+           ",\"gpu_bytes\":%" PRId64 ",\"gpu_peak_bytes\":%" PRId64
+           ",\"allocations\":%d}",
+           name, cpu.bytes, cpu.peak_bytes, gpu.bytes, gpu.peak_bytes,
+           cpu.allocation_count + gpu.allocation_count);
+  report->append(entry);
+}
+
+size_t BytesPerPixel(GLenum format, GLenum type) {
+  size_t components;
+  switch (format) {
+    case GL_ALPHA:
+    case GL_LUMINANCE:
+    case GL_DEPTH_COMPONENT:
+    case kRed:
+    case kR8:
+      components = 1;
+      break;
+    case GL_LUMINANCE_ALPHA:
+    case kRg:
+    case kRg8:
+      components = 2;
+      break;
+    case GL_RGB:
+      components = 3;
+      break;
+    case kR16f:
+      return 2;
+    case kR32f:
+      return 4;
+    case kRgba8:
+    default:
+      components = 4;
+      break;
+  }
+  switch (type) {
+    case GL_UNSIGNED_SHORT_5_6_5:
+    case GL_UNSIGNED_SHORT_4_4_4_4:
+    case GL_UNSIGNED_SHORT_5_5_5_1:
+      return 2;
+    case GL_UNSIGNED_SHORT:
+    case kHalfFloat:
+    case kHalfFloatOes:
+      return components * 2;
+    case GL_FLOAT:
+    case GL_UNSIGNED_INT:
+      return components * 4;
+    default:
+      return components;
+  }
+}
+}  // namespace
+
+namespace tango_gl {
+
+MemoryAccount::MemoryAccount(MemoryTag tag, MemoryDomain domain)
+    : tag_(tag), domain_(domain), bytes_(0) {}
+
+MemoryAccount::MemoryAccount(const MemoryAccount& other)
+    : tag_(other.tag_), domain_(other.domain_), bytes_(0) {}
+
+MemoryAccount& MemoryAccount::operator=(const MemoryAccount&) { return *this; }
+
+MemoryAccount::~MemoryAccount() { Set(0); }
+
+void MemoryAccount::Set(size_t bytes) {
+  if (bytes == bytes_) {
+    return;
+  }
+  const int64_t delta =
+      static_cast<int64_t>(bytes) - static_cast<int64_t>(bytes_);
+  const int32_t allocation_delta =
+      (bytes != 0 ? 1 : 0) - (bytes_ != 0 ? 1 : 0);
+  bytes_ = bytes;
+  Add(&g_counters[tag_][domain_], delta, allocation_delta);
+  Add(&g_totals[domain_], delta, allocation_delta);
+}
+
+MemoryUsage GetMemoryUsage(MemoryTag tag, MemoryDomain domain) {
+  return Read(g_counters[tag][domain]);
+}
+
+MemoryUsage GetTotalMemoryUsage(MemoryDomain domain) {
+  return Read(g_totals[domain]);
+}
+
+const char* GetMemoryTagName(MemoryTag tag) { return kTagNames[tag]; }
+
+void ResetMemoryPeaks() {
+  for (int domain = 0; domain < kMemoryDomainCount; ++domain) {
+    for (int tag = 0; tag < kMemoryTagCount; ++tag) {
+      Counter& counter = g_counters[tag][domain];
+      counter.peak_bytes.store(counter.bytes.load(std::memory_order_relaxed),
+                               std::memory_order_relaxed);
+    }
+    g_totals[domain].peak_bytes.store(
+        g_totals[domain].bytes.load(std::memory_order_relaxed),
+        std::memory_order_relaxed);
+  }
+}
+
+std::string FormatMemoryReport() {
+  std::string report = "{";
+  for (int i = 0; i < kMemoryTagCount; ++i) {
+    const MemoryTag tag = static_cast<MemoryTag>(i);
+    AppendUsage(GetMemoryTagName(tag), GetMemoryUsage(tag, kMemoryCpu),
+                GetMemoryUsage(tag, kMemoryGpu), &report);
+    report.append(",");
+  }
+  AppendUsage("total", GetTotalMemoryUsage(kMemoryCpu),
+              GetTotalMemoryUsage(kMemoryGpu), &report);
+  report.append("}");
+  return report;
+}
+
+size_t EstimateTextureBytes(GLsizei width, GLsizei height, GLenum format,
+                            GLenum type, bool has_mipmaps) {
+  if (width <= 0 || height <= 0) {
+    return 0;
+  }
+  const size_t bytes = static_cast<size_t>(width) * height *
+                       BytesPerPixel(format, type);
+  return has_mipmaps ? bytes + bytes / 3 : bytes;
+}
+}  // namespace tango_gl
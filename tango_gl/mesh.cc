@@ -15,36 +15,54 @@
  */
 
 #include "tango-gl/mesh.h"
+
+#include <algorithm>
+
+#include "tango-gl/gl_state.h"
+#include "tango-gl/render_statistics.h"
 #include "tango-gl/shaders.h"
+#include "tango-gl/tracing.h"
 
 namespace tango_gl {
-Mesh::Mesh() { render_mode_ = GL_TRIANGLES; }
-Mesh::Mesh(GLenum render_mode) { render_mode_ = render_mode; }
+namespace {
+// Write a range of the bound buffer, without syncing with the pending draws
+// when |is_unused| says none of them reads it.
+void WriteBufferRange(GLenum target, GLintptr offset, GLsizeiptr size,
+                      const void* data, bool is_unused) {
+  if (is_unused) {
+    util::WriteUnusedBufferRange(target, offset, size, data);
+  } else {
+    glBufferSubData(target, offset, size, data);
+  }
+}
+}  // namespace
+
+Mesh::Mesh() : Mesh(GL_TRIANGLES) {}
+Mesh::Mesh(GLenum render_mode)
+    : bounding_box_(NULL),
+      is_bounding_box_on_(false),
+      is_cached_mesh_(false),
+      array_vertex_capacity_(0),
+      array_face_capacity_(0),
+      array_written_vertex_count_(0),
+      array_written_face_count_(0),
+      lod_screen_size_(kDefaultLodScreenSize) {
+  render_mode_ = render_mode;
+}
+Mesh::Mesh(const Arrays& arrays) : Mesh(GL_TRIANGLES) {
+  SetShader(arrays.normals != nullptr);
+  SetVertexBuffers(arrays);
+}
 
 void Mesh::SetShader() {
-  DrawableObject::SetShader();
-  // Default mode set to no lighting.
-  is_lighting_on_ = false;
+  SetProgram<false>();
   // Default mode set to without bounding box detection.
   is_bounding_box_on_ = false;
 }
 
 void Mesh::SetShader(bool is_lighting_on) {
   if (is_lighting_on) {
-    shader_program_ =
-        util::CreateProgram(shaders::GetShadedVertexShader().c_str(),
-                            shaders::GetBasicFragmentShader().c_str());
-    if (!shader_program_) {
-      LOGE("Could not create program.");
-    }
-    uniform_mvp_mat_ = glGetUniformLocation(shader_program_, "mvp");
-    uniform_mv_mat_ = glGetUniformLocation(shader_program_, "mv");
-    uniform_light_vec_ = glGetUniformLocation(shader_program_, "lightVec");
-    uniform_color_ = glGetUniformLocation(shader_program_, "color");
-
-    attrib_vertices_ = glGetAttribLocation(shader_program_, "vertex");
-    attrib_normals_ = glGetAttribLocation(shader_program_, "normal");
-    is_lighting_on_ = true;
+    SetProgram<true>();
     // Set a defualt direction for directional light.
     light_direction_ = glm::vec3(-1.0f, -3.0f, -1.0f);
     light_direction_ = glm::normalize(light_direction_);
@@ -53,7 +71,37 @@ void Mesh::SetShader(bool is_lighting_on) {
   }
 }
 
+template <bool kIsLit>
+void Mesh::SetProgram() {
+  is_lighting_on_ = kIsLit;
+  const util::SharedProgram* program =
+      util::GetSharedProgram(shaders::GetMeshVertexShader(kIsLit).c_str(),
+                             shaders::GetBasicFragmentShader().c_str());
+  if (!program) {
+    LOGE("Could not create program.");
+    shader_program_ = 0;
+    return;
+  }
+  shader_program_ = program->GetId();
+  uniform_mvp_mat_ = program->GetUniformLocation("mvp");
+  uniform_color_ = program->GetUniformLocation("color");
+  attrib_vertices_ = program->GetAttribLocation("vertex");
+  if (kIsLit) {
+    uniform_mv_mat_ = program->GetUniformLocation("mv");
+    uniform_light_vec_ = program->GetUniformLocation("lightVec");
+    attrib_normals_ = program->GetAttribLocation("normal");
+  }
+}
+
 void Mesh::SetBoundingBox() {
+  // A mesh cache already knows its bounds.
+  if (is_cached_mesh_ && vertices_.empty()) {
+    is_bounding_box_on_ = true;
+    delete bounding_box_;
+    bounding_box_ = new BoundingBox(buffer_bounding_min_, buffer_bounding_max_);
+    oriented_bounding_box_ = OrientedBoundingBox(*bounding_box_);
+    return;
+  }
   // Traverse all the vertices to define an axis-aligned
   // bounding box for this mesh, needs to be called after SetVertices().
   if (vertices_.size() == 0) {
@@ -61,13 +109,292 @@ void Mesh::SetBoundingBox() {
     return;
   }
   is_bounding_box_on_ = true;
+  delete bounding_box_;
   bounding_box_ = new BoundingBox(vertices_);
+  oriented_bounding_box_ = OrientedBoundingBox(vertices_);
 }
 
 void Mesh::SetLightDirection(const glm::vec3& light_direction) {
   light_direction_ = light_direction;
 }
 
+void Mesh::SetVertexBuffers(const MappedMesh& mesh) {
+  UploadMesh(mesh.GetVertexData(), mesh.GetVertexCount(),
+             mesh.GetVertexStride(), mesh.HasNormals(), mesh.GetIndexData(),
+             mesh.GetIndexCount(), mesh.GetIndexType(), mesh.GetBoundingMin(),
+             mesh.GetBoundingMax());
+}
+
+void Mesh::SetVertexBuffers(const std::vector<GLfloat>& vertices,
+                            bool has_normals,
+                            const std::vector<GLuint>& indices) {
+  SetVertexBuffers(vertices, has_normals, indices,
+                   std::vector<std::vector<GLuint>>());
+}
+
+void Mesh::SetVertexBuffers(
+    const std::vector<GLfloat>& vertices, bool has_normals,
+    const std::vector<GLuint>& indices,
+    const std::vector<std::vector<GLuint>>& lod_indices) {
+  const size_t floats_per_vertex = has_normals ? 6 : 3;
+  glm::vec3 bounding_min(0.0f);
+  glm::vec3 bounding_max(0.0f);
+  for (size_t i = 0; i + 3 <= vertices.size(); i += floats_per_vertex) {
+    const glm::vec3 position(vertices[i], vertices[i + 1], vertices[i + 2]);
+    bounding_min = i == 0 ? position : glm::min(bounding_min, position);
+    bounding_max = i == 0 ? position : glm::max(bounding_max, position);
+  }
+  const size_t vertex_count = vertices.size() / floats_per_vertex;
+  const bool is_ushort = vertex_count <= mesh_indices::kMaxChunkVertexCount;
+
+  // The levels follow the full mesh in the index buffer. A split mesh has no
+  // ranges to draw them from.
+  const bool has_lods =
+      !lod_indices.empty() && !indices.empty() &&
+      (is_ushort || util::IsGlExtensionSupported("GL_OES_element_index_uint"));
+  if (!lod_indices.empty() && !has_lods) {
+    LOGI("Mesh::SetVertexBuffers, drawing without levels of detail.");
+  }
+  std::vector<Lod> lods;
+  std::vector<GLuint> all_indices;
+  if (has_lods) {
+    all_indices = indices;
+    Lod lod = {0, static_cast<GLsizei>(indices.size())};
+    lods.push_back(lod);
+    for (const std::vector<GLuint>& level : lod_indices) {
+      lod.first_index = static_cast<GLsizei>(all_indices.size());
+      lod.index_count = static_cast<GLsizei>(level.size());
+      lods.push_back(lod);
+      all_indices.insert(all_indices.end(), level.begin(), level.end());
+    }
+  }
+  const std::vector<GLuint>& uploaded_indices =
+      has_lods ? all_indices : indices;
+
+  // Halve the index buffer whenever the indices fit in 16 bits.
+  std::vector<GLushort> short_indices;
+  if (is_ushort) {
+    short_indices.assign(uploaded_indices.begin(), uploaded_indices.end());
+  }
+  UploadMesh(vertices.data(), static_cast<GLsizei>(vertex_count),
+             static_cast<GLsizei>(floats_per_vertex * sizeof(GLfloat)),
+             has_normals,
+             is_ushort ? static_cast<const void*>(short_indices.data())
+                       : static_cast<const void*>(uploaded_indices.data()),
+             static_cast<GLsizei>(uploaded_indices.size()),
+             is_ushort ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, bounding_min,
+             bounding_max);
+  if (has_lods && buffer_index_count_ > 0) {
+    lods_.swap(lods);
+    buffer_index_count_ = lods_[0].index_count;
+  }
+}
+
+void Mesh::SetVertexBuffers(const Arrays& arrays) {
+  // Sized to the mesh, grown by later updates.
+  array_vertex_capacity_ = 0;
+  UpdateVertexBufferRange(arrays, 0, 0);
+}
+
+void Mesh::UpdateVertexBufferRange(const Arrays& arrays,
+                                   GLsizei first_vertex, GLsizei first_face) {
+  TANGO_TRACE_SCOPE("Mesh::UpdateVertexBufferRange");
+  const bool has_normals = arrays.normals != nullptr;
+  if (!util::IsGlExtensionSupported("GL_OES_element_index_uint")) {
+    // The vectors path halves or splits the indices, from an interleaved
+    // copy.
+    std::vector<GLfloat> vertices;
+    vertices.reserve(arrays.vertex_count * (has_normals ? 6 : 3));
+    for (GLsizei i = 0; i < arrays.vertex_count; ++i) {
+      vertices.insert(vertices.end(), arrays.vertices[i],
+                      arrays.vertices[i] + 3);
+      if (has_normals) {
+        vertices.insert(vertices.end(), arrays.normals[i],
+                        arrays.normals[i] + 3);
+      }
+    }
+    const GLuint* faces = arrays.face_count > 0 ? arrays.faces[0] : nullptr;
+    SetVertexBuffers(vertices, has_normals,
+                     std::vector<GLuint>(faces, faces + 3 * arrays.face_count));
+    return;
+  }
+
+  // Everything is uploaded again into new buffers when the arrays outgrow
+  // them or when they hold other vertices.
+  const bool is_allocated =
+      array_vertex_capacity_ > 0 && !vertex_buffers_dirty_ &&
+      buffer_has_normals_ == has_normals &&
+      arrays.vertex_count <= array_vertex_capacity_ &&
+      arrays.face_count <= array_face_capacity_;
+  if (!is_allocated) {
+    // A first upload, of SetVertexBuffers(), is of the size of the mesh.
+    const bool is_growing = array_vertex_capacity_ > 0;
+    AllocateArrayBuffers(
+        is_growing ? std::max(arrays.vertex_count, 2 * array_vertex_capacity_)
+                   : arrays.vertex_count,
+        is_growing ? std::max(arrays.face_count, 2 * array_face_capacity_)
+                   : arrays.face_count,
+        has_normals);
+    first_vertex = 0;
+    first_face = 0;
+  }
+  first_vertex = std::max<GLsizei>(first_vertex, 0);
+  first_face = std::max<GLsizei>(first_face, 0);
+
+  const GLsizei position_size = sizeof(arrays.vertices[0]);
+  if (first_vertex < arrays.vertex_count) {
+    const GLsizei changed_size =
+        (arrays.vertex_count - first_vertex) * position_size;
+    GlState::BindBuffer(GL_ARRAY_BUFFER, vertex_buffer_);
+    CountUpload(has_normals ? 2 * changed_size : changed_size);
+    // Appended vertices are written without syncing with the draws of the
+    // earlier ones.
+    const bool is_unused = first_vertex >= array_written_vertex_count_;
+    WriteBufferRange(GL_ARRAY_BUFFER, first_vertex * position_size,
+                     changed_size, arrays.vertices[first_vertex], is_unused);
+    if (has_normals) {
+      WriteBufferRange(GL_ARRAY_BUFFER,
+                       buffer_normal_offset_ + first_vertex * position_size,
+                       changed_size, arrays.normals[first_vertex], is_unused);
+    }
+    GlState::BindBuffer(GL_ARRAY_BUFFER, 0);
+    array_written_vertex_count_ =
+        std::max(array_written_vertex_count_, arrays.vertex_count);
+
+    glm::vec3 bounding_min = first_vertex == 0
+                                 ? glm::make_vec3(arrays.vertices[0])
+                                 : buffer_bounding_min_;
+    glm::vec3 bounding_max =
+        first_vertex == 0 ? bounding_min : buffer_bounding_max_;
+    for (GLsizei i = first_vertex; i < arrays.vertex_count; ++i) {
+      const glm::vec3 position = glm::make_vec3(arrays.vertices[i]);
+      bounding_min = glm::min(bounding_min, position);
+      bounding_max = glm::max(bounding_max, position);
+    }
+    buffer_bounding_min_ = bounding_min;
+    buffer_bounding_max_ = bounding_max;
+  }
+  if (first_face < arrays.face_count) {
+    const GLsizei face_size = sizeof(arrays.faces[0]);
+    GlState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer_);
+    CountUpload((arrays.face_count - first_face) * face_size);
+    WriteBufferRange(GL_ELEMENT_ARRAY_BUFFER, first_face * face_size,
+                     (arrays.face_count - first_face) * face_size,
+                     arrays.faces[first_face],
+                     first_face >= array_written_face_count_);
+    GlState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    array_written_face_count_ =
+        std::max(array_written_face_count_, arrays.face_count);
+  }
+  buffer_vertex_count_ = arrays.vertex_count;
+  buffer_index_count_ = 3 * arrays.face_count;
+  util::CheckGlError("Mesh::UpdateVertexBufferRange");
+}
+
+void Mesh::AllocateArrayBuffers(GLsizei vertex_capacity,
+                                GLsizei face_capacity, bool has_normals) {
+  // The buffers now hold the only copy of the vertices.
+  vertices_.clear();
+  normals_.clear();
+  indices_.clear();
+  index_chunks_.clear();
+  lods_.clear();
+
+  const GLsizei position_size = sizeof(GLfloat[3]);
+  const GLsizei vertex_size =
+      vertex_capacity * (has_normals ? 2 : 1) * position_size;
+  if (!vertex_buffer_) {
+    glGenBuffers(1, &vertex_buffer_);
+  }
+  GlState::BindBuffer(GL_ARRAY_BUFFER, vertex_buffer_);
+  glBufferData(GL_ARRAY_BUFFER, vertex_size, nullptr, GL_DYNAMIC_DRAW);
+  GlState::BindBuffer(GL_ARRAY_BUFFER, 0);
+  vertex_buffer_memory_.Set(vertex_size);
+
+  const GLsizei index_size = face_capacity * sizeof(GLuint[3]);
+  if (!index_buffer_) {
+    glGenBuffers(1, &index_buffer_);
+  }
+  GlState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer_);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_size, nullptr, GL_DYNAMIC_DRAW);
+  GlState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+  index_buffer_memory_.Set(index_size);
+
+  // The normals follow the positions of every vertex the buffer can hold.
+  buffer_vertex_stride_ = position_size;
+  buffer_normal_offset_ = vertex_capacity * position_size;
+  buffer_has_normals_ = has_normals;
+  buffer_index_type_ = GL_UNSIGNED_INT;
+  vertex_buffer_usage_ = GL_DYNAMIC_DRAW;
+  vertex_buffers_dirty_ = false;
+  is_cached_mesh_ = true;
+  array_vertex_capacity_ = vertex_capacity;
+  array_face_capacity_ = face_capacity;
+  array_written_vertex_count_ = 0;
+  array_written_face_count_ = 0;
+}
+
+void Mesh::UploadMesh(const void* vertex_data, GLsizei vertex_count,
+                      GLsizei vertex_stride, bool has_normals,
+                      const void* index_data, GLsizei index_count,
+                      GLenum index_type, const glm::vec3& bounding_min,
+                      const glm::vec3& bounding_max) {
+  const bool is_split =
+      index_count > 0 && index_type == GL_UNSIGNED_INT &&
+      !util::IsGlExtensionSupported("GL_OES_element_index_uint");
+  if (is_split && render_mode_ != GL_TRIANGLES) {
+    LOGE("Mesh::SetVertexBuffers, 32 bit indices are not supported.");
+    return;
+  }
+  // The buffers now hold the only copy of the vertices.
+  SetVertexBuffersDirty();
+  array_vertex_capacity_ = 0;
+  vertices_.clear();
+  normals_.clear();
+  indices_.clear();
+  index_chunks_.clear();
+  lods_.clear();
+
+  std::vector<uint8_t> chunk_vertices;
+  std::vector<GLushort> chunk_indices;
+  if (is_split) {
+    mesh_indices::SplitIntoChunks(
+        vertex_data, vertex_count, vertex_stride,
+        static_cast<const GLuint*>(index_data), index_count, &chunk_vertices,
+        &chunk_indices, &index_chunks_);
+    vertex_data = chunk_vertices.data();
+    vertex_count = static_cast<GLsizei>(chunk_vertices.size() / vertex_stride);
+    index_data = chunk_indices.data();
+    index_count = static_cast<GLsizei>(chunk_indices.size());
+    index_type = GL_UNSIGNED_SHORT;
+    LOGI("Mesh::SetVertexBuffers, drawing %d indices in %d chunks.",
+         index_count, static_cast<int>(index_chunks_.size()));
+  }
+  UploadVertexBuffer(vertex_data, vertex_count, vertex_stride);
+
+  buffer_index_count_ = index_count;
+  buffer_index_type_ = index_type;
+  if (buffer_index_count_ > 0) {
+    const GLsizeiptr index_size =
+        index_type == GL_UNSIGNED_INT ? sizeof(GLuint) : sizeof(GLushort);
+    if (!index_buffer_) {
+      glGenBuffers(1, &index_buffer_);
+    }
+    GlState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer_);
+    CountUpload(index_count * index_size);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_count * index_size, index_data,
+                 GL_STATIC_DRAW);
+    GlState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    index_buffer_memory_.Set(index_count * index_size);
+  }
+
+  buffer_has_normals_ = has_normals;
+  is_cached_mesh_ = true;
+  buffer_bounding_min_ = bounding_min;
+  buffer_bounding_max_ = bounding_max;
+  util::CheckGlError("Mesh::SetVertexBuffers");
+}
+
 bool Mesh::IsIntersecting(const Segment& segment) {
   // If there is no bounding box defined based on all vertices,
   // we can not calculate intersection.
@@ -75,46 +402,95 @@ bool Mesh::IsIntersecting(const Segment& segment) {
     LOGE("Mesh::IsIntersecting, bounding box is not available.");
     return false;
   }
-  return bounding_box_->IsIntersecting(segment, GetRotation(),
-                                       GetTransformationMatrix());
+  return oriented_bounding_box_.GetTransformed(GetTransformationMatrix())
+      .IsIntersecting(segment);
 }
 
 void Mesh::Render(const glm::mat4& projection_mat,
                   const glm::mat4& view_mat) const {
-  glUseProgram(shader_program_);
-  glm::mat4 model_mat = GetTransformationMatrix();
-  glm::mat4 mv_mat = view_mat * model_mat;
-  glm::mat4 mvp_mat = projection_mat * mv_mat;
+  // The chunks and levels are of the buffers SetVertices() replaces.
+  if (vertex_buffers_dirty_) {
+    index_chunks_.clear();
+    lods_.clear();
+  }
+  // The upload decides whether there are indices.
+  UpdateVertexBuffers();
+  static const RenderFunction kRenderVariants[2][2] = {
+      {&Mesh::RenderVariant<false, false>, &Mesh::RenderVariant<false, true>},
+      {&Mesh::RenderVariant<true, false>, &Mesh::RenderVariant<true, true>}};
+  (this->*kRenderVariants[is_lighting_on_][buffer_index_count_ > 0])(
+      projection_mat, view_mat);
+}
+
+int Mesh::SelectLod(const glm::mat4& projection_mat,
+                    const glm::mat4& mv_mat) const {
+  // The sphere around the bounds, scaled like the mesh.
+  const glm::vec3 center = 0.5f * (buffer_bounding_min_ + buffer_bounding_max_);
+  const glm::vec3 scale = glm::abs(GetScale());
+  const float radius =
+      0.5f * glm::length(buffer_bounding_max_ - buffer_bounding_min_) *
+      std::max(scale.x, std::max(scale.y, scale.z));
+  const float distance =
+      glm::length(glm::vec3(mv_mat * glm::vec4(center, 1.0f)));
+  if (distance <= radius) {
+    return 0;
+  }
+  // The diameter over the height of the view at that distance.
+  const float screen_size = radius * projection_mat[1][1] / distance;
+  int level = 0;
+  float level_screen_size = lod_screen_size_;
+  while (level + 1 < static_cast<int>(lods_.size()) &&
+         screen_size < level_screen_size) {
+    ++level;
+    level_screen_size *= 0.5f;
+  }
+  return level;
+}
+
+template <bool kIsLit, bool kIsIndexed>
+void Mesh::RenderVariant(const glm::mat4& projection_mat,
+                         const glm::mat4& view_mat) const {
+  GlState::UseProgram(shader_program_);
+  const glm::mat4 mv_mat = view_mat * GetTransformationMatrix();
+  const glm::mat4 mvp_mat = projection_mat * mv_mat;
   glUniformMatrix4fv(uniform_mvp_mat_, 1, GL_FALSE, glm::value_ptr(mvp_mat));
   glUniform4f(uniform_color_, red_, green_, blue_, alpha_);
 
-  if (is_lighting_on_) {
+  if (kIsLit) {
     glUniformMatrix4fv(uniform_mv_mat_, 1, GL_FALSE, glm::value_ptr(mv_mat));
-
-    glEnableVertexAttribArray(attrib_normals_);
-    glVertexAttribPointer(attrib_normals_, 3, GL_FLOAT, GL_FALSE,
-                          3 * sizeof(GLfloat), &normals_[0]);
-    glm::vec3 light_direction = glm::mat3(view_mat) * light_direction_;
+    const glm::vec3 light_direction = glm::mat3(view_mat) * light_direction_;
     glUniform3fv(uniform_light_vec_, 1, glm::value_ptr(light_direction));
   }
 
-  glEnableVertexAttribArray(attrib_vertices_);
-
-  if (!indices_.empty()) {
-    glVertexAttribPointer(attrib_vertices_, 3, GL_FLOAT, GL_FALSE,
-                          3 * sizeof(GLfloat), vertices_.data());
-    glDrawElements(render_mode_, indices_.size(), GL_UNSIGNED_SHORT,
-                   indices_.data());
+  // A lit mesh without normals is drawn with the attribute's constant value.
+  const bool use_normals = kIsLit && buffer_has_normals_;
+  BindVertexAttributes(use_normals);
+  if (kIsIndexed && !lods_.empty()) {
+    const Lod& lod = lods_[SelectLod(projection_mat, mv_mat)];
+    const size_t index_size = buffer_index_type_ == GL_UNSIGNED_INT
+                                  ? sizeof(GLuint)
+                                  : sizeof(GLushort);
+    CountDraw(lod.index_count);
+    glDrawElements(render_mode_, lod.index_count, buffer_index_type_,
+                   reinterpret_cast<const GLvoid*>(lod.first_index *
+                                                   index_size));
+  } else if (kIsIndexed && index_chunks_.empty()) {
+    CountDraw(buffer_index_count_);
+    glDrawElements(render_mode_, buffer_index_count_, buffer_index_type_,
+                   nullptr);
+  } else if (kIsIndexed) {
+    for (const mesh_indices::IndexChunk& chunk : index_chunks_) {
+      PointVertexAttributes(chunk.first_vertex, use_normals);
+      CountDraw(chunk.index_count);
+      glDrawElements(render_mode_, chunk.index_count, GL_UNSIGNED_SHORT,
+                     reinterpret_cast<const GLvoid*>(chunk.first_index *
+                                                     sizeof(GLushort)));
+    }
+    PointVertexAttributes(0, use_normals);
   } else {
-    glVertexAttribPointer(attrib_vertices_, 3, GL_FLOAT, GL_FALSE,
-                          3 * sizeof(GLfloat), &vertices_[0]);
-    glDrawArrays(render_mode_, 0, vertices_.size() / 3);
-  }
-
-  glDisableVertexAttribArray(attrib_vertices_);
-  if (is_lighting_on_) {
-    glDisableVertexAttribArray(attrib_normals_);
+    CountDraw(buffer_vertex_count_);
+    glDrawArrays(render_mode_, 0, buffer_vertex_count_);
   }
-  glUseProgram(0);
+  UnbindVertexAttributes(use_normals);
 }
 }  // namespace tango_gl
@@ -0,0 +1,270 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-gl/mesh_cache.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "tango-gl/mesh_indices.h"
+#include "tango-gl/obj_loader.h"
+
+namespace {
+const char kMagic[4] = {'T', 'G', 'M', 'C'};
+// 2: the triangles are ordered for the vertex cache.
+const uint32_t kVersion = 2;
+// Largest vertex count addressable by GLushort indices.
+const size_t kMaxUshortVertexCount = 65536;
+
+size_t AlignToFour(size_t offset) { return (offset + 3) & ~size_t(3); }
+
+// Fill the size and modification time of |path|, or zeros if there is no
+// such file.
+bool GetSourceStamp(const char* path, int64_t* size, int64_t* mtime) {
+  struct stat file_stat;
+  if (path == NULL || stat(path, &file_stat) != 0) {
+    *size = 0;
+    *mtime = 0;
+    return false;
+  }
+  *size = file_stat.st_size;
+  *mtime = file_stat.st_mtime;
+  return true;
+}
+}  // namespace
+
+namespace tango_gl {
+
+bool mesh_cache::WriteMeshCache(const char* path,
+                                const std::vector<GLfloat>& vertices,
+                                bool has_normals, bool has_tex_coords,
+                                const std::vector<GLuint>& indices,
+                                const char* source_path) {
+  const size_t floats_per_vertex =
+      3 + (has_normals ? 3 : 0) + (has_tex_coords ? 2 : 0);
+  const size_t vertex_count = vertices.size() / floats_per_vertex;
+  if (vertex_count == 0 || vertices.size() % floats_per_vertex != 0) {
+    LOGE("Mesh cache: invalid vertex data");
+    return false;
+  }
+  const bool uint_indices = vertex_count > kMaxUshortVertexCount;
+
+  Header header;
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.flags = (has_normals ? kHasNormals : 0) |
+                 (has_tex_coords ? kHasTexCoords : 0) |
+                 (uint_indices ? kHasUintIndices : 0);
+  header.vertex_count = vertex_count;
+  header.vertex_stride = floats_per_vertex * sizeof(GLfloat);
+  header.index_count = indices.size();
+  for (int i = 0; i < 3; ++i) {
+    header.bounding_min[i] = vertices[i];
+    header.bounding_max[i] = vertices[i];
+  }
+  for (size_t i = 0; i < vertices.size(); i += floats_per_vertex) {
+    for (int j = 0; j < 3; ++j) {
+      const GLfloat value = vertices[i + j];
+      header.bounding_min[j] = std::min(header.bounding_min[j], value);
+      header.bounding_max[j] = std::max(header.bounding_max[j], value);
+    }
+  }
+  GetSourceStamp(source_path, &header.source_size, &header.source_mtime);
+
+  // Halve the index block whenever the indices fit in 16 bits.
+  std::vector<GLushort> short_indices;
+  if (!uint_indices) {
+    short_indices.assign(indices.begin(), indices.end());
+  }
+  const void* index_data =
+      uint_indices ? static_cast<const void*>(indices.data())
+                   : static_cast<const void*>(short_indices.data());
+  const size_t index_bytes =
+      indices.size() * (uint_indices ? sizeof(GLuint) : sizeof(GLushort));
+
+  const std::string temp_path = std::string(path) + ".tmp";
+  FILE* file = fopen(temp_path.c_str(), "wb");
+  if (file == NULL) {
+    LOGE("Mesh cache: failed to create %s", temp_path.c_str());
+    return false;
+  }
+  const size_t vertex_bytes = vertices.size() * sizeof(GLfloat);
+  const size_t vertex_end = sizeof(header) + vertex_bytes;
+  const size_t padding = AlignToFour(vertex_end) - vertex_end;
+  const char zeros[4] = {0, 0, 0, 0};
+  bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                 fwrite(vertices.data(), vertex_bytes, 1, file) == 1 &&
+                 fwrite(zeros, 1, padding, file) == padding;
+  if (written && !indices.empty()) {
+    written = fwrite(index_data, index_bytes, 1, file) == 1;
+  }
+  written = fclose(file) == 0 && written;
+  if (!written || rename(temp_path.c_str(), path) != 0) {
+    LOGE("Mesh cache: failed to write %s", path);
+    unlink(temp_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+MappedMesh::MappedMesh()
+    : mapping_(NULL),
+      mapping_size_(0),
+      header_(NULL),
+      vertex_data_(NULL),
+      index_data_(NULL) {}
+
+MappedMesh::~MappedMesh() { Close(); }
+
+bool MappedMesh::Open(const char* path) {
+  Close();
+
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0 ||
+      static_cast<size_t>(file_stat.st_size) < sizeof(mesh_cache::Header)) {
+    close(fd);
+    return false;
+  }
+  mapping_size_ = file_stat.st_size;
+  mapping_ = mmap(NULL, mapping_size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping keeps the file alive.
+  close(fd);
+  if (mapping_ == MAP_FAILED) {
+    LOGE("Mesh cache: failed to map %s", path);
+    mapping_ = NULL;
+    mapping_size_ = 0;
+    return false;
+  }
+
+  const mesh_cache::Header* header =
+      static_cast<const mesh_cache::Header*>(mapping_);
+  const size_t vertex_offset = sizeof(mesh_cache::Header);
+  const size_t vertex_bytes =
+      static_cast<size_t>(header->vertex_count) * header->vertex_stride;
+  const size_t index_offset = AlignToFour(vertex_offset + vertex_bytes);
+  const size_t index_size = (header->flags & mesh_cache::kHasUintIndices)
+                                ? sizeof(GLuint)
+                                : sizeof(GLushort);
+  const size_t expected_stride =
+      (3 + ((header->flags & mesh_cache::kHasNormals) ? 3 : 0) +
+       ((header->flags & mesh_cache::kHasTexCoords) ? 2 : 0)) *
+      sizeof(GLfloat);
+  if (memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 ||
+      header->version != kVersion ||
+      header->vertex_stride != expected_stride ||
+      index_offset + header->index_count * index_size > mapping_size_) {
+    LOGE("Mesh cache: %s is not a valid mesh cache", path);
+    Close();
+    return false;
+  }
+
+  // Hint that the whole file is about to be uploaded.
+  madvise(mapping_, mapping_size_, MADV_WILLNEED);
+
+  header_ = header;
+  vertex_data_ = static_cast<const char*>(mapping_) + vertex_offset;
+  index_data_ = header->index_count > 0
+                    ? static_cast<const char*>(mapping_) + index_offset
+                    : NULL;
+  return true;
+}
+
+void MappedMesh::Close() {
+  if (mapping_ != NULL) {
+    munmap(mapping_, mapping_size_);
+  }
+  mapping_ = NULL;
+  mapping_size_ = 0;
+  header_ = NULL;
+  vertex_data_ = NULL;
+  index_data_ = NULL;
+}
+
+GLsizeiptr MappedMesh::GetIndexDataSize() const {
+  const GLsizeiptr index_size =
+      GetIndexType() == GL_UNSIGNED_INT ? sizeof(GLuint) : sizeof(GLushort);
+  return header_->index_count * index_size;
+}
+
+glm::vec3 MappedMesh::GetBoundingMin() const {
+  return glm::vec3(header_->bounding_min[0], header_->bounding_min[1],
+                   header_->bounding_min[2]);
+}
+
+glm::vec3 MappedMesh::GetBoundingMax() const {
+  return glm::vec3(header_->bounding_max[0], header_->bounding_max[1],
+                   header_->bounding_max[2]);
+}
+
+bool mesh_cache::LoadOBJData(const char* obj_path, const char* cache_path,
+                             bool with_normals, MappedMesh* mesh) {
+  return LoadOBJData(obj_path, cache_path, with_normals, false, mesh);
+}
+
+bool mesh_cache::LoadOBJData(const char* obj_path, const char* cache_path,
+                             bool with_normals, bool with_tex_coords,
+                             MappedMesh* mesh) {
+  int64_t source_size, source_mtime;
+  const bool has_source =
+      GetSourceStamp(obj_path, &source_size, &source_mtime);
+
+  if (mesh->Open(cache_path)) {
+    const Header& header = mesh->GetHeader();
+    const bool has_normals = (header.flags & kHasNormals) != 0;
+    const bool has_tex_coords = (header.flags & kHasTexCoords) != 0;
+    if (has_normals == with_normals && has_tex_coords == with_tex_coords &&
+        (!has_source || (header.source_size == source_size &&
+                         header.source_mtime == source_mtime))) {
+      return true;
+    }
+    mesh->Close();
+  }
+
+  if (!has_source) {
+    LOGE("Mesh cache: neither %s nor a cache of it exist", obj_path);
+    return false;
+  }
+
+  std::vector<GLfloat> vertices;
+  std::vector<GLuint> indices;
+  if (!obj_loader::LoadInterleavedOBJData(obj_path, with_normals,
+                                          with_tex_coords, vertices,
+                                          indices)) {
+    return false;
+  }
+  // Reordered once here rather than on every load of the cache.
+  const size_t floats_per_vertex =
+      3 + (with_normals ? 3 : 0) + (with_tex_coords ? 2 : 0);
+  mesh_indices::OptimizeVertexCache(
+      static_cast<GLuint>(vertices.size() / floats_per_vertex), &indices);
+  if (!WriteMeshCache(cache_path, vertices, with_normals, with_tex_coords,
+                      indices, obj_path)) {
+    return false;
+  }
+  return mesh->Open(cache_path);
+}
+}  // namespace tango_gl
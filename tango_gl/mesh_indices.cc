@@ -0,0 +1,180 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-gl/mesh_indices.h"
+
+#include "tango-gl/tracing.h"
+
+namespace tango_gl {
+
+void mesh_indices::OptimizeVertexCache(GLuint vertex_count,
+                                       std::vector<GLuint>* indices,
+                                       int cache_size) {
+  TANGO_TRACE_SCOPE("mesh_indices::OptimizeVertexCache");
+  const size_t triangle_count = indices->size() / 3;
+  if (triangle_count < 2) {
+    return;
+  }
+  const std::vector<GLuint>& input = *indices;
+
+  // The triangles of every vertex, and how many are not emitted yet.
+  std::vector<int> live_counts(vertex_count, 0);
+  for (size_t i = 0; i < triangle_count * 3; ++i) {
+    ++live_counts[input[i]];
+  }
+  std::vector<size_t> first_triangles(vertex_count + 1, 0);
+  for (GLuint v = 0; v < vertex_count; ++v) {
+    first_triangles[v + 1] = first_triangles[v] + live_counts[v];
+  }
+  std::vector<size_t> triangles(triangle_count * 3);
+  {
+    std::vector<size_t> next(first_triangles.begin(),
+                             first_triangles.end() - 1);
+    for (size_t i = 0; i < triangle_count * 3; ++i) {
+      triangles[next[input[i]]++] = i / 3;
+    }
+  }
+
+  // When each vertex last entered the cache, and the vertices of the emitted
+  // triangles, to restart from after a dead end.
+  std::vector<int> cache_times(vertex_count, 0);
+  std::vector<bool> is_emitted(triangle_count, false);
+  std::vector<GLuint> dead_ends;
+  dead_ends.reserve(triangle_count * 3);
+  std::vector<GLuint> candidates;
+  std::vector<GLuint> output;
+  output.reserve(triangle_count * 3);
+  int time = cache_size + 1;
+  GLuint scan_vertex = 0;
+
+  int fan_vertex = 0;
+  while (fan_vertex >= 0) {
+    // Emit the remaining triangles around the fanning vertex.
+    candidates.clear();
+    for (size_t t = first_triangles[fan_vertex];
+         t < first_triangles[fan_vertex + 1]; ++t) {
+      const size_t triangle = triangles[t];
+      if (is_emitted[triangle]) {
+        continue;
+      }
+      is_emitted[triangle] = true;
+      for (int corner = 0; corner < 3; ++corner) {
+        const GLuint v = input[triangle * 3 + corner];
+        output.push_back(v);
+        dead_ends.push_back(v);
+        candidates.push_back(v);
+        --live_counts[v];
+        if (time - cache_times[v] > cache_size) {
+          cache_times[v] = time++;
+        }
+      }
+    }
+
+    // Fan next around the candidate that stays longest in the cache while
+    // its triangles are emitted.
+    fan_vertex = -1;
+    int best_priority = -1;
+    for (GLuint v : candidates) {
+      if (live_counts[v] <= 0) {
+        continue;
+      }
+      int priority = 0;
+      if (time - cache_times[v] + 2 * live_counts[v] <= cache_size) {
+        priority = time - cache_times[v];
+      }
+      if (priority > best_priority) {
+        best_priority = priority;
+        fan_vertex = static_cast<int>(v);
+      }
+    }
+    if (fan_vertex >= 0) {
+      continue;
+    }
+    // Dead end: the most recent vertex with triangles left, or the next one
+    // in index order.
+    while (!dead_ends.empty()) {
+      const GLuint v = dead_ends.back();
+      dead_ends.pop_back();
+      if (live_counts[v] > 0) {
+        fan_vertex = static_cast<int>(v);
+        break;
+      }
+    }
+    for (; fan_vertex < 0 && scan_vertex < vertex_count; ++scan_vertex) {
+      if (live_counts[scan_vertex] > 0) {
+        fan_vertex = static_cast<int>(scan_vertex);
+      }
+    }
+  }
+  // A partial triangle at the end is kept as it was.
+  output.insert(output.end(), input.begin() + triangle_count * 3,
+                input.end());
+  indices->swap(output);
+}
+
+void mesh_indices::SplitIntoChunks(const void* vertices, GLsizei vertex_count,
+                                   GLsizei stride, const GLuint* indices,
+                                   GLsizei index_count,
+                                   std::vector<uint8_t>* chunk_vertices,
+                                   std::vector<GLushort>* chunk_indices,
+                                   std::vector<IndexChunk>* chunks) {
+  TANGO_TRACE_SCOPE("mesh_indices::SplitIntoChunks");
+  chunk_vertices->clear();
+  chunk_indices->clear();
+  chunks->clear();
+  chunk_vertices->reserve(static_cast<size_t>(vertex_count) * stride);
+  chunk_indices->reserve(index_count);
+  const uint8_t* source = static_cast<const uint8_t*>(vertices);
+
+  // The index of every vertex in the current chunk, valid when its chunk
+  // number is the current one.
+  std::vector<GLushort> local_indices(vertex_count);
+  std::vector<GLsizei> vertex_chunks(vertex_count, -1);
+  GLsizei chunk_vertex_count = 0;
+  const GLsizei triangle_index_count = index_count - index_count % 3;
+  for (GLsizei i = 0; i < triangle_index_count; i += 3) {
+    GLsizei new_vertex_count = 0;
+    for (int corner = 0; corner < 3; ++corner) {
+      if (vertex_chunks[indices[i + corner]] !=
+          static_cast<GLsizei>(chunks->size()) - 1) {
+        ++new_vertex_count;
+      }
+    }
+    if (chunks->empty() || chunk_vertex_count + new_vertex_count >
+                               static_cast<GLsizei>(kMaxChunkVertexCount)) {
+      IndexChunk chunk;
+      chunk.first_vertex =
+          static_cast<GLsizei>(chunk_vertices->size() / stride);
+      chunk.first_index = static_cast<GLsizei>(chunk_indices->size());
+      chunk.index_count = 0;
+      chunks->push_back(chunk);
+      chunk_vertex_count = 0;
+    }
+    const GLsizei chunk_number = static_cast<GLsizei>(chunks->size()) - 1;
+    for (int corner = 0; corner < 3; ++corner) {
+      const GLuint v = indices[i + corner];
+      if (vertex_chunks[v] != chunk_number) {
+        vertex_chunks[v] = chunk_number;
+        local_indices[v] = static_cast<GLushort>(chunk_vertex_count++);
+        const uint8_t* vertex = source + static_cast<size_t>(v) * stride;
+        chunk_vertices->insert(chunk_vertices->end(), vertex, vertex + stride);
+      }
+      chunk_indices->push_back(local_indices[v]);
+    }
+    chunks->back().index_count += 3;
+  }
+}
+}  // namespace tango_gl
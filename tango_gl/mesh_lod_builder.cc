@@ -0,0 +1,99 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-gl/mesh_lod_builder.h"
+
+#include <utility>
+
+namespace tango_gl {
+
+MeshLodBuilder::MeshLodBuilder(int lod_count)
+    : lod_count_(lod_count), is_building_(false), is_stopping_(false) {
+  worker_ = std::thread(&MeshLodBuilder::BuildLoop, this);
+}
+
+MeshLodBuilder::~MeshLodBuilder() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    is_stopping_ = true;
+    requests_.clear();
+  }
+  request_available_.notify_all();
+  worker_.join();
+}
+
+void MeshLodBuilder::Build(const std::vector<GLfloat>& vertices,
+                           bool has_normals,
+                           const std::vector<GLuint>& indices, Mesh* mesh) {
+  Request request;
+  request.vertices = vertices;
+  request.has_normals = has_normals;
+  request.indices = indices;
+  request.mesh = mesh;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    requests_.push_back(std::move(request));
+  }
+  request_available_.notify_one();
+}
+
+void MeshLodBuilder::BuildLoop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    request_available_.wait(
+        lock, [this] { return is_stopping_ || !requests_.empty(); });
+    if (is_stopping_) {
+      return;
+    }
+    Request request = std::move(requests_.front());
+    requests_.pop_front();
+    is_building_ = true;
+    lock.unlock();
+
+    mesh_simplifier::BuildLods(request.vertices, request.has_normals,
+                               request.indices, lod_count_,
+                               &request.lod_indices);
+
+    lock.lock();
+    is_building_ = false;
+    built_.push_back(std::move(request));
+  }
+}
+
+int MeshLodBuilder::UploadBuilt(int max_count) {
+  int uploaded_count = 0;
+  while (uploaded_count < max_count) {
+    Request built;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (built_.empty()) {
+        break;
+      }
+      built = std::move(built_.front());
+      built_.pop_front();
+    }
+    built.mesh->SetVertexBuffers(built.vertices, built.has_normals,
+                                 built.indices, built.lod_indices);
+    ++uploaded_count;
+  }
+  return uploaded_count;
+}
+
+size_t MeshLodBuilder::GetPendingCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return requests_.size() + (is_building_ ? 1 : 0) + built_.size();
+}
+}  // namespace tango_gl
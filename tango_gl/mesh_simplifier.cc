@@ -0,0 +1,360 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-gl/mesh_simplifier.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <unordered_map>
+
+#include "tango-gl/mesh_indices.h"
+#include "tango-gl/tracing.h"
+
+namespace {
+// Weight of the planes that hold the borders in place, relative to the
+// planes of the triangles.
+const double kBorderWeight = 10.0;
+
+// Weight of the squared area spanned by an edge in the cost of its collapse,
+// so that flat regions, where the collapses cost no error, lose their short
+// edges first instead of piling their vertices into a few fans.
+const double kEdgeLengthWeight = 1e-3;
+
+// A level keeps at least this many triangles, and is left out unless it
+// has at most this fraction of the triangles of the previous level.
+const size_t kMinLodTriangleCount = 16;
+const double kMaxLodTriangleRatio = 0.75;
+
+// Sum of squared distances to planes, as the symmetric 4x4 matrix of
+// Garland and Heckbert.
+struct Quadric {
+  Quadric() { std::fill(q, q + 10, 0.0); }
+
+  // Add the plane of unit |normal| through |point|.
+  void AddPlane(const glm::dvec3& normal, const glm::dvec3& point,
+                double weight) {
+    const double d = -glm::dot(normal, point);
+    const double plane[4] = {normal.x, normal.y, normal.z, d};
+    int k = 0;
+    for (int i = 0; i < 4; ++i) {
+      for (int j = i; j < 4; ++j) {
+        q[k++] += weight * plane[i] * plane[j];
+      }
+    }
+  }
+
+  void Add(const Quadric& other) {
+    for (int i = 0; i < 10; ++i) {
+      q[i] += other.q[i];
+    }
+  }
+
+  double Error(const glm::dvec3& p) const {
+    return q[0] * p.x * p.x + 2.0 * q[1] * p.x * p.y + 2.0 * q[2] * p.x * p.z +
+           2.0 * q[3] * p.x + q[4] * p.y * p.y + 2.0 * q[5] * p.y * p.z +
+           2.0 * q[6] * p.y + q[7] * p.z * p.z + 2.0 * q[8] * p.z + q[9];
+  }
+
+  // Upper triangle of the matrix, row by row.
+  double q[10];
+};
+
+// A candidate collapse of the vertex |from| into |to|, valid while neither
+// vertex changed since it was queued.
+struct Collapse {
+  double cost;
+  GLuint from;
+  GLuint to;
+  uint32_t from_version;
+  uint32_t to_version;
+
+  bool operator>(const Collapse& other) const { return cost > other.cost; }
+};
+
+uint64_t EdgeKey(GLuint a, GLuint b) {
+  return a < b ? (static_cast<uint64_t>(a) << 32) | b
+               : (static_cast<uint64_t>(b) << 32) | a;
+}
+
+class Simplifier {
+ public:
+  Simplifier(const std::vector<GLfloat>& vertices, bool has_normals,
+             const std::vector<GLuint>& indices);
+
+  void Run(size_t target_triangle_count);
+  void GetIndices(std::vector<GLuint>* indices) const;
+
+ private:
+  glm::dvec3 Normal(const GLuint* triangle) const {
+    return glm::cross(positions_[triangle[1]] - positions_[triangle[0]],
+                      positions_[triangle[2]] - positions_[triangle[0]]);
+  }
+  bool HasVertex(size_t triangle, GLuint v) const {
+    const GLuint* t = &triangles_[triangle * 3];
+    return t[0] == v || t[1] == v || t[2] == v;
+  }
+
+  void QueueCollapses(GLuint a, GLuint b);
+  void GetNeighbors(GLuint v, std::vector<GLuint>* neighbors) const;
+  bool CanCollapse(GLuint from, GLuint to);
+  void DoCollapse(GLuint from, GLuint to);
+
+  std::vector<glm::dvec3> positions_;
+  std::vector<GLuint> triangles_;
+  std::vector<bool> is_triangle_alive_;
+  size_t triangle_count_;
+  // The triangles around each vertex, alive or not.
+  std::vector<std::vector<size_t>> vertex_triangles_;
+  std::vector<Quadric> quadrics_;
+  std::vector<uint32_t> versions_;
+  std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>>
+      collapses_;
+  // Scratch of CanCollapse().
+  std::vector<GLuint> from_neighbors_;
+  std::vector<GLuint> to_neighbors_;
+};
+
+Simplifier::Simplifier(const std::vector<GLfloat>& vertices, bool has_normals,
+                       const std::vector<GLuint>& indices)
+    : triangles_(indices.begin(), indices.begin() + indices.size() / 3 * 3),
+      is_triangle_alive_(indices.size() / 3, true),
+      triangle_count_(indices.size() / 3) {
+  const size_t floats_per_vertex = has_normals ? 6 : 3;
+  const size_t vertex_count = vertices.size() / floats_per_vertex;
+  positions_.resize(vertex_count);
+  for (size_t i = 0; i < vertex_count; ++i) {
+    const GLfloat* p = &vertices[i * floats_per_vertex];
+    positions_[i] = glm::dvec3(p[0], p[1], p[2]);
+  }
+  vertex_triangles_.resize(vertex_count);
+  quadrics_.resize(vertex_count);
+  versions_.resize(vertex_count, 0);
+
+  // The planes of the triangles, weighted by their area, and the number of
+  // triangles of each edge to find the borders.
+  std::unordered_map<uint64_t, int> edge_counts;
+  edge_counts.reserve(triangles_.size());
+  for (size_t t = 0; t < triangle_count_; ++t) {
+    const GLuint* triangle = &triangles_[t * 3];
+    const glm::dvec3 normal = Normal(triangle);
+    const double length = glm::length(normal);
+    for (int corner = 0; corner < 3; ++corner) {
+      vertex_triangles_[triangle[corner]].push_back(t);
+      ++edge_counts[EdgeKey(triangle[corner], triangle[(corner + 1) % 3])];
+      if (length > 0.0) {
+        quadrics_[triangle[corner]].AddPlane(
+            normal / length, positions_[triangle[0]], 0.5 * length);
+      }
+    }
+  }
+  // A plane through each border edge, across its triangle.
+  for (size_t t = 0; t < triangle_count_; ++t) {
+    const GLuint* triangle = &triangles_[t * 3];
+    const glm::dvec3 normal = Normal(triangle);
+    for (int corner = 0; corner < 3; ++corner) {
+      const GLuint a = triangle[corner];
+      const GLuint b = triangle[(corner + 1) % 3];
+      if (edge_counts[EdgeKey(a, b)] != 1) {
+        continue;
+      }
+      const glm::dvec3 edge = positions_[b] - positions_[a];
+      const glm::dvec3 across = glm::cross(edge, normal);
+      const double length = glm::length(across);
+      if (length > 0.0) {
+        const double weight = kBorderWeight * glm::dot(edge, edge);
+        quadrics_[a].AddPlane(across / length, positions_[a], weight);
+        quadrics_[b].AddPlane(across / length, positions_[a], weight);
+      }
+    }
+  }
+  for (const auto& edge_count : edge_counts) {
+    QueueCollapses(static_cast<GLuint>(edge_count.first >> 32),
+                   static_cast<GLuint>(edge_count.first & 0xffffffff));
+  }
+}
+
+void Simplifier::QueueCollapses(GLuint a, GLuint b) {
+  Quadric quadric = quadrics_[a];
+  quadric.Add(quadrics_[b]);
+  // The cheaper of the two directions.
+  const double a_into_b = quadric.Error(positions_[b]);
+  const double b_into_a = quadric.Error(positions_[a]);
+  const glm::dvec3 edge = positions_[b] - positions_[a];
+  const double squared_length = glm::dot(edge, edge);
+  Collapse collapse;
+  collapse.cost = std::min(a_into_b, b_into_a) +
+                  kEdgeLengthWeight * squared_length * squared_length;
+  collapse.from = a_into_b <= b_into_a ? a : b;
+  collapse.to = a_into_b <= b_into_a ? b : a;
+  collapse.from_version = versions_[collapse.from];
+  collapse.to_version = versions_[collapse.to];
+  collapses_.push(collapse);
+}
+
+void Simplifier::GetNeighbors(GLuint v, std::vector<GLuint>* neighbors) const {
+  neighbors->clear();
+  for (size_t t : vertex_triangles_[v]) {
+    if (!is_triangle_alive_[t]) {
+      continue;
+    }
+    for (int corner = 0; corner < 3; ++corner) {
+      if (triangles_[t * 3 + corner] != v) {
+        neighbors->push_back(triangles_[t * 3 + corner]);
+      }
+    }
+  }
+  std::sort(neighbors->begin(), neighbors->end());
+  neighbors->erase(std::unique(neighbors->begin(), neighbors->end()),
+                   neighbors->end());
+}
+
+bool Simplifier::CanCollapse(GLuint from, GLuint to) {
+  // The vertices next to both must be those of the triangles that vanish,
+  // otherwise the collapse pinches the surface into duplicate triangles.
+  GetNeighbors(from, &from_neighbors_);
+  GetNeighbors(to, &to_neighbors_);
+  size_t common_count = 0;
+  for (GLuint neighbor : from_neighbors_) {
+    common_count += std::binary_search(to_neighbors_.begin(),
+                                       to_neighbors_.end(), neighbor);
+  }
+  size_t shared_count = 0;
+  for (size_t t : vertex_triangles_[from]) {
+    if (!is_triangle_alive_[t]) {
+      continue;
+    }
+    if (HasVertex(t, to)) {
+      ++shared_count;
+      continue;
+    }
+    // The moved triangles must not flip over.
+    GLuint moved[3];
+    for (int corner = 0; corner < 3; ++corner) {
+      const GLuint v = triangles_[t * 3 + corner];
+      moved[corner] = v == from ? to : v;
+    }
+    if (glm::dot(Normal(&triangles_[t * 3]), Normal(moved)) <= 0.0) {
+      return false;
+    }
+  }
+  return shared_count > 0 && common_count == shared_count;
+}
+
+void Simplifier::DoCollapse(GLuint from, GLuint to) {
+  for (size_t t : vertex_triangles_[from]) {
+    if (!is_triangle_alive_[t]) {
+      continue;
+    }
+    if (HasVertex(t, to)) {
+      is_triangle_alive_[t] = false;
+      --triangle_count_;
+      continue;
+    }
+    for (int corner = 0; corner < 3; ++corner) {
+      if (triangles_[t * 3 + corner] == from) {
+        triangles_[t * 3 + corner] = to;
+      }
+    }
+    vertex_triangles_[to].push_back(t);
+  }
+  std::vector<size_t>().swap(vertex_triangles_[from]);
+  std::vector<size_t>& to_triangles = vertex_triangles_[to];
+  to_triangles.erase(
+      std::remove_if(to_triangles.begin(), to_triangles.end(),
+                     [this](size_t t) { return !is_triangle_alive_[t]; }),
+      to_triangles.end());
+  quadrics_[to].Add(quadrics_[from]);
+  ++versions_[from];
+  ++versions_[to];
+
+  GetNeighbors(to, &to_neighbors_);
+  for (GLuint neighbor : to_neighbors_) {
+    QueueCollapses(to, neighbor);
+  }
+}
+
+void Simplifier::Run(size_t target_triangle_count) {
+  while (triangle_count_ > target_triangle_count && !collapses_.empty()) {
+    const Collapse collapse = collapses_.top();
+    collapses_.pop();
+    if (versions_[collapse.from] != collapse.from_version ||
+        versions_[collapse.to] != collapse.to_version ||
+        vertex_triangles_[collapse.from].empty()) {
+      continue;
+    }
+    if (CanCollapse(collapse.from, collapse.to)) {
+      DoCollapse(collapse.from, collapse.to);
+    }
+  }
+}
+
+void Simplifier::GetIndices(std::vector<GLuint>* indices) const {
+  indices->clear();
+  indices->reserve(triangle_count_ * 3);
+  for (size_t t = 0; t < is_triangle_alive_.size(); ++t) {
+    if (is_triangle_alive_[t]) {
+      indices->insert(indices->end(), &triangles_[t * 3],
+                      &triangles_[t * 3] + 3);
+    }
+  }
+}
+}  // namespace
+
+namespace tango_gl {
+
+void mesh_simplifier::Simplify(const std::vector<GLfloat>& vertices,
+                               bool has_normals,
+                               const std::vector<GLuint>& indices,
+                               size_t target_triangle_count,
+                               std::vector<GLuint>* simplified_indices) {
+  TANGO_TRACE_SCOPE("mesh_simplifier::Simplify");
+  Simplifier simplifier(vertices, has_normals, indices);
+  simplifier.Run(target_triangle_count);
+  simplifier.GetIndices(simplified_indices);
+}
+
+void mesh_simplifier::BuildLods(const std::vector<GLfloat>& vertices,
+                                bool has_normals,
+                                const std::vector<GLuint>& indices,
+                                int lod_count,
+                                std::vector<std::vector<GLuint>>* lod_indices) {
+  TANGO_TRACE_SCOPE("mesh_simplifier::BuildLods");
+  lod_indices->clear();
+  lod_indices->reserve(lod_count);
+  const GLuint vertex_count =
+      static_cast<GLuint>(vertices.size() / (has_normals ? 6 : 3));
+  // Each level is simplified from the previous one, which is cheaper than
+  // starting over from the full mesh every time.
+  const std::vector<GLuint>* previous = &indices;
+  std::vector<GLuint> simplified;
+  for (int level = 0; level < lod_count; ++level) {
+    const size_t previous_count = previous->size() / 3;
+    const size_t target_count = previous_count / 4;
+    if (target_count < kMinLodTriangleCount) {
+      break;
+    }
+    Simplify(vertices, has_normals, *previous, target_count, &simplified);
+    if (simplified.size() / 3 > previous_count * kMaxLodTriangleRatio) {
+      break;
+    }
+    mesh_indices::OptimizeVertexCache(vertex_count, &simplified);
+    lod_indices->push_back(simplified);
+    previous = &lod_indices->back();
+  }
+}
+}  // namespace tango_gl
@@ -13,159 +13,403 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
-#include <string>
 
 #include "tango-gl/obj_loader.h"
 
-namespace tango_gl {
-bool obj_loader::LoadOBJData(const char* path, std::vector<GLfloat>& vertices,
-                             std::vector<GLushort>& indices) {
-  FILE* file = fopen(path, "r");
+#include <cstdio>
+
+namespace {
+// Largest vertex count addressable by GLushort indices.
+const size_t kMaxUshortVertexCount = 65536;
+
+// One corner of a face, as 0-based indices into the position, texture
+// coordinate and normal lists. A missing texture coordinate or normal is -1.
+struct Corner {
+  int vertex;
+  int tex_coord;
+  int normal;
+};
+
+// All the data of an OBJ file, with every face triangulated.
+struct ObjData {
+  std::vector<GLfloat> positions;
+  std::vector<GLfloat> tex_coords;
+  std::vector<GLfloat> normals;
+  // Three corners per triangle.
+  std::vector<Corner> corners;
+  // Number of 'v', 'vt' and 'vn' lines in the file. Faces may refer to
+  // elements defined further down.
+  size_t vertex_count;
+  size_t tex_coord_count;
+  size_t normal_count;
+};
+
+bool ReadFile(const char* path, std::vector<char>* contents) {
+  FILE* file = fopen(path, "rb");
   if (file == NULL) {
     LOGE("Failed to open file: %s", path);
     return false;
   }
+  fseek(file, 0, SEEK_END);
+  const long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  if (size < 0) {
+    fclose(file);
+    LOGE("Failed to read file: %s", path);
+    return false;
+  }
+  // Zero terminated, so the parser can look one character ahead anywhere.
+  contents->resize(size + 1);
+  const size_t read = fread(contents->data(), 1, size, file);
+  fclose(file);
+  (*contents)[read] = '\0';
+  contents->resize(read + 1);
+  return true;
+}
+
+inline bool IsSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+inline bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+
+inline void SkipSpaces(const char** p) {
+  while (IsSpace(**p)) {
+    ++*p;
+  }
+}
+
+inline void SkipLine(const char** p) {
+  while (**p != '\0' && **p != '\n') {
+    ++*p;
+  }
+  if (**p == '\n') {
+    ++*p;
+  }
+}
+
+// ParseInt and ParseFloat advance |p| past the number and return false, with
+// |p| unchanged, if it does not start with a number.
+bool ParseInt(const char** p, int* value) {
+  const char* c = *p;
+  const bool negative = *c == '-';
+  if (*c == '-' || *c == '+') {
+    ++c;
+  }
+  if (!IsDigit(*c)) {
+    return false;
+  }
+  int result = 0;
+  while (IsDigit(*c)) {
+    result = result * 10 + (*c++ - '0');
+  }
+  *value = negative ? -result : result;
+  *p = c;
+  return true;
+}
 
-  while (1) {
-    char lineHeader[128];
-    int res = fscanf(file, "%s", lineHeader);
-    if (res == EOF) break;
-    if (strcmp(lineHeader, "v") == 0) {
-      GLfloat vertex[3];
-      int matches =
-          fscanf(file, "%f %f %f\n", &vertex[0], &vertex[1], &vertex[2]);
-      if (matches != 3) {
-        LOGE("Format of 'v float float float' required for each vertice line");
+bool ParseFloat(const char** p, GLfloat* value) {
+  const char* c = *p;
+  const bool negative = *c == '-';
+  if (*c == '-' || *c == '+') {
+    ++c;
+  }
+  double mantissa = 0.0;
+  bool has_digits = false;
+  while (IsDigit(*c)) {
+    mantissa = mantissa * 10.0 + (*c++ - '0');
+    has_digits = true;
+  }
+  if (*c == '.') {
+    ++c;
+    double scale = 0.1;
+    while (IsDigit(*c)) {
+      mantissa += (*c++ - '0') * scale;
+      scale *= 0.1;
+      has_digits = true;
+    }
+  }
+  if (!has_digits) {
+    return false;
+  }
+  if (*c == 'e' || *c == 'E') {
+    const char* exponent_start = c + 1;
+    int exponent;
+    if (ParseInt(&exponent_start, &exponent)) {
+      double power = 1.0;
+      for (int i = exponent < 0 ? -exponent : exponent; i > 0; --i) {
+        power *= 10.0;
+      }
+      mantissa = exponent < 0 ? mantissa / power : mantissa * power;
+      c = exponent_start;
+    }
+  }
+  *value = static_cast<GLfloat>(negative ? -mantissa : mantissa);
+  *p = c;
+  return true;
+}
+
+bool ParseFloats(const char** p, int count, std::vector<GLfloat>* values) {
+  for (int i = 0; i < count; ++i) {
+    SkipSpaces(p);
+    GLfloat value;
+    if (!ParseFloat(p, &value)) {
+      return false;
+    }
+    values->push_back(value);
+  }
+  return true;
+}
+
+// Turn a 1-based or negative (relative to the elements defined so far) OBJ
+// index into a 0-based index, or return -1 if it is out of range.
+inline int ResolveIndex(int index, size_t defined_count, size_t total_count) {
+  const int resolved =
+      index < 0 ? static_cast<int>(defined_count) + index : index - 1;
+  return resolved >= 0 && resolved < static_cast<int>(total_count) ? resolved
+                                                                    : -1;
+}
+
+// Parse a face corner in any of the 'v', 'v/vt', 'v//vn' or 'v/vt/vn' forms.
+bool ParseCorner(const char** p, const ObjData& obj, Corner* corner) {
+  int vertex;
+  if (!ParseInt(p, &vertex)) {
+    return false;
+  }
+  corner->vertex =
+      ResolveIndex(vertex, obj.positions.size() / 3, obj.vertex_count);
+  corner->tex_coord = -1;
+  corner->normal = -1;
+  if (corner->vertex < 0) {
+    return false;
+  }
+  if (**p == '/') {
+    ++*p;
+    int tex_coord;
+    if (ParseInt(p, &tex_coord)) {
+      corner->tex_coord = ResolveIndex(tex_coord, obj.tex_coords.size() / 2,
+                                       obj.tex_coord_count);
+      if (corner->tex_coord < 0) {
+        return false;
+      }
+    }
+    if (**p == '/') {
+      ++*p;
+      int normal;
+      if (!ParseInt(p, &normal)) {
         return false;
       }
-      vertices.push_back(vertex[0]);
-      vertices.push_back(vertex[1]);
-      vertices.push_back(vertex[2]);
-    } else if (strcmp(lineHeader, "f") == 0) {
-      GLushort vertexIndex[3];
-      int matches = fscanf(file, "%hu %hu %hu\n", &vertexIndex[0],
-                           &vertexIndex[1], &vertexIndex[2]);
-      if (matches != 3) {
-        LOGE("Format of 'f int int int' required for each face line");
+      corner->normal =
+          ResolveIndex(normal, obj.normals.size() / 3, obj.normal_count);
+      if (corner->normal < 0) {
         return false;
       }
-      indices.push_back(vertexIndex[0] - 1);
-      indices.push_back(vertexIndex[1] - 1);
-      indices.push_back(vertexIndex[2] - 1);
-    } else {
-      char comments_buffer[1000];
-      fgets(comments_buffer, 1000, file);
     }
   }
-  fclose(file);
   return true;
 }
 
-bool obj_loader::LoadOBJData(const char* path, std::vector<GLfloat>& vertices,
-                             std::vector<GLfloat>& normals) {
-  std::vector<unsigned int> vertexIndices, normalIndices;
-  std::vector<GLfloat> temp_vertices, temp_normals;
-
-  FILE* file = fopen(path, "r");
-  if (file == NULL) {
-    LOGE("Failed to open file: %s", path);
+// Parse the whole file in two passes over a single buffer: the first one
+// counts the elements so every vector is allocated once.
+bool ParseObj(const char* path, ObjData* obj) {
+  std::vector<char> contents;
+  if (!ReadFile(path, &contents)) {
     return false;
   }
-  while (1) {
-    char lineHeader[128];
-    int res = fscanf(file, "%s", lineHeader);
-    if (res == EOF) break;
-    if (strcmp(lineHeader, "v") == 0) {
-      GLfloat vertex[3];
-      int matches =
-          fscanf(file, "%f %f %f\n", &vertex[0], &vertex[1], &vertex[2]);
-      if (matches != 3) {
-        LOGE("Format of 'v float float float' required for each vertice line");
+
+  obj->vertex_count = 0;
+  obj->tex_coord_count = 0;
+  obj->normal_count = 0;
+  size_t face_count = 0;
+  for (const char* p = contents.data(); *p != '\0'; SkipLine(&p)) {
+    SkipSpaces(&p);
+    if (p[0] == 'v' && IsSpace(p[1])) {
+      ++obj->vertex_count;
+    } else if (p[0] == 'v' && p[1] == 't' && IsSpace(p[2])) {
+      ++obj->tex_coord_count;
+    } else if (p[0] == 'v' && p[1] == 'n' && IsSpace(p[2])) {
+      ++obj->normal_count;
+    } else if (p[0] == 'f' && IsSpace(p[1])) {
+      ++face_count;
+    }
+  }
+  obj->positions.reserve(obj->vertex_count * 3);
+  obj->tex_coords.reserve(obj->tex_coord_count * 2);
+  obj->normals.reserve(obj->normal_count * 3);
+  // Most faces are triangles or quads.
+  obj->corners.reserve(face_count * 6);
+
+  int line = 1;
+  for (const char* p = contents.data(); *p != '\0'; SkipLine(&p), ++line) {
+    SkipSpaces(&p);
+    if (p[0] == 'v' && IsSpace(p[1])) {
+      ++p;
+      if (!ParseFloats(&p, 3, &obj->positions)) {
+        LOGE("%s:%d: format of 'v float float float' required", path, line);
         return false;
       }
-      temp_vertices.push_back(vertex[0]);
-      temp_vertices.push_back(vertex[1]);
-      temp_vertices.push_back(vertex[2]);
-    } else if (strcmp(lineHeader, "vn") == 0) {
-      GLfloat normal[3];
-      int matches =
-          fscanf(file, "%f %f %f\n", &normal[0], &normal[1], &normal[2]);
-      if (matches != 3) {
-        LOGE("Format of 'vn float float float' required for each normal line");
+    } else if (p[0] == 'v' && p[1] == 't' && IsSpace(p[2])) {
+      // A third, depth coordinate is ignored.
+      p += 2;
+      if (!ParseFloats(&p, 2, &obj->tex_coords)) {
+        LOGE("%s:%d: format of 'vt float float' required", path, line);
         return false;
       }
-      temp_normals.push_back(normal[0]);
-      temp_normals.push_back(normal[1]);
-      temp_normals.push_back(normal[2]);
-    } else if (strcmp(lineHeader, "f") == 0) {
-      unsigned int vertexIndex[4];
-      unsigned int normalIndex[4];
-      unsigned int textureIndex[4];
-      int matches = fscanf(file, "%d//%d %d//%d %d//%d %d//%d\n",
-                           &vertexIndex[0], &normalIndex[0], &vertexIndex[1],
-                           &normalIndex[1], &vertexIndex[2], &normalIndex[2],
-                           &vertexIndex[3], &normalIndex[3]);
-      // If the exported obj file includes texture face indices information,
-      // we still support the loading
-      if ((matches != 6) && (matches != 8)) {
-        // to use "%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n" since we already have
-        // one match in the previous scan.
-        matches = fscanf(file, "%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n",
-                         &textureIndex[0], &normalIndex[0], &vertexIndex[1],
-                         &textureIndex[1], &normalIndex[1], &vertexIndex[2],
-                         &textureIndex[2], &normalIndex[2], &vertexIndex[3],
-                         &textureIndex[3], &normalIndex[3]);
-        // Adding one count back to matches to count for the one we already
-        // matched.
-        matches += 1;
+    } else if (p[0] == 'v' && p[1] == 'n' && IsSpace(p[2])) {
+      p += 2;
+      if (!ParseFloats(&p, 3, &obj->normals)) {
+        LOGE("%s:%d: format of 'vn float float float' required", path, line);
+        return false;
       }
-      // .obj file is 1-indexed, so subtract 1 from all indices.
-      if (matches == 6 || matches == 9) {
-        // If triangles provided.
-        vertexIndices.push_back(vertexIndex[0] - 1);
-        vertexIndices.push_back(vertexIndex[1] - 1);
-        vertexIndices.push_back(vertexIndex[2] - 1);
-        normalIndices.push_back(normalIndex[0] - 1);
-        normalIndices.push_back(normalIndex[1] - 1);
-        normalIndices.push_back(normalIndex[2] - 1);
-      } else if (matches == 8 || matches == 12) {
-        // If quads provided.
-        vertexIndices.push_back(vertexIndex[0] - 1);
-        vertexIndices.push_back(vertexIndex[1] - 1);
-        vertexIndices.push_back(vertexIndex[2] - 1);
-        vertexIndices.push_back(vertexIndex[0] - 1);
-        vertexIndices.push_back(vertexIndex[2] - 1);
-        vertexIndices.push_back(vertexIndex[3] - 1);
-        normalIndices.push_back(normalIndex[0] - 1);
-        normalIndices.push_back(normalIndex[1] - 1);
-        normalIndices.push_back(normalIndex[2] - 1);
-        normalIndices.push_back(normalIndex[0] - 1);
-        normalIndices.push_back(normalIndex[2] - 1);
-        normalIndices.push_back(normalIndex[3] - 1);
-      } else {
-        LOGE(
-            "Format of 'f int/int/int int/int/int int/int/int (int/int/int)' "
-            "or 'f int//int int//int int//int (int//int)' required for each "
-            "face");
+    } else if (p[0] == 'f' && IsSpace(p[1])) {
+      ++p;
+      // Triangulate polygons as a fan around their first corner.
+      Corner first, previous, current;
+      int corner_count = 0;
+      for (SkipSpaces(&p); *p != '\0' && *p != '\n'; SkipSpaces(&p)) {
+        if (!ParseCorner(&p, *obj, &current)) {
+          LOGE("%s:%d: invalid face", path, line);
+          return false;
+        }
+        if (corner_count == 0) {
+          first = current;
+        } else if (corner_count >= 2) {
+          obj->corners.push_back(first);
+          obj->corners.push_back(previous);
+          obj->corners.push_back(current);
+        }
+        previous = current;
+        ++corner_count;
+      }
+      if (corner_count < 3) {
+        LOGE("%s:%d: a face needs at least 3 vertices", path, line);
         return false;
       }
-    } else {
-      char comments_buffer[1000];
-      fgets(comments_buffer, 1000, file);
     }
   }
-  for (unsigned int i = 0; i < vertexIndices.size(); i++) {
-    unsigned int vertexIndex = vertexIndices[i];
-    unsigned int normalIndex = normalIndices[i];
+  return true;
+}
+}  // namespace
 
-    vertices.push_back(temp_vertices[vertexIndex * 3]);
-    vertices.push_back(temp_vertices[vertexIndex * 3 + 1]);
-    vertices.push_back(temp_vertices[vertexIndex * 3 + 2]);
-    normals.push_back(temp_normals[normalIndex * 3]);
-    normals.push_back(temp_normals[normalIndex * 3 + 1]);
-    normals.push_back(temp_normals[normalIndex * 3 + 2]);
+namespace tango_gl {
+bool obj_loader::LoadOBJData(const char* path, std::vector<GLfloat>& vertices,
+                             std::vector<GLushort>& indices) {
+  ObjData obj;
+  if (!ParseObj(path, &obj)) {
+    return false;
+  }
+  if (obj.positions.size() / 3 > kMaxUshortVertexCount) {
+    LOGE("%s has too many vertices for GLushort indices", path);
+    return false;
+  }
+  vertices.insert(vertices.end(), obj.positions.begin(), obj.positions.end());
+  indices.reserve(indices.size() + obj.corners.size());
+  for (const Corner& corner : obj.corners) {
+    indices.push_back(static_cast<GLushort>(corner.vertex));
+  }
+  return true;
+}
+
+bool obj_loader::LoadOBJData(const char* path, std::vector<GLfloat>& vertices,
+                             std::vector<GLuint>& indices) {
+  ObjData obj;
+  if (!ParseObj(path, &obj)) {
+    return false;
+  }
+  vertices.insert(vertices.end(), obj.positions.begin(), obj.positions.end());
+  indices.reserve(indices.size() + obj.corners.size());
+  for (const Corner& corner : obj.corners) {
+    indices.push_back(corner.vertex);
+  }
+  return true;
+}
+
+bool obj_loader::LoadOBJData(const char* path, std::vector<GLfloat>& vertices,
+                             std::vector<GLfloat>& normals) {
+  ObjData obj;
+  if (!ParseObj(path, &obj)) {
+    return false;
+  }
+  vertices.reserve(vertices.size() + obj.corners.size() * 3);
+  normals.reserve(normals.size() + obj.corners.size() * 3);
+  for (const Corner& corner : obj.corners) {
+    if (corner.normal < 0) {
+      LOGE("%s: every face vertex needs a normal", path);
+      return false;
+    }
+    const GLfloat* position = &obj.positions[corner.vertex * 3];
+    const GLfloat* normal = &obj.normals[corner.normal * 3];
+    vertices.insert(vertices.end(), position, position + 3);
+    normals.insert(normals.end(), normal, normal + 3);
+  }
+  return true;
+}
+
+bool obj_loader::LoadInterleavedOBJData(const char* path, bool with_normals,
+                                        std::vector<GLfloat>& vertices,
+                                        std::vector<GLuint>& indices) {
+  return LoadInterleavedOBJData(path, with_normals, false, vertices, indices);
+}
+
+bool obj_loader::LoadInterleavedOBJData(const char* path, bool with_normals,
+                                        bool with_tex_coords,
+                                        std::vector<GLfloat>& vertices,
+                                        std::vector<GLuint>& indices) {
+  ObjData obj;
+  if (!ParseObj(path, &obj)) {
+    return false;
+  }
+
+  // Every distinct position/texture coordinate/normal triple becomes one
+  // output vertex. The vertices made from a position are chained from it, so
+  // finding whether a corner is new only compares it with the few vertices
+  // sharing its position, e.g. across a seam.
+  const size_t position_count = obj.positions.size() / 3;
+  std::vector<GLint> first_vertex(position_count, -1);
+  struct OutputVertex {
+    int tex_coord;
+    int normal;
+    GLint next;
+  };
+  std::vector<OutputVertex> output_vertices;
+  output_vertices.reserve(position_count);
+  const size_t floats_per_vertex =
+      3 + (with_tex_coords ? 2 : 0) + (with_normals ? 3 : 0);
+  vertices.reserve(vertices.size() + position_count * floats_per_vertex);
+  indices.reserve(indices.size() + obj.corners.size());
+  const GLuint first_id = vertices.size() / floats_per_vertex;
+  for (const Corner& corner : obj.corners) {
+    if (with_normals && corner.normal < 0) {
+      LOGE("%s: every face vertex needs a normal", path);
+      return false;
+    }
+    if (with_tex_coords && corner.tex_coord < 0) {
+      LOGE("%s: every face vertex needs a texture coordinate", path);
+      return false;
+    }
+    const int tex_coord = with_tex_coords ? corner.tex_coord : 0;
+    const int normal = with_normals ? corner.normal : 0;
+    GLint id = first_vertex[corner.vertex];
+    while (id >= 0 && (output_vertices[id].tex_coord != tex_coord ||
+                       output_vertices[id].normal != normal)) {
+      id = output_vertices[id].next;
+    }
+    if (id < 0) {
+      id = static_cast<GLint>(output_vertices.size());
+      const OutputVertex output_vertex = {tex_coord, normal,
+                                          first_vertex[corner.vertex]};
+      output_vertices.push_back(output_vertex);
+      first_vertex[corner.vertex] = id;
+      const GLfloat* position = &obj.positions[corner.vertex * 3];
+      vertices.insert(vertices.end(), position, position + 3);
+      if (with_normals) {
+        const GLfloat* normal_data = &obj.normals[normal * 3];
+        vertices.insert(vertices.end(), normal_data, normal_data + 3);
+      }
+      if (with_tex_coords) {
+        const GLfloat* uv = &obj.tex_coords[tex_coord * 2];
+        vertices.insert(vertices.end(), uv, uv + 2);
+      }
+    }
+    indices.push_back(first_id + id);
   }
-  fclose(file);
   return true;
 }
 }  // namespace tango_gl
@@ -0,0 +1,304 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "tango-gl/oriented_bounding_box.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define TANGO_GL_OBB_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define TANGO_GL_OBB_SSE2 1
+#endif
+
+namespace {
+// Number of Jacobi sweeps of the eigen decomposition, plenty for 3x3.
+const int kJacobiSweepCount = 8;
+
+// Direction components smaller than this are clamped to it, so the slab
+// distances stay finite for segments parallel to a face.
+const float kMinDirection = 1e-20f;
+
+// @return the eigenvectors of |symmetric|, as the columns.
+glm::mat3 GetEigenvectors(const glm::mat3& symmetric) {
+  // Diagonalized by Jacobi rotations.
+  glm::mat3 a = symmetric;
+  glm::mat3 vectors(1.0f);
+  for (int sweep = 0; sweep < kJacobiSweepCount; ++sweep) {
+    for (int p = 0; p < 2; ++p) {
+      for (int q = p + 1; q < 3; ++q) {
+        if (std::fabs(a[q][p]) < 1e-12f) {
+          continue;
+        }
+        const float theta = (a[q][q] - a[p][p]) / (2.0f * a[q][p]);
+        const float t = (theta >= 0.0f ? 1.0f : -1.0f) /
+                        (std::fabs(theta) + std::sqrt(theta * theta + 1.0f));
+        const float c = 1.0f / std::sqrt(t * t + 1.0f);
+        const float s = t * c;
+        glm::mat3 rotation(1.0f);
+        rotation[p][p] = c;
+        rotation[q][q] = c;
+        rotation[q][p] = s;
+        rotation[p][q] = -s;
+        a = glm::transpose(rotation) * a * rotation;
+        vectors = vectors * rotation;
+      }
+    }
+  }
+  return vectors;
+}
+
+// Make |axes| an orthonormal right-handed basis, keeping the direction of
+// the first.
+void Orthonormalize(glm::vec3 axes[3]) {
+  axes[0] = glm::normalize(axes[0]);
+  axes[1] -= glm::dot(axes[1], axes[0]) * axes[0];
+  if (glm::dot(axes[1], axes[1]) < 1e-12f) {
+    axes[1] = std::fabs(axes[0].x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f)
+                                          : glm::vec3(0.0f, 1.0f, 0.0f);
+    axes[1] -= glm::dot(axes[1], axes[0]) * axes[0];
+  }
+  axes[1] = glm::normalize(axes[1]);
+  axes[2] = glm::cross(axes[0], axes[1]);
+}
+
+// Slab test of a segment, in the frame of the box, over its three axes in
+// the first lanes: the segment starts at |start| and goes along the inverse
+// of |inverse_direction| over [0, 1]. The fourth lane is padding that
+// never rejects.
+#if defined(TANGO_GL_OBB_NEON)
+bool IntersectSlabs(const float start[4], const float inverse_direction[4],
+                    const float half_extent[4]) {
+  const float32x4_t s = vld1q_f32(start);
+  const float32x4_t inverse = vld1q_f32(inverse_direction);
+  const float32x4_t h = vld1q_f32(half_extent);
+  const float32x4_t t0 = vmulq_f32(vsubq_f32(vnegq_f32(h), s), inverse);
+  const float32x4_t t1 = vmulq_f32(vsubq_f32(h, s), inverse);
+  const float32x4_t entries = vminq_f32(t0, t1);
+  const float32x4_t exits = vmaxq_f32(t0, t1);
+  float32x2_t t_near =
+      vpmax_f32(vget_low_f32(entries), vget_high_f32(entries));
+  t_near = vpmax_f32(t_near, t_near);
+  float32x2_t t_far = vpmin_f32(vget_low_f32(exits), vget_high_f32(exits));
+  t_far = vpmin_f32(t_far, t_far);
+  return std::max(vget_lane_f32(t_near, 0), 0.0f) <=
+         std::min(vget_lane_f32(t_far, 0), 1.0f);
+}
+#elif defined(TANGO_GL_OBB_SSE2)
+bool IntersectSlabs(const float start[4], const float inverse_direction[4],
+                    const float half_extent[4]) {
+  const __m128 s = _mm_loadu_ps(start);
+  const __m128 inverse = _mm_loadu_ps(inverse_direction);
+  const __m128 h = _mm_loadu_ps(half_extent);
+  const __m128 t0 =
+      _mm_mul_ps(_mm_sub_ps(_mm_sub_ps(_mm_setzero_ps(), h), s), inverse);
+  const __m128 t1 = _mm_mul_ps(_mm_sub_ps(h, s), inverse);
+  __m128 entries = _mm_min_ps(t0, t1);
+  __m128 exits = _mm_max_ps(t0, t1);
+  // The largest entry and smallest exit over the lanes.
+  entries = _mm_max_ps(
+      entries, _mm_shuffle_ps(entries, entries, _MM_SHUFFLE(2, 3, 0, 1)));
+  entries = _mm_max_ps(
+      entries, _mm_shuffle_ps(entries, entries, _MM_SHUFFLE(1, 0, 3, 2)));
+  exits = _mm_min_ps(exits,
+                     _mm_shuffle_ps(exits, exits, _MM_SHUFFLE(2, 3, 0, 1)));
+  exits = _mm_min_ps(exits,
+                     _mm_shuffle_ps(exits, exits, _MM_SHUFFLE(1, 0, 3, 2)));
+  return std::max(_mm_cvtss_f32(entries), 0.0f) <=
+         std::min(_mm_cvtss_f32(exits), 1.0f);
+}
+#else
+bool IntersectSlabs(const float start[4], const float inverse_direction[4],
+                    const float half_extent[4]) {
+  float t_near = 0.0f;
+  float t_far = 1.0f;
+  for (int axis = 0; axis < 4; ++axis) {
+    const float t0 =
+        (-half_extent[axis] - start[axis]) * inverse_direction[axis];
+    const float t1 =
+        (half_extent[axis] - start[axis]) * inverse_direction[axis];
+    t_near = std::max(t_near, std::min(t0, t1));
+    t_far = std::min(t_far, std::max(t0, t1));
+  }
+  return t_near <= t_far;
+}
+#endif
+}  // namespace
+
+namespace tango_gl {
+
+OrientedBoundingBox::OrientedBoundingBox()
+    : center_(0.0f, 0.0f, 0.0f), half_extent_(0.0f, 0.0f, 0.0f),
+      radius_(0.0f) {
+  axes_[0] = glm::vec3(1.0f, 0.0f, 0.0f);
+  axes_[1] = glm::vec3(0.0f, 1.0f, 0.0f);
+  axes_[2] = glm::vec3(0.0f, 0.0f, 1.0f);
+}
+
+OrientedBoundingBox::OrientedBoundingBox(const BoundingBox& box)
+    : OrientedBoundingBox() {
+  center_ = box.GetCenter();
+  half_extent_ = (box.GetMax() - box.GetMin()) * 0.5f;
+  radius_ = glm::length(half_extent_);
+}
+
+OrientedBoundingBox::OrientedBoundingBox(const std::vector<float>& vertices)
+    : OrientedBoundingBox() {
+  Fit(vertices.data(), vertices.size() / 3, 3);
+}
+
+OrientedBoundingBox::OrientedBoundingBox(
+    const std::vector<glm::vec3>& vertices)
+    : OrientedBoundingBox() {
+  Fit(vertices.empty() ? NULL : &vertices[0].x, vertices.size(), 3);
+}
+
+void OrientedBoundingBox::Fit(const float* vertices, size_t count,
+                              size_t stride) {
+  if (count == 0) {
+    return;
+  }
+  glm::dvec3 sum(0.0);
+  glm::vec3 min(std::numeric_limits<float>::max());
+  glm::vec3 max(-std::numeric_limits<float>::max());
+  for (size_t i = 0; i < count; ++i) {
+    const glm::vec3 v(vertices[i * stride], vertices[i * stride + 1],
+                      vertices[i * stride + 2]);
+    sum += glm::dvec3(v);
+    min = glm::min(min, v);
+    max = glm::max(max, v);
+  }
+  const glm::vec3 mean(sum / static_cast<double>(count));
+  glm::mat3 covariance(0.0f);
+  for (size_t i = 0; i < count; ++i) {
+    const glm::vec3 d = glm::vec3(vertices[i * stride],
+                                  vertices[i * stride + 1],
+                                  vertices[i * stride + 2]) - mean;
+    covariance += glm::outerProduct(d, d);
+  }
+
+  const glm::mat3 eigenvectors = GetEigenvectors(covariance);
+  glm::vec3 axes[3] = {eigenvectors[0], eigenvectors[1], eigenvectors[2]};
+  Orthonormalize(axes);
+  glm::vec3 local_min(std::numeric_limits<float>::max());
+  glm::vec3 local_max(-std::numeric_limits<float>::max());
+  for (size_t i = 0; i < count; ++i) {
+    const glm::vec3 d = glm::vec3(vertices[i * stride],
+                                  vertices[i * stride + 1],
+                                  vertices[i * stride + 2]) - mean;
+    const glm::vec3 local(glm::dot(d, axes[0]), glm::dot(d, axes[1]),
+                          glm::dot(d, axes[2]));
+    local_min = glm::min(local_min, local);
+    local_max = glm::max(local_max, local);
+  }
+
+  const glm::vec3 size = max - min;
+  const glm::vec3 local_size = local_max - local_min;
+  if (local_size.x * local_size.y * local_size.z <
+      size.x * size.y * size.z) {
+    const glm::vec3 local_center = (local_min + local_max) * 0.5f;
+    center_ = mean + axes[0] * local_center.x + axes[1] * local_center.y +
+              axes[2] * local_center.z;
+    for (int axis = 0; axis < 3; ++axis) {
+      axes_[axis] = axes[axis];
+    }
+    half_extent_ = local_size * 0.5f;
+  } else {
+    center_ = (min + max) * 0.5f;
+    half_extent_ = size * 0.5f;
+  }
+
+  float radius_squared = 0.0f;
+  for (size_t i = 0; i < count; ++i) {
+    const glm::vec3 d = glm::vec3(vertices[i * stride],
+                                  vertices[i * stride + 1],
+                                  vertices[i * stride + 2]) - center_;
+    radius_squared = std::max(radius_squared, glm::dot(d, d));
+  }
+  radius_ = std::min(std::sqrt(radius_squared), glm::length(half_extent_));
+}
+
+OrientedBoundingBox OrientedBoundingBox::GetTransformed(
+    const glm::mat4& transformation) const {
+  const glm::mat3 linear(transformation);
+  OrientedBoundingBox box;
+  box.center_ = glm::vec3(transformation * glm::vec4(center_, 1.0f));
+  // The transformed edges are orthogonal for a rotation and a uniform scale.
+  // Otherwise the box is along the first of them, around all three.
+  glm::vec3 edges[3];
+  float max_scale = 0.0f;
+  for (int axis = 0; axis < 3; ++axis) {
+    edges[axis] = linear * axes_[axis];
+    max_scale = std::max(max_scale, glm::length(edges[axis]));
+    box.axes_[axis] = edges[axis];
+  }
+  Orthonormalize(box.axes_);
+  for (int axis = 0; axis < 3; ++axis) {
+    float half_extent = 0.0f;
+    for (int edge = 0; edge < 3; ++edge) {
+      half_extent += std::fabs(glm::dot(box.axes_[axis], edges[edge])) *
+                     half_extent_[edge];
+    }
+    box.half_extent_[axis] = half_extent;
+  }
+  box.radius_ =
+      std::min(radius_ * max_scale, glm::length(box.half_extent_));
+  return box;
+}
+
+BoundingBox OrientedBoundingBox::GetAxisAligned() const {
+  glm::vec3 half_extent(0.0f, 0.0f, 0.0f);
+  for (int axis = 0; axis < 3; ++axis) {
+    half_extent += glm::abs(axes_[axis]) * half_extent_[axis];
+  }
+  return BoundingBox(center_ - half_extent, center_ + half_extent);
+}
+
+bool OrientedBoundingBox::IsIntersecting(const Segment& segment) const {
+  const glm::vec3 direction = segment.end - segment.start;
+  const glm::vec3 to_center = center_ - segment.start;
+  // The point of the segment nearest to the center, out of the sphere.
+  const float length_squared = glm::dot(direction, direction);
+  const float t =
+      length_squared > 0.0f
+          ? util::Clamp(glm::dot(to_center, direction) / length_squared, 0.0f,
+                        1.0f)
+          : 0.0f;
+  const glm::vec3 offset = to_center - direction * t;
+  if (glm::dot(offset, offset) > radius_ * radius_) {
+    return false;
+  }
+
+  float start[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+  float inverse_direction[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+  const float half_extent[4] = {half_extent_.x, half_extent_.y,
+                                half_extent_.z, 1.0f};
+  for (int axis = 0; axis < 3; ++axis) {
+    start[axis] = -glm::dot(to_center, axes_[axis]);
+    float d = glm::dot(direction, axes_[axis]);
+    if (std::fabs(d) < kMinDirection) {
+      d = d < 0.0f ? -kMinDirection : kMinDirection;
+    }
+    inverse_direction[axis] = 1.0f / d;
+  }
+  return IntersectSlabs(start, inverse_direction, half_extent);
+}
+}  // namespace tango_gl
@@ -0,0 +1,221 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-gl/overlay_target.h"
+
+#include <algorithm>
+
+#include "tango-gl/gl_state.h"
+#include "tango-gl/render_statistics.h"
+#include "tango-gl/tracing.h"
+
+namespace {
+// The framebuffer is bottom-up and the quad's texture coordinates top-down,
+// so the rows are flipped back.
+const char kVertexShader[] =
+    "attribute vec4 vertex;\n"
+    "attribute vec2 textureCoords;\n"
+    "varying vec2 uv;\n"
+    "void main() {\n"
+    "  gl_Position = vertex;\n"
+    "  uv = vec2(textureCoords.x, 1.0 - textureCoords.y);\n"
+    "}\n";
+
+const char kFragmentShader[] =
+    "precision mediump float;\n"
+    "uniform sampler2D overlay;\n"
+    "varying vec2 uv;\n"
+    "void main() {\n"
+    "  gl_FragColor = texture2D(overlay, uv);\n"
+    "}\n";
+
+// Bytes per pixel of the 16 bit depth buffer.
+const size_t kDepthBytesPerPixel = 2;
+}  // namespace
+
+namespace tango_gl {
+
+const float OverlayTarget::kMinScale = 0.25f;
+
+OverlayTarget::OverlayTarget()
+    : scale_(1.0f),
+      is_active_(false),
+      program_(0),
+      texture_location_(-1),
+      framebuffer_(0),
+      color_texture_(0),
+      depth_renderbuffer_(0),
+      framebuffer_width_(0),
+      framebuffer_height_(0),
+      gpu_memory_(kMemoryTagTexture, kMemoryGpu),
+      previous_framebuffer_(0) {}
+
+OverlayTarget::~OverlayTarget() {}
+
+void OverlayTarget::SetScale(float scale) {
+  scale_ = std::min(std::max(scale, kMinScale), 1.0f);
+}
+
+bool OverlayTarget::InitializeFramebuffer(GLsizei width, GLsizei height) {
+  if (program_ == 0) {
+    program_ = util::CreateProgram(kVertexShader, kFragmentShader);
+    if (program_ == 0) {
+      LOGE("OverlayTarget: could not create the program");
+      return false;
+    }
+    texture_location_ = glGetUniformLocation(program_, "overlay");
+    quad_.SetAttributeLocations(glGetAttribLocation(program_, "vertex"),
+                                glGetAttribLocation(program_, "textureCoords"));
+  }
+  if (framebuffer_ != 0 && width == framebuffer_width_ &&
+      height == framebuffer_height_) {
+    return true;
+  }
+  if (framebuffer_ == 0) {
+    glGenFramebuffers(1, &framebuffer_);
+    glGenTextures(1, &color_texture_);
+    glGenRenderbuffers(1, &depth_renderbuffer_);
+  }
+  // Upscaled with bilinear filtering when composited.
+  CountRender(kRenderCounterTextureBinds);
+  glBindTexture(GL_TEXTURE_2D, color_texture_);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA,
+               GL_UNSIGNED_BYTE, NULL);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glBindRenderbuffer(GL_RENDERBUFFER, depth_renderbuffer_);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT16, width, height);
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+  gpu_memory_.Set(
+      EstimateTextureBytes(width, height, GL_RGBA, GL_UNSIGNED_BYTE) +
+      static_cast<size_t>(width) * height * kDepthBytesPerPixel);
+
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                         color_texture_, 0);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                            GL_RENDERBUFFER, depth_renderbuffer_);
+  const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+  glBindFramebuffer(GL_FRAMEBUFFER, previous_framebuffer_);
+  if (status != GL_FRAMEBUFFER_COMPLETE) {
+    LOGE("OverlayTarget: incomplete framebuffer 0x%x", status);
+    framebuffer_width_ = 0;
+    framebuffer_height_ = 0;
+    return false;
+  }
+  framebuffer_width_ = width;
+  framebuffer_height_ = height;
+  util::CheckGlError("OverlayTarget::InitializeFramebuffer");
+  return true;
+}
+
+bool OverlayTarget::Begin() {
+  is_active_ = false;
+  if (scale_ >= 1.0f) {
+    return false;
+  }
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous_framebuffer_);
+  glGetIntegerv(GL_VIEWPORT, previous_viewport_);
+  const GLsizei width = std::max(
+      static_cast<GLsizei>(previous_viewport_[2] * scale_ + 0.5f), 1);
+  const GLsizei height = std::max(
+      static_cast<GLsizei>(previous_viewport_[3] * scale_ + 0.5f), 1);
+  if (!InitializeFramebuffer(width, height)) {
+    return false;
+  }
+
+  TANGO_TRACE_SCOPE("OverlayTarget::Begin");
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+  glViewport(0, 0, framebuffer_width_, framebuffer_height_);
+  GLfloat previous_clear_color[4];
+  glGetFloatv(GL_COLOR_CLEAR_VALUE, previous_clear_color);
+  glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+  GlState::DepthMask(GL_TRUE);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  glClearColor(previous_clear_color[0], previous_clear_color[1],
+               previous_clear_color[2], previous_clear_color[3]);
+  is_active_ = true;
+  return true;
+}
+
+void OverlayTarget::End() {
+  if (!is_active_) {
+    return;
+  }
+  is_active_ = false;
+  TANGO_TRACE_SCOPE("OverlayTarget::End");
+  glBindFramebuffer(GL_FRAMEBUFFER, previous_framebuffer_);
+  glViewport(previous_viewport_[0], previous_viewport_[1],
+             previous_viewport_[2], previous_viewport_[3]);
+
+  const bool was_depth_test_enabled = glIsEnabled(GL_DEPTH_TEST) == GL_TRUE;
+  const bool was_blend_enabled = glIsEnabled(GL_BLEND) == GL_TRUE;
+  GLint previous_source_factor = GL_ONE;
+  GLint previous_destination_factor = GL_ZERO;
+  glGetIntegerv(GL_BLEND_SRC_RGB, &previous_source_factor);
+  glGetIntegerv(GL_BLEND_DST_RGB, &previous_destination_factor);
+
+  GlState::Disable(GL_DEPTH_TEST);
+  GlState::Enable(GL_BLEND);
+  GlState::BlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+  GlState::UseProgram(program_);
+  glUniform1i(texture_location_, 0);
+  glActiveTexture(GL_TEXTURE0);
+  CountRender(kRenderCounterTextureBinds);
+  glBindTexture(GL_TEXTURE_2D, color_texture_);
+  quad_.Draw();
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  GlState::BlendFunc(previous_source_factor, previous_destination_factor);
+  if (!was_blend_enabled) {
+    GlState::Disable(GL_BLEND);
+  }
+  if (was_depth_test_enabled) {
+    GlState::Enable(GL_DEPTH_TEST);
+  }
+  util::CheckGlError("OverlayTarget::End");
+}
+
+void OverlayTarget::DeleteGlResources() {
+  if (framebuffer_ != 0) {
+    glDeleteFramebuffers(1, &framebuffer_);
+    glDeleteTextures(1, &color_texture_);
+    glDeleteRenderbuffers(1, &depth_renderbuffer_);
+  }
+  if (program_ != 0) {
+    GlState::DeleteProgram(program_);
+  }
+  quad_.DeleteGlResources();
+  InvalidateGlResources();
+}
+
+void OverlayTarget::InvalidateGlResources() {
+  quad_.InvalidateGlResources();
+  program_ = 0;
+  texture_location_ = -1;
+  framebuffer_ = 0;
+  color_texture_ = 0;
+  depth_renderbuffer_ = 0;
+  framebuffer_width_ = 0;
+  framebuffer_height_ = 0;
+  gpu_memory_.Set(0);
+  is_active_ = false;
+}
+
+}  // namespace tango_gl
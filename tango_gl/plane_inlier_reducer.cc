@@ -0,0 +1,372 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-gl/plane_inlier_reducer.h"
+
+#include <cstdio>
+#include <string>
+
+#include "tango-gl/gl_state.h"
+#include "tango-gl/render_statistics.h"
+
+namespace {
+// GLES 3.0 and 3.1 enums, which gl2.h does not define.
+const GLenum kShaderStorageBuffer = 0x90D2;
+const GLenum kDynamicRead = 0x88E9;
+const GLenum kDynamicCopy = 0x88EA;
+const GLbitfield kShaderStorageBarrierBit = 0x2000;
+const GLbitfield kBufferUpdateBarrierBit = 0x0200;
+const GLbitfield kMapReadBit = 0x0001;
+
+// Reductions in flight before their results must be available, older ones
+// are dropped rather than waited for.
+const size_t kReductionLatency = 4;
+
+// Work groups of the classification, each summing its points into one
+// partial sum, and invocations per work group. Both are powers of two, and
+// the partial sums are summed by a single work group of kGroupCount
+// invocations.
+const int kGroupCount = 64;
+const int kGroupSize = 128;
+
+// A sum is 3 vec4: the count and the sum of the offsets to the origin, then
+// the 6 distinct sums of their products.
+const int kSumVectorCount = 3;
+const GLsizeiptr kSumSize = kSumVectorCount * 4 * sizeof(GLfloat);
+
+// Tree reduction of the sums of the invocations of a work group into the
+// first of them, shared by both programs.
+const char kShaderHeader[] =
+    "#version 310 es\n"
+    "layout(local_size_x = %d) in;\n"
+    "shared vec4 sums[%d];\n"
+    "void ReduceSums(vec4 s0, vec4 s1, vec4 s2) {\n"
+    "  uint local = gl_LocalInvocationID.x;\n"
+    "  sums[3u * local] = s0;\n"
+    "  sums[3u * local + 1u] = s1;\n"
+    "  sums[3u * local + 2u] = s2;\n"
+    "  memoryBarrierShared();\n"
+    "  barrier();\n"
+    "  for (uint width = gl_WorkGroupSize.x / 2u; width > 0u;\n"
+    "       width /= 2u) {\n"
+    "    if (local < width) {\n"
+    "      for (uint k = 0u; k < 3u; ++k) {\n"
+    "        sums[3u * local + k] += sums[3u * (local + width) + k];\n"
+    "      }\n"
+    "    }\n"
+    "    memoryBarrierShared();\n"
+    "    barrier();\n"
+    "  }\n"
+    "}\n";
+
+const char kClassifyShader[] =
+    "layout(std430, binding = 0) readonly buffer Points {\n"
+    "  float points[];\n"
+    "};\n"
+    "layout(std430, binding = 1) writeonly buffer Partials {\n"
+    "  vec4 partials[];\n"
+    "};\n"
+    "uniform int point_count;\n"
+    "uniform mat4 frame_T_points;\n"
+    "uniform vec4 plane;\n"
+    "uniform float distance;\n"
+    "uniform vec3 origin;\n"
+    "void main() {\n"
+    "  vec4 s0 = vec4(0.0);\n"
+    "  vec4 s1 = vec4(0.0);\n"
+    "  vec4 s2 = vec4(0.0);\n"
+    "  uint stride = gl_NumWorkGroups.x * gl_WorkGroupSize.x;\n"
+    "  for (uint i = gl_GlobalInvocationID.x; i < uint(point_count);\n"
+    "       i += stride) {\n"
+    "    vec3 point = (frame_T_points * vec4(points[3u * i],\n"
+    "                  points[3u * i + 1u], points[3u * i + 2u], 1.0)).xyz;\n"
+    "    if (abs(dot(plane.xyz, point) + plane.w) < distance) {\n"
+    "      vec3 o = point - origin;\n"
+    "      s0 += vec4(1.0, o);\n"
+    "      s1 += vec4(o.x * o.x, o.x * o.y, o.x * o.z, o.y * o.y);\n"
+    "      s2 += vec4(o.y * o.z, o.z * o.z, 0.0, 0.0);\n"
+    "    }\n"
+    "  }\n"
+    "  ReduceSums(s0, s1, s2);\n"
+    "  if (gl_LocalInvocationID.x == 0u) {\n"
+    "    for (uint k = 0u; k < 3u; ++k) {\n"
+    "      partials[3u * gl_WorkGroupID.x + k] = sums[k];\n"
+    "    }\n"
+    "  }\n"
+    "}\n";
+
+const char kSumShader[] =
+    "layout(std430, binding = 1) readonly buffer Partials {\n"
+    "  vec4 partials[];\n"
+    "};\n"
+    "layout(std430, binding = 2) writeonly buffer Result {\n"
+    "  vec4 result[];\n"
+    "};\n"
+    "void main() {\n"
+    "  uint local = gl_LocalInvocationID.x;\n"
+    "  ReduceSums(partials[3u * local], partials[3u * local + 1u],\n"
+    "             partials[3u * local + 2u]);\n"
+    "  if (local == 0u) {\n"
+    "    for (uint k = 0u; k < 3u; ++k) {\n"
+    "      result[k] = sums[k];\n"
+    "    }\n"
+    "  }\n"
+    "}\n";
+
+// The source of a program of |group_size| invocations per work group.
+std::string GetShaderSource(int group_size, const char* main_source) {
+  char header[sizeof(kShaderHeader) + 32];
+  snprintf(header, sizeof(header), kShaderHeader, group_size,
+           kSumVectorCount * group_size);
+  return std::string(header) + main_source;
+}
+}  // namespace
+
+namespace tango_gl {
+
+PlaneInlierReducer::PlaneInlierReducer()
+    : gl_initialized_(false),
+      is_supported_(false),
+      dispatch_compute_(NULL),
+      memory_barrier_(NULL),
+      bind_buffer_base_(NULL),
+      map_buffer_range_(NULL),
+      unmap_buffer_(NULL),
+      fence_sync_(NULL),
+      client_wait_sync_(NULL),
+      delete_sync_(NULL),
+      classify_program_(0),
+      sum_program_(0),
+      point_count_location_(-1),
+      frame_T_points_location_(-1),
+      plane_location_(-1),
+      distance_location_(-1),
+      origin_location_(-1),
+      partial_buffer_(0),
+      next_reduction_(0),
+      last_centroid_(0.0f),
+      has_last_centroid_(false) {}
+
+PlaneInlierReducer::~PlaneInlierReducer() {}
+
+void PlaneInlierReducer::InitializeGl() {
+  if (gl_initialized_) {
+    return;
+  }
+  gl_initialized_ = true;
+  is_supported_ = false;
+  const util::GlCapabilities& gl = util::GetGlCapabilities();
+  if (!gl.IsGles31()) {
+    LOGI("PlaneInlierReducer: compute shaders are not supported");
+    return;
+  }
+
+  dispatch_compute_ = gl.dispatch_compute;
+  memory_barrier_ = gl.memory_barrier;
+  bind_buffer_base_ = gl.bind_buffer_base;
+  map_buffer_range_ = gl.map_buffer_range;
+  unmap_buffer_ = gl.unmap_buffer;
+  fence_sync_ = gl.fence_sync;
+  client_wait_sync_ = gl.client_wait_sync;
+  delete_sync_ = gl.delete_sync;
+  if (dispatch_compute_ == NULL || memory_barrier_ == NULL ||
+      bind_buffer_base_ == NULL || map_buffer_range_ == NULL ||
+      unmap_buffer_ == NULL || fence_sync_ == NULL ||
+      client_wait_sync_ == NULL || delete_sync_ == NULL) {
+    LOGE("PlaneInlierReducer: GLES 3.1 entry points are missing");
+    return;
+  }
+
+  classify_program_ = util::CreateComputeProgram(
+      GetShaderSource(kGroupSize, kClassifyShader).c_str());
+  sum_program_ = util::CreateComputeProgram(
+      GetShaderSource(kGroupCount, kSumShader).c_str());
+  if (classify_program_ == 0 || sum_program_ == 0) {
+    DeleteGlResources();
+    gl_initialized_ = true;
+    return;
+  }
+  point_count_location_ =
+      glGetUniformLocation(classify_program_, "point_count");
+  frame_T_points_location_ =
+      glGetUniformLocation(classify_program_, "frame_T_points");
+  plane_location_ = glGetUniformLocation(classify_program_, "plane");
+  distance_location_ = glGetUniformLocation(classify_program_, "distance");
+  origin_location_ = glGetUniformLocation(classify_program_, "origin");
+
+  glGenBuffers(1, &partial_buffer_);
+  GlState::BindBuffer(kShaderStorageBuffer, partial_buffer_);
+  glBufferData(kShaderStorageBuffer, kGroupCount * kSumSize, NULL,
+               kDynamicCopy);
+  reductions_.resize(kReductionLatency);
+  for (Reduction& reduction : reductions_) {
+    glGenBuffers(1, &reduction.result_buffer);
+    GlState::BindBuffer(kShaderStorageBuffer, reduction.result_buffer);
+    glBufferData(kShaderStorageBuffer, kSumSize, NULL, kDynamicRead);
+    reduction.fence = NULL;
+  }
+  GlState::BindBuffer(kShaderStorageBuffer, 0);
+  next_reduction_ = 0;
+  is_supported_ = true;
+  util::CheckGlError("PlaneInlierReducer::InitializeGl");
+}
+
+void PlaneInlierReducer::Reduce(GLuint points_buffer, uint32_t point_count,
+                                const glm::mat4& frame_T_points,
+                                const glm::vec4& plane, float distance) {
+  InitializeGl();
+  if (!is_supported_ || point_count == 0) {
+    return;
+  }
+
+  // A reduction whose result is still not available after kReductionLatency
+  // others is dropped.
+  Reduction& reduction = reductions_[next_reduction_];
+  next_reduction_ = (next_reduction_ + 1) % reductions_.size();
+  if (reduction.fence != NULL) {
+    delete_sync_(reduction.fence);
+    reduction.fence = NULL;
+  }
+  reduction.plane = plane;
+  // The sums are taken around a point close to the inliers, so that they stay
+  // small enough for float precision.
+  const glm::vec3 normal(plane);
+  if (has_last_centroid_) {
+    reduction.origin =
+        last_centroid_ - normal * (glm::dot(normal, last_centroid_) + plane.w);
+  } else {
+    reduction.origin = -normal * plane.w;
+  }
+
+  GlState::UseProgram(classify_program_);
+  glUniform1i(point_count_location_, static_cast<GLint>(point_count));
+  glUniformMatrix4fv(frame_T_points_location_, 1, GL_FALSE,
+                     glm::value_ptr(frame_T_points));
+  glUniform4fv(plane_location_, 1, glm::value_ptr(plane));
+  glUniform1f(distance_location_, distance);
+  glUniform3fv(origin_location_, 1, glm::value_ptr(reduction.origin));
+  bind_buffer_base_(kShaderStorageBuffer, 0, points_buffer);
+  bind_buffer_base_(kShaderStorageBuffer, 1, partial_buffer_);
+  bind_buffer_base_(kShaderStorageBuffer, 2, reduction.result_buffer);
+  dispatch_compute_(kGroupCount, 1, 1);
+  memory_barrier_(kShaderStorageBarrierBit);
+
+  GlState::UseProgram(sum_program_);
+  dispatch_compute_(1, 1, 1);
+  // The result is read with glMapBufferRange().
+  memory_barrier_(kBufferUpdateBarrierBit);
+  reduction.fence =
+      fence_sync_(util::GlCapabilities::kSyncGpuCommandsComplete, 0);
+
+  for (GLuint binding = 0; binding < 3; ++binding) {
+    bind_buffer_base_(kShaderStorageBuffer, binding, 0);
+  }
+  GlState::UseProgram(0);
+  util::CheckGlError("PlaneInlierReducer::Reduce");
+}
+
+bool PlaneInlierReducer::GetLatestInliers(PlaneInliers* inliers) {
+  if (!is_supported_) {
+    return false;
+  }
+  bool has_inliers = false;
+  // Reductions finish in order, oldest first, so the later ones are not done
+  // when one is not.
+  for (size_t i = 0; i < reductions_.size(); ++i) {
+    Reduction& reduction =
+        reductions_[(next_reduction_ + i) % reductions_.size()];
+    if (reduction.fence == NULL) {
+      continue;
+    }
+    const GLenum status = client_wait_sync_(
+        reduction.fence, util::GlCapabilities::kSyncFlushCommandsBit, 0);
+    if (status != util::GlCapabilities::kAlreadySignaled &&
+        status != util::GlCapabilities::kConditionSatisfied) {
+      break;
+    }
+    delete_sync_(reduction.fence);
+    reduction.fence = NULL;
+    if (ReadReduction(reduction, inliers)) {
+      has_inliers = true;
+    }
+  }
+  if (has_inliers) {
+    last_centroid_ = inliers->centroid;
+    has_last_centroid_ = true;
+  }
+  return has_inliers;
+}
+
+bool PlaneInlierReducer::ReadReduction(const Reduction& reduction,
+                                       PlaneInliers* inliers) {
+  GlState::BindBuffer(kShaderStorageBuffer, reduction.result_buffer);
+  const GLfloat* sums = static_cast<const GLfloat*>(
+      map_buffer_range_(kShaderStorageBuffer, 0, kSumSize, kMapReadBit));
+  if (sums == NULL) {
+    GlState::BindBuffer(kShaderStorageBuffer, 0);
+    util::CheckGlError("PlaneInlierReducer::ReadReduction");
+    return false;
+  }
+  const float count = sums[0];
+  const glm::vec3 sum(sums[1], sums[2], sums[3]);
+  glm::mat3 products;
+  products[0] = glm::vec3(sums[4], sums[5], sums[6]);
+  products[1] = glm::vec3(sums[5], sums[7], sums[8]);
+  products[2] = glm::vec3(sums[6], sums[8], sums[9]);
+  unmap_buffer_(kShaderStorageBuffer);
+  GlState::BindBuffer(kShaderStorageBuffer, 0);
+
+  if (count < 1.0f) {
+    return false;
+  }
+  const glm::vec3 mean = sum / count;
+  inliers->plane = reduction.plane;
+  inliers->count = static_cast<uint32_t>(count);
+  inliers->centroid = reduction.origin + mean;
+  inliers->covariance = products / count - glm::outerProduct(mean, mean);
+  return true;
+}
+
+void PlaneInlierReducer::DeleteGlResources() {
+  if (classify_program_ != 0) {
+    GlState::DeleteProgram(classify_program_);
+  }
+  if (sum_program_ != 0) {
+    GlState::DeleteProgram(sum_program_);
+  }
+  if (partial_buffer_ != 0) {
+    GlState::DeleteBuffers(1, &partial_buffer_);
+  }
+  for (Reduction& reduction : reductions_) {
+    GlState::DeleteBuffers(1, &reduction.result_buffer);
+    if (reduction.fence != NULL) {
+      delete_sync_(reduction.fence);
+    }
+  }
+  InvalidateGlResources();
+}
+
+void PlaneInlierReducer::InvalidateGlResources() {
+  classify_program_ = 0;
+  sum_program_ = 0;
+  partial_buffer_ = 0;
+  reductions_.clear();
+  next_reduction_ = 0;
+  has_last_centroid_ = false;
+  gl_initialized_ = false;
+  is_supported_ = false;
+}
+}  // namespace tango_gl
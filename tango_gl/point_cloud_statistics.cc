@@ -0,0 +1,165 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-gl/point_cloud_statistics.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define TANGO_GL_STATISTICS_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define TANGO_GL_STATISTICS_SSE2 1
+#endif
+
+namespace tango_gl {
+
+PointCloudStatistics::PointCloudStatistics() { Clear(); }
+
+void PointCloudStatistics::Clear() {
+  count = 0;
+  min = glm::vec3(0.0f);
+  max = glm::vec3(0.0f);
+  mean = glm::vec3(0.0f);
+  variance = glm::vec3(0.0f);
+  memset(depth_histogram, 0, sizeof(depth_histogram));
+}
+
+float PointCloudStatistics::GetDepthPercentile(float fraction) const {
+  uint32_t total = 0;
+  for (int bin = 0; bin < kDepthBins; ++bin) {
+    total += depth_histogram[bin];
+  }
+  if (total == 0) {
+    return min.z;
+  }
+  const float target = std::min(std::max(fraction, 0.0f), 1.0f) * total;
+  const float bin_depth = (max.z - min.z) / kDepthBins;
+  uint32_t below = 0;
+  for (int bin = 0; bin < kDepthBins; ++bin) {
+    const uint32_t in_bin = depth_histogram[bin];
+    if (in_bin > 0 && below + in_bin >= target) {
+      return min.z + (bin + (target - below) / in_bin) * bin_depth;
+    }
+    below += in_bin;
+  }
+  return max.z;
+}
+
+void GetPointCloudStatistics(const float* xyz, int count,
+                             PointCloudStatistics* statistics) {
+  statistics->Clear();
+  if (count <= 0) {
+    return;
+  }
+  // The sums are of the points relative to the first one, which keeps the
+  // squares small and the variance from cancelling out in float.
+  const glm::vec3 shift(xyz[0], xyz[1], xyz[2]);
+  glm::vec3 min = shift;
+  glm::vec3 max = shift;
+  glm::vec3 sum(0.0f);
+  glm::vec3 sum_squares(0.0f);
+  int i = 0;
+#if defined(TANGO_GL_STATISTICS_NEON)
+  float32x4x3_t min_4;
+  float32x4x3_t max_4;
+  float32x4x3_t sum_4;
+  float32x4x3_t sum_squares_4;
+  float32x4_t shift_4[3];
+  for (int c = 0; c < 3; ++c) {
+    shift_4[c] = vdupq_n_f32(shift[c]);
+    min_4.val[c] = shift_4[c];
+    max_4.val[c] = shift_4[c];
+    sum_4.val[c] = vdupq_n_f32(0.0f);
+    sum_squares_4.val[c] = vdupq_n_f32(0.0f);
+  }
+  for (; i + 4 <= count; i += 4) {
+    const float32x4x3_t points = vld3q_f32(xyz + i * 3);
+    for (int c = 0; c < 3; ++c) {
+      min_4.val[c] = vminq_f32(min_4.val[c], points.val[c]);
+      max_4.val[c] = vmaxq_f32(max_4.val[c], points.val[c]);
+      const float32x4_t shifted = vsubq_f32(points.val[c], shift_4[c]);
+      sum_4.val[c] = vaddq_f32(sum_4.val[c], shifted);
+      sum_squares_4.val[c] = vmlaq_f32(sum_squares_4.val[c], shifted, shifted);
+    }
+  }
+  for (int c = 0; c < 3; ++c) {
+    float min_lanes[4];
+    float max_lanes[4];
+    float sum_lanes[4];
+    float sum_squares_lanes[4];
+    vst1q_f32(min_lanes, min_4.val[c]);
+    vst1q_f32(max_lanes, max_4.val[c]);
+    vst1q_f32(sum_lanes, sum_4.val[c]);
+    vst1q_f32(sum_squares_lanes, sum_squares_4.val[c]);
+    min[c] = *std::min_element(min_lanes, min_lanes + 4);
+    max[c] = *std::max_element(max_lanes, max_lanes + 4);
+    sum[c] = (sum_lanes[0] + sum_lanes[1]) + (sum_lanes[2] + sum_lanes[3]);
+    sum_squares[c] = (sum_squares_lanes[0] + sum_squares_lanes[1]) +
+                     (sum_squares_lanes[2] + sum_squares_lanes[3]);
+  }
+#elif defined(TANGO_GL_STATISTICS_SSE2)
+  // One point per iteration, the fourth lane reads the x of the next point
+  // and is ignored, so the last point is left to the scalar loop.
+  const __m128 shift_4 = _mm_setr_ps(shift.x, shift.y, shift.z, 0.0f);
+  __m128 min_4 = shift_4;
+  __m128 max_4 = shift_4;
+  __m128 sum_4 = _mm_setzero_ps();
+  __m128 sum_squares_4 = _mm_setzero_ps();
+  for (; i + 1 < count; ++i) {
+    const __m128 point = _mm_loadu_ps(xyz + i * 3);
+    min_4 = _mm_min_ps(min_4, point);
+    max_4 = _mm_max_ps(max_4, point);
+    const __m128 shifted = _mm_sub_ps(point, shift_4);
+    sum_4 = _mm_add_ps(sum_4, shifted);
+    sum_squares_4 = _mm_add_ps(sum_squares_4, _mm_mul_ps(shifted, shifted));
+  }
+  float min_lanes[4];
+  float max_lanes[4];
+  float sum_lanes[4];
+  float sum_squares_lanes[4];
+  _mm_storeu_ps(min_lanes, min_4);
+  _mm_storeu_ps(max_lanes, max_4);
+  _mm_storeu_ps(sum_lanes, sum_4);
+  _mm_storeu_ps(sum_squares_lanes, sum_squares_4);
+  min = glm::vec3(min_lanes[0], min_lanes[1], min_lanes[2]);
+  max = glm::vec3(max_lanes[0], max_lanes[1], max_lanes[2]);
+  sum = glm::vec3(sum_lanes[0], sum_lanes[1], sum_lanes[2]);
+  sum_squares = glm::vec3(sum_squares_lanes[0], sum_squares_lanes[1],
+                          sum_squares_lanes[2]);
+#endif
+  for (; i < count; ++i) {
+    const glm::vec3 point(xyz[i * 3], xyz[i * 3 + 1], xyz[i * 3 + 2]);
+    min = glm::min(min, point);
+    max = glm::max(max, point);
+    const glm::vec3 shifted = point - shift;
+    sum += shifted;
+    sum_squares += shifted * shifted;
+  }
+  const glm::vec3 shifted_mean = sum / static_cast<float>(count);
+  statistics->count = count;
+  statistics->min = min;
+  statistics->max = max;
+  statistics->mean = shift + shifted_mean;
+  statistics->variance =
+      glm::max(sum_squares / static_cast<float>(count) -
+                   shifted_mean * shifted_mean,
+               glm::vec3(0.0f));
+}
+
+}  // namespace tango_gl
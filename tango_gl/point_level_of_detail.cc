@@ -0,0 +1,78 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-gl/point_level_of_detail.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// 1 / golden ratio, the stride with the most even prefixes.
+const double kInverseGoldenRatio = 0.6180339887498949;
+
+// Default diameter of a point in meters.
+const float kDefaultPointSize = 0.02f;
+
+int GreatestCommonDivisor(int a, int b) {
+  while (b != 0) {
+    const int remainder = a % b;
+    a = b;
+    b = remainder;
+  }
+  return a;
+}
+}  // namespace
+
+namespace tango_gl {
+
+PointLevelOfDetail::PointLevelOfDetail()
+    : point_budget_(0),
+      point_size_(kDefaultPointSize),
+      point_size_scale_(0.0f) {}
+
+int PointLevelOfDetail::Update(int count, const glm::mat4& projection_mat,
+                               int viewport_height) {
+  if (count <= 0) {
+    return 0;
+  }
+  const int draw_count =
+      point_budget_ > 0 ? std::min(count, point_budget_) : count;
+  // The clip w of a point is its distance along the view axis, and
+  // projection_mat[1][1] maps a height at a distance of 1 to half the
+  // viewport. A subsample of 1 / n of the points covers as much with points
+  // sqrt(n) times wider.
+  point_size_scale_ = point_size_ * 0.5f * viewport_height *
+                      projection_mat[1][1] *
+                      std::sqrt(static_cast<float>(count) / draw_count);
+  return draw_count;
+}
+
+void PointLevelOfDetail::SetUniforms(GLint point_size_scale_location) const {
+  glUniform1f(point_size_scale_location, point_size_scale_);
+}
+
+int PointLevelOfDetail::GetShuffleStride(int count) {
+  if (count <= 2) {
+    return 1;
+  }
+  int stride = static_cast<int>(count * kInverseGoldenRatio + 0.5);
+  while (GreatestCommonDivisor(count, stride) != 1) {
+    ++stride;
+  }
+  return stride;
+}
+
+}  // namespace tango_gl
@@ -0,0 +1,283 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-gl/point_transform.h"
+
+#include <algorithm>
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define TANGO_GL_TRANSFORM_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define TANGO_GL_TRANSFORM_SSE2 1
+#endif
+
+namespace {
+// Points transformed by one iteration of the SIMD kernels.
+const int kSimdPointCount = 4;
+
+// See ProjectPoints(), anything this far off the image is rejected anyway.
+const float kMaxPixelCoordinate = 1 << 20;
+
+inline int32_t ToPixelCoordinate(float value) {
+  return static_cast<int32_t>(
+      std::min(std::max(value, -kMaxPixelCoordinate), kMaxPixelCoordinate));
+}
+
+inline float Dot(const float row[4], const float* point) {
+  return row[0] * point[0] + row[1] * point[1] + row[2] * point[2] + row[3];
+}
+
+#if defined(TANGO_GL_TRANSFORM_NEON)
+typedef float32x4_t Lanes;
+
+// The x, y and z of four points.
+struct Points4 {
+  Lanes x;
+  Lanes y;
+  Lanes z;
+};
+
+inline Lanes Splat(float value) { return vdupq_n_f32(value); }
+
+inline Points4 LoadPoints(const float* xyz) {
+  const float32x4x3_t points = vld3q_f32(xyz);
+  Points4 result;
+  result.x = points.val[0];
+  result.y = points.val[1];
+  result.z = points.val[2];
+  return result;
+}
+
+inline void StorePoints(const Points4& points, float* xyz) {
+  float32x4x3_t interleaved;
+  interleaved.val[0] = points.x;
+  interleaved.val[1] = points.y;
+  interleaved.val[2] = points.z;
+  vst3q_f32(xyz, interleaved);
+}
+
+inline Lanes Dot(const float row[4], const Points4& points) {
+  Lanes result = vdupq_n_f32(row[3]);
+  result = vmlaq_n_f32(result, points.x, row[0]);
+  result = vmlaq_n_f32(result, points.y, row[1]);
+  result = vmlaq_n_f32(result, points.z, row[2]);
+  return result;
+}
+
+// ARMv7 NEON has no division, the reciprocal estimate is refined with two
+// Newton-Raphson steps, which is accurate to float precision.
+inline Lanes Divide(Lanes numerator, Lanes denominator) {
+  Lanes inverse = vrecpeq_f32(denominator);
+  inverse = vmulq_f32(vrecpsq_f32(denominator, inverse), inverse);
+  inverse = vmulq_f32(vrecpsq_f32(denominator, inverse), inverse);
+  return vmulq_f32(numerator, inverse);
+}
+
+inline Lanes Clamp(Lanes value, Lanes min_value, Lanes max_value) {
+  return vmaxq_f32(vminq_f32(value, max_value), min_value);
+}
+
+inline void Store(Lanes value, float* destination) {
+  vst1q_f32(destination, value);
+}
+
+inline void StoreTruncated(Lanes value, int32_t* destination) {
+  vst1q_s32(destination, vcvtq_s32_f32(value));
+}
+#elif defined(TANGO_GL_TRANSFORM_SSE2)
+typedef __m128 Lanes;
+
+struct Points4 {
+  Lanes x;
+  Lanes y;
+  Lanes z;
+};
+
+inline Lanes Splat(float value) { return _mm_set1_ps(value); }
+
+// The points are transposed with shuffles, from and to
+//   a0 = x0 y0 z0 x1, a1 = y1 z1 x2 y2, a2 = z2 x3 y3 z3.
+inline Points4 LoadPoints(const float* xyz) {
+  const __m128 a0 = _mm_loadu_ps(xyz);
+  const __m128 a1 = _mm_loadu_ps(xyz + 4);
+  const __m128 a2 = _mm_loadu_ps(xyz + 8);
+  const __m128 x_high = _mm_shuffle_ps(a1, a2, _MM_SHUFFLE(1, 1, 2, 2));
+  const __m128 y_low = _mm_shuffle_ps(a0, a1, _MM_SHUFFLE(0, 0, 1, 1));
+  const __m128 y_high = _mm_shuffle_ps(a1, a2, _MM_SHUFFLE(2, 2, 3, 3));
+  const __m128 z_low = _mm_shuffle_ps(a0, a1, _MM_SHUFFLE(1, 1, 2, 2));
+  Points4 points;
+  points.x = _mm_shuffle_ps(a0, x_high, _MM_SHUFFLE(2, 0, 3, 0));
+  points.y = _mm_shuffle_ps(y_low, y_high, _MM_SHUFFLE(2, 0, 2, 0));
+  points.z = _mm_shuffle_ps(z_low, a2, _MM_SHUFFLE(3, 0, 2, 0));
+  return points;
+}
+
+inline void StorePoints(const Points4& points, float* xyz) {
+  const __m128 xy_low = _mm_unpacklo_ps(points.x, points.y);
+  const __m128 xy_high = _mm_unpackhi_ps(points.x, points.y);
+  const __m128 z0_x1 =
+      _mm_shuffle_ps(points.z, points.x, _MM_SHUFFLE(1, 1, 0, 0));
+  const __m128 y1_z1 =
+      _mm_shuffle_ps(points.y, points.z, _MM_SHUFFLE(1, 1, 1, 1));
+  const __m128 z2_x3 =
+      _mm_shuffle_ps(points.z, xy_high, _MM_SHUFFLE(2, 2, 2, 2));
+  const __m128 y3_z3 =
+      _mm_shuffle_ps(xy_high, points.z, _MM_SHUFFLE(3, 3, 3, 3));
+  _mm_storeu_ps(xyz, _mm_shuffle_ps(xy_low, z0_x1, _MM_SHUFFLE(2, 0, 1, 0)));
+  _mm_storeu_ps(xyz + 4,
+                _mm_shuffle_ps(y1_z1, xy_high, _MM_SHUFFLE(1, 0, 2, 0)));
+  _mm_storeu_ps(xyz + 8, _mm_shuffle_ps(z2_x3, y3_z3, _MM_SHUFFLE(2, 0, 2, 0)));
+}
+
+inline Lanes Dot(const float row[4], const Points4& points) {
+  return _mm_add_ps(
+      _mm_add_ps(_mm_mul_ps(points.x, _mm_set1_ps(row[0])),
+                 _mm_mul_ps(points.y, _mm_set1_ps(row[1]))),
+      _mm_add_ps(_mm_mul_ps(points.z, _mm_set1_ps(row[2])),
+                 _mm_set1_ps(row[3])));
+}
+
+inline Lanes Divide(Lanes numerator, Lanes denominator) {
+  return _mm_div_ps(numerator, denominator);
+}
+
+inline Lanes Clamp(Lanes value, Lanes min_value, Lanes max_value) {
+  return _mm_max_ps(_mm_min_ps(value, max_value), min_value);
+}
+
+inline void Store(Lanes value, float* destination) {
+  _mm_storeu_ps(destination, value);
+}
+
+inline void StoreTruncated(Lanes value, int32_t* destination) {
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(destination),
+                   _mm_cvttps_epi32(value));
+}
+#endif
+
+// The rows of the affine part of |transform|, which glm stores by column.
+void GetRows(const glm::mat4& transform, float rows[3][4]) {
+  for (int row = 0; row < 3; ++row) {
+    for (int column = 0; column < 4; ++column) {
+      rows[row][column] = transform[column][row];
+    }
+  }
+}
+}  // namespace
+
+namespace tango_gl {
+
+void TransformPoints(const glm::mat4& transform, const float* xyz, int count,
+                     float* transformed_xyz) {
+  float rows[3][4];
+  GetRows(transform, rows);
+  int i = 0;
+#if defined(TANGO_GL_TRANSFORM_NEON) || defined(TANGO_GL_TRANSFORM_SSE2)
+  for (; i + kSimdPointCount <= count; i += kSimdPointCount) {
+    // All four points are loaded before any is stored, so the points can be
+    // transformed in place.
+    const Points4 points = LoadPoints(xyz + i * 3);
+    Points4 transformed;
+    transformed.x = Dot(rows[0], points);
+    transformed.y = Dot(rows[1], points);
+    transformed.z = Dot(rows[2], points);
+    StorePoints(transformed, transformed_xyz + i * 3);
+  }
+#endif
+  for (; i < count; ++i) {
+    const float* point = xyz + i * 3;
+    const float x = Dot(rows[0], point);
+    const float y = Dot(rows[1], point);
+    const float z = Dot(rows[2], point);
+    float* transformed = transformed_xyz + i * 3;
+    transformed[0] = x;
+    transformed[1] = y;
+    transformed[2] = z;
+  }
+}
+
+PointProjection::PointProjection(const glm::mat4& camera_T_points, float fx,
+                                 float fy, float cx, float cy) {
+  for (int i = 0; i < 4; ++i) {
+    const glm::vec4& column = camera_T_points[i];
+    u_row[i] = fx * column.x + cx * column.z;
+    v_row[i] = fy * column.y + cy * column.z;
+    w_row[i] = column.z;
+  }
+}
+
+void ProjectPoints(const PointProjection& projection, const float* xyz,
+                   int count, float* pixel_x, float* pixel_y, float* depth) {
+  int i = 0;
+#if defined(TANGO_GL_TRANSFORM_NEON) || defined(TANGO_GL_TRANSFORM_SSE2)
+  for (; i + kSimdPointCount <= count; i += kSimdPointCount) {
+    const Points4 points = LoadPoints(xyz + i * 3);
+    const Lanes w = Dot(projection.w_row, points);
+    Store(Divide(Dot(projection.u_row, points), w), pixel_x + i);
+    Store(Divide(Dot(projection.v_row, points), w), pixel_y + i);
+    Store(w, depth + i);
+  }
+#endif
+  for (; i < count; ++i) {
+    const float* point = xyz + i * 3;
+    const float w = Dot(projection.w_row, point);
+    depth[i] = w;
+    if (w > 0.0f) {
+      pixel_x[i] = Dot(projection.u_row, point) / w;
+      pixel_y[i] = Dot(projection.v_row, point) / w;
+    } else {
+      pixel_x[i] = -1.0f;
+      pixel_y[i] = -1.0f;
+    }
+  }
+}
+
+void ProjectPoints(const PointProjection& projection, const float* xyz,
+                   int count, int32_t* pixel_x, int32_t* pixel_y,
+                   float* depth) {
+  int i = 0;
+#if defined(TANGO_GL_TRANSFORM_NEON) || defined(TANGO_GL_TRANSFORM_SSE2)
+  const Lanes max_coordinate = Splat(kMaxPixelCoordinate);
+  const Lanes min_coordinate = Splat(-kMaxPixelCoordinate);
+  for (; i + kSimdPointCount <= count; i += kSimdPointCount) {
+    const Points4 points = LoadPoints(xyz + i * 3);
+    const Lanes w = Dot(projection.w_row, points);
+    StoreTruncated(Clamp(Divide(Dot(projection.u_row, points), w),
+                         min_coordinate, max_coordinate),
+                   pixel_x + i);
+    StoreTruncated(Clamp(Divide(Dot(projection.v_row, points), w),
+                         min_coordinate, max_coordinate),
+                   pixel_y + i);
+    Store(w, depth + i);
+  }
+#endif
+  for (; i < count; ++i) {
+    const float* point = xyz + i * 3;
+    const float w = Dot(projection.w_row, point);
+    depth[i] = w;
+    if (w > 0.0f) {
+      const float inverse_w = 1.0f / w;
+      pixel_x[i] = ToPixelCoordinate(Dot(projection.u_row, point) * inverse_w);
+      pixel_y[i] = ToPixelCoordinate(Dot(projection.v_row, point) * inverse_w);
+    } else {
+      pixel_x[i] = -1;
+      pixel_y[i] = -1;
+    }
+  }
+}
+}  // namespace tango_gl
@@ -0,0 +1,191 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-gl/profiled_mutex.h"
+
+#include <time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <string>
+
+#include "tango-gl/tracing.h"
+#include "tango-gl/util.h"
+
+namespace tango_gl {
+namespace tracing {
+
+struct LockCounters {
+  explicit LockCounters(const char* name)
+      : name(name),
+        wait_slice_name(std::string("Lock wait: ") + name),
+        lock_count(0),
+        contended_count(0),
+        total_wait_time(0),
+        max_wait_time(0),
+        total_hold_time(0),
+        max_hold_time(0) {}
+
+  const char* name;
+  // The name of the slices of the contended waits, which must outlive the
+  // recording as the counters do.
+  const std::string wait_slice_name;
+  std::atomic<uint64_t> lock_count;
+  std::atomic<uint64_t> contended_count;
+  // In nanoseconds.
+  std::atomic<int64_t> total_wait_time;
+  std::atomic<int64_t> max_wait_time;
+  std::atomic<int64_t> total_hold_time;
+  std::atomic<int64_t> max_hold_time;
+};
+
+}  // namespace tracing
+}  // namespace tango_gl
+
+namespace {
+using tango_gl::tracing::LockCounters;
+
+// The counters of every name. Never destroyed, mutexes may still be locked
+// while the process exits.
+struct LockRegistry {
+  std::mutex mutex;
+  std::map<std::string, LockCounters*> counters;
+};
+
+LockRegistry& GetLockRegistry() {
+  static LockRegistry* registry = new LockRegistry();
+  return *registry;
+}
+
+int64_t GetMonotonicTime() {
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+void UpdateMax(std::atomic<int64_t>* max, int64_t value) {
+  int64_t current = max->load(std::memory_order_relaxed);
+  while (value > current &&
+         !max->compare_exchange_weak(current, value,
+                                     std::memory_order_relaxed)) {
+  }
+}
+
+double ToMilliseconds(const std::atomic<int64_t>& time) {
+  return time.load(std::memory_order_relaxed) * 1e-6;
+}
+}  // namespace
+
+namespace tango_gl {
+namespace tracing {
+
+LockCounters* GetLockCounters(const char* name) {
+  LockRegistry& registry = GetLockRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  LockCounters*& counters = registry.counters[name];
+  if (counters == nullptr) {
+    counters = new LockCounters(name);
+  }
+  return counters;
+}
+
+int64_t LockProfiled(std::mutex* mutex, LockCounters* counters) {
+  counters->lock_count.fetch_add(1, std::memory_order_relaxed);
+  if (mutex->try_lock()) {
+    return GetMonotonicTime();
+  }
+  const int64_t wait_begin_time = GetMonotonicTime();
+  {
+    ScopedTrace trace(counters->wait_slice_name.c_str());
+    mutex->lock();
+  }
+  const int64_t lock_time = GetMonotonicTime();
+  const int64_t wait_time = lock_time - wait_begin_time;
+  counters->contended_count.fetch_add(1, std::memory_order_relaxed);
+  counters->total_wait_time.fetch_add(wait_time, std::memory_order_relaxed);
+  UpdateMax(&counters->max_wait_time, wait_time);
+  return lock_time;
+}
+
+int64_t CountUncontendedLock(LockCounters* counters) {
+  counters->lock_count.fetch_add(1, std::memory_order_relaxed);
+  return GetMonotonicTime();
+}
+
+void UnlockProfiled(std::mutex* mutex, LockCounters* counters,
+                    int64_t lock_time) {
+  const int64_t hold_time = GetMonotonicTime() - lock_time;
+  mutex->unlock();
+  counters->total_hold_time.fetch_add(hold_time, std::memory_order_relaxed);
+  UpdateMax(&counters->max_hold_time, hold_time);
+}
+
+std::vector<LockStatistics> GetLockStatistics() {
+  LockRegistry& registry = GetLockRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  std::vector<LockStatistics> statistics;
+  statistics.reserve(registry.counters.size());
+  for (const auto& name_counters : registry.counters) {
+    const LockCounters& counters = *name_counters.second;
+    LockStatistics name_statistics;
+    name_statistics.name = counters.name;
+    name_statistics.lock_count =
+        counters.lock_count.load(std::memory_order_relaxed);
+    name_statistics.contended_count =
+        counters.contended_count.load(std::memory_order_relaxed);
+    name_statistics.total_wait_ms = ToMilliseconds(counters.total_wait_time);
+    name_statistics.max_wait_ms = ToMilliseconds(counters.max_wait_time);
+    name_statistics.total_hold_ms = ToMilliseconds(counters.total_hold_time);
+    name_statistics.max_hold_ms = ToMilliseconds(counters.max_hold_time);
+    statistics.push_back(name_statistics);
+  }
+  return statistics;
+}
+
+void ResetLockStatistics() {
+  LockRegistry& registry = GetLockRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  // The counters of locks held meanwhile are off by one hold at most.
+  for (const auto& name_counters : registry.counters) {
+    LockCounters* counters = name_counters.second;
+    counters->lock_count.store(0, std::memory_order_relaxed);
+    counters->contended_count.store(0, std::memory_order_relaxed);
+    counters->total_wait_time.store(0, std::memory_order_relaxed);
+    counters->max_wait_time.store(0, std::memory_order_relaxed);
+    counters->total_hold_time.store(0, std::memory_order_relaxed);
+    counters->max_hold_time.store(0, std::memory_order_relaxed);
+  }
+}
+
+void LogLockStatistics() {
+  std::vector<LockStatistics> statistics = GetLockStatistics();
+  std::sort(statistics.begin(), statistics.end(),
+            [](const LockStatistics& a, const LockStatistics& b) {
+              return a.total_wait_ms > b.total_wait_ms;
+            });
+  for (const LockStatistics& lock : statistics) {
+    LOGI(
+        "Lock %s: %llu locks, %llu contended, waited %.3f ms (max %.3f ms), "
+        "held %.3f ms (max %.3f ms)",
+        lock.name, static_cast<unsigned long long>(lock.lock_count),
+        static_cast<unsigned long long>(lock.contended_count),
+        lock.total_wait_ms, lock.max_wait_ms, lock.total_hold_ms,
+        lock.max_hold_ms);
+  }
+}
+}  // namespace tracing
+}  // namespace tango_gl
@@ -15,6 +15,9 @@
  */
 
 #include "tango-gl/quad.h"
+#include "tango-gl/camera_block.h"
+#include "tango-gl/gl_state.h"
+#include "tango-gl/render_statistics.h"
 #include "tango-gl/util.h"
 
 namespace tango_gl {
@@ -30,6 +33,7 @@ static const char kVertexShader[] =
     "}\n";
 
 static const char kFragmentShader[] =
+    "precision mediump float;\n"
     "varying vec2 textureCoordinate;\n"
     "uniform sampler2D inputTexture;\n"
     "void main() {\n"
@@ -43,48 +47,54 @@ static const GLfloat texture_coords[] = {0.0f, 1.0f, 1.0f, 1.0f,
                                          0.0f, 0.0f, 1.0f, 0.0f, };
 
 Quad::Quad() {
-  shader_program_ = util::CreateProgram(kVertexShader, kFragmentShader);
-  if (!shader_program_) {
+  const util::SharedProgram* program =
+      util::GetSharedProgram(kVertexShader, kFragmentShader);
+  if (program) {
+    shader_program_ = program->GetId();
+    uniform_mvp_mat_ = program->GetUniformLocation("mvp");
+    attrib_vertices_ = program->GetAttribLocation("vertex");
+    texture_coords_ = program->GetAttribLocation("inputTextureCoordinate");
+    texture_handle = program->GetUniformLocation("inputTexture");
+  } else {
     LOGE("Could not create program.");
+    shader_program_ = 0;
   }
-  uniform_mvp_mat_ = glGetUniformLocation(shader_program_, "mvp");
-  attrib_vertices_ = glGetAttribLocation(shader_program_, "vertex");
-  texture_coords_ =
-      glGetAttribLocation(shader_program_, "inputTextureCoordinate");
-  texture_handle = glGetUniformLocation(shader_program_, "inputTexture");
   glGenBuffers(1, &vertex_buffer_);
 }
 
-Quad::~Quad() { glDeleteShader(shader_program_); }
+// The program is owned by util::GetSharedProgram().
+Quad::~Quad() {}
 
-void Quat::SetTextureId(GLuint texture_id) { texture_id_ = texture_id; }
+void Quad::SetTextureId(GLuint texture_id) { texture_id_ = texture_id; }
 
 void Quad::Render(const glm::mat4& projection_mat,
                   const glm::mat4& view_mat) const {
-  glEnable(GL_CULL_FACE);
-  glEnable(GL_BLEND);
-  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-  glUseProgram(shader_program_);
+  GlState::Enable(GL_CULL_FACE);
+  GlState::Enable(GL_BLEND);
+  GlState::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  GlState::UseProgram(shader_program_);
 
+  CountRender(kRenderCounterTextureBinds);
   glBindTexture(GL_TEXTURE_2D, texture_id_);
   glUniform1i(texture_handle, 0);
 
   // Calculate MVP matrix and pass it to shader.
   glm::mat4 model_mat = GetTransformationMatrix();
-  glm::mat4 mvp_mat = projection_mat * view_mat * model_mat;
+  glm::mat4 mvp_mat =
+      GetCameraBlock(projection_mat, view_mat).view_projection * model_mat;
   glUniformMatrix4fv(uniform_mvp_mat_, 1, GL_FALSE, glm::value_ptr(mvp_mat));
 
   // Vertice binding
   glEnableVertexAttribArray(attrib_vertices_);
   glVertexAttribPointer(attrib_vertices_, 2, GL_FLOAT, GL_FALSE, 0, vertices);
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  GlState::BindBuffer(GL_ARRAY_BUFFER, 0);
 
   glEnableVertexAttribArray(texture_coords_);
   glVertexAttribPointer(texture_coords_, 2, GL_FLOAT, GL_FALSE, 0,
                         texture_coords);
 
+  CountDraw(4);
   glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-  glUseProgram(0);
   glBindTexture(GL_TEXTURE_2D, 0);
 }
 
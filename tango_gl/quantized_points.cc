@@ -0,0 +1,172 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-gl/quantized_points.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "tango-gl/point_level_of_detail.h"
+#include "tango-gl/tracing.h"
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define TANGO_GL_QUANTIZE_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define TANGO_GL_QUANTIZE_SSE2 1
+#endif
+
+namespace {
+// The largest quantized coordinate, GL_SHORT normalizes it to 1 and its
+// negation to -1.
+const float kMaxValue = 32767.0f;
+
+// @return |value| rounded and clamped to the quantized range.
+int16_t QuantizeValue(float value) {
+  const float rounded = value >= 0.0f ? value + 0.5f : value - 0.5f;
+  return static_cast<int16_t>(
+      std::min(std::max(rounded, -kMaxValue), kMaxValue));
+}
+
+// The depth histogram bins the quantized depths, offset to [0, 65534], by
+// their top bits: 1 << kDepthBinShift values per bin.
+const int kDepthBinShift = 10;
+static_assert((65536 >> kDepthBinShift) ==
+                  tango_gl::PointCloudStatistics::kDepthBins,
+              "the depth bins must cover the quantized range");
+
+void AddToHistogram(int16_t depth, uint32_t* histogram) {
+  // The SIMD paths saturate to -32768.
+  ++histogram[std::max(depth + 32767, 0) >> kDepthBinShift];
+}
+}  // namespace
+
+namespace tango_gl {
+
+QuantizedPoints::QuantizedPoints()
+    : count_(0), scale_(1.0f), offset_(0.0f) {}
+
+void QuantizedPoints::Quantize(const float* xyz, int count) {
+  TANGO_TRACE_SCOPE("QuantizedPoints::Quantize");
+  count_ = std::max(count, 0);
+  data_.resize(count_ * kComponents);
+  GetPointCloudStatistics(xyz, count_, &statistics_);
+  if (count_ == 0) {
+    scale_ = glm::vec3(1.0f);
+    offset_ = glm::vec3(0.0f);
+    return;
+  }
+
+  offset_ = 0.5f * (statistics_.min + statistics_.max);
+  scale_ = 0.5f * (statistics_.max - statistics_.min);
+  // The points of a flat axis all quantize to 0.
+  glm::vec3 inverse;
+  for (int c = 0; c < 3; ++c) {
+    inverse[c] = scale_[c] > 0.0f ? kMaxValue / scale_[c] : 0.0f;
+  }
+
+  int16_t* out = data_.data();
+  uint32_t* histogram = statistics_.depth_histogram;
+  int i = 0;
+#if defined(TANGO_GL_QUANTIZE_NEON)
+  float32x4_t offset_4[3];
+  float32x4_t inverse_4[3];
+  for (int c = 0; c < 3; ++c) {
+    offset_4[c] = vdupq_n_f32(offset_[c]);
+    inverse_4[c] = vdupq_n_f32(inverse[c]);
+  }
+  const uint32x4_t sign_mask = vdupq_n_u32(0x80000000u);
+  const uint32x4_t half = vreinterpretq_u32_f32(vdupq_n_f32(0.5f));
+  for (; i + 4 <= count_; i += 4) {
+    const float32x4x3_t points = vld3q_f32(xyz + i * 3);
+    int16x4x4_t packed;
+    for (int c = 0; c < 3; ++c) {
+      const float32x4_t value =
+          vmulq_f32(vsubq_f32(points.val[c], offset_4[c]), inverse_4[c]);
+      // Round half away from zero, the conversion truncates.
+      const float32x4_t bias = vreinterpretq_f32_u32(
+          vorrq_u32(vandq_u32(vreinterpretq_u32_f32(value), sign_mask), half));
+      packed.val[c] = vqmovn_s32(vcvtq_s32_f32(vaddq_f32(value, bias)));
+    }
+    packed.val[3] = vdup_n_s16(0);
+    vst4_s16(out + i * kComponents, packed);
+    int16_t depths[4];
+    vst1_s16(depths, packed.val[2]);
+    for (int j = 0; j < 4; ++j) {
+      AddToHistogram(depths[j], histogram);
+    }
+  }
+#elif defined(TANGO_GL_QUANTIZE_SSE2)
+  // As in GetPointCloudStatistics(), the fourth lane reads the x of the next
+  // point, and its inverse of 0 turns it into the padding.
+  const __m128 offset_4 = _mm_setr_ps(offset_.x, offset_.y, offset_.z, 0.0f);
+  const __m128 inverse_4 =
+      _mm_setr_ps(inverse.x, inverse.y, inverse.z, 0.0f);
+  for (; i + 1 < count_; ++i) {
+    const __m128 value = _mm_mul_ps(
+        _mm_sub_ps(_mm_loadu_ps(xyz + i * 3), offset_4), inverse_4);
+    // Rounds to nearest, and saturates to the 16 bit range.
+    const __m128i rounded = _mm_cvtps_epi32(value);
+    const __m128i packed = _mm_packs_epi32(rounded, rounded);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i * kComponents),
+                     packed);
+    AddToHistogram(static_cast<int16_t>(_mm_extract_epi16(packed, 2)),
+                   histogram);
+  }
+#endif
+  for (; i < count_; ++i) {
+    for (int c = 0; c < 3; ++c) {
+      out[i * kComponents + c] =
+          QuantizeValue((xyz[i * 3 + c] - offset_[c]) * inverse[c]);
+    }
+    out[i * kComponents + 3] = 0;
+    AddToHistogram(out[i * kComponents + 2], histogram);
+  }
+}
+
+void QuantizedPoints::Shuffle() {
+  TANGO_TRACE_SCOPE("QuantizedPoints::Shuffle");
+  const int stride = PointLevelOfDetail::GetShuffleStride(count_);
+  if (stride == 1) {
+    return;
+  }
+  shuffled_data_.resize(data_.size());
+  int source = 0;
+  for (int i = 0; i < count_; ++i) {
+    memcpy(&shuffled_data_[i * kComponents], &data_[source * kComponents],
+           kPointSize);
+    source += stride;
+    if (source >= count_) {
+      source -= count_;
+    }
+  }
+  data_.swap(shuffled_data_);
+}
+
+void QuantizedPoints::SetUniforms(GLint scale_location,
+                                  GLint offset_location) const {
+  glUniform3fv(scale_location, 1, glm::value_ptr(scale_));
+  glUniform3fv(offset_location, 1, glm::value_ptr(offset_));
+}
+
+void QuantizedPoints::SetVertexAttribPointer(GLuint location,
+                                             int point_stride) {
+  glVertexAttribPointer(location, 3, GL_SHORT, GL_TRUE,
+                        kPointSize * point_stride, nullptr);
+}
+
+}  // namespace tango_gl
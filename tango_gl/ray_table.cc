@@ -0,0 +1,165 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-gl/ray_table.h"
+
+#include <algorithm>
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define TANGO_GL_RAYS_NEON 1
+#endif
+
+namespace {
+// Fixed point iterations inverting the distortion, which converge well
+// within the image of the lenses it models.
+const int kUndistortionIterations = 20;
+
+// The points are stored as packed xyz floats.
+static_assert(sizeof(glm::vec3) == 3 * sizeof(float),
+              "glm::vec3 is expected to be three packed floats");
+
+// @return the undistorted ray seen at |distorted|.
+glm::vec2 Undistort(const glm::vec2& distorted, const double* distortion) {
+  glm::vec2 ray = distorted;
+  for (int i = 0; i < kUndistortionIterations; ++i) {
+    const float r2 = glm::dot(ray, ray);
+    const float factor =
+        1.0f + r2 * (distortion[0] + r2 * (distortion[1] + r2 * distortion[2]));
+    ray = distorted / factor;
+  }
+  return ray;
+}
+}  // namespace
+
+namespace tango_gl {
+
+RayTable::RayTable()
+    : cx_(0.0f),
+      cy_(0.0f),
+      inverse_fx_(0.0f),
+      inverse_fy_(0.0f),
+      tile_size_(0),
+      grid_width_(0),
+      grid_height_(0) {}
+
+void RayTable::Reset(int width, int height, double fx, double fy, double cx,
+                     double cy) {
+  cx_ = cx;
+  cy_ = cy;
+  inverse_fx_ = 1.0 / fx;
+  inverse_fy_ = 1.0 / fy;
+  ray_x_.resize(std::max(width, 0));
+  for (size_t x = 0; x < ray_x_.size(); ++x) {
+    ray_x_[x] = (x + 0.5f - cx_) * inverse_fx_;
+  }
+  ray_y_.resize(std::max(height, 0));
+  for (size_t y = 0; y < ray_y_.size(); ++y) {
+    ray_y_[y] = (y + 0.5f - cy_) * inverse_fy_;
+  }
+  SetUndistortion(nullptr, 0);
+}
+
+void RayTable::SetUndistortion(const double* distortion, int tile_size) {
+  corrections_.clear();
+  if (distortion == nullptr || tile_size <= 0 || IsEmpty()) {
+    tile_size_ = 0;
+    grid_width_ = 0;
+    grid_height_ = 0;
+    return;
+  }
+  tile_size_ = tile_size;
+  // A sample past the last pixel closes the last tile.
+  grid_width_ = (GetWidth() + tile_size - 1) / tile_size + 1;
+  grid_height_ = (GetHeight() + tile_size - 1) / tile_size + 1;
+  corrections_.resize(grid_width_ * grid_height_);
+  for (int grid_y = 0; grid_y < grid_height_; ++grid_y) {
+    for (int grid_x = 0; grid_x < grid_width_; ++grid_x) {
+      const glm::vec2 distorted((grid_x * tile_size - cx_) * inverse_fx_,
+                                (grid_y * tile_size - cy_) * inverse_fy_);
+      corrections_[grid_y * grid_width_ + grid_x] =
+          Undistort(distorted, distortion) - distorted;
+    }
+  }
+}
+
+glm::vec2 RayTable::GetRay(const glm::vec2& position) const {
+  const glm::vec2 ray((position.x - cx_) * inverse_fx_,
+                      (position.y - cy_) * inverse_fy_);
+  if (corrections_.empty()) {
+    return ray;
+  }
+  return ray + GetCorrection(position.x, position.y);
+}
+
+void RayTable::UnprojectDepthImage(const float* depth,
+                                   std::vector<glm::vec3>* points) const {
+  const int width = GetWidth();
+  const int height = GetHeight();
+  points->resize(width * height);
+  float* xyz = reinterpret_cast<float*>(points->data());
+
+  if (!corrections_.empty()) {
+    for (int y = 0; y < height; ++y) {
+      for (int x = 0; x < width; ++x) {
+        const int i = y * width + x;
+        (*points)[i] = Unproject(x, y, depth[i]);
+      }
+    }
+    return;
+  }
+
+  for (int y = 0; y < height; ++y) {
+    const float ray_y = ray_y_[y];
+    const float* row_depth = depth + y * width;
+    float* row_xyz = xyz + y * width * 3;
+    int x = 0;
+#if defined(TANGO_GL_RAYS_NEON)
+    const float32x4_t ray_y_4 = vdupq_n_f32(ray_y);
+    for (; x + 4 <= width; x += 4) {
+      const float32x4_t d = vld1q_f32(row_depth + x);
+      float32x4x3_t point;
+      point.val[0] = vmulq_f32(vld1q_f32(ray_x_.data() + x), d);
+      point.val[1] = vmulq_f32(ray_y_4, d);
+      point.val[2] = d;
+      vst3q_f32(row_xyz + x * 3, point);
+    }
+#endif
+    for (; x < width; ++x) {
+      const float d = row_depth[x];
+      row_xyz[x * 3] = ray_x_[x] * d;
+      row_xyz[x * 3 + 1] = ray_y * d;
+      row_xyz[x * 3 + 2] = d;
+    }
+  }
+}
+
+glm::vec2 RayTable::GetCorrection(float x, float y) const {
+  const float grid_x = std::min(std::max(x / tile_size_, 0.0f),
+                                static_cast<float>(grid_width_ - 1));
+  const float grid_y = std::min(std::max(y / tile_size_, 0.0f),
+                                static_cast<float>(grid_height_ - 1));
+  const int x0 = std::min(static_cast<int>(grid_x), grid_width_ - 2);
+  const int y0 = std::min(static_cast<int>(grid_y), grid_height_ - 2);
+  const float tx = grid_x - x0;
+  const float ty = grid_y - y0;
+  const glm::vec2* top = corrections_.data() + y0 * grid_width_ + x0;
+  const glm::vec2* bottom = top + grid_width_;
+  return glm::mix(glm::mix(top[0], top[1], tx),
+                  glm::mix(bottom[0], bottom[1], tx), ty);
+}
+
+}  // namespace tango_gl
@@ -0,0 +1,416 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-gl/render_queue.h"
+
+#include <algorithm>
+
+#include "tango-gl/camera_block.h"
+#include "tango-gl/gl_state.h"
+#include "tango-gl/render_statistics.h"
+#include "tango-gl/shaders.h"
+
+namespace {
+// Floats per instance: model matrix, then color.
+const size_t kInstanceFloats = 16 + 4;
+// Floats per packed vertex: world position, world normal when lit, color.
+const size_t kPackedFloats = 3 + 4;
+const size_t kShadedPackedFloats = 3 + 3 + 4;
+// Vertices addressable by the GLushort indices of a packed draw.
+const size_t kMaxPackedVertexCount = 65536;
+
+const char* kModelAttributes[4] = {"model0", "model1", "model2", "model3"};
+
+bool IsListMode(GLenum mode) {
+  return mode == GL_POINTS || mode == GL_LINES || mode == GL_TRIANGLES;
+}
+
+void AppendColor(float red, float green, float blue, float alpha,
+                 std::vector<GLfloat>* data) {
+  data->push_back(red);
+  data->push_back(green);
+  data->push_back(blue);
+  data->push_back(alpha);
+}
+
+const GLvoid* FloatOffset(size_t offset) {
+  return reinterpret_cast<const GLvoid*>(offset * sizeof(GLfloat));
+}
+}  // namespace
+
+namespace tango_gl {
+
+RenderQueue::RenderQueue()
+    : gl_initialized_(false),
+      basic_program_(NULL),
+      shaded_program_(NULL),
+      batch_program_(NULL),
+      shaded_batch_program_(NULL),
+      draw_arrays_instanced_(NULL),
+      draw_elements_instanced_(NULL),
+      vertex_attrib_divisor_(NULL) {}
+
+void RenderQueue::Add(const DrawableObject* object) {
+  objects_.push_back(object);
+}
+
+void RenderQueue::Add(const Mesh* mesh) { meshes_.push_back(mesh); }
+
+void RenderQueue::Clear() {
+  objects_.clear();
+  meshes_.clear();
+  batches_.clear();
+  unbatched_objects_.clear();
+}
+
+void RenderQueue::DeleteGlResources() {
+  batch_buffer_.DeleteGlResources();
+  InvalidateGlResources();
+}
+
+void RenderQueue::InvalidateGlResources() {
+  batch_buffer_.InvalidateGlResources();
+  gl_initialized_ = false;
+  basic_program_ = NULL;
+  shaded_program_ = NULL;
+  batch_program_ = NULL;
+  shaded_batch_program_ = NULL;
+  draw_arrays_instanced_ = NULL;
+  draw_elements_instanced_ = NULL;
+  vertex_attrib_divisor_ = NULL;
+}
+
+void RenderQueue::InitializeGl() {
+  if (gl_initialized_) {
+    return;
+  }
+  gl_initialized_ = true;
+
+  // The same programs Mesh::SetShader() gets, to recognize the meshes that
+  // use them.
+  basic_program_ =
+      util::GetSharedProgram(shaders::GetMeshVertexShader(false).c_str(),
+                             shaders::GetBasicFragmentShader().c_str());
+  shaded_program_ =
+      util::GetSharedProgram(shaders::GetMeshVertexShader(true).c_str(),
+                             shaders::GetBasicFragmentShader().c_str());
+  batch_program_ =
+      util::GetSharedProgram(shaders::GetInstancedVertexShader().c_str(),
+                             shaders::GetBasicFragmentShader().c_str());
+  shaded_batch_program_ = util::GetSharedProgram(
+      shaders::GetInstancedShadedVertexShader().c_str(),
+      shaders::GetBasicFragmentShader().c_str());
+
+  const util::GlCapabilities& gl = util::GetGlCapabilities();
+  draw_arrays_instanced_ = gl.draw_arrays_instanced;
+  draw_elements_instanced_ = gl.draw_elements_instanced;
+  vertex_attrib_divisor_ = gl.vertex_attrib_divisor;
+}
+
+bool RenderQueue::IsBatchable(const Mesh* mesh) const {
+  // A mesh cache has no client-side copy of its vertices to pack.
+  if (mesh->vertices_.empty() || !IsListMode(mesh->render_mode_)) {
+    return false;
+  }
+  if (mesh->is_lighting_on_) {
+    return shaded_program_ && shaded_batch_program_ &&
+           mesh->shader_program_ == shaded_program_->GetId() &&
+           mesh->normals_.size() == mesh->vertices_.size();
+  }
+  return basic_program_ && batch_program_ &&
+         mesh->shader_program_ == basic_program_->GetId();
+}
+
+void RenderQueue::BuildBatches() {
+  batches_.clear();
+  unbatched_objects_ = objects_;
+  for (const Mesh* mesh : meshes_) {
+    if (!IsBatchable(mesh)) {
+      unbatched_objects_.push_back(mesh);
+      continue;
+    }
+    // There are few distinct geometries, and comparing different ones stops
+    // at the first difference.
+    Batch* batch = NULL;
+    for (Batch& candidate : batches_) {
+      const Mesh* geometry = candidate.geometry;
+      if (geometry->render_mode_ == mesh->render_mode_ &&
+          geometry->is_lighting_on_ == mesh->is_lighting_on_ &&
+          (!mesh->is_lighting_on_ ||
+           geometry->light_direction_ == mesh->light_direction_) &&
+          geometry->vertices_ == mesh->vertices_ &&
+          geometry->indices_ == mesh->indices_ &&
+          (!mesh->is_lighting_on_ || geometry->normals_ == mesh->normals_)) {
+        batch = &candidate;
+        break;
+      }
+    }
+    if (batch == NULL) {
+      batches_.push_back(Batch());
+      batch = &batches_.back();
+      batch->geometry = mesh;
+    }
+    batch->meshes.push_back(mesh);
+  }
+
+  // Draw the remaining objects grouped by program.
+  std::stable_sort(unbatched_objects_.begin(), unbatched_objects_.end(),
+                   [](const DrawableObject* a, const DrawableObject* b) {
+                     return a->shader_program_ < b->shader_program_;
+                   });
+}
+
+void RenderQueue::AppendInstances(Batch* batch) {
+  batch->data_offset = batch_data_.size();
+  for (const Mesh* mesh : batch->meshes) {
+    const glm::mat4 model_mat = mesh->GetTransformationMatrix();
+    const GLfloat* model = glm::value_ptr(model_mat);
+    batch_data_.insert(batch_data_.end(), model, model + 16);
+    AppendColor(mesh->red_, mesh->green_, mesh->blue_, mesh->alpha_,
+                &batch_data_);
+  }
+}
+
+void RenderQueue::AppendPackedVertices(Batch* batch) {
+  batch->data_offset = batch_data_.size();
+  const Mesh* geometry = batch->geometry;
+  const bool lighting = geometry->is_lighting_on_;
+  const std::vector<GLfloat>& vertices = geometry->vertices_;
+  const std::vector<GLfloat>& normals = geometry->normals_;
+  batch_data_.reserve(batch_data_.size() +
+                      batch->meshes.size() * vertices.size() / 3 *
+                          (lighting ? kShadedPackedFloats : kPackedFloats));
+  for (const Mesh* mesh : batch->meshes) {
+    const glm::mat4 model_mat = mesh->GetTransformationMatrix();
+    // Normals are transformed like the shaded vertex shader does.
+    const glm::mat3 normal_mat(model_mat);
+    for (size_t i = 0; i < vertices.size(); i += 3) {
+      const glm::vec4 position =
+          model_mat * glm::vec4(vertices[i], vertices[i + 1], vertices[i + 2],
+                                1.0f);
+      batch_data_.push_back(position.x);
+      batch_data_.push_back(position.y);
+      batch_data_.push_back(position.z);
+      if (lighting) {
+        const glm::vec3 normal =
+            normal_mat * glm::vec3(normals[i], normals[i + 1], normals[i + 2]);
+        batch_data_.push_back(normal.x);
+        batch_data_.push_back(normal.y);
+        batch_data_.push_back(normal.z);
+      }
+      AppendColor(mesh->red_, mesh->green_, mesh->blue_, mesh->alpha_,
+                  &batch_data_);
+    }
+  }
+}
+
+void RenderQueue::Render(const glm::mat4& projection_mat,
+                         const glm::mat4& view_mat) {
+  InitializeGl();
+  BuildBatches();
+
+  const bool instanced = draw_arrays_instanced_ != NULL;
+  batch_data_.clear();
+  for (Batch& batch : batches_) {
+    if (instanced) {
+      AppendInstances(&batch);
+    } else {
+      AppendPackedVertices(&batch);
+    }
+  }
+
+  if (!batches_.empty()) {
+    // One upload for every batch of the frame.
+    batch_buffer_.Update(batch_data_.data(),
+                         batch_data_.size() * sizeof(GLfloat));
+    GlState::BindBuffer(GL_ARRAY_BUFFER, 0);
+
+    const CameraBlock& camera = GetCameraBlock(projection_mat, view_mat);
+    for (const Batch& batch : batches_) {
+      const Mesh* geometry = batch.geometry;
+      const util::SharedProgram& program =
+          geometry->is_lighting_on_ ? *shaded_batch_program_ : *batch_program_;
+      GlState::UseProgram(program.GetId());
+      // The batches sharing a program share its camera uniforms.
+      if (!IsCameraUploaded(program.GetId(), camera)) {
+        glUniformMatrix4fv(program.GetUniformLocation("vp"), 1, GL_FALSE,
+                           glm::value_ptr(camera.view_projection));
+        if (geometry->is_lighting_on_) {
+          glUniformMatrix4fv(program.GetUniformLocation("view"), 1, GL_FALSE,
+                             glm::value_ptr(camera.view));
+        }
+      }
+      if (geometry->is_lighting_on_) {
+        const glm::vec3 light_direction =
+            glm::mat3(view_mat) * geometry->light_direction_;
+        glUniform3fv(program.GetUniformLocation("lightVec"), 1,
+                     glm::value_ptr(light_direction));
+      }
+      if (instanced) {
+        RenderInstanced(batch, program);
+      } else {
+        RenderPacked(batch, program);
+      }
+    }
+  }
+
+  for (const DrawableObject* object : unbatched_objects_) {
+    object->Render(projection_mat, view_mat);
+  }
+  util::CheckGlError("RenderQueue::Render");
+}
+
+void RenderQueue::RenderInstanced(const Batch& batch,
+                                  const util::SharedProgram& program) {
+  const Mesh* geometry = batch.geometry;
+  const bool lighting = geometry->is_lighting_on_;
+  const GLint attrib_vertices = program.GetAttribLocation("vertex");
+  const GLint attrib_normals = program.GetAttribLocation("normal");
+  const GLint attrib_color = program.GetAttribLocation("color");
+  GLint attrib_model[4];
+  for (int i = 0; i < 4; ++i) {
+    attrib_model[i] = program.GetAttribLocation(kModelAttributes[i]);
+  }
+
+  // The geometry is shared by every instance, drawn from the vertex buffers
+  // of the first mesh.
+  geometry->UpdateVertexBuffers();
+  GlState::BindBuffer(GL_ARRAY_BUFFER, geometry->vertex_buffer_);
+  glEnableVertexAttribArray(attrib_vertices);
+  glVertexAttribPointer(attrib_vertices, 3, GL_FLOAT, GL_FALSE,
+                        geometry->buffer_vertex_stride_, nullptr);
+  if (lighting) {
+    glEnableVertexAttribArray(attrib_normals);
+    glVertexAttribPointer(attrib_normals, 3, GL_FLOAT, GL_FALSE,
+                          geometry->buffer_vertex_stride_,
+                          reinterpret_cast<const GLvoid*>(
+                              geometry->buffer_normal_offset_));
+  }
+
+  // One model matrix and color per instance, from the batch buffer.
+  batch_buffer_.Bind();
+  const GLsizei stride = kInstanceFloats * sizeof(GLfloat);
+  for (int i = 0; i < 4; ++i) {
+    glEnableVertexAttribArray(attrib_model[i]);
+    glVertexAttribPointer(attrib_model[i], 4, GL_FLOAT, GL_FALSE, stride,
+                          FloatOffset(batch.data_offset + i * 4));
+    vertex_attrib_divisor_(attrib_model[i], 1);
+  }
+  glEnableVertexAttribArray(attrib_color);
+  glVertexAttribPointer(attrib_color, 4, GL_FLOAT, GL_FALSE, stride,
+                        FloatOffset(batch.data_offset + 16));
+  vertex_attrib_divisor_(attrib_color, 1);
+  GlState::BindBuffer(GL_ARRAY_BUFFER, 0);
+
+  const GLsizei instance_count = batch.meshes.size();
+  if (geometry->buffer_index_count_ > 0) {
+    GlState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, geometry->index_buffer_);
+    draw_elements_instanced_(geometry->render_mode_,
+                             geometry->buffer_index_count_,
+                             geometry->buffer_index_type_, nullptr,
+                             instance_count);
+    GlState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+  } else {
+    draw_arrays_instanced_(geometry->render_mode_, 0,
+                           geometry->buffer_vertex_count_, instance_count);
+  }
+
+  for (int i = 0; i < 4; ++i) {
+    vertex_attrib_divisor_(attrib_model[i], 0);
+    glDisableVertexAttribArray(attrib_model[i]);
+  }
+  vertex_attrib_divisor_(attrib_color, 0);
+  glDisableVertexAttribArray(attrib_color);
+  if (lighting) {
+    glDisableVertexAttribArray(attrib_normals);
+  }
+  glDisableVertexAttribArray(attrib_vertices);
+}
+
+void RenderQueue::RenderPacked(const Batch& batch,
+                               const util::SharedProgram& program) {
+  const Mesh* geometry = batch.geometry;
+  const bool lighting = geometry->is_lighting_on_;
+  const GLint attrib_vertices = program.GetAttribLocation("vertex");
+  const GLint attrib_normals = program.GetAttribLocation("normal");
+  const GLint attrib_color = program.GetAttribLocation("color");
+
+  // The vertices are already in world space: the model matrix attributes are
+  // left disabled and read as the identity.
+  for (int i = 0; i < 4; ++i) {
+    const GLint attrib_model = program.GetAttribLocation(kModelAttributes[i]);
+    GLfloat column[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    column[i] = 1.0f;
+    glVertexAttrib4fv(attrib_model, column);
+  }
+
+  const size_t floats_per_vertex =
+      lighting ? kShadedPackedFloats : kPackedFloats;
+  const GLsizei stride = floats_per_vertex * sizeof(GLfloat);
+  const size_t vertex_count = geometry->vertices_.size() / 3;
+  const std::vector<GLushort>& indices = geometry->indices_;
+  // Non-indexed lists are drawn in a single call, indexed ones in chunks of
+  // instances that GLushort indices can address.
+  const size_t instances_per_draw =
+      indices.empty() ? batch.meshes.size()
+                      : std::max<size_t>(kMaxPackedVertexCount / vertex_count,
+                                         1);
+
+  batch_buffer_.Bind();
+  glEnableVertexAttribArray(attrib_vertices);
+  glEnableVertexAttribArray(attrib_color);
+  if (lighting) {
+    glEnableVertexAttribArray(attrib_normals);
+  }
+  for (size_t first = 0; first < batch.meshes.size();
+       first += instances_per_draw) {
+    const size_t count =
+        std::min(instances_per_draw, batch.meshes.size() - first);
+    const size_t offset =
+        batch.data_offset + first * vertex_count * floats_per_vertex;
+    glVertexAttribPointer(attrib_vertices, 3, GL_FLOAT, GL_FALSE, stride,
+                          FloatOffset(offset));
+    if (lighting) {
+      glVertexAttribPointer(attrib_normals, 3, GL_FLOAT, GL_FALSE, stride,
+                            FloatOffset(offset + 3));
+    }
+    glVertexAttribPointer(attrib_color, 4, GL_FLOAT, GL_FALSE, stride,
+                          FloatOffset(offset + floats_per_vertex - 4));
+    if (indices.empty()) {
+      CountDraw(count * vertex_count);
+      glDrawArrays(geometry->render_mode_, 0, count * vertex_count);
+      continue;
+    }
+    packed_indices_.clear();
+    for (size_t instance = 0; instance < count; ++instance) {
+      const GLushort base = instance * vertex_count;
+      for (GLushort index : indices) {
+        packed_indices_.push_back(base + index);
+      }
+    }
+    CountDraw(packed_indices_.size());
+    CountUpload(packed_indices_.size() * sizeof(GLushort));
+    glDrawElements(geometry->render_mode_, packed_indices_.size(),
+                   GL_UNSIGNED_SHORT, packed_indices_.data());
+  }
+  if (lighting) {
+    glDisableVertexAttribArray(attrib_normals);
+  }
+  glDisableVertexAttribArray(attrib_color);
+  glDisableVertexAttribArray(attrib_vertices);
+  GlState::BindBuffer(GL_ARRAY_BUFFER, 0);
+}
+}  // namespace tango_gl
@@ -0,0 +1,120 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-gl/render_statistics.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+const char* const kCounterNames[tango_gl::kRenderCounterCount] = {
+    "draw_calls",    "vertices",
+    "program_binds", "texture_binds",
+    "state_changes", "skipped_state_changes",
+    "uploads",       "uploaded_bytes"};
+}  // namespace
+
+namespace tango_gl {
+namespace internal {
+// Zero initialized before any constructor runs.
+std::atomic<int64_t> g_render_counters[kRenderCounterCount];
+}  // namespace internal
+
+RenderStatistics RenderStatistics::operator-(
+    const RenderStatistics& other) const {
+  RenderStatistics difference;
+  for (int i = 0; i < kRenderCounterCount; ++i) {
+    difference.counters[i] = counters[i] - other.counters[i];
+  }
+  return difference;
+}
+
+RenderStatistics GetRenderStatistics() {
+  RenderStatistics statistics;
+  for (int i = 0; i < kRenderCounterCount; ++i) {
+    statistics.counters[i] =
+        internal::g_render_counters[i].load(std::memory_order_relaxed);
+  }
+  return statistics;
+}
+
+const char* GetRenderCounterName(RenderCounter counter) {
+  return kCounterNames[counter];
+}
+
+RenderBenchmark::RenderBenchmark(const char* name, bool is_gpu_synchronized)
+    : name_(name), is_gpu_synchronized_(is_gpu_synchronized) {
+  Reset();
+}
+
+void RenderBenchmark::BeginFrame() {
+  if (is_gpu_synchronized_) {
+    // Not to time the GPU work issued before the frame.
+    glFinish();
+  }
+  frame_start_statistics_ = GetRenderStatistics();
+  frame_start_ = std::chrono::steady_clock::now();
+}
+
+void RenderBenchmark::EndFrame() {
+  if (is_gpu_synchronized_) {
+    glFinish();
+  }
+  const double frame_time =
+      std::chrono::duration<double, std::milli>(
+          std::chrono::steady_clock::now() - frame_start_)
+          .count();
+  const RenderStatistics frame =
+      GetRenderStatistics() - frame_start_statistics_;
+  for (int i = 0; i < kRenderCounterCount; ++i) {
+    totals_.counters[i] += frame.counters[i];
+  }
+  ++frame_count_;
+  total_frame_time_ += frame_time;
+  max_frame_time_ = std::max(max_frame_time_, frame_time);
+}
+
+void RenderBenchmark::Reset() {
+  for (int i = 0; i < kRenderCounterCount; ++i) {
+    totals_.counters[i] = 0;
+  }
+  frame_count_ = 0;
+  total_frame_time_ = 0.0;
+  max_frame_time_ = 0.0;
+}
+
+double RenderBenchmark::GetAverageFrameTime() const {
+  return frame_count_ > 0 ? total_frame_time_ / frame_count_ : 0.0;
+}
+
+std::string RenderBenchmark::FormatReport() const {
+  char entry[128];
+  snprintf(entry, sizeof(entry),
+           "{\"name\":\"%s\",\"frames\":%d,\"average_ms\":%.3f,"
+           "\"max_ms\":%.3f",
+           name_, frame_count_, GetAverageFrameTime(), max_frame_time_);
+  std::string report = entry;
+  const double frame_count = std::max(frame_count_, 1);
+  for (int i = 0; i < kRenderCounterCount; ++i) {
+    snprintf(entry, sizeof(entry), ",\"%s\":%.2f",
+             GetRenderCounterName(static_cast<RenderCounter>(i)),
+             totals_.counters[i] / frame_count);
+    report.append(entry);
+  }
+  report.append("}");
+  return report;
+}
+}  // namespace tango_gl
@@ -0,0 +1,200 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "tango-gl/segment_picker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define TANGO_GL_PICK_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define TANGO_GL_PICK_SSE2 1
+#endif
+
+namespace {
+// Boxes tested at once, and floats per group of boxes.
+const size_t kBoxesPerGroup = 4;
+const size_t kFloatsPerGroup = kBoxesPerGroup * 6;
+
+// Direction components smaller than this are clamped to it, so the slab
+// distances stay finite for segments parallel to an axis.
+const float kMinDirection = 1e-20f;
+
+// The segment as the slab test uses it: its start and the inverse of its
+// direction.
+struct SlabSegment {
+  float start[3];
+  float inverse_direction[3];
+};
+
+SlabSegment MakeSlabSegment(const tango_gl::Segment& segment) {
+  SlabSegment slab;
+  const glm::vec3 direction = segment.end - segment.start;
+  for (int axis = 0; axis < 3; ++axis) {
+    float d = direction[axis];
+    if (std::abs(d) < kMinDirection) {
+      d = d < 0.0f ? -kMinDirection : kMinDirection;
+    }
+    slab.start[axis] = segment.start[axis];
+    slab.inverse_direction[axis] = 1.0f / d;
+  }
+  return slab;
+}
+
+// Test the segment against the four boxes of |group|. Bit i of the result is
+// set when box i is hit, with its entry distance in t_enter[i]. A box is hit
+// when the segment overlaps it between its start and its end, like
+// util::SegmentAABBIntersect.
+#if defined(TANGO_GL_PICK_NEON)
+unsigned int IntersectGroup(const SlabSegment& s, const float* group,
+                            float* t_enter) {
+  float32x4_t t_near = vdupq_n_f32(-std::numeric_limits<float>::max());
+  float32x4_t t_far = vdupq_n_f32(std::numeric_limits<float>::max());
+  for (int axis = 0; axis < 3; ++axis) {
+    const float32x4_t start = vdupq_n_f32(s.start[axis]);
+    const float32x4_t inverse = vdupq_n_f32(s.inverse_direction[axis]);
+    const float32x4_t t0 =
+        vmulq_f32(vsubq_f32(vld1q_f32(group + axis * 4), start), inverse);
+    const float32x4_t t1 =
+        vmulq_f32(vsubq_f32(vld1q_f32(group + 12 + axis * 4), start), inverse);
+    t_near = vmaxq_f32(t_near, vminq_f32(t0, t1));
+    t_far = vminq_f32(t_far, vmaxq_f32(t0, t1));
+  }
+  const uint32x4_t hit =
+      vandq_u32(vandq_u32(vcleq_f32(t_near, t_far),
+                          vcltq_f32(t_near, vdupq_n_f32(1.0f))),
+                vcgtq_f32(t_far, vdupq_n_f32(0.0f)));
+  vst1q_f32(t_enter, t_near);
+  return (vgetq_lane_u32(hit, 0) & 1) | (vgetq_lane_u32(hit, 1) & 2) |
+         (vgetq_lane_u32(hit, 2) & 4) | (vgetq_lane_u32(hit, 3) & 8);
+}
+#elif defined(TANGO_GL_PICK_SSE2)
+unsigned int IntersectGroup(const SlabSegment& s, const float* group,
+                            float* t_enter) {
+  __m128 t_near = _mm_set1_ps(-std::numeric_limits<float>::max());
+  __m128 t_far = _mm_set1_ps(std::numeric_limits<float>::max());
+  for (int axis = 0; axis < 3; ++axis) {
+    const __m128 start = _mm_set1_ps(s.start[axis]);
+    const __m128 inverse = _mm_set1_ps(s.inverse_direction[axis]);
+    const __m128 t0 =
+        _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(group + axis * 4), start), inverse);
+    const __m128 t1 = _mm_mul_ps(
+        _mm_sub_ps(_mm_loadu_ps(group + 12 + axis * 4), start), inverse);
+    t_near = _mm_max_ps(t_near, _mm_min_ps(t0, t1));
+    t_far = _mm_min_ps(t_far, _mm_max_ps(t0, t1));
+  }
+  const __m128 hit =
+      _mm_and_ps(_mm_and_ps(_mm_cmple_ps(t_near, t_far),
+                            _mm_cmplt_ps(t_near, _mm_set1_ps(1.0f))),
+                 _mm_cmpgt_ps(t_far, _mm_setzero_ps()));
+  _mm_storeu_ps(t_enter, t_near);
+  return _mm_movemask_ps(hit);
+}
+#else
+unsigned int IntersectGroup(const SlabSegment& s, const float* group,
+                            float* t_enter) {
+  unsigned int hits = 0;
+  for (size_t box = 0; box < kBoxesPerGroup; ++box) {
+    float t_near = -std::numeric_limits<float>::max();
+    float t_far = std::numeric_limits<float>::max();
+    for (int axis = 0; axis < 3; ++axis) {
+      const float t0 =
+          (group[axis * 4 + box] - s.start[axis]) * s.inverse_direction[axis];
+      const float t1 = (group[12 + axis * 4 + box] - s.start[axis]) *
+                       s.inverse_direction[axis];
+      t_near = std::max(t_near, std::min(t0, t1));
+      t_far = std::min(t_far, std::max(t0, t1));
+    }
+    t_enter[box] = t_near;
+    if (t_near <= t_far && t_near < 1.0f && t_far > 0.0f) {
+      hits |= 1u << box;
+    }
+  }
+  return hits;
+}
+#endif
+}  // namespace
+
+namespace tango_gl {
+
+SegmentPicker::SegmentPicker() : box_count_(0) {}
+
+void SegmentPicker::Clear() {
+  groups_.clear();
+  box_count_ = 0;
+}
+
+size_t SegmentPicker::Add(const BoundingBox& world_box) {
+  if (box_count_ % kBoxesPerGroup == 0) {
+    groups_.resize(groups_.size() + kFloatsPerGroup, 0.0f);
+  }
+  Set(box_count_, world_box);
+  return box_count_++;
+}
+
+void SegmentPicker::Set(size_t index, const BoundingBox& world_box) {
+  float* group = &groups_[index / kBoxesPerGroup * kFloatsPerGroup];
+  const size_t box = index % kBoxesPerGroup;
+  for (int axis = 0; axis < 3; ++axis) {
+    group[axis * 4 + box] = world_box.GetMin()[axis];
+    group[12 + axis * 4 + box] = world_box.GetMax()[axis];
+  }
+}
+
+template <typename HitFunction>
+void SegmentPicker::ForEachHit(const Segment& segment,
+                               HitFunction on_hit) const {
+  const SlabSegment slab = MakeSlabSegment(segment);
+  float t_enter[kBoxesPerGroup];
+  for (size_t first = 0; first < box_count_; first += kBoxesPerGroup) {
+    unsigned int hits =
+        IntersectGroup(slab, &groups_[first / kBoxesPerGroup * kFloatsPerGroup],
+                       t_enter);
+    // Drop the padding of the last group.
+    if (box_count_ - first < kBoxesPerGroup) {
+      hits &= (1u << (box_count_ - first)) - 1;
+    }
+    for (size_t box = 0; hits != 0; ++box, hits >>= 1) {
+      if (hits & 1) {
+        on_hit(first + box, t_enter[box]);
+      }
+    }
+  }
+}
+
+void SegmentPicker::Intersect(const Segment& segment,
+                              std::vector<size_t>* hits) const {
+  ForEachHit(segment,
+             [hits](size_t index, float) { hits->push_back(index); });
+}
+
+int SegmentPicker::IntersectNearest(const Segment& segment) const {
+  int nearest = -1;
+  float nearest_t = std::numeric_limits<float>::max();
+  ForEachHit(segment, [&nearest, &nearest_t](size_t index, float t_enter) {
+    // A segment starting inside a box enters it at 0.
+    const float t = std::max(t_enter, 0.0f);
+    if (t < nearest_t) {
+      nearest = static_cast<int>(index);
+      nearest_t = t;
+    }
+  });
+  return nearest;
+}
+}  // namespace tango_gl
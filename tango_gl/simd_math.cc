@@ -0,0 +1,243 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-gl/simd_math.h"
+
+#include <cmath>
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define TANGO_GL_SIMD_MATH_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define TANGO_GL_SIMD_MATH_SSE2 1
+#endif
+
+namespace {
+// Above this cosine of the angle between two quaternions, a linear
+// interpolation is as accurate as the spherical one and does not divide by
+// the sine of a vanishing angle.
+const float kMaxSlerpCosine = 0.9995f;
+
+// The kernels work on the columns of the glm types as four lanes, with the
+// same few operations for every backend.
+#if defined(TANGO_GL_SIMD_MATH_NEON)
+typedef float32x4_t Lanes;
+
+inline Lanes Load(const float* source) { return vld1q_f32(source); }
+inline void Store(Lanes value, float* destination) {
+  vst1q_f32(destination, value);
+}
+inline Lanes Add(Lanes a, Lanes b) { return vaddq_f32(a, b); }
+inline Lanes Scale(Lanes a, float b) { return vmulq_n_f32(a, b); }
+// @return: |sum| + |a| * |b|.
+inline Lanes ScaleAdd(Lanes sum, Lanes a, float b) {
+  return vmlaq_n_f32(sum, a, b);
+}
+
+// Transpose the matrix of rows |r0| to |r3| in place.
+inline void Transpose(Lanes* r0, Lanes* r1, Lanes* r2, Lanes* r3) {
+  const float32x4x2_t r01 = vtrnq_f32(*r0, *r1);
+  const float32x4x2_t r23 = vtrnq_f32(*r2, *r3);
+  *r0 = vcombine_f32(vget_low_f32(r01.val[0]), vget_low_f32(r23.val[0]));
+  *r1 = vcombine_f32(vget_low_f32(r01.val[1]), vget_low_f32(r23.val[1]));
+  *r2 = vcombine_f32(vget_high_f32(r01.val[0]), vget_high_f32(r23.val[0]));
+  *r3 = vcombine_f32(vget_high_f32(r01.val[1]), vget_high_f32(r23.val[1]));
+}
+#elif defined(TANGO_GL_SIMD_MATH_SSE2)
+typedef __m128 Lanes;
+
+inline Lanes Load(const float* source) { return _mm_loadu_ps(source); }
+inline void Store(Lanes value, float* destination) {
+  _mm_storeu_ps(destination, value);
+}
+inline Lanes Add(Lanes a, Lanes b) { return _mm_add_ps(a, b); }
+inline Lanes Scale(Lanes a, float b) {
+  return _mm_mul_ps(a, _mm_set1_ps(b));
+}
+inline Lanes ScaleAdd(Lanes sum, Lanes a, float b) {
+  return _mm_add_ps(sum, _mm_mul_ps(a, _mm_set1_ps(b)));
+}
+
+inline void Transpose(Lanes* r0, Lanes* r1, Lanes* r2, Lanes* r3) {
+  _MM_TRANSPOSE4_PS(*r0, *r1, *r2, *r3);
+}
+#else
+struct Lanes {
+  float values[4];
+};
+
+inline Lanes Load(const float* source) {
+  Lanes lanes;
+  for (int i = 0; i < 4; ++i) {
+    lanes.values[i] = source[i];
+  }
+  return lanes;
+}
+inline void Store(const Lanes& value, float* destination) {
+  for (int i = 0; i < 4; ++i) {
+    destination[i] = value.values[i];
+  }
+}
+inline Lanes Add(const Lanes& a, const Lanes& b) {
+  Lanes lanes;
+  for (int i = 0; i < 4; ++i) {
+    lanes.values[i] = a.values[i] + b.values[i];
+  }
+  return lanes;
+}
+inline Lanes Scale(const Lanes& a, float b) {
+  Lanes lanes;
+  for (int i = 0; i < 4; ++i) {
+    lanes.values[i] = a.values[i] * b;
+  }
+  return lanes;
+}
+inline Lanes ScaleAdd(const Lanes& sum, const Lanes& a, float b) {
+  return Add(sum, Scale(a, b));
+}
+
+inline void Transpose(Lanes* r0, Lanes* r1, Lanes* r2, Lanes* r3) {
+  Lanes* rows[4] = {r0, r1, r2, r3};
+  for (int i = 0; i < 4; ++i) {
+    for (int j = i + 1; j < 4; ++j) {
+      const float value = rows[i]->values[j];
+      rows[i]->values[j] = rows[j]->values[i];
+      rows[j]->values[i] = value;
+    }
+  }
+}
+#endif
+
+// @return: |transform| * |vector|, from the columns of |transform|.
+inline Lanes Transform(const Lanes columns[4], const float* vector) {
+  Lanes result = Scale(columns[0], vector[0]);
+  result = ScaleAdd(result, columns[1], vector[1]);
+  result = ScaleAdd(result, columns[2], vector[2]);
+  return ScaleAdd(result, columns[3], vector[3]);
+}
+
+inline void LoadColumns(const glm::mat4& matrix, Lanes columns[4]) {
+  for (int i = 0; i < 4; ++i) {
+    columns[i] = Load(&matrix[i][0]);
+  }
+}
+}  // namespace
+
+namespace tango_gl {
+namespace simd_math {
+
+glm::mat4 Multiply(const glm::mat4& a, const glm::mat4& b) {
+  Lanes columns[4];
+  LoadColumns(a, columns);
+  glm::mat4 product;
+  for (int i = 0; i < 4; ++i) {
+    Store(Transform(columns, &b[i][0]), &product[i][0]);
+  }
+  return product;
+}
+
+void TransformVectors(const glm::mat4& transform, const glm::vec4* vectors,
+                      int count, glm::vec4* transformed) {
+  Lanes columns[4];
+  LoadColumns(transform, columns);
+  for (int i = 0; i < count; ++i) {
+    // The vector is read into registers before the result is stored, so it
+    // can be transformed in place.
+    Store(Transform(columns, &vectors[i][0]), &transformed[i][0]);
+  }
+}
+
+glm::mat4 InverseRigid(const glm::mat4& transform) {
+  // The rotation columns have a 0 w, so transposing them along with the
+  // (0, 0, 0, 1) column gives the columns of the transposed rotation, again
+  // with a 0 w.
+  Lanes r0 = Load(&transform[0][0]);
+  Lanes r1 = Load(&transform[1][0]);
+  Lanes r2 = Load(&transform[2][0]);
+  const float homogeneous_column[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+  Lanes r3 = Load(homogeneous_column);
+  Transpose(&r0, &r1, &r2, &r3);
+  const glm::vec4& translation = transform[3];
+  Lanes inverse_translation = Scale(r0, -translation.x);
+  inverse_translation = ScaleAdd(inverse_translation, r1, -translation.y);
+  inverse_translation = ScaleAdd(inverse_translation, r2, -translation.z);
+  glm::mat4 inverse;
+  Store(r0, &inverse[0][0]);
+  Store(r1, &inverse[1][0]);
+  Store(r2, &inverse[2][0]);
+  Store(inverse_translation, &inverse[3][0]);
+  inverse[3][3] = 1.0f;
+  return inverse;
+}
+
+glm::mat4 RigidFromQuat(const glm::quat& rotation,
+                        const glm::vec3& translation) {
+  // Too few operations, with too many shuffles between them, to be worth
+  // lanes: the win over glm is the product with the translation it skips.
+  const float x = rotation.x;
+  const float y = rotation.y;
+  const float z = rotation.z;
+  const float w = rotation.w;
+  const float xx = x * x;
+  const float yy = y * y;
+  const float zz = z * z;
+  const float xy = x * y;
+  const float xz = x * z;
+  const float yz = y * z;
+  const float wx = w * x;
+  const float wy = w * y;
+  const float wz = w * z;
+  glm::mat4 transform;
+  transform[0] = glm::vec4(1.0f - 2.0f * (yy + zz), 2.0f * (xy + wz),
+                           2.0f * (xz - wy), 0.0f);
+  transform[1] = glm::vec4(2.0f * (xy - wz), 1.0f - 2.0f * (xx + zz),
+                           2.0f * (yz + wx), 0.0f);
+  transform[2] = glm::vec4(2.0f * (xz + wy), 2.0f * (yz - wx),
+                           1.0f - 2.0f * (xx + yy), 0.0f);
+  transform[3] = glm::vec4(translation, 1.0f);
+  return transform;
+}
+
+glm::quat Slerp(const glm::quat& a, const glm::quat& b, float t) {
+  float cosine = a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+  // q and -q are the same rotation, the one nearer to |a| is taken.
+  float b_sign = 1.0f;
+  if (cosine < 0.0f) {
+    cosine = -cosine;
+    b_sign = -1.0f;
+  }
+  float a_weight;
+  float b_weight;
+  if (cosine > kMaxSlerpCosine) {
+    a_weight = 1.0f - t;
+    b_weight = t;
+  } else {
+    const float angle = std::acos(cosine);
+    const float inverse_sine = 1.0f / std::sin(angle);
+    a_weight = std::sin((1.0f - t) * angle) * inverse_sine;
+    b_weight = std::sin(t * angle) * inverse_sine;
+  }
+  glm::quat result;
+  Store(ScaleAdd(Scale(Load(&a.x), a_weight), Load(&b.x), b_weight * b_sign),
+        &result.x);
+  if (cosine > kMaxSlerpCosine) {
+    result = glm::normalize(result);
+  }
+  return result;
+}
+}  // namespace simd_math
+}  // namespace tango_gl
@@ -0,0 +1,225 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "tango-gl/sprite_atlas.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "tango-gl/tracing.h"
+
+namespace {
+int NextPowerOfTwo(int value) {
+  int power = 1;
+  while (power < value) {
+    power <<= 1;
+  }
+  return power;
+}
+
+// Where Pack() puts an image, before the page is allocated.
+struct Placement {
+  size_t image;
+  int page;
+  int x;
+  int y;
+};
+}  // namespace
+
+namespace tango_gl {
+SpriteAtlas::Options::Options() : page_size(1024), border(1) {}
+
+SpriteAtlas::SpriteAtlas(const Options& options)
+    : page_size_(options.page_size),
+      border_(std::max(options.border, 0)),
+      uploaded_page_count_(0) {}
+
+int SpriteAtlas::AddImage(const TextureImage& image) {
+  if (image.is_compressed ||
+      (image.format != GL_RGB && image.format != GL_RGBA)) {
+    LOGE("SpriteAtlas: only 8 bit RGB and RGBA images can be packed.");
+    return -1;
+  }
+  if (image.width <= 0 || image.height <= 0 ||
+      image.width + 2 * border_ > page_size_ ||
+      image.height + 2 * border_ > page_size_) {
+    LOGE("SpriteAtlas: a %dx%d image does not fit a page of %d.",
+         image.width, image.height, page_size_);
+    return -1;
+  }
+  const int index = static_cast<int>(sprites_.size());
+  PendingImage pending;
+  pending.sprite = index;
+  pending.image.width = image.width;
+  pending.image.height = image.height;
+  pending.image.format = GL_RGBA;
+  if (image.format == GL_RGBA) {
+    pending.image.data = image.data;
+  } else {
+    const size_t pixel_count =
+        static_cast<size_t>(image.width) * image.height;
+    pending.image.data.resize(pixel_count * 4);
+    const unsigned char* source = image.data.data();
+    unsigned char* destination = pending.image.data.data();
+    for (size_t i = 0; i < pixel_count; ++i) {
+      destination[0] = source[0];
+      destination[1] = source[1];
+      destination[2] = source[2];
+      destination[3] = 255;
+      source += 3;
+      destination += 4;
+    }
+  }
+  pending_images_.push_back(std::move(pending));
+
+  Sprite sprite;
+  sprite.page = -1;
+  sprite.uv_min = glm::vec2(0.0f);
+  sprite.uv_max = glm::vec2(0.0f);
+  sprite.size = glm::ivec2(image.width, image.height);
+  sprites_.push_back(sprite);
+  return index;
+}
+
+int SpriteAtlas::AddFile(const char* file_path) {
+  TextureImage image;
+  if (!Texture::DecodeFile(file_path, &image)) {
+    return -1;
+  }
+  return AddImage(image);
+}
+
+void SpriteAtlas::Pack() {
+  if (pending_images_.empty()) {
+    return;
+  }
+  TANGO_TRACE_SCOPE("SpriteAtlas::Pack");
+  // Tallest first, so that the shelves waste little height.
+  std::vector<size_t> order(pending_images_.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+    return pending_images_[a].image.height > pending_images_[b].image.height;
+  });
+
+  std::vector<Placement> placements;
+  placements.reserve(order.size());
+  // Height used on each new page.
+  std::vector<int> page_heights(1, 0);
+  int shelf_x = 0;
+  int shelf_y = 0;
+  int shelf_height = 0;
+  for (size_t image : order) {
+    const int width = pending_images_[image].image.width + 2 * border_;
+    const int height = pending_images_[image].image.height + 2 * border_;
+    if (shelf_x + width > page_size_) {
+      shelf_y += shelf_height;
+      shelf_x = 0;
+      shelf_height = 0;
+    }
+    if (shelf_y + height > page_size_) {
+      page_heights.push_back(0);
+      shelf_x = 0;
+      shelf_y = 0;
+      shelf_height = 0;
+    }
+    Placement placement;
+    placement.image = image;
+    placement.page = static_cast<int>(page_heights.size()) - 1;
+    placement.x = shelf_x;
+    placement.y = shelf_y;
+    placements.push_back(placement);
+    shelf_x += width;
+    shelf_height = std::max(shelf_height, height);
+    page_heights.back() = shelf_y + shelf_height;
+  }
+
+  const int first_page = static_cast<int>(pages_.size());
+  for (int height : page_heights) {
+    std::unique_ptr<Page> page(new Page());
+    page->image.width = page_size_;
+    page->image.height = NextPowerOfTwo(height);
+    page->image.format = GL_RGBA;
+    page->image.data.assign(
+        static_cast<size_t>(page->image.width) * page->image.height * 4, 0);
+    pages_.push_back(std::move(page));
+  }
+  for (const Placement& placement : placements) {
+    const PendingImage& pending = pending_images_[placement.image];
+    Page* page = pages_[first_page + placement.page].get();
+    Blit(pending.image, placement.x + border_, placement.y + border_,
+         &page->image);
+    const glm::vec2 page_size(page->image.width, page->image.height);
+    Sprite* sprite = &sprites_[pending.sprite];
+    sprite->page = first_page + placement.page;
+    sprite->uv_min =
+        glm::vec2(placement.x + border_, placement.y + border_) / page_size;
+    sprite->uv_max =
+        (glm::vec2(placement.x + border_, placement.y + border_) +
+         glm::vec2(sprite->size)) / page_size;
+  }
+  pending_images_.clear();
+}
+
+void SpriteAtlas::Blit(const TextureImage& image, int x, int y,
+                       TextureImage* page) const {
+  const size_t page_stride = static_cast<size_t>(page->width) * 4;
+  const size_t row_size = static_cast<size_t>(image.width) * 4;
+  for (int row = -border_; row < image.height + border_; ++row) {
+    const int source_row = std::min(std::max(row, 0), image.height - 1);
+    const unsigned char* source = image.data.data() + source_row * row_size;
+    unsigned char* destination =
+        page->data.data() + (y + row) * page_stride + x * 4;
+    memcpy(destination, source, row_size);
+    for (int i = 1; i <= border_; ++i) {
+      memcpy(destination - i * 4, source, 4);
+      memcpy(destination + row_size + (i - 1) * 4, source + row_size - 4, 4);
+    }
+  }
+}
+
+bool SpriteAtlas::Upload() {
+  bool uploaded = true;
+  for (; uploaded_page_count_ < GetPageCount(); ++uploaded_page_count_) {
+    Page* page = pages_[uploaded_page_count_].get();
+    if (!page->texture.Upload(page->image)) {
+      LOGE("SpriteAtlas: could not upload page %d.", uploaded_page_count_);
+      uploaded = false;
+    }
+    std::vector<unsigned char>().swap(page->image.data);
+  }
+  return uploaded;
+}
+
+void SpriteAtlas::DeleteGlResources() {
+  for (const std::unique_ptr<Page>& page : pages_) {
+    page->texture.DeleteGlResources();
+  }
+  InvalidateGlResources();
+}
+
+void SpriteAtlas::InvalidateGlResources() {
+  for (const std::unique_ptr<Page>& page : pages_) {
+    page->texture.InvalidateGlResources();
+  }
+  pages_.clear();
+  sprites_.clear();
+  pending_images_.clear();
+  uploaded_page_count_ = 0;
+}
+}  // namespace tango_gl
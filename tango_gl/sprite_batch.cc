@@ -0,0 +1,276 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "tango-gl/sprite_batch.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+#include "tango-gl/gl_state.h"
+#include "tango-gl/render_statistics.h"
+#include "tango-gl/tracing.h"
+
+namespace {
+// The screen sprites are put on the near plane, in front of the scene.
+const char kVertexShader[] =
+    "attribute vec4 anchor;\n"
+    "attribute vec2 offset;\n"
+    "attribute vec2 uv;\n"
+    "attribute vec4 color;\n"
+    "uniform mat4 view_projection;\n"
+    "uniform vec2 pixel_size;\n"
+    "varying vec2 f_uv;\n"
+    "varying vec4 f_color;\n"
+    "void main() {\n"
+    "  vec4 position = anchor.w > 0.0 ? view_projection * anchor\n"
+    "                                 : vec4(anchor.xy, -1.0, 1.0);\n"
+    "  if (position.w <= 0.0) {\n"
+    "    position = vec4(2.0, 2.0, 0.0, 1.0);\n"
+    "  }\n"
+    "  position.xy += vec2(offset.x, -offset.y) * pixel_size * position.w;\n"
+    "  gl_Position = position;\n"
+    "  f_uv = uv;\n"
+    "  f_color = color;\n"
+    "}\n";
+
+// The color is premultiplied by the alpha.
+const char kFragmentShader[] =
+    "precision mediump float;\n"
+    "uniform sampler2D atlas;\n"
+    "varying vec2 f_uv;\n"
+    "varying vec4 f_color;\n"
+    "void main() {\n"
+    "  vec4 texel = texture2D(atlas, f_uv) * f_color;\n"
+    "  gl_FragColor = vec4(texel.rgb * texel.a, texel.a);\n"
+    "}\n";
+
+uint8_t ToByte(float value) {
+  return static_cast<uint8_t>(tango_gl::util::Clamp(value, 0.0f, 1.0f) *
+                              255.0f + 0.5f);
+}
+}  // namespace
+
+namespace tango_gl {
+
+SpriteBatch::SpriteBatch()
+    : gl_initialized_(false),
+      program_(0),
+      anchor_location_(-1),
+      offset_location_(-1),
+      uv_location_(-1),
+      color_location_(-1),
+      view_projection_location_(-1),
+      pixel_size_location_(-1),
+      atlas_location_(-1) {}
+
+SpriteBatch::~SpriteBatch() {}
+
+void SpriteBatch::AddSprite(const SpriteAtlas::Sprite& sprite,
+                            const glm::vec3& position, const glm::vec2& size,
+                            const Color& color, float alpha) {
+  const float anchor[4] = {position.x, position.y, position.z, 1.0f};
+  AddQuad(sprite, anchor, size, color, alpha);
+}
+
+void SpriteBatch::AddScreenSprite(const SpriteAtlas::Sprite& sprite,
+                                  const glm::vec2& position,
+                                  const glm::vec2& size, const Color& color,
+                                  float alpha) {
+  const float anchor[4] = {position.x, position.y, 0.0f, 0.0f};
+  AddQuad(sprite, anchor, size, color, alpha);
+}
+
+void SpriteBatch::AddQuad(const SpriteAtlas::Sprite& sprite,
+                          const float anchor[4], const glm::vec2& size,
+                          const Color& color, float alpha) {
+  if (sprite.page < 0) {
+    return;
+  }
+  if (page_vertices_.size() <= static_cast<size_t>(sprite.page)) {
+    page_vertices_.resize(sprite.page + 1);
+  }
+  std::vector<Vertex>* vertices = &page_vertices_[sprite.page];
+  Vertex vertex;
+  memcpy(vertex.anchor, anchor, sizeof(vertex.anchor));
+  vertex.color[0] = ToByte(color.r);
+  vertex.color[1] = ToByte(color.g);
+  vertex.color[2] = ToByte(color.b);
+  vertex.color[3] = ToByte(alpha);
+  const float x0 = -0.5f * size.x;
+  const float y0 = -0.5f * size.y;
+  const float x1 = 0.5f * size.x;
+  const float y1 = 0.5f * size.y;
+  const float u0 = sprite.uv_min.x;
+  const float v0 = sprite.uv_min.y;
+  const float u1 = sprite.uv_max.x;
+  const float v1 = sprite.uv_max.y;
+  const float corners[6][4] = {{x0, y0, u0, v0}, {x1, y0, u1, v0},
+                               {x0, y1, u0, v1}, {x0, y1, u0, v1},
+                               {x1, y0, u1, v0}, {x1, y1, u1, v1}};
+  for (const float* corner : corners) {
+    vertex.offset[0] = corner[0];
+    vertex.offset[1] = corner[1];
+    vertex.uv[0] = corner[2];
+    vertex.uv[1] = corner[3];
+    vertices->push_back(vertex);
+  }
+}
+
+size_t SpriteBatch::GetSpriteCount() const {
+  size_t vertex_count = 0;
+  for (const std::vector<Vertex>& vertices : page_vertices_) {
+    vertex_count += vertices.size();
+  }
+  return vertex_count / 6;
+}
+
+bool SpriteBatch::InitializeGl() {
+  if (gl_initialized_) {
+    return program_ != 0;
+  }
+  gl_initialized_ = true;
+  program_ = util::CreateProgram(kVertexShader, kFragmentShader);
+  if (program_ == 0) {
+    LOGE("SpriteBatch: could not create the program");
+    return false;
+  }
+  anchor_location_ = glGetAttribLocation(program_, "anchor");
+  offset_location_ = glGetAttribLocation(program_, "offset");
+  uv_location_ = glGetAttribLocation(program_, "uv");
+  color_location_ = glGetAttribLocation(program_, "color");
+  view_projection_location_ =
+      glGetUniformLocation(program_, "view_projection");
+  pixel_size_location_ = glGetUniformLocation(program_, "pixel_size");
+  atlas_location_ = glGetUniformLocation(program_, "atlas");
+  util::CheckGlError("SpriteBatch::InitializeGl");
+  return true;
+}
+
+void SpriteBatch::Render(const SpriteAtlas& atlas,
+                         const glm::mat4& projection_mat,
+                         const glm::mat4& view_mat) {
+  vertices_.clear();
+  for (const std::vector<Vertex>& vertices : page_vertices_) {
+    vertices_.insert(vertices_.end(), vertices.begin(), vertices.end());
+  }
+  if (vertices_.empty() || !InitializeGl()) {
+    for (std::vector<Vertex>& vertices : page_vertices_) {
+      vertices.clear();
+    }
+    return;
+  }
+  TANGO_TRACE_SCOPE("SpriteBatch::Render");
+  GLint viewport[4];
+  glGetIntegerv(GL_VIEWPORT, viewport);
+  GLint previous_program = 0;
+  GLint blend_source_rgb = GL_ONE;
+  GLint blend_destination_rgb = GL_ZERO;
+  GLint blend_source_alpha = GL_ONE;
+  GLint blend_destination_alpha = GL_ZERO;
+  GLboolean depth_mask = GL_TRUE;
+  glGetIntegerv(GL_CURRENT_PROGRAM, &previous_program);
+  glGetIntegerv(GL_BLEND_SRC_RGB, &blend_source_rgb);
+  glGetIntegerv(GL_BLEND_DST_RGB, &blend_destination_rgb);
+  glGetIntegerv(GL_BLEND_SRC_ALPHA, &blend_source_alpha);
+  glGetIntegerv(GL_BLEND_DST_ALPHA, &blend_destination_alpha);
+  glGetBooleanv(GL_DEPTH_WRITEMASK, &depth_mask);
+  const bool was_blending = glIsEnabled(GL_BLEND) == GL_TRUE;
+  const bool was_culling = glIsEnabled(GL_CULL_FACE) == GL_TRUE;
+  GlState::Enable(GL_BLEND);
+  GlState::BlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+  GlState::Disable(GL_CULL_FACE);
+  GlState::DepthMask(GL_FALSE);
+
+  GlState::UseProgram(program_);
+  const glm::mat4 view_projection = projection_mat * view_mat;
+  glUniformMatrix4fv(view_projection_location_, 1, GL_FALSE,
+                     glm::value_ptr(view_projection));
+  glUniform2f(pixel_size_location_, 2.0f / std::max(viewport[2], 1),
+              2.0f / std::max(viewport[3], 1));
+  glActiveTexture(GL_TEXTURE0);
+  glUniform1i(atlas_location_, 0);
+
+  vertex_buffer_.Update(vertices_.data(), vertices_.size() * sizeof(Vertex));
+  const GLsizei stride = sizeof(Vertex);
+  glEnableVertexAttribArray(anchor_location_);
+  glVertexAttribPointer(anchor_location_, 4, GL_FLOAT, GL_FALSE, stride,
+                        reinterpret_cast<const GLvoid*>(
+                            offsetof(Vertex, anchor)));
+  glEnableVertexAttribArray(offset_location_);
+  glVertexAttribPointer(offset_location_, 2, GL_FLOAT, GL_FALSE, stride,
+                        reinterpret_cast<const GLvoid*>(
+                            offsetof(Vertex, offset)));
+  glEnableVertexAttribArray(uv_location_);
+  glVertexAttribPointer(uv_location_, 2, GL_FLOAT, GL_FALSE, stride,
+                        reinterpret_cast<const GLvoid*>(offsetof(Vertex, uv)));
+  glEnableVertexAttribArray(color_location_);
+  glVertexAttribPointer(color_location_, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride,
+                        reinterpret_cast<const GLvoid*>(
+                            offsetof(Vertex, color)));
+  // One draw per page, of the range its quads were copied to.
+  GLint first = 0;
+  for (size_t page = 0; page < page_vertices_.size(); ++page) {
+    const GLsizei count = static_cast<GLsizei>(page_vertices_[page].size());
+    page_vertices_[page].clear();
+    if (count == 0) {
+      continue;
+    }
+    if (static_cast<int>(page) < atlas.GetPageCount() &&
+        atlas.GetPageTexture(page).IsLoaded()) {
+      CountRender(kRenderCounterTextureBinds);
+      glBindTexture(GL_TEXTURE_2D, atlas.GetPageTexture(page).GetTextureID());
+      CountDraw(count);
+      glDrawArrays(GL_TRIANGLES, first, count);
+    }
+    first += count;
+  }
+  glDisableVertexAttribArray(anchor_location_);
+  glDisableVertexAttribArray(offset_location_);
+  glDisableVertexAttribArray(uv_location_);
+  glDisableVertexAttribArray(color_location_);
+  GlState::BindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  vertices_.clear();
+
+  GlState::UseProgram(previous_program);
+  glBlendFuncSeparate(blend_source_rgb, blend_destination_rgb,
+                      blend_source_alpha, blend_destination_alpha);
+  GlState::DepthMask(depth_mask);
+  if (!was_blending) {
+    GlState::Disable(GL_BLEND);
+  }
+  if (was_culling) {
+    GlState::Enable(GL_CULL_FACE);
+  }
+  util::CheckGlError("SpriteBatch::Render");
+}
+
+void SpriteBatch::DeleteGlResources() {
+  if (program_ != 0) {
+    GlState::DeleteProgram(program_);
+  }
+  vertex_buffer_.DeleteGlResources();
+  InvalidateGlResources();
+}
+
+void SpriteBatch::InvalidateGlResources() {
+  vertex_buffer_.InvalidateGlResources();
+  program_ = 0;
+  gl_initialized_ = false;
+}
+}  // namespace tango_gl
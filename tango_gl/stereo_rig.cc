@@ -0,0 +1,140 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-gl/stereo_rig.h"
+
+#include <algorithm>
+
+#include "tango-gl/camera.h"
+
+namespace {
+// Intrinsics of a 640x480 image with a 90 degree horizontal field of view,
+// until SetIntrinsics().
+const float kDefaultImageWidth = 640.0f;
+const float kDefaultImageHeight = 480.0f;
+const float kDefaultFocalLength = 320.0f;
+const float kDefaultNear = 0.1f;
+const float kDefaultFar = 100.0f;
+}  // namespace
+
+namespace tango_gl {
+
+const float StereoRig::kDefaultInterpupillaryDistance = 0.064f;
+
+StereoRig::StereoRig()
+    : surface_width_(0),
+      surface_height_(0),
+      image_width_(kDefaultImageWidth),
+      image_height_(kDefaultImageHeight),
+      fx_(kDefaultFocalLength),
+      fy_(kDefaultFocalLength),
+      cx_(kDefaultImageWidth / 2.0f),
+      cy_(kDefaultImageHeight / 2.0f),
+      near_(kDefaultNear),
+      far_(kDefaultFar),
+      interpupillary_distance_(kDefaultInterpupillaryDistance),
+      culling_frustum_(glm::mat4(1.0f), glm::mat4(1.0f)),
+      eye_viewport_y_(0),
+      eye_viewport_width_(0),
+      eye_viewport_height_(0) {
+  eye_viewport_x_[kLeftEye] = 0;
+  eye_viewport_x_[kRightEye] = 0;
+  projection_ = Camera::ProjectionMatrixForCameraIntrinsics(
+      image_width_, image_height_, fx_, fy_, cx_, cy_, near_, far_);
+}
+
+void StereoRig::SetSurfaceSize(int width, int height) {
+  surface_width_ = std::max(width, 0);
+  surface_height_ = std::max(height, 0);
+  UpdateViewports();
+}
+
+void StereoRig::SetIntrinsics(float width, float height, float fx, float fy,
+                              float cx, float cy, float near, float far) {
+  if (width <= 0.0f || height <= 0.0f || fx <= 0.0f || fy <= 0.0f) {
+    LOGE("StereoRig: invalid intrinsics %fx%f, focal length %f %f", width,
+         height, fx, fy);
+    return;
+  }
+  image_width_ = width;
+  image_height_ = height;
+  fx_ = fx;
+  fy_ = fy;
+  cx_ = cx;
+  cy_ = cy;
+  near_ = near;
+  far_ = far;
+  projection_ = Camera::ProjectionMatrixForCameraIntrinsics(
+      width, height, fx, fy, cx, cy, near, far);
+  UpdateViewports();
+}
+
+void StereoRig::SetInterpupillaryDistance(float distance) {
+  interpupillary_distance_ = std::max(distance, 0.0f);
+}
+
+void StereoRig::Update(const glm::mat4& view_mat) {
+  // The left eye is half the distance to the left of the camera, so the
+  // points are that much to the right of it.
+  const float half_distance = 0.5f * interpupillary_distance_;
+  views_[kLeftEye] =
+      glm::translate(glm::mat4(1.0f), glm::vec3(half_distance, 0.0f, 0.0f)) *
+      view_mat;
+  views_[kRightEye] =
+      glm::translate(glm::mat4(1.0f), glm::vec3(-half_distance, 0.0f, 0.0f)) *
+      view_mat;
+
+  // A camera |back| meters behind the eyes, with their intrinsics, sees
+  // everything they see when its left plane passes through the left eye's
+  // and its right plane through the right eye's. The planes of an eye are
+  // cx / fx and (width - cx) / fx meters aside per meter of depth. Moving the
+  // clip planes back as much keeps them where the eyes' are.
+  const float narrowest_side =
+      std::max(std::min(cx_, image_width_ - cx_), 1.0f);
+  const float back = half_distance * fx_ / narrowest_side;
+  const glm::mat4 culling_projection =
+      Camera::ProjectionMatrixForCameraIntrinsics(image_width_, image_height_,
+                                                  fx_, fy_, cx_, cy_,
+                                                  near_ + back, far_ + back);
+  const glm::mat4 culling_view =
+      glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -back)) *
+      view_mat;
+  culling_frustum_ = ViewFrustum(culling_projection, culling_view);
+}
+
+void StereoRig::SetEyeViewport(Eye eye) const {
+  glViewport(eye_viewport_x_[eye], eye_viewport_y_, eye_viewport_width_,
+             eye_viewport_height_);
+}
+
+void StereoRig::UpdateViewports() {
+  // The largest viewport of the aspect of the image in each half.
+  const int half_width = surface_width_ / 2;
+  const float aspect_ratio = image_width_ / image_height_;
+  if (half_width > surface_height_ * aspect_ratio) {
+    eye_viewport_height_ = surface_height_;
+    eye_viewport_width_ = static_cast<int>(surface_height_ * aspect_ratio);
+  } else {
+    eye_viewport_width_ = half_width;
+    eye_viewport_height_ = static_cast<int>(half_width / aspect_ratio);
+  }
+  const int margin_x = (half_width - eye_viewport_width_) / 2;
+  eye_viewport_x_[kLeftEye] = margin_x;
+  eye_viewport_x_[kRightEye] = half_width + margin_x;
+  eye_viewport_y_ = (surface_height_ - eye_viewport_height_) / 2;
+}
+
+}  // namespace tango_gl
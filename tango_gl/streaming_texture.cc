@@ -0,0 +1,183 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-gl/streaming_texture.h"
+
+#include <cstring>
+
+#include "tango-gl/gl_state.h"
+#include "tango-gl/render_statistics.h"
+#include "tango-gl/tracing.h"
+
+namespace {
+// GLES 3.0 enum, which gl2.h does not define.
+const GLenum kPixelUnpackBuffer = 0x88EC;
+
+int BytesPerPixel(GLenum format) {
+  switch (format) {
+    case GL_LUMINANCE:
+      return 1;
+    case GL_LUMINANCE_ALPHA:
+      return 2;
+    case GL_RGB:
+      return 3;
+    case GL_RGBA:
+      return 4;
+    default:
+      return 0;
+  }
+}
+}  // namespace
+
+namespace tango_gl {
+
+StreamingTexture::StreamingTexture(GLenum filter)
+    : filter_(filter),
+      format_(0),
+      width_(0),
+      height_(0),
+      image_size_(0),
+      texture_id_(0),
+      use_pixel_buffers_(false),
+      pixel_buffer_index_(0),
+      map_buffer_range_(NULL),
+      unmap_buffer_(NULL),
+      gpu_memory_(kMemoryTagStreamingTexture, kMemoryGpu) {
+  for (int i = 0; i < kPixelBufferCount; ++i) {
+    pixel_buffers_[i] = 0;
+  }
+}
+
+bool StreamingTexture::Allocate(GLenum format, GLsizei width, GLsizei height) {
+  if (texture_id_ != 0 && format == format_ && width == width_ &&
+      height == height_) {
+    return false;
+  }
+
+  const int bytes_per_pixel = BytesPerPixel(format);
+  if (bytes_per_pixel == 0) {
+    LOGE("StreamingTexture: unsupported format 0x%x", format);
+    return false;
+  }
+
+  if (texture_id_ == 0) {
+    glGenTextures(1, &texture_id_);
+    CountRender(kRenderCounterTextureBinds);
+    glBindTexture(GL_TEXTURE_2D, texture_id_);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter_);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter_);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  } else {
+    CountRender(kRenderCounterTextureBinds);
+    glBindTexture(GL_TEXTURE_2D, texture_id_);
+  }
+
+  format_ = format;
+  width_ = width;
+  height_ = height;
+  image_size_ = static_cast<GLsizeiptr>(width) * height * bytes_per_pixel;
+  glTexImage2D(GL_TEXTURE_2D, 0, format_, width_, height_, 0, format_,
+               GL_UNSIGNED_BYTE, nullptr);
+
+  const util::GlCapabilities& gl = util::GetGlCapabilities();
+  map_buffer_range_ = gl.map_buffer_range;
+  unmap_buffer_ = gl.unmap_buffer;
+  use_pixel_buffers_ = gl.IsGles3() && gl.HasMapBufferRange();
+  if (use_pixel_buffers_) {
+    if (pixel_buffers_[0] == 0) {
+      glGenBuffers(kPixelBufferCount, pixel_buffers_);
+    }
+    for (int i = 0; i < kPixelBufferCount; ++i) {
+      GlState::BindBuffer(kPixelUnpackBuffer, pixel_buffers_[i]);
+      glBufferData(kPixelUnpackBuffer, image_size_, nullptr, GL_STREAM_DRAW);
+    }
+    GlState::BindBuffer(kPixelUnpackBuffer, 0);
+  }
+
+  gpu_memory_.Set(image_size_ *
+                  (use_pixel_buffers_ ? 1 + kPixelBufferCount : 1));
+  util::CheckGlError("StreamingTexture::Allocate");
+  return true;
+}
+
+void StreamingTexture::Update(const void* data) {
+  TANGO_TRACE_SCOPE("StreamingTexture::Update");
+  if (texture_id_ == 0) {
+    LOGE("StreamingTexture: Update called before Allocate");
+    return;
+  }
+
+  CountRender(kRenderCounterTextureBinds);
+  glBindTexture(GL_TEXTURE_2D, texture_id_);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+  if (use_pixel_buffers_) {
+    GlState::BindBuffer(kPixelUnpackBuffer,
+                        pixel_buffers_[pixel_buffer_index_]);
+    // Invalidating the buffer lets the driver hand out fresh memory instead
+    // of waiting for the upload that still reads from it.
+    void* mapped = map_buffer_range_(
+        kPixelUnpackBuffer, 0, image_size_,
+        util::GlCapabilities::kMapWriteBit |
+            util::GlCapabilities::kMapInvalidateBufferBit);
+    if (mapped != nullptr) {
+      CountUpload(image_size_);
+      memcpy(mapped, data, image_size_);
+      unmap_buffer_(kPixelUnpackBuffer);
+      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width_, height_, format_,
+                      GL_UNSIGNED_BYTE, nullptr);
+      GlState::BindBuffer(kPixelUnpackBuffer, 0);
+      pixel_buffer_index_ = (pixel_buffer_index_ + 1) % kPixelBufferCount;
+      util::CheckGlError("StreamingTexture::Update");
+      return;
+    }
+    LOGE("StreamingTexture: failed to map pixel buffer, disabling it");
+    GlState::BindBuffer(kPixelUnpackBuffer, 0);
+    use_pixel_buffers_ = false;
+  }
+
+  CountUpload(image_size_);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width_, height_, format_,
+                  GL_UNSIGNED_BYTE, data);
+  util::CheckGlError("StreamingTexture::Update");
+}
+
+void StreamingTexture::DeleteGlResources() {
+  if (texture_id_ != 0) {
+    glDeleteTextures(1, &texture_id_);
+  }
+  if (pixel_buffers_[0] != 0) {
+    GlState::DeleteBuffers(kPixelBufferCount, pixel_buffers_);
+  }
+  InvalidateGlResources();
+}
+
+void StreamingTexture::InvalidateGlResources() {
+  texture_id_ = 0;
+  for (int i = 0; i < kPixelBufferCount; ++i) {
+    pixel_buffers_[i] = 0;
+  }
+  use_pixel_buffers_ = false;
+  pixel_buffer_index_ = 0;
+  format_ = 0;
+  width_ = 0;
+  height_ = 0;
+  image_size_ = 0;
+  gpu_memory_.Set(0);
+}
+
+}  // namespace tango_gl
@@ -0,0 +1,111 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-gl/streaming_vertex_buffer.h"
+
+#include <cstring>
+
+#include "tango-gl/gl_state.h"
+#include "tango-gl/render_statistics.h"
+#include "tango-gl/tracing.h"
+
+namespace tango_gl {
+
+StreamingVertexBuffer::StreamingVertexBuffer()
+    : current_buffer_(0),
+      capacity_(0),
+      gpu_memory_(kMemoryTagVertexBuffer, kMemoryGpu) {
+  for (int i = 0; i < kBufferCount; ++i) {
+    buffers_[i] = 0;
+  }
+}
+
+void StreamingVertexBuffer::Reserve(GLsizeiptr capacity) {
+  if (buffers_[0] != 0 && capacity <= capacity_) {
+    return;
+  }
+  if (buffers_[0] == 0) {
+    glGenBuffers(kBufferCount, buffers_);
+  }
+  capacity_ = capacity > capacity_ ? capacity : capacity_;
+  for (int i = 0; i < kBufferCount; ++i) {
+    GlState::BindBuffer(GL_ARRAY_BUFFER, buffers_[i]);
+    glBufferData(GL_ARRAY_BUFFER, capacity_, nullptr, GL_STREAM_DRAW);
+  }
+  GlState::BindBuffer(GL_ARRAY_BUFFER, 0);
+  gpu_memory_.Set(capacity_ * kBufferCount);
+  util::CheckGlError("StreamingVertexBuffer::Reserve");
+}
+
+void StreamingVertexBuffer::Update(const void* data, GLsizeiptr size) {
+  TANGO_TRACE_SCOPE("StreamingVertexBuffer::Update");
+  if (buffers_[0] == 0 || size > capacity_) {
+    // Grow geometrically so a slowly increasing size does not reallocate on
+    // every frame.
+    Reserve(size > 2 * capacity_ ? size : 2 * capacity_);
+  }
+  current_buffer_ = (current_buffer_ + 1) % kBufferCount;
+  GlState::BindBuffer(GL_ARRAY_BUFFER, buffers_[current_buffer_]);
+  const util::GlCapabilities& gl = util::GetGlCapabilities();
+  if (gl.HasMapBufferRange() && size > 0) {
+    // Invalidating the buffer orphans it like glBufferData() below, and the
+    // data is written straight into the new storage instead of being copied
+    // by glBufferSubData().
+    void* mapped = gl.map_buffer_range(
+        GL_ARRAY_BUFFER, 0, size,
+        util::GlCapabilities::kMapWriteBit |
+            util::GlCapabilities::kMapInvalidateBufferBit);
+    if (mapped != nullptr) {
+      CountUpload(size);
+      memcpy(mapped, data, size);
+      // The content is lost if the unmap fails, it is uploaded again below.
+      if (gl.unmap_buffer(GL_ARRAY_BUFFER) == GL_TRUE) {
+        util::CheckGlError("StreamingVertexBuffer::Update");
+        return;
+      }
+    }
+  }
+  // Orphan the previous storage; the driver keeps it alive for pending draws
+  // and hands out fresh memory of the same size.
+  glBufferData(GL_ARRAY_BUFFER, capacity_, nullptr, GL_STREAM_DRAW);
+  if (size > 0) {
+    CountUpload(size);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, size, data);
+  }
+  util::CheckGlError("StreamingVertexBuffer::Update");
+}
+
+void StreamingVertexBuffer::Bind() const {
+  GlState::BindBuffer(GL_ARRAY_BUFFER, buffers_[current_buffer_]);
+}
+
+void StreamingVertexBuffer::DeleteGlResources() {
+  if (buffers_[0] != 0) {
+    GlState::DeleteBuffers(kBufferCount, buffers_);
+  }
+  InvalidateGlResources();
+}
+
+void StreamingVertexBuffer::InvalidateGlResources() {
+  for (int i = 0; i < kBufferCount; ++i) {
+    buffers_[i] = 0;
+  }
+  current_buffer_ = 0;
+  capacity_ = 0;
+  gpu_memory_.Set(0);
+}
+
+}  // namespace tango_gl
@@ -17,6 +17,9 @@
 #include "tango-gl/tango-gl.h"
 
 #include "tango-gl/camera.h"
+#include "tango-gl/camera_block.h"
+#include "tango-gl/gl_state.h"
+#include "tango-gl/render_statistics.h"
 #include "tango-gl/transform.h"
 #include "tango-gl/util.h"
 
@@ -55,12 +58,13 @@ void Render(const StaticMesh& mesh, const Material& material,
   glm::mat4 view_mat = camera.GetViewMatrix();
   glm::mat4 projection_mat = camera.GetProjectionMatrix();
 
-  glUseProgram(material.GetShaderProgram());
+  GlState::UseProgram(material.GetShaderProgram());
 
   // Set up shader uniforms.
   GLint uniform_mvp_mat = material.GetUniformModelViewProjMatrix();
   if (uniform_mvp_mat != -1) {
-    glm::mat4 mvp_mat = projection_mat * view_mat * model_mat;
+    glm::mat4 mvp_mat =
+        GetCameraBlock(projection_mat, view_mat).view_projection * model_mat;
     glUniformMatrix4fv(uniform_mvp_mat, 1, GL_FALSE, glm::value_ptr(mvp_mat));
   }
 
@@ -92,6 +96,7 @@ void Render(const StaticMesh& mesh, const Material& material,
                           mesh.colors.data());
   }
 
+  CountDraw(mesh.indices.size());
   glDrawElements(mesh.render_mode, mesh.indices.size(), GL_UNSIGNED_INT,
                  mesh.indices.data());
 
@@ -104,8 +109,6 @@ void Render(const StaticMesh& mesh, const Material& material,
     glDisableVertexAttribArray(attrib_color);
   }
 
-  glUseProgram(0);
-
   util::CheckGlError("Render");
 }
 
@@ -116,7 +119,7 @@ Material::Material() {
 
 Material::~Material() {
   if (shader_program_ && shader_program_ != fallback_shader_program_) {
-    glDeleteProgram(shader_program_);
+    GlState::DeleteProgram(shader_program_);
   }
 }
 
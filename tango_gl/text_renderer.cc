@@ -0,0 +1,501 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-gl/text_renderer.h"
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+#include "tango-gl/gl_state.h"
+#include "tango-gl/render_statistics.h"
+#include "tango-gl/tracing.h"
+
+namespace {
+// Side of the square atlas texture, in pixels.
+const int kAtlasSize = 512;
+
+// The fonts of the Android versions we run on, tried in order.
+const char* const kSystemFontPaths[] = {"/system/fonts/Roboto-Regular.ttf",
+                                        "/system/fonts/NotoSans-Regular.ttf",
+                                        "/system/fonts/DroidSans.ttf"};
+
+// Drawn for the invalid bytes of a UTF-8 string.
+const uint32_t kReplacementCharacter = 0xFFFD;
+
+const char kVertexShader[] =
+    "attribute vec4 anchor;\n"
+    "attribute vec2 offset;\n"
+    "attribute vec2 uv;\n"
+    "attribute vec4 color;\n"
+    "uniform mat4 view_projection;\n"
+    "uniform vec2 pixel_size;\n"
+    "varying vec2 f_uv;\n"
+    "varying vec4 f_color;\n"
+    "void main() {\n"
+    "  vec4 position = anchor.w > 0.0 ? view_projection * anchor\n"
+    "                                 : vec4(anchor.xy, 0.0, 1.0);\n"
+    "  if (position.w <= 0.0) {\n"
+    "    position = vec4(2.0, 2.0, 0.0, 1.0);\n"
+    "  }\n"
+    "  position.xy += vec2(offset.x, -offset.y) * pixel_size * position.w;\n"
+    "  gl_Position = vec4(position.xy, 0.0, position.w);\n"
+    "  f_uv = uv;\n"
+    "  f_color = color;\n"
+    "}\n";
+
+// The shadow is the glyph a pixel down and to the right, drawn under it.
+// The color is premultiplied by the alpha.
+const char kFragmentShader[] =
+    "precision mediump float;\n"
+    "uniform sampler2D atlas;\n"
+    "uniform vec2 shadow_offset;\n"
+    "varying vec2 f_uv;\n"
+    "varying vec4 f_color;\n"
+    "void main() {\n"
+    "  float glyph = texture2D(atlas, f_uv).a;\n"
+    "  float shadow = texture2D(atlas, f_uv - shadow_offset).a;\n"
+    "  float alpha = glyph + shadow * (1.0 - glyph);\n"
+    "  gl_FragColor = f_color.a * vec4(f_color.rgb * glyph, alpha);\n"
+    "}\n";
+
+// @return the code point at |*text|, advancing it past it, or 0 at the end
+// of the string.
+uint32_t NextCodePoint(const char** text) {
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(*text);
+  if (bytes[0] == 0) {
+    return 0;
+  }
+  int length = 1;
+  uint32_t code_point = bytes[0];
+  if (bytes[0] >= 0xF0) {
+    length = 4;
+    code_point &= 0x07;
+  } else if (bytes[0] >= 0xE0) {
+    length = 3;
+    code_point &= 0x0F;
+  } else if (bytes[0] >= 0xC0) {
+    length = 2;
+    code_point &= 0x1F;
+  } else if (bytes[0] >= 0x80) {
+    ++*text;
+    return kReplacementCharacter;
+  }
+  for (int i = 1; i < length; ++i) {
+    // Stops at the terminating 0 too.
+    if ((bytes[i] & 0xC0) != 0x80) {
+      *text += i;
+      return kReplacementCharacter;
+    }
+    code_point = (code_point << 6) | (bytes[i] & 0x3F);
+  }
+  *text += length;
+  return code_point;
+}
+
+void SetColor(const tango_gl::Color& color, uint8_t* rgba) {
+  rgba[0] = static_cast<uint8_t>(tango_gl::util::Clamp(color.r, 0.0f, 1.0f) *
+                                 255.0f + 0.5f);
+  rgba[1] = static_cast<uint8_t>(tango_gl::util::Clamp(color.g, 0.0f, 1.0f) *
+                                 255.0f + 0.5f);
+  rgba[2] = static_cast<uint8_t>(tango_gl::util::Clamp(color.b, 0.0f, 1.0f) *
+                                 255.0f + 0.5f);
+  rgba[3] = 255;
+}
+}  // namespace
+
+namespace tango_gl {
+
+TextRenderer::TextRenderer()
+    : library_(nullptr),
+      face_(nullptr),
+      line_height_(0),
+      ascender_(0),
+      cell_size_(0),
+      cells_per_row_(0),
+      frame_(1),
+      gl_initialized_(false),
+      atlas_(0),
+      atlas_memory_(kMemoryTagTexture, kMemoryGpu),
+      program_(0),
+      anchor_location_(-1),
+      offset_location_(-1),
+      uv_location_(-1),
+      color_location_(-1),
+      view_projection_location_(-1),
+      pixel_size_location_(-1),
+      shadow_offset_location_(-1),
+      atlas_location_(-1) {}
+
+TextRenderer::~TextRenderer() {
+  if (face_ != nullptr) {
+    FT_Done_Face(face_);
+  }
+  if (library_ != nullptr) {
+    FT_Done_FreeType(library_);
+  }
+}
+
+bool TextRenderer::LoadFont(const std::string& path, int pixel_size) {
+  if (face_ != nullptr) {
+    FT_Done_Face(face_);
+    face_ = nullptr;
+  }
+  line_height_ = 0;
+  cells_.clear();
+  cell_of_code_point_.clear();
+  if (library_ == nullptr && FT_Init_FreeType(&library_) != 0) {
+    LOGE("TextRenderer: could not initialize FreeType");
+    library_ = nullptr;
+    return false;
+  }
+  if (FT_New_Face(library_, path.c_str(), 0, &face_) != 0) {
+    LOGE("TextRenderer: could not load the font %s", path.c_str());
+    face_ = nullptr;
+    return false;
+  }
+  if (FT_Set_Pixel_Sizes(face_, 0, std::max(pixel_size, 1)) != 0) {
+    LOGE("TextRenderer: %s has no size of %d pixels", path.c_str(),
+         pixel_size);
+    FT_Done_Face(face_);
+    face_ = nullptr;
+    return false;
+  }
+
+  // The metrics are in 26.6 fixed point.
+  const FT_Size_Metrics& metrics = face_->size->metrics;
+  ascender_ = static_cast<int>((metrics.ascender + 63) >> 6);
+  const int descender = static_cast<int>(metrics.descender >> 6);
+  line_height_ = ascender_ - descender;
+  // A pixel more for the shadow, and one to keep it off the next cell.
+  cell_size_ = line_height_ + 2;
+  cells_per_row_ = kAtlasSize / cell_size_;
+  if (cells_per_row_ == 0) {
+    LOGE("TextRenderer: %d pixels do not fit the atlas", pixel_size);
+    FT_Done_Face(face_);
+    face_ = nullptr;
+    line_height_ = 0;
+    return false;
+  }
+  cells_.resize(cells_per_row_ * cells_per_row_);
+  ClearCells();
+  bitmap_.resize(cell_size_ * cell_size_);
+  return true;
+}
+
+bool TextRenderer::LoadSystemFont(int pixel_size) {
+  for (const char* path : kSystemFontPaths) {
+    FILE* file = fopen(path, "rb");
+    if (file != nullptr) {
+      fclose(file);
+      return LoadFont(path, pixel_size);
+    }
+  }
+  LOGE("TextRenderer: no system font found");
+  return false;
+}
+
+void TextRenderer::ClearCells() {
+  for (Cell& cell : cells_) {
+    memset(&cell, 0, sizeof(cell));
+  }
+  cell_of_code_point_.clear();
+}
+
+bool TextRenderer::InitializeGl() {
+  if (gl_initialized_) {
+    return atlas_ != 0;
+  }
+  gl_initialized_ = true;
+  program_ = util::CreateProgram(kVertexShader, kFragmentShader);
+  if (program_ == 0) {
+    LOGE("TextRenderer: could not create the program");
+    return false;
+  }
+  anchor_location_ = glGetAttribLocation(program_, "anchor");
+  offset_location_ = glGetAttribLocation(program_, "offset");
+  uv_location_ = glGetAttribLocation(program_, "uv");
+  color_location_ = glGetAttribLocation(program_, "color");
+  view_projection_location_ =
+      glGetUniformLocation(program_, "view_projection");
+  pixel_size_location_ = glGetUniformLocation(program_, "pixel_size");
+  shadow_offset_location_ = glGetUniformLocation(program_, "shadow_offset");
+  atlas_location_ = glGetUniformLocation(program_, "atlas");
+
+  // Cleared, so that the shadows sample nothing around the glyphs.
+  const std::vector<uint8_t> zeros(kAtlasSize * kAtlasSize, 0);
+  glGenTextures(1, &atlas_);
+  CountRender(kRenderCounterTextureBinds);
+  glBindTexture(GL_TEXTURE_2D, atlas_);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  GLint unpack_alignment = 4;
+  glGetIntegerv(GL_UNPACK_ALIGNMENT, &unpack_alignment);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  CountUpload(zeros.size());
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, kAtlasSize, kAtlasSize, 0,
+               GL_ALPHA, GL_UNSIGNED_BYTE, zeros.data());
+  glPixelStorei(GL_UNPACK_ALIGNMENT, unpack_alignment);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  atlas_memory_.Set(
+      EstimateTextureBytes(kAtlasSize, kAtlasSize, GL_ALPHA, GL_UNSIGNED_BYTE));
+  util::CheckGlError("TextRenderer::InitializeGl");
+  return true;
+}
+
+const TextRenderer::Cell* TextRenderer::GetGlyph(uint32_t code_point) {
+  std::unordered_map<uint32_t, int>::const_iterator found =
+      cell_of_code_point_.find(code_point);
+  if (found != cell_of_code_point_.end()) {
+    Cell* cell = &cells_[found->second];
+    cell->last_used_frame = frame_;
+    return cell;
+  }
+  if (!InitializeGl()) {
+    return nullptr;
+  }
+
+  // The least recently used cell, the empty ones first, that the text of
+  // this frame does not use.
+  int index = -1;
+  for (size_t i = 0; i < cells_.size(); ++i) {
+    if (cells_[i].last_used_frame < frame_ &&
+        (index < 0 ||
+         cells_[i].last_used_frame < cells_[index].last_used_frame)) {
+      index = static_cast<int>(i);
+    }
+  }
+  if (index < 0 || FT_Load_Char(face_, code_point, FT_LOAD_RENDER) != 0) {
+    return nullptr;
+  }
+  Cell* cell = &cells_[index];
+  if (cell->code_point != 0) {
+    cell_of_code_point_.erase(cell->code_point);
+  }
+
+  // Clipped to the cell, less the row and column of the shadow.
+  const FT_GlyphSlot glyph = face_->glyph;
+  const FT_Bitmap& bitmap = glyph->bitmap;
+  const int max_size = cell_size_ - 2;
+  cell->code_point = code_point;
+  cell->last_used_frame = frame_;
+  cell->width = std::min(static_cast<int>(bitmap.width), max_size);
+  cell->height = std::min(static_cast<int>(bitmap.rows), max_size);
+  cell->left = glyph->bitmap_left;
+  cell->top = glyph->bitmap_top;
+  cell->advance = static_cast<int>(glyph->advance.x >> 6);
+  cell_of_code_point_[code_point] = index;
+
+  // The whole cell is uploaded, clearing what an evicted glyph left.
+  std::fill(bitmap_.begin(), bitmap_.end(), 0);
+  for (int y = 0; y < cell->height; ++y) {
+    memcpy(&bitmap_[y * cell_size_], bitmap.buffer + y * bitmap.pitch,
+           cell->width);
+  }
+  CountRender(kRenderCounterTextureBinds);
+  glBindTexture(GL_TEXTURE_2D, atlas_);
+  GLint unpack_alignment = 4;
+  glGetIntegerv(GL_UNPACK_ALIGNMENT, &unpack_alignment);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  CountUpload(bitmap_.size());
+  glTexSubImage2D(GL_TEXTURE_2D, 0, (index % cells_per_row_) * cell_size_,
+                  (index / cells_per_row_) * cell_size_, cell_size_,
+                  cell_size_, GL_ALPHA, GL_UNSIGNED_BYTE, bitmap_.data());
+  glPixelStorei(GL_UNPACK_ALIGNMENT, unpack_alignment);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  return cell;
+}
+
+float TextRenderer::MeasureText(const char* text) {
+  float width = 0.0f;
+  uint32_t code_point;
+  while ((code_point = NextCodePoint(&text)) != 0) {
+    const Cell* cell = GetGlyph(code_point);
+    if (cell != nullptr) {
+      width += cell->advance;
+    }
+  }
+  return width;
+}
+
+void TextRenderer::AddText(const char* text, const float anchor[4],
+                           float offset_x, const Color& color) {
+  Vertex vertex;
+  memcpy(vertex.anchor, anchor, sizeof(vertex.anchor));
+  SetColor(color, vertex.color);
+  const float baseline = ascender_ - 0.5f * line_height_;
+  const float texel = 1.0f / kAtlasSize;
+  float pen = offset_x;
+  uint32_t code_point;
+  while ((code_point = NextCodePoint(&text)) != 0) {
+    const Cell* cell = GetGlyph(code_point);
+    if (cell == nullptr) {
+      continue;
+    }
+    if (cell->width > 0 && cell->height > 0) {
+      // The quad covers the shadow too.
+      const int index = static_cast<int>(cell - cells_.data());
+      const float u0 = (index % cells_per_row_) * cell_size_ * texel;
+      const float v0 = (index / cells_per_row_) * cell_size_ * texel;
+      const float u1 = u0 + (cell->width + 1) * texel;
+      const float v1 = v0 + (cell->height + 1) * texel;
+      const float x0 = pen + cell->left;
+      const float y0 = baseline - cell->top;
+      const float x1 = x0 + cell->width + 1;
+      const float y1 = y0 + cell->height + 1;
+      const float corners[6][4] = {{x0, y0, u0, v0}, {x1, y0, u1, v0},
+                                   {x0, y1, u0, v1}, {x0, y1, u0, v1},
+                                   {x1, y0, u1, v0}, {x1, y1, u1, v1}};
+      for (const float* corner : corners) {
+        vertex.offset[0] = corner[0];
+        vertex.offset[1] = corner[1];
+        vertex.uv[0] = corner[2];
+        vertex.uv[1] = corner[3];
+        vertices_.push_back(vertex);
+      }
+    }
+    pen += cell->advance;
+  }
+}
+
+void TextRenderer::AddLabel(const char* text, const glm::vec3& position,
+                            const Color& color) {
+  if (face_ == nullptr) {
+    return;
+  }
+  const float anchor[4] = {position.x, position.y, position.z, 1.0f};
+  AddText(text, anchor, -0.5f * MeasureText(text), color);
+}
+
+void TextRenderer::AddScreenText(const char* text, const glm::vec2& position,
+                                 const Color& color) {
+  if (face_ == nullptr) {
+    return;
+  }
+  const float anchor[4] = {position.x, position.y, 0.0f, 0.0f};
+  AddText(text, anchor, 0.0f, color);
+}
+
+void TextRenderer::Render(const glm::mat4& projection_mat,
+                          const glm::mat4& view_mat) {
+  // Glyphs used before this frame can be evicted by the next one.
+  ++frame_;
+  if (vertices_.empty() || program_ == 0) {
+    vertices_.clear();
+    return;
+  }
+  TANGO_TRACE_SCOPE("TextRenderer::Render");
+  GLint viewport[4];
+  glGetIntegerv(GL_VIEWPORT, viewport);
+  GLint previous_program = 0;
+  GLint blend_source_rgb = GL_ONE;
+  GLint blend_destination_rgb = GL_ZERO;
+  GLint blend_source_alpha = GL_ONE;
+  GLint blend_destination_alpha = GL_ZERO;
+  glGetIntegerv(GL_CURRENT_PROGRAM, &previous_program);
+  glGetIntegerv(GL_BLEND_SRC_RGB, &blend_source_rgb);
+  glGetIntegerv(GL_BLEND_DST_RGB, &blend_destination_rgb);
+  glGetIntegerv(GL_BLEND_SRC_ALPHA, &blend_source_alpha);
+  glGetIntegerv(GL_BLEND_DST_ALPHA, &blend_destination_alpha);
+  const bool was_blending = glIsEnabled(GL_BLEND) == GL_TRUE;
+  const bool was_depth_testing = glIsEnabled(GL_DEPTH_TEST) == GL_TRUE;
+  const bool was_culling = glIsEnabled(GL_CULL_FACE) == GL_TRUE;
+  GlState::Enable(GL_BLEND);
+  GlState::BlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+  GlState::Disable(GL_DEPTH_TEST);
+  GlState::Disable(GL_CULL_FACE);
+
+  GlState::UseProgram(program_);
+  const glm::mat4 view_projection = projection_mat * view_mat;
+  glUniformMatrix4fv(view_projection_location_, 1, GL_FALSE,
+                     glm::value_ptr(view_projection));
+  glUniform2f(pixel_size_location_, 2.0f / std::max(viewport[2], 1),
+              2.0f / std::max(viewport[3], 1));
+  glUniform2f(shadow_offset_location_, 1.0f / kAtlasSize,
+              1.0f / kAtlasSize);
+  glActiveTexture(GL_TEXTURE0);
+  CountRender(kRenderCounterTextureBinds);
+  glBindTexture(GL_TEXTURE_2D, atlas_);
+  glUniform1i(atlas_location_, 0);
+
+  vertex_buffer_.Update(vertices_.data(), vertices_.size() * sizeof(Vertex));
+  const GLsizei stride = sizeof(Vertex);
+  glEnableVertexAttribArray(anchor_location_);
+  glVertexAttribPointer(anchor_location_, 4, GL_FLOAT, GL_FALSE, stride,
+                        reinterpret_cast<const GLvoid*>(
+                            offsetof(Vertex, anchor)));
+  glEnableVertexAttribArray(offset_location_);
+  glVertexAttribPointer(offset_location_, 2, GL_FLOAT, GL_FALSE, stride,
+                        reinterpret_cast<const GLvoid*>(
+                            offsetof(Vertex, offset)));
+  glEnableVertexAttribArray(uv_location_);
+  glVertexAttribPointer(uv_location_, 2, GL_FLOAT, GL_FALSE, stride,
+                        reinterpret_cast<const GLvoid*>(offsetof(Vertex, uv)));
+  glEnableVertexAttribArray(color_location_);
+  glVertexAttribPointer(color_location_, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride,
+                        reinterpret_cast<const GLvoid*>(
+                            offsetof(Vertex, color)));
+  CountDraw(vertices_.size());
+  glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(vertices_.size()));
+  glDisableVertexAttribArray(anchor_location_);
+  glDisableVertexAttribArray(offset_location_);
+  glDisableVertexAttribArray(uv_location_);
+  glDisableVertexAttribArray(color_location_);
+  GlState::BindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  vertices_.clear();
+
+  GlState::UseProgram(previous_program);
+  glBlendFuncSeparate(blend_source_rgb, blend_destination_rgb,
+                      blend_source_alpha, blend_destination_alpha);
+  if (!was_blending) {
+    GlState::Disable(GL_BLEND);
+  }
+  if (was_depth_testing) {
+    GlState::Enable(GL_DEPTH_TEST);
+  }
+  if (was_culling) {
+    GlState::Enable(GL_CULL_FACE);
+  }
+  util::CheckGlError("TextRenderer::Render");
+}
+
+void TextRenderer::DeleteGlResources() {
+  if (atlas_ != 0) {
+    glDeleteTextures(1, &atlas_);
+  }
+  if (program_ != 0) {
+    GlState::DeleteProgram(program_);
+  }
+  vertex_buffer_.DeleteGlResources();
+  InvalidateGlResources();
+}
+
+void TextRenderer::InvalidateGlResources() {
+  vertex_buffer_.InvalidateGlResources();
+  atlas_ = 0;
+  atlas_memory_.Set(0);
+  program_ = 0;
+  gl_initialized_ = false;
+  ClearCells();
+}
+}  // namespace tango_gl
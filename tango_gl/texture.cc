@@ -14,94 +14,396 @@
  * limitations under the License.
  */
 #include "tango-gl/texture.h"
-#include "tango-gl/util.h"
 
-namespace tango_gl {
+#include <errno.h>
+#include <png.h>
+#include <strings.h>
+
+#include <cstdio>
+#include <cstring>
+
+#include "tango-gl/gl_state.h"
+#include "tango-gl/render_statistics.h"
+#include "tango-gl/tracing.h"
+
+namespace {
+// GLES 3.0 enum, which gl2.h does not define.
+const GLenum kPixelUnpackBuffer = 0x88EC;
+
+// ETC2 formats of OpenGL ES 3.0, which gl2ext.h does not define.
+const GLenum kCompressedRgb8Etc2 = 0x9274;
+const GLenum kCompressedRgb8PunchthroughAlpha1Etc2 = 0x9276;
+const GLenum kCompressedRgba8Etc2Eac = 0x9278;
+
+// PKM header, all fields are big endian:
+//   "PKM " magic, "10" or "20" version, 16 bit format, 16 bit width and
+//   height rounded up to a multiple of 4, 16 bit width and height.
+const size_t kPkmHeaderSize = 16;
+const unsigned char kPkmMagic[4] = {'P', 'K', 'M', ' '};
+
+bool IsPowerOfTwo(GLsizei value) { return (value & (value - 1)) == 0; }
+
+GLsizei RoundUpPowerOfTwo(GLsizei value) {
+  GLsizei result = 1;
+  while (result < value) {
+    result <<= 1;
+  }
+  return result;
+}
 
-static const int kMaxExponentiation = 12;
+bool HasExtension(const char* file_path, const char* extension) {
+  const size_t path_length = strlen(file_path);
+  const size_t extension_length = strlen(extension);
+  return path_length >= extension_length &&
+         strcasecmp(file_path + path_length - extension_length, extension) ==
+             0;
+}
+
+inline unsigned int ReadBigEndian16(const unsigned char* data) {
+  return (data[0] << 8) | data[1];
+}
 
-static int RoundUpPowerOfTwo(int w) {
-  int start = 2;
-  for (int i = 0; i <= kMaxExponentiation; ++i) {
-    if (w < start) {
-      w = start;
+bool DecodePkm(FILE* file, const char* file_path,
+               tango_gl::TextureImage* image) {
+  unsigned char header[kPkmHeaderSize];
+  if (fread(header, 1, kPkmHeaderSize, file) != kPkmHeaderSize ||
+      memcmp(header, kPkmMagic, sizeof(kPkmMagic)) != 0) {
+    LOGE("%s is not a PKM file", file_path);
+    return false;
+  }
+  size_t block_size = 8;
+  switch (ReadBigEndian16(header + 6)) {
+    case 0:
+      image->format = GL_ETC1_RGB8_OES;
       break;
-    } else {
-      start = start << 1;
+    case 1:
+      image->format = kCompressedRgb8Etc2;
+      break;
+    case 3:
+      image->format = kCompressedRgba8Etc2Eac;
+      block_size = 16;
+      break;
+    case 4:
+      image->format = kCompressedRgb8PunchthroughAlpha1Etc2;
+      break;
+    default:
+      LOGE("%s: unsupported PKM format %u", file_path,
+           ReadBigEndian16(header + 6));
+      return false;
+  }
+  const unsigned int block_width = ReadBigEndian16(header + 8) / 4;
+  const unsigned int block_height = ReadBigEndian16(header + 10) / 4;
+  image->width = ReadBigEndian16(header + 12);
+  image->height = ReadBigEndian16(header + 14);
+  image->is_compressed = true;
+  image->data.resize(block_width * block_height * block_size);
+  if (image->data.empty() ||
+      fread(image->data.data(), 1, image->data.size(), file) !=
+          image->data.size()) {
+    LOGE("%s: truncated PKM file", file_path);
+    return false;
+  }
+  return true;
+}
+
+// A PNG file decoded in two steps, so that the caller can allocate the
+// pixels, or map a buffer for them, once the size is known.
+class PngDecoder {
+ public:
+  PngDecoder()
+      : png_ptr_(NULL),
+        info_ptr_(NULL),
+        file_path_(NULL),
+        row_size_(0),
+        pass_count_(1) {}
+  PngDecoder(const PngDecoder& other) = delete;
+  PngDecoder& operator=(const PngDecoder&) = delete;
+  ~PngDecoder() {
+    if (png_ptr_ != NULL) {
+      png_destroy_read_struct(&png_ptr_, &info_ptr_, NULL);
+    }
+  }
+
+  // Read the header of the PNG |file|, filling the size and format of
+  // |image| but not its data.
+  bool ReadHeader(FILE* file, const char* file_path,
+                  tango_gl::TextureImage* image) {
+    file_path_ = file_path;
+    png_byte signature[8];
+    if (fread(signature, 1, sizeof(signature), file) != sizeof(signature) ||
+        png_sig_cmp(signature, 0, sizeof(signature)) != 0) {
+      LOGE("%s is not a PNG file", file_path);
+      return false;
+    }
+    png_ptr_ = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    info_ptr_ = png_create_info_struct(png_ptr_);
+    // libpng reports decoding errors by jumping back here.
+    if (setjmp(png_jmpbuf(png_ptr_))) {
+      LOGE("%s: invalid PNG data", file_path);
+      return false;
+    }
+    png_init_io(png_ptr_, file);
+    png_set_sig_bytes(png_ptr_, sizeof(signature));
+    png_read_info(png_ptr_, info_ptr_);
+
+    // Expand every PNG flavor to 8 bit RGB or RGBA.
+    png_set_expand(png_ptr_);
+    png_set_strip_16(png_ptr_);
+    png_set_gray_to_rgb(png_ptr_);
+    // An interlaced image is read in passes over every row, those without
+    // interlacing in a single pass decoding each row straight to its place.
+    pass_count_ = png_set_interlace_handling(png_ptr_);
+    png_read_update_info(png_ptr_, info_ptr_);
+
+    image->width = png_get_image_width(png_ptr_, info_ptr_);
+    image->height = png_get_image_height(png_ptr_, info_ptr_);
+    image->format =
+        png_get_channels(png_ptr_, info_ptr_) == 4 ? GL_RGBA : GL_RGB;
+    image->is_compressed = false;
+    row_size_ = png_get_rowbytes(png_ptr_, info_ptr_);
+    return true;
+  }
+
+  // @return: the size of the tightly packed pixels, after ReadHeader().
+  size_t GetImageSize(const tango_gl::TextureImage& image) const {
+    return row_size_ * image.height;
+  }
+
+  // Decode the pixels into |pixels|, GetImageSize() bytes, a row at a time.
+  bool ReadPixels(unsigned char* pixels, GLsizei height) {
+    if (setjmp(png_jmpbuf(png_ptr_))) {
+      LOGE("%s: invalid PNG data", file_path_);
+      return false;
+    }
+    for (int pass = 0; pass < pass_count_; ++pass) {
+      for (GLsizei y = 0; y < height; ++y) {
+        png_read_row(png_ptr_, pixels + y * row_size_, NULL);
+      }
     }
+    png_read_end(png_ptr_, NULL);
+    return true;
   }
-  return w;
+
+ private:
+  png_structp png_ptr_;
+  png_infop info_ptr_;
+  const char* file_path_;
+  size_t row_size_;
+  int pass_count_;
+};
+
+bool DecodePng(FILE* file, const char* file_path,
+               tango_gl::TextureImage* image) {
+  PngDecoder decoder;
+  if (!decoder.ReadHeader(file, file_path, image)) {
+    return false;
+  }
+  image->data.resize(decoder.GetImageSize(*image));
+  return decoder.ReadPixels(image->data.data(), image->height);
+}
+
+// Pixels of the PNG files loaded on the GL thread without pixel buffers,
+// kept from one load to the next as the images of an app are of a few
+// sizes. Only used on the GL thread.
+std::vector<unsigned char>& GetStagingPixels() {
+  static std::vector<unsigned char>* pixels = new std::vector<unsigned char>();
+  return *pixels;
 }
+}  // namespace
+
+namespace tango_gl {
 
-Texture::Texture(const char* file_path) {
+Texture::Texture()
+    : width_(0),
+      height_(0),
+      texture_width_(0),
+      texture_height_(0),
+      texture_id_(0),
+      gpu_memory_(kMemoryTagTexture, kMemoryGpu) {}
+
+Texture::Texture(const char* file_path) : Texture() {
   if (!LoadFromPNG(file_path)) {
     LOGE("Texture initialing error");
   }
 }
 
+Texture::~Texture() {}
+
 bool Texture::LoadFromPNG(const char* file_path) {
+  TANGO_TRACE_SCOPE("Texture::LoadFromPNG");
+  if (HasExtension(file_path, ".pkm")) {
+    TextureImage image;
+    return DecodeFile(file_path, &image) && Upload(image);
+  }
   FILE* file = fopen(file_path, "rb");
-
   if (file == NULL) {
     LOGE("fp not loaded: %s", strerror(errno));
     return false;
   }
+  // The pixels are decoded straight into the memory they are uploaded from,
+  // a pixel buffer on OpenGL ES 3.0, which the driver copies from without
+  // the image being copied on the CPU, or the staging pixels otherwise.
+  TextureImage image;
+  PngDecoder decoder;
+  if (!decoder.ReadHeader(file, file_path, &image)) {
+    fclose(file);
+    return false;
+  }
+  const size_t image_size = decoder.GetImageSize(image);
+  const util::GlCapabilities& gl = util::GetGlCapabilities();
+  if (gl.IsGles3() && gl.HasMapBufferRange()) {
+    GLuint pixel_buffer;
+    glGenBuffers(1, &pixel_buffer);
+    GlState::BindBuffer(kPixelUnpackBuffer, pixel_buffer);
+    glBufferData(kPixelUnpackBuffer, image_size, nullptr, GL_STREAM_DRAW);
+    void* mapped = gl.map_buffer_range(
+        kPixelUnpackBuffer, 0, image_size,
+        util::GlCapabilities::kMapWriteBit |
+            util::GlCapabilities::kMapInvalidateBufferBit);
+    bool is_loaded = false;
+    if (mapped != nullptr) {
+      const bool is_decoded = decoder.ReadPixels(
+          static_cast<unsigned char*>(mapped), image.height);
+      // The contents are lost if the buffer was not unmapped cleanly.
+      is_loaded = gl.unmap_buffer(kPixelUnpackBuffer) == GL_TRUE &&
+                  is_decoded && UploadPixels(image, nullptr, image_size);
+    }
+    GlState::BindBuffer(kPixelUnpackBuffer, 0);
+    GlState::DeleteBuffers(1, &pixel_buffer);
+    if (mapped != nullptr) {
+      fclose(file);
+      return is_loaded;
+    }
+    LOGE("Texture: failed to map a pixel buffer for %s", file_path);
+  }
+  std::vector<unsigned char>& pixels = GetStagingPixels();
+  pixels.resize(image_size);
+  const bool is_decoded = decoder.ReadPixels(pixels.data(), image.height);
+  fclose(file);
+  return is_decoded && UploadPixels(image, pixels.data(), image_size);
+}
 
-  fseek(file, 8, SEEK_CUR);
+bool Texture::DecodeFile(const char* file_path, TextureImage* image) {
+  FILE* file = fopen(file_path, "rb");
+  if (file == NULL) {
+    LOGE("fp not loaded: %s", strerror(errno));
+    return false;
+  }
+  const bool decoded = HasExtension(file_path, ".pkm")
+                           ? DecodePkm(file, file_path, image)
+                           : DecodePng(file, file_path, image);
+  fclose(file);
+  return decoded;
+}
 
-  png_structp png_ptr =
-      png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-  png_infop info_ptr = png_create_info_struct(png_ptr);
+bool Texture::Upload(const TextureImage& image) {
+  return UploadPixels(image, image.data.data(), image.data.size());
+}
 
-  png_init_io(png_ptr, file);
-  png_set_sig_bytes(png_ptr, 8);
-  png_read_info(png_ptr, info_ptr);
-  png_get_IHDR(png_ptr, info_ptr, &width_, &height_, &bit_depth_, &color_type_,
-               NULL, NULL, NULL);
+bool Texture::UploadPixels(const TextureImage& image, const void* pixels,
+                           size_t size) {
+  TANGO_TRACE_SCOPE("Texture::Upload");
+  if (image.width <= 0 || image.height <= 0) {
+    LOGE("Texture::Upload, empty image.");
+    return false;
+  }
+  if (image.is_compressed) {
+    const bool supported =
+        image.format == GL_ETC1_RGB8_OES
+            ? util::GetGlCapabilities().IsGles3() ||
+                  util::IsGlExtensionSupported(
+                      "GL_OES_compressed_ETC1_RGB8_texture")
+            : util::GetGlCapabilities().IsGles3();
+    if (!supported) {
+      LOGE("Texture::Upload, compressed format 0x%x is not supported.",
+           image.format);
+      return false;
+    }
+  }
 
-  width_ = RoundUpPowerOfTwo(width_);
-  height_ = RoundUpPowerOfTwo(height_);
-  int row = width_ * (color_type_ == PNG_COLOR_TYPE_RGBA ? 4 : 3);
-  byte_data_ = new char[row * height_];
+  const bool is_npot = !IsPowerOfTwo(image.width) ||
+                       !IsPowerOfTwo(image.height);
+  const bool npot_supported =
+      util::GetGlCapabilities().IsGles3() ||
+      util::IsGlExtensionSupported("GL_OES_texture_npot");
+  // OpenGL ES 2.0 only repeats power of two textures. Uncompressed images
+  // are padded instead; compressed ones cannot be, so they are clamped.
+  const bool pad = is_npot && !npot_supported && !image.is_compressed;
+  const GLenum wrap =
+      is_npot && !npot_supported && image.is_compressed ? GL_CLAMP_TO_EDGE
+                                                        : GL_REPEAT;
 
-  png_bytep* row_pointers = new png_bytep[height_];
-  for (uint i = 0; i < height_; ++i) {
-    row_pointers[i] = (png_bytep)(byte_data_ + i * row);
+  if (texture_id_ == 0) {
+    glGenTextures(1, &texture_id_);
   }
-  png_read_image(png_ptr, row_pointers);
-  png_destroy_read_struct(&png_ptr, &info_ptr, 0);
-
-  glGenTextures(1, &texture_id_);
+  CountRender(kRenderCounterTextureBinds);
   glBindTexture(GL_TEXTURE_2D, texture_id_);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
   util::CheckGlError("glBindTexture");
-  if (color_type_ == PNG_COLOR_TYPE_RGBA) {
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width_, height_, 0, GL_RGBA,
-                 GL_UNSIGNED_BYTE, byte_data_);
+
+  width_ = image.width;
+  height_ = image.height;
+  if (image.is_compressed) {
+    texture_width_ = width_;
+    texture_height_ = height_;
+    glCompressedTexImage2D(GL_TEXTURE_2D, 0, image.format, width_, height_, 0,
+                           size, pixels);
   } else {
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width_, height_, 0, GL_RGB,
-                 GL_UNSIGNED_BYTE, byte_data_);
+    // RGB rows are not 4 byte aligned in general.
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    if (pad) {
+      // Only the storage is padded, the image itself is not copied.
+      texture_width_ = RoundUpPowerOfTwo(width_);
+      texture_height_ = RoundUpPowerOfTwo(height_);
+      glTexImage2D(GL_TEXTURE_2D, 0, image.format, texture_width_,
+                   texture_height_, 0, image.format, GL_UNSIGNED_BYTE, NULL);
+      CountUpload(size);
+      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width_, height_, image.format,
+                      GL_UNSIGNED_BYTE, pixels);
+    } else {
+      texture_width_ = width_;
+      texture_height_ = height_;
+      CountUpload(size);
+      glTexImage2D(GL_TEXTURE_2D, 0, image.format, width_, height_, 0,
+                   image.format, GL_UNSIGNED_BYTE, pixels);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
   }
   util::CheckGlError("glTexImage2D");
   glBindTexture(GL_TEXTURE_2D, 0);
-
-  fclose(file);
-  delete[] row_pointers;
-  delete[] byte_data_;
-
+  gpu_memory_.Set(image.is_compressed
+                      ? size
+                      : EstimateTextureBytes(texture_width_, texture_height_,
+                                             image.format, GL_UNSIGNED_BYTE));
   return true;
 }
 
 GLuint Texture::GetTextureID() const { return texture_id_; }
 
-Texture::~Texture() {
-  if (byte_data_ != NULL) {
-    delete[] byte_data_;
+glm::vec2 Texture::GetTextureCoordinateScale() const {
+  if (texture_width_ == 0 || texture_height_ == 0) {
+    return glm::vec2(1.0f, 1.0f);
   }
-  byte_data_ = NULL;
+  return glm::vec2(static_cast<float>(width_) / texture_width_,
+                   static_cast<float>(height_) / texture_height_);
 }
 
+void Texture::DeleteGlResources() {
+  if (texture_id_ != 0) {
+    glDeleteTextures(1, &texture_id_);
+  }
+  InvalidateGlResources();
+}
+
+void Texture::InvalidateGlResources() {
+  texture_id_ = 0;
+  width_ = 0;
+  height_ = 0;
+  texture_width_ = 0;
+  texture_height_ = 0;
+  gpu_memory_.Set(0);
+}
 }  // namespace tango_gl
@@ -0,0 +1,108 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "tango-gl/texture_loader.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace tango_gl {
+
+TextureLoader::TextureLoader(int thread_count)
+    : decoding_count_(0), is_stopping_(false) {
+  for (int i = 0; i < std::max(1, thread_count); ++i) {
+    workers_.push_back(std::thread(&TextureLoader::DecodeLoop, this));
+  }
+}
+
+TextureLoader::~TextureLoader() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    is_stopping_ = true;
+    requests_.clear();
+  }
+  request_available_.notify_all();
+  for (std::thread& worker : workers_) {
+    worker.join();
+  }
+}
+
+void TextureLoader::Load(const std::string& file_path, Texture* texture) {
+  Request request;
+  request.file_path = file_path;
+  request.texture = texture;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    requests_.push_back(request);
+  }
+  request_available_.notify_one();
+}
+
+void TextureLoader::DecodeLoop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    request_available_.wait(
+        lock, [this] { return is_stopping_ || !requests_.empty(); });
+    if (is_stopping_) {
+      return;
+    }
+    const Request request = requests_.front();
+    requests_.pop_front();
+    ++decoding_count_;
+    lock.unlock();
+
+    DecodedImage decoded;
+    decoded.texture = request.texture;
+    decoded.is_valid =
+        Texture::DecodeFile(request.file_path.c_str(), &decoded.image);
+
+    lock.lock();
+    --decoding_count_;
+    // Hand the pixels over without copying them.
+    decoded_images_.push_back(std::move(decoded));
+  }
+}
+
+int TextureLoader::UploadDecoded(size_t byte_budget) {
+  size_t uploaded_bytes = 0;
+  int uploaded_count = 0;
+  while (true) {
+    DecodedImage decoded;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (decoded_images_.empty()) {
+        break;
+      }
+      const size_t size = decoded_images_.front().image.data.size();
+      if (uploaded_count > 0 && uploaded_bytes + size > byte_budget) {
+        break;
+      }
+      decoded = std::move(decoded_images_.front());
+      decoded_images_.pop_front();
+    }
+    // Failed files were already reported by the decoder.
+    if (decoded.is_valid && decoded.texture->Upload(decoded.image)) {
+      uploaded_bytes += decoded.image.data.size();
+      ++uploaded_count;
+    }
+  }
+  return uploaded_count;
+}
+
+size_t TextureLoader::GetPendingCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return requests_.size() + decoding_count_ + decoded_images_.size();
+}
+}  // namespace tango_gl
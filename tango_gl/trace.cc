@@ -18,21 +18,35 @@
 
 namespace tango_gl {
 
-static const int kMaxTraceLength = 5000;
-static const float kDistanceCheck = 0.05f;
+constexpr float Trace::kSpacing;
+const size_t Trace::kMaxPointCount;
 
-Trace::Trace() : Line(3.0f, GL_LINE_STRIP) { SetShader(); }
+Trace::Trace()
+    : Line(3.0f, GL_LINE_STRIP), trajectory_(kSpacing, kMaxPointCount) {
+  SetShader();
+}
 
 void Trace::UpdateVertexArray(const glm::vec3& v) {
-  if (vec_vertices_.size() == 0) {
-    vec_vertices_.push_back(v);
-  } else {
-    float dist = glm::distance(vec_vertices_[vec_vertices_.size() - 1], v);
-    if (dist >= kDistanceCheck) {
-      vec_vertices_.push_back(v);
-    }
+  // Appended vertices are uploaded on their own by RenderVertices(), the
+  // decimated ones from the first that moved.
+  if (trajectory_.Append(v)) {
+    SetVerticesChangedFrom(trajectory_.TakeFirstChangedPoint());
+  }
+}
+
+void Trace::UpdateVertexArray(SharedTrajectory* trajectory) {
+  if (trajectory->CopyTo(&trajectory_)) {
+    SetVerticesChangedFrom(trajectory_.TakeFirstChangedPoint());
   }
 }
 
-void Trace::ClearVertexArray() { vec_vertices_.clear(); }
+void Trace::ClearVertexArray() {
+  trajectory_.Clear();
+  SetVertexBuffersDirty();
+}
+
+void Trace::Render(const glm::mat4& projection_mat,
+                   const glm::mat4& view_mat) const {
+  RenderVertices(projection_mat, view_mat, trajectory_.GetPositions());
+}
 }  // namespace tango_gl
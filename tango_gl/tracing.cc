@@ -0,0 +1,270 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-gl/tracing.h"
+
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "tango-gl/util.h"
+
+namespace {
+// Number of slices kept per thread.
+const size_t kThreadEventCapacity = 4096;
+const size_t kMarkerLength = 128;
+const char kTraceMarkerPath[] = "/sys/kernel/debug/tracing/trace_marker";
+
+struct Event {
+  const char* name;
+  int64_t begin_time;
+  int64_t duration;
+};
+
+// Ring of the latest slices of one thread. Only that thread writes to it.
+struct ThreadBuffer {
+  explicit ThreadBuffer(pid_t thread_id)
+      : thread_id(thread_id), event_count(0), events(kThreadEventCapacity) {}
+
+  const pid_t thread_id;
+  // Number of slices ever written, the latest one is at
+  // (event_count - 1) % kThreadEventCapacity.
+  std::atomic<uint64_t> event_count;
+  std::vector<Event> events;
+};
+
+// State shared by every thread. The buffers of exited threads are kept, so
+// their slices are still dumped, and reused by no one else.
+struct Recorder {
+  Recorder() : is_recording(false), trace_marker_fd(-1), start_time(0) {}
+
+  std::atomic<bool> is_recording;
+  std::atomic<int> trace_marker_fd;
+
+  // Protects the rest.
+  std::mutex mutex;
+  std::vector<ThreadBuffer*> buffers;
+  int64_t start_time;
+};
+
+Recorder& GetRecorder() {
+  // Never destroyed, threads may still record while the process exits.
+  static Recorder* recorder = new Recorder();
+  return *recorder;
+}
+
+int64_t GetMonotonicTime() {
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+ThreadBuffer* GetThreadBuffer() {
+  static thread_local ThreadBuffer* thread_buffer = nullptr;
+  if (thread_buffer == nullptr) {
+    thread_buffer = new ThreadBuffer(syscall(__NR_gettid));
+    Recorder& recorder = GetRecorder();
+    std::lock_guard<std::mutex> lock(recorder.mutex);
+    recorder.buffers.push_back(thread_buffer);
+  }
+  return thread_buffer;
+}
+
+void WriteMarker(const char* marker, size_t length) {
+  const int fd = GetRecorder().trace_marker_fd.load(std::memory_order_relaxed);
+  if (fd >= 0) {
+    // Markers are best effort, a failed write only loses the systrace slice.
+    const ssize_t written = write(fd, marker, length);
+    static_cast<void>(written);
+  }
+}
+
+// Call |function| with the thread id and each slice recorded since the
+// start, under the mutex of |recorder|.
+template <typename Function>
+void ForEachRecordedEvent(const Recorder& recorder, Function function) {
+  std::vector<Event> events;
+  for (const ThreadBuffer* buffer : recorder.buffers) {
+    // The thread keeps writing while its buffer is copied, so the slices it
+    // may have overwritten in the meantime are left out.
+    const uint64_t end = buffer->event_count.load(std::memory_order_acquire);
+    uint64_t begin =
+        end > kThreadEventCapacity ? end - kThreadEventCapacity : 0;
+    events.clear();
+    for (uint64_t i = begin; i < end; ++i) {
+      events.push_back(buffer->events[i % kThreadEventCapacity]);
+    }
+    const uint64_t new_end =
+        buffer->event_count.load(std::memory_order_acquire);
+    if (new_end < end) {
+      // Recording restarted, the copy is meaningless.
+      continue;
+    }
+    const uint64_t first_intact =
+        new_end > kThreadEventCapacity ? new_end - kThreadEventCapacity : 0;
+    for (uint64_t i = std::max(begin, first_intact); i < end; ++i) {
+      const Event& event = events[i - begin];
+      if (event.begin_time >= recorder.start_time) {
+        function(buffer->thread_id, event);
+      }
+    }
+  }
+}
+
+// Write |text| as a JSON string.
+void WriteJsonString(FILE* file, const char* text) {
+  fputc('"', file);
+  for (const char* c = text; *c != '\0'; ++c) {
+    if (*c == '"' || *c == '\\') {
+      fputc('\\', file);
+      fputc(*c, file);
+    } else if (static_cast<unsigned char>(*c) < 0x20) {
+      fprintf(file, "\\u%04x", static_cast<unsigned int>(*c));
+    } else {
+      fputc(*c, file);
+    }
+  }
+  fputc('"', file);
+}
+}  // namespace
+
+namespace tango_gl {
+namespace tracing {
+
+void Start() {
+  Recorder& recorder = GetRecorder();
+  std::lock_guard<std::mutex> lock(recorder.mutex);
+  for (ThreadBuffer* buffer : recorder.buffers) {
+    buffer->event_count.store(0, std::memory_order_relaxed);
+  }
+  recorder.start_time = GetMonotonicTime();
+  if (recorder.trace_marker_fd.load() < 0) {
+    // Only writable on some builds, systrace markers are optional.
+    recorder.trace_marker_fd.store(open(kTraceMarkerPath, O_WRONLY));
+  }
+  recorder.is_recording.store(true);
+}
+
+void Stop() { GetRecorder().is_recording.store(false); }
+
+bool IsRecording() {
+  return GetRecorder().is_recording.load(std::memory_order_relaxed);
+}
+
+bool DumpChromeTrace(const char* path) {
+  FILE* file = fopen(path, "w");
+  if (file == NULL) {
+    LOGE("tracing: failed to create %s", path);
+    return false;
+  }
+
+  Recorder& recorder = GetRecorder();
+  std::lock_guard<std::mutex> lock(recorder.mutex);
+  const int process_id = getpid();
+  bool is_first_event = true;
+  fprintf(file, "{\"traceEvents\":[");
+  ForEachRecordedEvent(recorder, [&](pid_t thread_id, const Event& event) {
+    fprintf(file, is_first_event ? "\n" : ",\n");
+    is_first_event = false;
+    fprintf(file, "{\"name\":");
+    WriteJsonString(file, event.name);
+    fprintf(file,
+            ",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+            process_id, static_cast<int>(thread_id),
+            (event.begin_time - recorder.start_time) / 1000.0,
+            event.duration / 1000.0);
+  });
+  fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+
+  if (ferror(file) != 0 || fclose(file) != 0) {
+    LOGE("tracing: failed to write %s", path);
+    return false;
+  }
+  return true;
+}
+
+std::vector<SliceStatistics> GetSliceStatistics() {
+  // Equal names may be different literals, so they are compared as strings.
+  std::map<std::string, std::vector<int64_t>> durations;
+  std::map<std::string, const char*> names;
+  {
+    Recorder& recorder = GetRecorder();
+    std::lock_guard<std::mutex> lock(recorder.mutex);
+    ForEachRecordedEvent(recorder, [&](pid_t, const Event& event) {
+      durations[event.name].push_back(event.duration);
+      names.insert(std::make_pair(std::string(event.name), event.name));
+    });
+  }
+  std::vector<SliceStatistics> statistics;
+  for (std::pair<const std::string, std::vector<int64_t>>& slices :
+       durations) {
+    std::vector<int64_t>& samples = slices.second;
+    std::sort(samples.begin(), samples.end());
+    int64_t sum = 0;
+    for (int64_t duration : samples) {
+      sum += duration;
+    }
+    SliceStatistics slice;
+    slice.name = names[slices.first];
+    slice.count = static_cast<int>(samples.size());
+    slice.average_ms = sum / 1e6 / samples.size();
+    slice.percentile_95_ms = samples[(samples.size() - 1) * 95 / 100] / 1e6;
+    slice.max_ms = samples.back() / 1e6;
+    statistics.push_back(slice);
+  }
+  return statistics;
+}
+
+ScopedTrace::ScopedTrace(const char* name) : name_(name), begin_time_(0) {
+  if (!IsRecording()) {
+    return;
+  }
+  char marker[kMarkerLength];
+  const int length =
+      snprintf(marker, sizeof(marker), "B|%d|%s", getpid(), name_);
+  if (length > 0) {
+    WriteMarker(marker,
+                std::min(static_cast<size_t>(length), sizeof(marker) - 1));
+  }
+  begin_time_ = GetMonotonicTime();
+}
+
+ScopedTrace::~ScopedTrace() {
+  if (begin_time_ == 0) {
+    return;
+  }
+  const int64_t end_time = GetMonotonicTime();
+  WriteMarker("E", 1);
+
+  ThreadBuffer* buffer = GetThreadBuffer();
+  const uint64_t count = buffer->event_count.load(std::memory_order_relaxed);
+  Event& event = buffer->events[count % kThreadEventCapacity];
+  event.name = name_;
+  event.begin_time = begin_time_;
+  event.duration = end_time - begin_time_;
+  buffer->event_count.store(count + 1, std::memory_order_release);
+}
+}  // namespace tracing
+}  // namespace tango_gl
@@ -0,0 +1,249 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-gl/trajectory.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "tango-gl/util.h"
+
+namespace {
+// Start of the data of Trajectory::Serialize(), "TRJ1".
+const uint32_t kMagic = 0x314a5254;
+
+struct SerializedHeader {
+  uint32_t magic;
+  uint32_t point_count;
+  float spacing;
+  uint32_t reserved;
+};
+
+// Fraction of the capacity at the end of the path that is never decimated.
+const size_t kRecentFraction = 4;
+
+// Squared distance from |point| to the segment [start, end].
+float DistanceSquaredToSegment(const glm::vec3& point, const glm::vec3& start,
+                               const glm::vec3& end) {
+  const glm::vec3 segment = end - start;
+  const float length_squared = glm::dot(segment, segment);
+  float t = 0.0f;
+  if (length_squared > 0.0f) {
+    t = tango_gl::util::Clamp(
+        glm::dot(point - start, segment) / length_squared, 0.0f, 1.0f);
+  }
+  return tango_gl::util::DistanceSquared(point, start + t * segment);
+}
+
+// Mark in |keep| the points of |path| in [first, last] that are farther than
+// |tolerance| from the simplified path, with the Douglas-Peucker algorithm.
+// The first and last points are always kept.
+void SimplifyPath(const std::vector<glm::vec3>& path, size_t first,
+                  size_t last, float tolerance, std::vector<bool>* keep) {
+  const float tolerance_squared = tolerance * tolerance;
+  (*keep)[first] = true;
+  (*keep)[last] = true;
+
+  // Ranges still to simplify, without recursion so that a long path can not
+  // overflow the stack.
+  std::vector<std::pair<size_t, size_t>> ranges;
+  ranges.push_back(std::make_pair(first, last));
+  while (!ranges.empty()) {
+    const size_t begin = ranges.back().first;
+    const size_t end = ranges.back().second;
+    ranges.pop_back();
+    float max_distance_squared = 0.0f;
+    size_t farthest = begin;
+    for (size_t i = begin + 1; i < end; ++i) {
+      const float distance_squared =
+          DistanceSquaredToSegment(path[i], path[begin], path[end]);
+      if (distance_squared > max_distance_squared) {
+        max_distance_squared = distance_squared;
+        farthest = i;
+      }
+    }
+    if (max_distance_squared > tolerance_squared) {
+      (*keep)[farthest] = true;
+      ranges.push_back(std::make_pair(begin, farthest));
+      ranges.push_back(std::make_pair(farthest, end));
+    }
+  }
+}
+}  // namespace
+
+namespace tango_gl {
+
+Trajectory::Trajectory(float spacing, size_t max_point_count)
+    : spacing_(spacing),
+      max_point_count_(std::max<size_t>(max_point_count, 2 * kRecentFraction)),
+      first_changed_point_(0),
+      memory_(kMemoryTagTrajectory, kMemoryCpu) {
+  positions_.reserve(max_point_count_ + 1);
+  arc_lengths_.reserve(max_point_count_ + 1);
+  UpdateMemoryAccount();
+}
+
+bool Trajectory::Append(const glm::vec3& position) {
+  float arc_length = 0.0f;
+  if (!positions_.empty()) {
+    const float distance = glm::distance(positions_.back(), position);
+    if (distance < spacing_) {
+      return false;
+    }
+    arc_length = arc_lengths_.back() + distance;
+  }
+  positions_.push_back(position);
+  arc_lengths_.push_back(arc_length);
+  if (positions_.size() > max_point_count_) {
+    Decimate();
+  }
+  UpdateMemoryAccount();
+  return true;
+}
+
+void Trajectory::Clear() {
+  positions_.clear();
+  arc_lengths_.clear();
+  first_changed_point_ = 0;
+}
+
+size_t Trajectory::TakeFirstChangedPoint() {
+  const size_t first_changed_point =
+      std::min(first_changed_point_, positions_.size());
+  first_changed_point_ = positions_.size();
+  return first_changed_point;
+}
+
+void Trajectory::Decimate() {
+  const size_t count = positions_.size();
+  // The older part ends on the first recent point, which it keeps.
+  const size_t old_end = count - max_point_count_ / kRecentFraction;
+  const size_t target_count = max_point_count_ / 2;
+  std::vector<bool> keep(count, true);
+  size_t kept_count = count;
+  for (float tolerance = spacing_; kept_count > target_count;
+       tolerance *= 2.0f) {
+    std::fill(keep.begin(), keep.begin() + old_end, false);
+    SimplifyPath(positions_, 0, old_end, tolerance, &keep);
+    kept_count = std::count(keep.begin(), keep.end(), true);
+  }
+
+  size_t kept = 0;
+  for (size_t i = 0; i < count; ++i) {
+    if (keep[i]) {
+      positions_[kept] = positions_[i];
+      arc_lengths_[kept] = arc_lengths_[i];
+      ++kept;
+    }
+  }
+  positions_.resize(kept);
+  arc_lengths_.resize(kept);
+  // The first point is always kept, everything after it may have moved.
+  first_changed_point_ = std::min<size_t>(first_changed_point_, 1);
+}
+
+void Trajectory::Serialize(std::vector<uint8_t>* data) const {
+  SerializedHeader header;
+  header.magic = kMagic;
+  header.point_count = static_cast<uint32_t>(positions_.size());
+  header.spacing = spacing_;
+  header.reserved = 0;
+  const size_t offset = data->size();
+  data->resize(offset + sizeof(header) +
+               positions_.size() * 4 * sizeof(float));
+  uint8_t* output = data->data() + offset;
+  memcpy(output, &header, sizeof(header));
+  output += sizeof(header);
+  for (size_t i = 0; i < positions_.size(); ++i) {
+    const float point[4] = {positions_[i].x, positions_[i].y, positions_[i].z,
+                            arc_lengths_[i]};
+    memcpy(output, point, sizeof(point));
+    output += sizeof(point);
+  }
+}
+
+bool Trajectory::Deserialize(const uint8_t* data, size_t size) {
+  Clear();
+  SerializedHeader header;
+  if (size < sizeof(header)) {
+    return false;
+  }
+  memcpy(&header, data, sizeof(header));
+  if (header.magic != kMagic ||
+      (size - sizeof(header)) / (4 * sizeof(float)) < header.point_count) {
+    LOGE("Trajectory: the data is not a trajectory");
+    return false;
+  }
+  const uint8_t* input = data + sizeof(header);
+  positions_.resize(header.point_count);
+  arc_lengths_.resize(header.point_count);
+  for (size_t i = 0; i < header.point_count; ++i) {
+    float point[4];
+    memcpy(point, input, sizeof(point));
+    input += sizeof(point);
+    positions_[i] = glm::vec3(point[0], point[1], point[2]);
+    arc_lengths_[i] = point[3];
+  }
+  // A longer path than the capacity is decimated on the next append.
+  UpdateMemoryAccount();
+  return true;
+}
+
+void Trajectory::CopyFrom(const Trajectory& source,
+                          size_t first_changed_point) {
+  const size_t first = std::min(
+      first_changed_point, std::min(positions_.size(),
+                                    source.positions_.size()));
+  positions_.resize(first);
+  arc_lengths_.resize(first);
+  positions_.insert(positions_.end(), source.positions_.begin() + first,
+                    source.positions_.end());
+  arc_lengths_.insert(arc_lengths_.end(), source.arc_lengths_.begin() + first,
+                      source.arc_lengths_.end());
+  first_changed_point_ = std::min(first_changed_point_, first);
+  UpdateMemoryAccount();
+}
+
+void Trajectory::UpdateMemoryAccount() {
+  memory_.Set(positions_.capacity() * sizeof(glm::vec3) +
+              arc_lengths_.capacity() * sizeof(float));
+}
+
+SharedTrajectory::SharedTrajectory(float spacing, size_t max_point_count)
+    : trajectory_(spacing, max_point_count) {}
+
+bool SharedTrajectory::Append(const glm::vec3& position) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return trajectory_.Append(position);
+}
+
+void SharedTrajectory::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  trajectory_.Clear();
+}
+
+bool SharedTrajectory::CopyTo(Trajectory* snapshot) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const size_t first_changed_point = trajectory_.TakeFirstChangedPoint();
+  if (first_changed_point == trajectory_.GetPointCount() &&
+      snapshot->GetPointCount() == trajectory_.GetPointCount()) {
+    return false;
+  }
+  snapshot->CopyFrom(trajectory_, first_changed_point);
+  return true;
+}
+}  // namespace tango_gl
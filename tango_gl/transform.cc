@@ -15,6 +15,10 @@
  */
 
 #include "tango-gl/transform.h"
+
+#include <algorithm>
+
+#include "tango-gl/simd_math.h"
 #include "tango-gl/util.h"
 
 namespace tango_gl {
@@ -23,49 +27,101 @@ Transform::Transform()
     : parent_(nullptr),
       position_(0.0f, 0.0f, 0.0f),
       rotation_(1.0f, 0.0f, 0.0f, 0.0f),
-      scale_(1.0f, 1.0f, 1.0f) {}
+      scale_(1.0f, 1.0f, 1.0f),
+      local_matrix_(1.0f),
+      world_matrix_(1.0f),
+      is_local_matrix_dirty_(false),
+      is_world_matrix_dirty_(false) {}
 
 Transform::~Transform() {
-  // Objects are not responsible for deleting their parents.
+  // Objects are not responsible for deleting their parents, nor their
+  // children, which are left attached to the world.
+  SetParent(nullptr);
+  for (Transform* child : children_) {
+    child->parent_ = nullptr;
+    child->InvalidateWorldMatrix();
+  }
 }
 
-void Transform::SetPosition(const glm::vec3& position) { position_ = position; }
+void Transform::SetPosition(const glm::vec3& position) {
+  position_ = position;
+  SetLocalMatrixDirty();
+}
 
 glm::vec3 Transform::GetPosition() const { return position_; }
 
-void Transform::SetRotation(const glm::quat& rotation) { rotation_ = rotation; }
+void Transform::SetRotation(const glm::quat& rotation) {
+  rotation_ = rotation;
+  SetLocalMatrixDirty();
+}
 
 glm::quat Transform::GetRotation() const { return rotation_; }
 
-void Transform::SetScale(const glm::vec3& scale) { scale_ = scale; }
+void Transform::SetScale(const glm::vec3& scale) {
+  scale_ = scale;
+  SetLocalMatrixDirty();
+}
 
 glm::vec3 Transform::GetScale() const { return scale_; }
 
 void Transform::Translate(const glm::vec3& translation) {
   position_ += translation;
+  SetLocalMatrixDirty();
 }
 
 void Transform::SetTransformationMatrix(const glm::mat4& transform_mat) {
   util::DecomposeMatrix(transform_mat, position_, rotation_, scale_);
+  SetLocalMatrixDirty();
 }
 
-glm::mat4 Transform::GetTransformationMatrix() const {
-  glm::mat4 trans_mat = glm::scale(glm::mat4_cast(rotation_), scale_);
-  trans_mat[3][0] = position_.x;
-  trans_mat[3][1] = position_.y;
-  trans_mat[3][2] = position_.z;
-  glm::mat4 parent_mat = glm::mat4(1.0f);
+const glm::mat4& Transform::GetTransformationMatrix() const {
+  if (!is_world_matrix_dirty_) {
+    return world_matrix_;
+  }
+  if (is_local_matrix_dirty_) {
+    local_matrix_ = glm::scale(glm::mat4_cast(rotation_), scale_);
+    local_matrix_[3][0] = position_.x;
+    local_matrix_[3][1] = position_.y;
+    local_matrix_[3][2] = position_.z;
+    is_local_matrix_dirty_ = false;
+  }
   if (parent_ != NULL) {
-    parent_mat = parent_->GetTransformationMatrix();
-    trans_mat = parent_mat * trans_mat;
+    world_matrix_ = simd_math::Multiply(parent_->GetTransformationMatrix(),
+                                        local_matrix_);
+  } else {
+    world_matrix_ = local_matrix_;
   }
-  return trans_mat;
+  is_world_matrix_dirty_ = false;
+  return world_matrix_;
 }
 
-void Transform::SetParent(Transform* transform) { parent_ = transform; }
+void Transform::SetParent(Transform* transform) {
+  if (transform == parent_) {
+    return;
+  }
+  if (parent_ != NULL) {
+    std::vector<Transform*>& siblings = parent_->children_;
+    siblings.erase(std::find(siblings.begin(), siblings.end(), this));
+  }
+  parent_ = transform;
+  if (parent_ != NULL) {
+    parent_->children_.push_back(this);
+  }
+  InvalidateWorldMatrix();
+}
 
 const Transform* Transform::GetParent() const { return parent_; }
 
 Transform* Transform::GetParent() { return parent_; }
 
+void Transform::InvalidateWorldMatrix() {
+  if (is_world_matrix_dirty_) {
+    return;
+  }
+  is_world_matrix_dirty_ = true;
+  for (Transform* child : children_) {
+    child->InvalidateWorldMatrix();
+  }
+}
+
 }  // namespace tango_gl
@@ -16,14 +16,174 @@
 
 #include "tango-gl/util.h"
 
+#include <EGL/egl.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "tango-gl/camera_block.h"
+#include "tango-gl/gl_state.h"
+#include "tango-gl/render_statistics.h"
+
 namespace tango_gl {
 
-void util::CheckGlError(const char* operation) {
+void util::CheckGlErrorNow(const char* operation) {
   for (GLint error = glGetError(); error; error = glGetError()) {
-    LOGI("after %s() glError (0x%x)\n", operation, error);
+    // A failing call in the render loop would otherwise flood logcat.
+    TANGO_LOG_EVERY_N_SEC(ANDROID_LOG_INFO, 1.0, "after %s() glError (0x%x)",
+                          operation, error);
+  }
+}
+
+namespace {
+// GL_KHR_debug, which gl2ext.h may not define.
+typedef void(GL_APIENTRYP DebugMessageInsertFunction)(GLenum, GLenum, GLuint,
+                                                       GLenum, GLsizei,
+                                                       const GLchar*);
+
+// The operations and errors of the frame being drawn, on the GL thread.
+struct FrameErrors {
+  EGLContext context;
+  DebugMessageInsertFunction debug_message_insert;
+  // The last operation marked.
+  const char* last_operation;
+  // Set by the debug callback when an error was raised since the last
+  // operation marked, the first one of the frame being kept.
+  bool has_debug_error;
+  char debug_message[256];
+  // The operation marked after the first error, which raised it.
+  const char* failed_operation;
+};
+
+FrameErrors frame_errors = {EGL_NO_CONTEXT, NULL, NULL, false, "", NULL};
+
+// The rest is only used to check the errors of each frame.
+#if TANGO_GL_ERROR_CHECKS == TANGO_GL_ERROR_CHECKS_FRAME
+const GLenum kDebugOutput = 0x92E0;
+const GLenum kDebugOutputSynchronous = 0x8242;
+const GLenum kDebugSourceApplication = 0x824A;
+const GLenum kDebugTypeError = 0x824C;
+const GLenum kDebugTypeMarker = 0x8268;
+const GLenum kDebugSeverityNotification = 0x826B;
+const GLenum kDontCare = 0x1100;
+
+typedef void(GL_APIENTRYP DebugCallback)(GLenum source, GLenum type,
+                                          GLuint id, GLenum severity,
+                                          GLsizei length,
+                                          const GLchar* message,
+                                          const void* user_param);
+typedef void(GL_APIENTRYP DebugMessageCallbackFunction)(DebugCallback,
+                                                         const void*);
+typedef void(GL_APIENTRYP DebugMessageControlFunction)(GLenum, GLenum, GLenum,
+                                                        GLsizei,
+                                                        const GLuint*,
+                                                        GLboolean);
+
+void GL_APIENTRY OnDebugMessage(GLenum /*source*/, GLenum type,
+                                GLuint /*id*/, GLenum /*severity*/,
+                                GLsizei /*length*/, const GLchar* message,
+                                const void* /*user_param*/) {
+  if (type != kDebugTypeError || frame_errors.has_debug_error) {
+    return;
   }
+  frame_errors.has_debug_error = true;
+  snprintf(frame_errors.debug_message, sizeof(frame_errors.debug_message),
+           "%s", message);
 }
 
+// Have the errors of the current context reported as they are raised, where
+// GL_KHR_debug is supported.
+void EnableDebugErrors() {
+  frame_errors.debug_message_insert = NULL;
+  if (!util::IsGlExtensionSupported("GL_KHR_debug")) {
+    LOGI("GL_KHR_debug is not supported, GL errors are checked but not "
+         "located");
+    return;
+  }
+  const DebugMessageCallbackFunction debug_message_callback =
+      reinterpret_cast<DebugMessageCallbackFunction>(
+          eglGetProcAddress("glDebugMessageCallbackKHR"));
+  const DebugMessageControlFunction debug_message_control =
+      reinterpret_cast<DebugMessageControlFunction>(
+          eglGetProcAddress("glDebugMessageControlKHR"));
+  if (debug_message_callback == NULL || debug_message_control == NULL) {
+    return;
+  }
+  frame_errors.debug_message_insert =
+      reinterpret_cast<DebugMessageInsertFunction>(
+          eglGetProcAddress("glDebugMessageInsertKHR"));
+  // Synchronous, so that an error is reported before the next operation is
+  // marked. Only the errors, the other messages can be many.
+  GlState::Enable(kDebugOutput);
+  GlState::Enable(kDebugOutputSynchronous);
+  debug_message_control(kDontCare, kDontCare, kDontCare, 0, NULL, GL_FALSE);
+  debug_message_control(kDontCare, kDebugTypeError, kDontCare, 0, NULL,
+                        GL_TRUE);
+  debug_message_callback(OnDebugMessage, NULL);
+}
+#endif
+}  // namespace
+
+void util::MarkGlOperation(const char* operation) {
+  if (frame_errors.has_debug_error && frame_errors.failed_operation == NULL) {
+    frame_errors.failed_operation = operation;
+  }
+  frame_errors.last_operation = operation;
+}
+
+void util::CheckGlErrorsOfFrame() {
+#if TANGO_GL_ERROR_CHECKS == TANGO_GL_ERROR_CHECKS_FRAME
+  const EGLContext context = eglGetCurrentContext();
+  if (context != frame_errors.context) {
+    // The errors before are of the previous context, or of the setup.
+    frame_errors.context = context;
+    EnableDebugErrors();
+    while (glGetError() != GL_NO_ERROR) {
+    }
+  } else {
+    // The only sync with the driver of the frame.
+    const GLenum error = glGetError();
+    while (glGetError() != GL_NO_ERROR) {
+    }
+    const char* last_operation = frame_errors.last_operation != NULL
+                                     ? frame_errors.last_operation
+                                     : "the start of the frame";
+    if (frame_errors.failed_operation != NULL) {
+      TANGO_LOG_EVERY_N_SEC(ANDROID_LOG_INFO, 1.0,
+                            "in %s() glError (0x%x): %s",
+                            frame_errors.failed_operation, error,
+                            frame_errors.debug_message);
+      // Shown by the GPU debuggers, next to the calls of the frame.
+      if (frame_errors.debug_message_insert != NULL) {
+        frame_errors.debug_message_insert(
+            kDebugSourceApplication, kDebugTypeMarker, 0,
+            kDebugSeverityNotification, -1, frame_errors.failed_operation);
+      }
+    } else if (frame_errors.has_debug_error) {
+      TANGO_LOG_EVERY_N_SEC(ANDROID_LOG_INFO, 1.0,
+                            "after %s() glError (0x%x): %s", last_operation,
+                            error, frame_errors.debug_message);
+    } else if (error != GL_NO_ERROR) {
+      TANGO_LOG_EVERY_N_SEC(
+          ANDROID_LOG_INFO, 1.0,
+          "glError (0x%x) in the frame, last checked after %s(); check each "
+          "operation to find it",
+          error, last_operation);
+    }
+  }
+  frame_errors.last_operation = NULL;
+  frame_errors.has_debug_error = false;
+  frame_errors.failed_operation = NULL;
+#endif
+}
+
+// GL_COMPUTE_SHADER of GLES 3.1, which gl2.h does not define.
+static const GLenum kComputeShader = 0x91B9;
+
 // Convenience function used in CreateProgram below.
 static GLuint LoadShader(GLenum shader_type, const char* shader_source) {
   GLuint shader = glCreateShader(shader_type);
@@ -82,13 +242,532 @@ GLuint util::CreateProgram(const char* vertex_source,
           free(buf);
         }
       }
-      glDeleteProgram(program);
+      GlState::DeleteProgram(program);
+      program = 0;
+    }
+  }
+  return program;
+}
+
+GLuint util::CreateComputeProgram(const char* compute_source) {
+  GLuint compute_shader = LoadShader(kComputeShader, compute_source);
+  if (!compute_shader) {
+    return 0;
+  }
+
+  GLuint program = glCreateProgram();
+  if (program) {
+    glAttachShader(program, compute_shader);
+    CheckGlError("glAttachShader");
+    glLinkProgram(program);
+    GLint link_status = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &link_status);
+    if (link_status != GL_TRUE) {
+      GLint buf_length = 0;
+      glGetProgramiv(program, GL_INFO_LOG_LENGTH, &buf_length);
+      if (buf_length) {
+        char* buf = reinterpret_cast<char*>(malloc(buf_length));
+        if (buf) {
+          glGetProgramInfoLog(program, buf_length, NULL, buf);
+          LOGE("Could not link program:\n%s\n", buf);
+          free(buf);
+        }
+      }
+      GlState::DeleteProgram(program);
       program = 0;
     }
   }
+  // The program keeps the shader alive as long as it needs it.
+  glDeleteShader(compute_shader);
   return program;
 }
 
+bool util::IsGlExtensionSupported(const char* extension) {
+  const char* extensions =
+      reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+  if (extensions == NULL) {
+    return false;
+  }
+  // Match whole names only, one extension name can prefix another.
+  const size_t length = strlen(extension);
+  for (const char* match = strstr(extensions, extension); match != NULL;
+       match = strstr(match + length, extension)) {
+    const bool starts = match == extensions || match[-1] == ' ';
+    const bool ends = match[length] == ' ' || match[length] == '\0';
+    if (starts && ends) {
+      return true;
+    }
+  }
+  return false;
+}
+
+util::GlCapabilities::GlCapabilities()
+    : major_version(2),
+      minor_version(0),
+      gen_vertex_arrays(NULL),
+      bind_vertex_array(NULL),
+      delete_vertex_arrays(NULL),
+      draw_arrays_instanced(NULL),
+      draw_elements_instanced(NULL),
+      vertex_attrib_divisor(NULL),
+      map_buffer_range(NULL),
+      unmap_buffer(NULL),
+      fence_sync(NULL),
+      client_wait_sync(NULL),
+      delete_sync(NULL),
+      dispatch_compute(NULL),
+      memory_barrier(NULL),
+      bind_buffer_base(NULL),
+      bind_image_texture(NULL),
+      tex_storage_2d(NULL) {}
+
+namespace {
+// @return the entry point |name| followed by |suffix|, e.g. "OES".
+template <typename Function>
+Function GetProcAddress(const char* name, const char* suffix) {
+  return reinterpret_cast<Function>(
+      eglGetProcAddress((std::string(name) + suffix).c_str()));
+}
+
+void QueryGlCapabilities(util::GlCapabilities* gl) {
+  typedef util::GlCapabilities Gl;
+  const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+  int major = 0;
+  int minor = 0;
+  if (version != NULL &&
+      sscanf(version, "OpenGL ES %d.%d", &major, &minor) == 2) {
+    gl->major_version = major;
+    gl->minor_version = minor;
+  }
+  const bool is_gles3 = gl->IsGles3();
+
+  const char* suffix = is_gles3 ? "" : NULL;
+  if (!is_gles3 && util::IsGlExtensionSupported("GL_OES_vertex_array_object")) {
+    suffix = "OES";
+  }
+  if (suffix != NULL) {
+    gl->gen_vertex_arrays = GetProcAddress<Gl::GenVertexArraysFunction>(
+        "glGenVertexArrays", suffix);
+    gl->bind_vertex_array = GetProcAddress<Gl::BindVertexArrayFunction>(
+        "glBindVertexArray", suffix);
+    gl->delete_vertex_arrays = GetProcAddress<Gl::DeleteVertexArraysFunction>(
+        "glDeleteVertexArrays", suffix);
+  }
+  if (gl->gen_vertex_arrays == NULL || gl->bind_vertex_array == NULL ||
+      gl->delete_vertex_arrays == NULL) {
+    gl->gen_vertex_arrays = NULL;
+    gl->bind_vertex_array = NULL;
+    gl->delete_vertex_arrays = NULL;
+  }
+
+  suffix = is_gles3 ? "" : NULL;
+  if (!is_gles3 && util::IsGlExtensionSupported("GL_EXT_instanced_arrays")) {
+    suffix = "EXT";
+  }
+  if (suffix != NULL) {
+    gl->draw_arrays_instanced = GetProcAddress<Gl::DrawArraysInstancedFunction>(
+        "glDrawArraysInstanced", suffix);
+    gl->draw_elements_instanced =
+        GetProcAddress<Gl::DrawElementsInstancedFunction>(
+            "glDrawElementsInstanced", suffix);
+    gl->vertex_attrib_divisor = GetProcAddress<Gl::VertexAttribDivisorFunction>(
+        "glVertexAttribDivisor", suffix);
+  }
+  if (gl->draw_arrays_instanced == NULL ||
+      gl->draw_elements_instanced == NULL ||
+      gl->vertex_attrib_divisor == NULL) {
+    gl->draw_arrays_instanced = NULL;
+    gl->draw_elements_instanced = NULL;
+    gl->vertex_attrib_divisor = NULL;
+  }
+
+  if (is_gles3) {
+    gl->map_buffer_range =
+        GetProcAddress<Gl::MapBufferRangeFunction>("glMapBufferRange", "");
+    gl->unmap_buffer =
+        GetProcAddress<Gl::UnmapBufferFunction>("glUnmapBuffer", "");
+  } else if (util::IsGlExtensionSupported("GL_EXT_map_buffer_range") &&
+             util::IsGlExtensionSupported("GL_OES_mapbuffer")) {
+    gl->map_buffer_range =
+        GetProcAddress<Gl::MapBufferRangeFunction>("glMapBufferRange", "EXT");
+    gl->unmap_buffer =
+        GetProcAddress<Gl::UnmapBufferFunction>("glUnmapBuffer", "OES");
+  }
+  if (gl->map_buffer_range == NULL || gl->unmap_buffer == NULL) {
+    gl->map_buffer_range = NULL;
+    gl->unmap_buffer = NULL;
+  }
+
+  suffix = is_gles3 ? "" : NULL;
+  if (!is_gles3 && util::IsGlExtensionSupported("GL_APPLE_sync")) {
+    suffix = "APPLE";
+  }
+  if (suffix != NULL) {
+    gl->fence_sync =
+        GetProcAddress<Gl::FenceSyncFunction>("glFenceSync", suffix);
+    gl->client_wait_sync =
+        GetProcAddress<Gl::ClientWaitSyncFunction>("glClientWaitSync", suffix);
+    gl->delete_sync =
+        GetProcAddress<Gl::DeleteSyncFunction>("glDeleteSync", suffix);
+  }
+  if (gl->fence_sync == NULL || gl->client_wait_sync == NULL ||
+      gl->delete_sync == NULL) {
+    gl->fence_sync = NULL;
+    gl->client_wait_sync = NULL;
+    gl->delete_sync = NULL;
+  }
+
+  if (gl->IsGles31()) {
+    gl->dispatch_compute = GetProcAddress<Gl::DispatchComputeFunction>(
+        "glDispatchCompute", "");
+    gl->memory_barrier =
+        GetProcAddress<Gl::MemoryBarrierFunction>("glMemoryBarrier", "");
+    gl->bind_buffer_base =
+        GetProcAddress<Gl::BindBufferBaseFunction>("glBindBufferBase", "");
+    gl->bind_image_texture = GetProcAddress<Gl::BindImageTextureFunction>(
+        "glBindImageTexture", "");
+    gl->tex_storage_2d =
+        GetProcAddress<Gl::TexStorage2DFunction>("glTexStorage2D", "");
+  }
+  if (gl->dispatch_compute == NULL || gl->memory_barrier == NULL ||
+      gl->bind_buffer_base == NULL || gl->bind_image_texture == NULL ||
+      gl->tex_storage_2d == NULL) {
+    gl->dispatch_compute = NULL;
+    gl->memory_barrier = NULL;
+    gl->bind_buffer_base = NULL;
+    gl->bind_image_texture = NULL;
+    gl->tex_storage_2d = NULL;
+  }
+}
+}  // namespace
+
+const util::GlCapabilities& util::GetGlCapabilities() {
+  static EGLContext capabilities_context = EGL_NO_CONTEXT;
+  static GlCapabilities* capabilities = new GlCapabilities();
+  const EGLContext context = eglGetCurrentContext();
+  if (context != capabilities_context) {
+    capabilities_context = context;
+    *capabilities = GlCapabilities();
+    QueryGlCapabilities(capabilities);
+  }
+  return *capabilities;
+}
+
+void util::WriteUnusedBufferRange(GLenum target, GLintptr offset,
+                                  GLsizeiptr size, const void* data) {
+  const GlCapabilities& gl = GetGlCapabilities();
+  if (gl.HasMapBufferRange() && size > 0) {
+    void* mapped = gl.map_buffer_range(
+        target, offset, size,
+        GlCapabilities::kMapWriteBit | GlCapabilities::kMapInvalidateRangeBit |
+            GlCapabilities::kMapUnsynchronizedBit);
+    if (mapped != NULL) {
+      memcpy(mapped, data, size);
+      // The content is undefined if the unmap fails, it is written again
+      // below.
+      if (gl.unmap_buffer(target) == GL_TRUE) {
+        return;
+      }
+    }
+  }
+  glBufferSubData(target, offset, size, data);
+}
+
+namespace {
+// Programs returned by GetSharedProgram(), keyed by their shader sources, and
+// the context they belong to.
+struct ProgramCache {
+  ProgramCache() : context(EGL_NO_CONTEXT) {}
+
+  EGLContext context;
+  std::unordered_map<std::string, std::unique_ptr<util::SharedProgram>>
+      programs;
+  std::string binary_directory;
+};
+
+ProgramCache& GetProgramCache() {
+  static ProgramCache* cache = new ProgramCache();
+  return *cache;
+}
+
+// 64 bit FNV-1a, a hash that stays the same across launches to name the
+// program binary files.
+uint64_t HashString(const std::string& string) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (char c : string) {
+    hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+std::string GetProgramBinaryPath(const std::string& directory,
+                                 const std::string& key) {
+  char name[24];
+  snprintf(name, sizeof(name), "%016llx.bin",
+           static_cast<unsigned long long>(HashString(key)));
+  return directory + "/" + name;
+}
+
+// Entry points of GL_OES_get_program_binary, NULL if it is not supported.
+struct ProgramBinaryFunctions {
+  PFNGLGETPROGRAMBINARYOESPROC get_program_binary;
+  PFNGLPROGRAMBINARYOESPROC program_binary;
+};
+
+bool GetProgramBinaryFunctions(ProgramBinaryFunctions* functions) {
+  functions->get_program_binary = NULL;
+  functions->program_binary = NULL;
+  GLint format_count = 0;
+  if (util::IsGlExtensionSupported("GL_OES_get_program_binary")) {
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS_OES, &format_count);
+  }
+  if (format_count > 0) {
+    functions->get_program_binary =
+        reinterpret_cast<PFNGLGETPROGRAMBINARYOESPROC>(
+            eglGetProcAddress("glGetProgramBinaryOES"));
+    functions->program_binary = reinterpret_cast<PFNGLPROGRAMBINARYOESPROC>(
+        eglGetProcAddress("glProgramBinaryOES"));
+  }
+  return functions->get_program_binary != NULL &&
+         functions->program_binary != NULL;
+}
+
+// A program binary file holds the GLenum binary format followed by the
+// binary.
+GLuint LoadProgramBinary(const ProgramBinaryFunctions& functions,
+                         const std::string& path) {
+  FILE* file = fopen(path.c_str(), "rb");
+  if (file == NULL) {
+    return 0;
+  }
+  fseek(file, 0, SEEK_END);
+  const long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  uint32_t format = 0;
+  std::vector<char> binary;
+  bool read = size > static_cast<long>(sizeof(format)) &&
+              fread(&format, sizeof(format), 1, file) == 1;
+  if (read) {
+    binary.resize(size - sizeof(format));
+    read = fread(binary.data(), binary.size(), 1, file) == 1;
+  }
+  fclose(file);
+  if (!read) {
+    return 0;
+  }
+
+  GLuint program = glCreateProgram();
+  functions.program_binary(program, format, binary.data(), binary.size());
+  GLint link_status = GL_FALSE;
+  glGetProgramiv(program, GL_LINK_STATUS, &link_status);
+  if (link_status != GL_TRUE) {
+    GlState::DeleteProgram(program);
+    // Clear the error raised for a rejected binary.
+    glGetError();
+    return 0;
+  }
+  return program;
+}
+
+void SaveProgramBinary(const ProgramBinaryFunctions& functions,
+                       GLuint program, const std::string& path) {
+  GLint length = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH_OES, &length);
+  if (length <= 0) {
+    return;
+  }
+  std::vector<char> binary(length);
+  GLenum format = 0;
+  functions.get_program_binary(program, length, &length, &format,
+                               binary.data());
+
+  // Written next to the final file and renamed, so a reader never sees a
+  // partial binary.
+  const std::string temp_path = path + ".tmp";
+  FILE* file = fopen(temp_path.c_str(), "wb");
+  if (file == NULL) {
+    LOGE("Failed to create program binary %s", temp_path.c_str());
+    return;
+  }
+  const uint32_t stored_format = format;
+  bool written = fwrite(&stored_format, sizeof(stored_format), 1, file) == 1 &&
+                 fwrite(binary.data(), length, 1, file) == 1;
+  written = fclose(file) == 0 && written;
+  if (!written || rename(temp_path.c_str(), path.c_str()) != 0) {
+    LOGE("Failed to write program binary %s", path.c_str());
+    remove(temp_path.c_str());
+  }
+}
+
+// Fill |locations| with the location of every active uniform, or attribute,
+// of a program.
+void GetActiveLocations(GLuint program, bool uniforms,
+                        std::unordered_map<std::string, GLint>* locations) {
+  GLint count = 0;
+  GLint max_length = 0;
+  glGetProgramiv(program, uniforms ? GL_ACTIVE_UNIFORMS : GL_ACTIVE_ATTRIBUTES,
+                 &count);
+  glGetProgramiv(program, uniforms ? GL_ACTIVE_UNIFORM_MAX_LENGTH
+                                   : GL_ACTIVE_ATTRIBUTE_MAX_LENGTH,
+                 &max_length);
+  std::vector<char> name(max_length + 1);
+  for (GLint i = 0; i < count; ++i) {
+    GLsizei length = 0;
+    GLint size = 0;
+    GLenum type = 0;
+    if (uniforms) {
+      glGetActiveUniform(program, i, name.size(), &length, &size, &type,
+                         name.data());
+    } else {
+      glGetActiveAttrib(program, i, name.size(), &length, &size, &type,
+                        name.data());
+    }
+    std::string active_name(name.data(), length);
+    const GLint location =
+        uniforms ? glGetUniformLocation(program, active_name.c_str())
+                 : glGetAttribLocation(program, active_name.c_str());
+    // Arrays are reported as "name[0]", make them reachable as "name" too.
+    const size_t bracket = active_name.find('[');
+    if (bracket != std::string::npos) {
+      (*locations)[active_name.substr(0, bracket)] = location;
+    }
+    (*locations)[active_name] = location;
+  }
+}
+
+// Buffers returned by GetSharedVertexBuffer(), keyed by their generator and
+// parameter, and the context they belong to.
+struct VertexBufferCache {
+  VertexBufferCache() : context(EGL_NO_CONTEXT), generation(0) {}
+
+  EGLContext context;
+  uint32_t generation;
+  std::map<std::pair<util::GeometryGenerator, int>, util::SharedVertexBuffer>
+      buffers;
+};
+
+// The cache, started over if another context is current.
+VertexBufferCache& GetVertexBufferCache() {
+  static VertexBufferCache* cache = new VertexBufferCache();
+  const EGLContext context = eglGetCurrentContext();
+  if (context != cache->context) {
+    // The buffers of another context can not be used, nor deleted, here.
+    cache->buffers.clear();
+    cache->context = context;
+    ++cache->generation;
+  }
+  return *cache;
+}
+}  // namespace
+
+util::SharedProgram::SharedProgram(GLuint program) : id_(program) {
+  GetActiveLocations(id_, true, &uniform_locations_);
+  GetActiveLocations(id_, false, &attrib_locations_);
+}
+
+GLint util::SharedProgram::GetUniformLocation(const char* name) const {
+  auto found = uniform_locations_.find(name);
+  if (found != uniform_locations_.end()) {
+    return found->second;
+  }
+  // Array elements other than the first one are not in the table.
+  return strchr(name, '[') != NULL ? glGetUniformLocation(id_, name) : -1;
+}
+
+GLint util::SharedProgram::GetAttribLocation(const char* name) const {
+  auto found = attrib_locations_.find(name);
+  return found != attrib_locations_.end() ? found->second : -1;
+}
+
+const util::SharedProgram* util::GetSharedProgram(
+    const char* vertex_source, const char* fragment_source) {
+  ProgramCache& cache = GetProgramCache();
+  const EGLContext context = eglGetCurrentContext();
+  if (context != cache.context) {
+    // The programs of another context can not be used, nor deleted, here.
+    cache.programs.clear();
+    cache.context = context;
+  }
+
+  std::string key(vertex_source);
+  key.push_back('\0');
+  key.append(fragment_source);
+  auto found = cache.programs.find(key);
+  if (found != cache.programs.end()) {
+    return found->second.get();
+  }
+
+  ProgramBinaryFunctions functions;
+  const bool use_binary = !cache.binary_directory.empty() &&
+                          GetProgramBinaryFunctions(&functions);
+  const std::string binary_path =
+      use_binary ? GetProgramBinaryPath(cache.binary_directory, key) : "";
+  GLuint program = use_binary ? LoadProgramBinary(functions, binary_path) : 0;
+  if (!program) {
+    program = CreateProgram(vertex_source, fragment_source);
+    if (!program) {
+      return NULL;
+    }
+    if (use_binary) {
+      SaveProgramBinary(functions, program, binary_path);
+    }
+  }
+
+  SharedProgram* shared_program = new SharedProgram(program);
+  cache.programs[key].reset(shared_program);
+  return shared_program;
+}
+
+void util::DeleteSharedPrograms() {
+  ProgramCache& cache = GetProgramCache();
+  if (cache.context == eglGetCurrentContext()) {
+    for (const auto& entry : cache.programs) {
+      ForgetCameraUploads(entry.second->GetId());
+      GlState::DeleteProgram(entry.second->GetId());
+    }
+  }
+  cache.programs.clear();
+}
+
+const util::SharedVertexBuffer& util::GetSharedVertexBuffer(
+    GeometryGenerator generate, int parameter) {
+  VertexBufferCache& cache = GetVertexBufferCache();
+  const auto key = std::make_pair(generate, parameter);
+  auto found = cache.buffers.find(key);
+  if (found != cache.buffers.end()) {
+    return found->second;
+  }
+  std::vector<glm::vec3> vertices;
+  generate(parameter, &vertices);
+  SharedVertexBuffer buffer;
+  buffer.vertex_count = static_cast<GLsizei>(vertices.size());
+  glGenBuffers(1, &buffer.id);
+  GlState::BindBuffer(GL_ARRAY_BUFFER, buffer.id);
+  CountUpload(vertices.size() * sizeof(glm::vec3));
+  glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec3),
+               vertices.data(), GL_STATIC_DRAW);
+  GlState::BindBuffer(GL_ARRAY_BUFFER, 0);
+  CheckGlError("util::GetSharedVertexBuffer");
+  return cache.buffers[key] = buffer;
+}
+
+uint32_t util::GetSharedVertexBufferGeneration() {
+  return GetVertexBufferCache().generation;
+}
+
+void util::DeleteSharedVertexBuffers() {
+  VertexBufferCache& cache = GetVertexBufferCache();
+  for (const auto& entry : cache.buffers) {
+    GlState::DeleteBuffers(1, &entry.second.id);
+  }
+  cache.buffers.clear();
+  ++cache.generation;
+}
+
+void util::SetProgramBinaryDirectory(const std::string& directory) {
+  GetProgramCache().binary_directory = directory;
+}
+
 void util::DecomposeMatrix(const glm::mat4& transform_mat,
                            glm::vec3& translation, glm::quat& rotation,
                            glm::vec3& scale) {
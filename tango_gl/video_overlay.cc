@@ -15,119 +15,329 @@
  */
 
 #include "tango-gl/video_overlay.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "tango-gl/camera_block.h"
+#include "tango-gl/gl_state.h"
+#include "tango-gl/render_statistics.h"
 #include "tango-gl/shaders.h"
 
-namespace tango_gl {
+namespace {
+// Not in the GLES2 headers.
+const GLenum kGlRg = 0x8227;
+const GLenum kGlRg16f = 0x822F;
+const GLenum kGlHalfFloat = 0x140B;
+const GLenum kGlHalfFloatOes = 0x8D61;
+
+// The map is on the texture unit after the camera texture's.
+const int kUndistortionMapUnit = 1;
+
+// Texture coordinates of the texels of the map that the camera does not see,
+// which the shaders draw black.
+const float kInvalidCoordinate = -1.0f;
+
+// The map gives the texture coordinates of the camera image for the
+// fragment, outside [0, 1] where the camera does not see it.
+#define TANGO_GL_UNDISTORTED_FRAGMENT_SHADER_BODY                      \
+  "uniform sampler2D undistortion_map;\n"                              \
+  "varying vec2 f_textureCoords;\n"                                    \
+  "void main() {\n"                                                    \
+  "  vec2 coords = texture2D(undistortion_map, f_textureCoords).rg;\n" \
+  "  if (any(lessThan(coords, vec2(0.0))) ||\n"                        \
+  "      any(greaterThan(coords, vec2(1.0)))) {\n"                     \
+  "    gl_FragColor = vec4(0.0, 0.0, 0.0, 1.0);\n"                     \
+  "  } else {\n"                                                       \
+  "    gl_FragColor = texture2D(texture, coords);\n"                   \
+  "  }\n"                                                              \
+  "}\n"
+
+const char kUndistortedFragmentShader[] =
+    TANGO_GL_GLSL_EXTERNAL_OES TANGO_GL_GLSL_HIGHP
+    "uniform samplerExternalOES texture;\n"
+    TANGO_GL_UNDISTORTED_FRAGMENT_SHADER_BODY;
 
-static const GLfloat kVertices[] = {-1.0, 1.0, 0.0, -1.0, -1.0, 0.0,
-                                    1.0,  1.0, 0.0, 1.0,  -1.0, 0.0};
+const char kUndistortedTexture2DFragmentShader[] =
+    TANGO_GL_GLSL_HIGHP
+    "uniform sampler2D texture;\n"
+    TANGO_GL_UNDISTORTED_FRAGMENT_SHADER_BODY;
 
-static const GLushort kIndices[] = {0, 1, 2, 2, 1, 3};
+#undef TANGO_GL_UNDISTORTED_FRAGMENT_SHADER_BODY
 
-static const GLfloat kTextureCoords[] = {0.0, 0.0, 0.0, 1.0,
-                                         1.0, 0.0, 1.0, 1.0};
+// IEEE 754 half of |value|, rounded toward 0, which is well below the
+// precision the map needs.
+uint16_t ToHalf(float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  const uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+  const int exponent = static_cast<int>((bits >> 23) & 0xFF) - 127 + 15;
+  const uint32_t mantissa = bits & 0x7FFFFF;
+  if (exponent <= 0) {
+    // Too small for a normal half, flushed to 0.
+    return sign;
+  }
+  if (exponent >= 31) {
+    // Too large, or not a number, clamped to the largest half.
+    return sign | 0x7BFF;
+  }
+  return sign | static_cast<uint16_t>(exponent << 10) |
+         static_cast<uint16_t>(mantissa >> 13);
+}
+
+// The ratio of the distorted to the undistorted radius of a point at
+// |radius| on the normalized image plane, or a negative one if the camera
+// does not see it.
+double GetDistortionRatio(
+    const tango_gl::VideoOverlay::Undistortion& undistortion, double radius) {
+  if (undistortion.model == tango_gl::VideoOverlay::kFieldOfView) {
+    const double w = undistortion.distortion[0];
+    if (std::abs(w) < 1e-6 || radius < 1e-9) {
+      return 1.0;
+    }
+    return std::atan(2.0 * radius * std::tan(w / 2.0)) / (w * radius);
+  }
+  const double r2 = radius * radius;
+  const double ratio =
+      1.0 + r2 * (undistortion.distortion[0] +
+                  r2 * (undistortion.distortion[1] +
+                        r2 * undistortion.distortion[2]));
+  // Far out, the polynomial folds back onto the image.
+  return ratio > 0.0 ? ratio : -1.0;
+}
+}  // namespace
 
-VideoOverlay::VideoOverlay(GLuint texture_type) : texture_type_(texture_type) {
+namespace tango_gl {
+
+VideoOverlay::Undistortion::Undistortion()
+    : model(kFieldOfView),
+      width(0),
+      height(0),
+      fx(0.0),
+      fy(0.0),
+      cx(0.0),
+      cy(0.0),
+      map_width(0),
+      map_height(0),
+      focal_scale(1.0) {
+  distortion[0] = distortion[1] = distortion[2] = 0.0;
+}
+
+VideoOverlay::VideoOverlay(GLuint texture_type)
+    : texture_type_(texture_type),
+      undistortion_map_(0),
+      undistorted_program_(0),
+      uniform_undistorted_mvp_(-1),
+      uniform_undistorted_texture_(-1),
+      uniform_undistortion_map_(-1) {
   Initialize();
 }
 
-VideoOverlay::VideoOverlay() : texture_type_(GL_TEXTURE_EXTERNAL_OES) {
+VideoOverlay::VideoOverlay()
+    : texture_type_(GL_TEXTURE_EXTERNAL_OES),
+      undistortion_map_(0),
+      undistorted_program_(0),
+      uniform_undistorted_mvp_(-1),
+      uniform_undistorted_texture_(-1),
+      uniform_undistortion_map_(-1) {
   Initialize();
 }
 
-void VideoOverlay::Initialize() {
-  glEnable(GL_VERTEX_PROGRAM_POINT_SIZE);
-  if (texture_type_ == GL_TEXTURE_EXTERNAL_OES) {
-    shader_program_ =
-        util::CreateProgram(shaders::GetVideoOverlayVertexShader().c_str(),
-                            shaders::GetVideoOverlayFragmentShader().c_str());
-  } else {
-    shader_program_ = util::CreateProgram(
-        shaders::GetVideoOverlayVertexShader().c_str(),
-        shaders::GetVideoOverlayTexture2DFragmentShader().c_str());
-  }
+VideoOverlay::~VideoOverlay() { ClearUndistortion(); }
 
+void VideoOverlay::Initialize() {
+  GlState::Enable(GL_VERTEX_PROGRAM_POINT_SIZE);
+  const shaders::ShaderSource fragment_shader =
+      texture_type_ == GL_TEXTURE_EXTERNAL_OES
+          ? shaders::GetVideoOverlayFragmentShader()
+          : shaders::GetVideoOverlayTexture2DFragmentShader();
+  const util::SharedProgram* program = util::GetSharedProgram(
+      shaders::GetVideoOverlayVertexShader().c_str(), fragment_shader.c_str());
+  shader_program_ = program ? program->GetId() : 0;
   if (!shader_program_) {
     LOGE("Could not create program.");
   }
 
   glGenTextures(1, &texture_id_);
+  CountRender(kRenderCounterTextureBinds);
   glBindTexture(texture_type_, texture_id_);
   glTexParameteri(texture_type_, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
   glTexParameteri(texture_type_, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-  uniform_texture_ = glGetUniformLocation(shader_program_, "texture");
-
-  glGenBuffers(3, vertex_buffers_);
-  // Allocate vertices buffer.
-  glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers_[0]);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * 3 * 4, kVertices,
-               GL_STATIC_DRAW);
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-  // Allocate triangle indices buffer.
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vertex_buffers_[1]);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLushort) * 6, kIndices,
-               GL_STATIC_DRAW);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-
-  // Allocate texture coordinates buufer.
-  glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers_[2]);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * 2 * 4, kTextureCoords,
-               GL_STATIC_DRAW);
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-  // Assign the vertices attribute data.
-  attrib_vertices_ = glGetAttribLocation(shader_program_, "vertex");
-  glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers_[0]);
-  glEnableVertexAttribArray(attrib_vertices_);
-  glVertexAttribPointer(attrib_vertices_, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-  // Assign the texture coordinates attribute data.
+  uniform_texture_ = program ? program->GetUniformLocation("texture") : -1;
+
+  // Looked up once, when the shared program was linked.
+  attrib_vertices_ = program ? program->GetAttribLocation("vertex") : -1;
   attrib_texture_coords_ =
-      glGetAttribLocation(shader_program_, "textureCoords");
-  glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers_[2]);
-  glEnableVertexAttribArray(attrib_texture_coords_);
-  glVertexAttribPointer(attrib_texture_coords_, 2, GL_FLOAT, GL_FALSE, 0,
-                        nullptr);
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-  uniform_mvp_mat_ = glGetUniformLocation(shader_program_, "mvp");
+      program ? program->GetAttribLocation("textureCoords") : -1;
+  quad_.SetAttributeLocations(attrib_vertices_, attrib_texture_coords_);
+
+  uniform_mvp_mat_ = program ? program->GetUniformLocation("mvp") : -1;
+}
+
+bool VideoOverlay::SetUndistortion(const Undistortion& undistortion) {
+  if (undistortion.width <= 0 || undistortion.height <= 0 ||
+      undistortion.fx <= 0.0 || undistortion.fy <= 0.0) {
+    LOGE("VideoOverlay: invalid intrinsics for the undistortion");
+    return false;
+  }
+  const bool is_gles3 = util::GetGlCapabilities().IsGles3();
+  if (!is_gles3 &&
+      (!util::IsGlExtensionSupported("GL_OES_texture_half_float") ||
+       !util::IsGlExtensionSupported("GL_EXT_texture_rg"))) {
+    LOGI("VideoOverlay: half float RG textures are not supported, drawing "
+         "the texture distorted");
+    return false;
+  }
+  if (undistorted_program_ == 0) {
+    const util::SharedProgram* program = util::GetSharedProgram(
+        shaders::GetVideoOverlayVertexShader().c_str(),
+        texture_type_ == GL_TEXTURE_EXTERNAL_OES
+            ? kUndistortedFragmentShader
+            : kUndistortedTexture2DFragmentShader);
+    if (!program) {
+      LOGE("VideoOverlay: could not create the undistorted program");
+      return false;
+    }
+    undistorted_program_ = program->GetId();
+    uniform_undistorted_mvp_ = program->GetUniformLocation("mvp");
+    uniform_undistorted_texture_ = program->GetUniformLocation("texture");
+    uniform_undistortion_map_ = program->GetUniformLocation("undistortion_map");
+    undistorted_quad_.SetAttributeLocations(
+        program->GetAttribLocation("vertex"),
+        program->GetAttribLocation("textureCoords"));
+  }
+
+  const int map_width = undistortion.map_width > 0
+                            ? undistortion.map_width
+                            : std::max(undistortion.width / 4, 1);
+  const int map_height = undistortion.map_height > 0
+                             ? undistortion.map_height
+                             : std::max(undistortion.height / 4, 1);
+  // The undistorted image has the center and the size of the camera's, and
+  // its focal length scaled.
+  const double fx = undistortion.fx * undistortion.focal_scale;
+  const double fy = undistortion.fy * undistortion.focal_scale;
+  std::vector<uint16_t> map(map_width * map_height * 2);
+  for (int row = 0; row < map_height; ++row) {
+    const double y =
+        ((row + 0.5) / map_height * undistortion.height - undistortion.cy) /
+        fy;
+    for (int column = 0; column < map_width; ++column) {
+      const double x =
+          ((column + 0.5) / map_width * undistortion.width - undistortion.cx) /
+          fx;
+      const double ratio =
+          GetDistortionRatio(undistortion, std::sqrt(x * x + y * y));
+      float s = kInvalidCoordinate;
+      float t = kInvalidCoordinate;
+      if (ratio > 0.0) {
+        s = static_cast<float>(
+            (undistortion.fx * x * ratio + undistortion.cx) /
+            undistortion.width);
+        t = static_cast<float>(
+            (undistortion.fy * y * ratio + undistortion.cy) /
+            undistortion.height);
+      }
+      uint16_t* texel = &map[(row * map_width + column) * 2];
+      texel[0] = ToHalf(s);
+      texel[1] = ToHalf(t);
+    }
+  }
+
+  // Between texels, the coordinates are interpolated where half floats can
+  // be filtered.
+  const bool is_filterable =
+      is_gles3 ||
+      util::IsGlExtensionSupported("GL_OES_texture_half_float_linear");
+  const GLint filter = is_filterable ? GL_LINEAR : GL_NEAREST;
+  if (undistortion_map_ == 0) {
+    glGenTextures(1, &undistortion_map_);
+  }
+  CountRender(kRenderCounterTextureBinds);
+  glBindTexture(GL_TEXTURE_2D, undistortion_map_);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  if (is_gles3) {
+    CountUpload(map.size() * sizeof(uint16_t));
+    glTexImage2D(GL_TEXTURE_2D, 0, kGlRg16f, map_width, map_height, 0, kGlRg,
+                 kGlHalfFloat, map.data());
+  } else {
+    // GLES2 takes the format as the internal format.
+    CountUpload(map.size() * sizeof(uint16_t));
+    glTexImage2D(GL_TEXTURE_2D, 0, kGlRg, map_width, map_height, 0, kGlRg,
+                 kGlHalfFloatOes, map.data());
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
+  util::CheckGlError("VideoOverlay::SetUndistortion");
+  return true;
+}
+
+void VideoOverlay::ClearUndistortion() {
+  if (undistortion_map_ != 0) {
+    glDeleteTextures(1, &undistortion_map_);
+    undistortion_map_ = 0;
+  }
 }
 
 void VideoOverlay::Render(const glm::mat4& projection_mat,
                           const glm::mat4& view_mat) const {
-  glUseProgram(shader_program_);
+  glm::mat4 model_mat = GetTransformationMatrix();
+  glm::mat4 mvp_mat =
+      GetCameraBlock(projection_mat, view_mat).view_projection * model_mat;
+  Draw(mvp_mat);
+}
+
+void VideoOverlay::RenderBehind() const {
+  // Keeps x and y, and moves every vertex to z = w = 1, the far plane.
+  glm::mat4 far_plane_mat(1.0f);
+  far_plane_mat[2][2] = 0.0f;
+  far_plane_mat[3][2] = 1.0f;
+  const glm::mat4 mvp_mat = far_plane_mat * GetTransformationMatrix();
+
+  GlState::Enable(GL_DEPTH_TEST);
+  GlState::DepthFunc(GL_LEQUAL);
+  GlState::DepthMask(GL_FALSE);
+  GlState::Disable(GL_BLEND);
+  Draw(mvp_mat);
+  GlState::DepthMask(GL_TRUE);
+  GlState::DepthFunc(GL_LESS);
+}
+
+void VideoOverlay::Draw(const glm::mat4& mvp_mat) const {
+  if (undistortion_map_ != 0) {
+    GlState::UseProgram(undistorted_program_);
+    glUniform1i(uniform_undistorted_texture_, 0);
+    glUniform1i(uniform_undistortion_map_, kUndistortionMapUnit);
+    glActiveTexture(GL_TEXTURE0 + kUndistortionMapUnit);
+    CountRender(kRenderCounterTextureBinds);
+    glBindTexture(GL_TEXTURE_2D, undistortion_map_);
+    glActiveTexture(GL_TEXTURE0);
+    CountRender(kRenderCounterTextureBinds);
+    glBindTexture(texture_type_, texture_id_);
+    glUniformMatrix4fv(uniform_undistorted_mvp_, 1, GL_FALSE,
+                       glm::value_ptr(mvp_mat));
+    undistorted_quad_.Draw();
+    util::CheckGlError("VideoOverlay::Render");
+    return;
+  }
+
+  GlState::UseProgram(shader_program_);
 
   glUniform1i(uniform_texture_, 0);
   glActiveTexture(GL_TEXTURE0);
+  CountRender(kRenderCounterTextureBinds);
   glBindTexture(texture_type_, texture_id_);
 
-  glm::mat4 model_mat = GetTransformationMatrix();
-  glm::mat4 mvp_mat = projection_mat * view_mat * model_mat;
   glUniformMatrix4fv(uniform_mvp_mat_, 1, GL_FALSE, glm::value_ptr(mvp_mat));
 
-  // Bind vertices buffer.
-  glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers_[0]);
-  glEnableVertexAttribArray(attrib_vertices_);
-  glVertexAttribPointer(attrib_vertices_, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-  // Bind texture coordinates buffer.
-  glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers_[2]);
-  glEnableVertexAttribArray(attrib_texture_coords_);
-  glVertexAttribPointer(attrib_texture_coords_, 2, GL_FLOAT, GL_FALSE, 0,
-                        nullptr);
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-  // Bind element array buffer.
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vertex_buffers_[1]);
-  glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, 0);
-  util::CheckGlError("glDrawElements");
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-
-  glUseProgram(0);
-  util::CheckGlError("glUseProgram()");
+  quad_.Draw();
+
+  util::CheckGlError("VideoOverlay::Render");
 }
 
 }  // namespace tango_gl
@@ -0,0 +1,207 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "tango-gl/view_frustum.h"
+
+#include <cmath>
+#include <limits>
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define TANGO_GL_FRUSTUM_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define TANGO_GL_FRUSTUM_SSE2 1
+#endif
+
+namespace {
+// Bits of ClassifyPlanes(), for each of the four planes tested.
+struct PlaneTests {
+  // Set for the planes the box is entirely behind.
+  unsigned int outside;
+  // Set for the planes the box is not entirely in front of.
+  unsigned int crossing;
+};
+
+// Test a box of |center| whose extent along the normal of a plane is
+// |radius| + the sum of |half_extent|[i] * |dot(normal, axes[i])| against
+// the four planes of |planes|, one array of 4 per coordinate, 8 apart.
+#if defined(TANGO_GL_FRUSTUM_NEON)
+PlaneTests ClassifyPlanes(const float* planes, const glm::vec3& center,
+                          float radius, const glm::vec3* axes,
+                          const glm::vec3& half_extent) {
+  const float32x4_t nx = vld1q_f32(planes);
+  const float32x4_t ny = vld1q_f32(planes + 8);
+  const float32x4_t nz = vld1q_f32(planes + 16);
+  float32x4_t distance = vld1q_f32(planes + 24);
+  distance = vmlaq_n_f32(distance, nx, center.x);
+  distance = vmlaq_n_f32(distance, ny, center.y);
+  distance = vmlaq_n_f32(distance, nz, center.z);
+  float32x4_t extent = vdupq_n_f32(radius);
+  for (int axis = 0; axis < 3; ++axis) {
+    if (half_extent[axis] == 0.0f) {
+      continue;
+    }
+    float32x4_t projection = vmulq_n_f32(nx, axes[axis].x);
+    projection = vmlaq_n_f32(projection, ny, axes[axis].y);
+    projection = vmlaq_n_f32(projection, nz, axes[axis].z);
+    extent = vmlaq_n_f32(extent, vabsq_f32(projection), half_extent[axis]);
+  }
+  const uint32x4_t bits = {1, 2, 4, 8};
+  const uint32x4_t outside =
+      vandq_u32(vcltq_f32(distance, vnegq_f32(extent)), bits);
+  const uint32x4_t crossing = vandq_u32(vcltq_f32(distance, extent), bits);
+  uint32x2_t o = vorr_u32(vget_low_u32(outside), vget_high_u32(outside));
+  uint32x2_t c = vorr_u32(vget_low_u32(crossing), vget_high_u32(crossing));
+  PlaneTests tests;
+  tests.outside = vget_lane_u32(o, 0) | vget_lane_u32(o, 1);
+  tests.crossing = vget_lane_u32(c, 0) | vget_lane_u32(c, 1);
+  return tests;
+}
+#elif defined(TANGO_GL_FRUSTUM_SSE2)
+PlaneTests ClassifyPlanes(const float* planes, const glm::vec3& center,
+                          float radius, const glm::vec3* axes,
+                          const glm::vec3& half_extent) {
+  const __m128 nx = _mm_loadu_ps(planes);
+  const __m128 ny = _mm_loadu_ps(planes + 8);
+  const __m128 nz = _mm_loadu_ps(planes + 16);
+  __m128 distance = _mm_loadu_ps(planes + 24);
+  distance = _mm_add_ps(distance, _mm_mul_ps(nx, _mm_set1_ps(center.x)));
+  distance = _mm_add_ps(distance, _mm_mul_ps(ny, _mm_set1_ps(center.y)));
+  distance = _mm_add_ps(distance, _mm_mul_ps(nz, _mm_set1_ps(center.z)));
+  // Clearing the sign bit is the absolute value.
+  const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+  __m128 extent = _mm_set1_ps(radius);
+  for (int axis = 0; axis < 3; ++axis) {
+    if (half_extent[axis] == 0.0f) {
+      continue;
+    }
+    __m128 projection = _mm_mul_ps(nx, _mm_set1_ps(axes[axis].x));
+    projection =
+        _mm_add_ps(projection, _mm_mul_ps(ny, _mm_set1_ps(axes[axis].y)));
+    projection =
+        _mm_add_ps(projection, _mm_mul_ps(nz, _mm_set1_ps(axes[axis].z)));
+    extent = _mm_add_ps(extent, _mm_mul_ps(_mm_and_ps(projection, abs_mask),
+                                           _mm_set1_ps(half_extent[axis])));
+  }
+  PlaneTests tests;
+  tests.outside = _mm_movemask_ps(
+      _mm_cmplt_ps(distance, _mm_sub_ps(_mm_setzero_ps(), extent)));
+  tests.crossing = _mm_movemask_ps(_mm_cmplt_ps(distance, extent));
+  return tests;
+}
+#else
+PlaneTests ClassifyPlanes(const float* planes, const glm::vec3& center,
+                          float radius, const glm::vec3* axes,
+                          const glm::vec3& half_extent) {
+  PlaneTests tests = {0, 0};
+  for (int i = 0; i < 4; ++i) {
+    const glm::vec3 normal(planes[i], planes[8 + i], planes[16 + i]);
+    const float distance = glm::dot(normal, center) + planes[24 + i];
+    float extent = radius;
+    for (int axis = 0; axis < 3; ++axis) {
+      extent += std::fabs(glm::dot(normal, axes[axis])) * half_extent[axis];
+    }
+    tests.outside |= distance < -extent ? 1u << i : 0u;
+    tests.crossing |= distance < extent ? 1u << i : 0u;
+  }
+  return tests;
+}
+#endif
+}  // namespace
+
+namespace tango_gl {
+
+ViewFrustum::ViewFrustum(const glm::mat4& projection_mat,
+                         const glm::mat4& view_mat) {
+  // A point p is inside the clip volume when -w <= x, y, z <= w, with
+  // (x, y, z, w) = m * p. Every inequality is a plane on the rows of m.
+  const glm::mat4 m = projection_mat * view_mat;
+  glm::vec4 rows[4];
+  for (int row = 0; row < 4; ++row) {
+    rows[row] = glm::vec4(m[0][row], m[1][row], m[2][row], m[3][row]);
+  }
+  for (int axis = 0; axis < 3; ++axis) {
+    planes_[axis * 2] = rows[3] + rows[axis];
+    planes_[axis * 2 + 1] = rows[3] - rows[axis];
+  }
+  for (int i = 0; i < 8; ++i) {
+    glm::vec4 plane(0.0f, 0.0f, 0.0f, std::numeric_limits<float>::max());
+    if (i < 6) {
+      const float length = glm::length(glm::vec3(planes_[i]));
+      if (length > 0.0f) {
+        plane = planes_[i] / length;
+      }
+    }
+    for (int coordinate = 0; coordinate < 4; ++coordinate) {
+      normalized_planes_[coordinate][i] = plane[coordinate];
+    }
+  }
+}
+
+ViewFrustum::Containment ViewFrustum::Classify(const BoundingBox& box) const {
+  const glm::vec3& min = box.GetMin();
+  const glm::vec3& max = box.GetMax();
+  Containment containment = kInside;
+  for (const glm::vec4& plane : planes_) {
+    // The corners of the box furthest along and against the plane normal.
+    const glm::vec3 positive(plane.x > 0.0f ? max.x : min.x,
+                          plane.y > 0.0f ? max.y : min.y,
+                          plane.z > 0.0f ? max.z : min.z);
+    const glm::vec3 negative(plane.x > 0.0f ? min.x : max.x,
+                          plane.y > 0.0f ? min.y : max.y,
+                          plane.z > 0.0f ? min.z : max.z);
+    if (glm::dot(glm::vec3(plane), positive) + plane.w < 0.0f) {
+      return kOutside;
+    }
+    if (glm::dot(glm::vec3(plane), negative) + plane.w < 0.0f) {
+      containment = kIntersecting;
+    }
+  }
+  return containment;
+}
+
+ViewFrustum::Containment ViewFrustum::Classify(
+    const OrientedBoundingBox& box) const {
+  const glm::vec3 no_extent(0.0f, 0.0f, 0.0f);
+  // The sphere is cheaper: it often decides alone.
+  unsigned int outside = 0;
+  unsigned int crossing = 0;
+  for (int first = 0; first < 8; first += 4) {
+    const PlaneTests tests =
+        ClassifyPlanes(&normalized_planes_[0][first], box.GetCenter(),
+                       box.GetRadius(), box.GetAxes(), no_extent);
+    outside |= tests.outside;
+    crossing |= tests.crossing;
+  }
+  if (outside != 0) {
+    return kOutside;
+  }
+  if (crossing == 0) {
+    return kInside;
+  }
+  crossing = 0;
+  for (int first = 0; first < 8; first += 4) {
+    const PlaneTests tests =
+        ClassifyPlanes(&normalized_planes_[0][first], box.GetCenter(), 0.0f,
+                       box.GetAxes(), box.GetHalfExtent());
+    if (tests.outside != 0) {
+      return kOutside;
+    }
+    crossing |= tests.crossing;
+  }
+  return crossing == 0 ? kInside : kIntersecting;
+}
+}  // namespace tango_gl
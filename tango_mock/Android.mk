@@ -0,0 +1,37 @@
+# Copyright 2016 Google Inc. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# A mock of the Tango service, built as a static library an example links
+# instead of tango_client_api, to run without the service:
+#
+#   LOCAL_STATIC_LIBRARIES := tango_mock tango_util tango_gl
+#   ...
+#   $(call import-add-path,$(PROJECT_ROOT))
+#   $(call import-module,tango_mock)
+#
+# See tango-mock/mock_service.h for what it simulates.
+
+LOCAL_PATH := $(call my-dir)
+PROJECT_ROOT:= $(LOCAL_PATH)/..
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := tango_mock
+LOCAL_CFLAGS := -std=c++11
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/include \
+                    $(PROJECT_ROOT)/tango_client_api/include \
+                    $(PROJECT_ROOT)/third_party/glm
+LOCAL_SRC_FILES := mock_service.cc
+LOCAL_EXPORT_C_INCLUDES := $(LOCAL_PATH)/include \
+                           $(PROJECT_ROOT)/tango_client_api/include
+include $(BUILD_STATIC_LIBRARY)
@@ -0,0 +1,134 @@
+/*
+ * Copyright 2016 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_MOCK_MOCK_SERVICE_H_
+#define TANGO_MOCK_MOCK_SERVICE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <tango_client_api.h>  // NOLINT
+
+namespace tango_mock {
+// The mock service implements the part of tango_client_api.h the examples
+// use, so that their app classes run off-device, e.g. on a workstation under
+// perf or VTune, or on a device without the Tango service. It is linked in
+// place of libtango_client_api.so:
+//
+//   # ndk-build
+//   LOCAL_STATIC_LIBRARIES := tango_mock tango_util tango_gl
+//   $(call import-module,tango_mock)
+//
+//   # On a workstation, with the jni.h of a JDK.
+//   g++ -std=c++11 -Itango_client_api/include -Itango_mock/include
+//       -isystem third_party/glm -I$JAVA_HOME/include ...
+//       tango_mock/mock_service.cc <app sources> -lpthread
+//
+// The service produces a synthetic session: the device walks a circle in a
+// box shaped room, the depth camera sees the walls, floor and ceiling of the
+// room, and the color camera produces a fixed NV21 image. The rates, the
+// size of the clouds and images, and the path are MockOptions.
+//
+//   tango_mock::MockOptions options = tango_mock::GetDefaultOptions();
+//   options.depth_rate = 15.0;
+//   tango_mock::SetOptions(options);
+//   app.TangoSetupConfig();
+//   app.TangoConnect();
+//
+// By default the callbacks are called at their rate on a thread per stream,
+// like the service does. With |is_real_time| unset nothing runs on its own
+// and Step() delivers the callbacks due on the calling thread, so a
+// benchmark is repeatable and runs as fast as the app allows.
+//
+// For recorded data, set every rate to 0 and replay a session log with
+// tango_util::SessionPlayer, which calls the same callbacks and answers the
+// pose queries of tango_util::GetPoseAtTime().
+//
+// Area descriptions are not supported, and TangoService_updateTexture() only
+// reports the timestamp of the latest image: the connected texture is not
+// written, as an external texture can not be filled off-device.
+struct MockOptions {
+  // Rates of the callbacks in Hz, 0 for none. Depth also needs
+  // config_enable_depth, and the color camera config_enable_color_camera.
+  double pose_rate;
+  double depth_rate;
+  double color_rate;
+
+  // Points of each cloud, at most, as the rays that miss the room within
+  // max_depth are dropped.
+  int point_count;
+  // Range of the depth camera in meters.
+  double max_depth;
+
+  // Size of the color camera images, which its intrinsics scale with.
+  int color_width;
+  int color_height;
+
+  // The device walks a circle of |path_radius| meters in |path_period|
+  // seconds, looking along the path, |path_height| meters above the floor.
+  double path_radius;
+  double path_period;
+  double path_height;
+
+  // The half size of the room in meters, centered on the circle, and its
+  // height.
+  double room_half_size;
+  double room_height;
+
+  // Call the callbacks on threads at their rate, in real time, rather than
+  // from Step().
+  bool is_real_time;
+};
+
+// How many of each callback were called since the connection.
+struct MockStatistics {
+  uint64_t pose_count;
+  uint64_t point_cloud_count;
+  uint64_t color_frame_count;
+  uint64_t texture_update_count;
+};
+
+MockOptions GetDefaultOptions();
+
+// Canonical sessions, for benchmarks to compare their runs on the same
+// workload, see tango_util::PerformanceBudget.
+enum Scenario {
+  // The device held still above a desk, so the clouds barely change.
+  kScenarioStaticDesk = 0,
+  // Walking a wide circle along the walls of a room at walking speed.
+  kScenarioWalking,
+  // Turning in place a full turn per second, so every frame sees a new view.
+  kScenarioFastRotation
+};
+
+// @return the default options changed for |scenario|.
+MockOptions GetScenarioOptions(Scenario scenario);
+
+// Set the options of the next TangoService_connect().
+void SetOptions(const MockOptions& options);
+
+// Advance the clock by |seconds| and call the callbacks due in the meantime
+// on the calling thread, in timestamp order. Only without |is_real_time|.
+void Step(double seconds);
+
+// @return the timestamp of now, in seconds, as the callbacks and the poses
+//         of timestamp 0.0 see it.
+double GetTimestamp();
+
+MockStatistics GetStatistics();
+}  // namespace tango_mock
+
+#endif  // TANGO_MOCK_MOCK_SERVICE_H_
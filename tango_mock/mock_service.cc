@@ -0,0 +1,1034 @@
+/*
+ * Copyright 2016 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-mock/mock_service.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+namespace {
+typedef void (*PoseCallback)(void* context, const TangoPoseData* pose);
+typedef void (*XYZijCallback)(void* context, const TangoXYZij* xyz_ij);
+typedef void (*FrameCallback)(void* context, TangoCameraId id,
+                              const TangoImageBuffer* buffer);
+typedef void (*TextureCallback)(void* context, TangoCameraId id);
+
+// The handle behind a TangoConfig, its values kept as strings.
+struct Config {
+  std::map<std::string, std::string> values;
+};
+
+const double kPi = 3.14159265358979323846;
+
+// The timestamp of the connection, so that no callback has the timestamp
+// 0.0, which the pose queries read as the latest.
+const double kConnectTimestamp = 1.0;
+
+// Depths closer than this are not seen by the depth camera, in meters.
+const double kMinDepth = 0.3;
+// Relative noise of the depths.
+const double kDepthNoise = 0.005;
+
+// Focal length over image width of the color and depth cameras.
+const double kFocalLengthRatio = 0.814;
+const uint32_t kDepthWidth = 320;
+const uint32_t kDepthHeight = 180;
+const uint32_t kFisheyeWidth = 640;
+const uint32_t kFisheyeHeight = 480;
+
+// Size of the squares of the color image, in pixels.
+const uint32_t kCheckerSize = 32;
+
+enum Stream { kPoseStream = 0, kDepthStream, kColorStream, kStreamCount };
+
+// A rigid transform.
+struct Transform {
+  glm::dquat rotation;
+  glm::dvec3 translation;
+
+  Transform operator*(const Transform& other) const {
+    Transform result;
+    result.rotation = rotation * other.rotation;
+    result.translation = translation + rotation * other.translation;
+    return result;
+  }
+
+  Transform Inverse() const {
+    Transform result;
+    result.rotation = glm::conjugate(rotation);
+    result.translation = -(result.rotation * translation);
+    return result;
+  }
+};
+
+bool IsOnDevice(TangoCoordinateFrameType frame) {
+  return frame == TANGO_COORDINATE_FRAME_DEVICE ||
+         frame == TANGO_COORDINATE_FRAME_IMU ||
+         frame == TANGO_COORDINATE_FRAME_DISPLAY ||
+         frame == TANGO_COORDINATE_FRAME_CAMERA_COLOR ||
+         frame == TANGO_COORDINATE_FRAME_CAMERA_DEPTH ||
+         frame == TANGO_COORDINATE_FRAME_CAMERA_FISHEYE;
+}
+
+// The transform of a frame fixed to the device into the device frame. The
+// cameras look out of the back of the device, with x right and y down.
+Transform DeviceTFrame(TangoCoordinateFrameType frame) {
+  Transform transform;
+  transform.rotation = glm::dquat(1.0, 0.0, 0.0, 0.0);
+  transform.translation = glm::dvec3(0.0);
+  if (frame == TANGO_COORDINATE_FRAME_CAMERA_COLOR ||
+      frame == TANGO_COORDINATE_FRAME_CAMERA_DEPTH ||
+      frame == TANGO_COORDINATE_FRAME_CAMERA_FISHEYE) {
+    transform.rotation = glm::angleAxis(kPi, glm::dvec3(1.0, 0.0, 0.0));
+  }
+  return transform;
+}
+
+// A cheap and repeatable random number in [-1, 1).
+double NextNoise(uint32_t* state) {
+  *state ^= *state << 13;
+  *state ^= *state >> 17;
+  *state ^= *state << 5;
+  return *state / 2147483648.0 - 1.0;
+}
+
+class MockService {
+ public:
+  static MockService& Get() {
+    static MockService service;
+    return service;
+  }
+
+  MockService()
+      : options_(tango_mock::GetDefaultOptions()),
+        clock_origin_(std::chrono::steady_clock::now()),
+        is_connected_(false),
+        context_(nullptr),
+        is_depth_enabled_(false),
+        is_color_enabled_(false),
+        depth_rate_(0.0),
+        step_timestamp_(kConnectTimestamp),
+        motion_origin_(kConnectTimestamp),
+        pose_callback_(nullptr),
+        xyz_ij_callback_(nullptr),
+        color_frame_number_(0) {
+    for (int i = 0; i < TANGO_MAX_CAMERA_ID; ++i) {
+      frame_callbacks_[i] = nullptr;
+      frame_contexts_[i] = nullptr;
+      texture_ids_[i] = 0;
+      texture_callbacks_[i] = nullptr;
+      texture_contexts_[i] = nullptr;
+      texture_timestamps_[i] = 0.0;
+    }
+    for (int i = 0; i < kStreamCount; ++i) {
+      next_timestamps_[i] = kConnectTimestamp;
+    }
+    ResetStatistics();
+  }
+
+  ~MockService() { Disconnect(); }
+
+  void SetOptions(const tango_mock::MockOptions& options) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    options_ = options;
+  }
+
+  tango_mock::MockOptions GetOptions() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return options_;
+  }
+
+  double Now() {
+    if (!options_.is_real_time) {
+      return step_timestamp_;
+    }
+    return kConnectTimestamp +
+           std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         clock_origin_)
+               .count();
+  }
+
+  double GetTimestamp() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return Now();
+  }
+
+  Config* NewConfig(TangoConfigType type) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Config* config = new Config();
+    if ((type == TANGO_CONFIG_CURRENT || type == TANGO_CONFIG_RUNTIME) &&
+        is_connected_) {
+      *config = connected_config_;
+      config->values["config_runtime_depth_framerate"] =
+          std::to_string(static_cast<int>(depth_rate_));
+      return config;
+    }
+    config->values["config_enable_motion_tracking"] = "true";
+    config->values["config_enable_auto_recovery"] = "true";
+    config->values["config_enable_depth"] = "false";
+    config->values["config_enable_color_camera"] = "false";
+    config->values["config_enable_low_latency_imu_integration"] = "false";
+    config->values["config_enable_learning_mode"] = "false";
+    config->values["max_point_cloud_elements"] =
+        std::to_string(options_.point_count);
+    config->values["tango_service_library_version"] = "tango_mock";
+    if (type == TANGO_CONFIG_RUNTIME) {
+      config->values["config_runtime_depth_framerate"] =
+          std::to_string(static_cast<int>(options_.depth_rate));
+    }
+    return config;
+  }
+
+  TangoErrorType Connect(void* context, const Config* config) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (is_connected_) {
+        return TANGO_ERROR;
+      }
+      connected_config_ = config != nullptr ? *config : Config();
+      context_ = context;
+      is_depth_enabled_ = IsSet(connected_config_, "config_enable_depth");
+      is_color_enabled_ =
+          IsSet(connected_config_, "config_enable_color_camera");
+      depth_rate_ = options_.depth_rate;
+      clock_origin_ = std::chrono::steady_clock::now();
+      step_timestamp_ = kConnectTimestamp;
+      motion_origin_ = kConnectTimestamp;
+      for (int i = 0; i < kStreamCount; ++i) {
+        next_timestamps_[i] = kConnectTimestamp;
+      }
+      color_frame_number_ = 0;
+      SetUpCameras();
+      is_connected_ = true;
+    }
+    ResetStatistics();
+    if (options_.is_real_time) {
+      for (int i = 0; i < kStreamCount; ++i) {
+        threads_.push_back(
+            std::thread(&MockService::RunStream, this, static_cast<Stream>(i)));
+      }
+    }
+    return TANGO_SUCCESS;
+  }
+
+  // Must not be called from a callback, whose thread it waits for.
+  void Disconnect() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      is_connected_ = false;
+      pose_callback_ = nullptr;
+      pose_frames_.clear();
+      xyz_ij_callback_ = nullptr;
+      for (int i = 0; i < TANGO_MAX_CAMERA_ID; ++i) {
+        frame_callbacks_[i] = nullptr;
+        texture_ids_[i] = 0;
+        texture_callbacks_[i] = nullptr;
+      }
+    }
+    wake_.notify_all();
+    for (std::thread& thread : threads_) {
+      thread.join();
+    }
+    threads_.clear();
+  }
+
+  TangoErrorType SetRuntimeConfig(const Config* config) {
+    std::map<std::string, std::string>::const_iterator found =
+        config->values.find("config_runtime_depth_framerate");
+    if (found != config->values.end()) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      depth_rate_ = std::max(0.0, atof(found->second.c_str()));
+    }
+    wake_.notify_all();
+    return TANGO_SUCCESS;
+  }
+
+  void ResetMotionTracking() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    motion_origin_ = Now();
+  }
+
+  void ConnectOnPoseAvailable(uint32_t count,
+                              const TangoCoordinateFramePair* frames,
+                              PoseCallback callback) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pose_frames_.assign(frames, frames + count);
+    pose_callback_ = callback;
+  }
+
+  void ConnectOnXYZijAvailable(XYZijCallback callback) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    xyz_ij_callback_ = callback;
+  }
+
+  void ConnectTexture(TangoCameraId id, unsigned int texture_id,
+                      void* context, TextureCallback callback) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    texture_ids_[id] = texture_id;
+    texture_contexts_[id] = context;
+    texture_callbacks_[id] = callback;
+  }
+
+  void ConnectOnFrameAvailable(TangoCameraId id, void* context,
+                               FrameCallback callback) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    frame_contexts_[id] = context;
+    frame_callbacks_[id] = callback;
+  }
+
+  void DisconnectCamera(TangoCameraId id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    frame_callbacks_[id] = nullptr;
+    texture_ids_[id] = 0;
+    texture_callbacks_[id] = nullptr;
+  }
+
+  TangoErrorType UpdateTexture(TangoCameraId id, double* timestamp) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (texture_ids_[id] == 0) {
+      return TANGO_INVALID;
+    }
+    *timestamp = texture_timestamps_[id];
+    ++statistics_.texture_update_count;
+    return TANGO_SUCCESS;
+  }
+
+  TangoErrorType GetIntrinsics(TangoCameraId id,
+                               TangoCameraIntrinsics* intrinsics) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    *intrinsics = MakeIntrinsics(id, options_);
+    return TANGO_SUCCESS;
+  }
+
+  TangoErrorType GetPoseAtTime(double timestamp,
+                               const TangoCoordinateFramePair& frame,
+                               TangoPoseData* pose) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return ComputePose(timestamp == 0.0 ? Now() : timestamp, frame, pose);
+  }
+
+  void Step(double seconds) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!is_connected_ || options_.is_real_time) {
+      return;
+    }
+    step_timestamp_ += seconds;
+    for (;;) {
+      // The stream due first, until none is due.
+      int due = -1;
+      for (int i = 0; i < kStreamCount; ++i) {
+        if (GetRate(static_cast<Stream>(i)) > 0.0 &&
+            next_timestamps_[i] <= step_timestamp_ &&
+            (due < 0 || next_timestamps_[i] < next_timestamps_[due])) {
+          due = i;
+        }
+      }
+      if (due < 0) {
+        break;
+      }
+      const double timestamp = next_timestamps_[due];
+      next_timestamps_[due] += 1.0 / GetRate(static_cast<Stream>(due));
+      lock.unlock();
+      Deliver(static_cast<Stream>(due), timestamp);
+      lock.lock();
+    }
+  }
+
+  tango_mock::MockStatistics GetStatistics() {
+    tango_mock::MockStatistics statistics;
+    statistics.pose_count = pose_count_.load();
+    statistics.point_cloud_count = point_cloud_count_.load();
+    statistics.color_frame_count = color_frame_count_.load();
+    std::lock_guard<std::mutex> lock(mutex_);
+    statistics.texture_update_count = statistics_.texture_update_count;
+    return statistics;
+  }
+
+ private:
+  static bool IsSet(const Config& config, const char* key) {
+    std::map<std::string, std::string>::const_iterator found =
+        config.values.find(key);
+    return found != config.values.end() && found->second == "true";
+  }
+
+  static TangoCameraIntrinsics MakeIntrinsics(
+      TangoCameraId id, const tango_mock::MockOptions& options) {
+    TangoCameraIntrinsics intrinsics;
+    memset(&intrinsics, 0, sizeof(intrinsics));
+    intrinsics.camera_id = id;
+    intrinsics.calibration_type = TANGO_CALIBRATION_POLYNOMIAL_3_PARAMETERS;
+    if (id == TANGO_CAMERA_FISHEYE) {
+      intrinsics.calibration_type = TANGO_CALIBRATION_EQUIDISTANT;
+      intrinsics.width = kFisheyeWidth;
+      intrinsics.height = kFisheyeHeight;
+      intrinsics.fx = 0.4 * kFisheyeWidth;
+      intrinsics.fy = intrinsics.fx;
+      intrinsics.distortion[0] = 0.925;
+    } else if (id == TANGO_CAMERA_DEPTH) {
+      intrinsics.width = kDepthWidth;
+      intrinsics.height = kDepthHeight;
+      intrinsics.fx = kFocalLengthRatio * kDepthWidth;
+      intrinsics.fy = intrinsics.fx;
+    } else {
+      intrinsics.width = options.color_width;
+      intrinsics.height = options.color_height;
+      intrinsics.fx = kFocalLengthRatio * options.color_width;
+      intrinsics.fy = intrinsics.fx;
+    }
+    intrinsics.cx = 0.5 * intrinsics.width;
+    intrinsics.cy = 0.5 * intrinsics.height;
+    return intrinsics;
+  }
+
+  // The rays of the depth camera and the color image, for the options of
+  // the connection, under mutex_.
+  void SetUpCameras() {
+    const TangoCameraIntrinsics depth =
+        MakeIntrinsics(TANGO_CAMERA_DEPTH, options_);
+    const int point_count = std::max(1, options_.point_count);
+    const int columns = std::max(
+        1, static_cast<int>(std::sqrt(static_cast<double>(point_count) *
+                                      depth.width / depth.height)));
+    const int rows = std::max(1, point_count / columns);
+    rays_.clear();
+    rays_.reserve(columns * rows);
+    for (int row = 0; row < rows; ++row) {
+      for (int column = 0; column < columns; ++column) {
+        const double u = (column + 0.5) * depth.width / columns;
+        const double v = (row + 0.5) * depth.height / rows;
+        rays_.push_back(glm::dvec3((u - depth.cx) / depth.fx,
+                                   (v - depth.cy) / depth.fy, 1.0));
+      }
+    }
+    points_.resize(rays_.size());
+    memset(&xyz_ij_, 0, sizeof(xyz_ij_));
+
+    const uint32_t width = options_.color_width;
+    const uint32_t height = options_.color_height;
+    color_image_.resize(width * height * 3 / 2);
+    for (uint32_t y = 0; y < height; ++y) {
+      for (uint32_t x = 0; x < width; ++x) {
+        color_image_[y * width + x] =
+            ((x / kCheckerSize + y / kCheckerSize) % 2) != 0 ? 192 : 64;
+      }
+    }
+    std::fill(color_image_.begin() + width * height, color_image_.end(), 128);
+    memset(&color_buffer_, 0, sizeof(color_buffer_));
+    color_buffer_.width = width;
+    color_buffer_.height = height;
+    color_buffer_.stride = width;
+    color_buffer_.format = TANGO_HAL_PIXEL_FORMAT_YCrCb_420_SP;
+    color_buffer_.data = color_image_.data();
+  }
+
+  double GetRate(Stream stream) const {
+    switch (stream) {
+      case kPoseStream:
+        return options_.pose_rate;
+      case kDepthStream:
+        return is_depth_enabled_ ? depth_rate_ : 0.0;
+      case kColorStream:
+        return is_color_enabled_ ? options_.color_rate : 0.0;
+      default:
+        return 0.0;
+    }
+  }
+
+  // The device in the start of service frame, walking its circle from the
+  // origin along +y, upright.
+  Transform StartOfServiceTDevice(double timestamp) const {
+    const double angle = 2.0 * kPi * (timestamp - motion_origin_) /
+                         std::max(options_.path_period, 1e-3);
+    const double radius = options_.path_radius;
+    Transform transform;
+    transform.rotation =
+        glm::angleAxis(angle, glm::dvec3(0.0, 0.0, 1.0)) *
+        glm::angleAxis(0.5 * kPi, glm::dvec3(1.0, 0.0, 0.0));
+    transform.translation = glm::dvec3(radius * std::cos(angle) - radius,
+                                       radius * std::sin(angle), 0.0);
+    return transform;
+  }
+
+  // @return false for the frames the mock does not track.
+  bool GetStartOfServiceTFrame(TangoCoordinateFrameType frame,
+                               double timestamp, Transform* transform) const {
+    if (frame == TANGO_COORDINATE_FRAME_START_OF_SERVICE) {
+      transform->rotation = glm::dquat(1.0, 0.0, 0.0, 0.0);
+      transform->translation = glm::dvec3(0.0);
+      return true;
+    }
+    if (!IsOnDevice(frame)) {
+      return false;
+    }
+    *transform = StartOfServiceTDevice(timestamp) * DeviceTFrame(frame);
+    return true;
+  }
+
+  TangoErrorType ComputePose(double timestamp,
+                             const TangoCoordinateFramePair& frame,
+                             TangoPoseData* pose) const {
+    memset(pose, 0, sizeof(*pose));
+    pose->timestamp = timestamp;
+    pose->frame = frame;
+    pose->orientation[3] = 1.0;
+    pose->status_code = TANGO_POSE_INVALID;
+    Transform ss_T_base;
+    Transform ss_T_target;
+    if (!GetStartOfServiceTFrame(frame.base, timestamp, &ss_T_base) ||
+        !GetStartOfServiceTFrame(frame.target, timestamp, &ss_T_target)) {
+      return TANGO_SUCCESS;
+    }
+    // The device is only tracked since the connection or the last reset,
+    // the transforms between frames on the device are fixed.
+    const bool is_tracked = IsOnDevice(frame.base) == IsOnDevice(frame.target);
+    if (!is_tracked && timestamp < motion_origin_) {
+      return TANGO_SUCCESS;
+    }
+    const Transform base_T_target = ss_T_base.Inverse() * ss_T_target;
+    pose->orientation[0] = base_T_target.rotation.x;
+    pose->orientation[1] = base_T_target.rotation.y;
+    pose->orientation[2] = base_T_target.rotation.z;
+    pose->orientation[3] = base_T_target.rotation.w;
+    pose->translation[0] = base_T_target.translation.x;
+    pose->translation[1] = base_T_target.translation.y;
+    pose->translation[2] = base_T_target.translation.z;
+    pose->status_code = TANGO_POSE_VALID;
+    return TANGO_SUCCESS;
+  }
+
+  // Cast the rays of the depth camera on the inside of the room. Only the
+  // thread delivering depth uses the points.
+  void FillPointCloud(double timestamp) {
+    Transform ss_T_camera;
+    GetStartOfServiceTFrame(TANGO_COORDINATE_FRAME_CAMERA_DEPTH, timestamp,
+                            &ss_T_camera);
+    const double half_size = options_.room_half_size;
+    const glm::dvec3 room_min(-options_.path_radius - half_size, -half_size,
+                              -options_.path_height);
+    const glm::dvec3 room_max(-options_.path_radius + half_size, half_size,
+                              options_.room_height - options_.path_height);
+    const glm::dvec3& origin = ss_T_camera.translation;
+    uint32_t noise_state =
+        2463534242u ^ static_cast<uint32_t>(timestamp * 1000.0);
+    uint32_t count = 0;
+    for (const glm::dvec3& ray : rays_) {
+      const glm::dvec3 direction = ss_T_camera.rotation * ray;
+      double depth = options_.max_depth + 1.0;
+      for (int axis = 0; axis < 3; ++axis) {
+        if (direction[axis] > 0.0) {
+          depth = std::min(depth,
+                           (room_max[axis] - origin[axis]) / direction[axis]);
+        } else if (direction[axis] < 0.0) {
+          depth = std::min(depth,
+                           (room_min[axis] - origin[axis]) / direction[axis]);
+        }
+      }
+      if (depth < kMinDepth || depth > options_.max_depth) {
+        continue;
+      }
+      depth *= 1.0 + kDepthNoise * NextNoise(&noise_state);
+      points_[count][0] = static_cast<float>(ray.x * depth);
+      points_[count][1] = static_cast<float>(ray.y * depth);
+      points_[count][2] = static_cast<float>(depth);
+      ++count;
+    }
+    xyz_ij_.timestamp = timestamp;
+    xyz_ij_.xyz_count = count;
+    xyz_ij_.xyz = reinterpret_cast<float(*)[3]>(points_.data());
+  }
+
+  void Deliver(Stream stream, double timestamp) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    void* const context = context_;
+    if (stream == kPoseStream) {
+      const PoseCallback callback = pose_callback_;
+      const std::vector<TangoCoordinateFramePair> frames = pose_frames_;
+      for (const TangoCoordinateFramePair& frame : frames) {
+        TangoPoseData pose;
+        ComputePose(timestamp, frame, &pose);
+        if (callback != nullptr) {
+          lock.unlock();
+          callback(context, &pose);
+          lock.lock();
+          ++pose_count_;
+        }
+      }
+    } else if (stream == kDepthStream) {
+      const XYZijCallback callback = xyz_ij_callback_;
+      if (callback != nullptr) {
+        FillPointCloud(timestamp);
+        lock.unlock();
+        callback(context, &xyz_ij_);
+        ++point_cloud_count_;
+      }
+    } else if (stream == kColorStream) {
+      TextureCallback texture_callbacks[TANGO_MAX_CAMERA_ID];
+      void* texture_contexts[TANGO_MAX_CAMERA_ID];
+      for (int i = 0; i < TANGO_MAX_CAMERA_ID; ++i) {
+        texture_callbacks[i] = texture_callbacks_[i];
+        texture_contexts[i] = texture_contexts_[i];
+        if (texture_ids_[i] != 0) {
+          texture_timestamps_[i] = timestamp;
+        }
+      }
+      const FrameCallback frame_callback = frame_callbacks_[TANGO_CAMERA_COLOR];
+      void* const frame_context = frame_contexts_[TANGO_CAMERA_COLOR];
+      color_buffer_.timestamp = timestamp;
+      color_buffer_.frame_number = color_frame_number_++;
+      lock.unlock();
+      for (int i = 0; i < TANGO_MAX_CAMERA_ID; ++i) {
+        if (texture_callbacks[i] != nullptr) {
+          texture_callbacks[i](texture_contexts[i],
+                               static_cast<TangoCameraId>(i));
+        }
+      }
+      if (frame_callback != nullptr) {
+        frame_callback(frame_context, TANGO_CAMERA_COLOR, &color_buffer_);
+        ++color_frame_count_;
+      }
+    }
+  }
+
+  void RunStream(Stream stream) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    double next_timestamp = Now();
+    while (is_connected_) {
+      const double rate = GetRate(stream);
+      if (rate <= 0.0) {
+        // Until setRuntimeConfig() or the disconnection.
+        wake_.wait(lock);
+        next_timestamp = Now();
+        continue;
+      }
+      if (next_timestamp > Now()) {
+        const std::chrono::steady_clock::time_point wake_time =
+            clock_origin_ +
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(next_timestamp -
+                                              kConnectTimestamp));
+        wake_.wait_until(lock, wake_time);
+        continue;
+      }
+      lock.unlock();
+      Deliver(stream, next_timestamp);
+      lock.lock();
+      // A slow callback drops the samples it missed rather than catching up
+      // in a burst, as the service does.
+      next_timestamp = std::max(next_timestamp + 1.0 / rate, Now());
+    }
+  }
+
+  void ResetStatistics() {
+    pose_count_.store(0);
+    point_cloud_count_.store(0);
+    color_frame_count_.store(0);
+    std::lock_guard<std::mutex> lock(mutex_);
+    memset(&statistics_, 0, sizeof(statistics_));
+  }
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::vector<std::thread> threads_;
+
+  tango_mock::MockOptions options_;
+  std::chrono::steady_clock::time_point clock_origin_;
+  bool is_connected_;
+  Config connected_config_;
+  void* context_;
+  bool is_depth_enabled_;
+  bool is_color_enabled_;
+  double depth_rate_;
+  double step_timestamp_;
+  double next_timestamps_[kStreamCount];
+  double motion_origin_;
+
+  PoseCallback pose_callback_;
+  std::vector<TangoCoordinateFramePair> pose_frames_;
+  XYZijCallback xyz_ij_callback_;
+  FrameCallback frame_callbacks_[TANGO_MAX_CAMERA_ID];
+  void* frame_contexts_[TANGO_MAX_CAMERA_ID];
+  unsigned int texture_ids_[TANGO_MAX_CAMERA_ID];
+  TextureCallback texture_callbacks_[TANGO_MAX_CAMERA_ID];
+  void* texture_contexts_[TANGO_MAX_CAMERA_ID];
+  double texture_timestamps_[TANGO_MAX_CAMERA_ID];
+
+  // The rays of the depth camera, and the cloud they hit.
+  std::vector<glm::dvec3> rays_;
+  std::vector<glm::vec3> points_;
+  TangoXYZij xyz_ij_;
+
+  std::vector<uint8_t> color_image_;
+  TangoImageBuffer color_buffer_;
+  int64_t color_frame_number_;
+
+  std::atomic<uint64_t> pose_count_;
+  std::atomic<uint64_t> point_cloud_count_;
+  std::atomic<uint64_t> color_frame_count_;
+  tango_mock::MockStatistics statistics_;
+};
+
+bool IsValidCamera(TangoCameraId id) {
+  return id >= 0 && id < TANGO_MAX_CAMERA_ID;
+}
+
+template <typename T>
+TangoErrorType GetValue(TangoConfig config, const char* key, T* value,
+                        T (*parse)(const std::string&)) {
+  if (config == nullptr || key == nullptr || value == nullptr) {
+    return TANGO_INVALID;
+  }
+  const Config* values = static_cast<const Config*>(config);
+  std::map<std::string, std::string>::const_iterator found =
+      values->values.find(key);
+  if (found == values->values.end()) {
+    return TANGO_INVALID;
+  }
+  *value = parse(found->second);
+  return TANGO_SUCCESS;
+}
+
+TangoErrorType SetValue(TangoConfig config, const char* key,
+                        const std::string& value) {
+  if (config == nullptr || key == nullptr) {
+    return TANGO_INVALID;
+  }
+  static_cast<Config*>(config)->values[key] = value;
+  return TANGO_SUCCESS;
+}
+
+bool ParseBool(const std::string& value) { return value == "true"; }
+int32_t ParseInt32(const std::string& value) {
+  return static_cast<int32_t>(strtol(value.c_str(), nullptr, 10));
+}
+int64_t ParseInt64(const std::string& value) {
+  return strtoll(value.c_str(), nullptr, 10);
+}
+double ParseDouble(const std::string& value) {
+  return strtod(value.c_str(), nullptr);
+}
+}  // namespace
+
+namespace tango_mock {
+
+MockOptions GetDefaultOptions() {
+  MockOptions options;
+  options.pose_rate = 100.0;
+  options.depth_rate = 5.0;
+  options.color_rate = 30.0;
+  options.point_count = 12000;
+  options.max_depth = 4.0;
+  options.color_width = 1280;
+  options.color_height = 720;
+  options.path_radius = 1.0;
+  options.path_period = 20.0;
+  options.path_height = 1.3;
+  options.room_half_size = 3.0;
+  options.room_height = 2.6;
+  options.is_real_time = true;
+  return options;
+}
+
+MockOptions GetScenarioOptions(Scenario scenario) {
+  MockOptions options = GetDefaultOptions();
+  switch (scenario) {
+    case kScenarioStaticDesk:
+      options.path_radius = 0.0;
+      options.path_period = 1e9;
+      options.path_height = 0.4;
+      options.room_half_size = 1.0;
+      options.room_height = 1.5;
+      break;
+    case kScenarioWalking:
+      options.path_radius = 2.0;
+      options.path_period = 30.0;
+      options.room_half_size = 3.0;
+      break;
+    case kScenarioFastRotation:
+      options.path_radius = 0.0;
+      options.path_period = 1.0;
+      break;
+  }
+  return options;
+}
+
+void SetOptions(const MockOptions& options) {
+  MockService::Get().SetOptions(options);
+}
+
+void Step(double seconds) { MockService::Get().Step(seconds); }
+
+double GetTimestamp() { return MockService::Get().GetTimestamp(); }
+
+MockStatistics GetStatistics() { return MockService::Get().GetStatistics(); }
+}  // namespace tango_mock
+
+extern "C" {
+
+TangoErrorType TangoService_initialize(JNIEnv*, jobject) {
+  return TANGO_SUCCESS;
+}
+
+TangoErrorType TangoService_setBinder(JNIEnv*, jobject) {
+  return TANGO_SUCCESS;
+}
+
+TangoConfig TangoService_getConfig(TangoConfigType config_type) {
+  return MockService::Get().NewConfig(config_type);
+}
+
+TangoErrorType TangoService_connect(void* context, TangoConfig config) {
+  return MockService::Get().Connect(context,
+                                    static_cast<const Config*>(config));
+}
+
+TangoErrorType TangoService_setRuntimeConfig(TangoConfig tconfig) {
+  if (tconfig == nullptr) {
+    return TANGO_INVALID;
+  }
+  return MockService::Get().SetRuntimeConfig(
+      static_cast<const Config*>(tconfig));
+}
+
+void TangoService_disconnect() { MockService::Get().Disconnect(); }
+
+void TangoService_resetMotionTracking() {
+  MockService::Get().ResetMotionTracking();
+}
+
+TangoErrorType TangoService_connectOnPoseAvailable(
+    uint32_t count, const TangoCoordinateFramePair* frames,
+    void (*TangoService_onPoseAvailable)(void* context,
+                                         const TangoPoseData* pose),
+    ...) {
+  if (count > 0 && frames == nullptr) {
+    return TANGO_INVALID;
+  }
+  MockService::Get().ConnectOnPoseAvailable(count, frames,
+                                            TangoService_onPoseAvailable);
+  return TANGO_SUCCESS;
+}
+
+TangoErrorType TangoService_getPoseAtTime(double timestamp,
+                                          TangoCoordinateFramePair frame,
+                                          TangoPoseData* pose) {
+  if (pose == nullptr) {
+    return TANGO_INVALID;
+  }
+  return MockService::Get().GetPoseAtTime(timestamp, frame, pose);
+}
+
+TangoErrorType TangoService_connectOnXYZijAvailable(
+    void (*TangoService_onXYZijAvailable)(void* context,
+                                          const TangoXYZij* xyz_ij),
+    ...) {
+  MockService::Get().ConnectOnXYZijAvailable(TangoService_onXYZijAvailable);
+  return TANGO_SUCCESS;
+}
+
+// Events are accepted, but the mock has none to report.
+TangoErrorType TangoService_connectOnTangoEvent(
+    void (*)(void* context, const TangoEvent* event), ...) {
+  return TANGO_SUCCESS;
+}
+
+TangoErrorType TangoService_connectTextureId(TangoCameraId id, unsigned int tex,
+                                             void* context,
+                                             void (*callback)(void*,
+                                                              TangoCameraId)) {
+  if (!IsValidCamera(id)) {
+    return TANGO_INVALID;
+  }
+  MockService::Get().ConnectTexture(id, tex, context, callback);
+  return TANGO_SUCCESS;
+}
+
+TangoErrorType TangoService_updateTexture(TangoCameraId id,
+                                          double* timestamp) {
+  if (!IsValidCamera(id) || timestamp == nullptr) {
+    return TANGO_INVALID;
+  }
+  return MockService::Get().UpdateTexture(id, timestamp);
+}
+
+TangoErrorType TangoService_connectOnFrameAvailable(
+    TangoCameraId id, void* context,
+    void (*onFrameAvailable)(void* context, TangoCameraId id,
+                             const TangoImageBuffer* buffer)) {
+  if (!IsValidCamera(id)) {
+    return TANGO_INVALID;
+  }
+  MockService::Get().ConnectOnFrameAvailable(id, context, onFrameAvailable);
+  return TANGO_SUCCESS;
+}
+
+TangoErrorType TangoService_disconnectCamera(TangoCameraId id) {
+  if (!IsValidCamera(id)) {
+    return TANGO_INVALID;
+  }
+  MockService::Get().DisconnectCamera(id);
+  return TANGO_SUCCESS;
+}
+
+TangoErrorType TangoService_getCameraIntrinsics(
+    TangoCameraId camera_id, TangoCameraIntrinsics* intrinsics) {
+  if (!IsValidCamera(camera_id) || intrinsics == nullptr) {
+    return TANGO_INVALID;
+  }
+  return MockService::Get().GetIntrinsics(camera_id, intrinsics);
+}
+
+TangoErrorType TangoService_saveAreaDescription(TangoUUID*) {
+  return TANGO_ERROR;
+}
+
+TangoErrorType TangoService_deleteAreaDescription(const TangoUUID) {
+  return TANGO_ERROR;
+}
+
+TangoErrorType TangoService_getAreaDescriptionUUIDList(char** uuid_list) {
+  if (uuid_list == nullptr) {
+    return TANGO_INVALID;
+  }
+  static char empty_list[] = "";
+  *uuid_list = empty_list;
+  return TANGO_SUCCESS;
+}
+
+TangoErrorType TangoService_getAreaDescriptionMetadata(
+    const TangoUUID, TangoAreaDescriptionMetadata*) {
+  return TANGO_ERROR;
+}
+
+TangoErrorType TangoService_saveAreaDescriptionMetadata(
+    const TangoUUID, TangoAreaDescriptionMetadata) {
+  return TANGO_ERROR;
+}
+
+TangoErrorType TangoAreaDescriptionMetadata_free(
+    TangoAreaDescriptionMetadata) {
+  return TANGO_ERROR;
+}
+
+TangoErrorType TangoAreaDescriptionMetadata_get(TangoAreaDescriptionMetadata,
+                                                const char*, size_t*,
+                                                char**) {
+  return TANGO_ERROR;
+}
+
+TangoErrorType TangoAreaDescriptionMetadata_set(TangoAreaDescriptionMetadata,
+                                                const char*, size_t,
+                                                const char*) {
+  return TANGO_ERROR;
+}
+
+void TangoConfig_free(TangoConfig config) {
+  delete static_cast<Config*>(config);
+}
+
+char* TangoConfig_toString(TangoConfig config) {
+  std::string text;
+  if (config != nullptr) {
+    for (const std::pair<const std::string, std::string>& value :
+         static_cast<const Config*>(config)->values) {
+      text += value.first + "=" + value.second + ";";
+    }
+  }
+  char* result = static_cast<char*>(malloc(text.size() + 1));
+  memcpy(result, text.c_str(), text.size() + 1);
+  return result;
+}
+
+TangoErrorType TangoConfig_setBool(TangoConfig config, const char* key,
+                                   bool value) {
+  return SetValue(config, key, value ? "true" : "false");
+}
+
+TangoErrorType TangoConfig_setInt32(TangoConfig config, const char* key,
+                                    int32_t value) {
+  return SetValue(config, key, std::to_string(value));
+}
+
+TangoErrorType TangoConfig_setInt64(TangoConfig config, const char* key,
+                                    int64_t value) {
+  return SetValue(config, key, std::to_string(value));
+}
+
+TangoErrorType TangoConfig_setDouble(TangoConfig config, const char* key,
+                                     double value) {
+  char text[32];
+  snprintf(text, sizeof(text), "%.17g", value);
+  return SetValue(config, key, text);
+}
+
+TangoErrorType TangoConfig_setString(TangoConfig config, const char* key,
+                                     const char* value) {
+  if (value == nullptr) {
+    return TANGO_INVALID;
+  }
+  return SetValue(config, key, value);
+}
+
+TangoErrorType TangoConfig_getBool(TangoConfig config, const char* key,
+                                   bool* value) {
+  return GetValue(config, key, value, ParseBool);
+}
+
+TangoErrorType TangoConfig_getInt32(TangoConfig config, const char* key,
+                                    int32_t* value) {
+  return GetValue(config, key, value, ParseInt32);
+}
+
+TangoErrorType TangoConfig_getInt64(TangoConfig config, const char* key,
+                                    int64_t* value) {
+  return GetValue(config, key, value, ParseInt64);
+}
+
+TangoErrorType TangoConfig_getDouble(TangoConfig config, const char* key,
+                                     double* value) {
+  return GetValue(config, key, value, ParseDouble);
+}
+
+TangoErrorType TangoConfig_getString(TangoConfig config, const char* key,
+                                     char* value, size_t size) {
+  if (config == nullptr || key == nullptr || value == nullptr || size == 0) {
+    return TANGO_INVALID;
+  }
+  const Config* values = static_cast<const Config*>(config);
+  std::map<std::string, std::string>::const_iterator found =
+      values->values.find(key);
+  if (found == values->values.end()) {
+    return TANGO_INVALID;
+  }
+  const size_t length = std::min(found->second.size(), size - 1);
+  memcpy(value, found->second.data(), length);
+  value[length] = '\0';
+  return TANGO_SUCCESS;
+}
+}  // extern "C"
@@ -18,6 +18,13 @@ PROJECT_ROOT:= $(LOCAL_PATH)/..
 include $(CLEAR_VARS)
 LOCAL_MODULE := tango_support_api
 LOCAL_EXPORT_C_INCLUDES := $(LOCAL_PATH)/include
+
+# The Tango libraries only ship for the 32-bit ABIs, and a 64-bit process
+# cannot load them.
+ifeq ($(filter $(TARGET_ARCH_ABI),armeabi-v7a x86),)
+    $(error The Tango libraries are not available for $(TARGET_ARCH_ABI))
+endif
+
 ifeq ($(TARGET_ARCH),x86)
     LOCAL_SRC_FILES := $(LOCAL_PATH)/lib/x86/libtango_support_api.so
 else
@@ -0,0 +1,115 @@
+# Copyright 2016 Google Inc. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# The tango_util helpers around the Tango service, built as a static library
+# the examples import along with tango_gl:
+#
+#   LOCAL_STATIC_LIBRARIES := tango_util tango_gl
+#   ...
+#   $(call import-add-path,$(PROJECT_ROOT))
+#   $(call import-module,tango_gl)
+#   $(call import-module,tango_util)
+#
+# Only the objects an example references are linked into it.
+
+LOCAL_PATH := $(call my-dir)
+PROJECT_ROOT:= $(LOCAL_PATH)/..
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := tango_util
+LOCAL_SHARED_LIBRARIES := tango_client_api tango_support_api
+LOCAL_STATIC_LIBRARIES := tango_gl libpng
+LOCAL_CFLAGS := -std=c++11
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/include
+LOCAL_SRC_FILES := anchor_store.cc \
+                   autotuner.cc \
+                   callback_dispatcher.cc \
+                   camera_stream_scheduler.cc \
+                   convex_hull.cc \
+                   depth_segmenter.cc \
+                   depth_temporal_filter.cc \
+                   display_configuration.cc \
+                   extrinsics_cache.cc \
+                   fast_corner_detector.cc \
+                   feature_demand.cc \
+                   frame_arena.cc \
+                   frame_exporter.cc \
+                   frame_pacer.cc \
+                   frame_pipeline.cc \
+                   hit_tester.cc \
+                   image_pyramid.cc \
+                   intrinsics_registry.cc \
+                   keyframe_store.cc \
+                   latency_tracker.cc \
+                   map_sync.cc \
+                   marching_cubes.cc \
+                   model_aligner.cc \
+                   network_streamer.cc \
+                   normal_estimator.cc \
+                   occupancy_grid.cc \
+                   path_calibration.cc \
+                   path_planner.cc \
+                   performance_budget.cc \
+                   performance_hint.cc \
+                   plane_detector.cc \
+                   plane_tracker.cc \
+                   ply_exporter.cc \
+                   point_cloud_buffer.cc \
+                   point_cloud_codec.cc \
+                   point_cloud_map.cc \
+                   point_kd_tree.cc \
+                   point_cloud_queue.cc \
+                   pose_bus.cc \
+                   pose_history.cc \
+                   pose_predictor.cc \
+                   pose_source.cc \
+                   projected_depth_cache.cc \
+                   quality_governor.cc \
+                   render_scheduler.cc \
+                   session_log.cc \
+                   session_player.cc \
+                   session_recorder.cc \
+                   shared_sensor_publisher.cc \
+                   shared_sensor_reader.cc \
+                   slot_ring.cc \
+                   snapshot_writer.cc \
+                   startup_timer.cc \
+                   tag_detector.cc \
+                   task_scheduler.cc \
+                   texture_atlas_baker.cc \
+                   thread_policy.cc \
+                   tile_file.cc \
+                   touch_queue.cc \
+                   tsdf_volume.cc \
+                   voxel_grid_filter.cc \
+                   worker_pool.cc
+LOCAL_EXPORT_C_INCLUDES := $(LOCAL_PATH)/include
+# PerformanceHintSession looks up the hint functions with dlsym().
+LOCAL_EXPORT_LDLIBS := -ldl
+
+# The depth, meshing and filtering loops run on every point cloud.
+ifeq ($(APP_OPTIM),release)
+LOCAL_CFLAGS += -O3
+endif
+ifeq ($(TARGET_ARCH_ABI),armeabi-v7a)
+LOCAL_ARM_MODE := arm
+LOCAL_ARM_NEON := true
+endif
+include $(BUILD_STATIC_LIBRARY)
+
+$(call import-add-path,$(PROJECT_ROOT))
+$(call import-module,tango_client_api)
+$(call import-module,tango_support_api)
+$(call import-module,tango_gl)
+$(call import-module,third_party/libpng)
@@ -0,0 +1,83 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "tango-util/anchor_store.h"
+
+#include <algorithm>
+
+namespace tango_util {
+
+AnchorStore::Options::Options() : smoothing_frames(15) {}
+
+AnchorStore::AnchorStore(const Options& options)
+    : smoothing_frames_(std::max(options.smoothing_frames, 0)),
+      is_dirty_(false),
+      smoothing_frame_(smoothing_frames_) {}
+
+int AnchorStore::AddAnchor(const tango_gl::RigidTransform& world_T_anchor) {
+  area_T_anchors_.push_back(world_T_area_.Inverse() * world_T_anchor);
+  transforms_.push_back(world_T_anchor.ToMatrix());
+  return static_cast<int>(area_T_anchors_.size()) - 1;
+}
+
+int AnchorStore::AddAreaAnchor(const tango_gl::RigidTransform& area_T_anchor) {
+  area_T_anchors_.push_back(area_T_anchor);
+  transforms_.push_back((world_T_area_ * area_T_anchor).ToMatrix());
+  return static_cast<int>(area_T_anchors_.size()) - 1;
+}
+
+void AnchorStore::Clear() {
+  area_T_anchors_.clear();
+  transforms_.clear();
+  is_dirty_ = true;
+}
+
+void AnchorStore::SetWorldTArea(const tango_gl::RigidTransform& world_T_area) {
+  // A correction arriving while one is eased in starts from where the
+  // content is, so it does not jump either.
+  start_world_T_area_ = world_T_area_;
+  target_world_T_area_ = world_T_area;
+  smoothing_frame_ = 0;
+  if (smoothing_frames_ == 0) {
+    world_T_area_ = world_T_area;
+    is_dirty_ = true;
+  }
+}
+
+bool AnchorStore::Update() {
+  if (IsSmoothing()) {
+    ++smoothing_frame_;
+    const float t = static_cast<float>(smoothing_frame_) / smoothing_frames_;
+    // Ease in and out, for the content to start and stop gently.
+    const float weight = t * t * (3.0f - 2.0f * t);
+    world_T_area_ = tango_gl::RigidTransform(
+        glm::slerp(start_world_T_area_.GetRotation(),
+                   target_world_T_area_.GetRotation(), weight),
+        glm::mix(start_world_T_area_.GetTranslation(),
+                 target_world_T_area_.GetTranslation(), weight));
+    is_dirty_ = true;
+  }
+  if (!is_dirty_) {
+    return false;
+  }
+  is_dirty_ = false;
+  for (size_t i = 0; i < area_T_anchors_.size(); ++i) {
+    transforms_[i] = (world_T_area_ * area_T_anchors_[i]).ToMatrix();
+  }
+  return true;
+}
+}  // namespace tango_util
@@ -0,0 +1,206 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "tango-util/autotuner.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include <tango-gl/util.h>
+
+namespace {
+// Longest line of the store, the key included.
+const int kMaxLineLength = 1024;
+
+// Longest parameter name stored.
+const int kMaxNameLength = 64;
+
+// @return: the index of the first parameter from |begin| with more than one
+//          value, |parameters| size if there is none.
+size_t FindTunedParameter(
+    const std::vector<tango_util::Autotuner::Parameter>& parameters,
+    size_t begin) {
+  while (begin < parameters.size() && parameters[begin].values.size() < 2) {
+    ++begin;
+  }
+  return begin;
+}
+}  // namespace
+
+namespace tango_util {
+
+Autotuner::Options::Options()
+    : warmup_samples(3), trial_samples(9), sweep_count(2) {}
+
+Autotuner::Autotuner(const std::vector<Parameter>& parameters,
+                     const Options& options)
+    : parameters_(parameters),
+      warmup_samples_(std::max(options.warmup_samples, 0)),
+      trial_samples_(std::max(options.trial_samples, 1)),
+      sweep_count_(std::max(options.sweep_count, 1)),
+      can_explore_(false) {
+  for (Parameter& parameter : parameters_) {
+    if (parameter.values.empty()) {
+      LOGE("Autotuner: no value for %s, using 0", parameter.name.c_str());
+      parameter.values.push_back(0);
+    }
+  }
+  samples_.reserve(trial_samples_);
+  Restart();
+}
+
+void Autotuner::SetStore(const std::string& path, const std::string& key) {
+  path_ = path;
+  key_ = key;
+  std::replace(key_.begin(), key_.end(), '\n', ' ');
+}
+
+bool Autotuner::Load() {
+  if (path_.empty()) {
+    return false;
+  }
+  FILE* file = fopen(path_.c_str(), "r");
+  if (file == NULL) {
+    return false;
+  }
+  char line[kMaxLineLength];
+  const size_t length =
+      fgets(line, sizeof(line), file) != NULL ? strlen(line) : 0;
+  if (length == 0 || line[length - 1] != '\n' ||
+      key_.compare(0, std::string::npos, line, length - 1) != 0) {
+    fclose(file);
+    return false;
+  }
+  std::vector<size_t> loaded(parameters_.size(), 0);
+  std::vector<bool> is_loaded(parameters_.size(), false);
+  char name[kMaxNameLength];
+  int value;
+  while (fscanf(file, "%63s %d", name, &value) == 2) {
+    for (size_t i = 0; i < parameters_.size(); ++i) {
+      const std::vector<int>& values = parameters_[i].values;
+      const std::vector<int>::const_iterator it =
+          std::find(values.begin(), values.end(), value);
+      if (parameters_[i].name == name && it != values.end()) {
+        loaded[i] = it - values.begin();
+        is_loaded[i] = true;
+      }
+    }
+  }
+  fclose(file);
+  if (std::find(is_loaded.begin(), is_loaded.end(), false) !=
+      is_loaded.end()) {
+    return false;
+  }
+  best_ = loaded;
+  is_converged_ = true;
+  return true;
+}
+
+void Autotuner::Restart() {
+  best_.assign(parameters_.size(), 0);
+  sweep_ = 0;
+  parameter_ = FindTunedParameter(parameters_, 0);
+  is_converged_ = parameter_ == parameters_.size();
+  candidate_ = 0;
+  samples_.clear();
+  warmup_left_ = warmup_samples_;
+  candidate_times_.clear();
+}
+
+void Autotuner::SetCanExplore(bool can_explore) {
+  // The samples of the best values ran since, the next ones warm up again.
+  if (can_explore && !can_explore_) {
+    warmup_left_ = warmup_samples_;
+  }
+  can_explore_ = can_explore;
+}
+
+int Autotuner::GetValue(size_t index) const {
+  const Parameter& parameter = parameters_[index];
+  if (can_explore_ && !is_converged_ && index == parameter_) {
+    return parameter.values[candidate_];
+  }
+  return parameter.values[best_[index]];
+}
+
+void Autotuner::AddSample(double time) {
+  if (is_converged_ || !can_explore_) {
+    return;
+  }
+  if (warmup_left_ > 0) {
+    --warmup_left_;
+    return;
+  }
+  samples_.push_back(time);
+  if (static_cast<int>(samples_.size()) < trial_samples_) {
+    return;
+  }
+  std::nth_element(samples_.begin(), samples_.begin() + samples_.size() / 2,
+                   samples_.end());
+  candidate_times_.push_back(samples_[samples_.size() / 2]);
+  samples_.clear();
+  warmup_left_ = warmup_samples_;
+  NextTrial();
+}
+
+void Autotuner::NextTrial() {
+  ++candidate_;
+  if (candidate_ < parameters_[parameter_].values.size()) {
+    return;
+  }
+  // Every value of the parameter was timed with the best of the others.
+  best_[parameter_] =
+      std::min_element(candidate_times_.begin(), candidate_times_.end()) -
+      candidate_times_.begin();
+  candidate_times_.clear();
+  candidate_ = 0;
+  parameter_ = FindTunedParameter(parameters_, parameter_ + 1);
+  if (parameter_ < parameters_.size()) {
+    return;
+  }
+  parameter_ = FindTunedParameter(parameters_, 0);
+  if (++sweep_ < sweep_count_) {
+    return;
+  }
+  is_converged_ = true;
+  if (!path_.empty() && !Store()) {
+    LOGE("Autotuner: could not store the values in %s", path_.c_str());
+  }
+}
+
+bool Autotuner::Store() const {
+  // Written aside and renamed, for a crash not to leave half a store.
+  const std::string temporary_path = path_ + ".tmp";
+  FILE* file = fopen(temporary_path.c_str(), "w");
+  if (file == NULL) {
+    return false;
+  }
+  bool is_written = fprintf(file, "%s\n", key_.c_str()) > 0;
+  for (size_t i = 0; i < parameters_.size(); ++i) {
+    is_written = is_written &&
+                 fprintf(file, "%s %d\n", parameters_[i].name.c_str(),
+                         parameters_[i].values[best_[i]]) > 0;
+  }
+  if (fclose(file) != 0 || !is_written) {
+    remove(temporary_path.c_str());
+    return false;
+  }
+  return rename(temporary_path.c_str(), path_.c_str()) == 0;
+}
+
+}  // namespace tango_util
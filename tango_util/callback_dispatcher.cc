@@ -0,0 +1,187 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/callback_dispatcher.h"
+
+#include <algorithm>
+
+#include "tango-util/performance_hint.h"
+
+namespace tango_util {
+
+DispatchQueueBase::DispatchQueueBase(const char* name, size_t capacity,
+                                     OverflowPolicy policy)
+    : name_(name),
+      capacity_(std::max<size_t>(capacity, 1)),
+      policy_(policy),
+      dispatcher_(nullptr),
+      head_(0),
+      size_(0),
+      post_times_(capacity_) {
+  ResetStats();
+}
+
+DispatchQueueStats DispatchQueueBase::GetStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  DispatchQueueStats stats;
+  stats.depth = size_;
+  stats.max_depth = max_depth_;
+  stats.posted_count = posted_count_;
+  stats.dispatched_count = dispatched_count_;
+  stats.dropped_count = dropped_count_;
+  stats.average_latency =
+      dispatched_count_ > 0 ? total_latency_ / dispatched_count_ : 0.0;
+  stats.max_latency = max_latency_;
+  return stats;
+}
+
+void DispatchQueueBase::ResetStats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  max_depth_ = size_;
+  posted_count_ = 0;
+  dispatched_count_ = 0;
+  dropped_count_ = 0;
+  total_latency_ = 0.0;
+  max_latency_ = 0.0;
+}
+
+int DispatchQueueBase::ReserveSlot() {
+  ++posted_count_;
+  if (size_ == capacity_) {
+    ++dropped_count_;
+    if (policy_ == kDropNewest) {
+      return -1;
+    }
+    head_ = (head_ + 1) % capacity_;
+    --size_;
+  }
+  const size_t slot = (head_ + size_) % capacity_;
+  post_times_[slot] = Clock::now();
+  ++size_;
+  max_depth_ = std::max(max_depth_, size_);
+  return static_cast<int>(slot);
+}
+
+int DispatchQueueBase::ReleaseSlot() {
+  if (size_ == 0) {
+    return -1;
+  }
+  const size_t slot = head_;
+  head_ = (head_ + 1) % capacity_;
+  --size_;
+  const double latency =
+      std::chrono::duration<double>(Clock::now() - post_times_[slot]).count();
+  ++dispatched_count_;
+  total_latency_ += latency;
+  max_latency_ = std::max(max_latency_, latency);
+  return static_cast<int>(slot);
+}
+
+void DispatchQueueBase::NotifyDispatcher() {
+  if (dispatcher_ != nullptr) {
+    dispatcher_->Notify();
+  }
+}
+
+CallbackDispatcher::CallbackDispatcher()
+    : thread_stage_(ThreadPolicy::kCallbackStage),
+      hint_session_(nullptr),
+      has_posted_items_(false),
+      is_stopping_(false) {}
+
+CallbackDispatcher::~CallbackDispatcher() { Stop(); }
+
+void CallbackDispatcher::AddQueue(DispatchQueueBase* queue) {
+  queue->dispatcher_ = this;
+  queues_.push_back(queue);
+}
+
+void CallbackDispatcher::SetPerformanceHintSession(
+    PerformanceHintSession* session, double target_duration) {
+  hint_session_ = session;
+  if (hint_session_ != nullptr) {
+    hint_session_->SetTargetDuration(target_duration);
+  }
+}
+
+void CallbackDispatcher::Start() {
+  if (worker_.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    is_stopping_ = false;
+    // Handle whatever was posted while the worker was stopped.
+    has_posted_items_ = true;
+  }
+  worker_ = std::thread(&CallbackDispatcher::Run, this);
+}
+
+void CallbackDispatcher::Stop() {
+  if (!worker_.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    is_stopping_ = true;
+  }
+  condition_.notify_one();
+  worker_.join();
+}
+
+void CallbackDispatcher::Notify() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    has_posted_items_ = true;
+  }
+  condition_.notify_one();
+}
+
+void CallbackDispatcher::Run() {
+  if (hint_session_ != nullptr) {
+    hint_session_->AddCurrentThread();
+  }
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      condition_.wait(lock,
+                      [this] { return has_posted_items_ || is_stopping_; });
+      if (is_stopping_) {
+        return;
+      }
+      has_posted_items_ = false;
+    }
+    ThreadPolicy::Get().Enter(thread_stage_);
+    const std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    // Take one item of every queue in turn, so a busy queue does not starve
+    // the others.
+    bool dispatched = true;
+    while (dispatched) {
+      dispatched = false;
+      for (DispatchQueueBase* queue : queues_) {
+        dispatched = queue->DispatchOne() || dispatched;
+      }
+    }
+    if (hint_session_ != nullptr) {
+      hint_session_->ReportActualDuration(
+          std::chrono::duration<double, std::milli>(
+              std::chrono::steady_clock::now() - start)
+              .count());
+    }
+  }
+}
+}  // namespace tango_util
@@ -0,0 +1,233 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "tango-util/camera_stream_scheduler.h"
+
+#include <tango-gl/tracing.h>
+
+namespace {
+// Routes the frame callbacks of the service to their scheduler.
+void OnFrameAvailableRouter(void* context, TangoCameraId camera) {
+  static_cast<tango_util::CameraStreamScheduler*>(context)->OnFrameAvailable(
+      camera);
+}
+
+bool IsValidCamera(TangoCameraId camera) {
+  return camera >= 0 && camera < TANGO_MAX_CAMERA_ID;
+}
+}  // namespace
+
+namespace tango_util {
+
+CameraStreamScheduler::CameraStreamScheduler() : reference_camera_(-1) {
+  for (Stream& stream : streams_) {
+    stream.is_added.store(false);
+    stream.drop_policy.store(kPaused);
+    stream.has_new_frame.store(false);
+    stream.frame_count.store(0);
+    stream.dropped_frame_count.store(0);
+    stream.texture_id = 0;
+    stream.min_update_interval = Clock::duration::zero();
+    stream.timestamp = 0.0;
+  }
+}
+
+void CameraStreamScheduler::SetFrameFunction(
+    const FrameFunction& frame_function) {
+  std::lock_guard<std::mutex> lock(frame_mutex_);
+  frame_function_ = frame_function;
+}
+
+void CameraStreamScheduler::AddStream(TangoCameraId camera, GLuint texture_id,
+                                      DropPolicy drop_policy,
+                                      double min_update_interval) {
+  if (!IsValidCamera(camera)) {
+    LOGE("CameraStreamScheduler: Invalid camera %d.", camera);
+    return;
+  }
+  Stream& stream = streams_[camera];
+  stream.texture_id = texture_id;
+  stream.min_update_interval = std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>(min_update_interval));
+  stream.last_update_time = Clock::time_point();
+  stream.timestamp = 0.0;
+  stream.drop_policy.store(drop_policy);
+  stream.is_added.store(true);
+  if (reference_camera_ < 0) {
+    reference_camera_ = camera;
+  }
+}
+
+void CameraStreamScheduler::Clear() {
+  for (Stream& stream : streams_) {
+    stream.is_added.store(false);
+    stream.has_new_frame.store(false);
+    stream.timestamp = 0.0;
+  }
+  reference_camera_ = -1;
+}
+
+bool CameraStreamScheduler::Connect() {
+  bool is_connected = true;
+  for (int camera = 0; camera < TANGO_MAX_CAMERA_ID; ++camera) {
+    Stream& stream = streams_[camera];
+    if (!stream.is_added.load()) {
+      continue;
+    }
+    stream.frame_count.store(0);
+    stream.dropped_frame_count.store(0);
+    const TangoErrorType ret = TangoService_connectTextureId(
+        static_cast<TangoCameraId>(camera), stream.texture_id, this,
+        OnFrameAvailableRouter);
+    if (ret != TANGO_SUCCESS) {
+      LOGE(
+          "CameraStreamScheduler: Failed to connect the texture of camera %d "
+          "with error code: %d",
+          camera, ret);
+      is_connected = false;
+    }
+  }
+  return is_connected;
+}
+
+void CameraStreamScheduler::SetDropPolicy(TangoCameraId camera,
+                                          DropPolicy drop_policy) {
+  if (IsValidCamera(camera)) {
+    streams_[camera].drop_policy.store(drop_policy);
+  }
+}
+
+uint32_t CameraStreamScheduler::UpdateTextures() {
+  if (reference_camera_ < 0) {
+    return 0;
+  }
+  const Clock::time_point now = Clock::now();
+  const TangoCameraId reference = static_cast<TangoCameraId>(reference_camera_);
+  uint32_t updated = 0;
+  if (UpdateStream(reference, now, false)) {
+    updated |= StreamBit(reference);
+  }
+  const bool is_reference_updated =
+      updated != 0 || streams_[reference].drop_policy.load() == kPaused;
+  for (int i = 0; i < TANGO_MAX_CAMERA_ID; ++i) {
+    const TangoCameraId camera = static_cast<TangoCameraId>(i);
+    if (camera != reference &&
+        UpdateStream(camera, now, is_reference_updated)) {
+      updated |= StreamBit(camera);
+    }
+  }
+  return updated;
+}
+
+bool CameraStreamScheduler::UpdateStream(TangoCameraId camera,
+                                         Clock::time_point now,
+                                         bool is_reference_updated) {
+  Stream& stream = streams_[camera];
+  if (!stream.is_added.load() || !stream.has_new_frame.load()) {
+    return false;
+  }
+  switch (stream.drop_policy.load()) {
+    case kPaused:
+      if (stream.has_new_frame.exchange(false)) {
+        ++stream.dropped_frame_count;
+      }
+      return false;
+    case kWithReference:
+      if (!is_reference_updated) {
+        return false;
+      }
+      break;
+    default:
+      break;
+  }
+  // A frame arriving before the interval is over stays pending, and is
+  // counted as dropped once a newer one replaces it.
+  if (now - stream.last_update_time < stream.min_update_interval) {
+    return false;
+  }
+  stream.has_new_frame.store(false);
+  TangoErrorType ret;
+  {
+    TANGO_TRACE_SCOPE("TangoService_updateTexture");
+    ret = TangoService_updateTexture(camera, &stream.timestamp);
+  }
+  if (ret != TANGO_SUCCESS) {
+    LOGE(
+        "CameraStreamScheduler: Failed to update the texture of camera %d "
+        "with error code: %d",
+        camera, ret);
+    return false;
+  }
+  stream.last_update_time = now;
+  return true;
+}
+
+GLuint CameraStreamScheduler::GetTextureId(TangoCameraId camera) const {
+  return IsValidCamera(camera) && streams_[camera].is_added.load()
+             ? streams_[camera].texture_id
+             : 0;
+}
+
+double CameraStreamScheduler::GetTimestamp(TangoCameraId camera) const {
+  return IsValidCamera(camera) ? streams_[camera].timestamp : 0.0;
+}
+
+double CameraStreamScheduler::GetTimestampOffset(TangoCameraId camera) const {
+  if (!IsValidCamera(camera) || reference_camera_ < 0) {
+    return 0.0;
+  }
+  const double timestamp = streams_[camera].timestamp;
+  const double reference_timestamp = streams_[reference_camera_].timestamp;
+  if (timestamp == 0.0 || reference_timestamp == 0.0) {
+    return 0.0;
+  }
+  return timestamp - reference_timestamp;
+}
+
+uint64_t CameraStreamScheduler::GetFrameCount(TangoCameraId camera) const {
+  return IsValidCamera(camera) ? streams_[camera].frame_count.load() : 0;
+}
+
+uint64_t CameraStreamScheduler::GetDroppedFrameCount(
+    TangoCameraId camera) const {
+  return IsValidCamera(camera) ? streams_[camera].dropped_frame_count.load()
+                               : 0;
+}
+
+void CameraStreamScheduler::OnFrameAvailable(TangoCameraId camera) {
+  if (!IsValidCamera(camera)) {
+    return;
+  }
+  Stream& stream = streams_[camera];
+  if (!stream.is_added.load()) {
+    return;
+  }
+  ++stream.frame_count;
+  // The service updates a texture to its latest image, so a frame still
+  // pending is replaced by this one.
+  if (stream.has_new_frame.exchange(true)) {
+    ++stream.dropped_frame_count;
+  }
+  if (stream.drop_policy.load() != kLatestFrame) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(frame_mutex_);
+  if (frame_function_) {
+    frame_function_(camera);
+  }
+}
+}  // namespace tango_util
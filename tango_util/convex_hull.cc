@@ -0,0 +1,103 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/convex_hull.h"
+
+#include <algorithm>
+
+namespace {
+// Twice the signed area of the triangle (a, b, c), positive when it turns
+// counterclockwise.
+inline float Cross(const glm::vec2& a, const glm::vec2& b,
+                   const glm::vec2& c) {
+  return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+}
+
+inline bool IsLess(const glm::vec2& a, const glm::vec2& b) {
+  return a.x < b.x || (a.x == b.x && a.y < b.y);
+}
+}  // namespace
+
+namespace tango_util {
+
+void ComputeConvexHull(std::vector<glm::vec2>* points) {
+  const size_t count = points->size();
+  if (count < 3) {
+    return;
+  }
+  std::vector<glm::vec2>& sorted = *points;
+  std::sort(sorted.begin(), sorted.end(), IsLess);
+  // Andrew's monotone chain: the lower then the upper chain, each point
+  // removing the vertices it makes turn clockwise.
+  std::vector<glm::vec2> hull(2 * count);
+  size_t size = 0;
+  for (size_t i = 0; i < count; ++i) {
+    while (size >= 2 &&
+           Cross(hull[size - 2], hull[size - 1], sorted[i]) <= 0.0f) {
+      --size;
+    }
+    hull[size++] = sorted[i];
+  }
+  const size_t lower_size = size + 1;
+  for (size_t i = count - 1; i-- > 0;) {
+    while (size >= lower_size &&
+           Cross(hull[size - 2], hull[size - 1], sorted[i]) <= 0.0f) {
+      --size;
+    }
+    hull[size++] = sorted[i];
+  }
+  // The last vertex is the first one again.
+  hull.resize(size - 1);
+  points->swap(hull);
+}
+
+void SimplifyConvexHull(size_t max_vertex_count,
+                        std::vector<glm::vec2>* hull) {
+  // A few vertices are removed at a time from hulls of a few dozen, the
+  // areas are computed again for each.
+  std::vector<glm::vec2>& vertices = *hull;
+  const size_t min_vertex_count = std::max<size_t>(max_vertex_count, 3);
+  while (vertices.size() > min_vertex_count) {
+    const size_t count = vertices.size();
+    size_t smallest = 0;
+    float smallest_area = 0.0f;
+    for (size_t i = 0; i < count; ++i) {
+      const float area = Cross(vertices[(i + count - 1) % count], vertices[i],
+                               vertices[(i + 1) % count]);
+      if (i == 0 || area < smallest_area) {
+        smallest = i;
+        smallest_area = area;
+      }
+    }
+    vertices.erase(vertices.begin() + smallest);
+  }
+}
+
+bool IsInsideConvexHull(const std::vector<glm::vec2>& hull,
+                        const glm::vec2& point) {
+  const size_t count = hull.size();
+  if (count < 3) {
+    return false;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    if (Cross(hull[i], hull[(i + 1) % count], point) < 0.0f) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace tango_util
@@ -0,0 +1,283 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/depth_segmenter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include <tango-gl/tracing.h>
+
+namespace {
+// Cell of the points off the grid.
+const uint32_t kNoCell = 0xFFFFFFFFu;
+}  // namespace
+
+namespace tango_util {
+
+const uint32_t DepthSegmenter::kNoSegment;
+
+DepthSegmenter::Options::Options()
+    : grid_scale(0.5f),
+      max_depth_change(0.05f),
+      min_point_count(50),
+      tile_size(32),
+      thread_count(2) {}
+
+DepthSegmenter::DepthSegmenter(const Options& options)
+    : options_(options),
+      worker_pool_(options.thread_count),
+      has_intrinsics_(false),
+      grid_width_(0),
+      grid_height_(0) {
+  options_.tile_size = std::max(options_.tile_size, 1);
+  memset(&intrinsics_, 0, sizeof(intrinsics_));
+}
+
+void DepthSegmenter::SetIntrinsics(const TangoCameraIntrinsics& intrinsics) {
+  intrinsics_ = intrinsics;
+  has_intrinsics_ = intrinsics.width > 0 && intrinsics.height > 0;
+}
+
+const std::vector<DepthSegmenter::Segment>& DepthSegmenter::Split(
+    const TangoXYZij* xyz_ij) {
+  TANGO_TRACE_SCOPE("DepthSegmenter::Split");
+  segments_.clear();
+  point_segments_.assign(xyz_ij->xyz_count, kNoSegment);
+  if (!LayOut(xyz_ij)) {
+    return segments_;
+  }
+
+  // Every cell starts as a tree of its own.
+  const uint32_t cell_count = grid_width_ * grid_height_;
+  parents_.resize(cell_count);
+  for (uint32_t cell = 0; cell < cell_count; ++cell) {
+    parents_[cell] = cell;
+  }
+  const int tile_size = options_.tile_size;
+  const int tile_columns = (grid_width_ + tile_size - 1) / tile_size;
+  const int tile_rows = (grid_height_ + tile_size - 1) / tile_size;
+  worker_pool_.ParallelFor(tile_columns * tile_rows,
+                           [this, tile_columns](size_t tile) {
+                             ConnectTile(static_cast<int>(tile) % tile_columns,
+                                         static_cast<int>(tile) / tile_columns);
+                           });
+  ConnectTileBorders();
+
+  // The trees are only read from here on, so the roots are found in
+  // parallel.
+  roots_.resize(cell_count);
+  worker_pool_.ParallelFor(grid_height_, [this](size_t row) {
+    const uint32_t begin = static_cast<uint32_t>(row) * grid_width_;
+    for (uint32_t cell = begin; cell < begin + grid_width_; ++cell) {
+      uint32_t root = cell;
+      while (parents_[root] != root) {
+        root = parents_[root];
+      }
+      roots_[cell] = root;
+    }
+  });
+
+  Segment empty;
+  empty.point_count = 0;
+  empty.bounding_min = glm::vec3(std::numeric_limits<float>::max());
+  empty.bounding_max = glm::vec3(-std::numeric_limits<float>::max());
+  empty.min_column = grid_width_;
+  empty.min_row = grid_height_;
+  empty.max_column = -1;
+  empty.max_row = -1;
+  root_segments_.assign(cell_count, empty);
+  for (uint32_t i = 0; i < xyz_ij->xyz_count; ++i) {
+    // The points behind the nearest one of their cell, of a surface the
+    // cell straddles the edge of, are left out.
+    if (cells_[i] == kNoCell ||
+        !IsSameSurface(xyz_ij->xyz[i][2], depths_[cells_[i]])) {
+      cells_[i] = kNoCell;
+      continue;
+    }
+    const int row = static_cast<int>(cells_[i]) / grid_width_;
+    const int column = static_cast<int>(cells_[i]) % grid_width_;
+    const glm::vec3 point = glm::make_vec3(xyz_ij->xyz[i]);
+    Segment& segment = root_segments_[roots_[cells_[i]]];
+    ++segment.point_count;
+    segment.bounding_min = glm::min(segment.bounding_min, point);
+    segment.bounding_max = glm::max(segment.bounding_max, point);
+    segment.min_column = std::min(segment.min_column, column);
+    segment.min_row = std::min(segment.min_row, row);
+    segment.max_column = std::max(segment.max_column, column);
+    segment.max_row = std::max(segment.max_row, row);
+  }
+
+  // The segments large enough are numbered by decreasing size. The trees are
+  // not needed anymore, parents_ becomes the index of the segment of every
+  // root.
+  const uint32_t min_point_count =
+      std::max<uint32_t>(options_.min_point_count, 1);
+  kept_roots_.clear();
+  for (uint32_t cell = 0; cell < cell_count; ++cell) {
+    if (root_segments_[cell].point_count >= min_point_count) {
+      kept_roots_.push_back(cell);
+    }
+  }
+  std::sort(kept_roots_.begin(), kept_roots_.end(),
+            [this](uint32_t a, uint32_t b) {
+              return root_segments_[a].point_count >
+                     root_segments_[b].point_count;
+            });
+  std::fill(parents_.begin(), parents_.end(), kNoSegment);
+  segments_.reserve(kept_roots_.size());
+  for (uint32_t root : kept_roots_) {
+    parents_[root] = static_cast<uint32_t>(segments_.size());
+    segments_.push_back(root_segments_[root]);
+  }
+  for (uint32_t i = 0; i < xyz_ij->xyz_count; ++i) {
+    if (cells_[i] != kNoCell) {
+      point_segments_[i] = parents_[roots_[cells_[i]]];
+    }
+  }
+  return segments_;
+}
+
+bool DepthSegmenter::LayOut(const TangoXYZij* xyz_ij) {
+  const uint32_t point_count = xyz_ij->xyz_count;
+  const bool has_ij =
+      xyz_ij->ij != nullptr && xyz_ij->ij_rows > 0 && xyz_ij->ij_cols > 0;
+  if (has_ij) {
+    grid_width_ = static_cast<int>(xyz_ij->ij_cols);
+    grid_height_ = static_cast<int>(xyz_ij->ij_rows);
+  } else if (has_intrinsics_) {
+    const float scale = options_.grid_scale;
+    grid_width_ =
+        std::max(1, static_cast<int>(std::ceil(intrinsics_.width * scale)));
+    grid_height_ =
+        std::max(1, static_cast<int>(std::ceil(intrinsics_.height * scale)));
+  } else {
+    LOGE("DepthSegmenter: no ij buffer nor intrinsics to lay out the points");
+    return false;
+  }
+
+  cells_.assign(point_count, kNoCell);
+  depths_.assign(grid_width_ * grid_height_, 0.0f);
+  if (has_ij) {
+    const uint32_t cell_count = xyz_ij->ij_rows * xyz_ij->ij_cols;
+    for (uint32_t cell = 0; cell < cell_count; ++cell) {
+      const uint32_t index = xyz_ij->ij[cell];
+      if (index < point_count && xyz_ij->xyz[index][2] > 0.0f) {
+        cells_[index] = cell;
+        depths_[cell] = xyz_ij->xyz[index][2];
+      }
+    }
+    return true;
+  }
+
+  const double scale = options_.grid_scale;
+  for (uint32_t i = 0; i < point_count; ++i) {
+    const float* point = xyz_ij->xyz[i];
+    if (!(point[2] > 0.0f)) {
+      continue;
+    }
+    const int column = static_cast<int>(std::floor(
+        (intrinsics_.fx * point[0] / point[2] + intrinsics_.cx) * scale));
+    const int row = static_cast<int>(std::floor(
+        (intrinsics_.fy * point[1] / point[2] + intrinsics_.cy) * scale));
+    if (column < 0 || column >= grid_width_ || row < 0 ||
+        row >= grid_height_) {
+      continue;
+    }
+    const uint32_t cell = static_cast<uint32_t>(row * grid_width_ + column);
+    cells_[i] = cell;
+    // The cell is connected by its nearest depth.
+    if (depths_[cell] == 0.0f || point[2] < depths_[cell]) {
+      depths_[cell] = point[2];
+    }
+  }
+  return true;
+}
+
+void DepthSegmenter::ConnectTile(int tile_column, int tile_row) {
+  const int tile_size = options_.tile_size;
+  const int left = tile_column * tile_size;
+  const int top = tile_row * tile_size;
+  const int right = std::min(left + tile_size, grid_width_);
+  const int bottom = std::min(top + tile_size, grid_height_);
+  for (int row = top; row < bottom; ++row) {
+    for (int column = left; column < right; ++column) {
+      const uint32_t cell = row * grid_width_ + column;
+      if (depths_[cell] == 0.0f) {
+        continue;
+      }
+      if (column > left && IsConnected(cell, cell - 1)) {
+        Union(cell, cell - 1);
+      }
+      if (row > top && IsConnected(cell, cell - grid_width_)) {
+        Union(cell, cell - grid_width_);
+      }
+    }
+  }
+}
+
+void DepthSegmenter::ConnectTileBorders() {
+  const int tile_size = options_.tile_size;
+  // The first column of every tile but the leftmost with the last of the
+  // tile to its left, then the same for the rows.
+  for (int column = tile_size; column < grid_width_; column += tile_size) {
+    for (int row = 0; row < grid_height_; ++row) {
+      const uint32_t cell = row * grid_width_ + column;
+      if (IsConnected(cell, cell - 1)) {
+        Union(cell, cell - 1);
+      }
+    }
+  }
+  for (int row = tile_size; row < grid_height_; row += tile_size) {
+    for (int column = 0; column < grid_width_; ++column) {
+      const uint32_t cell = row * grid_width_ + column;
+      if (IsConnected(cell, cell - grid_width_)) {
+        Union(cell, cell - grid_width_);
+      }
+    }
+  }
+}
+
+bool DepthSegmenter::IsConnected(uint32_t a, uint32_t b) const {
+  return depths_[a] > 0.0f && depths_[b] > 0.0f &&
+         IsSameSurface(depths_[a], depths_[b]);
+}
+
+bool DepthSegmenter::IsSameSurface(float depth_a, float depth_b) const {
+  return std::abs(depth_a - depth_b) <=
+         options_.max_depth_change * std::min(depth_a, depth_b);
+}
+
+uint32_t DepthSegmenter::Find(uint32_t cell) {
+  while (parents_[cell] != cell) {
+    parents_[cell] = parents_[parents_[cell]];
+    cell = parents_[cell];
+  }
+  return cell;
+}
+
+void DepthSegmenter::Union(uint32_t a, uint32_t b) {
+  const uint32_t root_a = Find(a);
+  const uint32_t root_b = Find(b);
+  if (root_a < root_b) {
+    parents_[root_b] = root_a;
+  } else if (root_b < root_a) {
+    parents_[root_a] = root_b;
+  }
+}
+}  // namespace tango_util
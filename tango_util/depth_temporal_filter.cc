@@ -0,0 +1,199 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/depth_temporal_filter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <tango-gl/tracing.h>
+
+namespace tango_util {
+
+DepthTemporalFilter::Options::Options()
+    : image_scale(0.5f),
+      max_weight(8.0f),
+      max_depth_change(0.03f),
+      max_missing_count(2) {}
+
+DepthTemporalFilter::DepthTemporalFilter(const Options& options)
+    : options_(options),
+      width_(0),
+      height_(0),
+      fx_(0.0f),
+      fy_(0.0f),
+      cx_(0.0f),
+      cy_(0.0f),
+      has_previous_(false) {
+  memset(&filtered_, 0, sizeof(filtered_));
+}
+
+void DepthTemporalFilter::SetIntrinsics(
+    const TangoCameraIntrinsics& intrinsics) {
+  const float scale = options_.image_scale;
+  width_ = std::max(1, static_cast<int>(std::ceil(intrinsics.width * scale)));
+  height_ =
+      std::max(1, static_cast<int>(std::ceil(intrinsics.height * scale)));
+  fx_ = intrinsics.fx * scale;
+  fy_ = intrinsics.fy * scale;
+  cx_ = intrinsics.cx * scale;
+  cy_ = intrinsics.cy * scale;
+  rays_.Reset(width_, height_, fx_, fy_, cx_, cy_);
+
+  const size_t pixel_count = width_ * height_;
+  depth_.assign(pixel_count, 0.0f);
+  weight_.assign(pixel_count, 0.0f);
+  missing_count_.assign(pixel_count, 0.0f);
+  warped_depth_.assign(pixel_count, 0.0f);
+  warped_weight_.assign(pixel_count, 0.0f);
+  warped_missing_count_.assign(pixel_count, 0.0f);
+  raw_depth_.assign(pixel_count, 0.0f);
+  points_.reserve(3 * pixel_count);
+  has_previous_ = false;
+}
+
+void DepthTemporalFilter::Reset() { has_previous_ = false; }
+
+const TangoXYZij* DepthTemporalFilter::Filter(const TangoXYZij* xyz_ij,
+                                              const glm::mat4& world_T_depth) {
+  if (xyz_ij == nullptr || depth_.empty()) {
+    return xyz_ij;
+  }
+  TANGO_TRACE_SCOPE("DepthTemporalFilter::Filter");
+  if (has_previous_) {
+    Warp(glm::inverse(world_T_depth) * previous_world_T_depth_);
+  } else {
+    std::fill(warped_depth_.begin(), warped_depth_.end(), 0.0f);
+  }
+  Splat(xyz_ij);
+  Blend();
+  previous_world_T_depth_ = world_T_depth;
+  has_previous_ = true;
+
+  points_.clear();
+  for (int y = 0; y < height_; ++y) {
+    const float* row = &depth_[y * width_];
+    for (int x = 0; x < width_; ++x) {
+      if (row[x] > 0.0f) {
+        const glm::vec3 point = rays_.Unproject(x, y, row[x]);
+        points_.push_back(point.x);
+        points_.push_back(point.y);
+        points_.push_back(point.z);
+      }
+    }
+  }
+  filtered_ = *xyz_ij;
+  filtered_.xyz_count = static_cast<uint32_t>(points_.size() / 3);
+  filtered_.xyz = reinterpret_cast<float(*)[3]>(points_.data());
+  // The points are pixels of a scaled depth image, not of the ij grid.
+  filtered_.ij_rows = 0;
+  filtered_.ij_cols = 0;
+  filtered_.ij = nullptr;
+  return &filtered_;
+}
+
+void DepthTemporalFilter::Warp(const glm::mat4& current_T_previous) {
+  std::fill(warped_depth_.begin(), warped_depth_.end(), 0.0f);
+  for (int y = 0; y < height_; ++y) {
+    for (int x = 0; x < width_; ++x) {
+      const size_t pixel = y * width_ + x;
+      if (depth_[pixel] <= 0.0f) {
+        continue;
+      }
+      const glm::vec3 point = glm::vec3(
+          current_T_previous * glm::vec4(rays_.Unproject(x, y, depth_[pixel]),
+                                         1.0f));
+      if (point.z <= 0.0f) {
+        continue;
+      }
+      const int u = static_cast<int>(
+          std::floor(fx_ * point.x / point.z + cx_));
+      const int v = static_cast<int>(
+          std::floor(fy_ * point.y / point.z + cy_));
+      if (u < 0 || u >= width_ || v < 0 || v >= height_) {
+        continue;
+      }
+      // The nearest surface wins where the warp folds the image.
+      const size_t target = v * width_ + u;
+      if (warped_depth_[target] == 0.0f || point.z < warped_depth_[target]) {
+        warped_depth_[target] = point.z;
+        warped_weight_[target] = weight_[pixel];
+        warped_missing_count_[target] = missing_count_[pixel];
+      }
+    }
+  }
+}
+
+void DepthTemporalFilter::Splat(const TangoXYZij* xyz_ij) {
+  std::fill(raw_depth_.begin(), raw_depth_.end(), 0.0f);
+  for (uint32_t i = 0; i < xyz_ij->xyz_count; ++i) {
+    const float* point = xyz_ij->xyz[i];
+    if (!(point[2] > 0.0f)) {
+      continue;
+    }
+    const int u =
+        static_cast<int>(std::floor(fx_ * point[0] / point[2] + cx_));
+    const int v =
+        static_cast<int>(std::floor(fy_ * point[1] / point[2] + cy_));
+    if (u < 0 || u >= width_ || v < 0 || v >= height_) {
+      continue;
+    }
+    float& depth = raw_depth_[v * width_ + u];
+    if (depth == 0.0f || point[2] < depth) {
+      depth = point[2];
+    }
+  }
+}
+
+void DepthTemporalFilter::Blend() {
+  TANGO_TRACE_SCOPE("DepthTemporalFilter::Blend");
+  const size_t pixel_count = depth_.size();
+  const float max_weight = options_.max_weight;
+  const float max_depth_change = options_.max_depth_change;
+  const float max_missing_count =
+      static_cast<float>(options_.max_missing_count);
+  const float* raw = raw_depth_.data();
+  const float* warped = warped_depth_.data();
+  const float* warped_weight = warped_weight_.data();
+  const float* warped_missing_count = warped_missing_count_.data();
+  float* depth = depth_.data();
+  float* weight = weight_.data();
+  float* missing_count = missing_count_.data();
+  // Only selects between values, without branches, so that the loop is
+  // vectorized.
+  for (size_t i = 0; i < pixel_count; ++i) {
+    const bool has_raw = raw[i] > 0.0f;
+    const bool has_warped = warped[i] > 0.0f;
+    const bool is_consistent =
+        has_raw && has_warped &&
+        std::fabs(raw[i] - warped[i]) <= max_depth_change * warped[i];
+    const bool is_kept =
+        !has_raw && has_warped && warped_missing_count[i] < max_missing_count;
+
+    const float blended_weight = std::min(warped_weight[i] + 1.0f, max_weight);
+    const float blended_depth =
+        warped[i] + (raw[i] - warped[i]) / blended_weight;
+    const float kept_depth = is_kept ? warped[i] : 0.0f;
+    depth[i] = is_consistent ? blended_depth : (has_raw ? raw[i] : kept_depth);
+    weight[i] = is_consistent ? blended_weight
+                              : (has_raw ? 1.0f
+                                         : (is_kept ? warped_weight[i] : 0.0f));
+    missing_count[i] = is_kept ? warped_missing_count[i] + 1.0f : 0.0f;
+  }
+}
+
+}  // namespace tango_util
@@ -0,0 +1,192 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/display_configuration.h"
+
+#include <cstring>
+
+namespace {
+// Cosine and sine of the quarter turns, exact.
+const float kQuarterTurnCos[4] = {1.0f, 0.0f, -1.0f, 0.0f};
+const float kQuarterTurnSin[4] = {0.0f, 1.0f, 0.0f, -1.0f};
+
+bool SameIntrinsics(const TangoCameraIntrinsics& a,
+                    const TangoCameraIntrinsics& b) {
+  return a.width == b.width && a.height == b.height && a.fx == b.fx &&
+         a.fy == b.fy && a.cx == b.cx && a.cy == b.cy;
+}
+
+// The 2D affine transform of rows (a, b, c) and (d, e, f), in glm's column
+// order.
+glm::mat3 Affine(float a, float b, float c, float d, float e, float f) {
+  glm::mat3 transform(1.0f);
+  transform[0][0] = a;
+  transform[1][0] = b;
+  transform[2][0] = c;
+  transform[0][1] = d;
+  transform[1][1] = e;
+  transform[2][1] = f;
+  return transform;
+}
+}  // namespace
+
+namespace tango_util {
+
+const size_t DisplayConfiguration::kMaxCacheEntries;
+
+DisplayConfiguration::DisplayConfiguration(TangoCameraId camera_id,
+                                           float near, float far)
+    : camera_id_(camera_id),
+      near_(near),
+      far_(far),
+      rotation_(0),
+      surface_width_(0),
+      surface_height_(0),
+      version_(1),
+      reported_version_(0) {
+  memset(&reported_intrinsics_, 0, sizeof(reported_intrinsics_));
+}
+
+void DisplayConfiguration::SetDisplayRotation(int rotation) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  rotation = ((rotation % 4) + 4) % 4;
+  if (rotation != rotation_) {
+    rotation_ = rotation;
+    ++version_;
+  }
+}
+
+void DisplayConfiguration::SetSurfaceSize(int width, int height) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (width != surface_width_ || height != surface_height_) {
+    surface_width_ = width;
+    surface_height_ = height;
+    ++version_;
+  }
+}
+
+void DisplayConfiguration::Invalidate() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++version_;
+}
+
+bool DisplayConfiguration::Update(IntrinsicsRegistry* intrinsics,
+                                  Layout* layout) {
+  int rotation;
+  int surface_width;
+  int surface_height;
+  uint64_t version;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    rotation = rotation_;
+    surface_width = surface_width_;
+    surface_height = surface_height_;
+    version = version_;
+  }
+  TangoCameraIntrinsics camera_intrinsics;
+  if (surface_width <= 0 || surface_height <= 0 ||
+      !intrinsics->GetIntrinsics(camera_id_, &camera_intrinsics) ||
+      camera_intrinsics.width == 0 || camera_intrinsics.height == 0) {
+    return false;
+  }
+  if (version == reported_version_ &&
+      SameIntrinsics(camera_intrinsics, reported_intrinsics_)) {
+    return false;
+  }
+  reported_version_ = version;
+  reported_intrinsics_ = camera_intrinsics;
+
+  for (const Entry& entry : entries_) {
+    if (entry.rotation == rotation && entry.surface_width == surface_width &&
+        entry.surface_height == surface_height &&
+        SameIntrinsics(entry.intrinsics, camera_intrinsics)) {
+      *layout = entry.layout;
+      return true;
+    }
+  }
+
+  Entry entry;
+  entry.rotation = rotation;
+  entry.surface_width = surface_width;
+  entry.surface_height = surface_height;
+  entry.intrinsics = camera_intrinsics;
+  entry.layout = ComputeLayout(rotation, surface_width, surface_height,
+                               camera_intrinsics, intrinsics);
+  if (entries_.size() >= kMaxCacheEntries) {
+    entries_.erase(entries_.begin());
+  }
+  entries_.push_back(entry);
+  *layout = entry.layout;
+  return true;
+}
+
+DisplayConfiguration::Layout DisplayConfiguration::ComputeLayout(
+    int rotation, int surface_width, int surface_height,
+    const TangoCameraIntrinsics& intrinsics,
+    IntrinsicsRegistry* registry) const {
+  Layout layout;
+  layout.rotation = rotation;
+  layout.surface_width = surface_width;
+  layout.surface_height = surface_height;
+
+  const float image_width = static_cast<float>(intrinsics.width);
+  const float image_height = static_cast<float>(intrinsics.height);
+  layout.image_plane_ratio = image_height / image_width;
+  layout.image_plane_distance =
+      2.0f * static_cast<float>(intrinsics.fx) / image_width;
+
+  // On a quarter turn the image is displayed on its side. The view port
+  // keeps its aspect ratio and covers the surface, and may overflow it on
+  // the right or the top.
+  const float display_ratio = rotation % 2 == 0
+                                  ? layout.image_plane_ratio
+                                  : 1.0f / layout.image_plane_ratio;
+  const float surface_ratio = static_cast<float>(surface_height) /
+                              static_cast<float>(surface_width);
+  layout.viewport_x = 0;
+  layout.viewport_y = 0;
+  if (display_ratio < surface_ratio) {
+    layout.viewport_width = static_cast<int>(surface_height / display_ratio);
+    layout.viewport_height = surface_height;
+  } else {
+    layout.viewport_width = surface_width;
+    layout.viewport_height = static_cast<int>(surface_width * display_ratio);
+  }
+
+  // Android rotates the content clockwise by the rotation of the display, so
+  // the camera image, fixed to the device, is turned back counterclockwise.
+  const float cos_angle = kQuarterTurnCos[rotation];
+  const float sin_angle = kQuarterTurnSin[rotation];
+  layout.display_T_camera = glm::mat4(1.0f);
+  layout.display_T_camera[0][0] = cos_angle;
+  layout.display_T_camera[0][1] = sin_angle;
+  layout.display_T_camera[1][0] = -sin_angle;
+  layout.display_T_camera[1][1] = cos_angle;
+
+  IntrinsicsRegistry::Projection projection;
+  registry->GetProjection(camera_id_, near_, far_, &projection);
+  layout.projection = layout.display_T_camera * projection.matrix;
+
+  // From the texture coordinates of the view port to clip space, back by the
+  // inverse rotation, and to the texture coordinates of the camera image.
+  const glm::mat3 clip_T_uv = Affine(2.0f, 0.0f, -1.0f, 0.0f, -2.0f, 1.0f);
+  const glm::mat3 uv_T_clip = Affine(0.5f, 0.0f, 0.5f, 0.0f, -0.5f, 0.5f);
+  const glm::mat3 camera_T_display =
+      Affine(cos_angle, sin_angle, 0.0f, -sin_angle, cos_angle, 0.0f);
+  layout.uv_transform = uv_T_clip * camera_T_display * clip_T_uv;
+  return layout;
+}
+}  // namespace tango_util
@@ -0,0 +1,114 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/extrinsics_cache.h"
+
+#include <tango-gl/conversions.h>
+#include <tango-gl/simd_math.h>
+
+#include "tango-util/pose_source.h"
+
+namespace {
+// Query the fixed transformation of |target| with respect to the IMU.
+TangoErrorType GetImuTTarget(TangoCoordinateFrameType target,
+                             glm::mat4* imu_T_target) {
+  // TangoService_getPoseAtTime function is used for query device extrinsics
+  // as well. We use timestamp 0.0 and the target frame pair to get the
+  // extrinsics from the sensors.
+  TangoCoordinateFramePair frame_pair;
+  frame_pair.base = TANGO_COORDINATE_FRAME_IMU;
+  frame_pair.target = target;
+  TangoPoseData pose;
+  TangoErrorType ret = tango_util::GetPoseAtTime(0.0, frame_pair, &pose);
+  if (ret != TANGO_SUCCESS) {
+    return ret;
+  }
+  *imu_T_target = tango_gl::conversions::TransformFromArrays(
+      pose.translation, pose.orientation);
+  return TANGO_SUCCESS;
+}
+}  // namespace
+
+namespace tango_util {
+
+ExtrinsicsCache::ExtrinsicsCache()
+    : is_valid_(false),
+      opengl_world_T_start_service_(
+          tango_gl::conversions::opengl_world_T_tango_world()),
+      start_service_T_opengl_world_(
+          glm::inverse(opengl_world_T_start_service_)) {
+  device_T_color_opengl_camera_ =
+      tango_gl::conversions::color_camera_T_opengl_camera();
+  color_opengl_camera_T_device_ = glm::inverse(device_T_color_opengl_camera_);
+  device_T_depth_opengl_camera_ =
+      tango_gl::conversions::depth_camera_T_opengl_camera();
+}
+
+TangoErrorType ExtrinsicsCache::Update() {
+  glm::mat4 imu_T_device;
+  glm::mat4 imu_T_color_camera;
+  glm::mat4 imu_T_depth_camera;
+  TangoErrorType ret =
+      GetImuTTarget(TANGO_COORDINATE_FRAME_DEVICE, &imu_T_device);
+  if (ret != TANGO_SUCCESS) {
+    LOGE(
+        "ExtrinsicsCache: Failed to get transform between the IMU and device "
+        "frames");
+    return ret;
+  }
+  ret = GetImuTTarget(TANGO_COORDINATE_FRAME_CAMERA_COLOR,
+                      &imu_T_color_camera);
+  if (ret != TANGO_SUCCESS) {
+    LOGE(
+        "ExtrinsicsCache: Failed to get transform between the IMU and color "
+        "camera frames");
+    return ret;
+  }
+  ret = GetImuTTarget(TANGO_COORDINATE_FRAME_CAMERA_DEPTH,
+                      &imu_T_depth_camera);
+  if (ret != TANGO_SUCCESS) {
+    LOGE(
+        "ExtrinsicsCache: Failed to get transform between the IMU and depth "
+        "camera frames");
+    return ret;
+  }
+
+  imu_T_device_ = imu_T_device;
+  device_T_imu_ = tango_gl::simd_math::InverseRigid(imu_T_device);
+  imu_T_color_camera_ = imu_T_color_camera;
+  imu_T_depth_camera_ = imu_T_depth_camera;
+  device_T_color_camera_ = device_T_imu_ * imu_T_color_camera_;
+  color_camera_T_device_ =
+      tango_gl::simd_math::InverseRigid(device_T_color_camera_);
+  device_T_depth_camera_ = device_T_imu_ * imu_T_depth_camera_;
+  depth_camera_T_device_ =
+      tango_gl::simd_math::InverseRigid(device_T_depth_camera_);
+
+  const glm::mat4 color_camera_T_opengl_camera =
+      tango_gl::conversions::color_camera_T_opengl_camera();
+  device_T_color_opengl_camera_ =
+      device_T_color_camera_ * color_camera_T_opengl_camera;
+  color_opengl_camera_T_device_ =
+      glm::inverse(color_camera_T_opengl_camera) * color_camera_T_device_;
+  device_T_depth_opengl_camera_ =
+      device_T_depth_camera_ *
+      tango_gl::conversions::depth_camera_T_opengl_camera();
+
+  is_valid_ = true;
+  return TANGO_SUCCESS;
+}
+
+}  // namespace tango_util
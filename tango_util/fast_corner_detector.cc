@@ -0,0 +1,352 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/fast_corner_detector.h"
+
+#include <algorithm>
+
+#include <tango-gl/tracing.h>
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define TANGO_UTIL_FAST_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define TANGO_UTIL_FAST_SSE2 1
+#endif
+
+namespace {
+// Pixels of the circle around a corner, clockwise from the top. 0, 4, 8 and
+// 12 are the compass pixels.
+const int kCircleSize = 16;
+const int kCircle[kCircleSize][2] = {
+    {0, -3}, {1, -3}, {2, -2}, {3, -1}, {3, 0},  {3, 1},  {2, 2},  {1, 3},
+    {0, 3},  {-1, 3}, {-2, 2}, {-3, 1}, {-3, 0}, {-3, -1}, {-2, -2}, {-1, -3}};
+
+// Contiguous pixels of the circle a corner needs.
+const int kArcLength = 9;
+
+// Every other pixel of the circle, from the top.
+const int kRingSize = kCircleSize / 2;
+
+// Pixels of the border no corner is searched in, the radius of the circle.
+const int kBorder = 3;
+
+// Fewest rows of a band, below which the bands cost more than they save.
+const int kMinBandRows = 16;
+
+// @return the offset of the pixel |i| of the circle from the center.
+int GetCircleOffset(int i, int stride) {
+  return kCircle[i][1] * stride + kCircle[i][0];
+}
+
+// @return whether the 16 bits of |mask|, in a circle, have kArcLength
+// contiguous ones.
+bool HasArc(uint32_t mask) {
+  uint32_t arc = mask | (mask << kCircleSize);
+  for (int i = 1; i < kArcLength; ++i) {
+    arc &= arc >> 1;
+  }
+  return (arc & 0xffff) != 0;
+}
+
+// @return whether the pixel at |center| may be a corner from its compass
+// pixels: any arc of kArcLength pixels covers two adjacent ones, which are
+// then both brighter than |bright|, or both darker than |dark|.
+bool MayBeCorner(const uint8_t* center, int stride, int bright, int dark) {
+  const int top = center[-3 * stride];
+  const int right = center[3];
+  const int bottom = center[3 * stride];
+  const int left = center[-3];
+  const bool is_bright[4] = {top > bright, right > bright, bottom > bright,
+                             left > bright};
+  const bool is_dark[4] = {top < dark, right < dark, bottom < dark,
+                           left < dark};
+  for (int i = 0; i < 4; ++i) {
+    if ((is_bright[i] && is_bright[(i + 1) % 4]) ||
+        (is_dark[i] && is_dark[(i + 1) % 4])) {
+      return true;
+    }
+  }
+  return false;
+}
+}  // namespace
+
+namespace tango_util {
+
+FastCornerDetector::Options::Options()
+    : threshold(20), cell_size(32), max_corners_per_cell(4), thread_count(2) {}
+
+FastCornerDetector::FastCornerDetector(const Options& options)
+    : options_(options), worker_pool_(options.thread_count) {
+  options_.threshold = std::min(std::max(options_.threshold, 1), 254);
+}
+
+int FastCornerDetector::GetScore(const uint8_t* center, int stride,
+                                 int threshold) {
+  const int value = center[0];
+  int differences[kCircleSize];
+  uint32_t bright_mask = 0;
+  uint32_t dark_mask = 0;
+  for (int i = 0; i < kCircleSize; ++i) {
+    differences[i] = center[GetCircleOffset(i, stride)] - value;
+    bright_mask |= static_cast<uint32_t>(differences[i] > threshold) << i;
+    dark_mask |= static_cast<uint32_t>(differences[i] < -threshold) << i;
+  }
+  const bool is_bright = HasArc(bright_mask);
+  if (!is_bright && !HasArc(dark_mask)) {
+    return 0;
+  }
+  // The best arc, whose smallest difference is the largest, on the side it
+  // is a corner of.
+  const int sign = is_bright ? 1 : -1;
+  int score = 0;
+  for (int start = 0; start < kCircleSize; ++start) {
+    int arc_min = 255;
+    for (int i = 0; i < kArcLength; ++i) {
+      arc_min = std::min(arc_min,
+                         sign * differences[(start + i) % kCircleSize]);
+    }
+    score = std::max(score, arc_min);
+  }
+  return score;
+}
+
+void FastCornerDetector::DetectBand(const ImagePyramidLevel& level,
+                                    Band* band) {
+  const int threshold = options_.threshold;
+  const int end_x = level.width - kBorder;
+  band->candidates.clear();
+  for (int y = band->begin_row; y < band->end_row; ++y) {
+    const uint8_t* row = level.data + y * level.stride;
+    int16_t* score_row = &scores_[static_cast<size_t>(y) * level.width];
+    int x = kBorder;
+#if defined(TANGO_UTIL_FAST_NEON) || defined(TANGO_UTIL_FAST_SSE2)
+    // 16 pixels at a time, only those the every other pixel of the circle does
+    // not reject being tested in full: an arc of kArcLength pixels covers 4
+    // of them in a row.
+    uint8_t may_be_corner[16];
+    for (; x + 16 <= end_x; x += 16) {
+      const uint8_t* center = row + x;
+#if defined(TANGO_UTIL_FAST_NEON)
+      const uint8x16_t threshold_vector =
+          vdupq_n_u8(static_cast<uint8_t>(threshold));
+      const uint8x16_t pixels = vld1q_u8(center);
+      const uint8x16_t bright = vqaddq_u8(pixels, threshold_vector);
+      const uint8x16_t dark = vqsubq_u8(pixels, threshold_vector);
+      uint8x16_t is_bright[kRingSize];
+      uint8x16_t is_dark[kRingSize];
+      for (int i = 0; i < kRingSize; ++i) {
+        const uint8x16_t ring =
+            vld1q_u8(center + GetCircleOffset(2 * i, level.stride));
+        is_bright[i] = vcgtq_u8(ring, bright);
+        is_dark[i] = vcltq_u8(ring, dark);
+      }
+      uint8x16_t bright_pairs[kRingSize];
+      uint8x16_t dark_pairs[kRingSize];
+      for (int i = 0; i < kRingSize; ++i) {
+        bright_pairs[i] =
+            vandq_u8(is_bright[i], is_bright[(i + 1) % kRingSize]);
+        dark_pairs[i] = vandq_u8(is_dark[i], is_dark[(i + 1) % kRingSize]);
+      }
+      uint8x16_t mask = vdupq_n_u8(0);
+      for (int i = 0; i < kRingSize; ++i) {
+        mask = vorrq_u8(
+            mask, vandq_u8(bright_pairs[i], bright_pairs[(i + 2) % kRingSize]));
+        mask = vorrq_u8(
+            mask, vandq_u8(dark_pairs[i], dark_pairs[(i + 2) % kRingSize]));
+      }
+      const uint64x2_t lanes = vreinterpretq_u64_u8(mask);
+      if ((vgetq_lane_u64(lanes, 0) | vgetq_lane_u64(lanes, 1)) == 0) {
+        continue;
+      }
+      vst1q_u8(may_be_corner, mask);
+#else
+      // Unsigned comparisons are saturated subtractions: a > b when a - b
+      // is not 0.
+      const __m128i zero = _mm_setzero_si128();
+      const __m128i threshold_vector =
+          _mm_set1_epi8(static_cast<char>(threshold));
+      const __m128i pixels =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(center));
+      const __m128i bright = _mm_adds_epu8(pixels, threshold_vector);
+      const __m128i dark = _mm_subs_epu8(pixels, threshold_vector);
+      __m128i is_bright[kRingSize];
+      __m128i is_dark[kRingSize];
+      for (int i = 0; i < kRingSize; ++i) {
+        const __m128i ring = _mm_loadu_si128(reinterpret_cast<const __m128i*>(
+            center + GetCircleOffset(2 * i, level.stride)));
+        is_bright[i] = _mm_xor_si128(
+            _mm_cmpeq_epi8(_mm_subs_epu8(ring, bright), zero),
+            _mm_set1_epi8(-1));
+        is_dark[i] = _mm_xor_si128(
+            _mm_cmpeq_epi8(_mm_subs_epu8(dark, ring), zero), _mm_set1_epi8(-1));
+      }
+      __m128i bright_pairs[kRingSize];
+      __m128i dark_pairs[kRingSize];
+      for (int i = 0; i < kRingSize; ++i) {
+        bright_pairs[i] =
+            _mm_and_si128(is_bright[i], is_bright[(i + 1) % kRingSize]);
+        dark_pairs[i] = _mm_and_si128(is_dark[i], is_dark[(i + 1) % kRingSize]);
+      }
+      __m128i mask = zero;
+      for (int i = 0; i < kRingSize; ++i) {
+        mask = _mm_or_si128(
+            mask,
+            _mm_and_si128(bright_pairs[i], bright_pairs[(i + 2) % kRingSize]));
+        mask = _mm_or_si128(
+            mask,
+            _mm_and_si128(dark_pairs[i], dark_pairs[(i + 2) % kRingSize]));
+      }
+      const int mask_bits = _mm_movemask_epi8(mask);
+      if (mask_bits == 0) {
+        continue;
+      }
+      for (int i = 0; i < 16; ++i) {
+        may_be_corner[i] = (mask_bits & (1 << i)) != 0;
+      }
+#endif
+      for (int i = 0; i < 16; ++i) {
+        if (!may_be_corner[i]) {
+          continue;
+        }
+        const int score = GetScore(center + i, level.stride, threshold);
+        if (score > 0) {
+          FastCorner corner;
+          corner.x = static_cast<int16_t>(x + i);
+          corner.y = static_cast<int16_t>(y);
+          corner.score = static_cast<int16_t>(score);
+          band->candidates.push_back(corner);
+          score_row[x + i] = corner.score;
+        }
+      }
+    }
+#endif
+    for (; x < end_x; ++x) {
+      const uint8_t* center = row + x;
+      if (!MayBeCorner(center, level.stride, center[0] + threshold,
+                       center[0] - threshold)) {
+        continue;
+      }
+      const int score = GetScore(center, level.stride, threshold);
+      if (score > 0) {
+        FastCorner corner;
+        corner.x = static_cast<int16_t>(x);
+        corner.y = static_cast<int16_t>(y);
+        corner.score = static_cast<int16_t>(score);
+        band->candidates.push_back(corner);
+        score_row[x] = corner.score;
+      }
+    }
+  }
+}
+
+void FastCornerDetector::SuppressBand(int width, Band* band) {
+  band->corners.clear();
+  for (const FastCorner& candidate : band->candidates) {
+    const int16_t* center =
+        &scores_[static_cast<size_t>(candidate.y) * width + candidate.x];
+    // Of equal scores, the first in raster order wins.
+    const int16_t score = candidate.score;
+    const bool is_maximum =
+        center[-width - 1] < score && center[-width] < score &&
+        center[-width + 1] < score && center[-1] < score &&
+        center[1] <= score && center[width - 1] <= score &&
+        center[width] <= score && center[width + 1] <= score;
+    if (is_maximum) {
+      band->corners.push_back(candidate);
+    }
+  }
+}
+
+void FastCornerDetector::SelectByCell(int width) {
+  all_corners_.clear();
+  for (const Band& band : bands_) {
+    all_corners_.insert(all_corners_.end(), band.corners.begin(),
+                        band.corners.end());
+  }
+  corners_.clear();
+  if (options_.cell_size <= 0 || options_.max_corners_per_cell <= 0) {
+    corners_.swap(all_corners_);
+    return;
+  }
+  const int cell_size = options_.cell_size;
+  const uint32_t cells_per_row = (width + cell_size - 1) / cell_size;
+  cells_.resize(all_corners_.size());
+  order_.resize(all_corners_.size());
+  for (size_t i = 0; i < all_corners_.size(); ++i) {
+    cells_[i] = (all_corners_[i].y / cell_size) * cells_per_row +
+                all_corners_[i].x / cell_size;
+    order_[i] = static_cast<uint32_t>(i);
+  }
+  std::sort(order_.begin(), order_.end(), [this](uint32_t a, uint32_t b) {
+    if (cells_[a] != cells_[b]) {
+      return cells_[a] < cells_[b];
+    }
+    if (all_corners_[a].score != all_corners_[b].score) {
+      return all_corners_[a].score > all_corners_[b].score;
+    }
+    return a < b;
+  });
+  int count_in_cell = 0;
+  for (size_t i = 0; i < order_.size(); ++i) {
+    if (i == 0 || cells_[order_[i]] != cells_[order_[i - 1]]) {
+      count_in_cell = 0;
+    }
+    if (count_in_cell < options_.max_corners_per_cell) {
+      corners_.push_back(all_corners_[order_[i]]);
+      ++count_in_cell;
+    }
+  }
+}
+
+size_t FastCornerDetector::Detect(const ImagePyramidLevel& level) {
+  TANGO_TRACE_SCOPE("FastCornerDetector::Detect");
+  corners_.clear();
+  const int rows = level.height - 2 * kBorder;
+  if (level.data == nullptr || level.width <= 2 * kBorder || rows <= 0) {
+    return 0;
+  }
+  const size_t pixel_count = static_cast<size_t>(level.width) * level.height;
+  if (scores_.size() < pixel_count) {
+    scores_.resize(pixel_count, 0);
+  }
+
+  // A few bands per thread, for the ones with more texture to even out.
+  const int band_count = std::max(
+      std::min(2 * worker_pool_.GetThreadCount(), rows / kMinBandRows), 1);
+  bands_.resize(band_count);
+  for (int i = 0; i < band_count; ++i) {
+    bands_[i].begin_row = kBorder + rows * i / band_count;
+    bands_[i].end_row = kBorder + rows * (i + 1) / band_count;
+  }
+  // The suppression reads the scores of the neighboring bands, so every band
+  // is detected first.
+  worker_pool_.ParallelFor(
+      bands_.size(), [&](size_t i) { DetectBand(level, &bands_[i]); });
+  worker_pool_.ParallelFor(bands_.size(), [&](size_t i) {
+    SuppressBand(level.width, &bands_[i]);
+  });
+  for (const Band& band : bands_) {
+    for (const FastCorner& candidate : band.candidates) {
+      scores_[static_cast<size_t>(candidate.y) * level.width + candidate.x] =
+          0;
+    }
+  }
+  SelectByCell(level.width);
+  return corners_.size();
+}
+}  // namespace tango_util
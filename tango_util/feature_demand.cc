@@ -0,0 +1,177 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/feature_demand.h"
+
+namespace tango_util {
+
+const int FeatureDemand::kDefaultDepthFramerate;
+
+FeatureDemand::FeatureDemand(double release_delay)
+    : release_delay_(std::chrono::duration_cast<Clock::duration>(
+          std::chrono::duration<double>(release_delay))),
+      frame_context_(nullptr),
+      frame_callback_(nullptr),
+      color_texture_id_(0),
+      texture_context_(nullptr),
+      is_connected_(false),
+      depth_framerate_(kDefaultDepthFramerate) {
+  for (FeatureState& feature : features_) {
+    feature.demand.store(0);
+    feature.state = kUnknown;
+    feature.is_releasing = false;
+  }
+}
+
+TangoErrorType FeatureDemand::Configure(TangoConfig config) {
+  const TangoErrorType ret =
+      TangoConfig_setBool(config, "config_enable_depth", true);
+  if (ret != TANGO_SUCCESS) {
+    LOGE("FeatureDemand: Failed to enable depth with error code: %d.", ret);
+  }
+  return ret;
+}
+
+void FeatureDemand::SetDepthFramerate(int framerate) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (framerate == depth_framerate_) {
+    return;
+  }
+  depth_framerate_ = framerate;
+  // Set again by the next Apply() if depth is running.
+  if (features_[kDepth].state == kRunning) {
+    features_[kDepth].state = kUnknown;
+  }
+}
+
+void FeatureDemand::SetColorFrameCallback(void* context,
+                                          FrameCallback callback) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  frame_context_ = context;
+  frame_callback_ = callback;
+}
+
+void FeatureDemand::SetColorTexture(unsigned int texture_id, void* context) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  color_texture_id_ = texture_id;
+  texture_context_ = context;
+}
+
+void FeatureDemand::SetDemand(Feature feature, uint32_t consumer,
+                              bool is_demanded) {
+  if (is_demanded) {
+    features_[feature].demand.fetch_or(consumer);
+  } else {
+    features_[feature].demand.fetch_and(~consumer);
+  }
+}
+
+bool FeatureDemand::IsDemanded(Feature feature) const {
+  return features_[feature].demand.load() != 0;
+}
+
+bool FeatureDemand::IsRunning(Feature feature) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return features_[feature].state == kRunning;
+}
+
+void FeatureDemand::OnConnected() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  is_connected_ = true;
+  // Depth runs at the rate of the connect time config, while the frame
+  // callback is only ever connected by Apply().
+  features_[kDepth].state = kUnknown;
+  features_[kColorFrames].state = kStopped;
+  for (FeatureState& feature : features_) {
+    feature.is_releasing = false;
+  }
+}
+
+void FeatureDemand::OnDisconnected() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  is_connected_ = false;
+}
+
+bool FeatureDemand::Apply() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!is_connected_) {
+    return false;
+  }
+  const Clock::time_point now = Clock::now();
+  bool is_applied = false;
+  for (int i = 0; i < kFeatureCount; ++i) {
+    const Feature feature = static_cast<Feature>(i);
+    FeatureState& state = features_[i];
+    if (state.demand.load() != 0) {
+      state.is_releasing = false;
+      if (state.state != kRunning) {
+        SetRunning(feature, true);
+        is_applied = true;
+      }
+    } else if (state.state == kUnknown) {
+      SetRunning(feature, false);
+      is_applied = true;
+    } else if (state.state == kRunning) {
+      if (!state.is_releasing) {
+        state.is_releasing = true;
+        state.release_time = now;
+      } else if (now - state.release_time >= release_delay_) {
+        state.is_releasing = false;
+        SetRunning(feature, false);
+        is_applied = true;
+      }
+    }
+  }
+  return is_applied;
+}
+
+void FeatureDemand::SetRunning(Feature feature, bool is_running) {
+  features_[feature].state = is_running ? kRunning : kStopped;
+  TangoErrorType ret = TANGO_SUCCESS;
+  if (feature == kDepth) {
+    TangoConfig config = TangoService_getConfig(TANGO_CONFIG_RUNTIME);
+    if (config == nullptr) {
+      LOGE("FeatureDemand: Failed to get the runtime config.");
+      return;
+    }
+    ret = TangoConfig_setInt32(config, "config_runtime_depth_framerate",
+                               is_running ? depth_framerate_ : 0);
+    if (ret == TANGO_SUCCESS) {
+      ret = TangoService_setRuntimeConfig(config);
+    }
+    TangoConfig_free(config);
+  } else if (is_running) {
+    if (frame_callback_ == nullptr) {
+      return;
+    }
+    ret = TangoService_connectOnFrameAvailable(TANGO_CAMERA_COLOR,
+                                               frame_context_, frame_callback_);
+  } else {
+    // Disconnecting the camera drops its texture too, which is connected
+    // again right away.
+    ret = TangoService_disconnectCamera(TANGO_CAMERA_COLOR);
+    if (ret == TANGO_SUCCESS && color_texture_id_ != 0) {
+      ret = TangoService_connectTextureId(TANGO_CAMERA_COLOR,
+                                          color_texture_id_, texture_context_,
+                                          nullptr);
+    }
+  }
+  if (ret != TANGO_SUCCESS) {
+    LOGE("FeatureDemand: Failed to turn feature %d %s with error code: %d.",
+         feature, is_running ? "on" : "off", ret);
+  }
+}
+}  // namespace tango_util
@@ -0,0 +1,101 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/frame_arena.h"
+
+#include <algorithm>
+
+namespace {
+// Overflow blocks are at least this large, so that many small allocations
+// past the main block do not each get their own.
+const size_t kMinOverflowBlockSize = 64 * 1024;
+
+// Blocks are aligned for any type by new[], allocations within them by
+// rounding up the offset.
+size_t AlignUp(size_t offset, size_t alignment) {
+  return (offset + alignment - 1) & ~(alignment - 1);
+}
+}  // namespace
+
+namespace tango_util {
+
+FrameArena::FrameArena(size_t capacity)
+    : capacity_(0),
+      offset_(0),
+      overflow_begin_(nullptr),
+      overflow_size_(0),
+      overflow_offset_(0),
+      frame_size_(0),
+      high_water_mark_(0),
+      heap_allocation_count_(0) {
+  if (capacity > 0) {
+    block_.reset(AllocateBlock(capacity));
+    capacity_ = capacity;
+  }
+}
+
+void* FrameArena::Allocate(size_t size, size_t alignment) {
+  // Counts the padding too, so that the main block sized after a frame fits
+  // it next time.
+  const size_t offset = AlignUp(offset_, alignment);
+  if (offset + size <= capacity_) {
+    frame_size_ += offset + size - offset_;
+    offset_ = offset + size;
+    return block_.get() + offset;
+  }
+  size_t overflow_offset = AlignUp(overflow_offset_, alignment);
+  if (overflow_begin_ == nullptr || overflow_offset + size > overflow_size_) {
+    overflow_size_ = std::max(size, kMinOverflowBlockSize);
+    overflow_begin_ = AllocateBlock(overflow_size_);
+    overflow_blocks_.push_back(std::unique_ptr<uint8_t[]>(overflow_begin_));
+    overflow_offset_ = 0;
+    overflow_offset = 0;
+  }
+  frame_size_ += overflow_offset + size - overflow_offset_;
+  overflow_offset_ = overflow_offset + size;
+  return overflow_begin_ + overflow_offset;
+}
+
+void FrameArena::Reset() {
+  high_water_mark_ = std::max(high_water_mark_, frame_size_);
+  if (!overflow_blocks_.empty()) {
+    // Room for the frame that overflowed, and a little more for the next
+    // ones.
+    overflow_blocks_.clear();
+    overflow_begin_ = nullptr;
+    overflow_size_ = 0;
+    overflow_offset_ = 0;
+    capacity_ = frame_size_ + frame_size_ / 4;
+    block_.reset(AllocateBlock(capacity_));
+  }
+  offset_ = 0;
+  frame_size_ = 0;
+}
+
+FrameArenaStats FrameArena::GetStats() const {
+  FrameArenaStats stats;
+  stats.capacity = capacity_;
+  stats.high_water_mark = std::max(high_water_mark_, frame_size_);
+  stats.heap_allocation_count = heap_allocation_count_;
+  return stats;
+}
+
+uint8_t* FrameArena::AllocateBlock(size_t size) {
+  ++heap_allocation_count_;
+  return new uint8_t[size];
+}
+
+}  // namespace tango_util
@@ -0,0 +1,323 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "tango-util/frame_exporter.h"
+
+#include <png.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include <tango-gl/util.h>
+
+#include "tango-util/task_scheduler.h"
+#include "tango-util/thread_policy.h"
+#include "tango-util/worker_pool.h"
+
+namespace {
+// Largest depth of the 16 bit images, in millimeters.
+const float kMaxDepthMillimeters = 65535.0f;
+
+// Append the bytes libpng writes to the vector of its io pointer.
+void AppendPngData(png_structp png_ptr, png_bytep data, png_size_t length) {
+  std::vector<uint8_t>* encoded =
+      static_cast<std::vector<uint8_t>*>(png_get_io_ptr(png_ptr));
+  encoded->insert(encoded->end(), data, data + length);
+}
+
+void FlushPngData(png_structp) {}
+}  // namespace
+
+namespace tango_util {
+
+FrameExporter::Options::Options()
+    : frame_count(8),
+      encode_thread_count(2),
+      compression_level(1),
+      wait_for_frame(false) {}
+
+FrameExporter::FrameExporter(const Options& options)
+    : encode_thread_count_(std::max(options.encode_thread_count, 1)),
+      compression_level_(options.compression_level),
+      wait_for_frame_(options.wait_for_frame),
+      slots_(std::max(options.frame_count, 1)),
+      is_stopping_(false),
+      is_running_(false),
+      written_count_(0),
+      dropped_count_(0),
+      failed_count_(0),
+      written_bytes_(0) {
+  for (size_t i = 0; i < slots_.size(); ++i) {
+    slots_[i].capacity = 0;
+    slots_[i].is_encoded = false;
+    free_slots_.push_back(static_cast<int>(i));
+  }
+}
+
+FrameExporter::~FrameExporter() { Stop(); }
+
+bool FrameExporter::Start(const char* directory) {
+  Stop();
+  directory_ = directory;
+  written_count_ = 0;
+  dropped_count_ = 0;
+  failed_count_ = 0;
+  written_bytes_ = 0;
+  TaskScheduler::Options scheduler_options;
+  scheduler_options.core_policy = TaskScheduler::kLittleCores;
+  scheduler_options.worker_count = encode_thread_count_ - 1;
+  scheduler_.reset(new TaskScheduler(scheduler_options));
+  pool_.reset(new WorkerPool(encode_thread_count_ - 1, scheduler_.get()));
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    is_stopping_ = false;
+    is_running_ = true;
+  }
+  thread_ = std::thread(&FrameExporter::ExportLoop, this);
+  return true;
+}
+
+void FrameExporter::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!is_running_) {
+      return;
+    }
+    is_running_ = false;
+    is_stopping_ = true;
+  }
+  queue_condition_.notify_one();
+  free_condition_.notify_all();
+  thread_.join();
+  pool_.reset();
+  scheduler_.reset();
+  LOGI("FrameExporter: wrote %llu frames, %llu bytes, dropped %llu, failed "
+       "%llu",
+       static_cast<unsigned long long>(written_count_.load()),  // NOLINT
+       static_cast<unsigned long long>(written_bytes_.load()),  // NOLINT
+       static_cast<unsigned long long>(dropped_count_.load()),  // NOLINT
+       static_cast<unsigned long long>(failed_count_.load()));  // NOLINT
+}
+
+FrameExporter::Frame* FrameExporter::Acquire(size_t size) {
+  int slot_index;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (wait_for_frame_) {
+      free_condition_.wait(
+          lock, [this] { return !is_running_ || !free_slots_.empty(); });
+    }
+    if (!is_running_ || free_slots_.empty()) {
+      ++dropped_count_;
+      return nullptr;
+    }
+    slot_index = free_slots_.back();
+    free_slots_.pop_back();
+  }
+  // The slot is the caller's until submitted, it grows outside the lock.
+  Slot& slot = slots_[slot_index];
+  if (slot.capacity < size) {
+    slot.buffer.reset(new float[(size + sizeof(float) - 1) / sizeof(float)]);
+    slot.capacity = size;
+  }
+  Frame& frame = slot.frame;
+  frame.format = kRawFormat;
+  frame.name = "frame";
+  frame.extension = "raw";
+  frame.width = 0;
+  frame.height = 0;
+  frame.timestamp = 0.0;
+  frame.data = reinterpret_cast<uint8_t*>(slot.buffer.get());
+  frame.size = size;
+  frame.slot = slot_index;
+  return &frame;
+}
+
+void FrameExporter::Submit(Frame* frame) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (is_running_) {
+      queued_slots_.push_back(frame->slot);
+    } else {
+      // Stopped since it was acquired.
+      free_slots_.push_back(frame->slot);
+      ++dropped_count_;
+      return;
+    }
+  }
+  queue_condition_.notify_one();
+}
+
+bool FrameExporter::ExportDepth(const char* name, const float* depths,
+                                int width, int height, double timestamp) {
+  const size_t size = static_cast<size_t>(width) * height * sizeof(float);
+  Frame* frame = Acquire(size);
+  if (frame == nullptr) {
+    return false;
+  }
+  frame->format = kDepthFormat;
+  frame->name = name;
+  frame->width = width;
+  frame->height = height;
+  frame->timestamp = timestamp;
+  memcpy(frame->data, depths, size);
+  Submit(frame);
+  return true;
+}
+
+FrameExporter::Stats FrameExporter::GetStats() const {
+  Stats stats;
+  stats.written_count = written_count_.load();
+  stats.dropped_count = dropped_count_.load();
+  stats.failed_count = failed_count_.load();
+  stats.written_bytes = written_bytes_.load();
+  return stats;
+}
+
+void FrameExporter::ExportLoop() {
+  std::vector<int> batch;
+  while (true) {
+    ThreadPolicy::Get().Enter(ThreadPolicy::kBulkStage);
+    batch.clear();
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      queue_condition_.wait(
+          lock, [this] { return is_stopping_ || !queued_slots_.empty(); });
+      // Every frame queued before Stop() is written.
+      if (queued_slots_.empty()) {
+        return;
+      }
+      while (!queued_slots_.empty() &&
+             static_cast<int>(batch.size()) < encode_thread_count_) {
+        batch.push_back(queued_slots_.front());
+        queued_slots_.pop_front();
+      }
+    }
+    pool_->ParallelFor(batch.size(),
+                       [&](size_t i) { EncodeSlot(&slots_[batch[i]]); });
+    for (int slot : batch) {
+      if (WriteSlot(slots_[slot])) {
+        ++written_count_;
+      } else {
+        ++failed_count_;
+      }
+      ReleaseSlot(slot);
+    }
+  }
+}
+
+void FrameExporter::EncodeSlot(Slot* slot) {
+  slot->encoded.clear();
+  slot->is_encoded = false;
+  const Frame& frame = slot->frame;
+  if (frame.format != kDepthFormat) {
+    return;
+  }
+  const size_t pixel_count = static_cast<size_t>(frame.width) * frame.height;
+  if (frame.width <= 0 || frame.height <= 0 ||
+      pixel_count * sizeof(float) > frame.size) {
+    LOGE("FrameExporter: depth image of %dx%d does not fit its %zu bytes",
+         frame.width, frame.height, frame.size);
+    return;
+  }
+  png_structp png_ptr =
+      png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+  png_infop info_ptr = png_create_info_struct(png_ptr);
+  // libpng reports encoding errors by jumping back here.
+  if (setjmp(png_jmpbuf(png_ptr))) {
+    LOGE("FrameExporter: failed to encode %s_%.6f", frame.name,
+         frame.timestamp);
+    png_destroy_write_struct(&png_ptr, &info_ptr);
+    return;
+  }
+  png_set_write_fn(png_ptr, &slot->encoded, AppendPngData, FlushPngData);
+  // The depth changes slowly along a row, the filter of the previous pixel
+  // is the cheap one that suits it.
+  png_set_IHDR(png_ptr, info_ptr, frame.width, frame.height, 16,
+               PNG_COLOR_TYPE_GRAY, PNG_INTERLACE_NONE,
+               PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+  png_set_filter(png_ptr, PNG_FILTER_TYPE_BASE, PNG_FILTER_SUB);
+  png_set_compression_level(png_ptr, compression_level_);
+  png_write_info(png_ptr, info_ptr);
+
+  // Millimeters, in the big endian samples of PNG.
+  const float* depths = reinterpret_cast<const float*>(frame.data);
+  slot->row.resize(frame.width * 2);
+  for (int y = 0; y < frame.height; ++y) {
+    const float* depth_row = depths + static_cast<size_t>(y) * frame.width;
+    for (int x = 0; x < frame.width; ++x) {
+      const float millimeters = depth_row[x] * 1000.0f + 0.5f;
+      const uint16_t value =
+          millimeters >= 1.0f
+              ? static_cast<uint16_t>(
+                    std::min(millimeters, kMaxDepthMillimeters))
+              : 0;
+      slot->row[2 * x] = static_cast<uint8_t>(value >> 8);
+      slot->row[2 * x + 1] = static_cast<uint8_t>(value);
+    }
+    png_write_row(png_ptr, slot->row.data());
+  }
+  png_write_end(png_ptr, NULL);
+  png_destroy_write_struct(&png_ptr, &info_ptr);
+  slot->is_encoded = true;
+}
+
+bool FrameExporter::WriteSlot(const Slot& slot) {
+  const Frame& frame = slot.frame;
+  const uint8_t* data;
+  size_t size;
+  char path[512];
+  if (frame.format == kDepthFormat) {
+    if (!slot.is_encoded) {
+      return false;
+    }
+    data = slot.encoded.data();
+    size = slot.encoded.size();
+    snprintf(path, sizeof(path), "%s/%s_%.6f.png", directory_.c_str(),
+             frame.name, frame.timestamp);
+  } else {
+    data = frame.data;
+    size = frame.size;
+    snprintf(path, sizeof(path), "%s/%s_%.6f_%dx%d.%s", directory_.c_str(),
+             frame.name, frame.timestamp, frame.width, frame.height,
+             frame.extension);
+  }
+  FILE* file = fopen(path, "wb");
+  if (file == NULL) {
+    LOGE("FrameExporter: failed to create %s", path);
+    return false;
+  }
+  const bool is_written = fwrite(data, 1, size, file) == size;
+  if (fclose(file) != 0 || !is_written) {
+    LOGE("FrameExporter: failed to write %s", path);
+    return false;
+  }
+  written_bytes_ += size;
+  return true;
+}
+
+void FrameExporter::ReleaseSlot(int slot) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_slots_.push_back(slot);
+  }
+  free_condition_.notify_one();
+}
+
+}  // namespace tango_util
@@ -0,0 +1,313 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/frame_pacer.h"
+
+#include <android/looper.h>
+#include <dlfcn.h>
+#include <time.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include <tango-gl/util.h>
+
+namespace {
+const double kNanosecondsPerMillisecond = 1e6;
+
+// Vsync intervals outside of these are missed or spurious callbacks, in
+// nanoseconds.
+const int64_t kMinVsyncPeriodNs = 4000000;
+const int64_t kMaxVsyncPeriodNs = 50000000;
+
+// Smoothing of the vsync period and of the wait.
+const double kVsyncPeriodSmoothing = 0.1;
+const double kWaitSmoothing = 0.05;
+
+// Longest the vsync thread sleeps in its looper before checking whether it
+// must stop, in milliseconds.
+const int kPollTimeoutMs = 100;
+
+// The AChoreographer functions of android/choreographer.h, the handle being
+// opaque. The frame callback of Android 7.0 gets a long, 32 bits on 32 bit
+// ABIs, and the one of Android 10 a 64 bit time.
+typedef void (*FrameCallback)(long frame_time_ns, void* data);  // NOLINT
+typedef void (*FrameCallback64)(int64_t frame_time_ns, void* data);
+typedef void* (*GetInstanceFunction)();
+typedef void (*PostFrameCallbackFunction)(void* choreographer,
+                                          FrameCallback callback, void* data);
+typedef void (*PostFrameCallback64Function)(void* choreographer,
+                                            FrameCallback64 callback,
+                                            void* data);
+
+struct ChoreographerApi {
+  GetInstanceFunction get_instance;
+  PostFrameCallbackFunction post_frame_callback;
+  PostFrameCallback64Function post_frame_callback64;
+};
+
+ChoreographerApi* LoadChoreographerApi() {
+  ChoreographerApi* api = new ChoreographerApi();
+  void* library = dlopen("libandroid.so", RTLD_NOW | RTLD_LOCAL);
+  if (library == nullptr) {
+    return api;
+  }
+  api->get_instance = reinterpret_cast<GetInstanceFunction>(
+      dlsym(library, "AChoreographer_getInstance"));
+  api->post_frame_callback = reinterpret_cast<PostFrameCallbackFunction>(
+      dlsym(library, "AChoreographer_postFrameCallback"));
+  api->post_frame_callback64 = reinterpret_cast<PostFrameCallback64Function>(
+      dlsym(library, "AChoreographer_postFrameCallback64"));
+  return api;
+}
+
+const ChoreographerApi& GetChoreographerApi() {
+  static ChoreographerApi* api = LoadChoreographerApi();
+  return *api;
+}
+
+bool IsChoreographerAvailable() {
+  const ChoreographerApi& api = GetChoreographerApi();
+  return api.get_instance != nullptr &&
+         (api.post_frame_callback != nullptr ||
+          api.post_frame_callback64 != nullptr);
+}
+}  // namespace
+
+namespace tango_util {
+
+FramePacer::Options::Options() : margin(4.0), estimate_decay(0.05) {}
+
+FramePacer::FramePacer(const Options& options)
+    : options_(options),
+      is_enabled_(true),
+      is_running_(false),
+      looper_(nullptr),
+      choreographer_(nullptr),
+      last_vsync_ns_(0),
+      vsync_period_ns_(0),
+      previous_target_ns_(0),
+      render_duration_(0.0),
+      average_wait_(0.0),
+      double_latch_count_(0),
+      frame_count_(0) {}
+
+FramePacer::~FramePacer() { Stop(); }
+
+bool FramePacer::Start() {
+  if (vsync_thread_.joinable()) {
+    return true;
+  }
+  if (!IsChoreographerAvailable()) {
+    LOGI("FramePacer: AChoreographer is not available, frames are not paced");
+    return false;
+  }
+  is_running_.store(true);
+  vsync_thread_ = std::thread(&FramePacer::VsyncLoop, this);
+  return true;
+}
+
+void FramePacer::Stop() {
+  if (!vsync_thread_.joinable()) {
+    return;
+  }
+  is_running_.store(false);
+  {
+    std::lock_guard<std::mutex> lock(looper_mutex_);
+    if (looper_ != nullptr) {
+      ALooper_wake(looper_);
+    }
+  }
+  vsync_thread_.join();
+  // The vsyncs of a next Start() start over.
+  last_vsync_ns_.store(0);
+  vsync_period_ns_.store(0);
+}
+
+double FramePacer::BeginFrame() {
+  const int64_t last_vsync_ns = last_vsync_ns_.load();
+  const int64_t period_ns = vsync_period_ns_.load();
+  double render_duration;
+  {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    render_duration = render_duration_;
+  }
+  const int64_t render_ns =
+      static_cast<int64_t>(render_duration * kNanosecondsPerMillisecond);
+  const int64_t lead_ns =
+      render_ns +
+      static_cast<int64_t>(options_.margin * kNanosecondsPerMillisecond);
+
+  int64_t now_ns = GetMonotonicTimeNs();
+  double wait = 0.0;
+  const bool has_vsync = last_vsync_ns > 0 && period_ns > 0;
+  if (has_vsync && is_enabled_.load()) {
+    // Finish just before the first vsync after now that the previous frame
+    // was not made for. A frame whose start is past already starts at once
+    // rather than a vsync later.
+    int64_t next_vsync_ns =
+        last_vsync_ns +
+        (std::max<int64_t>(now_ns - last_vsync_ns, 0) / period_ns + 1) *
+            period_ns;
+    {
+      std::lock_guard<std::mutex> lock(stats_mutex_);
+      while (next_vsync_ns < previous_target_ns_ + period_ns / 2) {
+        next_vsync_ns += period_ns;
+      }
+    }
+    const int64_t start_ns = next_vsync_ns - lead_ns;
+    if (start_ns > now_ns) {
+      std::this_thread::sleep_for(std::chrono::nanoseconds(start_ns - now_ns));
+      const int64_t end_ns = GetMonotonicTimeNs();
+      wait = (end_ns - now_ns) / kNanosecondsPerMillisecond;
+      now_ns = end_ns;
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(stats_mutex_);
+  if (has_vsync) {
+    // The first vsync after the frame is expected to finish, shown then: the
+    // same one as the previous frame's is a double latch.
+    const int64_t finish_ns = now_ns + render_ns;
+    const int64_t target_ns =
+        last_vsync_ns +
+        (std::max<int64_t>(finish_ns - last_vsync_ns + period_ns - 1, 0) /
+         period_ns) *
+            period_ns;
+    if (previous_target_ns_ != 0 &&
+        std::abs(target_ns - previous_target_ns_) < period_ns / 2) {
+      ++double_latch_count_;
+    }
+    previous_target_ns_ = target_ns;
+  }
+  average_wait_ += kWaitSmoothing * (wait - average_wait_);
+  ++frame_count_;
+  frame_start_ = Clock::now();
+  return wait;
+}
+
+void FramePacer::EndFrame() {
+  const double duration =
+      std::chrono::duration<double, std::milli>(Clock::now() - frame_start_)
+          .count();
+  std::lock_guard<std::mutex> lock(stats_mutex_);
+  // Up at once after a slow frame, so the next one is not late too, and
+  // back down slowly.
+  if (duration > render_duration_) {
+    render_duration_ = duration;
+  } else {
+    render_duration_ += options_.estimate_decay * (duration - render_duration_);
+  }
+}
+
+FramePacer::Stats FramePacer::GetStats() const {
+  Stats stats;
+  stats.vsync_period =
+      vsync_period_ns_.load() / kNanosecondsPerMillisecond;
+  std::lock_guard<std::mutex> lock(stats_mutex_);
+  stats.render_duration = render_duration_;
+  stats.average_wait = average_wait_;
+  stats.double_latch_count = double_latch_count_;
+  stats.frame_count = frame_count_;
+  return stats;
+}
+
+void FramePacer::VsyncLoop() {
+  // AChoreographer delivers its callbacks on the looper of the thread that
+  // got it.
+  ALooper* looper = ALooper_prepare(0);
+  {
+    std::lock_guard<std::mutex> lock(looper_mutex_);
+    looper_ = looper;
+  }
+  choreographer_ = GetChoreographerApi().get_instance();
+  if (choreographer_ == nullptr) {
+    LOGE("FramePacer: could not get the choreographer");
+  } else {
+    PostVsyncCallback();
+  }
+  while (is_running_.load()) {
+    ALooper_pollOnce(kPollTimeoutMs, nullptr, nullptr, nullptr);
+  }
+  std::lock_guard<std::mutex> lock(looper_mutex_);
+  looper_ = nullptr;
+  choreographer_ = nullptr;
+}
+
+void FramePacer::PostVsyncCallback() {
+  const ChoreographerApi& api = GetChoreographerApi();
+  if (api.post_frame_callback64 != nullptr) {
+    api.post_frame_callback64(choreographer_, &FramePacer::OnVsync64, this);
+  } else {
+    api.post_frame_callback(choreographer_, &FramePacer::OnVsync32, this);
+  }
+}
+
+void FramePacer::OnVsync(int64_t vsync_time_ns) {
+  const int64_t last_vsync_ns = last_vsync_ns_.load();
+  const int64_t interval_ns = vsync_time_ns - last_vsync_ns;
+  if (last_vsync_ns > 0 && interval_ns > 0) {
+    // Callbacks missed while the thread was held up span several vsyncs.
+    int64_t period_ns = vsync_period_ns_.load();
+    const int64_t vsync_count =
+        period_ns > 0
+            ? std::max<int64_t>(
+                  static_cast<int64_t>(std::llround(
+                      static_cast<double>(interval_ns) / period_ns)),
+                  1)
+            : 1;
+    const int64_t measured_ns = interval_ns / vsync_count;
+    if (measured_ns >= kMinVsyncPeriodNs && measured_ns <= kMaxVsyncPeriodNs) {
+      period_ns = period_ns == 0
+                      ? measured_ns
+                      : period_ns + static_cast<int64_t>(
+                                        kVsyncPeriodSmoothing *
+                                        (measured_ns - period_ns));
+      vsync_period_ns_.store(period_ns);
+    }
+  }
+  last_vsync_ns_.store(vsync_time_ns);
+  if (is_running_.load()) {
+    PostVsyncCallback();
+  }
+}
+
+void FramePacer::OnVsync32(long vsync_time_ns, void* data) {  // NOLINT
+  // On 32 bit ABIs only the low bits of the time are given, the high ones
+  // are those of the current time, a vsync being in the recent past.
+  int64_t time_ns = vsync_time_ns;
+  if (sizeof(vsync_time_ns) < sizeof(int64_t)) {
+    const int64_t now_ns = GetMonotonicTimeNs();
+    const int64_t low_mask = (static_cast<int64_t>(1) << 32) - 1;
+    time_ns = (now_ns & ~low_mask) |
+              (static_cast<int64_t>(vsync_time_ns) & low_mask);
+    if (time_ns > now_ns) {
+      time_ns -= low_mask + 1;
+    }
+  }
+  static_cast<FramePacer*>(data)->OnVsync(time_ns);
+}
+
+void FramePacer::OnVsync64(int64_t vsync_time_ns, void* data) {
+  static_cast<FramePacer*>(data)->OnVsync(vsync_time_ns);
+}
+
+int64_t FramePacer::GetMonotonicTimeNs() {
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+}  // namespace tango_util
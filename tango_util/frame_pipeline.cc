@@ -0,0 +1,242 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/frame_pipeline.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include <tango-gl/tracing.h>
+
+#include "tango-util/performance_hint.h"
+#include "tango-util/thread_policy.h"
+
+namespace {
+bool Contains(const std::vector<size_t>& offsets, size_t offset) {
+  return std::find(offsets.begin(), offsets.end(), offset) != offsets.end();
+}
+
+// Whether |stage| must wait for |earlier|: it reads what |earlier| writes,
+// writes what |earlier| reads, or writes it too.
+template <typename Stage>
+bool DependsOn(const Stage& stage, const Stage& earlier) {
+  for (size_t offset : stage.reads) {
+    if (Contains(earlier.writes, offset)) {
+      return true;
+    }
+  }
+  for (size_t offset : stage.writes) {
+    if (Contains(earlier.reads, offset) || Contains(earlier.writes, offset)) {
+      return true;
+    }
+  }
+  return false;
+}
+}  // namespace
+
+namespace tango_util {
+
+FramePipelineBase::FramePipelineBase(int frame_count,
+                                     TaskScheduler* scheduler)
+    : scheduler_(scheduler != nullptr ? scheduler : &TaskScheduler::Get()),
+      hint_session_(nullptr),
+      sequence_(0),
+      acquired_slot_(-1),
+      dropped_count_(0),
+      processed_count_(0),
+      is_stopping_(false) {
+  Slot slot;
+  slot.state = kFree;
+  slot.sequence = 0;
+  slots_.assign(frame_count, slot);
+}
+
+FramePipelineBase::~FramePipelineBase() { Stop(); }
+
+size_t FramePipelineBase::AddSlotStage(
+    const char* name, const std::function<void(int slot)>& run) {
+  Stage stage;
+  stage.name = name;
+  stage.run = run;
+  stages_.push_back(stage);
+  return stages_.size() - 1;
+}
+
+void FramePipelineBase::AddRead(size_t stage, size_t offset) {
+  stages_[stage].reads.push_back(offset);
+}
+
+void FramePipelineBase::AddWrite(size_t stage, size_t offset) {
+  stages_[stage].writes.push_back(offset);
+}
+
+void FramePipelineBase::Start() {
+  if (processor_.joinable()) {
+    return;
+  }
+  if (graphs_.empty()) {
+    BuildGraphs();
+  }
+  is_stopping_ = false;
+  processor_ = std::thread(&FramePipelineBase::Run, this);
+}
+
+void FramePipelineBase::Stop() {
+  if (!processor_.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    is_stopping_ = true;
+    for (int slot : queued_slots_) {
+      slots_[slot].state = kFree;
+    }
+    dropped_count_ += queued_slots_.size();
+    queued_slots_.clear();
+  }
+  frame_queued_.notify_all();
+  processor_.join();
+}
+
+void FramePipelineBase::SetPerformanceHintSession(
+    PerformanceHintSession* session, double target_duration) {
+  hint_session_ = session;
+  if (hint_session_ != nullptr) {
+    hint_session_->SetTargetDuration(target_duration);
+  }
+}
+
+uint64_t FramePipelineBase::GetDroppedCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return dropped_count_;
+}
+
+uint64_t FramePipelineBase::GetProcessedCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return processed_count_;
+}
+
+int FramePipelineBase::BeginSlot() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  // A free frame, or else the oldest processed frame the render thread did
+  // not take, which a newer one replaces.
+  int best = -1;
+  for (size_t i = 0; i < slots_.size(); ++i) {
+    if (slots_[i].state == kFree) {
+      best = static_cast<int>(i);
+      break;
+    }
+    if (slots_[i].state == kDone &&
+        (best < 0 || slots_[i].sequence < slots_[best].sequence)) {
+      best = static_cast<int>(i);
+    }
+  }
+  if (best < 0) {
+    ++dropped_count_;
+    return -1;
+  }
+  slots_[best].state = kFilling;
+  return best;
+}
+
+void FramePipelineBase::SubmitSlot(int slot) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    slots_[slot].state = kQueued;
+    slots_[slot].sequence = ++sequence_;
+    queued_slots_.push_back(slot);
+  }
+  frame_queued_.notify_one();
+}
+
+int FramePipelineBase::AcquireSlot(bool* is_new) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  int latest = -1;
+  for (size_t i = 0; i < slots_.size(); ++i) {
+    if (slots_[i].state == kDone &&
+        (latest < 0 || slots_[i].sequence > slots_[latest].sequence)) {
+      latest = static_cast<int>(i);
+    }
+  }
+  *is_new = latest >= 0;
+  if (latest < 0) {
+    return acquired_slot_;
+  }
+  // The acquired frame and the processed ones older than the latest are
+  // done with.
+  for (size_t i = 0; i < slots_.size(); ++i) {
+    if (slots_[i].state == kDone || slots_[i].state == kAcquired) {
+      slots_[i].state = kFree;
+    }
+  }
+  slots_[latest].state = kAcquired;
+  acquired_slot_ = latest;
+  return latest;
+}
+
+void FramePipelineBase::BuildGraphs() {
+  for (size_t slot = 0; slot < slots_.size(); ++slot) {
+    std::unique_ptr<TaskGraph> graph(new TaskGraph());
+    for (size_t i = 0; i < stages_.size(); ++i) {
+      const Stage* stage = &stages_[i];
+      const int slot_index = static_cast<int>(slot);
+      graph->Add([stage, slot_index] {
+        tango_gl::tracing::ScopedTrace trace(stage->name);
+        stage->run(slot_index);
+      });
+      for (size_t earlier = 0; earlier < i; ++earlier) {
+        if (DependsOn(stages_[i], stages_[earlier])) {
+          graph->Precede(earlier, i);
+        }
+      }
+    }
+    graphs_.push_back(std::move(graph));
+  }
+}
+
+void FramePipelineBase::Run() {
+  if (hint_session_ != nullptr) {
+    hint_session_->AddCurrentThread();
+  }
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    frame_queued_.wait(
+        lock, [this] { return is_stopping_ || !queued_slots_.empty(); });
+    if (is_stopping_) {
+      return;
+    }
+    const int slot = queued_slots_.front();
+    queued_slots_.pop_front();
+    slots_[slot].state = kProcessing;
+    lock.unlock();
+    ThreadPolicy::Get().Enter(ThreadPolicy::kCallbackStage);
+
+    const std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    scheduler_->Run(graphs_[slot].get());
+    if (hint_session_ != nullptr) {
+      hint_session_->ReportActualDuration(
+          std::chrono::duration<double, std::milli>(
+              std::chrono::steady_clock::now() - start)
+              .count());
+    }
+
+    lock.lock();
+    slots_[slot].state = kDone;
+    ++processed_count_;
+  }
+}
+}  // namespace tango_util
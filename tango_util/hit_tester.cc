@@ -0,0 +1,203 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "tango-util/hit_tester.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace tango_util {
+
+HitResult::HitResult()
+    : type(kNone),
+      point(0.0f),
+      normal(0.0f),
+      distance(std::numeric_limits<float>::max()),
+      plane_id(-1),
+      object(nullptr) {}
+
+HitTester::Options::Options()
+    : max_memoized_results(16),
+      max_object_distance(10.0f),
+      depth_margin(0.05f) {}
+
+HitTester::HitTester(const Options& options)
+    : max_memoized_results_(std::max(options.max_memoized_results, 0)),
+      max_object_distance_(options.max_object_distance),
+      depth_margin_(options.depth_margin),
+      planes_(nullptr),
+      objects_(nullptr),
+      depth_cache_(nullptr),
+      camera_t1_T_camera_t0_(1.0f),
+      next_result_(0),
+      memoized_query_count_(0) {
+  results_.reserve(max_memoized_results_);
+}
+
+void HitTester::BeginFrame(const tango_gl::RigidTransform& world_T_camera,
+                           std::shared_ptr<const tango_gl::RayTable> rays) {
+  world_T_camera_ = world_T_camera;
+  rays_ = std::move(rays);
+  planes_ = nullptr;
+  objects_ = nullptr;
+  depth_cache_ = nullptr;
+  results_.clear();
+  next_result_ = 0;
+  memoized_query_count_ = 0;
+}
+
+void HitTester::SetPlanes(const std::vector<TrackedPlane>* planes) {
+  planes_ = planes;
+}
+
+void HitTester::SetObjects(tango_gl::BoundingVolumeHierarchy* objects,
+                           const tango_gl::RigidTransform& world_T_objects) {
+  objects_ = objects;
+  world_T_objects_ = world_T_objects;
+}
+
+void HitTester::SetDepth(const ProjectedDepthCache* cache,
+                         const glm::mat4& camera_t1_T_camera_t0,
+                         const tango_gl::RigidTransform& world_T_depth) {
+  depth_cache_ = cache;
+  camera_t1_T_camera_t0_ = camera_t1_T_camera_t0;
+  world_T_depth_ = world_T_depth;
+}
+
+bool HitTester::Query(const float uv[2], int types, HitResult* hit) {
+  *hit = HitResult();
+  if (rays_ == nullptr || rays_->IsEmpty()) {
+    return false;
+  }
+  const int width = rays_->GetWidth();
+  const int height = rays_->GetHeight();
+  const glm::vec2 position(uv[0] * width, uv[1] * height);
+  const int pixel_x = std::min(std::max(static_cast<int>(position.x), 0),
+                               width - 1);
+  const int pixel_y = std::min(std::max(static_cast<int>(position.y), 0),
+                               height - 1);
+  for (const MemoizedResult& result : results_) {
+    if (result.pixel_x == pixel_x && result.pixel_y == pixel_y &&
+        result.types == types) {
+      *hit = result.hit;
+      ++memoized_query_count_;
+      return hit->type != HitResult::kNone;
+    }
+  }
+
+  const glm::vec3& origin = world_T_camera_.GetTranslation();
+  const glm::vec3 direction = glm::normalize(world_T_camera_.TransformVector(
+      glm::vec3(rays_->GetRay(position), 1.0f)));
+  if ((types & HitResult::kPlane) != 0) {
+    TestPlanes(origin, direction, hit);
+  }
+  if ((types & HitResult::kObject) != 0) {
+    TestObjects(origin, direction, hit);
+  }
+  if ((types & HitResult::kDepth) != 0) {
+    TestDepth(uv, origin, direction, hit);
+  }
+
+  if (max_memoized_results_ > 0) {
+    const MemoizedResult result = {pixel_x, pixel_y, types, *hit};
+    if (results_.size() < static_cast<size_t>(max_memoized_results_)) {
+      results_.push_back(result);
+    } else {
+      results_[next_result_] = result;
+      next_result_ = (next_result_ + 1) % results_.size();
+    }
+  }
+  return hit->type != HitResult::kNone;
+}
+
+void HitTester::TestPlanes(const glm::vec3& origin, const glm::vec3& direction,
+                           HitResult* hit) const {
+  if (planes_ == nullptr) {
+    return;
+  }
+  glm::vec3 point;
+  const TrackedPlane* plane =
+      PlaneTracker::Raycast(*planes_, origin, direction, &point);
+  if (plane == nullptr) {
+    return;
+  }
+  const float distance = glm::dot(point - origin, direction);
+  if (distance >= hit->distance) {
+    return;
+  }
+  glm::vec3 normal(plane->plane.equation);
+  if (glm::dot(normal, direction) > 0.0f) {
+    normal = -normal;
+  }
+  hit->type = HitResult::kPlane;
+  hit->point = point;
+  hit->normal = normal;
+  hit->distance = distance;
+  hit->plane_id = plane->id;
+  hit->object = nullptr;
+}
+
+void HitTester::TestObjects(const glm::vec3& origin,
+                            const glm::vec3& direction, HitResult* hit) const {
+  if (objects_ == nullptr) {
+    return;
+  }
+  // Only the objects nearer than the hits so far are of interest.
+  const float length = std::min(hit->distance, max_object_distance_);
+  const tango_gl::RigidTransform objects_T_world = world_T_objects_.Inverse();
+  const glm::vec3 start = objects_T_world.TransformPoint(origin);
+  const tango_gl::Segment segment(
+      start, start + objects_T_world.TransformVector(direction) * length);
+  float fraction;
+  glm::vec3 normal;
+  const tango_gl::DrawableObject* object =
+      objects_->IntersectNearest(segment, &fraction, &normal);
+  if (object == nullptr) {
+    return;
+  }
+  hit->type = HitResult::kObject;
+  hit->distance = fraction * length;
+  hit->point = origin + direction * hit->distance;
+  hit->normal = world_T_objects_.TransformVector(normal);
+  hit->plane_id = -1;
+  hit->object = object;
+}
+
+void HitTester::TestDepth(const float uv[2], const glm::vec3& origin,
+                          const glm::vec3& direction, HitResult* hit) const {
+  if (depth_cache_ == nullptr) {
+    return;
+  }
+  float xyz[3];
+  if (!depth_cache_->GetNearestPoint(uv, camera_t1_T_camera_t0_, xyz)) {
+    return;
+  }
+  const glm::vec3 point =
+      world_T_depth_.TransformPoint(glm::vec3(xyz[0], xyz[1], xyz[2]));
+  const float distance = glm::dot(point - origin, direction);
+  const float margin = hit->type == HitResult::kNone ? 0.0f : depth_margin_;
+  if (distance <= 0.0f || distance >= hit->distance - margin) {
+    return;
+  }
+  hit->type = HitResult::kDepth;
+  hit->point = point;
+  hit->normal = -direction;
+  hit->distance = distance;
+  hit->plane_id = -1;
+  hit->object = nullptr;
+}
+}  // namespace tango_util
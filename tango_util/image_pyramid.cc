@@ -0,0 +1,240 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/image_pyramid.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <tango-gl/tracing.h>
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define TANGO_UTIL_PYRAMID_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define TANGO_UTIL_PYRAMID_SSE2 1
+#endif
+
+namespace {
+// Smallest capacity, see ImagePyramid::Initialize().
+const int kMinCapacity = 3;
+
+// Rows of the levels start aligned, for the SIMD loads of the next level.
+int GetLevelStride(int width) {
+  return static_cast<int>(tango_gl::GetAlignedStride(width));
+}
+}  // namespace
+
+namespace tango_util {
+
+ImagePyramid::ImagePyramid()
+    : max_width_(0),
+      max_height_(0),
+      sequence_(0),
+      acquired_slot_(-1),
+      acquired_sequence_(0) {}
+
+void ImagePyramid::Initialize(int capacity, int max_width, int max_height) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  max_width_ = std::max(max_width, 0);
+  max_height_ = std::max(max_height, 0);
+  size_t size = 0;
+  for (int i = 0; i < ImagePyramidFrame::kLevelCount; ++i) {
+    size += static_cast<size_t>(GetLevelStride(max_width_ >> (i + 1))) *
+            (max_height_ >> (i + 1));
+  }
+  slots_.resize(std::max(capacity, kMinCapacity));
+  for (Slot& slot : slots_) {
+    slot.data.resize(size);
+    slot.frame = ImagePyramidFrame();
+    slot.sequence = 0;
+    slot.is_writing = false;
+  }
+  sequence_ = 0;
+  acquired_slot_ = -1;
+  acquired_sequence_ = 0;
+}
+
+void ImagePyramid::OnFrameAvailable(const TangoImageBuffer* buffer) {
+  // Both YUV formats start with the full resolution Y plane.
+  if (buffer->format != TANGO_HAL_PIXEL_FORMAT_YCrCb_420_SP &&
+      buffer->format != TANGO_HAL_PIXEL_FORMAT_YV12) {
+    return;
+  }
+  const int width = static_cast<int>(buffer->width);
+  const int height = static_cast<int>(buffer->height);
+  if (width > max_width_ || height > max_height_) {
+    return;
+  }
+  Slot* slot = BeginWrite();
+  if (slot == nullptr) {
+    return;
+  }
+
+  TANGO_TRACE_SCOPE("ImagePyramid::OnFrameAvailable");
+  slot->frame.timestamp = buffer->timestamp;
+  slot->frame.frame_number = buffer->frame_number;
+  SetLevels(width / 2, height / 2, slot);
+  const ImagePyramidLevel& first_level = slot->frame.levels[0];
+  Downsample(buffer->data, static_cast<int>(buffer->stride), width, height,
+             const_cast<uint8_t*>(first_level.data), first_level.stride);
+  for (int i = 1; i < ImagePyramidFrame::kLevelCount; ++i) {
+    const ImagePyramidLevel& source = slot->frame.levels[i - 1];
+    const ImagePyramidLevel& level = slot->frame.levels[i];
+    Downsample(source.data, source.stride, source.width, source.height,
+               const_cast<uint8_t*>(level.data), level.stride);
+  }
+  EndWrite(slot);
+}
+
+void ImagePyramid::OnLuminanceAvailable(const uint8_t* luminance, int width,
+                                        int height, int stride,
+                                        double timestamp) {
+  if (width > max_width_ / 2 || height > max_height_ / 2) {
+    return;
+  }
+  Slot* slot = BeginWrite();
+  if (slot == nullptr) {
+    return;
+  }
+
+  TANGO_TRACE_SCOPE("ImagePyramid::OnLuminanceAvailable");
+  slot->frame.timestamp = timestamp;
+  slot->frame.frame_number = 0;
+  SetLevels(width, height, slot);
+  const ImagePyramidLevel& first_level = slot->frame.levels[0];
+  uint8_t* destination = const_cast<uint8_t*>(first_level.data);
+  for (int y = 0; y < height; ++y) {
+    memcpy(destination + y * first_level.stride, luminance + y * stride,
+           width);
+  }
+  for (int i = 1; i < ImagePyramidFrame::kLevelCount; ++i) {
+    const ImagePyramidLevel& source = slot->frame.levels[i - 1];
+    const ImagePyramidLevel& level = slot->frame.levels[i];
+    Downsample(source.data, source.stride, source.width, source.height,
+               const_cast<uint8_t*>(level.data), level.stride);
+  }
+  EndWrite(slot);
+}
+
+const ImagePyramidFrame* ImagePyramid::Acquire(bool* is_new) {
+  int latest_slot = -1;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < slots_.size(); ++i) {
+      const Slot& slot = slots_[i];
+      if (slot.sequence == 0 || slot.is_writing) {
+        continue;
+      }
+      if (latest_slot < 0 || slot.sequence > slots_[latest_slot].sequence) {
+        latest_slot = static_cast<int>(i);
+      }
+    }
+    if (latest_slot < 0) {
+      *is_new = false;
+      return nullptr;
+    }
+    acquired_slot_ = latest_slot;
+  }
+  // Only this thread changes the acquired slot, and the callback leaves it
+  // alone.
+  const Slot& slot = slots_[latest_slot];
+  *is_new = slot.sequence != acquired_sequence_;
+  acquired_sequence_ = slot.sequence;
+  return &slot.frame;
+}
+
+ImagePyramid::Slot* ImagePyramid::BeginWrite() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  // The oldest slot, the empty ones first, that is not being read.
+  Slot* slot = nullptr;
+  for (size_t i = 0; i < slots_.size(); ++i) {
+    if (static_cast<int>(i) == acquired_slot_ || slots_[i].is_writing) {
+      continue;
+    }
+    if (slot == nullptr || slots_[i].sequence < slot->sequence) {
+      slot = &slots_[i];
+    }
+  }
+  if (slot != nullptr) {
+    slot->is_writing = true;
+  }
+  return slot;
+}
+
+void ImagePyramid::EndWrite(Slot* slot) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  slot->sequence = ++sequence_;
+  slot->is_writing = false;
+}
+
+void ImagePyramid::SetLevels(int width, int height, Slot* slot) {
+  const uint8_t* data = slot->data.data();
+  for (int i = 0; i < ImagePyramidFrame::kLevelCount; ++i) {
+    ImagePyramidLevel& level = slot->frame.levels[i];
+    level.width = width >> i;
+    level.height = height >> i;
+    level.stride = GetLevelStride(level.width);
+    level.data = data;
+    data += static_cast<size_t>(level.stride) * level.height;
+  }
+}
+
+void ImagePyramid::Downsample(const uint8_t* source, int source_stride,
+                              int width, int height, uint8_t* destination,
+                              int destination_stride) {
+  const int destination_width = width / 2;
+  const int destination_height = height / 2;
+  for (int y = 0; y < destination_height; ++y) {
+    const uint8_t* row_0 = source + 2 * y * source_stride;
+    const uint8_t* row_1 = row_0 + source_stride;
+    uint8_t* out = destination + y * destination_stride;
+    int x = 0;
+#if defined(TANGO_UTIL_PYRAMID_NEON)
+    for (; x + 8 <= destination_width; x += 8) {
+      // Pairwise add the columns of both rows, then round the sums of 4.
+      const uint16x8_t sum =
+          vpadalq_u8(vpaddlq_u8(vld1q_u8(row_0 + 2 * x)),
+                     vld1q_u8(row_1 + 2 * x));
+      vst1_u8(out + x, vrshrn_n_u16(sum, 2));
+    }
+#elif defined(TANGO_UTIL_PYRAMID_SSE2)
+    const __m128i low_bytes = _mm_set1_epi16(0x00ff);
+    const __m128i two = _mm_set1_epi16(2);
+    for (; x + 8 <= destination_width; x += 8) {
+      const __m128i pixels_0 =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(row_0 + 2 * x));
+      const __m128i pixels_1 =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(row_1 + 2 * x));
+      // The even and odd columns as 16 bit lanes.
+      __m128i sum = _mm_add_epi16(_mm_and_si128(pixels_0, low_bytes),
+                                  _mm_srli_epi16(pixels_0, 8));
+      sum = _mm_add_epi16(sum, _mm_and_si128(pixels_1, low_bytes));
+      sum = _mm_add_epi16(sum, _mm_srli_epi16(pixels_1, 8));
+      sum = _mm_srli_epi16(_mm_add_epi16(sum, two), 2);
+      _mm_storel_epi64(reinterpret_cast<__m128i*>(out + x),
+                       _mm_packus_epi16(sum, sum));
+    }
+#endif
+    for (; x < destination_width; ++x) {
+      out[x] = static_cast<uint8_t>((row_0[2 * x] + row_0[2 * x + 1] +
+                                     row_1[2 * x] + row_1[2 * x + 1] + 2) >>
+                                    2);
+    }
+  }
+}
+}  // namespace tango_util
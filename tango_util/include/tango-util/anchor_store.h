@@ -0,0 +1,122 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef TANGO_UTIL_ANCHOR_STORE_H_
+#define TANGO_UTIL_ANCHOR_STORE_H_
+
+#include <vector>
+
+#include <tango-gl/rigid_transform.h>
+#include <tango-gl/util.h>
+
+namespace tango_util {
+// AnchorStore keeps the anchors AR content is attached to, so that a
+// correction of the area description, e.g. its localization, moves every
+// object at the cost of its anchor rather than of each object.
+//
+//   // Content is placed on an anchor, the objects being children of a node
+//   // set from its transform.
+//   const int anchor = anchors_.AddAnchor(world_T_content);
+//   ...
+//   // On a pose of the area description in the start of service frame.
+//   anchors_.SetWorldTArea(world_T_area_description);
+//   ...
+//   // Every frame, before the content is drawn.
+//   if (anchors_.Update()) {
+//     scene_.SetAnchorTransforms(anchors_.GetTransforms());
+//   }
+//
+// The anchors are poses in the area description frame, and the world, the
+// frame the content is drawn in, has the area description at a pose set by
+// SetWorldTArea(), the identity until the first localization. All the
+// anchors are posed in the world in one pass over a contiguous array when
+// that pose changes. A change is eased in over Options::smoothing_frames
+// Update()s, so the content glides to the corrected pose instead of jumping.
+//
+// Not thread safe.
+class AnchorStore {
+ public:
+  struct Options {
+    Options();
+
+    // Updates a correction is eased in over, 0 to apply it at once.
+    int smoothing_frames;
+  };
+
+  explicit AnchorStore(const Options& options);
+  AnchorStore(const AnchorStore& other) = delete;
+  AnchorStore& operator=(const AnchorStore&) = delete;
+
+  // Add an anchor where the content is seen now.
+  //
+  // @param world_T_anchor: pose of the anchor in the world frame, under the
+  //        correction currently drawn.
+  // @return: the id of the anchor, its index in GetTransforms().
+  int AddAnchor(const tango_gl::RigidTransform& world_T_anchor);
+
+  // Add an anchor at a pose in the area description frame, e.g. one another
+  // device localized in the area description shared.
+  //
+  // @return: the id of the anchor.
+  int AddAreaAnchor(const tango_gl::RigidTransform& area_T_anchor);
+
+  // @return: the pose of anchor |id| in the area description frame.
+  const tango_gl::RigidTransform& GetAreaTAnchor(int id) const {
+    return area_T_anchors_[id];
+  }
+
+  // Remove every anchor.
+  void Clear();
+
+  // Set the pose of the area description in the world frame, which the
+  // anchors move to over the next Update()s.
+  void SetWorldTArea(const tango_gl::RigidTransform& world_T_area);
+
+  // Advance the correction by a frame, and pose the anchors again if it
+  // moved. A new anchor is posed by AddAnchor().
+  //
+  // @return: true if GetTransforms() changed.
+  bool Update();
+
+  // @return: whether a correction is being eased in, for the frames to keep
+  //          being drawn until it is.
+  bool IsSmoothing() const { return smoothing_frame_ < smoothing_frames_; }
+
+  size_t GetAnchorCount() const { return area_T_anchors_.size(); }
+
+  // @return: the pose of every anchor in the world frame, by id, as of the
+  //          last Update().
+  const std::vector<glm::mat4>& GetTransforms() const { return transforms_; }
+
+ private:
+  int smoothing_frames_;
+
+  // The anchors, and their transforms in the world frame.
+  std::vector<tango_gl::RigidTransform> area_T_anchors_;
+  std::vector<glm::mat4> transforms_;
+  bool is_dirty_;
+
+  // The correction drawn, the one eased in from |start_world_T_area_| to
+  // |target_world_T_area_|, and the frames of it done.
+  tango_gl::RigidTransform world_T_area_;
+  tango_gl::RigidTransform start_world_T_area_;
+  tango_gl::RigidTransform target_world_T_area_;
+  int smoothing_frame_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_ANCHOR_STORE_H_
@@ -0,0 +1,137 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef TANGO_UTIL_AUTOTUNER_H_
+#define TANGO_UTIL_AUTOTUNER_H_
+
+#include <string>
+#include <vector>
+
+namespace tango_util {
+
+// Autotuner looks for the values of a few parameters of some work, e.g. the
+// number of bands an image is split in, that run it the fastest on the
+// device, by timing the work as it runs with other values, and keeps them in
+// a file for the next sessions.
+//
+//   tuner.SetStore(files_dir + "/splat_tuning",
+//                  model + " " + os_build + " " + gl_driver);
+//   tuner.Load();
+//   ...
+//   // For every frame.
+//   tuner.SetCanExplore(governor.HasHeadroom());
+//   upsampler.SetBandCount(tuner.GetValue(kBandCount));
+//   time = Upsample();
+//   tuner.AddSample(time);
+//
+// The parameters are tuned one after the other, every value of one timed
+// with the best values found for the others, over Options::sweep_count
+// sweeps of them. A value is timed by the median of
+// Options::trial_samples samples, after Options::warmup_samples ones for the
+// caches and threads to settle. The values of a parameter must all produce
+// an acceptable result: it is the caller that keeps the tuning within its
+// quality constraints, by only listing such values.
+//
+// Other values are only explored while SetCanExplore() is on, e.g. while the
+// frame has time to spare, the best values found so far being used
+// otherwise. Once converged, the best values are stored for the key, and
+// used from then on.
+//
+// Not thread safe.
+class Autotuner {
+ public:
+  struct Parameter {
+    // Name the value is stored under, without spaces.
+    std::string name;
+    // Values to explore, the first one being used until a better one is
+    // found.
+    std::vector<int> values;
+  };
+
+  struct Options {
+    Options();
+
+    // Samples dropped after the values change, and then timed, per value.
+    int warmup_samples;
+    int trial_samples;
+    // Times every parameter is tuned.
+    int sweep_count;
+  };
+
+  Autotuner(const std::vector<Parameter>& parameters, const Options& options);
+  Autotuner(const Autotuner& other) = delete;
+  Autotuner& operator=(const Autotuner&) = delete;
+
+  // Keep the values in the file at |path|, for the device described by
+  // |key|, see PathCalibration::SetStore().
+  void SetStore(const std::string& path, const std::string& key);
+
+  // Use the values stored for the key, converged, instead of tuning them.
+  //
+  // @return: false if there are none, e.g. for another key or other values.
+  bool Load();
+
+  // Tune from the first values again.
+  void Restart();
+
+  // Whether the values of the next samples may be other than the best ones.
+  void SetCanExplore(bool can_explore);
+
+  // @return: the value of parameter |index| to run the next sample with.
+  int GetValue(size_t index) const;
+
+  // Account for a run of the work with the values of GetValue(), which may
+  // change for the next one.
+  //
+  // @param time: duration of the run, in milliseconds.
+  void AddSample(double time);
+
+  // @return: true once every sweep finished, or the values were loaded.
+  bool IsConverged() const { return is_converged_; }
+
+ private:
+  // Time the next value of the current parameter, or move to the next
+  // parameter, or converge.
+  void NextTrial();
+
+  bool Store() const;
+
+  std::vector<Parameter> parameters_;
+  int warmup_samples_;
+  int trial_samples_;
+  int sweep_count_;
+  std::string path_;
+  std::string key_;
+
+  // Index in the values of each parameter of the best value found.
+  std::vector<size_t> best_;
+  bool is_converged_;
+  bool can_explore_;
+
+  // The value of parameters_[parameter_] being timed, the sweep, its
+  // samples, the samples to drop before them, and the median time of every
+  // value of the parameter timed in the sweep.
+  size_t parameter_;
+  size_t candidate_;
+  int sweep_;
+  std::vector<double> samples_;
+  int warmup_left_;
+  std::vector<double> candidate_times_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_AUTOTUNER_H_
@@ -0,0 +1,236 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_CALLBACK_DISPATCHER_H_
+#define TANGO_UTIL_CALLBACK_DISPATCHER_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "tango-util/thread_policy.h"
+
+namespace tango_util {
+
+class CallbackDispatcher;
+class PerformanceHintSession;
+
+// Counters of a DispatchQueue, see DispatchQueueBase::GetStats().
+struct DispatchQueueStats {
+  // Items waiting, and the most that ever waited at once.
+  size_t depth;
+  size_t max_depth;
+  // Items posted, handled, and dropped because the queue was full.
+  uint64_t posted_count;
+  uint64_t dispatched_count;
+  uint64_t dropped_count;
+  // Time from Post() to the start of the handler, in seconds.
+  double average_latency;
+  double max_latency;
+};
+
+// The part of a DispatchQueue that does not depend on the item type.
+class DispatchQueueBase {
+ public:
+  // What Post() does when the queue is full.
+  enum OverflowPolicy {
+    // Drop the oldest item, for streams where only the latest data matters,
+    // e.g. poses.
+    kDropOldest,
+    // Drop the new item, for streams where every handled item must be
+    // followed by the next one.
+    kDropNewest
+  };
+
+  virtual ~DispatchQueueBase() {}
+
+  const char* GetName() const { return name_; }
+
+  // Can be called on any thread.
+  DispatchQueueStats GetStats() const;
+  void ResetStats();
+
+ protected:
+  typedef std::chrono::steady_clock Clock;
+
+  DispatchQueueBase(const char* name, size_t capacity, OverflowPolicy policy);
+
+  // Reserve the slot of a new item. Must be called with mutex_ locked.
+  //
+  // @return the slot, or -1 if the item must be dropped.
+  int ReserveSlot();
+
+  // Release the slot of the oldest item and account for its latency. Must be
+  // called with mutex_ locked.
+  //
+  // @return the slot, or -1 if the queue is empty.
+  int ReleaseSlot();
+
+  // Wake the dispatcher up after an item was posted, without mutex_ locked.
+  void NotifyDispatcher();
+
+  mutable std::mutex mutex_;
+
+ private:
+  friend class CallbackDispatcher;
+
+  // Run the handler of the oldest item, if any. Only called by the
+  // dispatcher's worker thread.
+  //
+  // @return false if the queue was empty.
+  virtual bool DispatchOne() = 0;
+
+  const char* name_;
+  const size_t capacity_;
+  const OverflowPolicy policy_;
+  CallbackDispatcher* dispatcher_;
+
+  // Ring of slots: size_ items starting at head_, and when they were posted.
+  size_t head_;
+  size_t size_;
+  std::vector<Clock::time_point> post_times_;
+
+  size_t max_depth_;
+  uint64_t posted_count_;
+  uint64_t dispatched_count_;
+  uint64_t dropped_count_;
+  double total_latency_;
+  double max_latency_;
+};
+
+// DispatchQueue hands items of type T from the threads of the Tango service
+// callbacks to the worker thread of a CallbackDispatcher, where |handler|
+// runs. Posting only copies the item into a preallocated slot, so a slow
+// handler never holds up the service; when the handler cannot keep up, the
+// queue drops items according to its OverflowPolicy instead of growing.
+//
+// T should be a small handle, e.g. a TangoPoseData or the timestamp of a
+// point cloud already copied elsewhere: the data a callback receives is only
+// valid for the duration of the callback.
+template <typename T>
+class DispatchQueue : public DispatchQueueBase {
+ public:
+  typedef std::function<void(const T&)> Handler;
+
+  DispatchQueue(const char* name, size_t capacity, OverflowPolicy policy,
+                const Handler& handler)
+      : DispatchQueueBase(name, capacity, policy),
+        handler_(handler),
+        items_(capacity) {}
+  DispatchQueue(const DispatchQueue& other) = delete;
+  DispatchQueue& operator=(const DispatchQueue&) = delete;
+
+  // Queue |item| for the handler. Can be called from any number of threads.
+  //
+  // @return false if the item was dropped.
+  bool Post(const T& item) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      const int slot = ReserveSlot();
+      if (slot < 0) {
+        return false;
+      }
+      items_[slot] = item;
+    }
+    NotifyDispatcher();
+    return true;
+  }
+
+ private:
+  bool DispatchOne() override {
+    T item;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      const int slot = ReleaseSlot();
+      if (slot < 0) {
+        return false;
+      }
+      item = items_[slot];
+    }
+    handler_(item);
+    return true;
+  }
+
+  Handler handler_;
+  std::vector<T> items_;
+};
+
+// CallbackDispatcher runs the handlers of its queues on one worker thread,
+// in the order each queue received its items.
+//
+//   dispatcher_.AddQueue(&pose_queue_);
+//   dispatcher_.Start();
+//   ...
+//   // In the pose callback.
+//   pose_queue_.Post(*pose);
+//   ...
+//   // Once the service is disconnected.
+//   dispatcher_.Stop();
+//
+// The queues must outlive the dispatcher, or at least the worker thread.
+class CallbackDispatcher {
+ public:
+  CallbackDispatcher();
+  CallbackDispatcher(const CallbackDispatcher& other) = delete;
+  CallbackDispatcher& operator=(const CallbackDispatcher&) = delete;
+  ~CallbackDispatcher();
+
+  // Add a queue to dispatch. Must be called before Start(), and a queue
+  // belongs to a single dispatcher.
+  void AddQueue(DispatchQueueBase* queue);
+
+  // Set the stage of ThreadPolicy the worker thread enters, the callback
+  // stage by default, e.g. the bulk stage for handlers that mesh. Must be
+  // called before Start().
+  void SetThreadStage(ThreadPolicy::Stage stage) { thread_stage_ = stage; }
+
+  // Report how long the handlers take from each wake-up of the worker
+  // thread to |session|, which gets |target_duration| in milliseconds as its
+  // target and the worker thread. Must be called before Start(), |session|
+  // outliving the dispatcher.
+  void SetPerformanceHintSession(PerformanceHintSession* session,
+                                 double target_duration);
+
+  // Start the worker thread.
+  void Start();
+
+  // Stop the worker thread once the handler running, if any, returns. Items
+  // still queued are handled on the next Start().
+  void Stop();
+
+ private:
+  friend class DispatchQueueBase;
+
+  void Notify();
+  void Run();
+
+  std::vector<DispatchQueueBase*> queues_;
+  ThreadPolicy::Stage thread_stage_;
+  PerformanceHintSession* hint_session_;
+
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  bool has_posted_items_;
+  bool is_stopping_;
+  std::thread worker_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_CALLBACK_DISPATCHER_H_
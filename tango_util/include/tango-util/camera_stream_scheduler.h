@@ -0,0 +1,171 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef TANGO_UTIL_CAMERA_STREAM_SCHEDULER_H_
+#define TANGO_UTIL_CAMERA_STREAM_SCHEDULER_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+
+#include <tango_client_api.h>  // NOLINT
+#include <tango-gl/util.h>
+
+namespace tango_util {
+
+// CameraStreamScheduler streams several cameras, e.g. the color and fisheye
+// cameras, into external textures at once. The frame callbacks only mark a
+// stream as having a new frame, and one UpdateTextures() sweep per drawn
+// frame updates the textures that have one, so a stream costs an
+// updateTexture call only for the frames it shows rather than on every
+// frame. Each stream has its own drop policy, and the timestamps of the
+// images in the textures are kept to align them with the reference stream,
+// the first one added.
+//
+//   // On the GL thread, once the service is connected.
+//   camera_streams_.SetFrameFunction([this](TangoCameraId) {
+//     render_scheduler_.RequestRender(RenderScheduler::kColorFrame);
+//   });
+//   camera_streams_.AddStream(TANGO_CAMERA_COLOR, color_texture_id,
+//                             CameraStreamScheduler::kLatestFrame);
+//   camera_streams_.AddStream(TANGO_CAMERA_FISHEYE, fisheye_texture_id,
+//                             CameraStreamScheduler::kWithReference);
+//   camera_streams_.Connect();
+//   ...
+//   // On the GL thread, at the start of every frame.
+//   const uint32_t updated = camera_streams_.UpdateTextures();
+//   if (updated & CameraStreamScheduler::StreamBit(TANGO_CAMERA_COLOR)) {
+//     image_timestamp = camera_streams_.GetTimestamp(TANGO_CAMERA_COLOR);
+//   }
+//
+// The textures are those of the VideoOverlay, or of any stage sampling the
+// camera images, which reads them after the sweep.
+class CameraStreamScheduler {
+ public:
+  // When the texture of a stream is updated.
+  enum DropPolicy {
+    // On the first sweep after a new frame arrived.
+    kLatestFrame = 0,
+    // Only on the sweeps that update the reference stream, so that the
+    // images drawn together are the closest in time the service has. The
+    // stream behaves as kLatestFrame when the reference is paused.
+    kWithReference = 1,
+    // Never, every frame is dropped.
+    kPaused = 2
+  };
+
+  typedef std::function<void(TangoCameraId)> FrameFunction;
+
+  // @return the bit of |camera| in the value UpdateTextures() returns.
+  static uint32_t StreamBit(TangoCameraId camera) { return 1u << camera; }
+
+  CameraStreamScheduler();
+  CameraStreamScheduler(const CameraStreamScheduler& other) = delete;
+  CameraStreamScheduler& operator=(const CameraStreamScheduler&) = delete;
+
+  // Set the function called on the service thread when a new frame of a
+  // kLatestFrame stream arrived, e.g. to request a frame in on demand mode.
+  // The frames of the other streams are shown by the frames of the
+  // reference stream, or not at all. An empty function stops the calls.
+  void SetFrameFunction(const FrameFunction& frame_function);
+
+  // Stream |camera| into |texture_id|, a GL_TEXTURE_EXTERNAL_OES texture of
+  // the current context. The first stream added is the reference stream.
+  // Called on the GL thread before Connect().
+  //
+  // @param min_update_interval: the shortest time in seconds between two
+  //        updates of the texture, the frames arriving sooner are dropped,
+  //        or 0 to keep up with the camera.
+  void AddStream(TangoCameraId camera, GLuint texture_id,
+                 DropPolicy drop_policy, double min_update_interval = 0.0);
+
+  // Remove the streams, e.g. before adding them again with the textures of
+  // a new GL context. The service keeps calling back until it disconnects.
+  void Clear();
+
+  // Connect the textures of the streams added to their cameras. A stream
+  // whose camera fails to connect is logged, and never has a frame.
+  //
+  // @return true if every stream connected.
+  bool Connect();
+
+  // Change the drop policy of |camera|, on any thread.
+  void SetDropPolicy(TangoCameraId camera, DropPolicy drop_policy);
+
+  // Update the textures of the streams with a new frame their drop policy
+  // takes, the reference stream first. Called on the GL thread once per
+  // frame, before the textures are drawn.
+  //
+  // @return the StreamBit() of the streams updated.
+  uint32_t UpdateTextures();
+
+  // @return the texture |camera| streams into, 0 if it was not added.
+  GLuint GetTextureId(TangoCameraId camera) const;
+
+  // @return the timestamp of the image in the texture of |camera|, 0 until
+  //         the first update.
+  double GetTimestamp(TangoCameraId camera) const;
+
+  // @return how much later in seconds the image in the texture of |camera|
+  //         was taken than that of the reference stream, e.g. to draw it
+  //         with a pose of its own. 0 until both were updated.
+  double GetTimestampOffset(TangoCameraId camera) const;
+
+  // @return the frames of |camera| the service announced since Connect(),
+  //         and how many of them were never updated to its texture.
+  uint64_t GetFrameCount(TangoCameraId camera) const;
+  uint64_t GetDroppedFrameCount(TangoCameraId camera) const;
+
+  // Called by the frame callback of the service.
+  void OnFrameAvailable(TangoCameraId camera);
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+
+  struct Stream {
+    // Written on the GL thread, read by the callbacks.
+    std::atomic<bool> is_added;
+    std::atomic<int> drop_policy;
+    std::atomic<bool> has_new_frame;
+    std::atomic<uint64_t> frame_count;
+    std::atomic<uint64_t> dropped_frame_count;
+
+    // Only used on the GL thread.
+    GLuint texture_id;
+    Clock::duration min_update_interval;
+    Clock::time_point last_update_time;
+    double timestamp;
+  };
+
+  // @return true if |stream| took its new frame.
+  bool UpdateStream(TangoCameraId camera, Clock::time_point now,
+                    bool is_reference_updated);
+
+  // Indexed by TangoCameraId, so that the callbacks find their stream
+  // without a lock.
+  Stream streams_[TANGO_MAX_CAMERA_ID];
+  int reference_camera_;
+
+  std::mutex frame_mutex_;
+  FrameFunction frame_function_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_CAMERA_STREAM_SCHEDULER_H_
@@ -0,0 +1,56 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_CONVEX_HULL_H_
+#define TANGO_UTIL_CONVEX_HULL_H_
+
+#include <stddef.h>
+
+#include <vector>
+
+#include <tango-gl/util.h>
+
+namespace tango_util {
+
+// 2D convex hulls, e.g. of the inliers of a plane in its basis.
+//
+//   ComputeConvexHull(&points);
+//   SimplifyConvexHull(kMaxVertexCount, &points);
+//   if (IsInsideConvexHull(points, hit)) {
+//     ...
+//   }
+//
+// A hull is the list of its vertices, counterclockwise, without collinear
+// ones.
+
+// Replace |points| with their convex hull, in O(n log(n)). Collinear points
+// leave a degenerate hull of 2 vertices, and fewer than 3 points are left
+// as they are.
+void ComputeConvexHull(std::vector<glm::vec2>* points);
+
+// Remove the vertices of a hull spanning the smallest triangles with their
+// neighbors, until it has at most |max_vertex_count| of them. The hull stays
+// convex, inside the original one, and loses the least area.
+void SimplifyConvexHull(size_t max_vertex_count, std::vector<glm::vec2>* hull);
+
+// @return: whether |point| is inside |hull| or on its boundary, false for a
+//          degenerate hull.
+bool IsInsideConvexHull(const std::vector<glm::vec2>& hull,
+                        const glm::vec2& point);
+
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_CONVEX_HULL_H_
@@ -0,0 +1,157 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_DEPTH_SEGMENTER_H_
+#define TANGO_UTIL_DEPTH_SEGMENTER_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include <tango_client_api.h>  // NOLINT
+#include <tango-gl/util.h>
+
+#include "tango-util/worker_pool.h"
+
+namespace tango_util {
+
+// DepthSegmenter splits a depth frame into the surfaces that are connected in
+// the depth image, e.g. to count the boxes on a pallet: two neighboring
+// cells of the image are connected unless their depths differ by more than
+// Options::max_depth_change of the nearer one, so that an object in front of
+// another is a segment of its own.
+//
+// The points are laid out on a grid as by NormalEstimator: the ij buffer of
+// the TangoXYZij when the service fills it, and otherwise the points
+// projected with the depth camera intrinsics, each cell keeping its nearest
+// point and those on the same surface as it. The connected components are
+// then found with a union-find, first within square tiles of the grid, in
+// parallel on a WorkerPool since the tiles share no cells, then across the
+// borders of the tiles, which only merges the few trees that meet there.
+// Every buffer is kept from one frame to the next.
+//
+//   depth_segmenter_.SetIntrinsics(depth_camera_intrinsics);
+//   ...
+//   const std::vector<tango_util::DepthSegmenter::Segment>& segments =
+//       depth_segmenter_.Split(xyz_ij);
+//
+// Not thread safe, every method must be called from the same thread.
+class DepthSegmenter {
+ public:
+  struct Options {
+    Options();
+
+    // Cells of the projected grid per pixel of the depth camera, a grid
+    // smaller than the depth image bridges the gaps between the points.
+    float grid_scale;
+    // Neighboring cells whose depths differ by more than this ratio of the
+    // nearer one are not connected.
+    float max_depth_change;
+    // Segments with fewer points are left out of the output, as noise.
+    uint32_t min_point_count;
+    // Side of the tiles of the first pass, in cells.
+    int tile_size;
+    // Threads besides the one calling Split().
+    int thread_count;
+  };
+
+  struct Segment {
+    uint32_t point_count;
+    // Bounding box of the points, in the depth camera frame.
+    glm::vec3 bounding_min;
+    glm::vec3 bounding_max;
+    // Bounds of the cells of the segment in the grid, included.
+    int min_column;
+    int min_row;
+    int max_column;
+    int max_row;
+  };
+
+  // Segment of the points left out of every segment.
+  static const uint32_t kNoSegment = 0xFFFFFFFFu;
+
+  explicit DepthSegmenter(const Options& options);
+  DepthSegmenter(const DepthSegmenter& other) = delete;
+  DepthSegmenter& operator=(const DepthSegmenter&) = delete;
+
+  // Set the intrinsics of the depth camera, used to lay out point clouds
+  // without an ij buffer.
+  void SetIntrinsics(const TangoCameraIntrinsics& intrinsics);
+
+  // Split |xyz_ij| into its segments.
+  //
+  // @return: the segments of at least Options::min_point_count points, the
+  //          largest first. Valid until the next call.
+  const std::vector<Segment>& Split(const TangoXYZij* xyz_ij);
+
+  // @return: the index in the output of Split() of the segment of every
+  //          point of the last point cloud, or kNoSegment.
+  const std::vector<uint32_t>& GetPointSegments() const {
+    return point_segments_;
+  }
+
+  // @return: the size of the grid of the last point cloud.
+  int GetGridWidth() const { return grid_width_; }
+  int GetGridHeight() const { return grid_height_; }
+
+ private:
+  // Size the grid and fill cells_ with the cell of every point, kNoCell for
+  // points off the grid, and depths_ with the nearest depth of every cell,
+  // 0 for empty ones.
+  //
+  // @return: false if the points can not be laid out.
+  bool LayOut(const TangoXYZij* xyz_ij);
+
+  // Connect the cells of a tile, and those of the borders between tiles.
+  void ConnectTile(int tile_column, int tile_row);
+  void ConnectTileBorders();
+
+  // @return: whether neighboring cells |a| and |b| are connected.
+  bool IsConnected(uint32_t a, uint32_t b) const;
+
+  // @return: whether two depths are close enough to be of one surface.
+  bool IsSameSurface(float depth_a, float depth_b) const;
+
+  // @return: the root of the tree of |cell|, halving the path to it.
+  uint32_t Find(uint32_t cell);
+
+  // Merge the trees of |a| and |b|. Only writes the cells of their trees, so
+  // the merges of a tile never touch another.
+  void Union(uint32_t a, uint32_t b);
+
+  Options options_;
+  WorkerPool worker_pool_;
+  TangoCameraIntrinsics intrinsics_;
+  bool has_intrinsics_;
+
+  int grid_width_;
+  int grid_height_;
+  std::vector<uint32_t> cells_;
+  std::vector<float> depths_;
+  // Parent of every cell in the union-find, itself for roots and empty
+  // cells, and the root of every cell once the trees are complete.
+  std::vector<uint32_t> parents_;
+  std::vector<uint32_t> roots_;
+  // The segment of every root, before the small ones are left out, and the
+  // roots of those kept.
+  std::vector<Segment> root_segments_;
+  std::vector<uint32_t> kept_roots_;
+  std::vector<Segment> segments_;
+  std::vector<uint32_t> point_segments_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_DEPTH_SEGMENTER_H_
@@ -0,0 +1,130 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_DEPTH_TEMPORAL_FILTER_H_
+#define TANGO_UTIL_DEPTH_TEMPORAL_FILTER_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include <tango_client_api.h>  // NOLINT
+#include <tango-gl/aligned_buffer.h>
+#include <tango-gl/ray_table.h>
+#include <tango-gl/util.h>
+
+namespace tango_util {
+// DepthTemporalFilter smooths the depth of point clouds over time, so that
+// plane fitting and the other consumers of a single frame see less of the
+// noise of the depth sensor.
+//
+// It keeps a filtered depth image in the depth camera frame. For each point
+// cloud, the previous filtered image is warped into the new frame with the
+// relative pose of the two frames, and the points are splatted into a raw
+// image of the same size. Each pixel then blends its raw depth into the
+// warped one as a running mean, up to max_weight frames. A raw depth too far
+// from the warped one is an outlier or a moving object, and restarts the
+// mean. The filtered image is returned as a point cloud, one point per pixel
+// with a depth.
+//
+//   // Once the intrinsics are known.
+//   depth_filter_.SetIntrinsics(depth_camera_intrinsics);
+//   ...
+//   const TangoXYZij* filtered_cloud =
+//       depth_filter_.Filter(xyz_ij, start_service_T_depth);
+//
+// The images are allocated by SetIntrinsics(), and Filter() only allocates
+// for point clouds larger than any before. Not thread safe.
+class DepthTemporalFilter {
+ public:
+  struct Options {
+    Options();
+
+    // Pixels of the filtered image per pixel of the depth camera.
+    float image_scale;
+    // Frames the running mean of a pixel spans at most, the larger the
+    // smoother and the slower to follow changes.
+    float max_weight;
+    // Raw depths differing from the warped one by more than this ratio of
+    // it restart the mean of their pixel.
+    float max_depth_change;
+    // Frames a pixel of the filtered image survives without a raw depth,
+    // filling the holes of a single point cloud, 0 to only keep the pixels
+    // of the latest one.
+    int max_missing_count;
+  };
+
+  explicit DepthTemporalFilter(const Options& options);
+  DepthTemporalFilter(const DepthTemporalFilter& other) = delete;
+  DepthTemporalFilter& operator=(const DepthTemporalFilter&) = delete;
+
+  // Size the images for a depth camera, and reset the filter.
+  void SetIntrinsics(const TangoCameraIntrinsics& intrinsics);
+
+  // Forget the filtered image, e.g. after the pose was lost.
+  void Reset();
+
+  // Filter a point cloud.
+  //
+  // @param xyz_ij: points in the depth camera frame.
+  // @param world_T_depth: pose of the depth camera at the time of |xyz_ij|,
+  //        in any frame fixed to the world, e.g. the start of service frame.
+  // @return: the filtered points with the timestamp of |xyz_ij|, in its
+  //          frame and valid until the next call, or |xyz_ij| itself before
+  //          SetIntrinsics().
+  const TangoXYZij* Filter(const TangoXYZij* xyz_ij,
+                           const glm::mat4& world_T_depth);
+
+ private:
+  // Warp the filtered image of the previous frame into warped_depth_ and
+  // warped_weight_, through |current_T_previous|.
+  void Warp(const glm::mat4& current_T_previous);
+
+  // Splat |xyz_ij| into raw_depth_, keeping the nearest point of a pixel.
+  void Splat(const TangoXYZij* xyz_ij);
+
+  // Blend raw_depth_ into the warped image, as the new filtered image.
+  void Blend();
+
+  Options options_;
+  int width_;
+  int height_;
+  float fx_;
+  float fy_;
+  float cx_;
+  float cy_;
+  tango_gl::RayTable rays_;
+
+  // Row major images of width_ x height_, a depth of 0 being empty.
+  // The weight of a filtered pixel is the frames in its mean, and the missing
+  // count those since its last raw depth.
+  tango_gl::AlignedBuffer<float> depth_;
+  tango_gl::AlignedBuffer<float> weight_;
+  tango_gl::AlignedBuffer<float> missing_count_;
+  tango_gl::AlignedBuffer<float> warped_depth_;
+  tango_gl::AlignedBuffer<float> warped_weight_;
+  tango_gl::AlignedBuffer<float> warped_missing_count_;
+  tango_gl::AlignedBuffer<float> raw_depth_;
+
+  bool has_previous_;
+  glm::mat4 previous_world_T_depth_;
+
+  std::vector<float> points_;
+  TangoXYZij filtered_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_DEPTH_TEMPORAL_FILTER_H_
@@ -0,0 +1,146 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_DISPLAY_CONFIGURATION_H_
+#define TANGO_UTIL_DISPLAY_CONFIGURATION_H_
+
+#include <stdint.h>
+
+#include <mutex>
+#include <vector>
+
+#include <tango_client_api.h>  // NOLINT
+#include <tango-gl/util.h>
+
+#include "tango-util/intrinsics_registry.h"
+
+namespace tango_util {
+// DisplayConfiguration derives how the image of a camera is laid out on the
+// display, the view port, the projection and the texture coordinates, from
+// the rotation of the display, the size of the surface and the intrinsics of
+// the camera. Each layout is computed once per set of them and cached, so
+// turning the display back and forth costs a lookup:
+//
+//   // On the UI thread, when the activity resumes.
+//   display_configuration_.SetDisplayRotation(rotation);
+//   // On the GL thread, when the surface changes.
+//   display_configuration_.SetSurfaceSize(width, height);
+//   ...
+//   // On the GL thread, at the start of every frame.
+//   tango_util::DisplayConfiguration::Layout layout;
+//   if (display_configuration_.Update(&intrinsics_, &layout)) {
+//     glViewport(layout.viewport_x, layout.viewport_y, layout.viewport_width,
+//                layout.viewport_height);
+//     scene_.SetProjectionMatrix(layout.projection);
+//   }
+//
+// Update() is the single hook: it reports a layout only when it differs from
+// the previous one, whatever changed.
+//
+// The rotation is the one of Android's Display.getRotation(), 0 for the
+// natural orientation of the device, in which the camera image is upright.
+class DisplayConfiguration {
+ public:
+  struct Layout {
+    int rotation;
+    int surface_width;
+    int surface_height;
+
+    // glViewport() of the camera image at the aspect ratio it is displayed
+    // with, from the bottom left corner of the surface, which it covers.
+    int viewport_x;
+    int viewport_y;
+    int viewport_width;
+    int viewport_height;
+
+    // Height over width of the camera image, and the distance to the camera
+    // of its image plane scaled to a width of 2, in the frame of the camera.
+    float image_plane_ratio;
+    float image_plane_distance;
+
+    // The rotation of clip space that turns the camera image upright on the
+    // display, identity at rotation 0.
+    glm::mat4 display_T_camera;
+    // The projection of the camera, display_T_camera applied.
+    glm::mat4 projection;
+    // The texture coordinates of the camera image at texture coordinates of
+    // the view port, both with (0, 0) at the top left corner.
+    glm::mat3 uv_transform;
+  };
+
+  static const size_t kMaxCacheEntries = 4;
+
+  // Lay out the image of |camera_id| for a projection between the clip
+  // planes at |near| and |far|.
+  DisplayConfiguration(TangoCameraId camera_id, float near, float far);
+  DisplayConfiguration(const DisplayConfiguration& other) = delete;
+  DisplayConfiguration& operator=(const DisplayConfiguration&) = delete;
+
+  // Can be called on any thread.
+  // @param rotation: 0 to 3, quarter turns of the display.
+  void SetDisplayRotation(int rotation);
+
+  // Can be called on any thread.
+  void SetSurfaceSize(int width, int height);
+
+  // Make the next Update() report the layout even if it did not change, for
+  // a new GL context whose view port is to be set again. Can be called on
+  // any thread.
+  void Invalidate();
+
+  // The layout for the current rotation, surface and intrinsics.
+  //
+  // @param layout: filled with the layout if it changed.
+  //
+  // @return: true if |layout| was filled, false if the layout did not change
+  //          since the previous call, or can not be computed yet, the surface
+  //          size or the intrinsics of the camera not being known.
+  bool Update(IntrinsicsRegistry* intrinsics, Layout* layout);
+
+ private:
+  struct Entry {
+    int rotation;
+    int surface_width;
+    int surface_height;
+    TangoCameraIntrinsics intrinsics;
+    Layout layout;
+  };
+
+  // @return: the layout of the camera image, computed.
+  Layout ComputeLayout(int rotation, int surface_width, int surface_height,
+                       const TangoCameraIntrinsics& intrinsics,
+                       IntrinsicsRegistry* registry) const;
+
+  const TangoCameraId camera_id_;
+  const float near_;
+  const float far_;
+
+  std::mutex mutex_;
+  int rotation_;
+  int surface_width_;
+  int surface_height_;
+  // Incremented by every setter and Invalidate(), under mutex_.
+  uint64_t version_;
+
+  // Only used by the thread calling Update().
+  uint64_t reported_version_;
+  TangoCameraIntrinsics reported_intrinsics_;
+  // Oldest first.
+  std::vector<Entry> entries_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_DISPLAY_CONFIGURATION_H_
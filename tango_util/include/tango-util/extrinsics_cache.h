@@ -0,0 +1,139 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_EXTRINSICS_CACHE_H_
+#define TANGO_UTIL_EXTRINSICS_CACHE_H_
+
+#include <tango_client_api.h>  // NOLINT
+#include <tango-gl/conversions.h>
+#include <tango-gl/util.h>
+
+namespace tango_util {
+// ExtrinsicsCache holds the fixed transformations between the device, the
+// sensors and the OpenGL frames. The extrinsics of the device, color camera
+// and depth camera are queried from the Tango service once, and every chain
+// built from them is composed and inverted at the same time, so rendering a
+// frame only multiplies its pose in.
+//
+// The naming follows the rest of the examples: a_T_b transforms points from
+// frame b to frame a.
+//
+// More information about frame transformation can be found here:
+// Frame of reference:
+//   https://developers.google.com/project-tango/overview/frames-of-reference
+// Coordinate System Conventions:
+//   https://developers.google.com/project-tango/overview/coordinate-systems
+class ExtrinsicsCache {
+ public:
+  ExtrinsicsCache();
+
+  // Query the extrinsics from the Tango service. They are only available
+  // once the service is connected, and must be updated before the render
+  // thread reads them.
+  //
+  // @return: error code, the cache keeps its previous content on failure.
+  TangoErrorType Update();
+
+  // @return: whether Update() has succeeded at least once. Until then every
+  //          extrinsic transformation is the identity.
+  bool IsValid() const { return is_valid_; }
+
+  // Sensor extrinsics.
+  const glm::mat4& GetImuTDevice() const { return imu_T_device_; }
+  const glm::mat4& GetDeviceTImu() const { return device_T_imu_; }
+  const glm::mat4& GetImuTColorCamera() const { return imu_T_color_camera_; }
+  const glm::mat4& GetImuTDepthCamera() const { return imu_T_depth_camera_; }
+  const glm::mat4& GetDeviceTColorCamera() const {
+    return device_T_color_camera_;
+  }
+  const glm::mat4& GetColorCameraTDevice() const {
+    return color_camera_T_device_;
+  }
+  const glm::mat4& GetDeviceTDepthCamera() const {
+    return device_T_depth_camera_;
+  }
+  const glm::mat4& GetDepthCameraTDevice() const {
+    return depth_camera_T_device_;
+  }
+
+  // OpenGL camera of the color and depth cameras with respect to the device.
+  const glm::mat4& GetDeviceTColorOpenGlCamera() const {
+    return device_T_color_opengl_camera_;
+  }
+  const glm::mat4& GetColorOpenGlCameraTDevice() const {
+    return color_opengl_camera_T_device_;
+  }
+  const glm::mat4& GetDeviceTDepthOpenGlCamera() const {
+    return device_T_depth_opengl_camera_;
+  }
+
+  // Start of service frame with respect to the OpenGL world, and back.
+  const glm::mat4& GetOpenGlWorldTStartService() const {
+    return opengl_world_T_start_service_;
+  }
+  const glm::mat4& GetStartServiceTOpenGlWorld() const {
+    return start_service_T_opengl_world_;
+  }
+
+  // Compose a device pose with the extrinsics into the pose of the color
+  // camera's OpenGL camera in the OpenGL world:
+  //   opengl_world_T_start_service * start_service_T_device *
+  //   device_T_color_camera * color_camera_T_opengl_camera
+  glm::mat4 GetOpenGlWorldTColorOpenGlCamera(
+      const glm::mat4& start_service_T_device) const {
+    // The world conversion is an axis permutation, applied as a swizzle.
+    return tango_gl::conversions::kOpenGlWorldTTangoWorld *
+           (start_service_T_device * device_T_color_opengl_camera_);
+  }
+
+  // Compose a device pose with the extrinsics into the pose of the depth
+  // camera in the OpenGL world, e.g. to draw its point clouds:
+  //   opengl_world_T_start_service * start_service_T_device *
+  //   device_T_depth_camera
+  glm::mat4 GetOpenGlWorldTDepthCamera(
+      const glm::mat4& start_service_T_device) const {
+    return tango_gl::conversions::kOpenGlWorldTTangoWorld *
+           (start_service_T_device * device_T_depth_camera_);
+  }
+
+  // Same as GetOpenGlWorldTColorOpenGlCamera() for the depth camera.
+  glm::mat4 GetOpenGlWorldTDepthOpenGlCamera(
+      const glm::mat4& start_service_T_device) const {
+    // The world conversion is an axis permutation, applied as a swizzle.
+    return tango_gl::conversions::kOpenGlWorldTTangoWorld *
+           (start_service_T_device * device_T_depth_opengl_camera_);
+  }
+
+ private:
+  bool is_valid_;
+
+  glm::mat4 imu_T_device_;
+  glm::mat4 device_T_imu_;
+  glm::mat4 imu_T_color_camera_;
+  glm::mat4 imu_T_depth_camera_;
+  glm::mat4 device_T_color_camera_;
+  glm::mat4 color_camera_T_device_;
+  glm::mat4 device_T_depth_camera_;
+  glm::mat4 depth_camera_T_device_;
+  glm::mat4 device_T_color_opengl_camera_;
+  glm::mat4 color_opengl_camera_T_device_;
+  glm::mat4 device_T_depth_opengl_camera_;
+  glm::mat4 opengl_world_T_start_service_;
+  glm::mat4 start_service_T_opengl_world_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_EXTRINSICS_CACHE_H_
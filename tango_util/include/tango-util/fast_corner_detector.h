@@ -0,0 +1,135 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_FAST_CORNER_DETECTOR_H_
+#define TANGO_UTIL_FAST_CORNER_DETECTOR_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "tango-util/image_pyramid.h"
+#include "tango-util/worker_pool.h"
+
+namespace tango_util {
+
+// A corner of FastCornerDetector, in pixels of the level it was found in.
+struct FastCorner {
+  int16_t x;
+  int16_t y;
+  // Strength of the corner: it stays one for any threshold below it, which
+  // is above Options::threshold.
+  int16_t score;
+};
+
+// FastCornerDetector finds FAST-9 corners in 8 bit luminance, e.g. a level
+// of an ImagePyramidFrame or the Y plane of a TangoImageBuffer, for marker
+// placement or to tell whether a view has enough texture to track:
+//
+//   FastCornerDetector detector(FastCornerDetector::Options());
+//   ...
+//   // On the consumer's thread.
+//   const ImagePyramidFrame* frame = pyramid_.Acquire(&is_new);
+//   if (frame != nullptr && is_new) {
+//     detector.Detect(frame->levels[0]);
+//     for (const FastCorner& corner : detector.GetCorners()) {
+//       ...
+//     }
+//   }
+//
+// A pixel is a corner when 9 contiguous pixels of the circle of 16 of radius
+// 3 around it are all brighter than it by more than the threshold, or all
+// darker. The pixels whose every other pixel of the circle already rules that
+// out are rejected 16 at a time with NEON, or SSE2 on x86, and the others
+// tested in full. The corners are kept only where their score is a maximum of
+// the 3x3 pixels around them, and only the best Options::max_corners_per_cell
+// of each cell of a grid, so that they spread over the image rather than
+// cluster on its most textured part.
+//
+// The rows are split into bands detected in parallel on a WorkerPool. The
+// scratch of the bands and the corners are kept from one call to the next,
+// so that a detection of images of the same size allocates nothing.
+//
+// Not thread safe, Detect() must be called from one thread at a time.
+class FastCornerDetector {
+ public:
+  struct Options {
+    Options();
+
+    // Difference of luminance from the center a pixel of the circle needs.
+    int threshold;
+    // Edge length of the cells of the grid the corners are spread over, in
+    // pixels, and the most corners kept in each, 0 for no grid.
+    int cell_size;
+    int max_corners_per_cell;
+    // Threads detecting bands besides the calling one.
+    int thread_count;
+  };
+
+  explicit FastCornerDetector(const Options& options);
+  FastCornerDetector(const FastCornerDetector& other) = delete;
+  FastCornerDetector& operator=(const FastCornerDetector&) = delete;
+
+  // Detect the corners of |level|, replacing those of the previous call.
+  //
+  // @return: the number of corners.
+  size_t Detect(const ImagePyramidLevel& level);
+
+  // @return: the corners of the last Detect(), by cell of the grid, the best
+  //          first in each, and row by row without the grid.
+  const std::vector<FastCorner>& GetCorners() const { return corners_; }
+
+  // @return: the score of the pixel at |center|, in rows of |stride| bytes
+  //          with 3 pixels around it on every side, 0 if it is not a corner
+  //          for |threshold|.
+  static int GetScore(const uint8_t* center, int stride, int threshold);
+
+ private:
+  // The corners found in a band of rows.
+  struct Band {
+    int begin_row;
+    int end_row;
+    std::vector<FastCorner> candidates;
+    std::vector<FastCorner> corners;
+  };
+
+  // Find the corners of the rows of |band| before non-maximum suppression,
+  // writing their scores into scores_.
+  void DetectBand(const ImagePyramidLevel& level, Band* band);
+
+  // Keep the candidates of |band| that are the maximum of their neighbors in
+  // scores_.
+  void SuppressBand(int width, Band* band);
+
+  // Keep the best corners of each cell of the grid.
+  void SelectByCell(int width);
+
+  Options options_;
+  WorkerPool worker_pool_;
+  std::vector<Band> bands_;
+  // Score of each pixel of the level, 0 for the pixels that are not
+  // candidates, cleared back after each Detect().
+  std::vector<int16_t> scores_;
+  std::vector<FastCorner> corners_;
+  // The corners of every band before the grid, the cell of each, and their
+  // order by cell and score.
+  std::vector<FastCorner> all_corners_;
+  std::vector<uint32_t> cells_;
+  std::vector<uint32_t> order_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_FAST_CORNER_DETECTOR_H_
@@ -0,0 +1,164 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_FEATURE_DEMAND_H_
+#define TANGO_UTIL_FEATURE_DEMAND_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+#include <tango_client_api.h>  // NOLINT
+#include <tango-gl/util.h>
+
+namespace tango_util {
+// FeatureDemand keeps the depth sensor and the color frame callbacks of the
+// service running only while some part of the app consumes them, e.g. a mode
+// of the UI, rather than for the whole session. Each consumer sets its own
+// bit of demand, and a feature runs while any bit is set:
+//
+//   // Before TangoService_connect().
+//   feature_demand_.Configure(tango_config_);
+//   feature_demand_.SetColorFrameCallback(this, OnFrameAvailableRouter);
+//   ...
+//   // After TangoService_connect().
+//   feature_demand_.OnConnected();
+//   // On the GL thread, after connectTextureId().
+//   feature_demand_.SetColorTexture(texture_id, this);
+//   ...
+//   // On the UI thread, when a mode is toggled.
+//   feature_demand_.SetDemand(tango_util::FeatureDemand::kDepth,
+//                             kDepthOverlayConsumer, is_overlay_visible);
+//   ...
+//   // On the GL thread, every frame.
+//   feature_demand_.Apply();
+//
+// Depth is turned on and off through config_runtime_depth_framerate, which
+// needs no reconnect, and the color frames by reconnecting the color camera
+// with its texture only. A feature is turned on at the first Apply() it is
+// demanded, and off only once it has not been demanded for the release
+// delay, so that modes toggled back and forth, or handed over from one
+// consumer to the next, cost no service call at all.
+class FeatureDemand {
+ public:
+  enum Feature {
+    // The point clouds of connectOnXYZijAvailable().
+    kDepth = 0,
+    // The images of connectOnFrameAvailable() for the color camera, whose
+    // texture stays connected either way.
+    kColorFrames = 1,
+    kFeatureCount = 2
+  };
+
+  typedef void (*FrameCallback)(void* context, TangoCameraId id,
+                                const TangoImageBuffer* buffer);
+
+  // The rate of the depth callback while depth is demanded, in Hz.
+  static const int kDefaultDepthFramerate = 5;
+
+  // @param release_delay: how long a feature is kept running after its last
+  //                       consumer let go, in seconds.
+  explicit FeatureDemand(double release_delay = 1.0);
+  FeatureDemand(const FeatureDemand& other) = delete;
+  FeatureDemand& operator=(const FeatureDemand&) = delete;
+
+  // Enable depth in the connect time |config|, which is required for it to
+  // be turned on at runtime. The color camera, needed for its texture
+  // anyway, is left to the app.
+  //
+  // @return: the error of TangoConfig_setBool().
+  TangoErrorType Configure(TangoConfig config);
+
+  // Set the rate of the depth callback while depth is demanded, in Hz. Can
+  // be called on any thread.
+  void SetDepthFramerate(int framerate);
+
+  // Set the callback connected to the color camera while frames are
+  // demanded. Can be called on any thread.
+  void SetColorFrameCallback(void* context, FrameCallback callback);
+
+  // Set the texture the color camera is connected to again when it is
+  // disconnected from the frame callback, 0 for none, and the context of
+  // connectTextureId(). Can be called on any thread, once the texture is
+  // connected.
+  void SetColorTexture(unsigned int texture_id, void* context);
+
+  // Demand |feature| for |consumer|, or stop. Can be called on any thread.
+  //
+  // @param consumer: a bit of the app's own, one per mode or stage that
+  //                  consumes the feature.
+  void SetDemand(Feature feature, uint32_t consumer, bool is_demanded);
+
+  // @return: true if any consumer demands |feature|.
+  bool IsDemanded(Feature feature) const;
+
+  // @return: true if |feature| was running at the service as of the last
+  //          Apply().
+  bool IsRunning(Feature feature) const;
+
+  // Call after TangoService_connect(). The state of depth at the service is
+  // unknown until the next Apply() sets it.
+  void OnConnected();
+
+  // Call before TangoService_disconnect(). Apply() makes no service call
+  // until OnConnected().
+  void OnDisconnected();
+
+  // Turn the features on or off at the service as demanded, if they are
+  // not already. Most calls make no service call and are cheap enough for
+  // every frame.
+  //
+  // @return: true if a service call was made.
+  bool Apply();
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+
+  // What a feature was set to at the service.
+  enum State { kUnknown, kStopped, kRunning };
+
+  struct FeatureState {
+    std::atomic<uint32_t> demand;
+    State state;
+    // Set while the feature is running without demand, since
+    // release_time.
+    bool is_releasing;
+    Clock::time_point release_time;
+  };
+
+  // Turn |feature| on or off at the service. The state is updated even if
+  // the service call failed, to not retry it every frame, the next change of
+  // demand does.
+  void SetRunning(Feature feature, bool is_running);
+
+  const Clock::duration release_delay_;
+
+  void* frame_context_;
+  FrameCallback frame_callback_;
+  unsigned int color_texture_id_;
+  void* texture_context_;
+
+  // Guards what follows, between the threads of the setters and Apply().
+  mutable std::mutex mutex_;
+  bool is_connected_;
+  int depth_framerate_;
+  FeatureState features_[kFeatureCount];
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_FEATURE_DEMAND_H_
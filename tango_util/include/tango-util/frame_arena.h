@@ -0,0 +1,140 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_FRAME_ARENA_H_
+#define TANGO_UTIL_FRAME_ARENA_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+namespace tango_util {
+// Counters of a FrameArena, see FrameArena::GetStats().
+struct FrameArenaStats {
+  // Size of the main block, in bytes.
+  size_t capacity;
+  // Most bytes allocated between two resets.
+  size_t high_water_mark;
+  // Blocks allocated from the heap since the arena was created. Stops
+  // increasing once the main block fits the largest frame.
+  uint64_t heap_allocation_count;
+};
+
+// FrameArena hands out the scratch memory of a frame from one block, by
+// bumping an offset, and takes it all back at once with Reset() at the end
+// of the frame. It is meant for the transient buffers of a per frame stage,
+// which would otherwise be malloc'ed and freed on every frame:
+//
+//   tango_util::ArenaVector<glm::vec3> vertices(
+//       tango_util::ArenaAllocator<glm::vec3>(&arena_));
+//   ...
+//   // Once nothing allocated from the arena is used anymore.
+//   arena_.Reset();
+//
+// A frame needing more than the main block gets extra blocks from the heap,
+// and the next Reset() replaces the main block by one fitting that frame, so
+// after a few frames of warm-up the arena stops allocating, which
+// heap_allocation_count shows.
+//
+// Not thread safe: every thread needs its own arena, e.g. one per thread of
+// WorkerPool::ParallelForWithThread().
+class FrameArena {
+ public:
+  // @param capacity: initial size of the main block, in bytes.
+  explicit FrameArena(size_t capacity);
+  FrameArena(const FrameArena& other) = delete;
+  FrameArena& operator=(const FrameArena&) = delete;
+
+  // @param alignment: a power of two, at most alignof(max_align_t).
+  // @return: |size| bytes valid until the next Reset().
+  void* Allocate(size_t size, size_t alignment);
+
+  // Free everything allocated since the previous reset.
+  void Reset();
+
+  FrameArenaStats GetStats() const;
+
+ private:
+  // Allocate a heap block of |size| bytes.
+  uint8_t* AllocateBlock(size_t size);
+
+  std::unique_ptr<uint8_t[]> block_;
+  size_t capacity_;
+  size_t offset_;
+  // Blocks of the frames larger than the main one, freed by Reset(), and the
+  // bytes allocated from them.
+  std::vector<std::unique_ptr<uint8_t[]>> overflow_blocks_;
+  uint8_t* overflow_begin_;
+  size_t overflow_size_;
+  size_t overflow_offset_;
+  size_t frame_size_;
+
+  size_t high_water_mark_;
+  uint64_t heap_allocation_count_;
+};
+
+// ArenaAllocator allocates the storage of a standard container from a
+// FrameArena. Deallocation does nothing: the storage is reclaimed by the
+// next FrameArena::Reset(), which the container must not outlive.
+template <typename T>
+class ArenaAllocator {
+ public:
+  typedef T value_type;
+  typedef T* pointer;
+  typedef const T* const_pointer;
+  typedef T& reference;
+  typedef const T& const_reference;
+  typedef size_t size_type;
+  typedef ptrdiff_t difference_type;
+
+  template <typename U>
+  struct rebind {
+    typedef ArenaAllocator<U> other;
+  };
+
+  explicit ArenaAllocator(FrameArena* arena) : arena_(arena) {}
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U>& other)  // NOLINT
+      : arena_(other.GetArena()) {}
+
+  T* allocate(size_t count) {
+    return static_cast<T*>(arena_->Allocate(count * sizeof(T), alignof(T)));
+  }
+  void deallocate(T* /*pointer*/, size_t /*count*/) {}
+
+  FrameArena* GetArena() const { return arena_; }
+
+ private:
+  FrameArena* arena_;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+  return a.GetArena() == b.GetArena();
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+  return a.GetArena() != b.GetArena();
+}
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_FRAME_ARENA_H_
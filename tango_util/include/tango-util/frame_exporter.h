@@ -0,0 +1,199 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef TANGO_UTIL_FRAME_EXPORTER_H_
+#define TANGO_UTIL_FRAME_EXPORTER_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace tango_util {
+class TaskScheduler;
+class WorkerPool;
+
+// FrameExporter writes the frames of a data collection session to files, the
+// metric depth images as 16 bit PNG of millimeters and the other frames, e.g.
+// the NV21 color images, raw:
+//
+//   exporter_.Start("/sdcard/capture");
+//   ...
+//   // Any thread, e.g. the color camera callback.
+//   FrameExporter::Frame* frame = exporter_.Acquire(size);
+//   if (frame != nullptr) {
+//     frame->format = FrameExporter::kRawFormat;
+//     frame->name = "color";
+//     frame->extension = "nv21";
+//     ...
+//     memcpy(frame->data, buffer->data, size);
+//     exporter_.Submit(frame);
+//   }
+//
+// The frames are pooled: Acquire() hands out a free one for the producer to
+// fill in place, and Submit() queues it without a copy. A thread of the
+// exporter encodes the queued frames a few at a time, in parallel on
+// Options::encode_thread_count threads of the little cores, and writes them
+// in the order they were submitted. A frame goes back to the pool once
+// written, so when the disk can not keep up, the pool runs out and Acquire()
+// drops the frame instead of waiting: the producers are never held up by the
+// disk. The buffers grow to the largest frame once, and are then reused.
+// An offline conversion, which must not lose frames, sets
+// Options::wait_for_frame for Acquire() to wait for a free frame instead.
+//
+// Each frame is written to <name>_<timestamp>.png for kDepthFormat, and to
+// <name>_<timestamp>_<width>x<height>.<extension> for kRawFormat, in the
+// directory.
+class FrameExporter {
+ public:
+  enum Format {
+    // |data| holds width * height floats, depths in meters, 0 where there is
+    // none, written as a 16 bit grayscale PNG of millimeters.
+    kDepthFormat,
+    // |data| is written as is.
+    kRawFormat
+  };
+
+  // A frame of the pool, from Acquire() to Submit().
+  struct Frame {
+    Format format;
+    // Start of the file name, and its extension for kRawFormat, which must
+    // outlive the exporter, e.g. literals.
+    const char* name;
+    const char* extension;
+    int width;
+    int height;
+    double timestamp;
+    // The |size| bytes of Acquire(), for the producer to fill, aligned for
+    // floats.
+    uint8_t* data;
+    size_t size;
+    // Index of the frame in the pool.
+    int slot;
+  };
+
+  struct Options {
+    Options();
+
+    // Frames of the pool, queued, being filled or written.
+    int frame_count;
+    // Threads encoding the depth images, the exporter thread included.
+    int encode_thread_count;
+    // zlib level, from 1 for the fastest to 9 for the smallest files.
+    int compression_level;
+    // Whether Acquire() waits for a frame of the pool to be free rather than
+    // dropping the frame.
+    bool wait_for_frame;
+  };
+
+  struct Stats {
+    uint64_t written_count;
+    uint64_t dropped_count;
+    uint64_t failed_count;
+    uint64_t written_bytes;
+  };
+
+  explicit FrameExporter(const Options& options);
+  ~FrameExporter();
+  FrameExporter(const FrameExporter& other) = delete;
+  FrameExporter& operator=(const FrameExporter&) = delete;
+
+  // Start the exporter thread, writing to |directory|, which must exist.
+  bool Start(const char* directory);
+
+  // Write every queued frame and stop the exporter thread. The frames
+  // submitted after are dropped.
+  void Stop();
+
+  bool IsRunning() const { return is_running_.load(); }
+
+  // @return: a frame with |size| bytes of data, nullptr when not running or
+  //          every frame of the pool is in use, without
+  //          Options::wait_for_frame, the frame then being counted as
+  //          dropped. Can be called on any thread.
+  Frame* Acquire(size_t size);
+
+  // Queue a frame of Acquire() for writing, after which the caller must not
+  // touch it. Can be called on any thread.
+  void Submit(Frame* frame);
+
+  // Copy a metric depth image into a frame and submit it.
+  //
+  // @return: false if the frame was dropped.
+  bool ExportDepth(const char* name, const float* depths, int width,
+                   int height, double timestamp);
+
+  Stats GetStats() const;
+
+ private:
+  struct Slot {
+    Frame frame;
+    std::unique_ptr<float[]> buffer;
+    size_t capacity;
+    // The file of the frame, for kDepthFormat, and a row being encoded.
+    std::vector<uint8_t> encoded;
+    std::vector<uint8_t> row;
+    bool is_encoded;
+  };
+
+  // Exporter thread.
+  void ExportLoop();
+
+  // Encode the frame of |slot| into its file contents. Runs on the pool.
+  void EncodeSlot(Slot* slot);
+
+  // @return: false if the file could not be written.
+  bool WriteSlot(const Slot& slot);
+
+  void ReleaseSlot(int slot);
+
+  int encode_thread_count_;
+  int compression_level_;
+  bool wait_for_frame_;
+  std::string directory_;
+  std::vector<Slot> slots_;
+
+  // The free slots and the queued ones, in submission order, under mutex_.
+  std::mutex mutex_;
+  std::condition_variable queue_condition_;
+  // Signaled when a slot is freed, for Options::wait_for_frame.
+  std::condition_variable free_condition_;
+  std::vector<int> free_slots_;
+  std::deque<int> queued_slots_;
+  bool is_stopping_;
+  std::atomic<bool> is_running_;
+
+  std::atomic<uint64_t> written_count_;
+  std::atomic<uint64_t> dropped_count_;
+  std::atomic<uint64_t> failed_count_;
+  std::atomic<uint64_t> written_bytes_;
+
+  // The encoding runs on a scheduler of its own, so that it never delays the
+  // loops of the render thread on the shared one.
+  std::unique_ptr<TaskScheduler> scheduler_;
+  std::unique_ptr<WorkerPool> pool_;
+  std::thread thread_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_FRAME_EXPORTER_H_
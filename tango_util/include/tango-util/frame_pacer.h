@@ -0,0 +1,151 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_FRAME_PACER_H_
+#define TANGO_UTIL_FRAME_PACER_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+struct ALooper;
+
+namespace tango_util {
+
+// FramePacer starts each frame on the GL thread as late as it can while still
+// finishing before the next vsync, so that the camera texture and the pose it
+// latches are as recent as possible when the frame is shown:
+//
+//   frame_pacer_.Start();
+//   ...
+//   // On the GL thread, first thing in the frame.
+//   frame_pacer_.BeginFrame();
+//   ... update the camera texture, render ...
+//   frame_pacer_.EndFrame();
+//
+// A thread of its own receives the vsyncs from AChoreographer. BeginFrame()
+// waits until the next vsync minus the render duration, estimated from the
+// recent frames, minus Options::margin, for the swap and the compositor.
+// Without it, GLSurfaceView starts a frame as soon as the previous one is
+// swapped, the camera image is latched a whole vsync before it is shown, and
+// two frames can start within one vsync, the second latching the same image.
+//
+// The AChoreographer functions are looked up in libandroid.so at run time,
+// the platform the examples build for predating them: before Android 7.0,
+// Start() fails and BeginFrame() does not wait.
+class FramePacer {
+ public:
+  struct Options {
+    Options();
+
+    // Time kept between the end of the frame on the GL thread and the
+    // vsync, in milliseconds.
+    double margin;
+    // Rate at which the render duration estimate falls back after a slow
+    // frame, per frame; a slower frame raises it at once.
+    double estimate_decay;
+  };
+
+  // The pacing of the frames, for telemetry.
+  struct Stats {
+    // Smoothed interval between vsyncs, 0 before two were received, and
+    // the render duration estimate, in milliseconds.
+    double vsync_period;
+    double render_duration;
+    // Smoothed wait of BeginFrame(), in milliseconds.
+    double average_wait;
+    // Frames that started in the same vsync interval as the previous one,
+    // and frames paced.
+    uint64_t double_latch_count;
+    uint64_t frame_count;
+  };
+
+  explicit FramePacer(const Options& options);
+  // Stops.
+  ~FramePacer();
+  FramePacer(const FramePacer& other) = delete;
+  FramePacer& operator=(const FramePacer&) = delete;
+
+  // Start receiving the vsyncs.
+  //
+  // @return: false if AChoreographer is not available.
+  bool Start();
+  void Stop();
+
+  // Wait in BeginFrame() when |is_enabled|, the default. The vsyncs and the
+  // render duration are still tracked when not.
+  void SetEnabled(bool is_enabled) { is_enabled_.store(is_enabled); }
+  bool IsEnabled() const { return is_enabled_.load(); }
+
+  // Wait until the frame should start, on the GL thread.
+  //
+  // @return: the time waited, in milliseconds.
+  double BeginFrame();
+
+  // Account for the render duration of the frame BeginFrame() started.
+  void EndFrame();
+
+  // Can be called on any thread.
+  Stats GetStats() const;
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+
+  // Receive the vsyncs on a looper of the calling thread until Stop().
+  void VsyncLoop();
+
+  // Post OnVsync() for the next vsync. Called on the vsync thread.
+  void PostVsyncCallback();
+
+  // Called on the vsync thread with the CLOCK_MONOTONIC time of a vsync.
+  void OnVsync(int64_t vsync_time_ns);
+  static void OnVsync32(long vsync_time_ns, void* data);  // NOLINT
+  static void OnVsync64(int64_t vsync_time_ns, void* data);
+
+  // @return: the CLOCK_MONOTONIC time, as AChoreographer's.
+  static int64_t GetMonotonicTimeNs();
+
+  const Options options_;
+  std::atomic<bool> is_enabled_;
+
+  std::thread vsync_thread_;
+  std::atomic<bool> is_running_;
+  // Of the vsync thread, to wake it on Stop(). Protected by looper_mutex_.
+  ALooper* looper_;
+  void* choreographer_;
+  std::mutex looper_mutex_;
+
+  // Latest vsync and smoothed interval, in CLOCK_MONOTONIC nanoseconds,
+  // written by the vsync thread.
+  std::atomic<int64_t> last_vsync_ns_;
+  std::atomic<int64_t> vsync_period_ns_;
+
+  // Only used on the GL thread, but for the stats under stats_mutex_.
+  Clock::time_point frame_start_;
+  // The vsync the previous frame made it for, 0 before it.
+  int64_t previous_target_ns_;
+  mutable std::mutex stats_mutex_;
+  double render_duration_;
+  double average_wait_;
+  uint64_t double_latch_count_;
+  uint64_t frame_count_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_FRAME_PACER_H_
@@ -0,0 +1,250 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_FRAME_PIPELINE_H_
+#define TANGO_UTIL_FRAME_PIPELINE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "tango-util/task_scheduler.h"
+
+namespace tango_util {
+class PerformanceHintSession;
+
+// The part of a FramePipeline that does not depend on the frame type: the
+// stages, the states of the frames and the thread running them.
+class FramePipelineBase {
+ public:
+  // Frames of a pipeline by default: one acquired by the render thread, one
+  // being processed and one being filled or waiting.
+  static const int kDefaultFrameCount = 3;
+
+  virtual ~FramePipelineBase();
+  FramePipelineBase(const FramePipelineBase& other) = delete;
+  FramePipelineBase& operator=(const FramePipelineBase&) = delete;
+
+  // Order the stages by their inputs and outputs, and start processing the
+  // submitted frames. Stages can not be added afterwards.
+  void Start();
+
+  // Stop once the frame being processed, if any, is done. Frames still
+  // waiting are dropped.
+  void Stop();
+
+  // Report how long each frame takes to process to |session|, which gets
+  // |target_duration| in milliseconds as its target and the processing
+  // thread. Must be called before Start(), |session| outliving the pipeline.
+  void SetPerformanceHintSession(PerformanceHintSession* session,
+                                 double target_duration);
+
+  // @return: the frames BeginFrame() could not provide, every frame being
+  //          busy. Can be called on any thread.
+  uint64_t GetDroppedCount() const;
+  // @return: the frames processed since the start. Can be called on any
+  //          thread.
+  uint64_t GetProcessedCount() const;
+
+ protected:
+  FramePipelineBase(int frame_count, TaskScheduler* scheduler);
+
+  size_t AddSlotStage(const char* name,
+                      const std::function<void(int slot)>& run);
+  // Record that |stage| reads or writes the member of the frames at
+  // |offset|.
+  void AddRead(size_t stage, size_t offset);
+  void AddWrite(size_t stage, size_t offset);
+
+  // @return: the slot of a frame to fill, -1 if every frame is busy.
+  int BeginSlot();
+  void SubmitSlot(int slot);
+  // @return: the slot of the latest processed frame, -1 if there is none.
+  int AcquireSlot(bool* is_new);
+
+ private:
+  enum SlotState { kFree, kFilling, kQueued, kProcessing, kDone, kAcquired };
+
+  struct Stage {
+    const char* name;
+    std::function<void(int slot)> run;
+    std::vector<size_t> reads;
+    std::vector<size_t> writes;
+  };
+
+  struct Slot {
+    SlotState state;
+    // Order of submission, to find the latest processed frame.
+    uint64_t sequence;
+  };
+
+  // Make the graph of every slot, a stage following the previous ones that
+  // write what it reads, read what it writes, or write it too.
+  void BuildGraphs();
+
+  void Run();
+
+  TaskScheduler* scheduler_;
+  PerformanceHintSession* hint_session_;
+  std::vector<Stage> stages_;
+  std::vector<std::unique_ptr<TaskGraph>> graphs_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable frame_queued_;
+  std::vector<Slot> slots_;
+  std::deque<int> queued_slots_;
+  uint64_t sequence_;
+  int acquired_slot_;
+  uint64_t dropped_count_;
+  uint64_t processed_count_;
+  bool is_stopping_;
+  std::thread processor_;
+};
+
+// FramePipeline runs the stages of a per frame computation, e.g. the filters
+// of a point cloud, on a TaskScheduler off the thread producing the frames
+// and the one consuming them. The frame type holds the inputs and outputs of
+// the stages, which declare the members they read and write, and the stages
+// are ordered from those: independent stages run at once, and a stage runs
+// after those it takes its inputs from.
+//
+//   struct DepthFrame {
+//     std::vector<float> points;
+//     std::vector<float> filtered;
+//     float average_depth;
+//   };
+//   tango_util::FramePipeline<DepthFrame> pipeline_;
+//   ...
+//   pipeline_.AddStage("filter", &DepthFrame::points, &DepthFrame::filtered,
+//                      [this](const std::vector<float>& points,
+//                             std::vector<float>* filtered) { ... });
+//   pipeline_.AddStage("statistics", &DepthFrame::points,
+//                      &DepthFrame::average_depth, ...);
+//   pipeline_.Start();
+//   ...
+//   // On the depth callback thread.
+//   DepthFrame* frame = pipeline_.BeginFrame();
+//   if (frame != nullptr) {
+//     frame->points.assign(...);
+//     pipeline_.Submit(frame);
+//   }
+//   ...
+//   // On the render thread.
+//   bool is_new;
+//   const DepthFrame* frame = pipeline_.Acquire(&is_new);
+//
+// Frames are processed one at a time, in the order they were submitted, while
+// the render thread holds the latest one processed: frame N + 1 is processed
+// while frame N is rendered. Frames are reused, so their buffers are only
+// allocated by the first ones. A stage of a frame can run on any thread of
+// the scheduler, but the stages are never run for two frames at once, so a
+// stage can keep state of its own from one frame to the next.
+template <typename Frame>
+class FramePipeline : public FramePipelineBase {
+ public:
+  typedef std::function<void(Frame* frame)> StageFunction;
+
+  explicit FramePipeline(int frame_count = kDefaultFrameCount,
+                         TaskScheduler* scheduler = nullptr)
+      : FramePipelineBase(frame_count, scheduler),
+        frames_(new Frame[frame_count]) {}
+  ~FramePipeline() { Stop(); }
+
+  // Add a stage reading and writing any member of the frame, declared with
+  // Reads() and Writes().
+  //
+  // @param name: a string literal, for the traces.
+  // @return: the stage.
+  size_t AddStage(const char* name, const StageFunction& function) {
+    Frame* frames = frames_.get();
+    return AddSlotStage(
+        name, [frames, function](int slot) { function(&frames[slot]); });
+  }
+
+  // Add a stage computing frame->*output from frame->*input, by calling
+  // function(frame->*input, &(frame->*output)).
+  template <typename Input, typename Output, typename Function>
+  size_t AddStage(const char* name, Input Frame::*input, Output Frame::*output,
+                  Function function) {
+    const size_t stage =
+        AddStage(name, [input, output, function](Frame* frame) {
+          function(static_cast<const Input&>(frame->*input),
+                   &(frame->*output));
+        });
+    Reads(stage, input);
+    Writes(stage, output);
+    return stage;
+  }
+
+  template <typename T>
+  void Reads(size_t stage, T Frame::*member) {
+    AddRead(stage, GetOffset(member));
+  }
+  template <typename T>
+  void Writes(size_t stage, T Frame::*member) {
+    AddWrite(stage, GetOffset(member));
+  }
+
+  // Get a frame to fill with the inputs of the stages, e.g. a point cloud,
+  // and Submit(). Its members keep the values of the frame it was last.
+  //
+  // @return: nullptr if every frame is busy, the new frame then being
+  //          dropped.
+  Frame* BeginFrame() {
+    const int slot = BeginSlot();
+    return slot < 0 ? nullptr : &frames_[slot];
+  }
+
+  // Queue a frame of BeginFrame() for processing.
+  void Submit(Frame* frame) {
+    SubmitSlot(static_cast<int>(frame - frames_.get()));
+  }
+
+  // Take the latest processed frame, releasing the one acquired before if
+  // it is older. Called on a single thread, e.g. the render thread.
+  //
+  // @param is_new: set if it is not the frame of the previous call.
+  // @return: the frame, valid until the next call, nullptr until the first
+  //          one is processed.
+  const Frame* Acquire(bool* is_new) {
+    const int slot = AcquireSlot(is_new);
+    return slot < 0 ? nullptr : &frames_[slot];
+  }
+
+  // @return: frame |index| of the pipeline, e.g. to size its buffers before
+  //          Start().
+  Frame* GetFrame(int index) { return &frames_[index]; }
+
+ private:
+  template <typename T>
+  size_t GetOffset(T Frame::*member) const {
+    const Frame& frame = frames_[0];
+    return reinterpret_cast<const char*>(&(frame.*member)) -
+           reinterpret_cast<const char*>(&frame);
+  }
+
+  std::unique_ptr<Frame[]> frames_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_FRAME_PIPELINE_H_
@@ -0,0 +1,182 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef TANGO_UTIL_HIT_TESTER_H_
+#define TANGO_UTIL_HIT_TESTER_H_
+
+#include <memory>
+#include <vector>
+
+#include <tango-gl/bounding_volume_hierarchy.h>
+#include <tango-gl/ray_table.h>
+#include <tango-gl/rigid_transform.h>
+#include <tango-gl/util.h>
+
+#include "tango-util/plane_tracker.h"
+#include "tango-util/projected_depth_cache.h"
+
+namespace tango_util {
+// The nearest surface under a pixel, see HitTester::Query().
+struct HitResult {
+  enum Type {
+    kNone = 0,
+    kPlane = 1 << 0,
+    kObject = 1 << 1,
+    kDepth = 1 << 2,
+    kAll = kPlane | kObject | kDepth
+  };
+
+  HitResult();
+
+  Type type;
+  // In the world frame of HitTester::BeginFrame().
+  glm::vec3 point;
+  // Unit normal facing the camera: of the plane, of the face of the bounding
+  // box of the object, or opposite the ray for a depth point.
+  glm::vec3 normal;
+  // From the camera along the ray, in meters.
+  float distance;
+  // Id of the tracked plane of a kPlane hit, -1 otherwise.
+  int plane_id;
+  // Object of a kObject hit, nullptr otherwise.
+  const tango_gl::DrawableObject* object;
+};
+
+// HitTester answers taps and other screen queries with the nearest surface
+// under a pixel of the color camera image, among the planes of a
+// PlaneTracker, the objects of a tango_gl::BoundingVolumeHierarchy and the
+// depth of a ProjectedDepthCache, instead of every app testing each in its
+// own way.
+//
+//   // Every frame the queries are made in, with the sources of that frame.
+//   hit_tester_.BeginFrame(world_T_color_camera, color_rays);
+//   hit_tester_.SetPlanes(&planes_);
+//   hit_tester_.SetObjects(&scene_objects_, world_T_opengl_world);
+//   hit_tester_.SetDepth(&depth_cache_, color_t1_T_color_t0,
+//                        world_T_depth_camera_t1);
+//   tango_util::HitResult hit;
+//   if (hit_tester_.Query(uv, tango_util::HitResult::kAll, &hit)) {
+//     ...
+//   }
+//
+// The sources are tested cheapest first, planes, then the boxes of the
+// objects, through the hierarchy and only up to the plane hit, and the depth
+// last, only when the caller asks for its type. A depth point nearer than a
+// plane or an object by more than Options::depth_margin hides it, e.g. a real
+// object on a table, the margin keeping the noise of the depth on the table
+// itself from hiding the table.
+//
+// The results of a frame are memoized by pixel, so the queries a touch UI
+// repeats, e.g. a drag or a crosshair asked for by several widgets, are
+// answered without testing the sources again. The sources must not change
+// until the next BeginFrame(). Not thread safe.
+class HitTester {
+ public:
+  struct Options {
+    Options();
+
+    // Results memoized per frame at most, the oldest replaced first.
+    int max_memoized_results;
+    // Objects farther from the camera are not hit, in meters.
+    float max_object_distance;
+    // Distance a depth point must be nearer than a plane or object hit by to
+    // hide it, in meters.
+    float depth_margin;
+  };
+
+  explicit HitTester(const Options& options);
+  HitTester(const HitTester& other) = delete;
+  HitTester& operator=(const HitTester&) = delete;
+
+  // Start a frame, forgetting its sources and memoized results.
+  //
+  // @param world_T_camera: pose of the color camera at the time of the image
+  //        on screen, in the frame of the sources.
+  // @param rays: rays of the pixels of the color camera.
+  void BeginFrame(const tango_gl::RigidTransform& world_T_camera,
+                  std::shared_ptr<const tango_gl::RayTable> rays);
+
+  // @param planes: in the world frame, not hit-tested if nullptr.
+  void SetPlanes(const std::vector<TrackedPlane>* planes);
+
+  // @param objects: the objects, hit on their world space box, which must be
+  //        up to date, see BoundingVolumeHierarchy::Update(). Not hit-tested
+  //        if nullptr.
+  // @param world_T_objects: transform of the frame the objects are placed
+  //        in, e.g. the OpenGL world, to the world frame.
+  void SetObjects(tango_gl::BoundingVolumeHierarchy* objects,
+                  const tango_gl::RigidTransform& world_T_objects);
+
+  // @param cache: the depth, not hit-tested if nullptr.
+  // @param camera_t1_T_camera_t0: motion of the color camera from the time
+  //        of the image to the time of the point cloud of |cache|.
+  // @param world_T_depth: pose of the depth camera at the time of the point
+  //        cloud.
+  void SetDepth(const ProjectedDepthCache* cache,
+                const glm::mat4& camera_t1_T_camera_t0,
+                const tango_gl::RigidTransform& world_T_depth);
+
+  // Find the nearest surface at a pixel.
+  //
+  // @param uv: the pixel in normalized image coordinates, [0, 1] over the
+  //        width and the height of the image.
+  // @param types: the HitResult::Type bits of the sources to test.
+  // @param hit: set to the nearest hit, of type kNone if there is none.
+  //
+  // @return: false if nothing was hit, or the frame has no rays.
+  bool Query(const float uv[2], int types, HitResult* hit);
+
+  // @return: the queries of the frame answered from their memoized result.
+  int GetMemoizedQueryCount() const { return memoized_query_count_; }
+
+ private:
+  struct MemoizedResult {
+    int pixel_x;
+    int pixel_y;
+    int types;
+    HitResult hit;
+  };
+
+  // Each test replaces |hit| with a nearer hit of its source.
+  void TestPlanes(const glm::vec3& origin, const glm::vec3& direction,
+                  HitResult* hit) const;
+  void TestObjects(const glm::vec3& origin, const glm::vec3& direction,
+                   HitResult* hit) const;
+  void TestDepth(const float uv[2], const glm::vec3& origin,
+                 const glm::vec3& direction, HitResult* hit) const;
+
+  int max_memoized_results_;
+  float max_object_distance_;
+  float depth_margin_;
+
+  tango_gl::RigidTransform world_T_camera_;
+  std::shared_ptr<const tango_gl::RayTable> rays_;
+  const std::vector<TrackedPlane>* planes_;
+  tango_gl::BoundingVolumeHierarchy* objects_;
+  tango_gl::RigidTransform world_T_objects_;
+  const ProjectedDepthCache* depth_cache_;
+  glm::mat4 camera_t1_T_camera_t0_;
+  tango_gl::RigidTransform world_T_depth_;
+
+  // Results of the frame, and the next one to replace once full.
+  std::vector<MemoizedResult> results_;
+  size_t next_result_;
+  int memoized_query_count_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_HIT_TESTER_H_
@@ -0,0 +1,139 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_IMAGE_PYRAMID_H_
+#define TANGO_UTIL_IMAGE_PYRAMID_H_
+
+#include <stdint.h>
+
+#include <mutex>
+#include <vector>
+
+#include <tango_client_api.h>  // NOLINT
+#include <tango-gl/aligned_buffer.h>
+
+namespace tango_util {
+
+// One level of an ImagePyramidFrame: 8 bit luminance rows of |stride| bytes.
+struct ImagePyramidLevel {
+  int width;
+  int height;
+  int stride;
+  const uint8_t* data;
+};
+
+// The luminance of a color image at 1/2, 1/4 and 1/8 of its size.
+struct ImagePyramidFrame {
+  static const int kLevelCount = 3;
+
+  double timestamp;
+  // 0 for the images of OnLuminanceAvailable().
+  int64_t frame_number;
+  // Level i is 1 / 2^(i + 1) of the image.
+  ImagePyramidLevel levels[kLevelCount];
+};
+
+// ImagePyramid downsamples the Y plane of the color images of the
+// OnFrameAvailable callback for the computer vision code that runs on a
+// fraction of their pixels, e.g. feature detection and tracking. Each level
+// averages 2x2 blocks of the one above it, starting straight from the
+// callback's buffer, so the full image is read once and never copied.
+//
+//   // Before connecting the callbacks.
+//   pyramid_.Initialize(kPyramidCapacity, 1920, 1080);
+//   ...
+//   // On the color callback thread.
+//   pyramid_.OnFrameAvailable(buffer);
+//   ...
+//   // On the consumer's thread.
+//   bool is_new;
+//   const ImagePyramidFrame* frame = pyramid_.Acquire(&is_new);
+//
+// An app that only connects the camera texture can instead read its
+// luminance back with a tango_gl::CameraLuminance of half the camera's size,
+// and hand it to OnLuminanceAvailable() as the first level.
+//
+// As with PointCloudQueue, the frame acquired stays valid until the next
+// Acquire(), and the callback builds into the other slots meanwhile; the
+// levels are allocated once, by Initialize().
+class ImagePyramid {
+ public:
+  ImagePyramid();
+  ImagePyramid(const ImagePyramid& other) = delete;
+  ImagePyramid& operator=(const ImagePyramid&) = delete;
+
+  // Allocate |capacity| pyramids of images up to |max_width| x |max_height|.
+  // The capacity is at least 3: one acquired, one being built and one to
+  // pick. Must be called before the color callback is connected.
+  void Initialize(int capacity, int max_width, int max_height);
+  bool IsInitialized() const { return !slots_.empty(); }
+
+  // Build the pyramid of |buffer| over the oldest one. Images larger than
+  // the maximum, or not in a YUV format, are dropped. Called on the color
+  // callback thread.
+  void OnFrameAvailable(const TangoImageBuffer* buffer);
+
+  // Build a pyramid whose first level is a copy of |luminance|, half the size
+  // of the camera image, e.g. the read back of a tango_gl::CameraLuminance.
+  // Images larger than half the maximum are dropped. Can be called on any
+  // thread.
+  void OnLuminanceAvailable(const uint8_t* luminance, int width, int height,
+                            int stride, double timestamp);
+
+  // Acquire the latest pyramid built, releasing the one acquired before.
+  //
+  // @param is_new: set if it is not the pyramid of the previous call.
+  // @return the pyramid, nullptr until the first one is built.
+  const ImagePyramidFrame* Acquire(bool* is_new);
+
+  // Average the 2x2 blocks of |source| into |destination|, of half its width
+  // and height rounded down.
+  static void Downsample(const uint8_t* source, int source_stride,
+                         int width, int height, uint8_t* destination,
+                         int destination_stride);
+
+ private:
+  struct Slot {
+    tango_gl::AlignedBuffer<uint8_t> data;
+    ImagePyramidFrame frame;
+    // Order of building, 0 while empty.
+    uint64_t sequence;
+    bool is_writing;
+  };
+
+  // @return the oldest slot not acquired, marked as being written, nullptr
+  // if there is none.
+  Slot* BeginWrite();
+  // Publish the slot of BeginWrite().
+  void EndWrite(Slot* slot);
+
+  // Point the levels of |slot| at its data, level 0 being |width| x
+  // |height|.
+  void SetLevels(int width, int height, Slot* slot);
+
+  std::vector<Slot> slots_;
+  int max_width_;
+  int max_height_;
+
+  // Protects the bookkeeping of the slots, not their pixels.
+  std::mutex mutex_;
+  uint64_t sequence_;
+  int acquired_slot_;
+  uint64_t acquired_sequence_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_IMAGE_PYRAMID_H_
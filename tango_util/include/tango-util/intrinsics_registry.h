@@ -0,0 +1,119 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_INTRINSICS_REGISTRY_H_
+#define TANGO_UTIL_INTRINSICS_REGISTRY_H_
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <tango_client_api.h>  // NOLINT
+#include <tango-gl/ray_table.h>
+#include <tango-gl/util.h>
+
+namespace tango_util {
+// IntrinsicsRegistry holds the intrinsics of the cameras, queried from the
+// Tango service once, and what the examples derive from them, computed once
+// per set of parameters and cached:
+//
+//   // Right after TangoService_connect().
+//   intrinsics_.Update(TANGO_CAMERA_COLOR);
+//   ...
+//   // Render thread, never calls the service.
+//   tango_util::IntrinsicsRegistry::Projection projection;
+//   if (intrinsics_.GetProjection(TANGO_CAMERA_COLOR, kNear, kFar,
+//                                 &projection)) {
+//     scene_.SetProjectionMatrix(projection.matrix);
+//   }
+//
+// A projection only depends on the camera and the clip planes: scaling the
+// image and the intrinsics alike gives the same frustum. The ray tables
+// depend on the size of the image they are for.
+//
+// The cache keeps the last kMaxCacheEntries projections and ray tables. All
+// methods are thread safe.
+class IntrinsicsRegistry {
+ public:
+  struct Projection {
+    // tango_gl::Camera::ProjectionMatrixForCameraIntrinsics() of the camera.
+    glm::mat4 matrix;
+    glm::mat4 inverse;
+  };
+
+  static const size_t kMaxCacheEntries = 8;
+
+  IntrinsicsRegistry();
+  IntrinsicsRegistry(const IntrinsicsRegistry& other) = delete;
+  IntrinsicsRegistry& operator=(const IntrinsicsRegistry&) = delete;
+
+  // Query the intrinsics of |camera_id| from the Tango service, which must be
+  // connected. The cache entries of the camera are dropped if they changed.
+  //
+  // @return: error code, the registry keeps its previous content on failure.
+  TangoErrorType Update(TangoCameraId camera_id);
+
+  // @param intrinsics: filled with the intrinsics of |camera_id|.
+  //
+  // @return: false if Update() has not succeeded for |camera_id|.
+  bool GetIntrinsics(TangoCameraId camera_id,
+                     TangoCameraIntrinsics* intrinsics);
+
+  // @param projection: filled with the projection of |camera_id| between
+  //        the clip planes at |near| and |far|.
+  //
+  // @return: false if Update() has not succeeded for |camera_id|.
+  bool GetProjection(TangoCameraId camera_id, float near, float far,
+                     Projection* projection);
+
+  // @return: the rays of the pixels of a |width| x |height| image covering
+  //          the image of |camera_id|, nullptr if Update() has not succeeded
+  //          for it.
+  std::shared_ptr<const tango_gl::RayTable> GetRayTable(
+      TangoCameraId camera_id, int width, int height);
+
+ private:
+  struct CameraEntry {
+    TangoCameraId camera_id;
+    TangoCameraIntrinsics intrinsics;
+  };
+
+  struct ProjectionEntry {
+    TangoCameraId camera_id;
+    float near;
+    float far;
+    Projection projection;
+  };
+
+  struct RayTableEntry {
+    TangoCameraId camera_id;
+    int width;
+    int height;
+    std::shared_ptr<const tango_gl::RayTable> rays;
+  };
+
+  // @return: the entry of |camera_id|, nullptr if none. Called under mutex_.
+  const CameraEntry* FindCameraLocked(TangoCameraId camera_id) const;
+
+  std::mutex mutex_;
+  std::vector<CameraEntry> cameras_;
+  // Oldest first.
+  std::vector<ProjectionEntry> projections_;
+  std::vector<RayTableEntry> ray_tables_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_INTRINSICS_REGISTRY_H_
@@ -0,0 +1,175 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_KEYFRAME_STORE_H_
+#define TANGO_UTIL_KEYFRAME_STORE_H_
+
+#include <stdint.h>
+
+#include <mutex>
+#include <vector>
+
+#include <tango_client_api.h>  // NOLINT
+#include <tango-gl/util.h>
+
+namespace tango_util {
+
+// A color image kept by a KeyframeStore, downsampled to RGB.
+struct Keyframe {
+  double timestamp;
+  // Pose of the color camera in the frame of the poses handed to the store,
+  // and its inverse.
+  glm::mat4 world_T_camera;
+  glm::mat4 camera_T_world;
+  // Mean squared gradient of the luminance, higher is sharper.
+  float sharpness;
+  // Size of the camera image the keyframe was downsampled from.
+  int image_width;
+  int image_height;
+  // width * height RGB pixels, top row first, tightly packed.
+  int width;
+  int height;
+  const uint8_t* rgb;
+};
+
+// KeyframeStore keeps a sparse set of the color images, for the texturing of
+// the reconstructed surfaces, e.g. by a TextureAtlasBaker:
+//
+//   // Before the color callback is connected.
+//   keyframes_.Initialize(1920, 1080);
+//   ...
+//   // On the color callback thread.
+//   keyframes_.OnFrameAvailable(buffer, start_service_T_color_camera);
+//   ...
+//   // On the consumer's thread.
+//   const int index = keyframes_.Commit();
+//   if (index >= 0) {
+//     baker_.OnKeyframeChanged(keyframes_.GetKeyframe(index));
+//   }
+//
+// A frame is a candidate once the camera moved or turned away from every
+// keyframe by Options::min_translation or Options::min_angle. The sharpest
+// of the candidate_window frames from there on is kept, so a frame blurred
+// by the motion that made the view new is passed over for a steadier one
+// right after it. Only the frames that beat the sharpest so far are
+// downsampled, straight from the callback's buffer.
+//
+// The images live in capacity + 1 slots allocated by Initialize(), the extra
+// one being where the candidate is built. Once the store is full, a new
+// keyframe replaces the one closest in pose to another keyframe, which loses
+// the least of the views covered.
+//
+// OnFrameAvailable() may be called from one thread and the other methods from
+// another: the consumer only sees the keyframes once it commits them, and the
+// keyframes stay valid until its next Commit() or Clear().
+class KeyframeStore {
+ public:
+  struct Options {
+    Options();
+
+    // Keyframes kept at most.
+    int capacity;
+    // The keyframes are 1 / downsample of the camera image in each
+    // direction.
+    int downsample;
+    // Distance and angle between the viewing directions, in meters and
+    // radians, from which a view is new.
+    float min_translation;
+    float min_angle;
+    // Frames among which the sharpest is kept once a view is new.
+    int candidate_window;
+  };
+
+  explicit KeyframeStore(const Options& options);
+  KeyframeStore(const KeyframeStore& other) = delete;
+  KeyframeStore& operator=(const KeyframeStore&) = delete;
+
+  // Allocate the slots for images up to |max_width| x |max_height|. Must be
+  // called before the color callback is connected.
+  void Initialize(int max_width, int max_height);
+
+  // Consider a color image. Only YCrCb 420 SP (NV21) images are supported.
+  //
+  // @param world_T_camera: pose of the color camera at the timestamp of the
+  //        image.
+  //
+  // @return true if the image was downsampled as the best candidate so far.
+  bool OnFrameAvailable(const TangoImageBuffer* buffer,
+                        const glm::mat4& world_T_camera);
+
+  // Add the candidate to the keyframes once its window of frames is over.
+  //
+  // @return the index of the keyframe added or replaced, -1 if none.
+  int Commit();
+
+  // Remove every keyframe. Called on the consumer's thread.
+  void Clear();
+
+  // Called on the consumer's thread.
+  int GetKeyframeCount() const { return keyframe_count_; }
+  const Keyframe& GetKeyframe(int index) const {
+    return slots_[index].keyframe;
+  }
+
+ private:
+  struct Slot {
+    Keyframe keyframe;
+    std::vector<uint8_t> rgb;
+  };
+
+  // @return whether |world_T_camera| is far enough from every keyframe.
+  //         Called under mutex_.
+  bool IsNovelLocked(const glm::mat4& world_T_camera) const;
+
+  // @return the distance between two poses, in units of the thresholds.
+  float GetPoseDistance(const glm::mat4& a_T_camera,
+                        const glm::mat4& b_T_camera) const;
+
+  // Mean squared difference of the luminance of neighboring pixels, sampled
+  // every |downsample_| pixels.
+  float ComputeSharpness(const TangoImageBuffer* buffer) const;
+
+  // Convert |buffer| into the candidate slot.
+  void Downsample(const TangoImageBuffer* buffer, Slot* slot) const;
+
+  int capacity_;
+  int downsample_;
+  float min_translation_;
+  float min_angle_;
+  int candidate_window_;
+  int max_width_;
+  int max_height_;
+
+  // Only used on the callback thread, while is_candidate_ready_ is false.
+  Slot candidate_;
+  int window_remaining_;
+  float best_sharpness_;
+  bool has_warned_format_;
+
+  // The poses of the keyframes, for the callback to test novelty, and
+  // whether the candidate waits for Commit().
+  std::mutex mutex_;
+  std::vector<glm::mat4> keyframe_poses_;
+  bool is_candidate_ready_;
+
+  // Only used on the consumer's thread, the first keyframe_count_ slots
+  // hold the keyframes.
+  std::vector<Slot> slots_;
+  int keyframe_count_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_KEYFRAME_STORE_H_
@@ -0,0 +1,155 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_LATENCY_TRACKER_H_
+#define TANGO_UTIL_LATENCY_TRACKER_H_
+
+#include <stdint.h>
+
+#include <deque>
+#include <mutex>
+#include <string>
+
+#include "tango-util/pose_predictor.h"
+
+namespace tango_util {
+
+// LatencyTracker measures how long the frames of a sensor, e.g. the color
+// camera, take from their capture to the display, in histograms of three
+// stages: from the capture to the callback of the service, from the callback
+// to the frame drawn with them, and from that frame to its presentation.
+//
+//   // On the callback thread, or 0 for the texture callbacks, which come
+//   // before the timestamp of the image is known.
+//   color_latency_.OnFrameAvailable(0.0);
+//   ...
+//   // On the GL thread, once the frame is issued.
+//   color_latency_.OnFrameRendered(video_overlay_timestamp);
+//   ...
+//   const tango_util::LatencyTracker::StageStatistics to_present =
+//       color_latency_.GetStatistics(LatencyTracker::kRenderToPresent);
+//
+// The capture is taken to the clock of the app with the offset |clock|
+// follows from the poses. The presentation is that SurfaceFlinger reports
+// through EGL_ANDROID_get_frame_timestamps, which the eglGetProcAddress()
+// of Android 8.0 has: on older devices, and for surfaces that do not enable
+// the timestamps, the last stage has no samples. Only the first frame drawn
+// with each sensor frame is measured.
+class LatencyTracker {
+ public:
+  enum Stage {
+    kCaptureToCallback = 0,
+    kCallbackToRender,
+    kRenderToPresent,
+    // The whole, for the frames whose presentation is known.
+    kCaptureToPresent,
+    kStageCount
+  };
+
+  struct StageStatistics {
+    uint64_t count;
+    // In milliseconds, the percentiles to the histogram's bucket size.
+    double average_ms;
+    double percentile_50_ms;
+    double percentile_95_ms;
+    double max_ms;
+  };
+
+  // @param clock: follows the service clock, must outlive the tracker.
+  explicit LatencyTracker(const PosePredictor* clock);
+  LatencyTracker(const LatencyTracker& other) = delete;
+  LatencyTracker& operator=(const LatencyTracker&) = delete;
+
+  // Note that the frame of service |timestamp| arrived, or a frame of an
+  // unknown timestamp for 0. Called on the callback thread of the sensor.
+  void OnFrameAvailable(double timestamp);
+
+  // Note that the frame just issued on the GL thread shows the sensor frame
+  // of |timestamp|, and collect the presentation times of the earlier ones.
+  // Called once per drawn frame, while the EGL surface it is drawn into is
+  // current, before the swap.
+  void OnFrameRendered(double timestamp);
+
+  // Can be called on any thread.
+  StageStatistics GetStatistics(Stage stage) const;
+
+  // Forget the frames measured so far.
+  void Reset();
+
+  // @return: the statistics of every stage as a JSON object, e.g.
+  //          {"capture_to_callback":{"count":120,"average_ms":31.20,...},...}.
+  std::string FormatReport() const;
+
+  // @return: the name of |stage| in the report, e.g. "render_to_present".
+  static const char* GetStageName(Stage stage);
+
+ private:
+  // Buckets of half a millisecond, the last one also counting the longer
+  // latencies.
+  static const int kBucketCount = 500;
+
+  struct Histogram {
+    Histogram();
+
+    uint64_t counts[kBucketCount];
+    uint64_t count;
+    double total;
+    double max;
+  };
+
+  struct Arrival {
+    double timestamp;
+    // In seconds of CLOCK_MONOTONIC.
+    double time;
+  };
+
+  // A drawn frame waiting for its presentation time.
+  struct PendingFrame {
+    uint64_t frame_id;
+    double capture_time;
+    double render_time;
+  };
+
+  // Add |latency|, in seconds, to the histogram of |stage|. Called with
+  // mutex_ held.
+  void AddSample(Stage stage, double latency);
+
+  // @return: the arrival of the frame of |timestamp|, with the latest of an
+  //          unknown timestamp taken as it, or false if there is none.
+  //          Called with mutex_ held.
+  bool TakeArrival(double timestamp, Arrival* arrival);
+
+  // Queue the next frame of the current surface for its presentation time,
+  // and collect those of the frames queued earlier. Called on the GL thread.
+  void TrackPresentTime(double capture_time, double render_time);
+  void CollectPresentTimes();
+
+  const PosePredictor* clock_;
+
+  mutable std::mutex mutex_;
+  // The latest arrivals, oldest first.
+  std::deque<Arrival> arrivals_;
+  Histogram histograms_[kStageCount];
+
+  // Only used on the GL thread.
+  double last_rendered_timestamp_;
+  void* surface_;
+  bool is_surface_timed_;
+  std::deque<PendingFrame> pending_frames_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_LATENCY_TRACKER_H_
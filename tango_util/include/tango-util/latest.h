@@ -0,0 +1,118 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_LATEST_H_
+#define TANGO_UTIL_LATEST_H_
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace tango_util {
+
+// Latest publishes the last value written by one thread to any number of
+// reader threads without a lock, e.g. the pose of the service callback to the
+// render thread, so that neither side ever waits on the other.
+//
+//   // On the callback thread.
+//   latest_pose_.Write(*pose);
+//
+//   // On the render thread.
+//   const TangoPoseData pose = latest_pose_.Read();
+//
+// The value is double buffered: a write goes to the slot not published, then
+// publishes it. Each slot is a seqlock, its sequence odd while it is written,
+// so a read that overlapped a write to its slot, which takes two writes
+// during the read, is retried on the slot published since. The writer never
+// waits, and a reader only retries when lapped.
+//
+// T must be a trivial type, as it is copied through atomic words. Write()
+// must always be called from the same thread, or under a lock of the caller.
+template <typename T>
+class Latest {
+ public:
+  explicit Latest(const T& value = T()) : write_count_(0) {
+    for (Slot& slot : slots_) {
+      slot.sequence.store(0, std::memory_order_relaxed);
+      StoreWords(value, &slot);
+    }
+    published_.store(0, std::memory_order_release);
+  }
+  Latest(const Latest& other) = delete;
+  Latest& operator=(const Latest&) = delete;
+
+  void Write(const T& value) {
+    ++write_count_;
+    const uint32_t index = write_count_ & 1;
+    Slot& slot = slots_[index];
+    const uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+    slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    StoreWords(value, &slot);
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+    published_.store(index, std::memory_order_release);
+  }
+
+  // @return: the value of the last write, or of the constructor before any.
+  T Read() const {
+    uint32_t words[kWordCount];
+    for (;;) {
+      const Slot& slot = slots_[published_.load(std::memory_order_acquire)];
+      const uint32_t sequence = slot.sequence.load(std::memory_order_acquire);
+      if ((sequence & 1) != 0) {
+        continue;
+      }
+      for (size_t i = 0; i < kWordCount; ++i) {
+        words[i] = slot.words[i].load(std::memory_order_relaxed);
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot.sequence.load(std::memory_order_relaxed) == sequence) {
+        break;
+      }
+    }
+    T value;
+    std::memcpy(&value, words, sizeof(T));
+    return value;
+  }
+
+ private:
+  static_assert(std::is_trivial<T>::value,
+                "the value is copied as raw memory");
+
+  static const size_t kWordCount = (sizeof(T) + 3) / 4;
+
+  struct Slot {
+    std::atomic<uint32_t> sequence;
+    std::atomic<uint32_t> words[kWordCount];
+  };
+
+  static void StoreWords(const T& value, Slot* slot) {
+    uint32_t words[kWordCount] = {};
+    std::memcpy(words, &value, sizeof(T));
+    for (size_t i = 0; i < kWordCount; ++i) {
+      slot->words[i].store(words[i], std::memory_order_relaxed);
+    }
+  }
+
+  Slot slots_[2];
+  std::atomic<uint32_t> published_;
+  // Only touched by the writer.
+  uint32_t write_count_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_LATEST_H_
@@ -0,0 +1,317 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_MAP_SYNC_H_
+#define TANGO_UTIL_MAP_SYNC_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include <tango_client_api.h>  // NOLINT
+#include <tango-gl/rigid_transform.h>
+
+#include "tango-util/point_cloud_codec.h"
+
+namespace tango_util {
+
+// MapSync shares a map between the devices of a room localized in the same
+// area description: the cells their depth points occupied, by tiles, and
+// their anchors, over UDP broadcast on the local network.
+//
+// The map is kept as the cells of Options::precision the points fall into,
+// grouped in cubic tiles of Options::tile_size in the area description
+// frame. A tile has a version, bumped when its cells change, and a
+// PointCloudEncoder of its own: a tile is sent as the next frame of its own
+// stream, so a change only codes the cells new since the version sent
+// before, split into as many datagrams as it needs. A peer missing a frame,
+// which cannot apply the deltas after it, asks for an intra frame of the
+// tile alone.
+//
+// Peers announce themselves with a hello every second, holding their
+// position and a hash of the area description UUID, and peers of another
+// area description are ignored. A new peer gets every tile again, nearest
+// to it first, so the room around it fills in first, and the changed tiles
+// go nearest to a peer first. Everything sent goes through a token bucket
+// of Options::max_bytes_per_second, which leaves the WiFi to the rest of
+// the room however many peers join.
+//
+// A single thread sends and receives. The tiles of peers are decoded on it
+// and kept, the latest version of each, for TakeRemoteTileUpdates() to take
+// under a brief lock, so a renderer merging them never waits on the
+// network.
+//
+//   map_sync_.Start(area_description_uuid, 7600,
+//                   tango_util::MapSync::Options());
+//   ...
+//   // For every new point cloud, localized.
+//   map_sync_.AddPoints(xyz_ij, area_T_depth);
+//   ...
+//   // On the render thread.
+//   map_sync_.TakeRemoteTileUpdates(&tile_updates_);
+//   for (const tango_util::MapSync::TileUpdate& update : tile_updates_) {
+//     // |update.points| are the cells of the tile, in the area frame.
+//   }
+//
+// Every method can be called on any thread.
+class MapSync {
+ public:
+  struct Options {
+    Options();
+
+    // Edge length of a tile and of a cell, in meters. A tile holds at most
+    // 1024 cells per axis.
+    float tile_size;
+    float precision;
+    // Cells a tile keeps at most, for its frames to fit kMaxFragmentCount
+    // datagrams.
+    int max_cells_per_tile;
+    // Tiles kept at most, past which new ones are dropped.
+    int max_tile_count;
+    // Every |point_stride| point of a cloud is added, as neighbouring points
+    // mostly fall into the same cell.
+    int point_stride;
+    // Frames of a tile between two intra frames.
+    int keyframe_interval;
+    // Bytes sent per second at most, over the datagrams of every kind.
+    int max_bytes_per_second;
+    // Largest datagram sent, by default what fits in a WiFi frame.
+    size_t max_datagram_size;
+  };
+
+  // The cells of a tile a peer sent.
+  struct TileUpdate {
+    uint32_t device_id;
+    // Coordinates of the tile, in tiles from the origin of the area frame.
+    int16_t tile[3];
+    uint32_t version;
+    // Centers of the occupied cells, as the xyz array of a TangoXYZij, in
+    // the area frame. Replaces the previous cells of the tile.
+    std::vector<float> points;
+  };
+
+  // An anchor a peer shared, new or moved.
+  struct RemoteAnchor {
+    uint32_t device_id;
+    int id;
+    tango_gl::RigidTransform area_T_anchor;
+  };
+
+  struct Stats {
+    int peer_count;
+    int tile_count;
+    uint64_t tiles_sent;
+    uint64_t tiles_received;
+    uint64_t bytes_sent;
+    uint64_t bytes_received;
+    // Datagrams of peers lost on the way, as gaps of their sequence, and
+    // those the socket did not take.
+    uint64_t lost_datagram_count;
+    uint64_t dropped_datagram_count;
+    // Frames of peers which did not decode, each asking for an intra frame.
+    uint64_t resync_count;
+  };
+
+  // Datagrams of a tile frame at most.
+  static const int kMaxFragmentCount = 32;
+
+  MapSync();
+  ~MapSync();
+  MapSync(const MapSync& other) = delete;
+  MapSync& operator=(const MapSync&) = delete;
+
+  // Forget the map and start sharing it with the peers of
+  // |area_description_uuid| on |port|.
+  //
+  // @return: false if the socket could not be opened.
+  bool Start(const char* area_description_uuid, int port,
+             const Options& options);
+
+  // Stop the thread and close the socket.
+  void Stop();
+
+  bool IsSharing() const { return is_sharing_.load(); }
+
+  // Add the cells of |xyz_ij| to the map, if sharing.
+  //
+  // @param area_T_points: pose of the frame of the points in the area
+  //        description frame, its translation being taken as the position
+  //        of the device.
+  void AddPoints(const TangoXYZij* xyz_ij, const glm::mat4& area_T_points);
+
+  // Share anchor |id| at |area_T_anchor|, again if it moved.
+  void SetAnchor(int id, const tango_gl::RigidTransform& area_T_anchor);
+
+  // Swap the tiles peers sent since the last call into |updates|, the
+  // latest version of each.
+  void TakeRemoteTileUpdates(std::vector<TileUpdate>* updates);
+
+  // Swap the anchors peers shared or moved since the last call into
+  // |anchors|.
+  void TakeRemoteAnchors(std::vector<RemoteAnchor>* anchors);
+
+  // @return: the random id of the device in the datagrams of this Start().
+  uint32_t GetDeviceId() const { return device_id_; }
+
+  Stats GetStats() const;
+
+ private:
+  struct TileKey {
+    int16_t x;
+    int16_t y;
+    int16_t z;
+
+    bool operator<(const TileKey& other) const {
+      if (x != other.x) {
+        return x < other.x;
+      }
+      if (y != other.y) {
+        return y < other.y;
+      }
+      return z < other.z;
+    }
+    bool operator==(const TileKey& other) const {
+      return x == other.x && y == other.y && z == other.z;
+    }
+  };
+
+  struct LocalTile {
+    // Index of the cells in the tile, (x * n + y) * n + z for n cells per
+    // axis.
+    std::unordered_set<uint32_t> cells;
+    uint32_t version;
+    uint32_t sent_version;
+    // The peer the tile is sent again for, 0 for the nearest.
+    uint32_t requested_by;
+    // Only used by the sync thread. The tiles are only erased by Start(), so
+    // it is used outside of the lock.
+    std::unique_ptr<PointCloudEncoder> encoder;
+  };
+
+  // The frames of a tile of a peer, put together and decoded.
+  struct RemoteTile {
+    PointCloudDecoder decoder;
+    bool has_version;
+    uint32_t decoded_version;
+    // The frame being put together, and its fragments received.
+    uint32_t version;
+    uint32_t fragment_mask;
+    std::vector<uint8_t> frame;
+    std::chrono::steady_clock::time_point resync_time;
+  };
+
+  struct Peer {
+    glm::vec3 position;
+    std::chrono::steady_clock::time_point hello_time;
+    uint32_t next_sequence;
+    std::map<TileKey, std::unique_ptr<RemoteTile>> tiles;
+    std::map<int, tango_gl::RigidTransform> anchors;
+  };
+
+  // A changed tile, and its distance to the peers.
+  struct TileToSend {
+    TileKey key;
+    float distance;
+  };
+
+  // Sync thread.
+  void SyncLoop();
+  void Receive(const uint8_t* data, size_t size);
+  void ReceiveHello(uint32_t device_id, uint32_t sequence,
+                    const uint8_t* data, size_t size);
+  void ReceiveTile(uint32_t device_id, Peer* peer, const uint8_t* data,
+                   size_t size);
+  void ReceiveResync(uint32_t device_id, const uint8_t* data, size_t size);
+  void ReceiveAnchors(uint32_t device_id, Peer* peer, const uint8_t* data,
+                      size_t size);
+  void ForgetSilentPeers();
+  void SendHello();
+  void SendAnchors();
+  // Send the changed tiles the budget allows, nearest to a peer first.
+  void SendTiles();
+  void SendTile(const TileKey& key);
+  void SendResync(uint32_t device_id, const TileKey& key);
+  // Send a datagram of message |type| followed by |size| bytes of |payload|.
+  void Send(uint8_t type, const uint8_t* payload, size_t size);
+  // Add the tokens of the time since the last call.
+  void RefillTokens();
+
+  TileKey GetTileKey(const glm::ivec3& cell) const;
+  // Send |tile| again as an intra frame, sooner for |device_id|. Must be
+  // called with |local_mutex_| held.
+  void ResendTile(uint32_t device_id, LocalTile* tile);
+
+  std::atomic<bool> is_sharing_;
+  int socket_;
+  int port_;
+  Options options_;
+  int cells_per_tile_;
+  uint32_t device_id_;
+  uint32_t area_description_hash_;
+
+  // The local map and anchors, written by AddPoints() and SetAnchor().
+  std::mutex local_mutex_;
+  std::map<TileKey, LocalTile> local_tiles_;
+  std::map<int, tango_gl::RigidTransform> local_anchors_;
+  bool has_tiles_to_send_;
+  bool has_new_anchor_;
+  glm::vec3 position_;
+
+  // What peers sent, for the Take*() methods.
+  std::mutex remote_mutex_;
+  std::map<std::pair<uint32_t, TileKey>, TileUpdate> tile_updates_;
+  std::vector<RemoteAnchor> remote_anchors_;
+
+  // Only used by the sync thread. The tiles are sent in the order of
+  // |tiles_to_send_|, sorted again when more changed.
+  std::map<uint32_t, Peer> peers_;
+  std::vector<TileToSend> tiles_to_send_;
+  size_t next_tile_to_send_;
+  std::chrono::steady_clock::time_point sort_time_;
+  std::vector<float> tile_points_;
+  std::vector<uint8_t> frame_;
+  std::vector<uint8_t> payload_;
+  std::vector<uint8_t> received_;
+  std::vector<float> decoded_points_;
+  uint32_t sequence_;
+  double tokens_;
+  std::chrono::steady_clock::time_point token_time_;
+  std::chrono::steady_clock::time_point hello_time_;
+  std::chrono::steady_clock::time_point anchor_time_;
+
+  std::atomic<int> peer_count_;
+  std::atomic<int> tile_count_;
+  std::atomic<uint64_t> tiles_sent_;
+  std::atomic<uint64_t> tiles_received_;
+  std::atomic<uint64_t> bytes_sent_;
+  std::atomic<uint64_t> bytes_received_;
+  std::atomic<uint64_t> lost_datagram_count_;
+  std::atomic<uint64_t> dropped_datagram_count_;
+  std::atomic<uint64_t> resync_count_;
+
+  std::thread thread_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_MAP_SYNC_H_
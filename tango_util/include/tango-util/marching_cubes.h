@@ -0,0 +1,44 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_MARCHING_CUBES_H_
+#define TANGO_UTIL_MARCHING_CUBES_H_
+
+#include <stdint.h>
+
+namespace tango_util {
+// Tables of the marching cubes isosurface extraction.
+//
+// Corner i of a cube is at (i & 1, (i >> 1) & 1, (i >> 2) & 1). Edge e joins
+// the corners kEdgeCorners[e]: edges 0 to 3 run along x, 4 to 7 along y and
+// 8 to 11 along z. The configuration of a cube is the mask of its corners
+// inside the surface, whose signed distance is negative.
+namespace marching_cubes {
+
+const int kEdgeCount = 12;
+const int kMaxTriangleCount = 5;
+
+extern const int kEdgeCorners[kEdgeCount][2];
+
+// @return: the triangles of a cube configuration, as kMaxTriangleCount
+//          triplets of edge indices where the triangle vertices lie,
+//          terminated by -1. Triangles are counterclockwise seen from the
+//          outside of the surface.
+const int8_t* GetTriangles(uint8_t configuration);
+}  // namespace marching_cubes
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_MARCHING_CUBES_H_
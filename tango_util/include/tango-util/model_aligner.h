@@ -0,0 +1,176 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_MODEL_ALIGNER_H_
+#define TANGO_UTIL_MODEL_ALIGNER_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <tango-gl/util.h>
+
+#include "tango-util/point_cloud_map.h"
+#include "tango-util/worker_pool.h"
+
+namespace tango_util {
+
+// Find the similarity transformation, rotation, translation and uniform
+// scale, taking |model_points| closest to their |world_points|, with
+// TangoSupport_findCorrespondenceSimilarityTransform. At least three
+// non-collinear pairs are needed for a unique transformation, e.g. points
+// tapped on a model and on the scene.
+//
+// @return false if the transformation could not be found.
+bool FindSimilarityTransform(const std::vector<glm::vec3>& model_points,
+                             const std::vector<glm::vec3>& world_points,
+                             glm::mat4* world_T_model);
+
+// ModelAligner registers a model, e.g. a CAD model loaded from an OBJ file,
+// to points of the scene such as those of a PointCloudMap, by ICP with a
+// similarity transformation.
+//
+// The model surface is sampled once, by SetModel(), and the samples indexed
+// in a hash grid of max_correspondence_distance cells, so the closest sample
+// of a scene point is found by looking only at the 27 cells around it. The
+// iterations run on a thread of the aligner, each searching the
+// correspondences of the scene points in parallel on a WorkerPool and
+// solving for the transformation with FindSimilarityTransform(). They stop
+// once the error no longer decreases, or at the time budget.
+//
+//   aligner_.LoadModel("/sdcard/part.obj");
+//   FindSimilarityTransform(tapped_model_points, tapped_world_points,
+//                           &world_T_model);
+//   std::vector<glm::vec3> scene_points;
+//   GetMapPoints(*map, kMaxScenePoints, &scene_points);
+//   aligner_.Start(&scene_points, world_T_model);
+//   ...
+//   ModelAligner::Result result;
+//   if (!aligner_.IsRunning() && aligner_.GetResult(&result)) {
+//     ...
+//   }
+//
+// SetModel(), Start() and Cancel() must be called from one thread at a time.
+class ModelAligner {
+ public:
+  struct Options {
+    Options();
+
+    // Spacing of the samples of the model surface, in model units. It grows
+    // for models too large for max_sample_count samples.
+    float sample_spacing;
+    int max_sample_count;
+    // Pairs of a scene point and a model sample farther apart than this, in
+    // model units, are not correspondences. Also the cell size of the index.
+    float max_correspondence_distance;
+    int max_iteration_count;
+    // Stop once the RMS error decreases by less than this ratio.
+    float convergence_ratio;
+    // Time after which the iterations stop, in seconds.
+    double time_budget;
+    // Threads searching correspondences besides the aligner thread.
+    int thread_count;
+  };
+
+  struct Result {
+    glm::mat4 world_T_model;
+    // RMS distance of the correspondences of the last iteration, in meters.
+    float rms_error;
+    int correspondence_count;
+    int iteration_count;
+    // Duration of the alignment, in seconds.
+    double time;
+    bool is_converged;
+  };
+
+  explicit ModelAligner(const Options& options);
+  // Cancels the alignment in progress.
+  ~ModelAligner();
+  ModelAligner(const ModelAligner& other) = delete;
+  ModelAligner& operator=(const ModelAligner&) = delete;
+
+  // Sample and index the surface of a triangle mesh, xyz vertices and three
+  // indices per triangle. Cancels the alignment in progress.
+  void SetModel(const std::vector<GLfloat>& vertices,
+                const std::vector<GLuint>& indices);
+
+  // SetModel() with the mesh of a Wavefront OBJ file.
+  //
+  // @return false if the file could not be loaded.
+  bool LoadModel(const char* path);
+
+  size_t GetSampleCount() const { return samples_.size(); }
+
+  // Start aligning the model to |scene_points|, in the world frame, from
+  // |initial_world_T_model|. The points are swapped out of |scene_points|.
+  //
+  // @return false if there is no model or an alignment is in progress.
+  bool Start(std::vector<glm::vec3>* scene_points,
+             const glm::mat4& initial_world_T_model);
+
+  // Stop the alignment in progress, which keeps the result of its last
+  // iteration.
+  void Cancel();
+
+  bool IsRunning() const { return is_running_.load(); }
+
+  // @return false if no alignment finished or was cancelled since SetModel().
+  bool GetResult(Result* result) const;
+
+ private:
+  // Aligner thread.
+  void Align(glm::mat4 world_T_model);
+
+  // @return the key of the index cell at |cell|.
+  static uint64_t GetCellKey(const glm::ivec3& cell);
+
+  // @return the index of the sample closest to |point| within
+  //         max_correspondence_distance, -1 if there is none.
+  int FindClosestSample(const glm::vec3& point) const;
+
+  Options options_;
+  WorkerPool worker_pool_;
+
+  // Samples of the model surface sorted by cell, and the first sample and
+  // sample count of every cell that has some.
+  std::vector<glm::vec3> samples_;
+  std::unordered_map<uint64_t, std::pair<uint32_t, uint32_t>> cells_;
+  float inverse_cell_size_;
+
+  // Only used by the aligner thread.
+  std::vector<glm::vec3> scene_points_;
+  std::vector<int> correspondences_;
+
+  std::atomic<bool> is_running_;
+  std::atomic<bool> is_cancelled_;
+  std::thread aligner_;
+
+  mutable std::mutex result_mutex_;
+  Result result_;
+  bool has_result_;
+};
+
+// Gather at most |max_count| of the occupied voxels of |map|, evenly spread
+// over them, e.g. as the scene points of ModelAligner::Start().
+void GetMapPoints(const PointCloudMap& map, size_t max_count,
+                  std::vector<glm::vec3>* points);
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_MODEL_ALIGNER_H_
@@ -0,0 +1,165 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_NETWORK_STREAMER_H_
+#define TANGO_UTIL_NETWORK_STREAMER_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <tango_client_api.h>  // NOLINT
+
+#include "tango-util/session_log.h"
+#include "tango-util/slot_ring.h"
+
+namespace tango_util {
+
+// NetworkStreamer sends the poses and the point clouds of an app over UDP, to
+// watch a device from a desktop viewer.
+//
+// Every datagram is a session log chunk, see session_log.h, so a viewer
+// decodes them as it reads a log: a ChunkHeader followed by its records.
+// Poses are sent at their full rate, batched every few milliseconds into one
+// chunk of delta coded PoseRecords. Point clouds are throttled to
+// Options::point_cloud_interval and sent as chunks of a single
+// PointCloudRecord, each holding a slice of the cloud small enough for one
+// datagram. The slices of a cloud share its timestamp, and a lost datagram
+// only loses its slice.
+//
+// As with SessionRecorder, a callback only copies its data into a slot of a
+// preallocated SlotRing. The sender thread quantizes the slots in place into
+// the datagrams, and the socket never blocks: when the rings are full or the
+// socket buffer is, the data is dropped rather than stalling a callback.
+//
+//   streamer_.Start("192.168.1.10", 7500,
+//                   tango_util::NetworkStreamer::Options());
+//   ...
+//   // In the Tango callbacks.
+//   streamer_.OnPoseAvailable(pose);
+//   streamer_.OnXYZijAvailable(xyz_ij);
+//
+// Each On*Available() method must only be called from one thread at a time,
+// which is what the Tango callbacks do.
+class NetworkStreamer {
+ public:
+  struct Options {
+    Options();
+
+    // The maximum number of points in a point cloud, usually the
+    // max_point_cloud_elements of the Tango config.
+    int max_point_count;
+    // Units per meter of the 16 bit point coordinates.
+    float point_scale;
+    // Minimum time between two point clouds sent, in seconds.
+    double point_cloud_interval;
+    // Largest datagram sent, by default what fits in an Ethernet or WiFi
+    // frame, so that no datagram is fragmented.
+    size_t max_datagram_size;
+    // Number of records each ring holds before dropping.
+    int pose_slot_count;
+    int point_cloud_slot_count;
+  };
+
+  struct Stats {
+    uint64_t pose_count;
+    uint64_t point_cloud_count;
+    // Records dropped because a ring was full, and datagrams the socket did
+    // not take.
+    uint64_t dropped_count;
+    uint64_t dropped_datagram_count;
+    uint64_t datagram_count;
+    uint64_t bytes_sent;
+    // Over the last second: the bytes sent per second, and the average time
+    // in seconds from a callback to the datagram of its data being sent.
+    float bytes_per_second;
+    float average_latency;
+  };
+
+  NetworkStreamer();
+  ~NetworkStreamer();
+  NetworkStreamer(const NetworkStreamer& other) = delete;
+  NetworkStreamer& operator=(const NetworkStreamer&) = delete;
+
+  // Resolve |host|, which may block on DNS, allocate the rings and start the
+  // sender thread. Must not be called while callbacks may be streamed.
+  bool Start(const char* host, int port, const Options& options);
+
+  // Send the data received so far and close the socket.
+  void Stop();
+
+  bool IsStreaming() const { return is_streaming_.load(); }
+
+  // Copy the data of a callback, if streaming.
+  void OnPoseAvailable(const TangoPoseData* pose);
+  void OnXYZijAvailable(const TangoXYZij* xyz_ij);
+
+  Stats GetStats() const;
+
+ private:
+  // Sender thread.
+  void SendLoop();
+
+  // Send the poses of the ring, as few datagrams as they fit in.
+  void SendPoses();
+  void SendPointCloud(const uint8_t* slot);
+
+  // Send a datagram of |header| followed by the |size| bytes of payload_.
+  void Send(const session_log::ChunkHeader& header, size_t size);
+
+  // Account for the data of a callback at |receive_time| being sent.
+  void AddLatency(int64_t receive_time);
+
+  // Update the per second stats, every second.
+  void UpdateRates();
+
+  std::atomic<bool> is_streaming_;
+  int socket_;
+  Options options_;
+  // Only used by the point cloud callback.
+  double last_point_cloud_timestamp_;
+
+  SlotRing pose_ring_;
+  SlotRing point_cloud_ring_;
+
+  // Only used by the sender thread.
+  std::vector<uint8_t> payload_;
+  double latency_sum_;
+  uint32_t latency_count_;
+  uint64_t rate_bytes_sent_;
+  std::chrono::steady_clock::time_point rate_start_time_;
+
+  std::atomic<uint64_t> pose_count_;
+  std::atomic<uint64_t> point_cloud_count_;
+  std::atomic<uint64_t> dropped_count_;
+  std::atomic<uint64_t> dropped_datagram_count_;
+  std::atomic<uint64_t> datagram_count_;
+  std::atomic<uint64_t> bytes_sent_;
+  std::atomic<float> bytes_per_second_;
+  std::atomic<float> average_latency_;
+
+  std::thread sender_;
+  std::mutex wake_mutex_;
+  std::condition_variable wake_condition_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_NETWORK_STREAMER_H_
@@ -0,0 +1,122 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_NORMAL_ESTIMATOR_H_
+#define TANGO_UTIL_NORMAL_ESTIMATOR_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include <tango_client_api.h>  // NOLINT
+#include <tango-gl/util.h>
+
+#include "tango-util/worker_pool.h"
+
+namespace tango_util {
+
+// NormalEstimator computes a normal for every point of a depth frame from its
+// neighbors in the depth image, rather than by searching for them.
+//
+// The points are laid out on a grid: the ij buffer of the TangoXYZij when
+// the service fills it, and otherwise the points projected with the depth
+// camera intrinsics, several of which may share a cell. Integral images of
+// the point sums and of their products then give the covariance of any
+// window of cells in constant time, and the normal of a point is the
+// smallest eigenvector of the covariance of the window around its cell.
+// Points whose window straddles a depth discontinuity, or has too few
+// points, get a zero normal.
+//
+// The integral images are built and read by rows on a WorkerPool, and every
+// buffer is kept from one frame to the next.
+//
+//   normal_estimator_.SetIntrinsics(depth_camera_intrinsics);
+//   ...
+//   const std::vector<glm::vec3>& normals =
+//       normal_estimator_.Estimate(xyz_ij);
+//
+// Not thread safe, every method must be called from the same thread.
+class NormalEstimator {
+ public:
+  struct Options {
+    Options();
+
+    // Cells of the projected grid per pixel of the depth camera, a grid
+    // smaller than the depth image is faster and smoother.
+    float grid_scale;
+    // The window of a point spans this many cells on each side of its own.
+    int window_radius;
+    // Windows with fewer points give no normal.
+    uint32_t min_point_count;
+    // Windows whose mean depth differs from the one of the point by more
+    // than this ratio of its depth give no normal.
+    float max_depth_change;
+    // Threads besides the one calling Estimate().
+    int thread_count;
+  };
+
+  explicit NormalEstimator(const Options& options);
+  NormalEstimator(const NormalEstimator& other) = delete;
+  NormalEstimator& operator=(const NormalEstimator&) = delete;
+
+  // Set the intrinsics of the depth camera, used to lay out point clouds
+  // without an ij buffer.
+  void SetIntrinsics(const TangoCameraIntrinsics& intrinsics);
+
+  // Estimate the normals of |xyz_ij|.
+  //
+  // @return: one normal per point, in the depth camera frame and facing the
+  //          camera, or zero. Valid until the next call.
+  const std::vector<glm::vec3>& Estimate(const TangoXYZij* xyz_ij);
+
+ private:
+  // Sums of the points of a window, and of their products.
+  struct Moments {
+    double count;
+    double sum[3];
+    // xx, xy, xz, yy, yz, zz.
+    double products[6];
+  };
+
+  // Size the grid, fill cells_ with the cell of every point, kNoCell for
+  // points off the grid, and add the moments of every point to its cell of
+  // integral_.
+  //
+  // @return: false if the points can not be laid out.
+  bool LayOut(const TangoXYZij* xyz_ij);
+
+  // Turn the moments of the cells into their integral image.
+  void IntegrateMoments();
+
+  // @return: the normal of |point| from the window around |cell|.
+  glm::vec3 GetNormal(const glm::vec3& point, uint32_t cell) const;
+
+  Options options_;
+  WorkerPool worker_pool_;
+  TangoCameraIntrinsics intrinsics_;
+  bool has_intrinsics_;
+
+  int grid_width_;
+  int grid_height_;
+  std::vector<uint32_t> cells_;
+  // (grid_width_ + 1) x (grid_height_ + 1), with a zero first row and
+  // column: the sums of the cells above and to the left of each entry.
+  std::vector<Moments> integral_;
+  std::vector<glm::vec3> normals_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_NORMAL_ESTIMATOR_H_
@@ -0,0 +1,211 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_OCCUPANCY_GRID_H_
+#define TANGO_UTIL_OCCUPANCY_GRID_H_
+
+#include <stdint.h>
+
+#include <unordered_map>
+#include <vector>
+
+#include <tango_client_api.h>  // NOLINT
+#include <tango-gl/util.h>
+
+namespace tango_util {
+
+// OccupancyGrid is a 2D floor map of the start of service or area
+// description frame, z up, built incrementally from the depth frames, e.g. to
+// navigate to a GoalMarker.
+//
+//   // For every point cloud.
+//   grid_.Insert(xyz_ij, start_service_T_depth);
+//   if (grid_.GetRevision() != revision) {
+//     revision = grid_.GetRevision();
+//     grid_.GetWindow(device_position, kMapSize, map_pixels);
+//   }
+//
+// Each cell holds the log odds of it being occupied. The points of a frame
+// are classified from their height above the floor: those on it are seen
+// free, those above it up to Options::max_obstacle_height are obstacles. The
+// cells from under the depth camera to each obstacle, along a Bresenham line,
+// are seen free, so an obstacle that moves away is cleared even where the
+// floor is not seen. A cell is updated once per frame however many points or
+// lines fall in it, an obstacle winning over a line through it.
+//
+// The floor height is estimated from the heights of the points below the
+// camera, as the lowest height holding a large share of them, decayed over
+// the frames so that it follows the camera to another floor. No frame is
+// inserted before the floor is found.
+//
+// The cells are stored in tiles of kTileSize^2, allocated as the frames reach
+// them, so a frame only touches the tiles around the camera and the memory
+// follows the area explored rather than its bounds.
+//
+// A cell is blocked, for a PathPlanner, from kBlockedLogOdds up. The cells
+// whose blocked state changes are listed for the planner to repair its path
+// around them, see TakeBlockedChanges().
+//
+// Not thread safe, every method must be called from the same thread.
+class OccupancyGrid {
+ public:
+  static const int kTileSize = 32;
+  static const int kTileCells = kTileSize * kTileSize;
+
+  // Log odds of a cell are clamped to [-kMaxLogOdds, kMaxLogOdds].
+  static const int kMaxLogOdds = 40;
+
+  // Log odds from which a cell is blocked, those of two frames seeing it
+  // occupied.
+  static const int kBlockedLogOdds = 12;
+
+  struct Options {
+    Options();
+
+    // Edge length of a cell in meters.
+    float cell_size;
+    // Points farther from the depth camera are ignored, in meters.
+    float max_range;
+    // Distance from the floor within which a point is on the floor, and the
+    // heights above the floor between which it is an obstacle, in meters.
+    float floor_tolerance;
+    float min_obstacle_height;
+    float max_obstacle_height;
+  };
+
+  explicit OccupancyGrid(const Options& options);
+  OccupancyGrid(const OccupancyGrid& other) = delete;
+  OccupancyGrid& operator=(const OccupancyGrid&) = delete;
+
+  // Insert a point cloud frame.
+  //
+  // @param xyz_ij: points in the depth camera frame.
+  // @param world_T_depth: pose of the depth camera at the timestamp of the
+  //        frame, in a frame whose z axis is up.
+  void Insert(const TangoXYZij* xyz_ij, const glm::mat4& world_T_depth);
+
+  // Remove every tile, and forget the floor.
+  void Clear();
+
+  // @return: the cell under (|x|, |y|).
+  glm::ivec2 GetCell(float x, float y) const;
+
+  // @return: the edge length of a cell in meters.
+  float GetCellSize() const { return cell_size_; }
+
+  // @return: whether the floor was found, and its height.
+  bool HasFloor() const { return has_floor_; }
+  float GetFloorHeight() const { return floor_height_; }
+
+  // @return: a number that changes whenever a cell does.
+  uint64_t GetRevision() const { return revision_; }
+
+  size_t GetTileCount() const { return tiles_.size(); }
+
+  // @return: the log odds of the cell under |position|, positive for an
+  //          obstacle, negative for free space, 0 for a cell never seen.
+  int GetLogOdds(const glm::vec2& position) const;
+
+  // @return: whether |cell| is blocked, false for a cell never seen.
+  bool IsBlocked(const glm::ivec2& cell) const;
+
+  // Append the cells that became blocked or free since the previous call to
+  // |cells|, a cell that changed twice possibly listed twice.
+  //
+  // @return: false if the cells were not all listed, too many of them having
+  //          changed or the grid having been cleared since, for the caller
+  //          to start over from the cells themselves.
+  bool TakeBlockedChanges(std::vector<glm::ivec2>* cells);
+
+  // Write the cells of a window of |size|^2 cells centered on |position| as
+  // 8 bit luminance, black for obstacles, white for free space and mid gray
+  // for the cells never seen, e.g. for a GL_LUMINANCE texture.
+  //
+  // @param pixels: |size|^2 bytes, a row per cell along y, the first row on
+  //        the largest y, so that the window is upright when drawn with y up.
+  void GetWindow(const glm::vec2& position, int size, uint8_t* pixels) const;
+
+ private:
+  struct Tile {
+    glm::ivec2 coordinates;
+    // Offset of the cells of the tile in cells_ and stamps_.
+    size_t offset;
+  };
+
+  // Fold the points below the camera into the height histogram, and update
+  // the floor from it.
+  void UpdateFloor(const glm::vec3* points, size_t count, float camera_height);
+
+  // @return: the offset of the cell at |cell| in cells_, allocating its tile
+  //          if needed.
+  size_t GetCellOffset(const glm::ivec2& cell);
+
+  // @return: the offset of the cell at |cell| in cells_, -1 if its tile was
+  //          never allocated.
+  int64_t FindCellOffset(const glm::ivec2& cell) const;
+
+  // Apply |log_odds| to the cell at |offset|, unless it was already updated
+  // in this frame.
+  //
+  // @return: false if it was.
+  bool UpdateCell(size_t offset, int log_odds);
+
+  // Mark the cells from |from| to |to| free, |to| excluded.
+  void TraceLine(const glm::ivec2& from, const glm::ivec2& to);
+
+  // @return: the coordinates of the cell at |offset| in cells_.
+  glm::ivec2 GetCellAt(size_t offset) const;
+
+  float cell_size_;
+  float inverse_cell_size_;
+  float max_range_;
+  float floor_tolerance_;
+  float min_obstacle_height_;
+  float max_obstacle_height_;
+
+  std::unordered_map<uint64_t, uint32_t> tile_indices_;
+  std::vector<Tile> tiles_;
+  // Log odds of the cells of every tile, and the frame each was last updated
+  // in.
+  std::vector<int8_t> cells_;
+  std::vector<uint16_t> stamps_;
+  uint16_t stamp_;
+  uint64_t revision_;
+
+  // Cells whose blocked state changed since TakeBlockedChanges(), and whether
+  // some were dropped, see kMaxBlockedChanges.
+  std::vector<glm::ivec2> blocked_changes_;
+  bool has_dropped_blocked_changes_;
+
+  // Decayed counts of the heights of the points below the camera, over
+  // heights in cells from the origin.
+  std::vector<float> height_histogram_;
+  bool has_floor_;
+  float floor_height_;
+
+  // Per frame scratch, the points in the world frame, and the obstacle cells
+  // the lines are traced to.
+  std::vector<glm::vec3> points_;
+  std::vector<glm::ivec2> line_ends_;
+
+  // Tile of the last cell looked up, -1 for none, as consecutive cells are
+  // mostly in the same tile.
+  uint64_t last_tile_key_;
+  int64_t last_tile_offset_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_OCCUPANCY_GRID_H_
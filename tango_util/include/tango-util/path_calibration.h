@@ -0,0 +1,92 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef TANGO_UTIL_PATH_CALIBRATION_H_
+#define TANGO_UTIL_PATH_CALIBRATION_H_
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace tango_util {
+
+// PathCalibration picks the fastest of a few interchangeable code paths, e.g.
+// the CPU and GPU depth upsampling, by timing each on the device, and keeps
+// the choice in a file so that it is only timed once per device:
+//
+//   // On the thread running the paths, e.g. the GL thread.
+//   calibration.SetStore(files_dir + "/upsample_calibration",
+//                        model + " " + os_build + " " + gl_driver);
+//   int path = calibration.LoadChoice();
+//   if (path < 0) {
+//     path = calibration.Calibrate({run_cpu_path, run_gpu_path});
+//   }
+//
+// The choice is only valid for the key it was stored with, so a key holding
+// the OS build and driver versions times the paths again after an update.
+// Each path runs Options::warmup_runs times untimed, for the caches, shaders
+// and buffers to settle, then Options::timed_runs times, and is rated by the
+// median of the runs. A path must wait for its work to finish, e.g. with
+// glFinish(), for its time to be meaningful.
+//
+// Not thread safe.
+class PathCalibration {
+ public:
+  typedef std::function<void()> Path;
+
+  struct Options {
+    Options();
+
+    // Runs of each path before and while it is timed.
+    int warmup_runs;
+    int timed_runs;
+  };
+
+  explicit PathCalibration(const Options& options);
+  PathCalibration(const PathCalibration& other) = delete;
+  PathCalibration& operator=(const PathCalibration&) = delete;
+
+  // Keep the choice in the file at |path|, for the device described by
+  // |key|.
+  void SetStore(const std::string& path, const std::string& key);
+
+  // @return: the index of the path stored for the key, -1 if there is none
+  //          or it was stored for another key.
+  int LoadChoice() const;
+
+  // Time every path of |paths| and store the index of the fastest, unless no
+  // store was set.
+  //
+  // @return: the index of the fastest path, -1 if |paths| is empty.
+  int Calibrate(const std::vector<Path>& paths);
+
+  // @return: the median time of each path of the last Calibrate(), in
+  //          milliseconds.
+  const std::vector<double>& GetTimes() const { return times_; }
+
+ private:
+  bool StoreChoice(int choice) const;
+
+  int warmup_runs_;
+  int timed_runs_;
+  std::string path_;
+  std::string key_;
+  std::vector<double> times_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_PATH_CALIBRATION_H_
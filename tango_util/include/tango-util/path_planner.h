@@ -0,0 +1,210 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_PATH_PLANNER_H_
+#define TANGO_UTIL_PATH_PLANNER_H_
+
+#include <stdint.h>
+
+#include <queue>
+#include <vector>
+
+#include <tango-gl/util.h>
+#include <tango-util/occupancy_grid.h>
+
+namespace tango_util {
+
+// PathPlanner keeps the shortest path over the cells of an OccupancyGrid from
+// the device to a goal, e.g. a GoalMarker, repaired as the device moves and
+// the cells change instead of planned again from scratch.
+//
+//   PathPlanner planner(&grid, PathPlanner::Options());
+//   planner.SetGoal(grid.GetCell(goal.x, goal.y));
+//   // For every frame, once the grid was updated.
+//   if (!grid.TakeBlockedChanges(&changed_cells)) {
+//     planner.Restart();
+//   }
+//   planner.Update(grid.GetCell(device.x, device.y), changed_cells);
+//   changed_cells.clear();
+//   if (planner.GetRevision() != revision) {
+//     revision = planner.GetRevision();
+//     // Draw planner.GetPath().
+//   }
+//
+// The search is D* Lite, an A* from the goal to the device whose distances
+// are kept: when cells change, only the distances they affect are updated,
+// and the device moving only offsets the priorities of the queue. The moves
+// are to the 8 neighbors of a cell, diagonals not cutting the corner of a
+// blocked cell. The cells never seen are free, so the path goes through the
+// unknown parts of the map, and is repaired as they are discovered.
+//
+// An update expands at most Options::max_expansions cells, which bounds its
+// time whatever the size of the map. A search that does not finish in one
+// update resumes on the next, the previous path kept until then. The cells
+// are searched in the tiles of the grid covering a square of
+// Options::search_radius around the goal, whose nodes are allocated as the
+// search reaches them.
+//
+// Not thread safe, every method must be called from the thread updating the
+// grid.
+class PathPlanner {
+ public:
+  enum Status {
+    // No goal was set.
+    kNoGoal = 0,
+    // The search did not finish yet, GetPath() is the previous path.
+    kSearching = 1,
+    // GetPath() is the shortest path.
+    kPathFound = 2,
+    // The device can not reach the goal, or is out of the search square.
+    kNoPath = 3
+  };
+
+  struct Options {
+    Options();
+
+    // Cells expanded per update at most.
+    int max_expansions;
+    // Half the edge length of the square around the goal the path is
+    // searched in, in cells.
+    int search_radius;
+  };
+
+  // @param grid: the cells the path is planned over, which must outlive the
+  //        planner.
+  PathPlanner(const OccupancyGrid* grid, const Options& options);
+  PathPlanner(const PathPlanner& other) = delete;
+  PathPlanner& operator=(const PathPlanner&) = delete;
+
+  // Plan to |goal|, starting over unless it is the current goal. The goal is
+  // never blocked, for a marker above an obstacle to be reached.
+  void SetGoal(const glm::ivec2& goal);
+  void ClearGoal();
+
+  // Start the search over, e.g. when the grid changes could not be listed.
+  void Restart();
+
+  // Repair the path from |start| after the cells of |changed_cells| changed
+  // their blocked state, see OccupancyGrid::TakeBlockedChanges().
+  //
+  // @return: the status of the path.
+  Status Update(const glm::ivec2& start,
+                const std::vector<glm::ivec2>& changed_cells);
+
+  Status GetStatus() const { return status_; }
+
+  // @return: the cells from the start to the goal, both included, empty
+  //          until a path was found.
+  const std::vector<glm::ivec2>& GetPath() const { return path_; }
+
+  // @return: a number that changes whenever the path does.
+  uint64_t GetRevision() const { return revision_; }
+
+ private:
+  struct Node {
+    // Distance to the goal, and its one step lookahead from the neighbors.
+    float g;
+    float rhs;
+    // Priority the node is queued with, when is_queued is set.
+    float key[2];
+    bool is_queued;
+    bool is_blocked;
+  };
+
+  struct QueueEntry {
+    float key[2];
+    int32_t node;
+  };
+
+  struct QueueEntryGreater {
+    bool operator()(const QueueEntry& a, const QueueEntry& b) const {
+      return a.key[0] > b.key[0] ||
+             (a.key[0] == b.key[0] && a.key[1] > b.key[1]);
+    }
+  };
+
+  typedef std::priority_queue<QueueEntry, std::vector<QueueEntry>,
+                              QueueEntryGreater> Queue;
+
+  // @return: the index of the node of |cell| in nodes_, allocating its tile
+  //          if needed, -1 out of the search square.
+  int32_t GetNode(const glm::ivec2& cell);
+
+  // As GetNode(), -1 for a cell of a tile not allocated.
+  int32_t FindNode(const glm::ivec2& cell) const;
+
+  glm::ivec2 GetNodeCell(int32_t node) const;
+
+  // @return: the cost of the move from |cell| to its neighbor |cell| +
+  //          |step|, infinite if it is blocked.
+  float GetCost(const glm::ivec2& cell, const glm::ivec2& step);
+  bool IsBlocked(const glm::ivec2& cell);
+
+  // @return: the smallest cost to the goal of a move to a neighbor of
+  //          |cell|, and the neighbor in |best| if not null.
+  float GetBestNeighbor(const glm::ivec2& cell, glm::ivec2* best);
+
+  // Queue the node of |cell| with its priority if it is inconsistent, dequeue
+  // it otherwise.
+  void UpdateNode(int32_t node, const glm::ivec2& cell);
+  void ComputeKey(const Node& node, const glm::ivec2& cell, float key[2]) const;
+
+  // Expand the nodes until the distance of the start is known.
+  //
+  // @return: false if the expansion budget ran out before.
+  bool ComputeShortestPath();
+
+  // Apply the change of the blocked state of |cell|.
+  void ApplyChange(const glm::ivec2& cell);
+
+  // Follow the distances from the start to the goal into path_.
+  //
+  // @return: false if the goal is not reachable.
+  bool ExtractPath();
+
+  const OccupancyGrid* grid_;
+  int max_expansions_;
+  int search_radius_;
+
+  bool has_goal_;
+  glm::ivec2 goal_;
+  glm::ivec2 start_;
+  // Start the keys were computed from, and the heuristic offset keeping the
+  // queued keys valid as the start moves.
+  glm::ivec2 last_start_;
+  float key_modifier_;
+  Status status_;
+
+  // The search square, in tiles of OccupancyGrid::kTileSize^2 cells, and the
+  // index in nodes_ of the first node of each, -1 for a tile not allocated.
+  glm::ivec2 tile_origin_;
+  int tiles_per_side_;
+  std::vector<int32_t> tile_offsets_;
+  // Tile of each kTileCells nodes of nodes_.
+  std::vector<glm::ivec2> node_tiles_;
+  std::vector<Node> nodes_;
+  Queue queue_;
+
+  // Whether the distances or the start changed since the path was extracted,
+  // the path, and the one being extracted.
+  bool is_path_stale_;
+  std::vector<glm::ivec2> path_;
+  std::vector<glm::ivec2> next_path_;
+  uint64_t revision_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_PATH_PLANNER_H_
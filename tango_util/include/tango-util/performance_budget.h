@@ -0,0 +1,115 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_PERFORMANCE_BUDGET_H_
+#define TANGO_UTIL_PERFORMANCE_BUDGET_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include <tango-gl/memory_accounting.h>
+#include <tango-gl/tracing.h>
+
+namespace tango_util {
+
+// PerformanceBudget checks a run of a pipeline against the latency of its
+// stages and the memory it allocates, so that a regression of a hot path
+// fails a benchmark rather than going unnoticed. The stages are the trace
+// slices of tango_gl/tracing.h, and the memory is that of
+// tango_gl/memory_accounting.h.
+//
+// A run replays a canonical session, e.g. a tango_mock scenario, or a
+// recorded one through SessionPlayer, with tracing recording:
+//
+//   tango_util::PerformanceBudget budget(0.1);
+//   budget.SetStageBudget("PointCloudApp::OnXYZijAvailable", 2.0, 4.0);
+//   budget.SetMemoryBudget(tango_gl::kMemoryTagVertexBuffer,
+//                          tango_gl::kMemoryGpu, 8 << 20, 16);
+//
+//   tango_gl::ResetMemoryPeaks();
+//   tango_gl::tracing::Start();
+//   ... replay the session ...
+//   tango_gl::tracing::Stop();
+//
+//   std::string report;
+//   if (!budget.Check(tango_gl::tracing::GetSliceStatistics(), &report)) {
+//     LOGE("Over budget: %s", report.c_str());
+//   }
+//
+// A measure fails when it is more than |tolerance| above its budget, e.g.
+// 10% for 0.1, to leave room for the noise between runs.
+class PerformanceBudget {
+ public:
+  explicit PerformanceBudget(double tolerance);
+  PerformanceBudget(const PerformanceBudget& other) = delete;
+  PerformanceBudget& operator=(const PerformanceBudget&) = delete;
+
+  // Budget the slices named |stage|: their 95th percentile and longest
+  // duration in milliseconds, 0 for no budget.
+  //
+  // @param stage: name of the slices, which must outlive the budget.
+  void SetStageBudget(const char* stage, double percentile_95_ms,
+                      double max_ms);
+
+  // Budget the memory of |tag| in |domain|: its peak bytes and the accounts
+  // that hold memory at the end of the run, 0 for no budget.
+  void SetMemoryBudget(tango_gl::MemoryTag tag, tango_gl::MemoryDomain domain,
+                       int64_t peak_bytes, int32_t allocation_count);
+
+  // Check the stages of a run and the memory accounted right now.
+  //
+  // @param stages: statistics of the slices of the run.
+  // @param report: if not NULL, set to the measures and their budgets as a
+  //                JSON object, e.g. {"passed":false,"checks":[{"name":
+  //                "Render","measure":"max_ms","value":5.31,"budget":4.00,
+  //                "passed":false},...]}.
+  //
+  // @return false if any measure is over its budget, or a budgeted stage was
+  //         not run at all.
+  bool Check(const std::vector<tango_gl::tracing::SliceStatistics>& stages,
+             std::string* report) const;
+
+ private:
+  struct StageBudget {
+    const char* stage;
+    double percentile_95_ms;
+    double max_ms;
+  };
+
+  struct MemoryBudget {
+    tango_gl::MemoryTag tag;
+    tango_gl::MemoryDomain domain;
+    int64_t peak_bytes;
+    int32_t allocation_count;
+  };
+
+  // Check |value| against |budget|, appending the check to |report|.
+  bool CheckMeasure(const char* name, const char* measure, double value,
+                    double budget, std::string* report) const;
+
+  // Append a check as a JSON object to the comma separated |report|.
+  static void AppendCheck(const char* name, const char* measure, double value,
+                          double budget, bool is_passed, std::string* report);
+
+  double tolerance_;
+  std::vector<StageBudget> stage_budgets_;
+  std::vector<MemoryBudget> memory_budgets_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_PERFORMANCE_BUDGET_H_
@@ -0,0 +1,92 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_PERFORMANCE_HINT_H_
+#define TANGO_UTIL_PERFORMANCE_HINT_H_
+
+#include <stdint.h>
+
+#include <mutex>
+#include <vector>
+
+namespace tango_util {
+
+// PerformanceHintSession tells Android's Dynamic Performance Framework how
+// long the work of a group of threads took each cycle, e.g. each frame, and
+// how long it should take, so that the CPU clocks of the group are raised
+// just enough to meet the target and let drop when there is slack:
+//
+//   render_hint_.SetTargetDuration(kFrameBudget);
+//   ...
+//   // On the GL thread, every frame.
+//   render_hint_.AddCurrentThread();
+//   ... render ...
+//   render_hint_.ReportActualDuration(frame_time);
+//
+// QualityGovernor, FramePipeline and CallbackDispatcher report the work of
+// their thread to the session they are given.
+//
+// The APerformanceHint functions are looked up in libandroid.so at run
+// time, the platform the examples build for predating them. Before Android
+// 13, or on devices without hint support, the session does nothing. The
+// session is opened on the first report once it has a target and a thread,
+// and opened again when threads are added. Can be called from any thread.
+class PerformanceHintSession {
+ public:
+  // @param name: name of the group of threads, for logging, which must
+  //        outlive the session.
+  explicit PerformanceHintSession(const char* name);
+  ~PerformanceHintSession();
+  PerformanceHintSession(const PerformanceHintSession& other) = delete;
+  PerformanceHintSession& operator=(const PerformanceHintSession&) = delete;
+
+  // @return: whether the platform has the APerformanceHint functions.
+  static bool IsSupported();
+
+  // Set how long the work of a cycle should take, in milliseconds.
+  void SetTargetDuration(double target_duration);
+
+  // Add the calling thread to the group, if it is not in it already.
+  void AddCurrentThread();
+
+  // Report how long the work of the last cycle took, in milliseconds.
+  void ReportActualDuration(double duration);
+
+  // @return: whether the framework accepted the session.
+  bool IsOpen() const;
+
+ private:
+  // Open the session for thread_ids_, or update its threads.
+  //
+  // @return: false if the framework refused it.
+  bool OpenLocked();
+  void CloseLocked();
+
+  const char* name_;
+  mutable std::mutex mutex_;
+  std::vector<int32_t> thread_ids_;
+  int64_t target_duration_ns_;
+  // The APerformanceHintSession, null when closed.
+  void* session_;
+  // Whether thread_ids_ or the target changed since the session was opened,
+  // and whether the framework refused it, not to retry every cycle.
+  bool are_threads_changed_;
+  bool is_target_changed_;
+  bool is_refused_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_PERFORMANCE_HINT_H_
@@ -0,0 +1,148 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_PLANE_DETECTOR_H_
+#define TANGO_UTIL_PLANE_DETECTOR_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include <tango_client_api.h>  // NOLINT
+#include <tango-gl/util.h>
+
+#include "tango-util/worker_pool.h"
+
+namespace tango_util {
+// A plane found in a point cloud.
+struct DetectedPlane {
+  // Unit normal and offset, dot(normal, p) + offset = 0 on the plane. The
+  // normal points to the side the points were seen from.
+  glm::vec4 equation;
+  // Centroid of the inliers.
+  glm::vec3 centroid;
+  // Orthonormal basis of the plane, and the extent of the inliers along it
+  // around the centroid, leaving out the farthest few.
+  glm::vec3 tangent;
+  glm::vec3 bitangent;
+  glm::vec2 min_extent;
+  glm::vec2 max_extent;
+  // Convex hull of the inliers in the same coordinates, clamped to the
+  // extent, see ComputeConvexHull().
+  std::vector<glm::vec2> hull;
+  uint32_t inlier_count;
+};
+
+// Fill the two vectors orthogonal to |normal| of a DetectedPlane basis, the
+// tangent kept horizontal in frames with z up, e.g. the start of service
+// frame, unless the plane is horizontal.
+void GetPlaneBasis(const glm::vec3& normal, glm::vec3* tangent,
+                   glm::vec3* bitangent);
+
+// @return the unit eigenvector of the smallest eigenvalue of a symmetric
+// matrix, e.g. the normal of the plane fitting points of a covariance.
+glm::vec3 GetSmallestEigenvector(const glm::mat3& symmetric);
+
+// PlaneDetector finds the dominant planes of a point cloud with RANSAC.
+//
+// The planes are found one after the other, each among the points left by
+// the previous ones. For each plane, the hypotheses are drawn in parallel on
+// a WorkerPool, and no more are drawn once enough have been tried to find the
+// best plane with the configured confidence, given the inlier ratio of the
+// best so far. The best hypothesis is then refined by a least squares fit of
+// its inliers.
+//
+// Not thread safe, Detect() must be called from one thread at a time.
+class PlaneDetector {
+ public:
+  struct Options {
+    Options();
+
+    // Maximum distance of an inlier to its plane, in meters.
+    float inlier_distance;
+    // Planes with fewer inliers are not reported.
+    uint32_t min_inlier_count;
+    // Maximum number of planes found per point cloud.
+    int max_plane_count;
+    // Maximum number of hypotheses per plane.
+    int max_iteration_count;
+    // Minimum cosine of the angle between the normal of an inlier and its
+    // plane, when Detect() is given normals.
+    float min_normal_cosine;
+    // Probability of drawing at least one all-inlier hypothesis, from which
+    // the number of hypotheses is derived.
+    float confidence;
+    // Threads drawing hypotheses besides the one calling Detect().
+    int thread_count;
+  };
+
+  explicit PlaneDetector(const Options& options);
+  PlaneDetector(const PlaneDetector& other) = delete;
+  PlaneDetector& operator=(const PlaneDetector&) = delete;
+
+  // Find the planes of a point cloud.
+  //
+  // @param xyz_ij: points in the depth camera frame.
+  // @param frame_T_depth: transformation of the points into the frame of the
+  //        planes, e.g. the start of service frame.
+  // @param planes: receives the planes, by decreasing inlier count.
+  void Detect(const TangoXYZij* xyz_ij, const glm::mat4& frame_T_depth,
+              std::vector<DetectedPlane>* planes);
+
+  // Find the planes of a point cloud with normals, e.g. those of a
+  // NormalEstimator. The inliers of a plane must also have a normal within
+  // the configured angle of its own, so that distinct surfaces meeting at an
+  // edge are not mistaken for one plane. Points with a zero normal are
+  // judged by their distance only.
+  //
+  // @param normals: one per point of |xyz_ij|, in the depth camera frame,
+  //        or nullptr.
+  void Detect(const TangoXYZij* xyz_ij, const glm::vec3* normals,
+              const glm::mat4& frame_T_depth,
+              std::vector<DetectedPlane>* planes);
+
+ private:
+  // Find the best plane among the points listed in remaining_.
+  //
+  // @return: false if no plane has enough inliers.
+  bool FindPlane(const glm::vec3& viewpoint, DetectedPlane* plane);
+
+  // Least squares plane through the points listed in inliers_.
+  glm::vec4 FitPlane(glm::vec3* centroid) const;
+
+  // @return: true if the point |index| is within the inlier distance of
+  //          |equation|, with a normal agreeing with it if it has one.
+  bool IsInlier(const glm::vec4& equation, uint32_t index) const;
+
+  // Fill inliers_ with the inliers of |equation| among remaining_.
+  void CollectInliers(const glm::vec4& equation);
+
+  Options options_;
+  WorkerPool worker_pool_;
+
+  // Transformed points and normals, the latter empty without normals, and
+  // the indices of the points not assigned to a plane yet.
+  std::vector<glm::vec3> points_;
+  std::vector<glm::vec3> normals_;
+  std::vector<uint32_t> remaining_;
+  std::vector<uint32_t> inliers_;
+  std::vector<float> coordinates_;
+  std::vector<glm::vec2> hull_;
+  uint32_t frame_count_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_PLANE_DETECTOR_H_
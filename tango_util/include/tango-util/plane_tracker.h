@@ -0,0 +1,119 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_PLANE_TRACKER_H_
+#define TANGO_UTIL_PLANE_TRACKER_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include <tango-gl/util.h>
+
+#include "tango-util/plane_detector.h"
+
+namespace tango_util {
+// A plane followed across point clouds.
+struct TrackedPlane {
+  // Unique for the lifetime of the tracker.
+  int id;
+  // Running estimate of the plane. Its extent and hull cover every
+  // observation, the hull simplified to PlaneTracker::kMaxHullVertexCount
+  // vertices.
+  DetectedPlane plane;
+  // Inliers of every observation.
+  uint64_t total_inlier_count;
+  // Number of point clouds the plane was found in.
+  int observation_count;
+  // Number of point clouds since it was last found.
+  int missed_count;
+};
+
+// PlaneTracker matches the planes detected in successive point clouds of a
+// fixed frame, e.g. the start of service frame, into tracked planes.
+//
+// A detected plane matches the closest tracked plane with a similar normal
+// and offset whose extent it touches, which is then updated with a running
+// average and extended; detected planes matching none start new tracked
+// planes. Planes not found for a while are dropped, unless they were seen
+// often enough to be confirmed and are only out of view.
+//
+// The hull of a tracked plane is merged with the hull of each detection,
+// rather than computed again from every inlier seen, so an update costs the
+// hull of the new inliers and stays the same over a long session. The
+// confirmed planes are a map of the surfaces around the device, which taps
+// can be hit-tested against with Raycast() instead of fitting a plane.
+//
+// Not thread safe.
+class PlaneTracker {
+ public:
+  // Vertices of the hull of a tracked plane at most.
+  static const size_t kMaxHullVertexCount = 64;
+
+  struct Options {
+    Options();
+
+    // Maximum angle between the normals of matching planes, in radians.
+    float max_normal_angle;
+    // Maximum distance of a detected centroid to a matching plane, in meters.
+    float max_offset;
+    // Maximum distance between the extents of a detected plane and a
+    // matching one, in meters, so that apart surfaces of a plane, e.g. two
+    // tables of the same height, are kept apart.
+    float max_gap;
+    // Weight of a detection in the running average.
+    float smoothing;
+    // Observations after which a plane is confirmed.
+    int min_observation_count;
+    // Unconfirmed planes are dropped after this many point clouds without
+    // being found.
+    int max_missed_count;
+  };
+
+  explicit PlaneTracker(const Options& options);
+
+  // Match the planes detected in a point cloud.
+  void Update(const std::vector<DetectedPlane>& detected_planes);
+
+  // Remove every plane.
+  void Clear() { planes_.clear(); }
+
+  const std::vector<TrackedPlane>& GetPlanes() const { return planes_; }
+
+  // Copy the planes observed often enough to be reported.
+  void GetConfirmedPlanes(std::vector<TrackedPlane>* planes) const;
+
+  // Intersect a ray with a list of planes, within their hull.
+  //
+  // @param planes: e.g. the confirmed planes.
+  // @param origin, direction: the ray.
+  // @param point: set to the nearest intersection.
+  //
+  // @return: the plane intersected first, nullptr if none is.
+  static const TrackedPlane* Raycast(const std::vector<TrackedPlane>& planes,
+                                     const glm::vec3& origin,
+                                     const glm::vec3& direction,
+                                     glm::vec3* point);
+
+ private:
+  Options options_;
+  float min_normal_cosine_;
+  std::vector<TrackedPlane> planes_;
+  int next_id_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_PLANE_TRACKER_H_
@@ -0,0 +1,136 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_PLY_EXPORTER_H_
+#define TANGO_UTIL_PLY_EXPORTER_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <tango_client_api.h>  // NOLINT
+#include <tango-gl/util.h>
+
+#include "tango-util/point_cloud_map.h"
+
+namespace tango_util {
+
+// PlyExporter writes point clouds and meshes as binary PLY files on a writer
+// thread, so that an export neither stalls the thread that renders or fuses
+// them nor needs a second copy of what it writes.
+//
+// The geometry is walked on the writer thread and written through one
+// buffer of kBufferSize bytes. The map and the meshes are not copied: they
+// must not change until IsBusy() returns false, which the apps ensure by
+// pausing accumulation or fusion during an export. A single point cloud is
+// small and is copied, since the Tango buffers are only valid during their
+// callback.
+//
+//   // On the thread that updates the map, once per frame.
+//   if (!exporter_.IsBusy()) {
+//     point_cloud_map_->Insert(...);
+//   }
+//   ...
+//   exporter_.ExportPointCloudMap(path, point_cloud_map_.get());
+//
+// Only one export runs at a time. The files are little endian, which every
+// Tango device is, with float coordinates in meters.
+class PlyExporter {
+ public:
+  // Size of the buffer the writer thread encodes into before writing.
+  static const size_t kBufferSize = 256 * 1024;
+
+  struct Stats {
+    uint32_t export_count;
+    uint32_t failed_count;
+    uint64_t bytes_written;
+    // Duration of the last export, in seconds.
+    double last_export_time;
+  };
+
+  PlyExporter();
+  // Waits for the export in progress.
+  ~PlyExporter();
+  PlyExporter(const PlyExporter& other) = delete;
+  PlyExporter& operator=(const PlyExporter&) = delete;
+
+  // Write the points of |xyz_ij| in the frame of |world_T_depth|, copied
+  // before returning.
+  //
+  // @return false if an export is in progress.
+  bool ExportPointCloud(const char* path, const TangoXYZij* xyz_ij,
+                        const glm::mat4& world_T_depth);
+
+  // Write every voxel of |map| as a point of its weight, as the float
+  // "confidence" property. |map| must not change until the export is done.
+  //
+  // @return false if an export is in progress.
+  bool ExportPointCloudMap(const char* path, const PointCloudMap* map);
+
+  // Write |meshes| as one mesh, without welding the vertices they share.
+  // Normals and colors are written if every mesh has them. The meshes must
+  // not change until the export is done.
+  //
+  // @return false if an export is in progress or there are no faces.
+  bool ExportMeshes(const char* path,
+                    const std::vector<const TangoMesh_Experimental*>& meshes);
+
+  // @return whether an export is in progress.
+  bool IsBusy() const { return is_busy_.load(); }
+
+  // Wait for the export in progress.
+  void Wait();
+
+  Stats GetStats() const;
+
+ private:
+  // Run |write| on the writer thread, with the file open.
+  bool Start(const char* path, std::function<bool()> write);
+
+  // Writer thread, buffered writes.
+  bool WriteHeader(const char* vertex_properties, uint64_t vertex_count,
+                   uint64_t face_count);
+  bool Append(const void* data, size_t size);
+  bool Flush();
+
+  bool WritePointCloud();
+  bool WritePointCloudMap(const PointCloudMap* map);
+  bool WriteMeshes(const std::vector<const TangoMesh_Experimental*>& meshes);
+
+  std::atomic<bool> is_busy_;
+  std::thread writer_;
+
+  // Only used by the writer thread during an export.
+  FILE* file_;
+  std::vector<uint8_t> buffer_;
+  size_t buffer_size_;
+  // The point cloud of ExportPointCloud(), in the depth camera frame.
+  std::vector<float> points_;
+  glm::mat4 world_T_depth_;
+
+  std::atomic<uint32_t> export_count_;
+  std::atomic<uint32_t> failed_count_;
+  std::atomic<uint64_t> bytes_written_;
+  std::atomic<double> last_export_time_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_PLY_EXPORTER_H_
@@ -0,0 +1,138 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_POINT_CLOUD_BUFFER_H_
+#define TANGO_UTIL_POINT_CLOUD_BUFFER_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+
+#include <tango_client_api.h>  // NOLINT
+#include <tango-gl/aligned_buffer.h>
+
+namespace tango_util {
+
+// PointCloudBuffer hands the latest point cloud of the depth callback to any
+// number of threads, none of which ever waits for another: the callback
+// copies each cloud into a free slot and publishes it, and every reader
+// holds the cloud it acquired, stable, for as long as it needs it.
+//
+//   // Before connecting the callbacks.
+//   buffer_.Initialize(2, max_point_cloud_elements);
+//   ...
+//   // On the depth callback thread, the only producer.
+//   buffer_.Update(xyz_ij);
+//   ...
+//   // On the render thread, which keeps a reader of its own.
+//   bool is_new;
+//   const TangoXYZij* point_cloud = render_reader_.Acquire(&is_new);
+//
+// A reader holds at most one cloud, from one Acquire() to the next, or to
+// Release(). The buffer keeps a slot per reader, one for the latest cloud
+// and one for the callback to write, so the callback always finds a free
+// slot as long as there are no more readers than Initialize() was told.
+// Unlike TangoSupportPointCloudManager, getting the latest cloud does not
+// swap it away from the other readers.
+class PointCloudBuffer {
+ public:
+  // Most readers of a buffer.
+  static const int kMaxReaderCount = 16;
+
+  // The cloud one thread holds. A reader is used by a single thread, and
+  // must be destroyed before its buffer.
+  class Reader {
+   public:
+    explicit Reader(PointCloudBuffer* buffer);
+    ~Reader();
+    Reader(const Reader& other) = delete;
+    Reader& operator=(const Reader&) = delete;
+
+    // Acquire the latest point cloud, releasing the one held before if it
+    // is older.
+    //
+    // @param is_new: set if it is not the cloud of the previous call.
+    // @return: the cloud, valid until the next Acquire() or Release(),
+    //          nullptr until the first one arrived.
+    const TangoXYZij* Acquire(bool* is_new);
+
+    // Let the callback write over the cloud held, e.g. when the reader
+    // stops for a while.
+    void Release();
+
+    // @return: the generation of the cloud held, 0 if none.
+    uint64_t GetGeneration() const { return generation_; }
+
+   private:
+    PointCloudBuffer* buffer_;
+    int slot_;
+    uint64_t generation_;
+  };
+
+  PointCloudBuffer();
+  PointCloudBuffer(const PointCloudBuffer& other) = delete;
+  PointCloudBuffer& operator=(const PointCloudBuffer&) = delete;
+
+  // Allocate the slots for |reader_count| readers of clouds of up to
+  // |max_point_count| points. Must be called before the depth callback is
+  // connected, and before any reader acquires a cloud.
+  void Initialize(int reader_count, int max_point_count);
+  bool IsInitialized() const { return slot_count_ != 0; }
+
+  // Copy |xyz_ij| into a free slot and make it the latest cloud. Called on
+  // the depth callback thread only.
+  //
+  // @return: false if every slot was held, the cloud then being dropped.
+  bool Update(const TangoXYZij* xyz_ij);
+
+  // @return: the generation of the latest cloud, counting the clouds
+  //          published, 0 before the first. Can be called on any thread, to
+  //          check for a new cloud without acquiring it.
+  uint64_t GetGeneration() const;
+
+  // @return: the clouds Update() dropped. Can be called on any thread.
+  uint64_t GetDroppedCount() const { return dropped_count_.load(); }
+
+ private:
+  struct Slot {
+    tango_gl::AlignedBuffer<float> xyz;
+    TangoXYZij point_cloud;
+    // Readers holding the slot, or about to.
+    std::atomic<int> reader_count;
+  };
+
+  // The latest cloud, its generation above the bits of its slot.
+  static const int kSlotBits = 8;
+  static const uint64_t kSlotMask = (1 << kSlotBits) - 1;
+
+  // Hold the slot of the latest cloud for a reader.
+  //
+  // @return: the slot, or -1 if there is no cloud yet.
+  int AcquireLatest(uint64_t* generation);
+  void ReleaseSlot(int slot);
+
+  std::unique_ptr<Slot[]> slots_;
+  int slot_count_;
+  int max_point_count_;
+  std::atomic<uint64_t> latest_;
+  std::atomic<uint64_t> dropped_count_;
+  // Only used by the callback thread.
+  uint64_t generation_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_POINT_CLOUD_BUFFER_H_
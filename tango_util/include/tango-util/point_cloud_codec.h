@@ -0,0 +1,160 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_POINT_CLOUD_CODEC_H_
+#define TANGO_UTIL_POINT_CLOUD_CODEC_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include <tango_client_api.h>  // NOLINT
+#include <tango-gl/util.h>
+
+namespace tango_util {
+
+// The point cloud codec compresses point clouds for logs and streams, as the
+// occupancy octree of the cells of a grid of the world frame the points fall
+// into.
+//
+// The points are quantized to cells of Options::precision, 21 bits per axis
+// around the origin, and the cells sorted along their Morton codes, which
+// orders them as a depth first walk of the octree. The octree is written
+// breadth first, from the smallest node holding every cell, as one byte per
+// node whose bits are its occupied children. The bytes go through an
+// adaptive binary range coder, whose context is the number of children of
+// the parent of the node: a node with a single sibling is likely to have a
+// single child itself.
+//
+// Most cells of consecutive frames are the same, as the world does not move,
+// so a delta frame only codes the cells that changed, the octree of the
+// cells occupied in only one of the frames, and the decoder toggles them.
+// Every Options::keyframe_interval frame is an intra frame, coded on its
+// own, for a decoder to recover from a lost frame.
+//
+//   PointCloudEncoder encoder(PointCloudEncoder::Options());
+//   // For every point cloud.
+//   encoder.Encode(xyz_ij, world_T_depth, &data);
+//   ...
+//   PointCloudDecoder decoder;
+//   if (decoder.Decode(data.data(), data.size(), &points)) {
+//     // |points| holds the centers of the cells, in the world frame.
+//   }
+//
+// Neither encoding nor decoding allocates once their buffers have grown to
+// the largest frame. Not thread safe.
+namespace point_cloud_codec {
+
+// Bits of a quantized coordinate, and the depth of an octree of the whole
+// grid.
+const int kCoordinateBits = 21;
+const int kMaxDepth = kCoordinateBits;
+
+enum FrameType { kIntraFrame = 0, kDeltaFrame = 1 };
+
+// The header of a frame, followed by the range coded occupancy bytes.
+struct FrameHeader {
+  uint8_t type;
+  // Levels of the octree under the root.
+  uint8_t depth;
+  uint16_t reserved;
+  // Index of the frame in the stream, a delta frame applying to the frame
+  // before it.
+  uint32_t frame_index;
+  // Cells coded, the leaves of the octree.
+  uint32_t cell_count;
+  // Edge length of a cell in meters.
+  float precision;
+  // Morton code of the root, the prefix shared by the cells.
+  uint64_t root;
+};
+}  // namespace point_cloud_codec
+
+class PointCloudEncoder {
+ public:
+  struct Options {
+    Options();
+
+    // Edge length of a cell in meters, the precision of the decoded points.
+    float precision;
+    // Frames between two intra frames, 1 for intra frames only.
+    int keyframe_interval;
+  };
+
+  explicit PointCloudEncoder(const Options& options);
+  PointCloudEncoder(const PointCloudEncoder& other) = delete;
+  PointCloudEncoder& operator=(const PointCloudEncoder&) = delete;
+
+  // Encode a point cloud as the next frame of the stream.
+  //
+  // @param world_T_points: pose of the frame of the points in the world
+  //        frame the cells are in.
+  // @param data: receives the frame.
+  //
+  // @return: the number of cells the points occupy, those decoded.
+  uint32_t Encode(const TangoXYZij* xyz_ij, const glm::mat4& world_T_points,
+                  std::vector<uint8_t>* data);
+
+  // Make the next frame an intra frame, e.g. for a new decoder.
+  void RequestIntraFrame() { frames_to_intra_ = 0; }
+
+ private:
+  float precision_;
+  float inverse_precision_;
+  int keyframe_interval_;
+  uint32_t frame_index_;
+  int frames_to_intra_;
+
+  // Sorted Morton codes of the cells of the previous frame and of the
+  // current one, the codes to sort, and the nodes of a level of the octree.
+  std::vector<uint64_t> previous_cells_;
+  std::vector<uint64_t> cells_;
+  std::vector<uint64_t> sort_buffer_;
+  std::vector<uint64_t> nodes_;
+  // Occupancy bytes of the levels of the octree, from the root.
+  std::vector<uint8_t> levels_[point_cloud_codec::kMaxDepth];
+};
+
+class PointCloudDecoder {
+ public:
+  PointCloudDecoder();
+  PointCloudDecoder(const PointCloudDecoder& other) = delete;
+  PointCloudDecoder& operator=(const PointCloudDecoder&) = delete;
+
+  // Decode the next frame of a stream.
+  //
+  // @param points: receives the centers of the cells, as the xyz array of a
+  //        TangoXYZij, in the world frame.
+  //
+  // @return: false if the frame is corrupt, or a delta frame not following
+  //          the previous frame decoded. An intra frame decodes whatever
+  //          the frames before it.
+  bool Decode(const uint8_t* data, size_t size, std::vector<float>* points);
+
+ private:
+  bool has_previous_;
+  uint32_t previous_frame_index_;
+  float previous_precision_;
+  // As in PointCloudEncoder, and the cells the frame codes.
+  std::vector<uint64_t> previous_cells_;
+  std::vector<uint64_t> cells_;
+  std::vector<uint64_t> nodes_;
+  std::vector<uint8_t> levels_[point_cloud_codec::kMaxDepth];
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_POINT_CLOUD_CODEC_H_
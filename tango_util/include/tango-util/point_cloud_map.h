@@ -0,0 +1,231 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_POINT_CLOUD_MAP_H_
+#define TANGO_UTIL_POINT_CLOUD_MAP_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <tango_client_api.h>  // NOLINT
+#include <tango-gl/util.h>
+
+#include "tango-util/tile_file.h"
+
+namespace tango_util {
+// PointCloudMap accumulates point cloud frames into a sparse voxel map of the
+// start of service frame.
+//
+// Voxels are allocated in blocks of kBlockSize^3, kept in a hash map from the
+// block coordinates. Each voxel holds the mean of the points that fell into
+// it, weighted by the number of observations, which is capped so that the
+// mean keeps following small corrections of the poses. The weight is also the
+// occupancy of the voxel: 0 for a voxel never observed, more for a surface
+// observed in several frames.
+//
+// Memory is bounded: every block lives in one of a fixed number of slots,
+// allocated up front from Options::max_memory_size. Once they are all used,
+// the blocks not observed for a while and farthest from the depth camera are
+// evicted to make room, the most distant first.
+//
+// With a Options::tile_file_path, the map of a whole building is kept out of
+// core instead: the blocks are grouped in tiles of kTileSize^3 blocks, and
+// the evicted blocks are paged out to the record of their tile in a
+// TileFile rather than dropped. Every frame, the tiles farther than
+// Options::resident_radius from both the depth camera and where its motion
+// leads it in Options::prefetch_time are paged out, and those within it paged
+// back in, so the tiles ahead are resident before the camera sees them. A
+// point falling in a block paged out brings its whole tile back. Only the
+// resident blocks are in the slots, rendered and exported.
+//
+// Renderers can mirror the slots on the GPU, and only upload the slots
+// returned by TakeChangedSlots().
+//
+// Not thread safe, every method must be called from the same thread.
+class PointCloudMap {
+ public:
+  static const int kBlockSize = 8;
+  static const int kVoxelsPerBlock = kBlockSize * kBlockSize * kBlockSize;
+  // Edge length of a tile, in blocks.
+  static const int kTileSize = 4;
+  static const int kBlocksPerTile = kTileSize * kTileSize * kTileSize;
+
+  // The layout of a voxel, also usable as a vertex with a weight attribute.
+  struct Voxel {
+    float position[3];
+    float weight;
+  };
+
+  struct Options {
+    Options();
+
+    // Edge length of a voxel in meters.
+    float voxel_size;
+    // Maximum weight of a voxel mean.
+    float max_weight;
+    // Bytes of voxels and block bookkeeping the map may use. The number of
+    // block slots is derived from it.
+    size_t max_memory_size;
+    // Scratch file the tiles are paged out to, on the app storage. Empty to
+    // drop the blocks evicted instead.
+    std::string tile_file_path;
+    // Distance from the depth camera and from its predicted position within
+    // which the tiles are resident, in meters.
+    float resident_radius;
+    // How far ahead the motion of the depth camera is extrapolated to
+    // prefetch tiles, in seconds.
+    float prefetch_time;
+  };
+
+  explicit PointCloudMap(const Options& options);
+  PointCloudMap(const PointCloudMap& other) = delete;
+  PointCloudMap& operator=(const PointCloudMap&) = delete;
+
+  // Insert a point cloud frame.
+  //
+  // @param xyz_ij: points in the depth camera frame.
+  // @param start_service_T_depth: pose of the depth camera at the timestamp
+  //        of the frame.
+  void Insert(const TangoXYZij* xyz_ij,
+              const glm::mat4& start_service_T_depth);
+
+  // Remove every block. Every used slot is reported as changed.
+  void Clear();
+
+  // @return: the edge length of a voxel in meters.
+  float GetVoxelSize() const { return voxel_size_; }
+
+  // @return: the number of block slots, fixed at construction.
+  uint32_t GetSlotCount() const { return slot_count_; }
+
+  // @return: the number of blocks in the map.
+  uint32_t GetBlockCount() const {
+    return slot_count_ - static_cast<uint32_t>(free_slots_.size());
+  }
+
+  // @return: the number of blocks evicted and dropped so far.
+  uint64_t GetEvictedCount() const { return evicted_count_; }
+
+  // @return: the number of blocks paged out to the tile file right now.
+  uint32_t GetPagedOutBlockCount() const { return paged_out_block_count_; }
+
+  // @return: whether the evicted blocks are paged out to a tile file.
+  bool IsPaging() const { return tile_file_.IsOpen(); }
+
+  // Move the slots changed since the previous call into |slots|: blocks that
+  // got new points, were just allocated, or were evicted.
+  void TakeChangedSlots(std::vector<uint32_t>* slots);
+
+  // @return: the voxels of a slot. Voxels of free slots have a weight of 0.
+  const Voxel* GetSlotVoxels(uint32_t slot) const {
+    return &voxels_[static_cast<size_t>(slot) * kVoxelsPerBlock];
+  }
+
+ private:
+  struct Slot {
+    bool is_used;
+    bool is_changed;
+    uint64_t key;
+    glm::vec3 center;
+    uint32_t last_frame;
+    // The tile of the block and the index of the block in it, when paging.
+    uint64_t tile_key;
+    int tile_block;
+  };
+
+  struct Tile {
+    glm::ivec3 coordinates;
+    glm::vec3 center;
+    // Record of the tile in the file, -1 until it is first paged out.
+    int32_t record;
+    // Bit i is set when block i of the tile is in the file.
+    uint64_t paged_out_blocks;
+    // Blocks of the tile in the slots.
+    uint32_t resident_count;
+  };
+
+  // Find or allocate the block at block coordinates |key|.
+  //
+  // @return: its slot, or -1 when every slot holds a block of this frame.
+  int32_t GetSlot(uint64_t key, const glm::ivec3& block);
+
+  // Allocate a slot for a new block, evicting blocks if needed.
+  //
+  // @return: the slot, or -1 when every slot holds a block of this frame.
+  int32_t AllocateSlot(uint64_t key, const glm::ivec3& block);
+
+  // Free a batch of slots, see the class comment.
+  void EvictBlocks();
+  // Page the block of a slot out if paging, and free the slot.
+  void EvictSlot(uint32_t slot);
+  void FreeSlot(uint32_t slot);
+  void MarkChanged(uint32_t slot);
+
+  // Page the tiles in and out around the depth camera, see the class
+  // comment.
+  void UpdateResidency(double timestamp);
+
+  // @return: the tile of |block|, created if needed, and the index of the
+  //          block in it.
+  Tile* GetTile(const glm::ivec3& block, uint64_t* tile_key, int* tile_block);
+
+  // Write the block of a slot to the record of its tile.
+  //
+  // @return: false if the file failed, the block is dropped then.
+  bool PageOutBlock(uint32_t slot);
+
+  // Load the blocks of a tile paged out back into slots.
+  void PageInTile(Tile* tile);
+
+  // Page out every resident block of a tile.
+  void PageOutTile(const Tile& tile);
+
+  float voxel_size_;
+  float inverse_voxel_size_;
+  float max_weight_;
+  uint32_t slot_count_;
+
+  std::vector<Voxel> voxels_;
+  std::vector<Slot> slots_;
+  std::vector<uint32_t> free_slots_;
+  std::unordered_map<uint64_t, uint32_t> block_slots_;
+  std::vector<uint32_t> changed_slots_;
+  // Reused by EvictBlocks().
+  std::vector<uint32_t> eviction_candidates_;
+  // The points of the frame being inserted, in the start of service frame.
+  std::vector<float> world_points_;
+
+  uint32_t frame_;
+  glm::vec3 depth_camera_position_;
+  uint64_t evicted_count_;
+
+  // Paging, only used with a tile file.
+  TileFile tile_file_;
+  std::unordered_map<uint64_t, Tile> tiles_;
+  float resident_radius_;
+  float prefetch_time_;
+  uint32_t paged_out_block_count_;
+  // Smoothed velocity of the depth camera, from the positions of the frames.
+  glm::vec3 velocity_;
+  glm::vec3 last_position_;
+  double last_timestamp_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_POINT_CLOUD_MAP_H_
@@ -0,0 +1,124 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef TANGO_UTIL_POINT_CLOUD_QUEUE_H_
+#define TANGO_UTIL_POINT_CLOUD_QUEUE_H_
+
+#include <stdint.h>
+
+#include <mutex>
+#include <vector>
+
+#include <tango_client_api.h>  // NOLINT
+
+namespace tango_util {
+
+// How far apart in time the point clouds PointCloudQueue paired with color
+// images were taken, see PointCloudQueue::GetSkewStats().
+struct PointCloudSkewStats {
+  // Pairs made.
+  uint64_t pair_count;
+  // Point cloud minus color image timestamp of the last pair, in seconds.
+  double last_skew;
+  // Average of the absolute skews, in seconds.
+  double average_skew;
+  // Pairs skewed by more than the maximum skew.
+  uint64_t large_skew_count;
+};
+
+// PointCloudQueue keeps the last few point clouds of the depth callback, so
+// that the render thread can pair a color image with the point cloud taken
+// closest to it, instead of with whichever arrived last. The depth camera
+// runs at a few Hz and its clouds arrive later than the images, so the
+// latest cloud is often not the closest one.
+//
+//   // Before connecting the callbacks.
+//   queue_.Initialize(kQueueCapacity, max_point_cloud_elements);
+//   ...
+//   // On the depth callback thread.
+//   queue_.OnPointCloudAvailable(xyz_ij);
+//   ...
+//   // On the render thread.
+//   bool is_new;
+//   const TangoXYZij* point_cloud = queue_.Acquire(color_timestamp, &is_new);
+//
+// The point cloud acquired stays valid until the next Acquire(); the callback
+// writes into the other slots meanwhile, so neither side copies a cloud under
+// the lock.
+class PointCloudQueue {
+ public:
+  PointCloudQueue();
+  PointCloudQueue(const PointCloudQueue& other) = delete;
+  PointCloudQueue& operator=(const PointCloudQueue&) = delete;
+
+  // Allocate |capacity| point clouds of up to |max_point_count| points. The
+  // capacity is at least 3: one acquired, one being written and one to pick.
+  // Must be called before the depth callback is connected.
+  void Initialize(int capacity, int max_point_count);
+  bool IsInitialized() const { return !slots_.empty(); }
+
+  // Pairs skewed by more than |max_skew| seconds are counted as large, e.g.
+  // the skew beyond which the depth image visibly misses the color image.
+  void SetMaxSkew(double max_skew);
+
+  // Copy |xyz_ij| over the oldest point cloud. Called on the depth callback
+  // thread.
+  void OnPointCloudAvailable(const TangoXYZij* xyz_ij);
+
+  // Acquire the point cloud taken closest to |timestamp|, releasing the one
+  // acquired before.
+  //
+  // @param is_new: set if it is not the point cloud of the previous call.
+  // @return the point cloud, nullptr until the first one arrived.
+  const TangoXYZij* Acquire(double timestamp, bool* is_new);
+
+  // @return the skews of the pairs Acquire() made since the last summary
+  // logged, every kSkewLogInterval pairs. Called on the render thread.
+  PointCloudSkewStats GetSkewStats() const;
+
+ private:
+  // About 10 seconds of color images.
+  static const int kSkewLogInterval = 300;
+
+  struct Slot {
+    std::vector<float> xyz;
+    TangoXYZij point_cloud;
+    // Order of arrival, 0 while empty.
+    uint64_t sequence;
+    bool is_writing;
+  };
+
+  // Record the skew of a pair, logging a summary now and then.
+  void RecordSkew(double skew);
+
+  std::vector<Slot> slots_;
+  int max_point_count_;
+
+  // Protects the bookkeeping of the slots, not their points.
+  std::mutex mutex_;
+  uint64_t sequence_;
+  int acquired_slot_;
+  uint64_t acquired_sequence_;
+
+  // Only used on the render thread.
+  double max_skew_;
+  PointCloudSkewStats skew_stats_;
+  double skew_sum_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_POINT_CLOUD_QUEUE_H_
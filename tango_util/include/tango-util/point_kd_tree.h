@@ -0,0 +1,135 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_POINT_KD_TREE_H_
+#define TANGO_UTIL_POINT_KD_TREE_H_
+
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+#include <tango_client_api.h>  // NOLINT
+#include <tango-gl/util.h>
+
+#include "tango-util/worker_pool.h"
+
+namespace tango_util {
+
+// PointKdTree answers nearest neighbor and radius queries over a point
+// cloud, e.g. to estimate normals, match points for ICP or snap to edges.
+//
+// The tree has no nodes: Build() permutes a copy of the points so that the
+// median of each range, along the axis of its largest extent, is in its
+// middle, with the smaller points before it and the larger after. A range
+// is then a node whose children are its two halves, down to leaves of
+// kLeafSize points scanned linearly. Only the split axis of each median is
+// stored besides the points and their indices, which are contiguous for the
+// scans.
+//
+// The arrays are kept from one Build() to the next, so rebuilding for every
+// depth frame does not allocate once the largest frame has been seen.
+//
+//   tree_.Build(xyz_ij);
+//   uint32_t indices[8];
+//   float squared_distances[8];
+//   const int count = tree_.FindNearest(point, 8, 0.05f, indices,
+//                                       squared_distances);
+//
+// Queries can be made from several threads at once, not during Build().
+class PointKdTree {
+ public:
+  // Ranges of at most this many points are not split.
+  static const uint32_t kLeafSize = 8;
+
+  // @param thread_count: threads building the subtrees besides the one
+  //        calling Build(), 0 to build on that thread only.
+  explicit PointKdTree(int thread_count);
+  PointKdTree(const PointKdTree& other) = delete;
+  PointKdTree& operator=(const PointKdTree&) = delete;
+
+  // Index |count| points, xyz triplets.
+  void Build(const float* xyz, uint32_t count);
+  void Build(const TangoXYZij* xyz_ij) {
+    Build(xyz_ij->xyz[0], static_cast<uint32_t>(xyz_ij->xyz_count));
+  }
+
+  uint32_t GetPointCount() const {
+    return static_cast<uint32_t>(entries_.size());
+  }
+
+  // Find the |k| points closest to |point| within |max_distance|.
+  //
+  // @param indices: receives the indices of the points in the array of
+  //        Build(), closest first. Must hold |k| indices.
+  // @param squared_distances: receives their squared distances. Must hold
+  //        |k| distances.
+  //
+  // @return the number of points found, at most |k|.
+  int FindNearest(const glm::vec3& point, int k, float max_distance,
+                  uint32_t* indices, float* squared_distances) const;
+
+  // Append the indices of the points within |radius| of |point|, in no
+  // particular order.
+  void FindInRadius(const glm::vec3& point, float radius,
+                    std::vector<uint32_t>* indices) const;
+
+  // Position of the point of index |index| of the array of Build().
+  const glm::vec3& GetPoint(uint32_t index) const {
+    return entries_[positions_[index]].position;
+  }
+
+ private:
+  // A point and its index in the array of Build().
+  struct Entry {
+    glm::vec3 position;
+    uint32_t index;
+  };
+
+  // The best points of a FindNearest() so far, sorted by distance.
+  struct NearestSet {
+    int k;
+    int count;
+    uint32_t* indices;
+    float* squared_distances;
+    // Squared distance a point must beat to get in.
+    float bound;
+  };
+
+  // Arrange [begin, end) and its subtrees, descending |depth| levels before
+  // handing the subtrees left to |subtrees|, if not NULL.
+  void BuildRange(uint32_t begin, uint32_t end, int depth,
+                  std::vector<std::pair<uint32_t, uint32_t>>* subtrees);
+
+  void SearchNearest(uint32_t begin, uint32_t end, const glm::vec3& point,
+                     NearestSet* set) const;
+  void SearchRadius(uint32_t begin, uint32_t end, const glm::vec3& point,
+                    float squared_radius,
+                    std::vector<uint32_t>* indices) const;
+
+  // The points in tree order, and the split axis of the median of each range
+  // that has one.
+  std::vector<Entry> entries_;
+  std::vector<uint8_t> axes_;
+  // Position in entries_ of each point of the array of Build().
+  std::vector<uint32_t> positions_;
+
+  int thread_count_;
+  std::unique_ptr<WorkerPool> worker_pool_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_POINT_KD_TREE_H_
@@ -0,0 +1,115 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_POSE_BUS_H_
+#define TANGO_UTIL_POSE_BUS_H_
+
+#include <stdint.h>
+
+#include <tango_client_api.h>  // NOLINT
+
+#include "tango-util/latest.h"
+
+namespace tango_util {
+
+// PoseBus gathers the poses of several frame pairs, which the
+// TangoService_connectOnPoseAvailable() callback delivers one call per pair,
+// into a snapshot per service tick: the poses of one timestamp, with the
+// latest of the pairs not in it. Other threads read the whole snapshot at
+// once, without a lock, instead of state updated pair by pair.
+//
+//   // Before connecting the callback.
+//   TangoService_connectOnPoseAvailable(pose_bus_.GetFramePairCount(),
+//                                       pose_bus_.GetFramePairs(),
+//                                       onPoseAvailableRouter);
+//   ...
+//   // On the callback thread.
+//   if (pose_bus_.OnPoseAvailable(pose)) {
+//     // A tick is complete.
+//   }
+//   ...
+//   // On any thread.
+//   const tango_util::PoseBus::Snapshot snapshot = pose_bus_.GetSnapshot();
+//   if (snapshot.pose_ticks[kAreaDescriptionTDevice] == snapshot.tick) ...
+//
+// A tick is published as soon as it has the pose of every pair that came in
+// each of the last two ticks, or else when a pose of a later timestamp
+// arrives, so pairs the service only sends now and then, e.g. the area
+// description corrections, do not hold the others back.
+class PoseBus {
+ public:
+  static const int kMaxFramePairCount = 4;
+
+  struct Snapshot {
+    // The latest pose of each frame pair, in the order of the constructor,
+    // zeroed before the first.
+    TangoPoseData poses[kMaxFramePairCount];
+    // The tick which last updated |poses[i]|, 0 before the first.
+    uint64_t pose_ticks[kMaxFramePairCount];
+    // The ticks published, 0 before the first.
+    uint64_t tick;
+    // The latest pose timestamp of the tick.
+    double timestamp;
+  };
+
+  // @param frame_pairs: the |count| pairs to gather, at most
+  //                     kMaxFramePairCount, the ones past that dropped.
+  PoseBus(const TangoCoordinateFramePair* frame_pairs, int count);
+  PoseBus(const PoseBus& other) = delete;
+  PoseBus& operator=(const PoseBus&) = delete;
+
+  const TangoCoordinateFramePair* GetFramePairs() const {
+    return frame_pairs_;
+  }
+  int GetFramePairCount() const { return frame_pair_count_; }
+
+  // @return: the index of |frame_pair| in the snapshots, -1 if not gathered.
+  int FindFramePair(const TangoCoordinateFramePair& frame_pair) const;
+
+  // Add |pose| to its tick. Must be called from a single thread, normally
+  // the pose callback. Poses of other frame pairs are ignored.
+  //
+  // @return: whether a tick was published, for the caller to take the
+  //          snapshot once per tick rather than once per pose.
+  bool OnPoseAvailable(const TangoPoseData* pose);
+
+  // @return: the latest tick published. Can be called on any thread.
+  Snapshot GetSnapshot() const { return latest_.Read(); }
+
+  // Forget the poses, e.g. after disconnecting. Must not be called while
+  // the callback may run.
+  void Reset();
+
+ private:
+  void Publish();
+
+  TangoCoordinateFramePair frame_pairs_[kMaxFramePairCount];
+  int frame_pair_count_;
+
+  // Only used by the callback thread: the tick being gathered, the pairs it
+  // has, and those of the last tick published.
+  Snapshot pending_;
+  bool has_pending_;
+  uint32_t pending_pairs_;
+  uint32_t last_pairs_;
+  // The pairs a tick must have to be published before a later pose.
+  uint32_t expected_pairs_;
+
+  Latest<Snapshot> latest_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_POSE_BUS_H_
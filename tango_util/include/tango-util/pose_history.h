@@ -0,0 +1,100 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_POSE_HISTORY_H_
+#define TANGO_UTIL_POSE_HISTORY_H_
+
+#include <atomic>
+#include <cstdint>
+
+#include <tango_client_api.h>  // NOLINT
+
+namespace tango_util {
+// Interpolate between two poses of the same frame pair at |timestamp|,
+// linearly for the translation and spherically for the orientation, as
+// PoseHistory::LookUpPose() does.
+//
+// @return false if either pose is invalid.
+bool InterpolatePose(const TangoPoseData& older, const TangoPoseData& newer,
+                     double timestamp, TangoPoseData* pose);
+
+// PoseHistory keeps the latest poses of one frame pair, as delivered by the
+// TangoService_connectOnPoseAvailable() callback, so other threads can look
+// up the pose at a timestamp without a round-trip to the Tango service.
+//
+// The callback thread records poses with OnPoseAvailable(); any number of
+// threads may look them up at the same time. Neither side ever blocks: the
+// poses are stored in a ring of sequence-numbered slots, and a lookup that
+// races with the overwriting of a slot just tries the service instead.
+class PoseHistory {
+ public:
+  explicit PoseHistory(const TangoCoordinateFramePair& frame_pair);
+  PoseHistory(const PoseHistory& other) = delete;
+  PoseHistory& operator=(const PoseHistory&) = delete;
+
+  const TangoCoordinateFramePair& GetFramePair() const { return frame_pair_; }
+
+  // Record a pose. Must be called from a single thread, normally the pose
+  // callback. Poses of other frame pairs are ignored.
+  void OnPoseAvailable(const TangoPoseData* pose);
+
+  // Look up the pose at |timestamp| in the history: the pose is interpolated
+  // between the two valid poses recorded around it, linearly for the
+  // translation and spherically for the orientation. A timestamp of 0.0
+  // returns the latest pose, like TangoService_getPoseAtTime().
+  //
+  // @return false if the timestamp is newer than the latest pose, older than
+  //         the history, or not between two valid poses.
+  bool LookUpPose(double timestamp, TangoPoseData* pose) const;
+
+  // LookUpPose(), falling back to the pose source of pose_source.h, normally
+  // TangoService_getPoseAtTime(), when the history does not cover
+  // |timestamp|.
+  TangoErrorType GetPoseAtTime(double timestamp, TangoPoseData* pose) const;
+
+ private:
+  // About 2.5 seconds of poses at the 100Hz of the pose callback.
+  static const uint32_t kCapacity = 256;
+
+  // Timestamp, orientation xyzw and translation xyz.
+  static const int kValueCount = 8;
+
+  // A pose and its status, written under a sequence number: odd while the
+  // slot is being written, 2 * (n + 1) once it holds the n-th pose.
+  struct Slot {
+    std::atomic<uint32_t> sequence;
+    std::atomic<double> values[kValueCount];
+    std::atomic<int> status;
+  };
+
+  struct Sample {
+    double values[kValueCount];
+    int status;
+  };
+
+  // Copy the n-th recorded pose.
+  //
+  // @return false if it was overwritten since.
+  bool ReadSample(uint32_t n, Sample* sample) const;
+
+  TangoCoordinateFramePair frame_pair_;
+  Slot slots_[kCapacity];
+  // Number of poses recorded so far.
+  std::atomic<uint32_t> pose_count_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_POSE_HISTORY_H_
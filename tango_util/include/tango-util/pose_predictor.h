@@ -0,0 +1,98 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_POSE_PREDICTOR_H_
+#define TANGO_UTIL_POSE_PREDICTOR_H_
+
+#include <atomic>
+
+#include <tango_client_api.h>  // NOLINT
+
+#include "tango-util/pose_history.h"
+
+namespace tango_util {
+// Extrapolate the motion between two poses of the same frame pair: the pose
+// keeps moving from |latest| with the linear and angular velocity measured
+// between |earlier| and |latest|.
+//
+// @return false if either pose is invalid or |earlier| is not older than
+//         |latest|.
+bool ExtrapolatePose(const TangoPoseData& earlier, const TangoPoseData& latest,
+                     double timestamp, TangoPoseData* pose);
+
+// PosePredictor estimates the pose of the device when a frame being rendered
+// reaches the display, so virtual content is drawn where the device will be
+// rather than where it was when the latest pose or camera image was captured.
+//
+// The Tango service clock is followed by timing the arrival of the poses in
+// OnPoseAvailable(), so the predictor knows how far the display time is beyond
+// the latest pose without assuming anything about the time base of the pose
+// timestamps.
+class PosePredictor {
+ public:
+  PosePredictor();
+  PosePredictor(const PosePredictor& other) = delete;
+  PosePredictor& operator=(const PosePredictor&) = delete;
+
+  // Time from the start of rendering a frame to its presentation, in seconds.
+  // Defaults to two frames at 60Hz: one to render, one to wait for vsync and
+  // scan out.
+  void SetDisplayLatency(double display_latency);
+  double GetDisplayLatency() const;
+
+  // Follow the service clock. Must be called from a single thread, normally
+  // the pose callback, with poses as they arrive.
+  void OnPoseAvailable(const TangoPoseData* pose);
+
+  // @return: estimated service time at which a frame rendered now will be
+  //          displayed, or 0.0 before the first pose arrived.
+  double GetDisplayTimestamp() const;
+
+  // Convert a service |timestamp| to seconds of CLOCK_MONOTONIC, e.g. to
+  // measure the latency of a frame. The fastest pose delivery is taken as
+  // instantaneous, so the result is late by that much at most.
+  //
+  // @return: false before the first pose arrived.
+  bool ToMonotonicTime(double timestamp, double* monotonic_time) const;
+
+  // Predict the pose at GetDisplayTimestamp() from the latest poses of
+  // |history|. The prediction reaches at most 100ms beyond the latest pose,
+  // and is the latest pose itself until the history is long enough to
+  // measure the velocity.
+  //
+  // @return false if the latest pose of the history is not valid.
+  bool PredictPose(const PoseHistory& history, TangoPoseData* pose) const;
+
+  // Same as above from two poses of the same frame pair, e.g. poses queried
+  // with TangoSupport_getPoseAtTime() in OpenGL frames: |pose| is |latest|
+  // extrapolated to GetDisplayTimestamp() with the motion since |earlier|.
+  //
+  // @return false if either pose is invalid.
+  bool PredictPose(const TangoPoseData& earlier, const TangoPoseData& latest,
+                   TangoPoseData* pose) const;
+
+ private:
+  // Offset from the service clock to CLOCK_MONOTONIC, in seconds.
+  std::atomic<double> clock_offset_;
+  std::atomic<bool> has_clock_offset_;
+  // Timestamp of the pose that last updated the offset, only accessed by
+  // OnPoseAvailable().
+  double last_update_time_;
+  std::atomic<double> display_latency_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_POSE_PREDICTOR_H_
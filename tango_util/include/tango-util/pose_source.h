@@ -0,0 +1,41 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_POSE_SOURCE_H_
+#define TANGO_UTIL_POSE_SOURCE_H_
+
+#include <tango_client_api.h>  // NOLINT
+
+namespace tango_util {
+// A function that looks up poses like TangoService_getPoseAtTime(), and like
+// the TangoSupport_GetPoseAtTimeFn of the support library.
+typedef TangoErrorType (*GetPoseAtTimeFunction)(double timestamp,
+                                                TangoCoordinateFramePair frame,
+                                                TangoPoseData* pose);
+
+// Answer the pose queries of tango_util and of the examples with |function|,
+// e.g. a recorded session being replayed, instead of the Tango service.
+// NULL restores TangoService_getPoseAtTime(). Can be called on any thread.
+void SetPoseSource(GetPoseAtTimeFunction function);
+
+// Look up a pose with the current pose source. This function can itself be
+// passed to TangoSupport_initialize(), so that the support library follows
+// SetPoseSource() too.
+TangoErrorType GetPoseAtTime(double timestamp, TangoCoordinateFramePair frame,
+                             TangoPoseData* pose);
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_POSE_SOURCE_H_
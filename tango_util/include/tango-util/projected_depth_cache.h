@@ -0,0 +1,156 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_PROJECTED_DEPTH_CACHE_H_
+#define TANGO_UTIL_PROJECTED_DEPTH_CACHE_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include <tango_client_api.h>  // NOLINT
+#include <tango-gl/ray_table.h>
+#include <tango-gl/util.h>
+
+namespace tango_util {
+// ProjectedDepthCache answers depth queries at pixels of the color camera
+// without reprojecting the point cloud for every query.
+//
+// Each point cloud is projected once into the color camera at the time of
+// the point cloud, and bucketed into a grid of square cells of pixels. A
+// query at a pixel of a later color image maps the pixel into that camera,
+// then only looks at the points of the few cells around it, so any number of
+// queries, e.g. a crosshair every frame, cost O(1) each until the next point
+// cloud.
+//
+//   // Once the intrinsics are known.
+//   depth_cache_.SetIntrinsics(color_camera_intrinsics);
+//   ...
+//   // Before the queries, does nothing if the point cloud did not change.
+//   depth_cache_.Update(front_cloud_, color_camera_T_depth_camera);
+//   float xyz[3];
+//   if (depth_cache_.GetNearestPoint(uv, color_t1_T_color_t0, xyz)) {
+//     ...
+//   }
+//
+// Once SetIntrinsics() sized the grid, Update() only allocates for point
+// clouds larger than any before. Not thread safe.
+class ProjectedDepthCache {
+ public:
+  struct Options {
+    Options();
+
+    // Edge length of the grid cells in pixels.
+    int cell_size;
+    // Farthest a point can be from a query, in cells, at least 1.
+    int search_radius;
+    // Standard deviation in meters of the depth weight of
+    // GetInterpolatedPoint(), the one of the spatial weight being half the
+    // search radius.
+    float depth_sigma;
+  };
+
+  explicit ProjectedDepthCache(const Options& options);
+  ProjectedDepthCache(const ProjectedDepthCache& other) = delete;
+  ProjectedDepthCache& operator=(const ProjectedDepthCache&) = delete;
+
+  // Size the grid for the images of a camera, and clear the cache.
+  void SetIntrinsics(const TangoCameraIntrinsics& intrinsics);
+
+  // Project a point cloud into the camera, unless it was the last one
+  // projected.
+  //
+  // @param xyz_ij: the point cloud, nullptr to clear the cache.
+  // @param camera_T_depth: transform of the depth camera to the color camera
+  //        at the time of the point cloud, i.e. their extrinsics.
+  void Update(const TangoXYZij* xyz_ij, const glm::mat4& camera_T_depth);
+
+  // @return the timestamp of the point cloud projected, or a negative value
+  // when the cache is empty.
+  double GetTimestamp() const { return timestamp_; }
+
+  // Find the point projected the closest to a pixel of a color image.
+  //
+  // @param uv: the pixel in normalized image coordinates, [0, 1] over the
+  //        width and the height of the image.
+  // @param camera_t1_T_camera_t0: motion of the color camera from the time of
+  //        the image, t0, to the time of the point cloud, t1.
+  // @param xyz: set to the point, in the depth camera frame.
+  //
+  // @return false if no point is within the search radius.
+  bool GetNearestPoint(const float uv[2],
+                       const glm::mat4& camera_t1_T_camera_t0,
+                       float xyz[3]) const;
+
+  // Like GetNearestPoint(), but average the points around the pixel, weighted
+  // by their distance to the pixel and by their depth relative to the nearest
+  // point, so that depth edges are preserved.
+  bool GetInterpolatedPoint(const float uv[2],
+                            const glm::mat4& camera_t1_T_camera_t0,
+                            float xyz[3]) const;
+
+ private:
+  struct ProjectedPoint {
+    // Position in the depth camera frame.
+    glm::vec3 point;
+    // Pixel it projects to.
+    glm::vec2 pixel;
+    // Depth along the optical axis of the color camera.
+    float depth;
+  };
+
+  // Map a pixel of the image at t0 to a pixel of the camera at t1.
+  //
+  // @return false if the pixel is outside the grid.
+  bool GetQueryPixel(const float uv[2], const glm::mat4& camera_t1_T_camera_t0,
+                     glm::vec2* pixel) const;
+
+  // Find the point projected the closest to |pixel|.
+  //
+  // @return its index in points_, -1 if there is none within the search
+  // radius.
+  int FindNearest(const glm::vec2& pixel) const;
+
+  // Range of the cells covering the search radius around |pixel|.
+  void GetSearchWindow(const glm::vec2& pixel, int* min_x, int* min_y,
+                       int* max_x, int* max_y) const;
+
+  Options options_;
+  // Squared search radius in pixels.
+  float max_distance_squared_;
+  TangoCameraIntrinsics intrinsics_;
+  // Rays of the query pixels.
+  tango_gl::RayTable rays_;
+  int grid_width_;
+  int grid_height_;
+  double timestamp_;
+
+  // Points of cell i are points_[cell_starts_[i]] to
+  // points_[cell_starts_[i + 1] - 1], by a counting sort of the point cloud.
+  std::vector<uint32_t> cell_starts_;
+  std::vector<ProjectedPoint> points_;
+  // Cell of every point of the point cloud, -1 for the points outside the
+  // image, and the projected points in the order of the point cloud.
+  std::vector<int> point_cells_;
+  std::vector<ProjectedPoint> unsorted_points_;
+  // Pixels and depths of every point, projected in a batch.
+  std::vector<float> pixel_x_;
+  std::vector<float> pixel_y_;
+  std::vector<float> depths_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_PROJECTED_DEPTH_CACHE_H_
@@ -0,0 +1,155 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_QUALITY_GOVERNOR_H_
+#define TANGO_UTIL_QUALITY_GOVERNOR_H_
+
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+namespace tango_util {
+class PerformanceHintSession;
+
+// The quality knobs an app applies every frame. An app only uses the knobs
+// that make sense for it and ignores the others.
+struct QualityLevel {
+  // Half size of the window over which depth points are splatted.
+  int depth_window_size;
+  // Only one point out of point_cloud_stride is processed or drawn.
+  int point_cloud_stride;
+  // Images produced at the color camera resolution are divided by this on
+  // each side before they are uploaded.
+  int color_image_divisor;
+  // Whether the point cloud is drawn at all.
+  bool render_point_cloud;
+  // The most points of a point cloud or map drawn in a frame, 0 for all of
+  // them. Unlike point_cloud_stride, this is for renderers that draw an even
+  // subsample of any size, see tango_gl::PointLevelOfDetail.
+  int point_budget;
+  // Scale of the resolution the virtual objects of an AR view are rendered
+  // at, over the camera image drawn at full resolution, see
+  // tango_gl::OverlayTarget.
+  float render_scale;
+};
+
+// QualityGovernor steps through a list of quality levels, from the best to
+// the cheapest, to keep the frame time within a budget and the device from
+// overheating. Degrading gracefully is better than having the OS throttle the
+// device so hard that the session is killed.
+//
+// It steps down one level when the frame time stays over the budget, and back
+// up only after the frame time has stayed well under it for much longer, so
+// it does not oscillate. The thermal status caps the best level: the hotter
+// the device, the cheaper the best level allowed.
+//
+//   // On the GL thread.
+//   governor_.BeginFrame();
+//   const tango_util::QualityLevel& quality = governor_.GetLevel();
+//   ... render with |quality| ...
+//   governor_.EndFrame();
+class QualityGovernor {
+ public:
+  // Thermal status, with the values of Android's PowerManager.THERMAL_STATUS_*
+  // constants.
+  enum ThermalStatus {
+    kThermalStatusNone = 0,
+    kThermalStatusLight = 1,
+    kThermalStatusModerate = 2,
+    kThermalStatusSevere = 3,
+    kThermalStatusCritical = 4,
+    kThermalStatusEmergency = 5,
+    kThermalStatusShutdown = 6
+  };
+
+  // @param levels: the quality levels from the best to the cheapest, at
+  //                least one.
+  // @param frame_budget: the target frame time in milliseconds.
+  QualityGovernor(const std::vector<QualityLevel>& levels,
+                  double frame_budget);
+  QualityGovernor(const QualityGovernor& other) = delete;
+  QualityGovernor& operator=(const QualityGovernor&) = delete;
+
+  // Four levels from the defaults of the examples down to a sparse,
+  // quarter resolution depth image without a rendered point cloud, with
+  // point budgets from unlimited down to a quarter million points, and AR
+  // overlays from full down to half resolution.
+  static std::vector<QualityLevel> DefaultLevels();
+
+  // Set the thermal status, e.g. from a PowerManager listener. Can be called
+  // on any thread.
+  void SetThermalStatus(ThermalStatus status);
+  ThermalStatus GetThermalStatus() const { return thermal_status_.load(); }
+
+  // Poll the thermal zones of the kernel every few seconds from EndFrame(),
+  // for platforms that do not report a thermal status. Defaults to true.
+  void SetReadThermalZones(bool read_thermal_zones) {
+    read_thermal_zones_ = read_thermal_zones;
+  }
+
+  // Report the frame times of OnFrameTime() to |session|, with the budget as
+  // their target, and add the thread calling BeginFrame() to it. |session|
+  // must outlive the governor, null to stop reporting.
+  void SetPerformanceHintSession(PerformanceHintSession* session);
+
+  // Time the work of a frame on the render thread. The time between the two
+  // calls is passed to OnFrameTime().
+  void BeginFrame();
+  void EndFrame();
+
+  // Account for a frame that took |frame_time| milliseconds, for apps that
+  // time their frames themselves, e.g. on the GPU.
+  //
+  // @return true if the level changed.
+  bool OnFrameTime(double frame_time);
+
+  // @return the level to render the current frame with.
+  const QualityLevel& GetLevel() const { return levels_[level_index_]; }
+  int GetLevelIndex() const { return level_index_; }
+  int GetLevelCount() const { return static_cast<int>(levels_.size()); }
+
+  // @return the smoothed frame time in milliseconds.
+  double GetAverageFrameTime() const { return average_frame_time_; }
+
+  // @return true while the frame time is well under the budget and the
+  // device is not heating, e.g. for work that can wait for such frames.
+  bool HasHeadroom() const;
+
+ private:
+  // Move to |level_index| and restart the hysteresis counters.
+  void SetLevelIndex(int level_index);
+
+  // The best level the current thermal status allows.
+  int GetBestAllowedLevelIndex() const;
+
+  std::vector<QualityLevel> levels_;
+  double frame_budget_;
+  int level_index_;
+
+  double average_frame_time_;
+  // Consecutive frames over, and well under, the budget.
+  int over_budget_frames_;
+  int under_budget_frames_;
+
+  std::atomic<ThermalStatus> thermal_status_;
+  bool read_thermal_zones_;
+  PerformanceHintSession* hint_session_;
+  std::chrono::steady_clock::time_point frame_start_;
+  std::chrono::steady_clock::time_point last_thermal_read_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_QUALITY_GOVERNOR_H_
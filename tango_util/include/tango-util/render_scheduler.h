@@ -0,0 +1,103 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_RENDER_SCHEDULER_H_
+#define TANGO_UTIL_RENDER_SCHEDULER_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+
+namespace tango_util {
+
+// RenderScheduler decides when a frame is worth drawing. In on demand mode,
+// frames are only requested when something that changes the picture
+// happened: a new color camera frame or point cloud, an input event, or a
+// change of the app's state. Requests are coalesced, so however many happen
+// between two frames only one frame is requested, and the platform draws at
+// most one frame per vsync.
+//
+//   scheduler_.SetRequestFunction([this]() { RequestJavaRender(); });
+//   scheduler_.SetOnDemand(true);
+//   ...
+//   // On any thread.
+//   scheduler_.RequestRender(tango_util::RenderScheduler::kColorFrame);
+//   ...
+//   // On the GL thread, at the start of every frame.
+//   const uint32_t reasons = scheduler_.BeginFrame();
+//
+// With GLSurfaceView, on demand mode goes with RENDERMODE_WHEN_DIRTY and a
+// request function that calls GLSurfaceView.requestRender(). The surface is
+// still drawn when it is created or resized.
+class RenderScheduler {
+ public:
+  // Why a frame is requested, as bits of the value BeginFrame() returns.
+  enum Reason {
+    kColorFrame = 1 << 0,
+    kPointCloud = 1 << 1,
+    kInput = 1 << 2,
+    kStateChange = 1 << 3
+  };
+
+  typedef std::function<void()> RequestFunction;
+
+  RenderScheduler();
+  RenderScheduler(const RenderScheduler& other) = delete;
+  RenderScheduler& operator=(const RenderScheduler&) = delete;
+
+  // Set the function that asks the platform for a frame, an empty function
+  // to stop asking, e.g. once the activity is destroyed. It is called on the
+  // thread of RequestRender().
+  void SetRequestFunction(const RequestFunction& request_function);
+
+  // Only draw requested frames when |on_demand| is set, every frame
+  // otherwise. Defaults to false.
+  void SetOnDemand(bool on_demand);
+  bool IsOnDemand() const { return is_on_demand_.load(); }
+
+  // Ask for a frame, unless one was already asked for since the last
+  // BeginFrame(). Can be called on any thread.
+  //
+  // @param reasons: the Reason bits of the request.
+  void RequestRender(uint32_t reasons);
+
+  // Start a frame, clearing the pending requests.
+  //
+  // @return the Reason bits requested since the previous frame, 0 when
+  //         nothing changed, e.g. in continuous mode.
+  uint32_t BeginFrame();
+
+  // @return the number of RequestRender() calls, and the number of frames
+  //         they were coalesced into.
+  uint64_t GetRequestCount() const { return request_count_.load(); }
+  uint64_t GetFrameCount() const { return frame_count_.load(); }
+
+ private:
+  std::atomic<bool> is_on_demand_;
+  std::atomic<uint32_t> pending_reasons_;
+  std::atomic<uint64_t> request_count_;
+  std::atomic<uint64_t> frame_count_;
+
+  // Protects request_function_, which the UI thread may clear while a
+  // callback thread calls it.
+  std::mutex request_mutex_;
+  RequestFunction request_function_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_RENDER_SCHEDULER_H_
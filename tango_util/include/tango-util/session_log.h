@@ -0,0 +1,244 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_SESSION_LOG_H_
+#define TANGO_UTIL_SESSION_LOG_H_
+
+#include <stdint.h>
+
+#include <cstdio>
+#include <vector>
+
+#include <tango_client_api.h>  // NOLINT
+
+namespace tango_util {
+
+// A session log records the poses, point clouds and color images of a Tango
+// session for replaying it offline. It is a FileHeader followed by chunks,
+// each a ChunkHeader and the records of a single type:
+//  - poses, as PoseRecords whose translations are deltas from the previous
+//    pose of the chunk, quantized to 10 microns, with orientations quantized
+//    to 16 bits,
+//  - point clouds, as a PointCloudRecord followed by the coordinates
+//    quantized to 16 bits with FileHeader::point_scale,
+//  - color images, one per chunk, as an ImageRecord followed by the raw
+//    image, e.g. NV21,
+//  - trajectories, one per chunk, as a TrajectoryRecord followed by the data
+//    of tango_gl::Trajectory::Serialize(), since version 2.
+// Timestamps are stored in microseconds from the first timestamp of their
+// chunk, so every chunk decodes on its own. The log is only ever appended
+// to, which keeps every complete chunk readable if the app dies, and the
+// chunk headers give the time range of each chunk, so seeking to a timestamp
+// only reads the headers.
+namespace session_log {
+
+const uint32_t kVersion = 2;
+
+// Translation units per meter of PoseRecord, and the default units per meter
+// of the point coordinates, millimeters, for a range of 32 meters.
+const double kTranslationScale = 1e5;
+const float kDefaultPointScale = 1000.0f;
+const double kOrientationScale = 32767.0;
+const double kTimeOffsetScale = 1e6;
+
+enum RecordType {
+  kPoseRecord = 1,
+  kPointCloudRecord = 2,
+  kImageRecord = 3,
+  kTrajectoryRecord = 4
+};
+
+struct FileHeader {
+  char magic[4];
+  uint32_t version;
+  float point_scale;
+  uint32_t reserved;
+};
+
+struct ChunkHeader {
+  char magic[4];
+  uint32_t type;
+  uint32_t record_count;
+  uint32_t payload_size;
+  double first_timestamp;
+  double last_timestamp;
+};
+
+struct PoseRecord {
+  uint32_t time_offset;
+  int32_t translation_delta[3];
+  int16_t orientation[4];
+  uint8_t status_code;
+  uint8_t base_frame;
+  uint8_t target_frame;
+  uint8_t reserved;
+};
+
+struct PointCloudRecord {
+  uint32_t time_offset;
+  uint32_t point_count;
+};
+
+struct TrajectoryRecord {
+  uint32_t time_offset;
+  uint32_t data_size;
+};
+
+struct ImageRecord {
+  uint32_t time_offset;
+  uint32_t width;
+  uint32_t height;
+  uint32_t stride;
+  int32_t format;
+  uint32_t data_size;
+  int64_t frame_number;
+};
+
+// Magic values of the file and of every chunk.
+extern const char kFileMagic[4];
+extern const char kChunkMagic[4];
+
+// @return |value| in meters quantized to |scale| units per meter, clamped to
+//         the 16 bit range.
+int16_t QuantizePoint(float value, float scale);
+
+// Encode |pose| in |record|, but for its time offset. |translation| is the
+// quantized translation of the previous pose of the chunk, zeros for the
+// first, and is updated to the one of |pose|.
+void EncodePose(const TangoPoseData& pose, int64_t translation[3],
+                PoseRecord* record);
+}  // namespace session_log
+
+// SessionReader reads the records of a session log in timestamp order,
+// whatever chunks they are stored in.
+//
+// The log is memory mapped when it can be, the records then decoded straight
+// from the mapping: the pages of the chunk a cursor moves to are read ahead,
+// and those of the chunk it leaves are dropped, so a log much larger than
+// the memory streams through a bounded working set. The chunks are read into
+// a buffer otherwise.
+class SessionReader {
+ public:
+  struct Record {
+    session_log::RecordType type;
+    double timestamp;
+    // Valid for kPoseRecord.
+    TangoPoseData pose;
+    // For kPointCloudRecord, the points as the xyz array of a TangoXYZij.
+    std::vector<float> points;
+    // Valid for kImageRecord, with image.data pointing to image_data.
+    TangoImageBuffer image;
+    std::vector<uint8_t> image_data;
+    // For kTrajectoryRecord, the data to Deserialize() a Trajectory from.
+    std::vector<uint8_t> trajectory_data;
+  };
+
+  SessionReader();
+  ~SessionReader();
+  SessionReader(const SessionReader& other) = delete;
+  SessionReader& operator=(const SessionReader&) = delete;
+
+  // Open a log and index its chunks. A chunk cut short, by the recording app
+  // dying, ends the log.
+  bool Open(const char* path);
+  void Close();
+
+  // @return whether the log is memory mapped.
+  bool IsMapped() const { return mapping_ != NULL; }
+
+  // @return the timestamps of the first and last records.
+  double GetStartTimestamp() const { return start_timestamp_; }
+  double GetEndTimestamp() const { return end_timestamp_; }
+
+  // Only read the records of the types of |type_mask|, a combination of
+  // 1 << RecordType bits, e.g. to skip the images. Defaults to every type.
+  void SetRecordTypes(uint32_t type_mask) { type_mask_ = type_mask; }
+
+  // Move to the first record of every type at or after |timestamp|.
+  bool Seek(double timestamp);
+
+  // Read the next record in timestamp order.
+  //
+  // @return false at the end of the log, or at a record that overruns its
+  //         chunk, as in a corrupt or truncated log.
+  bool Read(Record* record);
+
+ private:
+  struct ChunkInfo {
+    long payload_offset;
+    session_log::ChunkHeader header;
+  };
+
+  // Reading position in the chunks of a record type.
+  struct Cursor {
+    std::vector<size_t> chunks;
+    size_t chunk;
+    // Payload of the chunk, in the mapping or in |payload|.
+    const uint8_t* data;
+    std::vector<uint8_t> payload;
+    size_t payload_offset;
+    uint32_t record_index;
+    int64_t translation[3];
+  };
+
+  // Load chunk |chunk| of |cursor|, false past its last chunk.
+  bool LoadChunk(Cursor* cursor, size_t chunk);
+
+  // Move |cursor| past its last chunk, so that it has no more records.
+  void StopCursor(Cursor* cursor);
+
+  // @return the bytes of the payload of the chunk of |cursor| past its
+  //         reading position.
+  size_t GetRemainingBytes(const Cursor& cursor) const;
+
+  // Make sure |cursor| is on a record, loading the next chunk if needed.
+  //
+  // @return false when the records of the cursor are exhausted, or the
+  //         chunk ends before its next record, which stops the cursor.
+  bool Prepare(Cursor* cursor);
+
+  // Timestamp of the record |cursor| is on, after Prepare().
+  double PeekTimestamp(const Cursor& cursor) const;
+
+  // Decode the record |cursor| is on into |record| and move past it.
+  //
+  // @return false if the record overruns the payload of its chunk, which
+  //         stops the cursor.
+  bool Decode(Cursor* cursor, session_log::RecordType type, Record* record);
+
+  // Log that the record |cursor| is on overruns its chunk and stop the cursor.
+  //
+  // @return false, for Prepare() and Decode() to return.
+  bool RejectRecord(Cursor* cursor);
+
+  // Advise the kernel about the pages of the payload of |info| in the
+  // mapping, e.g. MADV_WILLNEED.
+  void AdviseChunk(const ChunkInfo& info, int advice) const;
+
+  FILE* file_;
+  const uint8_t* mapping_;
+  size_t mapping_size_;
+  uint32_t type_mask_;
+  float point_scale_;
+  double start_timestamp_;
+  double end_timestamp_;
+  std::vector<ChunkInfo> chunk_infos_;
+  // Indexed by record type - 1.
+  Cursor cursors_[4];
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_SESSION_LOG_H_
@@ -0,0 +1,166 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_SESSION_PLAYER_H_
+#define TANGO_UTIL_SESSION_PLAYER_H_
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <tango_client_api.h>  // NOLINT
+#include <tango-gl/profiled_mutex.h>
+
+#include "tango-util/session_log.h"
+
+namespace tango_util {
+
+// SessionPlayer replays a session log, see session_log.h, through the same
+// callbacks the Tango service calls, so an app's existing routers can be
+// driven offline with a repeatable workload, e.g. to benchmark on a desktop.
+//
+// Pose queries are answered from the log once InstallPoseSource() makes the
+// player the pose source of pose_source.h, which tango_util and the examples
+// look up poses with:
+//  - poses of a recorded frame pair are interpolated between the recorded
+//    poses around the timestamp, and a timestamp of 0.0 returns the latest
+//    pose replayed,
+//  - fixed transformations that are not recorded, like the extrinsics, are
+//    answered from AddStaticPose().
+// Poses are answered from the whole log, not only the part replayed so far,
+// so the answers do not depend on the replay speed.
+//
+//   player.Open(path);
+//   player.ConnectOnXYZijAvailable(app, OnXYZijAvailableRouter);
+//   player.ConnectOnPoseAvailable(app, OnPoseAvailableRouter);
+//   player.InstallPoseSource();
+//   while (player.Step()) {
+//     app->Render();
+//   }
+class SessionPlayer {
+ public:
+  typedef void (*OnPoseAvailableFunction)(void* context,
+                                          const TangoPoseData* pose);
+  typedef void (*OnXYZijAvailableFunction)(void* context,
+                                           const TangoXYZij* xyz_ij);
+  typedef void (*OnFrameAvailableFunction)(void* context, TangoCameraId id,
+                                           const TangoImageBuffer* buffer);
+
+  enum PlaybackMode {
+    // Deliver the records at the pace they were recorded at.
+    kRecordedRate,
+    // Deliver the records as fast as the callbacks return.
+    kAsFastAsPossible
+  };
+
+  SessionPlayer();
+  ~SessionPlayer();
+  SessionPlayer(const SessionPlayer& other) = delete;
+  SessionPlayer& operator=(const SessionPlayer&) = delete;
+
+  // Open a log and load its poses for the pose queries.
+  bool Open(const char* path);
+
+  // Set the callbacks, with the signatures of the Tango service callbacks.
+  void ConnectOnPoseAvailable(void* context, OnPoseAvailableFunction callback);
+  void ConnectOnXYZijAvailable(void* context,
+                               OnXYZijAvailableFunction callback);
+  void ConnectOnFrameAvailable(void* context,
+                               OnFrameAvailableFunction callback);
+
+  // Only deliver the records of the types of |type_mask|, see
+  // SessionReader::SetRecordTypes(), e.g. to skip decoding the images. The
+  // pose queries are answered from every pose whatever the mask.
+  void SetRecordTypes(uint32_t type_mask) {
+    reader_.SetRecordTypes(type_mask);
+  }
+
+  // Answer the queries of pose.frame at any timestamp with |pose|.
+  void AddStaticPose(const TangoPoseData& pose);
+
+  // Make this player the pose source, until UninstallPoseSource() or its
+  // destruction. Only one player can be installed at a time.
+  void InstallPoseSource();
+  void UninstallPoseSource();
+
+  // Look up a pose like TangoService_getPoseAtTime(). Can be called on any
+  // thread.
+  TangoErrorType GetPoseAtTime(double timestamp,
+                               const TangoCoordinateFramePair& frame,
+                               TangoPoseData* pose) const;
+
+  // Move to the first record at or after |timestamp|.
+  bool Seek(double timestamp);
+
+  // Deliver the next record on the calling thread, to single-step a session.
+  //
+  // @return false at the end of the log.
+  bool Step();
+
+  // Deliver the records on a playback thread until the end of the log or
+  // Stop(). Step() must not be called while playing.
+  bool Play(PlaybackMode mode);
+  void Stop();
+  bool IsPlaying() const { return is_playing_.load(); }
+
+  // Wait for the playback thread to reach the end of the log.
+  void Wait();
+
+  // @return the timestamp of the last record delivered.
+  double GetCurrentTimestamp() const { return current_timestamp_.load(); }
+
+ private:
+  // The recorded or static poses of a frame pair, by timestamp.
+  struct PoseTrack {
+    TangoCoordinateFramePair frame;
+    bool is_static;
+    std::vector<TangoPoseData> poses;
+  };
+
+  PoseTrack* FindTrack(const TangoCoordinateFramePair& frame);
+  const PoseTrack* FindTrack(const TangoCoordinateFramePair& frame) const;
+
+  void Deliver(const SessionReader::Record& record);
+  void PlayLoop(PlaybackMode mode);
+
+  static TangoErrorType GetInstalledPoseAtTime(double timestamp,
+                                               TangoCoordinateFramePair frame,
+                                               TangoPoseData* pose);
+
+  SessionReader reader_;
+  SessionReader::Record record_;
+
+  void* pose_context_;
+  OnPoseAvailableFunction on_pose_available_;
+  void* xyz_ij_context_;
+  OnXYZijAvailableFunction on_xyz_ij_available_;
+  void* frame_context_;
+  OnFrameAvailableFunction on_frame_available_;
+
+  // Protects pose_tracks_, which AddStaticPose() may change while callbacks
+  // query poses.
+  mutable tango_gl::ProfiledMutex pose_mutex_{"SessionPlayer::pose_mutex_"};
+  std::vector<PoseTrack> pose_tracks_;
+
+  std::atomic<double> current_timestamp_;
+  std::atomic<bool> is_playing_;
+  std::atomic<bool> stop_requested_;
+  std::thread playback_thread_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_SESSION_PLAYER_H_
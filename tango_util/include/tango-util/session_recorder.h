@@ -0,0 +1,162 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_SESSION_RECORDER_H_
+#define TANGO_UTIL_SESSION_RECORDER_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <tango_client_api.h>  // NOLINT
+#include <tango-gl/trajectory.h>
+
+#include "tango-util/session_log.h"
+#include "tango-util/slot_ring.h"
+
+namespace tango_util {
+
+// SessionRecorder tees the pose, point cloud and color image callbacks of an
+// app into a session log, see session_log.h, to reproduce a session offline.
+//
+// A callback only copies its data into a slot of a ring preallocated by
+// Start(), and a writer thread encodes and writes the slots. When a ring is
+// full, because the storage can not keep up, the data is dropped rather than
+// stalling the callback.
+//
+// Each On*Available() method must only be called from one thread at a time,
+// which is what the Tango callbacks do.
+class SessionRecorder {
+ public:
+  struct Options {
+    Options();
+
+    // The maximum number of points in a point cloud, usually the
+    // max_point_cloud_elements of the Tango config.
+    int max_point_count;
+    // Record color images, the largest being max_image_size bytes. Raw NV21
+    // images make for large logs, over 40MB/s at 1280x720 and 30Hz.
+    bool record_images;
+    size_t max_image_size;
+    // Units per meter of the 16 bit point coordinates.
+    float point_scale;
+    // Number of records each ring holds before dropping.
+    int pose_slot_count;
+    int point_cloud_slot_count;
+    int image_slot_count;
+    // Size of the largest trajectory recorded, see Trajectory::Serialize(),
+    // and the number of them the ring holds. Room for 8000 points by default.
+    size_t max_trajectory_size;
+    int trajectory_slot_count;
+  };
+
+  struct Stats {
+    uint64_t pose_count;
+    uint64_t point_cloud_count;
+    uint64_t image_count;
+    uint64_t dropped_count;
+    uint64_t bytes_written;
+  };
+
+  SessionRecorder();
+  ~SessionRecorder();
+  SessionRecorder(const SessionRecorder& other) = delete;
+  SessionRecorder& operator=(const SessionRecorder&) = delete;
+
+  // Create the log at |path|, allocate the rings and start the writer
+  // thread. Must not be called while callbacks may be recorded.
+  bool Start(const char* path, const Options& options);
+
+  // Write every recorded slot and close the log.
+  void Stop();
+
+  bool IsRecording() const { return is_recording_.load(); }
+
+  // Copy the data of a callback, if recording.
+  void OnPoseAvailable(const TangoPoseData* pose);
+  void OnXYZijAvailable(const TangoXYZij* xyz_ij);
+  void OnFrameAvailable(const TangoImageBuffer* buffer);
+
+  // Record |trajectory| as of |timestamp|, e.g. the path the app draws, so a
+  // replay can show it without walking through every pose. Must only be
+  // called from one thread at a time.
+  void OnTrajectoryAvailable(const tango_gl::Trajectory& trajectory,
+                             double timestamp);
+
+  Stats GetStats() const;
+
+ private:
+  // The chunk being encoded for a record type.
+  struct ChunkBuilder {
+    session_log::ChunkHeader header;
+    std::vector<uint8_t> payload;
+    int64_t translation[3];
+    std::chrono::steady_clock::time_point start_time;
+  };
+
+  // Writer thread.
+  void WriteLoop();
+
+  // Encode every slot of each ring in its chunk.
+  void DrainRings();
+
+  // Start a record at |timestamp| in |chunk|.
+  //
+  // @return the time offset of the record.
+  uint32_t BeginRecord(ChunkBuilder* chunk, double timestamp);
+
+  void EncodePose(const TangoPoseData& pose);
+  void EncodePointCloud(const uint8_t* slot);
+  void WriteImage(const uint8_t* slot);
+  void WriteTrajectory(const uint8_t* slot);
+
+  // Append |chunk| to the log, if not empty, and start a new one.
+  void FlushChunk(ChunkBuilder* chunk);
+  bool Write(const void* data, size_t size);
+
+  std::atomic<bool> is_recording_;
+  FILE* file_;
+  // Set by the writer thread once a write failed, to log it only once.
+  bool write_failed_;
+  Options options_;
+
+  SlotRing pose_ring_;
+  SlotRing point_cloud_ring_;
+  SlotRing image_ring_;
+  SlotRing trajectory_ring_;
+
+  ChunkBuilder pose_chunk_;
+  ChunkBuilder point_cloud_chunk_;
+
+  std::atomic<uint64_t> pose_count_;
+  std::atomic<uint64_t> point_cloud_count_;
+  std::atomic<uint64_t> image_count_;
+  std::atomic<uint64_t> dropped_count_;
+  std::atomic<uint64_t> bytes_written_;
+
+  std::thread writer_;
+  std::mutex wake_mutex_;
+  std::condition_variable wake_condition_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_SESSION_RECORDER_H_
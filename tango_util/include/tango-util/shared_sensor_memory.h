@@ -0,0 +1,95 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_SHARED_SENSOR_MEMORY_H_
+#define TANGO_UTIL_SHARED_SENSOR_MEMORY_H_
+
+#include <stdint.h>
+
+#include <atomic>
+
+namespace tango_util {
+
+// The layout of the shared memory a SharedSensorPublisher writes the poses
+// and point clouds of an app into, and SharedSensorReaders of other
+// processes map read only. It is a Header followed by two rings of slots:
+// pose_slot_count PoseSlots at pose_offset, then point_cloud_slot_count
+// point cloud slots of point_cloud_slot_size bytes at point_cloud_offset,
+// each a PointCloudSlot followed by max_point_count points of 3 floats.
+//
+// The publication |index| of a pose or point cloud, counted from 0, is
+// written into slot index % slot_count, and *_count of the header is
+// index + 1 once it is complete. Every slot is a seqlock: its sequence is
+// odd while the slot is written and bumped again after, so a read that saw
+// it odd or changed, or a slot index other than the one it looked for, was
+// overwritten and must be dropped.
+//
+// All fields are 4 or 8 bytes wide, and aligned to their size, so that the
+// layout is the same for 32 and 64 bit processes.
+namespace shared_sensor_memory {
+
+const uint32_t kVersion = 1;
+
+// The magic value of the header.
+const char kMagic[4] = {'T', 'S', 'S', 'M'};
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2,
+              "32 bit atomics of shared memory must be lock free");
+
+struct Header {
+  char magic[4];
+  uint32_t version;
+  // Size of the whole memory, in bytes.
+  uint32_t size;
+  uint32_t pose_slot_count;
+  uint32_t pose_offset;
+  uint32_t point_cloud_slot_count;
+  uint32_t point_cloud_offset;
+  uint32_t point_cloud_slot_size;
+  uint32_t max_point_count;
+  uint32_t reserved;
+  std::atomic<uint32_t> pose_count;
+  std::atomic<uint32_t> point_cloud_count;
+};
+
+struct PoseSlot {
+  std::atomic<uint32_t> sequence;
+  uint32_t index;
+  double timestamp;
+  double translation[3];
+  double orientation[4];
+  // The TangoPoseStatusType and TangoCoordinateFrameTypes of the pose.
+  int32_t status_code;
+  int32_t base_frame;
+  int32_t target_frame;
+  uint32_t reserved;
+};
+
+struct PointCloudSlot {
+  std::atomic<uint32_t> sequence;
+  uint32_t index;
+  double timestamp;
+  uint32_t point_count;
+  uint32_t reserved;
+};
+
+static_assert(sizeof(Header) == 48 && sizeof(PoseSlot) == 88 &&
+                  sizeof(PointCloudSlot) == 24,
+              "the layout must not depend on the ABI");
+}  // namespace shared_sensor_memory
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_SHARED_SENSOR_MEMORY_H_
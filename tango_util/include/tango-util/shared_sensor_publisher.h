@@ -0,0 +1,116 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_SHARED_SENSOR_PUBLISHER_H_
+#define TANGO_UTIL_SHARED_SENSOR_PUBLISHER_H_
+
+#include <stdint.h>
+
+#include <mutex>
+
+#include <tango_client_api.h>  // NOLINT
+#include <tango-gl/profiled_mutex.h>
+
+#include "tango-util/shared_sensor_memory.h"
+
+namespace tango_util {
+
+// SharedSensorPublisher writes the poses and point clouds of the Tango
+// callbacks into shared memory, for services of other processes on the
+// device to read at their full rate without a message per frame. See
+// shared_sensor_memory.h for the layout and SharedSensorReader for the other
+// side.
+//
+//   publisher_.Start(tango_util::SharedSensorPublisher::Options());
+//   // Sent once to the other process, e.g. as a ParcelFileDescriptor.
+//   int fd = publisher_.GetFd();
+//   ...
+//   // In the Tango callbacks.
+//   publisher_.OnPoseAvailable(pose);
+//   publisher_.OnXYZijAvailable(xyz_ij);
+//
+// The memory is allocated once, by ASharedMemory_create() from Android 8.0
+// and through /dev/ashmem before, and the callbacks only copy their data
+// into the next slot of a ring, overwriting the oldest: a reader that falls
+// a ring behind loses data, the callbacks never wait for it. The memory is
+// write protected before the fd is handed out, so other processes can only
+// map it read only.
+//
+// Each On*Available() method must only be called from one thread at a time,
+// which is what the Tango callbacks do.
+class SharedSensorPublisher {
+ public:
+  struct Options {
+    Options();
+
+    // The maximum number of points in a point cloud, usually the
+    // max_point_cloud_elements of the Tango config. Larger point clouds are
+    // truncated.
+    int max_point_count;
+    // Number of poses and point clouds kept before overwriting the oldest.
+    int pose_slot_count;
+    int point_cloud_slot_count;
+  };
+
+  SharedSensorPublisher();
+  ~SharedSensorPublisher();
+  SharedSensorPublisher(const SharedSensorPublisher& other) = delete;
+  SharedSensorPublisher& operator=(const SharedSensorPublisher&) = delete;
+
+  // Allocate and map the shared memory. Publishing again after a Stop()
+  // allocates a new one, with a new fd.
+  //
+  // @return: false if the memory could not be allocated or mapped.
+  bool Start(const Options& options);
+
+  // Stop writing, close the fd and unmap the memory. The readers keep the
+  // data published so far.
+  void Stop();
+
+  bool IsPublishing() const { return memory_ != nullptr; }
+
+  // @return: the fd of the shared memory, owned by the publisher, -1 when
+  //          not publishing.
+  int GetFd() const { return fd_; }
+
+  // Copy the data of a callback, if publishing.
+  void OnPoseAvailable(const TangoPoseData* pose);
+  void OnXYZijAvailable(const TangoXYZij* xyz_ij);
+
+ private:
+  // @return: a shared memory fd of |size| bytes, -1 on failure.
+  static int CreateSharedMemory(size_t size);
+
+  // @return: whether the shared memory of |fd| was made read only for the
+  //          mappings to come.
+  static bool ProtectSharedMemory(int fd);
+
+  // Guard the rings against a concurrent Start() or Stop(), never contended
+  // otherwise.
+  tango_gl::ProfiledMutex pose_mutex_{"SharedSensorPublisher::pose_mutex_"};
+  tango_gl::ProfiledMutex point_cloud_mutex_{
+      "SharedSensorPublisher::point_cloud_mutex_"};
+  int fd_;
+  size_t size_;
+  uint8_t* memory_;
+  shared_sensor_memory::Header* header_;
+  // Publication indices of the next pose and point cloud.
+  uint32_t pose_index_;
+  uint32_t point_cloud_index_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_SHARED_SENSOR_PUBLISHER_H_
@@ -0,0 +1,131 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_SHARED_SENSOR_READER_H_
+#define TANGO_UTIL_SHARED_SENSOR_READER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <atomic>
+
+#include <tango_client_api.h>  // NOLINT
+
+#include "tango-util/shared_sensor_memory.h"
+
+namespace tango_util {
+
+// SharedSensorReader reads the poses and point clouds a SharedSensorPublisher
+// of another process writes, from the fd it received once from it:
+//
+//   reader_.Open(fd);
+//   ...
+//   // Poll, e.g. on every frame of the consumer.
+//   TangoPoseData pose;
+//   if (reader_.ReadLatestPose(&pose)) { ... }
+//   bool is_intact = reader_.ReadLatestPointCloud(
+//       [&](double timestamp, const float (*xyz)[3], uint32_t count) {
+//         ... use the points in place ...
+//       });
+//
+// A point cloud is read in place from the shared memory, without copying it:
+// if the publisher overwrote it meanwhile, which only happens to a reader a
+// whole ring behind, the read returns false once done and what the callback
+// computed from it must be dropped. Poses are small and copied out.
+//
+// Only depends on the Tango headers and libc, so a service can use it
+// without the rest of tango_util. Methods must be called from one thread at
+// a time.
+class SharedSensorReader {
+ public:
+  SharedSensorReader();
+  ~SharedSensorReader();
+  SharedSensorReader(const SharedSensorReader& other) = delete;
+  SharedSensorReader& operator=(const SharedSensorReader&) = delete;
+
+  // Map the memory of |fd| read only. The fd can be closed afterwards.
+  //
+  // @return: false if it is not the memory of a SharedSensorPublisher.
+  bool Open(int fd);
+  void Close();
+
+  bool IsOpen() const { return header_ != nullptr; }
+
+  // @return: the number of poses and point clouds published so far, the last
+  //          one's index being one less.
+  uint32_t GetPoseCount() const;
+  uint32_t GetPointCloudCount() const;
+
+  // Copy the pose of publication |index| into |pose|.
+  //
+  // @return: false if it is not published yet or overwritten.
+  bool ReadPose(uint32_t index, TangoPoseData* pose) const;
+  bool ReadLatestPose(TangoPoseData* pose) const;
+
+  // Call |read| with the timestamp, the points and the point count of the
+  // point cloud of publication |index|.
+  //
+  // @return: false if it is not published yet, or if it was overwritten
+  //          before or while |read| was called, in which case what |read|
+  //          got is garbage.
+  template <typename Read>
+  bool ReadPointCloud(uint32_t index, const Read& read) const;
+  template <typename Read>
+  bool ReadLatestPointCloud(const Read& read) const;
+
+ private:
+  // @return: the point cloud slot of publication |index|, whose sequence
+  //          was |*sequence| when it still held it, nullptr if it does not.
+  const shared_sensor_memory::PointCloudSlot* BeginPointCloudRead(
+      uint32_t index, uint32_t* sequence) const;
+
+  // @return: whether |slot| was not written since its sequence was
+  //          |sequence|.
+  template <typename Slot>
+  static bool EndRead(const Slot& slot, uint32_t sequence) {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot.sequence.load(std::memory_order_relaxed) == sequence;
+  }
+
+  const uint8_t* memory_;
+  size_t size_;
+  const shared_sensor_memory::Header* header_;
+};
+
+template <typename Read>
+bool SharedSensorReader::ReadPointCloud(uint32_t index,
+                                        const Read& read) const {
+  uint32_t sequence;
+  const shared_sensor_memory::PointCloudSlot* slot =
+      BeginPointCloudRead(index, &sequence);
+  if (slot == nullptr) {
+    return false;
+  }
+  const uint32_t count =
+      std::min(slot->point_count, header_->max_point_count);
+  read(slot->timestamp, reinterpret_cast<const float(*)[3]>(slot + 1), count);
+  return EndRead(*slot, sequence);
+}
+
+template <typename Read>
+bool SharedSensorReader::ReadLatestPointCloud(const Read& read) const {
+  const uint32_t count = GetPointCloudCount();
+  return count > 0 && ReadPointCloud(count - 1, read);
+}
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_SHARED_SENSOR_READER_H_
@@ -0,0 +1,79 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_SLOT_RING_H_
+#define TANGO_UTIL_SLOT_RING_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace tango_util {
+
+// SlotRing is a ring of fixed size slots, written by one thread and read by
+// another without locking. It is how the Tango callbacks hand their data to
+// a writer thread without allocating or waiting for it:
+//
+//   // Callback thread.
+//   uint8_t* slot = ring_.BeginWrite();
+//   if (slot == NULL) {
+//     ++dropped_count_;  // The reader is behind, drop rather than wait.
+//     return;
+//   }
+//   memcpy(slot, pose, sizeof(*pose));
+//   ring_.EndWrite(sizeof(*pose));
+//
+//   // Writer thread.
+//   size_t size;
+//   while ((slot = ring_.BeginRead(&size)) != NULL) {
+//     ...
+//     ring_.EndRead();
+//   }
+class SlotRing {
+ public:
+  SlotRing();
+  SlotRing(const SlotRing& other) = delete;
+  SlotRing& operator=(const SlotRing&) = delete;
+
+  // Allocate |slot_count| slots of |slot_size| bytes, dropping the slots
+  // written. Must not be called while either thread uses the ring.
+  void Allocate(int slot_count, size_t slot_size);
+
+  // @return the slot to write, NULL when the ring is full.
+  uint8_t* BeginWrite();
+  // Publish the slot of BeginWrite(), of which |size| bytes were written.
+  void EndWrite(size_t size);
+
+  // @return the oldest written slot, NULL when the ring is empty.
+  const uint8_t* BeginRead(size_t* size);
+  // Release the slot of BeginRead() to the writer.
+  void EndRead();
+
+  size_t GetSlotSize() const { return slot_size_; }
+
+ private:
+  std::vector<uint8_t> data_;
+  std::vector<size_t> sizes_;
+  size_t slot_size_;
+  size_t slot_count_;
+  std::atomic<size_t> write_count_;
+  std::atomic<size_t> read_count_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_SLOT_RING_H_
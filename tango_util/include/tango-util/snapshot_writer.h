@@ -0,0 +1,125 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_SNAPSHOT_WRITER_H_
+#define TANGO_UTIL_SNAPSHOT_WRITER_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tango-util/slot_ring.h"
+
+namespace tango_util {
+
+// SnapshotWriter encodes captured frames into PNG files on its own thread,
+// e.g. the frames of a tango_gl::FrameCapture:
+//
+//   writer_.Start("/sdcard/snapshots", width * height * 4,
+//                 SnapshotWriter::Options());
+//   ...
+//   // GL thread.
+//   capture_.ReadFinishedFrames([&](const uint8_t* rgba, int width,
+//                                   int height, double timestamp) {
+//     writer_.Write(rgba, width, height, timestamp);
+//   });
+//
+// Write() only copies the frame into a slot of a ring preallocated by
+// Start(). When the ring is full, because encoding can not keep up, the
+// frame is dropped rather than stalling the caller. Each frame is written to
+// snapshot_<timestamp>.png in the directory.
+//
+// Write() must only be called from one thread at a time.
+class SnapshotWriter {
+ public:
+  struct Options {
+    Options();
+
+    // Frames the ring holds before dropping.
+    int slot_count;
+    // zlib level, from 1 for the fastest to 9 for the smallest files.
+    int compression_level;
+  };
+
+  struct Stats {
+    uint64_t written_count;
+    uint64_t dropped_count;
+  };
+
+  SnapshotWriter();
+  ~SnapshotWriter();
+  SnapshotWriter(const SnapshotWriter& other) = delete;
+  SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+  // Allocate the ring and start the writer thread. Must not be called while
+  // frames may be written.
+  //
+  // @param directory: existing directory the files are written to.
+  // @param max_frame_size: size of the largest RGBA frame, in bytes.
+  bool Start(const char* directory, size_t max_frame_size,
+             const Options& options);
+
+  // Write every queued frame and stop the writer thread.
+  void Stop();
+
+  bool IsRunning() const { return is_running_.load(); }
+
+  // Copy a frame and queue it for encoding, if running.
+  //
+  // @param rgba: bottom-up rows of RGBA pixels, as glReadPixels() returns
+  //        them. The alpha is not written.
+  //
+  // @return false if the frame was dropped.
+  bool Write(const uint8_t* rgba, int width, int height, double timestamp);
+
+  Stats GetStats() const;
+
+ private:
+  // Writer thread.
+  void WriteLoop();
+
+  // Encode every slot of the ring.
+  void DrainRing();
+
+  // Encode a frame slot into its file.
+  //
+  // @return false if the file could not be written.
+  bool WritePng(const uint8_t* slot);
+
+  std::atomic<bool> is_running_;
+  std::string directory_;
+  Options options_;
+
+  SlotRing ring_;
+  // Rows of the frame being encoded, top-down, on the writer thread.
+  std::vector<uint8_t*> row_pointers_;
+
+  std::atomic<uint64_t> written_count_;
+  std::atomic<uint64_t> dropped_count_;
+
+  std::thread writer_;
+  std::mutex wake_mutex_;
+  std::condition_variable wake_condition_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_SNAPSHOT_WRITER_H_
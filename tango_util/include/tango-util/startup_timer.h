@@ -0,0 +1,85 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_STARTUP_TIMER_H_
+#define TANGO_UTIL_STARTUP_TIMER_H_
+
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+namespace tango_util {
+
+// StartupTimer records when each phase of an app's startup finished, from
+// threads that run them in parallel, and logs the whole sequence once the
+// first frame is drawn.
+//
+//   startup_timer_.Begin();
+//   ...
+//   // On the thread that connects to the service.
+//   startup_timer_.MarkPhase("service connected");
+//   ...
+//   // On the GL thread.
+//   startup_timer_.MarkPhase("GL content created");
+//   ...
+//   startup_timer_.Finish("first frame");
+//
+// logs, e.g.:
+//
+//   Startup: 842.1 ms to first frame
+//     GL content created at 31.4 ms
+//     service connected at 790.2 ms
+//     first frame at 842.1 ms
+class StartupTimer {
+ public:
+  struct Phase {
+    // The name passed to MarkPhase(), which must outlive the timer.
+    const char* name;
+    // Time from Begin() to the end of the phase.
+    double end_ms;
+  };
+
+  StartupTimer();
+  StartupTimer(const StartupTimer& other) = delete;
+  StartupTimer& operator=(const StartupTimer&) = delete;
+
+  // Start timing a startup, forgetting the phases of the previous one.
+  void Begin();
+
+  // Record that |phase| just finished. Can be called on any thread, does
+  // nothing unless the timer is between Begin() and Finish().
+  void MarkPhase(const char* phase);
+
+  // Record the last phase and log every phase.
+  void Finish(const char* phase);
+
+  // @return true between Begin() and Finish().
+  bool IsRunning() const;
+
+  // @return the phases recorded since Begin(), in the order they finished.
+  std::vector<Phase> GetPhases() const;
+
+ private:
+  void MarkPhaseLocked(const char* phase);
+
+  mutable std::mutex mutex_;
+  bool is_running_;
+  std::chrono::steady_clock::time_point begin_time_;
+  std::vector<Phase> phases_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_STARTUP_TIMER_H_
@@ -0,0 +1,228 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_TAG_DETECTOR_H_
+#define TANGO_UTIL_TAG_DETECTOR_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include <tango_client_api.h>  // NOLINT
+#include <tango-gl/rigid_transform.h>
+#include <tango-gl/util.h>
+
+#include "tango-util/image_pyramid.h"
+#include "tango-util/worker_pool.h"
+
+namespace tango_util {
+
+// A family of square fiducial tags, as AprilTag's: a black square of
+// bits_per_side + 2 cells with a border of one cell around the data cells,
+// printed on a white background at least a cell wide.
+struct TagFamily {
+  // @return: the AprilTag 16h5 family, 30 tags of 4x4 bits at least 5 bits
+  //          apart in any rotation.
+  static TagFamily Tag16h5();
+
+  // Data cells per side, at most 8.
+  int bits_per_side;
+  // Code of each tag, by id: the data cells row by row from the top left
+  // one, in the most significant bit, a white cell being a 1.
+  std::vector<uint64_t> codes;
+  // Bits a code read may differ by from the code of its tag.
+  int max_corrected_bits;
+};
+
+// A tag found by TagDetector.
+struct TagDetection {
+  // Index of the code of the tag in TagFamily::codes.
+  int id;
+  // Bits of the code read that differed from the code of the tag.
+  int corrected_bits;
+  // Corners of the black square in pixels of the level, the top left, top
+  // right, bottom right and bottom left ones of the tag as printed.
+  glm::vec2 corners[4];
+  // Pose of the tag in the frame of the color camera, the tag frame having
+  // its origin at the center of the square, x to the right, y to the top
+  // and z out of the face of the tag.
+  tango_gl::RigidTransform camera_T_tag;
+};
+
+// TagDetector finds the tags of a TagFamily in the luminance of the color
+// camera, e.g. to register assets to the tags they carry:
+//
+//   TagDetector detector(TagFamily::Tag16h5(), TagDetector::Options());
+//   ...
+//   // On the consumer's thread.
+//   const ImagePyramidFrame* frame = pyramid_.Acquire(&is_new);
+//   if (frame != nullptr && is_new) {
+//     detector.Detect(frame->levels[0], color_camera_intrinsics);
+//     for (const TagDetection& tag : detector.GetDetections()) {
+//       // Pose it with the color camera at frame->timestamp.
+//     }
+//   }
+//
+// The image is thresholded against the local extremes of its tiles of 4x4
+// pixels, and its connected dark regions fitted with a quad: their convex
+// hull simplified to 4 corners, which the lines through the pixels of each
+// side refine. The cells of the quad are sampled through its homography,
+// the code read being that of a tag rotated by a quarter turn or not, and
+// the tag posed from the homography of its corners.
+//
+// Only every Options::full_search_interval frames is the whole image
+// searched: the others only search the regions around the tags of the
+// previous frame, each on a thread of a WorkerPool. A full search runs the
+// thresholding by bands of rows and the fit of the regions in parallel, the
+// pool sharing the work stealing TaskScheduler. The scratch of the searches
+// is kept from one call to the next.
+//
+// Not thread safe, Detect() must be called from one thread at a time.
+class TagDetector {
+ public:
+  struct Options {
+    Options();
+
+    // Edge length of the black square of the tags, in meters.
+    float tag_size;
+    // Frames from one search of the whole image to the next, 1 to always
+    // search it.
+    int full_search_interval;
+    // Margin of the region searched around a tag of the previous frame, in
+    // fractions of the extent of the tag.
+    float region_margin;
+    // Shortest edge of a tag, in pixels of the level.
+    int min_tag_pixels;
+    // Smallest difference of luminance of the black and white of a tag.
+    int min_contrast;
+    // Threads searching besides the calling one.
+    int thread_count;
+  };
+
+  TagDetector(const TagFamily& family, const Options& options);
+  TagDetector(const TagDetector& other) = delete;
+  TagDetector& operator=(const TagDetector&) = delete;
+
+  // Detect the tags of |level|, replacing those of the previous call.
+  //
+  // @param level: the luminance of a color camera image of |intrinsics|, or
+  //        of a level of its pyramid.
+  // @return: the number of tags.
+  size_t Detect(const ImagePyramidLevel& level,
+                const TangoCameraIntrinsics& intrinsics);
+
+  // @return: the tags of the last Detect(), by id, at most one per id.
+  const std::vector<TagDetection>& GetDetections() const {
+    return detections_;
+  }
+
+  // @return: whether the last Detect() searched the whole image.
+  bool WasFullSearch() const { return was_full_search_; }
+
+  // Search the whole image on the next Detect(), e.g. once the camera
+  // resumes.
+  void Reset() { frames_to_full_search_ = 0; }
+
+ private:
+  // A rectangle of the level, [x0, x1) x [y0, y1).
+  struct Region {
+    int x0;
+    int y0;
+    int x1;
+    int y1;
+  };
+
+  // A connected dark region, and its pixels bordering a lighter one.
+  struct Component {
+    int min_x;
+    int min_y;
+    int max_x;
+    int max_y;
+    bool touches_region_edge;
+    // Range of the boundary pixels in Scratch::boundary, begin being -1 for
+    // a component rejected before the fit.
+    int32_t boundary_begin;
+    int32_t boundary_count;
+  };
+
+  // Buffers of a search, one set per thread.
+  struct Scratch {
+    // Of the region segmented: the darkest and lightest pixel of each tile,
+    // whether each pixel is dark, light or in a tile without contrast, and
+    // the connected components of the dark ones.
+    std::vector<uint8_t> tile_extremes;
+    std::vector<uint8_t> classes;
+    std::vector<int32_t> parents;
+    std::vector<int32_t> component_ids;
+    std::vector<Component> components;
+    // Centers of the boundary pixels of the components, in pixels of the
+    // level.
+    std::vector<glm::vec2> boundary;
+    // Of the quad being fitted.
+    std::vector<glm::vec2> hull;
+    // Tags found in the regions searched by the thread.
+    std::vector<TagDetection> detections;
+  };
+
+  // Threshold |region| and find its dark components large enough to be a
+  // tag, into |scratch|. The thresholding runs on |pool| if not null.
+  void Segment(const ImagePyramidLevel& level, const Region& region,
+               WorkerPool* pool, Scratch* scratch);
+
+  // Fit a quad to the boundary pixels of a component, and decode it.
+  //
+  // @param hull: scratch of the fit.
+  // @return: false if it is not a tag.
+  bool Decode(const ImagePyramidLevel& level, const glm::vec2* boundary,
+              size_t boundary_count, std::vector<glm::vec2>* hull,
+              TagDetection* detection) const;
+
+  // @return: the id of the tag whose code |code| is closest to, -1 if none
+  //          is within TagFamily::max_corrected_bits, with the bits
+  //          corrected in |corrected_bits|.
+  int MatchCode(uint64_t code, int* corrected_bits) const;
+
+  // Set the pose of |detection| from its corners.
+  void Pose(TagDetection* detection) const;
+
+  // Search the whole level, or the regions around detections_.
+  void SearchLevel(const ImagePyramidLevel& level);
+  void SearchRegions(const ImagePyramidLevel& level);
+
+  TagFamily family_;
+  Options options_;
+  WorkerPool worker_pool_;
+  std::vector<Scratch> scratches_;
+
+  // Pinhole of the level being detected, with pixel centers at + 0.5.
+  float fx_;
+  float fy_;
+  float cx_;
+  float cy_;
+
+  int frames_to_full_search_;
+  bool was_full_search_;
+  std::vector<Region> regions_;
+  // The components of a full search that may be a tag, their quads, and
+  // whether each was decoded.
+  std::vector<uint32_t> candidate_components_;
+  std::vector<TagDetection> candidates_;
+  std::vector<uint8_t> is_candidate_tag_;
+  std::vector<TagDetection> detections_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_TAG_DETECTOR_H_
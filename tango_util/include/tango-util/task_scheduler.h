@@ -0,0 +1,216 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_TASK_SCHEDULER_H_
+#define TANGO_UTIL_TASK_SCHEDULER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace tango_util {
+// TaskGraph is a set of tasks and the order some of them must run in, run
+// as a whole by TaskScheduler::Run():
+//
+//   tango_util::TaskGraph graph;
+//   const size_t filter = graph.Add([&] { Filter(&points); });
+//   const size_t normals = graph.Add([&] { EstimateNormals(points); });
+//   const size_t planes = graph.Add([&] { FitPlanes(points); });
+//   graph.Precede(filter, normals);
+//   graph.Precede(filter, planes);
+//   scheduler.Run(&graph);
+//
+// The dependencies must not form a cycle. A graph can be run again, but not
+// modified nor run twice at once.
+class TaskGraph {
+ public:
+  typedef std::function<void()> Task;
+
+  TaskGraph() {}
+  TaskGraph(const TaskGraph& other) = delete;
+  TaskGraph& operator=(const TaskGraph&) = delete;
+
+  // @return: the node of |task|, for Precede().
+  size_t Add(const Task& task);
+
+  // Have |successor| start only once |predecessor| is done.
+  void Precede(size_t predecessor, size_t successor);
+
+  size_t GetNodeCount() const { return nodes_.size(); }
+
+ private:
+  friend class TaskScheduler;
+
+  struct Node {
+    Task task;
+    std::vector<size_t> successors;
+    size_t predecessor_count;
+  };
+
+  std::vector<Node> nodes_;
+  // Predecessors of every node left to finish during a run.
+  std::unique_ptr<std::atomic<size_t>[]> remaining_;
+};
+
+// TaskScheduler runs tasks on a few threads, started once, that take work
+// from each other: every worker keeps a deque of tasks, runs the newest of
+// its own and steals the oldest of the others when it has none left. A loop
+// is split in halves as it runs, so the halves stolen first are the largest.
+//
+//   tango_util::TaskScheduler& scheduler = tango_util::TaskScheduler::Get();
+//   scheduler.ParallelFor(0, rows, 16, [&](size_t begin, size_t end) {
+//     for (size_t row = begin; row < end; ++row) {
+//       FilterRow(row);
+//     }
+//   });
+//
+// Waiting, for a loop or a graph, runs tasks on the waiting thread until they
+// are done, so loops can be nested and called from any thread at once. The
+// stages of an application share the scheduler of Get(), which is sized for
+// the device, instead of each starting its own threads.
+class TaskScheduler {
+ public:
+  typedef std::function<void(size_t begin, size_t end)> RangeTask;
+
+  // The CPUs the workers run on. Big cores are those of the highest maximum
+  // frequency, little ones the others. On CPUs whose cores all run at the
+  // same frequency, every core is both.
+  enum CorePolicy { kAnyCore, kBigCores, kLittleCores };
+
+  struct Options {
+    Options();
+
+    CorePolicy core_policy;
+    // Threads besides the calling ones, -1 for one less than the cores of
+    // |core_policy|.
+    int worker_count;
+  };
+
+  explicit TaskScheduler(const Options& options);
+  // Waits for the queued tasks.
+  ~TaskScheduler();
+  TaskScheduler(const TaskScheduler& other) = delete;
+  TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+  // @return: the scheduler shared by the whole process, started on first
+  //          use with the options of SetDefaultOptions().
+  static TaskScheduler& Get();
+
+  // Set the options of Get(), before its first call.
+  //
+  // @return: false if the shared scheduler already started.
+  static bool SetDefaultOptions(const Options& options);
+
+  // Run task(begin, end) over sub-ranges of [begin, end) of at most |grain|
+  // indices, on the workers and the calling thread, and return once all of
+  // them are done. A |grain| of 0 splits the range in a few times more parts
+  // than there are threads.
+  void ParallelFor(size_t begin, size_t end, size_t grain,
+                   const RangeTask& task);
+
+  // Run every task of |graph| once its predecessors are done, and return
+  // once all of them are.
+  void Run(TaskGraph* graph);
+
+  // @return: the threads of the scheduler, the calling ones excluded.
+  int GetWorkerCount() const { return static_cast<int>(workers_.size()); }
+
+  // @return: the CPUs |policy| selects, a bit per CPU index, 0 if they can
+  //          not be told apart.
+  static uint64_t GetCoreMask(CorePolicy policy);
+
+ private:
+  // The tasks of a ParallelFor() or a Run() left to finish, which its caller
+  // waits for.
+  struct Batch {
+    Batch() : pending(0), is_done(false) {}
+
+    std::atomic<size_t> pending;
+    // Set by the last task under |mutex|, so the waiter only returns, and
+    // destroys the batch, once that task let go of it.
+    bool is_done;
+    std::mutex mutex;
+    std::condition_variable done;
+  };
+
+  // What a worker runs, the range being a part of a loop or a node of a
+  // graph. Plain data so that queueing it does not allocate.
+  struct Job {
+    void (*run)(TaskScheduler* scheduler, const Job& job);
+    const void* context;
+    Batch* batch;
+    size_t begin;
+    size_t end;
+  };
+
+  struct Worker {
+    std::mutex mutex;
+    std::deque<Job> jobs;
+    std::thread thread;
+  };
+
+  struct RangeContext {
+    const RangeTask* task;
+    size_t grain;
+  };
+
+  static void RunRange(TaskScheduler* scheduler, const Job& job);
+  static void RunNode(TaskScheduler* scheduler, const Job& job);
+
+  void WorkerLoop(int worker, uint64_t core_mask);
+
+  // Queue |job| on the deque of the calling worker, or on the shared one
+  // from other threads, and wake a sleeping worker.
+  void Push(const Job& job);
+
+  // Run one queued job: the newest of |worker|, or the oldest of the shared
+  // deque or of another worker.
+  //
+  // @return: false if none was queued.
+  bool RunOne(int worker);
+
+  // Run jobs until the tasks of |batch| are done.
+  void Wait(Batch* batch);
+
+  // Mark a job of |batch| done.
+  void Finish(Batch* batch);
+
+  // @return: the index of the calling thread in workers_, -1 for the others.
+  int GetCurrentWorker() const;
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  // Jobs queued from threads that are not workers.
+  std::mutex shared_mutex_;
+  std::deque<Job> shared_jobs_;
+
+  // Jobs in every deque, which sleeping workers wait for.
+  std::atomic<size_t> queued_count_;
+  std::mutex sleep_mutex_;
+  std::condition_variable job_available_;
+  int sleeping_count_;
+  bool is_stopping_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_TASK_SCHEDULER_H_
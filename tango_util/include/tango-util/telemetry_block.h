@@ -0,0 +1,99 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_TELEMETRY_BLOCK_H_
+#define TANGO_UTIL_TELEMETRY_BLOCK_H_
+
+#include <jni.h>
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <type_traits>
+
+namespace tango_util {
+
+// TelemetryBlock shares a struct of debug fields with Java through a direct
+// ByteBuffer, so that a UI polling them neither calls into native code nor
+// allocates strings on either heap. Native threads update the fields in
+// place, and Java reads them as a seqlock: the sequence before the fields is
+// odd during a write and bumped again after it, so a read that saw it odd or
+// changed is retried.
+//
+//   // Native, on any thread.
+//   telemetry_.Write([&](Telemetry* telemetry) {
+//     telemetry->point_count = point_count;
+//   });
+//
+//   // Java, through a TelemetryBuffer of cpp_example_util over the buffer
+//   // of NewDirectByteBuffer().
+//   int sequence;
+//   do {
+//     sequence = mTelemetry.beginRead();
+//     pointCount = mTelemetry.getInt(POINT_COUNT_OFFSET);
+//   } while (!mTelemetry.endRead(sequence));
+//
+// Fields must be a plain struct of 4 byte fields, and arrays of them or of
+// chars, so that its layout is the same on every ABI and Java can mirror it
+// as constant offsets.
+template <typename Fields>
+class TelemetryBlock {
+ public:
+  // Offset of the fields in the buffer, after the 32 bit sequence.
+  static const int kFieldsOffset = 8;
+
+  TelemetryBlock() : write_sequence_(0) {
+    block_.sequence.store(0);
+    block_.fields = Fields();
+  }
+  TelemetryBlock(const TelemetryBlock& other) = delete;
+  TelemetryBlock& operator=(const TelemetryBlock&) = delete;
+
+  // Update the fields with |update|, called with a Fields*. Can be called on
+  // any thread, the writes are serialized.
+  template <typename Update>
+  void Write(const Update& update) {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    block_.sequence.store(++write_sequence_, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    update(&block_.fields);
+    block_.sequence.store(++write_sequence_, std::memory_order_release);
+  }
+
+  // @return a direct ByteBuffer over the block, which must outlive it. Its
+  //         order must be set to ByteOrder.nativeOrder(), as TelemetryBuffer
+  //         does.
+  jobject NewDirectByteBuffer(JNIEnv* env) {
+    return env->NewDirectByteBuffer(&block_, sizeof(block_));
+  }
+
+ private:
+  static_assert(std::is_trivial<Fields>::value,
+                "the fields are shared as raw memory");
+
+  struct Block {
+    std::atomic<uint32_t> sequence;
+    uint32_t padding;
+    Fields fields;
+  };
+
+  Block block_;
+  std::mutex write_mutex_;
+  uint32_t write_sequence_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_TELEMETRY_BLOCK_H_
@@ -0,0 +1,208 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_TEXTURE_ATLAS_BAKER_H_
+#define TANGO_UTIL_TEXTURE_ATLAS_BAKER_H_
+
+#include <stdint.h>
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+#include <tango_client_api.h>  // NOLINT
+#include <tango-gl/util.h>
+
+#include "tango-util/keyframe_store.h"
+#include "tango-util/worker_pool.h"
+
+namespace tango_util {
+
+// TextureAtlasBaker textures the block meshes of a TsdfVolume from the
+// keyframes of a KeyframeStore, into a single RGB atlas:
+//
+//   // Whenever the mesh of a block changes.
+//   baker_.UpdateBlock(&block_meshes_[index]);
+//   ...
+//   // Once per depth frame, on the same thread.
+//   const int index = keyframes_.Commit();
+//   if (index >= 0) {
+//     baker_.OnKeyframeChanged(keyframes_.GetKeyframe(index));
+//   }
+//   baker_.Bake(keyframes_, &baked_blocks_);
+//   for (const TextureAtlasBaker::BlockKey& key : baked_blocks_) {
+//     baker_.GetBlockUvs(key, &uvs);  // Hand to the render thread.
+//   }
+//   ...
+//   // Render thread.
+//   baker_.UploadDirtyRows([](int y, int height, const uint8_t* rows) {
+//     glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y, size, height, GL_RGB,
+//                     GL_UNSIGNED_BYTE, rows);
+//   });
+//
+// Every pair of faces of a block gets a square tile of the atlas, half each,
+// with the corners of the faces on texel centers so that bilinear filtering
+// never reads the neighboring tiles. A face is baked from the keyframe that
+// sees all its corners most frontally and nearest, every texel of its half
+// sampling the keyframe where the texel projects. Faces no keyframe sees are
+// left gray. Occlusion is not tested: a face hidden from the keyframe behind
+// another surface gets the color of that surface.
+//
+// Baking is incremental: the blocks changed, and those a new keyframe sees,
+// wait in a queue, and each Bake() takes at most Options::max_bake_faces
+// faces of it, on a pool of worker threads. The atlas is allocated once, a
+// block whose tiles do not fit stays untextured until its next update.
+//
+// All methods but UploadDirtyRows() must be called from the same thread, the
+// one owning the meshes.
+class TextureAtlasBaker {
+ public:
+  // Coordinates of a block, as in TangoMesh_Experimental::index.
+  typedef std::tuple<int32_t, int32_t, int32_t> BlockKey;
+
+  struct Options {
+    Options();
+
+    // Edge length of the atlas and of a tile of two faces, in texels.
+    int atlas_size;
+    int tile_size;
+    // Faces baked by one Bake() at most.
+    size_t max_bake_faces;
+    // Keyframes seeing a face more obliquely than this angle, in radians,
+    // are not used for it.
+    float max_view_angle;
+    // Baking threads besides the one calling Bake().
+    int thread_count;
+  };
+
+  explicit TextureAtlasBaker(const Options& options);
+  TextureAtlasBaker(const TextureAtlasBaker& other) = delete;
+  TextureAtlasBaker& operator=(const TextureAtlasBaker&) = delete;
+
+  // Set the intrinsics of the color camera the keyframes come from.
+  void SetIntrinsics(const TangoCameraIntrinsics& intrinsics);
+
+  // Assign tiles to the faces of a block mesh and queue it for baking. A mesh
+  // without faces removes the block.
+  //
+  // @param mesh: vertices in the frame of the keyframe poses, kept until the
+  //        block is updated again or removed.
+  //
+  // @return false if the block was removed or does not fit in the atlas.
+  bool UpdateBlock(const TangoMesh_Experimental* mesh);
+
+  // Queue the blocks |keyframe| sees for baking again.
+  void OnKeyframeChanged(const Keyframe& keyframe);
+
+  // Bake from |keyframes| the next blocks of the queue.
+  //
+  // @param baked: receives the blocks whose texels and UVs changed.
+  void Bake(const KeyframeStore& keyframes, std::vector<BlockKey>* baked);
+
+  // @param uvs: receives the texture coordinates of the corners of the faces
+  //        of |key|, 6 floats per face, in the order of the faces of its
+  //        mesh.
+  //
+  // @return false if the block has not been baked since its last update.
+  bool GetBlockUvs(const BlockKey& key, std::vector<float>* uvs) const;
+
+  // Remove every block, freeing the atlas.
+  void Clear();
+
+  // Hand the rows of the atlas baked since the previous call to |upload|, in
+  // runs of consecutive rows. May be called from any thread.
+  //
+  // @return false if a Bake() is writing the atlas, in which case nothing is
+  //         uploaded and the rows stay dirty.
+  bool UploadDirtyRows(
+      const std::function<void(int y, int height, const uint8_t* rows)>&
+          upload);
+
+  // Mark the whole atlas dirty, e.g. for a new GL context. May be called from
+  // any thread.
+  void MarkAtlasDirty();
+
+  int GetAtlasSize() const { return atlas_size_; }
+
+ private:
+  struct Block {
+    const TangoMesh_Experimental* mesh;
+    // One tile per two faces.
+    std::vector<uint32_t> tiles;
+    glm::vec3 center;
+    float radius;
+    bool is_queued;
+    bool is_baked;
+  };
+
+  // Return the tiles of |block| to the free list.
+  void FreeTiles(Block* block);
+
+  // Bake a face into its half tile.
+  void BakeFace(const TangoMesh_Experimental& mesh, uint32_t face,
+                uint32_t tile, const KeyframeStore& keyframes);
+
+  // @param normal: of the face, of any length.
+  // @param is_oriented: whether the keyframe must be on the side |normal|
+  //        points to.
+  //
+  // @return the keyframe to bake a face from, -1 if none sees it.
+  int SelectKeyframe(const glm::vec3 corners[3], const glm::vec3& normal,
+                     bool is_oriented, const KeyframeStore& keyframes) const;
+
+  // @return the pixel of |keyframe| |point| projects to, false if behind the
+  //         camera.
+  bool Project(const Keyframe& keyframe, const glm::vec3& point,
+               glm::vec2* pixel, float* depth) const;
+
+  // Set |corners| to the texel coordinates of the corners of half |half| of
+  // a tile.
+  void GetTileCorners(uint32_t tile, int half, glm::vec2 corners[3]) const;
+
+  int atlas_size_;
+  int tile_size_;
+  int tiles_per_row_;
+  size_t max_bake_faces_;
+  float min_view_cosine_;
+
+  bool has_intrinsics_;
+  float fx_;
+  float fy_;
+  float cx_;
+  float cy_;
+
+  std::map<BlockKey, Block> blocks_;
+  std::deque<BlockKey> queue_;
+  // Free tiles, taken from the back.
+  std::vector<uint32_t> free_tiles_;
+  bool has_warned_full_;
+  // The blocks of the current Bake(), kept to not allocate each time.
+  std::vector<Block*> batch_;
+
+  // The atlas and the tile rows written since the last upload, protected by
+  // atlas_mutex_, held by Bake() for all its writes.
+  std::mutex atlas_mutex_;
+  std::vector<uint8_t> atlas_;
+  std::vector<bool> dirty_tile_rows_;
+
+  WorkerPool worker_pool_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_TEXTURE_ATLAS_BAKER_H_
@@ -0,0 +1,147 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_THREAD_POLICY_H_
+#define TANGO_UTIL_THREAD_POLICY_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <mutex>
+
+#include "tango-util/task_scheduler.h"
+
+namespace tango_util {
+
+// ThreadPolicy sets the priority and the CPUs of the threads of an app by the
+// stage they run, so that on big.LITTLE CPUs the render thread and the
+// callback handlers stay on the big cores ahead of everything else, and the
+// bulk work runs on the little ones out of their way:
+//
+//   // At the top of the loop of the thread, e.g. on every frame.
+//   tango_util::ThreadPolicy::Get().Enter(
+//       tango_util::ThreadPolicy::kRenderStage);
+//   ...
+//   // From the activity.
+//   tango_util::ThreadPolicy::Get().SetEnabled(true);
+//
+// Enter() only changes the calling thread, when the policy changed since the
+// thread last entered, and otherwise only reads the CPU it runs on: the core
+// each stage was last on, and how often it was on a big one, are kept for
+// telemetry. Disabling the policy puts the threads it changed back at the
+// default priority on every CPU, as they enter again.
+//
+// The threads of tango_util enter their stage themselves: the
+// CallbackDispatcher and FramePipeline threads the callback stage, the
+// TaskScheduler workers the worker stage, and the exporting, recording and
+// streaming threads the bulk stage. The render thread is the app's.
+class ThreadPolicy {
+ public:
+  enum Stage {
+    // The GL thread.
+    kRenderStage,
+    // The threads handling the sensor callbacks and processing each frame.
+    kCallbackStage,
+    // The workers of the TaskScheduler, which run the loops of every stage.
+    kWorkerStage,
+    // Exports, compression, recording and meshing, which can lag behind.
+    kBulkStage,
+    kStageCount
+  };
+
+  struct StagePolicy {
+    // The CPUs of the threads, kAnyCore to leave them where they are.
+    TaskScheduler::CorePolicy core_policy;
+    // The nice value of the threads, from -20 for the highest priority to 19
+    // for the lowest, 0 being the default.
+    int nice;
+  };
+
+  // What the threads of a stage ran on, as of their last Enter().
+  struct StageStats {
+    // The CPU of the last thread to enter, -1 before any did.
+    int last_cpu;
+    // The entries into the stage, and those on a big core.
+    uint32_t entry_count;
+    uint32_t big_core_entry_count;
+  };
+
+  // @return: the policy of the process.
+  static ThreadPolicy& Get();
+
+  ThreadPolicy();
+  ThreadPolicy(const ThreadPolicy& other) = delete;
+  ThreadPolicy& operator=(const ThreadPolicy&) = delete;
+
+  // Apply the policy, or undo it, as the threads next enter their stage.
+  // Disabled at first.
+  void SetEnabled(bool is_enabled);
+  bool IsEnabled() const { return is_enabled_.load(); }
+
+  // Replace the policy of |stage|, e.g. to keep a dispatcher that meshes in
+  // the bulk stage. The defaults are:
+  //
+  //   kRenderStage: the big cores at nice -8, Android's urgent display.
+  //   kCallbackStage: the big cores at nice -4, Android's display.
+  //   kWorkerStage: the cores of the TaskScheduler at nice 0.
+  //   kBulkStage: the little cores at nice 10, Android's background.
+  void SetStagePolicy(Stage stage, const StagePolicy& policy);
+  StagePolicy GetStagePolicy(Stage stage) const;
+
+  // Place the calling thread by the policy of |stage| if it changed since the
+  // thread last entered, and record the CPU the thread runs on. A thread is
+  // expected to stay in one stage, entering another one places it anew.
+  void Enter(Stage stage);
+
+  // @return: what the threads of |stage| ran on.
+  StageStats GetStageStats(Stage stage) const;
+
+  // @return: whether |cpu| is a big core, every core being one on CPUs
+  //          whose cores all run at the same frequency.
+  bool IsBigCore(int cpu) const;
+
+  // @return: the name of |stage|, for logging.
+  static const char* GetStageName(Stage stage);
+
+ private:
+  struct StageState {
+    std::atomic<int> last_cpu;
+    std::atomic<uint32_t> entry_count;
+    std::atomic<uint32_t> big_core_entry_count;
+  };
+
+  // What a thread last changed of itself, kept by the thread.
+  struct Placement;
+
+  // Set the priority and CPUs of the calling thread for |stage|, or back to
+  // the defaults if the policy is disabled.
+  void Place(Stage stage, Placement* placement);
+
+  // CPUs of TaskScheduler::GetCoreMask(), read once, and every CPU.
+  uint64_t big_core_mask_;
+  uint64_t little_core_mask_;
+  uint64_t all_core_mask_;
+
+  std::atomic<bool> is_enabled_;
+  // Bumped on every change, which makes the threads place themselves again.
+  std::atomic<uint32_t> generation_;
+  mutable std::mutex mutex_;
+  StagePolicy policies_[kStageCount];
+  StageState states_[kStageCount];
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_THREAD_POLICY_H_
@@ -0,0 +1,89 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_TILE_FILE_H_
+#define TANGO_UTIL_TILE_FILE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+namespace tango_util {
+
+// TileFile is a scratch file of fixed size records, e.g. the tiles of a map
+// paged out of memory, each memory-mapped while it is read or written:
+//
+//   file_.Open(path, kRecordSize);
+//   const int32_t record = file_.AllocateRecord();
+//   uint8_t* data = file_.Map(record);
+//   memcpy(data + offset, block, block_size);
+//
+// Only one record is mapped at a time, the last one, and it is kept mapped
+// until another one is, so the consecutive accesses to a record cost a
+// single mmap(). The address space used stays that of a record whatever the
+// size of the file, which only takes disk space for the pages written.
+//
+// The file is truncated when opened and deleted when closed, it is not meant
+// to outlive the session. Not thread safe.
+class TileFile {
+ public:
+  TileFile();
+  ~TileFile();
+  TileFile(const TileFile& other) = delete;
+  TileFile& operator=(const TileFile&) = delete;
+
+  // Create the file, or truncate it.
+  //
+  // @param record_size: bytes of a record, rounded up to the page size.
+  //
+  // @return false if the file could not be created.
+  bool Open(const std::string& path, size_t record_size);
+
+  // Unmap the record, close and delete the file.
+  void Close();
+
+  bool IsOpen() const { return fd_ >= 0; }
+
+  // Grow the file by a record of zeros.
+  //
+  // @return the index of the record, -1 on failure.
+  int32_t AllocateRecord();
+
+  // @return the record, valid until the next Map() or Close(), nullptr on
+  //         failure.
+  uint8_t* Map(int32_t record);
+
+  // Free every record.
+  void Reset();
+
+  size_t GetRecordSize() const { return record_size_; }
+  int32_t GetRecordCount() const { return record_count_; }
+
+ private:
+  void Unmap();
+
+  std::string path_;
+  int fd_;
+  size_t record_size_;
+  int32_t record_count_;
+
+  int32_t mapped_record_;
+  uint8_t* mapped_data_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_TILE_FILE_H_
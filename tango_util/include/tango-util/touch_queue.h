@@ -0,0 +1,92 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_TOUCH_QUEUE_H_
+#define TANGO_UTIL_TOUCH_QUEUE_H_
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include <tango-gl/gesture_camera.h>
+
+namespace tango_util {
+
+// TouchQueue holds the touch samples Java batches, the historical samples of
+// each MotionEvent included, for the render thread to handle at the start of
+// the frame rather than in a JNI call per event:
+//
+//   // JNI, the floats of the TouchBatch handed over once per frame.
+//   touch_queue_.Post(samples, sample_count);
+//
+//   // Render thread, at the start of Render().
+//   touch_queue_.Take(&touch_samples_);
+//   for (const TouchSample& sample : touch_samples_) {
+//     camera->OnTouchEvent(sample.touch_count, sample.event, sample.x0,
+//                          sample.y0, sample.x1, sample.y1);
+//   }
+//
+// The consecutive moves of the same touch count are coalesced into the last
+// one, as the gestures only depend on where the touches end up: a frame then
+// handles a handful of samples however fast the touch screen reports them.
+// Past Options::max_sample_count samples, the oldest are dropped.
+struct TouchSample {
+  int touch_count;
+  tango_gl::GestureCamera::TouchEvent event;
+  // Position of the first and second touch, as Java posted them.
+  float x0;
+  float y0;
+  float x1;
+  float y1;
+};
+
+class TouchQueue {
+ public:
+  // Floats per sample posted: the touch count, the event, and x0, y0, x1,
+  // y1.
+  static const int kSampleSize = 6;
+
+  struct Options {
+    Options();
+
+    // Samples queued at most, between two Take().
+    int max_sample_count;
+  };
+
+  explicit TouchQueue(const Options& options);
+  TouchQueue(const TouchQueue& other) = delete;
+  TouchQueue& operator=(const TouchQueue&) = delete;
+
+  // Queue |sample_count| samples of kSampleSize floats. Can be called on any
+  // thread.
+  void Post(const float* samples, int sample_count);
+
+  // Swap the samples queued since the previous call into |samples|, oldest
+  // first, cleared if there is none. Called on the render thread.
+  void Take(std::vector<TouchSample>* samples);
+
+  // @return: the samples dropped for the queue being full.
+  uint64_t GetDroppedCount();
+
+ private:
+  int max_sample_count_;
+  std::mutex mutex_;
+  std::vector<TouchSample> samples_;
+  uint64_t dropped_count_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_TOUCH_QUEUE_H_
@@ -0,0 +1,202 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_TSDF_VOLUME_H_
+#define TANGO_UTIL_TSDF_VOLUME_H_
+
+#include <stdint.h>
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <tango_client_api.h>  // NOLINT
+#include <tango-gl/util.h>
+
+#include "tango-util/frame_arena.h"
+#include "tango-util/worker_pool.h"
+
+namespace tango_util {
+// TsdfVolume fuses depth frames into a truncated signed distance field of
+// the start of service frame, and meshes it incrementally.
+//
+// The voxels are allocated in blocks of kBlockSize^3 around the surfaces,
+// kept in a hash map from the block coordinates. Every depth point updates
+// the voxels along its ray within the truncation distance of the point, with
+// a running average of their distance to the surface, positive in front of
+// it.
+//
+// ExtractMeshes() runs marching cubes only on the blocks changed since its
+// previous call, on a pool of worker threads, and returns a mesh per block.
+// The scratch buffers of a block come from a FrameArena of its thread, so
+// meshing does not allocate besides the meshes themselves. These are
+// TangoMesh_Experimental structs allocated by the support library, so they
+// can be copied, merged and simplified with its functions, e.g.
+// TangoSupport_createSimplifiedMesh() for export.
+//
+// ExtractBlockDistances() instead quantizes the distances of the blocks
+// changed since its own previous call, for a renderer that raycasts the
+// volume rather than drawing its meshes. The two keep track of the changes
+// separately, so either can be skipped for a while and catch up later.
+//
+// Not thread safe, every method must be called from the same thread.
+class TsdfVolume {
+ public:
+  static const int kBlockSize = 8;
+  // Samples of a block along each axis: its voxels and the first layer of
+  // its upper neighbors, which the cubes along its upper faces reach into.
+  static const int kSampleSize = kBlockSize + 1;
+
+  // The distances of a block at the centers of its samples, quantized for a
+  // texture, so that the surface inside the block is found by interpolating
+  // them as marching cubes does.
+  struct BlockDistances {
+    glm::ivec3 index;
+    // Whether a cube of the block crosses the surface, as when its mesh has
+    // faces. A block without one has nothing to draw.
+    bool has_surface;
+    // Luminance and alpha of every sample, laid out as an image of the z
+    // slices side by side, kSampleSize^2 wide and kSampleSize high. The
+    // luminance maps [-truncation_distance, truncation_distance] to
+    // [0, 255], the alpha is 255 where the voxel would be meshed and 0
+    // elsewhere.
+    uint8_t samples[kSampleSize * kSampleSize * kSampleSize * 2];
+  };
+
+  struct Options {
+    Options();
+
+    // Edge length of a voxel, in meters.
+    float voxel_size;
+    // Distance from the surface up to which voxels are updated, in meters.
+    float truncation_distance;
+    // Maximum weight of a voxel average.
+    float max_weight;
+    // Range of the depth points integrated, in meters.
+    float min_depth;
+    float max_depth;
+    // Voxels are meshed once observed at least this many times.
+    float min_mesh_weight;
+    // New blocks are not allocated past this count.
+    size_t max_block_count;
+    // Meshing threads besides the one calling ExtractMeshes().
+    int thread_count;
+  };
+
+  explicit TsdfVolume(const Options& options);
+  ~TsdfVolume();
+  TsdfVolume(const TsdfVolume& other) = delete;
+  TsdfVolume& operator=(const TsdfVolume&) = delete;
+
+  // Integrate a point cloud frame.
+  //
+  // @param xyz_ij: points in the depth camera frame.
+  // @param start_service_T_depth: pose of the depth camera at the timestamp
+  //        of the frame.
+  void Integrate(const TangoXYZij* xyz_ij,
+                 const glm::mat4& start_service_T_depth);
+
+  // Mesh the blocks changed since the previous call. Each mesh has the block
+  // coordinates in its index, and its vertices and normals in the start of
+  // service frame; a block with no surface left gets a mesh without faces.
+  //
+  // @param meshes: receives the meshes, which the caller must free with
+  //                TangoSupport_freeMesh().
+  void ExtractMeshes(std::vector<TangoMesh_Experimental>* meshes);
+
+  // Quantize the distances of the blocks changed since the previous call,
+  // on the meshing threads. Like the meshes, a block with no surface left
+  // is returned once, with has_surface not set.
+  //
+  // @param blocks: receives the distances of every block changed, kept
+  //                allocated from one call to the next.
+  void ExtractBlockDistances(std::vector<BlockDistances>* blocks);
+
+  // Have the next ExtractBlockDistances() return every block, e.g. once the
+  // renderer of the distances lost its GL context.
+  void InvalidateBlockDistances();
+
+  // Remove every block.
+  void Clear();
+
+  size_t GetBlockCount() const { return blocks_.size(); }
+
+  // @return: the heap blocks allocated by the scratch arenas of the meshing
+  //          threads, steady once they fit the largest block meshed.
+  uint64_t GetScratchAllocationCount() const;
+
+  // @return: the edge length of a block, in meters.
+  float GetBlockSize() const { return voxel_size_ * kBlockSize; }
+
+ private:
+  struct Voxel {
+    float sdf;
+    float weight;
+  };
+
+  struct Block {
+    Voxel voxels[kBlockSize * kBlockSize * kBlockSize];
+    // Changed since the last ExtractMeshes(), and ExtractBlockDistances().
+    bool is_changed;
+    bool is_distance_changed;
+  };
+
+  Block* GetBlock(const glm::ivec3& block_index, bool create);
+  const Block* FindBlock(const glm::ivec3& block_index) const;
+
+  // Add to |changed_blocks| the lower neighbors of its blocks, whose samples
+  // reach into them, marking them with |is_changed|.
+  void AddLowerNeighbors(bool Block::*is_changed,
+                         std::vector<glm::ivec3>* changed_blocks);
+
+  // Gather the voxels of a block and of its upper neighbors, a weight of 0
+  // where there is no block.
+  //
+  // @param samples: kSampleSize^3 voxels, x first.
+  void GatherSamples(const glm::ivec3& block_index, Voxel* samples) const;
+
+  // Quantize the samples of a block.
+  void QuantizeBlock(const glm::ivec3& block_index,
+                     BlockDistances* distances) const;
+
+  // Run marching cubes on a block and its neighbors' voxels along its upper
+  // faces.
+  //
+  // @param arena: holds the scratch buffers, reset by the caller.
+  void MeshBlock(const glm::ivec3& block_index, FrameArena* arena,
+                 TangoMesh_Experimental* mesh) const;
+
+  float voxel_size_;
+  float inverse_voxel_size_;
+  float truncation_distance_;
+  float max_weight_;
+  float min_depth_;
+  float max_depth_;
+  float min_mesh_weight_;
+  size_t max_block_count_;
+
+  std::unordered_map<uint64_t, std::unique_ptr<Block>> blocks_;
+  std::vector<glm::ivec3> changed_blocks_;
+  std::vector<glm::ivec3> distance_changed_blocks_;
+  bool has_warned_full_;
+
+  WorkerPool worker_pool_;
+  // One per thread of worker_pool_.
+  std::vector<std::unique_ptr<FrameArena>> mesh_arenas_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_TSDF_VOLUME_H_
@@ -0,0 +1,101 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_VOXEL_GRID_FILTER_H_
+#define TANGO_UTIL_VOXEL_GRID_FILTER_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include <tango_client_api.h>  // NOLINT
+#include <tango-gl/util.h>
+
+namespace tango_util {
+// VoxelGridFilter downsamples point clouds to one point per voxel of a
+// regular grid, the centroid of the points falling into it, so that the cost
+// of rendering or fitting a point cloud follows the detail of the scene
+// rather than the resolution of the depth sensor.
+//
+// The voxels of a frame are found in a flat open-addressing hash table. Its
+// slots are stamped with the frame they were last used in, so nothing is
+// cleared between frames, and once Reserve() has sized the storage for the
+// largest point cloud, filtering never allocates.
+//
+// Not thread safe, every method must be called from the same thread.
+class VoxelGridFilter {
+ public:
+  VoxelGridFilter();
+  VoxelGridFilter(const VoxelGridFilter& other) = delete;
+  VoxelGridFilter& operator=(const VoxelGridFilter&) = delete;
+
+  // Size the storage for point clouds of up to |max_point_count| points,
+  // e.g. the max_point_cloud_elements of the Tango config. This allocates,
+  // so it should be called once at setup rather than for every frame.
+  void Reserve(uint32_t max_point_count);
+  uint32_t GetCapacity() const { return capacity_; }
+
+  // Set the edge length of the voxels in meters, 0 to pass the points
+  // through unfiltered.
+  void SetLeafSize(float leaf_size);
+  float GetLeafSize() const { return leaf_size_; }
+
+  // Downsample a point cloud. Points past the reserved capacity are ignored,
+  // as are points too far from the origin for the grid, further than 2^20
+  // voxels.
+  //
+  // @return: the centroids as a point cloud with the timestamp of |xyz_ij|,
+  //          valid until the next call, or |xyz_ij| itself when the leaf
+  //          size is 0.
+  const TangoXYZij* Filter(const TangoXYZij* xyz_ij);
+
+  // Downsample a point cloud and its normals, e.g. those of a
+  // NormalEstimator, the normal of a voxel being the mean of those of its
+  // points. Zero normals are left out of the mean.
+  //
+  // @param normals: one per point of |xyz_ij|.
+  // @param filtered_normals: receives one unit or zero normal per point of
+  //        the result, valid until the next call, or |normals| itself when
+  //        the leaf size is 0.
+  const TangoXYZij* Filter(const TangoXYZij* xyz_ij, const glm::vec3* normals,
+                           const glm::vec3** filtered_normals);
+
+ private:
+  struct Slot {
+    uint64_t key;
+    uint32_t frame;
+    uint32_t point_count;
+    float sum[3];
+    float normal_sum[3];
+  };
+
+  float leaf_size_;
+  float inverse_leaf_size_;
+  uint32_t capacity_;
+  // The table has a power of two of slots, at least twice the capacity, so
+  // probes stay short even when every point lands in its own voxel.
+  uint32_t slot_mask_;
+  uint32_t frame_;
+  std::vector<Slot> slots_;
+  // Slots used by the current frame, in the order of their first point.
+  std::vector<uint32_t> used_slots_;
+  std::vector<float> points_;
+  std::vector<glm::vec3> normals_;
+  TangoXYZij filtered_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_VOXEL_GRID_FILTER_H_
@@ -0,0 +1,67 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_UTIL_WORKER_POOL_H_
+#define TANGO_UTIL_WORKER_POOL_H_
+
+#include <stddef.h>
+
+#include <functional>
+
+namespace tango_util {
+class TaskScheduler;
+
+// WorkerPool runs the iterations of a loop on at most a few threads of a
+// TaskScheduler, the shared one by default, so that the stages using a pool
+// each do not start threads of their own.
+//
+//   pool.ParallelFor(blocks.size(), [&](size_t i) { Mesh(blocks[i]); });
+//
+// A pool runs one loop at a time: ParallelFor() must not be called from
+// several threads at once. Loops of different pools, and loops nested in an
+// iteration, run concurrently on the scheduler.
+class WorkerPool {
+ public:
+  typedef std::function<void(size_t index)> Task;
+  typedef std::function<void(size_t index, int thread)> ThreadTask;
+
+  // @param thread_count: number of threads besides the calling one.
+  // @param scheduler: the scheduler running the loops, NULL for
+  //        TaskScheduler::Get().
+  explicit WorkerPool(int thread_count, TaskScheduler* scheduler = nullptr);
+  WorkerPool(const WorkerPool& other) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  // Run task(i) for every i in [0, count), on the pool and on the calling
+  // thread, and return once every iteration is done.
+  void ParallelFor(size_t count, const Task& task);
+
+  // Like ParallelFor(), but task(i, thread) also gets the index of the
+  // thread running the iteration, in [0, GetThreadCount()), the calling
+  // thread being 0, e.g. to pick the scratch buffers of the thread. No two
+  // iterations run at once with the same index.
+  void ParallelForWithThread(size_t count, const ThreadTask& task);
+
+  // @return: the threads running the iterations, the calling one included.
+  int GetThreadCount() const { return thread_count_ + 1; }
+
+ private:
+  const int thread_count_;
+  TaskScheduler* scheduler_;
+};
+}  // namespace tango_util
+
+#endif  // TANGO_UTIL_WORKER_POOL_H_
@@ -0,0 +1,166 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/intrinsics_registry.h"
+
+#include <tango-gl/camera.h>
+
+namespace {
+bool SameIntrinsics(const TangoCameraIntrinsics& a,
+                    const TangoCameraIntrinsics& b) {
+  return a.width == b.width && a.height == b.height && a.fx == b.fx &&
+         a.fy == b.fy && a.cx == b.cx && a.cy == b.cy;
+}
+
+// Append |entry| to |entries|, dropping the oldest entry beyond |max_size|.
+template <typename Entry>
+void AppendEntry(const Entry& entry, size_t max_size,
+                 std::vector<Entry>* entries) {
+  if (entries->size() >= max_size) {
+    entries->erase(entries->begin());
+  }
+  entries->push_back(entry);
+}
+
+// Drop the entries of |camera_id| from |entries|.
+template <typename Entry>
+void EraseCameraEntries(TangoCameraId camera_id, std::vector<Entry>* entries) {
+  for (auto it = entries->begin(); it != entries->end();) {
+    if (it->camera_id == camera_id) {
+      it = entries->erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+}  // namespace
+
+namespace tango_util {
+
+IntrinsicsRegistry::IntrinsicsRegistry() {}
+
+TangoErrorType IntrinsicsRegistry::Update(TangoCameraId camera_id) {
+  TangoCameraIntrinsics intrinsics;
+  TangoErrorType ret = TangoService_getCameraIntrinsics(camera_id, &intrinsics);
+  if (ret != TANGO_SUCCESS) {
+    LOGE(
+        "IntrinsicsRegistry: Failed to get the intrinsics of camera %d with "
+        "error code: %d",
+        camera_id, ret);
+    return ret;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (CameraEntry& camera : cameras_) {
+    if (camera.camera_id == camera_id) {
+      if (!SameIntrinsics(camera.intrinsics, intrinsics)) {
+        camera.intrinsics = intrinsics;
+        EraseCameraEntries(camera_id, &projections_);
+        EraseCameraEntries(camera_id, &ray_tables_);
+      }
+      return TANGO_SUCCESS;
+    }
+  }
+  CameraEntry camera;
+  camera.camera_id = camera_id;
+  camera.intrinsics = intrinsics;
+  cameras_.push_back(camera);
+  return TANGO_SUCCESS;
+}
+
+bool IntrinsicsRegistry::GetIntrinsics(TangoCameraId camera_id,
+                                       TangoCameraIntrinsics* intrinsics) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const CameraEntry* camera = FindCameraLocked(camera_id);
+  if (camera == nullptr) {
+    return false;
+  }
+  *intrinsics = camera->intrinsics;
+  return true;
+}
+
+bool IntrinsicsRegistry::GetProjection(TangoCameraId camera_id, float near,
+                                       float far, Projection* projection) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const ProjectionEntry& entry : projections_) {
+    if (entry.camera_id == camera_id && entry.near == near &&
+        entry.far == far) {
+      *projection = entry.projection;
+      return true;
+    }
+  }
+
+  const CameraEntry* camera = FindCameraLocked(camera_id);
+  if (camera == nullptr) {
+    return false;
+  }
+  const TangoCameraIntrinsics& intrinsics = camera->intrinsics;
+  ProjectionEntry entry;
+  entry.camera_id = camera_id;
+  entry.near = near;
+  entry.far = far;
+  entry.projection.matrix =
+      tango_gl::Camera::ProjectionMatrixForCameraIntrinsics(
+          intrinsics.width, intrinsics.height, intrinsics.fx, intrinsics.fy,
+          intrinsics.cx, intrinsics.cy, near, far);
+  entry.projection.inverse = glm::inverse(entry.projection.matrix);
+  AppendEntry(entry, kMaxCacheEntries, &projections_);
+  *projection = entry.projection;
+  return true;
+}
+
+std::shared_ptr<const tango_gl::RayTable> IntrinsicsRegistry::GetRayTable(
+    TangoCameraId camera_id, int width, int height) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const RayTableEntry& entry : ray_tables_) {
+    if (entry.camera_id == camera_id && entry.width == width &&
+        entry.height == height) {
+      return entry.rays;
+    }
+  }
+
+  const CameraEntry* camera = FindCameraLocked(camera_id);
+  if (camera == nullptr || width <= 0 || height <= 0) {
+    return nullptr;
+  }
+  // The intrinsics in pixels of the image asked for.
+  const TangoCameraIntrinsics& intrinsics = camera->intrinsics;
+  const double scale_x = static_cast<double>(width) / intrinsics.width;
+  const double scale_y = static_cast<double>(height) / intrinsics.height;
+  std::shared_ptr<tango_gl::RayTable> rays(new tango_gl::RayTable());
+  rays->Reset(width, height, intrinsics.fx * scale_x, intrinsics.fy * scale_y,
+              intrinsics.cx * scale_x, intrinsics.cy * scale_y);
+
+  RayTableEntry entry;
+  entry.camera_id = camera_id;
+  entry.width = width;
+  entry.height = height;
+  entry.rays = rays;
+  AppendEntry(entry, kMaxCacheEntries, &ray_tables_);
+  return entry.rays;
+}
+
+const IntrinsicsRegistry::CameraEntry* IntrinsicsRegistry::FindCameraLocked(
+    TangoCameraId camera_id) const {
+  for (const CameraEntry& camera : cameras_) {
+    if (camera.camera_id == camera_id) {
+      return &camera;
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace tango_util
@@ -0,0 +1,278 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/keyframe_store.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <tango-gl/simd_math.h>
+
+namespace {
+// Fixed-point (Q6) YCrCb to RGB coefficients, as in the hello_video
+// converter:
+//   R = Y + 1.370705 * (V - 128)
+//   G = Y - 0.698001 * (V - 128) - 0.337633 * (U - 128)
+//   B = Y + 1.732446 * (U - 128)
+const int kFixedPointShift = 6;
+const int kFixedPointRound = 1 << (kFixedPointShift - 1);
+const int kVToR = 88;
+const int kVToG = 45;
+const int kUToG = 22;
+const int kUToB = 111;
+
+inline uint8_t ClampToByte(int value) {
+  return static_cast<uint8_t>(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+// @return the angle between the viewing directions of two camera poses.
+float GetViewAngle(const glm::mat4& a_T_camera, const glm::mat4& b_T_camera) {
+  const float cosine = glm::dot(glm::normalize(glm::vec3(a_T_camera[2])),
+                                glm::normalize(glm::vec3(b_T_camera[2])));
+  return std::acos(std::max(-1.0f, std::min(cosine, 1.0f)));
+}
+}  // namespace
+
+namespace tango_util {
+
+KeyframeStore::Options::Options()
+    : capacity(24),
+      downsample(4),
+      min_translation(0.3f),
+      min_angle(0.35f),
+      candidate_window(6) {}
+
+KeyframeStore::KeyframeStore(const Options& options)
+    : capacity_(std::max(options.capacity, 1)),
+      downsample_(std::max(options.downsample, 1)),
+      min_translation_(options.min_translation),
+      min_angle_(options.min_angle),
+      candidate_window_(std::max(options.candidate_window, 1)),
+      max_width_(0),
+      max_height_(0),
+      window_remaining_(0),
+      best_sharpness_(0.0f),
+      has_warned_format_(false),
+      is_candidate_ready_(false),
+      keyframe_count_(0) {}
+
+void KeyframeStore::Initialize(int max_width, int max_height) {
+  max_width_ = max_width;
+  max_height_ = max_height;
+  const size_t slot_size = static_cast<size_t>(max_width / downsample_) *
+                           (max_height / downsample_) * 3;
+  slots_.resize(capacity_);
+  for (Slot& slot : slots_) {
+    slot.rgb.reserve(slot_size);
+  }
+  candidate_.rgb.reserve(slot_size);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  keyframe_poses_.clear();
+  keyframe_poses_.reserve(capacity_);
+  is_candidate_ready_ = false;
+  keyframe_count_ = 0;
+}
+
+bool KeyframeStore::OnFrameAvailable(const TangoImageBuffer* buffer,
+                                     const glm::mat4& world_T_camera) {
+  if (buffer->format != TANGO_HAL_PIXEL_FORMAT_YCrCb_420_SP) {
+    if (!has_warned_format_) {
+      has_warned_format_ = true;
+      LOGE("KeyframeStore: Unsupported image format %d", buffer->format);
+    }
+    return false;
+  }
+  if (static_cast<int>(buffer->width) > max_width_ ||
+      static_cast<int>(buffer->height) > max_height_) {
+    if (!has_warned_format_) {
+      has_warned_format_ = true;
+      LOGE("KeyframeStore: %ux%u image larger than the %dx%d slots",
+           buffer->width, buffer->height, max_width_, max_height_);
+    }
+    return false;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // The candidate slot is the consumer's until it commits it.
+    if (is_candidate_ready_) {
+      return false;
+    }
+    if (window_remaining_ == 0) {
+      if (!IsNovelLocked(world_T_camera)) {
+        return false;
+      }
+      window_remaining_ = candidate_window_;
+      best_sharpness_ = -1.0f;
+    }
+  }
+
+  --window_remaining_;
+  const float sharpness = ComputeSharpness(buffer);
+  const bool is_best = sharpness > best_sharpness_;
+  if (is_best) {
+    best_sharpness_ = sharpness;
+    Downsample(buffer, &candidate_);
+    Keyframe& keyframe = candidate_.keyframe;
+    keyframe.timestamp = buffer->timestamp;
+    keyframe.world_T_camera = world_T_camera;
+    keyframe.camera_T_world =
+        tango_gl::simd_math::InverseRigid(world_T_camera);
+    keyframe.sharpness = sharpness;
+  }
+  if (window_remaining_ == 0) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    is_candidate_ready_ = true;
+  }
+  return is_best;
+}
+
+int KeyframeStore::Commit() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!is_candidate_ready_) {
+    return -1;
+  }
+  is_candidate_ready_ = false;
+  const glm::mat4& world_T_candidate = candidate_.keyframe.world_T_camera;
+
+  int index = keyframe_count_;
+  if (keyframe_count_ == capacity_) {
+    // Replace the keyframe closest to another one, the candidate included.
+    float min_distance = std::numeric_limits<float>::max();
+    for (int i = 0; i < keyframe_count_; ++i) {
+      const glm::mat4& world_T_keyframe = keyframe_poses_[i];
+      float distance = GetPoseDistance(world_T_keyframe, world_T_candidate);
+      for (int j = 0; j < keyframe_count_; ++j) {
+        if (j != i) {
+          distance = std::min(
+              distance, GetPoseDistance(world_T_keyframe, keyframe_poses_[j]));
+        }
+      }
+      if (distance < min_distance) {
+        min_distance = distance;
+        index = i;
+      }
+    }
+  } else {
+    ++keyframe_count_;
+    keyframe_poses_.push_back(glm::mat4());
+  }
+
+  // The slots trade their storage, nothing is copied or allocated.
+  Slot& slot = slots_[index];
+  slot.rgb.swap(candidate_.rgb);
+  slot.keyframe = candidate_.keyframe;
+  slot.keyframe.rgb = slot.rgb.data();
+  keyframe_poses_[index] = world_T_candidate;
+  return index;
+}
+
+void KeyframeStore::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  keyframe_poses_.clear();
+  is_candidate_ready_ = false;
+  keyframe_count_ = 0;
+}
+
+bool KeyframeStore::IsNovelLocked(const glm::mat4& world_T_camera) const {
+  const glm::vec3 position(world_T_camera[3]);
+  for (const glm::mat4& keyframe_pose : keyframe_poses_) {
+    if (glm::distance(position, glm::vec3(keyframe_pose[3])) <
+            min_translation_ &&
+        GetViewAngle(world_T_camera, keyframe_pose) < min_angle_) {
+      return false;
+    }
+  }
+  return true;
+}
+
+float KeyframeStore::GetPoseDistance(const glm::mat4& a_T_camera,
+                                     const glm::mat4& b_T_camera) const {
+  return glm::distance(glm::vec3(a_T_camera[3]), glm::vec3(b_T_camera[3])) /
+             min_translation_ +
+         GetViewAngle(a_T_camera, b_T_camera) / min_angle_;
+}
+
+float KeyframeStore::ComputeSharpness(const TangoImageBuffer* buffer) const {
+  // Blur flattens the differences between neighboring pixels, so they are
+  // taken at full resolution, on a sparse grid.
+  const uint8_t* luminance = buffer->data;
+  const int stride = static_cast<int>(buffer->stride);
+  const int width = static_cast<int>(buffer->width) - 1;
+  const int height = static_cast<int>(buffer->height) - 1;
+  uint64_t energy = 0;
+  uint32_t count = 0;
+  for (int y = 0; y < height; y += downsample_) {
+    const uint8_t* row = luminance + y * stride;
+    for (int x = 0; x < width; x += downsample_) {
+      const int dx = row[x + 1] - row[x];
+      const int dy = row[x + stride] - row[x];
+      energy += dx * dx + dy * dy;
+      ++count;
+    }
+  }
+  return count > 0 ? static_cast<float>(energy) / count : 0.0f;
+}
+
+void KeyframeStore::Downsample(const TangoImageBuffer* buffer,
+                               Slot* slot) const {
+  const int width = static_cast<int>(buffer->width) / downsample_;
+  const int height = static_cast<int>(buffer->height) / downsample_;
+  const int stride = static_cast<int>(buffer->stride);
+  // The VU plane follows the Y plane, one VU pair per 2x2 pixels.
+  const uint8_t* luminance = buffer->data;
+  const uint8_t* chrominance = luminance + stride * buffer->height;
+  // Each pixel averages the 2x2 pixels at the center of its cell, which
+  // share their VU pair.
+  const int offset = (downsample_ / 2) & ~1;
+
+  slot->rgb.resize(static_cast<size_t>(width) * height * 3);
+  uint8_t* rgb = slot->rgb.data();
+  for (int y = 0; y < height; ++y) {
+    const int source_y = y * downsample_ + offset;
+    const uint8_t* row_0 = luminance + source_y * stride;
+    const uint8_t* row_1 =
+        source_y + 1 < static_cast<int>(buffer->height) ? row_0 + stride
+                                                        : row_0;
+    const uint8_t* vu_row = chrominance + (source_y / 2) * stride;
+    for (int x = 0; x < width; ++x) {
+      const int source_x = x * downsample_ + offset;
+      const int next_x =
+          source_x + 1 < static_cast<int>(buffer->width) ? source_x + 1
+                                                         : source_x;
+      const int average = (row_0[source_x] + row_0[next_x] + row_1[source_x] +
+                           row_1[next_x] + 2) >> 2;
+      const int vu_index = source_x & ~1;
+      const int v = vu_row[vu_index] - 128;
+      const int u = vu_row[vu_index + 1] - 128;
+      const int luma = (average << kFixedPointShift) + kFixedPointRound;
+      rgb[0] = ClampToByte((luma + kVToR * v) >> kFixedPointShift);
+      rgb[1] = ClampToByte((luma - kVToG * v - kUToG * u) >> kFixedPointShift);
+      rgb[2] = ClampToByte((luma + kUToB * u) >> kFixedPointShift);
+      rgb += 3;
+    }
+  }
+  Keyframe& keyframe = slot->keyframe;
+  keyframe.image_width = static_cast<int>(buffer->width);
+  keyframe.image_height = static_cast<int>(buffer->height);
+  keyframe.width = width;
+  keyframe.height = height;
+  keyframe.rgb = slot->rgb.data();
+}
+
+}  // namespace tango_util
@@ -0,0 +1,309 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/latency_tracker.h"
+
+#include <EGL/egl.h>
+#include <time.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include <tango-gl/util.h>
+
+namespace {
+const double kBucketSize = 0.0005;
+
+// Arrivals kept for the frames to be drawn, about a second of the camera.
+const size_t kMaxArrivalCount = 32;
+
+// Frames kept waiting for their presentation time. The compositor keeps the
+// timestamps of the last few frames only.
+const size_t kMaxPendingFrameCount = 8;
+
+// EGL_ANDROID_get_frame_timestamps, which the EGL headers of older NDKs do
+// not declare.
+const EGLint kEglTimestampsAndroid = 0x3430;
+const EGLint kEglDisplayPresentTimeAndroid = 0x343A;
+const int64_t kEglTimestampPendingAndroid = -2;
+
+typedef EGLBoolean(EGLAPIENTRYP GetNextFrameIdFunction)(EGLDisplay,
+                                                        EGLSurface,
+                                                        uint64_t*);
+typedef EGLBoolean(EGLAPIENTRYP GetFrameTimestampsFunction)(
+    EGLDisplay, EGLSurface, uint64_t, EGLint, const EGLint*, int64_t*);
+typedef EGLBoolean(EGLAPIENTRYP GetFrameTimestampSupportedFunction)(
+    EGLDisplay, EGLSurface, EGLint);
+
+struct FrameTimestampsApi {
+  GetNextFrameIdFunction get_next_frame_id;
+  GetFrameTimestampsFunction get_frame_timestamps;
+  GetFrameTimestampSupportedFunction get_frame_timestamp_supported;
+};
+
+FrameTimestampsApi* LoadFrameTimestampsApi() {
+  FrameTimestampsApi* api = new FrameTimestampsApi();
+  api->get_next_frame_id = reinterpret_cast<GetNextFrameIdFunction>(
+      eglGetProcAddress("eglGetNextFrameIdANDROID"));
+  api->get_frame_timestamps = reinterpret_cast<GetFrameTimestampsFunction>(
+      eglGetProcAddress("eglGetFrameTimestampsANDROID"));
+  api->get_frame_timestamp_supported =
+      reinterpret_cast<GetFrameTimestampSupportedFunction>(
+          eglGetProcAddress("eglGetFrameTimestampSupportedANDROID"));
+  return api;
+}
+
+const FrameTimestampsApi& GetFrameTimestampsApi() {
+  static FrameTimestampsApi* api = LoadFrameTimestampsApi();
+  return *api;
+}
+
+double GetMonotonicTime() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec * 1e-9;
+}
+}  // namespace
+
+namespace tango_util {
+
+const int LatencyTracker::kBucketCount;
+
+LatencyTracker::Histogram::Histogram() : count(0), total(0.0), max(0.0) {
+  memset(counts, 0, sizeof(counts));
+}
+
+LatencyTracker::LatencyTracker(const PosePredictor* clock)
+    : clock_(clock),
+      last_rendered_timestamp_(0.0),
+      surface_(nullptr),
+      is_surface_timed_(false) {}
+
+void LatencyTracker::OnFrameAvailable(double timestamp) {
+  const double now = GetMonotonicTime();
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (arrivals_.size() == kMaxArrivalCount) {
+    arrivals_.pop_front();
+  }
+  Arrival arrival;
+  arrival.timestamp = timestamp;
+  arrival.time = now;
+  arrivals_.push_back(arrival);
+}
+
+void LatencyTracker::OnFrameRendered(double timestamp) {
+  const double now = GetMonotonicTime();
+  if (timestamp > 0.0 && timestamp != last_rendered_timestamp_) {
+    last_rendered_timestamp_ = timestamp;
+    double capture_time;
+    if (clock_->ToMonotonicTime(timestamp, &capture_time)) {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Arrival arrival;
+        if (TakeArrival(timestamp, &arrival)) {
+          AddSample(kCaptureToCallback, arrival.time - capture_time);
+          AddSample(kCallbackToRender, now - arrival.time);
+        }
+      }
+      TrackPresentTime(capture_time, now);
+    }
+  }
+  CollectPresentTimes();
+}
+
+bool LatencyTracker::TakeArrival(double timestamp, Arrival* arrival) {
+  // The newest arrival of the timestamp, or else of an unknown one, which is
+  // the image the texture was just updated to.
+  auto found = arrivals_.end();
+  for (auto it = arrivals_.begin(); it != arrivals_.end(); ++it) {
+    if (it->timestamp == timestamp) {
+      found = it;
+    } else if (it->timestamp == 0.0 &&
+               (found == arrivals_.end() || found->timestamp == 0.0)) {
+      found = it;
+    }
+  }
+  if (found == arrivals_.end()) {
+    return false;
+  }
+  *arrival = *found;
+  // The older frames will not be drawn anymore.
+  arrivals_.erase(arrivals_.begin(), found + 1);
+  return true;
+}
+
+void LatencyTracker::AddSample(Stage stage, double latency) {
+  latency = std::max(latency, 0.0);
+  Histogram& histogram = histograms_[stage];
+  const int bucket =
+      std::min(static_cast<int>(latency / kBucketSize), kBucketCount - 1);
+  ++histogram.counts[bucket];
+  ++histogram.count;
+  histogram.total += latency;
+  histogram.max = std::max(histogram.max, latency);
+}
+
+void LatencyTracker::TrackPresentTime(double capture_time,
+                                      double render_time) {
+  const FrameTimestampsApi& api = GetFrameTimestampsApi();
+  if (api.get_next_frame_id == nullptr || api.get_frame_timestamps == nullptr) {
+    return;
+  }
+  const EGLDisplay display = eglGetCurrentDisplay();
+  const EGLSurface surface = eglGetCurrentSurface(EGL_DRAW);
+  if (surface == EGL_NO_SURFACE) {
+    return;
+  }
+  if (surface != surface_) {
+    // The frame ids are those of the surface, a new one starts over.
+    surface_ = surface;
+    pending_frames_.clear();
+    is_surface_timed_ =
+        eglSurfaceAttrib(display, surface, kEglTimestampsAndroid, EGL_TRUE) &&
+        (api.get_frame_timestamp_supported == nullptr ||
+         api.get_frame_timestamp_supported(display, surface,
+                                           kEglDisplayPresentTimeAndroid));
+    if (!is_surface_timed_) {
+      LOGI("LatencyTracker: the surface has no present times");
+    }
+  }
+  PendingFrame frame;
+  if (!is_surface_timed_ ||
+      !api.get_next_frame_id(display, surface, &frame.frame_id)) {
+    return;
+  }
+  frame.capture_time = capture_time;
+  frame.render_time = render_time;
+  if (pending_frames_.size() == kMaxPendingFrameCount) {
+    pending_frames_.pop_front();
+  }
+  pending_frames_.push_back(frame);
+}
+
+void LatencyTracker::CollectPresentTimes() {
+  if (pending_frames_.empty()) {
+    return;
+  }
+  const FrameTimestampsApi& api = GetFrameTimestampsApi();
+  const EGLDisplay display = eglGetCurrentDisplay();
+  const EGLSurface surface = eglGetCurrentSurface(EGL_DRAW);
+  if (surface != surface_) {
+    return;
+  }
+  while (!pending_frames_.empty()) {
+    const PendingFrame& frame = pending_frames_.front();
+    int64_t present_time = 0;
+    if (!api.get_frame_timestamps(display, surface, frame.frame_id, 1,
+                                  &kEglDisplayPresentTimeAndroid,
+                                  &present_time)) {
+      // The frame of this call is not swapped yet, an older one is not
+      // kept anymore.
+      if (pending_frames_.size() == 1) {
+        break;
+      }
+      pending_frames_.pop_front();
+      continue;
+    }
+    if (present_time == kEglTimestampPendingAndroid) {
+      break;
+    }
+    if (present_time > 0) {
+      const double present_seconds = present_time * 1e-9;
+      std::lock_guard<std::mutex> lock(mutex_);
+      AddSample(kRenderToPresent, present_seconds - frame.render_time);
+      AddSample(kCaptureToPresent, present_seconds - frame.capture_time);
+    }
+    pending_frames_.pop_front();
+  }
+}
+
+LatencyTracker::StageStatistics LatencyTracker::GetStatistics(
+    Stage stage) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const Histogram& histogram = histograms_[stage];
+  StageStatistics statistics;
+  statistics.count = histogram.count;
+  statistics.average_ms = 0.0;
+  statistics.percentile_50_ms = 0.0;
+  statistics.percentile_95_ms = 0.0;
+  statistics.max_ms = histogram.max * 1000.0;
+  if (histogram.count == 0) {
+    return statistics;
+  }
+  statistics.average_ms = histogram.total / histogram.count * 1000.0;
+  // The upper bound of the buckets the percentiles fall in, at most the
+  // longest latency.
+  const uint64_t count_50 = (histogram.count + 1) / 2;
+  const uint64_t count_95 = (histogram.count * 95 + 99) / 100;
+  uint64_t count = 0;
+  for (int bucket = 0; bucket < kBucketCount; ++bucket) {
+    const uint64_t previous_count = count;
+    count += histogram.counts[bucket];
+    const double bound =
+        std::min((bucket + 1) * kBucketSize, histogram.max) * 1000.0;
+    if (previous_count < count_50 && count >= count_50) {
+      statistics.percentile_50_ms = bound;
+    }
+    if (previous_count < count_95 && count >= count_95) {
+      statistics.percentile_95_ms = bound;
+      break;
+    }
+  }
+  return statistics;
+}
+
+void LatencyTracker::Reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (Histogram& histogram : histograms_) {
+    histogram = Histogram();
+  }
+}
+
+std::string LatencyTracker::FormatReport() const {
+  std::string report = "{";
+  for (int stage = 0; stage < kStageCount; ++stage) {
+    const StageStatistics statistics =
+        GetStatistics(static_cast<Stage>(stage));
+    char buffer[192];
+    snprintf(buffer, sizeof(buffer),
+             "%s\"%s\":{\"count\":%llu,\"average_ms\":%.2f,\"p50_ms\":%.2f,"
+             "\"p95_ms\":%.2f,\"max_ms\":%.2f}",
+             stage == 0 ? "" : ",", GetStageName(static_cast<Stage>(stage)),
+             static_cast<unsigned long long>(statistics.count),
+             statistics.average_ms, statistics.percentile_50_ms,
+             statistics.percentile_95_ms, statistics.max_ms);
+    report += buffer;
+  }
+  report += "}";
+  return report;
+}
+
+const char* LatencyTracker::GetStageName(Stage stage) {
+  switch (stage) {
+    case kCaptureToCallback:
+      return "capture_to_callback";
+    case kCallbackToRender:
+      return "callback_to_render";
+    case kRenderToPresent:
+      return "render_to_present";
+    case kCaptureToPresent:
+      return "capture_to_present";
+    default:
+      return "unknown";
+  }
+}
+}  // namespace tango_util
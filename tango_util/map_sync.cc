@@ -0,0 +1,935 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/map_sync.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <random>
+
+#include <tango-gl/util.h>
+
+#include "tango-util/thread_policy.h"
+
+namespace {
+const char kMessageMagic[4] = {'T', 'M', 'A', 'P'};
+const uint8_t kProtocolVersion = 1;
+
+enum MessageType : uint8_t {
+  kHelloMessage = 0,
+  kTileMessage = 1,
+  kResyncMessage = 2,
+  kAnchorsMessage = 3
+};
+
+// The header of every datagram, followed by the message of its type.
+struct MessageHeader {
+  char magic[4];
+  uint8_t version;
+  uint8_t type;
+  uint16_t reserved;
+  uint32_t device_id;
+  uint32_t area_description_hash;
+  // Datagrams of the device before this one, for the losses to be counted.
+  uint32_t sequence;
+};
+
+struct HelloMessage {
+  // Position of the device in the area description frame.
+  float position[3];
+  uint32_t tile_count;
+};
+
+// A fragment of a tile frame, followed by its bytes.
+struct TileFragment {
+  int16_t tile[3];
+  uint8_t fragment_index;
+  uint8_t fragment_count;
+  uint32_t version;
+  uint32_t frame_size;
+  // Of the bytes of the fragment in the frame.
+  uint32_t offset;
+};
+
+// Asks |device_id| for an intra frame of a tile.
+struct ResyncMessage {
+  uint32_t device_id;
+  int16_t tile[3];
+  uint16_t reserved;
+};
+
+// Followed by |count| AnchorRecords.
+struct AnchorsMessage {
+  uint32_t count;
+};
+
+struct AnchorRecord {
+  int32_t id;
+  // w, x, y and z.
+  float rotation[4];
+  float translation[3];
+};
+
+// Longest wait for a datagram, and so the latency of sending.
+const int kPollTimeoutMs = 10;
+const std::chrono::seconds kHelloInterval(1);
+// Anchors are sent again now and then, for those lost on the way.
+const std::chrono::seconds kAnchorInterval(2);
+// Peers not heard from for this long have left.
+const std::chrono::seconds kPeerTimeout(5);
+// Intra frames of a tile asked for at most this often.
+const std::chrono::seconds kResyncInterval(1);
+// The tiles changed since the last sort wait for this long at most.
+const std::chrono::milliseconds kSortInterval(250);
+
+// Seconds of budget the bucket holds, the longest burst.
+const double kBurstDuration = 0.25;
+
+const int kMaxCellsPerAxis = 1024;
+// Cells are kept within the tiles an int16_t indexes.
+const float kMaxTileCoordinate = 32000.0f;
+
+// Largest UDP datagram.
+const size_t kMaxReceivedSize = 65536;
+
+// Poses of an anchor moving less than that are not sent again.
+const float kAnchorTolerance = 1e-4f;
+
+// @return: the 32 bit FNV-1a hash of |text|.
+uint32_t HashString(const char* text) {
+  uint32_t hash = 2166136261u;
+  for (const char* c = text; *c != '\0'; ++c) {
+    hash = (hash ^ static_cast<uint8_t>(*c)) * 16777619u;
+  }
+  return hash;
+}
+
+// @return: |value| / |divisor| rounded down.
+int FloorDivide(int value, int divisor) {
+  return value >= 0 ? value / divisor : -((-value - 1) / divisor) - 1;
+}
+
+bool IsSameAnchor(const tango_gl::RigidTransform& a,
+                  const tango_gl::RigidTransform& b) {
+  return glm::distance(a.GetTranslation(), b.GetTranslation()) <
+             kAnchorTolerance &&
+         std::abs(glm::dot(a.GetRotation(), b.GetRotation())) >
+             1.0f - kAnchorTolerance;
+}
+}  // namespace
+
+namespace tango_util {
+
+const int MapSync::kMaxFragmentCount;
+
+MapSync::Options::Options()
+    : tile_size(2.0f),
+      precision(0.05f),
+      max_cells_per_tile(16384),
+      max_tile_count(4096),
+      point_stride(4),
+      keyframe_interval(30),
+      max_bytes_per_second(64 * 1024),
+      max_datagram_size(1400) {}
+
+MapSync::MapSync()
+    : is_sharing_(false),
+      socket_(-1),
+      port_(0),
+      cells_per_tile_(1),
+      device_id_(0),
+      area_description_hash_(0),
+      has_tiles_to_send_(false),
+      has_new_anchor_(false),
+      position_(0.0f),
+      next_tile_to_send_(0),
+      sequence_(0),
+      tokens_(0.0),
+      peer_count_(0),
+      tile_count_(0),
+      tiles_sent_(0),
+      tiles_received_(0),
+      bytes_sent_(0),
+      bytes_received_(0),
+      lost_datagram_count_(0),
+      dropped_datagram_count_(0),
+      resync_count_(0) {}
+
+MapSync::~MapSync() { Stop(); }
+
+bool MapSync::Start(const char* area_description_uuid, int port,
+                    const Options& options) {
+  Stop();
+  const size_t min_datagram_size =
+      sizeof(MessageHeader) + sizeof(AnchorsMessage) + sizeof(AnchorRecord);
+  if (options.max_datagram_size < min_datagram_size ||
+      options.max_datagram_size > kMaxReceivedSize) {
+    LOGE("MapSync: datagrams of %d bytes are not supported",
+         static_cast<int>(options.max_datagram_size));
+    return false;
+  }
+  const float cells_per_tile =
+      options.precision > 0.0f ? std::round(options.tile_size /
+                                            options.precision)
+                               : 0.0f;
+  if (!(cells_per_tile >= 1.0f && cells_per_tile <= kMaxCellsPerAxis)) {
+    LOGE("MapSync: tiles of %f m with cells of %f m are not supported",
+         options.tile_size, options.precision);
+    return false;
+  }
+
+  socket_ = socket(AF_INET, SOCK_DGRAM, 0);
+  if (socket_ < 0) {
+    LOGE("MapSync: failed to open a socket: %s", strerror(errno));
+    return false;
+  }
+  // Every app of the device on |port| gets the broadcasts, for a viewer to
+  // run along with it.
+  const int enabled = 1;
+  struct sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  address.sin_port = htons(static_cast<uint16_t>(port));
+  if (setsockopt(socket_, SOL_SOCKET, SO_REUSEADDR, &enabled,
+                 sizeof(enabled)) != 0 ||
+      setsockopt(socket_, SOL_SOCKET, SO_BROADCAST, &enabled,
+                 sizeof(enabled)) != 0 ||
+      bind(socket_, reinterpret_cast<struct sockaddr*>(&address),
+           sizeof(address)) != 0 ||
+      fcntl(socket_, F_SETFL, fcntl(socket_, F_GETFL) | O_NONBLOCK) != 0) {
+    LOGE("MapSync: failed to listen on port %d: %s", port, strerror(errno));
+    close(socket_);
+    socket_ = -1;
+    return false;
+  }
+
+  options_ = options;
+  port_ = port;
+  cells_per_tile_ = static_cast<int>(cells_per_tile);
+  std::random_device random_device;
+  do {
+    device_id_ = random_device();
+  } while (device_id_ == 0);
+  area_description_hash_ = HashString(area_description_uuid);
+  {
+    std::lock_guard<std::mutex> lock(local_mutex_);
+    local_tiles_.clear();
+    local_anchors_.clear();
+    has_tiles_to_send_ = false;
+    has_new_anchor_ = false;
+    position_ = glm::vec3(0.0f);
+  }
+  {
+    std::lock_guard<std::mutex> lock(remote_mutex_);
+    tile_updates_.clear();
+    remote_anchors_.clear();
+  }
+  peers_.clear();
+  tiles_to_send_.clear();
+  next_tile_to_send_ = 0;
+  payload_.resize(options_.max_datagram_size - sizeof(MessageHeader));
+  received_.resize(kMaxReceivedSize);
+  sequence_ = 0;
+  tokens_ = 0.0;
+  const std::chrono::steady_clock::time_point now =
+      std::chrono::steady_clock::now();
+  token_time_ = now;
+  sort_time_ = now;
+  // The first hello goes out at once.
+  hello_time_ = now - kHelloInterval;
+  anchor_time_ = now;
+  peer_count_.store(0);
+  tile_count_.store(0);
+  tiles_sent_.store(0);
+  tiles_received_.store(0);
+  bytes_sent_.store(0);
+  bytes_received_.store(0);
+  lost_datagram_count_.store(0);
+  dropped_datagram_count_.store(0);
+  resync_count_.store(0);
+
+  is_sharing_.store(true);
+  thread_ = std::thread(&MapSync::SyncLoop, this);
+  LOGI("MapSync: sharing the map as %08x on port %d", device_id_, port);
+  return true;
+}
+
+void MapSync::Stop() {
+  if (!is_sharing_.exchange(false)) {
+    return;
+  }
+  thread_.join();
+  close(socket_);
+  socket_ = -1;
+  LOGI(
+      "MapSync: sent %llu tiles in %llu bytes, received %llu tiles in %llu "
+      "bytes, lost %llu datagrams and dropped %llu",
+      static_cast<unsigned long long>(tiles_sent_.load()),
+      static_cast<unsigned long long>(bytes_sent_.load()),
+      static_cast<unsigned long long>(tiles_received_.load()),
+      static_cast<unsigned long long>(bytes_received_.load()),
+      static_cast<unsigned long long>(lost_datagram_count_.load()),
+      static_cast<unsigned long long>(dropped_datagram_count_.load()));
+}
+
+MapSync::TileKey MapSync::GetTileKey(const glm::ivec3& cell) const {
+  TileKey key;
+  key.x = static_cast<int16_t>(FloorDivide(cell.x, cells_per_tile_));
+  key.y = static_cast<int16_t>(FloorDivide(cell.y, cells_per_tile_));
+  key.z = static_cast<int16_t>(FloorDivide(cell.z, cells_per_tile_));
+  return key;
+}
+
+void MapSync::AddPoints(const TangoXYZij* xyz_ij,
+                        const glm::mat4& area_T_points) {
+  if (!is_sharing_.load() || xyz_ij == nullptr) {
+    return;
+  }
+  // The points are quantized straight into cells, the scale folded into the
+  // pose.
+  const glm::mat4 cells_T_points =
+      glm::scale(glm::mat4(1.0f), glm::vec3(1.0f / options_.precision)) *
+      area_T_points;
+  const float max_cell_coordinate = kMaxTileCoordinate * cells_per_tile_;
+  const uint32_t stride =
+      static_cast<uint32_t>(std::max(options_.point_stride, 1));
+  const size_t max_cells_per_tile =
+      static_cast<size_t>(std::max(options_.max_cells_per_tile, 0));
+
+  std::lock_guard<std::mutex> lock(local_mutex_);
+  position_ = glm::vec3(area_T_points[3]);
+  // The tile of the previous point, that of most points.
+  LocalTile* tile = nullptr;
+  TileKey tile_key = {0, 0, 0};
+  for (uint32_t i = 0; i < xyz_ij->xyz_count; i += stride) {
+    const float* point = xyz_ij->xyz[i];
+    const glm::vec3 cell_point(cells_T_points *
+                               glm::vec4(point[0], point[1], point[2], 1.0f));
+    // Also false for NaN.
+    if (!(std::abs(cell_point.x) < max_cell_coordinate &&
+          std::abs(cell_point.y) < max_cell_coordinate &&
+          std::abs(cell_point.z) < max_cell_coordinate)) {
+      continue;
+    }
+    const glm::ivec3 cell(glm::floor(cell_point));
+    const TileKey key = GetTileKey(cell);
+    if (tile == nullptr || !(key == tile_key)) {
+      tile_key = key;
+      auto found = local_tiles_.find(key);
+      if (found != local_tiles_.end()) {
+        tile = &found->second;
+      } else if (local_tiles_.size() <
+                 static_cast<size_t>(options_.max_tile_count)) {
+        tile = &local_tiles_[key];
+        tile->version = 0;
+        tile->sent_version = 0;
+        tile->requested_by = 0;
+        PointCloudEncoder::Options encoder_options;
+        encoder_options.precision = options_.precision;
+        encoder_options.keyframe_interval = options_.keyframe_interval;
+        tile->encoder.reset(new PointCloudEncoder(encoder_options));
+      } else {
+        tile = nullptr;
+        continue;
+      }
+    }
+    if (tile->cells.size() >= max_cells_per_tile) {
+      continue;
+    }
+    const glm::ivec3 tile_cell =
+        cell - glm::ivec3(key.x, key.y, key.z) * cells_per_tile_;
+    const uint32_t index = static_cast<uint32_t>(
+        (tile_cell.x * cells_per_tile_ + tile_cell.y) * cells_per_tile_ +
+        tile_cell.z);
+    if (tile->cells.insert(index).second) {
+      ++tile->version;
+      has_tiles_to_send_ = true;
+    }
+  }
+  tile_count_.store(static_cast<int>(local_tiles_.size()));
+}
+
+void MapSync::SetAnchor(int id,
+                        const tango_gl::RigidTransform& area_T_anchor) {
+  if (!is_sharing_.load()) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(local_mutex_);
+  auto found = local_anchors_.find(id);
+  if (found != local_anchors_.end() &&
+      IsSameAnchor(found->second, area_T_anchor)) {
+    return;
+  }
+  local_anchors_[id] = area_T_anchor;
+  has_new_anchor_ = true;
+}
+
+void MapSync::TakeRemoteTileUpdates(std::vector<TileUpdate>* updates) {
+  updates->clear();
+  std::lock_guard<std::mutex> lock(remote_mutex_);
+  // The points are moved, not copied.
+  for (auto& key_update : tile_updates_) {
+    updates->push_back(std::move(key_update.second));
+  }
+  tile_updates_.clear();
+}
+
+void MapSync::TakeRemoteAnchors(std::vector<RemoteAnchor>* anchors) {
+  anchors->clear();
+  std::lock_guard<std::mutex> lock(remote_mutex_);
+  anchors->swap(remote_anchors_);
+}
+
+MapSync::Stats MapSync::GetStats() const {
+  Stats stats;
+  stats.peer_count = peer_count_.load();
+  stats.tile_count = tile_count_.load();
+  stats.tiles_sent = tiles_sent_.load();
+  stats.tiles_received = tiles_received_.load();
+  stats.bytes_sent = bytes_sent_.load();
+  stats.bytes_received = bytes_received_.load();
+  stats.lost_datagram_count = lost_datagram_count_.load();
+  stats.dropped_datagram_count = dropped_datagram_count_.load();
+  stats.resync_count = resync_count_.load();
+  return stats;
+}
+
+void MapSync::SyncLoop() {
+  ThreadPolicy::Get().Enter(ThreadPolicy::kBulkStage);
+  struct pollfd descriptor;
+  descriptor.fd = socket_;
+  descriptor.events = POLLIN;
+  while (is_sharing_.load()) {
+    descriptor.revents = 0;
+    if (poll(&descriptor, 1, kPollTimeoutMs) > 0) {
+      // Every datagram waiting is handled before sending.
+      ssize_t size;
+      while ((size = recv(socket_, received_.data(), received_.size(),
+                          MSG_DONTWAIT)) >= 0) {
+        Receive(received_.data(), static_cast<size_t>(size));
+      }
+    }
+    const std::chrono::steady_clock::time_point now =
+        std::chrono::steady_clock::now();
+    RefillTokens();
+    if (now - hello_time_ >= kHelloInterval) {
+      hello_time_ = now;
+      ForgetSilentPeers();
+      SendHello();
+    }
+    SendAnchors();
+    SendTiles();
+  }
+}
+
+void MapSync::Receive(const uint8_t* data, size_t size) {
+  MessageHeader header;
+  if (size < sizeof(header)) {
+    return;
+  }
+  memcpy(&header, data, sizeof(header));
+  // The broadcasts of the device itself come back to it.
+  if (memcmp(header.magic, kMessageMagic, sizeof(header.magic)) != 0 ||
+      header.version != kProtocolVersion || header.device_id == device_id_ ||
+      header.area_description_hash != area_description_hash_) {
+    return;
+  }
+  bytes_received_ += size;
+  data += sizeof(header);
+  size -= sizeof(header);
+  if (header.type == kHelloMessage) {
+    ReceiveHello(header.device_id, header.sequence, data, size);
+    return;
+  }
+  // A peer is only known from its hello, which holds where it is.
+  auto found = peers_.find(header.device_id);
+  if (found == peers_.end()) {
+    return;
+  }
+  Peer* peer = &found->second;
+  const int32_t sequence_gap =
+      static_cast<int32_t>(header.sequence - peer->next_sequence);
+  if (sequence_gap >= 0) {
+    lost_datagram_count_ += sequence_gap;
+    peer->next_sequence = header.sequence + 1;
+  }
+  switch (header.type) {
+    case kTileMessage:
+      ReceiveTile(header.device_id, peer, data, size);
+      break;
+    case kResyncMessage:
+      ReceiveResync(header.device_id, data, size);
+      break;
+    case kAnchorsMessage:
+      ReceiveAnchors(header.device_id, peer, data, size);
+      break;
+    default:
+      break;
+  }
+}
+
+void MapSync::ReceiveHello(uint32_t device_id, uint32_t sequence,
+                           const uint8_t* data, size_t size) {
+  HelloMessage hello;
+  if (size < sizeof(hello)) {
+    return;
+  }
+  memcpy(&hello, data, sizeof(hello));
+  const bool is_new_peer = peers_.count(device_id) == 0;
+  Peer& peer = peers_[device_id];
+  peer.position =
+      glm::vec3(hello.position[0], hello.position[1], hello.position[2]);
+  peer.hello_time = std::chrono::steady_clock::now();
+  if (!is_new_peer) {
+    const int32_t sequence_gap =
+        static_cast<int32_t>(sequence - peer.next_sequence);
+    if (sequence_gap >= 0) {
+      lost_datagram_count_ += sequence_gap;
+      peer.next_sequence = sequence + 1;
+    }
+    return;
+  }
+  peer.next_sequence = sequence + 1;
+  peer_count_.store(static_cast<int>(peers_.size()));
+  LOGI("MapSync: %08x joined, with %u tiles", device_id, hello.tile_count);
+
+  // The new peer gets the whole map, the tiles around it first.
+  std::lock_guard<std::mutex> lock(local_mutex_);
+  for (auto& key_tile : local_tiles_) {
+    ResendTile(device_id, &key_tile.second);
+  }
+  has_new_anchor_ = !local_anchors_.empty();
+}
+
+void MapSync::ResendTile(uint32_t device_id, LocalTile* tile) {
+  if (tile->cells.empty()) {
+    return;
+  }
+  tile->encoder->RequestIntraFrame();
+  tile->sent_version = tile->version - 1;
+  tile->requested_by = device_id;
+  has_tiles_to_send_ = true;
+}
+
+void MapSync::ReceiveTile(uint32_t device_id, Peer* peer, const uint8_t* data,
+                          size_t size) {
+  TileFragment fragment;
+  if (size < sizeof(fragment)) {
+    return;
+  }
+  memcpy(&fragment, data, sizeof(fragment));
+  data += sizeof(fragment);
+  size -= sizeof(fragment);
+  if (fragment.fragment_count == 0 ||
+      fragment.fragment_count > kMaxFragmentCount ||
+      fragment.fragment_index >= fragment.fragment_count ||
+      fragment.frame_size > kMaxFragmentCount * options_.max_datagram_size ||
+      fragment.offset > fragment.frame_size ||
+      size > fragment.frame_size - fragment.offset) {
+    return;
+  }
+  TileKey key;
+  key.x = fragment.tile[0];
+  key.y = fragment.tile[1];
+  key.z = fragment.tile[2];
+  std::unique_ptr<RemoteTile>& tile = peer->tiles[key];
+  if (!tile) {
+    tile.reset(new RemoteTile());
+    tile->has_version = false;
+    tile->decoded_version = 0;
+    tile->version = 0;
+    tile->fragment_mask = 0;
+  }
+  // Versions decoded already, or older than that, are late duplicates.
+  if (tile->has_version &&
+      static_cast<int32_t>(fragment.version - tile->decoded_version) <= 0) {
+    return;
+  }
+  // The fragments of a new version replace those of a frame not complete.
+  if (tile->fragment_mask == 0 || fragment.version != tile->version ||
+      fragment.frame_size != tile->frame.size()) {
+    tile->version = fragment.version;
+    tile->fragment_mask = 0;
+    tile->frame.resize(fragment.frame_size);
+  }
+  const uint32_t fragment_bit = 1u << fragment.fragment_index;
+  if ((tile->fragment_mask & fragment_bit) != 0) {
+    return;
+  }
+  memcpy(tile->frame.data() + fragment.offset, data, size);
+  tile->fragment_mask |= fragment_bit;
+  const uint32_t all_fragments =
+      fragment.fragment_count == 32 ? 0xffffffffu
+                                    : (1u << fragment.fragment_count) - 1;
+  if (tile->fragment_mask != all_fragments) {
+    return;
+  }
+  tile->fragment_mask = 0;
+
+  if (!tile->decoder.Decode(tile->frame.data(), tile->frame.size(),
+                            &decoded_points_)) {
+    // The deltas after a lost frame do not apply, the tile starts over from
+    // an intra frame.
+    ++resync_count_;
+    const std::chrono::steady_clock::time_point now =
+        std::chrono::steady_clock::now();
+    if (now - tile->resync_time >= kResyncInterval) {
+      tile->resync_time = now;
+      SendResync(device_id, key);
+    }
+    return;
+  }
+  tile->has_version = true;
+  tile->decoded_version = fragment.version;
+  ++tiles_received_;
+
+  std::lock_guard<std::mutex> lock(remote_mutex_);
+  TileUpdate& update = tile_updates_[std::make_pair(device_id, key)];
+  update.device_id = device_id;
+  update.tile[0] = key.x;
+  update.tile[1] = key.y;
+  update.tile[2] = key.z;
+  update.version = fragment.version;
+  // The buffer of the update not taken yet is decoded into next.
+  update.points.swap(decoded_points_);
+}
+
+void MapSync::ReceiveResync(uint32_t device_id, const uint8_t* data,
+                            size_t size) {
+  ResyncMessage resync;
+  if (size < sizeof(resync)) {
+    return;
+  }
+  memcpy(&resync, data, sizeof(resync));
+  if (resync.device_id != device_id_) {
+    return;
+  }
+  TileKey key;
+  key.x = resync.tile[0];
+  key.y = resync.tile[1];
+  key.z = resync.tile[2];
+  std::lock_guard<std::mutex> lock(local_mutex_);
+  auto found = local_tiles_.find(key);
+  if (found != local_tiles_.end()) {
+    ResendTile(device_id, &found->second);
+  }
+}
+
+void MapSync::ReceiveAnchors(uint32_t device_id, Peer* peer,
+                             const uint8_t* data, size_t size) {
+  AnchorsMessage message;
+  if (size < sizeof(message)) {
+    return;
+  }
+  memcpy(&message, data, sizeof(message));
+  data += sizeof(message);
+  size -= sizeof(message);
+  const size_t count =
+      std::min<size_t>(message.count, size / sizeof(AnchorRecord));
+  std::vector<RemoteAnchor> anchors;
+  for (size_t i = 0; i < count; ++i) {
+    AnchorRecord record;
+    memcpy(&record, data + i * sizeof(record), sizeof(record));
+    const tango_gl::RigidTransform area_T_anchor(
+        glm::quat(record.rotation[0], record.rotation[1], record.rotation[2],
+                  record.rotation[3]),
+        glm::vec3(record.translation[0], record.translation[1],
+                  record.translation[2]));
+    auto found = peer->anchors.find(record.id);
+    if (found != peer->anchors.end() &&
+        IsSameAnchor(found->second, area_T_anchor)) {
+      continue;
+    }
+    peer->anchors[record.id] = area_T_anchor;
+    RemoteAnchor anchor;
+    anchor.device_id = device_id;
+    anchor.id = record.id;
+    anchor.area_T_anchor = area_T_anchor;
+    anchors.push_back(anchor);
+  }
+  if (anchors.empty()) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(remote_mutex_);
+  remote_anchors_.insert(remote_anchors_.end(), anchors.begin(),
+                         anchors.end());
+}
+
+void MapSync::ForgetSilentPeers() {
+  const std::chrono::steady_clock::time_point now =
+      std::chrono::steady_clock::now();
+  for (auto peer = peers_.begin(); peer != peers_.end();) {
+    if (now - peer->second.hello_time < kPeerTimeout) {
+      ++peer;
+      continue;
+    }
+    LOGI("MapSync: %08x left", peer->first);
+    peer = peers_.erase(peer);
+  }
+  peer_count_.store(static_cast<int>(peers_.size()));
+}
+
+void MapSync::RefillTokens() {
+  const std::chrono::steady_clock::time_point now =
+      std::chrono::steady_clock::now();
+  const double elapsed =
+      std::chrono::duration<double>(now - token_time_).count();
+  token_time_ = now;
+  tokens_ = std::min(tokens_ + elapsed * options_.max_bytes_per_second,
+                     kBurstDuration * options_.max_bytes_per_second);
+}
+
+void MapSync::SendHello() {
+  HelloMessage hello;
+  {
+    std::lock_guard<std::mutex> lock(local_mutex_);
+    hello.position[0] = position_.x;
+    hello.position[1] = position_.y;
+    hello.position[2] = position_.z;
+    hello.tile_count = static_cast<uint32_t>(local_tiles_.size());
+  }
+  Send(kHelloMessage, reinterpret_cast<const uint8_t*>(&hello),
+       sizeof(hello));
+}
+
+void MapSync::SendAnchors() {
+  const std::chrono::steady_clock::time_point now =
+      std::chrono::steady_clock::now();
+  if (peers_.empty() || tokens_ <= 0.0) {
+    return;
+  }
+  const size_t max_record_count =
+      (payload_.size() - sizeof(AnchorsMessage)) / sizeof(AnchorRecord);
+  std::lock_guard<std::mutex> lock(local_mutex_);
+  if (local_anchors_.empty() ||
+      (!has_new_anchor_ && now - anchor_time_ < kAnchorInterval)) {
+    return;
+  }
+  has_new_anchor_ = false;
+  anchor_time_ = now;
+  // There are few anchors, all of them are sent whenever one changes.
+  AnchorsMessage message;
+  message.count = 0;
+  for (auto anchor = local_anchors_.begin(); anchor != local_anchors_.end();
+       ++anchor) {
+    const glm::quat& rotation = anchor->second.GetRotation();
+    const glm::vec3& translation = anchor->second.GetTranslation();
+    AnchorRecord record;
+    record.id = anchor->first;
+    record.rotation[0] = rotation.w;
+    record.rotation[1] = rotation.x;
+    record.rotation[2] = rotation.y;
+    record.rotation[3] = rotation.z;
+    record.translation[0] = translation.x;
+    record.translation[1] = translation.y;
+    record.translation[2] = translation.z;
+    memcpy(&payload_[sizeof(message) + message.count * sizeof(record)],
+           &record, sizeof(record));
+    ++message.count;
+    if (message.count == max_record_count ||
+        std::next(anchor) == local_anchors_.end()) {
+      memcpy(payload_.data(), &message, sizeof(message));
+      Send(kAnchorsMessage, payload_.data(),
+           sizeof(message) + message.count * sizeof(record));
+      message.count = 0;
+    }
+  }
+}
+
+void MapSync::SendTiles() {
+  if (peers_.empty() || tokens_ <= 0.0) {
+    return;
+  }
+  const std::chrono::steady_clock::time_point now =
+      std::chrono::steady_clock::now();
+  const bool is_queue_done = next_tile_to_send_ == tiles_to_send_.size();
+  if (is_queue_done || now - sort_time_ >= kSortInterval) {
+    std::lock_guard<std::mutex> lock(local_mutex_);
+    if (has_tiles_to_send_) {
+      has_tiles_to_send_ = false;
+      sort_time_ = now;
+      tiles_to_send_.clear();
+      next_tile_to_send_ = 0;
+      for (const auto& key_tile : local_tiles_) {
+        const LocalTile& tile = key_tile.second;
+        if (tile.version == tile.sent_version) {
+          continue;
+        }
+        const TileKey& key = key_tile.first;
+        const glm::vec3 center =
+            (glm::vec3(key.x, key.y, key.z) + 0.5f) *
+            (cells_per_tile_ * options_.precision);
+        // A tile sent again for a new peer is sorted by its distance to
+        // that peer, and the others by that to the nearest.
+        auto requester = peers_.find(tile.requested_by);
+        TileToSend tile_to_send;
+        tile_to_send.key = key;
+        if (requester != peers_.end()) {
+          tile_to_send.distance =
+              glm::distance(center, requester->second.position);
+        } else {
+          tile_to_send.distance = std::numeric_limits<float>::max();
+          for (const auto& id_peer : peers_) {
+            tile_to_send.distance =
+                std::min(tile_to_send.distance,
+                         glm::distance(center, id_peer.second.position));
+          }
+        }
+        tiles_to_send_.push_back(tile_to_send);
+      }
+      std::sort(tiles_to_send_.begin(), tiles_to_send_.end(),
+                [](const TileToSend& a, const TileToSend& b) {
+                  return a.distance < b.distance;
+                });
+    }
+  }
+  while (next_tile_to_send_ < tiles_to_send_.size() && tokens_ > 0.0) {
+    SendTile(tiles_to_send_[next_tile_to_send_].key);
+    ++next_tile_to_send_;
+  }
+}
+
+void MapSync::SendTile(const TileKey& key) {
+  PointCloudEncoder* encoder;
+  uint32_t version;
+  {
+    std::lock_guard<std::mutex> lock(local_mutex_);
+    auto found = local_tiles_.find(key);
+    if (found == local_tiles_.end() ||
+        found->second.version == found->second.sent_version) {
+      return;
+    }
+    LocalTile& tile = found->second;
+    // The centers of the cells, which the encoder quantizes back into them.
+    const glm::vec3 tile_origin =
+        glm::vec3(key.x, key.y, key.z) * static_cast<float>(cells_per_tile_);
+    tile_points_.resize(tile.cells.size() * 3);
+    float* point = tile_points_.data();
+    for (const uint32_t index : tile.cells) {
+      const glm::vec3 tile_cell(
+          index / (cells_per_tile_ * cells_per_tile_),
+          index / cells_per_tile_ % cells_per_tile_, index % cells_per_tile_);
+      const glm::vec3 center =
+          (tile_origin + tile_cell + 0.5f) * options_.precision;
+      point[0] = center.x;
+      point[1] = center.y;
+      point[2] = center.z;
+      point += 3;
+    }
+    version = tile.version;
+    tile.sent_version = version;
+    tile.requested_by = 0;
+    encoder = tile.encoder.get();
+  }
+  TangoXYZij xyz_ij;
+  memset(&xyz_ij, 0, sizeof(xyz_ij));
+  xyz_ij.xyz_count = static_cast<uint32_t>(tile_points_.size() / 3);
+  xyz_ij.xyz = reinterpret_cast<float(*)[3]>(tile_points_.data());
+  encoder->Encode(&xyz_ij, glm::mat4(1.0f), &frame_);
+
+  const size_t fragment_size = payload_.size() - sizeof(TileFragment);
+  const size_t fragment_count =
+      (frame_.size() + fragment_size - 1) / fragment_size;
+  if (fragment_count > static_cast<size_t>(kMaxFragmentCount)) {
+    LOGE("MapSync: a frame of %d bytes does not fit in the datagrams",
+         static_cast<int>(frame_.size()));
+    ++dropped_datagram_count_;
+    encoder->RequestIntraFrame();
+    return;
+  }
+  // The fragments of a frame go out together, even past the budget, which
+  // the next ones wait for.
+  TileFragment fragment;
+  fragment.tile[0] = key.x;
+  fragment.tile[1] = key.y;
+  fragment.tile[2] = key.z;
+  fragment.fragment_count = static_cast<uint8_t>(fragment_count);
+  fragment.version = version;
+  fragment.frame_size = static_cast<uint32_t>(frame_.size());
+  for (size_t i = 0; i < fragment_count; ++i) {
+    const size_t offset = i * fragment_size;
+    const size_t size = std::min(fragment_size, frame_.size() - offset);
+    fragment.fragment_index = static_cast<uint8_t>(i);
+    fragment.offset = static_cast<uint32_t>(offset);
+    memcpy(payload_.data(), &fragment, sizeof(fragment));
+    memcpy(payload_.data() + sizeof(fragment), frame_.data() + offset, size);
+    Send(kTileMessage, payload_.data(), sizeof(fragment) + size);
+  }
+  ++tiles_sent_;
+}
+
+void MapSync::SendResync(uint32_t device_id, const TileKey& key) {
+  ResyncMessage resync;
+  resync.device_id = device_id;
+  resync.tile[0] = key.x;
+  resync.tile[1] = key.y;
+  resync.tile[2] = key.z;
+  resync.reserved = 0;
+  Send(kResyncMessage, reinterpret_cast<const uint8_t*>(&resync),
+       sizeof(resync));
+}
+
+void MapSync::Send(uint8_t type, const uint8_t* payload, size_t size) {
+  MessageHeader header;
+  memcpy(header.magic, kMessageMagic, sizeof(header.magic));
+  header.version = kProtocolVersion;
+  header.type = type;
+  header.reserved = 0;
+  header.device_id = device_id_;
+  header.area_description_hash = area_description_hash_;
+  header.sequence = sequence_++;
+
+  struct sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_BROADCAST);
+  address.sin_port = htons(static_cast<uint16_t>(port_));
+  // As in NetworkStreamer, the kernel gathers the header and the payload.
+  struct iovec parts[2];
+  parts[0].iov_base = &header;
+  parts[0].iov_len = sizeof(header);
+  parts[1].iov_base = const_cast<uint8_t*>(payload);
+  parts[1].iov_len = size;
+  struct msghdr message;
+  memset(&message, 0, sizeof(message));
+  message.msg_name = &address;
+  message.msg_namelen = sizeof(address);
+  message.msg_iov = parts;
+  message.msg_iovlen = 2;
+  tokens_ -= sizeof(header) + size;
+  const ssize_t sent = sendmsg(socket_, &message, MSG_DONTWAIT | MSG_NOSIGNAL);
+  if (sent < 0) {
+    // EAGAIN when the socket buffer is full, the datagram is dropped.
+    ++dropped_datagram_count_;
+    return;
+  }
+  bytes_sent_ += sent;
+}
+
+}  // namespace tango_util
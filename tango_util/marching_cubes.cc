@@ -0,0 +1,139 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/marching_cubes.h"
+
+#include <cstring>
+
+namespace {
+using tango_util::marching_cubes::kEdgeCount;
+using tango_util::marching_cubes::kMaxTriangleCount;
+
+// The triangles of every configuration, built once from the faces of the
+// cube rather than typed in: on each face the surface crosses the edges
+// between inside and outside corners, and the crossings are joined around
+// every run of inside corners. Faces with two diagonal inside corners thus
+// always separate them, whichever cube the face is seen from, so the meshes
+// of neighboring cubes have no cracks. The segments of the six faces close
+// into loops, triangulated as fans.
+class TriangleTable {
+ public:
+  TriangleTable() {
+    for (int configuration = 0; configuration < 256; ++configuration) {
+      Build(configuration, triangles_[configuration]);
+    }
+  }
+
+  const int8_t* Get(uint8_t configuration) const {
+    return triangles_[configuration];
+  }
+
+ private:
+  static int EdgeBetween(int a, int b) {
+    const int bit = a ^ b;
+    const int axis = bit == 1 ? 0 : (bit == 2 ? 1 : 2);
+    const int corner = a < b ? a : b;
+    // The other two bits of the corner, in order, index the 4 edges.
+    int k = 0;
+    int position = 0;
+    for (int i = 0; i < 3; ++i) {
+      if (i == axis) {
+        continue;
+      }
+      k |= ((corner >> i) & 1) << position;
+      ++position;
+    }
+    return axis * 4 + k;
+  }
+
+  static void Build(int configuration, int8_t* triangles) {
+    // next[e] is the crossing that follows crossing e in its loop.
+    int next[kEdgeCount];
+    for (int e = 0; e < kEdgeCount; ++e) {
+      next[e] = -1;
+    }
+    for (int axis = 0; axis < 3; ++axis) {
+      const int u = (axis + 1) % 3;
+      const int v = (axis + 2) % 3;
+      for (int side = 0; side < 2; ++side) {
+        // The face corners, counterclockwise seen from outside the cube.
+        int corners[4];
+        const int uv[4][2] = {{0, 0}, {1, 0}, {1, 1}, {0, 1}};
+        for (int i = 0; i < 4; ++i) {
+          const int j = side == 1 ? i : 3 - i;
+          corners[i] = (side << axis) | (uv[j][0] << u) | (uv[j][1] << v);
+        }
+        for (int i = 0; i < 4; ++i) {
+          const int previous = corners[(i + 3) % 4];
+          if (!IsInside(configuration, corners[i]) ||
+              IsInside(configuration, previous)) {
+            continue;
+          }
+          // A run of inside corners starts at i, find where it ends.
+          int last = i;
+          while (IsInside(configuration, corners[(last + 1) % 4])) {
+            last = (last + 1) % 4;
+          }
+          next[EdgeBetween(previous, corners[i])] =
+              EdgeBetween(corners[last], corners[(last + 1) % 4]);
+        }
+      }
+    }
+
+    int count = 0;
+    bool is_visited[kEdgeCount] = {false};
+    for (int start = 0; start < kEdgeCount; ++start) {
+      if (next[start] < 0 || is_visited[start]) {
+        continue;
+      }
+      int loop[kEdgeCount];
+      int length = 0;
+      for (int e = start; !is_visited[e]; e = next[e]) {
+        is_visited[e] = true;
+        loop[length++] = e;
+      }
+      for (int i = 1; i + 1 < length && count < kMaxTriangleCount; ++i) {
+        triangles[3 * count] = static_cast<int8_t>(loop[0]);
+        triangles[3 * count + 1] = static_cast<int8_t>(loop[i]);
+        triangles[3 * count + 2] = static_cast<int8_t>(loop[i + 1]);
+        ++count;
+      }
+    }
+    triangles[3 * count] = -1;
+  }
+
+  static bool IsInside(int configuration, int corner) {
+    return (configuration >> corner) & 1;
+  }
+
+  int8_t triangles_[256][3 * kMaxTriangleCount + 1];
+};
+}  // namespace
+
+namespace tango_util {
+namespace marching_cubes {
+
+const int kEdgeCorners[kEdgeCount][2] = {
+    {0, 1}, {2, 3}, {4, 5}, {6, 7}, {0, 2}, {1, 3},
+    {4, 6}, {5, 7}, {0, 4}, {1, 5}, {2, 6}, {3, 7}};
+
+const int8_t* GetTriangles(uint8_t configuration) {
+  // Built on first use, thread safe in C++11.
+  static const TriangleTable table;
+  return table.Get(configuration);
+}
+}  // namespace marching_cubes
+}  // namespace tango_util
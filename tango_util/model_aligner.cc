@@ -0,0 +1,387 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/model_aligner.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+
+#include <tango_support_api.h>
+#include <tango-gl/obj_loader.h>
+#include <tango-gl/tracing.h>
+
+namespace {
+// Scene points whose correspondences one iteration of the loop searches.
+const size_t kSearchBatchSize = 1024;
+
+// Offset of the cell coordinates packed in 21 bits each by GetCellKey().
+const int kCellOffset = 1 << 20;
+
+// Seed of the surface sampling, so a model always gets the same samples.
+const uint32_t kSampleSeed = 5489u;
+
+// @return the sum of the squared distances of |model_points| transformed by
+// |world_T_model| to their |world_points|.
+double GetSquaredError(const std::vector<glm::vec3>& model_points,
+                       const std::vector<glm::vec3>& world_points,
+                       const glm::dmat4& world_T_model) {
+  double error = 0.0;
+  for (size_t i = 0; i < model_points.size(); ++i) {
+    const glm::dvec3 point(world_T_model * glm::dvec4(model_points[i], 1.0));
+    const glm::dvec3 delta = point - glm::dvec3(world_points[i]);
+    error += glm::dot(delta, delta);
+  }
+  return error;
+}
+}  // namespace
+
+namespace tango_util {
+
+bool FindSimilarityTransform(const std::vector<glm::vec3>& model_points,
+                             const std::vector<glm::vec3>& world_points,
+                             glm::mat4* world_T_model) {
+  if (model_points.empty() || model_points.size() != world_points.size()) {
+    return false;
+  }
+  std::vector<double> src(model_points.size() * 3);
+  std::vector<double> dest(world_points.size() * 3);
+  for (size_t i = 0; i < model_points.size(); ++i) {
+    for (int k = 0; k < 3; ++k) {
+      src[i * 3 + k] = model_points[i][k];
+      dest[i * 3 + k] = world_points[i][k];
+    }
+  }
+  double matrix[16];
+  if (TangoSupport_findCorrespondenceSimilarityTransform(
+          reinterpret_cast<double(*)[3]>(src.data()),
+          reinterpret_cast<double(*)[3]>(dest.data()),
+          static_cast<int>(model_points.size()), matrix) != TANGO_SUCCESS) {
+    LOGE("FindSimilarityTransform: no transformation for %d points",
+         static_cast<int>(model_points.size()));
+    return false;
+  }
+  // The result is column major, as glm. It is documented as
+  // src_frame_T_dest_frame, while the transformation of Umeyama maps the
+  // source points onto the destination ones: keep whichever of it and its
+  // inverse does.
+  glm::dmat4 transform;
+  for (int i = 0; i < 16; ++i) {
+    transform[i / 4][i % 4] = matrix[i];
+  }
+  const glm::dmat4 inverse = glm::inverse(transform);
+  if (GetSquaredError(model_points, world_points, inverse) <
+      GetSquaredError(model_points, world_points, transform)) {
+    transform = inverse;
+  }
+  *world_T_model = glm::mat4(transform);
+  return true;
+}
+
+void GetMapPoints(const PointCloudMap& map, size_t max_count,
+                  std::vector<glm::vec3>* points) {
+  points->clear();
+  size_t occupied_count = 0;
+  for (uint32_t slot = 0; slot < map.GetSlotCount(); ++slot) {
+    const PointCloudMap::Voxel* voxels = map.GetSlotVoxels(slot);
+    for (int i = 0; i < PointCloudMap::kVoxelsPerBlock; ++i) {
+      occupied_count += voxels[i].weight > 0.0f;
+    }
+  }
+  if (occupied_count == 0 || max_count == 0) {
+    return;
+  }
+  // Every stride-th occupied voxel, counting across the slots.
+  const size_t stride = (occupied_count + max_count - 1) / max_count;
+  points->reserve(occupied_count / stride + 1);
+  size_t index = 0;
+  for (uint32_t slot = 0; slot < map.GetSlotCount(); ++slot) {
+    const PointCloudMap::Voxel* voxels = map.GetSlotVoxels(slot);
+    for (int i = 0; i < PointCloudMap::kVoxelsPerBlock; ++i) {
+      if (voxels[i].weight > 0.0f && index++ % stride == 0) {
+        points->push_back(glm::vec3(voxels[i].position[0],
+                                    voxels[i].position[1],
+                                    voxels[i].position[2]));
+      }
+    }
+  }
+}
+
+ModelAligner::Options::Options()
+    : sample_spacing(0.01f),
+      max_sample_count(200000),
+      max_correspondence_distance(0.05f),
+      max_iteration_count(30),
+      convergence_ratio(0.001f),
+      time_budget(1.0),
+      thread_count(2) {}
+
+ModelAligner::ModelAligner(const Options& options)
+    : options_(options),
+      worker_pool_(options.thread_count),
+      inverse_cell_size_(1.0f / options.max_correspondence_distance),
+      is_running_(false),
+      is_cancelled_(false),
+      has_result_(false) {}
+
+ModelAligner::~ModelAligner() { Cancel(); }
+
+void ModelAligner::SetModel(const std::vector<GLfloat>& vertices,
+                            const std::vector<GLuint>& indices) {
+  TANGO_TRACE_SCOPE("ModelAligner::SetModel");
+  Cancel();
+  {
+    std::lock_guard<std::mutex> lock(result_mutex_);
+    has_result_ = false;
+  }
+
+  // Samples are spread over the triangles by area, more than spacing^2 per
+  // sample for models too large.
+  const size_t triangle_count = indices.size() / 3;
+  std::vector<float> areas(triangle_count);
+  double total_area = 0.0;
+  for (size_t i = 0; i < triangle_count; ++i) {
+    const glm::vec3 a = glm::make_vec3(&vertices[indices[i * 3] * 3]);
+    const glm::vec3 b = glm::make_vec3(&vertices[indices[i * 3 + 1] * 3]);
+    const glm::vec3 c = glm::make_vec3(&vertices[indices[i * 3 + 2] * 3]);
+    areas[i] = 0.5f * glm::length(glm::cross(b - a, c - a));
+    total_area += areas[i];
+  }
+  const double sample_area =
+      std::max(static_cast<double>(options_.sample_spacing) *
+                   options_.sample_spacing,
+               total_area / std::max(options_.max_sample_count, 1));
+
+  std::mt19937 generator(kSampleSeed);
+  std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+  std::vector<glm::vec3> samples;
+  samples.reserve(static_cast<size_t>(total_area / sample_area) +
+                  triangle_count);
+  for (size_t i = 0; i < triangle_count; ++i) {
+    // The fraction of a sample left is drawn, so small triangles still get
+    // their share.
+    const float expected_count = static_cast<float>(areas[i] / sample_area);
+    int count = static_cast<int>(expected_count);
+    if (uniform(generator) < expected_count - count) {
+      ++count;
+    }
+    const glm::vec3 a = glm::make_vec3(&vertices[indices[i * 3] * 3]);
+    const glm::vec3 b = glm::make_vec3(&vertices[indices[i * 3 + 1] * 3]);
+    const glm::vec3 c = glm::make_vec3(&vertices[indices[i * 3 + 2] * 3]);
+    for (int j = 0; j < count; ++j) {
+      // Uniform over the triangle.
+      const float r = std::sqrt(uniform(generator));
+      const float s = uniform(generator);
+      samples.push_back((1.0f - r) * a + r * (1.0f - s) * b + r * s * c);
+    }
+  }
+
+  // Sort the samples by cell, then record the range of every cell.
+  std::vector<std::pair<uint64_t, uint32_t>> keys(samples.size());
+  for (size_t i = 0; i < samples.size(); ++i) {
+    keys[i] = std::make_pair(
+        GetCellKey(glm::ivec3(glm::floor(samples[i] * inverse_cell_size_))),
+        static_cast<uint32_t>(i));
+  }
+  std::sort(keys.begin(), keys.end());
+  samples_.resize(samples.size());
+  cells_.clear();
+  for (size_t i = 0; i < keys.size(); ++i) {
+    samples_[i] = samples[keys[i].second];
+    std::pair<uint32_t, uint32_t>& cell = cells_[keys[i].first];
+    if (cell.second == 0) {
+      cell.first = static_cast<uint32_t>(i);
+    }
+    ++cell.second;
+  }
+  LOGI("ModelAligner: %d samples in %d cells for %d triangles",
+       static_cast<int>(samples_.size()), static_cast<int>(cells_.size()),
+       static_cast<int>(triangle_count));
+}
+
+bool ModelAligner::LoadModel(const char* path) {
+  std::vector<GLfloat> vertices;
+  std::vector<GLuint> indices;
+  if (!tango_gl::obj_loader::LoadOBJData(path, vertices, indices)) {
+    LOGE("ModelAligner: failed to load %s", path);
+    return false;
+  }
+  SetModel(vertices, indices);
+  return true;
+}
+
+bool ModelAligner::Start(std::vector<glm::vec3>* scene_points,
+                         const glm::mat4& initial_world_T_model) {
+  if (samples_.empty() || IsRunning()) {
+    return false;
+  }
+  if (aligner_.joinable()) {
+    aligner_.join();
+  }
+  scene_points_.swap(*scene_points);
+  is_cancelled_.store(false);
+  is_running_.store(true);
+  aligner_ = std::thread(&ModelAligner::Align, this, initial_world_T_model);
+  return true;
+}
+
+void ModelAligner::Cancel() {
+  is_cancelled_.store(true);
+  if (aligner_.joinable()) {
+    aligner_.join();
+  }
+}
+
+bool ModelAligner::GetResult(Result* result) const {
+  std::lock_guard<std::mutex> lock(result_mutex_);
+  if (has_result_) {
+    *result = result_;
+  }
+  return has_result_;
+}
+
+void ModelAligner::Align(glm::mat4 world_T_model) {
+  TANGO_TRACE_SCOPE("ModelAligner::Align");
+  const std::chrono::steady_clock::time_point start_time =
+      std::chrono::steady_clock::now();
+  correspondences_.resize(scene_points_.size());
+  std::vector<glm::vec3> model_points;
+  std::vector<glm::vec3> world_points;
+  model_points.reserve(scene_points_.size());
+  world_points.reserve(scene_points_.size());
+
+  Result result;
+  result.world_T_model = world_T_model;
+  result.rms_error = 0.0f;
+  result.correspondence_count = 0;
+  result.iteration_count = 0;
+  result.time = 0.0;
+  result.is_converged = false;
+  float previous_rms_error = 0.0f;
+  while (result.iteration_count < options_.max_iteration_count &&
+         !is_cancelled_.load()) {
+    const double elapsed = std::chrono::duration<double>(
+                               std::chrono::steady_clock::now() - start_time)
+                               .count();
+    if (elapsed >= options_.time_budget) {
+      break;
+    }
+
+    // The closest samples are searched in the model frame, where the index
+    // is.
+    const glm::mat4 model_T_world = glm::inverse(world_T_model);
+    const size_t batch_count =
+        (scene_points_.size() + kSearchBatchSize - 1) / kSearchBatchSize;
+    worker_pool_.ParallelFor(batch_count, [&](size_t batch) {
+      const size_t end =
+          std::min(scene_points_.size(), (batch + 1) * kSearchBatchSize);
+      for (size_t i = batch * kSearchBatchSize; i < end; ++i) {
+        correspondences_[i] = FindClosestSample(
+            glm::vec3(model_T_world * glm::vec4(scene_points_[i], 1.0f)));
+      }
+    });
+    model_points.clear();
+    world_points.clear();
+    for (size_t i = 0; i < scene_points_.size(); ++i) {
+      if (correspondences_[i] >= 0) {
+        model_points.push_back(samples_[correspondences_[i]]);
+        world_points.push_back(scene_points_[i]);
+      }
+    }
+    if (model_points.size() < 3 ||
+        !FindSimilarityTransform(model_points, world_points, &world_T_model)) {
+      LOGE("ModelAligner: %d correspondences, the model is too far off",
+           static_cast<int>(model_points.size()));
+      break;
+    }
+
+    ++result.iteration_count;
+    result.world_T_model = world_T_model;
+    result.correspondence_count = static_cast<int>(model_points.size());
+    result.rms_error = static_cast<float>(std::sqrt(
+        GetSquaredError(model_points, world_points,
+                        glm::dmat4(world_T_model)) /
+        model_points.size()));
+    result.time = std::chrono::duration<double>(
+                      std::chrono::steady_clock::now() - start_time)
+                      .count();
+    {
+      std::lock_guard<std::mutex> lock(result_mutex_);
+      result_ = result;
+      has_result_ = true;
+    }
+    if (result.iteration_count > 1 &&
+        previous_rms_error - result.rms_error <
+            options_.convergence_ratio * previous_rms_error) {
+      result.is_converged = true;
+      break;
+    }
+    previous_rms_error = result.rms_error;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(result_mutex_);
+    result_.is_converged = result.is_converged;
+  }
+  LOGI("ModelAligner: %s after %d iterations in %.3fs, %.4fm RMS error",
+       result.is_converged ? "converged" : "stopped", result.iteration_count,
+       std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                     start_time)
+           .count(),
+       result.rms_error);
+  is_running_.store(false);
+}
+
+uint64_t ModelAligner::GetCellKey(const glm::ivec3& cell) {
+  const uint64_t mask = (1u << 21) - 1;
+  return (static_cast<uint64_t>(cell.x + kCellOffset) & mask) |
+         ((static_cast<uint64_t>(cell.y + kCellOffset) & mask) << 21) |
+         ((static_cast<uint64_t>(cell.z + kCellOffset) & mask) << 42);
+}
+
+int ModelAligner::FindClosestSample(const glm::vec3& point) const {
+  // A sample within the cell size is in one of the 27 cells around the one of
+  // the point.
+  const glm::ivec3 center(glm::floor(point * inverse_cell_size_));
+  float closest_distance = options_.max_correspondence_distance *
+                           options_.max_correspondence_distance;
+  int closest = -1;
+  for (int z = -1; z <= 1; ++z) {
+    for (int y = -1; y <= 1; ++y) {
+      for (int x = -1; x <= 1; ++x) {
+        const std::unordered_map<uint64_t,
+                                 std::pair<uint32_t, uint32_t>>::const_iterator
+            cell = cells_.find(GetCellKey(center + glm::ivec3(x, y, z)));
+        if (cell == cells_.end()) {
+          continue;
+        }
+        const uint32_t end = cell->second.first + cell->second.second;
+        for (uint32_t i = cell->second.first; i < end; ++i) {
+          const glm::vec3 delta = samples_[i] - point;
+          const float distance = glm::dot(delta, delta);
+          if (distance < closest_distance) {
+            closest_distance = distance;
+            closest = static_cast<int>(i);
+          }
+        }
+      }
+    }
+  }
+  return closest;
+}
+
+}  // namespace tango_util
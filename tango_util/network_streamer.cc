@@ -0,0 +1,412 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/network_streamer.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+#include <tango-gl/util.h>
+
+#include "tango-util/thread_policy.h"
+
+namespace {
+// Time the sender sleeps when there is nothing to send, unless woken up by a
+// point cloud. Poses are batched over it.
+const std::chrono::milliseconds kSendInterval(10);
+
+// Interval of the per second stats.
+const std::chrono::seconds kRateInterval(1);
+
+// Layout of a pose slot: the pose and the time it was received, in
+// nanoseconds of the steady clock.
+struct PoseSlot {
+  TangoPoseData pose;
+  int64_t receive_time;
+};
+
+// Layout of a point cloud slot: as PoseSlot, then the points as floats.
+struct PointCloudSlot {
+  double timestamp;
+  int64_t receive_time;
+  uint32_t point_count;
+  uint32_t reserved;
+};
+
+int64_t GetSteadyTime() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void InitializeChunkHeader(tango_util::session_log::RecordType type,
+                           double timestamp,
+                           tango_util::session_log::ChunkHeader* header) {
+  memcpy(header->magic, tango_util::session_log::kChunkMagic,
+         sizeof(header->magic));
+  header->type = type;
+  header->record_count = 0;
+  header->payload_size = 0;
+  header->first_timestamp = timestamp;
+  header->last_timestamp = timestamp;
+}
+}  // namespace
+
+namespace tango_util {
+
+NetworkStreamer::Options::Options()
+    : max_point_count(60000),
+      point_scale(session_log::kDefaultPointScale),
+      point_cloud_interval(0.5),
+      max_datagram_size(1400),
+      pose_slot_count(256),
+      point_cloud_slot_count(2) {}
+
+NetworkStreamer::NetworkStreamer()
+    : is_streaming_(false),
+      socket_(-1),
+      last_point_cloud_timestamp_(0.0),
+      latency_sum_(0.0),
+      latency_count_(0),
+      rate_bytes_sent_(0),
+      pose_count_(0),
+      point_cloud_count_(0),
+      dropped_count_(0),
+      dropped_datagram_count_(0),
+      datagram_count_(0),
+      bytes_sent_(0),
+      bytes_per_second_(0.0f),
+      average_latency_(0.0f) {}
+
+NetworkStreamer::~NetworkStreamer() { Stop(); }
+
+bool NetworkStreamer::Start(const char* host, int port,
+                            const Options& options) {
+  Stop();
+  const size_t min_datagram_size = sizeof(session_log::ChunkHeader) +
+                                   sizeof(session_log::PointCloudRecord) +
+                                   sizeof(session_log::PoseRecord);
+  if (options.max_datagram_size < min_datagram_size) {
+    LOGE("NetworkStreamer: datagrams of %d bytes are too small",
+         static_cast<int>(options.max_datagram_size));
+    return false;
+  }
+
+  char service[16];
+  snprintf(service, sizeof(service), "%d", port);
+  struct addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_DGRAM;
+  struct addrinfo* addresses = NULL;
+  const int error = getaddrinfo(host, service, &hints, &addresses);
+  if (error != 0) {
+    LOGE("NetworkStreamer: failed to resolve %s: %s", host,
+         gai_strerror(error));
+    return false;
+  }
+  // A connected socket only needs send(), and reports an ICMP port
+  // unreachable as an error of the next send rather than ignoring it.
+  for (struct addrinfo* address = addresses; address != NULL;
+       address = address->ai_next) {
+    socket_ = socket(address->ai_family, address->ai_socktype,
+                     address->ai_protocol);
+    if (socket_ < 0) {
+      continue;
+    }
+    if (connect(socket_, address->ai_addr, address->ai_addrlen) == 0 &&
+        fcntl(socket_, F_SETFL, fcntl(socket_, F_GETFL) | O_NONBLOCK) == 0) {
+      break;
+    }
+    close(socket_);
+    socket_ = -1;
+  }
+  freeaddrinfo(addresses);
+  if (socket_ < 0) {
+    LOGE("NetworkStreamer: failed to connect to %s:%d", host, port);
+    return false;
+  }
+
+  options_ = options;
+  last_point_cloud_timestamp_ = 0.0;
+  pose_count_.store(0);
+  point_cloud_count_.store(0);
+  dropped_count_.store(0);
+  dropped_datagram_count_.store(0);
+  datagram_count_.store(0);
+  bytes_sent_.store(0);
+  bytes_per_second_.store(0.0f);
+  average_latency_.store(0.0f);
+  latency_sum_ = 0.0;
+  latency_count_ = 0;
+  rate_bytes_sent_ = 0;
+  rate_start_time_ = std::chrono::steady_clock::now();
+
+  // Every buffer is allocated here, so neither the callbacks nor the sender
+  // allocate while streaming.
+  pose_ring_.Allocate(options_.pose_slot_count, sizeof(PoseSlot));
+  point_cloud_ring_.Allocate(
+      options_.point_cloud_slot_count,
+      sizeof(PointCloudSlot) + options_.max_point_count * 3 * sizeof(float));
+  payload_.resize(options_.max_datagram_size -
+                  sizeof(session_log::ChunkHeader));
+
+  is_streaming_.store(true);
+  sender_ = std::thread(&NetworkStreamer::SendLoop, this);
+  LOGI("NetworkStreamer: streaming to %s:%d", host, port);
+  return true;
+}
+
+void NetworkStreamer::Stop() {
+  if (!is_streaming_.exchange(false)) {
+    return;
+  }
+  wake_condition_.notify_one();
+  sender_.join();
+  close(socket_);
+  socket_ = -1;
+  LOGI(
+      "NetworkStreamer: sent %llu poses and %llu point clouds in %llu bytes, "
+      "dropped %llu records and %llu datagrams",
+      static_cast<unsigned long long>(pose_count_.load()),
+      static_cast<unsigned long long>(point_cloud_count_.load()),
+      static_cast<unsigned long long>(bytes_sent_.load()),
+      static_cast<unsigned long long>(dropped_count_.load()),
+      static_cast<unsigned long long>(dropped_datagram_count_.load()));
+}
+
+void NetworkStreamer::OnPoseAvailable(const TangoPoseData* pose) {
+  if (!is_streaming_.load()) {
+    return;
+  }
+  uint8_t* slot = pose_ring_.BeginWrite();
+  if (slot == NULL) {
+    ++dropped_count_;
+    return;
+  }
+  PoseSlot pose_slot;
+  pose_slot.pose = *pose;
+  pose_slot.receive_time = GetSteadyTime();
+  memcpy(slot, &pose_slot, sizeof(pose_slot));
+  pose_ring_.EndWrite(sizeof(pose_slot));
+}
+
+void NetworkStreamer::OnXYZijAvailable(const TangoXYZij* xyz_ij) {
+  if (!is_streaming_.load() ||
+      xyz_ij->timestamp - last_point_cloud_timestamp_ <
+          options_.point_cloud_interval) {
+    return;
+  }
+  const size_t points_size = xyz_ij->xyz_count * 3 * sizeof(float);
+  uint8_t* slot = point_cloud_ring_.BeginWrite();
+  if (slot == NULL ||
+      sizeof(PointCloudSlot) + points_size > point_cloud_ring_.GetSlotSize()) {
+    ++dropped_count_;
+    return;
+  }
+  last_point_cloud_timestamp_ = xyz_ij->timestamp;
+  PointCloudSlot header;
+  header.timestamp = xyz_ij->timestamp;
+  header.receive_time = GetSteadyTime();
+  header.point_count = xyz_ij->xyz_count;
+  header.reserved = 0;
+  memcpy(slot, &header, sizeof(header));
+  memcpy(slot + sizeof(header), xyz_ij->xyz, points_size);
+  point_cloud_ring_.EndWrite(sizeof(header) + points_size);
+  wake_condition_.notify_one();
+}
+
+NetworkStreamer::Stats NetworkStreamer::GetStats() const {
+  Stats stats;
+  stats.pose_count = pose_count_.load();
+  stats.point_cloud_count = point_cloud_count_.load();
+  stats.dropped_count = dropped_count_.load();
+  stats.dropped_datagram_count = dropped_datagram_count_.load();
+  stats.datagram_count = datagram_count_.load();
+  stats.bytes_sent = bytes_sent_.load();
+  stats.bytes_per_second = bytes_per_second_.load();
+  stats.average_latency = average_latency_.load();
+  return stats;
+}
+
+void NetworkStreamer::SendLoop() {
+  while (true) {
+    ThreadPolicy::Get().Enter(ThreadPolicy::kBulkStage);
+    // Check before sending, so everything received before Stop() is sent.
+    const bool stopping = !is_streaming_.load();
+    SendPoses();
+    size_t size;
+    const uint8_t* slot;
+    while ((slot = point_cloud_ring_.BeginRead(&size)) != NULL) {
+      SendPointCloud(slot);
+      point_cloud_ring_.EndRead();
+    }
+    UpdateRates();
+    if (stopping) {
+      return;
+    }
+
+    std::unique_lock<std::mutex> lock(wake_mutex_);
+    wake_condition_.wait_for(lock, kSendInterval);
+  }
+}
+
+void NetworkStreamer::SendPoses() {
+  const size_t max_record_count =
+      payload_.size() / sizeof(session_log::PoseRecord);
+  session_log::ChunkHeader header;
+  int64_t translation[3] = {0, 0, 0};
+  header.record_count = 0;
+  size_t size;
+  const uint8_t* slot;
+  while ((slot = pose_ring_.BeginRead(&size)) != NULL) {
+    PoseSlot pose_slot;
+    memcpy(&pose_slot, slot, sizeof(pose_slot));
+    pose_ring_.EndRead();
+    const TangoPoseData& pose = pose_slot.pose;
+
+    // As in a log, a chunk starts over for timestamps its time offsets can
+    // not represent.
+    double time_offset = 0.0;
+    if (header.record_count > 0) {
+      time_offset = std::round((pose.timestamp - header.first_timestamp) *
+                               session_log::kTimeOffsetScale);
+      if (time_offset < 0.0 ||
+          time_offset > std::numeric_limits<uint32_t>::max() ||
+          header.record_count == max_record_count) {
+        Send(header, header.record_count * sizeof(session_log::PoseRecord));
+        header.record_count = 0;
+        time_offset = 0.0;
+      }
+    }
+    if (header.record_count == 0) {
+      InitializeChunkHeader(session_log::kPoseRecord, pose.timestamp, &header);
+      translation[0] = 0;
+      translation[1] = 0;
+      translation[2] = 0;
+    }
+    header.last_timestamp = std::max(header.last_timestamp, pose.timestamp);
+
+    session_log::PoseRecord record;
+    record.time_offset = static_cast<uint32_t>(time_offset);
+    session_log::EncodePose(pose, translation, &record);
+    memcpy(&payload_[header.record_count * sizeof(record)], &record,
+           sizeof(record));
+    ++header.record_count;
+    ++pose_count_;
+    AddLatency(pose_slot.receive_time);
+  }
+  if (header.record_count > 0) {
+    Send(header, header.record_count * sizeof(session_log::PoseRecord));
+  }
+}
+
+void NetworkStreamer::SendPointCloud(const uint8_t* slot) {
+  PointCloudSlot cloud;
+  memcpy(&cloud, slot, sizeof(cloud));
+  const uint8_t* values = slot + sizeof(cloud);
+  const uint32_t max_slice_count = static_cast<uint32_t>(
+      (payload_.size() - sizeof(session_log::PointCloudRecord)) /
+      (3 * sizeof(int16_t)));
+
+  // The points are quantized from the slot straight into the datagram.
+  for (uint32_t first = 0; first < cloud.point_count;
+       first += max_slice_count) {
+    session_log::PointCloudRecord record;
+    record.time_offset = 0;
+    record.point_count = std::min(max_slice_count, cloud.point_count - first);
+    memcpy(payload_.data(), &record, sizeof(record));
+    uint8_t* out = payload_.data() + sizeof(record);
+    const size_t value_count = record.point_count * 3;
+    for (size_t i = 0; i < value_count; ++i) {
+      float value;
+      memcpy(&value, values + (first * 3 + i) * sizeof(value), sizeof(value));
+      const int16_t quantized =
+          session_log::QuantizePoint(value, options_.point_scale);
+      memcpy(out + i * sizeof(quantized), &quantized, sizeof(quantized));
+    }
+
+    session_log::ChunkHeader header;
+    InitializeChunkHeader(session_log::kPointCloudRecord, cloud.timestamp,
+                          &header);
+    header.record_count = 1;
+    Send(header, sizeof(record) + value_count * sizeof(int16_t));
+  }
+  ++point_cloud_count_;
+  AddLatency(cloud.receive_time);
+}
+
+void NetworkStreamer::Send(const session_log::ChunkHeader& header,
+                           size_t size) {
+  session_log::ChunkHeader chunk_header = header;
+  chunk_header.payload_size = static_cast<uint32_t>(size);
+  // The header and the payload are gathered by the kernel rather than
+  // copied into one buffer.
+  struct iovec parts[2];
+  parts[0].iov_base = &chunk_header;
+  parts[0].iov_len = sizeof(chunk_header);
+  parts[1].iov_base = payload_.data();
+  parts[1].iov_len = size;
+  struct msghdr message;
+  memset(&message, 0, sizeof(message));
+  message.msg_iov = parts;
+  message.msg_iovlen = 2;
+  const ssize_t sent = sendmsg(socket_, &message, MSG_DONTWAIT | MSG_NOSIGNAL);
+  if (sent < 0) {
+    // EAGAIN when the socket buffer is full, ECONNREFUSED when no viewer
+    // listens: the datagram is dropped either way.
+    ++dropped_datagram_count_;
+    return;
+  }
+  ++datagram_count_;
+  bytes_sent_ += sent;
+  rate_bytes_sent_ += sent;
+}
+
+void NetworkStreamer::AddLatency(int64_t receive_time) {
+  latency_sum_ += (GetSteadyTime() - receive_time) * 1e-9;
+  ++latency_count_;
+}
+
+void NetworkStreamer::UpdateRates() {
+  const std::chrono::steady_clock::time_point now =
+      std::chrono::steady_clock::now();
+  const double elapsed =
+      std::chrono::duration<double>(now - rate_start_time_).count();
+  if (now - rate_start_time_ < kRateInterval) {
+    return;
+  }
+  bytes_per_second_.store(static_cast<float>(rate_bytes_sent_ / elapsed));
+  average_latency_.store(
+      latency_count_ > 0 ? static_cast<float>(latency_sum_ / latency_count_)
+                         : 0.0f);
+  rate_bytes_sent_ = 0;
+  latency_sum_ = 0.0;
+  latency_count_ = 0;
+  rate_start_time_ = now;
+}
+
+}  // namespace tango_util
@@ -0,0 +1,236 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/normal_estimator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <tango-gl/tracing.h>
+
+#include "tango-util/plane_detector.h"
+
+namespace {
+// Cell of the points off the grid.
+const uint32_t kNoCell = 0xFFFFFFFFu;
+
+// Points whose normals one iteration of the loop estimates.
+const size_t kNormalBatchSize = 1024;
+
+// Number of doubles of NormalEstimator::Moments, summed as an array.
+const int kMomentCount = 10;
+}  // namespace
+
+namespace tango_util {
+
+NormalEstimator::Options::Options()
+    : grid_scale(0.5f),
+      window_radius(2),
+      min_point_count(6),
+      max_depth_change(0.05f),
+      thread_count(2) {}
+
+NormalEstimator::NormalEstimator(const Options& options)
+    : options_(options),
+      worker_pool_(options.thread_count),
+      has_intrinsics_(false),
+      grid_width_(0),
+      grid_height_(0) {
+  static_assert(sizeof(Moments) == kMomentCount * sizeof(double),
+                "the moments are summed as an array of doubles");
+  memset(&intrinsics_, 0, sizeof(intrinsics_));
+}
+
+void NormalEstimator::SetIntrinsics(const TangoCameraIntrinsics& intrinsics) {
+  intrinsics_ = intrinsics;
+  has_intrinsics_ = intrinsics.width > 0 && intrinsics.height > 0;
+}
+
+const std::vector<glm::vec3>& NormalEstimator::Estimate(
+    const TangoXYZij* xyz_ij) {
+  TANGO_TRACE_SCOPE("NormalEstimator::Estimate");
+  const uint32_t point_count = xyz_ij->xyz_count;
+  normals_.resize(point_count);
+  if (!LayOut(xyz_ij)) {
+    std::fill(normals_.begin(), normals_.end(), glm::vec3(0.0f));
+    return normals_;
+  }
+  IntegrateMoments();
+
+  const size_t batch_count =
+      (point_count + kNormalBatchSize - 1) / kNormalBatchSize;
+  worker_pool_.ParallelFor(batch_count, [this, xyz_ij](size_t batch) {
+    const size_t end =
+        std::min<size_t>(xyz_ij->xyz_count, (batch + 1) * kNormalBatchSize);
+    for (size_t i = batch * kNormalBatchSize; i < end; ++i) {
+      normals_[i] = cells_[i] == kNoCell
+                        ? glm::vec3(0.0f)
+                        : GetNormal(glm::make_vec3(xyz_ij->xyz[i]), cells_[i]);
+    }
+  });
+  return normals_;
+}
+
+bool NormalEstimator::LayOut(const TangoXYZij* xyz_ij) {
+  const uint32_t point_count = xyz_ij->xyz_count;
+  const bool has_ij =
+      xyz_ij->ij != nullptr && xyz_ij->ij_rows > 0 && xyz_ij->ij_cols > 0;
+  if (has_ij) {
+    grid_width_ = static_cast<int>(xyz_ij->ij_cols);
+    grid_height_ = static_cast<int>(xyz_ij->ij_rows);
+  } else if (has_intrinsics_) {
+    const float scale = options_.grid_scale;
+    grid_width_ =
+        std::max(1, static_cast<int>(std::ceil(intrinsics_.width * scale)));
+    grid_height_ =
+        std::max(1, static_cast<int>(std::ceil(intrinsics_.height * scale)));
+  } else {
+    LOGE("NormalEstimator: no ij buffer nor intrinsics to lay out the points");
+    return false;
+  }
+
+  cells_.assign(point_count, kNoCell);
+  const size_t stride = grid_width_ + 1;
+  Moments zero;
+  memset(&zero, 0, sizeof(zero));
+  integral_.assign(stride * (grid_height_ + 1), zero);
+
+  if (has_ij) {
+    const uint32_t cell_count = xyz_ij->ij_rows * xyz_ij->ij_cols;
+    for (uint32_t cell = 0; cell < cell_count; ++cell) {
+      const uint32_t index = xyz_ij->ij[cell];
+      if (index < point_count) {
+        cells_[index] = cell;
+      }
+    }
+  } else {
+    const double scale = options_.grid_scale;
+    for (uint32_t i = 0; i < point_count; ++i) {
+      const float* point = xyz_ij->xyz[i];
+      if (!(point[2] > 0.0f)) {
+        continue;
+      }
+      const int column = static_cast<int>(std::floor(
+          (intrinsics_.fx * point[0] / point[2] + intrinsics_.cx) * scale));
+      const int row = static_cast<int>(std::floor(
+          (intrinsics_.fy * point[1] / point[2] + intrinsics_.cy) * scale));
+      if (column >= 0 && column < grid_width_ && row >= 0 &&
+          row < grid_height_) {
+        cells_[i] = static_cast<uint32_t>(row * grid_width_ + column);
+      }
+    }
+  }
+
+  // Every point is added to the entry after its cell, as the integral image
+  // is offset by a row and a column.
+  for (uint32_t i = 0; i < point_count; ++i) {
+    if (cells_[i] == kNoCell) {
+      continue;
+    }
+    const uint32_t row = cells_[i] / grid_width_;
+    const uint32_t column = cells_[i] % grid_width_;
+    Moments& moments = integral_[(row + 1) * stride + column + 1];
+    const double x = xyz_ij->xyz[i][0];
+    const double y = xyz_ij->xyz[i][1];
+    const double z = xyz_ij->xyz[i][2];
+    moments.count += 1.0;
+    moments.sum[0] += x;
+    moments.sum[1] += y;
+    moments.sum[2] += z;
+    moments.products[0] += x * x;
+    moments.products[1] += x * y;
+    moments.products[2] += x * z;
+    moments.products[3] += y * y;
+    moments.products[4] += y * z;
+    moments.products[5] += z * z;
+  }
+  return true;
+}
+
+void NormalEstimator::IntegrateMoments() {
+  TANGO_TRACE_SCOPE("NormalEstimator::IntegrateMoments");
+  const size_t stride = grid_width_ + 1;
+  // Prefix sums along the rows, then down the columns. Each pass is
+  // independent across rows, or columns, and the inner loop over the moments
+  // of an entry is a plain array sum the compiler vectorizes.
+  worker_pool_.ParallelFor(grid_height_, [this, stride](size_t row) {
+    double* entry = &integral_[(row + 1) * stride].count;
+    for (int column = 0; column < grid_width_; ++column) {
+      double* next = entry + kMomentCount;
+      for (int k = 0; k < kMomentCount; ++k) {
+        next[k] += entry[k];
+      }
+      entry = next;
+    }
+  });
+  for (int row = 1; row < grid_height_; ++row) {
+    double* previous = &integral_[row * stride].count;
+    double* entry = &integral_[(row + 1) * stride].count;
+    const size_t value_count = stride * kMomentCount;
+    for (size_t k = 0; k < value_count; ++k) {
+      entry[k] += previous[k];
+    }
+  }
+}
+
+glm::vec3 NormalEstimator::GetNormal(const glm::vec3& point,
+                                     uint32_t cell) const {
+  const int row = static_cast<int>(cell) / grid_width_;
+  const int column = static_cast<int>(cell) % grid_width_;
+  const size_t stride = grid_width_ + 1;
+  const size_t top = std::max(row - options_.window_radius, 0);
+  const size_t bottom =
+      std::min(row + options_.window_radius + 1, grid_height_);
+  const size_t left = std::max(column - options_.window_radius, 0);
+  const size_t right =
+      std::min(column + options_.window_radius + 1, grid_width_);
+  const double* a = &integral_[top * stride + left].count;
+  const double* b = &integral_[top * stride + right].count;
+  const double* c = &integral_[bottom * stride + left].count;
+  const double* d = &integral_[bottom * stride + right].count;
+  double window[kMomentCount];
+  for (int k = 0; k < kMomentCount; ++k) {
+    window[k] = d[k] - b[k] - c[k] + a[k];
+  }
+
+  const double count = window[0];
+  if (count < options_.min_point_count) {
+    return glm::vec3(0.0f);
+  }
+  const glm::dvec3 mean =
+      glm::dvec3(window[1], window[2], window[3]) / count;
+  if (std::fabs(mean.z - point.z) > options_.max_depth_change * point.z) {
+    return glm::vec3(0.0f);
+  }
+  // The moments give the covariance as E[p p^T] - mean mean^T.
+  const double* products = window + 4;
+  const double xx = products[0] / count - mean.x * mean.x;
+  const double xy = products[1] / count - mean.x * mean.y;
+  const double xz = products[2] / count - mean.x * mean.z;
+  const double yy = products[3] / count - mean.y * mean.y;
+  const double yz = products[4] / count - mean.y * mean.z;
+  const double zz = products[5] / count - mean.z * mean.z;
+  const glm::mat3 covariance(xx, xy, xz, xy, yy, yz, xz, yz, zz);
+  glm::vec3 normal = GetSmallestEigenvector(covariance);
+  // The camera is at the origin of the depth frame.
+  if (glm::dot(normal, point) > 0.0f) {
+    normal = -normal;
+  }
+  return normal;
+}
+
+}  // namespace tango_util
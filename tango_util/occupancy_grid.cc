@@ -0,0 +1,346 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/occupancy_grid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace {
+// Log odds added by a frame seeing a cell occupied, and removed by one seeing
+// it free. A cell seen as often occupied as free ends up occupied, and an
+// obstacle gone is cleared in a few seconds of frames.
+const int kHitLogOdds = 6;
+const int kMissLogOdds = 2;
+
+// Luminance of a cell never seen, and change of luminance per unit of log
+// odds.
+const int kUnknownLuminance = 128;
+const int kLuminancePerLogOdds = 3;
+
+// The height histogram: bins of 5 cm over 32 meters around the origin, the
+// heights below the camera the floor is searched at, and the share of the
+// points of the fullest bin a lower bin needs to be the floor.
+const float kHistogramBinSize = 0.05f;
+const int kHistogramBinCount = 640;
+const float kMinFloorDepth = 0.3f;
+const float kMaxFloorDepth = 2.5f;
+const float kFloorShare = 0.3f;
+// Decay of the histogram per frame, and the decayed points the fullest bin
+// needs for the floor to be found.
+const float kHistogramDecay = 0.9f;
+const float kMinFloorCount = 100.0f;
+
+// The blocked changes kept between two calls to TakeBlockedChanges(), beyond
+// which they are dropped: a planner is better off starting over than
+// repairing that many cells, and the list stays bounded when no one takes it.
+const size_t kMaxBlockedChanges = 4096;
+
+inline int FloorDivide(int value, int divisor) {
+  return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+}
+
+inline uint64_t PackTile(const glm::ivec2& tile) {
+  return (static_cast<uint64_t>(static_cast<uint32_t>(tile.x)) << 32) |
+         static_cast<uint32_t>(tile.y);
+}
+}  // namespace
+
+namespace tango_util {
+
+const int OccupancyGrid::kTileSize;
+const int OccupancyGrid::kTileCells;
+const int OccupancyGrid::kMaxLogOdds;
+const int OccupancyGrid::kBlockedLogOdds;
+
+OccupancyGrid::Options::Options()
+    : cell_size(0.05f),
+      max_range(4.0f),
+      floor_tolerance(0.06f),
+      min_obstacle_height(0.1f),
+      max_obstacle_height(1.8f) {}
+
+OccupancyGrid::OccupancyGrid(const Options& options)
+    : cell_size_(options.cell_size),
+      inverse_cell_size_(1.0f / options.cell_size),
+      max_range_(options.max_range),
+      floor_tolerance_(options.floor_tolerance),
+      min_obstacle_height_(options.min_obstacle_height),
+      max_obstacle_height_(options.max_obstacle_height),
+      stamp_(0),
+      revision_(0),
+      has_dropped_blocked_changes_(false),
+      height_histogram_(kHistogramBinCount, 0.0f),
+      has_floor_(false),
+      floor_height_(0.0f),
+      last_tile_key_(0),
+      last_tile_offset_(-1) {}
+
+void OccupancyGrid::Insert(const TangoXYZij* xyz_ij,
+                           const glm::mat4& world_T_depth) {
+  const glm::vec3 camera_position(world_T_depth[3]);
+  points_.resize(xyz_ij->xyz_count);
+  size_t count = 0;
+  const float max_range_squared = max_range_ * max_range_;
+  for (uint32_t i = 0; i < xyz_ij->xyz_count; ++i) {
+    const float* point = xyz_ij->xyz[i];
+    if (point[0] * point[0] + point[1] * point[1] + point[2] * point[2] >
+        max_range_squared) {
+      continue;
+    }
+    points_[count++] = glm::vec3(
+        world_T_depth * glm::vec4(point[0], point[1], point[2], 1.0f));
+  }
+  UpdateFloor(points_.data(), count, camera_position.z);
+  if (!has_floor_) {
+    return;
+  }
+
+  // A new frame stamp, clearing the stamps when it wraps around.
+  if (++stamp_ == 0) {
+    std::fill(stamps_.begin(), stamps_.end(), 0);
+    stamp_ = 1;
+  }
+
+  // The obstacles first, for the lines to leave them be, then the floor.
+  line_ends_.clear();
+  const float obstacle_min = floor_height_ + min_obstacle_height_;
+  const float obstacle_max = floor_height_ + max_obstacle_height_;
+  for (size_t i = 0; i < count; ++i) {
+    const glm::vec3& point = points_[i];
+    if (point.z > obstacle_min && point.z < obstacle_max) {
+      const glm::ivec2 cell = GetCell(point.x, point.y);
+      if (UpdateCell(GetCellOffset(cell), kHitLogOdds)) {
+        line_ends_.push_back(cell);
+      }
+    }
+  }
+  bool has_changed = !line_ends_.empty();
+  for (size_t i = 0; i < count; ++i) {
+    const glm::vec3& point = points_[i];
+    if (std::abs(point.z - floor_height_) < floor_tolerance_) {
+      has_changed |= UpdateCell(GetCellOffset(GetCell(point.x, point.y)),
+                                -kMissLogOdds);
+    }
+  }
+
+  // A line per obstacle cell rather than per point, from under the camera.
+  // The floor points are free on their own, lines to them would mostly cross
+  // cells already updated.
+  const glm::ivec2 camera_cell = GetCell(camera_position.x, camera_position.y);
+  for (const glm::ivec2& line_end : line_ends_) {
+    TraceLine(camera_cell, line_end);
+  }
+  if (has_changed) {
+    ++revision_;
+  }
+}
+
+void OccupancyGrid::Clear() {
+  tile_indices_.clear();
+  tiles_.clear();
+  cells_.clear();
+  stamps_.clear();
+  last_tile_offset_ = -1;
+  std::fill(height_histogram_.begin(), height_histogram_.end(), 0.0f);
+  has_floor_ = false;
+  ++revision_;
+  blocked_changes_.clear();
+  has_dropped_blocked_changes_ = true;
+}
+
+int OccupancyGrid::GetLogOdds(const glm::vec2& position) const {
+  const int64_t offset = FindCellOffset(GetCell(position.x, position.y));
+  return offset >= 0 ? cells_[offset] : 0;
+}
+
+bool OccupancyGrid::IsBlocked(const glm::ivec2& cell) const {
+  const int64_t offset = FindCellOffset(cell);
+  return offset >= 0 && cells_[offset] >= kBlockedLogOdds;
+}
+
+bool OccupancyGrid::TakeBlockedChanges(std::vector<glm::ivec2>* cells) {
+  const bool is_complete = !has_dropped_blocked_changes_;
+  if (is_complete) {
+    cells->insert(cells->end(), blocked_changes_.begin(),
+                  blocked_changes_.end());
+  }
+  blocked_changes_.clear();
+  has_dropped_blocked_changes_ = false;
+  return is_complete;
+}
+
+void OccupancyGrid::GetWindow(const glm::vec2& position, int size,
+                              uint8_t* pixels) const {
+  const glm::ivec2 center = GetCell(position.x, position.y);
+  const glm::ivec2 origin = center - glm::ivec2(size / 2);
+  for (int row = 0; row < size; ++row) {
+    const int y = origin.y + size - 1 - row;
+    uint8_t* out = pixels + row * size;
+    // A run of cells per tile the row crosses.
+    for (int x = origin.x; x < origin.x + size;) {
+      const int run_end = std::min(
+          (FloorDivide(x, kTileSize) + 1) * kTileSize, origin.x + size);
+      const int64_t offset = FindCellOffset(glm::ivec2(x, y));
+      for (const int run_start = x; x < run_end; ++x) {
+        const int log_odds = offset >= 0 ? cells_[offset + x - run_start] : 0;
+        *out++ = static_cast<uint8_t>(kUnknownLuminance -
+                                      log_odds * kLuminancePerLogOdds);
+      }
+    }
+  }
+}
+
+void OccupancyGrid::UpdateFloor(const glm::vec3* points, size_t count,
+                                float camera_height) {
+  for (float& bin : height_histogram_) {
+    bin *= kHistogramDecay;
+  }
+  const float bias = kHistogramBinCount / 2;
+  const float min_height = camera_height - kMaxFloorDepth;
+  const float max_height = camera_height - kMinFloorDepth;
+  for (size_t i = 0; i < count; ++i) {
+    const float height = points[i].z;
+    if (height > min_height && height < max_height) {
+      const int bin =
+          static_cast<int>(std::floor(height / kHistogramBinSize + bias));
+      if (bin >= 0 && bin < kHistogramBinCount) {
+        height_histogram_[bin] += 1.0f;
+      }
+    }
+  }
+
+  // The lowest bin below the camera with a large share of the fullest one.
+  const int first_bin = std::max(
+      static_cast<int>(std::floor(min_height / kHistogramBinSize + bias)), 0);
+  const int last_bin =
+      std::min(static_cast<int>(std::floor(max_height / kHistogramBinSize +
+                                           bias)),
+               kHistogramBinCount - 1);
+  float max_count = 0.0f;
+  for (int bin = first_bin; bin <= last_bin; ++bin) {
+    max_count = std::max(max_count, height_histogram_[bin]);
+  }
+  if (max_count < kMinFloorCount) {
+    return;
+  }
+  for (int bin = first_bin; bin <= last_bin; ++bin) {
+    if (height_histogram_[bin] >= max_count * kFloorShare) {
+      has_floor_ = true;
+      floor_height_ = (bin - bias + 0.5f) * kHistogramBinSize;
+      return;
+    }
+  }
+}
+
+size_t OccupancyGrid::GetCellOffset(const glm::ivec2& cell) {
+  const glm::ivec2 tile(FloorDivide(cell.x, kTileSize),
+                        FloorDivide(cell.y, kTileSize));
+  const glm::ivec2 local = cell - tile * kTileSize;
+  const size_t local_offset = local.y * kTileSize + local.x;
+  const uint64_t key = PackTile(tile);
+  if (last_tile_offset_ >= 0 && key == last_tile_key_) {
+    return last_tile_offset_ + local_offset;
+  }
+  std::unordered_map<uint64_t, uint32_t>::const_iterator it =
+      tile_indices_.find(key);
+  size_t offset;
+  if (it != tile_indices_.end()) {
+    offset = tiles_[it->second].offset;
+  } else {
+    offset = cells_.size();
+    Tile new_tile = {tile, offset};
+    tile_indices_[key] = static_cast<uint32_t>(tiles_.size());
+    tiles_.push_back(new_tile);
+    cells_.resize(offset + kTileCells, 0);
+    stamps_.resize(offset + kTileCells, 0);
+  }
+  last_tile_key_ = key;
+  last_tile_offset_ = static_cast<int64_t>(offset);
+  return offset + local_offset;
+}
+
+int64_t OccupancyGrid::FindCellOffset(const glm::ivec2& cell) const {
+  const glm::ivec2 tile(FloorDivide(cell.x, kTileSize),
+                        FloorDivide(cell.y, kTileSize));
+  std::unordered_map<uint64_t, uint32_t>::const_iterator it =
+      tile_indices_.find(PackTile(tile));
+  if (it == tile_indices_.end()) {
+    return -1;
+  }
+  const glm::ivec2 local = cell - tile * kTileSize;
+  return static_cast<int64_t>(tiles_[it->second].offset) +
+         local.y * kTileSize + local.x;
+}
+
+bool OccupancyGrid::UpdateCell(size_t offset, int log_odds) {
+  if (stamps_[offset] == stamp_) {
+    return false;
+  }
+  stamps_[offset] = stamp_;
+  const int previous_value = cells_[offset];
+  const int value =
+      std::max(-kMaxLogOdds, std::min(previous_value + log_odds, kMaxLogOdds));
+  cells_[offset] = static_cast<int8_t>(value);
+  if ((previous_value >= kBlockedLogOdds) != (value >= kBlockedLogOdds) &&
+      !has_dropped_blocked_changes_) {
+    if (blocked_changes_.size() < kMaxBlockedChanges) {
+      blocked_changes_.push_back(GetCellAt(offset));
+    } else {
+      blocked_changes_.clear();
+      has_dropped_blocked_changes_ = true;
+    }
+  }
+  return true;
+}
+
+void OccupancyGrid::TraceLine(const glm::ivec2& from, const glm::ivec2& to) {
+  // Bresenham, on the cells between the ends.
+  const int dx = std::abs(to.x - from.x);
+  const int dy = -std::abs(to.y - from.y);
+  const int step_x = from.x < to.x ? 1 : -1;
+  const int step_y = from.y < to.y ? 1 : -1;
+  int error = dx + dy;
+  glm::ivec2 cell = from;
+  while (cell != to) {
+    UpdateCell(GetCellOffset(cell), -kMissLogOdds);
+    const int error_2 = 2 * error;
+    if (error_2 >= dy) {
+      error += dy;
+      cell.x += step_x;
+    }
+    if (error_2 <= dx) {
+      error += dx;
+      cell.y += step_y;
+    }
+  }
+}
+
+glm::ivec2 OccupancyGrid::GetCellAt(size_t offset) const {
+  // The tiles are allocated in order, kTileCells apart.
+  const Tile& tile = tiles_[offset / kTileCells];
+  const int local = static_cast<int>(offset % kTileCells);
+  return tile.coordinates * kTileSize +
+         glm::ivec2(local % kTileSize, local / kTileSize);
+}
+
+glm::ivec2 OccupancyGrid::GetCell(float x, float y) const {
+  return glm::ivec2(static_cast<int>(std::floor(x * inverse_cell_size_)),
+                    static_cast<int>(std::floor(y * inverse_cell_size_)));
+}
+
+}  // namespace tango_util
@@ -0,0 +1,119 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "tango-util/path_calibration.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#include <tango-gl/util.h>
+
+namespace {
+// Longest line of the store, the key included.
+const int kMaxLineLength = 1024;
+
+// @return: |line| without its line feed, false if it was cut.
+bool TrimLine(char* line) {
+  const size_t length = strlen(line);
+  if (length == 0 || line[length - 1] != '\n') {
+    return false;
+  }
+  line[length - 1] = '\0';
+  return true;
+}
+}  // namespace
+
+namespace tango_util {
+
+PathCalibration::Options::Options() : warmup_runs(3), timed_runs(7) {}
+
+PathCalibration::PathCalibration(const Options& options)
+    : warmup_runs_(std::max(options.warmup_runs, 0)),
+      timed_runs_(std::max(options.timed_runs, 1)) {}
+
+void PathCalibration::SetStore(const std::string& path,
+                               const std::string& key) {
+  path_ = path;
+  // The key is a line of the store.
+  key_ = key;
+  std::replace(key_.begin(), key_.end(), '\n', ' ');
+}
+
+int PathCalibration::LoadChoice() const {
+  if (path_.empty()) {
+    return -1;
+  }
+  FILE* file = fopen(path_.c_str(), "r");
+  if (file == NULL) {
+    return -1;
+  }
+  char line[kMaxLineLength];
+  int choice;
+  const bool is_loaded = fgets(line, sizeof(line), file) != NULL &&
+                         TrimLine(line) && key_ == line &&
+                         fscanf(file, "%d", &choice) == 1 && choice >= 0;
+  fclose(file);
+  return is_loaded ? choice : -1;
+}
+
+int PathCalibration::Calibrate(const std::vector<Path>& paths) {
+  times_.clear();
+  int choice = -1;
+  std::vector<double> run_times(timed_runs_);
+  for (size_t i = 0; i < paths.size(); ++i) {
+    for (int run = 0; run < warmup_runs_; ++run) {
+      paths[i]();
+    }
+    for (int run = 0; run < timed_runs_; ++run) {
+      const std::chrono::steady_clock::time_point start =
+          std::chrono::steady_clock::now();
+      paths[i]();
+      run_times[run] = std::chrono::duration<double, std::milli>(
+                           std::chrono::steady_clock::now() - start)
+                           .count();
+    }
+    std::nth_element(run_times.begin(), run_times.begin() + timed_runs_ / 2,
+                     run_times.end());
+    times_.push_back(run_times[timed_runs_ / 2]);
+    if (choice < 0 || times_.back() < times_[choice]) {
+      choice = static_cast<int>(i);
+    }
+  }
+  if (choice >= 0 && !path_.empty() && !StoreChoice(choice)) {
+    LOGE("PathCalibration: could not store the choice in %s", path_.c_str());
+  }
+  return choice;
+}
+
+bool PathCalibration::StoreChoice(int choice) const {
+  // Written aside and renamed, for a crash not to leave half a store.
+  const std::string temporary_path = path_ + ".tmp";
+  FILE* file = fopen(temporary_path.c_str(), "w");
+  if (file == NULL) {
+    return false;
+  }
+  const bool is_written = fprintf(file, "%s\n%d\n", key_.c_str(), choice) > 0;
+  if (fclose(file) != 0 || !is_written) {
+    remove(temporary_path.c_str());
+    return false;
+  }
+  return rename(temporary_path.c_str(), path_.c_str()) == 0;
+}
+
+}  // namespace tango_util
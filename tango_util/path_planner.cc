@@ -0,0 +1,408 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/path_planner.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+
+namespace {
+const float kInfinity = std::numeric_limits<float>::infinity();
+const float kDiagonalCost = 1.41421356f;
+
+// The moves to the neighbors of a cell, the straight ones first.
+const int kStepCount = 8;
+const glm::ivec2 kSteps[kStepCount] = {
+    glm::ivec2(1, 0),  glm::ivec2(-1, 0), glm::ivec2(0, 1),
+    glm::ivec2(0, -1), glm::ivec2(1, 1),  glm::ivec2(-1, 1),
+    glm::ivec2(1, -1), glm::ivec2(-1, -1)};
+
+const int kTileSize = tango_util::OccupancyGrid::kTileSize;
+const int kTileCells = tango_util::OccupancyGrid::kTileCells;
+
+inline int FloorDivide(int value, int divisor) {
+  return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+}
+
+inline glm::ivec2 GetTile(const glm::ivec2& cell) {
+  return glm::ivec2(FloorDivide(cell.x, kTileSize),
+                    FloorDivide(cell.y, kTileSize));
+}
+
+// The octile distance, the cost of the shortest path between two cells with
+// no cell blocked, which never overestimates the cost of a path.
+inline float GetHeuristic(const glm::ivec2& a, const glm::ivec2& b) {
+  const int dx = std::abs(a.x - b.x);
+  const int dy = std::abs(a.y - b.y);
+  return static_cast<float>(std::max(dx, dy)) +
+         (kDiagonalCost - 1.0f) * std::min(dx, dy);
+}
+
+inline bool IsKeyLess(const float a[2], const float b[2]) {
+  return a[0] < b[0] || (a[0] == b[0] && a[1] < b[1]);
+}
+}  // namespace
+
+namespace tango_util {
+
+PathPlanner::Options::Options() : max_expansions(1000), search_radius(256) {}
+
+PathPlanner::PathPlanner(const OccupancyGrid* grid, const Options& options)
+    : grid_(grid),
+      max_expansions_(options.max_expansions),
+      search_radius_(options.search_radius),
+      has_goal_(false),
+      goal_(0),
+      start_(0),
+      last_start_(0),
+      key_modifier_(0.0f),
+      status_(kNoGoal),
+      tile_origin_(0),
+      tiles_per_side_(0),
+      is_path_stale_(false),
+      revision_(0) {}
+
+void PathPlanner::SetGoal(const glm::ivec2& goal) {
+  if (has_goal_ && goal == goal_) {
+    return;
+  }
+  has_goal_ = true;
+  goal_ = goal;
+  Restart();
+}
+
+void PathPlanner::ClearGoal() {
+  has_goal_ = false;
+  Restart();
+  status_ = kNoGoal;
+  if (!path_.empty()) {
+    path_.clear();
+    ++revision_;
+  }
+}
+
+void PathPlanner::Restart() {
+  queue_ = Queue();
+  nodes_.clear();
+  node_tiles_.clear();
+  tile_offsets_.clear();
+  tiles_per_side_ = 0;
+  key_modifier_ = 0.0f;
+  last_start_ = start_;
+  if (!has_goal_) {
+    return;
+  }
+  tile_origin_ = GetTile(goal_ - glm::ivec2(search_radius_));
+  tiles_per_side_ = GetTile(goal_ + glm::ivec2(search_radius_)).x -
+                    tile_origin_.x + 1;
+  tile_offsets_.assign(tiles_per_side_ * tiles_per_side_, -1);
+  const int32_t goal_node = GetNode(goal_);
+  nodes_[goal_node].rhs = 0.0f;
+  UpdateNode(goal_node, goal_);
+  status_ = kSearching;
+  is_path_stale_ = true;
+}
+
+PathPlanner::Status PathPlanner::Update(
+    const glm::ivec2& start, const std::vector<glm::ivec2>& changed_cells) {
+  if (!has_goal_) {
+    return kNoGoal;
+  }
+  if (start != start_) {
+    start_ = start;
+    is_path_stale_ = true;
+  }
+  if (GetNode(start_) < 0) {
+    status_ = kNoPath;
+    if (!path_.empty()) {
+      path_.clear();
+      ++revision_;
+    }
+    return status_;
+  }
+  // The queued keys stay lower bounds of the keys from the new start when
+  // they all grow by the distance between the starts.
+  if (start_ != last_start_) {
+    key_modifier_ += GetHeuristic(last_start_, start_);
+    last_start_ = start_;
+  }
+  for (const glm::ivec2& cell : changed_cells) {
+    ApplyChange(cell);
+  }
+  if (!ComputeShortestPath()) {
+    status_ = kSearching;
+    return status_;
+  }
+  if (is_path_stale_) {
+    is_path_stale_ = false;
+    status_ = ExtractPath() ? kPathFound : kNoPath;
+    if (next_path_ != path_) {
+      path_.swap(next_path_);
+      ++revision_;
+    }
+  }
+  return status_;
+}
+
+int32_t PathPlanner::GetNode(const glm::ivec2& cell) {
+  const glm::ivec2 tile = GetTile(cell);
+  const glm::ivec2 index = tile - tile_origin_;
+  if (index.x < 0 || index.y < 0 || index.x >= tiles_per_side_ ||
+      index.y >= tiles_per_side_) {
+    return -1;
+  }
+  int32_t& offset = tile_offsets_[index.y * tiles_per_side_ + index.x];
+  if (offset < 0) {
+    // The nodes of a tile are allocated at once, with the blocked state of
+    // their cells, the changes after that being applied by ApplyChange().
+    offset = static_cast<int32_t>(nodes_.size());
+    node_tiles_.push_back(tile);
+    const Node free_node = {kInfinity, kInfinity, {0.0f, 0.0f}, false, false};
+    nodes_.resize(nodes_.size() + kTileCells, free_node);
+    for (int i = 0; i < kTileCells; ++i) {
+      const glm::ivec2 node_cell =
+          tile * kTileSize + glm::ivec2(i % kTileSize, i / kTileSize);
+      nodes_[offset + i].is_blocked =
+          node_cell != goal_ && grid_->IsBlocked(node_cell);
+    }
+  }
+  const glm::ivec2 local = cell - tile * kTileSize;
+  return offset + local.y * kTileSize + local.x;
+}
+
+int32_t PathPlanner::FindNode(const glm::ivec2& cell) const {
+  const glm::ivec2 tile = GetTile(cell);
+  const glm::ivec2 index = tile - tile_origin_;
+  if (index.x < 0 || index.y < 0 || index.x >= tiles_per_side_ ||
+      index.y >= tiles_per_side_) {
+    return -1;
+  }
+  const int32_t offset = tile_offsets_[index.y * tiles_per_side_ + index.x];
+  if (offset < 0) {
+    return -1;
+  }
+  const glm::ivec2 local = cell - tile * kTileSize;
+  return offset + local.y * kTileSize + local.x;
+}
+
+glm::ivec2 PathPlanner::GetNodeCell(int32_t node) const {
+  const int local = node % kTileCells;
+  return node_tiles_[node / kTileCells] * kTileSize +
+         glm::ivec2(local % kTileSize, local / kTileSize);
+}
+
+bool PathPlanner::IsBlocked(const glm::ivec2& cell) {
+  const int32_t node = GetNode(cell);
+  return node < 0 || nodes_[node].is_blocked;
+}
+
+float PathPlanner::GetCost(const glm::ivec2& cell, const glm::ivec2& step) {
+  if (IsBlocked(cell) || IsBlocked(cell + step)) {
+    return kInfinity;
+  }
+  if (step.x == 0 || step.y == 0) {
+    return 1.0f;
+  }
+  if (IsBlocked(cell + glm::ivec2(step.x, 0)) ||
+      IsBlocked(cell + glm::ivec2(0, step.y))) {
+    return kInfinity;
+  }
+  return kDiagonalCost;
+}
+
+float PathPlanner::GetBestNeighbor(const glm::ivec2& cell, glm::ivec2* best) {
+  if (IsBlocked(cell)) {
+    return kInfinity;
+  }
+  float best_value = kInfinity;
+  for (int i = 0; i < kStepCount; ++i) {
+    const glm::ivec2 neighbor = cell + kSteps[i];
+    const int32_t node = GetNode(neighbor);
+    // The cost is only looked up for the neighbors that could be better.
+    if (node < 0 || nodes_[node].g >= best_value) {
+      continue;
+    }
+    const float g = nodes_[node].g;
+    const float value = g + GetCost(cell, kSteps[i]);
+    if (value < best_value) {
+      best_value = value;
+      if (best != nullptr) {
+        *best = neighbor;
+      }
+    }
+  }
+  return best_value;
+}
+
+void PathPlanner::ComputeKey(const Node& node, const glm::ivec2& cell,
+                             float key[2]) const {
+  const float value = std::min(node.g, node.rhs);
+  key[0] = value + GetHeuristic(start_, cell) + key_modifier_;
+  key[1] = value;
+}
+
+void PathPlanner::UpdateNode(int32_t node, const glm::ivec2& cell) {
+  Node& updated = nodes_[node];
+  if (updated.g == updated.rhs) {
+    // Its entry left in the queue is skipped when popped.
+    updated.is_queued = false;
+    return;
+  }
+  float key[2];
+  ComputeKey(updated, cell, key);
+  if (updated.is_queued && key[0] == updated.key[0] &&
+      key[1] == updated.key[1]) {
+    return;
+  }
+  updated.key[0] = key[0];
+  updated.key[1] = key[1];
+  updated.is_queued = true;
+  const QueueEntry entry = {{key[0], key[1]}, node};
+  queue_.push(entry);
+}
+
+bool PathPlanner::ComputeShortestPath() {
+  const int32_t start_node = GetNode(start_);
+  for (int expansions = 0;; ++expansions) {
+    // The entries of the nodes dequeued or queued again are stale.
+    while (!queue_.empty()) {
+      const QueueEntry& top = queue_.top();
+      const Node& node = nodes_[top.node];
+      if (node.is_queued && node.key[0] == top.key[0] &&
+          node.key[1] == top.key[1]) {
+        break;
+      }
+      queue_.pop();
+    }
+    float start_key[2];
+    ComputeKey(nodes_[start_node], start_, start_key);
+    if (queue_.empty() ||
+        (!IsKeyLess(queue_.top().key, start_key) &&
+         nodes_[start_node].rhs <= nodes_[start_node].g)) {
+      return true;
+    }
+    if (expansions == max_expansions_) {
+      return false;
+    }
+    is_path_stale_ = true;
+
+    const QueueEntry top = queue_.top();
+    queue_.pop();
+    const int32_t node = top.node;
+    const glm::ivec2 cell = GetNodeCell(node);
+    float key[2];
+    ComputeKey(nodes_[node], cell, key);
+    if (IsKeyLess(top.key, key)) {
+      // Queued from an earlier start.
+      nodes_[node].key[0] = key[0];
+      nodes_[node].key[1] = key[1];
+      const QueueEntry entry = {{key[0], key[1]}, node};
+      queue_.push(entry);
+      continue;
+    }
+    nodes_[node].is_queued = false;
+
+    if (nodes_[node].g > nodes_[node].rhs) {
+      // Closer than it was: the neighbors can only get closer through it.
+      const float g = nodes_[node].rhs;
+      nodes_[node].g = g;
+      for (int i = 0; i < kStepCount; ++i) {
+        const glm::ivec2 neighbor = cell + kSteps[i];
+        if (neighbor == goal_) {
+          continue;
+        }
+        const float value = g + GetCost(cell, kSteps[i]);
+        const int32_t neighbor_node = GetNode(neighbor);
+        if (neighbor_node >= 0 && value < nodes_[neighbor_node].rhs) {
+          nodes_[neighbor_node].rhs = value;
+          UpdateNode(neighbor_node, neighbor);
+        }
+      }
+    } else {
+      // Farther than it was: the neighbors that went through it look for
+      // another way, as it does.
+      const float previous_g = nodes_[node].g;
+      nodes_[node].g = kInfinity;
+      for (int i = 0; i < kStepCount; ++i) {
+        const glm::ivec2 neighbor = cell + kSteps[i];
+        const int32_t neighbor_node = FindNode(neighbor);
+        if (neighbor == goal_ || neighbor_node < 0) {
+          continue;
+        }
+        const float cost = GetCost(cell, kSteps[i]);
+        if (cost != kInfinity &&
+            nodes_[neighbor_node].rhs == previous_g + cost) {
+          nodes_[neighbor_node].rhs = GetBestNeighbor(neighbor, nullptr);
+          UpdateNode(neighbor_node, neighbor);
+        }
+      }
+      if (cell != goal_) {
+        nodes_[node].rhs = GetBestNeighbor(cell, nullptr);
+      }
+      UpdateNode(node, cell);
+    }
+  }
+}
+
+void PathPlanner::ApplyChange(const glm::ivec2& cell) {
+  const int32_t node = FindNode(cell);
+  if (node < 0) {
+    // Its tile reads the cell when allocated.
+    return;
+  }
+  const bool is_blocked = cell != goal_ && grid_->IsBlocked(cell);
+  if (nodes_[node].is_blocked == is_blocked) {
+    return;
+  }
+  nodes_[node].is_blocked = is_blocked;
+  // The moves changed are those from the cell, and the diagonals around its
+  // corners, all from a cell of the 3x3 block around it.
+  for (int y = -1; y <= 1; ++y) {
+    for (int x = -1; x <= 1; ++x) {
+      const glm::ivec2 neighbor = cell + glm::ivec2(x, y);
+      const int32_t neighbor_node = FindNode(neighbor);
+      if (neighbor == goal_ || neighbor_node < 0) {
+        continue;
+      }
+      nodes_[neighbor_node].rhs = GetBestNeighbor(neighbor, nullptr);
+      UpdateNode(neighbor_node, neighbor);
+    }
+  }
+  is_path_stale_ = true;
+}
+
+bool PathPlanner::ExtractPath() {
+  next_path_.clear();
+  glm::ivec2 cell = start_;
+  next_path_.push_back(cell);
+  // The distances only decrease along the path, the bound only guarding
+  // against a bug looping forever.
+  const size_t max_length = nodes_.size();
+  while (cell != goal_) {
+    glm::ivec2 next;
+    if (GetBestNeighbor(cell, &next) == kInfinity ||
+        next_path_.size() > max_length) {
+      next_path_.clear();
+      return false;
+    }
+    cell = next;
+    next_path_.push_back(cell);
+  }
+  return true;
+}
+
+}  // namespace tango_util
@@ -0,0 +1,126 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/performance_budget.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace tango_util {
+
+PerformanceBudget::PerformanceBudget(double tolerance)
+    : tolerance_(tolerance) {}
+
+void PerformanceBudget::SetStageBudget(const char* stage,
+                                       double percentile_95_ms,
+                                       double max_ms) {
+  StageBudget budget;
+  budget.stage = stage;
+  budget.percentile_95_ms = percentile_95_ms;
+  budget.max_ms = max_ms;
+  stage_budgets_.push_back(budget);
+}
+
+void PerformanceBudget::SetMemoryBudget(tango_gl::MemoryTag tag,
+                                        tango_gl::MemoryDomain domain,
+                                        int64_t peak_bytes,
+                                        int32_t allocation_count) {
+  MemoryBudget budget;
+  budget.tag = tag;
+  budget.domain = domain;
+  budget.peak_bytes = peak_bytes;
+  budget.allocation_count = allocation_count;
+  memory_budgets_.push_back(budget);
+}
+
+bool PerformanceBudget::Check(
+    const std::vector<tango_gl::tracing::SliceStatistics>& stages,
+    std::string* report) const {
+  std::string checks;
+  bool is_passed = true;
+  for (const StageBudget& budget : stage_budgets_) {
+    const tango_gl::tracing::SliceStatistics* found = nullptr;
+    for (const tango_gl::tracing::SliceStatistics& stage : stages) {
+      if (strcmp(stage.name, budget.stage) == 0) {
+        found = &stage;
+        break;
+      }
+    }
+    if (found == nullptr) {
+      // A stage that did not run is as suspicious as a slow one.
+      LOGE("PerformanceBudget: %s was not run.", budget.stage);
+      AppendCheck(budget.stage, "count", 0.0, 0.0, false, &checks);
+      is_passed = false;
+      continue;
+    }
+    if (budget.percentile_95_ms > 0.0) {
+      is_passed &= CheckMeasure(budget.stage, "percentile_95_ms",
+                                found->percentile_95_ms,
+                                budget.percentile_95_ms, &checks);
+    }
+    if (budget.max_ms > 0.0) {
+      is_passed &= CheckMeasure(budget.stage, "max_ms", found->max_ms,
+                                budget.max_ms, &checks);
+    }
+  }
+  for (const MemoryBudget& budget : memory_budgets_) {
+    const tango_gl::MemoryUsage usage =
+        tango_gl::GetMemoryUsage(budget.tag, budget.domain);
+    char name[64];
+    snprintf(name, sizeof(name), "%s_%s",
+             tango_gl::GetMemoryTagName(budget.tag),
+             budget.domain == tango_gl::kMemoryCpu ? "cpu" : "gpu");
+    if (budget.peak_bytes > 0) {
+      is_passed &= CheckMeasure(name, "peak_bytes",
+                                static_cast<double>(usage.peak_bytes),
+                                static_cast<double>(budget.peak_bytes),
+                                &checks);
+    }
+    if (budget.allocation_count > 0) {
+      is_passed &= CheckMeasure(name, "allocations", usage.allocation_count,
+                                budget.allocation_count, &checks);
+    }
+  }
+  if (report != nullptr) {
+    *report = std::string("{\"passed\":") + (is_passed ? "true" : "false") +
+              ",\"checks\":[" + checks + "]}";
+  }
+  return is_passed;
+}
+
+bool PerformanceBudget::CheckMeasure(const char* name, const char* measure,
+                                     double value, double budget,
+                                     std::string* report) const {
+  const bool is_passed = value <= budget * (1.0 + tolerance_);
+  AppendCheck(name, measure, value, budget, is_passed, report);
+  if (!is_passed) {
+    LOGE("PerformanceBudget: %s %s is %.2f, over the budget of %.2f.", name,
+         measure, value, budget);
+  }
+  return is_passed;
+}
+void PerformanceBudget::AppendCheck(const char* name, const char* measure,
+                                    double value, double budget,
+                                    bool is_passed, std::string* report) {
+  char check[256];
+  snprintf(check, sizeof(check),
+           "%s{\"name\":\"%s\",\"measure\":\"%s\",\"value\":%.2f,"
+           "\"budget\":%.2f,\"passed\":%s}",
+           report->empty() ? "" : ",", name, measure, value, budget,
+           is_passed ? "true" : "false");
+  report->append(check);
+}
+}  // namespace tango_util
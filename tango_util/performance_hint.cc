@@ -0,0 +1,194 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/performance_hint.h"
+
+#include <dlfcn.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include <tango-gl/util.h>
+
+namespace {
+const double kNanosecondsPerMillisecond = 1e6;
+
+// The APerformanceHint functions of android/performance_hint.h, the handles
+// being opaque.
+typedef void* (*GetManagerFunction)();
+typedef void* (*CreateSessionFunction)(void* manager,
+                                       const int32_t* thread_ids, size_t size,
+                                       int64_t target_duration_ns);
+typedef int (*UpdateTargetFunction)(void* session,
+                                    int64_t target_duration_ns);
+typedef int (*ReportActualFunction)(void* session,
+                                    int64_t actual_duration_ns);
+typedef void (*CloseSessionFunction)(void* session);
+// Android 14 and later only.
+typedef int (*SetThreadsFunction)(void* session, const int32_t* thread_ids,
+                                  size_t size);
+
+struct HintApi {
+  GetManagerFunction get_manager;
+  CreateSessionFunction create_session;
+  UpdateTargetFunction update_target;
+  ReportActualFunction report_actual;
+  CloseSessionFunction close_session;
+  SetThreadsFunction set_threads;
+  // Of get_manager(), null without support.
+  void* manager;
+};
+
+HintApi* LoadHintApi() {
+  HintApi* api = new HintApi();
+  // libandroid.so is loaded by every app, this only takes another reference.
+  void* library = dlopen("libandroid.so", RTLD_NOW | RTLD_LOCAL);
+  if (library == nullptr) {
+    return api;
+  }
+  api->get_manager = reinterpret_cast<GetManagerFunction>(
+      dlsym(library, "APerformanceHint_getManager"));
+  api->create_session = reinterpret_cast<CreateSessionFunction>(
+      dlsym(library, "APerformanceHint_createSession"));
+  api->update_target = reinterpret_cast<UpdateTargetFunction>(
+      dlsym(library, "APerformanceHint_updateTargetWorkDuration"));
+  api->report_actual = reinterpret_cast<ReportActualFunction>(
+      dlsym(library, "APerformanceHint_reportActualWorkDuration"));
+  api->close_session = reinterpret_cast<CloseSessionFunction>(
+      dlsym(library, "APerformanceHint_closeSession"));
+  api->set_threads = reinterpret_cast<SetThreadsFunction>(
+      dlsym(library, "APerformanceHint_setThreads"));
+  if (api->get_manager != nullptr && api->create_session != nullptr &&
+      api->update_target != nullptr && api->report_actual != nullptr &&
+      api->close_session != nullptr) {
+    api->manager = api->get_manager();
+  }
+  if (api->manager == nullptr) {
+    LOGI("PerformanceHintSession: performance hints are not supported");
+  }
+  return api;
+}
+
+// @return: the functions, loaded once, their manager being null without
+//          support.
+const HintApi& GetHintApi() {
+  static HintApi* api = LoadHintApi();
+  return *api;
+}
+
+int64_t ToNanoseconds(double milliseconds) {
+  return static_cast<int64_t>(milliseconds * kNanosecondsPerMillisecond);
+}
+}  // namespace
+
+namespace tango_util {
+
+PerformanceHintSession::PerformanceHintSession(const char* name)
+    : name_(name),
+      target_duration_ns_(0),
+      session_(nullptr),
+      are_threads_changed_(false),
+      is_target_changed_(false),
+      is_refused_(false) {}
+
+PerformanceHintSession::~PerformanceHintSession() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  CloseLocked();
+}
+
+bool PerformanceHintSession::IsSupported() {
+  return GetHintApi().manager != nullptr;
+}
+
+void PerformanceHintSession::SetTargetDuration(double target_duration) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const int64_t target_duration_ns = ToNanoseconds(target_duration);
+  if (target_duration_ns != target_duration_ns_) {
+    target_duration_ns_ = target_duration_ns;
+    is_target_changed_ = true;
+  }
+}
+
+void PerformanceHintSession::AddCurrentThread() {
+  const int32_t thread_id = static_cast<int32_t>(syscall(__NR_gettid));
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (std::find(thread_ids_.begin(), thread_ids_.end(), thread_id) ==
+      thread_ids_.end()) {
+    thread_ids_.push_back(thread_id);
+    are_threads_changed_ = true;
+    is_refused_ = false;
+  }
+}
+
+void PerformanceHintSession::ReportActualDuration(double duration) {
+  const HintApi& api = GetHintApi();
+  if (api.manager == nullptr) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (target_duration_ns_ <= 0 || thread_ids_.empty()) {
+    return;
+  }
+  if (session_ == nullptr || are_threads_changed_) {
+    if (is_refused_ || !OpenLocked()) {
+      return;
+    }
+  }
+  if (is_target_changed_) {
+    api.update_target(session_, target_duration_ns_);
+    is_target_changed_ = false;
+  }
+  // The framework refuses durations that are not positive.
+  api.report_actual(session_, std::max<int64_t>(ToNanoseconds(duration), 1));
+}
+
+bool PerformanceHintSession::IsOpen() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return session_ != nullptr;
+}
+
+bool PerformanceHintSession::OpenLocked() {
+  const HintApi& api = GetHintApi();
+  are_threads_changed_ = false;
+  if (session_ != nullptr && api.set_threads != nullptr &&
+      api.set_threads(session_, thread_ids_.data(), thread_ids_.size()) ==
+          0) {
+    return true;
+  }
+  // Without setThreads(), a session only has the threads it was created
+  // with.
+  CloseLocked();
+  session_ = api.create_session(api.manager, thread_ids_.data(),
+                                thread_ids_.size(), target_duration_ns_);
+  is_target_changed_ = false;
+  if (session_ == nullptr) {
+    LOGE("PerformanceHintSession: the %s session was refused", name_);
+    is_refused_ = true;
+    return false;
+  }
+  LOGI("PerformanceHintSession: opened the %s session for %d threads", name_,
+       static_cast<int>(thread_ids_.size()));
+  return true;
+}
+
+void PerformanceHintSession::CloseLocked() {
+  if (session_ != nullptr) {
+    GetHintApi().close_session(session_);
+    session_ = nullptr;
+  }
+}
+}  // namespace tango_util
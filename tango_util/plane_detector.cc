@@ -0,0 +1,336 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/plane_detector.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <mutex>
+#include <random>
+
+#include "tango-util/convex_hull.h"
+
+namespace {
+// Planes closer to horizontal than this, as the cosine of the angle between
+// their normal and z, get an arbitrary horizontal tangent.
+const float kHorizontalCosine = 0.99f;
+
+// Hypotheses whose sample points are closer together than this, in meters,
+// are too ill-conditioned to score.
+const float kMinSampleSpacing = 0.05f;
+
+// Fraction of the inliers left out of the extent of a plane on each side, so
+// a few outliers within the inlier distance do not stretch it.
+const float kExtentQuantile = 0.05f;
+
+// Number of Jacobi sweeps of the eigen decomposition, plenty for 3x3.
+const int kJacobiSweepCount = 8;
+
+// Scramble a seed, the first numbers drawn by std::minstd_rand from nearby
+// seeds being correlated.
+uint32_t MixSeed(uint32_t seed) {
+  seed ^= seed >> 16;
+  seed *= 0x85ebca6bu;
+  seed ^= seed >> 13;
+  seed *= 0xc2b2ae35u;
+  seed ^= seed >> 16;
+  return seed;
+}
+
+// Number of hypotheses to draw for |confidence| of drawing one of three
+// inliers, given the fraction of inliers.
+int GetRequiredIterationCount(float inlier_ratio, float confidence,
+                              int max_iteration_count) {
+  const double all_inliers = std::pow(inlier_ratio, 3.0);
+  if (all_inliers >= 1.0) {
+    return 1;
+  }
+  if (all_inliers <= 0.0) {
+    return max_iteration_count;
+  }
+  const double count =
+      std::ceil(std::log(1.0 - confidence) / std::log(1.0 - all_inliers));
+  return static_cast<int>(
+      std::min(count, static_cast<double>(max_iteration_count)));
+}
+}  // namespace
+
+namespace tango_util {
+
+void GetPlaneBasis(const glm::vec3& normal, glm::vec3* tangent,
+                   glm::vec3* bitangent) {
+  const glm::vec3 up(0.0f, 0.0f, 1.0f);
+  if (std::fabs(glm::dot(normal, up)) > kHorizontalCosine) {
+    *tangent = glm::normalize(glm::cross(glm::vec3(0.0f, 1.0f, 0.0f), normal));
+  } else {
+    *tangent = glm::normalize(glm::cross(up, normal));
+  }
+  *bitangent = glm::cross(normal, *tangent);
+}
+
+glm::vec3 GetSmallestEigenvector(const glm::mat3& symmetric) {
+  // Diagonalized by Jacobi rotations.
+  glm::mat3 a = symmetric;
+  glm::mat3 vectors(1.0f);
+  for (int sweep = 0; sweep < kJacobiSweepCount; ++sweep) {
+    for (int p = 0; p < 2; ++p) {
+      for (int q = p + 1; q < 3; ++q) {
+        if (std::fabs(a[q][p]) < 1e-12f) {
+          continue;
+        }
+        const float theta = (a[q][q] - a[p][p]) / (2.0f * a[q][p]);
+        const float t = (theta >= 0.0f ? 1.0f : -1.0f) /
+                        (std::fabs(theta) + std::sqrt(theta * theta + 1.0f));
+        const float c = 1.0f / std::sqrt(t * t + 1.0f);
+        const float s = t * c;
+        glm::mat3 rotation(1.0f);
+        rotation[p][p] = c;
+        rotation[q][q] = c;
+        rotation[q][p] = s;
+        rotation[p][q] = -s;
+        a = glm::transpose(rotation) * a * rotation;
+        vectors = vectors * rotation;
+      }
+    }
+  }
+  int smallest = 0;
+  for (int i = 1; i < 3; ++i) {
+    if (a[i][i] < a[smallest][smallest]) {
+      smallest = i;
+    }
+  }
+  return glm::normalize(vectors[smallest]);
+}
+
+PlaneDetector::Options::Options()
+    : inlier_distance(0.02f),
+      min_inlier_count(200),
+      max_plane_count(4),
+      max_iteration_count(256),
+      min_normal_cosine(0.94f),
+      confidence(0.99f),
+      thread_count(2) {}
+
+PlaneDetector::PlaneDetector(const Options& options)
+    : options_(options), worker_pool_(options.thread_count), frame_count_(0) {}
+
+void PlaneDetector::Detect(const TangoXYZij* xyz_ij,
+                           const glm::mat4& frame_T_depth,
+                           std::vector<DetectedPlane>* planes) {
+  Detect(xyz_ij, nullptr, frame_T_depth, planes);
+}
+
+void PlaneDetector::Detect(const TangoXYZij* xyz_ij, const glm::vec3* normals,
+                           const glm::mat4& frame_T_depth,
+                           std::vector<DetectedPlane>* planes) {
+  planes->clear();
+  ++frame_count_;
+  if (xyz_ij == nullptr) {
+    return;
+  }
+  points_.resize(xyz_ij->xyz_count);
+  remaining_.resize(xyz_ij->xyz_count);
+  for (uint32_t i = 0; i < xyz_ij->xyz_count; ++i) {
+    const float* xyz = xyz_ij->xyz[i];
+    points_[i] =
+        glm::vec3(frame_T_depth * glm::vec4(xyz[0], xyz[1], xyz[2], 1.0f));
+    remaining_[i] = i;
+  }
+  normals_.clear();
+  if (normals != nullptr) {
+    // Rotated only, zero normals stay zero.
+    const glm::mat3 rotation(frame_T_depth);
+    normals_.resize(xyz_ij->xyz_count);
+    for (uint32_t i = 0; i < xyz_ij->xyz_count; ++i) {
+      normals_[i] = rotation * normals[i];
+    }
+  }
+
+  const glm::vec3 viewpoint(frame_T_depth[3]);
+  DetectedPlane plane;
+  while (static_cast<int>(planes->size()) < options_.max_plane_count &&
+         remaining_.size() >= options_.min_inlier_count &&
+         FindPlane(viewpoint, &plane)) {
+    planes->push_back(plane);
+    // The next plane is searched among the points left. Both lists are in
+    // increasing order, inliers_ being collected from remaining_.
+    size_t left_count = 0;
+    size_t inlier = 0;
+    for (uint32_t index : remaining_) {
+      if (inlier < inliers_.size() && inliers_[inlier] == index) {
+        ++inlier;
+      } else {
+        remaining_[left_count++] = index;
+      }
+    }
+    remaining_.resize(left_count);
+  }
+}
+
+bool PlaneDetector::FindPlane(const glm::vec3& viewpoint,
+                              DetectedPlane* plane) {
+  const uint32_t point_count = static_cast<uint32_t>(remaining_.size());
+  std::mutex best_mutex;
+  glm::vec4 best_equation;
+  uint32_t best_inlier_count = 0;
+  std::atomic<int> required_iteration_count(options_.max_iteration_count);
+
+  worker_pool_.ParallelFor(options_.max_iteration_count, [&](size_t i) {
+    // Hypotheses past the required count are skipped, which ends the loop
+    // early once a good plane is found.
+    if (static_cast<int>(i) >= required_iteration_count.load()) {
+      return;
+    }
+    // Seeded by the hypothesis, so the result does not depend on which
+    // thread draws it.
+    std::minstd_rand random(
+        MixSeed(frame_count_ * 7919u + static_cast<uint32_t>(i)));
+    std::uniform_int_distribution<uint32_t> distribution(0, point_count - 1);
+    const glm::vec3& a = points_[remaining_[distribution(random)]];
+    const glm::vec3& b = points_[remaining_[distribution(random)]];
+    const glm::vec3& c = points_[remaining_[distribution(random)]];
+    if (glm::distance(a, b) < kMinSampleSpacing ||
+        glm::distance(a, c) < kMinSampleSpacing) {
+      return;
+    }
+    const glm::vec3 cross = glm::cross(b - a, c - a);
+    const float length = glm::length(cross);
+    if (length < kMinSampleSpacing * kMinSampleSpacing) {
+      return;
+    }
+    const glm::vec3 normal = cross / length;
+    const glm::vec4 equation(normal, -glm::dot(normal, a));
+
+    uint32_t inlier_count = 0;
+    for (uint32_t index : remaining_) {
+      if (IsInlier(equation, index)) {
+        ++inlier_count;
+      }
+    }
+
+    std::lock_guard<std::mutex> lock(best_mutex);
+    if (inlier_count > best_inlier_count) {
+      best_inlier_count = inlier_count;
+      best_equation = equation;
+      required_iteration_count.store(std::min(
+          required_iteration_count.load(),
+          GetRequiredIterationCount(
+              static_cast<float>(inlier_count) / point_count,
+              options_.confidence, options_.max_iteration_count)));
+    }
+  });
+
+  if (best_inlier_count < options_.min_inlier_count) {
+    return false;
+  }
+
+  // Two rounds of least squares, the inliers of the refined plane being a
+  // better sample than those of the hypothesis.
+  glm::vec4 equation = best_equation;
+  glm::vec3 centroid;
+  for (int round = 0; round < 2; ++round) {
+    CollectInliers(equation);
+    if (inliers_.size() < options_.min_inlier_count) {
+      return false;
+    }
+    equation = FitPlane(&centroid);
+  }
+  CollectInliers(equation);
+  if (inliers_.size() < options_.min_inlier_count) {
+    return false;
+  }
+
+  if (glm::dot(glm::vec3(equation), viewpoint) + equation.w < 0.0f) {
+    equation = -equation;
+  }
+  plane->equation = equation;
+  plane->centroid = centroid;
+  GetPlaneBasis(glm::vec3(equation), &plane->tangent, &plane->bitangent);
+  for (int axis = 0; axis < 2; ++axis) {
+    const glm::vec3& direction = axis == 0 ? plane->tangent : plane->bitangent;
+    coordinates_.clear();
+    for (uint32_t index : inliers_) {
+      coordinates_.push_back(glm::dot(points_[index] - centroid, direction));
+    }
+    const size_t low = static_cast<size_t>(kExtentQuantile * inliers_.size());
+    const size_t high = inliers_.size() - 1 - low;
+    std::nth_element(coordinates_.begin(), coordinates_.begin() + low,
+                     coordinates_.end());
+    plane->min_extent[axis] = coordinates_[low];
+    std::nth_element(coordinates_.begin(), coordinates_.begin() + high,
+                     coordinates_.end());
+    plane->max_extent[axis] = coordinates_[high];
+  }
+  // The inliers past the extent are clamped to it rather than left out, so
+  // that the hull keeps the shape of the plane up to its extent.
+  hull_.clear();
+  for (uint32_t index : inliers_) {
+    const glm::vec3 offset = points_[index] - centroid;
+    hull_.push_back(glm::clamp(
+        glm::vec2(glm::dot(offset, plane->tangent),
+                  glm::dot(offset, plane->bitangent)),
+        plane->min_extent, plane->max_extent));
+  }
+  ComputeConvexHull(&hull_);
+  plane->hull.assign(hull_.begin(), hull_.end());
+  plane->inlier_count = static_cast<uint32_t>(inliers_.size());
+  return true;
+}
+
+glm::vec4 PlaneDetector::FitPlane(glm::vec3* centroid) const {
+  glm::dvec3 sum(0.0);
+  for (uint32_t index : inliers_) {
+    sum += glm::dvec3(points_[index]);
+  }
+  const glm::vec3 mean = glm::vec3(sum / static_cast<double>(inliers_.size()));
+  glm::mat3 covariance(0.0f);
+  for (uint32_t index : inliers_) {
+    const glm::vec3 offset = points_[index] - mean;
+    covariance += glm::outerProduct(offset, offset);
+  }
+  const glm::vec3 normal = GetSmallestEigenvector(covariance);
+  *centroid = mean;
+  return glm::vec4(normal, -glm::dot(normal, mean));
+}
+
+bool PlaneDetector::IsInlier(const glm::vec4& equation,
+                             uint32_t index) const {
+  const glm::vec3 normal(equation);
+  if (std::fabs(glm::dot(normal, points_[index]) + equation.w) >=
+      options_.inlier_distance) {
+    return false;
+  }
+  if (normals_.empty()) {
+    return true;
+  }
+  // The normal of a hypothesis may face either side.
+  const glm::vec3& point_normal = normals_[index];
+  return std::fabs(glm::dot(normal, point_normal)) >=
+             options_.min_normal_cosine ||
+         glm::dot(point_normal, point_normal) == 0.0f;
+}
+
+void PlaneDetector::CollectInliers(const glm::vec4& equation) {
+  inliers_.clear();
+  for (uint32_t index : remaining_) {
+    if (IsInlier(equation, index)) {
+      inliers_.push_back(index);
+    }
+  }
+}
+
+}  // namespace tango_util
@@ -0,0 +1,207 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/plane_tracker.h"
+
+#include <cmath>
+#include <limits>
+
+#include "tango-util/convex_hull.h"
+
+namespace {
+// Rays closer to parallel to a plane, as the cosine of their angle to its
+// normal, do not intersect it.
+const float kMinRayCosine = 1e-3f;
+
+// Extent of |plane| in the basis of |basis_plane|, centered on its
+// centroid, as the corners of the bounding rectangle.
+void GetExtentIn(const tango_util::DetectedPlane& plane,
+                 const tango_util::DetectedPlane& basis_plane,
+                 glm::vec2* min_extent, glm::vec2* max_extent) {
+  for (int corner = 0; corner < 4; ++corner) {
+    const glm::vec2 coordinates(
+        corner & 1 ? plane.max_extent.x : plane.min_extent.x,
+        corner & 2 ? plane.max_extent.y : plane.min_extent.y);
+    const glm::vec3 point = plane.centroid + coordinates.x * plane.tangent +
+                            coordinates.y * plane.bitangent;
+    const glm::vec3 offset = point - basis_plane.centroid;
+    const glm::vec2 projected(glm::dot(offset, basis_plane.tangent),
+                              glm::dot(offset, basis_plane.bitangent));
+    *min_extent = glm::min(*min_extent, projected);
+    *max_extent = glm::max(*max_extent, projected);
+  }
+}
+
+// Append the hull of |plane| in the basis of |basis_plane| to |points|.
+void AppendHullIn(const tango_util::DetectedPlane& plane,
+                  const tango_util::DetectedPlane& basis_plane,
+                  std::vector<glm::vec2>* points) {
+  for (const glm::vec2& vertex : plane.hull) {
+    const glm::vec3 offset = plane.centroid + vertex.x * plane.tangent +
+                             vertex.y * plane.bitangent - basis_plane.centroid;
+    points->push_back(glm::vec2(glm::dot(offset, basis_plane.tangent),
+                                glm::dot(offset, basis_plane.bitangent)));
+  }
+}
+}  // namespace
+
+namespace tango_util {
+
+const size_t PlaneTracker::kMaxHullVertexCount;
+
+PlaneTracker::Options::Options()
+    : max_normal_angle(0.2f),
+      max_offset(0.05f),
+      max_gap(0.3f),
+      smoothing(0.3f),
+      min_observation_count(3),
+      max_missed_count(10) {}
+
+PlaneTracker::PlaneTracker(const Options& options)
+    : options_(options),
+      min_normal_cosine_(std::cos(options.max_normal_angle)),
+      next_id_(0) {}
+
+void PlaneTracker::Update(const std::vector<DetectedPlane>& detected_planes) {
+  for (TrackedPlane& tracked : planes_) {
+    ++tracked.missed_count;
+  }
+
+  for (const DetectedPlane& detected : detected_planes) {
+    const glm::vec3 normal(detected.equation);
+    TrackedPlane* match = nullptr;
+    float match_offset = options_.max_offset;
+    for (TrackedPlane& tracked : planes_) {
+      // A tracked plane matches one detected plane per point cloud.
+      if (tracked.missed_count == 0) {
+        continue;
+      }
+      const glm::vec4& equation = tracked.plane.equation;
+      if (glm::dot(glm::vec3(equation), normal) < min_normal_cosine_) {
+        continue;
+      }
+      const float offset = std::fabs(
+          glm::dot(glm::vec3(equation), detected.centroid) + equation.w);
+      if (offset >= match_offset) {
+        continue;
+      }
+      glm::vec2 min_extent(std::numeric_limits<float>::max());
+      glm::vec2 max_extent(-std::numeric_limits<float>::max());
+      GetExtentIn(detected, tracked.plane, &min_extent, &max_extent);
+      const glm::vec2 gap(options_.max_gap);
+      if (glm::any(glm::greaterThan(min_extent,
+                                    tracked.plane.max_extent + gap)) ||
+          glm::any(glm::lessThan(max_extent, tracked.plane.min_extent - gap))) {
+        continue;
+      }
+      match = &tracked;
+      match_offset = offset;
+    }
+
+    if (match == nullptr) {
+      TrackedPlane tracked;
+      tracked.id = next_id_++;
+      tracked.plane = detected;
+      tracked.total_inlier_count = detected.inlier_count;
+      tracked.observation_count = 1;
+      tracked.missed_count = 0;
+      planes_.push_back(tracked);
+      continue;
+    }
+
+    // The extent grows in the basis of the plane before it is updated, then
+    // is carried over to the basis of the updated plane.
+    DetectedPlane previous = match->plane;
+    GetExtentIn(detected, previous, &previous.min_extent,
+                &previous.max_extent);
+    DetectedPlane& plane = match->plane;
+    const float smoothing = options_.smoothing;
+    const glm::vec3 smoothed_normal = glm::normalize(
+        glm::mix(glm::vec3(plane.equation), normal, smoothing));
+    plane.centroid = glm::mix(plane.centroid, detected.centroid, smoothing);
+    plane.equation = glm::vec4(smoothed_normal,
+                               -glm::dot(smoothed_normal, plane.centroid));
+    GetPlaneBasis(smoothed_normal, &plane.tangent, &plane.bitangent);
+    plane.min_extent = glm::vec2(std::numeric_limits<float>::max());
+    plane.max_extent = glm::vec2(-std::numeric_limits<float>::max());
+    GetExtentIn(previous, plane, &plane.min_extent, &plane.max_extent);
+    // The hulls of the previous plane and of the detection in the new basis.
+    plane.hull.clear();
+    AppendHullIn(previous, plane, &plane.hull);
+    AppendHullIn(detected, plane, &plane.hull);
+    ComputeConvexHull(&plane.hull);
+    SimplifyConvexHull(kMaxHullVertexCount, &plane.hull);
+    plane.inlier_count = detected.inlier_count;
+    match->total_inlier_count += detected.inlier_count;
+    ++match->observation_count;
+    match->missed_count = 0;
+  }
+
+  std::vector<TrackedPlane>::iterator end = planes_.begin();
+  for (const TrackedPlane& tracked : planes_) {
+    if (tracked.observation_count >= options_.min_observation_count ||
+        tracked.missed_count <= options_.max_missed_count) {
+      *end++ = tracked;
+    }
+  }
+  planes_.erase(end, planes_.end());
+}
+
+void PlaneTracker::GetConfirmedPlanes(
+    std::vector<TrackedPlane>* planes) const {
+  planes->clear();
+  for (const TrackedPlane& tracked : planes_) {
+    if (tracked.observation_count >= options_.min_observation_count) {
+      planes->push_back(tracked);
+    }
+  }
+}
+
+const TrackedPlane* PlaneTracker::Raycast(
+    const std::vector<TrackedPlane>& planes, const glm::vec3& origin,
+    const glm::vec3& direction, glm::vec3* point) {
+  const TrackedPlane* nearest = nullptr;
+  float nearest_distance = std::numeric_limits<float>::max();
+  for (const TrackedPlane& tracked : planes) {
+    const DetectedPlane& plane = tracked.plane;
+    const glm::vec3 normal(plane.equation);
+    const float cosine = glm::dot(normal, direction);
+    if (std::fabs(cosine) < kMinRayCosine) {
+      continue;
+    }
+    const float distance =
+        -(glm::dot(normal, origin) + plane.equation.w) / cosine;
+    if (distance <= 0.0f || distance >= nearest_distance) {
+      continue;
+    }
+    const glm::vec3 hit = origin + direction * distance;
+    const glm::vec3 offset = hit - plane.centroid;
+    const glm::vec2 coordinates(glm::dot(offset, plane.tangent),
+                                glm::dot(offset, plane.bitangent));
+    if (glm::any(glm::lessThan(coordinates, plane.min_extent)) ||
+        glm::any(glm::greaterThan(coordinates, plane.max_extent)) ||
+        (plane.hull.size() >= 3 &&
+         !IsInsideConvexHull(plane.hull, coordinates))) {
+      continue;
+    }
+    nearest = &tracked;
+    nearest_distance = distance;
+    *point = hit;
+  }
+  return nearest;
+}
+
+}  // namespace tango_util
@@ -0,0 +1,289 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/ply_exporter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include <tango-gl/tracing.h>
+
+#include "tango-util/thread_policy.h"
+
+namespace {
+// Size of the vertex_indices list of a triangle, as the uchar of its PLY
+// property.
+const uint8_t kFaceVertexCount = 3;
+}  // namespace
+
+namespace tango_util {
+
+PlyExporter::PlyExporter()
+    : is_busy_(false),
+      file_(NULL),
+      buffer_size_(0),
+      export_count_(0),
+      failed_count_(0),
+      bytes_written_(0),
+      last_export_time_(0.0) {}
+
+PlyExporter::~PlyExporter() { Wait(); }
+
+void PlyExporter::Wait() {
+  if (writer_.joinable()) {
+    writer_.join();
+  }
+}
+
+bool PlyExporter::ExportPointCloud(const char* path, const TangoXYZij* xyz_ij,
+                                   const glm::mat4& world_T_depth) {
+  if (IsBusy()) {
+    return false;
+  }
+  Wait();
+  const float* xyz = &xyz_ij->xyz[0][0];
+  points_.assign(xyz, xyz + xyz_ij->xyz_count * 3);
+  world_T_depth_ = world_T_depth;
+  return Start(path, [this]() { return WritePointCloud(); });
+}
+
+bool PlyExporter::ExportPointCloudMap(const char* path,
+                                      const PointCloudMap* map) {
+  return Start(path, [this, map]() { return WritePointCloudMap(map); });
+}
+
+bool PlyExporter::ExportMeshes(
+    const char* path,
+    const std::vector<const TangoMesh_Experimental*>& meshes) {
+  uint64_t face_count = 0;
+  for (const TangoMesh_Experimental* mesh : meshes) {
+    face_count += mesh->num_faces;
+  }
+  if (face_count == 0) {
+    return false;
+  }
+  return Start(path, [this, meshes]() { return WriteMeshes(meshes); });
+}
+
+PlyExporter::Stats PlyExporter::GetStats() const {
+  Stats stats;
+  stats.export_count = export_count_.load();
+  stats.failed_count = failed_count_.load();
+  stats.bytes_written = bytes_written_.load();
+  stats.last_export_time = last_export_time_.load();
+  return stats;
+}
+
+bool PlyExporter::Start(const char* path, std::function<bool()> write) {
+  if (is_busy_.exchange(true)) {
+    return false;
+  }
+  // The previous writer thread is done, since is_busy_ was false.
+  Wait();
+  const std::string file_path(path);
+  writer_ = std::thread([this, file_path, write]() {
+    TANGO_TRACE_SCOPE("PlyExporter::Write");
+    ThreadPolicy::Get().Enter(ThreadPolicy::kBulkStage);
+    const std::chrono::steady_clock::time_point start_time =
+        std::chrono::steady_clock::now();
+    bool is_written = false;
+    file_ = fopen(file_path.c_str(), "wb");
+    if (file_ == NULL) {
+      LOGE("PlyExporter: Failed to create %s", file_path.c_str());
+    } else {
+      buffer_.resize(kBufferSize);
+      buffer_size_ = 0;
+      is_written = write() && Flush();
+      is_written = fclose(file_) == 0 && is_written;
+      file_ = NULL;
+      if (!is_written) {
+        LOGE("PlyExporter: Failed to write %s", file_path.c_str());
+      }
+    }
+    // Release the copy of ExportPointCloud(), and the buffer.
+    std::vector<float>().swap(points_);
+    std::vector<uint8_t>().swap(buffer_);
+
+    const double export_time =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                      start_time).count();
+    last_export_time_.store(export_time);
+    if (is_written) {
+      ++export_count_;
+      LOGI("PlyExporter: Wrote %s in %.2fs", file_path.c_str(), export_time);
+    } else {
+      ++failed_count_;
+    }
+    is_busy_.store(false);
+  });
+  return true;
+}
+
+bool PlyExporter::WriteHeader(const char* vertex_properties,
+                              uint64_t vertex_count, uint64_t face_count) {
+  typedef unsigned long long Count;  // NOLINT, the type of %llu.
+  char header[1024];
+  int length = snprintf(header, sizeof(header),
+                        "ply\n"
+                        "format binary_little_endian 1.0\n"
+                        "comment Written by tango_util::PlyExporter\n"
+                        "element vertex %llu\n"
+                        "property float x\n"
+                        "property float y\n"
+                        "property float z\n"
+                        "%s",
+                        static_cast<Count>(vertex_count),
+                        vertex_properties);
+  if (face_count > 0) {
+    length += snprintf(header + length, sizeof(header) - length,
+                       "element face %llu\n"
+                       "property list uchar int vertex_indices\n",
+                       static_cast<Count>(face_count));
+  }
+  length += snprintf(header + length, sizeof(header) - length, "end_header\n");
+  return Append(header, length);
+}
+
+bool PlyExporter::Append(const void* data, size_t size) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  while (size > 0) {
+    if (buffer_size_ == buffer_.size() && !Flush()) {
+      return false;
+    }
+    const size_t copied = std::min(size, buffer_.size() - buffer_size_);
+    memcpy(&buffer_[buffer_size_], bytes, copied);
+    buffer_size_ += copied;
+    bytes += copied;
+    size -= copied;
+  }
+  return true;
+}
+
+bool PlyExporter::Flush() {
+  if (buffer_size_ == 0) {
+    return true;
+  }
+  const size_t written = fwrite(buffer_.data(), 1, buffer_size_, file_);
+  bytes_written_ += written;
+  const bool is_written = written == buffer_size_;
+  buffer_size_ = 0;
+  return is_written;
+}
+
+bool PlyExporter::WritePointCloud() {
+  const size_t point_count = points_.size() / 3;
+  if (!WriteHeader("", point_count, 0)) {
+    return false;
+  }
+  for (size_t i = 0; i < point_count; ++i) {
+    const glm::vec4 point =
+        world_T_depth_ *
+        glm::vec4(points_[i * 3], points_[i * 3 + 1], points_[i * 3 + 2], 1.0f);
+    if (!Append(&point[0], 3 * sizeof(float))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool PlyExporter::WritePointCloudMap(const PointCloudMap* map) {
+  // The header needs the count, which a first pass over the weights gives
+  // without copying anything.
+  const uint32_t slot_count = map->GetSlotCount();
+  uint64_t vertex_count = 0;
+  for (uint32_t slot = 0; slot < slot_count; ++slot) {
+    const PointCloudMap::Voxel* voxels = map->GetSlotVoxels(slot);
+    for (int i = 0; i < PointCloudMap::kVoxelsPerBlock; ++i) {
+      vertex_count += voxels[i].weight > 0.0f;
+    }
+  }
+  if (!WriteHeader("property float confidence\n", vertex_count, 0)) {
+    return false;
+  }
+  // A voxel is its position followed by its weight, the layout of a vertex.
+  static_assert(sizeof(PointCloudMap::Voxel) == 4 * sizeof(float),
+                "voxels are written as they are");
+  for (uint32_t slot = 0; slot < slot_count; ++slot) {
+    const PointCloudMap::Voxel* voxels = map->GetSlotVoxels(slot);
+    for (int i = 0; i < PointCloudMap::kVoxelsPerBlock; ++i) {
+      if (voxels[i].weight > 0.0f &&
+          !Append(&voxels[i], sizeof(PointCloudMap::Voxel))) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+bool PlyExporter::WriteMeshes(
+    const std::vector<const TangoMesh_Experimental*>& meshes) {
+  uint64_t vertex_count = 0;
+  uint64_t face_count = 0;
+  bool has_normals = true;
+  bool has_colors = true;
+  for (const TangoMesh_Experimental* mesh : meshes) {
+    vertex_count += mesh->num_vertices;
+    face_count += mesh->num_faces;
+    has_normals = has_normals && mesh->has_normals;
+    has_colors = has_colors && mesh->has_colors;
+  }
+  std::string properties;
+  if (has_normals) {
+    properties +=
+        "property float nx\n"
+        "property float ny\n"
+        "property float nz\n";
+  }
+  if (has_colors) {
+    properties +=
+        "property uchar red\n"
+        "property uchar green\n"
+        "property uchar blue\n"
+        "property uchar alpha\n";
+  }
+  if (!WriteHeader(properties.c_str(), vertex_count, face_count)) {
+    return false;
+  }
+
+  for (const TangoMesh_Experimental* mesh : meshes) {
+    for (uint32_t i = 0; i < mesh->num_vertices; ++i) {
+      if (!Append(mesh->vertices[i], 3 * sizeof(float)) ||
+          (has_normals && !Append(mesh->normals[i], 3 * sizeof(float))) ||
+          (has_colors && !Append(mesh->colors[i], 4))) {
+        return false;
+      }
+    }
+  }
+  // The faces of a mesh index its own vertices, which follow those of the
+  // meshes before it.
+  uint32_t first_vertex = 0;
+  for (const TangoMesh_Experimental* mesh : meshes) {
+    for (uint32_t i = 0; i < mesh->num_faces; ++i) {
+      uint32_t face[3];
+      for (int k = 0; k < 3; ++k) {
+        face[k] = first_vertex + mesh->faces[i][k];
+      }
+      if (!Append(&kFaceVertexCount, 1) || !Append(face, sizeof(face))) {
+        return false;
+      }
+    }
+    first_vertex += mesh->num_vertices;
+  }
+  return true;
+}
+
+}  // namespace tango_util
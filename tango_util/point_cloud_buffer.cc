@@ -0,0 +1,141 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/point_cloud_buffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+// Slots besides those of the readers: the latest cloud and the one written.
+const int kExtraSlotCount = 2;
+}  // namespace
+
+namespace tango_util {
+
+const int PointCloudBuffer::kMaxReaderCount;
+
+PointCloudBuffer::Reader::Reader(PointCloudBuffer* buffer)
+    : buffer_(buffer), slot_(-1), generation_(0) {}
+
+PointCloudBuffer::Reader::~Reader() { Release(); }
+
+const TangoXYZij* PointCloudBuffer::Reader::Acquire(bool* is_new) {
+  *is_new = false;
+  if (slot_ >= 0 && buffer_->GetGeneration() == generation_) {
+    return &buffer_->slots_[slot_].point_cloud;
+  }
+  // Letting go of the older cloud first keeps each reader to a single slot,
+  // which is what the slot count is sized for.
+  Release();
+  slot_ = buffer_->AcquireLatest(&generation_);
+  if (slot_ < 0) {
+    return nullptr;
+  }
+  *is_new = true;
+  return &buffer_->slots_[slot_].point_cloud;
+}
+
+void PointCloudBuffer::Reader::Release() {
+  if (slot_ >= 0) {
+    buffer_->ReleaseSlot(slot_);
+    slot_ = -1;
+  }
+}
+
+PointCloudBuffer::PointCloudBuffer()
+    : slot_count_(0),
+      max_point_count_(0),
+      latest_(0),
+      dropped_count_(0),
+      generation_(0) {}
+
+void PointCloudBuffer::Initialize(int reader_count, int max_point_count) {
+  reader_count = std::min(std::max(reader_count, 1), kMaxReaderCount);
+  slot_count_ = reader_count + kExtraSlotCount;
+  max_point_count_ = std::max(max_point_count, 0);
+  slots_.reset(new Slot[slot_count_]);
+  for (int i = 0; i < slot_count_; ++i) {
+    Slot& slot = slots_[i];
+    slot.xyz.resize(max_point_count_ * 3);
+    memset(&slot.point_cloud, 0, sizeof(slot.point_cloud));
+    slot.point_cloud.xyz = reinterpret_cast<float(*)[3]>(slot.xyz.data());
+    slot.reader_count.store(0);
+  }
+  latest_.store(0);
+  generation_ = 0;
+}
+
+bool PointCloudBuffer::Update(const TangoXYZij* xyz_ij) {
+  const uint64_t latest = latest_.load();
+  const int latest_slot =
+      latest != 0 ? static_cast<int>(latest & kSlotMask) : -1;
+  // A slot no reader holds. A reader only holds a slot it saw as the latest
+  // after counting itself in, so once the count is seen at 0 here no reader
+  // can start reading it.
+  Slot* slot = nullptr;
+  for (int i = 0; i < slot_count_; ++i) {
+    if (i != latest_slot && slots_[i].reader_count.load() == 0) {
+      slot = &slots_[i];
+      break;
+    }
+  }
+  if (slot == nullptr) {
+    dropped_count_.fetch_add(1);
+    return false;
+  }
+
+  const uint32_t count =
+      std::min<uint32_t>(xyz_ij->xyz_count, max_point_count_);
+  memcpy(slot->xyz.data(), xyz_ij->xyz, count * 3 * sizeof(float));
+  slot->point_cloud.version = xyz_ij->version;
+  slot->point_cloud.timestamp = xyz_ij->timestamp;
+  slot->point_cloud.xyz_count = count;
+
+  ++generation_;
+  latest_.store((generation_ << kSlotBits) |
+                static_cast<uint64_t>(slot - slots_.get()));
+  return true;
+}
+
+uint64_t PointCloudBuffer::GetGeneration() const {
+  return latest_.load() >> kSlotBits;
+}
+
+int PointCloudBuffer::AcquireLatest(uint64_t* generation) {
+  while (true) {
+    const uint64_t latest = latest_.load();
+    if (latest == 0) {
+      *generation = 0;
+      return -1;
+    }
+    const int slot = static_cast<int>(latest & kSlotMask);
+    slots_[slot].reader_count.fetch_add(1);
+    // If the slot is still the latest, the callback can not have picked it
+    // since: it skips the latest slot, and the count it reads afterwards
+    // includes this reader. Otherwise it may be writing over it already.
+    if (latest_.load() == latest) {
+      *generation = latest >> kSlotBits;
+      return slot;
+    }
+    slots_[slot].reader_count.fetch_sub(1);
+  }
+}
+
+void PointCloudBuffer::ReleaseSlot(int slot) {
+  slots_[slot].reader_count.fetch_sub(1);
+}
+}  // namespace tango_util
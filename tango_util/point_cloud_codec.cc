@@ -0,0 +1,443 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/point_cloud_codec.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+
+namespace {
+using tango_util::point_cloud_codec::FrameHeader;
+using tango_util::point_cloud_codec::kCoordinateBits;
+using tango_util::point_cloud_codec::kMaxDepth;
+
+// Quantized coordinates are offset by half their range, for the origin to be
+// at the center of the grid.
+const int32_t kCoordinateBias = 1 << (kCoordinateBits - 1);
+const int32_t kMaxCoordinate = (1 << kCoordinateBits) - 1;
+
+// Probabilities of the range coder, as in LZMA: 11 bit probabilities of a 0,
+// moving by 1/32 of the distance to the bit coded.
+const int kProbabilityBits = 11;
+const uint16_t kProbabilityOne = 1 << kProbabilityBits;
+const int kAdaptationShift = 5;
+const uint32_t kTopValue = 1 << 24;
+
+// A context per number of children of the parent, and one for the root, each
+// a binary tree of the 8 bits of a byte.
+const int kContextCount = 9;
+const int kRootContext = 8;
+const int kTreeSize = 256;
+
+// Spread the low 21 bits of |value| to every third bit.
+inline uint64_t SpreadBits(uint64_t value) {
+  value &= 0x1fffff;
+  value = (value | value << 32) & 0x1f00000000ffffULL;
+  value = (value | value << 16) & 0x1f0000ff0000ffULL;
+  value = (value | value << 8) & 0x100f00f00f00f00fULL;
+  value = (value | value << 4) & 0x10c30c30c30c30c3ULL;
+  value = (value | value << 2) & 0x1249249249249249ULL;
+  return value;
+}
+
+// Inverse of SpreadBits(), gather every third bit of |value|.
+inline uint32_t CompactBits(uint64_t value) {
+  value &= 0x1249249249249249ULL;
+  value = (value ^ (value >> 2)) & 0x10c30c30c30c30c3ULL;
+  value = (value ^ (value >> 4)) & 0x100f00f00f00f00fULL;
+  value = (value ^ (value >> 8)) & 0x1f0000ff0000ffULL;
+  value = (value ^ (value >> 16)) & 0x1f00000000ffffULL;
+  value = (value ^ (value >> 32)) & 0x1fffff;
+  return static_cast<uint32_t>(value);
+}
+
+inline int PopCount(uint8_t byte) { return __builtin_popcount(byte); }
+
+void ResetProbabilities(uint16_t probabilities[kContextCount][kTreeSize]) {
+  for (int context = 0; context < kContextCount; ++context) {
+    std::fill(probabilities[context], probabilities[context] + kTreeSize,
+              kProbabilityOne / 2);
+  }
+}
+
+// Sort |values| with a least significant digit radix sort, skipping the
+// bytes all the values share, e.g. the high bytes of the Morton codes of a
+// cloud a few meters wide.
+void RadixSort(std::vector<uint64_t>* values, std::vector<uint64_t>* buffer) {
+  size_t counts[8][256];
+  memset(counts, 0, sizeof(counts));
+  for (uint64_t value : *values) {
+    for (int digit = 0; digit < 8; ++digit) {
+      ++counts[digit][(value >> (digit * 8)) & 0xff];
+    }
+  }
+  buffer->resize(values->size());
+  for (int digit = 0; digit < 8; ++digit) {
+    const int shift = digit * 8;
+    size_t* count = counts[digit];
+    if (values->empty() ||
+        count[((*values)[0] >> shift) & 0xff] == values->size()) {
+      continue;
+    }
+    size_t offset = 0;
+    for (int i = 0; i < 256; ++i) {
+      const size_t bucket_count = count[i];
+      count[i] = offset;
+      offset += bucket_count;
+    }
+    uint64_t* out = buffer->data();
+    for (uint64_t value : *values) {
+      out[count[(value >> shift) & 0xff]++] = value;
+    }
+    values->swap(*buffer);
+  }
+}
+
+class RangeEncoder {
+ public:
+  explicit RangeEncoder(std::vector<uint8_t>* out)
+      : out_(out), low_(0), range_(0xffffffff), cache_(0), cache_size_(1) {}
+
+  void EncodeByte(uint16_t* tree, uint8_t byte) {
+    uint32_t node = 1;
+    for (int bit_index = 7; bit_index >= 0; --bit_index) {
+      const uint32_t bit = (byte >> bit_index) & 1;
+      EncodeBit(&tree[node], bit);
+      node = (node << 1) | bit;
+    }
+  }
+
+  void Flush() {
+    for (int i = 0; i < 5; ++i) {
+      ShiftLow();
+    }
+  }
+
+ private:
+  void EncodeBit(uint16_t* probability, uint32_t bit) {
+    const uint32_t bound = (range_ >> kProbabilityBits) * *probability;
+    if (bit == 0) {
+      range_ = bound;
+      *probability += (kProbabilityOne - *probability) >> kAdaptationShift;
+    } else {
+      low_ += bound;
+      range_ -= bound;
+      *probability -= *probability >> kAdaptationShift;
+    }
+    while (range_ < kTopValue) {
+      range_ <<= 8;
+      ShiftLow();
+    }
+  }
+
+  // Output the top byte of low_, once a carry can no longer change it.
+  void ShiftLow() {
+    if (static_cast<uint32_t>(low_) < 0xff000000 || (low_ >> 32) != 0) {
+      const uint8_t carry = static_cast<uint8_t>(low_ >> 32);
+      uint8_t byte = cache_;
+      do {
+        out_->push_back(static_cast<uint8_t>(byte + carry));
+        byte = 0xff;
+      } while (--cache_size_ != 0);
+      cache_ = static_cast<uint8_t>(low_ >> 24);
+    }
+    ++cache_size_;
+    low_ = (low_ & 0x00ffffff) << 8;
+  }
+
+  std::vector<uint8_t>* out_;
+  uint64_t low_;
+  uint32_t range_;
+  uint8_t cache_;
+  uint64_t cache_size_;
+};
+
+class RangeDecoder {
+ public:
+  // Reading past |end| reads zeros, which a corrupt frame fails on later.
+  RangeDecoder(const uint8_t* data, const uint8_t* end)
+      : data_(data), end_(end), code_(0), range_(0xffffffff) {
+    for (int i = 0; i < 5; ++i) {
+      code_ = (code_ << 8) | NextByte();
+    }
+  }
+
+  uint8_t DecodeByte(uint16_t* tree) {
+    uint32_t node = 1;
+    while (node < kTreeSize) {
+      node = (node << 1) | DecodeBit(&tree[node]);
+    }
+    return static_cast<uint8_t>(node - kTreeSize);
+  }
+
+ private:
+  uint32_t DecodeBit(uint16_t* probability) {
+    const uint32_t bound = (range_ >> kProbabilityBits) * *probability;
+    uint32_t bit;
+    if (code_ < bound) {
+      range_ = bound;
+      *probability += (kProbabilityOne - *probability) >> kAdaptationShift;
+      bit = 0;
+    } else {
+      code_ -= bound;
+      range_ -= bound;
+      *probability -= *probability >> kAdaptationShift;
+      bit = 1;
+    }
+    while (range_ < kTopValue) {
+      range_ <<= 8;
+      code_ = (code_ << 8) | NextByte();
+    }
+    return bit;
+  }
+
+  uint8_t NextByte() { return data_ < end_ ? *data_++ : 0; }
+
+  const uint8_t* data_;
+  const uint8_t* end_;
+  uint32_t code_;
+  uint32_t range_;
+};
+}  // namespace
+
+namespace tango_util {
+
+PointCloudEncoder::Options::Options()
+    : precision(0.005f), keyframe_interval(30) {}
+
+PointCloudEncoder::PointCloudEncoder(const Options& options)
+    : precision_(options.precision),
+      inverse_precision_(1.0f / options.precision),
+      keyframe_interval_(std::max(options.keyframe_interval, 1)),
+      frame_index_(0),
+      frames_to_intra_(0) {}
+
+uint32_t PointCloudEncoder::Encode(const TangoXYZij* xyz_ij,
+                                   const glm::mat4& world_T_points,
+                                   std::vector<uint8_t>* data) {
+  // Quantize the points into Morton codes, folding the scale into the pose.
+  const glm::mat4 grid_T_points =
+      glm::scale(glm::mat4(1.0f), glm::vec3(inverse_precision_)) *
+      world_T_points;
+  cells_.resize(xyz_ij->xyz_count);
+  size_t cell_count = 0;
+  for (uint32_t i = 0; i < xyz_ij->xyz_count; ++i) {
+    const float* point = xyz_ij->xyz[i];
+    const glm::vec3 grid_point(grid_T_points *
+                               glm::vec4(point[0], point[1], point[2], 1.0f));
+    uint64_t code = 0;
+    bool is_valid = true;
+    for (int axis = 0; axis < 3; ++axis) {
+      const float value = std::floor(grid_point[axis]) + kCoordinateBias;
+      // Also false for NaN.
+      if (!(value >= 0.0f && value <= kMaxCoordinate)) {
+        is_valid = false;
+        break;
+      }
+      code |= SpreadBits(static_cast<uint64_t>(value)) << axis;
+    }
+    if (is_valid) {
+      cells_[cell_count++] = code;
+    }
+  }
+  cells_.resize(cell_count);
+  RadixSort(&cells_, &sort_buffer_);
+  cells_.erase(std::unique(cells_.begin(), cells_.end()), cells_.end());
+
+  // A delta frame codes the cells in only one of the frames, unless they
+  // outnumber the cells of the frame, e.g. when the camera turned.
+  point_cloud_codec::FrameHeader header;
+  header.type = point_cloud_codec::kIntraFrame;
+  if (frames_to_intra_ > 0) {
+    nodes_.clear();
+    std::set_symmetric_difference(previous_cells_.begin(),
+                                  previous_cells_.end(), cells_.begin(),
+                                  cells_.end(), std::back_inserter(nodes_));
+    if (nodes_.size() < cells_.size()) {
+      header.type = point_cloud_codec::kDeltaFrame;
+      --frames_to_intra_;
+    }
+  }
+  if (header.type == point_cloud_codec::kIntraFrame) {
+    nodes_.assign(cells_.begin(), cells_.end());
+    frames_to_intra_ = keyframe_interval_ - 1;
+  }
+  header.reserved = 0;
+  header.frame_index = frame_index_++;
+  header.cell_count = static_cast<uint32_t>(nodes_.size());
+  header.precision = precision_;
+
+  // The root is the deepest node holding the first and last cells.
+  int depth = 0;
+  if (!nodes_.empty()) {
+    while ((nodes_.front() >> (3 * depth)) != (nodes_.back() >> (3 * depth))) {
+      ++depth;
+    }
+  }
+  header.depth = static_cast<uint8_t>(depth);
+
+  // Build the levels from the leaves up, each replacing the nodes of the
+  // level under it by their parents.
+  size_t node_count = nodes_.size();
+  for (int level = depth - 1; level >= 0; --level) {
+    std::vector<uint8_t>& bytes = levels_[level];
+    bytes.clear();
+    size_t parent_count = 0;
+    for (size_t i = 0; i < node_count; ++i) {
+      // Read before the parents overwrite it.
+      const uint64_t node = nodes_[i];
+      const uint64_t parent = node >> 3;
+      if (parent_count == 0 || nodes_[parent_count - 1] != parent) {
+        nodes_[parent_count++] = parent;
+        bytes.push_back(0);
+      }
+      bytes.back() |= 1 << (node & 7);
+    }
+    node_count = parent_count;
+  }
+  header.root = node_count > 0 ? nodes_[0] : 0;
+
+  data->resize(sizeof(header));
+  memcpy(data->data(), &header, sizeof(header));
+  if (depth > 0) {
+    uint16_t probabilities[kContextCount][kTreeSize];
+    ResetProbabilities(probabilities);
+    RangeEncoder encoder(data);
+    encoder.EncodeByte(probabilities[kRootContext], levels_[0][0]);
+    // The nodes of a level are the children of the bytes of the one above.
+    for (int level = 1; level < depth; ++level) {
+      const std::vector<uint8_t>& parents = levels_[level - 1];
+      const uint8_t* byte = levels_[level].data();
+      for (uint8_t parent : parents) {
+        const int children = PopCount(parent);
+        uint16_t* tree = probabilities[children - 1];
+        for (int child = 0; child < children; ++child) {
+          encoder.EncodeByte(tree, *byte++);
+        }
+      }
+    }
+    encoder.Flush();
+  }
+
+  previous_cells_.swap(cells_);
+  return static_cast<uint32_t>(previous_cells_.size());
+}
+
+PointCloudDecoder::PointCloudDecoder()
+    : has_previous_(false), previous_frame_index_(0), previous_precision_(0) {}
+
+bool PointCloudDecoder::Decode(const uint8_t* data, size_t size,
+                               std::vector<float>* points) {
+  point_cloud_codec::FrameHeader header;
+  if (size < sizeof(header)) {
+    return false;
+  }
+  memcpy(&header, data, sizeof(header));
+  const bool is_delta = header.type == point_cloud_codec::kDeltaFrame;
+  if ((!is_delta && header.type != point_cloud_codec::kIntraFrame) ||
+      header.depth > kMaxDepth || !(header.precision > 0.0f)) {
+    return false;
+  }
+  if (is_delta &&
+      (!has_previous_ || header.frame_index != previous_frame_index_ + 1 ||
+       header.precision != previous_precision_)) {
+    return false;
+  }
+
+  // Decode the levels from the root, each level having a node per child of
+  // the one above. No level has more nodes than there are cells.
+  const int depth = header.depth;
+  if (depth > 0) {
+    uint16_t probabilities[kContextCount][kTreeSize];
+    ResetProbabilities(probabilities);
+    RangeDecoder decoder(data + sizeof(header), data + size);
+    levels_[0].assign(1, decoder.DecodeByte(probabilities[kRootContext]));
+    for (int level = 1; level < depth; ++level) {
+      const std::vector<uint8_t>& parents = levels_[level - 1];
+      std::vector<uint8_t>& bytes = levels_[level];
+      bytes.clear();
+      for (uint8_t parent : parents) {
+        const int children = PopCount(parent);
+        if (children == 0 || bytes.size() + children > header.cell_count) {
+          return false;
+        }
+        uint16_t* tree = probabilities[children - 1];
+        for (int child = 0; child < children; ++child) {
+          bytes.push_back(decoder.DecodeByte(tree));
+        }
+      }
+    }
+  }
+
+  // Expand the root into the cells, in Morton order.
+  nodes_.clear();
+  if (header.cell_count > 0) {
+    nodes_.push_back(header.root);
+  }
+  for (int level = 0; level < depth; ++level) {
+    const std::vector<uint8_t>& bytes = levels_[level];
+    if (bytes.size() != nodes_.size()) {
+      return false;
+    }
+    cells_.clear();
+    for (size_t i = 0; i < bytes.size(); ++i) {
+      const uint64_t prefix = nodes_[i] << 3;
+      for (int child = 0; child < 8; ++child) {
+        if (bytes[i] & (1 << child)) {
+          cells_.push_back(prefix | child);
+        }
+      }
+    }
+    nodes_.swap(cells_);
+  }
+  if (nodes_.size() != header.cell_count) {
+    return false;
+  }
+
+  if (is_delta) {
+    cells_.clear();
+    std::set_symmetric_difference(previous_cells_.begin(),
+                                  previous_cells_.end(), nodes_.begin(),
+                                  nodes_.end(), std::back_inserter(cells_));
+  } else {
+    cells_.swap(nodes_);
+  }
+
+  // A flat loop over the cells, with no branch for the compiler to keep it
+  // from vectorizing.
+  const size_t cell_count = cells_.size();
+  points->resize(cell_count * 3);
+  float* out = points->data();
+  const uint64_t* cells = cells_.data();
+  const float precision = header.precision;
+  const float offset = 0.5f - kCoordinateBias;
+  for (size_t i = 0; i < cell_count; ++i) {
+    const uint64_t code = cells[i];
+    out[i * 3 + 0] = (CompactBits(code) + offset) * precision;
+    out[i * 3 + 1] = (CompactBits(code >> 1) + offset) * precision;
+    out[i * 3 + 2] = (CompactBits(code >> 2) + offset) * precision;
+  }
+
+  previous_cells_.swap(cells_);
+  previous_frame_index_ = header.frame_index;
+  previous_precision_ = header.precision;
+  has_previous_ = true;
+  return true;
+}
+
+}  // namespace tango_util
@@ -0,0 +1,445 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/point_cloud_map.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include <tango-gl/point_transform.h>
+
+namespace {
+// Block coordinates are packed into 21 bits each, offset to be unsigned.
+const int kCoordinateBits = 21;
+const int32_t kCoordinateOffset = 1 << (kCoordinateBits - 1);
+const uint64_t kCoordinateMask = (uint64_t(1) << kCoordinateBits) - 1;
+
+// Blocks observed within this many frames, about 5 seconds of depth frames,
+// are only evicted once every older block is gone.
+const uint32_t kRecentFrameCount = 25;
+
+// Fraction of the slots freed at once when the map is full, so eviction does
+// not run for every new block.
+const uint32_t kEvictionBatchDivisor = 16;
+
+// Resident tiles are paged out past this multiple of the resident radius, so
+// a camera moving back and forth at the radius does not page a tile every
+// frame.
+const float kPageOutRadiusScale = 1.25f;
+
+// Weight of the latest frame in the smoothed velocity of the camera, and the
+// longest gap between frames it is estimated over, in seconds.
+const float kVelocitySmoothing = 0.3f;
+const double kMaxVelocityInterval = 1.0;
+
+const size_t kBlockBytes =
+    sizeof(tango_util::PointCloudMap::Voxel) *
+    tango_util::PointCloudMap::kVoxelsPerBlock;
+
+uint64_t PackBlock(const glm::ivec3& block) {
+  uint64_t key = 0;
+  for (int i = 0; i < 3; ++i) {
+    key = (key << kCoordinateBits) |
+          (static_cast<uint64_t>(block[i] + kCoordinateOffset) &
+           kCoordinateMask);
+  }
+  return key;
+}
+
+int32_t FloorDivide(int32_t value, int32_t divisor) {
+  return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+}
+}  // namespace
+
+namespace tango_util {
+
+const int PointCloudMap::kBlockSize;
+const int PointCloudMap::kVoxelsPerBlock;
+const int PointCloudMap::kTileSize;
+const int PointCloudMap::kBlocksPerTile;
+
+PointCloudMap::Options::Options()
+    : voxel_size(0.05f),
+      max_weight(32.0f),
+      max_memory_size(16 << 20),
+      resident_radius(6.0f),
+      prefetch_time(1.0f) {}
+
+PointCloudMap::PointCloudMap(const Options& options)
+    : voxel_size_(options.voxel_size),
+      inverse_voxel_size_(1.0f / options.voxel_size),
+      max_weight_(options.max_weight),
+      frame_(0),
+      depth_camera_position_(0.0f),
+      evicted_count_(0),
+      resident_radius_(options.resident_radius),
+      prefetch_time_(options.prefetch_time),
+      paged_out_block_count_(0),
+      velocity_(0.0f),
+      last_position_(0.0f),
+      last_timestamp_(0.0) {
+  // Every slot costs its voxels, its bookkeeping and its hash map entry.
+  const size_t slot_size = sizeof(Voxel) * kVoxelsPerBlock + sizeof(Slot) +
+                           3 * sizeof(uint32_t) + 4 * sizeof(void*);
+  slot_count_ =
+      static_cast<uint32_t>(std::max<size_t>(1, options.max_memory_size /
+                                                    slot_size));
+
+  Voxel empty_voxel = {{0.0f, 0.0f, 0.0f}, 0.0f};
+  voxels_.assign(static_cast<size_t>(slot_count_) * kVoxelsPerBlock,
+                 empty_voxel);
+  Slot free_slot = {false, false, 0, glm::vec3(0.0f), 0, 0, 0};
+  slots_.assign(slot_count_, free_slot);
+  free_slots_.reserve(slot_count_);
+  // Popped from the back, so the first slots are used first.
+  for (uint32_t slot = slot_count_; slot > 0; --slot) {
+    free_slots_.push_back(slot - 1);
+  }
+  block_slots_.reserve(slot_count_);
+  changed_slots_.reserve(slot_count_);
+  eviction_candidates_.reserve(slot_count_);
+
+  if (!options.tile_file_path.empty() &&
+      !tile_file_.Open(options.tile_file_path, kBlockBytes * kBlocksPerTile)) {
+    LOGE("PointCloudMap: Evicted blocks will be dropped");
+  }
+}
+
+void PointCloudMap::Insert(const TangoXYZij* xyz_ij,
+                           const glm::mat4& start_service_T_depth) {
+  if (xyz_ij == nullptr) {
+    return;
+  }
+  ++frame_;
+  depth_camera_position_ = glm::vec3(start_service_T_depth[3]);
+  if (tile_file_.IsOpen()) {
+    UpdateResidency(xyz_ij->timestamp);
+  }
+
+  const uint32_t point_count = xyz_ij->xyz_count;
+  world_points_.resize(point_count * 3);
+  tango_gl::TransformPoints(start_service_T_depth, xyz_ij->xyz[0],
+                            point_count, world_points_.data());
+
+  // Consecutive points are mostly in the same block.
+  uint64_t last_key = 0;
+  int32_t last_slot = -1;
+  for (uint32_t i = 0; i < point_count; ++i) {
+    const glm::vec3 point(world_points_[i * 3], world_points_[i * 3 + 1],
+                          world_points_[i * 3 + 2]);
+    const glm::vec3 scaled = glm::floor(point * inverse_voxel_size_);
+    // Also rejects NaN.
+    if (!(glm::all(glm::greaterThan(scaled, glm::vec3(-kCoordinateOffset))) &&
+          glm::all(glm::lessThan(scaled, glm::vec3(kCoordinateOffset))))) {
+      continue;
+    }
+    const glm::ivec3 voxel = glm::ivec3(scaled);
+    const glm::ivec3 block(FloorDivide(voxel.x, kBlockSize),
+                           FloorDivide(voxel.y, kBlockSize),
+                           FloorDivide(voxel.z, kBlockSize));
+    const uint64_t key = PackBlock(block);
+    int32_t slot = last_slot;
+    if (slot < 0 || key != last_key) {
+      slot = GetSlot(key, block);
+      if (slot < 0) {
+        continue;
+      }
+      last_key = key;
+      last_slot = slot;
+    }
+
+    const glm::ivec3 local = voxel - block * kBlockSize;
+    Voxel& v = voxels_[static_cast<size_t>(slot) * kVoxelsPerBlock +
+                       (local.z * kBlockSize + local.y) * kBlockSize +
+                       local.x];
+    // Running mean, whose weight stops growing at max_weight_.
+    const float weight = std::min(v.weight + 1.0f, max_weight_);
+    const float t = 1.0f / weight;
+    for (int k = 0; k < 3; ++k) {
+      v.position[k] += (point[k] - v.position[k]) * t;
+    }
+    v.weight = weight;
+  }
+}
+
+void PointCloudMap::Clear() {
+  for (uint32_t slot = 0; slot < slot_count_; ++slot) {
+    if (slots_[slot].is_used) {
+      FreeSlot(slot);
+    }
+  }
+  tiles_.clear();
+  tile_file_.Reset();
+  paged_out_block_count_ = 0;
+}
+
+void PointCloudMap::TakeChangedSlots(std::vector<uint32_t>* slots) {
+  slots->clear();
+  slots->swap(changed_slots_);
+  for (uint32_t slot : *slots) {
+    slots_[slot].is_changed = false;
+  }
+  changed_slots_.reserve(slot_count_);
+}
+
+int32_t PointCloudMap::GetSlot(uint64_t key, const glm::ivec3& block) {
+  std::unordered_map<uint64_t, uint32_t>::const_iterator it =
+      block_slots_.find(key);
+  if (it != block_slots_.end()) {
+    Slot& slot = slots_[it->second];
+    slot.last_frame = frame_;
+    MarkChanged(it->second);
+    return it->second;
+  }
+
+  if (tile_file_.IsOpen()) {
+    // A block paged out comes back with its tile.
+    uint64_t tile_key;
+    int tile_block;
+    Tile* tile = GetTile(block, &tile_key, &tile_block);
+    if (tile->paged_out_blocks & (uint64_t(1) << tile_block)) {
+      PageInTile(tile);
+      it = block_slots_.find(key);
+      if (it == block_slots_.end()) {
+        return -1;
+      }
+      slots_[it->second].last_frame = frame_;
+      return it->second;
+    }
+  }
+  return AllocateSlot(key, block);
+}
+
+int32_t PointCloudMap::AllocateSlot(uint64_t key, const glm::ivec3& block) {
+  if (free_slots_.empty()) {
+    EvictBlocks();
+    if (free_slots_.empty()) {
+      return -1;
+    }
+  }
+  const uint32_t index = free_slots_.back();
+  free_slots_.pop_back();
+  Slot& slot = slots_[index];
+  slot.is_used = true;
+  slot.key = key;
+  slot.center =
+      (glm::vec3(block) + glm::vec3(0.5f)) * (voxel_size_ * kBlockSize);
+  slot.last_frame = frame_;
+  if (tile_file_.IsOpen()) {
+    Tile* tile = GetTile(block, &slot.tile_key, &slot.tile_block);
+    ++tile->resident_count;
+  }
+  block_slots_[key] = index;
+  MarkChanged(index);
+  return index;
+}
+
+void PointCloudMap::EvictBlocks() {
+  eviction_candidates_.clear();
+  for (uint32_t index = 0; index < slot_count_; ++index) {
+    const Slot& slot = slots_[index];
+    if (slot.is_used && slot.last_frame != frame_) {
+      eviction_candidates_.push_back(index);
+    }
+  }
+  const size_t count =
+      std::min<size_t>(eviction_candidates_.size(),
+                       std::max<uint32_t>(1, slot_count_ /
+                                                 kEvictionBatchDivisor));
+  if (count == 0) {
+    return;
+  }
+
+  // Blocks not seen recently go first, the farthest first, then the recent
+  // ones, the least recently seen first.
+  const uint32_t frame = frame_;
+  const glm::vec3 position = depth_camera_position_;
+  const std::vector<Slot>& slots = slots_;
+  std::partial_sort(
+      eviction_candidates_.begin(), eviction_candidates_.begin() + count,
+      eviction_candidates_.end(), [&](uint32_t a, uint32_t b) {
+        const Slot& slot_a = slots[a];
+        const Slot& slot_b = slots[b];
+        const bool recent_a = frame - slot_a.last_frame <= kRecentFrameCount;
+        const bool recent_b = frame - slot_b.last_frame <= kRecentFrameCount;
+        if (recent_a != recent_b) {
+          return recent_b;
+        }
+        if (recent_a) {
+          return slot_a.last_frame < slot_b.last_frame;
+        }
+        return glm::distance(slot_a.center, position) >
+               glm::distance(slot_b.center, position);
+      });
+  for (size_t i = 0; i < count; ++i) {
+    EvictSlot(eviction_candidates_[i]);
+  }
+}
+
+void PointCloudMap::EvictSlot(uint32_t index) {
+  if (!tile_file_.IsOpen() || !PageOutBlock(index)) {
+    ++evicted_count_;
+  }
+  FreeSlot(index);
+}
+
+void PointCloudMap::FreeSlot(uint32_t index) {
+  Slot& slot = slots_[index];
+  block_slots_.erase(slot.key);
+  slot.is_used = false;
+  if (tile_file_.IsOpen()) {
+    std::unordered_map<uint64_t, Tile>::iterator tile =
+        tiles_.find(slot.tile_key);
+    if (tile != tiles_.end()) {
+      --tile->second.resident_count;
+    }
+  }
+  Voxel* voxels = &voxels_[static_cast<size_t>(index) * kVoxelsPerBlock];
+  for (int i = 0; i < kVoxelsPerBlock; ++i) {
+    voxels[i].weight = 0.0f;
+    voxels[i].position[0] = 0.0f;
+    voxels[i].position[1] = 0.0f;
+    voxels[i].position[2] = 0.0f;
+  }
+  free_slots_.push_back(index);
+  MarkChanged(index);
+}
+
+void PointCloudMap::MarkChanged(uint32_t index) {
+  Slot& slot = slots_[index];
+  if (!slot.is_changed) {
+    slot.is_changed = true;
+    changed_slots_.push_back(index);
+  }
+}
+
+void PointCloudMap::UpdateResidency(double timestamp) {
+  const double interval = timestamp - last_timestamp_;
+  if (last_timestamp_ > 0.0 && interval > 0.0 &&
+      interval < kMaxVelocityInterval) {
+    const glm::vec3 velocity =
+        (depth_camera_position_ - last_position_) /
+        static_cast<float>(interval);
+    velocity_ = glm::mix(velocity_, velocity, kVelocitySmoothing);
+  } else {
+    velocity_ = glm::vec3(0.0f);
+  }
+  last_timestamp_ = timestamp;
+  last_position_ = depth_camera_position_;
+
+  const glm::vec3 predicted_position =
+      depth_camera_position_ + velocity_ * prefetch_time_;
+  const float page_out_radius = resident_radius_ * kPageOutRadiusScale;
+  for (std::pair<const uint64_t, Tile>& entry : tiles_) {
+    Tile& tile = entry.second;
+    const float distance =
+        std::min(glm::distance(tile.center, depth_camera_position_),
+                 glm::distance(tile.center, predicted_position));
+    if (tile.paged_out_blocks != 0 && distance < resident_radius_) {
+      PageInTile(&tile);
+    } else if (tile.resident_count > 0 && distance > page_out_radius) {
+      PageOutTile(tile);
+    }
+  }
+}
+
+PointCloudMap::Tile* PointCloudMap::GetTile(const glm::ivec3& block,
+                                            uint64_t* tile_key,
+                                            int* tile_block) {
+  const glm::ivec3 coordinates(FloorDivide(block.x, kTileSize),
+                               FloorDivide(block.y, kTileSize),
+                               FloorDivide(block.z, kTileSize));
+  const glm::ivec3 local = block - coordinates * kTileSize;
+  *tile_key = PackBlock(coordinates);
+  *tile_block = (local.z * kTileSize + local.y) * kTileSize + local.x;
+  std::pair<std::unordered_map<uint64_t, Tile>::iterator, bool> inserted =
+      tiles_.insert(std::make_pair(*tile_key, Tile()));
+  Tile& tile = inserted.first->second;
+  if (inserted.second) {
+    tile.coordinates = coordinates;
+    tile.center = (glm::vec3(coordinates) + glm::vec3(0.5f)) *
+                  (voxel_size_ * kBlockSize * kTileSize);
+    tile.record = -1;
+    tile.paged_out_blocks = 0;
+    tile.resident_count = 0;
+  }
+  return &tile;
+}
+
+bool PointCloudMap::PageOutBlock(uint32_t index) {
+  const Slot& slot = slots_[index];
+  std::unordered_map<uint64_t, Tile>::iterator it = tiles_.find(slot.tile_key);
+  if (it == tiles_.end()) {
+    return false;
+  }
+  Tile& tile = it->second;
+  if (tile.record < 0) {
+    tile.record = tile_file_.AllocateRecord();
+    if (tile.record < 0) {
+      return false;
+    }
+  }
+  uint8_t* record = tile_file_.Map(tile.record);
+  if (record == nullptr) {
+    return false;
+  }
+  memcpy(record + slot.tile_block * kBlockBytes,
+         &voxels_[static_cast<size_t>(index) * kVoxelsPerBlock], kBlockBytes);
+  tile.paged_out_blocks |= uint64_t(1) << slot.tile_block;
+  ++paged_out_block_count_;
+  return true;
+}
+
+void PointCloudMap::PageInTile(Tile* tile) {
+  for (int i = 0; i < kBlocksPerTile && tile->paged_out_blocks != 0; ++i) {
+    const uint64_t bit = uint64_t(1) << i;
+    if (!(tile->paged_out_blocks & bit)) {
+      continue;
+    }
+    const glm::ivec3 local(i % kTileSize, (i / kTileSize) % kTileSize,
+                           i / (kTileSize * kTileSize));
+    const glm::ivec3 block = tile->coordinates * kTileSize + local;
+    // Allocating may page other blocks out, and map their record.
+    const int32_t slot = AllocateSlot(PackBlock(block), block);
+    if (slot < 0) {
+      return;
+    }
+    const uint8_t* record = tile_file_.Map(tile->record);
+    if (record == nullptr) {
+      FreeSlot(slot);
+      return;
+    }
+    memcpy(&voxels_[static_cast<size_t>(slot) * kVoxelsPerBlock],
+           record + i * kBlockBytes, kBlockBytes);
+    tile->paged_out_blocks &= ~bit;
+    --paged_out_block_count_;
+  }
+}
+
+void PointCloudMap::PageOutTile(const Tile& tile) {
+  for (int i = 0; i < kBlocksPerTile && tile.resident_count > 0; ++i) {
+    const glm::ivec3 local(i % kTileSize, (i / kTileSize) % kTileSize,
+                           i / (kTileSize * kTileSize));
+    std::unordered_map<uint64_t, uint32_t>::const_iterator it =
+        block_slots_.find(PackBlock(tile.coordinates * kTileSize + local));
+    if (it != block_slots_.end()) {
+      EvictSlot(it->second);
+    }
+  }
+}
+}  // namespace tango_util
@@ -0,0 +1,151 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "tango-util/point_cloud_queue.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <tango-gl/util.h>
+
+namespace {
+// Smallest capacity, see PointCloudQueue::Initialize().
+const int kMinCapacity = 3;
+
+// Default skew counted as large: beyond half the 200ms between two clouds
+// of the depth camera, a closer cloud existed or will arrive.
+const double kDefaultMaxSkew = 0.1;
+}  // namespace
+
+namespace tango_util {
+
+PointCloudQueue::PointCloudQueue()
+    : max_point_count_(0),
+      sequence_(0),
+      acquired_slot_(-1),
+      acquired_sequence_(0),
+      max_skew_(kDefaultMaxSkew),
+      skew_stats_(),
+      skew_sum_(0.0) {}
+
+void PointCloudQueue::Initialize(int capacity, int max_point_count) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  max_point_count_ = std::max(max_point_count, 0);
+  slots_.resize(std::max(capacity, kMinCapacity));
+  for (Slot& slot : slots_) {
+    slot.xyz.resize(max_point_count_ * 3);
+    memset(&slot.point_cloud, 0, sizeof(slot.point_cloud));
+    slot.point_cloud.xyz = reinterpret_cast<float(*)[3]>(slot.xyz.data());
+    slot.sequence = 0;
+    slot.is_writing = false;
+  }
+  sequence_ = 0;
+  acquired_slot_ = -1;
+  acquired_sequence_ = 0;
+}
+
+void PointCloudQueue::SetMaxSkew(double max_skew) { max_skew_ = max_skew; }
+
+void PointCloudQueue::OnPointCloudAvailable(const TangoXYZij* xyz_ij) {
+  Slot* slot = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // The oldest slot, the empty ones first, that is not being read.
+    for (size_t i = 0; i < slots_.size(); ++i) {
+      if (static_cast<int>(i) == acquired_slot_ || slots_[i].is_writing) {
+        continue;
+      }
+      if (slot == nullptr || slots_[i].sequence < slot->sequence) {
+        slot = &slots_[i];
+      }
+    }
+    if (slot == nullptr) {
+      return;
+    }
+    slot->is_writing = true;
+  }
+
+  const uint32_t count = std::min<uint32_t>(xyz_ij->xyz_count,
+                                            max_point_count_);
+  memcpy(slot->xyz.data(), xyz_ij->xyz, count * 3 * sizeof(float));
+  slot->point_cloud.version = xyz_ij->version;
+  slot->point_cloud.timestamp = xyz_ij->timestamp;
+  slot->point_cloud.xyz_count = count;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  slot->sequence = ++sequence_;
+  slot->is_writing = false;
+}
+
+const TangoXYZij* PointCloudQueue::Acquire(double timestamp, bool* is_new) {
+  int closest_slot = -1;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    double closest_skew = 0.0;
+    for (size_t i = 0; i < slots_.size(); ++i) {
+      const Slot& slot = slots_[i];
+      if (slot.sequence == 0 || slot.is_writing) {
+        continue;
+      }
+      const double skew = std::fabs(slot.point_cloud.timestamp - timestamp);
+      if (closest_slot < 0 || skew < closest_skew) {
+        closest_slot = static_cast<int>(i);
+        closest_skew = skew;
+      }
+    }
+    if (closest_slot < 0) {
+      *is_new = false;
+      return nullptr;
+    }
+    acquired_slot_ = closest_slot;
+  }
+  // Only this thread changes the acquired slot, and the callback leaves it
+  // alone.
+  const Slot& slot = slots_[closest_slot];
+  *is_new = slot.sequence != acquired_sequence_;
+  acquired_sequence_ = slot.sequence;
+  RecordSkew(slot.point_cloud.timestamp - timestamp);
+  return &slot.point_cloud;
+}
+
+PointCloudSkewStats PointCloudQueue::GetSkewStats() const {
+  PointCloudSkewStats stats = skew_stats_;
+  stats.average_skew =
+      skew_sum_ / std::max<double>(skew_stats_.pair_count, 1.0);
+  return stats;
+}
+
+void PointCloudQueue::RecordSkew(double skew) {
+  ++skew_stats_.pair_count;
+  skew_stats_.last_skew = skew;
+  skew_sum_ += std::fabs(skew);
+  if (std::fabs(skew) > max_skew_) {
+    ++skew_stats_.large_skew_count;
+  }
+  if (skew_stats_.pair_count < kSkewLogInterval) {
+    return;
+  }
+  const PointCloudSkewStats summary = GetSkewStats();
+  LOGI(
+      "PointCloudQueue: %d pairs, average skew %.1f ms, %d over %.1f ms",
+      static_cast<int>(summary.pair_count), 1000.0 * summary.average_skew,
+      static_cast<int>(summary.large_skew_count), 1000.0 * max_skew_);
+  skew_stats_ = PointCloudSkewStats();
+  skew_sum_ = 0.0;
+}
+}  // namespace tango_util
@@ -0,0 +1,206 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/point_kd_tree.h"
+
+#include <algorithm>
+
+#include <tango-gl/tracing.h>
+
+namespace {
+// Subtrees built in parallel per thread, so that threads finishing early
+// find more work.
+const size_t kSubtreesPerThread = 4;
+
+// Ranges smaller than this are built on one thread.
+const uint32_t kMinParallelSize = 4096;
+
+float GetSquaredDistance(const glm::vec3& a, const glm::vec3& b) {
+  const glm::vec3 delta = a - b;
+  return glm::dot(delta, delta);
+}
+}  // namespace
+
+namespace tango_util {
+
+PointKdTree::PointKdTree(int thread_count) : thread_count_(thread_count) {
+  if (thread_count > 0) {
+    worker_pool_.reset(new WorkerPool(thread_count));
+  }
+}
+
+void PointKdTree::Build(const float* xyz, uint32_t count) {
+  TANGO_TRACE_SCOPE("PointKdTree::Build");
+  entries_.resize(count);
+  axes_.resize(count);
+  positions_.resize(count);
+  for (uint32_t i = 0; i < count; ++i) {
+    entries_[i].position = glm::make_vec3(xyz + i * 3);
+    entries_[i].index = i;
+  }
+
+  if (worker_pool_ == nullptr || count < kMinParallelSize) {
+    BuildRange(0, count, -1, nullptr);
+  } else {
+    // The top levels are split on this thread, down to enough subtrees to
+    // keep every thread busy.
+    int depth = 0;
+    while ((static_cast<size_t>(1) << depth) <
+           kSubtreesPerThread * (thread_count_ + 1)) {
+      ++depth;
+    }
+    std::vector<std::pair<uint32_t, uint32_t>> subtrees;
+    BuildRange(0, count, depth, &subtrees);
+    worker_pool_->ParallelFor(subtrees.size(), [this, &subtrees](size_t i) {
+      BuildRange(subtrees[i].first, subtrees[i].second, -1, nullptr);
+    });
+  }
+
+  for (uint32_t i = 0; i < count; ++i) {
+    positions_[entries_[i].index] = i;
+  }
+}
+
+void PointKdTree::BuildRange(
+    uint32_t begin, uint32_t end, int depth,
+    std::vector<std::pair<uint32_t, uint32_t>>* subtrees) {
+  while (end - begin > kLeafSize) {
+    if (depth == 0) {
+      subtrees->push_back(std::make_pair(begin, end));
+      return;
+    }
+    glm::vec3 min_position = entries_[begin].position;
+    glm::vec3 max_position = min_position;
+    for (uint32_t i = begin + 1; i < end; ++i) {
+      min_position = glm::min(min_position, entries_[i].position);
+      max_position = glm::max(max_position, entries_[i].position);
+    }
+    const glm::vec3 extent = max_position - min_position;
+    const int axis = extent.x >= extent.y ? (extent.x >= extent.z ? 0 : 2)
+                                          : (extent.y >= extent.z ? 1 : 2);
+    const uint32_t middle = begin + (end - begin) / 2;
+    std::nth_element(entries_.begin() + begin, entries_.begin() + middle,
+                     entries_.begin() + end,
+                     [axis](const Entry& a, const Entry& b) {
+                       return a.position[axis] < b.position[axis];
+                     });
+    axes_[middle] = static_cast<uint8_t>(axis);
+
+    // The smaller half recursively, the larger one by looping.
+    BuildRange(begin, middle, depth - 1, subtrees);
+    begin = middle + 1;
+    --depth;
+  }
+}
+
+int PointKdTree::FindNearest(const glm::vec3& point, int k,
+                             float max_distance, uint32_t* indices,
+                             float* squared_distances) const {
+  if (k <= 0 || entries_.empty()) {
+    return 0;
+  }
+  NearestSet set;
+  set.k = k;
+  set.count = 0;
+  set.indices = indices;
+  set.squared_distances = squared_distances;
+  set.bound = max_distance * max_distance;
+  SearchNearest(0, static_cast<uint32_t>(entries_.size()), point, &set);
+  return set.count;
+}
+
+void PointKdTree::FindInRadius(const glm::vec3& point, float radius,
+                               std::vector<uint32_t>* indices) const {
+  SearchRadius(0, static_cast<uint32_t>(entries_.size()), point,
+               radius * radius, indices);
+}
+
+void PointKdTree::SearchNearest(uint32_t begin, uint32_t end,
+                                const glm::vec3& point,
+                                NearestSet* set) const {
+  while (end - begin > kLeafSize) {
+    const uint32_t middle = begin + (end - begin) / 2;
+    const Entry& median = entries_[middle];
+    const int axis = axes_[middle];
+    const float offset = point[axis] - median.position[axis];
+    // The half of the point first, then the median and the other half if
+    // the splitting plane is closer than the worst point of the set.
+    if (offset < 0.0f) {
+      SearchNearest(begin, middle, point, set);
+    } else {
+      SearchNearest(middle + 1, end, point, set);
+    }
+    if (offset * offset >= set->bound) {
+      return;
+    }
+    SearchNearest(middle, middle + 1, point, set);
+    if (offset < 0.0f) {
+      begin = middle + 1;
+    } else {
+      end = middle;
+    }
+  }
+
+  for (uint32_t i = begin; i < end; ++i) {
+    const float distance = GetSquaredDistance(entries_[i].position, point);
+    if (distance >= set->bound) {
+      continue;
+    }
+    // Insertion into the sorted set, dropping its worst point once full.
+    int j = std::min(set->count, set->k - 1);
+    while (j > 0 && set->squared_distances[j - 1] > distance) {
+      set->squared_distances[j] = set->squared_distances[j - 1];
+      set->indices[j] = set->indices[j - 1];
+      --j;
+    }
+    set->squared_distances[j] = distance;
+    set->indices[j] = entries_[i].index;
+    if (set->count < set->k) {
+      ++set->count;
+    }
+    if (set->count == set->k) {
+      set->bound = set->squared_distances[set->k - 1];
+    }
+  }
+}
+
+void PointKdTree::SearchRadius(uint32_t begin, uint32_t end,
+                               const glm::vec3& point, float squared_radius,
+                               std::vector<uint32_t>* indices) const {
+  while (end - begin > kLeafSize) {
+    const uint32_t middle = begin + (end - begin) / 2;
+    const Entry& median = entries_[middle];
+    const int axis = axes_[middle];
+    const float offset = point[axis] - median.position[axis];
+    if (offset * offset < squared_radius) {
+      // The sphere straddles the plane: both halves and the median.
+      SearchRadius(begin, middle, point, squared_radius, indices);
+      SearchRadius(middle, middle + 1, point, squared_radius, indices);
+      begin = middle + 1;
+    } else if (offset < 0.0f) {
+      end = middle;
+    } else {
+      begin = middle + 1;
+    }
+  }
+  for (uint32_t i = begin; i < end; ++i) {
+    if (GetSquaredDistance(entries_[i].position, point) < squared_radius) {
+      indices->push_back(entries_[i].index);
+    }
+  }
+}
+
+}  // namespace tango_util
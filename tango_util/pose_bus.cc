@@ -0,0 +1,110 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/pose_bus.h"
+
+#include <algorithm>
+
+namespace tango_util {
+
+const int PoseBus::kMaxFramePairCount;
+
+PoseBus::PoseBus(const TangoCoordinateFramePair* frame_pairs, int count)
+    : frame_pair_count_(std::min(std::max(count, 0), kMaxFramePairCount)),
+      pending_(),
+      has_pending_(false),
+      pending_pairs_(0),
+      last_pairs_(0),
+      expected_pairs_(0) {
+  for (int i = 0; i < frame_pair_count_; ++i) {
+    frame_pairs_[i] = frame_pairs[i];
+  }
+}
+
+int PoseBus::FindFramePair(const TangoCoordinateFramePair& frame_pair) const {
+  for (int i = 0; i < frame_pair_count_; ++i) {
+    if (frame_pairs_[i].base == frame_pair.base &&
+        frame_pairs_[i].target == frame_pair.target) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+bool PoseBus::OnPoseAvailable(const TangoPoseData* pose) {
+  if (pose == nullptr) {
+    return false;
+  }
+  const int pair = FindFramePair(pose->frame);
+  if (pair < 0) {
+    return false;
+  }
+  bool is_published = false;
+  if (has_pending_ && pose->timestamp > pending_.timestamp) {
+    // The pending tick will not get more poses, whatever it misses.
+    Publish();
+    is_published = true;
+  }
+  // A pose of the tick just published, after it had every expected pair, is
+  // published right away rather than waiting for the next tick.
+  const bool is_late = !has_pending_ && pending_.tick != 0 &&
+                       pose->timestamp <= pending_.timestamp;
+  if (!has_pending_) {
+    has_pending_ = true;
+    ++pending_.tick;
+    pending_pairs_ = 0;
+    if (!is_late) {
+      pending_.timestamp = pose->timestamp;
+    }
+  }
+  pending_.poses[pair] = *pose;
+  pending_.pose_ticks[pair] = pending_.tick;
+  pending_.timestamp = std::max(pending_.timestamp, pose->timestamp);
+  pending_pairs_ |= 1u << pair;
+
+  if (is_late) {
+    latest_.Write(pending_);
+    has_pending_ = false;
+    return true;
+  }
+  if (expected_pairs_ != 0 &&
+      (pending_pairs_ & expected_pairs_) == expected_pairs_) {
+    Publish();
+    is_published = true;
+  }
+  return is_published;
+}
+
+void PoseBus::Publish() {
+  latest_.Write(pending_);
+  has_pending_ = false;
+  // A tick of only the pairs sent now and then, at a timestamp of their own,
+  // leaves the pairs expected as they are.
+  if (expected_pairs_ == 0 || (pending_pairs_ & expected_pairs_) != 0) {
+    expected_pairs_ = pending_pairs_ & last_pairs_;
+    last_pairs_ = pending_pairs_;
+  }
+}
+
+void PoseBus::Reset() {
+  pending_ = Snapshot();
+  has_pending_ = false;
+  pending_pairs_ = 0;
+  last_pairs_ = 0;
+  expected_pairs_ = 0;
+  latest_.Write(pending_);
+}
+}  // namespace tango_util
@@ -0,0 +1,201 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "tango-util/pose_history.h"
+
+#include <cmath>
+#include <cstring>
+
+#include "tango-util/pose_source.h"
+
+namespace {
+// Below this angle between two orientations, they are interpolated linearly
+// to avoid dividing by a vanishing sine.
+const double kMinSlerpAngleCos = 0.9995;
+
+// Indices into Sample::values.
+const int kTimestamp = 0;
+const int kOrientation = 1;
+const int kTranslation = 5;
+
+// Spherical interpolation between unit quaternions |a| and |b|, taking the
+// shortest path.
+void Slerp(const double* a, const double* b, double t, double* result) {
+  double cos_angle = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+  double sign = 1.0;
+  if (cos_angle < 0.0) {
+    cos_angle = -cos_angle;
+    sign = -1.0;
+  }
+  double weight_a = 1.0 - t;
+  double weight_b = t;
+  if (cos_angle < kMinSlerpAngleCos) {
+    const double angle = std::acos(cos_angle);
+    const double sin_angle = std::sin(angle);
+    weight_a = std::sin((1.0 - t) * angle) / sin_angle;
+    weight_b = std::sin(t * angle) / sin_angle;
+  }
+  double norm = 0.0;
+  for (int i = 0; i < 4; ++i) {
+    result[i] = weight_a * a[i] + sign * weight_b * b[i];
+    norm += result[i] * result[i];
+  }
+  norm = std::sqrt(norm);
+  for (int i = 0; i < 4; ++i) {
+    result[i] /= norm;
+  }
+}
+
+bool IsSameFramePair(const TangoCoordinateFramePair& a,
+                     const TangoCoordinateFramePair& b) {
+  return a.base == b.base && a.target == b.target;
+}
+}  // namespace
+
+namespace tango_util {
+
+bool InterpolatePose(const TangoPoseData& older, const TangoPoseData& newer,
+                     double timestamp, TangoPoseData* pose) {
+  if (older.status_code != TANGO_POSE_VALID ||
+      newer.status_code != TANGO_POSE_VALID) {
+    return false;
+  }
+  const double interval = newer.timestamp - older.timestamp;
+  const double t =
+      interval > 0.0 ? (timestamp - older.timestamp) / interval : 0.0;
+  // Copied first, as |pose| may be one of the inputs.
+  double orientation[4];
+  Slerp(older.orientation, newer.orientation, t, orientation);
+  double translation[3];
+  for (int i = 0; i < 3; ++i) {
+    const double a = older.translation[i];
+    const double b = newer.translation[i];
+    translation[i] = a + (b - a) * t;
+  }
+  const TangoCoordinateFramePair frame = older.frame;
+  memset(pose, 0, sizeof(*pose));
+  pose->frame = frame;
+  pose->status_code = TANGO_POSE_VALID;
+  pose->timestamp = timestamp;
+  memcpy(pose->orientation, orientation, sizeof(orientation));
+  memcpy(pose->translation, translation, sizeof(translation));
+  return true;
+}
+
+PoseHistory::PoseHistory(const TangoCoordinateFramePair& frame_pair)
+    : frame_pair_(frame_pair), pose_count_(0) {
+  for (Slot& slot : slots_) {
+    slot.sequence.store(0, std::memory_order_relaxed);
+  }
+}
+
+void PoseHistory::OnPoseAvailable(const TangoPoseData* pose) {
+  if (pose == nullptr || !IsSameFramePair(pose->frame, frame_pair_)) {
+    return;
+  }
+  const uint32_t n = pose_count_.load(std::memory_order_relaxed);
+  Slot& slot = slots_[n % kCapacity];
+  // Readers that see an odd, or changed, sequence discard what they read.
+  slot.sequence.store(2 * n + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.values[kTimestamp].store(pose->timestamp, std::memory_order_relaxed);
+  for (int i = 0; i < 4; ++i) {
+    slot.values[kOrientation + i].store(pose->orientation[i],
+                                        std::memory_order_relaxed);
+  }
+  for (int i = 0; i < 3; ++i) {
+    slot.values[kTranslation + i].store(pose->translation[i],
+                                        std::memory_order_relaxed);
+  }
+  slot.status.store(pose->status_code, std::memory_order_relaxed);
+  slot.sequence.store(2 * (n + 1), std::memory_order_release);
+  pose_count_.store(n + 1, std::memory_order_release);
+}
+
+bool PoseHistory::ReadSample(uint32_t n, Sample* sample) const {
+  const Slot& slot = slots_[n % kCapacity];
+  const uint32_t expected = 2 * (n + 1);
+  if (slot.sequence.load(std::memory_order_acquire) != expected) {
+    return false;
+  }
+  for (int i = 0; i < kValueCount; ++i) {
+    sample->values[i] = slot.values[i].load(std::memory_order_relaxed);
+  }
+  sample->status = slot.status.load(std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return slot.sequence.load(std::memory_order_relaxed) == expected;
+}
+
+bool PoseHistory::LookUpPose(double timestamp, TangoPoseData* pose) const {
+  const uint32_t count = pose_count_.load(std::memory_order_acquire);
+  if (count == 0) {
+    return false;
+  }
+
+  // Walk back from the latest pose to the first one not newer than
+  // |timestamp|. The oldest slot may be being overwritten, so it is skipped.
+  Sample newer, older;
+  if (!ReadSample(count - 1, &newer)) {
+    return false;
+  }
+  if (timestamp == 0.0) {
+    older = newer;
+  } else {
+    if (timestamp > newer.values[kTimestamp]) {
+      return false;
+    }
+    const uint32_t oldest = count > kCapacity - 1 ? count - (kCapacity - 1) : 0;
+    uint32_t n = count - 1;
+    older = newer;
+    while (older.values[kTimestamp] > timestamp) {
+      if (n == oldest) {
+        return false;
+      }
+      newer = older;
+      if (!ReadSample(--n, &older)) {
+        return false;
+      }
+    }
+  }
+  if (older.status != TANGO_POSE_VALID || newer.status != TANGO_POSE_VALID) {
+    return false;
+  }
+
+  memset(pose, 0, sizeof(*pose));
+  pose->frame = frame_pair_;
+  pose->status_code = TANGO_POSE_VALID;
+  const double interval =
+      newer.values[kTimestamp] - older.values[kTimestamp];
+  const double t =
+      interval > 0.0 ? (timestamp - older.values[kTimestamp]) / interval : 0.0;
+  pose->timestamp = timestamp == 0.0 ? older.values[kTimestamp] : timestamp;
+  for (int i = 0; i < 3; ++i) {
+    const double a = older.values[kTranslation + i];
+    const double b = newer.values[kTranslation + i];
+    pose->translation[i] = a + (b - a) * t;
+  }
+  Slerp(older.values + kOrientation, newer.values + kOrientation, t,
+        pose->orientation);
+  return true;
+}
+
+TangoErrorType PoseHistory::GetPoseAtTime(double timestamp,
+                                          TangoPoseData* pose) const {
+  if (LookUpPose(timestamp, pose)) {
+    return TANGO_SUCCESS;
+  }
+  return tango_util::GetPoseAtTime(timestamp, frame_pair_, pose);
+}
+}  // namespace tango_util
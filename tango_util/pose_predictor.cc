@@ -0,0 +1,201 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/pose_predictor.h"
+
+#include <time.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// Two frames at 60Hz.
+const double kDefaultDisplayLatency = 2.0 / 60.0;
+
+// Velocities are measured over this interval before the latest pose, long
+// enough to average out the noise of the 100Hz pose stream.
+const double kVelocityInterval = 0.03;
+
+// Constant velocity stops being a good guess after about this long.
+const double kMaxPredictionInterval = 0.1;
+
+// The clock offset follows the fastest pose delivery, and is allowed to grow
+// by this many seconds per second to follow the drift between the clocks.
+const double kClockOffsetDrift = 0.001;
+
+// Below this rotation angle, in radians, the rotation axis is meaningless.
+const double kMinRotationAngle = 1e-9;
+
+double GetMonotonicTime() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+// Hamilton product of quaternions stored as xyzw.
+void MultiplyQuaternions(const double* a, const double* b, double* result) {
+  result[0] = a[3] * b[0] + a[0] * b[3] + a[1] * b[2] - a[2] * b[1];
+  result[1] = a[3] * b[1] - a[0] * b[2] + a[1] * b[3] + a[2] * b[0];
+  result[2] = a[3] * b[2] + a[0] * b[1] - a[1] * b[0] + a[2] * b[3];
+  result[3] = a[3] * b[3] - a[0] * b[0] - a[1] * b[1] - a[2] * b[2];
+}
+}  // namespace
+
+namespace tango_util {
+
+bool ExtrapolatePose(const TangoPoseData& earlier, const TangoPoseData& latest,
+                     double timestamp, TangoPoseData* pose) {
+  const double interval = latest.timestamp - earlier.timestamp;
+  if (earlier.status_code != TANGO_POSE_VALID ||
+      latest.status_code != TANGO_POSE_VALID || interval <= 0.0) {
+    return false;
+  }
+  const double t = (timestamp - latest.timestamp) / interval;
+
+  *pose = latest;
+  pose->timestamp = timestamp;
+  for (int i = 0; i < 3; ++i) {
+    pose->translation[i] = latest.translation[i] +
+                           (latest.translation[i] - earlier.translation[i]) * t;
+  }
+
+  // The rotation from the earlier to the latest orientation, in the base
+  // frame, is scaled by t and applied again to the latest orientation.
+  const double earlier_inverse[4] = {-earlier.orientation[0],
+                                     -earlier.orientation[1],
+                                     -earlier.orientation[2],
+                                     earlier.orientation[3]};
+  double delta[4];
+  MultiplyQuaternions(latest.orientation, earlier_inverse, delta);
+  if (delta[3] < 0.0) {
+    // Take the shortest way.
+    for (int i = 0; i < 4; ++i) {
+      delta[i] = -delta[i];
+    }
+  }
+  const double sin_half_angle = std::sqrt(
+      delta[0] * delta[0] + delta[1] * delta[1] + delta[2] * delta[2]);
+  const double half_angle = std::atan2(sin_half_angle, delta[3]);
+  if (half_angle < kMinRotationAngle) {
+    return true;
+  }
+  const double scale = std::sin(half_angle * t) / sin_half_angle;
+  const double step[4] = {delta[0] * scale, delta[1] * scale,
+                          delta[2] * scale, std::cos(half_angle * t)};
+  MultiplyQuaternions(step, latest.orientation, pose->orientation);
+  double norm = 0.0;
+  for (int i = 0; i < 4; ++i) {
+    norm += pose->orientation[i] * pose->orientation[i];
+  }
+  norm = std::sqrt(norm);
+  for (int i = 0; i < 4; ++i) {
+    pose->orientation[i] /= norm;
+  }
+  return true;
+}
+
+PosePredictor::PosePredictor()
+    : clock_offset_(0.0),
+      has_clock_offset_(false),
+      last_update_time_(0.0),
+      display_latency_(kDefaultDisplayLatency) {}
+
+void PosePredictor::SetDisplayLatency(double display_latency) {
+  display_latency_.store(display_latency, std::memory_order_relaxed);
+}
+
+double PosePredictor::GetDisplayLatency() const {
+  return display_latency_.load(std::memory_order_relaxed);
+}
+
+void PosePredictor::OnPoseAvailable(const TangoPoseData* pose) {
+  if (pose == nullptr || pose->timestamp <= 0.0) {
+    return;
+  }
+  // A pose never arrives before it is measured, so the smallest offset seen
+  // is the closest to the true one.
+  const double offset = GetMonotonicTime() - pose->timestamp;
+  if (!has_clock_offset_.load(std::memory_order_relaxed)) {
+    clock_offset_.store(offset, std::memory_order_relaxed);
+    has_clock_offset_.store(true, std::memory_order_release);
+    last_update_time_ = pose->timestamp;
+    return;
+  }
+  const double elapsed = std::max(pose->timestamp - last_update_time_, 0.0);
+  last_update_time_ = pose->timestamp;
+  const double drifted = clock_offset_.load(std::memory_order_relaxed) +
+                         elapsed * kClockOffsetDrift;
+  clock_offset_.store(std::min(offset, drifted), std::memory_order_relaxed);
+}
+
+double PosePredictor::GetDisplayTimestamp() const {
+  if (!has_clock_offset_.load(std::memory_order_acquire)) {
+    return 0.0;
+  }
+  return GetMonotonicTime() - clock_offset_.load(std::memory_order_relaxed) +
+         GetDisplayLatency();
+}
+
+bool PosePredictor::ToMonotonicTime(double timestamp,
+                                    double* monotonic_time) const {
+  if (!has_clock_offset_.load(std::memory_order_acquire)) {
+    return false;
+  }
+  *monotonic_time = timestamp + clock_offset_.load(std::memory_order_relaxed);
+  return true;
+}
+
+bool PosePredictor::PredictPose(const PoseHistory& history,
+                                TangoPoseData* pose) const {
+  TangoPoseData latest;
+  if (!history.LookUpPose(0.0, &latest)) {
+    return false;
+  }
+  const double display_timestamp = GetDisplayTimestamp();
+  if (display_timestamp <= latest.timestamp) {
+    // The display time is already covered by the history.
+    if (display_timestamp <= 0.0 ||
+        !history.LookUpPose(display_timestamp, pose)) {
+      *pose = latest;
+    }
+    return true;
+  }
+  TangoPoseData earlier;
+  if (!history.LookUpPose(latest.timestamp - kVelocityInterval, &earlier) ||
+      !PredictPose(earlier, latest, pose)) {
+    // Not enough motion recorded yet to measure the velocity.
+    *pose = latest;
+  }
+  return true;
+}
+
+bool PosePredictor::PredictPose(const TangoPoseData& earlier,
+                                const TangoPoseData& latest,
+                                TangoPoseData* pose) const {
+  if (latest.status_code != TANGO_POSE_VALID) {
+    return false;
+  }
+  const double display_timestamp = GetDisplayTimestamp();
+  if (display_timestamp <= latest.timestamp) {
+    *pose = latest;
+    return true;
+  }
+  return ExtrapolatePose(
+      earlier, latest,
+      std::min(display_timestamp, latest.timestamp + kMaxPredictionInterval),
+      pose);
+}
+}  // namespace tango_util
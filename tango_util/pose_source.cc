@@ -0,0 +1,36 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/pose_source.h"
+
+#include <atomic>
+
+namespace {
+std::atomic<tango_util::GetPoseAtTimeFunction> pose_source(
+    TangoService_getPoseAtTime);
+}  // namespace
+
+namespace tango_util {
+
+void SetPoseSource(GetPoseAtTimeFunction function) {
+  pose_source.store(function != NULL ? function : TangoService_getPoseAtTime);
+}
+
+TangoErrorType GetPoseAtTime(double timestamp, TangoCoordinateFramePair frame,
+                             TangoPoseData* pose) {
+  return pose_source.load()(timestamp, frame, pose);
+}
+}  // namespace tango_util
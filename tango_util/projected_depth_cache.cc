@@ -0,0 +1,275 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/projected_depth_cache.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <tango-gl/point_transform.h>
+#include <tango-gl/tracing.h>
+
+namespace {
+// Points closer to the color camera than this are not projected.
+const float kMinDepth = 0.01f;
+}  // namespace
+
+namespace tango_util {
+
+ProjectedDepthCache::Options::Options()
+    : cell_size(8), search_radius(1), depth_sigma(0.05f) {}
+
+ProjectedDepthCache::ProjectedDepthCache(const Options& options)
+    : options_(options), grid_width_(0), grid_height_(0), timestamp_(-1.0) {
+  options_.cell_size = std::max(options_.cell_size, 1);
+  options_.search_radius = std::max(options_.search_radius, 1);
+  const float max_distance =
+      static_cast<float>(options_.search_radius * options_.cell_size);
+  max_distance_squared_ = max_distance * max_distance;
+  intrinsics_.width = 0;
+  intrinsics_.height = 0;
+}
+
+void ProjectedDepthCache::SetIntrinsics(
+    const TangoCameraIntrinsics& intrinsics) {
+  intrinsics_ = intrinsics;
+  rays_.Reset(intrinsics.width, intrinsics.height, intrinsics.fx,
+              intrinsics.fy, intrinsics.cx, intrinsics.cy);
+  grid_width_ =
+      (static_cast<int>(intrinsics.width) + options_.cell_size - 1) /
+      options_.cell_size;
+  grid_height_ =
+      (static_cast<int>(intrinsics.height) + options_.cell_size - 1) /
+      options_.cell_size;
+  cell_starts_.assign(grid_width_ * grid_height_ + 1, 0);
+  points_.clear();
+  timestamp_ = -1.0;
+}
+
+void ProjectedDepthCache::Update(const TangoXYZij* xyz_ij,
+                                 const glm::mat4& camera_T_depth) {
+  if (xyz_ij == nullptr || grid_width_ == 0) {
+    std::fill(cell_starts_.begin(), cell_starts_.end(), 0);
+    points_.clear();
+    timestamp_ = -1.0;
+    return;
+  }
+  if (xyz_ij->timestamp == timestamp_) {
+    return;
+  }
+  TANGO_TRACE_SCOPE("ProjectedDepthCache::Update");
+  timestamp_ = xyz_ij->timestamp;
+
+  // Project every point and count the points of every cell.
+  const uint32_t point_count = xyz_ij->xyz_count;
+  unsorted_points_.resize(point_count);
+  point_cells_.resize(point_count);
+  pixel_x_.resize(point_count);
+  pixel_y_.resize(point_count);
+  depths_.resize(point_count);
+  std::fill(cell_starts_.begin(), cell_starts_.end(), 0);
+  const tango_gl::PointProjection projection(
+      camera_T_depth, static_cast<float>(intrinsics_.fx),
+      static_cast<float>(intrinsics_.fy), static_cast<float>(intrinsics_.cx),
+      static_cast<float>(intrinsics_.cy));
+  tango_gl::ProjectPoints(projection, xyz_ij->xyz[0], point_count,
+                          pixel_x_.data(), pixel_y_.data(), depths_.data());
+  const float cell_scale = 1.0f / options_.cell_size;
+  uint32_t projected_count = 0;
+  for (uint32_t i = 0; i < point_count; ++i) {
+    point_cells_[i] = -1;
+    if (depths_[i] < kMinDepth) {
+      continue;
+    }
+    const float* xyz = xyz_ij->xyz[i];
+    const glm::vec3 depth_point(xyz[0], xyz[1], xyz[2]);
+    const glm::vec2 pixel(pixel_x_[i], pixel_y_[i]);
+    const int cell_x = static_cast<int>(std::floor(pixel.x * cell_scale));
+    const int cell_y = static_cast<int>(std::floor(pixel.y * cell_scale));
+    if (cell_x < 0 || cell_x >= grid_width_ || cell_y < 0 ||
+        cell_y >= grid_height_) {
+      continue;
+    }
+    const int cell = cell_y * grid_width_ + cell_x;
+    ProjectedPoint& projected = unsorted_points_[i];
+    projected.point = depth_point;
+    projected.pixel = pixel;
+    projected.depth = depths_[i];
+    point_cells_[i] = cell;
+    ++cell_starts_[cell + 1];
+    ++projected_count;
+  }
+
+  // Counting sort of the points by cell.
+  for (size_t cell = 1; cell < cell_starts_.size(); ++cell) {
+    cell_starts_[cell] += cell_starts_[cell - 1];
+  }
+  points_.resize(projected_count);
+  for (uint32_t i = 0; i < point_count; ++i) {
+    const int cell = point_cells_[i];
+    if (cell >= 0) {
+      // cell_starts_[cell] is used as the insertion point of the cell, and
+      // ends up as the start of the next one.
+      points_[cell_starts_[cell]++] = unsorted_points_[i];
+    }
+  }
+  for (size_t cell = cell_starts_.size() - 1; cell > 0; --cell) {
+    cell_starts_[cell] = cell_starts_[cell - 1];
+  }
+  cell_starts_[0] = 0;
+}
+
+void ProjectedDepthCache::GetSearchWindow(const glm::vec2& pixel, int* min_x,
+                                          int* min_y, int* max_x,
+                                          int* max_y) const {
+  const int cell_x = static_cast<int>(std::floor(pixel.x / options_.cell_size));
+  const int cell_y = static_cast<int>(std::floor(pixel.y / options_.cell_size));
+  *min_x = std::max(cell_x - options_.search_radius, 0);
+  *min_y = std::max(cell_y - options_.search_radius, 0);
+  *max_x = std::min(cell_x + options_.search_radius, grid_width_ - 1);
+  *max_y = std::min(cell_y + options_.search_radius, grid_height_ - 1);
+}
+
+int ProjectedDepthCache::FindNearest(const glm::vec2& pixel) const {
+  int min_x, min_y, max_x, max_y;
+  GetSearchWindow(pixel, &min_x, &min_y, &max_x, &max_y);
+  int nearest = -1;
+  float nearest_distance = max_distance_squared_;
+  for (int y = min_y; y <= max_y; ++y) {
+    for (int x = min_x; x <= max_x; ++x) {
+      const int cell = y * grid_width_ + x;
+      for (uint32_t i = cell_starts_[cell]; i < cell_starts_[cell + 1]; ++i) {
+        const glm::vec2 offset = points_[i].pixel - pixel;
+        const float distance = glm::dot(offset, offset);
+        if (distance <= nearest_distance) {
+          nearest_distance = distance;
+          nearest = static_cast<int>(i);
+        }
+      }
+    }
+  }
+  return nearest;
+}
+
+bool ProjectedDepthCache::GetQueryPixel(const float uv[2],
+                                        const glm::mat4& camera_t1_T_camera_t0,
+                                        glm::vec2* pixel) const {
+  if (points_.empty()) {
+    return false;
+  }
+  const glm::vec3 ray(
+      rays_.GetRay(glm::vec2(uv[0] * intrinsics_.width,
+                             uv[1] * intrinsics_.height)),
+      1.0f);
+
+  // Mapping the pixel needs its depth, which is only known once the pixel is
+  // mapped: first map its ray as if the camera only rotated, then map the
+  // point at the depth found there.
+  glm::vec3 camera_t1_point = glm::mat3(camera_t1_T_camera_t0) * ray;
+  for (int pass = 0; pass < 2; ++pass) {
+    if (camera_t1_point.z < kMinDepth) {
+      return false;
+    }
+    *pixel = glm::vec2(
+        intrinsics_.fx * camera_t1_point.x / camera_t1_point.z +
+            intrinsics_.cx,
+        intrinsics_.fy * camera_t1_point.y / camera_t1_point.z +
+            intrinsics_.cy);
+    if (pass == 1) {
+      break;
+    }
+    const int nearest = FindNearest(*pixel);
+    if (nearest < 0) {
+      break;
+    }
+    // The depth at t0 is close to the depth at t1 over the short motion
+    // between a point cloud and an image.
+    camera_t1_point = glm::vec3(camera_t1_T_camera_t0 *
+                                glm::vec4(ray * points_[nearest].depth, 1.0f));
+  }
+  return pixel->x >= 0.0f && pixel->y >= 0.0f &&
+         pixel->x < grid_width_ * options_.cell_size &&
+         pixel->y < grid_height_ * options_.cell_size;
+}
+
+bool ProjectedDepthCache::GetNearestPoint(
+    const float uv[2], const glm::mat4& camera_t1_T_camera_t0,
+    float xyz[3]) const {
+  glm::vec2 pixel;
+  if (!GetQueryPixel(uv, camera_t1_T_camera_t0, &pixel)) {
+    return false;
+  }
+  const int nearest = FindNearest(pixel);
+  if (nearest < 0) {
+    return false;
+  }
+  const glm::vec3& point = points_[nearest].point;
+  xyz[0] = point.x;
+  xyz[1] = point.y;
+  xyz[2] = point.z;
+  return true;
+}
+
+bool ProjectedDepthCache::GetInterpolatedPoint(
+    const float uv[2], const glm::mat4& camera_t1_T_camera_t0,
+    float xyz[3]) const {
+  glm::vec2 pixel;
+  if (!GetQueryPixel(uv, camera_t1_T_camera_t0, &pixel)) {
+    return false;
+  }
+  const int nearest = FindNearest(pixel);
+  if (nearest < 0) {
+    return false;
+  }
+
+  const float reference_depth = points_[nearest].depth;
+  // The spatial sigma is half the search radius.
+  const float spatial_scale = -2.0f / max_distance_squared_;
+  const float depth_scale =
+      -0.5f / (options_.depth_sigma * options_.depth_sigma);
+  int min_x, min_y, max_x, max_y;
+  GetSearchWindow(pixel, &min_x, &min_y, &max_x, &max_y);
+  glm::vec3 sum(0.0f);
+  float weight_sum = 0.0f;
+  for (int y = min_y; y <= max_y; ++y) {
+    for (int x = min_x; x <= max_x; ++x) {
+      const int cell = y * grid_width_ + x;
+      for (uint32_t i = cell_starts_[cell]; i < cell_starts_[cell + 1]; ++i) {
+        const ProjectedPoint& projected = points_[i];
+        const glm::vec2 offset = projected.pixel - pixel;
+        const float distance = glm::dot(offset, offset);
+        if (distance > max_distance_squared_) {
+          continue;
+        }
+        const float depth_offset = projected.depth - reference_depth;
+        const float weight =
+            std::exp(spatial_scale * distance +
+                     depth_scale * depth_offset * depth_offset);
+        sum += weight * projected.point;
+        weight_sum += weight;
+      }
+    }
+  }
+  // Falls back to the nearest point should every weight underflow.
+  const glm::vec3 point =
+      weight_sum > 0.0f ? sum / weight_sum : points_[nearest].point;
+  xyz[0] = point.x;
+  xyz[1] = point.y;
+  xyz[2] = point.z;
+  return true;
+}
+
+}  // namespace tango_util
@@ -0,0 +1,197 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/quality_governor.h"
+
+#include <cstdio>
+
+#include <tango-gl/util.h>
+
+#include "tango-util/performance_hint.h"
+
+namespace {
+// The frame time is over the budget beyond kOverBudgetRatio of it, and well
+// under it below kUnderBudgetRatio of it.
+const double kOverBudgetRatio = 1.1;
+const double kUnderBudgetRatio = 0.7;
+
+// Frames over the budget before stepping down, about half a second, and
+// frames well under it before stepping back up, about ten seconds.
+const int kStepDownFrames = 30;
+const int kStepUpFrames = 600;
+
+// Weight of the latest frame in the smoothed frame time.
+const double kFrameTimeSmoothing = 0.1;
+
+// Interval between reads of the thermal zones.
+const std::chrono::seconds kThermalReadInterval(2);
+const int kMaxThermalZoneCount = 32;
+
+// Temperatures in degrees Celsius of the hottest thermal zone from which the
+// device is considered in the light, moderate, severe and critical states.
+const int kThermalThresholds[] = {42, 46, 50, 54};
+
+// Map the hottest thermal zone of the kernel to a thermal status.
+tango_util::QualityGovernor::ThermalStatus ReadThermalZoneStatus() {
+  int max_temperature = 0;
+  for (int i = 0; i < kMaxThermalZoneCount; ++i) {
+    char path[64];
+    snprintf(path, sizeof(path), "/sys/class/thermal/thermal_zone%d/temp", i);
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+      break;
+    }
+    int temperature;
+    if (fscanf(file, "%d", &temperature) == 1) {
+      // Most zones report millidegrees, some degrees.
+      if (temperature > 1000) {
+        temperature /= 1000;
+      }
+      if (temperature > max_temperature) {
+        max_temperature = temperature;
+      }
+    }
+    fclose(file);
+  }
+
+  int status = tango_util::QualityGovernor::kThermalStatusNone;
+  for (int threshold : kThermalThresholds) {
+    if (max_temperature >= threshold) {
+      ++status;
+    }
+  }
+  return static_cast<tango_util::QualityGovernor::ThermalStatus>(status);
+}
+}  // namespace
+
+namespace tango_util {
+
+QualityGovernor::QualityGovernor(const std::vector<QualityLevel>& levels,
+                                 double frame_budget)
+    : levels_(levels),
+      frame_budget_(frame_budget),
+      level_index_(0),
+      average_frame_time_(0.0),
+      over_budget_frames_(0),
+      under_budget_frames_(0),
+      thermal_status_(kThermalStatusNone),
+      read_thermal_zones_(true),
+      hint_session_(nullptr) {
+  if (levels_.empty()) {
+    LOGE("QualityGovernor: no quality level, using the default ones");
+    levels_ = DefaultLevels();
+  }
+}
+
+std::vector<QualityLevel> QualityGovernor::DefaultLevels() {
+  std::vector<QualityLevel> levels;
+  levels.push_back({7, 1, 1, true, 0, 1.0f});
+  levels.push_back({5, 2, 1, true, 1000000, 0.85f});
+  levels.push_back({3, 2, 2, false, 500000, 0.7f});
+  levels.push_back({2, 4, 4, false, 250000, 0.5f});
+  return levels;
+}
+
+void QualityGovernor::SetThermalStatus(ThermalStatus status) {
+  thermal_status_.store(status);
+}
+
+void QualityGovernor::SetPerformanceHintSession(
+    PerformanceHintSession* session) {
+  hint_session_ = session;
+  if (hint_session_ != nullptr) {
+    hint_session_->SetTargetDuration(frame_budget_);
+  }
+}
+
+void QualityGovernor::BeginFrame() {
+  if (hint_session_ != nullptr) {
+    hint_session_->AddCurrentThread();
+  }
+  frame_start_ = std::chrono::steady_clock::now();
+}
+
+void QualityGovernor::EndFrame() {
+  const std::chrono::steady_clock::time_point now =
+      std::chrono::steady_clock::now();
+  if (read_thermal_zones_ && now - last_thermal_read_ >= kThermalReadInterval) {
+    last_thermal_read_ = now;
+    SetThermalStatus(ReadThermalZoneStatus());
+  }
+  OnFrameTime(
+      std::chrono::duration<double, std::milli>(now - frame_start_).count());
+}
+
+bool QualityGovernor::OnFrameTime(double frame_time) {
+  if (hint_session_ != nullptr) {
+    hint_session_->ReportActualDuration(frame_time);
+  }
+  const int previous_level_index = level_index_;
+  average_frame_time_ = average_frame_time_ == 0.0
+                            ? frame_time
+                            : average_frame_time_ +
+                                  kFrameTimeSmoothing *
+                                      (frame_time - average_frame_time_);
+
+  // Heat comes first, the cheapest levels are used while the device is hot
+  // whatever the frame time.
+  const int best_allowed_level_index = GetBestAllowedLevelIndex();
+  if (level_index_ < best_allowed_level_index) {
+    SetLevelIndex(best_allowed_level_index);
+  } else if (average_frame_time_ > frame_budget_ * kOverBudgetRatio) {
+    under_budget_frames_ = 0;
+    if (++over_budget_frames_ >= kStepDownFrames &&
+        level_index_ + 1 < GetLevelCount()) {
+      SetLevelIndex(level_index_ + 1);
+    }
+  } else if (average_frame_time_ < frame_budget_ * kUnderBudgetRatio) {
+    over_budget_frames_ = 0;
+    if (++under_budget_frames_ >= kStepUpFrames &&
+        level_index_ > best_allowed_level_index) {
+      SetLevelIndex(level_index_ - 1);
+    }
+  } else {
+    over_budget_frames_ = 0;
+    under_budget_frames_ = 0;
+  }
+  return level_index_ != previous_level_index;
+}
+
+bool QualityGovernor::HasHeadroom() const {
+  return average_frame_time_ < frame_budget_ * kUnderBudgetRatio &&
+         thermal_status_.load() == kThermalStatusNone;
+}
+
+void QualityGovernor::SetLevelIndex(int level_index) {
+  LOGI(
+      "QualityGovernor: quality level %d -> %d, frame time %.1f ms, thermal "
+      "status %d",
+      level_index_, level_index, average_frame_time_, thermal_status_.load());
+  level_index_ = level_index;
+  over_budget_frames_ = 0;
+  under_budget_frames_ = 0;
+}
+
+int QualityGovernor::GetBestAllowedLevelIndex() const {
+  // Light throttling is left to the frame time, each further status caps the
+  // best level one step lower.
+  const int thermal_steps = thermal_status_.load() - kThermalStatusLight;
+  if (thermal_steps <= 0) {
+    return 0;
+  }
+  return thermal_steps < GetLevelCount() ? thermal_steps : GetLevelCount() - 1;
+}
+}  // namespace tango_util
@@ -0,0 +1,57 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/render_scheduler.h"
+
+namespace tango_util {
+
+RenderScheduler::RenderScheduler()
+    : is_on_demand_(false),
+      pending_reasons_(0),
+      request_count_(0),
+      frame_count_(0) {}
+
+void RenderScheduler::SetRequestFunction(
+    const RequestFunction& request_function) {
+  std::lock_guard<std::mutex> lock(request_mutex_);
+  request_function_ = request_function;
+}
+
+void RenderScheduler::SetOnDemand(bool on_demand) {
+  is_on_demand_.store(on_demand);
+  // Draw the current state in the new mode.
+  RequestRender(kStateChange);
+}
+
+void RenderScheduler::RequestRender(uint32_t reasons) {
+  ++request_count_;
+  // Only the first request since the last frame asks the platform, the
+  // others are drawn by the same frame.
+  const uint32_t previous_reasons = pending_reasons_.fetch_or(reasons);
+  if (previous_reasons != 0 || !is_on_demand_.load()) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(request_mutex_);
+  if (request_function_) {
+    request_function_();
+  }
+}
+
+uint32_t RenderScheduler::BeginFrame() {
+  ++frame_count_;
+  return pending_reasons_.exchange(0);
+}
+}  // namespace tango_util
@@ -0,0 +1,443 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/session_log.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include <tango-gl/util.h>
+
+namespace {
+const int kRecordTypeCount = 4;
+
+double RecordTimestamp(const tango_util::session_log::ChunkHeader& header,
+                       uint32_t time_offset) {
+  return time_offset == 0 ? header.first_timestamp
+                          : header.first_timestamp +
+                                time_offset /
+                                    tango_util::session_log::kTimeOffsetScale;
+}
+}  // namespace
+
+namespace tango_util {
+
+const char session_log::kFileMagic[4] = {'T', 'S', 'L', 'G'};
+const char session_log::kChunkMagic[4] = {'T', 'S', 'C', 'K'};
+
+int16_t session_log::QuantizePoint(float value, float scale) {
+  const float quantized = std::round(value * scale);
+  if (quantized > std::numeric_limits<int16_t>::max()) {
+    return std::numeric_limits<int16_t>::max();
+  }
+  if (quantized < std::numeric_limits<int16_t>::min()) {
+    return std::numeric_limits<int16_t>::min();
+  }
+  return static_cast<int16_t>(quantized);
+}
+
+void session_log::EncodePose(const TangoPoseData& pose,
+                             int64_t translation[3], PoseRecord* record) {
+  // Deltas between quantized translations, so decoding them back does not
+  // accumulate rounding errors.
+  for (int i = 0; i < 3; ++i) {
+    const int64_t quantized = static_cast<int64_t>(
+        std::llround(pose.translation[i] * kTranslationScale));
+    record->translation_delta[i] =
+        static_cast<int32_t>(quantized - translation[i]);
+    translation[i] = quantized;
+  }
+  for (int i = 0; i < 4; ++i) {
+    record->orientation[i] = static_cast<int16_t>(
+        std::round(pose.orientation[i] * kOrientationScale));
+  }
+  record->status_code = static_cast<uint8_t>(pose.status_code);
+  record->base_frame = static_cast<uint8_t>(pose.frame.base);
+  record->target_frame = static_cast<uint8_t>(pose.frame.target);
+  record->reserved = 0;
+}
+
+SessionReader::SessionReader()
+    : file_(NULL),
+      mapping_(NULL),
+      mapping_size_(0),
+      type_mask_(~0u),
+      point_scale_(session_log::kDefaultPointScale),
+      start_timestamp_(0.0),
+      end_timestamp_(0.0) {}
+
+SessionReader::~SessionReader() { Close(); }
+
+bool SessionReader::Open(const char* path) {
+  Close();
+  file_ = fopen(path, "rb");
+  if (file_ == NULL) {
+    LOGE("SessionReader: failed to open %s", path);
+    return false;
+  }
+
+  session_log::FileHeader file_header;
+  if (fread(&file_header, sizeof(file_header), 1, file_) != 1 ||
+      memcmp(file_header.magic, session_log::kFileMagic,
+             sizeof(session_log::kFileMagic)) != 0 ||
+      file_header.version < 1 || file_header.version > session_log::kVersion) {
+    LOGE("SessionReader: %s is not a session log", path);
+    Close();
+    return false;
+  }
+  point_scale_ = file_header.point_scale;
+
+  fseek(file_, 0, SEEK_END);
+  const long file_size = ftell(file_);
+  long offset = sizeof(file_header);
+  start_timestamp_ = std::numeric_limits<double>::max();
+  end_timestamp_ = 0.0;
+  while (true) {
+    ChunkInfo info;
+    fseek(file_, offset, SEEK_SET);
+    if (fread(&info.header, sizeof(info.header), 1, file_) != 1) {
+      break;
+    }
+    info.payload_offset = offset + sizeof(info.header);
+    if (memcmp(info.header.magic, session_log::kChunkMagic,
+               sizeof(session_log::kChunkMagic)) != 0 ||
+        info.header.type < 1 || info.header.type > kRecordTypeCount ||
+        info.payload_offset + static_cast<long>(info.header.payload_size) >
+            file_size) {
+      LOGI("SessionReader: %s ends with an incomplete chunk", path);
+      break;
+    }
+    cursors_[info.header.type - 1].chunks.push_back(chunk_infos_.size());
+    chunk_infos_.push_back(info);
+    if (info.header.first_timestamp < start_timestamp_) {
+      start_timestamp_ = info.header.first_timestamp;
+    }
+    if (info.header.last_timestamp > end_timestamp_) {
+      end_timestamp_ = info.header.last_timestamp;
+    }
+    offset = info.payload_offset + info.header.payload_size;
+  }
+  if (chunk_infos_.empty()) {
+    start_timestamp_ = 0.0;
+  }
+
+  // The cursors mostly move forward, each through its own chunks.
+  if (file_size > 0) {
+    void* mapping = mmap(NULL, file_size, PROT_READ, MAP_PRIVATE,
+                         fileno(file_), 0);
+    if (mapping != MAP_FAILED) {
+      mapping_ = static_cast<const uint8_t*>(mapping);
+      mapping_size_ = file_size;
+      madvise(mapping, mapping_size_, MADV_SEQUENTIAL);
+    } else {
+      LOGI("SessionReader: failed to map %s, reading it instead", path);
+    }
+  }
+
+  for (Cursor& cursor : cursors_) {
+    LoadChunk(&cursor, 0);
+  }
+  return true;
+}
+
+void SessionReader::Close() {
+  if (mapping_ != NULL) {
+    munmap(const_cast<uint8_t*>(mapping_), mapping_size_);
+  }
+  mapping_ = NULL;
+  mapping_size_ = 0;
+  if (file_ != NULL) {
+    fclose(file_);
+  }
+  file_ = NULL;
+  chunk_infos_.clear();
+  for (Cursor& cursor : cursors_) {
+    cursor.chunks.clear();
+    cursor.chunk = 0;
+    cursor.data = NULL;
+    cursor.payload.clear();
+    cursor.payload_offset = 0;
+    cursor.record_index = 0;
+  }
+}
+
+bool SessionReader::Seek(double timestamp) {
+  if (file_ == NULL) {
+    return false;
+  }
+  for (int type = 0; type < kRecordTypeCount; ++type) {
+    if ((type_mask_ & (1u << (type + 1))) == 0) {
+      continue;
+    }
+    Cursor* cursor = &cursors_[type];
+    // Only the headers are needed to find the chunk, then the records that
+    // come before the timestamp are decoded and dropped, as the translations
+    // of poses are accumulated.
+    size_t chunk = 0;
+    while (chunk < cursor->chunks.size() &&
+           chunk_infos_[cursor->chunks[chunk]].header.last_timestamp <
+               timestamp) {
+      ++chunk;
+    }
+    LoadChunk(cursor, chunk);
+    Record record;
+    while (Prepare(cursor) && PeekTimestamp(*cursor) < timestamp &&
+           Decode(cursor, static_cast<session_log::RecordType>(type + 1),
+                  &record)) {
+    }
+  }
+  return true;
+}
+
+bool SessionReader::Read(Record* record) {
+  int next_type = -1;
+  double next_timestamp = 0.0;
+  for (int type = 0; type < kRecordTypeCount; ++type) {
+    if ((type_mask_ & (1u << (type + 1))) == 0 || !Prepare(&cursors_[type])) {
+      continue;
+    }
+    const double timestamp = PeekTimestamp(cursors_[type]);
+    if (next_type < 0 || timestamp < next_timestamp) {
+      next_type = type;
+      next_timestamp = timestamp;
+    }
+  }
+  if (next_type < 0) {
+    return false;
+  }
+  return Decode(&cursors_[next_type],
+                static_cast<session_log::RecordType>(next_type + 1), record);
+}
+
+bool SessionReader::LoadChunk(Cursor* cursor, size_t chunk) {
+  if (mapping_ != NULL && cursor->chunk < cursor->chunks.size() &&
+      cursor->chunk != chunk) {
+    AdviseChunk(chunk_infos_[cursor->chunks[cursor->chunk]], MADV_DONTNEED);
+  }
+  cursor->chunk = chunk;
+  cursor->payload_offset = 0;
+  cursor->record_index = 0;
+  cursor->translation[0] = 0;
+  cursor->translation[1] = 0;
+  cursor->translation[2] = 0;
+  if (chunk >= cursor->chunks.size()) {
+    cursor->data = NULL;
+    cursor->payload.clear();
+    return false;
+  }
+  const ChunkInfo& info = chunk_infos_[cursor->chunks[chunk]];
+  if (mapping_ != NULL) {
+    cursor->data = mapping_ + info.payload_offset;
+    AdviseChunk(info, MADV_WILLNEED);
+    return true;
+  }
+  cursor->payload.resize(info.header.payload_size);
+  fseek(file_, info.payload_offset, SEEK_SET);
+  if (fread(cursor->payload.data(), 1, cursor->payload.size(), file_) !=
+      cursor->payload.size()) {
+    LOGE("SessionReader: failed to read a chunk");
+    StopCursor(cursor);
+    return false;
+  }
+  cursor->data = cursor->payload.data();
+  return true;
+}
+
+void SessionReader::StopCursor(Cursor* cursor) {
+  cursor->chunk = cursor->chunks.size();
+  cursor->data = NULL;
+  cursor->payload.clear();
+}
+
+size_t SessionReader::GetRemainingBytes(const Cursor& cursor) const {
+  const size_t payload_size =
+      chunk_infos_[cursor.chunks[cursor.chunk]].header.payload_size;
+  return cursor.payload_offset < payload_size
+             ? payload_size - cursor.payload_offset
+             : 0;
+}
+
+bool SessionReader::Prepare(Cursor* cursor) {
+  while (cursor->chunk < cursor->chunks.size()) {
+    const ChunkInfo& info = chunk_infos_[cursor->chunks[cursor->chunk]];
+    if (cursor->record_index < info.header.record_count) {
+      // Every record starts with its time offset, for PeekTimestamp().
+      if (GetRemainingBytes(*cursor) < sizeof(uint32_t)) {
+        return RejectRecord(cursor);
+      }
+      return true;
+    }
+    LoadChunk(cursor, cursor->chunk + 1);
+  }
+  return false;
+}
+
+double SessionReader::PeekTimestamp(const Cursor& cursor) const {
+  uint32_t time_offset;
+  memcpy(&time_offset, cursor.data + cursor.payload_offset,
+         sizeof(time_offset));
+  return RecordTimestamp(chunk_infos_[cursor.chunks[cursor.chunk]].header,
+                         time_offset);
+}
+
+bool SessionReader::Decode(Cursor* cursor, session_log::RecordType type,
+                           Record* record) {
+  const session_log::ChunkHeader& header =
+      chunk_infos_[cursor->chunks[cursor->chunk]].header;
+  const uint8_t* data = cursor->data + cursor->payload_offset;
+  size_t fixed_size = 0;
+  switch (type) {
+    case session_log::kPoseRecord:
+      fixed_size = sizeof(session_log::PoseRecord);
+      break;
+    case session_log::kPointCloudRecord:
+      fixed_size = sizeof(session_log::PointCloudRecord);
+      break;
+    case session_log::kImageRecord:
+      fixed_size = sizeof(session_log::ImageRecord);
+      break;
+    case session_log::kTrajectoryRecord:
+      fixed_size = sizeof(session_log::TrajectoryRecord);
+      break;
+  }
+  if (GetRemainingBytes(*cursor) < fixed_size) {
+    return RejectRecord(cursor);
+  }
+  // The data that follows the fixed part is checked against the rest of the
+  // payload before it is read. The point count is checked by division, as
+  // its size in bytes can overflow a 32 bit size_t.
+  const size_t remaining_size = GetRemainingBytes(*cursor) - fixed_size;
+  record->type = type;
+
+  switch (type) {
+    case session_log::kPoseRecord: {
+      session_log::PoseRecord pose_record;
+      memcpy(&pose_record, data, sizeof(pose_record));
+      cursor->payload_offset += sizeof(pose_record);
+      record->timestamp = RecordTimestamp(header, pose_record.time_offset);
+      TangoPoseData* pose = &record->pose;
+      memset(pose, 0, sizeof(*pose));
+      pose->timestamp = record->timestamp;
+      for (int i = 0; i < 3; ++i) {
+        cursor->translation[i] += pose_record.translation_delta[i];
+        pose->translation[i] =
+            cursor->translation[i] / session_log::kTranslationScale;
+      }
+      for (int i = 0; i < 4; ++i) {
+        pose->orientation[i] =
+            pose_record.orientation[i] / session_log::kOrientationScale;
+      }
+      pose->status_code =
+          static_cast<TangoPoseStatusType>(pose_record.status_code);
+      pose->frame.base =
+          static_cast<TangoCoordinateFrameType>(pose_record.base_frame);
+      pose->frame.target =
+          static_cast<TangoCoordinateFrameType>(pose_record.target_frame);
+      break;
+    }
+    case session_log::kPointCloudRecord: {
+      session_log::PointCloudRecord cloud_record;
+      memcpy(&cloud_record, data, sizeof(cloud_record));
+      if (cloud_record.point_count > remaining_size / (3 * sizeof(int16_t))) {
+        return RejectRecord(cursor);
+      }
+      cursor->payload_offset += sizeof(cloud_record);
+      record->timestamp = RecordTimestamp(header, cloud_record.time_offset);
+      const size_t value_count = cloud_record.point_count * 3;
+      const uint8_t* values = cursor->data + cursor->payload_offset;
+      cursor->payload_offset += value_count * sizeof(int16_t);
+      record->points.resize(value_count);
+      for (size_t i = 0; i < value_count; ++i) {
+        int16_t value;
+        memcpy(&value, values + i * sizeof(value), sizeof(value));
+        record->points[i] = value / point_scale_;
+      }
+      break;
+    }
+    case session_log::kImageRecord: {
+      session_log::ImageRecord image_record;
+      memcpy(&image_record, data, sizeof(image_record));
+      if (image_record.data_size > remaining_size) {
+        return RejectRecord(cursor);
+      }
+      cursor->payload_offset += sizeof(image_record);
+      record->timestamp = RecordTimestamp(header, image_record.time_offset);
+      record->image_data.assign(
+          cursor->data + cursor->payload_offset,
+          cursor->data + cursor->payload_offset +
+              image_record.data_size);
+      cursor->payload_offset += image_record.data_size;
+      TangoImageBuffer* image = &record->image;
+      image->width = image_record.width;
+      image->height = image_record.height;
+      image->stride = image_record.stride;
+      image->timestamp = record->timestamp;
+      image->frame_number = image_record.frame_number;
+      image->format = static_cast<TangoImageFormatType>(image_record.format);
+      image->data = record->image_data.data();
+      break;
+    }
+    case session_log::kTrajectoryRecord: {
+      session_log::TrajectoryRecord trajectory_record;
+      memcpy(&trajectory_record, data, sizeof(trajectory_record));
+      if (trajectory_record.data_size > remaining_size) {
+        return RejectRecord(cursor);
+      }
+      cursor->payload_offset += sizeof(trajectory_record);
+      record->timestamp =
+          RecordTimestamp(header, trajectory_record.time_offset);
+      record->trajectory_data.assign(
+          cursor->data + cursor->payload_offset,
+          cursor->data + cursor->payload_offset +
+              trajectory_record.data_size);
+      cursor->payload_offset += trajectory_record.data_size;
+      break;
+    }
+  }
+  ++cursor->record_index;
+  return true;
+}
+
+bool SessionReader::RejectRecord(Cursor* cursor) {
+  LOGE("SessionReader: record %u overruns its chunk", cursor->record_index);
+  StopCursor(cursor);
+  return false;
+}
+
+void SessionReader::AdviseChunk(const ChunkInfo& info, int advice) const {
+  const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  size_t begin = info.payload_offset;
+  size_t end = begin + info.header.payload_size;
+  if (advice == MADV_DONTNEED) {
+    // Only the pages of the chunk alone, its first and last ones possibly
+    // holding the chunks another cursor is on.
+    begin = (begin + page_size - 1) / page_size * page_size;
+    end = end / page_size * page_size;
+  } else {
+    begin = begin / page_size * page_size;
+    end = std::min((end + page_size - 1) / page_size * page_size,
+                   mapping_size_);
+  }
+  if (begin < end) {
+    madvise(const_cast<uint8_t*>(mapping_) + begin, end - begin, advice);
+  }
+}
+}  // namespace tango_util
@@ -0,0 +1,329 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/session_player.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include <tango-gl/util.h>
+
+#include "tango-util/pose_history.h"
+#include "tango-util/pose_source.h"
+
+namespace {
+// The player answering the pose queries of pose_source.h, if any.
+std::atomic<const tango_util::SessionPlayer*> installed_player(nullptr);
+
+bool IsSameFrame(const TangoCoordinateFramePair& a,
+                 const TangoCoordinateFramePair& b) {
+  return a.base == b.base && a.target == b.target;
+}
+
+bool IsEarlier(const TangoPoseData& pose, double timestamp) {
+  return pose.timestamp < timestamp;
+}
+
+void SetInvalidPose(double timestamp, const TangoCoordinateFramePair& frame,
+                    TangoPoseData* pose) {
+  memset(pose, 0, sizeof(*pose));
+  pose->frame = frame;
+  pose->timestamp = timestamp;
+  pose->status_code = TANGO_POSE_INVALID;
+  pose->orientation[3] = 1.0;
+}
+}  // namespace
+
+namespace tango_util {
+
+SessionPlayer::SessionPlayer()
+    : pose_context_(nullptr),
+      on_pose_available_(nullptr),
+      xyz_ij_context_(nullptr),
+      on_xyz_ij_available_(nullptr),
+      frame_context_(nullptr),
+      on_frame_available_(nullptr),
+      current_timestamp_(0.0),
+      is_playing_(false),
+      stop_requested_(false) {}
+
+SessionPlayer::~SessionPlayer() {
+  Stop();
+  UninstallPoseSource();
+}
+
+bool SessionPlayer::Open(const char* path) {
+  Stop();
+  if (!reader_.Open(path)) {
+    return false;
+  }
+
+  // The poses are read on their own, so that every pose query can be
+  // answered whatever record is being replayed.
+  SessionReader pose_reader;
+  if (!pose_reader.Open(path)) {
+    return false;
+  }
+  pose_reader.SetRecordTypes(1u << session_log::kPoseRecord);
+
+  std::lock_guard<tango_gl::ProfiledMutex> lock(pose_mutex_);
+  pose_tracks_.erase(
+      std::remove_if(pose_tracks_.begin(), pose_tracks_.end(),
+                     [](const PoseTrack& track) { return !track.is_static; }),
+      pose_tracks_.end());
+  SessionReader::Record record;
+  while (pose_reader.Read(&record)) {
+    PoseTrack* track = FindTrack(record.pose.frame);
+    if (track == nullptr) {
+      pose_tracks_.push_back(PoseTrack());
+      track = &pose_tracks_.back();
+      track->frame = record.pose.frame;
+      track->is_static = false;
+    }
+    if (!track->is_static) {
+      track->poses.push_back(record.pose);
+    }
+  }
+  current_timestamp_.store(0.0);
+  return true;
+}
+
+void SessionPlayer::ConnectOnPoseAvailable(void* context,
+                                           OnPoseAvailableFunction callback) {
+  pose_context_ = context;
+  on_pose_available_ = callback;
+}
+
+void SessionPlayer::ConnectOnXYZijAvailable(
+    void* context, OnXYZijAvailableFunction callback) {
+  xyz_ij_context_ = context;
+  on_xyz_ij_available_ = callback;
+}
+
+void SessionPlayer::ConnectOnFrameAvailable(
+    void* context, OnFrameAvailableFunction callback) {
+  frame_context_ = context;
+  on_frame_available_ = callback;
+}
+
+void SessionPlayer::AddStaticPose(const TangoPoseData& pose) {
+  std::lock_guard<tango_gl::ProfiledMutex> lock(pose_mutex_);
+  PoseTrack* track = FindTrack(pose.frame);
+  if (track == nullptr) {
+    pose_tracks_.push_back(PoseTrack());
+    track = &pose_tracks_.back();
+    track->frame = pose.frame;
+  }
+  track->is_static = true;
+  track->poses.assign(1, pose);
+}
+
+void SessionPlayer::InstallPoseSource() {
+  installed_player.store(this);
+  SetPoseSource(GetInstalledPoseAtTime);
+}
+
+void SessionPlayer::UninstallPoseSource() {
+  const SessionPlayer* player = this;
+  if (installed_player.compare_exchange_strong(player, nullptr)) {
+    SetPoseSource(nullptr);
+  }
+}
+
+TangoErrorType SessionPlayer::GetPoseAtTime(
+    double timestamp, const TangoCoordinateFramePair& frame,
+    TangoPoseData* pose) const {
+  if (pose == nullptr) {
+    return TANGO_INVALID;
+  }
+  std::lock_guard<tango_gl::ProfiledMutex> lock(pose_mutex_);
+  const PoseTrack* track = FindTrack(frame);
+  if (track == nullptr || track->poses.empty()) {
+    SetInvalidPose(timestamp, frame, pose);
+    return TANGO_SUCCESS;
+  }
+  if (track->is_static) {
+    *pose = track->poses.front();
+    pose->timestamp = timestamp;
+    return TANGO_SUCCESS;
+  }
+
+  const std::vector<TangoPoseData>& poses = track->poses;
+  if (timestamp == 0.0) {
+    // The latest pose as of the record being replayed.
+    const double current = current_timestamp_.load();
+    std::vector<TangoPoseData>::const_iterator it =
+        std::upper_bound(poses.begin(), poses.end(), current,
+                         [](double t, const TangoPoseData& pose) {
+                           return t < pose.timestamp;
+                         });
+    *pose = it == poses.begin() ? poses.front() : *(it - 1);
+    return TANGO_SUCCESS;
+  }
+
+  std::vector<TangoPoseData>::const_iterator newer =
+      std::lower_bound(poses.begin(), poses.end(), timestamp, IsEarlier);
+  if (newer == poses.end() || newer == poses.begin()) {
+    // Outside of the recording, like the service outside of its history.
+    if (newer != poses.end() && newer->timestamp == timestamp) {
+      *pose = *newer;
+    } else {
+      SetInvalidPose(timestamp, frame, pose);
+    }
+    return TANGO_SUCCESS;
+  }
+  const TangoPoseData& older = *(newer - 1);
+  if (!InterpolatePose(older, *newer, timestamp, pose)) {
+    // Across a loss of tracking, the status of the earlier pose holds.
+    *pose = older;
+    pose->timestamp = timestamp;
+  }
+  return TANGO_SUCCESS;
+}
+
+bool SessionPlayer::Seek(double timestamp) {
+  if (is_playing_.load()) {
+    LOGE("SessionPlayer: Cannot seek while playing.");
+    return false;
+  }
+  if (!reader_.Seek(timestamp)) {
+    return false;
+  }
+  current_timestamp_.store(timestamp);
+  return true;
+}
+
+bool SessionPlayer::Step() {
+  if (!reader_.Read(&record_)) {
+    return false;
+  }
+  Deliver(record_);
+  return true;
+}
+
+bool SessionPlayer::Play(PlaybackMode mode) {
+  if (is_playing_.load()) {
+    LOGE("SessionPlayer: Already playing.");
+    return false;
+  }
+  if (playback_thread_.joinable()) {
+    playback_thread_.join();
+  }
+  stop_requested_.store(false);
+  is_playing_.store(true);
+  playback_thread_ = std::thread(&SessionPlayer::PlayLoop, this, mode);
+  return true;
+}
+
+void SessionPlayer::Stop() {
+  stop_requested_.store(true);
+  Wait();
+}
+
+void SessionPlayer::Wait() {
+  if (playback_thread_.joinable()) {
+    playback_thread_.join();
+  }
+}
+
+SessionPlayer::PoseTrack* SessionPlayer::FindTrack(
+    const TangoCoordinateFramePair& frame) {
+  for (PoseTrack& track : pose_tracks_) {
+    if (IsSameFrame(track.frame, frame)) {
+      return &track;
+    }
+  }
+  return nullptr;
+}
+
+const SessionPlayer::PoseTrack* SessionPlayer::FindTrack(
+    const TangoCoordinateFramePair& frame) const {
+  for (const PoseTrack& track : pose_tracks_) {
+    if (IsSameFrame(track.frame, frame)) {
+      return &track;
+    }
+  }
+  return nullptr;
+}
+
+void SessionPlayer::Deliver(const SessionReader::Record& record) {
+  // Set first, so the callbacks querying the latest pose see this record.
+  current_timestamp_.store(record.timestamp);
+  switch (record.type) {
+    case session_log::kPoseRecord:
+      if (on_pose_available_ != nullptr) {
+        on_pose_available_(pose_context_, &record.pose);
+      }
+      break;
+    case session_log::kPointCloudRecord:
+      if (on_xyz_ij_available_ != nullptr) {
+        TangoXYZij xyz_ij;
+        memset(&xyz_ij, 0, sizeof(xyz_ij));
+        xyz_ij.version = 0;
+        xyz_ij.timestamp = record.timestamp;
+        xyz_ij.xyz_count = static_cast<uint32_t>(record.points.size() / 3);
+        // The callbacks only read the points, like those of the service.
+        xyz_ij.xyz = reinterpret_cast<float(*)[3]>(
+            const_cast<float*>(record.points.data()));
+        on_xyz_ij_available_(xyz_ij_context_, &xyz_ij);
+      }
+      break;
+    case session_log::kImageRecord:
+      if (on_frame_available_ != nullptr) {
+        on_frame_available_(frame_context_, TANGO_CAMERA_COLOR,
+                            &record.image);
+      }
+      break;
+    case session_log::kTrajectoryRecord:
+      // Recorded by the app rather than delivered by the service.
+      break;
+  }
+}
+
+void SessionPlayer::PlayLoop(PlaybackMode mode) {
+  SessionReader::Record record;
+  bool has_start = false;
+  double start_timestamp = 0.0;
+  std::chrono::steady_clock::time_point start_time;
+  while (!stop_requested_.load() && reader_.Read(&record)) {
+    if (mode == kRecordedRate) {
+      if (!has_start) {
+        has_start = true;
+        start_timestamp = record.timestamp;
+        start_time = std::chrono::steady_clock::now();
+      }
+      const std::chrono::duration<double> offset(record.timestamp -
+                                                 start_timestamp);
+      std::this_thread::sleep_until(
+          start_time +
+          std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+              offset));
+    }
+    Deliver(record);
+  }
+  is_playing_.store(false);
+}
+
+TangoErrorType SessionPlayer::GetInstalledPoseAtTime(
+    double timestamp, TangoCoordinateFramePair frame, TangoPoseData* pose) {
+  const SessionPlayer* player = installed_player.load();
+  if (player == nullptr) {
+    return TangoService_getPoseAtTime(timestamp, frame, pose);
+  }
+  return player->GetPoseAtTime(timestamp, frame, pose);
+}
+}  // namespace tango_util
@@ -0,0 +1,440 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/session_recorder.h"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include <tango-gl/util.h>
+
+#include "tango-util/thread_policy.h"
+
+namespace {
+// Payload size from which a chunk is written, and age after which it is
+// written anyway, so a crash loses little.
+const size_t kTargetChunkSize = 64 * 1024;
+const std::chrono::seconds kMaxChunkAge(1);
+
+// Time the writer sleeps when there is nothing to write, unless woken up by a
+// callback.
+const std::chrono::milliseconds kWriterInterval(10);
+
+// Layout of a point cloud slot: the timestamp and point count, then the
+// points as floats.
+struct PointCloudSlot {
+  double timestamp;
+  uint32_t point_count;
+  uint32_t reserved;
+};
+
+// Layout of an image slot: the image buffer, whose data pointer is unused,
+// then its data.
+struct ImageSlot {
+  TangoImageBuffer buffer;
+  size_t data_size;
+};
+
+// Layout of a trajectory slot: the timestamp and data size, then the data of
+// Trajectory::Serialize().
+struct TrajectorySlot {
+  double timestamp;
+  size_t data_size;
+};
+
+void Append(const void* data, size_t size, std::vector<uint8_t>* payload) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  payload->insert(payload->end(), bytes, bytes + size);
+}
+}  // namespace
+
+namespace tango_util {
+
+SessionRecorder::Options::Options()
+    : max_point_count(60000),
+      record_images(false),
+      max_image_size(1920 * 1080 * 3 / 2),
+      point_scale(session_log::kDefaultPointScale),
+      pose_slot_count(512),
+      point_cloud_slot_count(8),
+      image_slot_count(4),
+      max_trajectory_size(128 * 1024),
+      trajectory_slot_count(2) {}
+
+SessionRecorder::SessionRecorder()
+    : is_recording_(false),
+      file_(NULL),
+      write_failed_(false),
+      pose_count_(0),
+      point_cloud_count_(0),
+      image_count_(0),
+      dropped_count_(0),
+      bytes_written_(0) {}
+
+SessionRecorder::~SessionRecorder() { Stop(); }
+
+bool SessionRecorder::Start(const char* path, const Options& options) {
+  Stop();
+  file_ = fopen(path, "wb");
+  if (file_ == NULL) {
+    LOGE("SessionRecorder: failed to create %s", path);
+    return false;
+  }
+  options_ = options;
+  write_failed_ = false;
+  pose_count_.store(0);
+  point_cloud_count_.store(0);
+  image_count_.store(0);
+  dropped_count_.store(0);
+  bytes_written_.store(0);
+
+  // Every buffer is allocated here, so neither the callbacks nor the writer
+  // allocate while recording.
+  pose_ring_.Allocate(options_.pose_slot_count, sizeof(TangoPoseData));
+  point_cloud_ring_.Allocate(
+      options_.point_cloud_slot_count,
+      sizeof(PointCloudSlot) + options_.max_point_count * 3 * sizeof(float));
+  image_ring_.Allocate(options_.record_images ? options_.image_slot_count : 0,
+                       sizeof(ImageSlot) + options_.max_image_size);
+  trajectory_ring_.Allocate(
+      options_.trajectory_slot_count,
+      sizeof(TrajectorySlot) + options_.max_trajectory_size);
+  pose_chunk_.payload.clear();
+  pose_chunk_.payload.reserve(kTargetChunkSize +
+                              sizeof(session_log::PoseRecord));
+  point_cloud_chunk_.payload.clear();
+  point_cloud_chunk_.payload.reserve(
+      kTargetChunkSize + sizeof(session_log::PointCloudRecord) +
+      options_.max_point_count * 3 * sizeof(int16_t));
+  pose_chunk_.header.record_count = 0;
+  point_cloud_chunk_.header.record_count = 0;
+
+  session_log::FileHeader header;
+  memcpy(header.magic, session_log::kFileMagic, sizeof(header.magic));
+  header.version = session_log::kVersion;
+  header.point_scale = options_.point_scale;
+  header.reserved = 0;
+  if (!Write(&header, sizeof(header))) {
+    fclose(file_);
+    file_ = NULL;
+    return false;
+  }
+
+  is_recording_.store(true);
+  writer_ = std::thread(&SessionRecorder::WriteLoop, this);
+  return true;
+}
+
+void SessionRecorder::Stop() {
+  if (!is_recording_.exchange(false)) {
+    return;
+  }
+  wake_condition_.notify_one();
+  writer_.join();
+  fclose(file_);
+  file_ = NULL;
+  LOGI(
+      "SessionRecorder: recorded %llu poses, %llu point clouds and %llu "
+      "images in %llu bytes, dropped %llu",
+      static_cast<unsigned long long>(pose_count_.load()),
+      static_cast<unsigned long long>(point_cloud_count_.load()),
+      static_cast<unsigned long long>(image_count_.load()),
+      static_cast<unsigned long long>(bytes_written_.load()),
+      static_cast<unsigned long long>(dropped_count_.load()));
+}
+
+void SessionRecorder::OnPoseAvailable(const TangoPoseData* pose) {
+  if (!is_recording_.load()) {
+    return;
+  }
+  uint8_t* slot = pose_ring_.BeginWrite();
+  if (slot == NULL) {
+    ++dropped_count_;
+    return;
+  }
+  memcpy(slot, pose, sizeof(*pose));
+  pose_ring_.EndWrite(sizeof(*pose));
+}
+
+void SessionRecorder::OnXYZijAvailable(const TangoXYZij* xyz_ij) {
+  if (!is_recording_.load()) {
+    return;
+  }
+  const size_t points_size = xyz_ij->xyz_count * 3 * sizeof(float);
+  uint8_t* slot = point_cloud_ring_.BeginWrite();
+  if (slot == NULL ||
+      sizeof(PointCloudSlot) + points_size > point_cloud_ring_.GetSlotSize()) {
+    ++dropped_count_;
+    return;
+  }
+  PointCloudSlot header;
+  header.timestamp = xyz_ij->timestamp;
+  header.point_count = xyz_ij->xyz_count;
+  header.reserved = 0;
+  memcpy(slot, &header, sizeof(header));
+  memcpy(slot + sizeof(header), xyz_ij->xyz, points_size);
+  point_cloud_ring_.EndWrite(sizeof(header) + points_size);
+  wake_condition_.notify_one();
+}
+
+void SessionRecorder::OnFrameAvailable(const TangoImageBuffer* buffer) {
+  if (!is_recording_.load() || !options_.record_images) {
+    return;
+  }
+  // The color camera delivers NV21: a full resolution luma plane followed by
+  // an interleaved half resolution chroma plane.
+  const size_t data_size = buffer->stride * buffer->height * 3 / 2;
+  uint8_t* slot = image_ring_.BeginWrite();
+  if (slot == NULL ||
+      sizeof(ImageSlot) + data_size > image_ring_.GetSlotSize()) {
+    ++dropped_count_;
+    return;
+  }
+  ImageSlot header;
+  header.buffer = *buffer;
+  header.data_size = data_size;
+  memcpy(slot, &header, sizeof(header));
+  memcpy(slot + sizeof(header), buffer->data, data_size);
+  image_ring_.EndWrite(sizeof(header) + data_size);
+  wake_condition_.notify_one();
+}
+
+void SessionRecorder::OnTrajectoryAvailable(
+    const tango_gl::Trajectory& trajectory, double timestamp) {
+  if (!is_recording_.load()) {
+    return;
+  }
+  uint8_t* slot = trajectory_ring_.BeginWrite();
+  if (slot == NULL) {
+    ++dropped_count_;
+    return;
+  }
+  // Unlike the callbacks of the service, this one is allowed to allocate.
+  std::vector<uint8_t> data;
+  trajectory.Serialize(&data);
+  if (sizeof(TrajectorySlot) + data.size() > trajectory_ring_.GetSlotSize()) {
+    ++dropped_count_;
+    return;
+  }
+  TrajectorySlot header;
+  header.timestamp = timestamp;
+  header.data_size = data.size();
+  memcpy(slot, &header, sizeof(header));
+  memcpy(slot + sizeof(header), data.data(), data.size());
+  trajectory_ring_.EndWrite(sizeof(header) + data.size());
+  wake_condition_.notify_one();
+}
+
+SessionRecorder::Stats SessionRecorder::GetStats() const {
+  Stats stats;
+  stats.pose_count = pose_count_.load();
+  stats.point_cloud_count = point_cloud_count_.load();
+  stats.image_count = image_count_.load();
+  stats.dropped_count = dropped_count_.load();
+  stats.bytes_written = bytes_written_.load();
+  return stats;
+}
+
+void SessionRecorder::WriteLoop() {
+  while (true) {
+    ThreadPolicy::Get().Enter(ThreadPolicy::kBulkStage);
+    // Check before draining, so everything recorded before Stop() is written.
+    const bool stopping = !is_recording_.load();
+    DrainRings();
+
+    const std::chrono::steady_clock::time_point now =
+        std::chrono::steady_clock::now();
+    for (ChunkBuilder* chunk : {&pose_chunk_, &point_cloud_chunk_}) {
+      if (chunk->header.record_count > 0 &&
+          (stopping || now - chunk->start_time >= kMaxChunkAge)) {
+        FlushChunk(chunk);
+      }
+    }
+    if (stopping) {
+      return;
+    }
+
+    std::unique_lock<std::mutex> lock(wake_mutex_);
+    wake_condition_.wait_for(lock, kWriterInterval);
+  }
+}
+
+void SessionRecorder::DrainRings() {
+  size_t size;
+  const uint8_t* slot;
+  while ((slot = pose_ring_.BeginRead(&size)) != NULL) {
+    TangoPoseData pose;
+    memcpy(&pose, slot, sizeof(pose));
+    pose_ring_.EndRead();
+    EncodePose(pose);
+  }
+  while ((slot = point_cloud_ring_.BeginRead(&size)) != NULL) {
+    EncodePointCloud(slot);
+    point_cloud_ring_.EndRead();
+  }
+  while ((slot = image_ring_.BeginRead(&size)) != NULL) {
+    WriteImage(slot);
+    image_ring_.EndRead();
+  }
+  while ((slot = trajectory_ring_.BeginRead(&size)) != NULL) {
+    WriteTrajectory(slot);
+    trajectory_ring_.EndRead();
+  }
+}
+
+uint32_t SessionRecorder::BeginRecord(ChunkBuilder* chunk, double timestamp) {
+  double time_offset =
+      std::round((timestamp - chunk->header.first_timestamp) *
+                 session_log::kTimeOffsetScale);
+  // Start a new chunk for timestamps its time offsets can not represent.
+  if (chunk->header.record_count > 0 &&
+      (time_offset < 0.0 ||
+       time_offset > std::numeric_limits<uint32_t>::max())) {
+    FlushChunk(chunk);
+  }
+  if (chunk->header.record_count == 0) {
+    chunk->header.first_timestamp = timestamp;
+    chunk->translation[0] = 0;
+    chunk->translation[1] = 0;
+    chunk->translation[2] = 0;
+    chunk->header.last_timestamp = timestamp;
+    chunk->start_time = std::chrono::steady_clock::now();
+    time_offset = 0.0;
+  }
+  if (timestamp > chunk->header.last_timestamp) {
+    chunk->header.last_timestamp = timestamp;
+  }
+  ++chunk->header.record_count;
+  return static_cast<uint32_t>(time_offset);
+}
+
+void SessionRecorder::EncodePose(const TangoPoseData& pose) {
+  session_log::PoseRecord record;
+  record.time_offset = BeginRecord(&pose_chunk_, pose.timestamp);
+  session_log::EncodePose(pose, pose_chunk_.translation, &record);
+  Append(&record, sizeof(record), &pose_chunk_.payload);
+  ++pose_count_;
+  if (pose_chunk_.payload.size() >= kTargetChunkSize) {
+    FlushChunk(&pose_chunk_);
+  }
+}
+
+void SessionRecorder::EncodePointCloud(const uint8_t* slot) {
+  PointCloudSlot header;
+  memcpy(&header, slot, sizeof(header));
+  session_log::PointCloudRecord record;
+  record.time_offset = BeginRecord(&point_cloud_chunk_, header.timestamp);
+  record.point_count = header.point_count;
+  Append(&record, sizeof(record), &point_cloud_chunk_.payload);
+
+  const size_t value_count = header.point_count * 3;
+  std::vector<uint8_t>& payload = point_cloud_chunk_.payload;
+  const size_t offset = payload.size();
+  payload.resize(offset + value_count * sizeof(int16_t));
+  const uint8_t* values = slot + sizeof(header);
+  for (size_t i = 0; i < value_count; ++i) {
+    float value;
+    memcpy(&value, values + i * sizeof(value), sizeof(value));
+    const int16_t quantized =
+        session_log::QuantizePoint(value, options_.point_scale);
+    memcpy(payload.data() + offset + i * sizeof(quantized), &quantized,
+           sizeof(quantized));
+  }
+  ++point_cloud_count_;
+  if (payload.size() >= kTargetChunkSize) {
+    FlushChunk(&point_cloud_chunk_);
+  }
+}
+
+void SessionRecorder::WriteImage(const uint8_t* slot) {
+  ImageSlot image;
+  memcpy(&image, slot, sizeof(image));
+  session_log::ImageRecord record;
+  record.time_offset = 0;
+  record.width = image.buffer.width;
+  record.height = image.buffer.height;
+  record.stride = image.buffer.stride;
+  record.format = image.buffer.format;
+  record.data_size = image.data_size;
+  record.frame_number = image.buffer.frame_number;
+
+  // Images are written straight from their slot, one per chunk.
+  session_log::ChunkHeader header;
+  memcpy(header.magic, session_log::kChunkMagic, sizeof(header.magic));
+  header.type = session_log::kImageRecord;
+  header.record_count = 1;
+  header.payload_size = sizeof(record) + image.data_size;
+  header.first_timestamp = image.buffer.timestamp;
+  header.last_timestamp = image.buffer.timestamp;
+  if (Write(&header, sizeof(header)) && Write(&record, sizeof(record)) &&
+      Write(slot + sizeof(image), image.data_size)) {
+    fflush(file_);
+  }
+  ++image_count_;
+}
+
+void SessionRecorder::WriteTrajectory(const uint8_t* slot) {
+  TrajectorySlot trajectory;
+  memcpy(&trajectory, slot, sizeof(trajectory));
+  session_log::TrajectoryRecord record;
+  record.time_offset = 0;
+  record.data_size = trajectory.data_size;
+
+  // Like images, one per chunk straight from the slot.
+  session_log::ChunkHeader header;
+  memcpy(header.magic, session_log::kChunkMagic, sizeof(header.magic));
+  header.type = session_log::kTrajectoryRecord;
+  header.record_count = 1;
+  header.payload_size = sizeof(record) + trajectory.data_size;
+  header.first_timestamp = trajectory.timestamp;
+  header.last_timestamp = trajectory.timestamp;
+  if (Write(&header, sizeof(header)) && Write(&record, sizeof(record)) &&
+      Write(slot + sizeof(trajectory), trajectory.data_size)) {
+    fflush(file_);
+  }
+}
+
+void SessionRecorder::FlushChunk(ChunkBuilder* chunk) {
+  if (chunk->header.record_count == 0) {
+    return;
+  }
+  memcpy(chunk->header.magic, session_log::kChunkMagic,
+         sizeof(chunk->header.magic));
+  chunk->header.type = chunk == &pose_chunk_ ? session_log::kPoseRecord
+                                             : session_log::kPointCloudRecord;
+  chunk->header.payload_size = chunk->payload.size();
+  // Flushed chunk by chunk, so a log cut short only loses its last chunk.
+  if (Write(&chunk->header, sizeof(chunk->header)) &&
+      Write(chunk->payload.data(), chunk->payload.size())) {
+    fflush(file_);
+  }
+  chunk->header.record_count = 0;
+  chunk->payload.clear();
+}
+
+bool SessionRecorder::Write(const void* data, size_t size) {
+  if (fwrite(data, 1, size, file_) != size) {
+    if (!write_failed_) {
+      LOGE("SessionRecorder: failed to write the session log");
+      write_failed_ = true;
+    }
+    return false;
+  }
+  bytes_written_ += size;
+  return true;
+}
+}  // namespace tango_util
@@ -0,0 +1,249 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/shared_sensor_publisher.h"
+
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <linux/ashmem.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+#include <tango-gl/util.h>
+
+namespace {
+// The name of the memory, shown in /proc/<pid>/maps.
+const char kMemoryName[] = "tango_shared_sensors";
+
+// The ASharedMemory functions of android/sharedmem.h, of Android 8.0.
+typedef int (*CreateFunction)(const char* name, size_t size);
+typedef int (*SetProtFunction)(int fd, int prot);
+
+struct SharedMemoryApi {
+  CreateFunction create;
+  SetProtFunction set_prot;
+};
+
+SharedMemoryApi* LoadSharedMemoryApi() {
+  SharedMemoryApi* api = new SharedMemoryApi();
+  void* library = dlopen("libandroid.so", RTLD_NOW | RTLD_LOCAL);
+  if (library == nullptr) {
+    return api;
+  }
+  api->create = reinterpret_cast<CreateFunction>(
+      dlsym(library, "ASharedMemory_create"));
+  api->set_prot = reinterpret_cast<SetProtFunction>(
+      dlsym(library, "ASharedMemory_setProt"));
+  return api;
+}
+
+const SharedMemoryApi& GetSharedMemoryApi() {
+  static SharedMemoryApi* api = LoadSharedMemoryApi();
+  return *api;
+}
+
+// @return: |size| rounded up to a multiple of |alignment|.
+size_t AlignUp(size_t size, size_t alignment) {
+  return (size + alignment - 1) / alignment * alignment;
+}
+}  // namespace
+
+namespace tango_util {
+
+using shared_sensor_memory::Header;
+using shared_sensor_memory::PointCloudSlot;
+using shared_sensor_memory::PoseSlot;
+
+SharedSensorPublisher::Options::Options()
+    : max_point_count(60000), pose_slot_count(256), point_cloud_slot_count(4) {}
+
+SharedSensorPublisher::SharedSensorPublisher()
+    : fd_(-1),
+      size_(0),
+      memory_(nullptr),
+      header_(nullptr),
+      pose_index_(0),
+      point_cloud_index_(0) {}
+
+SharedSensorPublisher::~SharedSensorPublisher() { Stop(); }
+
+bool SharedSensorPublisher::Start(const Options& options) {
+  Stop();
+  if (options.max_point_count <= 0 || options.pose_slot_count <= 0 ||
+      options.point_cloud_slot_count <= 0) {
+    LOGE("SharedSensorPublisher: invalid options");
+    return false;
+  }
+  const size_t pose_offset = AlignUp(sizeof(Header), sizeof(double));
+  const size_t point_cloud_offset =
+      pose_offset + options.pose_slot_count * sizeof(PoseSlot);
+  const size_t point_cloud_slot_size =
+      AlignUp(sizeof(PointCloudSlot) +
+                  options.max_point_count * 3 * sizeof(float),
+              sizeof(double));
+  const size_t size =
+      AlignUp(point_cloud_offset +
+                  options.point_cloud_slot_count * point_cloud_slot_size,
+              static_cast<size_t>(sysconf(_SC_PAGESIZE)));
+  if (size > UINT32_MAX) {
+    LOGE("SharedSensorPublisher: %zu bytes are too many", size);
+    return false;
+  }
+
+  const int fd = CreateSharedMemory(size);
+  if (fd < 0) {
+    LOGE("SharedSensorPublisher: could not create %zu bytes of shared memory",
+         size);
+    return false;
+  }
+  void* memory =
+      mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (memory == MAP_FAILED) {
+    LOGE("SharedSensorPublisher: could not map the shared memory");
+    close(fd);
+    return false;
+  }
+  // The mapping above stays writable, the ones of the readers will not be.
+  if (!ProtectSharedMemory(fd)) {
+    LOGI("SharedSensorPublisher: the shared memory is not write protected");
+  }
+
+  // The memory is zeroed, so the slots start with an even sequence and the
+  // counts at 0.
+  Header* header = new (memory) Header();
+  memcpy(header->magic, shared_sensor_memory::kMagic, sizeof(header->magic));
+  header->version = shared_sensor_memory::kVersion;
+  header->size = static_cast<uint32_t>(size);
+  header->pose_slot_count = options.pose_slot_count;
+  header->pose_offset = static_cast<uint32_t>(pose_offset);
+  header->point_cloud_slot_count = options.point_cloud_slot_count;
+  header->point_cloud_offset = static_cast<uint32_t>(point_cloud_offset);
+  header->point_cloud_slot_size = static_cast<uint32_t>(point_cloud_slot_size);
+  header->max_point_count = options.max_point_count;
+  header->reserved = 0;
+  header->pose_count.store(0, std::memory_order_relaxed);
+  header->point_cloud_count.store(0, std::memory_order_release);
+
+  std::lock_guard<tango_gl::ProfiledMutex> pose_lock(pose_mutex_);
+  std::lock_guard<tango_gl::ProfiledMutex> point_cloud_lock(point_cloud_mutex_);
+  fd_ = fd;
+  size_ = size;
+  memory_ = static_cast<uint8_t*>(memory);
+  header_ = header;
+  pose_index_ = 0;
+  point_cloud_index_ = 0;
+  LOGI("SharedSensorPublisher: publishing into %zu bytes", size);
+  return true;
+}
+
+void SharedSensorPublisher::Stop() {
+  std::lock_guard<tango_gl::ProfiledMutex> pose_lock(pose_mutex_);
+  std::lock_guard<tango_gl::ProfiledMutex> point_cloud_lock(point_cloud_mutex_);
+  if (memory_ == nullptr) {
+    return;
+  }
+  munmap(memory_, size_);
+  close(fd_);
+  fd_ = -1;
+  size_ = 0;
+  memory_ = nullptr;
+  header_ = nullptr;
+}
+
+void SharedSensorPublisher::OnPoseAvailable(const TangoPoseData* pose) {
+  std::lock_guard<tango_gl::ProfiledMutex> lock(pose_mutex_);
+  if (memory_ == nullptr) {
+    return;
+  }
+  PoseSlot* slot = reinterpret_cast<PoseSlot*>(
+                       memory_ + header_->pose_offset) +
+                   pose_index_ % header_->pose_slot_count;
+  const uint32_t sequence = slot->sequence.load(std::memory_order_relaxed);
+  slot->sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot->index = pose_index_;
+  slot->timestamp = pose->timestamp;
+  std::copy(pose->translation, pose->translation + 3, slot->translation);
+  std::copy(pose->orientation, pose->orientation + 4, slot->orientation);
+  slot->status_code = pose->status_code;
+  slot->base_frame = pose->frame.base;
+  slot->target_frame = pose->frame.target;
+  slot->reserved = 0;
+  slot->sequence.store(sequence + 2, std::memory_order_release);
+  header_->pose_count.store(++pose_index_, std::memory_order_release);
+}
+
+void SharedSensorPublisher::OnXYZijAvailable(const TangoXYZij* xyz_ij) {
+  std::lock_guard<tango_gl::ProfiledMutex> lock(point_cloud_mutex_);
+  if (memory_ == nullptr) {
+    return;
+  }
+  PointCloudSlot* slot = reinterpret_cast<PointCloudSlot*>(
+      memory_ + header_->point_cloud_offset +
+      static_cast<size_t>(point_cloud_index_ %
+                          header_->point_cloud_slot_count) *
+          header_->point_cloud_slot_size);
+  const uint32_t point_count =
+      std::min<uint32_t>(xyz_ij->xyz_count, header_->max_point_count);
+  const uint32_t sequence = slot->sequence.load(std::memory_order_relaxed);
+  slot->sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot->index = point_cloud_index_;
+  slot->timestamp = xyz_ij->timestamp;
+  slot->point_count = point_count;
+  slot->reserved = 0;
+  if (point_count > 0) {
+    memcpy(reinterpret_cast<uint8_t*>(slot) + sizeof(*slot), xyz_ij->xyz,
+           point_count * 3 * sizeof(float));
+  }
+  slot->sequence.store(sequence + 2, std::memory_order_release);
+  header_->point_cloud_count.store(++point_cloud_index_,
+                                   std::memory_order_release);
+}
+
+int SharedSensorPublisher::CreateSharedMemory(size_t size) {
+  const SharedMemoryApi& api = GetSharedMemoryApi();
+  if (api.create != nullptr) {
+    return api.create(kMemoryName, size);
+  }
+  const int fd = open("/dev/ashmem", O_RDWR | O_CLOEXEC);
+  if (fd < 0) {
+    return -1;
+  }
+  char name[ASHMEM_NAME_LEN];
+  strncpy(name, kMemoryName, sizeof(name) - 1);
+  name[sizeof(name) - 1] = '\0';
+  if (ioctl(fd, ASHMEM_SET_NAME, name) < 0 ||
+      ioctl(fd, ASHMEM_SET_SIZE, size) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+bool SharedSensorPublisher::ProtectSharedMemory(int fd) {
+  const SharedMemoryApi& api = GetSharedMemoryApi();
+  if (api.set_prot != nullptr) {
+    return api.set_prot(fd, PROT_READ) == 0;
+  }
+  return ioctl(fd, ASHMEM_SET_PROT_MASK, PROT_READ) == 0;
+}
+}  // namespace tango_util
@@ -0,0 +1,146 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/shared_sensor_reader.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cstring>
+
+namespace tango_util {
+
+using shared_sensor_memory::Header;
+using shared_sensor_memory::PointCloudSlot;
+using shared_sensor_memory::PoseSlot;
+
+SharedSensorReader::SharedSensorReader()
+    : memory_(nullptr), size_(0), header_(nullptr) {}
+
+SharedSensorReader::~SharedSensorReader() { Close(); }
+
+bool SharedSensorReader::Open(int fd) {
+  Close();
+  // The header gives the size of the whole memory.
+  void* header_memory = mmap(nullptr, sizeof(Header), PROT_READ, MAP_SHARED,
+                             fd, 0);
+  if (header_memory == MAP_FAILED) {
+    return false;
+  }
+  const Header* header = static_cast<const Header*>(header_memory);
+  const bool is_valid =
+      memcmp(header->magic, shared_sensor_memory::kMagic,
+             sizeof(header->magic)) == 0 &&
+      header->version == shared_sensor_memory::kVersion &&
+      header->pose_slot_count > 0 && header->point_cloud_slot_count > 0 &&
+      header->pose_offset + static_cast<uint64_t>(header->pose_slot_count) *
+                                sizeof(PoseSlot) <=
+          header->point_cloud_offset &&
+      header->point_cloud_slot_size >=
+          sizeof(PointCloudSlot) +
+              static_cast<uint64_t>(header->max_point_count) * 3 *
+                  sizeof(float) &&
+      header->point_cloud_offset +
+              static_cast<uint64_t>(header->point_cloud_slot_count) *
+                  header->point_cloud_slot_size <=
+          header->size;
+  const size_t size = header->size;
+  munmap(header_memory, sizeof(Header));
+  if (!is_valid) {
+    return false;
+  }
+
+  void* memory = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  if (memory == MAP_FAILED) {
+    return false;
+  }
+  memory_ = static_cast<const uint8_t*>(memory);
+  size_ = size;
+  header_ = static_cast<const Header*>(memory);
+  return true;
+}
+
+void SharedSensorReader::Close() {
+  if (memory_ == nullptr) {
+    return;
+  }
+  munmap(const_cast<uint8_t*>(memory_), size_);
+  memory_ = nullptr;
+  size_ = 0;
+  header_ = nullptr;
+}
+
+uint32_t SharedSensorReader::GetPoseCount() const {
+  return header_ == nullptr
+             ? 0
+             : header_->pose_count.load(std::memory_order_acquire);
+}
+
+uint32_t SharedSensorReader::GetPointCloudCount() const {
+  return header_ == nullptr
+             ? 0
+             : header_->point_cloud_count.load(std::memory_order_acquire);
+}
+
+bool SharedSensorReader::ReadPose(uint32_t index, TangoPoseData* pose) const {
+  // Indices are compared modulo 2^32, as the counts wrap.
+  if (header_ == nullptr || index - GetPoseCount() < UINT32_MAX / 2) {
+    return false;
+  }
+  const PoseSlot& slot =
+      reinterpret_cast<const PoseSlot*>(memory_ + header_->pose_offset)
+          [index % header_->pose_slot_count];
+  const uint32_t sequence = slot.sequence.load(std::memory_order_acquire);
+  if ((sequence & 1) != 0 || slot.index != index) {
+    return false;
+  }
+  TangoPoseData read;
+  memset(&read, 0, sizeof(read));
+  read.timestamp = slot.timestamp;
+  memcpy(read.translation, slot.translation, sizeof(read.translation));
+  memcpy(read.orientation, slot.orientation, sizeof(read.orientation));
+  read.status_code = static_cast<TangoPoseStatusType>(slot.status_code);
+  read.frame.base = static_cast<TangoCoordinateFrameType>(slot.base_frame);
+  read.frame.target =
+      static_cast<TangoCoordinateFrameType>(slot.target_frame);
+  if (!EndRead(slot, sequence)) {
+    return false;
+  }
+  *pose = read;
+  return true;
+}
+
+bool SharedSensorReader::ReadLatestPose(TangoPoseData* pose) const {
+  const uint32_t count = GetPoseCount();
+  return count > 0 && ReadPose(count - 1, pose);
+}
+
+const PointCloudSlot* SharedSensorReader::BeginPointCloudRead(
+    uint32_t index, uint32_t* sequence) const {
+  if (header_ == nullptr || index - GetPointCloudCount() < UINT32_MAX / 2) {
+    return nullptr;
+  }
+  const PointCloudSlot* slot = reinterpret_cast<const PointCloudSlot*>(
+      memory_ + header_->point_cloud_offset +
+      static_cast<size_t>(index % header_->point_cloud_slot_count) *
+          header_->point_cloud_slot_size);
+  *sequence = slot->sequence.load(std::memory_order_acquire);
+  if ((*sequence & 1) != 0 || slot->index != index) {
+    return nullptr;
+  }
+  return slot;
+}
+}  // namespace tango_util
@@ -0,0 +1,63 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/slot_ring.h"
+
+namespace tango_util {
+
+SlotRing::SlotRing()
+    : slot_size_(0), slot_count_(0), write_count_(0), read_count_(0) {}
+
+void SlotRing::Allocate(int slot_count, size_t slot_size) {
+  slot_count_ = slot_count;
+  slot_size_ = slot_size;
+  data_.assign(slot_count_ * slot_size_, 0);
+  sizes_.assign(slot_count_, 0);
+  write_count_.store(0);
+  read_count_.store(0);
+}
+
+uint8_t* SlotRing::BeginWrite() {
+  const size_t write_count = write_count_.load(std::memory_order_relaxed);
+  if (slot_count_ == 0 ||
+      write_count - read_count_.load(std::memory_order_acquire) >=
+          slot_count_) {
+    return NULL;
+  }
+  return data_.data() + (write_count % slot_count_) * slot_size_;
+}
+
+void SlotRing::EndWrite(size_t size) {
+  const size_t write_count = write_count_.load(std::memory_order_relaxed);
+  sizes_[write_count % slot_count_] = size;
+  write_count_.store(write_count + 1, std::memory_order_release);
+}
+
+const uint8_t* SlotRing::BeginRead(size_t* size) {
+  const size_t read_count = read_count_.load(std::memory_order_relaxed);
+  if (read_count == write_count_.load(std::memory_order_acquire)) {
+    return NULL;
+  }
+  *size = sizes_[read_count % slot_count_];
+  return data_.data() + (read_count % slot_count_) * slot_size_;
+}
+
+void SlotRing::EndRead() {
+  read_count_.store(read_count_.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_release);
+}
+
+}  // namespace tango_util
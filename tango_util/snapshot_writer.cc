@@ -0,0 +1,183 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/snapshot_writer.h"
+
+#include <png.h>
+
+#include <cstdio>
+#include <cstring>
+
+#include <tango-gl/util.h>
+
+#include "tango-util/thread_policy.h"
+
+namespace {
+// Time the writer sleeps when there is nothing to write, unless woken up by
+// Write().
+const std::chrono::milliseconds kWriterInterval(20);
+
+// Layout of a frame slot: its size and timestamp, then the RGBA pixels.
+struct FrameSlot {
+  double timestamp;
+  int32_t width;
+  int32_t height;
+};
+}  // namespace
+
+namespace tango_util {
+
+SnapshotWriter::Options::Options() : slot_count(3), compression_level(1) {}
+
+SnapshotWriter::SnapshotWriter() {
+  is_running_ = false;
+  written_count_ = 0;
+  dropped_count_ = 0;
+}
+
+SnapshotWriter::~SnapshotWriter() { Stop(); }
+
+bool SnapshotWriter::Start(const char* directory, size_t max_frame_size,
+                           const Options& options) {
+  Stop();
+  directory_ = directory;
+  options_ = options;
+  written_count_.store(0);
+  dropped_count_.store(0);
+  ring_.Allocate(options_.slot_count, sizeof(FrameSlot) + max_frame_size);
+  is_running_ = true;
+  writer_ = std::thread(&SnapshotWriter::WriteLoop, this);
+  return true;
+}
+
+void SnapshotWriter::Stop() {
+  if (!is_running_.exchange(false)) {
+    return;
+  }
+  wake_condition_.notify_one();
+  writer_.join();
+  LOGI("SnapshotWriter: wrote %llu snapshots, dropped %llu",
+       static_cast<unsigned long long>(written_count_.load()),  // NOLINT
+       static_cast<unsigned long long>(dropped_count_.load()));  // NOLINT
+}
+
+bool SnapshotWriter::Write(const uint8_t* rgba, int width, int height,
+                           double timestamp) {
+  if (!is_running_.load()) {
+    return false;
+  }
+  const size_t pixels_size = static_cast<size_t>(width) * height * 4;
+  uint8_t* slot = ring_.BeginWrite();
+  if (slot == NULL || sizeof(FrameSlot) + pixels_size > ring_.GetSlotSize()) {
+    ++dropped_count_;
+    return false;
+  }
+  FrameSlot header;
+  header.timestamp = timestamp;
+  header.width = width;
+  header.height = height;
+  memcpy(slot, &header, sizeof(header));
+  memcpy(slot + sizeof(header), rgba, pixels_size);
+  ring_.EndWrite(sizeof(header) + pixels_size);
+  wake_condition_.notify_one();
+  return true;
+}
+
+SnapshotWriter::Stats SnapshotWriter::GetStats() const {
+  Stats stats;
+  stats.written_count = written_count_.load();
+  stats.dropped_count = dropped_count_.load();
+  return stats;
+}
+
+void SnapshotWriter::WriteLoop() {
+  while (true) {
+    ThreadPolicy::Get().Enter(ThreadPolicy::kBulkStage);
+    // Check before draining, so every frame written before Stop() is encoded.
+    const bool stopping = !is_running_.load();
+    DrainRing();
+    if (stopping) {
+      return;
+    }
+    std::unique_lock<std::mutex> lock(wake_mutex_);
+    wake_condition_.wait_for(lock, kWriterInterval);
+  }
+}
+
+void SnapshotWriter::DrainRing() {
+  size_t size;
+  const uint8_t* slot;
+  while ((slot = ring_.BeginRead(&size)) != NULL) {
+    if (WritePng(slot)) {
+      ++written_count_;
+    } else {
+      ++dropped_count_;
+    }
+    ring_.EndRead();
+  }
+}
+
+bool SnapshotWriter::WritePng(const uint8_t* slot) {
+  FrameSlot header;
+  memcpy(&header, slot, sizeof(header));
+  // The rows are bottom-up, PNG is top-down.
+  const size_t row_size = static_cast<size_t>(header.width) * 4;
+  uint8_t* pixels = const_cast<uint8_t*>(slot) + sizeof(header);
+  row_pointers_.resize(header.height);
+  for (int y = 0; y < header.height; ++y) {
+    row_pointers_[y] = pixels + (header.height - 1 - y) * row_size;
+  }
+
+  char path[512];
+  snprintf(path, sizeof(path), "%s/snapshot_%.3f.png", directory_.c_str(),
+           header.timestamp);
+  FILE* file = fopen(path, "wb");
+  if (file == NULL) {
+    LOGE("SnapshotWriter: failed to create %s", path);
+    return false;
+  }
+  png_structp png_ptr =
+      png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+  png_infop info_ptr = png_create_info_struct(png_ptr);
+  // libpng reports encoding errors by jumping back here.
+  if (setjmp(png_jmpbuf(png_ptr))) {
+    LOGE("SnapshotWriter: failed to write %s", path);
+    png_destroy_write_struct(&png_ptr, &info_ptr);
+    fclose(file);
+    return false;
+  }
+
+  png_init_io(png_ptr, file);
+  // The alpha of the framebuffer is not meaningful, it is stripped. The
+  // filter of the previous pixel suits camera images, and is much cheaper to
+  // pick than the adaptive default.
+  png_set_IHDR(png_ptr, info_ptr, header.width, header.height, 8,
+               PNG_COLOR_TYPE_RGB, PNG_INTERLACE_NONE,
+               PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+  png_set_filter(png_ptr, PNG_FILTER_TYPE_BASE, PNG_FILTER_SUB);
+  png_set_compression_level(png_ptr, options_.compression_level);
+  png_write_info(png_ptr, info_ptr);
+  png_set_filler(png_ptr, 0, PNG_FILLER_AFTER);
+  png_write_image(png_ptr, row_pointers_.data());
+  png_write_end(png_ptr, NULL);
+  png_destroy_write_struct(&png_ptr, &info_ptr);
+  if (fclose(file) != 0) {
+    LOGE("SnapshotWriter: failed to write %s", path);
+    return false;
+  }
+  return true;
+}
+}  // namespace tango_util
@@ -0,0 +1,73 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/startup_timer.h"
+
+#include <tango-gl/util.h>
+
+namespace tango_util {
+
+StartupTimer::StartupTimer() : is_running_(false) {}
+
+void StartupTimer::Begin() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  is_running_ = true;
+  begin_time_ = std::chrono::steady_clock::now();
+  phases_.clear();
+}
+
+void StartupTimer::MarkPhase(const char* phase) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  MarkPhaseLocked(phase);
+}
+
+void StartupTimer::Finish(const char* phase) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!is_running_) {
+    return;
+  }
+  MarkPhaseLocked(phase);
+  is_running_ = false;
+
+  LOGI("Startup: %.1f ms to %s", phases_.back().end_ms, phase);
+  for (const Phase& recorded : phases_) {
+    LOGI("  %s at %.1f ms", recorded.name, recorded.end_ms);
+  }
+}
+
+bool StartupTimer::IsRunning() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return is_running_;
+}
+
+std::vector<StartupTimer::Phase> StartupTimer::GetPhases() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return phases_;
+}
+
+void StartupTimer::MarkPhaseLocked(const char* phase) {
+  if (!is_running_) {
+    return;
+  }
+  const std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - begin_time_;
+  Phase recorded;
+  recorded.name = phase;
+  recorded.end_ms = elapsed.count();
+  phases_.push_back(recorded);
+}
+
+}  // namespace tango_util
@@ -0,0 +1,777 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/tag_detector.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <tango-gl/tracing.h>
+
+#include "tango-util/convex_hull.h"
+
+namespace {
+// Edge length of the tiles whose extremes the threshold is taken from, in
+// pixels.
+const int kTileSize = 4;
+
+// Tile rows of a band of the thresholding of a full search.
+const int kBandTileRows = 8;
+
+// Smallest part of the area of the hull of a component its quad covers.
+const float kMinQuadFill = 0.9f;
+
+// Smallest ratio of the shortest side of a quad to its longest.
+const float kMinSideRatio = 0.2f;
+
+// Part of each end of a side left out of its line fit, where the pixels
+// round the corner.
+const float kSideEndMargin = 0.15f;
+
+// Border cells of the black square allowed to read white, in 1 / n of the
+// cells.
+const int kBorderErrorDivisor = 8;
+
+const uint64_t kTag16h5Codes[] = {
+    0x231b, 0x2ea5, 0x346a, 0x45b9, 0x79a6, 0x7f6b, 0xb358, 0xe745,
+    0xfe59, 0x156d, 0x380b, 0xf0ab, 0x0d84, 0x4736, 0x8c72, 0xaf10,
+    0x093c, 0x93b4, 0xa503, 0x468f, 0xe137, 0x5795, 0xdf42, 0x1c1d,
+    0xe9dc, 0x73ad, 0xad5f, 0xd530, 0x07ca, 0xaf2e};
+
+float Cross(const glm::vec2& a, const glm::vec2& b) {
+  return a.x * b.y - a.y * b.x;
+}
+
+// @return: the area of a polygon, positive for the vertices of a
+//          counterclockwise hull.
+float GetArea(const std::vector<glm::vec2>& polygon) {
+  float area = 0.0f;
+  for (size_t i = 0; i < polygon.size(); ++i) {
+    area += Cross(polygon[i], polygon[(i + 1) % polygon.size()]);
+  }
+  return 0.5f * area;
+}
+
+// Solve for the homography taking each of |from| to the matching |to|, as
+// the 8 unknowns of the last row being normalized.
+//
+// @return: false if 3 of the points are collinear.
+bool ComputeHomography(const glm::dvec2 from[4], const glm::dvec2 to[4],
+                       glm::dmat3* to_H_from) {
+  double a[8][9];
+  for (int i = 0; i < 4; ++i) {
+    const double x = from[i].x;
+    const double y = from[i].y;
+    const double u = to[i].x;
+    const double v = to[i].y;
+    const double rows[2][9] = {{x, y, 1.0, 0.0, 0.0, 0.0, -u * x, -u * y, u},
+                               {0.0, 0.0, 0.0, x, y, 1.0, -v * x, -v * y, v}};
+    std::copy(rows[0], rows[0] + 9, a[2 * i]);
+    std::copy(rows[1], rows[1] + 9, a[2 * i + 1]);
+  }
+  // Gaussian elimination with partial pivoting.
+  for (int column = 0; column < 8; ++column) {
+    int pivot = column;
+    for (int row = column + 1; row < 8; ++row) {
+      if (std::abs(a[row][column]) > std::abs(a[pivot][column])) {
+        pivot = row;
+      }
+    }
+    if (std::abs(a[pivot][column]) < 1e-12) {
+      return false;
+    }
+    std::swap(a[pivot], a[column]);
+    for (int row = 0; row < 8; ++row) {
+      if (row == column) {
+        continue;
+      }
+      const double factor = a[row][column] / a[column][column];
+      for (int k = column; k < 9; ++k) {
+        a[row][k] -= factor * a[column][k];
+      }
+    }
+  }
+  double h[9];
+  for (int i = 0; i < 8; ++i) {
+    h[i] = a[i][8] / a[i][i];
+  }
+  h[8] = 1.0;
+  // glm matrices are column major.
+  *to_H_from = glm::dmat3(h[0], h[3], h[6], h[1], h[4], h[7], h[2], h[5],
+                          h[8]);
+  return true;
+}
+
+glm::dvec2 ApplyHomography(const glm::dmat3& H, const glm::dvec2& point) {
+  const glm::dvec3 mapped = H * glm::dvec3(point, 1.0);
+  return glm::dvec2(mapped) / mapped.z;
+}
+
+// @return: the luminance of |level| at |point|, pixel centers being at
+//          + 0.5, or -1 if it is not inside.
+float Sample(const tango_util::ImagePyramidLevel& level,
+             const glm::dvec2& point) {
+  const float x = static_cast<float>(point.x) - 0.5f;
+  const float y = static_cast<float>(point.y) - 0.5f;
+  const int x0 = static_cast<int>(std::floor(x));
+  const int y0 = static_cast<int>(std::floor(y));
+  if (x0 < 0 || y0 < 0 || x0 + 1 >= level.width || y0 + 1 >= level.height) {
+    return -1.0f;
+  }
+  const float fx = x - x0;
+  const float fy = y - y0;
+  const uint8_t* row = level.data + y0 * level.stride + x0;
+  const float top = row[0] + fx * (row[1] - row[0]);
+  const float bottom =
+      row[level.stride] + fx * (row[level.stride + 1] - row[level.stride]);
+  return top + fy * (bottom - top);
+}
+
+int32_t FindRoot(int32_t index, std::vector<int32_t>* parents) {
+  int32_t* p = parents->data();
+  while (p[index] != index) {
+    // Path halving.
+    p[index] = p[p[index]];
+    index = p[index];
+  }
+  return index;
+}
+
+void Union(int32_t a, int32_t b, std::vector<int32_t>* parents) {
+  a = FindRoot(a, parents);
+  b = FindRoot(b, parents);
+  if (a != b) {
+    // The root is the first pixel in raster order, which keeps the trees
+    // shallow for components found row by row.
+    (*parents)[std::max(a, b)] = std::min(a, b);
+  }
+}
+
+// Classes of the pixels of a thresholded region.
+const uint8_t kLight = 0;
+const uint8_t kDark = 1;
+const uint8_t kUnknown = 2;
+
+// @return: whether the pixel at |pixel|, in rows of |width|, has a light
+//          4-neighbor.
+bool IsBoundary(const uint8_t* pixel, int width) {
+  return pixel[-1] == kLight || pixel[1] == kLight || pixel[-width] == kLight ||
+         pixel[width] == kLight;
+}
+
+// Run f(begin, end) over [0, count) as bands of |band| on |pool|, or at once
+// without one.
+template <typename Function>
+void ForBands(tango_util::WorkerPool* pool, int count, int band,
+              const Function& f) {
+  if (pool == nullptr || count <= band) {
+    f(0, count);
+    return;
+  }
+  const int band_count = (count + band - 1) / band;
+  pool->ParallelFor(band_count, [&](size_t i) {
+    const int begin = static_cast<int>(i) * band;
+    f(begin, std::min(begin + band, count));
+  });
+}
+}  // namespace
+
+namespace tango_util {
+
+TagFamily TagFamily::Tag16h5() {
+  TagFamily family;
+  family.bits_per_side = 4;
+  family.codes.assign(
+      kTag16h5Codes,
+      kTag16h5Codes + sizeof(kTag16h5Codes) / sizeof(kTag16h5Codes[0]));
+  // Half of the distance less one, so that no code read is within reach of
+  // two tags.
+  family.max_corrected_bits = 1;
+  return family;
+}
+
+TagDetector::Options::Options()
+    : tag_size(0.1f),
+      full_search_interval(5),
+      region_margin(0.5f),
+      min_tag_pixels(16),
+      min_contrast(20),
+      thread_count(2) {}
+
+TagDetector::TagDetector(const TagFamily& family, const Options& options)
+    : family_(family),
+      options_(options),
+      worker_pool_(options.thread_count),
+      scratches_(worker_pool_.GetThreadCount()),
+      fx_(0.0f),
+      fy_(0.0f),
+      cx_(0.0f),
+      cy_(0.0f),
+      frames_to_full_search_(0),
+      was_full_search_(false) {
+  family_.bits_per_side = std::min(std::max(family_.bits_per_side, 1), 8);
+  options_.full_search_interval = std::max(options_.full_search_interval, 1);
+  options_.min_tag_pixels =
+      std::max(options_.min_tag_pixels, family_.bits_per_side + 4);
+}
+
+void TagDetector::Segment(const ImagePyramidLevel& level, const Region& region,
+                          WorkerPool* pool, Scratch* scratch) {
+  const int width = region.x1 - region.x0;
+  const int height = region.y1 - region.y0;
+  const int tiles_x = (width + kTileSize - 1) / kTileSize;
+  const int tiles_y = (height + kTileSize - 1) / kTileSize;
+  const size_t pixel_count = static_cast<size_t>(width) * height;
+  scratch->tile_extremes.resize(2 * tiles_x * tiles_y);
+  scratch->classes.resize(pixel_count);
+  scratch->components.clear();
+  scratch->boundary.clear();
+
+  // The extremes of each tile, then the threshold of each pixel halfway
+  // between the extremes of the 3x3 tiles around its own.
+  uint8_t* extremes = scratch->tile_extremes.data();
+  ForBands(pool, tiles_y, kBandTileRows, [&](int begin, int end) {
+    for (int ty = begin; ty < end; ++ty) {
+      const int y_end = std::min((ty + 1) * kTileSize, height);
+      for (int tx = 0; tx < tiles_x; ++tx) {
+        const int x_end = std::min((tx + 1) * kTileSize, width);
+        uint8_t darkest = 255;
+        uint8_t lightest = 0;
+        for (int y = ty * kTileSize; y < y_end; ++y) {
+          const uint8_t* row =
+              level.data + (region.y0 + y) * level.stride + region.x0;
+          for (int x = tx * kTileSize; x < x_end; ++x) {
+            darkest = std::min(darkest, row[x]);
+            lightest = std::max(lightest, row[x]);
+          }
+        }
+        extremes[2 * (ty * tiles_x + tx)] = darkest;
+        extremes[2 * (ty * tiles_x + tx) + 1] = lightest;
+      }
+    }
+  });
+  uint8_t* classes = scratch->classes.data();
+  const int min_contrast = options_.min_contrast;
+  ForBands(pool, tiles_y, kBandTileRows, [&](int begin, int end) {
+    for (int ty = begin; ty < end; ++ty) {
+      const int y_end = std::min((ty + 1) * kTileSize, height);
+      for (int tx = 0; tx < tiles_x; ++tx) {
+        const int x_end = std::min((tx + 1) * kTileSize, width);
+        int darkest = 255;
+        int lightest = 0;
+        for (int ny = std::max(ty - 1, 0); ny <= std::min(ty + 1, tiles_y - 1);
+             ++ny) {
+          for (int nx = std::max(tx - 1, 0);
+               nx <= std::min(tx + 1, tiles_x - 1); ++nx) {
+            darkest = std::min<int>(darkest, extremes[2 * (ny * tiles_x + nx)]);
+            lightest =
+                std::max<int>(lightest, extremes[2 * (ny * tiles_x + nx) + 1]);
+          }
+        }
+        // A tile without contrast is none of a tag's edges, whether it is
+        // inside its black or its white.
+        const bool is_unknown = lightest - darkest < min_contrast;
+        const int threshold = darkest + (lightest - darkest) / 2;
+        for (int y = ty * kTileSize; y < y_end; ++y) {
+          const uint8_t* row =
+              level.data + (region.y0 + y) * level.stride + region.x0;
+          uint8_t* class_row = classes + y * width;
+          for (int x = tx * kTileSize; x < x_end; ++x) {
+            class_row[x] =
+                is_unknown ? kUnknown : (row[x] <= threshold ? kDark : kLight);
+          }
+        }
+      }
+    }
+  });
+
+  // The 4-connected components of the dark pixels.
+  scratch->parents.resize(pixel_count);
+  std::vector<int32_t>& parents = scratch->parents;
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      const int32_t i = y * width + x;
+      if (classes[i] != kDark) {
+        continue;
+      }
+      parents[i] = i;
+      if (x > 0 && classes[i - 1] == kDark) {
+        Union(i, i - 1, &parents);
+      }
+      if (y > 0 && classes[i - width] == kDark) {
+        Union(i, i - width, &parents);
+      }
+    }
+  }
+  scratch->component_ids.assign(pixel_count, -1);
+  std::vector<int32_t>& component_ids = scratch->component_ids;
+  std::vector<Component>& components = scratch->components;
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      const int32_t i = y * width + x;
+      if (classes[i] != kDark) {
+        continue;
+      }
+      const int32_t root = FindRoot(i, &parents);
+      if (component_ids[root] < 0) {
+        component_ids[root] = static_cast<int32_t>(components.size());
+        Component component;
+        component.min_x = component.max_x = x;
+        component.min_y = component.max_y = y;
+        component.touches_region_edge = false;
+        component.boundary_begin = 0;
+        component.boundary_count = 0;
+        components.push_back(component);
+      }
+      Component& component = components[component_ids[root]];
+      component.min_x = std::min(component.min_x, x);
+      component.max_x = std::max(component.max_x, x);
+      component.min_y = std::min(component.min_y, y);
+      component.max_y = std::max(component.max_y, y);
+      if (x == 0 || y == 0 || x == width - 1 || y == height - 1) {
+        component.touches_region_edge = true;
+      } else if (IsBoundary(classes + i, width)) {
+        ++component.boundary_count;
+      }
+    }
+  }
+
+  // The boundary pixels of the components that may be a whole tag, grouped
+  // by component.
+  int32_t boundary_size = 0;
+  for (Component& component : components) {
+    if (component.touches_region_edge ||
+        component.max_x - component.min_x + 1 < options_.min_tag_pixels ||
+        component.max_y - component.min_y + 1 < options_.min_tag_pixels) {
+      component.boundary_begin = -1;
+      continue;
+    }
+    component.boundary_begin = boundary_size;
+    boundary_size += component.boundary_count;
+    component.boundary_count = 0;
+  }
+  if (boundary_size == 0) {
+    return;
+  }
+  scratch->boundary.resize(boundary_size);
+  for (int y = 1; y < height - 1; ++y) {
+    for (int x = 1; x < width - 1; ++x) {
+      const int32_t i = y * width + x;
+      if (classes[i] != kDark || !IsBoundary(classes + i, width)) {
+        continue;
+      }
+      Component& component =
+          components[component_ids[FindRoot(i, &parents)]];
+      if (component.boundary_begin < 0) {
+        continue;
+      }
+      scratch->boundary[component.boundary_begin + component.boundary_count++] =
+          glm::vec2(region.x0 + x + 0.5f, region.y0 + y + 0.5f);
+    }
+  }
+}
+
+bool TagDetector::Decode(const ImagePyramidLevel& level,
+                         const glm::vec2* boundary, size_t boundary_count,
+                         std::vector<glm::vec2>* hull,
+                         TagDetection* detection) const {
+  // The quad of the component is its hull simplified to 4 vertices, when
+  // they keep most of its area.
+  hull->assign(boundary, boundary + boundary_count);
+  ComputeConvexHull(hull);
+  if (hull->size() < 4) {
+    return false;
+  }
+  const float hull_area = GetArea(*hull);
+  SimplifyConvexHull(4, hull);
+  if (hull->size() != 4 || GetArea(*hull) < kMinQuadFill * hull_area) {
+    return false;
+  }
+  glm::vec2 quad[4];
+  float shortest_side = 0.0f;
+  float longest_side = 0.0f;
+  for (int i = 0; i < 4; ++i) {
+    quad[i] = (*hull)[i];
+    const float side = glm::length((*hull)[(i + 1) % 4] - (*hull)[i]);
+    shortest_side = i == 0 ? side : std::min(shortest_side, side);
+    longest_side = std::max(longest_side, side);
+  }
+  if (shortest_side < 0.5f * options_.min_tag_pixels ||
+      shortest_side < kMinSideRatio * longest_side) {
+    return false;
+  }
+
+  // Each side is refined to the line through the boundary pixels along it,
+  // away from its ends and from the data cells, moved out by half a pixel
+  // to the edge between the pixels. The corners are where the lines meet.
+  const int cells = family_.bits_per_side + 2;
+  const glm::vec2 center = 0.25f * (quad[0] + quad[1] + quad[2] + quad[3]);
+  glm::vec2 line_points[4];
+  glm::vec2 line_directions[4];
+  for (int side = 0; side < 4; ++side) {
+    const glm::vec2 start = quad[side];
+    const glm::vec2 edge = quad[(side + 1) % 4] - start;
+    const float length = glm::length(edge);
+    const glm::vec2 direction = edge / length;
+    const float tolerance = std::max(1.0f, 0.5f * length / cells);
+    glm::vec2 sum(0.0f);
+    float sum_xx = 0.0f;
+    float sum_xy = 0.0f;
+    float sum_yy = 0.0f;
+    int count = 0;
+    for (size_t i = 0; i < boundary_count; ++i) {
+      const glm::vec2 offset = boundary[i] - start;
+      const float t = glm::dot(offset, direction) / length;
+      if (t < kSideEndMargin || t > 1.0f - kSideEndMargin ||
+          std::abs(Cross(direction, offset)) > tolerance) {
+        continue;
+      }
+      sum += offset;
+      sum_xx += offset.x * offset.x;
+      sum_xy += offset.x * offset.y;
+      sum_yy += offset.y * offset.y;
+      ++count;
+    }
+    line_points[side] = start;
+    line_directions[side] = direction;
+    if (count >= 4) {
+      const glm::vec2 mean = sum / static_cast<float>(count);
+      const float xx = sum_xx / count - mean.x * mean.x;
+      const float xy = sum_xy / count - mean.x * mean.y;
+      const float yy = sum_yy / count - mean.y * mean.y;
+      const float angle = 0.5f * std::atan2(2.0f * xy, xx - yy);
+      line_points[side] = start + mean;
+      line_directions[side] = glm::vec2(std::cos(angle), std::sin(angle));
+    }
+    glm::vec2 normal(-line_directions[side].y, line_directions[side].x);
+    if (glm::dot(normal, line_points[side] - center) < 0.0f) {
+      normal = -normal;
+    }
+    line_points[side] += 0.5f * normal;
+  }
+  const float max_corner_shift = shortest_side / cells;
+  for (int corner = 0; corner < 4; ++corner) {
+    const int a = (corner + 3) % 4;
+    const float denominator =
+        Cross(line_directions[a], line_directions[corner]);
+    if (std::abs(denominator) < 0.1f) {
+      return false;
+    }
+    const float t = Cross(line_points[corner] - line_points[a],
+                          line_directions[corner]) /
+                    denominator;
+    const glm::vec2 refined = line_points[a] + t * line_directions[a];
+    if (glm::length(refined - quad[corner]) <= max_corner_shift) {
+      quad[corner] = refined;
+    }
+  }
+
+  // The cells, and the ring of white background around the black square,
+  // sampled at their centers.
+  const glm::dvec2 unit_square[4] = {glm::dvec2(0.0, 0.0), glm::dvec2(1.0, 0.0),
+                                     glm::dvec2(1.0, 1.0),
+                                     glm::dvec2(0.0, 1.0)};
+  const glm::dvec2 quad_corners[4] = {glm::dvec2(quad[0]), glm::dvec2(quad[1]),
+                                      glm::dvec2(quad[2]), glm::dvec2(quad[3])};
+  glm::dmat3 image_H_square;
+  if (!ComputeHomography(unit_square, quad_corners, &image_H_square)) {
+    return false;
+  }
+  const int ring = cells + 2;
+  float samples[(8 + 4) * (8 + 4)];
+  float black_sum = 0.0f;
+  float white_sum = 0.0f;
+  int black_count = 0;
+  int white_count = 0;
+  for (int j = 0; j < ring; ++j) {
+    for (int i = 0; i < ring; ++i) {
+      const glm::dvec2 square_point((i - 0.5) / cells, (j - 0.5) / cells);
+      const float value =
+          Sample(level, ApplyHomography(image_H_square, square_point));
+      if (value < 0.0f) {
+        return false;
+      }
+      samples[j * ring + i] = value;
+      const int distance =
+          std::min(std::min(i, j), std::min(ring - 1 - i, ring - 1 - j));
+      if (distance == 0) {
+        white_sum += value;
+        ++white_count;
+      } else if (distance == 1) {
+        black_sum += value;
+        ++black_count;
+      }
+    }
+  }
+  const float black = black_sum / black_count;
+  const float white = white_sum / white_count;
+  if (white - black < options_.min_contrast) {
+    return false;
+  }
+  const float threshold = 0.5f * (black + white);
+  int border_errors = 0;
+  for (int j = 1; j < ring - 1; ++j) {
+    for (int i = 1; i < ring - 1; ++i) {
+      const int distance =
+          std::min(std::min(i, j), std::min(ring - 1 - i, ring - 1 - j));
+      if (distance == 1 && samples[j * ring + i] > threshold) {
+        ++border_errors;
+      }
+    }
+  }
+  if (border_errors * kBorderErrorDivisor > black_count) {
+    return false;
+  }
+
+  // The code is read in each of the 4 rotations of the tag, the top left
+  // corner of the tag being quad[rotation].
+  const int bits = family_.bits_per_side;
+  const float* data = samples + 2 * ring + 2;
+  int best_id = -1;
+  int best_corrected_bits = 0;
+  int best_rotation = 0;
+  for (int rotation = 0; rotation < 4; ++rotation) {
+    uint64_t code = 0;
+    for (int j = 0; j < bits; ++j) {
+      for (int i = 0; i < bits; ++i) {
+        // The cell of the quad the cell (i, j) of the tag is seen in.
+        int x = i;
+        int y = j;
+        switch (rotation) {
+          case 1:
+            x = bits - 1 - j;
+            y = i;
+            break;
+          case 2:
+            x = bits - 1 - i;
+            y = bits - 1 - j;
+            break;
+          case 3:
+            x = j;
+            y = bits - 1 - i;
+            break;
+        }
+        code = (code << 1) | (data[y * ring + x] > threshold ? 1 : 0);
+      }
+    }
+    int corrected_bits;
+    const int id = MatchCode(code, &corrected_bits);
+    if (id >= 0 && (best_id < 0 || corrected_bits < best_corrected_bits)) {
+      best_id = id;
+      best_corrected_bits = corrected_bits;
+      best_rotation = rotation;
+    }
+  }
+  if (best_id < 0) {
+    return false;
+  }
+  detection->id = best_id;
+  detection->corrected_bits = best_corrected_bits;
+  for (int i = 0; i < 4; ++i) {
+    detection->corners[i] = quad[(best_rotation + i) % 4];
+  }
+  Pose(detection);
+  return true;
+}
+
+int TagDetector::MatchCode(uint64_t code, int* corrected_bits) const {
+  int best_id = -1;
+  int best_distance = family_.max_corrected_bits + 1;
+  for (size_t id = 0; id < family_.codes.size(); ++id) {
+    const int distance = __builtin_popcountll(code ^ family_.codes[id]);
+    if (distance < best_distance) {
+      best_id = static_cast<int>(id);
+      best_distance = distance;
+    }
+  }
+  *corrected_bits = best_distance;
+  return best_id;
+}
+
+void TagDetector::Pose(TagDetection* detection) const {
+  // The homography from the plane of the tag to the normalized image is
+  // lambda [r1 r2 t] of the pose.
+  const double half_size = 0.5 * options_.tag_size;
+  const glm::dvec2 tag_corners[4] = {
+      glm::dvec2(-half_size, half_size), glm::dvec2(half_size, half_size),
+      glm::dvec2(half_size, -half_size), glm::dvec2(-half_size, -half_size)};
+  glm::dvec2 image_corners[4];
+  for (int i = 0; i < 4; ++i) {
+    image_corners[i] = glm::dvec2((detection->corners[i].x - cx_) / fx_,
+                                  (detection->corners[i].y - cy_) / fy_);
+  }
+  glm::dmat3 H;
+  if (!ComputeHomography(tag_corners, image_corners, &H)) {
+    detection->camera_T_tag = tango_gl::RigidTransform();
+    return;
+  }
+  // With the last element of H normalized to 1, lambda is positive: the tag
+  // is in front of the camera.
+  const double scale = 2.0 / (glm::length(H[0]) + glm::length(H[1]));
+  // The closest orthonormal pair to the first two columns, symmetric in
+  // both.
+  const glm::dvec3 a = glm::normalize(H[0]);
+  const glm::dvec3 b = glm::normalize(H[1]);
+  const glm::dvec3 sum = glm::normalize(a + b);
+  const glm::dvec3 difference = glm::normalize(a - b);
+  const double kHalfSqrt2 = 0.70710678118654752;
+  glm::dmat3 rotation;
+  rotation[0] = kHalfSqrt2 * (sum + difference);
+  rotation[1] = kHalfSqrt2 * (sum - difference);
+  rotation[2] = glm::cross(rotation[0], rotation[1]);
+  detection->camera_T_tag = tango_gl::RigidTransform(
+      glm::quat_cast(glm::mat3(rotation)), glm::vec3(scale * H[2]));
+}
+
+void TagDetector::SearchLevel(const ImagePyramidLevel& level) {
+  Region region;
+  region.x0 = 0;
+  region.y0 = 0;
+  region.x1 = level.width;
+  region.y1 = level.height;
+  Scratch* scratch = &scratches_[0];
+  Segment(level, region, &worker_pool_, scratch);
+
+  const std::vector<Component>& components = scratch->components;
+  candidate_components_.clear();
+  for (size_t i = 0; i < components.size(); ++i) {
+    if (components[i].boundary_begin >= 0) {
+      candidate_components_.push_back(static_cast<uint32_t>(i));
+    }
+  }
+  const size_t candidate_count = candidate_components_.size();
+  candidates_.resize(candidate_count);
+  is_candidate_tag_.assign(candidate_count, 0);
+  worker_pool_.ParallelForWithThread(
+      candidate_count, [&](size_t i, int thread) {
+        const Component& component = components[candidate_components_[i]];
+        is_candidate_tag_[i] =
+            Decode(level, &scratch->boundary[component.boundary_begin],
+                   component.boundary_count, &scratches_[thread].hull,
+                   &candidates_[i]);
+      });
+  for (size_t i = 0; i < candidate_count; ++i) {
+    if (is_candidate_tag_[i]) {
+      detections_.push_back(candidates_[i]);
+    }
+  }
+}
+
+void TagDetector::SearchRegions(const ImagePyramidLevel& level) {
+  // The regions are the boxes of the tags with a margin, merged where they
+  // overlap so that no tag is searched twice.
+  regions_.clear();
+  for (const TagDetection& detection : detections_) {
+    glm::vec2 low = detection.corners[0];
+    glm::vec2 high = detection.corners[0];
+    for (int i = 1; i < 4; ++i) {
+      low = glm::min(low, detection.corners[i]);
+      high = glm::max(high, detection.corners[i]);
+    }
+    const float margin =
+        options_.region_margin * std::max(high.x - low.x, high.y - low.y);
+    Region region;
+    region.x0 = std::max(static_cast<int>(low.x - margin), 0);
+    region.y0 = std::max(static_cast<int>(low.y - margin), 0);
+    region.x1 = std::min(static_cast<int>(high.x + margin) + 1, level.width);
+    region.y1 = std::min(static_cast<int>(high.y + margin) + 1, level.height);
+    if (region.x0 < region.x1 && region.y0 < region.y1) {
+      regions_.push_back(region);
+    }
+  }
+  for (bool is_merged = true; is_merged;) {
+    is_merged = false;
+    for (size_t i = 0; i < regions_.size() && !is_merged; ++i) {
+      for (size_t j = i + 1; j < regions_.size(); ++j) {
+        Region& a = regions_[i];
+        const Region& b = regions_[j];
+        if (a.x0 < b.x1 && b.x0 < a.x1 && a.y0 < b.y1 && b.y0 < a.y1) {
+          a.x0 = std::min(a.x0, b.x0);
+          a.y0 = std::min(a.y0, b.y0);
+          a.x1 = std::max(a.x1, b.x1);
+          a.y1 = std::max(a.y1, b.y1);
+          regions_.erase(regions_.begin() + j);
+          is_merged = true;
+          break;
+        }
+      }
+    }
+  }
+  detections_.clear();
+
+  for (Scratch& scratch : scratches_) {
+    scratch.detections.clear();
+  }
+  worker_pool_.ParallelForWithThread(
+      regions_.size(), [&](size_t i, int thread) {
+        Scratch* scratch = &scratches_[thread];
+        Segment(level, regions_[i], nullptr, scratch);
+        TagDetection detection;
+        for (const Component& component : scratch->components) {
+          if (component.boundary_begin >= 0 &&
+              Decode(level, &scratch->boundary[component.boundary_begin],
+                     component.boundary_count, &scratch->hull, &detection)) {
+            scratch->detections.push_back(detection);
+          }
+        }
+      });
+  for (const Scratch& scratch : scratches_) {
+    detections_.insert(detections_.end(), scratch.detections.begin(),
+                       scratch.detections.end());
+  }
+}
+
+size_t TagDetector::Detect(const ImagePyramidLevel& level,
+                           const TangoCameraIntrinsics& intrinsics) {
+  TANGO_TRACE_SCOPE("TagDetector::Detect");
+  if (level.data == nullptr || level.width <= 0 || level.height <= 0 ||
+      intrinsics.width == 0 || family_.codes.empty()) {
+    detections_.clear();
+    return 0;
+  }
+  // The pinhole of the level, whose pixels cover those of the image
+  // |scale| times as wide.
+  const float scale = static_cast<float>(level.width) / intrinsics.width;
+  fx_ = static_cast<float>(intrinsics.fx) * scale;
+  fy_ = static_cast<float>(intrinsics.fy) * scale;
+  cx_ = static_cast<float>(intrinsics.cx + 0.5) * scale;
+  cy_ = static_cast<float>(intrinsics.cy + 0.5) * scale;
+
+  was_full_search_ = frames_to_full_search_ <= 0;
+  if (was_full_search_) {
+    frames_to_full_search_ = options_.full_search_interval - 1;
+    detections_.clear();
+    SearchLevel(level);
+  } else {
+    --frames_to_full_search_;
+    SearchRegions(level);
+  }
+
+  // One tag per id, the one read with the fewest corrections.
+  std::sort(detections_.begin(), detections_.end(),
+            [](const TagDetection& a, const TagDetection& b) {
+              return a.id < b.id ||
+                     (a.id == b.id && a.corrected_bits < b.corrected_bits);
+            });
+  detections_.erase(
+      std::unique(detections_.begin(), detections_.end(),
+                  [](const TagDetection& a, const TagDetection& b) {
+                    return a.id == b.id;
+                  }),
+      detections_.end());
+  return detections_.size();
+}
+}  // namespace tango_util
@@ -0,0 +1,384 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/task_scheduler.h"
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+#include <tango-gl/util.h>
+
+#include "tango-util/thread_policy.h"
+
+namespace {
+// CPUs whose frequencies GetCoreMask() reads, one bit each.
+const int kMaxCoreCount = 64;
+
+// How long a waiting thread with nothing to run sleeps before looking for
+// jobs again, since the jobs it could steal do not wake it.
+const std::chrono::microseconds kWaitPollInterval(500);
+
+// @return the maximum frequency of |cpu| in kHz, 0 if it can not be read.
+long ReadMaxFrequency(int cpu) {
+  char path[96];
+  snprintf(path, sizeof(path),
+           "/sys/devices/system/cpu/cpu%d/cpufreq/cpuinfo_max_freq", cpu);
+  FILE* file = fopen(path, "r");
+  if (file == NULL) {
+    return 0;
+  }
+  long frequency = 0;
+  if (fscanf(file, "%ld", &frequency) != 1) {
+    frequency = 0;
+  }
+  fclose(file);
+  return frequency;
+}
+
+int CountCores(uint64_t mask) {
+  int count = 0;
+  for (; mask != 0; mask &= mask - 1) {
+    ++count;
+  }
+  return count;
+}
+
+// Keep the calling thread on the CPUs of |mask|. Bionic has no
+// pthread_setaffinity_np(), the system call takes the thread id instead.
+void PinCurrentThread(uint64_t mask) {
+  const long thread_id = syscall(__NR_gettid);
+  if (syscall(__NR_sched_setaffinity, thread_id, sizeof(mask), &mask) != 0) {
+    LOGE("TaskScheduler: could not pin a worker to CPUs %llx",
+         static_cast<unsigned long long>(mask));
+  }
+}
+
+std::mutex& GetDefaultMutex() {
+  static std::mutex* mutex = new std::mutex();
+  return *mutex;
+}
+
+tango_util::TaskScheduler::Options& GetDefaultOptions() {
+  static tango_util::TaskScheduler::Options* options =
+      new tango_util::TaskScheduler::Options();
+  return *options;
+}
+
+tango_util::TaskScheduler* default_scheduler = nullptr;
+}  // namespace
+
+namespace tango_util {
+
+size_t TaskGraph::Add(const Task& task) {
+  Node node;
+  node.task = task;
+  node.predecessor_count = 0;
+  nodes_.push_back(node);
+  return nodes_.size() - 1;
+}
+
+void TaskGraph::Precede(size_t predecessor, size_t successor) {
+  nodes_[predecessor].successors.push_back(successor);
+  ++nodes_[successor].predecessor_count;
+}
+
+TaskScheduler::Options::Options() : core_policy(kAnyCore), worker_count(-1) {}
+
+TaskScheduler::TaskScheduler(const Options& options)
+    : queued_count_(0), sleeping_count_(0), is_stopping_(false) {
+  const uint64_t core_mask = GetCoreMask(options.core_policy);
+  int worker_count = options.worker_count;
+  if (worker_count < 0) {
+    const int core_count =
+        core_mask != 0
+            ? CountCores(core_mask)
+            : static_cast<int>(std::thread::hardware_concurrency());
+    worker_count = std::max(core_count - 1, 0);
+  }
+  for (int i = 0; i < worker_count; ++i) {
+    workers_.push_back(std::unique_ptr<Worker>(new Worker()));
+  }
+  for (int i = 0; i < worker_count; ++i) {
+    workers_[i]->thread =
+        std::thread(&TaskScheduler::WorkerLoop, this, i, core_mask);
+  }
+}
+
+TaskScheduler::~TaskScheduler() {
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    is_stopping_ = true;
+  }
+  job_available_.notify_all();
+  for (std::unique_ptr<Worker>& worker : workers_) {
+    worker->thread.join();
+  }
+}
+
+TaskScheduler& TaskScheduler::Get() {
+  std::lock_guard<std::mutex> lock(GetDefaultMutex());
+  if (default_scheduler == nullptr) {
+    default_scheduler = new TaskScheduler(GetDefaultOptions());
+  }
+  return *default_scheduler;
+}
+
+bool TaskScheduler::SetDefaultOptions(const Options& options) {
+  std::lock_guard<std::mutex> lock(GetDefaultMutex());
+  if (default_scheduler != nullptr) {
+    return false;
+  }
+  GetDefaultOptions() = options;
+  return true;
+}
+
+void TaskScheduler::ParallelFor(size_t begin, size_t end, size_t grain,
+                                const RangeTask& task) {
+  if (begin >= end) {
+    return;
+  }
+  const size_t count = end - begin;
+  if (grain == 0) {
+    grain = std::max<size_t>(count / (4 * (workers_.size() + 1)), 1);
+  }
+  if (workers_.empty() || count <= grain) {
+    task(begin, end);
+    return;
+  }
+  RangeContext context;
+  context.task = &task;
+  context.grain = grain;
+  Batch batch;
+  batch.pending.store(1);
+  Job job;
+  job.run = &TaskScheduler::RunRange;
+  job.context = &context;
+  job.batch = &batch;
+  job.begin = begin;
+  job.end = end;
+  RunRange(this, job);
+  Wait(&batch);
+}
+
+void TaskScheduler::Run(TaskGraph* graph) {
+  const size_t count = graph->nodes_.size();
+  if (count == 0) {
+    return;
+  }
+  graph->remaining_.reset(new std::atomic<size_t>[count]);
+  for (size_t i = 0; i < count; ++i) {
+    graph->remaining_[i].store(graph->nodes_[i].predecessor_count);
+  }
+  Batch batch;
+  batch.pending.store(count);
+  for (size_t i = 0; i < count; ++i) {
+    if (graph->nodes_[i].predecessor_count == 0) {
+      Job job;
+      job.run = &TaskScheduler::RunNode;
+      job.context = graph;
+      job.batch = &batch;
+      job.begin = i;
+      job.end = i + 1;
+      Push(job);
+    }
+  }
+  Wait(&batch);
+}
+
+uint64_t TaskScheduler::GetCoreMask(CorePolicy policy) {
+  if (policy == kAnyCore) {
+    return 0;
+  }
+  const int core_count = std::min(
+      static_cast<int>(sysconf(_SC_NPROCESSORS_CONF)), kMaxCoreCount);
+  long frequencies[kMaxCoreCount];
+  long max_frequency = 0;
+  for (int cpu = 0; cpu < core_count; ++cpu) {
+    frequencies[cpu] = ReadMaxFrequency(cpu);
+    if (frequencies[cpu] == 0) {
+      return 0;
+    }
+    max_frequency = std::max(max_frequency, frequencies[cpu]);
+  }
+  uint64_t big_mask = 0;
+  uint64_t little_mask = 0;
+  for (int cpu = 0; cpu < core_count; ++cpu) {
+    const uint64_t bit = static_cast<uint64_t>(1) << cpu;
+    if (frequencies[cpu] == max_frequency) {
+      big_mask |= bit;
+    } else {
+      little_mask |= bit;
+    }
+  }
+  if (little_mask == 0) {
+    return big_mask;
+  }
+  return policy == kBigCores ? big_mask : little_mask;
+}
+
+void TaskScheduler::RunRange(TaskScheduler* scheduler, const Job& job) {
+  const RangeContext* context =
+      static_cast<const RangeContext*>(job.context);
+  // Queue the upper halves, which other threads steal the oldest and so the
+  // largest of first, and keep splitting the lower one.
+  Job half = job;
+  while (half.end - half.begin > context->grain) {
+    const size_t middle = half.begin + (half.end - half.begin) / 2;
+    Job upper = half;
+    upper.begin = middle;
+    half.end = middle;
+    job.batch->pending.fetch_add(1);
+    scheduler->Push(upper);
+  }
+  (*context->task)(half.begin, half.end);
+  scheduler->Finish(job.batch);
+}
+
+void TaskScheduler::RunNode(TaskScheduler* scheduler, const Job& job) {
+  TaskGraph* graph =
+      const_cast<TaskGraph*>(static_cast<const TaskGraph*>(job.context));
+  const TaskGraph::Node& node = graph->nodes_[job.begin];
+  node.task();
+  for (size_t successor : node.successors) {
+    if (graph->remaining_[successor].fetch_sub(1) == 1) {
+      Job next = job;
+      next.begin = successor;
+      next.end = successor + 1;
+      scheduler->Push(next);
+    }
+  }
+  scheduler->Finish(job.batch);
+}
+
+void TaskScheduler::WorkerLoop(int worker, uint64_t core_mask) {
+  if (core_mask != 0) {
+    PinCurrentThread(core_mask);
+  }
+  ThreadPolicy::Get().Enter(ThreadPolicy::kWorkerStage);
+  while (true) {
+    if (RunOne(worker)) {
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
+    ++sleeping_count_;
+    job_available_.wait(lock, [this] {
+      return is_stopping_ || queued_count_.load() != 0;
+    });
+    --sleeping_count_;
+    if (is_stopping_ && queued_count_.load() == 0) {
+      return;
+    }
+    lock.unlock();
+    ThreadPolicy::Get().Enter(ThreadPolicy::kWorkerStage);
+  }
+}
+
+void TaskScheduler::Push(const Job& job) {
+  const int worker = GetCurrentWorker();
+  if (worker >= 0) {
+    std::lock_guard<std::mutex> lock(workers_[worker]->mutex);
+    workers_[worker]->jobs.push_back(job);
+  } else {
+    std::lock_guard<std::mutex> lock(shared_mutex_);
+    shared_jobs_.push_back(job);
+  }
+  queued_count_.fetch_add(1);
+  // Sleeping workers check the count under the lock, so none misses it.
+  std::lock_guard<std::mutex> lock(sleep_mutex_);
+  if (sleeping_count_ > 0) {
+    job_available_.notify_one();
+  }
+}
+
+bool TaskScheduler::RunOne(int worker) {
+  if (queued_count_.load() == 0) {
+    return false;
+  }
+  Job job;
+  bool is_found = false;
+  if (worker >= 0) {
+    std::lock_guard<std::mutex> lock(workers_[worker]->mutex);
+    std::deque<Job>& jobs = workers_[worker]->jobs;
+    if (!jobs.empty()) {
+      job = jobs.back();
+      jobs.pop_back();
+      is_found = true;
+    }
+  }
+  if (!is_found) {
+    std::lock_guard<std::mutex> lock(shared_mutex_);
+    if (!shared_jobs_.empty()) {
+      job = shared_jobs_.front();
+      shared_jobs_.pop_front();
+      is_found = true;
+    }
+  }
+  const size_t worker_count = workers_.size();
+  for (size_t i = 1; !is_found && i <= worker_count; ++i) {
+    const size_t victim = (worker + i) % worker_count;
+    std::lock_guard<std::mutex> lock(workers_[victim]->mutex);
+    std::deque<Job>& jobs = workers_[victim]->jobs;
+    if (!jobs.empty()) {
+      job = jobs.front();
+      jobs.pop_front();
+      is_found = true;
+    }
+  }
+  if (!is_found) {
+    return false;
+  }
+  queued_count_.fetch_sub(1);
+  job.run(this, job);
+  return true;
+}
+
+void TaskScheduler::Wait(Batch* batch) {
+  const int worker = GetCurrentWorker();
+  while (batch->pending.load() != 0) {
+    if (RunOne(worker)) {
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(batch->mutex);
+    batch->done.wait_for(lock, kWaitPollInterval,
+                         [batch] { return batch->is_done; });
+  }
+  std::unique_lock<std::mutex> lock(batch->mutex);
+  batch->done.wait(lock, [batch] { return batch->is_done; });
+}
+
+void TaskScheduler::Finish(Batch* batch) {
+  if (batch->pending.fetch_sub(1) != 1) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(batch->mutex);
+  batch->is_done = true;
+  batch->done.notify_all();
+}
+
+int TaskScheduler::GetCurrentWorker() const {
+  const std::thread::id id = std::this_thread::get_id();
+  for (size_t i = 0; i < workers_.size(); ++i) {
+    if (workers_[i]->thread.get_id() == id) {
+      return static_cast<int>(i);
+    }
+  }
+  return -1;
+}
+}  // namespace tango_util
@@ -0,0 +1,425 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/texture_atlas_baker.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// Color of the texels no keyframe sees.
+const uint8_t kUnseenColor = 128;
+
+// Nearest distance of a point to a keyframe camera, in meters.
+const float kMinDepth = 0.1f;
+
+// Bilinear sample of an RGB image at |pixel|, in pixels with the centers at
+// half integers, clamped to the border.
+void SampleBilinear(const tango_util::Keyframe& keyframe,
+                    const glm::vec2& pixel, uint8_t* rgb) {
+  const float x = std::max(
+      0.0f, std::min(pixel.x - 0.5f, static_cast<float>(keyframe.width - 1)));
+  const float y = std::max(
+      0.0f, std::min(pixel.y - 0.5f, static_cast<float>(keyframe.height - 1)));
+  const int x0 = static_cast<int>(x);
+  const int y0 = static_cast<int>(y);
+  const int x1 = std::min(x0 + 1, keyframe.width - 1);
+  const int y1 = std::min(y0 + 1, keyframe.height - 1);
+  const float fx = x - x0;
+  const float fy = y - y0;
+  const int row_stride = keyframe.width * 3;
+  const uint8_t* p00 = keyframe.rgb + y0 * row_stride + x0 * 3;
+  const uint8_t* p01 = keyframe.rgb + y0 * row_stride + x1 * 3;
+  const uint8_t* p10 = keyframe.rgb + y1 * row_stride + x0 * 3;
+  const uint8_t* p11 = keyframe.rgb + y1 * row_stride + x1 * 3;
+  for (int c = 0; c < 3; ++c) {
+    const float top = p00[c] + (p01[c] - p00[c]) * fx;
+    const float bottom = p10[c] + (p11[c] - p10[c]) * fx;
+    rgb[c] = static_cast<uint8_t>(top + (bottom - top) * fy + 0.5f);
+  }
+}
+}  // namespace
+
+namespace tango_util {
+
+TextureAtlasBaker::Options::Options()
+    : atlas_size(2048),
+      tile_size(4),
+      max_bake_faces(20000),
+      max_view_angle(1.3f),
+      thread_count(2) {}
+
+TextureAtlasBaker::TextureAtlasBaker(const Options& options)
+    : atlas_size_(options.atlas_size),
+      tile_size_(std::max(options.tile_size, 2)),
+      tiles_per_row_(options.atlas_size / std::max(options.tile_size, 2)),
+      max_bake_faces_(options.max_bake_faces),
+      min_view_cosine_(std::cos(options.max_view_angle)),
+      has_intrinsics_(false),
+      fx_(0.0f),
+      fy_(0.0f),
+      cx_(0.0f),
+      cy_(0.0f),
+      has_warned_full_(false),
+      atlas_(static_cast<size_t>(options.atlas_size) * options.atlas_size * 3,
+             kUnseenColor),
+      dirty_tile_rows_(tiles_per_row_, true),
+      worker_pool_(options.thread_count) {
+  Clear();
+}
+
+void TextureAtlasBaker::SetIntrinsics(
+    const TangoCameraIntrinsics& intrinsics) {
+  fx_ = static_cast<float>(intrinsics.fx);
+  fy_ = static_cast<float>(intrinsics.fy);
+  cx_ = static_cast<float>(intrinsics.cx);
+  cy_ = static_cast<float>(intrinsics.cy);
+  has_intrinsics_ = intrinsics.width > 0 && intrinsics.height > 0;
+}
+
+bool TextureAtlasBaker::UpdateBlock(const TangoMesh_Experimental* mesh) {
+  const BlockKey key(mesh->index[0], mesh->index[1], mesh->index[2]);
+  std::map<BlockKey, Block>::iterator it = blocks_.find(key);
+  if (it != blocks_.end()) {
+    FreeTiles(&it->second);
+    blocks_.erase(it);
+  }
+  if (mesh->num_faces == 0) {
+    return false;
+  }
+  const size_t tile_count = (mesh->num_faces + 1) / 2;
+  if (free_tiles_.size() < tile_count) {
+    if (!has_warned_full_) {
+      has_warned_full_ = true;
+      LOGE("TextureAtlasBaker: The atlas is full, blocks stay untextured");
+    }
+    return false;
+  }
+
+  // Stale entries of the queue are skipped by Bake().
+  Block& block = blocks_[key];
+  block.mesh = mesh;
+  block.tiles.assign(free_tiles_.end() - tile_count, free_tiles_.end());
+  free_tiles_.resize(free_tiles_.size() - tile_count);
+  glm::vec3 bounds_min(mesh->vertices[0][0], mesh->vertices[0][1],
+                       mesh->vertices[0][2]);
+  glm::vec3 bounds_max = bounds_min;
+  for (uint32_t i = 1; i < mesh->num_vertices; ++i) {
+    const glm::vec3 vertex(mesh->vertices[i][0], mesh->vertices[i][1],
+                           mesh->vertices[i][2]);
+    bounds_min = glm::min(bounds_min, vertex);
+    bounds_max = glm::max(bounds_max, vertex);
+  }
+  block.center = 0.5f * (bounds_min + bounds_max);
+  block.radius = 0.5f * glm::distance(bounds_min, bounds_max);
+  block.is_queued = true;
+  block.is_baked = false;
+  queue_.push_back(key);
+  return true;
+}
+
+void TextureAtlasBaker::OnKeyframeChanged(const Keyframe& keyframe) {
+  if (!has_intrinsics_) {
+    return;
+  }
+  const float scale =
+      static_cast<float>(keyframe.width) / keyframe.image_width;
+  for (std::pair<const BlockKey, Block>& entry : blocks_) {
+    Block& block = entry.second;
+    if (block.is_queued) {
+      continue;
+    }
+    glm::vec2 pixel;
+    float depth;
+    if (!Project(keyframe, block.center, &pixel, &depth)) {
+      continue;
+    }
+    // The block is seen when its bounding sphere overlaps the image.
+    const float margin = fx_ * scale * block.radius / depth;
+    if (pixel.x < -margin || pixel.y < -margin ||
+        pixel.x > keyframe.width + margin ||
+        pixel.y > keyframe.height + margin) {
+      continue;
+    }
+    block.is_queued = true;
+    queue_.push_back(entry.first);
+  }
+}
+
+void TextureAtlasBaker::Bake(const KeyframeStore& keyframes,
+                             std::vector<BlockKey>* baked) {
+  baked->clear();
+  if (!has_intrinsics_ || keyframes.GetKeyframeCount() == 0) {
+    return;
+  }
+  batch_.clear();
+  size_t face_count = 0;
+  while (!queue_.empty() && face_count < max_bake_faces_) {
+    const BlockKey key = queue_.front();
+    queue_.pop_front();
+    std::map<BlockKey, Block>::iterator it = blocks_.find(key);
+    if (it == blocks_.end() || !it->second.is_queued) {
+      continue;
+    }
+    it->second.is_queued = false;
+    batch_.push_back(&it->second);
+    baked->push_back(key);
+    face_count += it->second.mesh->num_faces;
+  }
+  if (batch_.empty()) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(atlas_mutex_);
+  // The blocks have tiles of their own, the threads never write the same
+  // texels.
+  worker_pool_.ParallelFor(batch_.size(), [this, &keyframes](size_t i) {
+    const Block& block = *batch_[i];
+    for (uint32_t face = 0; face < block.mesh->num_faces; ++face) {
+      BakeFace(*block.mesh, face, block.tiles[face / 2], keyframes);
+    }
+  });
+  for (Block* block : batch_) {
+    block->is_baked = true;
+    for (uint32_t tile : block->tiles) {
+      dirty_tile_rows_[tile / tiles_per_row_] = true;
+    }
+  }
+}
+
+bool TextureAtlasBaker::GetBlockUvs(const BlockKey& key,
+                                    std::vector<float>* uvs) const {
+  std::map<BlockKey, Block>::const_iterator it = blocks_.find(key);
+  if (it == blocks_.end() || !it->second.is_baked) {
+    return false;
+  }
+  const Block& block = it->second;
+  const float inverse_size = 1.0f / atlas_size_;
+  uvs->resize(block.mesh->num_faces * 6);
+  float* uv = uvs->data();
+  for (uint32_t face = 0; face < block.mesh->num_faces; ++face) {
+    glm::vec2 corners[3];
+    GetTileCorners(block.tiles[face / 2], face % 2, corners);
+    for (int k = 0; k < 3; ++k) {
+      *uv++ = corners[k].x * inverse_size;
+      *uv++ = corners[k].y * inverse_size;
+    }
+  }
+  return true;
+}
+
+void TextureAtlasBaker::Clear() {
+  blocks_.clear();
+  queue_.clear();
+  const uint32_t tile_count =
+      static_cast<uint32_t>(tiles_per_row_) * tiles_per_row_;
+  free_tiles_.resize(tile_count);
+  for (uint32_t i = 0; i < tile_count; ++i) {
+    free_tiles_[i] = tile_count - 1 - i;
+  }
+  has_warned_full_ = false;
+}
+
+bool TextureAtlasBaker::UploadDirtyRows(
+    const std::function<void(int y, int height, const uint8_t* rows)>&
+        upload) {
+  std::unique_lock<std::mutex> lock(atlas_mutex_, std::try_to_lock);
+  if (!lock.owns_lock()) {
+    return false;
+  }
+  const size_t row_size = static_cast<size_t>(atlas_size_) * 3;
+  int begin = 0;
+  while (begin < tiles_per_row_) {
+    if (!dirty_tile_rows_[begin]) {
+      ++begin;
+      continue;
+    }
+    int end = begin;
+    while (end < tiles_per_row_ && dirty_tile_rows_[end]) {
+      dirty_tile_rows_[end] = false;
+      ++end;
+    }
+    const int y = begin * tile_size_;
+    upload(y, (end - begin) * tile_size_, atlas_.data() + y * row_size);
+    begin = end;
+  }
+  return true;
+}
+
+void TextureAtlasBaker::MarkAtlasDirty() {
+  std::lock_guard<std::mutex> lock(atlas_mutex_);
+  std::fill(dirty_tile_rows_.begin(), dirty_tile_rows_.end(), true);
+}
+
+void TextureAtlasBaker::FreeTiles(Block* block) {
+  free_tiles_.insert(free_tiles_.end(), block->tiles.begin(),
+                     block->tiles.end());
+  block->tiles.clear();
+}
+
+void TextureAtlasBaker::BakeFace(const TangoMesh_Experimental& mesh,
+                                 uint32_t face, uint32_t tile,
+                                 const KeyframeStore& keyframes) {
+  glm::vec3 corners[3];
+  for (int k = 0; k < 3; ++k) {
+    const float* vertex = mesh.vertices[mesh.faces[face][k]];
+    corners[k] = glm::vec3(vertex[0], vertex[1], vertex[2]);
+  }
+  // Marching cubes orients the vertex normals towards the free space, which
+  // the keyframe must be on. Without them, either side of the face will do.
+  glm::vec3 normal =
+      glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+  bool is_oriented = false;
+  if (mesh.has_normals) {
+    glm::vec3 vertex_normals(0.0f);
+    for (int k = 0; k < 3; ++k) {
+      const float* vertex_normal = mesh.normals[mesh.faces[face][k]];
+      vertex_normals +=
+          glm::vec3(vertex_normal[0], vertex_normal[1], vertex_normal[2]);
+    }
+    if (glm::dot(normal, vertex_normals) < 0.0f) {
+      normal = -normal;
+    }
+    is_oriented = true;
+  }
+  const int keyframe_index =
+      SelectKeyframe(corners, normal, is_oriented, keyframes);
+
+  // Half 0 has the corners at (0, 0), (1, 0) and (0, 1) of the tile, half 1
+  // at (1, 1), (0, 1) and (1, 0), the texels of the diagonal going to half 0.
+  const int half = face % 2;
+  const int tile_x = static_cast<int>(tile % tiles_per_row_) * tile_size_;
+  const int tile_y = static_cast<int>(tile / tiles_per_row_) * tile_size_;
+  const float inverse_span = 1.0f / (tile_size_ - 1);
+  const glm::vec3 edge_1 = corners[1] - corners[0];
+  const glm::vec3 edge_2 = corners[2] - corners[0];
+  const size_t row_size = static_cast<size_t>(atlas_size_) * 3;
+  for (int y = 0; y < tile_size_; ++y) {
+    uint8_t* row = atlas_.data() + (tile_y + y) * row_size + tile_x * 3;
+    for (int x = 0; x < tile_size_; ++x) {
+      const bool is_lower = x + y <= tile_size_ - 1;
+      if (is_lower != (half == 0)) {
+        continue;
+      }
+      uint8_t* texel = row + x * 3;
+      if (keyframe_index < 0) {
+        texel[0] = texel[1] = texel[2] = kUnseenColor;
+        continue;
+      }
+      float a = x * inverse_span;
+      float b = y * inverse_span;
+      if (half == 1) {
+        a = 1.0f - a;
+        b = 1.0f - b;
+      }
+      const glm::vec3 point = corners[0] + a * edge_1 + b * edge_2;
+      const Keyframe& keyframe = keyframes.GetKeyframe(keyframe_index);
+      glm::vec2 pixel;
+      float depth;
+      if (Project(keyframe, point, &pixel, &depth)) {
+        SampleBilinear(keyframe, pixel, texel);
+      } else {
+        texel[0] = texel[1] = texel[2] = kUnseenColor;
+      }
+    }
+  }
+}
+
+int TextureAtlasBaker::SelectKeyframe(const glm::vec3 corners[3],
+                                      const glm::vec3& normal,
+                                      bool is_oriented,
+                                      const KeyframeStore& keyframes) const {
+  const float normal_length = glm::length(normal);
+  if (normal_length <= 0.0f) {
+    return -1;
+  }
+  const glm::vec3 unit_normal = normal / normal_length;
+  const glm::vec3 center = (corners[0] + corners[1] + corners[2]) / 3.0f;
+
+  int best_index = -1;
+  float best_score = 0.0f;
+  for (int i = 0; i < keyframes.GetKeyframeCount(); ++i) {
+    const Keyframe& keyframe = keyframes.GetKeyframe(i);
+    const glm::vec3 to_camera = glm::vec3(keyframe.world_T_camera[3]) - center;
+    const float distance = glm::length(to_camera);
+    if (distance < kMinDepth) {
+      continue;
+    }
+    float cosine = glm::dot(unit_normal, to_camera) / distance;
+    if (!is_oriented) {
+      cosine = std::fabs(cosine);
+    }
+    if (cosine < min_view_cosine_) {
+      continue;
+    }
+    bool is_inside = true;
+    for (int k = 0; k < 3 && is_inside; ++k) {
+      glm::vec2 pixel;
+      float depth;
+      is_inside = Project(keyframe, corners[k], &pixel, &depth) &&
+                  pixel.x >= 0.0f && pixel.y >= 0.0f &&
+                  pixel.x < keyframe.width && pixel.y < keyframe.height;
+    }
+    if (!is_inside) {
+      continue;
+    }
+    // Frontal views resolve the face best, near ones with the most pixels.
+    const float score = cosine / distance;
+    if (score > best_score) {
+      best_score = score;
+      best_index = i;
+    }
+  }
+  return best_index;
+}
+
+bool TextureAtlasBaker::Project(const Keyframe& keyframe,
+                                const glm::vec3& point, glm::vec2* pixel,
+                                float* depth) const {
+  const glm::vec4 camera_point = keyframe.camera_T_world * glm::vec4(point, 1);
+  if (camera_point.z < kMinDepth) {
+    return false;
+  }
+  // The keyframe pixels cover |scale| camera pixels each way. The lens
+  // distortion is left out, it is small at the keyframe resolution.
+  const float scale =
+      static_cast<float>(keyframe.width) / keyframe.image_width;
+  pixel->x = (fx_ * camera_point.x / camera_point.z + cx_) * scale;
+  pixel->y = (fy_ * camera_point.y / camera_point.z + cy_) * scale;
+  *depth = camera_point.z;
+  return true;
+}
+
+void TextureAtlasBaker::GetTileCorners(uint32_t tile, int half,
+                                       glm::vec2 corners[3]) const {
+  const float x0 =
+      static_cast<float>(tile % tiles_per_row_) * tile_size_ + 0.5f;
+  const float y0 =
+      static_cast<float>(tile / tiles_per_row_) * tile_size_ + 0.5f;
+  const float x1 = x0 + tile_size_ - 1;
+  const float y1 = y0 + tile_size_ - 1;
+  if (half == 0) {
+    corners[0] = glm::vec2(x0, y0);
+    corners[1] = glm::vec2(x1, y0);
+    corners[2] = glm::vec2(x0, y1);
+  } else {
+    corners[0] = glm::vec2(x1, y1);
+    corners[1] = glm::vec2(x0, y1);
+    corners[2] = glm::vec2(x1, y0);
+  }
+}
+
+}  // namespace tango_util
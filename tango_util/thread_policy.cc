@@ -0,0 +1,199 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/thread_policy.h"
+
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include <tango-gl/util.h>
+
+namespace {
+// CPUs the masks cover, one bit each, as in TaskScheduler.
+const int kMaxCoreCount = 64;
+
+// Nice values of Android's THREAD_PRIORITY_URGENT_DISPLAY, _DISPLAY and
+// _BACKGROUND.
+const int kUrgentDisplayNice = -8;
+const int kDisplayNice = -4;
+const int kBackgroundNice = 10;
+
+// @return: the CPU the calling thread runs on, -1 if it can not be read.
+int GetCurrentCpu() {
+  unsigned int cpu = 0;
+  if (syscall(__NR_getcpu, &cpu, nullptr, nullptr) != 0) {
+    return -1;
+  }
+  return static_cast<int>(cpu);
+}
+}  // namespace
+
+namespace tango_util {
+
+struct ThreadPolicy::Placement {
+  // The generation of the policy the thread was placed by, 0 for none.
+  uint32_t generation;
+  int stage;
+  // Whether the thread was pinned or reniced, to undo it.
+  bool is_pinned;
+  bool is_reniced;
+};
+
+ThreadPolicy& ThreadPolicy::Get() {
+  static ThreadPolicy* policy = new ThreadPolicy();
+  return *policy;
+}
+
+ThreadPolicy::ThreadPolicy()
+    : big_core_mask_(TaskScheduler::GetCoreMask(TaskScheduler::kBigCores)),
+      little_core_mask_(
+          TaskScheduler::GetCoreMask(TaskScheduler::kLittleCores)),
+      all_core_mask_(0),
+      is_enabled_(false),
+      generation_(1) {
+  const int core_count = std::min(
+      static_cast<int>(sysconf(_SC_NPROCESSORS_CONF)), kMaxCoreCount);
+  for (int cpu = 0; cpu < core_count; ++cpu) {
+    all_core_mask_ |= static_cast<uint64_t>(1) << cpu;
+  }
+  policies_[kRenderStage] = {TaskScheduler::kBigCores, kUrgentDisplayNice};
+  policies_[kCallbackStage] = {TaskScheduler::kBigCores, kDisplayNice};
+  policies_[kWorkerStage] = {TaskScheduler::kAnyCore, 0};
+  policies_[kBulkStage] = {TaskScheduler::kLittleCores, kBackgroundNice};
+  for (StageState& state : states_) {
+    state.last_cpu.store(-1);
+    state.entry_count.store(0);
+    state.big_core_entry_count.store(0);
+  }
+}
+
+void ThreadPolicy::SetEnabled(bool is_enabled) {
+  if (is_enabled_.exchange(is_enabled) != is_enabled) {
+    generation_.fetch_add(1);
+  }
+}
+
+void ThreadPolicy::SetStagePolicy(Stage stage, const StagePolicy& policy) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    policies_[stage] = policy;
+  }
+  generation_.fetch_add(1);
+}
+
+ThreadPolicy::StagePolicy ThreadPolicy::GetStagePolicy(Stage stage) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return policies_[stage];
+}
+
+void ThreadPolicy::Enter(Stage stage) {
+  // Plain data, so that the threads of the process need not destroy it.
+  static thread_local Placement placement = {0, -1, false, false};
+  const uint32_t generation = generation_.load();
+  if (placement.generation != generation || placement.stage != stage) {
+    Place(stage, &placement);
+    placement.generation = generation;
+    placement.stage = stage;
+  }
+
+  StageState& state = states_[stage];
+  const int cpu = GetCurrentCpu();
+  state.last_cpu.store(cpu, std::memory_order_relaxed);
+  state.entry_count.fetch_add(1, std::memory_order_relaxed);
+  if (cpu >= 0 && IsBigCore(cpu)) {
+    state.big_core_entry_count.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+ThreadPolicy::StageStats ThreadPolicy::GetStageStats(Stage stage) const {
+  const StageState& state = states_[stage];
+  StageStats stats;
+  stats.last_cpu = state.last_cpu.load(std::memory_order_relaxed);
+  stats.entry_count = state.entry_count.load(std::memory_order_relaxed);
+  stats.big_core_entry_count =
+      state.big_core_entry_count.load(std::memory_order_relaxed);
+  return stats;
+}
+
+bool ThreadPolicy::IsBigCore(int cpu) const {
+  if (big_core_mask_ == 0 || cpu < 0 || cpu >= kMaxCoreCount) {
+    return big_core_mask_ == 0;
+  }
+  return (big_core_mask_ >> cpu) & 1;
+}
+
+const char* ThreadPolicy::GetStageName(Stage stage) {
+  switch (stage) {
+    case kRenderStage:
+      return "render";
+    case kCallbackStage:
+      return "callback";
+    case kWorkerStage:
+      return "worker";
+    case kBulkStage:
+      return "bulk";
+    default:
+      return "unknown";
+  }
+}
+
+void ThreadPolicy::Place(Stage stage, Placement* placement) {
+  StagePolicy policy = {TaskScheduler::kAnyCore, 0};
+  if (is_enabled_.load()) {
+    policy = GetStagePolicy(stage);
+  }
+  // Bionic has no pthread_setaffinity_np(), nor a pthread priority of its
+  // own: the system calls take the thread id.
+  const long thread_id = syscall(__NR_gettid);
+
+  uint64_t core_mask = 0;
+  if (policy.core_policy == TaskScheduler::kBigCores) {
+    core_mask = big_core_mask_;
+  } else if (policy.core_policy == TaskScheduler::kLittleCores) {
+    core_mask = little_core_mask_;
+  }
+  // A thread left where it is by the policy goes back to every CPU only if
+  // the policy pinned it before.
+  if (core_mask == 0 && placement->is_pinned) {
+    core_mask = all_core_mask_;
+  }
+  if (core_mask != 0) {
+    if (syscall(__NR_sched_setaffinity, thread_id, sizeof(core_mask),
+                &core_mask) != 0) {
+      LOGE("ThreadPolicy: could not pin a %s thread to CPUs %llx",
+           GetStageName(stage),
+           static_cast<unsigned long long>(core_mask));  // NOLINT
+    } else {
+      placement->is_pinned = core_mask != all_core_mask_;
+    }
+  }
+
+  if (policy.nice != 0 || placement->is_reniced) {
+    // Raising the priority above the default can be refused, the thread then
+    // keeps its priority.
+    if (setpriority(PRIO_PROCESS, static_cast<id_t>(thread_id),
+                    policy.nice) != 0) {
+      LOGE("ThreadPolicy: could not set a %s thread to nice %d",
+           GetStageName(stage), policy.nice);
+    } else {
+      placement->is_reniced = policy.nice != 0;
+    }
+  }
+}
+}  // namespace tango_util
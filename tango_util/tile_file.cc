@@ -0,0 +1,119 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/tile_file.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <tango-gl/util.h>
+
+namespace tango_util {
+
+TileFile::TileFile()
+    : fd_(-1),
+      record_size_(0),
+      record_count_(0),
+      mapped_record_(-1),
+      mapped_data_(nullptr) {}
+
+TileFile::~TileFile() { Close(); }
+
+bool TileFile::Open(const std::string& path, size_t record_size) {
+  Close();
+  // Records are mapped at their offset, which must be a multiple of the page
+  // size.
+  const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  record_size_ = (record_size + page_size - 1) / page_size * page_size;
+  fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+  if (fd_ < 0) {
+    LOGE("TileFile: Failed to create %s: %s", path.c_str(), strerror(errno));
+    return false;
+  }
+  path_ = path;
+  record_count_ = 0;
+  return true;
+}
+
+void TileFile::Close() {
+  if (fd_ < 0) {
+    return;
+  }
+  Unmap();
+  close(fd_);
+  unlink(path_.c_str());
+  fd_ = -1;
+  record_count_ = 0;
+}
+
+int32_t TileFile::AllocateRecord() {
+  if (fd_ < 0) {
+    return -1;
+  }
+  // The file grows sparse, the new record reads as zeros.
+  const off_t size = static_cast<off_t>(record_size_) * (record_count_ + 1);
+  if (ftruncate(fd_, size) != 0) {
+    LOGE("TileFile: Failed to grow %s: %s", path_.c_str(), strerror(errno));
+    return -1;
+  }
+  return record_count_++;
+}
+
+uint8_t* TileFile::Map(int32_t record) {
+  if (record == mapped_record_) {
+    return mapped_data_;
+  }
+  Unmap();
+  if (fd_ < 0 || record < 0 || record >= record_count_) {
+    return nullptr;
+  }
+  void* data = mmap(nullptr, record_size_, PROT_READ | PROT_WRITE, MAP_SHARED,
+                    fd_, static_cast<off_t>(record_size_) * record);
+  if (data == MAP_FAILED) {
+    LOGE("TileFile: Failed to map record %d: %s", record, strerror(errno));
+    return nullptr;
+  }
+  mapped_record_ = record;
+  mapped_data_ = static_cast<uint8_t*>(data);
+  return mapped_data_;
+}
+
+void TileFile::Reset() {
+  if (fd_ < 0) {
+    return;
+  }
+  Unmap();
+  if (ftruncate(fd_, 0) != 0) {
+    LOGE("TileFile: Failed to truncate %s: %s", path_.c_str(),
+         strerror(errno));
+  }
+  record_count_ = 0;
+}
+
+void TileFile::Unmap() {
+  if (mapped_data_ != nullptr) {
+    // The pages are written back by the kernel, there is no need to wait for
+    // them.
+    munmap(mapped_data_, record_size_);
+    mapped_data_ = nullptr;
+  }
+  mapped_record_ = -1;
+}
+
+}  // namespace tango_util
@@ -0,0 +1,73 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/touch_queue.h"
+
+#include <algorithm>
+
+namespace tango_util {
+
+const int TouchQueue::kSampleSize;
+
+TouchQueue::Options::Options() : max_sample_count(64) {}
+
+TouchQueue::TouchQueue(const Options& options)
+    : max_sample_count_(std::max(options.max_sample_count, 1)),
+      dropped_count_(0) {
+  samples_.reserve(max_sample_count_);
+}
+
+void TouchQueue::Post(const float* samples, int sample_count) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (int i = 0; i < sample_count; ++i) {
+    const float* values = samples + i * kSampleSize;
+    TouchSample sample;
+    sample.touch_count = static_cast<int>(values[0]);
+    sample.event =
+        static_cast<tango_gl::GestureCamera::TouchEvent>(values[1]);
+    sample.x0 = values[2];
+    sample.y0 = values[3];
+    sample.x1 = values[4];
+    sample.y1 = values[5];
+    if (!samples_.empty()) {
+      TouchSample& last = samples_.back();
+      if (sample.event == tango_gl::GestureCamera::kTouchMove &&
+          last.event == tango_gl::GestureCamera::kTouchMove &&
+          sample.touch_count == last.touch_count) {
+        last = sample;
+        continue;
+      }
+    }
+    if (static_cast<int>(samples_.size()) >= max_sample_count_) {
+      samples_.erase(samples_.begin());
+      ++dropped_count_;
+    }
+    samples_.push_back(sample);
+  }
+}
+
+void TouchQueue::Take(std::vector<TouchSample>* samples) {
+  samples->clear();
+  std::lock_guard<std::mutex> lock(mutex_);
+  samples->swap(samples_);
+}
+
+uint64_t TouchQueue::GetDroppedCount() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return dropped_count_;
+}
+
+}  // namespace tango_util
@@ -0,0 +1,471 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/tsdf_volume.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <tango_support_api.h>
+
+#include "tango-util/marching_cubes.h"
+
+namespace {
+const int kBlockSize = tango_util::TsdfVolume::kBlockSize;
+
+// Block coordinates are packed into 21 bits each, offset to be unsigned.
+const int kCoordinateBits = 21;
+const int32_t kCoordinateOffset = 1 << (kCoordinateBits - 1);
+const uint64_t kCoordinateMask = (uint64_t(1) << kCoordinateBits) - 1;
+
+// Samples per voxel along the rays, so no voxel crossed is skipped.
+const float kSamplesPerVoxel = 2.0f;
+
+const int kSampleSize = tango_util::TsdfVolume::kSampleSize;
+
+// Initial size of the scratch arena of a meshing thread, grown to the
+// largest block it meshes.
+const size_t kMeshArenaCapacity = 64 * 1024;
+
+uint64_t PackBlock(const glm::ivec3& block) {
+  uint64_t key = 0;
+  for (int i = 0; i < 3; ++i) {
+    key = (key << kCoordinateBits) |
+          (static_cast<uint64_t>(block[i] + kCoordinateOffset) &
+           kCoordinateMask);
+  }
+  return key;
+}
+
+glm::ivec3 UnpackBlock(uint64_t key) {
+  glm::ivec3 block;
+  for (int i = 2; i >= 0; --i) {
+    block[i] = static_cast<int32_t>(key & kCoordinateMask) - kCoordinateOffset;
+    key >>= kCoordinateBits;
+  }
+  return block;
+}
+
+int32_t FloorDivide(int32_t value, int32_t divisor) {
+  return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+}
+
+int VoxelOffset(int x, int y, int z) {
+  return (z * kBlockSize + y) * kBlockSize + x;
+}
+
+int SampleOffset(int x, int y, int z) {
+  return (z * kSampleSize + y) * kSampleSize + x;
+}
+}  // namespace
+
+namespace tango_util {
+
+const int TsdfVolume::kBlockSize;
+const int TsdfVolume::kSampleSize;
+
+TsdfVolume::Options::Options()
+    : voxel_size(0.04f),
+      truncation_distance(0.12f),
+      max_weight(64.0f),
+      min_depth(0.3f),
+      max_depth(4.0f),
+      min_mesh_weight(2.0f),
+      max_block_count(8192),
+      thread_count(2) {}
+
+TsdfVolume::TsdfVolume(const Options& options)
+    : voxel_size_(options.voxel_size),
+      inverse_voxel_size_(1.0f / options.voxel_size),
+      truncation_distance_(options.truncation_distance),
+      max_weight_(options.max_weight),
+      min_depth_(options.min_depth),
+      max_depth_(options.max_depth),
+      min_mesh_weight_(options.min_mesh_weight),
+      max_block_count_(options.max_block_count),
+      has_warned_full_(false),
+      worker_pool_(options.thread_count) {
+  blocks_.reserve(max_block_count_);
+  for (int i = 0; i < worker_pool_.GetThreadCount(); ++i) {
+    mesh_arenas_.push_back(
+        std::unique_ptr<FrameArena>(new FrameArena(kMeshArenaCapacity)));
+  }
+}
+
+TsdfVolume::~TsdfVolume() {}
+
+void TsdfVolume::Integrate(const TangoXYZij* xyz_ij,
+                           const glm::mat4& start_service_T_depth) {
+  if (xyz_ij == nullptr) {
+    return;
+  }
+  const glm::vec3 origin = glm::vec3(start_service_T_depth[3]);
+  const float step = voxel_size_ / kSamplesPerVoxel;
+
+  // Consecutive samples are mostly in the same block.
+  glm::ivec3 last_block_index(0);
+  Block* last_block = nullptr;
+  for (uint32_t i = 0; i < xyz_ij->xyz_count; ++i) {
+    const float* xyz = xyz_ij->xyz[i];
+    if (!(xyz[2] >= min_depth_ && xyz[2] <= max_depth_)) {
+      continue;
+    }
+    const glm::vec3 point =
+        glm::vec3(start_service_T_depth * glm::vec4(xyz[0], xyz[1], xyz[2],
+                                                    1.0f));
+    const glm::vec3 ray = point - origin;
+    const float distance = glm::length(ray);
+    const glm::vec3 direction = ray / distance;
+
+    glm::ivec3 last_voxel(0);
+    bool has_last_voxel = false;
+    for (float t = distance - truncation_distance_;
+         t <= distance + truncation_distance_; t += step) {
+      const glm::vec3 scaled =
+          glm::floor((origin + direction * t) * inverse_voxel_size_);
+      if (!(glm::all(glm::greaterThan(
+                scaled, glm::vec3(-kCoordinateOffset * kBlockSize))) &&
+            glm::all(glm::lessThan(
+                scaled, glm::vec3(kCoordinateOffset * kBlockSize))))) {
+        break;
+      }
+      const glm::ivec3 voxel = glm::ivec3(scaled);
+      if (has_last_voxel && voxel == last_voxel) {
+        continue;
+      }
+      last_voxel = voxel;
+      has_last_voxel = true;
+
+      // Distance to the surface along the ray, from the voxel center.
+      const glm::vec3 center =
+          (glm::vec3(voxel) + glm::vec3(0.5f)) * voxel_size_;
+      const float sdf =
+          std::min(distance - glm::dot(center - origin, direction),
+                   truncation_distance_);
+      if (sdf < -truncation_distance_) {
+        continue;
+      }
+
+      const glm::ivec3 block_index(FloorDivide(voxel.x, kBlockSize),
+                                   FloorDivide(voxel.y, kBlockSize),
+                                   FloorDivide(voxel.z, kBlockSize));
+      if (last_block == nullptr || block_index != last_block_index) {
+        last_block = GetBlock(block_index, true);
+        last_block_index = block_index;
+        if (last_block == nullptr) {
+          continue;
+        }
+      }
+      if (!last_block->is_changed) {
+        last_block->is_changed = true;
+        changed_blocks_.push_back(block_index);
+      }
+      if (!last_block->is_distance_changed) {
+        last_block->is_distance_changed = true;
+        distance_changed_blocks_.push_back(block_index);
+      }
+
+      const glm::ivec3 local = voxel - block_index * kBlockSize;
+      Voxel& v = last_block->voxels[VoxelOffset(local.x, local.y, local.z)];
+      // Running average, whose weight stops growing at max_weight_.
+      v.weight = std::min(v.weight + 1.0f, max_weight_);
+      v.sdf += (sdf - v.sdf) / v.weight;
+    }
+  }
+}
+
+void TsdfVolume::ExtractMeshes(std::vector<TangoMesh_Experimental>* meshes) {
+  meshes->clear();
+  AddLowerNeighbors(&Block::is_changed, &changed_blocks_);
+  meshes->resize(changed_blocks_.size());
+  worker_pool_.ParallelForWithThread(
+      changed_blocks_.size(), [this, meshes](size_t i, int thread) {
+        FrameArena* arena = mesh_arenas_[thread].get();
+        MeshBlock(changed_blocks_[i], arena, &(*meshes)[i]);
+        arena->Reset();
+      });
+
+  for (const glm::ivec3& block_index : changed_blocks_) {
+    GetBlock(block_index, false)->is_changed = false;
+  }
+  changed_blocks_.clear();
+}
+
+void TsdfVolume::ExtractBlockDistances(std::vector<BlockDistances>* blocks) {
+  AddLowerNeighbors(&Block::is_distance_changed, &distance_changed_blocks_);
+  blocks->resize(distance_changed_blocks_.size());
+  worker_pool_.ParallelFor(distance_changed_blocks_.size(),
+                           [this, blocks](size_t i) {
+                             QuantizeBlock(distance_changed_blocks_[i],
+                                           &(*blocks)[i]);
+                           });
+
+  for (const glm::ivec3& block_index : distance_changed_blocks_) {
+    GetBlock(block_index, false)->is_distance_changed = false;
+  }
+  distance_changed_blocks_.clear();
+}
+
+void TsdfVolume::InvalidateBlockDistances() {
+  for (const std::pair<const uint64_t, std::unique_ptr<Block>>& block :
+       blocks_) {
+    if (!block.second->is_distance_changed) {
+      block.second->is_distance_changed = true;
+      distance_changed_blocks_.push_back(UnpackBlock(block.first));
+    }
+  }
+}
+
+uint64_t TsdfVolume::GetScratchAllocationCount() const {
+  uint64_t count = 0;
+  for (const std::unique_ptr<FrameArena>& arena : mesh_arenas_) {
+    count += arena->GetStats().heap_allocation_count;
+  }
+  return count;
+}
+
+void TsdfVolume::Clear() {
+  blocks_.clear();
+  changed_blocks_.clear();
+  distance_changed_blocks_.clear();
+  has_warned_full_ = false;
+}
+
+TsdfVolume::Block* TsdfVolume::GetBlock(const glm::ivec3& block_index,
+                                        bool create) {
+  const uint64_t key = PackBlock(block_index);
+  std::unordered_map<uint64_t, std::unique_ptr<Block>>::iterator it =
+      blocks_.find(key);
+  if (it != blocks_.end()) {
+    return it->second.get();
+  }
+  if (!create) {
+    return nullptr;
+  }
+  if (blocks_.size() >= max_block_count_) {
+    if (!has_warned_full_) {
+      LOGE("TsdfVolume: %zu blocks allocated, the volume is full.",
+           blocks_.size());
+      has_warned_full_ = true;
+    }
+    return nullptr;
+  }
+  std::unique_ptr<Block> block(new Block);
+  memset(block.get(), 0, sizeof(Block));
+  Block* result = block.get();
+  blocks_[key] = std::move(block);
+  return result;
+}
+
+const TsdfVolume::Block* TsdfVolume::FindBlock(
+    const glm::ivec3& block_index) const {
+  std::unordered_map<uint64_t, std::unique_ptr<Block>>::const_iterator it =
+      blocks_.find(PackBlock(block_index));
+  return it != blocks_.end() ? it->second.get() : nullptr;
+}
+
+void TsdfVolume::AddLowerNeighbors(bool Block::*is_changed,
+                                   std::vector<glm::ivec3>* changed_blocks) {
+  // The cubes of a block reach into its upper neighbors, so the lower
+  // neighbors of a changed block change too.
+  const size_t changed_count = changed_blocks->size();
+  for (size_t i = 0; i < changed_count; ++i) {
+    for (int neighbor = 1; neighbor < 8; ++neighbor) {
+      const glm::ivec3 block_index =
+          (*changed_blocks)[i] -
+          glm::ivec3(neighbor & 1, (neighbor >> 1) & 1, (neighbor >> 2) & 1);
+      Block* block = GetBlock(block_index, false);
+      if (block != nullptr && !(block->*is_changed)) {
+        block->*is_changed = true;
+        changed_blocks->push_back(block_index);
+      }
+    }
+  }
+}
+
+void TsdfVolume::GatherSamples(const glm::ivec3& block_index,
+                               Voxel* samples) const {
+  memset(samples, 0, kSampleSize * kSampleSize * kSampleSize * sizeof(Voxel));
+  for (int neighbor = 0; neighbor < 8; ++neighbor) {
+    const glm::ivec3 offset(neighbor & 1, (neighbor >> 1) & 1,
+                            (neighbor >> 2) & 1);
+    const Block* block = FindBlock(block_index + offset);
+    if (block == nullptr) {
+      continue;
+    }
+    const glm::ivec3 begin = offset * kBlockSize;
+    const glm::ivec3 end =
+        glm::min(begin + glm::ivec3(kBlockSize), glm::ivec3(kSampleSize));
+    for (int z = begin.z; z < end.z; ++z) {
+      for (int y = begin.y; y < end.y; ++y) {
+        for (int x = begin.x; x < end.x; ++x) {
+          samples[SampleOffset(x, y, z)] =
+              block->voxels[VoxelOffset(x - begin.x, y - begin.y, z - begin.z)];
+        }
+      }
+    }
+  }
+}
+
+void TsdfVolume::QuantizeBlock(const glm::ivec3& block_index,
+                               BlockDistances* distances) const {
+  Voxel samples[kSampleSize * kSampleSize * kSampleSize];
+  GatherSamples(block_index, samples);
+  distances->index = block_index;
+  const float scale = 127.5f / truncation_distance_;
+  for (int z = 0; z < kSampleSize; ++z) {
+    for (int y = 0; y < kSampleSize; ++y) {
+      uint8_t* row =
+          &distances->samples[(y * kSampleSize + z) * kSampleSize * 2];
+      for (int x = 0; x < kSampleSize; ++x) {
+        const Voxel& voxel = samples[SampleOffset(x, y, z)];
+        const float value = voxel.sdf * scale + 127.5f;
+        row[2 * x] = static_cast<uint8_t>(
+            std::min(std::max(value + 0.5f, 0.0f), 255.0f));
+        // As the corners of the cubes MeshBlock() meshes.
+        row[2 * x + 1] = voxel.weight >= min_mesh_weight_ &&
+                                 std::fabs(voxel.sdf) < truncation_distance_
+                             ? 255
+                             : 0;
+      }
+    }
+  }
+
+  distances->has_surface = false;
+  for (int z = 0; z < kBlockSize && !distances->has_surface; ++z) {
+    for (int y = 0; y < kBlockSize && !distances->has_surface; ++y) {
+      for (int x = 0; x < kBlockSize && !distances->has_surface; ++x) {
+        bool is_valid = true;
+        int negative_count = 0;
+        for (int corner = 0; corner < 8 && is_valid; ++corner) {
+          const int cx = x + (corner & 1);
+          const int cy = y + ((corner >> 1) & 1);
+          const int cz = z + ((corner >> 2) & 1);
+          const uint8_t* sample =
+              &distances->samples[((cy * kSampleSize + cz) * kSampleSize +
+                                   cx) *
+                                  2];
+          is_valid = sample[1] != 0;
+          negative_count += samples[SampleOffset(cx, cy, cz)].sdf < 0.0f;
+        }
+        distances->has_surface =
+            is_valid && negative_count != 0 && negative_count != 8;
+      }
+    }
+  }
+}
+
+void TsdfVolume::MeshBlock(const glm::ivec3& block_index, FrameArena* arena,
+                           TangoMesh_Experimental* mesh) const {
+  Voxel samples[kSampleSize * kSampleSize * kSampleSize];
+  GatherSamples(block_index, samples);
+
+  // Vertices are shared between the cubes of the block, each is found by the
+  // lower corner of its edge and the axis of the edge.
+  int32_t edge_vertices[kSampleSize * kSampleSize * kSampleSize * 3];
+  for (int32_t& vertex : edge_vertices) {
+    vertex = -1;
+  }
+  ArenaVector<glm::vec3> vertices((ArenaAllocator<glm::vec3>(arena)));
+  ArenaVector<glm::vec3> normals((ArenaAllocator<glm::vec3>(arena)));
+  ArenaVector<uint32_t> faces((ArenaAllocator<uint32_t>(arena)));
+
+  const glm::vec3 block_origin =
+      glm::vec3(block_index * kBlockSize) * voxel_size_;
+  for (int z = 0; z < kBlockSize; ++z) {
+    for (int y = 0; y < kBlockSize; ++y) {
+      for (int x = 0; x < kBlockSize; ++x) {
+        const Voxel* corners[8];
+        uint8_t configuration = 0;
+        bool is_valid = true;
+        for (int corner = 0; corner < 8 && is_valid; ++corner) {
+          corners[corner] =
+              &samples[SampleOffset(x + (corner & 1), y + ((corner >> 1) & 1),
+                                    z + ((corner >> 2) & 1))];
+          // Unobserved voxels, and the jump at the back of the truncation
+          // band, are no surface.
+          is_valid = corners[corner]->weight >= min_mesh_weight_ &&
+                     std::fabs(corners[corner]->sdf) < truncation_distance_;
+          if (corners[corner]->sdf < 0.0f) {
+            configuration |= 1 << corner;
+          }
+        }
+        if (!is_valid || configuration == 0 || configuration == 0xff) {
+          continue;
+        }
+
+        const int8_t* triangles = marching_cubes::GetTriangles(configuration);
+        for (int i = 0; triangles[i] >= 0; ++i) {
+          const int edge = triangles[i];
+          const int a = marching_cubes::kEdgeCorners[edge][0];
+          const int b = marching_cubes::kEdgeCorners[edge][1];
+          const glm::ivec3 corner_a(x + (a & 1), y + ((a >> 1) & 1),
+                                    z + ((a >> 2) & 1));
+          int32_t& vertex =
+              edge_vertices[SampleOffset(corner_a.x, corner_a.y, corner_a.z) *
+                                3 +
+                            edge / 4];
+          if (vertex < 0) {
+            const glm::ivec3 corner_b(x + (b & 1), y + ((b >> 1) & 1),
+                                      z + ((b >> 2) & 1));
+            const float sdf_a = corners[a]->sdf;
+            const float sdf_b = corners[b]->sdf;
+            const float t = sdf_a / (sdf_a - sdf_b);
+            const glm::vec3 position =
+                glm::mix(glm::vec3(corner_a), glm::vec3(corner_b), t);
+            vertex = static_cast<int32_t>(vertices.size());
+            // Voxel values are at the voxel centers.
+            vertices.push_back(block_origin +
+                               (position + glm::vec3(0.5f)) * voxel_size_);
+            normals.push_back(glm::vec3(0.0f));
+          }
+          faces.push_back(static_cast<uint32_t>(vertex));
+        }
+      }
+    }
+  }
+
+  // Area weighted vertex normals.
+  for (size_t i = 0; i < faces.size(); i += 3) {
+    const glm::vec3& a = vertices[faces[i]];
+    const glm::vec3 normal =
+        glm::cross(vertices[faces[i + 1]] - a, vertices[faces[i + 2]] - a);
+    normals[faces[i]] += normal;
+    normals[faces[i + 1]] += normal;
+    normals[faces[i + 2]] += normal;
+  }
+
+  TangoSupport_createMesh(static_cast<uint32_t>(vertices.size()),
+                          static_cast<uint32_t>(faces.size() / 3), true, false,
+                          mesh);
+  mesh->index[0] = block_index.x;
+  mesh->index[1] = block_index.y;
+  mesh->index[2] = block_index.z;
+  for (size_t i = 0; i < vertices.size(); ++i) {
+    const float length = glm::length(normals[i]);
+    const glm::vec3 normal =
+        length > 0.0f ? normals[i] / length : glm::vec3(0.0f, 0.0f, 1.0f);
+    for (int k = 0; k < 3; ++k) {
+      mesh->vertices[i][k] = vertices[i][k];
+      mesh->normals[i][k] = normal[k];
+    }
+  }
+  if (!faces.empty()) {
+    memcpy(mesh->faces[0], faces.data(), faces.size() * sizeof(uint32_t));
+  }
+}
+}  // namespace tango_util
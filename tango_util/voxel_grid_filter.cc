@@ -0,0 +1,182 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/voxel_grid_filter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+// Voxel coordinates are packed into 21 bits each, offset to be unsigned.
+const int kCoordinateBits = 21;
+const int64_t kCoordinateOffset = int64_t(1) << (kCoordinateBits - 1);
+const uint64_t kCoordinateMask = (uint64_t(1) << kCoordinateBits) - 1;
+
+bool PackVoxel(const float* point, float inverse_leaf_size, uint64_t* key) {
+  uint64_t packed = 0;
+  for (int i = 0; i < 3; ++i) {
+    const float scaled = std::floor(point[i] * inverse_leaf_size);
+    // Also rejects NaN.
+    if (!(scaled >= -kCoordinateOffset && scaled < kCoordinateOffset)) {
+      return false;
+    }
+    const uint64_t coordinate =
+        static_cast<uint64_t>(static_cast<int64_t>(scaled) +
+                              kCoordinateOffset) &
+        kCoordinateMask;
+    packed = (packed << kCoordinateBits) | coordinate;
+  }
+  *key = packed;
+  return true;
+}
+
+uint32_t HashVoxel(uint64_t key) {
+  // Fibonacci hashing, the high bits mix every coordinate.
+  return static_cast<uint32_t>((key * 0x9E3779B97F4A7C15ull) >> 32);
+}
+}  // namespace
+
+namespace tango_util {
+
+VoxelGridFilter::VoxelGridFilter()
+    : leaf_size_(0.0f),
+      inverse_leaf_size_(0.0f),
+      capacity_(0),
+      slot_mask_(0),
+      frame_(0) {
+  memset(&filtered_, 0, sizeof(filtered_));
+}
+
+void VoxelGridFilter::Reserve(uint32_t max_point_count) {
+  if (max_point_count <= capacity_) {
+    return;
+  }
+  uint32_t slot_count = 1;
+  while (slot_count < 2 * max_point_count) {
+    slot_count <<= 1;
+  }
+  // Slots are free unless stamped with the current frame, which is never 0.
+  Slot free_slot;
+  memset(&free_slot, 0, sizeof(free_slot));
+  slots_.assign(slot_count, free_slot);
+  slot_mask_ = slot_count - 1;
+  frame_ = 0;
+  capacity_ = max_point_count;
+  used_slots_.reserve(capacity_);
+  points_.resize(3 * capacity_);
+  normals_.reserve(capacity_);
+}
+
+void VoxelGridFilter::SetLeafSize(float leaf_size) {
+  leaf_size_ = leaf_size > 0.0f ? leaf_size : 0.0f;
+  inverse_leaf_size_ = leaf_size_ > 0.0f ? 1.0f / leaf_size_ : 0.0f;
+}
+
+const TangoXYZij* VoxelGridFilter::Filter(const TangoXYZij* xyz_ij) {
+  return Filter(xyz_ij, nullptr, nullptr);
+}
+
+const TangoXYZij* VoxelGridFilter::Filter(const TangoXYZij* xyz_ij,
+                                          const glm::vec3* normals,
+                                          const glm::vec3** filtered_normals) {
+  if (xyz_ij == nullptr || leaf_size_ == 0.0f) {
+    if (filtered_normals != nullptr) {
+      *filtered_normals = normals;
+    }
+    return xyz_ij;
+  }
+
+  // A new stamp makes every slot free again. Once every 2^32 frames the
+  // stamps wrap around, and the table is really cleared.
+  if (++frame_ == 0) {
+    for (Slot& slot : slots_) {
+      slot.frame = 0;
+    }
+    frame_ = 1;
+  }
+  used_slots_.clear();
+
+  const uint32_t point_count = std::min(xyz_ij->xyz_count, capacity_);
+  for (uint32_t i = 0; i < point_count; ++i) {
+    const float* point = xyz_ij->xyz[i];
+    uint64_t key;
+    if (!PackVoxel(point, inverse_leaf_size_, &key)) {
+      continue;
+    }
+    uint32_t index = HashVoxel(key) & slot_mask_;
+    while (true) {
+      Slot& slot = slots_[index];
+      if (slot.frame != frame_) {
+        slot.key = key;
+        slot.frame = frame_;
+        slot.point_count = 1;
+        slot.sum[0] = point[0];
+        slot.sum[1] = point[1];
+        slot.sum[2] = point[2];
+        if (normals != nullptr) {
+          slot.normal_sum[0] = normals[i].x;
+          slot.normal_sum[1] = normals[i].y;
+          slot.normal_sum[2] = normals[i].z;
+        }
+        used_slots_.push_back(index);
+        break;
+      }
+      if (slot.key == key) {
+        ++slot.point_count;
+        slot.sum[0] += point[0];
+        slot.sum[1] += point[1];
+        slot.sum[2] += point[2];
+        if (normals != nullptr) {
+          slot.normal_sum[0] += normals[i].x;
+          slot.normal_sum[1] += normals[i].y;
+          slot.normal_sum[2] += normals[i].z;
+        }
+        break;
+      }
+      index = (index + 1) & slot_mask_;
+    }
+  }
+
+  float* centroid = points_.data();
+  for (uint32_t index : used_slots_) {
+    const Slot& slot = slots_[index];
+    const float inverse_count = 1.0f / slot.point_count;
+    centroid[0] = slot.sum[0] * inverse_count;
+    centroid[1] = slot.sum[1] * inverse_count;
+    centroid[2] = slot.sum[2] * inverse_count;
+    centroid += 3;
+  }
+  if (normals != nullptr) {
+    normals_.resize(used_slots_.size());
+    for (size_t i = 0; i < used_slots_.size(); ++i) {
+      const glm::vec3 sum = glm::make_vec3(slots_[used_slots_[i]].normal_sum);
+      const float length = glm::length(sum);
+      normals_[i] = length > 0.0f ? sum / length : glm::vec3(0.0f);
+    }
+    *filtered_normals = normals_.data();
+  }
+
+  filtered_ = *xyz_ij;
+  filtered_.xyz_count = static_cast<uint32_t>(used_slots_.size());
+  filtered_.xyz = reinterpret_cast<float(*)[3]>(points_.data());
+  // The centroids are not pixels of the depth image.
+  filtered_.ij_rows = 0;
+  filtered_.ij_cols = 0;
+  filtered_.ij = nullptr;
+  return &filtered_;
+}
+}  // namespace tango_util
@@ -0,0 +1,54 @@
+/*
+ * Copyright 2014 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-util/worker_pool.h"
+
+#include <algorithm>
+#include <atomic>
+
+#include "tango-util/task_scheduler.h"
+
+namespace tango_util {
+
+WorkerPool::WorkerPool(int thread_count, TaskScheduler* scheduler)
+    : thread_count_(std::max(thread_count, 0)),
+      scheduler_(scheduler != nullptr ? scheduler : &TaskScheduler::Get()) {}
+
+void WorkerPool::ParallelFor(size_t count, const Task& task) {
+  ParallelForWithThread(count,
+                        [&task](size_t index, int /*thread*/) { task(index); });
+}
+
+void WorkerPool::ParallelForWithThread(size_t count, const ThreadTask& task) {
+  if (count == 0) {
+    return;
+  }
+  // Every slot is a thread index, taken by the one scheduler task that runs
+  // it, which then takes iterations until there are none left.
+  const size_t slot_count =
+      std::min(static_cast<size_t>(thread_count_) + 1, count);
+  std::atomic<size_t> next_index(0);
+  scheduler_->ParallelFor(
+      0, slot_count, 1, [&](size_t slot_begin, size_t slot_end) {
+        for (size_t slot = slot_begin; slot < slot_end; ++slot) {
+          for (size_t index = next_index.fetch_add(1); index < count;
+               index = next_index.fetch_add(1)) {
+            task(index, static_cast<int>(slot));
+          }
+        }
+      });
+}
+}  // namespace tango_util